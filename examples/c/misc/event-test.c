@@ -991,6 +991,22 @@ myDomainEventJobCompletedCallback(virConnectPtr conn G_GNUC_UNUSED,
 }
 
 
+static int
+myDomainEventStatsCallback(virConnectPtr conn G_GNUC_UNUSED,
+                           virDomainPtr dom,
+                           virTypedParameterPtr params,
+                           int nparams,
+                           void *opaque G_GNUC_UNUSED)
+{
+    printf("%s EVENT: Domain %s(%d) stats:\n",
+           __func__, virDomainGetName(dom), virDomainGetID(dom));
+
+    eventTypedParamsPrint(params, nparams);
+
+    return 0;
+}
+
+
 static int
 myDomainEventDeviceRemovalFailedCallback(virConnectPtr conn G_GNUC_UNUSED,
                                          virDomainPtr dom,
@@ -1093,6 +1109,7 @@ struct domainEventData domainEvents[] = {
     DOMAIN_EVENT(VIR_DOMAIN_EVENT_ID_DEVICE_REMOVAL_FAILED, myDomainEventDeviceRemovalFailedCallback),
     DOMAIN_EVENT(VIR_DOMAIN_EVENT_ID_METADATA_CHANGE, myDomainEventMetadataChangeCallback),
     DOMAIN_EVENT(VIR_DOMAIN_EVENT_ID_BLOCK_THRESHOLD, myDomainEventBlockThresholdCallback),
+    DOMAIN_EVENT(VIR_DOMAIN_EVENT_ID_STATS, myDomainEventStatsCallback),
 };
 
 struct storagePoolEventData {
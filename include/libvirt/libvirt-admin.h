@@ -187,6 +187,42 @@ virAdmServerPtr virAdmConnectLookupServer(virAdmConnectPtr conn,
 
 # define VIR_THREADPOOL_JOB_QUEUE_DEPTH "jobQueueDepth"
 
+/**
+ * VIR_THREADPOOL_TARGET_LATENCY:
+ * Macro for the threadpool targetLatency attribute: represents the time in
+ * microseconds jobs should at most wait in the queue, as VIR_TYPED_PARAM_UINT.
+ * If non-zero, the threadpool only creates new workers, up to
+ * VIR_THREADPOOL_WORKERS_MAX, if jobs would otherwise wait longer, and
+ * retires idle workers down to VIR_THREADPOOL_WORKERS_MIN. If zero, new
+ * workers are created whenever all workers are busy and are never retired.
+ */
+
+# define VIR_THREADPOOL_TARGET_LATENCY "targetLatency"
+
+/**
+ * VIR_THREADPOOL_JOB_WAIT_TIME:
+ * Macro for the threadpool jobWaitTime attribute: represents the moving
+ * average of the time in microseconds jobs waited in the queue before being
+ * processed, as VIR_TYPED_PARAM_UINT.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_JOB_WAIT_TIME "jobWaitTime"
+
+/**
+ * VIR_THREADPOOL_JOB_RUN_TIME:
+ * Macro for the threadpool jobRunTime attribute: represents the moving
+ * average of the time in microseconds it took to process a job, as
+ * VIR_TYPED_PARAM_UINT.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_THREADPOOL_JOB_RUN_TIME "jobRunTime"
+
 /* Tunables for a server workerpool */
 int virAdmServerGetThreadPoolParameters(virAdmServerPtr srv,
                                         virTypedParameterPtr *params,
@@ -343,6 +379,66 @@ virAdmServerLookupClient(virAdmServerPtr srv,
 
 # define VIR_CLIENT_INFO_SELINUX_CONTEXT "selinux_context"
 
+/**
+ * VIR_CLIENT_INFO_EVENTS_QUEUED:
+ * Macro represents the number of asynchronous events waiting to be sent
+ * to the client, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_CLIENT_INFO_EVENTS_QUEUED "events_queued"
+
+/**
+ * VIR_CLIENT_INFO_EVENTS_COALESCED:
+ * Macro represents the number of asynchronous events which were replaced
+ * by newer events of the same kind before being sent to the client, as
+ * VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_CLIENT_INFO_EVENTS_COALESCED "events_coalesced"
+
+/**
+ * VIR_CLIENT_INFO_EVENTS_DROPPED:
+ * Macro represents the number of asynchronous events which were not sent
+ * to the client because too many events were already waiting for it, as
+ * VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_CLIENT_INFO_EVENTS_DROPPED "events_dropped"
+
+/**
+ * VIR_CLIENT_INFO_CALLS_IN_FLIGHT:
+ * Macro represents the number of calls of the client which are waiting
+ * for a worker, being run or whose reply is waiting to be sent, as
+ * VIR_TYPED_PARAM_ULLONG.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_CLIENT_INFO_CALLS_IN_FLIGHT "calls_in_flight"
+
+/**
+ * VIR_CLIENT_INFO_CALL_TIME:
+ * Macro represents the total time, in microseconds, workers of the server
+ * spent running calls of the client, as VIR_TYPED_PARAM_ULLONG. Calls of
+ * clients are run in an order which shares this time fairly between the
+ * clients waiting for workers.
+ *
+ * NOTE: This attribute is read-only and any attempt to set it will be denied
+ * by daemon
+ */
+
+# define VIR_CLIENT_INFO_CALL_TIME "call_time"
+
 int virAdmClientGetInfo(virAdmClientPtr client,
                         virTypedParameterPtr *params,
                         int *nparams,
@@ -405,6 +501,21 @@ int virAdmServerSetClientLimits(virAdmServerPtr srv,
 int virAdmServerUpdateTlsFiles(virAdmServerPtr srv,
                                unsigned int flags);
 
+/**
+ * VIR_SERVER_RPC_STATS_COUNT:
+ * Macro for the number of procedures statistics are reported for by
+ * virAdmServerGetRPCStats, as VIR_TYPED_PARAM_UINT. The statistics of each
+ * of them use fields prefixed with "proc.<num>.", where <num> ranges from 0
+ * to this count minus one.
+ */
+
+# define VIR_SERVER_RPC_STATS_COUNT "proc.count"
+
+int virAdmServerGetRPCStats(virAdmServerPtr srv,
+                            virTypedParameterPtr *params,
+                            int *nparams,
+                            unsigned int flags);
+
 int virAdmConnectGetLoggingOutputs(virAdmConnectPtr conn,
                                    char **outputs,
                                    unsigned int flags);
@@ -421,6 +532,121 @@ int virAdmConnectSetLoggingFilters(virAdmConnectPtr conn,
                                    const char *filters,
                                    unsigned int flags);
 
+int virAdmConnectDumpLoggingBuffers(virAdmConnectPtr conn,
+                                    unsigned int flags);
+
+int virAdmConnectSetLockProfiling(virAdmConnectPtr conn,
+                                  int enable,
+                                  unsigned int flags);
+
+/**
+ * VIR_ADMIN_LOCK_STATS_COUNT:
+ * Macro for the number of object classes lock statistics are reported for
+ * by virAdmConnectGetLockStats, as VIR_TYPED_PARAM_UINT. The statistics of
+ * each of them use fields prefixed with "class.<num>.", where <num> ranges
+ * from 0 to this count minus one.
+ */
+
+# define VIR_ADMIN_LOCK_STATS_COUNT "class.count"
+
+typedef enum {
+    VIR_ADMIN_LOCK_STATS_RESET = (1 << 0), /* reset statistics after reading */
+} virAdmConnectGetLockStatsFlags;
+
+int virAdmConnectGetLockStats(virAdmConnectPtr conn,
+                              virTypedParameterPtr *params,
+                              int *nparams,
+                              unsigned int flags);
+
+/**
+ * VIR_ADMIN_EVENT_LOOP_STATS_DISPATCHED:
+ * Macro for the number of handle and timeout callbacks dispatched by the
+ * daemon's event loop, as VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_ADMIN_EVENT_LOOP_STATS_DISPATCHED "dispatched"
+
+/**
+ * VIR_ADMIN_EVENT_LOOP_STATS_SLOW:
+ * Macro for the number of callbacks which blocked the event loop for
+ * longer than the configured slow callback threshold, as
+ * VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_ADMIN_EVENT_LOOP_STATS_SLOW "slow"
+
+/**
+ * VIR_ADMIN_EVENT_LOOP_STATS_DISPATCH_TIME_MAX:
+ * Macro for the longest time a callback blocked the event loop, in
+ * microseconds, as VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_ADMIN_EVENT_LOOP_STATS_DISPATCH_TIME_MAX "dispatch_time_max"
+
+typedef enum {
+    VIR_ADMIN_EVENT_LOOP_STATS_RESET = (1 << 0), /* reset statistics after reading */
+} virAdmConnectGetEventLoopStatsFlags;
+
+int virAdmConnectGetEventLoopStats(virAdmConnectPtr conn,
+                                   virTypedParameterPtr *params,
+                                   int *nparams,
+                                   unsigned int flags);
+
+/**
+ * VIR_ADMIN_MEMORY_STATS_HEAP_SIZE:
+ * Macro for the memory obtained from the system by the daemon's memory
+ * allocator, in bytes, as VIR_TYPED_PARAM_ULLONG. Only reported where the
+ * allocator provides it.
+ */
+
+# define VIR_ADMIN_MEMORY_STATS_HEAP_SIZE "heap.size"
+
+/**
+ * VIR_ADMIN_MEMORY_STATS_HEAP_USED:
+ * Macro for the part of VIR_ADMIN_MEMORY_STATS_HEAP_SIZE in use by
+ * allocated memory, in bytes, as VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_ADMIN_MEMORY_STATS_HEAP_USED "heap.used"
+
+/**
+ * VIR_ADMIN_MEMORY_STATS_HEAP_FREE:
+ * Macro for the part of VIR_ADMIN_MEMORY_STATS_HEAP_SIZE which is free but
+ * kept by the allocator, in bytes, as VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_ADMIN_MEMORY_STATS_HEAP_FREE "heap.free"
+
+/**
+ * VIR_ADMIN_MEMORY_STATS_INTERNED_STRINGS:
+ * Macro for the number of distinct strings shared between objects of the
+ * daemon, such as CPU feature names of domain definitions, as
+ * VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_ADMIN_MEMORY_STATS_INTERNED_STRINGS "interned.strings"
+
+/**
+ * VIR_ADMIN_MEMORY_STATS_INTERNED_REFS:
+ * Macro for the number of references to the shared strings, i.e. the number
+ * of copies which would exist without sharing, as VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_ADMIN_MEMORY_STATS_INTERNED_REFS "interned.refs"
+
+/**
+ * VIR_ADMIN_MEMORY_STATS_INTERNED_BYTES:
+ * Macro for the memory used by the shared strings, in bytes, as
+ * VIR_TYPED_PARAM_ULLONG.
+ */
+
+# define VIR_ADMIN_MEMORY_STATS_INTERNED_BYTES "interned.bytes"
+
+int virAdmConnectGetMemoryStats(virAdmConnectPtr conn,
+                                virTypedParameterPtr *params,
+                                int *nparams,
+                                unsigned int flags);
+
 # ifdef __cplusplus
 }
 # endif
@@ -1065,6 +1065,14 @@ typedef enum {
  */
 # define VIR_MIGRATE_PARAM_TLS_DESTINATION          "tls.destination"
 
+/**
+ * VIR_MIGRATE_PARAM_PARALLEL_DOMAINS:
+ *
+ * virDomainListMigrate params field: maximum number of domains migrated at
+ * the same time. As VIR_TYPED_PARAM_UINT.
+ */
+# define VIR_MIGRATE_PARAM_PARALLEL_DOMAINS         "parallel.domains"
+
 /* Domain migration. */
 virDomainPtr virDomainMigrate (virDomainPtr domain, virConnectPtr dconn,
                                unsigned long flags, const char *dname,
@@ -1096,6 +1104,12 @@ int virDomainMigrateToURI3(virDomainPtr domain,
                            unsigned int nparams,
                            unsigned int flags);
 
+int virDomainListMigrate(virDomainPtr *doms,
+                         const char *dconnuri,
+                         virTypedParameterPtr params,
+                         unsigned int nparams,
+                         unsigned int flags);
+
 int virDomainMigrateGetMaxDowntime(virDomainPtr domain,
                                    unsigned long long *downtime,
                                    unsigned int flags);
@@ -1187,6 +1201,16 @@ int                     virDomainShutdown       (virDomainPtr domain);
 int                     virDomainShutdownFlags  (virDomainPtr domain,
                                                  unsigned int flags);
 
+typedef enum {
+    VIR_DOMAIN_LIST_SHUTDOWN_MANAGED_SAVE = (1 << 0), /* Save instead */
+    VIR_DOMAIN_LIST_SHUTDOWN_BYPASS_CACHE = (1 << 1), /* Avoid cache on save */
+    VIR_DOMAIN_LIST_SHUTDOWN_DESTROY      = (1 << 2), /* Destroy on timeout */
+} virDomainListShutdownFlags;
+
+int                     virDomainListShutdown   (virDomainPtr *doms,
+                                                 unsigned int timeout,
+                                                 unsigned int flags);
+
 typedef enum {
     VIR_DOMAIN_REBOOT_DEFAULT        = 0,        /* hypervisor choice */
     VIR_DOMAIN_REBOOT_ACPI_POWER_BTN = (1 << 0), /* Send ACPI event */
@@ -1624,6 +1648,10 @@ typedef enum {
 
 char *                  virDomainGetXMLDesc     (virDomainPtr domain,
                                                  unsigned int flags);
+int                     virDomainGetXMLDigest   (virDomainPtr domain,
+                                                 unsigned long long *generation,
+                                                 char **digest,
+                                                 unsigned int flags);
 
 
 char *                  virConnectDomainXMLFromNative(virConnectPtr conn,
@@ -2143,6 +2171,12 @@ int virDomainAttachDeviceFlags(virDomainPtr domain,
                                const char *xml, unsigned int flags);
 int virDomainDetachDeviceFlags(virDomainPtr domain,
                                const char *xml, unsigned int flags);
+int virDomainAttachDevices(virDomainPtr domain,
+                           const char *xml,
+                           unsigned int flags);
+int virDomainDetachDevices(virDomainPtr domain,
+                           const char *xml,
+                           unsigned int flags);
 int virDomainUpdateDeviceFlags(virDomainPtr domain,
                                const char *xml, unsigned int flags);
 
@@ -2167,6 +2201,9 @@ typedef enum {
     VIR_DOMAIN_STATS_PERF = (1 << 6), /* return domain perf event info */
     VIR_DOMAIN_STATS_IOTHREAD = (1 << 7), /* return iothread poll info */
     VIR_DOMAIN_STATS_MEMORY = (1 << 8), /* return domain memory info */
+    VIR_DOMAIN_STATS_MONITOR = (1 << 9), /* return monitor latency info */
+    VIR_DOMAIN_STATS_PRESSURE = (1 << 10), /* return resource contention info */
+    VIR_DOMAIN_STATS_DEFINITION = (1 << 11), /* return definition digests */
 } virDomainStatsTypes;
 
 typedef enum {
@@ -2199,6 +2236,9 @@ int virDomainListGetStats(virDomainPtr *doms,
 
 void virDomainStatsRecordListFree(virDomainStatsRecordPtr *stats);
 
+int virConnectOpenDomainStatsFD(virConnectPtr conn,
+                                unsigned int flags);
+
 /*
  * Perf Event API
  */
@@ -3635,6 +3675,107 @@ typedef enum {
  */
 # define VIR_DOMAIN_JOB_DISK_TEMP_TOTAL "disk_temp_total"
 
+/*
+ * The following virDomainGetJobStats fields are reported for jobs which
+ * started a domain, e.g. VIR_DOMAIN_JOB_OPERATION_START, for the phases of
+ * the startup which have finished. Once the domain started, they remain
+ * available through VIR_DOMAIN_JOB_STATS_COMPLETED.
+ */
+
+/**
+ * VIR_DOMAIN_JOB_START_TIME_INIT:
+ *
+ * virDomainGetJobStats field: time (ms) spent initializing the domain
+ * object and probing QEMU capabilities, as VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_START_TIME_INIT "start_time_init"
+
+/**
+ * VIR_DOMAIN_JOB_START_TIME_PREPARE_DOMAIN:
+ *
+ * virDomainGetJobStats field: time (ms) spent preparing the domain
+ * definition, e.g. assigning addresses and aliases, as
+ * VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_START_TIME_PREPARE_DOMAIN "start_time_prepare_domain"
+
+/**
+ * VIR_DOMAIN_JOB_START_TIME_PREPARE_HOST:
+ *
+ * virDomainGetJobStats field: time (ms) spent preparing host resources
+ * such as network interfaces, host devices and storage, as
+ * VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_START_TIME_PREPARE_HOST "start_time_prepare_host"
+
+/**
+ * VIR_DOMAIN_JOB_START_TIME_HOSTDEV:
+ *
+ * virDomainGetJobStats field: time (ms) spent preparing host devices for
+ * assignment, included in VIR_DOMAIN_JOB_START_TIME_PREPARE_HOST, as
+ * VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_START_TIME_HOSTDEV "start_time_hostdev"
+
+/**
+ * VIR_DOMAIN_JOB_START_TIME_LAUNCH:
+ *
+ * virDomainGetJobStats field: time (ms) spent launching QEMU and setting
+ * up the guest, which includes VIR_DOMAIN_JOB_START_TIME_EXEC,
+ * VIR_DOMAIN_JOB_START_TIME_CGROUP,
+ * VIR_DOMAIN_JOB_START_TIME_SECURITY_LABEL and
+ * VIR_DOMAIN_JOB_START_TIME_MONITOR, as VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_START_TIME_LAUNCH "start_time_launch"
+
+/**
+ * VIR_DOMAIN_JOB_START_TIME_EXEC:
+ *
+ * virDomainGetJobStats field: time (ms) spent executing the QEMU process,
+ * as VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_START_TIME_EXEC "start_time_exec"
+
+/**
+ * VIR_DOMAIN_JOB_START_TIME_CGROUP:
+ *
+ * virDomainGetJobStats field: time (ms) spent setting up the cgroups of
+ * the domain, as VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_START_TIME_CGROUP "start_time_cgroup"
+
+/**
+ * VIR_DOMAIN_JOB_START_TIME_SECURITY_LABEL:
+ *
+ * virDomainGetJobStats field: time (ms) spent labelling the resources of
+ * the domain for the security drivers, as VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_START_TIME_SECURITY_LABEL "start_time_security_label"
+
+/**
+ * VIR_DOMAIN_JOB_START_TIME_MONITOR:
+ *
+ * virDomainGetJobStats field: time (ms) spent connecting to the QEMU
+ * monitor and negotiating its capabilities, as VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_START_TIME_MONITOR "start_time_monitor"
+
+/**
+ * VIR_DOMAIN_JOB_START_TIME_REFRESH_STATE:
+ *
+ * virDomainGetJobStats field: time (ms) spent refreshing the state of the
+ * devices from QEMU, as VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_START_TIME_REFRESH_STATE "start_time_refresh_state"
+
+/**
+ * VIR_DOMAIN_JOB_START_TIME_FINISH_STARTUP:
+ *
+ * virDomainGetJobStats field: time (ms) spent finishing the startup, e.g.
+ * resuming the guest CPUs, as VIR_TYPED_PARAM_ULLONG.
+ */
+# define VIR_DOMAIN_JOB_START_TIME_FINISH_STARTUP "start_time_finish_startup"
+
 /**
  * virConnectDomainEventGenericCallback:
  * @conn: the connection pointer
@@ -4181,6 +4322,31 @@ typedef void (*virConnectDomainEventJobCompletedCallback)(virConnectPtr conn,
                                                           int nparams,
                                                           void *opaque);
 
+/**
+ * virConnectDomainEventStatsCallback:
+ * @conn: connection object
+ * @dom: domain on which the event occurred
+ * @params: domain statistics stored as an array of virTypedParameter
+ * @nparams: size of the params array
+ * @opaque: application specific data
+ *
+ * This callback occurs periodically for every running domain if the
+ * hypervisor driver is configured to push domain statistics.
+ *
+ * The params array will contain the same statistics virConnectGetAllDomainStats
+ * would report in the domain record. The interval and the set of statistics
+ * are determined by the configuration of the hypervisor driver. The callback
+ * must not free @params (the array will be freed once the callback finishes).
+ *
+ * The callback signature to use when registering for an event of type
+ * VIR_DOMAIN_EVENT_ID_STATS with virConnectDomainEventRegisterAny().
+ */
+typedef void (*virConnectDomainEventStatsCallback)(virConnectPtr conn,
+                                                   virDomainPtr dom,
+                                                   virTypedParameterPtr params,
+                                                   int nparams,
+                                                   void *opaque);
+
 /**
  * VIR_DOMAIN_TUNABLE_CPU_VCPUPIN:
  *
@@ -4207,6 +4373,17 @@ typedef void (*virConnectDomainEventJobCompletedCallback)(virConnectPtr conn,
  */
 # define VIR_DOMAIN_TUNABLE_CPU_IOTHREADSPIN "cputune.iothreadpin%u"
 
+/**
+ * VIR_DOMAIN_TUNABLE_CPU_MEMORYTUNE_BANDWIDTH:
+ *
+ * Macro represents the memory bandwidth in percent currently granted on one
+ * host node to a memorytune allocation whose bandwidth is adjusted at
+ * runtime. The allocation id and the node id are appended to the parameter
+ * name, for example "cputune.memorytune.vcpus_0-1.node0.bandwidth",
+ * as VIR_TYPED_PARAM_UINT.
+ */
+# define VIR_DOMAIN_TUNABLE_CPU_MEMORYTUNE_BANDWIDTH "cputune.memorytune.%s.node%u.bandwidth"
+
 /**
  * VIR_DOMAIN_TUNABLE_CPU_CPU_SHARES:
  *
@@ -4593,6 +4770,7 @@ typedef enum {
     VIR_DOMAIN_EVENT_ID_DEVICE_REMOVAL_FAILED = 22, /* virConnectDomainEventDeviceRemovalFailedCallback */
     VIR_DOMAIN_EVENT_ID_METADATA_CHANGE = 23, /* virConnectDomainEventMetadataChangeCallback */
     VIR_DOMAIN_EVENT_ID_BLOCK_THRESHOLD = 24, /* virConnectDomainEventBlockThresholdCallback */
+    VIR_DOMAIN_EVENT_ID_STATS = 25,          /* virConnectDomainEventStatsCallback */
 
 # ifdef VIR_ENUM_SENTINELS
     VIR_DOMAIN_EVENT_ID_LAST
@@ -30,6 +30,8 @@
 
 typedef enum {
     VIR_STREAM_NONBLOCK = (1 << 0),
+    VIR_STREAM_LARGE_PACKETS = (1 << 1), /* Transfer data in packets larger
+                                            than 256 KiB where possible */
 } virStreamFlags;
 
 virStreamPtr virStreamNew(virConnectPtr conn,
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+
+# Merges the CPU map of each architecture described by index.xml and the
+# files it includes into a single document and stores these documents in
+# a C header, so that the CPU drivers don't need to look up and parse tens
+# of separate files.
+
+import os
+import sys
+import xml.etree.ElementTree as ET
+
+if len(sys.argv) < 3:
+    print('invalid arguments')
+    print('usage: {0} OUTPUT INDEX.XML [INCLUDE.XML...]'.format(sys.argv[0]))
+    sys.exit(1)
+
+outfilepath = sys.argv[1]
+infiles = {}
+for path in sys.argv[2:]:
+    infiles[os.path.basename(path)] = path
+
+if 'index.xml' not in infiles:
+    print('index.xml is missing')
+    sys.exit(1)
+
+index = ET.parse(infiles['index.xml']).getroot()
+
+
+def c_string(text):
+    text = text.replace('\\', '\\\\').replace('"', '\\"')
+    lines = text.split('\n')
+    return '\n'.join(['      "{0}\\n"'.format(line) for line in lines if line.strip()])
+
+
+archs = []
+for arch in index.findall('arch'):
+    includes = arch.findall('include')
+    for include in includes:
+        filename = include.get('filename')
+        if filename not in infiles:
+            print('CPU map include {0} is missing'.format(filename))
+            sys.exit(1)
+
+        arch.remove(include)
+        for child in ET.parse(infiles[filename]).getroot():
+            arch.append(child)
+
+    doc = ET.Element('cpus')
+    doc.append(arch)
+    archs.append((arch.get('name'), ET.tostring(doc, encoding='unicode')))
+
+with open(outfilepath, 'w') as f:
+    f.write('/* Generated by meson-gen-cpu-map.py from src/cpu_map, do not edit */\n')
+    f.write('\n')
+    f.write('static const virCPUMapBuiltin cpuMapBuiltin[] = {\n')
+    for name, xml in archs:
+        f.write('    { "' + name + '",\n')
+        f.write(c_string(xml))
+        f.write(' },\n')
+    f.write('};\n')
@@ -22,12 +22,16 @@
 
 #include "viraccessdriverpolkit.h"
 #include "viralloc.h"
+#include "virbuffer.h"
 #include "vircommand.h"
+#include "virdbus.h"
+#include "virhash.h"
 #include "virlog.h"
 #include "virprocess.h"
 #include "virerror.h"
 #include "virpolkit.h"
 #include "virstring.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_ACCESS
 
@@ -39,16 +43,198 @@ VIR_LOG_INIT("access.accessdriverpolkit");
 
 #define VIR_ACCESS_DRIVER_POLKIT_ACTION_PREFIX "org.libvirt.api"
 
+/* How long a decision of polkitd is reused, in milliseconds */
+#define VIR_ACCESS_DRIVER_POLKIT_CACHE_TTL (10 * 1000)
+
+/* Upper bound of cached decisions */
+#define VIR_ACCESS_DRIVER_POLKIT_CACHE_MAX 4096
+
 typedef struct _virAccessDriverPolkitPrivate virAccessDriverPolkitPrivate;
 typedef virAccessDriverPolkitPrivate *virAccessDriverPolkitPrivatePtr;
 
 struct _virAccessDriverPolkitPrivate {
-    bool ignore;
+    virMutex lock;
+    /* caller, action and attributes -> virAccessDriverPolkitDecision */
+    virHashTablePtr cache;
+    bool filter;
+};
+
+typedef struct _virAccessDriverPolkitDecision virAccessDriverPolkitDecision;
+typedef virAccessDriverPolkitDecision *virAccessDriverPolkitDecisionPtr;
+
+struct _virAccessDriverPolkitDecision {
+    int result;
+    unsigned long long expires;
 };
 
 
-static void virAccessDriverPolkitCleanup(virAccessManagerPtr manager G_GNUC_UNUSED)
+static DBusHandlerResult
+virAccessDriverPolkitFilter(DBusConnection *connection G_GNUC_UNUSED,
+                            DBusMessage *message,
+                            void *opaque)
+{
+    virAccessDriverPolkitPrivatePtr priv = opaque;
+
+    /* polkitd announces changes of the rules and of its own state with
+     * the Changed signal, any decision may differ afterwards */
+    if (dbus_message_is_signal(message,
+                               "org.freedesktop.PolicyKit1.Authority",
+                               "Changed")) {
+        VIR_DEBUG("Authorization rules changed, dropping cached decisions");
+        virMutexLock(&priv->lock);
+        virHashRemoveAll(priv->cache);
+        virMutexUnlock(&priv->lock);
+    }
+
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+
+static int
+virAccessDriverPolkitSetup(virAccessManagerPtr manager)
+{
+    virAccessDriverPolkitPrivatePtr priv = virAccessManagerGetPrivateData(manager);
+    DBusConnection *sysbus;
+
+    if (virMutexInit(&priv->lock) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to initialize mutex"));
+        return -1;
+    }
+
+    priv->cache = virHashNew(g_free);
+
+    /* without the signal, decisions could be reused after the rules
+     * changed, so don't cache them at all */
+    if (!(sysbus = virDBusGetSystemBus())) {
+        VIR_WARN("Unable to watch polkit for changes, not caching "
+                 "authorization decisions: %s", virGetLastErrorMessage());
+        virResetLastError();
+        return 0;
+    }
+
+    dbus_bus_add_match(sysbus,
+                       "type='signal'"
+                       ",interface='org.freedesktop.PolicyKit1.Authority'"
+                       ",member='Changed'",
+                       NULL);
+    if (!dbus_connection_add_filter(sysbus, virAccessDriverPolkitFilter,
+                                    priv, NULL)) {
+        VIR_WARN("Unable to watch polkit for changes, not caching "
+                 "authorization decisions");
+        return 0;
+    }
+    priv->filter = true;
+
+    return 0;
+}
+
+
+static void virAccessDriverPolkitCleanup(virAccessManagerPtr manager)
+{
+    virAccessDriverPolkitPrivatePtr priv = virAccessManagerGetPrivateData(manager);
+    DBusConnection *sysbus;
+
+    if (priv->filter &&
+        (sysbus = virDBusGetSystemBus()))
+        dbus_connection_remove_filter(sysbus, virAccessDriverPolkitFilter, priv);
+
+    virHashFree(priv->cache);
+    virMutexDestroy(&priv->lock);
+}
+
+
+/*
+ * The key identifies the calling process by its PID and start time,
+ * so a decision can't be reused by another process after the client
+ * disconnected and its PID got recycled.
+ */
+static char *
+virAccessDriverPolkitCacheKey(const char *actionid,
+                              pid_t pid,
+                              unsigned long long startTime,
+                              uid_t uid,
+                              const char **attrs)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+
+    virBufferAsprintf(&buf, "%lld %llu %d %s",
+                      (long long)pid, startTime, (int)uid, actionid);
+
+    for (i = 0; attrs && attrs[i]; i += 2)
+        virBufferAsprintf(&buf, "\n%s=%s", attrs[i], NULLSTR(attrs[i + 1]));
+
+    return virBufferContentAndReset(&buf);
+}
+
+
+static bool
+virAccessDriverPolkitCacheLookup(virAccessDriverPolkitPrivatePtr priv,
+                                 const char *key,
+                                 unsigned long long now,
+                                 int *result)
 {
+    virAccessDriverPolkitDecisionPtr decision;
+    bool found = false;
+
+    if (!priv->filter)
+        return false;
+
+    virMutexLock(&priv->lock);
+    if ((decision = virHashLookup(priv->cache, key))) {
+        if (decision->expires > now) {
+            *result = decision->result;
+            found = true;
+        } else {
+            virHashRemoveEntry(priv->cache, key);
+        }
+    }
+    virMutexUnlock(&priv->lock);
+
+    return found;
+}
+
+
+static int
+virAccessDriverPolkitCacheExpired(const void *payload,
+                                  const void *name G_GNUC_UNUSED,
+                                  const void *opaque)
+{
+    const virAccessDriverPolkitDecision *decision = payload;
+    const unsigned long long *now = opaque;
+
+    return decision->expires <= *now;
+}
+
+
+static void
+virAccessDriverPolkitCacheStore(virAccessDriverPolkitPrivatePtr priv,
+                                const char *key,
+                                unsigned long long now,
+                                int result)
+{
+    virAccessDriverPolkitDecisionPtr decision;
+
+    if (!priv->filter)
+        return;
+
+    decision = g_new0(virAccessDriverPolkitDecision, 1);
+    decision->result = result;
+    decision->expires = now + VIR_ACCESS_DRIVER_POLKIT_CACHE_TTL;
+
+    virMutexLock(&priv->lock);
+    if (virHashSize(priv->cache) >= VIR_ACCESS_DRIVER_POLKIT_CACHE_MAX) {
+        virHashRemoveSet(priv->cache, virAccessDriverPolkitCacheExpired, &now);
+        if (virHashSize(priv->cache) >= VIR_ACCESS_DRIVER_POLKIT_CACHE_MAX)
+            virHashRemoveAll(priv->cache);
+    }
+
+    if (virHashUpdateEntry(priv->cache, key, decision) < 0) {
+        g_free(decision);
+        virResetLastError();
+    }
+    virMutexUnlock(&priv->lock);
 }
 
 
@@ -118,16 +304,60 @@ virAccessDriverPolkitGetCaller(const char *actionid,
 
 
 static int
-virAccessDriverPolkitCheck(virAccessManagerPtr manager G_GNUC_UNUSED,
+virAccessDriverPolkitCheckCaller(virAccessDriverPolkitPrivatePtr priv,
+                                 const char *actionid,
+                                 pid_t pid,
+                                 unsigned long long startTime,
+                                 uid_t uid,
+                                 unsigned long long now,
+                                 const char **attrs)
+{
+    g_autofree char *key = NULL;
+    int result;
+    int rv;
+
+    key = virAccessDriverPolkitCacheKey(actionid, pid, startTime, uid, attrs);
+
+    if (virAccessDriverPolkitCacheLookup(priv, key, now, &result)) {
+        VIR_DEBUG("Using cached decision %d", result);
+        return result;
+    }
+
+    rv = virPolkitCheckAuth(actionid,
+                            pid,
+                            startTime,
+                            uid,
+                            attrs,
+                            false);
+
+    if (rv == 0) {
+        result = 1; /* Allowed */
+    } else {
+        if (rv == -2) {
+            result = 0; /* Denied */
+        } else {
+            return -1; /* Error */
+        }
+    }
+
+    virAccessDriverPolkitCacheStore(priv, key, now, result);
+
+    return result;
+}
+
+
+static int
+virAccessDriverPolkitCheck(virAccessManagerPtr manager,
                            const char *typename,
                            const char *permname,
                            const char **attrs)
 {
+    virAccessDriverPolkitPrivatePtr priv = virAccessManagerGetPrivateData(manager);
     g_autofree char *actionid = NULL;
     pid_t pid;
     uid_t uid;
     unsigned long long startTime;
-    int rv;
+    unsigned long long now;
 
     if (!(actionid = virAccessDriverPolkitFormatAction(typename, permname)))
         return -1;
@@ -141,22 +371,11 @@ virAccessDriverPolkitCheck(virAccessManagerPtr manager G_GNUC_UNUSED,
     VIR_DEBUG("Check action '%s' for process '%lld' time %lld uid %d",
               actionid, (long long)pid, startTime, uid);
 
-    rv = virPolkitCheckAuth(actionid,
-                            pid,
-                            startTime,
-                            uid,
-                            attrs,
-                            false);
+    if (virTimeMillisNow(&now) < 0)
+        return -1;
 
-    if (rv == 0) {
-        return 1; /* Allowed */
-    } else {
-        if (rv == -2) {
-            return 0; /* Denied */
-        } else {
-            return -1; /* Error */
-        }
-    }
+    return virAccessDriverPolkitCheckCaller(priv, actionid, pid, startTime,
+                                            uid, now, attrs);
 }
 
 
@@ -197,6 +416,68 @@ virAccessDriverPolkitCheckDomain(virAccessManagerPtr manager,
                                       attrs);
 }
 
+/*
+ * The caller and the action are the same for all the domains, so they
+ * are resolved only once and the domains are checked one after another
+ * against the cache and, on a miss, polkit.
+ */
+static int
+virAccessDriverPolkitCheckDomainList(virAccessManagerPtr manager,
+                                     const char *driverName,
+                                     virDomainDefPtr *domains,
+                                     size_t ndomains,
+                                     virAccessPermDomain perm,
+                                     virBitmapPtr allowed)
+{
+    virAccessDriverPolkitPrivatePtr priv = virAccessManagerGetPrivateData(manager);
+    g_autofree char *actionid = NULL;
+    pid_t pid;
+    uid_t uid;
+    unsigned long long startTime;
+    unsigned long long now;
+    size_t i;
+
+    if (!(actionid = virAccessDriverPolkitFormatAction("domain",
+                                                       virAccessPermDomainTypeToString(perm))))
+        return -1;
+
+    if (virAccessDriverPolkitGetCaller(actionid,
+                                       &pid,
+                                       &startTime,
+                                       &uid) < 0)
+        return -1;
+
+    VIR_DEBUG("Check action '%s' for process '%lld' time %lld uid %d "
+              "on %zu domains", actionid, (long long)pid, startTime, uid,
+              ndomains);
+
+    if (virTimeMillisNow(&now) < 0)
+        return -1;
+
+    for (i = 0; i < ndomains; i++) {
+        char uuidstr[VIR_UUID_STRING_BUFLEN];
+        const char *attrs[] = {
+            "connect_driver", driverName,
+            "domain_name", domains[i]->name,
+            "domain_uuid", uuidstr,
+            NULL,
+        };
+        int rv;
+
+        virUUIDFormat(domains[i]->uuid, uuidstr);
+
+        if ((rv = virAccessDriverPolkitCheckCaller(priv, actionid, pid,
+                                                   startTime, uid, now,
+                                                   attrs)) < 0)
+            return -1;
+
+        if (rv > 0)
+            ignore_value(virBitmapSetBit(allowed, i));
+    }
+
+    return 0;
+}
+
 static int
 virAccessDriverPolkitCheckInterface(virAccessManagerPtr manager,
                                     const char *driverName,
@@ -447,9 +728,11 @@ virAccessDriverPolkitCheckStorageVol(virAccessManagerPtr manager,
 virAccessDriver accessDriverPolkit = {
     .privateDataLen = sizeof(virAccessDriverPolkitPrivate),
     .name = "polkit",
+    .setup = virAccessDriverPolkitSetup,
     .cleanup = virAccessDriverPolkitCleanup,
     .checkConnect = virAccessDriverPolkitCheckConnect,
     .checkDomain = virAccessDriverPolkitCheckDomain,
+    .checkDomainList = virAccessDriverPolkitCheckDomainList,
     .checkInterface = virAccessDriverPolkitCheckInterface,
     .checkNetwork = virAccessDriverPolkitCheckNetwork,
     .checkNetworkPort = virAccessDriverPolkitCheckNetworkPort,
@@ -105,6 +105,37 @@ virAccessDriverStackCheckDomain(virAccessManagerPtr manager,
     return ret;
 }
 
+static int
+virAccessDriverStackCheckDomainList(virAccessManagerPtr manager,
+                                    const char *driverName,
+                                    virDomainDefPtr *domains,
+                                    size_t ndomains,
+                                    virAccessPermDomain perm,
+                                    virBitmapPtr allowed)
+{
+    virAccessDriverStackPrivatePtr priv = virAccessManagerGetPrivateData(manager);
+    g_autoptr(virBitmap) childAllowed = NULL;
+    int ret = 0;
+    size_t i;
+
+    if (!(childAllowed = virBitmapNew(ndomains)))
+        return -1;
+
+    virBitmapSetAll(allowed);
+
+    for (i = 0; i < priv->managersLen; i++) {
+        /* We do not short-circuit on first denial - always check all drivers */
+        virBitmapClearAll(childAllowed);
+        if (virAccessManagerCheckDomainList(priv->managers[i], driverName,
+                                            domains, ndomains, perm,
+                                            childAllowed) < 0)
+            ret = -1;
+        virBitmapIntersect(allowed, childAllowed);
+    }
+
+    return ret;
+}
+
 static int
 virAccessDriverStackCheckInterface(virAccessManagerPtr manager,
                                    const char *driverName,
@@ -320,6 +351,7 @@ virAccessDriver accessDriverStack = {
     .cleanup = virAccessDriverStackCleanup,
     .checkConnect = virAccessDriverStackCheckConnect,
     .checkDomain = virAccessDriverStackCheckDomain,
+    .checkDomainList = virAccessDriverStackCheckDomainList,
     .checkInterface = virAccessDriverStackCheckInterface,
     .checkNetwork = virAccessDriverStackCheckNetwork,
     .checkNetworkPort = virAccessDriverStackCheckNetworkPort,
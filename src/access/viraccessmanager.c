@@ -244,6 +244,47 @@ int virAccessManagerCheckDomain(virAccessManagerPtr manager,
     return virAccessManagerSanitizeError(ret, driverName);
 }
 
+int virAccessManagerCheckDomainList(virAccessManagerPtr manager,
+                                    const char *driverName,
+                                    virDomainDefPtr *domains,
+                                    size_t ndomains,
+                                    virAccessPermDomain perm,
+                                    virBitmapPtr allowed)
+{
+    int ret = 0;
+    size_t i;
+    VIR_DEBUG("manager=%p(name=%s) driver=%s ndomains=%zu perm=%d",
+              manager, manager->drv->name, driverName, ndomains, perm);
+
+    virBitmapClearAll(allowed);
+
+    if (ndomains == 0)
+        return 0;
+
+    if (manager->drv->checkDomainList) {
+        ret = manager->drv->checkDomainList(manager, driverName, domains,
+                                            ndomains, perm, allowed);
+    } else if (manager->drv->checkDomain) {
+        for (i = 0; i < ndomains; i++) {
+            int rv;
+
+            if ((rv = manager->drv->checkDomain(manager, driverName,
+                                                domains[i], perm)) < 0) {
+                ret = -1;
+                break;
+            }
+
+            if (rv > 0)
+                ignore_value(virBitmapSetBit(allowed, i));
+        }
+    }
+
+    if (ret < 0)
+        virBitmapClearAll(allowed);
+
+    return virAccessManagerSanitizeError(ret, driverName);
+}
+
 int virAccessManagerCheckInterface(virAccessManagerPtr manager,
                                    const char *driverName,
                                    virInterfaceDefPtr iface,
@@ -58,6 +58,21 @@ int virAccessManagerCheckDomain(virAccessManagerPtr manager,
                                 const char *driverName,
                                 virDomainDefPtr domain,
                                 virAccessPermDomain perm);
+
+/*
+ * Sets the bits of the domains of @domains the access is allowed to in
+ * @allowed, which must be able to hold @ndomains bits.
+ *
+ * Return -1 on error
+ * Return 0 on success
+ */
+int virAccessManagerCheckDomainList(virAccessManagerPtr manager,
+                                    const char *driverName,
+                                    virDomainDefPtr *domains,
+                                    size_t ndomains,
+                                    virAccessPermDomain perm,
+                                    virBitmapPtr allowed);
+
 int virAccessManagerCheckInterface(virAccessManagerPtr manager,
                                    const char *driverName,
                                    virInterfaceDefPtr iface,
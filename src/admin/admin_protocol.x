@@ -46,6 +46,18 @@ const ADMIN_CLIENT_INFO_PARAMETERS_MAX = 64;
 /* Upper limit on number of client processing controls */
 const ADMIN_SERVER_CLIENT_LIMITS_MAX = 32;
 
+/* Upper limit on number of RPC statistics parameters */
+const ADMIN_SERVER_RPC_STATS_PARAMETERS_MAX = 65536;
+
+/* Upper limit on number of lock statistics parameters */
+const ADMIN_CONNECT_LOCK_STATS_PARAMETERS_MAX = 65536;
+
+/* Upper limit on number of event loop statistics parameters */
+const ADMIN_CONNECT_EVENT_LOOP_STATS_PARAMETERS_MAX = 64;
+
+/* Upper limit on number of memory statistics parameters */
+const ADMIN_CONNECT_MEMORY_STATS_PARAMETERS_MAX = 64;
+
 /* A long string, which may NOT be NULL. */
 typedef string admin_nonnull_string<ADMIN_STRING_MAX>;
 
@@ -214,6 +226,48 @@ struct admin_connect_set_logging_filters_args {
     unsigned int flags;
 };
 
+struct admin_server_get_rpc_stats_args {
+    admin_nonnull_server srv;
+    unsigned int flags;
+};
+
+struct admin_server_get_rpc_stats_ret {
+    admin_typed_param params<ADMIN_SERVER_RPC_STATS_PARAMETERS_MAX>;
+};
+
+struct admin_connect_dump_logging_buffers_args {
+    unsigned int flags;
+};
+
+struct admin_connect_set_lock_profiling_args {
+    int enable;
+    unsigned int flags;
+};
+
+struct admin_connect_get_lock_stats_args {
+    unsigned int flags;
+};
+
+struct admin_connect_get_lock_stats_ret {
+    admin_typed_param params<ADMIN_CONNECT_LOCK_STATS_PARAMETERS_MAX>;
+};
+
+struct admin_connect_get_event_loop_stats_args {
+    unsigned int flags;
+};
+
+struct admin_connect_get_event_loop_stats_ret {
+    admin_typed_param params<ADMIN_CONNECT_EVENT_LOOP_STATS_PARAMETERS_MAX>;
+};
+
+struct admin_connect_get_memory_stats_args {
+    unsigned int flags;
+};
+
+struct admin_connect_get_memory_stats_ret {
+    admin_typed_param params<ADMIN_CONNECT_MEMORY_STATS_PARAMETERS_MAX>;
+};
+
 /* Define the program number, protocol version and procedure numbers here. */
 const ADMIN_PROGRAM = 0x06900690;
 const ADMIN_PROTOCOL_VERSION = 1;
@@ -324,5 +378,35 @@ enum admin_procedure {
     /**
      * @generate: both
      */
-    ADMIN_PROC_SERVER_UPDATE_TLS_FILES = 18
+    ADMIN_PROC_SERVER_UPDATE_TLS_FILES = 18,
+
+    /**
+     * @generate: none
+     */
+    ADMIN_PROC_SERVER_GET_RPC_STATS = 19,
+
+    /**
+     * @generate: both
+     */
+    ADMIN_PROC_CONNECT_DUMP_LOGGING_BUFFERS = 20,
+
+    /**
+     * @generate: both
+     */
+    ADMIN_PROC_CONNECT_SET_LOCK_PROFILING = 21,
+
+    /**
+     * @generate: none
+     */
+    ADMIN_PROC_CONNECT_GET_LOCK_STATS = 22,
+
+    /**
+     * @generate: none
+     */
+    ADMIN_PROC_CONNECT_GET_EVENT_LOOP_STATS = 23,
+
+    /**
+     * @generate: none
+     */
+    ADMIN_PROC_CONNECT_GET_MEMORY_STATS = 24
 };
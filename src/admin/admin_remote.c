@@ -351,6 +351,45 @@ remoteAdminClientGetInfo(virAdmClientPtr client,
     return rv;
 }
 
+static int
+remoteAdminServerGetRPCStats(virAdmServerPtr srv,
+                             virTypedParameterPtr *params,
+                             int *nparams,
+                             unsigned int flags)
+{
+    int rv = -1;
+    admin_server_get_rpc_stats_args args;
+    admin_server_get_rpc_stats_ret ret;
+    remoteAdminPrivPtr priv = srv->conn->privateData;
+    args.flags = flags;
+    make_nonnull_server(&args.srv, srv);
+
+    memset(&ret, 0, sizeof(ret));
+    virObjectLock(priv);
+
+    if (call(srv->conn, 0, ADMIN_PROC_SERVER_GET_RPC_STATS,
+             (xdrproc_t) xdr_admin_server_get_rpc_stats_args,
+             (char *) &args,
+             (xdrproc_t) xdr_admin_server_get_rpc_stats_ret,
+             (char *) &ret) == -1)
+        goto cleanup;
+
+    if (virTypedParamsDeserialize((virTypedParameterRemotePtr) ret.params.params_val,
+                                  ret.params.params_len,
+                                  ADMIN_SERVER_RPC_STATS_PARAMETERS_MAX,
+                                  params,
+                                  nparams) < 0)
+        goto cleanup;
+
+    rv = 0;
+    xdr_free((xdrproc_t) xdr_admin_server_get_rpc_stats_ret,
+             (char *) &ret);
+
+ cleanup:
+    virObjectUnlock(priv);
+    return rv;
+}
+
 static int
 remoteAdminServerGetClientLimits(virAdmServerPtr srv,
                                  virTypedParameterPtr *params,
@@ -461,6 +500,120 @@ remoteAdminConnectGetLoggingOutputs(virAdmConnectPtr conn,
     return rv;
 }
 
+static int
+remoteAdminConnectGetLockStats(virAdmConnectPtr conn,
+                               virTypedParameterPtr *params,
+                               int *nparams,
+                               unsigned int flags)
+{
+    int rv = -1;
+    admin_connect_get_lock_stats_args args;
+    admin_connect_get_lock_stats_ret ret;
+    remoteAdminPrivPtr priv = conn->privateData;
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+    virObjectLock(priv);
+
+    if (call(conn, 0, ADMIN_PROC_CONNECT_GET_LOCK_STATS,
+             (xdrproc_t) xdr_admin_connect_get_lock_stats_args,
+             (char *) &args,
+             (xdrproc_t) xdr_admin_connect_get_lock_stats_ret,
+             (char *) &ret) == -1)
+        goto cleanup;
+
+    if (virTypedParamsDeserialize((virTypedParameterRemotePtr) ret.params.params_val,
+                                  ret.params.params_len,
+                                  ADMIN_CONNECT_LOCK_STATS_PARAMETERS_MAX,
+                                  params,
+                                  nparams) < 0)
+        goto cleanup;
+
+    rv = 0;
+    xdr_free((xdrproc_t) xdr_admin_connect_get_lock_stats_ret,
+             (char *) &ret);
+
+ cleanup:
+    virObjectUnlock(priv);
+    return rv;
+}
+
+static int
+remoteAdminConnectGetEventLoopStats(virAdmConnectPtr conn,
+                                    virTypedParameterPtr *params,
+                                    int *nparams,
+                                    unsigned int flags)
+{
+    int rv = -1;
+    admin_connect_get_event_loop_stats_args args;
+    admin_connect_get_event_loop_stats_ret ret;
+    remoteAdminPrivPtr priv = conn->privateData;
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+    virObjectLock(priv);
+
+    if (call(conn, 0, ADMIN_PROC_CONNECT_GET_EVENT_LOOP_STATS,
+             (xdrproc_t) xdr_admin_connect_get_event_loop_stats_args,
+             (char *) &args,
+             (xdrproc_t) xdr_admin_connect_get_event_loop_stats_ret,
+             (char *) &ret) == -1)
+        goto cleanup;
+
+    if (virTypedParamsDeserialize((virTypedParameterRemotePtr) ret.params.params_val,
+                                  ret.params.params_len,
+                                  ADMIN_CONNECT_EVENT_LOOP_STATS_PARAMETERS_MAX,
+                                  params,
+                                  nparams) < 0)
+        goto cleanup;
+
+    rv = 0;
+    xdr_free((xdrproc_t) xdr_admin_connect_get_event_loop_stats_ret,
+             (char *) &ret);
+
+ cleanup:
+    virObjectUnlock(priv);
+    return rv;
+}
+
+static int
+remoteAdminConnectGetMemoryStats(virAdmConnectPtr conn,
+                                 virTypedParameterPtr *params,
+                                 int *nparams,
+                                 unsigned int flags)
+{
+    int rv = -1;
+    admin_connect_get_memory_stats_args args;
+    admin_connect_get_memory_stats_ret ret;
+    remoteAdminPrivPtr priv = conn->privateData;
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+    virObjectLock(priv);
+
+    if (call(conn, 0, ADMIN_PROC_CONNECT_GET_MEMORY_STATS,
+             (xdrproc_t) xdr_admin_connect_get_memory_stats_args,
+             (char *) &args,
+             (xdrproc_t) xdr_admin_connect_get_memory_stats_ret,
+             (char *) &ret) == -1)
+        goto cleanup;
+
+    if (virTypedParamsDeserialize((virTypedParameterRemotePtr) ret.params.params_val,
+                                  ret.params.params_len,
+                                  ADMIN_CONNECT_MEMORY_STATS_PARAMETERS_MAX,
+                                  params,
+                                  nparams) < 0)
+        goto cleanup;
+
+    rv = 0;
+    xdr_free((xdrproc_t) xdr_admin_connect_get_memory_stats_ret,
+             (char *) &ret);
+
+ cleanup:
+    virObjectUnlock(priv);
+    return rv;
+}
+
 static int
 remoteAdminConnectGetLoggingFilters(virAdmConnectPtr conn,
                                     char **filters,
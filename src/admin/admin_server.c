@@ -81,6 +81,9 @@ adminServerGetThreadPoolParameters(virNetServerPtr srv,
     size_t freeWorkers;
     size_t nPrioWorkers;
     size_t jobQueueDepth;
+    unsigned long long targetLatency;
+    unsigned long long jobWaitTime;
+    unsigned long long jobRunTime;
     g_autoptr(virTypedParamList) paramlist = g_new0(virTypedParamList, 1);
 
     virCheckFlags(0, -1);
@@ -88,7 +91,10 @@ adminServerGetThreadPoolParameters(virNetServerPtr srv,
     if (virNetServerGetThreadPoolParameters(srv, &minWorkers, &maxWorkers,
                                             &nWorkers, &freeWorkers,
                                             &nPrioWorkers,
-                                            &jobQueueDepth) < 0) {
+                                            &jobQueueDepth,
+                                            &targetLatency,
+                                            &jobWaitTime,
+                                            &jobRunTime) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Unable to retrieve threadpool parameters"));
         return -1;
@@ -118,6 +124,18 @@ adminServerGetThreadPoolParameters(virNetServerPtr srv,
                                  "%s", VIR_THREADPOOL_JOB_QUEUE_DEPTH) < 0)
         return -1;
 
+    if (virTypedParamListAddUInt(paramlist, MIN(targetLatency, UINT_MAX),
+                                 "%s", VIR_THREADPOOL_TARGET_LATENCY) < 0)
+        return -1;
+
+    if (virTypedParamListAddUInt(paramlist, MIN(jobWaitTime, UINT_MAX),
+                                 "%s", VIR_THREADPOOL_JOB_WAIT_TIME) < 0)
+        return -1;
+
+    if (virTypedParamListAddUInt(paramlist, MIN(jobRunTime, UINT_MAX),
+                                 "%s", VIR_THREADPOOL_JOB_RUN_TIME) < 0)
+        return -1;
+
     *nparams = virTypedParamListStealParams(paramlist, params);
 
     return 0;
@@ -132,6 +150,7 @@ adminServerSetThreadPoolParameters(virNetServerPtr srv,
     long long int minWorkers = -1;
     long long int maxWorkers = -1;
     long long int prioWorkers = -1;
+    long long int targetLatency = -1;
     virTypedParameterPtr param = NULL;
 
     virCheckFlags(0, -1);
@@ -143,6 +162,8 @@ adminServerSetThreadPoolParameters(virNetServerPtr srv,
                                VIR_TYPED_PARAM_UINT,
                                VIR_THREADPOOL_WORKERS_PRIORITY,
                                VIR_TYPED_PARAM_UINT,
+                               VIR_THREADPOOL_TARGET_LATENCY,
+                               VIR_TYPED_PARAM_UINT,
                                NULL) < 0)
         return -1;
 
@@ -158,8 +179,13 @@ adminServerSetThreadPoolParameters(virNetServerPtr srv,
                                    VIR_THREADPOOL_WORKERS_PRIORITY)))
         prioWorkers = param->value.ui;
 
+    if ((param = virTypedParamsGet(params, nparams,
+                                   VIR_THREADPOOL_TARGET_LATENCY)))
+        targetLatency = param->value.ui;
+
     if (virNetServerSetThreadPoolParameters(srv, minWorkers,
-                                            maxWorkers, prioWorkers) < 0)
+                                            maxWorkers, prioWorkers,
+                                            targetLatency) < 0)
         return -1;
 
     return 0;
@@ -208,6 +234,11 @@ adminClientGetInfo(virNetServerClientPtr client,
     const char *attr = NULL;
     g_autoptr(virTypedParamList) paramlist = g_new0(virTypedParamList, 1);
     g_autoptr(virIdentity) identity = NULL;
+    size_t events;
+    unsigned long long coalesced;
+    unsigned long long dropped;
+    size_t inflight;
+    unsigned long long callTime;
     int rc;
 
     virCheckFlags(0, -1);
@@ -285,6 +316,24 @@ adminClientGetInfo(virNetServerClientPtr client,
                                    "%s", VIR_CLIENT_INFO_SELINUX_CONTEXT) < 0)
         return -1;
 
+    virNetServerClientGetEventStats(client, &events, &coalesced, &dropped);
+
+    if (virTypedParamListAddULLong(paramlist, events,
+                                   "%s", VIR_CLIENT_INFO_EVENTS_QUEUED) < 0 ||
+        virTypedParamListAddULLong(paramlist, coalesced,
+                                   "%s", VIR_CLIENT_INFO_EVENTS_COALESCED) < 0 ||
+        virTypedParamListAddULLong(paramlist, dropped,
+                                   "%s", VIR_CLIENT_INFO_EVENTS_DROPPED) < 0)
+        return -1;
+
+    virNetServerClientGetCallStats(client, &inflight, &callTime);
+
+    if (virTypedParamListAddULLong(paramlist, inflight,
+                                   "%s", VIR_CLIENT_INFO_CALLS_IN_FLIGHT) < 0 ||
+        virTypedParamListAddULLong(paramlist, callTime,
+                                   "%s", VIR_CLIENT_INFO_CALL_TIME) < 0)
+        return -1;
+
     *nparams = virTypedParamListStealParams(paramlist, params);
     return 0;
 }
@@ -376,3 +425,85 @@ adminServerUpdateTlsFiles(virNetServerPtr srv,
 
     return virNetServerUpdateTlsFiles(srv);
 }
+
+static int
+adminServerGetProgramRPCStats(virNetServerProgramPtr prog,
+                              virTypedParamListPtr paramlist,
+                              size_t *count)
+{
+    g_autofree virNetServerProgramProcStatsPtr stats = NULL;
+    size_t nstats;
+    size_t i;
+    size_t j;
+
+    virNetServerProgramGetStats(prog, &stats, &nstats);
+
+    for (i = 0; i < nstats; i++, (*count)++) {
+        if (virTypedParamListAddUInt(paramlist, virNetServerProgramGetID(prog),
+                                     "proc.%zu.program", *count) < 0 ||
+            virTypedParamListAddInt(paramlist, stats[i].proc,
+                                    "proc.%zu.procedure", *count) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].calls,
+                                       "proc.%zu.calls", *count) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].errors,
+                                       "proc.%zu.errors", *count) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].bytesIn,
+                                       "proc.%zu.bytes_in", *count) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].bytesOut,
+                                       "proc.%zu.bytes_out", *count) < 0)
+            return -1;
+
+        /* only non-empty histogram buckets are reported */
+        for (j = 0; j < VIR_NET_SERVER_PROGRAM_STATS_BUCKETS; j++) {
+            if (stats[i].queueTime[j] &&
+                virTypedParamListAddULLong(paramlist, stats[i].queueTime[j],
+                                           "proc.%zu.queue_time.%zu",
+                                           *count, j) < 0)
+                return -1;
+
+            if (stats[i].execTime[j] &&
+                virTypedParamListAddULLong(paramlist, stats[i].execTime[j],
+                                           "proc.%zu.exec_time.%zu",
+                                           *count, j) < 0)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+int
+adminServerGetRPCStats(virNetServerPtr srv,
+                       virTypedParameterPtr *params,
+                       int *nparams,
+                       unsigned int flags)
+{
+    g_autoptr(virTypedParamList) paramlist = g_new0(virTypedParamList, 1);
+    virNetServerProgramPtr *progs = NULL;
+    size_t nprogs;
+    size_t count = 0;
+    size_t i;
+    int ret = -1;
+
+    virCheckFlags(0, -1);
+
+    nprogs = virNetServerGetPrograms(srv, &progs);
+
+    for (i = 0; i < nprogs; i++) {
+        if (adminServerGetProgramRPCStats(progs[i], paramlist, &count) < 0)
+            goto cleanup;
+    }
+
+    if (virTypedParamListAddUInt(paramlist, count,
+                                 "%s", VIR_SERVER_RPC_STATS_COUNT) < 0)
+        goto cleanup;
+
+    *nparams = virTypedParamListStealParams(paramlist, params);
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < nprogs; i++)
+        virObjectUnref(progs[i]);
+    VIR_FREE(progs);
+    return ret;
+}
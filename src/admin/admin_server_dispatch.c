@@ -20,6 +20,10 @@
 
 #include <config.h>
 
+#ifdef HAVE_MALLINFO2
+# include <malloc.h>
+#endif
+
 #include "internal.h"
 #include "libvirt_internal.h"
 
@@ -28,6 +32,7 @@
 #include "datatypes.h"
 #include "viralloc.h"
 #include "virerror.h"
+#include "vireventglib.h"
 #include "virlog.h"
 #include "rpc/virnetdaemon.h"
 #include "rpc/virnetserver.h"
@@ -380,6 +385,43 @@ adminDispatchServerGetClientLimits(virNetServerPtr server G_GNUC_UNUSED,
     return rv;
 }
 
+static int
+adminDispatchServerGetRpcStats(virNetServerPtr server G_GNUC_UNUSED,
+                               virNetServerClientPtr client,
+                               virNetMessagePtr msg G_GNUC_UNUSED,
+                               virNetMessageErrorPtr rerr,
+                               admin_server_get_rpc_stats_args *args,
+                               admin_server_get_rpc_stats_ret *ret)
+{
+    int rv = -1;
+    virNetServerPtr srv = NULL;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    struct daemonAdmClientPrivate *priv =
+        virNetServerClientGetPrivateData(client);
+
+    if (!(srv = virNetDaemonGetServer(priv->dmn, args->srv.name)))
+        goto cleanup;
+
+    if (adminServerGetRPCStats(srv, &params, &nparams, args->flags) < 0)
+        goto cleanup;
+
+    if (virTypedParamsSerialize(params, nparams,
+                                ADMIN_SERVER_RPC_STATS_PARAMETERS_MAX,
+                                (virTypedParameterRemotePtr *) &ret->params.params_val,
+                                &ret->params.params_len, 0) < 0)
+        goto cleanup;
+
+    rv = 0;
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+
+    virTypedParamsFree(params, nparams);
+    virObjectUnref(srv);
+    return rv;
+}
+
 static int
 adminDispatchServerSetClientLimits(virNetServerPtr server G_GNUC_UNUSED,
                                    virNetServerClientPtr client,
@@ -469,6 +511,232 @@ adminConnectSetLoggingFilters(virNetDaemonPtr dmn G_GNUC_UNUSED,
     return virLogSetFilters(filters);
 }
 
+static int
+adminConnectDumpLoggingBuffers(virNetDaemonPtr dmn G_GNUC_UNUSED,
+                               unsigned int flags)
+{
+    virCheckFlags(0, -1);
+
+    return virLogDumpBuffers("admin request");
+}
+
+static int
+adminConnectSetLockProfiling(virNetDaemonPtr dmn G_GNUC_UNUSED,
+                             int enable,
+                             unsigned int flags)
+{
+    virCheckFlags(0, -1);
+
+    virObjectSetLockProfiling(!!enable);
+    return 0;
+}
+
+static int
+adminConnectGetLockStats(virTypedParameterPtr *params,
+                         int *nparams,
+                         unsigned int flags)
+{
+    g_autoptr(virTypedParamList) paramlist = g_new0(virTypedParamList, 1);
+    g_autofree virObjectLockStatsPtr stats = NULL;
+    size_t nstats;
+    size_t i;
+
+    virCheckFlags(VIR_ADMIN_LOCK_STATS_RESET, -1);
+
+    nstats = virObjectGetLockStats(&stats, flags & VIR_ADMIN_LOCK_STATS_RESET);
+
+    for (i = 0; i < nstats; i++) {
+        if (virTypedParamListAddString(paramlist, stats[i].klass,
+                                       "class.%zu.name", i) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].acquired,
+                                       "class.%zu.acquired", i) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].contended,
+                                       "class.%zu.contended", i) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].wait,
+                                       "class.%zu.wait_time", i) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].waitMax,
+                                       "class.%zu.wait_time_max", i) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].hold,
+                                       "class.%zu.hold_time", i) < 0 ||
+            virTypedParamListAddULLong(paramlist, stats[i].holdMax,
+                                       "class.%zu.hold_time_max", i) < 0)
+            return -1;
+    }
+
+    if (virTypedParamListAddUInt(paramlist, nstats,
+                                 "%s", VIR_ADMIN_LOCK_STATS_COUNT) < 0)
+        return -1;
+
+    *nparams = virTypedParamListStealParams(paramlist, params);
+    return 0;
+}
+
+static int
+adminDispatchConnectGetLockStats(virNetServerPtr server G_GNUC_UNUSED,
+                                 virNetServerClientPtr client G_GNUC_UNUSED,
+                                 virNetMessagePtr msg G_GNUC_UNUSED,
+                                 virNetMessageErrorPtr rerr,
+                                 admin_connect_get_lock_stats_args *args,
+                                 admin_connect_get_lock_stats_ret *ret)
+{
+    int rv = -1;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+
+    if (adminConnectGetLockStats(&params, &nparams, args->flags) < 0)
+        goto cleanup;
+
+    if (virTypedParamsSerialize(params, nparams,
+                                ADMIN_CONNECT_LOCK_STATS_PARAMETERS_MAX,
+                                (virTypedParameterRemotePtr *) &ret->params.params_val,
+                                &ret->params.params_len, 0) < 0)
+        goto cleanup;
+
+    rv = 0;
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+
+    virTypedParamsFree(params, nparams);
+    return rv;
+}
+
+static int
+adminConnectGetEventLoopStats(virTypedParameterPtr *params,
+                              int *nparams,
+                              unsigned int flags)
+{
+    g_autoptr(virTypedParamList) paramlist = g_new0(virTypedParamList, 1);
+    virEventGLibStats stats;
+    size_t i;
+
+    virCheckFlags(VIR_ADMIN_EVENT_LOOP_STATS_RESET, -1);
+
+    virEventGLibGetStats(&stats, flags & VIR_ADMIN_EVENT_LOOP_STATS_RESET);
+
+    if (virTypedParamListAddULLong(paramlist, stats.dispatched, "%s",
+                                   VIR_ADMIN_EVENT_LOOP_STATS_DISPATCHED) < 0 ||
+        virTypedParamListAddULLong(paramlist, stats.slow, "%s",
+                                   VIR_ADMIN_EVENT_LOOP_STATS_SLOW) < 0 ||
+        virTypedParamListAddULLong(paramlist, stats.dispatchMax, "%s",
+                                   VIR_ADMIN_EVENT_LOOP_STATS_DISPATCH_TIME_MAX) < 0)
+        return -1;
+
+    /* only non-empty histogram buckets are reported */
+    for (i = 0; i < VIR_EVENT_GLIB_STATS_BUCKETS; i++) {
+        if (stats.dispatchTime[i] &&
+            virTypedParamListAddULLong(paramlist, stats.dispatchTime[i],
+                                       "dispatch_time.%zu", i) < 0)
+            return -1;
+
+        if (stats.timerLag[i] &&
+            virTypedParamListAddULLong(paramlist, stats.timerLag[i],
+                                       "timer_lag.%zu", i) < 0)
+            return -1;
+    }
+
+    *nparams = virTypedParamListStealParams(paramlist, params);
+    return 0;
+}
+
+static int
+adminDispatchConnectGetEventLoopStats(virNetServerPtr server G_GNUC_UNUSED,
+                                      virNetServerClientPtr client G_GNUC_UNUSED,
+                                      virNetMessagePtr msg G_GNUC_UNUSED,
+                                      virNetMessageErrorPtr rerr,
+                                      admin_connect_get_event_loop_stats_args *args,
+                                      admin_connect_get_event_loop_stats_ret *ret)
+{
+    int rv = -1;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+
+    if (adminConnectGetEventLoopStats(&params, &nparams, args->flags) < 0)
+        goto cleanup;
+
+    if (virTypedParamsSerialize(params, nparams,
+                                ADMIN_CONNECT_EVENT_LOOP_STATS_PARAMETERS_MAX,
+                                (virTypedParameterRemotePtr *) &ret->params.params_val,
+                                &ret->params.params_len, 0) < 0)
+        goto cleanup;
+
+    rv = 0;
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+
+    virTypedParamsFree(params, nparams);
+    return rv;
+}
+
+static int
+adminConnectGetMemoryStats(virTypedParameterPtr *params,
+                           int *nparams,
+                           unsigned int flags)
+{
+    g_autoptr(virTypedParamList) paramlist = g_new0(virTypedParamList, 1);
+    virStringInternStats interned;
+
+    virCheckFlags(0, -1);
+
+#ifdef HAVE_MALLINFO2
+    {
+        struct mallinfo2 info = mallinfo2();
+
+        if (virTypedParamListAddULLong(paramlist, info.arena + info.hblkhd, "%s",
+                                       VIR_ADMIN_MEMORY_STATS_HEAP_SIZE) < 0 ||
+            virTypedParamListAddULLong(paramlist, info.uordblks + info.hblkhd, "%s",
+                                       VIR_ADMIN_MEMORY_STATS_HEAP_USED) < 0 ||
+            virTypedParamListAddULLong(paramlist, info.fordblks, "%s",
+                                       VIR_ADMIN_MEMORY_STATS_HEAP_FREE) < 0)
+            return -1;
+    }
+#endif /* HAVE_MALLINFO2 */
+
+    virStringInternGetStats(&interned);
+
+    if (virTypedParamListAddULLong(paramlist, interned.strings, "%s",
+                                   VIR_ADMIN_MEMORY_STATS_INTERNED_STRINGS) < 0 ||
+        virTypedParamListAddULLong(paramlist, interned.refs, "%s",
+                                   VIR_ADMIN_MEMORY_STATS_INTERNED_REFS) < 0 ||
+        virTypedParamListAddULLong(paramlist, interned.bytes, "%s",
+                                   VIR_ADMIN_MEMORY_STATS_INTERNED_BYTES) < 0)
+        return -1;
+
+    *nparams = virTypedParamListStealParams(paramlist, params);
+    return 0;
+}
+
+static int
+adminDispatchConnectGetMemoryStats(virNetServerPtr server G_GNUC_UNUSED,
+                                   virNetServerClientPtr client G_GNUC_UNUSED,
+                                   virNetMessagePtr msg G_GNUC_UNUSED,
+                                   virNetMessageErrorPtr rerr,
+                                   admin_connect_get_memory_stats_args *args,
+                                   admin_connect_get_memory_stats_ret *ret)
+{
+    int rv = -1;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+
+    if (adminConnectGetMemoryStats(&params, &nparams, args->flags) < 0)
+        goto cleanup;
+
+    if (virTypedParamsSerialize(params, nparams,
+                                ADMIN_CONNECT_MEMORY_STATS_PARAMETERS_MAX,
+                                (virTypedParameterRemotePtr *) &ret->params.params_val,
+                                &ret->params.params_len, 0) < 0)
+        goto cleanup;
+
+    rv = 0;
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+
+    virTypedParamsFree(params, nparams);
+    return rv;
+}
+
 static int
 adminDispatchConnectGetLoggingOutputs(virNetServerPtr server G_GNUC_UNUSED,
                                       virNetServerClientPtr client G_GNUC_UNUSED,
@@ -1109,6 +1109,69 @@ virAdmServerUpdateTlsFiles(virAdmServerPtr srv,
     return ret;
 }
 
+/**
+ * virAdmServerGetRPCStats:
+ * @srv: a valid server object reference
+ * @params: pointer to a list of typed parameters which will be allocated
+ *          to store all returned parameters
+ * @nparams: pointer which will hold the number of params returned in @params
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Retrieves statistics of the RPC procedures called on @srv since it was
+ * started. Procedures that have never been called are left out. The number
+ * of procedures reported is stored in the VIR_SERVER_RPC_STATS_COUNT field,
+ * and the statistics of the procedure <num> in the following fields:
+ *
+ *  "proc.<num>.program"   - the RPC program the procedure belongs to,
+ *                           as unsigned int
+ *  "proc.<num>.procedure" - the procedure number within the program,
+ *                           as int
+ *  "proc.<num>.calls"     - number of calls, as unsigned long long
+ *  "proc.<num>.errors"    - number of calls which failed, as unsigned
+ *                           long long
+ *  "proc.<num>.bytes_in"  - total size of the call packets in bytes,
+ *                           as unsigned long long
+ *  "proc.<num>.bytes_out" - total size of the reply packets in bytes,
+ *                           as unsigned long long
+ *  "proc.<num>.queue_time.<bucket>" - histogram of the time calls waited
+ *                           for a worker, as unsigned long long
+ *  "proc.<num>.exec_time.<bucket>" - histogram of the time it took to
+ *                           process the calls, as unsigned long long
+ *
+ * A histogram field holds the number of calls falling into its bucket,
+ * and is omitted for empty buckets. Bucket 0 covers calls taking less than
+ * one microsecond, bucket <b> greater than 0 those taking at least 2^(<b>-1)
+ * but less than 2^<b> microseconds, and the last bucket covers any longer
+ * calls.
+ *
+ * Returns 0 on success, allocating @params to size returned in @nparams, or
+ * -1 in case of an error. Caller is responsible for deallocating @params.
+ */
+int
+virAdmServerGetRPCStats(virAdmServerPtr srv,
+                        virTypedParameterPtr *params,
+                        int *nparams,
+                        unsigned int flags)
+{
+    int ret = -1;
+
+    VIR_DEBUG("srv=%p, params=%p, nparams=%p, flags=0x%x",
+              srv, params, nparams, flags);
+    virResetLastError();
+
+    virCheckAdmServerGoto(srv, error);
+    virCheckNonNullArgGoto(params, error);
+
+    if ((ret = remoteAdminServerGetRPCStats(srv, params,
+                                            nparams, flags)) < 0)
+        goto error;
+
+    return ret;
+ error:
+    virDispatchError(NULL);
+    return -1;
+}
+
 /**
  * virAdmConnectGetLoggingOutputs:
  * @conn: pointer to an active admin connection
@@ -1266,3 +1329,241 @@ virAdmConnectSetLoggingFilters(virAdmConnectPtr conn,
     virDispatchError(NULL);
     return -1;
 }
+
+/**
+ * virAdmConnectDumpLoggingBuffers:
+ * @conn: pointer to an active admin connection
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Write the messages kept in memory by the 'buffer' logging outputs of the
+ * daemon to the files given in their definition, and empty the buffers.
+ * This has no effect if no 'buffer' output is defined.
+ *
+ * Returns 0 on success, -1 in case of an error.
+ */
+int
+virAdmConnectDumpLoggingBuffers(virAdmConnectPtr conn,
+                                unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, flags=0x%x", conn, flags);
+
+    virResetLastError();
+    virCheckAdmConnectReturn(conn, -1);
+
+    if (remoteAdminConnectDumpLoggingBuffers(conn, flags) < 0)
+        goto error;
+
+    return 0;
+ error:
+    virDispatchError(NULL);
+    return -1;
+}
+
+/**
+ * virAdmConnectSetLockProfiling:
+ * @conn: pointer to an active admin connection
+ * @enable: whether to enable or disable lock profiling
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Enable or disable the accounting of lock contention of the daemon's
+ * objects, which virAdmConnectGetLockStats reports. Lock profiling makes
+ * every lock and unlock of an object more expensive, so it is disabled by
+ * default. While enabled, the object_lock and object_unlock probes are
+ * fired as well, which allows attributing contention to call sites using
+ * systemtap or similar tools.
+ *
+ * Returns 0 on success, -1 in case of an error.
+ */
+int
+virAdmConnectSetLockProfiling(virAdmConnectPtr conn,
+                              int enable,
+                              unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, enable=%d, flags=0x%x", conn, enable, flags);
+
+    virResetLastError();
+    virCheckAdmConnectReturn(conn, -1);
+
+    if (remoteAdminConnectSetLockProfiling(conn, enable, flags) < 0)
+        goto error;
+
+    return 0;
+ error:
+    virDispatchError(NULL);
+    return -1;
+}
+
+/**
+ * virAdmConnectGetLockStats:
+ * @conn: pointer to an active admin connection
+ * @params: pointer to a list of typed parameters which will be allocated
+ *          to store all returned parameters
+ * @nparams: pointer which will hold the number of params returned in @params
+ * @flags: bitwise-OR of virAdmConnectGetLockStatsFlags
+ *
+ * Retrieves the lock contention statistics of the daemon's objects,
+ * accumulated per object class while lock profiling was enabled with
+ * virAdmConnectSetLockProfiling. Classes whose objects have not been
+ * locked are left out. The number of classes reported is stored in the
+ * VIR_ADMIN_LOCK_STATS_COUNT field, and the statistics of the class <num>
+ * in the following fields:
+ *
+ *  "class.<num>.name"          - name of the class, as string
+ *  "class.<num>.acquired"      - number of times the lock of an object was
+ *                                acquired, as unsigned long long
+ *  "class.<num>.contended"     - number of times the lock was held by
+ *                                another thread, as unsigned long long
+ *  "class.<num>.wait_time"     - total time spent waiting for the lock in
+ *                                microseconds, as unsigned long long
+ *  "class.<num>.wait_time_max" - longest wait for the lock in
+ *                                microseconds, as unsigned long long
+ *  "class.<num>.hold_time"     - total time the lock was held in
+ *                                microseconds, as unsigned long long
+ *  "class.<num>.hold_time_max" - longest time the lock was held in
+ *                                microseconds, as unsigned long long
+ *
+ * The hold time includes the time spent waiting on conditions which
+ * temporarily release the lock. If @flags contains
+ * VIR_ADMIN_LOCK_STATS_RESET, the statistics are reset after being read.
+ *
+ * Returns 0 on success, allocating @params to size returned in @nparams, or
+ * -1 in case of an error. Caller is responsible for deallocating @params.
+ */
+int
+virAdmConnectGetLockStats(virAdmConnectPtr conn,
+                          virTypedParameterPtr *params,
+                          int *nparams,
+                          unsigned int flags)
+{
+    int ret = -1;
+
+    VIR_DEBUG("conn=%p, params=%p, nparams=%p, flags=0x%x",
+              conn, params, nparams, flags);
+    virResetLastError();
+
+    virCheckAdmConnectGoto(conn, error);
+    virCheckNonNullArgGoto(params, error);
+
+    if ((ret = remoteAdminConnectGetLockStats(conn, params,
+                                              nparams, flags)) < 0)
+        goto error;
+
+    return ret;
+ error:
+    virDispatchError(NULL);
+    return -1;
+}
+
+/**
+ * virAdmConnectGetEventLoopStats:
+ * @conn: pointer to an active admin connection
+ * @params: pointer to a list of typed parameters which will be allocated
+ *          to store all returned parameters
+ * @nparams: pointer which will hold the number of params returned in @params
+ * @flags: bitwise-OR of virAdmConnectGetEventLoopStatsFlags
+ *
+ * Retrieves statistics of the daemon's event loop, which dispatches the
+ * handle and timeout callbacks of all clients and drivers from a single
+ * thread. The following fields are reported:
+ *
+ *  VIR_ADMIN_EVENT_LOOP_STATS_DISPATCHED - number of callbacks dispatched,
+ *                             as unsigned long long
+ *  VIR_ADMIN_EVENT_LOOP_STATS_SLOW - number of callbacks which took longer
+ *                             than the slow callback threshold of the daemon
+ *                             configuration, as unsigned long long
+ *  VIR_ADMIN_EVENT_LOOP_STATS_DISPATCH_TIME_MAX - longest time a callback
+ *                             took in microseconds, as unsigned long long
+ *  "dispatch_time.<bucket>" - histogram of the time callbacks took, as
+ *                             unsigned long long
+ *  "timer_lag.<bucket>"     - histogram of how late timeout callbacks were
+ *                             dispatched after their timer expired, as
+ *                             unsigned long long
+ *
+ * A histogram field holds the number of callbacks falling into its bucket,
+ * and is omitted for empty buckets. Bucket 0 covers times shorter than one
+ * microsecond, bucket <b> greater than 0 those of at least 2^(<b>-1) but
+ * less than 2^<b> microseconds, and the last bucket, 23, any longer times.
+ * The timer lag shows how long the event loop is kept from reacting by
+ * slow callbacks. If @flags contains VIR_ADMIN_EVENT_LOOP_STATS_RESET, the
+ * statistics are reset after being read.
+ *
+ * Returns 0 on success, allocating @params to size returned in @nparams, or
+ * -1 in case of an error. Caller is responsible for deallocating @params.
+ */
+int
+virAdmConnectGetEventLoopStats(virAdmConnectPtr conn,
+                               virTypedParameterPtr *params,
+                               int *nparams,
+                               unsigned int flags)
+{
+    int ret = -1;
+
+    VIR_DEBUG("conn=%p, params=%p, nparams=%p, flags=0x%x",
+              conn, params, nparams, flags);
+    virResetLastError();
+
+    virCheckAdmConnectGoto(conn, error);
+    virCheckNonNullArgGoto(params, error);
+
+    if ((ret = remoteAdminConnectGetEventLoopStats(conn, params,
+                                                   nparams, flags)) < 0)
+        goto error;
+
+    return ret;
+ error:
+    virDispatchError(NULL);
+    return -1;
+}
+
+/**
+ * virAdmConnectGetMemoryStats:
+ * @conn: pointer to an active admin connection
+ * @params: pointer to a list of typed parameters which will be allocated
+ *          to store all returned parameters
+ * @nparams: pointer which will hold the number of params returned in @params
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Retrieves statistics of the memory used by the daemon. The following
+ * fields are reported:
+ *
+ *  VIR_ADMIN_MEMORY_STATS_HEAP_SIZE - memory obtained by the allocator
+ *                             from the system, in bytes
+ *  VIR_ADMIN_MEMORY_STATS_HEAP_USED - memory in use, in bytes
+ *  VIR_ADMIN_MEMORY_STATS_HEAP_FREE - memory free but kept by the
+ *                             allocator, in bytes
+ *  VIR_ADMIN_MEMORY_STATS_INTERNED_STRINGS - number of distinct shared
+ *                             strings
+ *  VIR_ADMIN_MEMORY_STATS_INTERNED_REFS - number of references to them
+ *  VIR_ADMIN_MEMORY_STATS_INTERNED_BYTES - memory used by the shared
+ *                             strings, in bytes
+ *
+ * All fields are unsigned long long. The heap fields are only reported if
+ * the memory allocator of the daemon provides them.
+ *
+ * Returns 0 on success, allocating @params to size returned in @nparams, or
+ * -1 in case of an error. Caller is responsible for deallocating @params.
+ */
+int
+virAdmConnectGetMemoryStats(virAdmConnectPtr conn,
+                            virTypedParameterPtr *params,
+                            int *nparams,
+                            unsigned int flags)
+{
+    int ret = -1;
+
+    VIR_DEBUG("conn=%p, params=%p, nparams=%p, flags=0x%x",
+              conn, params, nparams, flags);
+    virResetLastError();
+
+    virCheckAdmConnectGoto(conn, error);
+    virCheckNonNullArgGoto(params, error);
+
+    if ((ret = remoteAdminConnectGetMemoryStats(conn, params,
+                                                nparams, flags)) < 0)
+        goto error;
+
+    return ret;
+ error:
+    virDispatchError(NULL);
+    return -1;
+}
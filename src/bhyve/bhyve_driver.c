@@ -753,7 +753,163 @@ bhyveConnectListAllDomains(virConnectPtr conn,
         return -1;
 
     return virDomainObjListExport(privconn->domains, conn, domains,
-                                  virConnectListAllDomainsCheckACL, flags);
+                                  virConnectListAllDomainsCheckACLList, flags);
+}
+
+#define BHYVE_DOMAIN_STATS_SUPPORTED \
+    (VIR_DOMAIN_STATS_STATE | \
+     VIR_DOMAIN_STATS_CPU_TOTAL | \
+     VIR_DOMAIN_STATS_BALLOON | \
+     VIR_DOMAIN_STATS_VCPU)
+
+static int
+bhyveDomainGetStatsParams(virDomainObjPtr vm,
+                          unsigned int stats,
+                          pid_t pid,
+                          unsigned long long cputime,
+                          virTypedParamListPtr params)
+{
+    if (stats & VIR_DOMAIN_STATS_STATE) {
+        int state;
+        int reason;
+
+        state = virDomainObjGetState(vm, &reason);
+        if (virTypedParamListAddInt(params, state, "state.state") < 0 ||
+            virTypedParamListAddInt(params, reason, "state.reason") < 0)
+            return -1;
+    }
+
+    if (!virDomainObjIsActive(vm))
+        return 0;
+
+    /* Only report the CPU time if it was read for the current process */
+    if ((stats & VIR_DOMAIN_STATS_CPU_TOTAL) && pid == vm->pid &&
+        virTypedParamListAddULLong(params, cputime, "cpu.time") < 0)
+        return -1;
+
+    /* bhyve guests have no balloon, all their memory is assigned */
+    if (stats & VIR_DOMAIN_STATS_BALLOON) {
+        unsigned long long memory = virDomainDefGetMemoryTotal(vm->def);
+
+        if (virTypedParamListAddULLong(params, memory, "balloon.current") < 0 ||
+            virTypedParamListAddULLong(params, memory, "balloon.maximum") < 0)
+            return -1;
+    }
+
+    if (stats & VIR_DOMAIN_STATS_VCPU) {
+        if (virTypedParamListAddUInt(params, virDomainDefGetVcpus(vm->def),
+                                     "vcpu.current") < 0 ||
+            virTypedParamListAddUInt(params, virDomainDefGetVcpusMax(vm->def),
+                                     "vcpu.maximum") < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+bhyveConnectGetAllDomainStats(virConnectPtr conn,
+                              virDomainPtr *doms,
+                              unsigned int ndoms,
+                              unsigned int stats,
+                              virDomainStatsRecordPtr **retStats,
+                              unsigned int flags)
+{
+    bhyveConnPtr privconn = conn->privateData;
+    virDomainObjPtr *vms = NULL;
+    size_t nvms;
+    virDomainStatsRecordPtr *tmpstats = NULL;
+    g_autofree pid_t *pids = NULL;
+    g_autofree unsigned long long *cputimes = NULL;
+    int nstats = 0;
+    size_t i;
+    int ret = -1;
+    unsigned int lflags = flags & (VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE);
+
+    virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                  VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                  VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
+
+    if (virConnectGetAllDomainStatsEnsureACL(conn) < 0)
+        return -1;
+
+    if (stats == 0) {
+        stats = BHYVE_DOMAIN_STATS_SUPPORTED;
+    } else if (stats & ~BHYVE_DOMAIN_STATS_SUPPORTED) {
+        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS) {
+            virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED,
+                           _("Stats types bits 0x%x are not supported by this daemon"),
+                           stats & ~BHYVE_DOMAIN_STATS_SUPPORTED);
+            return -1;
+        }
+        stats &= BHYVE_DOMAIN_STATS_SUPPORTED;
+    }
+
+    if (ndoms) {
+        if (virDomainObjListConvert(privconn->domains, conn, doms, ndoms, &vms,
+                                    &nvms,
+                                    virConnectGetAllDomainStatsCheckACLList,
+                                    lflags, true) < 0)
+            return -1;
+    } else {
+        if (virDomainObjListCollect(privconn->domains, conn, &vms, &nvms,
+                                    virConnectGetAllDomainStatsCheckACLList,
+                                    lflags) < 0)
+            return -1;
+    }
+
+    pids = g_new0(pid_t, nvms);
+    cputimes = g_new0(unsigned long long, nvms);
+
+    /* Read the CPU time of all domain processes in one go */
+    if (stats & VIR_DOMAIN_STATS_CPU_TOTAL) {
+        for (i = 0; i < nvms; i++) {
+            virObjectLock(vms[i]);
+            pids[i] = virDomainObjIsActive(vms[i]) ? vms[i]->pid : -1;
+            virObjectUnlock(vms[i]);
+        }
+
+        if (virBhyveGetProcessesTotalCpuStats(pids, nvms, cputimes) < 0)
+            goto cleanup;
+    }
+
+    tmpstats = g_new0(virDomainStatsRecordPtr, nvms + 1);
+
+    for (i = 0; i < nvms; i++) {
+        g_autoptr(virTypedParamList) params = g_new0(virTypedParamList, 1);
+        virDomainStatsRecordPtr tmp;
+        int rc;
+
+        virObjectLock(vms[i]);
+        rc = bhyveDomainGetStatsParams(vms[i], stats, pids[i], cputimes[i],
+                                       params);
+        virObjectUnlock(vms[i]);
+
+        if (rc < 0)
+            goto cleanup;
+
+        tmp = g_new0(virDomainStatsRecord, 1);
+        if (!(tmp->dom = virGetDomain(conn, vms[i]->def->name,
+                                      vms[i]->def->uuid, vms[i]->def->id))) {
+            g_free(tmp);
+            goto cleanup;
+        }
+        tmp->nparams = virTypedParamListStealParams(params, &tmp->params);
+        tmpstats[nstats++] = tmp;
+    }
+
+    *retStats = g_steal_pointer(&tmpstats);
+    ret = nstats;
+
+ cleanup:
+    virDomainStatsRecordListFree(tmpstats);
+    virObjectListFreeCount(vms, nvms);
+    return ret;
 }
 
 static virDomainPtr
@@ -1723,6 +1879,7 @@ static virHypervisorDriver bhyveHypervisorDriver = {
     .connectIsEncrypted = bhyveConnectIsEncrypted, /* 1.3.5 */
     .connectDomainXMLFromNative = bhyveConnectDomainXMLFromNative, /* 2.1.0 */
     .connectGetDomainCapabilities = bhyveConnectGetDomainCapabilities, /* 2.1.0 */
+    .connectGetAllDomainStats = bhyveConnectGetAllDomainStats, /* 6.7.0 */
 };
 
 
@@ -31,8 +31,11 @@
 #include "viralloc.h"
 #include "virerror.h"
 #include "virfile.h"
+#include "virhash.h"
 #include "virlog.h"
 #include "virobject.h"
+#include "virstring.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS   VIR_FROM_BHYVE
 
@@ -43,62 +46,73 @@ struct _bhyveMonitor {
 
     bhyveConnPtr driver;
     virDomainObjPtr vm;
-    int kq;
-    int watch;
+    pid_t pid;
     bool reboot;
 };
 
 static virClassPtr bhyveMonitorClass;
 
+/* The exit of all domain processes is watched through a single kqueue,
+ * so that the number of event loop handles doesn't grow with the number
+ * of domains. Monitors are found by the PID of the process in
+ * bhyveMonitors, which holds a reference to each of them. */
+static int bhyveMonitorKq = -1;
+static int bhyveMonitorWatch = -1;
+static virMutex bhyveMonitorLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr bhyveMonitors;
+
+/* Process events read from the kqueue at once */
+#define BHYVE_MONITOR_EVENTS 32
+
 static void
 bhyveMonitorDispose(void *obj)
 {
     bhyveMonitorPtr mon = obj;
 
-    VIR_FORCE_CLOSE(mon->kq);
     virObjectUnref(mon->vm);
 }
 
+static void bhyveMonitorIO(int, int, int, void *);
+
 static int
 bhyveMonitorOnceInit(void)
 {
     if (!VIR_CLASS_NEW(bhyveMonitor, virClassForObject()))
         return -1;
 
-    return 0;
-}
-
-VIR_ONCE_GLOBAL_INIT(bhyveMonitor);
+    if (!(bhyveMonitors = virHashNew(virObjectFreeHashData)))
+        return -1;
 
-static void bhyveMonitorIO(int, int, int, void *);
+    if ((bhyveMonitorKq = kqueue()) < 0) {
+        virReportSystemError(errno, "%s", _("Unable to create kqueue"));
+        return -1;
+    }
 
-static bool
-bhyveMonitorRegister(bhyveMonitorPtr mon)
-{
-    virObjectRef(mon);
-    mon->watch = virEventAddHandle(mon->kq,
-                                   VIR_EVENT_HANDLE_READABLE |
-                                   VIR_EVENT_HANDLE_ERROR |
-                                   VIR_EVENT_HANDLE_HANGUP,
-                                   bhyveMonitorIO,
-                                   mon,
-                                   virObjectFreeCallback);
-    if (mon->watch < 0) {
-        VIR_DEBUG("failed to add event handle for mon %p", mon);
-        virObjectUnref(mon);
-        return false;
+    bhyveMonitorWatch = virEventAddHandle(bhyveMonitorKq,
+                                          VIR_EVENT_HANDLE_READABLE |
+                                          VIR_EVENT_HANDLE_ERROR |
+                                          VIR_EVENT_HANDLE_HANGUP,
+                                          bhyveMonitorIO,
+                                          NULL,
+                                          NULL);
+    if (bhyveMonitorWatch < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("unable to register monitor events"));
+        VIR_FORCE_CLOSE(bhyveMonitorKq);
+        return -1;
     }
-    return true;
+
+    return 0;
 }
 
+VIR_ONCE_GLOBAL_INIT(bhyveMonitor);
+
 static void
-bhyveMonitorUnregister(bhyveMonitorPtr mon)
+bhyveMonitorPIDKey(pid_t pid,
+                   char *key,
+                   size_t keylen)
 {
-    if (mon->watch < 0)
-        return;
-
-    virEventRemoveHandle(mon->watch);
-    mon->watch = -1;
+    g_snprintf(key, keylen, "%jd", (intmax_t)pid);
 }
 
 void
@@ -108,67 +122,92 @@ bhyveMonitorSetReboot(bhyveMonitorPtr mon)
 }
 
 static void
-bhyveMonitorIO(int watch, int kq, int events G_GNUC_UNUSED, void *opaque)
+bhyveMonitorHandleExit(bhyveMonitorPtr mon,
+                       int status)
 {
-    const struct timespec zerowait = { 0, 0 };
-    bhyveMonitorPtr mon = opaque;
     virDomainObjPtr vm = mon->vm;
     bhyveConnPtr driver = mon->driver;
     const char *name;
-    struct kevent kev;
-    int rc, status;
 
-    if (watch != mon->watch || kq != mon->kq) {
+    if (mon->pid != vm->pid) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("event from unexpected fd %d!=%d / watch %d!=%d"),
-                       mon->kq, kq, mon->watch, watch);
+                       _("event from unexpected proc %ju!=%ju"),
+                       (uintmax_t)vm->pid, (uintmax_t)mon->pid);
         return;
     }
 
-    rc = kevent(kq, NULL, 0, &kev, 1, &zerowait);
-    if (rc < 0) {
-        virReportSystemError(errno, "%s", _("Unable to query kqueue"));
-        return;
+    name = vm->def->name;
+    if (WIFSIGNALED(status) && WCOREDUMP(status)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Guest %s got signal %d and crashed"),
+                       name, WTERMSIG(status));
+        virBhyveProcessStop(driver, vm, VIR_DOMAIN_SHUTOFF_CRASHED);
+    } else if (WIFEXITED(status)) {
+        if (WEXITSTATUS(status) == 0 || mon->reboot) {
+            /* 0 - reboot */
+            VIR_INFO("Guest %s rebooted; restarting domain.", name);
+            virBhyveProcessRestart(driver, vm);
+        } else if (WEXITSTATUS(status) < 3) {
+            /* 1 - shutdown, 2 - halt, 3 - triple fault. others - error */
+            VIR_INFO("Guest %s shut itself down; destroying domain.", name);
+            virBhyveProcessStop(driver, vm, VIR_DOMAIN_SHUTOFF_SHUTDOWN);
+        } else {
+            VIR_INFO("Guest %s had an error and exited with status %d; destroying domain.",
+                     name, WEXITSTATUS(status));
+            virBhyveProcessStop(driver, vm, VIR_DOMAIN_SHUTOFF_UNKNOWN);
+        }
     }
+}
+
+static void
+bhyveMonitorIO(int watch, int kq, int events G_GNUC_UNUSED,
+               void *opaque G_GNUC_UNUSED)
+{
+    const struct timespec zerowait = { 0, 0 };
+    struct kevent kevs[BHYVE_MONITOR_EVENTS];
+    char key[VIR_INT64_STR_BUFLEN];
+    bhyveMonitorPtr mon;
+    int rc;
+    int i;
 
-    if (rc == 0)
+    if (watch != bhyveMonitorWatch || kq != bhyveMonitorKq) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("event from unexpected fd %d!=%d / watch %d!=%d"),
+                       bhyveMonitorKq, kq, bhyveMonitorWatch, watch);
         return;
+    }
 
-    if ((kev.flags & EV_ERROR) != 0) {
-        virReportSystemError(kev.data, "%s", _("Unable to query kqueue"));
+    rc = kevent(kq, NULL, 0, kevs, G_N_ELEMENTS(kevs), &zerowait);
+    if (rc < 0) {
+        virReportSystemError(errno, "%s", _("Unable to query kqueue"));
         return;
     }
 
-    if (kev.filter == EVFILT_PROC && (kev.fflags & NOTE_EXIT) != 0) {
-        if ((pid_t)kev.ident != vm->pid) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("event from unexpected proc %ju!=%ju"),
-                           (uintmax_t)vm->pid, (uintmax_t)kev.ident);
-            return;
+    for (i = 0; i < rc; i++) {
+        struct kevent *kev = &kevs[i];
+
+        if ((kev->flags & EV_ERROR) != 0) {
+            virReportSystemError(kev->data, "%s", _("Unable to query kqueue"));
+            continue;
         }
 
-        name = vm->def->name;
-        status = kev.data;
-        if (WIFSIGNALED(status) && WCOREDUMP(status)) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("Guest %s got signal %d and crashed"),
-                           name, WTERMSIG(status));
-            virBhyveProcessStop(driver, vm, VIR_DOMAIN_SHUTOFF_CRASHED);
-        } else if (WIFEXITED(status)) {
-            if (WEXITSTATUS(status) == 0 || mon->reboot) {
-                /* 0 - reboot */
-                VIR_INFO("Guest %s rebooted; restarting domain.", name);
-                virBhyveProcessRestart(driver, vm);
-            } else if (WEXITSTATUS(status) < 3) {
-                /* 1 - shutdown, 2 - halt, 3 - triple fault. others - error */
-                VIR_INFO("Guest %s shut itself down; destroying domain.", name);
-                virBhyveProcessStop(driver, vm, VIR_DOMAIN_SHUTOFF_SHUTDOWN);
-            } else {
-                VIR_INFO("Guest %s had an error and exited with status %d; destroying domain.",
-                         name, WEXITSTATUS(status));
-                virBhyveProcessStop(driver, vm, VIR_DOMAIN_SHUTOFF_UNKNOWN);
-            }
+        if (kev->filter != EVFILT_PROC || (kev->fflags & NOTE_EXIT) == 0)
+            continue;
+
+        /* The monitor may have been closed after the event was queued */
+        bhyveMonitorPIDKey((pid_t)kev->ident, key, sizeof(key));
+        virMutexLock(&bhyveMonitorLock);
+        mon = virHashSteal(bhyveMonitors, key);
+        virMutexUnlock(&bhyveMonitorLock);
+
+        if (!mon) {
+            VIR_DEBUG("Ignoring exit of unmonitored process %ju",
+                      (uintmax_t)kev->ident);
+            continue;
         }
+
+        bhyveMonitorHandleExit(mon, kev->data);
+        virObjectUnref(mon);
     }
 }
 
@@ -177,6 +216,7 @@ bhyveMonitorOpenImpl(virDomainObjPtr vm, bhyveConnPtr driver)
 {
     bhyveMonitorPtr mon;
     struct kevent kev;
+    char key[VIR_INT64_STR_BUFLEN];
 
     if (bhyveMonitorInitialize() < 0)
         return NULL;
@@ -186,30 +226,28 @@ bhyveMonitorOpenImpl(virDomainObjPtr vm, bhyveConnPtr driver)
 
     mon->driver = driver;
     mon->reboot = false;
+    mon->pid = vm->pid;
 
     virObjectRef(vm);
     mon->vm = vm;
 
-    mon->kq = kqueue();
-    if (mon->kq < 0) {
-        virReportError(VIR_ERR_SYSTEM_ERROR, "%s",
-                       _("Unable to create kqueue"));
+    bhyveMonitorPIDKey(mon->pid, key, sizeof(key));
+
+    virMutexLock(&bhyveMonitorLock);
+    if (virHashUpdateEntry(bhyveMonitors, key, virObjectRef(mon)) < 0) {
+        virObjectUnref(mon);
+        virMutexUnlock(&bhyveMonitorLock);
         goto cleanup;
     }
+    virMutexUnlock(&bhyveMonitorLock);
 
-    EV_SET(&kev, vm->pid, EVFILT_PROC, EV_ADD, NOTE_EXIT, 0, mon);
-    if (kevent(mon->kq, &kev, 1, NULL, 0, NULL) < 0) {
+    EV_SET(&kev, mon->pid, EVFILT_PROC, EV_ADD, NOTE_EXIT, 0, NULL);
+    if (kevent(bhyveMonitorKq, &kev, 1, NULL, 0, NULL) < 0) {
         virReportError(VIR_ERR_SYSTEM_ERROR, "%s",
                        _("Unable to register process kevent"));
         goto cleanup;
     }
 
-    if (!bhyveMonitorRegister(mon)) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("unable to register monitor events"));
-        goto cleanup;
-    }
-
     return mon;
 
  cleanup:
@@ -232,11 +270,24 @@ bhyveMonitorOpen(virDomainObjPtr vm, bhyveConnPtr driver)
 void
 bhyveMonitorClose(bhyveMonitorPtr mon)
 {
+    char key[VIR_INT64_STR_BUFLEN];
+    struct kevent kev;
+
     if (mon == NULL)
         return;
 
     VIR_DEBUG("cleaning up bhyveMonitor %p", mon);
 
-    bhyveMonitorUnregister(mon);
+    bhyveMonitorPIDKey(mon->pid, key, sizeof(key));
+
+    virMutexLock(&bhyveMonitorLock);
+    if (virHashLookup(bhyveMonitors, key) == mon)
+        virHashRemoveEntry(bhyveMonitors, key);
+    virMutexUnlock(&bhyveMonitorLock);
+
+    /* Fails harmlessly if the process is gone, which drops the kevent */
+    EV_SET(&kev, mon->pid, EVFILT_PROC, EV_DELETE, 0, 0, NULL);
+    ignore_value(kevent(bhyveMonitorKq, &kev, 1, NULL, 0, NULL));
+
     virObjectUnref(mon);
 }
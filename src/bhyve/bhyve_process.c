@@ -407,6 +407,79 @@ virBhyveGetDomainTotalCpuStats(virDomainObjPtr vm,
     return ret;
 }
 
+struct bhyveProcessCpuStat {
+    pid_t pid;
+    size_t idx;
+};
+
+static int
+bhyveProcessCpuStatCompare(const void *a,
+                           const void *b)
+{
+    const struct bhyveProcessCpuStat *sa = a;
+    const struct bhyveProcessCpuStat *sb = b;
+
+    if (sa->pid < sb->pid)
+        return -1;
+    return sa->pid > sb->pid;
+}
+
+/*
+ * Fills @cpustats with the CPU time of each of the @npids processes in
+ * @pids, walking the process table once instead of querying it for each
+ * of them. Processes which are not found have a CPU time of 0.
+ */
+int
+virBhyveGetProcessesTotalCpuStats(const pid_t *pids,
+                                  size_t npids,
+                                  unsigned long long *cpustats)
+{
+    g_autofree struct bhyveProcessCpuStat *sorted = NULL;
+    struct kinfo_proc *kp;
+    kvm_t *kd;
+    char errbuf[_POSIX2_LINE_MAX];
+    int nprocs;
+    size_t i;
+
+    memset(cpustats, 0, sizeof(*cpustats) * npids);
+
+    if (npids == 0)
+        return 0;
+
+    if ((kd = kvm_openfiles(NULL, NULL, NULL, O_RDONLY, errbuf)) == NULL) {
+        virReportError(VIR_ERR_SYSTEM_ERROR,
+                       _("Unable to get kvm descriptor: %s"),
+                       errbuf);
+        return -1;
+    }
+
+    if (!(kp = kvm_getprocs(kd, KERN_PROC_PROC, 0, &nprocs))) {
+        virReportError(VIR_ERR_SYSTEM_ERROR, "%s",
+                       _("Unable to obtain information about processes"));
+        kvm_close(kd);
+        return -1;
+    }
+
+    sorted = g_new0(struct bhyveProcessCpuStat, npids);
+    for (i = 0; i < npids; i++) {
+        sorted[i].pid = pids[i];
+        sorted[i].idx = i;
+    }
+    qsort(sorted, npids, sizeof(*sorted), bhyveProcessCpuStatCompare);
+
+    for (i = 0; i < nprocs; i++) {
+        struct bhyveProcessCpuStat key = { .pid = kp[i].ki_pid };
+        struct bhyveProcessCpuStat *found;
+
+        if ((found = bsearch(&key, sorted, npids, sizeof(*sorted),
+                             bhyveProcessCpuStatCompare)))
+            cpustats[found->idx] = kp[i].ki_runtime * 1000ull;
+    }
+
+    kvm_close(kd);
+    return 0;
+}
+
 struct bhyveProcessReconnectData {
     bhyveConnPtr driver;
     kvm_t *kd;
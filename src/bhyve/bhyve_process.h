@@ -40,6 +40,10 @@ int virBhyveProcessShutdown(virDomainObjPtr vm);
 int virBhyveGetDomainTotalCpuStats(virDomainObjPtr vm,
                                    unsigned long long *cpustats);
 
+int virBhyveGetProcessesTotalCpuStats(const pid_t *pids,
+                                      size_t npids,
+                                      unsigned long long *cpustats);
+
 void virBhyveProcessReconnectAll(bhyveConnPtr driver);
 
 typedef enum {
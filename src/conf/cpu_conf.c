@@ -95,7 +95,7 @@ virCPUDefFreeFeatures(virCPUDefPtr def)
     size_t i;
 
     for (i = 0; i < def->nfeatures; i++)
-        VIR_FREE(def->features[i].name);
+        virStringInternRelease(def->features[i].name);
     VIR_FREE(def->features);
 
     def->nfeatures = def->nfeatures_max = 0;
@@ -177,7 +177,7 @@ virCPUDefCopyModelFilter(virCPUDefPtr dst,
             dst->features[n].policy = src->features[i].policy;
         }
 
-        dst->features[n].name = g_strdup(src->features[i].name);
+        dst->features[n].name = virStringIntern(src->features[i].name);
     }
 
     return 0;
@@ -624,7 +624,7 @@ virCPUDefParseXML(xmlXPathContextPtr ctxt,
             }
         }
 
-        def->features[i].name = g_steal_pointer(&name);
+        def->features[i].name = virStringIntern(name);
         def->features[i].policy = policy;
     }
 
@@ -888,7 +888,7 @@ virCPUDefUpdateFeatureInternal(virCPUDefPtr def,
                      def->nfeatures, 1) < 0)
         return -1;
 
-    def->features[def->nfeatures].name = g_strdup(name);
+    def->features[def->nfeatures].name = virStringIntern(name);
 
     def->features[def->nfeatures].policy = policy;
     def->nfeatures++;
@@ -941,7 +941,7 @@ virCPUDefFilterFeatures(virCPUDefPtr cpu,
             continue;
         }
 
-        VIR_FREE(cpu->features[i].name);
+        virStringInternRelease(cpu->features[i].name);
         if (VIR_DELETE_ELEMENT_INPLACE(cpu->features, i, cpu->nfeatures) < 0)
             return -1;
     }
@@ -95,7 +95,7 @@ VIR_ENUM_DECL(virCPUFeaturePolicy);
 typedef struct _virCPUFeatureDef virCPUFeatureDef;
 typedef virCPUFeatureDef *virCPUFeatureDefPtr;
 struct _virCPUFeatureDef {
-    char *name;
+    const char *name;   /* interned, see virStringIntern */
     int policy;         /* enum virCPUFeaturePolicy */
 };
 
@@ -598,28 +598,14 @@ virDomainPCIAddressBusSetModel(virDomainPCIAddressBusPtr bus,
 bool
 virDomainPCIAddressBusIsFullyReserved(virDomainPCIAddressBusPtr bus)
 {
-    size_t i;
-
-    for (i = bus->minSlot; i <= bus->maxSlot; i++) {
-        if (!bus->slot[i].functions)
-            return false;
-    }
-
-    return true;
+    return bus->nusedSlots >= bus->maxSlot - bus->minSlot + 1;
 }
 
 
 static bool ATTRIBUTE_NONNULL(1)
 virDomainPCIAddressBusIsEmpty(virDomainPCIAddressBusPtr bus)
 {
-    size_t i;
-
-    for (i = bus->minSlot; i <= bus->maxSlot; i++) {
-        if (bus->slot[i].functions)
-            return false;
-    }
-
-    return true;
+    return bus->nusedSlots == 0;
 }
 
 
@@ -750,8 +736,11 @@ virDomainPCIAddressSetGrow(virDomainPCIAddressSetPtr addrs,
 
     i = addrs->nbuses;
 
-    if (VIR_EXPAND_N(addrs->buses, addrs->nbuses, add) < 0)
+    /* buses are usually added one by one when auto-assigning addresses,
+     * so don't reallocate the whole array every time */
+    if (VIR_RESIZE_N(addrs->buses, addrs->nbuses_max, addrs->nbuses, add) < 0)
         return -1;
+    addrs->nbuses += add;
 
     if (needDMIToPCIBridge) {
         /* first of the new buses is dmi-to-pci-bridge, the
@@ -876,6 +865,8 @@ virDomainPCIAddressReserveAddrInternal(virDomainPCIAddressSetPtr addrs,
     }
 
     /* mark the requested function as reserved */
+    if (!bus->slot[addr->slot].functions)
+        bus->nusedSlots++;
     bus->slot[addr->slot].functions |= (1 << addr->function);
     VIR_DEBUG("Reserving PCI address %s (aggregate='%s')", addrStr,
               bus->slot[addr->slot].aggregate ? "true" : "false");
@@ -961,7 +952,14 @@ void
 virDomainPCIAddressReleaseAddr(virDomainPCIAddressSetPtr addrs,
                                virPCIDeviceAddressPtr addr)
 {
-    addrs->buses[addr->bus].slot[addr->slot].functions &= ~(1 << addr->function);
+    virDomainPCIAddressBusPtr bus = &addrs->buses[addr->bus];
+
+    if (!bus->slot[addr->slot].functions)
+        return;
+
+    bus->slot[addr->slot].functions &= ~(1 << addr->function);
+    if (!bus->slot[addr->slot].functions)
+        bus->nusedSlots--;
 }
 
 
@@ -1061,6 +1059,7 @@ virDomainPCIAddressSetAlloc(unsigned int nbuses,
         goto error;
 
     addrs->nbuses = nbuses;
+    addrs->nbuses_max = nbuses;
 
     if (virDomainPCIAddressSetExtensionAlloc(addrs, extFlags) < 0)
         goto error;
@@ -1092,14 +1091,20 @@ virDomainPCIAddressFindUnusedFunctionOnBus(virDomainPCIAddressBusPtr bus,
                                            virDomainPCIConnectFlags flags,
                                            bool *found)
 {
-    g_autofree char *addrStr = NULL;
-
     *found = false;
 
-    if (!(addrStr = virPCIDeviceAddressAsString(searchAddr)))
-        return -1;
+    /* a slot on a bus that has all of them in use can only be shared
+     * by aggregating devices, so don't bother checking the slots one by
+     * one otherwise */
+    if (!(flags & VIR_PCI_CONNECT_AGGREGATE_SLOT) &&
+        virDomainPCIAddressBusIsFullyReserved(bus)) {
+        VIR_DEBUG("PCI bus %04x:%02x is fully reserved",
+                  searchAddr->domain, searchAddr->bus);
+        return 0;
+    }
 
-    if (!virDomainPCIAddressFlagsCompatible(searchAddr, addrStr, bus->flags,
+    /* the address string is only used for reporting errors */
+    if (!virDomainPCIAddressFlagsCompatible(searchAddr, NULL, bus->flags,
                                             flags, false, false)) {
         VIR_DEBUG("PCI bus %04x:%02x is not compatible with the device",
                   searchAddr->domain, searchAddr->bus);
@@ -105,6 +105,8 @@ typedef struct {
      * bit is set, that function is in use by a device.
      */
     virDomainPCIAddressSlot slot[VIR_PCI_ADDRESS_SLOT_LAST + 1];
+    /* number of slots with at least one function in use */
+    size_t nusedSlots;
 
     /* See virDomainDeviceInfo::isolationGroup */
     unsigned int isolationGroup;
@@ -123,6 +125,7 @@ typedef virDomainZPCIAddressIds *virDomainZPCIAddressIdsPtr;
 struct _virDomainPCIAddressSet {
     virDomainPCIAddressBus *buses;
     size_t nbuses;
+    size_t nbuses_max;
     bool dryRun;          /* on a dry run, new buses are auto-added
                              and addresses aren't saved in device infos */
     /* If true, the guest can have multiple pci-root controllers */
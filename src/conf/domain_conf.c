@@ -61,7 +61,9 @@
 #include "virmdev.h"
 #include "virdomainsnapshotobjlist.h"
 #include "virdomaincheckpointobjlist.h"
+#include "virdomainobjlist.h"
 #include "virutil.h"
+#include "virwritebehind.h"
 
 #define VIR_FROM_THIS VIR_FROM_DOMAIN
 
@@ -89,6 +91,12 @@ struct _virDomainXMLOption {
 
     /* Snapshot postparse callbacks */
     virDomainMomentPostParseCallback momentPostParse;
+
+    /* Compiled domain RNG schema, loaded on first use and
+     * shared by all callers; @schemaLock serializes validation
+     * as the libxml2 validation context is not thread safe */
+    virMutex schemaLock;
+    virXMLValidatorPtr schema;
 };
 
 #define VIR_DOMAIN_DEF_FORMAT_COMMON_FLAGS \
@@ -1364,6 +1372,9 @@ virDomainXMLOptionDispose(void *obj)
 
     if (xmlopt->config.privFree)
         (xmlopt->config.privFree)(xmlopt->config.priv);
+
+    virXMLValidatorFree(xmlopt->schema);
+    virMutexDestroy(&xmlopt->schemaLock);
 }
 
 /**
@@ -1493,6 +1504,13 @@ virDomainXMLOptionNew(virDomainDefParserConfigPtr config,
     if (!(xmlopt = virObjectNew(virDomainXMLOptionClass)))
         return NULL;
 
+    if (virMutexInit(&xmlopt->schemaLock) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to initialize mutex"));
+        virObjectUnref(xmlopt);
+        return NULL;
+    }
+
     if (priv)
         xmlopt->privateData = *priv;
 
@@ -1537,6 +1555,50 @@ virDomainXMLOptionGetNamespace(virDomainXMLOptionPtr xmlopt)
     return &xmlopt->ns;
 }
 
+
+/**
+ * virDomainXMLOptionValidateSchema:
+ * @xmlopt: XML parser configuration object
+ * @xml: parsed domain XML document
+ *
+ * Validate @xml against the domain RNG schema. The schema is compiled
+ * only once per @xmlopt and reused by subsequent calls, since building
+ * it costs much more than validating a typical document.
+ *
+ * Returns 0 if @xml is valid, -1 otherwise with error reported.
+ */
+static int
+virDomainXMLOptionValidateSchema(virDomainXMLOptionPtr xmlopt,
+                                 xmlDocPtr xml)
+{
+    int ret = -1;
+
+    virMutexLock(&xmlopt->schemaLock);
+
+    if (!xmlopt->schema) {
+        g_autofree char *schema = NULL;
+
+        schema = virFileFindResource("domain.rng",
+                                     abs_top_srcdir "/docs/schemas",
+                                     PKGDATADIR "/schemas");
+        if (!schema)
+            goto cleanup;
+
+        if (!(xmlopt->schema = virXMLValidatorInit(schema)))
+            goto cleanup;
+    }
+
+    /* The error buffer is filled by the validation callbacks and would
+     * otherwise accumulate messages from earlier documents */
+    virBufferFreeAndReset(&xmlopt->schema->buf);
+
+    ret = virXMLValidatorValidate(xmlopt->schema, xml);
+
+ cleanup:
+    virMutexUnlock(&xmlopt->schemaLock);
+    return ret;
+}
+
 static int
 virDomainVirtioOptionsParseXML(xmlNodePtr driver,
                                virDomainVirtioOptionsPtr *virtio)
@@ -2391,6 +2453,8 @@ virDomainFSDefNew(virDomainXMLOptionPtr xmlopt)
     if (!(ret->src = virStorageSourceNew()))
         goto cleanup;
 
+    ret->thread_pool_size = -1;
+
     if (xmlopt &&
         xmlopt->privateData.fsNew &&
         !(ret->privateData = xmlopt->privateData.fsNew()))
@@ -3509,7 +3573,7 @@ void virDomainDefFree(virDomainDefPtr def)
     VIR_FREE(def->idmap.uidmap);
     VIR_FREE(def->idmap.gidmap);
 
-    VIR_FREE(def->os.machine);
+    virStringInternRelease(def->os.machine);
     VIR_FREE(def->os.init);
     for (i = 0; def->os.initargv && def->os.initargv[i]; i++)
         VIR_FREE(def->os.initargv[i]);
@@ -3537,7 +3601,7 @@ void virDomainDefFree(virDomainDefPtr def)
 
     VIR_FREE(def->name);
     virBitmapFree(def->cpumask);
-    VIR_FREE(def->emulator);
+    virStringInternRelease(def->emulator);
     VIR_FREE(def->description);
     VIR_FREE(def->title);
     VIR_FREE(def->hyperv_vendor_id);
@@ -3603,6 +3667,8 @@ static void virDomainObjDispose(void *obj)
     virCondDestroy(&dom->cond);
     virDomainDefFree(dom->def);
     virDomainDefFree(dom->newDef);
+    g_free(dom->liveDigest);
+    g_free(dom->configDigest);
 
     if (dom->privateDataFreeFunc)
         (dom->privateDataFreeFunc)(dom->privateData);
@@ -3654,6 +3720,16 @@ virDomainObjNew(virDomainXMLOptionPtr xmlopt)
 }
 
 
+/* Last value handed out as virDomainDef.serial */
+static unsigned long long virDomainDefLastSerial;
+
+static unsigned long long
+virDomainDefNextSerial(void)
+{
+    return __atomic_add_fetch(&virDomainDefLastSerial, 1, __ATOMIC_RELAXED);
+}
+
+
 virDomainDefPtr
 virDomainDefNew(void)
 {
@@ -3668,6 +3744,7 @@ virDomainDefNew(void)
     ret->mem.hard_limit = VIR_DOMAIN_MEMORY_PARAM_UNLIMITED;
     ret->mem.soft_limit = VIR_DOMAIN_MEMORY_PARAM_UNLIMITED;
     ret->mem.swap_hard_limit = VIR_DOMAIN_MEMORY_PARAM_UNLIMITED;
+    ret->serial = virDomainDefNextSerial();
 
     return ret;
 
@@ -5622,7 +5699,8 @@ virDomainDeviceDefPostParse(virDomainDeviceDefPtr dev,
 {
     int ret;
 
-    if (xmlopt->config.devicesPostParseCallback) {
+    if (xmlopt->config.devicesPostParseCallback &&
+        !(flags & VIR_DOMAIN_DEF_PARSE_SKIP_POST_PARSE_CALLBACKS)) {
         ret = xmlopt->config.devicesPostParseCallback(dev, def, flags,
                                                       xmlopt->config.priv,
                                                       parseOpaque);
@@ -5963,6 +6041,7 @@ virDomainDefPostParse(virDomainDefPtr def,
 {
     int ret = -1;
     bool localParseOpaque = false;
+    bool callbacks = !(parseFlags & VIR_DOMAIN_DEF_PARSE_SKIP_POST_PARSE_CALLBACKS);
     struct virDomainDefPostParseDeviceIteratorData data = {
         .xmlopt = xmlopt,
         .parseFlags = parseFlags,
@@ -5972,7 +6051,7 @@ virDomainDefPostParse(virDomainDefPtr def,
     def->postParseFailed = false;
 
     /* call the basic post parse callback */
-    if (xmlopt->config.domainPostParseBasicCallback) {
+    if (callbacks && xmlopt->config.domainPostParseBasicCallback) {
         ret = xmlopt->config.domainPostParseBasicCallback(def,
                                                           xmlopt->config.priv);
 
@@ -5980,7 +6059,7 @@ virDomainDefPostParse(virDomainDefPtr def,
             goto cleanup;
     }
 
-    if (!data.parseOpaque &&
+    if (callbacks && !data.parseOpaque &&
         xmlopt->config.domainPostParseDataAlloc) {
         ret = xmlopt->config.domainPostParseDataAlloc(def, parseFlags,
                                                       xmlopt->config.priv,
@@ -5997,7 +6076,7 @@ virDomainDefPostParse(virDomainDefPtr def,
     virDomainAssignControllerIndexes(def);
 
     /* call the domain config callback */
-    if (xmlopt->config.domainPostParseCallback) {
+    if (callbacks && xmlopt->config.domainPostParseCallback) {
         ret = xmlopt->config.domainPostParseCallback(def, parseFlags,
                                                      xmlopt->config.priv,
                                                      data.parseOpaque);
@@ -6018,7 +6097,7 @@ virDomainDefPostParse(virDomainDefPtr def,
     if ((ret = virDomainDefPostParseCommon(def, &data, xmlopt)) < 0)
         goto cleanup;
 
-    if (xmlopt->config.assignAddressesCallback) {
+    if (callbacks && xmlopt->config.assignAddressesCallback) {
         ret = xmlopt->config.assignAddressesCallback(def, parseFlags,
                                                      xmlopt->config.priv,
                                                      data.parseOpaque);
@@ -11562,6 +11641,7 @@ virDomainFSDefParseXML(virDomainXMLOptionPtr xmlopt,
     if (def->fsdriver == VIR_DOMAIN_FS_DRIVER_TYPE_VIRTIOFS) {
         g_autofree char *queue_size = virXPathString("string(./driver/@queue)", ctxt);
         g_autofree char *binary = virXPathString("string(./binary/@path)", ctxt);
+        g_autofree char *thread_pool_size = virXPathString("string(./binary/thread_pool/@size)", ctxt);
         g_autofree char *xattr = virXPathString("string(./binary/@xattr)", ctxt);
         g_autofree char *cache = virXPathString("string(./binary/cache/@mode)", ctxt);
         g_autofree char *posix_lock = virXPathString("string(./binary/lock/@posix)", ctxt);
@@ -11578,6 +11658,15 @@ virDomainFSDefParseXML(virDomainXMLOptionPtr xmlopt,
         if (binary)
             def->binary = virFileSanitizePath(binary);
 
+        if (thread_pool_size &&
+            (virStrToLong_i(thread_pool_size, NULL, 10, &def->thread_pool_size) < 0 ||
+             def->thread_pool_size < 0)) {
+            virReportError(VIR_ERR_XML_ERROR,
+                           _("cannot parse thread pool size '%s' for virtiofs"),
+                           thread_pool_size);
+            goto error;
+        }
+
         if (xattr) {
             if ((val = virTristateSwitchTypeFromString(xattr)) <= 0) {
                 virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
@@ -16532,6 +16621,33 @@ virDomainPMStateParseXML(xmlXPathContextPtr ctxt,
 }
 
 
+static int
+virDomainAutostartDefParseXML(virDomainDefPtr def,
+                              xmlXPathContextPtr ctxt)
+{
+    VIR_XPATH_NODE_AUTORESTORE(ctxt);
+
+    if (!(ctxt->node = virXPathNode("./autostart", ctxt)))
+        return 0;
+
+    if (virXPathInt("string(./@priority)", ctxt,
+                    &def->autostart.priority) == -2) {
+        virReportError(VIR_ERR_XML_ERROR, "%s",
+                       _("invalid autostart priority"));
+        return -1;
+    }
+
+    if (virXPathUInt("string(./@delay)", ctxt,
+                     &def->autostart.delay) == -2) {
+        virReportError(VIR_ERR_XML_ERROR, "%s",
+                       _("invalid autostart delay"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 virDomainPerfEventDefParseXML(virDomainPerfDefPtr perf,
                               xmlNodePtr node)
@@ -17163,6 +17279,60 @@ virDomainDeviceDefParse(const char *xmlStr,
 }
 
 
+/**
+ * virDomainDeviceXMLSplit:
+ * @xmlStr: XML document with a <devices> root element
+ *
+ * Splits the list of devices in @xmlStr into separate documents, one per
+ * child element of <devices>, which can be parsed using
+ * virDomainDeviceDefParse().
+ *
+ * Returns a NULL terminated list of strings with at least one element on
+ * success, NULL on error.
+ */
+char **
+virDomainDeviceXMLSplit(const char *xmlStr)
+{
+    g_autoptr(xmlDoc) xml = NULL;
+    g_autoptr(xmlXPathContext) ctxt = NULL;
+    VIR_AUTOSTRINGLIST devices = NULL;
+    size_t ndevices = 0;
+    xmlNodePtr cur;
+
+    if (!(xml = virXMLParseStringCtxt(xmlStr, _("(devices_definition)"), &ctxt)))
+        return NULL;
+
+    if (!virXMLNodeNameEqual(ctxt->node, "devices")) {
+        virReportError(VIR_ERR_XML_ERROR,
+                       _("expecting root element of 'devices', not '%s'"),
+                       ctxt->node->name);
+        return NULL;
+    }
+
+    for (cur = ctxt->node->children; cur; cur = cur->next) {
+        char *device;
+
+        if (cur->type != XML_ELEMENT_NODE)
+            continue;
+
+        if (!(device = virXMLNodeToString(xml, cur)))
+            return NULL;
+
+        devices = g_renew(char *, devices, ndevices + 2);
+        devices[ndevices++] = device;
+        devices[ndevices] = NULL;
+    }
+
+    if (ndevices == 0) {
+        virReportError(VIR_ERR_XML_ERROR, "%s",
+                       _("no devices found in 'devices' element"));
+        return NULL;
+    }
+
+    return g_steal_pointer(&devices);
+}
+
+
 virDomainDiskDefPtr
 virDomainDiskDefParse(const char *xmlStr,
                       virDomainXMLOptionPtr xmlopt,
@@ -20848,6 +21018,8 @@ virDomainDefParseCaps(virDomainDefPtr def,
     g_autofree char *virttype = NULL;
     g_autofree char *arch = NULL;
     g_autofree char *ostype = NULL;
+    g_autofree char *machine = NULL;
+    g_autofree char *emulator = NULL;
 
     virttype = virXPathString("string(./@type)", ctxt);
     ostype = virXPathString("string(./os/type[1])", ctxt);
@@ -20855,8 +21027,10 @@ virDomainDefParseCaps(virDomainDefPtr def,
 
     def->os.bootloader = virXPathString("string(./bootloader)", ctxt);
     def->os.bootloaderArgs = virXPathString("string(./bootloader_args)", ctxt);
-    def->os.machine = virXPathString("string(./os/type[1]/@machine)", ctxt);
-    def->emulator = virXPathString("string(./devices/emulator[1])", ctxt);
+    machine = virXPathString("string(./os/type[1]/@machine)", ctxt);
+    def->os.machine = virStringIntern(machine);
+    emulator = virXPathString("string(./devices/emulator[1])", ctxt);
+    def->emulator = virStringIntern(emulator);
 
     if (!virttype) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -20920,6 +21094,7 @@ virDomainMemorytuneDefParseMemory(xmlXPathContextPtr ctxt,
     VIR_XPATH_NODE_AUTORESTORE(ctxt);
     unsigned int id;
     unsigned int bandwidth;
+    unsigned int min_bandwidth;
     g_autofree char *tmp = NULL;
 
     ctxt->node = node;
@@ -20952,6 +21127,20 @@ virDomainMemorytuneDefParseMemory(xmlXPathContextPtr ctxt,
     }
     if (virResctrlAllocSetMemoryBandwidth(alloc, id, bandwidth) < 0)
         return -1;
+    VIR_FREE(tmp);
+
+    if ((tmp = virXMLPropString(node, "min_bandwidth"))) {
+        if (virStrToLong_uip(tmp, NULL, 10, &min_bandwidth) < 0 ||
+            min_bandwidth == 0) {
+            virReportError(VIR_ERR_XML_ERROR,
+                           _("Invalid memorytune attribute 'min_bandwidth' "
+                             "value '%s'"),
+                           tmp);
+            return -1;
+        }
+        if (virResctrlAllocSetMemoryBandwidthMin(alloc, id, min_bandwidth) < 0)
+            return -1;
+    }
 
     return 0;
 }
@@ -21058,17 +21247,9 @@ virDomainDefParseXML(xmlDocPtr xml,
     g_autofree xmlNodePtr *nodes = NULL;
     g_autofree char *tmp = NULL;
 
-    if (flags & VIR_DOMAIN_DEF_PARSE_VALIDATE_SCHEMA) {
-        g_autofree char *schema = NULL;
-
-        schema = virFileFindResource("domain.rng",
-                                     abs_top_srcdir "/docs/schemas",
-                                     PKGDATADIR "/schemas");
-        if (!schema)
-            return NULL;
-        if (virXMLValidateAgainstSchema(schema, xml) < 0)
-            return NULL;
-    }
+    if (flags & VIR_DOMAIN_DEF_PARSE_VALIDATE_SCHEMA &&
+        virDomainXMLOptionValidateSchema(xmlopt, xml) < 0)
+        return NULL;
 
     if (!(def = virDomainDefNew()))
         return NULL;
@@ -21567,6 +21748,9 @@ virDomainDefParseXML(xmlDocPtr xml,
                                  &def->pm.s4) < 0)
         goto error;
 
+    if (virDomainAutostartDefParseXML(def, ctxt) < 0)
+        goto error;
+
     if (virDomainPerfDefParseXML(def, ctxt) < 0)
         goto error;
 
@@ -25957,6 +26141,11 @@ virDomainFSDefFormat(virBufferPtr buf,
                               virDomainFSCacheModeTypeToString(def->cache));
         }
 
+        if (def->thread_pool_size >= 0) {
+            virBufferAsprintf(&binaryBuf, "<thread_pool size='%d'/>\n",
+                              def->thread_pool_size);
+        }
+
         if (def->posix_lock != VIR_TRISTATE_SWITCH_ABSENT) {
             virBufferAsprintf(&lockAttrBuf, " posix='%s'",
                               virTristateSwitchTypeToString(def->posix_lock));
@@ -28846,16 +29035,24 @@ virDomainCachetuneDefFormat(virBufferPtr buf,
 }
 
 
+struct virDomainMemorytuneDefFormatData {
+    virBufferPtr buf;
+    virResctrlAllocPtr alloc;
+};
+
+
 static int
 virDomainMemorytuneDefFormatHelper(unsigned int id,
                                    unsigned int bandwidth,
                                    void *opaque)
 {
-    virBufferPtr buf = opaque;
+    struct virDomainMemorytuneDefFormatData *data = opaque;
+    unsigned int min_bandwidth;
 
-    virBufferAsprintf(buf,
-                      "<node id='%u' bandwidth='%u'/>\n",
-                      id, bandwidth);
+    virBufferAsprintf(data->buf, "<node id='%u' bandwidth='%u'", id, bandwidth);
+    if ((min_bandwidth = virResctrlAllocGetMemoryBandwidthMin(data->alloc, id)))
+        virBufferAsprintf(data->buf, " min_bandwidth='%u'", min_bandwidth);
+    virBufferAddLit(data->buf, "/>\n");
     return 0;
 }
 
@@ -28866,12 +29063,14 @@ virDomainMemorytuneDefFormat(virBufferPtr buf,
                             unsigned int flags)
 {
     g_auto(virBuffer) childrenBuf = VIR_BUFFER_INIT_CHILD(buf);
+    struct virDomainMemorytuneDefFormatData data = { &childrenBuf,
+                                                     resctrl->alloc };
     g_autofree char *vcpus = NULL;
     size_t i = 0;
 
     if (virResctrlAllocForeachMemory(resctrl->alloc,
                                      virDomainMemorytuneDefFormatHelper,
-                                     &childrenBuf) < 0)
+                                     &data) < 0)
         return -1;
 
     for (i = 0; i< resctrl->nmonitors; i++) {
@@ -29955,6 +30154,15 @@ virDomainDefFormatInternalSetRootName(virDomainDefPtr def,
         virBufferAddLit(buf, "</pm>\n");
     }
 
+    if (def->autostart.priority || def->autostart.delay) {
+        virBufferAddLit(buf, "<autostart");
+        if (def->autostart.priority)
+            virBufferAsprintf(buf, " priority='%d'", def->autostart.priority);
+        if (def->autostart.delay)
+            virBufferAsprintf(buf, " delay='%u'", def->autostart.delay);
+        virBufferAddLit(buf, "/>\n");
+    }
+
     virDomainPerfDefFormat(buf, &def->perf);
 
     virBufferAddLit(buf, "<devices>\n");
@@ -30155,9 +30363,18 @@ virDomainDefFormat(virDomainDefPtr def,
     g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
 
     virCheckFlags(VIR_DOMAIN_DEF_FORMAT_COMMON_FLAGS, NULL);
+
+    /* The document rarely changes size much between calls, so sizing
+     * the buffer from the previous run avoids repeated reallocation
+     * while formatting large definitions. Leave some slack for
+     * flags adding content, e.g. secure or live-only elements. */
+    virBufferReserve(&buf, def->formatSize + def->formatSize / 8);
+
     if (virDomainDefFormatInternal(def, xmlopt, &buf, flags) < 0)
         return NULL;
 
+    def->formatSize = virBufferUse(&buf);
+
     return virBufferContentAndReset(&buf);
 }
 
@@ -30320,7 +30537,8 @@ virDomainDefCompatibleDevice(virDomainDefPtr def,
 static int
 virDomainDefSaveXML(virDomainDefPtr def,
                     const char *configDir,
-                    const char *xml)
+                    const char *xml,
+                    bool deferred)
 {
     char uuidstr[VIR_UUID_STRING_BUFLEN];
     g_autofree char *configFile = NULL;
@@ -30339,6 +30557,11 @@ virDomainDefSaveXML(virDomainDefPtr def,
     }
 
     virUUIDFormat(def->uuid, uuidstr);
+    if (deferred)
+        return virXMLSaveFileDeferred(configFile,
+                                      virXMLPickShellSafeComment(def->name, uuidstr),
+                                      "edit", xml);
+
     return virXMLSaveFile(configFile,
                            virXMLPickShellSafeComment(def->name, uuidstr), "edit",
                            xml);
@@ -30351,10 +30574,14 @@ virDomainDefSave(virDomainDefPtr def,
 {
     g_autofree char *xml = NULL;
 
+    def->serial = virDomainDefNextSerial();
+
     if (!(xml = virDomainDefFormat(def, xmlopt, VIR_DOMAIN_DEF_FORMAT_SECURE)))
         return -1;
 
-    return virDomainDefSaveXML(def, configDir, xml);
+    /* The persistent config may be written behind; unlike the status
+     * XML, nothing but the next daemon start reads it back. */
+    return virDomainDefSaveXML(def, configDir, xml, true);
 }
 
 int
@@ -30369,11 +30596,136 @@ virDomainObjSave(virDomainObjPtr obj,
                           VIR_DOMAIN_DEF_FORMAT_CLOCK_ADJUST);
 
     g_autofree char *xml = NULL;
+    g_autofree char *statusFile = NULL;
+    unsigned char digest[VIR_CRYPTO_HASH_SIZE_SHA256];
+    bool haveDigest;
+
+    obj->def->serial = virDomainDefNextSerial();
 
     if (!(xml = virDomainObjFormat(obj, xmlopt, flags)))
         return -1;
 
-    return virDomainDefSaveXML(obj->def, statusDir, xml);
+    /* Most state changes don't alter the status XML at all. Rewriting and
+     * syncing the file is far more costly than formatting and hashing it,
+     * so skip the write if the file still holds the very same content. */
+    haveDigest = virCryptoHashBuf(VIR_CRYPTO_HASH_SHA256, xml, digest) >= 0;
+    if (!haveDigest)
+        virResetLastError();
+
+    if (haveDigest && statusDir && obj->hasStatusDigest &&
+        memcmp(digest, obj->statusDigest, sizeof(digest)) == 0 &&
+        (statusFile = virDomainConfigFile(statusDir, obj->def->name)) &&
+        virFileExists(statusFile))
+        return 0;
+
+    obj->hasStatusDigest = false;
+
+    if (virDomainDefSaveXML(obj->def, statusDir, xml, false) < 0)
+        return -1;
+
+    if (haveDigest) {
+        memcpy(obj->statusDigest, digest, sizeof(digest));
+        obj->hasStatusDigest = true;
+    }
+
+    return 0;
+}
+
+
+/* Brings the cached digest of @def formatted with @flags up to date.
+ * Sets @changed if the digest differs from the cached one. */
+static int
+virDomainObjUpdateDigest(virDomainDefPtr def,
+                         virDomainXMLOptionPtr xmlopt,
+                         unsigned int flags,
+                         char **digest,
+                         unsigned long long *serial,
+                         bool *changed)
+{
+    g_autofree char *xml = NULL;
+    g_autofree char *hash = NULL;
+
+    if (!def) {
+        if (*digest) {
+            g_clear_pointer(digest, g_free);
+            *changed = true;
+        }
+        *serial = 0;
+        return 0;
+    }
+
+    if (*digest && *serial == def->serial)
+        return 0;
+
+    if (!(xml = virDomainDefFormat(def, xmlopt, flags)) ||
+        virCryptoHashString(VIR_CRYPTO_HASH_SHA256, xml, &hash) < 0)
+        return -1;
+
+    *serial = def->serial;
+
+    if (STRNEQ_NULLABLE(*digest, hash)) {
+        g_free(*digest);
+        *digest = g_steal_pointer(&hash);
+        *changed = true;
+    }
+
+    return 0;
+}
+
+
+/**
+ * virDomainObjGetDigest:
+ * @vm: locked domain object
+ * @xmlopt: XML parser config
+ * @inactive: whether to return the digest of the persistent definition
+ * @generation: filled with the definition generation, may be NULL
+ * @digest: filled with the digest, may be NULL
+ *
+ * Gets the SHA-256 of the XML of the live or, if @inactive is true, the
+ * persistent definition of @vm, formatted without secure information.
+ * @digest is set to NULL when asking for the persistent definition of a
+ * transient domain. The generation counts changes of either digest since
+ * the daemon started, so a client which remembers it only needs to fetch
+ * the XML of @vm again once it changes.
+ *
+ * Digests are cached and only computed again once the definition was
+ * replaced or saved, so definitions which don't change are not formatted
+ * over and over.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virDomainObjGetDigest(virDomainObjPtr vm,
+                      virDomainXMLOptionPtr xmlopt,
+                      bool inactive,
+                      unsigned long long *generation,
+                      char **digest)
+{
+    virDomainDefPtr persistentDef = NULL;
+    bool changed = false;
+
+    if (vm->persistent)
+        persistentDef = vm->newDef ? vm->newDef : vm->def;
+
+    if (virDomainObjUpdateDigest(vm->def, xmlopt, 0,
+                                 &vm->liveDigest, &vm->liveDigestSerial,
+                                 &changed) < 0 ||
+        virDomainObjUpdateDigest(persistentDef, xmlopt,
+                                 VIR_DOMAIN_DEF_FORMAT_INACTIVE,
+                                 &vm->configDigest, &vm->configDigestSerial,
+                                 &changed) < 0)
+        return -1;
+
+    if (changed || vm->digestGeneration == 0)
+        vm->digestGeneration++;
+
+    if (generation)
+        *generation = vm->digestGeneration;
+
+    if (digest)
+        *digest = g_strdup(inactive ? vm->configDigest : vm->liveDigest);
+
+    return 0;
 }
 
 
@@ -30395,6 +30747,7 @@ virDomainDeleteConfig(const char *configDir,
     unlink(autostartLink);
     dom->autostart = 0;
 
+    virWriteBehindCancel(configFile);
     if (unlink(configFile) < 0 &&
         errno != ENOENT) {
         virReportSystemError(errno,
@@ -30670,6 +31023,13 @@ virDomainDefCopy(virDomainDefPtr src,
     if (migratable)
         format_flags |= VIR_DOMAIN_DEF_FORMAT_INACTIVE | VIR_DOMAIN_DEF_FORMAT_MIGRATABLE;
 
+    /* The defaults filled in by the hypervisor post parse callbacks of @src
+     * are formatted, so they would only do the same work again, including
+     * looking up capabilities and assigning addresses. The migratable XML
+     * lacks the implicit devices though, which the callbacks add back. */
+    if (!migratable && !src->postParseFailed)
+        parse_flags |= VIR_DOMAIN_DEF_PARSE_SKIP_POST_PARSE_CALLBACKS;
+
     /* Easiest to clone via a round-trip through XML.  */
     if (!(xml = virDomainDefFormat(src, xmlopt, format_flags)))
         return NULL;
@@ -30699,9 +31059,52 @@ virDomainObjGetState(virDomainObjPtr dom, int *reason)
 }
 
 
+/* Attempts of reading the state without the lock before taking it */
+#define VIR_DOMAIN_OBJ_STATE_READ_TRIES 3
+
+/**
+ * virDomainObjGetStateLockless:
+ * @dom: domain object, unlocked
+ * @reason: filled with the reason of the state, if not NULL
+ *
+ * Same as virDomainObjGetState(), for callers which hold a reference
+ * on @dom but not its lock. The state is read without locking @dom
+ * unless it is locked by another thread.
+ */
+virDomainState
+virDomainObjGetStateLockless(virDomainObjPtr dom, int *reason)
+{
+    virDomainState state;
+    unsigned int seq;
+    size_t i;
+    int r;
+
+    for (i = 0; i < VIR_DOMAIN_OBJ_STATE_READ_TRIES; i++) {
+        if (!virObjectReadBegin(dom, &seq))
+            break;
+
+        state = dom->state.state;
+        r = dom->state.reason;
+
+        if (virObjectReadValid(dom, seq)) {
+            if (reason)
+                *reason = r;
+            return state;
+        }
+    }
+
+    virObjectLock(dom);
+    state = virDomainObjGetState(dom, reason);
+    virObjectUnlock(dom);
+
+    return state;
+}
+
+
 void
 virDomainObjSetState(virDomainObjPtr dom, virDomainState state, int reason)
 {
+    virDomainState oldState = dom->state.state;
     int last;
 
     switch (state) {
@@ -30740,6 +31143,9 @@ virDomainObjSetState(virDomainObjPtr dom, virDomainState state, int reason)
         dom->state.reason = reason;
     else
         dom->state.reason = 0;
+
+    if (dom->list && oldState != state)
+        virDomainObjListUpdateState(dom->list, dom, oldState);
 }
 
 
@@ -33,6 +33,7 @@
 #include "cpu_conf.h"
 #include "virthread.h"
 #include "virhash.h"
+#include "vircrypto.h"
 #include "virsocketaddr.h"
 #include "networkcommon_conf.h"
 #include "nwfilter_params.h"
@@ -849,6 +850,7 @@ struct _virDomainFSDef {
     bool symlinksResolved;
     char *binary;
     unsigned long long queue_size;
+    int thread_pool_size; /* -1 for the virtiofsd default */
     virTristateSwitch xattr;
     virDomainFSCacheMode cache;
     virTristateSwitch posix_lock;
@@ -2072,7 +2074,7 @@ struct _virDomainOSDef {
     int type;
     virDomainOsDefFirmware firmware;
     virArch arch;
-    char *machine;
+    const char *machine; /* interned, see virStringIntern */
     size_t nBootDevs;
     int bootDevs[VIR_DOMAIN_BOOT_LAST];
     int bootmenu; /* enum virTristateBool */
@@ -2434,6 +2436,11 @@ struct _virDomainPowerManagement {
     int s4;
 };
 
+struct _virDomainAutostartDef {
+    int priority; /* domains with higher priority are started first */
+    unsigned int delay; /* seconds since autostart began */
+};
+
 struct _virDomainPerfDef {
     /* These options are of type enum virTristateBool */
     int events[VIR_PERF_EVENT_LAST];
@@ -2518,6 +2525,10 @@ struct _virDomainDef {
     bool genidRequested;
     bool genidGenerated;
 
+    /* Unique within the daemon, renewed by virDomainDefSave and
+     * virDomainObjSave; see virDomainObjGetDigest */
+    unsigned long long serial;
+
     char *name;
     char *title;
     char *description;
@@ -2553,10 +2564,12 @@ struct _virDomainDef {
 
     virDomainPowerManagement pm;
 
+    virDomainAutostartDef autostart;
+
     virDomainPerfDef perf;
 
     virDomainOSDef os;
-    char *emulator;
+    const char *emulator; /* interned */
     /* Most {caps_,hyperv_,kvm_,}feature options utilize a virTristateSwitch
      * to handle support. A few assign specific data values to the option.
      * See virDomainDefFeaturesCheckABIStability() for details. */
@@ -2678,6 +2691,8 @@ struct _virDomainDef {
                              callbacks failed for a non-critical reason
                              (was not able to fill in some data) and thus
                              should be re-run before starting */
+    size_t formatSize; /* length of the most recently formatted XML,
+                          used to size the buffer for the next one */
 };
 
 
@@ -2738,6 +2753,10 @@ struct _virDomainObj {
 
     virDomainCheckpointObjListPtr checkpoints;
 
+    /* The list the object is in, if any. Not referenced,
+     * maintained by virDomainObjList itself */
+    virDomainObjListPtr list;
+
     void *privateData;
     void (*privateDataFreeFunc)(void *);
 
@@ -2745,6 +2764,18 @@ struct _virDomainObj {
 
     unsigned long long original_memlock; /* Original RLIMIT_MEMLOCK, zero if no
                                           * restore will be required later */
+
+    /* SHA-256 of the status XML last written by virDomainObjSave */
+    unsigned char statusDigest[VIR_CRYPTO_HASH_SIZE_SHA256];
+    bool hasStatusDigest;
+
+    /* Cached digests of the definitions, maintained by
+     * virDomainObjGetDigest */
+    char *liveDigest;
+    unsigned long long liveDigestSerial;
+    char *configDigest;
+    unsigned long long configDigestSerial;
+    unsigned long long digestGeneration;
 };
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virDomainObj, virObjectUnref);
@@ -2752,6 +2783,10 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(virDomainObj, virObjectUnref);
 
 typedef bool (*virDomainObjListACLFilter)(virConnectPtr conn,
                                           virDomainDefPtr def);
+typedef int (*virDomainObjListACLListFilter)(virConnectPtr conn,
+                                             virDomainDefPtr *defs,
+                                             size_t ndefs,
+                                             virBitmapPtr allowed);
 
 
 /* NB: Any new flag to this list be considered to be set in
@@ -3152,6 +3187,10 @@ typedef enum {
      * post parse callbacks before starting. Failure of the post parse callback
      * is recorded as def->postParseFail */
     VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL = 1 << 12,
+    /* The XML was formatted from a definition which already went through
+     * the hypervisor specific post parse callbacks, so they are skipped.
+     * Used by virDomainDefCopy. */
+    VIR_DOMAIN_DEF_PARSE_SKIP_POST_PARSE_CALLBACKS = 1 << 13,
 } virDomainDefParseFlags;
 
 typedef enum {
@@ -3183,6 +3222,7 @@ virDomainDeviceDefPtr virDomainDeviceDefParse(const char *xmlStr,
                                               virDomainXMLOptionPtr xmlopt,
                                               void *parseOpaque,
                                               unsigned int flags);
+char **virDomainDeviceXMLSplit(const char *xmlStr);
 virDomainDiskDefPtr virDomainDiskDefParse(const char *xmlStr,
                                           virDomainXMLOptionPtr xmlopt,
                                           unsigned int flags);
@@ -3448,6 +3488,14 @@ int virDomainObjSave(virDomainObjPtr obj,
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2)
     ATTRIBUTE_NONNULL(3);
 
+int virDomainObjGetDigest(virDomainObjPtr vm,
+                          virDomainXMLOptionPtr xmlopt,
+                          bool inactive,
+                          unsigned long long *generation,
+                          char **digest)
+    G_GNUC_WARN_UNUSED_RESULT
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+
 typedef void (*virDomainLoadConfigNotify)(virDomainObjPtr dom,
                                           int newDomain,
                                           void *opaque);
@@ -3503,6 +3551,9 @@ virDomainObjSetState(virDomainObjPtr obj, virDomainState state, int reason)
 virDomainState
 virDomainObjGetState(virDomainObjPtr obj, int *reason)
         ATTRIBUTE_NONNULL(1);
+virDomainState
+virDomainObjGetStateLockless(virDomainObjPtr obj, int *reason)
+        ATTRIBUTE_NONNULL(1);
 
 virSecurityLabelDefPtr
 virDomainDefGetSecurityLabelDef(virDomainDefPtr def, const char *model);
@@ -57,6 +57,7 @@ static virClassPtr virDomainEventJobCompletedClass;
 static virClassPtr virDomainEventDeviceRemovalFailedClass;
 static virClassPtr virDomainEventMetadataChangeClass;
 static virClassPtr virDomainEventBlockThresholdClass;
+static virClassPtr virDomainEventStatsClass;
 
 static void virDomainEventDispose(void *obj);
 static void virDomainEventLifecycleDispose(void *obj);
@@ -79,6 +80,7 @@ static void virDomainEventJobCompletedDispose(void *obj);
 static void virDomainEventDeviceRemovalFailedDispose(void *obj);
 static void virDomainEventMetadataChangeDispose(void *obj);
 static void virDomainEventBlockThresholdDispose(void *obj);
+static void virDomainEventStatsDispose(void *obj);
 
 static void
 virDomainEventDispatchDefaultFunc(virConnectPtr conn,
@@ -287,6 +289,15 @@ struct _virDomainEventBlockThreshold {
 typedef struct _virDomainEventBlockThreshold virDomainEventBlockThreshold;
 typedef virDomainEventBlockThreshold *virDomainEventBlockThresholdPtr;
 
+struct _virDomainEventStats {
+    virDomainEvent parent;
+
+    virTypedParameterPtr params;
+    int nparams;
+};
+typedef struct _virDomainEventStats virDomainEventStats;
+typedef virDomainEventStats *virDomainEventStatsPtr;
+
 
 static int
 virDomainEventsOnceInit(void)
@@ -333,6 +344,8 @@ virDomainEventsOnceInit(void)
         return -1;
     if (!VIR_CLASS_NEW(virDomainEventBlockThreshold, virDomainEventClass))
         return -1;
+    if (!VIR_CLASS_NEW(virDomainEventStats, virDomainEventClass))
+        return -1;
     return 0;
 }
 
@@ -542,6 +555,16 @@ virDomainEventBlockThresholdDispose(void *obj)
 }
 
 
+static void
+virDomainEventStatsDispose(void *obj)
+{
+    virDomainEventStatsPtr event = obj;
+    VIR_DEBUG("obj=%p", event);
+
+    virTypedParamsFree(event->params, event->nparams);
+}
+
+
 static void *
 virDomainEventNew(virClassPtr klass,
                   int eventID,
@@ -1208,6 +1231,7 @@ virDomainEventBalloonChangeNewFromDom(virDomainPtr dom,
         return NULL;
 
     ev->actual = actual;
+    ev->parent.parent.coalesce = true;
 
     return (virObjectEventPtr)ev;
 }
@@ -1226,6 +1250,7 @@ virDomainEventBalloonChangeNewFromObj(virDomainObjPtr obj,
         return NULL;
 
     ev->actual = actual;
+    ev->parent.parent.coalesce = true;
 
     return (virObjectEventPtr)ev;
 }
@@ -1619,6 +1644,55 @@ virDomainEventBlockThresholdNewFromDom(virDomainPtr dom,
 }
 
 
+/* This function consumes @params, the caller must not free it.
+ */
+static virObjectEventPtr
+virDomainEventStatsNew(int id,
+                       const char *name,
+                       const unsigned char *uuid,
+                       virTypedParameterPtr params,
+                       int nparams)
+{
+    virDomainEventStatsPtr ev;
+
+    if (virDomainEventsInitialize() < 0)
+        goto error;
+
+    if (!(ev = virDomainEventNew(virDomainEventStatsClass,
+                                 VIR_DOMAIN_EVENT_ID_STATS,
+                                 id, name, uuid)))
+        goto error;
+
+    ev->params = params;
+    ev->nparams = nparams;
+    ev->parent.parent.coalesce = true;
+
+    return (virObjectEventPtr) ev;
+
+ error:
+    virTypedParamsFree(params, nparams);
+    return NULL;
+}
+
+virObjectEventPtr
+virDomainEventStatsNewFromObj(virDomainObjPtr obj,
+                              virTypedParameterPtr params,
+                              int nparams)
+{
+    return virDomainEventStatsNew(obj->def->id, obj->def->name,
+                                  obj->def->uuid, params, nparams);
+}
+
+virObjectEventPtr
+virDomainEventStatsNewFromDom(virDomainPtr dom,
+                              virTypedParameterPtr params,
+                              int nparams)
+{
+    return virDomainEventStatsNew(dom->id, dom->name, dom->uuid,
+                                  params, nparams);
+}
+
+
 static void
 virDomainEventDispatchDefaultFunc(virConnectPtr conn,
                                   virObjectEventPtr event,
@@ -1902,6 +1976,18 @@ virDomainEventDispatchDefaultFunc(virConnectPtr conn,
                                                               cbopaque);
             goto cleanup;
         }
+
+    case VIR_DOMAIN_EVENT_ID_STATS:
+        {
+            virDomainEventStatsPtr ev;
+
+            ev = (virDomainEventStatsPtr) event;
+            ((virConnectDomainEventStatsCallback) cb)(conn, dom,
+                                                      ev->params,
+                                                      ev->nparams,
+                                                      cbopaque);
+            goto cleanup;
+        }
     case VIR_DOMAIN_EVENT_ID_LAST:
         break;
     }
@@ -2159,6 +2245,24 @@ virDomainEventStateDeregister(virConnectPtr conn,
 }
 
 
+/**
+ * virDomainEventStateHasCallbacks:
+ * @state: object event state
+ * @eventID: ID of the event type
+ *
+ * Returns true if any domain event callback is registered for @eventID.
+ */
+bool
+virDomainEventStateHasCallbacks(virObjectEventStatePtr state,
+                                int eventID)
+{
+    if (virDomainEventsInitialize() < 0)
+        return false;
+
+    return virObjectEventStateHasCallbacks(state, virDomainEventClass, eventID);
+}
+
+
 /**
  * virDomainQemuMonitorEventFilter:
  * @conn: the connection pointer
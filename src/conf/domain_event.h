@@ -255,6 +255,20 @@ virDomainEventBlockThresholdNewFromDom(virDomainPtr dom,
                                        unsigned long long threshold,
                                        unsigned long long excess);
 
+virObjectEventPtr
+virDomainEventStatsNewFromObj(virDomainObjPtr obj,
+                              virTypedParameterPtr params,
+                              int nparams);
+
+virObjectEventPtr
+virDomainEventStatsNewFromDom(virDomainPtr dom,
+                              virTypedParameterPtr params,
+                              int nparams);
+
+bool
+virDomainEventStateHasCallbacks(virObjectEventStatePtr state,
+                                int eventID);
+
 int
 virDomainEventStateRegister(virConnectPtr conn,
                             virObjectEventStatePtr state,
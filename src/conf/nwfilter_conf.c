@@ -2990,7 +2990,7 @@ virNWFilterRuleDefDetailsFormat(virBufferPtr buf,
 }
 
 
-static int
+int
 virNWFilterRuleDefFormat(virBufferPtr buf,
                          virNWFilterRuleDefPtr def)
 {
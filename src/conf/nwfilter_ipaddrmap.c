@@ -26,14 +26,15 @@
 #include "viralloc.h"
 #include "virerror.h"
 #include "virstring.h"
+#include "virhash.h"
+#include "virobject.h"
 #include "datatypes.h"
 #include "nwfilter_params.h"
 #include "nwfilter_ipaddrmap.h"
 
 #define VIR_FROM_THIS VIR_FROM_NWFILTER
 
-static virMutex ipAddressMapLock = VIR_MUTEX_INITIALIZER;
-static virHashTablePtr ipAddressMap;
+static virHashShardedPtr ipAddressMap;
 
 
 /* Add an IP address to the list of IP addresses an interface is
@@ -52,18 +53,19 @@ virNWFilterIPAddrMapAddIPAddr(const char *ifname, char *addr)
     int ret = -1;
     char *addrCopy;
     virNWFilterVarValuePtr val;
+    virHashTablePtr table;
 
     addrCopy = g_strdup(addr);
 
-    virMutexLock(&ipAddressMapLock);
+    table = virHashShardedLockKey(ipAddressMap, ifname);
 
-    val = virHashLookup(ipAddressMap, ifname);
+    val = virHashLookup(table, ifname);
     if (!val) {
         val = virNWFilterVarValueCreateSimple(addrCopy);
         if (!val)
             goto cleanup;
         addrCopy = NULL;
-        ret = virHashUpdateEntry(ipAddressMap, ifname, val);
+        ret = virHashUpdateEntry(table, ifname, val);
         if (ret < 0)
             virNWFilterVarValueFree(val);
         goto cleanup;
@@ -76,7 +78,7 @@ virNWFilterIPAddrMapAddIPAddr(const char *ifname, char *addr)
     ret = 0;
 
  cleanup:
-    virMutexUnlock(&ipAddressMapLock);
+    virHashShardedUnlockKey(ipAddressMap, ifname);
     VIR_FREE(addrCopy);
 
     return ret;
@@ -101,11 +103,12 @@ virNWFilterIPAddrMapDelIPAddr(const char *ifname, const char *ipaddr)
 {
     int ret = -1;
     virNWFilterVarValuePtr val = NULL;
+    virHashTablePtr table;
 
-    virMutexLock(&ipAddressMapLock);
+    table = virHashShardedLockKey(ipAddressMap, ifname);
 
     if (ipaddr != NULL) {
-        val = virHashLookup(ipAddressMap, ifname);
+        val = virHashLookup(table, ifname);
         if (val) {
             if (virNWFilterVarValueGetCardinality(val) == 1 &&
                 STREQ(ipaddr,
@@ -117,11 +120,11 @@ virNWFilterIPAddrMapDelIPAddr(const char *ifname, const char *ipaddr)
     } else {
  remove_entry:
         /* remove whole entry */
-        virHashRemoveEntry(ipAddressMap, ifname);
+        virHashRemoveEntry(table, ifname);
         ret = 0;
     }
 
-    virMutexUnlock(&ipAddressMapLock);
+    virHashShardedUnlockKey(ipAddressMap, ifname);
 
     return ret;
 }
@@ -137,19 +140,23 @@ virNWFilterIPAddrMapGetIPAddr(const char *ifname)
 {
     virNWFilterVarValuePtr res;
 
-    virMutexLock(&ipAddressMapLock);
+    res = virHashLookup(virHashShardedLockKey(ipAddressMap, ifname), ifname);
 
-    res = virHashLookup(ipAddressMap, ifname);
-
-    virMutexUnlock(&ipAddressMapLock);
+    virHashShardedUnlockKey(ipAddressMap, ifname);
 
     return res;
 }
 
+static void
+virNWFilterIPAddrMapDataFree(void *payload)
+{
+    virNWFilterVarValueFree(payload);
+}
+
 int
 virNWFilterIPAddrMapInit(void)
 {
-    ipAddressMap = virNWFilterHashTableCreate(0);
+    ipAddressMap = virHashShardedNew(0, virNWFilterIPAddrMapDataFree);
     if (!ipAddressMap)
         return -1;
 
@@ -159,6 +166,6 @@ virNWFilterIPAddrMapInit(void)
 void
 virNWFilterIPAddrMapShutdown(void)
 {
-    virHashFree(ipAddressMap);
+    virObjectUnref(ipAddressMap);
     ipAddressMap = NULL;
 }
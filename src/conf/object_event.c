@@ -30,6 +30,7 @@
 #include "datatypes.h"
 #include "viralloc.h"
 #include "virerror.h"
+#include "virhash.h"
 #include "virobject.h"
 #include "virstring.h"
 
@@ -56,10 +57,22 @@ struct _virObjectEventCallback {
 typedef struct _virObjectEventCallback virObjectEventCallback;
 typedef virObjectEventCallback *virObjectEventCallbackPtr;
 
+/* Callbacks registered for one event ID, and either for one object or
+ * for all of them, in the order of registration */
+struct _virObjectEventCallbackBucket {
+    size_t count;
+    virObjectEventCallbackPtr *callbacks;
+};
+typedef struct _virObjectEventCallbackBucket virObjectEventCallbackBucket;
+typedef virObjectEventCallbackBucket *virObjectEventCallbackBucketPtr;
+
 struct _virObjectEventCallbackList {
     unsigned int nextID;
     size_t count;
     virObjectEventCallbackPtr *callbacks;
+    /* buckets of @callbacks indexed by event ID and key, so that
+     * dispatching an event doesn't need to look at every callback */
+    virHashTablePtr index;
 };
 
 struct _virObjectEventQueue {
@@ -144,6 +157,86 @@ virObjectEventCallbackFree(virObjectEventCallbackPtr cb)
     VIR_FREE(cb);
 }
 
+static void
+virObjectEventCallbackBucketFree(void *opaque)
+{
+    virObjectEventCallbackBucketPtr bucket = opaque;
+
+    VIR_FREE(bucket->callbacks);
+    VIR_FREE(bucket);
+}
+
+
+static char *
+virObjectEventCallbackIndexKey(int eventID,
+                               const char *key)
+{
+    if (key)
+        return g_strdup_printf("%d:%s", eventID, key);
+    return g_strdup_printf("%d", eventID);
+}
+
+
+static virObjectEventCallbackBucketPtr
+virObjectEventCallbackIndexLookup(virObjectEventCallbackListPtr cbList,
+                                  int eventID,
+                                  const char *key)
+{
+    g_autofree char *name = virObjectEventCallbackIndexKey(eventID, key);
+
+    return virHashLookup(cbList->index, name);
+}
+
+
+static int
+virObjectEventCallbackIndexAdd(virObjectEventCallbackListPtr cbList,
+                               virObjectEventCallbackPtr cb)
+{
+    g_autofree char *name = NULL;
+    virObjectEventCallbackBucketPtr bucket;
+
+    name = virObjectEventCallbackIndexKey(cb->eventID,
+                                          cb->key_filter ? cb->key : NULL);
+
+    if (!(bucket = virHashLookup(cbList->index, name))) {
+        bucket = g_new0(virObjectEventCallbackBucket, 1);
+
+        if (virHashAddEntry(cbList->index, name, bucket) < 0) {
+            VIR_FREE(bucket);
+            return -1;
+        }
+    }
+
+    return VIR_APPEND_ELEMENT(bucket->callbacks, bucket->count, cb);
+}
+
+
+static void
+virObjectEventCallbackIndexRemove(virObjectEventCallbackListPtr cbList,
+                                  virObjectEventCallbackPtr cb)
+{
+    g_autofree char *name = NULL;
+    virObjectEventCallbackBucketPtr bucket;
+    size_t i;
+
+    name = virObjectEventCallbackIndexKey(cb->eventID,
+                                          cb->key_filter ? cb->key : NULL);
+
+    if (!(bucket = virHashLookup(cbList->index, name)))
+        return;
+
+    for (i = 0; i < bucket->count; i++) {
+        if (bucket->callbacks[i] == cb) {
+            VIR_DELETE_ELEMENT(bucket->callbacks, i, bucket->count);
+            break;
+        }
+    }
+
+    if (bucket->count == 0)
+        virHashRemoveEntry(cbList->index, name);
+}
+
+
 /**
  * virObjectEventCallbackListFree:
  * @list: event callback list head
@@ -164,6 +257,7 @@ virObjectEventCallbackListFree(virObjectEventCallbackListPtr list)
         VIR_FREE(list->callbacks[i]);
     }
     VIR_FREE(list->callbacks);
+    virHashFree(list->index);
     VIR_FREE(list);
 }
 
@@ -253,6 +347,7 @@ virObjectEventCallbackListRemoveID(virConnectPtr conn,
              * function won't end up with a double free error */
             if (doFreeCb && cb->freecb)
                 (*cb->freecb)(cb->opaque);
+            virObjectEventCallbackIndexRemove(cbList, cb);
             virObjectEventCallbackFree(cb);
             VIR_DELETE_ELEMENT(cbList->callbacks, i, cbList->count);
             return ret;
@@ -302,6 +397,7 @@ virObjectEventCallbackListPurgeMarked(virObjectEventCallbackListPtr cbList)
             virFreeCallback freecb = cbList->callbacks[n]->freecb;
             if (freecb)
                 (*freecb)(cbList->callbacks[n]->opaque);
+            virObjectEventCallbackIndexRemove(cbList, cbList->callbacks[n]);
             virObjectEventCallbackFree(cbList->callbacks[n]);
 
             VIR_DELETE_ELEMENT(cbList->callbacks, n, cbList->count);
@@ -443,8 +539,13 @@ virObjectEventCallbackListAddID(virConnectPtr conn,
     cb->filter_opaque = filter_opaque;
     cb->legacy = legacy;
 
-    if (VIR_APPEND_ELEMENT(cbList->callbacks, cbList->count, cb) < 0)
+    if (virObjectEventCallbackIndexAdd(cbList, cb) < 0)
+        goto cleanup;
+
+    if (VIR_APPEND_ELEMENT(cbList->callbacks, cbList->count, cb) < 0) {
+        virObjectEventCallbackIndexRemove(cbList, cb);
         goto cleanup;
+    }
 
     /* When additional filtering is being done, every client callback
      * is matched to exactly one server callback.  */
@@ -569,6 +670,10 @@ virObjectEventStateNew(void)
     if (VIR_ALLOC(state->callbacks) < 0)
         goto error;
 
+    if (!(state->callbacks->index = virHashCreate(32,
+                                                  virObjectEventCallbackBucketFree)))
+        goto error;
+
     if (!(state->queue = virObjectEventQueueNew()))
         goto error;
 
@@ -655,6 +760,46 @@ virObjectEventQueuePush(virObjectEventQueuePtr evtQueue,
 }
 
 
+/**
+ * virObjectEventQueueReplace:
+ * @evtQueue: the object event queue
+ * @event: the event to add
+ *
+ * Internal function to replace an event in @evtQueue which is about the
+ * same object, has the same event ID and is meant for the same remote
+ * callback as @event. Only events which report the current state of an
+ * object, and thus make the earlier ones obsolete, are replaced.
+ *
+ * Returns: true if @event replaced a queued event, false otherwise
+ */
+static bool
+virObjectEventQueueReplace(virObjectEventQueuePtr evtQueue,
+                           virObjectEventPtr event)
+{
+    size_t i;
+
+    if (!evtQueue || !event->coalesce || !event->meta.key)
+        return false;
+
+    for (i = evtQueue->count; i > 0; i--) {
+        virObjectEventPtr queued = evtQueue->events[i - 1];
+
+        if (queued->eventID != event->eventID ||
+            queued->remoteID != event->remoteID ||
+            queued->dispatch != event->dispatch ||
+            STRNEQ_NULLABLE(queued->meta.key, event->meta.key))
+            continue;
+
+        VIR_DEBUG("Replacing queued event %p with %p", queued, event);
+        evtQueue->events[i - 1] = event;
+        virObjectUnref(queued);
+        return true;
+    }
+
+    return false;
+}
+
+
 static bool
 virObjectEventDispatchMatchCallback(virObjectEventPtr event,
                                     virObjectEventCallbackPtr cb)
@@ -684,14 +829,35 @@ virObjectEventStateDispatchCallbacks(virObjectEventStatePtr state,
                                      virObjectEventPtr event,
                                      virObjectEventCallbackListPtr callbacks)
 {
-    size_t i;
-    /* Cache this now, since we may be dropping the lock,
-       and have more callbacks added. We're guaranteed not
-       to have any removed */
-    size_t cbCount = callbacks->count;
+    virObjectEventCallbackBucketPtr all;
+    virObjectEventCallbackBucketPtr keyed = NULL;
+    size_t nall;
+    size_t nkeyed = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    /* Only callbacks registered for the event ID, either for all objects
+     * or for the one the event is about, can match. Cache the counts now,
+     * since we may be dropping the lock, and have more callbacks added.
+     * We're guaranteed not to have any removed, so the buckets stay. */
+    all = virObjectEventCallbackIndexLookup(callbacks, event->eventID, NULL);
+    nall = all ? all->count : 0;
+    if (event->meta.key) {
+        keyed = virObjectEventCallbackIndexLookup(callbacks, event->eventID,
+                                                  event->meta.key);
+        nkeyed = keyed ? keyed->count : 0;
+    }
+
+    while (i < nall || j < nkeyed) {
+        virObjectEventCallbackPtr cb;
 
-    for (i = 0; i < cbCount; i++) {
-        virObjectEventCallbackPtr cb = callbacks->callbacks[i];
+        /* keep the order of registration across both buckets */
+        if (j == nkeyed ||
+            (i < nall &&
+             all->callbacks[i]->callbackID < keyed->callbacks[j]->callbackID))
+            cb = all->callbacks[i++];
+        else
+            cb = keyed->callbacks[j++];
 
         if (!virObjectEventDispatchMatchCallback(event, cb))
             continue;
@@ -749,6 +915,11 @@ virObjectEventStateQueueRemote(virObjectEventStatePtr state,
     virObjectLock(state);
 
     event->remoteID = remoteID;
+    if (virObjectEventQueueReplace(state->queue, event)) {
+        virObjectUnlock(state);
+        return;
+    }
+
     if (virObjectEventQueuePush(state->queue, event) < 0) {
         VIR_DEBUG("Error adding event to queue");
         virObjectUnref(event);
@@ -994,6 +1165,41 @@ virObjectEventStateCallbackID(virConnectPtr conn,
 }
 
 
+/**
+ * virObjectEventStateHasCallbacks:
+ * @state: object event state
+ * @klass: the base event class
+ * @eventID: the event ID
+ *
+ * Allows producers of events which are expensive to create to skip the
+ * work if nobody would receive them.
+ *
+ * Returns true if any callback is registered for @eventID of @klass.
+ */
+bool
+virObjectEventStateHasCallbacks(virObjectEventStatePtr state,
+                                virClassPtr klass,
+                                int eventID)
+{
+    virObjectEventCallbackListPtr cbList = state->callbacks;
+    bool ret = false;
+    size_t i;
+
+    virObjectLock(state);
+    for (i = 0; i < cbList->count; i++) {
+        virObjectEventCallbackPtr cb = cbList->callbacks[i];
+
+        if (!cb->deleted && cb->klass == klass && cb->eventID == eventID) {
+            ret = true;
+            break;
+        }
+    }
+    virObjectUnlock(state);
+
+    return ret;
+}
+
+
 /**
  * virObjectEventStateEventID:
  * @conn: connection associated with the callback
@@ -48,6 +48,9 @@ struct  __attribute__((aligned(8))) _virObjectEvent {
     virObjectMeta meta;
     int remoteID;
     virObjectEventDispatchFunc dispatch;
+    /* the event only reports the current state of the object, so an
+     * undispatched earlier one of the same kind can be dropped */
+    bool coalesce;
 };
 
 /**
@@ -94,6 +97,12 @@ virObjectEventStateCallbackID(virConnectPtr conn,
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(3)
     ATTRIBUTE_NONNULL(5);
 
+bool
+virObjectEventStateHasCallbacks(virObjectEventStatePtr state,
+                                virClassPtr klass,
+                                int eventID)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+
 void *
 virObjectEventNew(virClassPtr klass,
                   virObjectEventDispatchFunc dispatcher,
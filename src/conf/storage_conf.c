@@ -98,7 +98,7 @@ VIR_ENUM_IMPL(virStorageVolFormatDisk,
 
 VIR_ENUM_IMPL(virStorageVolDefRefreshAllocation,
               VIR_STORAGE_VOL_DEF_REFRESH_ALLOCATION_LAST,
-              "default", "capacity",
+              "default", "capacity", "lazy",
 );
 
 VIR_ENUM_IMPL(virStoragePartedFs,
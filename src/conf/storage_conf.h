@@ -71,6 +71,8 @@ struct _virStorageVolSource {
 typedef enum {
     VIR_STORAGE_VOL_DEF_REFRESH_ALLOCATION_DEFAULT,  /* compute actual allocation */
     VIR_STORAGE_VOL_DEF_REFRESH_ALLOCATION_CAPACITY, /* use logical capacity */
+    VIR_STORAGE_VOL_DEF_REFRESH_ALLOCATION_LAZY,     /* compute actual allocation
+                                                        only for volume queries */
     VIR_STORAGE_VOL_DEF_REFRESH_ALLOCATION_LAST,
 } virStorageVolDefRefreshAllocation;
 
@@ -96,6 +96,9 @@ typedef virDomainABIStability *virDomainABIStabilityPtr;
 typedef struct _virDomainActualNetDef virDomainActualNetDef;
 typedef virDomainActualNetDef *virDomainActualNetDefPtr;
 
+typedef struct _virDomainAutostartDef virDomainAutostartDef;
+typedef virDomainAutostartDef *virDomainAutostartDefPtr;
+
 typedef struct _virDomainBackupDef virDomainBackupDef;
 typedef virDomainBackupDef *virDomainBackupDefPtr;
 
@@ -255,6 +258,9 @@ typedef virDomainOSEnv *virDomainOSEnvPtr;
 typedef struct _virDomainObj virDomainObj;
 typedef virDomainObj *virDomainObjPtr;
 
+typedef struct _virDomainObjList virDomainObjList;
+typedef virDomainObjList *virDomainObjListPtr;
+
 typedef struct _virDomainPCIControllerOpts virDomainPCIControllerOpts;
 typedef virDomainPCIControllerOpts *virDomainPCIControllerOptsPtr;
 
@@ -46,8 +46,99 @@ struct _virDomainMomentObjList {
 
     virDomainMomentObj metaroot; /* Special parent of all root moments */
     virDomainMomentObjPtr current; /* The current moment, if any */
+
+    /* The metaroot and all moments reachable from it in pre-order,
+     * rebuilt on demand after the tree changed */
+    virDomainMomentObjPtr *order;
+    size_t norder;
+    bool indexed;
 };
 
+/* Position of moments which are not reachable from the metaroot */
+#define VIR_DOMAIN_MOMENT_UNINDEXED ((size_t)-1)
+
+
+static int
+virDomainMomentUnindex(void *payload,
+                       const void *name G_GNUC_UNUSED,
+                       void *data G_GNUC_UNUSED)
+{
+    virDomainMomentObjPtr moment = payload;
+
+    moment->pre = VIR_DOMAIN_MOMENT_UNINDEXED;
+    moment->last = VIR_DOMAIN_MOMENT_UNINDEXED;
+    return 0;
+}
+
+
+/* Label all moments reachable from the metaroot with their pre-order
+ * position and the position of their last descendant, unless the tree
+ * didn't change since the last time. The walk is iterative so that
+ * deep hierarchies can't exhaust the stack. */
+static void
+virDomainMomentObjListIndex(virDomainMomentObjListPtr moments)
+{
+    virDomainMomentObjPtr moment = &moments->metaroot;
+    size_t size = virHashSize(moments->objs) + 1;
+    size_t n = 0;
+
+    if (moments->indexed)
+        return;
+
+    virHashForEach(moments->objs, virDomainMomentUnindex, NULL);
+    moments->order = g_renew(virDomainMomentObjPtr, moments->order, size);
+
+    while (moment) {
+        if (n == size) {
+            VIR_WARN("inconsistent moment relations");
+            break;
+        }
+
+        moment->pre = n;
+        moments->order[n++] = moment;
+
+        if (moment->first_child) {
+            moment = moment->first_child;
+            continue;
+        }
+
+        /* Finish the moment and all its ancestors which have no more
+         * children to visit */
+        while (moment) {
+            moment->last = n - 1;
+            if (moment == &moments->metaroot) {
+                moment = NULL;
+            } else if (moment->sibling) {
+                moment = moment->sibling;
+                break;
+            } else {
+                moment = moment->parent;
+            }
+        }
+    }
+
+    moments->norder = n;
+    moments->indexed = true;
+}
+
+
+/* Return true if @moment is a descendant of @ancestor. */
+bool
+virDomainMomentIsDescendant(virDomainMomentObjPtr moment,
+                            virDomainMomentObjPtr ancestor)
+{
+    if (moment->list != ancestor->list)
+        return false;
+
+    virDomainMomentObjListIndex(ancestor->list);
+
+    if (moment->pre == VIR_DOMAIN_MOMENT_UNINDEXED ||
+        ancestor->pre == VIR_DOMAIN_MOMENT_UNINDEXED)
+        return false;
+
+    return ancestor->pre < moment->pre && moment->pre <= ancestor->last;
+}
+
 
 /* Run iter(data) on all direct children of moment, while ignoring all
  * other entries in moments.  Return the number of children
@@ -100,15 +191,42 @@ virDomainMomentForEachDescendant(virDomainMomentObjPtr moment,
                                  virHashIterator iter,
                                  void *data)
 {
-    struct moment_act_on_descendant act;
+    virDomainMomentObjListPtr moments = moment->list;
+    g_autofree virDomainMomentObjPtr *descendants = NULL;
+    size_t ndescendants;
+    size_t i;
+
+    if (moments)
+        virDomainMomentObjListIndex(moments);
 
-    act.number = 0;
-    act.iter = iter;
-    act.data = data;
-    virDomainMomentForEachChild(moment,
-                                virDomainMomentActOnDescendant, &act);
+    if (!moments || moment->pre == VIR_DOMAIN_MOMENT_UNINDEXED) {
+        /* Not part of the tree, walk its children instead */
+        struct moment_act_on_descendant act;
 
-    return act.number;
+        act.number = 0;
+        act.iter = iter;
+        act.data = data;
+        virDomainMomentForEachChild(moment,
+                                    virDomainMomentActOnDescendant, &act);
+
+        return act.number;
+    }
+
+    /* The descendants are the moments following @moment in pre-order up
+     * to its last one. Copy them, since iter can change the tree or
+     * delete moments. */
+    ndescendants = moment->last - moment->pre;
+    if (ndescendants == 0)
+        return 0;
+
+    descendants = g_new0(virDomainMomentObjPtr, ndescendants);
+    memcpy(descendants, moments->order + moment->pre + 1,
+           ndescendants * sizeof(*descendants));
+
+    for (i = 0; i < ndescendants; i++)
+        (iter)(descendants[i], descendants[i]->def->name, data);
+
+    return ndescendants;
 }
 
 
@@ -119,25 +237,22 @@ virDomainMomentForEachDescendant(virDomainMomentObjPtr moment,
 void
 virDomainMomentDropParent(virDomainMomentObjPtr moment)
 {
-    virDomainMomentObjPtr prev = NULL;
-    virDomainMomentObjPtr curr = NULL;
+    if (!moment->prev_sibling && moment->parent->first_child != moment) {
+        VIR_WARN("inconsistent moment relations");
+        return;
+    }
 
     moment->parent->nchildren--;
-    curr = moment->parent->first_child;
-    while (curr != moment) {
-        if (!curr) {
-            VIR_WARN("inconsistent moment relations");
-            return;
-        }
-        prev = curr;
-        curr = curr->sibling;
-    }
-    if (prev)
-        prev->sibling = moment->sibling;
+    if (moment->prev_sibling)
+        moment->prev_sibling->sibling = moment->sibling;
     else
         moment->parent->first_child = moment->sibling;
+    if (moment->sibling)
+        moment->sibling->prev_sibling = moment->prev_sibling;
     moment->parent = NULL;
     moment->sibling = NULL;
+    moment->prev_sibling = NULL;
+    moment->list->indexed = false;
 }
 
 
@@ -147,6 +262,7 @@ virDomainMomentDropChildren(virDomainMomentObjPtr moment)
 {
     moment->nchildren = 0;
     moment->first_child = NULL;
+    moment->list->indexed = false;
 }
 
 
@@ -157,8 +273,12 @@ virDomainMomentSetParent(virDomainMomentObjPtr moment,
 {
     moment->parent = parent;
     parent->nchildren++;
+    moment->prev_sibling = NULL;
     moment->sibling = parent->first_child;
+    if (parent->first_child)
+        parent->first_child->prev_sibling = moment;
     parent->first_child = moment;
+    moment->list->indexed = false;
 }
 
 
@@ -196,6 +316,8 @@ virDomainMomentMoveChildren(virDomainMomentObjPtr from,
         child->parent = to;
         if (!child->sibling) {
             child->sibling = to->first_child;
+            if (to->first_child)
+                to->first_child->prev_sibling = child;
             break;
         }
         child = child->sibling;
@@ -204,6 +326,7 @@ virDomainMomentMoveChildren(virDomainMomentObjPtr from,
     to->first_child = from->first_child;
     from->nchildren = 0;
     from->first_child = NULL;
+    to->list->indexed = false;
 }
 
 
@@ -256,6 +379,10 @@ virDomainMomentAssignDef(virDomainMomentObjListPtr moments,
         return NULL;
     }
     moment->def = def;
+    moment->list = moments;
+    moment->pre = VIR_DOMAIN_MOMENT_UNINDEXED;
+    moment->last = VIR_DOMAIN_MOMENT_UNINDEXED;
+    moments->indexed = false;
 
     return moment;
 }
@@ -282,6 +409,7 @@ virDomainMomentObjListNew(void)
         VIR_FREE(moments);
         return NULL;
     }
+    moments->metaroot.list = moments;
     return moments;
 }
 
@@ -291,6 +419,7 @@ virDomainMomentObjListFree(virDomainMomentObjListPtr moments)
     if (!moments)
         return;
     virHashFree(moments->objs);
+    g_free(moments->order);
     VIR_FREE(moments);
 }
 
@@ -455,6 +584,7 @@ virDomainMomentObjListRemove(virDomainMomentObjListPtr moments,
 {
     bool ret = moments->current == moment;
 
+    moments->indexed = false;
     virHashRemoveEntry(moments->objs, moment->def->name);
     if (ret)
         moments->current = NULL;
@@ -466,6 +596,7 @@ virDomainMomentObjListRemove(virDomainMomentObjListPtr moments,
 void
 virDomainMomentObjListRemoveAll(virDomainMomentObjListPtr moments)
 {
+    moments->indexed = false;
     virHashRemoveAll(moments->objs);
     virDomainMomentDropChildren(&moments->metaroot);
 }
@@ -498,7 +629,6 @@ virDomainMomentSetRelations(void *payload,
 {
     virDomainMomentObjPtr obj = payload;
     struct moment_set_relation *curr = data;
-    virDomainMomentObjPtr tmp;
     virDomainMomentObjPtr parent;
 
     parent = virDomainMomentFindByName(curr->moments, obj->def->parent_name);
@@ -509,23 +639,39 @@ virDomainMomentSetRelations(void *payload,
             VIR_WARN("moment %s lacks parent %s", obj->def->name,
                      obj->def->parent_name);
         }
-    } else {
-        tmp = parent;
-        while (tmp && tmp->def) {
-            if (tmp == obj) {
-                curr->err = -1;
-                parent = &curr->moments->metaroot;
-                VIR_WARN("moment %s in circular chain", obj->def->name);
-                break;
-            }
-            tmp = tmp->parent;
-        }
+    } else if (parent == obj) {
+        curr->err = -1;
+        parent = &curr->moments->metaroot;
+        VIR_WARN("moment %s in circular chain", obj->def->name);
     }
     virDomainMomentSetParent(obj, parent);
     return 0;
 }
 
 
+/* Moments in a circular parent chain are not reachable from the
+ * metaroot. Break each chain by making the first moment of it found a
+ * root, which makes all of the chain reachable again. */
+static int
+virDomainMomentBreakCycle(void *payload,
+                          const void *name G_GNUC_UNUSED,
+                          void *data)
+{
+    virDomainMomentObjPtr obj = payload;
+    struct moment_set_relation *curr = data;
+
+    virDomainMomentObjListIndex(curr->moments);
+    if (obj->pre != VIR_DOMAIN_MOMENT_UNINDEXED)
+        return 0;
+
+    curr->err = -1;
+    VIR_WARN("moment %s in circular chain", obj->def->name);
+    virDomainMomentDropParent(obj);
+    virDomainMomentSetParent(obj, &curr->moments->metaroot);
+    return 0;
+}
+
+
 /* Populate parent link and child count of all moments, with all
  * assigned defs having relations starting as 0/NULL. Return 0 on
  * success, -1 if a parent is missing or if a circular relationship
@@ -537,6 +683,11 @@ virDomainMomentUpdateRelations(virDomainMomentObjListPtr moments)
 
     virDomainMomentDropChildren(&moments->metaroot);
     virHashForEach(moments->objs, virDomainMomentSetRelations, &act);
+
+    virDomainMomentObjListIndex(moments);
+    if (moments->norder < virHashSize(moments->objs) + 1)
+        virHashForEach(moments->objs, virDomainMomentBreakCycle, &act);
+
     if (act.err)
         moments->current = NULL;
     return act.err;
@@ -553,6 +704,7 @@ virDomainMomentCheckCycles(virDomainMomentObjListPtr list,
                            const char *domname)
 {
     virDomainMomentObjPtr other;
+    virDomainMomentObjPtr moment;
 
     if (def->parent_name) {
         if (STREQ(def->name, def->parent_name)) {
@@ -568,19 +720,25 @@ virDomainMomentCheckCycles(virDomainMomentObjListPtr list,
                            def->parent_name, def->name);
             return -1;
         }
-        while (other->def->parent_name) {
-            if (STREQ(other->def->parent_name, def->name)) {
-                virReportError(VIR_ERR_INVALID_ARG,
-                               _("parent %s would create cycle to %s"),
-                               other->def->name, def->name);
-                return -1;
-            }
-            other = virDomainMomentFindByName(list, other->def->parent_name);
-            if (!other) {
-                VIR_WARN("moments are inconsistent for domain %s",
-                         domname);
-                break;
-            }
+
+        /* Only a redefinition of an existing moment can create a cycle,
+         * if the new parent is one of its descendants */
+        if (!(moment = virDomainMomentFindByName(list, def->name)))
+            return 0;
+
+        virDomainMomentObjListIndex(list);
+        if (other->pre == VIR_DOMAIN_MOMENT_UNINDEXED ||
+            moment->pre == VIR_DOMAIN_MOMENT_UNINDEXED) {
+            VIR_WARN("moments are inconsistent for domain %s",
+                     domname);
+            return 0;
+        }
+
+        if (virDomainMomentIsDescendant(other, moment)) {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("parent %s would create cycle to %s"),
+                           other->def->name, def->name);
+            return -1;
         }
     }
     return 0;
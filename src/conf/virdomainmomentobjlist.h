@@ -36,7 +36,10 @@ typedef bool (*virDomainMomentObjListFilter)(virDomainMomentObjPtr obj,
  * (for quick lookup by name) and a metaroot (which is the parent of
  * all user-visible roots), so that all other objects always have a
  * valid parent object; the tree structure is currently maintained via
- * a linked list. */
+ * a linked list. The list also indexes the tree by labelling every
+ * moment with its position in a pre-order walk of the tree and the
+ * position of its last descendant, so that ancestry can be checked and
+ * subtrees extracted without walking the tree. */
 struct _virDomainMomentObj {
     /* Public field */
     virDomainMomentDefPtr def; /* non-NULL except for metaroot */
@@ -46,8 +49,13 @@ struct _virDomainMomentObj {
                                      virDomainMomentUpdateRelations, or
                                      after virDomainMomentDropParent */
     virDomainMomentObjPtr sibling; /* NULL if last child of parent */
+    virDomainMomentObjPtr prev_sibling; /* NULL if first child of parent */
     size_t nchildren;
     virDomainMomentObjPtr first_child; /* NULL if no children */
+
+    virDomainMomentObjListPtr list; /* list the moment belongs to */
+    size_t pre; /* pre-order position, valid while the list is indexed */
+    size_t last; /* pre-order position of the last descendant */
 };
 
 int virDomainMomentForEachChild(virDomainMomentObjPtr moment,
@@ -56,6 +64,8 @@ int virDomainMomentForEachChild(virDomainMomentObjPtr moment,
 int virDomainMomentForEachDescendant(virDomainMomentObjPtr moment,
                                      virHashIterator iter,
                                      void *data);
+bool virDomainMomentIsDescendant(virDomainMomentObjPtr moment,
+                                 virDomainMomentObjPtr ancestor);
 void virDomainMomentDropParent(virDomainMomentObjPtr moment);
 void virDomainMomentDropChildren(virDomainMomentObjPtr moment);
 void virDomainMomentMoveChildren(virDomainMomentObjPtr from,
@@ -22,6 +22,10 @@
 
 #include <config.h>
 
+#ifdef HAVE_MALLOC_TRIM
+# include <malloc.h>
+#endif
+
 #include "internal.h"
 #include "datatypes.h"
 #include "virdomainobjlist.h"
@@ -29,6 +33,8 @@
 #include "snapshot_conf.h"
 #include "viralloc.h"
 #include "virfile.h"
+#include "virhostcpu.h"
+#include "virhashcode.h"
 #include "virlog.h"
 #include "virstring.h"
 #include "virdomainsnapshotobjlist.h"
@@ -41,17 +47,48 @@ VIR_LOG_INIT("conf.virdomainobjlist");
 static virClassPtr virDomainObjListClass;
 static void virDomainObjListDispose(void *obj);
 
+#define VIR_DOMAIN_OBJ_LIST_SHARDS 32
+
+/* Upper bound of threads parsing persistent configs on startup */
+#define VIR_DOMAIN_OBJ_LIST_LOAD_WORKERS 16
+
+typedef struct _virDomainObjListShard virDomainObjListShard;
+typedef virDomainObjListShard *virDomainObjListShardPtr;
+struct _virDomainObjListShard {
+    virRWLock lock;
+
+    /* uuid string -> virDomainObj and name -> virDomainObj
+     * mappings of those keys which hash into this shard. Unlike
+     * the main tables these don't hold a reference. */
+    virHashTable *objs;
+    virHashTable *objsName;
+};
 
 struct _virDomainObjList {
     virObjectRWLockable parent;
 
     /* uuid string -> virDomainObj  mapping
-     * for O(1), lockless lookup-by-uuid */
+     * for O(1) lookup-by-uuid */
     virHashTable *objs;
 
-    /* name -> virDomainObj mapping for O(1),
-     * lockless lookup-by-name */
+    /* name -> virDomainObj mapping for O(1)
+     * lookup-by-name */
     virHashTable *objsName;
+
+    /* The above mappings split by key, so that concurrent lookups
+     * by uuid or name take one of many shard locks rather than the
+     * list lock. Shards are only modified with the list lock held
+     * for writing, and their locks nest inside of it. */
+    virDomainObjListShard shards[VIR_DOMAIN_OBJ_LIST_SHARDS];
+    size_t nshards;
+
+    /* uuid string -> virDomainObj mappings, without references, of
+     * the domains in each state, kept up to date by
+     * virDomainObjSetState. They let listings filtered by state skip
+     * all other domains without locking them. Guarded by stateLock,
+     * which nests inside of both the list and domain object locks. */
+    virMutex stateLock;
+    virHashTable *objsState[VIR_DOMAIN_LAST];
 };
 
 
@@ -68,6 +105,7 @@ VIR_ONCE_GLOBAL_INIT(virDomainObjList);
 virDomainObjListPtr virDomainObjListNew(void)
 {
     virDomainObjListPtr doms;
+    size_t i;
 
     if (virDomainObjListInitialize() < 0)
         return NULL;
@@ -76,35 +114,220 @@ virDomainObjListPtr virDomainObjListNew(void)
         return NULL;
 
     if (!(doms->objs = virHashCreate(50, virObjectFreeHashData)) ||
-        !(doms->objsName = virHashCreate(50, virObjectFreeHashData))) {
-        virObjectUnref(doms);
-        return NULL;
+        !(doms->objsName = virHashCreate(50, virObjectFreeHashData)))
+        goto error;
+
+    if (virMutexInit(&doms->stateLock) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot initialize domain list state lock"));
+        goto error;
+    }
+
+    for (i = 0; i < VIR_DOMAIN_LAST; i++) {
+        if (!(doms->objsState[i] = virHashCreate(50, NULL)))
+            goto error;
+    }
+
+    for (; doms->nshards < VIR_DOMAIN_OBJ_LIST_SHARDS; doms->nshards++) {
+        virDomainObjListShardPtr shard = &doms->shards[doms->nshards];
+
+        if (virRWLockInit(&shard->lock) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot initialize domain list shard lock"));
+            goto error;
+        }
+
+        if (!(shard->objs = virHashCreate(8, NULL)) ||
+            !(shard->objsName = virHashCreate(8, NULL))) {
+            virHashFree(shard->objs);
+            virRWLockDestroy(&shard->lock);
+            goto error;
+        }
     }
 
     return doms;
+
+ error:
+    virObjectUnref(doms);
+    return NULL;
+}
+
+
+static int
+virDomainObjListUnsetList(void *payload,
+                          const void *name G_GNUC_UNUSED,
+                          void *opaque G_GNUC_UNUSED)
+{
+    virDomainObjPtr obj = payload;
+
+    virObjectLock(obj);
+    obj->list = NULL;
+    virObjectUnlock(obj);
+    return 0;
 }
 
 
 static void virDomainObjListDispose(void *obj)
 {
     virDomainObjListPtr doms = obj;
+    size_t i;
+
+    /* Domain objects may outlive the list */
+    if (doms->objs)
+        virHashForEach(doms->objs, virDomainObjListUnsetList, NULL);
+
+    for (i = 0; i < doms->nshards; i++) {
+        virRWLockDestroy(&doms->shards[i].lock);
+        virHashFree(doms->shards[i].objs);
+        virHashFree(doms->shards[i].objsName);
+    }
+
+    for (i = 0; i < VIR_DOMAIN_LAST; i++)
+        virHashFree(doms->objsState[i]);
+    virMutexDestroy(&doms->stateLock);
 
     virHashFree(doms->objs);
     virHashFree(doms->objsName);
 }
 
 
+static virDomainObjListShardPtr
+virDomainObjListGetShard(virDomainObjListPtr doms,
+                         const char *key)
+{
+    uint32_t code = virHashCodeGen(key, strlen(key), 0);
+
+    return &doms->shards[code % VIR_DOMAIN_OBJ_LIST_SHARDS];
+}
+
+
+/*
+ * Adds @vm under @key into the by-name or by-uuid mapping of the
+ * shard @key hashes into, or removes @key from it if @vm is NULL.
+ * The caller must hold the list lock for writing.
+ */
+static int
+virDomainObjListShardUpdate(virDomainObjListPtr doms,
+                            bool byName,
+                            const char *key,
+                            virDomainObjPtr vm)
+{
+    virDomainObjListShardPtr shard = virDomainObjListGetShard(doms, key);
+    virHashTablePtr table = byName ? shard->objsName : shard->objs;
+    int ret = 0;
+
+    virRWLockWrite(&shard->lock);
+    if (vm)
+        ret = virHashAddEntry(table, key, vm);
+    else
+        virHashRemoveEntry(table, key);
+    virRWLockUnlock(&shard->lock);
+
+    return ret;
+}
+
+
+/*
+ * Adds locked @vm to the mapping of domains in its current state,
+ * or removes it when @add is false, and links it to @doms
+ * accordingly. The caller must hold the list lock for writing.
+ */
+static int
+virDomainObjListStateIndex(virDomainObjListPtr doms,
+                           virDomainObjPtr vm,
+                           const char *uuidstr,
+                           bool add)
+{
+    virHashTablePtr table = doms->objsState[vm->state.state];
+    int ret = 0;
+
+    virMutexLock(&doms->stateLock);
+    if (add) {
+        if ((ret = virHashAddEntry(table, uuidstr, vm)) == 0)
+            vm->list = doms;
+    } else {
+        virHashRemoveEntry(table, uuidstr);
+        vm->list = NULL;
+    }
+    virMutexUnlock(&doms->stateLock);
+
+    return ret;
+}
+
+
+/**
+ * virDomainObjListUpdateState:
+ * @doms: the list @vm is in
+ * @vm: locked domain object whose state just changed
+ * @oldState: the state @vm was in before
+ *
+ * Moves @vm to the mapping of domains in its new state. This is
+ * called by virDomainObjSetState, so there's no need to call it
+ * directly.
+ */
+void
+virDomainObjListUpdateState(virDomainObjListPtr doms,
+                            virDomainObjPtr vm,
+                            virDomainState oldState)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    virUUIDFormat(vm->def->uuid, uuidstr);
+
+    virMutexLock(&doms->stateLock);
+    virHashRemoveEntry(doms->objsState[oldState], uuidstr);
+    ignore_value(virHashAddEntry(doms->objsState[vm->state.state],
+                                 uuidstr, vm));
+    virMutexUnlock(&doms->stateLock);
+}
+
+
+/*
+ * Looks @key up in the by-name or by-uuid mapping of its shard and
+ * returns the domain object with an extra reference, but unlocked.
+ * The list lock is not needed.
+ */
+static virDomainObjPtr
+virDomainObjListShardLookup(virDomainObjListPtr doms,
+                            bool byName,
+                            const char *key)
+{
+    virDomainObjListShardPtr shard = virDomainObjListGetShard(doms, key);
+    virDomainObjPtr obj;
+
+    virRWLockRead(&shard->lock);
+    obj = virHashLookup(byName ? shard->objsName : shard->objs, key);
+    if (obj)
+        virObjectRef(obj);
+    virRWLockUnlock(&shard->lock);
+
+    return obj;
+}
+
+
+struct virDomainObjListSearchIDData {
+    int id;
+    bool skipShutoff;
+};
+
+
 static int virDomainObjListSearchID(const void *payload,
                                     const void *name G_GNUC_UNUSED,
-                                    const void *data)
+                                    const void *opaque)
 {
     virDomainObjPtr obj = (virDomainObjPtr)payload;
-    const int *id = data;
+    const struct virDomainObjListSearchIDData *data = opaque;
     int want = 0;
 
+    /* Most domains of large hosts are usually shut off, don't lock
+     * them just to find out */
+    if (data->skipShutoff &&
+        virDomainObjGetStateLockless(obj, NULL) == VIR_DOMAIN_SHUTOFF)
+        return 0;
+
     virObjectLock(obj);
     if (virDomainObjIsActive(obj) &&
-        obj->def->id == *id)
+        obj->def->id == data->id)
         want = 1;
     virObjectUnlock(obj);
     return want;
@@ -115,10 +338,18 @@ virDomainObjPtr
 virDomainObjListFindByID(virDomainObjListPtr doms,
                          int id)
 {
+    struct virDomainObjListSearchIDData data = { id, true };
     virDomainObjPtr obj;
 
     virObjectRWLockRead(doms);
-    obj = virHashSearch(doms->objs, virDomainObjListSearchID, &id, NULL);
+    /* A domain gets its ID before leaving the shut off state while it
+     * is being started, look at all domains if no running one has it */
+    if (!(obj = virHashSearch(doms->objs, virDomainObjListSearchID,
+                              &data, NULL))) {
+        data.skipShutoff = false;
+        obj = virHashSearch(doms->objs, virDomainObjListSearchID,
+                            &data, NULL);
+    }
     virObjectRef(obj);
     virObjectRWUnlock(doms);
     if (obj) {
@@ -163,13 +394,18 @@ virDomainObjPtr
 virDomainObjListFindByUUID(virDomainObjListPtr doms,
                            const unsigned char *uuid)
 {
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
     virDomainObjPtr obj;
 
-    virObjectRWLockRead(doms);
-    obj = virDomainObjListFindByUUIDLocked(doms, uuid);
-    virObjectRWUnlock(doms);
+    virUUIDFormat(uuid, uuidstr);
+
+    /* The shard lock is dropped before locking @obj, since writers
+     * hold domain object locks while updating the shards */
+    if (!(obj = virDomainObjListShardLookup(doms, false, uuidstr)))
+        return NULL;
 
-    if (obj && obj->removing) {
+    virObjectLock(obj);
+    if (obj->removing) {
         virObjectUnlock(obj);
         virObjectUnref(obj);
         obj = NULL;
@@ -208,11 +444,11 @@ virDomainObjListFindByName(virDomainObjListPtr doms,
 {
     virDomainObjPtr obj;
 
-    virObjectRWLockRead(doms);
-    obj = virDomainObjListFindByNameLocked(doms, name);
-    virObjectRWUnlock(doms);
+    if (!(obj = virDomainObjListShardLookup(doms, true, name)))
+        return NULL;
 
-    if (obj && obj->removing) {
+    virObjectLock(obj);
+    if (obj->removing) {
         virObjectUnlock(obj);
         virObjectUnref(obj);
         obj = NULL;
@@ -233,7 +469,8 @@ virDomainObjListFindByName(virDomainObjListPtr doms,
  * reference count since upon removal in virHashRemoveEntry
  * the virObjectUnref will be called since the hash tables were
  * configured to call virObjectFreeHashData when the object is
- * removed from the hash table.
+ * removed from the hash table. The shards, which don't hold
+ * references, are updated last.
  *
  * Returns 0 on success with 3 references and locked
  *        -1 on failure with 1 reference and locked
@@ -255,6 +492,13 @@ virDomainObjListAddObjLocked(virDomainObjListPtr doms,
     }
     virObjectRef(vm);
 
+    if (virDomainObjListShardUpdate(doms, false, uuidstr, vm) < 0 ||
+        virDomainObjListShardUpdate(doms, true, vm->def->name, vm) < 0 ||
+        virDomainObjListStateIndex(doms, vm, uuidstr, true) < 0) {
+        virDomainObjListRemoveLocked(doms, vm);
+        return -1;
+    }
+
     return 0;
 }
 
@@ -380,6 +624,10 @@ virDomainObjListRemoveLocked(virDomainObjListPtr doms,
 
     virUUIDFormat(dom->def->uuid, uuidstr);
 
+    virDomainObjListShardUpdate(doms, false, uuidstr, NULL);
+    virDomainObjListShardUpdate(doms, true, dom->def->name, NULL);
+    virDomainObjListStateIndex(doms, dom, uuidstr, false);
+
     virHashRemoveEntry(doms->objs, uuidstr);
     virHashRemoveEntry(doms->objsName, dom->def->name);
 }
@@ -468,7 +716,13 @@ virDomainObjListRename(virDomainObjListPtr doms,
      * table as set up during virDomainObjListNew. */
     virObjectRef(dom);
 
+    if (virDomainObjListShardUpdate(doms, true, new_name, dom) < 0) {
+        virHashRemoveEntry(doms->objsName, new_name);
+        goto cleanup;
+    }
+
     rc = callback(dom, new_name, flags, opaque);
+    virDomainObjListShardUpdate(doms, true, rc < 0 ? new_name : old_name, NULL);
     virHashRemoveEntry(doms->objsName, rc < 0 ? new_name : old_name);
     if (rc < 0)
         goto cleanup;
@@ -481,37 +735,48 @@ virDomainObjListRename(virDomainObjListPtr doms,
 }
 
 
-static virDomainObjPtr
-virDomainObjListLoadConfig(virDomainObjListPtr doms,
-                           virDomainXMLOptionPtr xmlopt,
-                           const char *configDir,
-                           const char *autostartDir,
-                           const char *name,
-                           virDomainLoadConfigNotify notify,
-                           void *opaque)
+static virDomainDefPtr
+virDomainObjListParseConfig(virDomainXMLOptionPtr xmlopt,
+                            const char *configDir,
+                            const char *autostartDir,
+                            const char *name,
+                            int *autostart)
 {
-    char *configFile = NULL, *autostartLink = NULL;
-    virDomainDefPtr def = NULL;
-    virDomainObjPtr dom;
-    int autostart;
-    virDomainDefPtr oldDef = NULL;
+    g_autofree char *configFile = NULL;
+    g_autofree char *autostartLink = NULL;
+    g_autoptr(virDomainDef) def = NULL;
 
     if ((configFile = virDomainConfigFile(configDir, name)) == NULL)
-        goto error;
+        return NULL;
     if (!(def = virDomainDefParseFile(configFile, xmlopt, NULL,
                                       VIR_DOMAIN_DEF_PARSE_INACTIVE |
                                       VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
                                       VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
-        goto error;
+        return NULL;
 
     if ((autostartLink = virDomainConfigFile(autostartDir, name)) == NULL)
-        goto error;
+        return NULL;
 
-    if ((autostart = virFileLinkPointsTo(autostartLink, configFile)) < 0)
-        goto error;
+    if ((*autostart = virFileLinkPointsTo(autostartLink, configFile)) < 0)
+        return NULL;
+
+    return g_steal_pointer(&def);
+}
+
+
+static virDomainObjPtr
+virDomainObjListAddConfig(virDomainObjListPtr doms,
+                          virDomainXMLOptionPtr xmlopt,
+                          virDomainDefPtr def,
+                          int autostart,
+                          virDomainLoadConfigNotify notify,
+                          void *opaque)
+{
+    virDomainObjPtr dom;
+    virDomainDefPtr oldDef = NULL;
 
     if (!(dom = virDomainObjListAddLocked(doms, def, xmlopt, 0, &oldDef)))
-        goto error;
+        return NULL;
 
     dom->autostart = autostart;
 
@@ -519,15 +784,164 @@ virDomainObjListLoadConfig(virDomainObjListPtr doms,
         (*notify)(dom, oldDef == NULL, opaque);
 
     virDomainDefFree(oldDef);
-    VIR_FREE(configFile);
-    VIR_FREE(autostartLink);
     return dom;
+}
 
- error:
-    VIR_FREE(configFile);
-    VIR_FREE(autostartLink);
-    virDomainDefFree(def);
-    return NULL;
+
+typedef struct _virDomainObjListLoadJob virDomainObjListLoadJob;
+typedef virDomainObjListLoadJob *virDomainObjListLoadJobPtr;
+struct _virDomainObjListLoadJob {
+    char *name;
+    virDomainDefPtr def;
+    int autostart;
+};
+
+typedef struct _virDomainObjListLoadData virDomainObjListLoadData;
+typedef virDomainObjListLoadData *virDomainObjListLoadDataPtr;
+struct _virDomainObjListLoadData {
+    virDomainXMLOptionPtr xmlopt;
+    const char *configDir;
+    const char *autostartDir;
+
+    virDomainObjListLoadJobPtr jobs;
+    size_t njobs;
+    int next; /* index of the next job to pick, updated atomically */
+};
+
+
+static void
+virDomainObjListLoadWorker(void *opaque)
+{
+    virDomainObjListLoadDataPtr data = opaque;
+    int i;
+
+    while ((i = g_atomic_int_add(&data->next, 1)) < (int) data->njobs) {
+        virDomainObjListLoadJobPtr job = &data->jobs[i];
+
+        VIR_INFO("Loading config file '%s.xml'", job->name);
+        job->def = virDomainObjListParseConfig(data->xmlopt,
+                                               data->configDir,
+                                               data->autostartDir,
+                                               job->name,
+                                               &job->autostart);
+    }
+}
+
+
+/*
+ * Parsing the configs doesn't touch the list, so it is spread across
+ * a few threads. The parsed definitions are then added to the list in
+ * the order the files were read, as if they were loaded one by one,
+ * so callers see the same notifications as before.
+ */
+static int
+virDomainObjListLoadAllConfigsParallel(virDomainObjListPtr doms,
+                                       DIR *dir,
+                                       const char *configDir,
+                                       const char *autostartDir,
+                                       virDomainXMLOptionPtr xmlopt,
+                                       virDomainLoadConfigNotify notify,
+                                       void *opaque)
+{
+    virDomainObjListLoadData data = {
+        .xmlopt = xmlopt,
+        .configDir = configDir,
+        .autostartDir = autostartDir,
+    };
+    g_autofree virThread *threads = NULL;
+    size_t nthreads = 0;
+    struct dirent *entry;
+    int ncpus;
+    size_t nworkers;
+    size_t i;
+    int ret;
+
+    while ((ret = virDirRead(dir, &entry, configDir)) > 0) {
+        virDomainObjListLoadJob job = { 0 };
+
+        if (!virStringStripSuffix(entry->d_name, ".xml"))
+            continue;
+
+        job.name = g_strdup(entry->d_name);
+        if (VIR_APPEND_ELEMENT(data.jobs, data.njobs, job) < 0) {
+            VIR_FREE(job.name);
+            ret = -1;
+            break;
+        }
+    }
+
+    if (ret < 0)
+        goto cleanup;
+
+    if ((ncpus = virHostCPUGetCount()) <= 0) {
+        virResetLastError();
+        ncpus = 1;
+    }
+
+    nworkers = MIN(MIN(ncpus, VIR_DOMAIN_OBJ_LIST_LOAD_WORKERS), data.njobs);
+
+    /* The calling thread is one of the workers */
+    if (nworkers > 1) {
+        threads = g_new0(virThread, nworkers - 1);
+        for (i = 0; i < nworkers - 1; i++) {
+            if (virThreadCreateFull(&threads[nthreads], true,
+                                    virDomainObjListLoadWorker,
+                                    "dom-load", false, &data) < 0) {
+                /* Not fatal; whoever runs picks up the remaining jobs */
+                VIR_WARN("Unable to create domain config loader thread");
+                break;
+            }
+            nthreads++;
+        }
+    }
+
+    virDomainObjListLoadWorker(&data);
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+#ifdef HAVE_MALLOC_TRIM
+    /* Parsing leaves behind lots of freed libxml2 memory, spread over
+     * the malloc arenas of the threads which are now gone. Nothing
+     * would reuse it soon, so hand it back to the system rather than
+     * keeping it in the daemon's RSS. */
+    if (nthreads > 0)
+        malloc_trim(0);
+#endif
+
+    virObjectRWLockWrite(doms);
+
+    for (i = 0; i < data.njobs; i++) {
+        virDomainObjListLoadJobPtr job = &data.jobs[i];
+        virDomainObjPtr dom = NULL;
+
+        /* NB: ignoring errors, so one malformed config doesn't
+           kill the whole process */
+        if (job->def &&
+            !(dom = virDomainObjListAddConfig(doms, xmlopt, job->def,
+                                              job->autostart,
+                                              notify, opaque))) {
+            virDomainDefFree(job->def);
+        }
+        job->def = NULL;
+
+        if (dom) {
+            dom->persistent = 1;
+            virDomainObjEndAPI(&dom);
+        } else {
+            VIR_ERROR(_("Failed to load config for domain '%s'"), job->name);
+        }
+    }
+
+    virObjectRWUnlock(doms);
+
+ cleanup:
+    for (i = 0; i < data.njobs; i++) {
+        virDomainDefFree(data.jobs[i].def);
+        VIR_FREE(data.jobs[i].name);
+    }
+    VIR_FREE(data.jobs);
+    return ret;
 }
 
 
@@ -598,6 +1012,16 @@ virDomainObjListLoadAllConfigs(virDomainObjListPtr doms,
     if ((rc = virDirOpenIfExists(&dir, configDir)) <= 0)
         return rc;
 
+    if (!liveStatus) {
+        ret = virDomainObjListLoadAllConfigsParallel(doms, dir,
+                                                     configDir,
+                                                     autostartDir,
+                                                     xmlopt,
+                                                     notify, opaque);
+        VIR_DIR_CLOSE(dir);
+        return ret;
+    }
+
     virObjectRWLockWrite(doms);
 
     while ((ret = virDirRead(dir, &entry, configDir)) > 0) {
@@ -609,24 +1033,13 @@ virDomainObjListLoadAllConfigs(virDomainObjListPtr doms,
         /* NB: ignoring errors, so one malformed config doesn't
            kill the whole process */
         VIR_INFO("Loading config file '%s.xml'", entry->d_name);
-        if (liveStatus)
-            dom = virDomainObjListLoadStatus(doms,
-                                             configDir,
-                                             entry->d_name,
-                                             xmlopt,
-                                             notify,
-                                             opaque);
-        else
-            dom = virDomainObjListLoadConfig(doms,
-                                             xmlopt,
-                                             configDir,
-                                             autostartDir,
-                                             entry->d_name,
-                                             notify,
-                                             opaque);
+        dom = virDomainObjListLoadStatus(doms,
+                                         configDir,
+                                         entry->d_name,
+                                         xmlopt,
+                                         notify,
+                                         opaque);
         if (dom) {
-            if (!liveStatus)
-                dom->persistent = 1;
             virDomainObjEndAPI(&dom);
         } else {
             VIR_ERROR(_("Failed to load config for domain '%s'"), entry->d_name);
@@ -914,6 +1327,41 @@ virDomainObjMatchFilter(virDomainObjPtr vm,
 
     return true;
 }
+
+
+/*
+ * Returns the states domains matching @filter can be in, as a bitmap
+ * of (1 << state). Domains in other states need not be looked at.
+ */
+static unsigned int
+virDomainObjListFilterStates(unsigned int filter)
+{
+    unsigned int all = (1 << VIR_DOMAIN_LAST) - 1;
+    unsigned int states = all;
+
+    if (MATCH(VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE)) {
+        states = 0;
+        if (MATCH(VIR_CONNECT_LIST_DOMAINS_RUNNING))
+            states |= 1 << VIR_DOMAIN_RUNNING;
+        if (MATCH(VIR_CONNECT_LIST_DOMAINS_PAUSED))
+            states |= 1 << VIR_DOMAIN_PAUSED;
+        if (MATCH(VIR_CONNECT_LIST_DOMAINS_SHUTOFF))
+            states |= 1 << VIR_DOMAIN_SHUTOFF;
+        if (MATCH(VIR_CONNECT_LIST_DOMAINS_OTHER))
+            states |= all & ~((1 << VIR_DOMAIN_RUNNING) |
+                              (1 << VIR_DOMAIN_PAUSED) |
+                              (1 << VIR_DOMAIN_SHUTOFF));
+    }
+
+    /* Drivers move domains out of the shut off state when starting
+     * them and back into it when they stop, so active ones are never
+     * shut off. The filter is still applied to every candidate. */
+    if (MATCH(VIR_CONNECT_LIST_DOMAINS_ACTIVE) &&
+        !MATCH(VIR_CONNECT_LIST_DOMAINS_INACTIVE))
+        states &= ~(1 << VIR_DOMAIN_SHUTOFF);
+
+    return states;
+}
 #undef MATCH
 
 
@@ -939,10 +1387,22 @@ static void
 virDomainObjListFilter(virDomainObjPtr **list,
                        size_t *nvms,
                        virConnectPtr conn,
-                       virDomainObjListACLFilter filter,
+                       virDomainObjListACLListFilter filter,
                        unsigned int flags)
 {
+    g_autofree virDomainDef *stubs = NULL;
+    g_autofree virDomainDefPtr *defs = NULL;
+    g_autoptr(virBitmap) allowed = NULL;
     size_t i = 0;
+    size_t j;
+
+    /* The ACL drivers only look at the identity of domains, so the
+     * connection is checked against stubs holding it. This lets all the
+     * domains be checked at once without keeping them locked. */
+    if (filter && *nvms > 0) {
+        stubs = g_new0(virDomainDef, *nvms);
+        defs = g_new0(virDomainDefPtr, *nvms);
+    }
 
     while (i < *nvms) {
         virDomainObjPtr vm = (*list)[i];
@@ -951,11 +1411,9 @@ virDomainObjListFilter(virDomainObjPtr **list,
 
         /* do not list the object if:
          * 1) it's being removed.
-         * 2) connection does not have ACL to see it
-         * 3) it doesn't match the filter
+         * 2) it doesn't match the filter
          */
         if (vm->removing ||
-            (filter && !filter(conn, vm->def)) ||
             !virDomainObjMatchFilter(vm, flags)) {
             virObjectUnlock(vm);
             virObjectUnref(vm);
@@ -963,9 +1421,36 @@ virDomainObjListFilter(virDomainObjPtr **list,
             continue;
         }
 
+        if (filter) {
+            stubs[i].id = vm->def->id;
+            stubs[i].name = g_strdup(vm->def->name);
+            memcpy(stubs[i].uuid, vm->def->uuid, VIR_UUID_BUFLEN);
+            defs[i] = &stubs[i];
+        }
+
         virObjectUnlock(vm);
         i++;
     }
+
+    if (!filter || *nvms == 0)
+        return;
+
+    /* do not list the objects the connection does not have ACL to see */
+    if (!(allowed = virBitmapNew(*nvms)) ||
+        filter(conn, defs, *nvms, allowed) < 0) {
+        virBitmapFree(allowed);
+        allowed = NULL;
+    }
+
+    for (i = 0, j = 0; i < *nvms; i++) {
+        g_free(stubs[i].name);
+
+        if (allowed && virBitmapIsBitSet(allowed, i))
+            (*list)[j++] = (*list)[i];
+        else
+            virObjectUnref((*list)[i]);
+    }
+    *nvms = j;
 }
 
 
@@ -974,21 +1459,47 @@ virDomainObjListCollect(virDomainObjListPtr domlist,
                         virConnectPtr conn,
                         virDomainObjPtr **vms,
                         size_t *nvms,
-                        virDomainObjListACLFilter filter,
+                        virDomainObjListACLListFilter filter,
                         unsigned int flags)
 {
     struct virDomainListData data = { NULL, 0 };
+    unsigned int states = virDomainObjListFilterStates(flags);
+    size_t count = 0;
+    size_t i;
 
-    virObjectRWLockRead(domlist);
-    sa_assert(domlist->objs);
-    if (VIR_ALLOC_N(data.vms, virHashSize(domlist->objs)) < 0) {
+    if (states != (1 << VIR_DOMAIN_LAST) - 1) {
+        /* Only collect the domains in the states the filter accepts.
+         * Domain objects must not be locked with stateLock held, so
+         * they're just referenced here and filtered below. */
+        virMutexLock(&domlist->stateLock);
+        for (i = 0; i < VIR_DOMAIN_LAST; i++) {
+            if (states & (1 << i))
+                count += virHashSize(domlist->objsState[i]);
+        }
+
+        if (VIR_ALLOC_N(data.vms, count) < 0) {
+            virMutexUnlock(&domlist->stateLock);
+            return -1;
+        }
+
+        for (i = 0; i < VIR_DOMAIN_LAST; i++) {
+            if (states & (1 << i))
+                virHashForEach(domlist->objsState[i],
+                               virDomainObjListCollectIterator, &data);
+        }
+        virMutexUnlock(&domlist->stateLock);
+    } else {
+        virObjectRWLockRead(domlist);
+        sa_assert(domlist->objs);
+        if (VIR_ALLOC_N(data.vms, virHashSize(domlist->objs)) < 0) {
+            virObjectRWUnlock(domlist);
+            return -1;
+        }
+
+        virHashForEach(domlist->objs, virDomainObjListCollectIterator, &data);
         virObjectRWUnlock(domlist);
-        return -1;
     }
 
-    virHashForEach(domlist->objs, virDomainObjListCollectIterator, &data);
-    virObjectRWUnlock(domlist);
-
     virDomainObjListFilter(&data.vms, &data.nvms, conn, filter, flags);
 
     *nvms = data.nvms;
@@ -1005,7 +1516,7 @@ virDomainObjListConvert(virDomainObjListPtr domlist,
                         size_t ndoms,
                         virDomainObjPtr **vms,
                         size_t *nvms,
-                        virDomainObjListACLFilter filter,
+                        virDomainObjListACLListFilter filter,
                         unsigned int flags,
                         bool skip_missing)
 {
@@ -1061,7 +1572,7 @@ int
 virDomainObjListExport(virDomainObjListPtr domlist,
                        virConnectPtr conn,
                        virDomainPtr **domains,
-                       virDomainObjListACLFilter filter,
+                       virDomainObjListACLListFilter filter,
                        unsigned int flags)
 {
     virDomainObjPtr *vms = NULL;
@@ -24,9 +24,6 @@
 
 #include "domain_conf.h"
 
-typedef struct _virDomainObjList virDomainObjList;
-typedef virDomainObjList *virDomainObjListPtr;
-
 virDomainObjListPtr virDomainObjListNew(void);
 
 virDomainObjPtr virDomainObjListFindByID(virDomainObjListPtr doms,
@@ -61,6 +58,9 @@ void virDomainObjListRemove(virDomainObjListPtr doms,
                             virDomainObjPtr dom);
 void virDomainObjListRemoveLocked(virDomainObjListPtr doms,
                                   virDomainObjPtr dom);
+void virDomainObjListUpdateState(virDomainObjListPtr doms,
+                                 virDomainObjPtr vm,
+                                 virDomainState oldState);
 
 int virDomainObjListLoadAllConfigs(virDomainObjListPtr doms,
                                    const char *configDir,
@@ -137,12 +137,12 @@ int virDomainObjListCollect(virDomainObjListPtr doms,
                             virConnectPtr conn,
                             virDomainObjPtr **vms,
                             size_t *nvms,
-                            virDomainObjListACLFilter filter,
+                            virDomainObjListACLListFilter filter,
                             unsigned int flags);
 int virDomainObjListExport(virDomainObjListPtr doms,
                            virConnectPtr conn,
                            virDomainPtr **domains,
-                           virDomainObjListACLFilter filter,
+                           virDomainObjListACLListFilter filter,
                            unsigned int flags);
 int virDomainObjListConvert(virDomainObjListPtr domlist,
                             virConnectPtr conn,
@@ -150,6 +150,6 @@ int virDomainObjListConvert(virDomainObjListPtr domlist,
                             size_t ndoms,
                             virDomainObjPtr **vms,
                             size_t *nvms,
-                            virDomainObjListACLFilter filter,
+                            virDomainObjListACLListFilter filter,
                             unsigned int flags,
                             bool skip_missing);
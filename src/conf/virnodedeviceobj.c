@@ -48,6 +48,14 @@ struct _virNodeDeviceObjList {
      * for O(1), lockless lookup-by-name */
     virHashTable *objs;
 
+    /* Secondary indexes not holding references, updated together
+     * with @objs: sysfs path -> virNodeDeviceObj, and for each type
+     * of capability in a definition, name -> virNodeDeviceObj of the
+     * devices having it. Capabilities derived from flags of others
+     * (e.g. fc_host and vports of a scsi_host) are not indexed, as
+     * the flags change without the definition being replaced. */
+    virHashTable *sysfsPaths;
+    virHashTable *caps[VIR_NODE_DEV_CAP_LAST];
 };
 
 
@@ -178,15 +186,65 @@ virNodeDeviceFindVPORTCapDef(const virNodeDeviceObj *obj)
 }
 
 
+/* Must be called with @devs locked for writing */
+static int
+virNodeDeviceObjListIndexAdd(virNodeDeviceObjListPtr devs,
+                             virNodeDeviceObjPtr obj)
+{
+    virNodeDevCapsDefPtr cap;
+
+    if (obj->def->sysfs_path &&
+        !virHashLookup(devs->sysfsPaths, obj->def->sysfs_path) &&
+        virHashAddEntry(devs->sysfsPaths, obj->def->sysfs_path, obj) < 0)
+        return -1;
+
+    for (cap = obj->def->caps; cap; cap = cap->next) {
+        virNodeDevCapType type = cap->data.type;
+
+        if (!devs->caps[type] &&
+            !(devs->caps[type] = virHashNew(NULL)))
+            return -1;
+
+        if (virHashUpdateEntry(devs->caps[type], obj->def->name, obj) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+/* Must be called with @devs locked for writing */
+static void
+virNodeDeviceObjListIndexRemove(virNodeDeviceObjListPtr devs,
+                                virNodeDeviceObjPtr obj)
+{
+    virNodeDevCapsDefPtr cap;
+
+    if (obj->def->sysfs_path &&
+        virHashLookup(devs->sysfsPaths, obj->def->sysfs_path) == obj)
+        virHashRemoveEntry(devs->sysfsPaths, obj->def->sysfs_path);
+
+    for (cap = obj->def->caps; cap; cap = cap->next) {
+        virNodeDevCapType type = cap->data.type;
+
+        if (devs->caps[type] &&
+            virHashLookup(devs->caps[type], obj->def->name) == obj)
+            virHashRemoveEntry(devs->caps[type], obj->def->name);
+    }
+}
+
+
 static virNodeDeviceObjPtr
-virNodeDeviceObjListSearch(virNodeDeviceObjListPtr devs,
-                           virHashSearcher callback,
-                           const void *data)
+virNodeDeviceObjListSearchTable(virNodeDeviceObjListPtr devs,
+                                virHashTablePtr *table,
+                                virHashSearcher callback,
+                                const void *data)
 {
-    virNodeDeviceObjPtr obj;
+    virNodeDeviceObjPtr obj = NULL;
 
     virObjectRWLockRead(devs);
-    obj = virHashSearch(devs->objs, callback, data, NULL);
+    if (*table)
+        obj = virHashSearch(*table, callback, data, NULL);
     virObjectRef(obj);
     virObjectRWUnlock(devs);
 
@@ -197,21 +255,25 @@ virNodeDeviceObjListSearch(virNodeDeviceObjListPtr devs,
 }
 
 
-static int
-virNodeDeviceObjListFindBySysfsPathCallback(const void *payload,
-                                            const void *name G_GNUC_UNUSED,
-                                            const void *opaque)
+static virNodeDeviceObjPtr
+virNodeDeviceObjListSearch(virNodeDeviceObjListPtr devs,
+                           virHashSearcher callback,
+                           const void *data)
 {
-    virNodeDeviceObjPtr obj = (virNodeDeviceObjPtr) payload;
-    const char *sysfs_path = opaque;
-    int want = 0;
+    return virNodeDeviceObjListSearchTable(devs, &devs->objs, callback, data);
+}
 
-    virObjectLock(obj);
-    if (obj->def->sysfs_path &&
-        STREQ_NULLABLE(obj->def->sysfs_path, sysfs_path))
-        want = 1;
-    virObjectUnlock(obj);
-    return want;
+
+/* Searches only the devices which have a capability of type @type in
+ * their definition */
+static virNodeDeviceObjPtr
+virNodeDeviceObjListSearchCap(virNodeDeviceObjListPtr devs,
+                              virNodeDevCapType type,
+                              virHashSearcher callback,
+                              const void *data)
+{
+    return virNodeDeviceObjListSearchTable(devs, &devs->caps[type],
+                                           callback, data);
 }
 
 
@@ -219,9 +281,18 @@ virNodeDeviceObjPtr
 virNodeDeviceObjListFindBySysfsPath(virNodeDeviceObjListPtr devs,
                                     const char *sysfs_path)
 {
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindBySysfsPathCallback,
-                                      sysfs_path);
+    virNodeDeviceObjPtr obj;
+
+    if (!sysfs_path)
+        return NULL;
+
+    virObjectRWLockRead(devs);
+    obj = virObjectRef(virHashLookup(devs->sysfsPaths, sysfs_path));
+    virObjectRWUnlock(devs);
+    if (obj)
+        virObjectLock(obj);
+
+    return obj;
 }
 
 
@@ -284,9 +355,9 @@ virNodeDeviceObjListFindByWWNs(virNodeDeviceObjListPtr devs,
     struct virNodeDeviceObjListFindByWWNsData data = {
         .parent_wwnn = parent_wwnn, .parent_wwpn = parent_wwpn };
 
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindByWWNsCallback,
-                                      &data);
+    return virNodeDeviceObjListSearchCap(devs, VIR_NODE_DEV_CAP_SCSI_HOST,
+                                         virNodeDeviceObjListFindByWWNsCallback,
+                                         &data);
 }
 
 
@@ -314,9 +385,9 @@ static virNodeDeviceObjPtr
 virNodeDeviceObjListFindByFabricWWN(virNodeDeviceObjListPtr devs,
                                     const char *parent_fabric_wwn)
 {
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindByFabricWWNCallback,
-                                      parent_fabric_wwn);
+    return virNodeDeviceObjListSearchCap(devs, VIR_NODE_DEV_CAP_SCSI_HOST,
+                                         virNodeDeviceObjListFindByFabricWWNCallback,
+                                         parent_fabric_wwn);
 }
 
 
@@ -341,9 +412,40 @@ static virNodeDeviceObjPtr
 virNodeDeviceObjListFindByCap(virNodeDeviceObjListPtr devs,
                               const char *cap)
 {
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindByCapCallback,
-                                      cap);
+    int type = virNodeDevCapTypeFromString(cap);
+
+    /* Derived capabilities can only be found on devices having the
+     * capability they are derived from */
+    switch ((virNodeDevCapType) type) {
+    case VIR_NODE_DEV_CAP_FC_HOST:
+    case VIR_NODE_DEV_CAP_VPORTS:
+        type = VIR_NODE_DEV_CAP_SCSI_HOST;
+        break;
+    case VIR_NODE_DEV_CAP_MDEV_TYPES:
+        type = VIR_NODE_DEV_CAP_PCI_DEV;
+        break;
+    case VIR_NODE_DEV_CAP_SYSTEM:
+    case VIR_NODE_DEV_CAP_PCI_DEV:
+    case VIR_NODE_DEV_CAP_USB_DEV:
+    case VIR_NODE_DEV_CAP_USB_INTERFACE:
+    case VIR_NODE_DEV_CAP_NET:
+    case VIR_NODE_DEV_CAP_SCSI_HOST:
+    case VIR_NODE_DEV_CAP_SCSI_TARGET:
+    case VIR_NODE_DEV_CAP_SCSI:
+    case VIR_NODE_DEV_CAP_STORAGE:
+    case VIR_NODE_DEV_CAP_SCSI_GENERIC:
+    case VIR_NODE_DEV_CAP_DRM:
+    case VIR_NODE_DEV_CAP_MDEV:
+    case VIR_NODE_DEV_CAP_CCW_DEV:
+        break;
+    case VIR_NODE_DEV_CAP_LAST:
+    default:
+        return NULL;
+    }
+
+    return virNodeDeviceObjListSearchCap(devs, type,
+                                         virNodeDeviceObjListFindByCapCallback,
+                                         cap);
 }
 
 
@@ -394,9 +496,9 @@ virNodeDeviceObjListFindSCSIHostByWWNs(virNodeDeviceObjListPtr devs,
     struct virNodeDeviceObjListFindSCSIHostByWWNsData data = {
         .wwnn = wwnn, .wwpn = wwpn };
 
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindSCSIHostByWWNsCallback,
-                                      &data);
+    return virNodeDeviceObjListSearchCap(devs, VIR_NODE_DEV_CAP_SCSI_HOST,
+                                         virNodeDeviceObjListFindSCSIHostByWWNsCallback,
+                                         &data);
 }
 
 static int
@@ -429,16 +531,20 @@ virNodeDeviceObjPtr
 virNodeDeviceObjListFindMediatedDeviceByUUID(virNodeDeviceObjListPtr devs,
                                              const char *uuid)
 {
-    return virNodeDeviceObjListSearch(devs,
-                                      virNodeDeviceObjListFindMediatedDeviceByUUIDCallback,
-                                      uuid);
+    return virNodeDeviceObjListSearchCap(devs, VIR_NODE_DEV_CAP_MDEV,
+                                         virNodeDeviceObjListFindMediatedDeviceByUUIDCallback,
+                                         uuid);
 }
 
 static void
 virNodeDeviceObjListDispose(void *obj)
 {
     virNodeDeviceObjListPtr devs = obj;
+    size_t i;
 
+    for (i = 0; i < VIR_NODE_DEV_CAP_LAST; i++)
+        virHashFree(devs->caps[i]);
+    virHashFree(devs->sysfsPaths);
     virHashFree(devs->objs);
 }
 
@@ -454,7 +560,8 @@ virNodeDeviceObjListNew(void)
     if (!(devs = virObjectRWLockableNew(virNodeDeviceObjListClass)))
         return NULL;
 
-    if (!(devs->objs = virHashCreate(50, virObjectFreeHashData))) {
+    if (!(devs->objs = virHashCreate(50, virObjectFreeHashData)) ||
+        !(devs->sysfsPaths = virHashNew(NULL))) {
         virObjectUnref(devs);
         return NULL;
     }
@@ -480,6 +587,7 @@ virNodeDeviceObjListAssignDef(virNodeDeviceObjListPtr devs,
 
     if ((obj = virNodeDeviceObjListFindByNameLocked(devs, def->name))) {
         virObjectLock(obj);
+        virNodeDeviceObjListIndexRemove(devs, obj);
         virNodeDeviceDefFree(obj->def);
         obj->def = def;
     } else {
@@ -495,6 +603,14 @@ virNodeDeviceObjListAssignDef(virNodeDeviceObjListPtr devs,
         virObjectRef(obj);
     }
 
+    if (virNodeDeviceObjListIndexAdd(devs, obj) < 0) {
+        /* the caller frees @def on failure */
+        virNodeDeviceObjListIndexRemove(devs, obj);
+        obj->def = NULL;
+        virHashRemoveEntry(devs->objs, def->name);
+        virNodeDeviceObjEndAPI(&obj);
+    }
+
  cleanup:
     virObjectRWUnlock(devs);
     return obj;
@@ -515,6 +631,7 @@ virNodeDeviceObjListRemove(virNodeDeviceObjListPtr devs,
     virObjectUnlock(obj);
     virObjectRWLockWrite(devs);
     virObjectLock(obj);
+    virNodeDeviceObjListIndexRemove(devs, obj);
     virHashRemoveEntry(devs->objs, def->name);
     virObjectUnlock(obj);
     virObjectUnref(obj);
@@ -48,6 +48,10 @@ struct _virNodeDeviceDriverState {
     void *privateData;                  /* driver-specific private data */
     bool privileged;                    /* whether we run in privileged mode */
 
+    /* Fills in details of a definition which the driver only looks up
+     * when the definition is formatted, may be NULL */
+    int (*fillDetails)(virNodeDeviceDefPtr def);
+
     /* Immutable pointer, self-locking APIs */
     virObjectEventStatePtr nodeDeviceEventState;
 };
@@ -43,6 +43,7 @@ struct _virSecretObj {
     virSecretDefPtr def;
     unsigned char *value;       /* May be NULL */
     size_t value_size;
+    virSecretStorePtr store;    /* May be NULL */
 };
 
 static virClassPtr virSecretObjClass;
@@ -56,11 +57,13 @@ struct _virSecretObjList {
     /* uuid string -> virSecretObj  mapping
      * for O(1), lockless lookup-by-uuid */
     virHashTable *objs;
-};
 
-struct virSecretSearchData {
-    int usageType;
-    const char *usageID;
+    /* "usage type:usage id" -> virSecretObj mapping of the secrets
+     * with a usage, for O(1) lookup-by-usage */
+    virHashTable *objsUsage;
+
+    /* Persists the secrets instead of per secret files if set */
+    virSecretStorePtr store;
 };
 
 
@@ -119,7 +122,8 @@ virSecretObjListNew(void)
     if (!(secrets = virObjectRWLockableNew(virSecretObjListClass)))
         return NULL;
 
-    if (!(secrets->objs = virHashCreate(50, virObjectFreeHashData))) {
+    if (!(secrets->objs = virHashCreate(50, virObjectFreeHashData)) ||
+        !(secrets->objsUsage = virHashNew(NULL))) {
         virObjectUnref(secrets);
         return NULL;
     }
@@ -128,6 +132,25 @@ virSecretObjListNew(void)
 }
 
 
+/**
+ * virSecretObjListSetStore:
+ * @secrets: list of secret objects
+ * @store: secret store
+ *
+ * Makes the secrets added to @secrets from now on persist their config
+ * and value in @store rather than in separate files.
+ */
+void
+virSecretObjListSetStore(virSecretObjListPtr secrets,
+                         virSecretStorePtr store)
+{
+    virObjectRWLockWrite(secrets);
+    virObjectUnref(secrets->store);
+    secrets->store = virObjectRef(store);
+    virObjectRWUnlock(secrets);
+}
+
+
 static void
 virSecretObjDispose(void *opaque)
 {
@@ -141,6 +164,7 @@ virSecretObjDispose(void *opaque)
     }
     VIR_FREE(obj->configFile);
     VIR_FREE(obj->base64File);
+    virObjectUnref(obj->store);
 }
 
 
@@ -149,7 +173,48 @@ virSecretObjListDispose(void *obj)
 {
     virSecretObjListPtr secrets = obj;
 
+    virHashFree(secrets->objsUsage);
     virHashFree(secrets->objs);
+    virObjectUnref(secrets->store);
+}
+
+
+static char *
+virSecretObjUsageKey(int usageType,
+                     const char *usageID)
+{
+    if (usageType == VIR_SECRET_USAGE_TYPE_NONE || !usageID)
+        return NULL;
+
+    return g_strdup_printf("%d:%s", usageType, usageID);
+}
+
+
+/* Must be called with @secrets locked for writing */
+static void
+virSecretObjListUsageAdd(virSecretObjListPtr secrets,
+                         virSecretObjPtr obj,
+                         virSecretDefPtr def)
+{
+    g_autofree char *key = virSecretObjUsageKey(def->usage_type,
+                                                def->usage_id);
+
+    if (key && virHashUpdateEntry(secrets->objsUsage, key, obj) < 0)
+        virResetLastError();
+}
+
+
+/* Must be called with @secrets locked for writing */
+static void
+virSecretObjListUsageRemove(virSecretObjListPtr secrets,
+                            virSecretObjPtr obj,
+                            virSecretDefPtr def)
+{
+    g_autofree char *key = virSecretObjUsageKey(def->usage_type,
+                                                def->usage_id);
+
+    if (key && virHashLookup(secrets->objsUsage, key) == obj)
+        virHashRemoveEntry(secrets->objsUsage, key);
 }
 
 
@@ -195,32 +260,6 @@ virSecretObjListFindByUUID(virSecretObjListPtr secrets,
 }
 
 
-static int
-virSecretObjSearchName(const void *payload,
-                       const void *name G_GNUC_UNUSED,
-                       const void *opaque)
-{
-    virSecretObjPtr obj = (virSecretObjPtr) payload;
-    virSecretDefPtr def;
-    struct virSecretSearchData *data = (struct virSecretSearchData *) opaque;
-    int found = 0;
-
-    virObjectLock(obj);
-    def = obj->def;
-
-    if (def->usage_type != data->usageType)
-        goto cleanup;
-
-    if (data->usageType != VIR_SECRET_USAGE_TYPE_NONE &&
-        STREQ(def->usage_id, data->usageID))
-        found = 1;
-
- cleanup:
-    virObjectUnlock(obj);
-    return found;
-}
-
-
 /**
  * virSecretObjFindByUsageLocked:
  * @secrets: list of secret objects
@@ -236,14 +275,12 @@ virSecretObjListFindByUsageLocked(virSecretObjListPtr secrets,
                                   int usageType,
                                   const char *usageID)
 {
-    virSecretObjPtr obj = NULL;
-    struct virSecretSearchData data = { .usageType = usageType,
-                                        .usageID = usageID };
+    g_autofree char *key = virSecretObjUsageKey(usageType, usageID);
 
-    obj = virHashSearch(secrets->objs, virSecretObjSearchName, &data, NULL);
-    if (obj)
-        virObjectRef(obj);
-    return obj;
+    if (!key)
+        return NULL;
+
+    return virObjectRef(virHashLookup(secrets->objsUsage, key));
 }
 
 
@@ -300,6 +337,7 @@ virSecretObjListRemove(virSecretObjListPtr secrets,
 
     virObjectRWLockWrite(secrets);
     virObjectLock(obj);
+    virSecretObjListUsageRemove(secrets, obj, def);
     virHashRemoveEntry(secrets->objs, uuidstr);
     virObjectUnlock(obj);
     virObjectUnref(obj);
@@ -355,6 +393,9 @@ virSecretObjListAdd(virSecretObjListPtr secrets,
             goto cleanup;
         }
 
+        virSecretObjListUsageRemove(secrets, obj, objdef);
+        virSecretObjListUsageAdd(secrets, obj, newdef);
+
         if (oldDef)
             *oldDef = objdef;
         else
@@ -390,6 +431,8 @@ virSecretObjListAdd(virSecretObjListPtr secrets,
             goto cleanup;
 
         obj->def = newdef;
+        obj->store = virObjectRef(secrets->store);
+        virSecretObjListUsageAdd(secrets, obj, newdef);
         virObjectRef(obj);
     }
 
@@ -648,8 +691,17 @@ virSecretObjDeleteConfig(virSecretObjPtr obj)
 {
     virSecretDefPtr def = obj->def;
 
-    if (!def->isephemeral &&
-        unlink(obj->configFile) < 0 && errno != ENOENT) {
+    if (def->isephemeral)
+        return 0;
+
+    if (obj->store) {
+        char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+        virUUIDFormat(def->uuid, uuidstr);
+        return virSecretStoreRemove(obj->store, uuidstr);
+    }
+
+    if (unlink(obj->configFile) < 0 && errno != ENOENT) {
         virReportSystemError(errno, _("cannot unlink '%s'"),
                              obj->configFile);
         return -1;
@@ -664,6 +716,15 @@ virSecretObjDeleteData(virSecretObjPtr obj)
 {
     /* The configFile will already be removed, so secret won't be
      * loaded again if this fails */
+    if (obj->store) {
+        char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+        virUUIDFormat(obj->def->uuid, uuidstr);
+        if (virSecretStoreRemoveValue(obj->store, uuidstr) < 0)
+            virResetLastError();
+        return;
+    }
+
     unlink(obj->base64File);
 }
 
@@ -673,7 +734,8 @@ virSecretObjDeleteData(virSecretObjPtr obj)
 /* Secrets are stored in virSecretDriverStatePtr->configDir.  Each secret
    has virSecretDef stored as XML in "$basename.xml".  If a value of the
    secret is defined, it is stored as base64 (with no formatting) in
-   "$basename.base64".  "$basename" is in both cases the base64-encoded UUID. */
+   "$basename.base64".  "$basename" is in both cases the base64-encoded UUID.
+   If the list of the secret has a store, both are kept in the store. */
 int
 virSecretObjSaveConfig(virSecretObjPtr obj)
 {
@@ -682,6 +744,13 @@ virSecretObjSaveConfig(virSecretObjPtr obj)
     if (!(xml = virSecretDefFormat(obj->def)))
         return -1;
 
+    if (obj->store) {
+        char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+        virUUIDFormat(obj->def->uuid, uuidstr);
+        return virSecretStoreSetConfig(obj->store, uuidstr, xml);
+    }
+
     if (virFileRewriteStr(obj->configFile, S_IRUSR | S_IWUSR, xml) < 0)
         return -1;
 
@@ -697,6 +766,14 @@ virSecretObjSaveData(virSecretObjPtr obj)
     if (!obj->value)
         return 0;
 
+    if (obj->store) {
+        char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+        virUUIDFormat(obj->def->uuid, uuidstr);
+        return virSecretStoreSetValue(obj->store, uuidstr,
+                                      obj->value, obj->value_size);
+    }
+
     base64 = g_base64_encode(obj->value, obj->value_size);
 
     if (virFileRewriteStr(obj->base64File, S_IRUSR | S_IWUSR, base64) < 0)
@@ -901,14 +978,113 @@ virSecretLoad(virSecretObjListPtr secrets,
 }
 
 
+static virSecretObjPtr
+virSecretLoadFromStore(virSecretObjListPtr secrets,
+                       virSecretStorePtr store,
+                       const char *uuidstr,
+                       const char *configDir)
+{
+    g_autofree char *xml = NULL;
+    virSecretDefPtr def = NULL;
+    virSecretObjPtr obj = NULL;
+    char defuuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (virSecretStoreGetConfig(store, uuidstr, &xml) < 0)
+        return NULL;
+
+    if (!(def = virSecretDefParseString(xml)))
+        return NULL;
+
+    virUUIDFormat(def->uuid, defuuidstr);
+    if (STRNEQ(defuuidstr, uuidstr)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("<uuid> does not match stored secret '%s'"),
+                       uuidstr);
+        virSecretDefFree(def);
+        return NULL;
+    }
+
+    if (!(obj = virSecretObjListAdd(secrets, def, configDir, NULL))) {
+        virSecretDefFree(def);
+        return NULL;
+    }
+
+    if (obj->value)
+        VIR_DISPOSE_N(obj->value, obj->value_size);
+
+    if (virSecretStoreGetValue(store, uuidstr,
+                               &obj->value, &obj->value_size) < 0) {
+        virSecretObjListRemove(secrets, obj);
+        virObjectUnref(obj);
+        return NULL;
+    }
+
+    return obj;
+}
+
+
+/*
+ * Adds a secret loaded from its files to the store of its list, which
+ * is saved once all the secrets are added. The files are then removed,
+ * so that they don't need to be read again.
+ */
+static int
+virSecretLoadMigrate(virSecretObjPtr obj,
+                     GPtrArray *migrated)
+{
+    g_autofree char *xml = NULL;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (!(xml = virSecretDefFormat(obj->def)))
+        return -1;
+
+    virUUIDFormat(obj->def->uuid, uuidstr);
+    if (virSecretStoreAdd(obj->store, uuidstr, xml,
+                          obj->value, obj->value_size) < 0)
+        return -1;
+
+    g_ptr_array_add(migrated, g_strdup(obj->configFile));
+    g_ptr_array_add(migrated, g_strdup(obj->base64File));
+    return 0;
+}
+
+
 int
 virSecretLoadAllConfigs(virSecretObjListPtr secrets,
                         const char *configDir)
 {
+    g_autoptr(virSecretStore) store = NULL;
+    g_autoptr(GPtrArray) migrated = g_ptr_array_new_with_free_func(g_free);
     DIR *dir = NULL;
     struct dirent *de;
+    size_t i;
     int rc;
 
+    virObjectRWLockRead(secrets);
+    store = virObjectRef(secrets->store);
+    virObjectRWUnlock(secrets);
+
+    if (store) {
+        g_auto(GStrv) uuids = NULL;
+
+        if (!(uuids = virSecretStoreGetUUIDs(store)))
+            return -1;
+
+        /* Like with the files below, keep the secrets we managed to load */
+        for (i = 0; uuids[i]; i++) {
+            virSecretObjPtr obj;
+
+            if (!(obj = virSecretLoadFromStore(secrets, store, uuids[i],
+                                               configDir))) {
+                VIR_ERROR(_("Error reading secret: %s"),
+                          virGetLastErrorMessage());
+                continue;
+            }
+
+            virSecretObjEndAPI(&obj);
+        }
+    }
+
     if ((rc = virDirOpenIfExists(&dir, configDir)) <= 0)
         return rc;
 
@@ -931,10 +1107,33 @@ virSecretLoadAllConfigs(virSecretObjListPtr secrets,
             continue;
         }
 
+        if (store && virSecretLoadMigrate(obj, migrated) < 0) {
+            VIR_WARN("Unable to move secret '%s' into the store: %s",
+                     path, virGetLastErrorMessage());
+            virResetLastError();
+        }
+
         VIR_FREE(path);
         virSecretObjEndAPI(&obj);
     }
 
     VIR_DIR_CLOSE(dir);
+
+    if (migrated->len > 0) {
+        if (virSecretStoreFlush(store) < 0) {
+            VIR_WARN("Unable to move secrets into the store: %s",
+                     virGetLastErrorMessage());
+            virResetLastError();
+            return 0;
+        }
+
+        for (i = 0; i < migrated->len; i++) {
+            const char *file = g_ptr_array_index(migrated, i);
+
+            if (unlink(file) < 0 && errno != ENOENT)
+                VIR_WARN("Unable to remove '%s': %s", file, g_strerror(errno));
+        }
+    }
+
     return 0;
 }
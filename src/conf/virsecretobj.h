@@ -24,6 +24,7 @@
 
 #include "secret_conf.h"
 #include "virobject.h"
+#include "virsecretstore.h"
 
 typedef struct _virSecretObj virSecretObj;
 typedef virSecretObj *virSecretObjPtr;
@@ -37,6 +38,10 @@ typedef virSecretObjList *virSecretObjListPtr;
 virSecretObjListPtr
 virSecretObjListNew(void);
 
+void
+virSecretObjListSetStore(virSecretObjListPtr secrets,
+                         virSecretStorePtr store);
+
 virSecretObjPtr
 virSecretObjListFindByUUID(virSecretObjListPtr secrets,
                            const char *uuidstr);
@@ -0,0 +1,774 @@
+/*
+ * virsecretstore.c: encrypted single file storage of secrets
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <sys/stat.h>
+
+#include "virsecretstore.h"
+#include "viralloc.h"
+#include "vircrypto.h"
+#include "virerror.h"
+#include "virfile.h"
+#include "virhash.h"
+#include "virlog.h"
+#include "virrandom.h"
+#include "virstring.h"
+
+#define VIR_FROM_THIS VIR_FROM_SECRET
+
+VIR_LOG_INIT("conf.virsecretstore");
+
+/*
+ * The store is a single file holding the config and value of all the
+ * persistent secrets:
+ *
+ *   "LVSECRET" | version (uint32) | IV (16 bytes) | ciphertext
+ *
+ * The ciphertext is the AES-256-CBC encrypted list of secrets, each of
+ * which is stored as its UUID string, its XML and its value, all of them
+ * prefixed by their length (uint32). A value length of
+ * VIR_SECRET_STORE_NO_VALUE means the secret has no value. All integers
+ * are big endian.
+ */
+#define VIR_SECRET_STORE_MAGIC "LVSECRET"
+#define VIR_SECRET_STORE_MAGIC_LEN 8
+#define VIR_SECRET_STORE_VERSION 1
+#define VIR_SECRET_STORE_KEY_LEN 32
+#define VIR_SECRET_STORE_IV_LEN 16
+#define VIR_SECRET_STORE_HEADER_LEN \
+    (VIR_SECRET_STORE_MAGIC_LEN + 4 + VIR_SECRET_STORE_IV_LEN)
+#define VIR_SECRET_STORE_MAX_SIZE (64 * 1024 * 1024)
+#define VIR_SECRET_STORE_NO_VALUE 0xffffffff
+
+typedef struct _virSecretStoreEntry virSecretStoreEntry;
+typedef virSecretStoreEntry *virSecretStoreEntryPtr;
+struct _virSecretStoreEntry {
+    char *xml;                  /* May be NULL */
+    unsigned char *value;       /* May be NULL */
+    size_t value_size;
+};
+
+struct _virSecretStore {
+    virObjectLockable parent;
+
+    char *path;
+    uint8_t key[VIR_SECRET_STORE_KEY_LEN];
+
+    /* uuid string -> virSecretStoreEntry */
+    virHashTablePtr entries;
+};
+
+struct virSecretStoreData {
+    uint8_t *buf;
+    size_t len;
+};
+
+static virClassPtr virSecretStoreClass;
+static void virSecretStoreDispose(void *obj);
+
+
+static int
+virSecretStoreOnceInit(void)
+{
+    if (!VIR_CLASS_NEW(virSecretStore, virClassForObjectLockable()))
+        return -1;
+
+    return 0;
+}
+
+
+VIR_ONCE_GLOBAL_INIT(virSecretStore);
+
+
+static void
+virSecretStoreEntryFree(void *opaque)
+{
+    virSecretStoreEntryPtr entry = opaque;
+
+    if (!entry)
+        return;
+
+    g_free(entry->xml);
+    /* Wipe before free to ensure we don't leave a secret on the heap */
+    VIR_DISPOSE_N(entry->value, entry->value_size);
+    g_free(entry);
+}
+
+
+static void
+virSecretStoreDispose(void *obj)
+{
+    virSecretStorePtr store = obj;
+
+    virHashFree(store->entries);
+    memset(store->key, 0, sizeof(store->key));
+    g_free(store->path);
+}
+
+
+static bool
+virSecretStoreReadField(const uint8_t *buf,
+                        size_t len,
+                        size_t *off,
+                        const uint8_t **field,
+                        uint32_t *fieldlen)
+{
+    uint32_t n;
+
+    if (len - *off < 4)
+        return false;
+
+    n = ((uint32_t)buf[*off] << 24) | ((uint32_t)buf[*off + 1] << 16) |
+        ((uint32_t)buf[*off + 2] << 8) | (uint32_t)buf[*off + 3];
+    *off += 4;
+    *fieldlen = n;
+
+    if (n == VIR_SECRET_STORE_NO_VALUE) {
+        *field = NULL;
+        return true;
+    }
+
+    if (len - *off < n)
+        return false;
+
+    *field = buf + *off;
+    *off += n;
+    return true;
+}
+
+
+static int
+virSecretStoreParse(virSecretStorePtr store,
+                    const uint8_t *buf,
+                    size_t len)
+{
+    size_t off = 0;
+
+    while (off < len) {
+        virSecretStoreEntryPtr entry;
+        const uint8_t *uuid;
+        const uint8_t *xml;
+        const uint8_t *value;
+        uint32_t uuidlen;
+        uint32_t xmllen;
+        uint32_t valuelen;
+        g_autofree char *uuidstr = NULL;
+
+        if (!virSecretStoreReadField(buf, len, &off, &uuid, &uuidlen) ||
+            !uuid || uuidlen >= VIR_UUID_STRING_BUFLEN ||
+            !virSecretStoreReadField(buf, len, &off, &xml, &xmllen) ||
+            !xml ||
+            !virSecretStoreReadField(buf, len, &off, &value, &valuelen)) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("secret store '%s' is corrupted"), store->path);
+            return -1;
+        }
+
+        uuidstr = g_strndup((const char *)uuid, uuidlen);
+
+        entry = g_new0(virSecretStoreEntry, 1);
+        entry->xml = g_strndup((const char *)xml, xmllen);
+        if (value) {
+            entry->value = g_new0(unsigned char, MAX(valuelen, 1));
+            memcpy(entry->value, value, valuelen);
+            entry->value_size = valuelen;
+        }
+
+        if (virHashUpdateEntry(store->entries, uuidstr, entry) < 0) {
+            virSecretStoreEntryFree(entry);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int
+virSecretStoreLoad(virSecretStorePtr store)
+{
+    g_autofree char *contents = NULL;
+    uint8_t *plaintext = NULL;
+    size_t plaintextlen = 0;
+    const uint8_t *buf;
+    uint32_t version;
+    int len;
+    int ret;
+
+    if ((len = virFileReadAll(store->path, VIR_SECRET_STORE_MAX_SIZE,
+                              &contents)) < 0)
+        return -1;
+
+    buf = (const uint8_t *)contents;
+
+    if (len < VIR_SECRET_STORE_HEADER_LEN ||
+        memcmp(buf, VIR_SECRET_STORE_MAGIC, VIR_SECRET_STORE_MAGIC_LEN) != 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("'%s' is not a secret store"), store->path);
+        return -1;
+    }
+
+    buf += VIR_SECRET_STORE_MAGIC_LEN;
+    version = ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) |
+              ((uint32_t)buf[2] << 8) | (uint32_t)buf[3];
+    if (version != VIR_SECRET_STORE_VERSION) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("unsupported version %u of secret store '%s'"),
+                       version, store->path);
+        return -1;
+    }
+    buf += 4;
+
+    if (virCryptoDecryptData(VIR_CRYPTO_CIPHER_AES256CBC,
+                             store->key, sizeof(store->key),
+                             (uint8_t *)buf, VIR_SECRET_STORE_IV_LEN,
+                             (uint8_t *)buf + VIR_SECRET_STORE_IV_LEN,
+                             len - VIR_SECRET_STORE_HEADER_LEN,
+                             &plaintext, &plaintextlen) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot decrypt secret store '%s', wrong key?"),
+                       store->path);
+        ret = -1;
+        goto cleanup;
+    }
+
+    ret = virSecretStoreParse(store, plaintext, plaintextlen);
+
+ cleanup:
+    VIR_DISPOSE_N(plaintext, plaintextlen);
+    memset(contents, 0, len);
+    return ret;
+}
+
+
+static void
+virSecretStoreAppendField(uint8_t *buf,
+                          size_t *off,
+                          const void *field,
+                          uint32_t fieldlen)
+{
+    buf[(*off)++] = (fieldlen >> 24) & 0xff;
+    buf[(*off)++] = (fieldlen >> 16) & 0xff;
+    buf[(*off)++] = (fieldlen >> 8) & 0xff;
+    buf[(*off)++] = fieldlen & 0xff;
+
+    if (field && fieldlen != VIR_SECRET_STORE_NO_VALUE) {
+        memcpy(buf + *off, field, fieldlen);
+        *off += fieldlen;
+    }
+}
+
+
+static int
+virSecretStoreWriteFD(int fd,
+                      const void *opaque)
+{
+    const struct virSecretStoreData *data = opaque;
+
+    if (safewrite(fd, data->buf, data->len) != data->len)
+        return -1;
+
+    return 0;
+}
+
+
+/*
+ * Writes all the secrets of @store having a config to its file, replacing
+ * the previous file atomically. The store must be locked.
+ */
+static int
+virSecretStoreSave(virSecretStorePtr store)
+{
+    g_autofree virHashKeyValuePairPtr items = NULL;
+    struct virSecretStoreData data = { NULL, 0 };
+    uint8_t iv[VIR_SECRET_STORE_IV_LEN];
+    uint8_t *plaintext = NULL;
+    size_t plaintextlen = 0;
+    uint8_t *ciphertext = NULL;
+    size_t ciphertextlen = 0;
+    size_t off = 0;
+    size_t i;
+    int ret = -1;
+
+    if (!(items = virHashGetItems(store->entries, NULL)))
+        return -1;
+
+    for (i = 0; items[i].key; i++) {
+        const virSecretStoreEntry *entry = items[i].value;
+
+        if (!entry->xml)
+            continue;
+
+        plaintextlen += 12 + strlen(items[i].key) + strlen(entry->xml) +
+                        entry->value_size;
+    }
+
+    plaintext = g_new0(uint8_t, MAX(plaintextlen, 1));
+
+    for (i = 0; items[i].key; i++) {
+        const char *uuidstr = items[i].key;
+        const virSecretStoreEntry *entry = items[i].value;
+
+        if (!entry->xml)
+            continue;
+
+        virSecretStoreAppendField(plaintext, &off, uuidstr, strlen(uuidstr));
+        virSecretStoreAppendField(plaintext, &off, entry->xml,
+                                  strlen(entry->xml));
+        if (entry->value)
+            virSecretStoreAppendField(plaintext, &off, entry->value,
+                                      entry->value_size);
+        else
+            virSecretStoreAppendField(plaintext, &off, NULL,
+                                      VIR_SECRET_STORE_NO_VALUE);
+    }
+
+    if (virRandomBytes(iv, sizeof(iv)) < 0)
+        goto cleanup;
+
+    if (virCryptoEncryptData(VIR_CRYPTO_CIPHER_AES256CBC,
+                             store->key, sizeof(store->key),
+                             iv, sizeof(iv), plaintext, off,
+                             &ciphertext, &ciphertextlen) < 0)
+        goto cleanup;
+
+    data.len = VIR_SECRET_STORE_HEADER_LEN + ciphertextlen;
+    data.buf = g_new0(uint8_t, data.len);
+    memcpy(data.buf, VIR_SECRET_STORE_MAGIC, VIR_SECRET_STORE_MAGIC_LEN);
+    data.buf[VIR_SECRET_STORE_MAGIC_LEN + 3] = VIR_SECRET_STORE_VERSION;
+    memcpy(data.buf + VIR_SECRET_STORE_MAGIC_LEN + 4, iv, sizeof(iv));
+    memcpy(data.buf + VIR_SECRET_STORE_HEADER_LEN, ciphertext, ciphertextlen);
+
+    if (virFileRewrite(store->path, S_IRUSR | S_IWUSR,
+                       virSecretStoreWriteFD, &data) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    VIR_DISPOSE_N(plaintext, plaintextlen);
+    VIR_FREE(ciphertext);
+    VIR_FREE(data.buf);
+    return ret;
+}
+
+
+/**
+ * virSecretStoreOpen:
+ * @path: path of the store file
+ * @keyFile: path of the file holding the 32 byte encryption key
+ *
+ * Opens the secret store at @path, reading all the secrets in it if the
+ * file exists already.
+ *
+ * Returns the store or NULL on error.
+ */
+virSecretStorePtr
+virSecretStoreOpen(const char *path,
+                   const char *keyFile)
+{
+    g_autoptr(virSecretStore) store = NULL;
+    g_autofree char *key = NULL;
+    int keylen;
+
+    if (virSecretStoreInitialize() < 0)
+        return NULL;
+
+    if (!(store = virObjectLockableNew(virSecretStoreClass)))
+        return NULL;
+
+    store->path = g_strdup(path);
+    if (!(store->entries = virHashNew(virSecretStoreEntryFree)))
+        return NULL;
+
+    if ((keylen = virFileReadAll(keyFile, VIR_SECRET_STORE_KEY_LEN + 1,
+                                 &key)) < 0)
+        return NULL;
+
+    if (keylen != VIR_SECRET_STORE_KEY_LEN) {
+        memset(key, 0, keylen);
+        virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
+                       _("secret store key '%s' must be %d bytes long"),
+                       keyFile, VIR_SECRET_STORE_KEY_LEN);
+        return NULL;
+    }
+
+    memcpy(store->key, key, VIR_SECRET_STORE_KEY_LEN);
+    memset(key, 0, keylen);
+
+    if (virFileExists(path) && virSecretStoreLoad(store) < 0)
+        return NULL;
+
+    VIR_DEBUG("Opened secret store '%s' with %zd secrets",
+              path, virHashSize(store->entries));
+
+    return g_steal_pointer(&store);
+}
+
+
+/**
+ * virSecretStoreGetUUIDs:
+ * @store: secret store
+ *
+ * Returns a NULL terminated list of the UUIDs of all secrets in @store.
+ */
+char **
+virSecretStoreGetUUIDs(virSecretStorePtr store)
+{
+    g_autofree virHashKeyValuePairPtr items = NULL;
+    char **uuids;
+    size_t i;
+
+    virObjectLock(store);
+    if (!(items = virHashGetItems(store->entries, NULL))) {
+        virObjectUnlock(store);
+        return NULL;
+    }
+
+    uuids = g_new0(char *, virHashSize(store->entries) + 1);
+    for (i = 0; items[i].key; i++)
+        uuids[i] = g_strdup(items[i].key);
+    virObjectUnlock(store);
+
+    return uuids;
+}
+
+
+/**
+ * virSecretStoreGetConfig:
+ * @store: secret store
+ * @uuidstr: UUID of the secret
+ * @xml: filled with the XML of the secret, NULL if it has no config
+ *
+ * Returns 0 on success, -1 if @store has no secret @uuidstr.
+ */
+int
+virSecretStoreGetConfig(virSecretStorePtr store,
+                        const char *uuidstr,
+                        char **xml)
+{
+    virSecretStoreEntryPtr entry;
+    int ret = -1;
+
+    virObjectLock(store);
+    if (!(entry = virHashLookup(store->entries, uuidstr))) {
+        virReportError(VIR_ERR_NO_SECRET,
+                       _("no secret with matching uuid '%s'"), uuidstr);
+        goto cleanup;
+    }
+
+    *xml = g_strdup(entry->xml);
+    ret = 0;
+
+ cleanup:
+    virObjectUnlock(store);
+    return ret;
+}
+
+
+/**
+ * virSecretStoreGetValue:
+ * @store: secret store
+ * @uuidstr: UUID of the secret
+ * @value: filled with a copy of the value of the secret, NULL if it has none
+ * @value_size: filled with the size of @value
+ *
+ * Returns 0 on success, -1 if @store has no secret @uuidstr.
+ */
+int
+virSecretStoreGetValue(virSecretStorePtr store,
+                       const char *uuidstr,
+                       unsigned char **value,
+                       size_t *value_size)
+{
+    virSecretStoreEntryPtr entry;
+    int ret = -1;
+
+    virObjectLock(store);
+    if (!(entry = virHashLookup(store->entries, uuidstr))) {
+        virReportError(VIR_ERR_NO_SECRET,
+                       _("no secret with matching uuid '%s'"), uuidstr);
+        goto cleanup;
+    }
+
+    *value = NULL;
+    *value_size = 0;
+    if (entry->value) {
+        *value = g_new0(unsigned char, MAX(entry->value_size, 1));
+        memcpy(*value, entry->value, entry->value_size);
+        *value_size = entry->value_size;
+    }
+    ret = 0;
+
+ cleanup:
+    virObjectUnlock(store);
+    return ret;
+}
+
+
+static virSecretStoreEntryPtr
+virSecretStoreGetEntry(virSecretStorePtr store,
+                       const char *uuidstr)
+{
+    virSecretStoreEntryPtr entry;
+
+    if ((entry = virHashLookup(store->entries, uuidstr)))
+        return entry;
+
+    entry = g_new0(virSecretStoreEntry, 1);
+    if (virHashAddEntry(store->entries, uuidstr, entry) < 0) {
+        virSecretStoreEntryFree(entry);
+        return NULL;
+    }
+
+    return entry;
+}
+
+
+/**
+ * virSecretStoreAdd:
+ * @store: secret store
+ * @uuidstr: UUID of the secret
+ * @xml: XML of the secret
+ * @value: value of the secret, may be NULL
+ * @value_size: size of @value
+ *
+ * Adds secret @uuidstr to @store without saving the store, so that many
+ * secrets can be added at once followed by virSecretStoreFlush.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virSecretStoreAdd(virSecretStorePtr store,
+                  const char *uuidstr,
+                  const char *xml,
+                  const unsigned char *value,
+                  size_t value_size)
+{
+    virSecretStoreEntryPtr entry;
+    int ret = -1;
+
+    virObjectLock(store);
+    if (!(entry = virSecretStoreGetEntry(store, uuidstr)))
+        goto cleanup;
+
+    g_free(entry->xml);
+    entry->xml = g_strdup(xml);
+
+    VIR_DISPOSE_N(entry->value, entry->value_size);
+    if (value) {
+        entry->value = g_new0(unsigned char, MAX(value_size, 1));
+        memcpy(entry->value, value, value_size);
+        entry->value_size = value_size;
+    }
+    ret = 0;
+
+ cleanup:
+    virObjectUnlock(store);
+    return ret;
+}
+
+
+/**
+ * virSecretStoreFlush:
+ * @store: secret store
+ *
+ * Saves @store.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virSecretStoreFlush(virSecretStorePtr store)
+{
+    int ret;
+
+    virObjectLock(store);
+    ret = virSecretStoreSave(store);
+    virObjectUnlock(store);
+
+    return ret;
+}
+
+
+/**
+ * virSecretStoreSetConfig:
+ * @store: secret store
+ * @uuidstr: UUID of the secret
+ * @xml: XML of the secret
+ *
+ * Stores @xml as the config of secret @uuidstr in @store and saves it.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virSecretStoreSetConfig(virSecretStorePtr store,
+                        const char *uuidstr,
+                        const char *xml)
+{
+    virSecretStoreEntryPtr entry;
+    char *oldxml;
+    int ret = -1;
+
+    virObjectLock(store);
+    if (!(entry = virSecretStoreGetEntry(store, uuidstr)))
+        goto cleanup;
+
+    oldxml = entry->xml;
+    entry->xml = g_strdup(xml);
+
+    if (virSecretStoreSave(store) < 0) {
+        g_free(entry->xml);
+        entry->xml = oldxml;
+        goto cleanup;
+    }
+
+    g_free(oldxml);
+    ret = 0;
+
+ cleanup:
+    virObjectUnlock(store);
+    return ret;
+}
+
+
+/**
+ * virSecretStoreSetValue:
+ * @store: secret store
+ * @uuidstr: UUID of the secret
+ * @value: value of the secret
+ * @value_size: size of @value
+ *
+ * Stores @value as the value of secret @uuidstr in @store and saves it.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virSecretStoreSetValue(virSecretStorePtr store,
+                       const char *uuidstr,
+                       const unsigned char *value,
+                       size_t value_size)
+{
+    virSecretStoreEntryPtr entry;
+    unsigned char *oldvalue;
+    size_t oldvalue_size;
+    int ret = -1;
+
+    virObjectLock(store);
+    if (!(entry = virSecretStoreGetEntry(store, uuidstr)))
+        goto cleanup;
+
+    oldvalue = entry->value;
+    oldvalue_size = entry->value_size;
+    entry->value = g_new0(unsigned char, MAX(value_size, 1));
+    memcpy(entry->value, value, value_size);
+    entry->value_size = value_size;
+
+    if (virSecretStoreSave(store) < 0) {
+        VIR_DISPOSE_N(entry->value, entry->value_size);
+        entry->value = oldvalue;
+        entry->value_size = oldvalue_size;
+        goto cleanup;
+    }
+
+    VIR_DISPOSE_N(oldvalue, oldvalue_size);
+    ret = 0;
+
+ cleanup:
+    virObjectUnlock(store);
+    return ret;
+}
+
+
+/**
+ * virSecretStoreRemove:
+ * @store: secret store
+ * @uuidstr: UUID of the secret
+ *
+ * Removes secret @uuidstr from @store and saves it.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virSecretStoreRemove(virSecretStorePtr store,
+                     const char *uuidstr)
+{
+    virSecretStoreEntryPtr entry;
+    int ret = -1;
+
+    virObjectLock(store);
+    if (!(entry = virHashSteal(store->entries, uuidstr))) {
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (virSecretStoreSave(store) < 0) {
+        if (virHashAddEntry(store->entries, uuidstr, entry) < 0)
+            virSecretStoreEntryFree(entry);
+        goto cleanup;
+    }
+
+    virSecretStoreEntryFree(entry);
+    ret = 0;
+
+ cleanup:
+    virObjectUnlock(store);
+    return ret;
+}
+
+
+/**
+ * virSecretStoreRemoveValue:
+ * @store: secret store
+ * @uuidstr: UUID of the secret
+ *
+ * Removes the value of secret @uuidstr from @store and saves it.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virSecretStoreRemoveValue(virSecretStorePtr store,
+                          const char *uuidstr)
+{
+    virSecretStoreEntryPtr entry;
+    unsigned char *oldvalue;
+    size_t oldvalue_size;
+    int ret = -1;
+
+    virObjectLock(store);
+    if (!(entry = virHashLookup(store->entries, uuidstr)) || !entry->value) {
+        ret = 0;
+        goto cleanup;
+    }
+
+    oldvalue = g_steal_pointer(&entry->value);
+    oldvalue_size = entry->value_size;
+    entry->value_size = 0;
+
+    if (virSecretStoreSave(store) < 0) {
+        entry->value = oldvalue;
+        entry->value_size = oldvalue_size;
+        goto cleanup;
+    }
+
+    VIR_DISPOSE_N(oldvalue, oldvalue_size);
+    ret = 0;
+
+ cleanup:
+    virObjectUnlock(store);
+    return ret;
+}
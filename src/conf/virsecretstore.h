@@ -0,0 +1,75 @@
+/*
+ * virsecretstore.h: encrypted single file storage of secrets
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "internal.h"
+
+#include "virobject.h"
+
+typedef struct _virSecretStore virSecretStore;
+typedef virSecretStore *virSecretStorePtr;
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virSecretStore, virObjectUnref);
+
+virSecretStorePtr
+virSecretStoreOpen(const char *path,
+                   const char *keyFile);
+
+char **
+virSecretStoreGetUUIDs(virSecretStorePtr store);
+
+int
+virSecretStoreGetConfig(virSecretStorePtr store,
+                        const char *uuidstr,
+                        char **xml);
+
+int
+virSecretStoreGetValue(virSecretStorePtr store,
+                       const char *uuidstr,
+                       unsigned char **value,
+                       size_t *value_size);
+
+int
+virSecretStoreAdd(virSecretStorePtr store,
+                  const char *uuidstr,
+                  const char *xml,
+                  const unsigned char *value,
+                  size_t value_size);
+
+int
+virSecretStoreFlush(virSecretStorePtr store);
+
+int
+virSecretStoreSetConfig(virSecretStorePtr store,
+                        const char *uuidstr,
+                        const char *xml);
+
+int
+virSecretStoreSetValue(virSecretStorePtr store,
+                       const char *uuidstr,
+                       const unsigned char *value,
+                       size_t value_size);
+
+int
+virSecretStoreRemove(virSecretStorePtr store,
+                     const char *uuidstr);
+
+int
+virSecretStoreRemoveValue(virSecretStorePtr store,
+                          const char *uuidstr);
@@ -608,7 +608,7 @@ virCPUarmDecode(virCPUDefPtr cpu,
 
         for (i = 0; i < cpu->nfeatures; i++) {
             cpu->features[i].policy = VIR_CPU_FEATURE_REQUIRE;
-            cpu->features[i].name = g_strdup(cpuData->features[i]);
+            cpu->features[i].name = virStringIntern(cpuData->features[i]);
         }
     }
 
@@ -32,6 +32,31 @@
 
 VIR_LOG_INIT("cpu.cpu_map");
 
+typedef struct _virCPUMapBuiltin virCPUMapBuiltin;
+struct _virCPUMapBuiltin {
+    const char *arch;
+    const char *xml;
+};
+
+/* CPU maps of all architectures with their includes merged in, generated
+ * from src/cpu_map at build time */
+#include "cpu_map_builtin.h"
+
+
+static const char *
+cpuMapFindBuiltin(const char *arch)
+{
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS(cpuMapBuiltin); i++) {
+        if (STREQ(cpuMapBuiltin[i].arch, arch))
+            return cpuMapBuiltin[i].xml;
+    }
+
+    return NULL;
+}
+
+
 static int
 loadData(const char *mapfile,
          xmlXPathContextPtr ctxt,
@@ -174,14 +199,8 @@ int cpuMapLoad(const char *arch,
     g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
     char *xpath = NULL;
     int ret = -1;
-    char *mapfile;
-
-    if (!(mapfile = virFileFindResource("index.xml",
-                                        abs_top_srcdir "/src/cpu_map",
-                                        PKGDATADIR "/cpu_map")))
-        return -1;
-
-    VIR_DEBUG("Loading '%s' CPU map from %s", NULLSTR(arch), mapfile);
+    char *mapfile = NULL;
+    const char *builtin;
 
     if (arch == NULL) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -189,8 +208,26 @@ int cpuMapLoad(const char *arch,
         goto cleanup;
     }
 
-    if (!(xml = virXMLParseFileCtxt(mapfile, &ctxt)))
-        goto cleanup;
+    /* The files in cpu_map are only read for architectures the built-in
+     * map doesn't know about */
+    if ((builtin = cpuMapFindBuiltin(arch))) {
+        mapfile = g_strdup_printf("built-in %s", arch);
+
+        VIR_DEBUG("Loading built-in '%s' CPU map", arch);
+
+        if (!(xml = virXMLParseStringCtxt(builtin, mapfile, &ctxt)))
+            goto cleanup;
+    } else {
+        if (!(mapfile = virFileFindResource("index.xml",
+                                            abs_top_srcdir "/src/cpu_map",
+                                            PKGDATADIR "/cpu_map")))
+            goto cleanup;
+
+        VIR_DEBUG("Loading '%s' CPU map from %s", arch, mapfile);
+
+        if (!(xml = virXMLParseFileCtxt(mapfile, &ctxt)))
+            goto cleanup;
+    }
 
     virBufferAsprintf(&buf, "./arch[@name='%s']", arch);
 
@@ -30,6 +30,7 @@
 #include "virendian.h"
 #include "virstring.h"
 #include "virhostcpu.h"
+#include "virhash.h"
 
 #define VIR_FROM_THIS VIR_FROM_CPU
 
@@ -157,6 +158,10 @@ struct _virCPUx86Map {
     virCPUx86ModelPtr *models;
     size_t nblockers;
     virCPUx86FeaturePtr *migrate_blockers;
+    /* name -> feature/model lookup tables pointing to the items of
+     * features and models */
+    virHashTablePtr featureNames;
+    virHashTablePtr modelNames;
 };
 
 static virCPUx86MapPtr cpuMap;
@@ -364,14 +369,7 @@ static virCPUx86FeaturePtr
 x86FeatureFind(virCPUx86MapPtr map,
                const char *name)
 {
-    size_t i;
-
-    for (i = 0; i < map->nfeatures; i++) {
-        if (STREQ(map->features[i]->name, name))
-            return map->features[i];
-    }
-
-    return NULL;
+    return virHashLookup(map->featureNames, name);
 }
 
 
@@ -460,19 +458,51 @@ virCPUx86DataNext(virCPUx86DataIteratorPtr iterator)
 }
 
 
+/*
+ * Items in @data are kept sorted by virCPUx86DataSorter. Returns the index
+ * of the item matching @item in @data if @found is set, otherwise the index
+ * at which @item would have to be inserted.
+ */
+static size_t
+virCPUx86DataSearch(const virCPUx86Data *data,
+                    const virCPUx86DataItem *item,
+                    bool *found)
+{
+    size_t lo = 0;
+    size_t hi = data->len;
+
+    *found = false;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = virCPUx86DataItemCmp(data->items + mid, item);
+
+        if (cmp == 0) {
+            *found = true;
+            return mid;
+        }
+
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+
 static virCPUx86DataItemPtr
 virCPUx86DataGet(const virCPUx86Data *data,
                  const virCPUx86DataItem *item)
 {
-    size_t i;
+    bool found;
+    size_t pos = virCPUx86DataSearch(data, item, &found);
 
-    for (i = 0; i < data->len; i++) {
-        virCPUx86DataItemPtr di = data->items + i;
-        if (virCPUx86DataItemCmp(di, item) == 0)
-            return di;
-    }
+    if (!found)
+        return NULL;
 
-    return NULL;
+    return data->items + pos;
 }
 
 static void
@@ -514,17 +544,15 @@ static int
 virCPUx86DataAddItem(virCPUx86Data *data,
                      const virCPUx86DataItem *item)
 {
-    virCPUx86DataItemPtr existing;
+    bool found;
+    size_t pos = virCPUx86DataSearch(data, item, &found);
 
-    if ((existing = virCPUx86DataGet(data, item))) {
-        virCPUx86DataItemSetBits(existing, item);
+    if (found) {
+        virCPUx86DataItemSetBits(data->items + pos, item);
     } else {
-        if (VIR_APPEND_ELEMENT_COPY(data->items, data->len,
+        if (VIR_INSERT_ELEMENT_COPY(data->items, pos, data->len,
                                     *((virCPUx86DataItemPtr)item)) < 0)
             return -1;
-
-        qsort(data->items, data->len,
-              sizeof(virCPUx86DataItem), virCPUx86DataSorter);
     }
 
     return 0;
@@ -1124,6 +1152,10 @@ x86FeatureParse(xmlXPathContextPtr ctxt,
     if (VIR_APPEND_ELEMENT(map->features, map->nfeatures, feature) < 0)
         return -1;
 
+    if (virHashAddEntry(map->featureNames, name,
+                        map->features[map->nfeatures - 1]) < 0)
+        return -1;
+
     return 0;
 }
 
@@ -1265,14 +1297,7 @@ static virCPUx86ModelPtr
 x86ModelFind(virCPUx86MapPtr map,
              const char *name)
 {
-    size_t i;
-
-    for (i = 0; i < map->nmodels; i++) {
-        if (STREQ(map->models[i]->name, name))
-            return map->models[i];
-    }
-
-    return NULL;
+    return virHashLookup(map->modelNames, name);
 }
 
 
@@ -1634,6 +1659,10 @@ x86ModelParse(xmlXPathContextPtr ctxt,
     if (VIR_APPEND_ELEMENT(map->models, map->nmodels, model) < 0)
         return -1;
 
+    if (virHashAddEntry(map->modelNames, name,
+                        map->models[map->nmodels - 1]) < 0)
+        return -1;
+
     return 0;
 }
 
@@ -1646,6 +1675,9 @@ x86MapFree(virCPUx86MapPtr map)
     if (!map)
         return;
 
+    virHashFree(map->featureNames);
+    virHashFree(map->modelNames);
+
     for (i = 0; i < map->nfeatures; i++)
         x86FeatureFree(map->features[i]);
     g_free(map->features);
@@ -1674,6 +1706,8 @@ virCPUx86LoadMap(void)
     g_autoptr(virCPUx86Map) map = NULL;
 
     map = g_new0(virCPUx86Map, 1);
+    map->featureNames = virHashNew(NULL);
+    map->modelNames = virHashNew(NULL);
 
     if (cpuMapLoad("x86", x86VendorParse, x86FeatureParse, x86ModelParse, map) < 0)
         return NULL;
@@ -1954,6 +1988,101 @@ x86Compute(virCPUDefPtr host,
 #undef virX86CpuIncompatible
 
 
+/* Upper bound of cached comparison results, the cache is dropped
+ * completely once it's reached */
+#define X86_COMPARE_CACHE_MAX 256
+
+typedef struct _virCPUx86CompareCacheEntry virCPUx86CompareCacheEntry;
+typedef virCPUx86CompareCacheEntry *virCPUx86CompareCacheEntryPtr;
+struct _virCPUx86CompareCacheEntry {
+    virCPUCompareResult result;
+    char *message;
+};
+
+static virMutex x86CompareCacheLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr x86CompareCache;
+
+
+static void
+x86CompareCacheEntryFree(void *opaque)
+{
+    virCPUx86CompareCacheEntryPtr entry = opaque;
+
+    if (!entry)
+        return;
+
+    g_free(entry->message);
+    g_free(entry);
+}
+
+
+/*
+ * Comparing a CPU definition with the host CPU translates both of them to
+ * CPUID data feature by feature. Callers compare the same pair of CPUs
+ * over and over again, e.g. once for every domain started, so the results
+ * are remembered. The key consists of the formatted definitions of both
+ * CPUs since everything x86Compute looks at is part of them.
+ */
+static char *
+x86CompareCacheKey(virCPUDefPtr host,
+                   virCPUDefPtr cpu)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+
+    virBufferAsprintf(&buf, "%s\n", virArchToString(cpu->arch));
+    if (virCPUDefFormatBufFull(&buf, host, NULL) < 0 ||
+        virCPUDefFormatBufFull(&buf, cpu, NULL) < 0)
+        return NULL;
+
+    return virBufferContentAndReset(&buf);
+}
+
+
+static bool
+x86CompareCacheLookup(const char *key,
+                      virCPUCompareResult *result,
+                      char **message)
+{
+    virCPUx86CompareCacheEntryPtr entry;
+    bool found = false;
+
+    virMutexLock(&x86CompareCacheLock);
+    if (x86CompareCache &&
+        (entry = virHashLookup(x86CompareCache, key))) {
+        *result = entry->result;
+        *message = g_strdup(entry->message);
+        found = true;
+    }
+    virMutexUnlock(&x86CompareCacheLock);
+
+    return found;
+}
+
+
+static void
+x86CompareCacheStore(const char *key,
+                     virCPUCompareResult result,
+                     const char *message)
+{
+    virCPUx86CompareCacheEntryPtr entry;
+
+    entry = g_new0(virCPUx86CompareCacheEntry, 1);
+    entry->result = result;
+    entry->message = g_strdup(message);
+
+    virMutexLock(&x86CompareCacheLock);
+    if (!x86CompareCache)
+        x86CompareCache = virHashNew(x86CompareCacheEntryFree);
+
+    if (virHashSize(x86CompareCache) >= X86_COMPARE_CACHE_MAX)
+        virHashRemoveAll(x86CompareCache);
+
+    if (virHashUpdateEntry(x86CompareCache, key, entry) < 0)
+        x86CompareCacheEntryFree(entry);
+    virMutexUnlock(&x86CompareCacheLock);
+}
+
+
 static virCPUCompareResult
 virCPUx86Compare(virCPUDefPtr host,
                  virCPUDefPtr cpu,
@@ -1961,6 +2090,7 @@ virCPUx86Compare(virCPUDefPtr host,
 {
     virCPUCompareResult ret;
     g_autofree char *message = NULL;
+    g_autofree char *key = NULL;
 
     if (!host || !host->model) {
         if (failIncompatible) {
@@ -1973,7 +2103,15 @@ virCPUx86Compare(virCPUDefPtr host,
         return VIR_CPU_COMPARE_INCOMPATIBLE;
     }
 
-    ret = x86Compute(host, cpu, NULL, &message);
+    if (!(key = x86CompareCacheKey(host, cpu)))
+        return VIR_CPU_COMPARE_ERROR;
+
+    if (!x86CompareCacheLookup(key, &ret, &message)) {
+        ret = x86Compute(host, cpu, NULL, &message);
+
+        if (ret != VIR_CPU_COMPARE_ERROR)
+            x86CompareCacheStore(key, ret, message);
+    }
 
     if (ret == VIR_CPU_COMPARE_INCOMPATIBLE && failIncompatible) {
         if (message)
@@ -2208,7 +2346,7 @@ x86Decode(virCPUDefPtr cpu,
             if (x86FeatureIsMigratable(cpuModel->features[i].name, map)) {
                 i++;
             } else {
-                VIR_FREE(cpuModel->features[i].name);
+                virStringInternRelease(cpuModel->features[i].name);
                 VIR_DELETE_ELEMENT_INPLACE(cpuModel->features, i,
                                            cpuModel->nfeatures);
             }
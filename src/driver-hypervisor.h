@@ -448,6 +448,16 @@ typedef int
                                  const char *xml,
                                  unsigned int flags);
 
+typedef int
+(*virDrvDomainAttachDevices)(virDomainPtr domain,
+                             const char *xml,
+                             unsigned int flags);
+
+typedef int
+(*virDrvDomainDetachDevices)(virDomainPtr domain,
+                             const char *xml,
+                             unsigned int flags);
+
 typedef int
 (*virDrvDomainUpdateDeviceFlags)(virDomainPtr domain,
                                  const char *xml,
@@ -1194,6 +1204,21 @@ typedef int
                                            int *cookieoutlen,
                                            unsigned int flags);
 
+typedef int
+(*virDrvDomainMigrateTunnelChannel)(virDomainPtr dom,
+                                    virStreamPtr st,
+                                    unsigned int channel,
+                                    unsigned int flags);
+
+typedef int
+(*virDrvDomainListMigrate)(virConnectPtr conn,
+                           virDomainPtr *doms,
+                           unsigned int ndoms,
+                           const char *dconnuri,
+                           virTypedParameterPtr params,
+                           int nparams,
+                           unsigned int flags);
+
 typedef int
 (*virDrvDomainMigratePerform3Params)(virDomainPtr dom,
                                      const char *dconnuri,
@@ -1260,6 +1285,23 @@ typedef int
                                   virDomainStatsRecordPtr **retStats,
                                   unsigned int flags);
 
+typedef int
+(*virDrvConnectOpenDomainStatsFD)(virConnectPtr conn,
+                                  unsigned int flags);
+
+typedef int
+(*virDrvDomainListShutdown)(virConnectPtr conn,
+                            virDomainPtr *doms,
+                            unsigned int ndoms,
+                            unsigned int timeout,
+                            unsigned int flags);
+
+typedef int
+(*virDrvDomainGetXMLDigest)(virDomainPtr dom,
+                            unsigned long long *generation,
+                            char **digest,
+                            unsigned int flags);
+
 typedef int
 (*virDrvNodeAllocPages)(virConnectPtr conn,
                         unsigned int npages,
@@ -1650,4 +1692,11 @@ struct _virHypervisorDriver {
     virDrvDomainAgentSetResponseTimeout domainAgentSetResponseTimeout;
     virDrvDomainBackupBegin domainBackupBegin;
     virDrvDomainBackupGetXMLDesc domainBackupGetXMLDesc;
+    virDrvDomainMigrateTunnelChannel domainMigrateTunnelChannel;
+    virDrvDomainListMigrate domainListMigrate;
+    virDrvDomainAttachDevices domainAttachDevices;
+    virDrvDomainDetachDevices domainDetachDevices;
+    virDrvConnectOpenDomainStatsFD connectOpenDomainStatsFD;
+    virDrvDomainListShutdown domainListShutdown;
+    virDrvDomainGetXMLDigest domainGetXMLDigest;
 };
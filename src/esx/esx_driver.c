@@ -1069,6 +1069,10 @@ esxConnectSupportsFeature(virConnectPtr conn, int feature)
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_STATS_COMPACT:
+    case VIR_DRV_FEATURE_REMOTE_PIPELINE:
+    case VIR_DRV_FEATURE_REMOTE_CALL_BATCH:
+    case VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PACKETS:
     case VIR_DRV_FEATURE_TYPED_PARAM_STRING:
     case VIR_DRV_FEATURE_XML_MIGRATABLE:
     default:
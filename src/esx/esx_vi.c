@@ -484,6 +484,10 @@ esxVI_SharedCURL_Lock(CURL *handle G_GNUC_UNUSED, curl_lock_data data,
         i = 2;
         break;
 
+      case CURL_LOCK_DATA_SSL_SESSION:
+        i = 3;
+        break;
+
       default:
         VIR_ERROR(_("Trying to lock unknown SharedCURL lock %d"), (int)data);
         return;
@@ -512,6 +516,10 @@ esxVI_SharedCURL_Unlock(CURL *handle G_GNUC_UNUSED, curl_lock_data data,
         i = 2;
         break;
 
+      case CURL_LOCK_DATA_SSL_SESSION:
+        i = 3;
+        break;
+
       default:
         VIR_ERROR(_("Trying to unlock unknown SharedCURL lock %d"), (int)data);
         return;
@@ -576,6 +584,8 @@ esxVI_SharedCURL_Add(esxVI_SharedCURL *shared, esxVI_CURL *curl)
                           CURL_LOCK_DATA_COOKIE);
         curl_share_setopt(shared->handle, CURLSHOPT_SHARE,
                           CURL_LOCK_DATA_DNS);
+        curl_share_setopt(shared->handle, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_SSL_SESSION);
 
         for (i = 0; i < G_N_ELEMENTS(shared->locks); ++i) {
             if (virMutexInit(&shared->locks[i]) < 0) {
@@ -793,6 +803,56 @@ esxVI_MultiCURL_CheckFirstMessage(esxVI_MultiCURL *multi, long *responseCode,
 
 
 
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * VirtualMachineCache
+ *
+ * Looking up the virtual machines with RetrieveProperties transfers the
+ * properties of all of them on every call, which takes seconds on large
+ * vCenters. Therefore the commonly used properties of all virtual machines
+ * of the host system are cached and kept up to date by a private property
+ * collector, that reports only the changes since the last check.
+ */
+
+struct _esxVI_VirtualMachineCache {
+    virMutex lock;
+    bool broken; /* property collector is not usable */
+    esxVI_ManagedObjectReference *propertyCollector;
+    char *version;
+    esxVI_ObjectContent *virtualMachineList;
+};
+
+/* Properties of virtual machines covered by the cache */
+static const char *esxVI_VirtualMachineCache_Properties =
+    "configStatus\0"
+    "name\0"
+    "runtime.powerState\0"
+    "config.uuid\0"
+    "config.files.vmPathName\0"
+    "config.hardware.memoryMB\0"
+    "config.hardware.numCPU\0"
+    "config.memoryAllocation.limit\0";
+
+static void
+esxVI_VirtualMachineCache_Reset(esxVI_VirtualMachineCache *cache)
+{
+    esxVI_ManagedObjectReference_Free(&cache->propertyCollector);
+    VIR_FREE(cache->version);
+    esxVI_ObjectContent_Free(&cache->virtualMachineList);
+}
+
+static void
+esxVI_VirtualMachineCache_Free(esxVI_VirtualMachineCache **cache)
+{
+    if (!*cache)
+        return;
+
+    esxVI_VirtualMachineCache_Reset(*cache);
+    virMutexDestroy(&(*cache)->lock);
+    VIR_FREE(*cache);
+}
+
+
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
  * Context
  */
@@ -803,9 +863,14 @@ ESX_VI__TEMPLATE__ALLOC(Context)
 /* esxVI_Context_Free */
 ESX_VI__TEMPLATE__FREE(Context,
 {
+    size_t i;
+
     if (item->sessionLock)
         virMutexDestroy(item->sessionLock);
 
+    for (i = 0; i < G_N_ELEMENTS(item->curlPool); ++i)
+        esxVI_CURL_Free(&item->curlPool[i]);
+
     esxVI_CURL_Free(&item->curl);
     VIR_FREE(item->url);
     VIR_FREE(item->ipAddress);
@@ -827,6 +892,7 @@ ESX_VI__TEMPLATE__FREE(Context,
     esxVI_SelectionSpec_Free(&item->selectSet_computeResourceToHost);
     esxVI_SelectionSpec_Free(&item->selectSet_computeResourceToParentToParent);
     esxVI_SelectionSpec_Free(&item->selectSet_datacenterToNetwork);
+    esxVI_VirtualMachineCache_Free(&item->vmCache);
 })
 
 int
@@ -836,6 +902,8 @@ esxVI_Context_Connect(esxVI_Context *ctx, const char *url,
 {
     int result = -1;
     char *escapedPassword = NULL;
+    esxVI_SharedCURL *shared = NULL;
+    size_t i;
 
     if (!ctx || !url || !ipAddress || !username ||
         !password || ctx->url || ctx->service || ctx->curl) {
@@ -856,6 +924,26 @@ esxVI_Context_Connect(esxVI_Context *ctx, const char *url,
         goto cleanup;
     }
 
+    /*
+     * Concurrent calls don't serialize on a single handle but run on a pool
+     * of handles. The handles share the cookie of the session, DNS lookups
+     * and TLS sessions, and each of them keeps its connection alive, so an
+     * additional handle costs a single handshake with the server once.
+     */
+    if (esxVI_SharedCURL_Alloc(&shared) < 0 ||
+        esxVI_SharedCURL_Add(shared, ctx->curl) < 0) {
+        esxVI_SharedCURL_Free(&shared);
+        goto cleanup;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(ctx->curlPool); ++i) {
+        if (esxVI_CURL_Alloc(&ctx->curlPool[i]) < 0 ||
+            esxVI_CURL_Connect(ctx->curlPool[i], parsedUri) < 0 ||
+            esxVI_SharedCURL_Add(shared, ctx->curlPool[i]) < 0) {
+            goto cleanup;
+        }
+    }
+
     ctx->url = g_strdup(url);
     ctx->ipAddress = g_strdup(ipAddress);
     ctx->username = g_strdup(username);
@@ -871,6 +959,15 @@ esxVI_Context_Connect(esxVI_Context *ctx, const char *url,
         goto cleanup;
     }
 
+    ctx->vmCache = g_new0(esxVI_VirtualMachineCache, 1);
+
+    if (virMutexInit(&ctx->vmCache->lock) < 0) {
+        VIR_FREE(ctx->vmCache);
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Could not initialize virtual machine cache mutex"));
+        goto cleanup;
+    }
+
     if (esxVI_RetrieveServiceContent(ctx, &ctx->service) < 0)
         goto cleanup;
 
@@ -1234,6 +1331,33 @@ esxVI_Context_LookupManagedObjectsByHostSystemIp(esxVI_Context *ctx,
     return result;
 }
 
+/*
+ * Returns a CURL handle of the context locked, preferring idle handles. If
+ * all of them are busy the calls queue on the handles in turn.
+ */
+static esxVI_CURL *
+esxVI_Context_AcquireCURL(esxVI_Context *ctx)
+{
+    esxVI_CURL *curl;
+    size_t i;
+
+    if (virMutexTryLock(&ctx->curl->lock))
+        return ctx->curl;
+
+    for (i = 0; i < G_N_ELEMENTS(ctx->curlPool); ++i) {
+        if (virMutexTryLock(&ctx->curlPool[i]->lock))
+            return ctx->curlPool[i];
+    }
+
+    i = (unsigned int)g_atomic_int_add(&ctx->curlPoolNext, 1) %
+        (G_N_ELEMENTS(ctx->curlPool) + 1);
+    curl = i == 0 ? ctx->curl : ctx->curlPool[i - 1];
+
+    virMutexLock(&curl->lock);
+
+    return curl;
+}
+
 int
 esxVI_Context_Execute(esxVI_Context *ctx, const char *methodName,
                       const char *request, esxVI_Response **response,
@@ -1245,6 +1369,7 @@ esxVI_Context_Execute(esxVI_Context *ctx, const char *methodName,
     char *xpathExpression = NULL;
     xmlXPathContextPtr xpathContext = NULL;
     xmlNodePtr responseNode = NULL;
+    esxVI_CURL *curl;
 
     if (!request || !response || *response) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("Invalid argument"));
@@ -1254,18 +1379,18 @@ esxVI_Context_Execute(esxVI_Context *ctx, const char *methodName,
     if (esxVI_Response_Alloc(response) < 0)
         return -1;
 
-    virMutexLock(&ctx->curl->lock);
+    curl = esxVI_Context_AcquireCURL(ctx);
 
-    curl_easy_setopt(ctx->curl->handle, CURLOPT_URL, ctx->url);
-    curl_easy_setopt(ctx->curl->handle, CURLOPT_RANGE, NULL);
-    curl_easy_setopt(ctx->curl->handle, CURLOPT_WRITEDATA, &buffer);
-    curl_easy_setopt(ctx->curl->handle, CURLOPT_UPLOAD, 0);
-    curl_easy_setopt(ctx->curl->handle, CURLOPT_POSTFIELDS, request);
-    curl_easy_setopt(ctx->curl->handle, CURLOPT_POSTFIELDSIZE, strlen(request));
+    curl_easy_setopt(curl->handle, CURLOPT_URL, ctx->url);
+    curl_easy_setopt(curl->handle, CURLOPT_RANGE, NULL);
+    curl_easy_setopt(curl->handle, CURLOPT_WRITEDATA, &buffer);
+    curl_easy_setopt(curl->handle, CURLOPT_UPLOAD, 0);
+    curl_easy_setopt(curl->handle, CURLOPT_POSTFIELDS, request);
+    curl_easy_setopt(curl->handle, CURLOPT_POSTFIELDSIZE, strlen(request));
 
-    (*response)->responseCode = esxVI_CURL_Perform(ctx->curl, ctx->url);
+    (*response)->responseCode = esxVI_CURL_Perform(curl, ctx->url);
 
-    virMutexUnlock(&ctx->curl->lock);
+    virMutexUnlock(&curl->lock);
 
     if ((*response)->responseCode < 0)
         goto cleanup;
@@ -2698,11 +2823,387 @@ esxVI_LookupHostSystemProperties(esxVI_Context *ctx,
 
 
 
+static int
+esxVI_VirtualMachineCache_CreatePropertyCollector(esxVI_Context *ctx)
+{
+    esxVI_VirtualMachineCache *cache = ctx->vmCache;
+    int result = -1;
+    esxVI_ObjectSpec *objectSpec = NULL;
+    bool objectSpec_isAppended = false;
+    esxVI_PropertySpec *propertySpec = NULL;
+    bool propertySpec_isAppended = false;
+    esxVI_PropertyFilterSpec *propertyFilterSpec = NULL;
+    esxVI_ManagedObjectReference *propertyFilter = NULL;
+
+    if (esxVI_ObjectSpec_Alloc(&objectSpec) < 0)
+        return -1;
+
+    /* FIXME: Switch from ctx->hostSystem to ctx->computeResource->resourcePool
+     *        for cluster support */
+    objectSpec->obj = ctx->hostSystem->_reference;
+    objectSpec->skip = esxVI_Boolean_False;
+    objectSpec->selectSet = ctx->selectSet_hostSystemToVm;
+
+    if (esxVI_PropertySpec_Alloc(&propertySpec) < 0)
+        goto cleanup;
+
+    propertySpec->type = (char *)"VirtualMachine";
+
+    if (esxVI_String_AppendValueListToList(&propertySpec->pathSet,
+                                           esxVI_VirtualMachineCache_Properties) < 0 ||
+        esxVI_PropertyFilterSpec_Alloc(&propertyFilterSpec) < 0 ||
+        esxVI_PropertySpec_AppendToList(&propertyFilterSpec->propSet,
+                                        propertySpec) < 0) {
+        goto cleanup;
+    }
+
+    propertySpec_isAppended = true;
+
+    if (esxVI_ObjectSpec_AppendToList(&propertyFilterSpec->objectSet,
+                                      objectSpec) < 0) {
+        goto cleanup;
+    }
+
+    objectSpec_isAppended = true;
+
+    /* A private property collector, so that other users of WaitForUpdates
+     * don't interfere with the versions of the cache */
+    if (esxVI_CreatePropertyCollector(ctx, ctx->service->propertyCollector,
+                                      &cache->propertyCollector) < 0 ||
+        esxVI_CreateFilter(ctx, cache->propertyCollector, propertyFilterSpec,
+                           esxVI_Boolean_False, &propertyFilter) < 0) {
+        goto cleanup;
+    }
+
+    cache->version = g_strdup("");
+
+    result = 0;
+
+ cleanup:
+    /*
+     * Remove values given by the context from the data structures to prevent
+     * them from being freed by the call to esxVI_PropertyFilterSpec_Free().
+     */
+    objectSpec->obj = NULL;
+    objectSpec->selectSet = NULL;
+
+    if (propertySpec)
+        propertySpec->type = NULL;
+
+    if (!objectSpec_isAppended)
+        esxVI_ObjectSpec_Free(&objectSpec);
+
+    if (!propertySpec_isAppended)
+        esxVI_PropertySpec_Free(&propertySpec);
+
+    esxVI_PropertyFilterSpec_Free(&propertyFilterSpec);
+    esxVI_ManagedObjectReference_Free(&propertyFilter);
+
+    return result;
+}
+
+
+
+static int
+esxVI_VirtualMachineCache_ApplyChanges(esxVI_ObjectContent *virtualMachine,
+                                       esxVI_PropertyChange *propertyChangeList)
+{
+    esxVI_PropertyChange *propertyChange;
+
+    for (propertyChange = propertyChangeList; propertyChange;
+         propertyChange = propertyChange->_next) {
+        esxVI_DynamicProperty **next = &virtualMachine->propSet;
+        esxVI_DynamicProperty *dynamicProperty = NULL;
+
+        while (*next && STRNEQ((*next)->name, propertyChange->name))
+            next = &(*next)->_next;
+
+        switch (propertyChange->op) {
+          case esxVI_PropertyChangeOp_Add:
+          case esxVI_PropertyChangeOp_Assign:
+            if (!propertyChange->val)
+                break;
+
+            if (*next) {
+                esxVI_AnyType_Free(&(*next)->val);
+
+                if (esxVI_AnyType_DeepCopy(&(*next)->val,
+                                           propertyChange->val) < 0) {
+                    return -1;
+                }
+            } else {
+                if (esxVI_DynamicProperty_Alloc(&dynamicProperty) < 0)
+                    return -1;
+
+                dynamicProperty->name = g_strdup(propertyChange->name);
+
+                if (esxVI_AnyType_DeepCopy(&dynamicProperty->val,
+                                           propertyChange->val) < 0) {
+                    esxVI_DynamicProperty_Free(&dynamicProperty);
+                    return -1;
+                }
+
+                *next = dynamicProperty;
+            }
+
+            break;
+
+          case esxVI_PropertyChangeOp_Remove:
+          case esxVI_PropertyChangeOp_IndirectRemove:
+            if (*next) {
+                dynamicProperty = *next;
+                *next = dynamicProperty->_next;
+                dynamicProperty->_next = NULL;
+                esxVI_DynamicProperty_Free(&dynamicProperty);
+            }
+
+            break;
+
+          case esxVI_PropertyChangeOp_Undefined:
+          default:
+            virReportEnumRangeError(esxVI_PropertyChangeOp, propertyChange->op);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+
+static int
+esxVI_VirtualMachineCache_ApplyUpdates(esxVI_VirtualMachineCache *cache,
+                                       esxVI_UpdateSet *updateSet)
+{
+    esxVI_PropertyFilterUpdate *propertyFilterUpdate;
+    esxVI_ObjectUpdate *objectUpdate;
+
+    for (propertyFilterUpdate = updateSet->filterSet; propertyFilterUpdate;
+         propertyFilterUpdate = propertyFilterUpdate->_next) {
+        for (objectUpdate = propertyFilterUpdate->objectSet; objectUpdate;
+             objectUpdate = objectUpdate->_next) {
+            esxVI_ObjectContent **next = &cache->virtualMachineList;
+            esxVI_ObjectContent *virtualMachine = NULL;
+
+            if (objectUpdate->kind != esxVI_ObjectUpdateKind_Enter) {
+                while (*next && STRNEQ((*next)->obj->value,
+                                       objectUpdate->obj->value)) {
+                    next = &(*next)->_next;
+                }
+
+                if (!*next) {
+                    VIR_DEBUG("Update of unknown virtual machine '%s'",
+                              objectUpdate->obj->value);
+                    continue;
+                }
+            }
+
+            switch (objectUpdate->kind) {
+              case esxVI_ObjectUpdateKind_Enter:
+                if (esxVI_ObjectContent_Alloc(&virtualMachine) < 0 ||
+                    esxVI_ManagedObjectReference_DeepCopy(&virtualMachine->obj,
+                                                          objectUpdate->obj) < 0 ||
+                    esxVI_VirtualMachineCache_ApplyChanges
+                      (virtualMachine, objectUpdate->changeSet) < 0) {
+                    esxVI_ObjectContent_Free(&virtualMachine);
+                    return -1;
+                }
+
+                virtualMachine->_next = cache->virtualMachineList;
+                cache->virtualMachineList = virtualMachine;
+                break;
+
+              case esxVI_ObjectUpdateKind_Modify:
+                if (esxVI_VirtualMachineCache_ApplyChanges
+                      (*next, objectUpdate->changeSet) < 0) {
+                    return -1;
+                }
+
+                break;
+
+              case esxVI_ObjectUpdateKind_Leave:
+                virtualMachine = *next;
+                *next = virtualMachine->_next;
+                virtualMachine->_next = NULL;
+                esxVI_ObjectContent_Free(&virtualMachine);
+                break;
+
+              case esxVI_ObjectUpdateKind_Undefined:
+              default:
+                virReportEnumRangeError(esxVI_ObjectUpdateKind,
+                                        objectUpdate->kind);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+
+/*
+ * Brings the cache up to date with the changes since the last refresh,
+ * creating the property collector on first use. Returns 0 if the cache
+ * can be used, -1 otherwise. Must be called with the cache locked.
+ */
+static int
+esxVI_VirtualMachineCache_Refresh(esxVI_Context *ctx)
+{
+    esxVI_VirtualMachineCache *cache = ctx->vmCache;
+    esxVI_UpdateSet *updateSet = NULL;
+    int result = -1;
+
+    if (cache->broken)
+        return -1;
+
+    if (!cache->propertyCollector &&
+        esxVI_VirtualMachineCache_CreatePropertyCollector(ctx) < 0) {
+        VIR_WARN("Disabling virtual machine cache: %s",
+                 virGetLastErrorMessage());
+        virResetLastError();
+        esxVI_VirtualMachineCache_Reset(cache);
+        cache->broken = true;
+        return -1;
+    }
+
+    if (esxVI_CheckForUpdates(ctx, cache->propertyCollector, cache->version,
+                              &updateSet) < 0 ||
+        (updateSet &&
+         esxVI_VirtualMachineCache_ApplyUpdates(cache, updateSet) < 0)) {
+        /* start over with a new property collector next time */
+        VIR_DEBUG("Resetting virtual machine cache: %s",
+                  virGetLastErrorMessage());
+        virResetLastError();
+        if (cache->propertyCollector &&
+            esxVI_DestroyPropertyCollector(ctx, cache->propertyCollector) < 0)
+            virResetLastError();
+        esxVI_VirtualMachineCache_Reset(cache);
+        goto cleanup;
+    }
+
+    if (updateSet) {
+        VIR_FREE(cache->version);
+        cache->version = g_strdup(updateSet->version);
+    }
+
+    result = 0;
+
+ cleanup:
+    esxVI_UpdateSet_Free(&updateSet);
+
+    return result;
+}
+
+
+
+static bool
+esxVI_VirtualMachineCache_Covers(esxVI_String *propertyNameList)
+{
+    esxVI_String *propertyName;
+
+    for (propertyName = propertyNameList; propertyName;
+         propertyName = propertyName->_next) {
+        const char *cached = esxVI_VirtualMachineCache_Properties;
+        bool found = false;
+
+        while (*cached) {
+            if (STREQ(cached, propertyName->value)) {
+                found = true;
+                break;
+            }
+
+            cached += strlen(cached) + 1;
+        }
+
+        if (!found)
+            return false;
+    }
+
+    return true;
+}
+
+
+
+/*
+ * Copies the cached virtual machines, or only the one with @uuid if given,
+ * to @virtualMachineList. Returns 1 if the cache answered the lookup, 0 if
+ * the cache doesn't cover @propertyNameList or isn't usable, -1 on error.
+ */
+static int
+esxVI_VirtualMachineCache_Lookup(esxVI_Context *ctx,
+                                 esxVI_String *propertyNameList,
+                                 const unsigned char *uuid,
+                                 esxVI_ObjectContent **virtualMachineList)
+{
+    esxVI_VirtualMachineCache *cache = ctx->vmCache;
+    esxVI_ObjectContent *candidate;
+    esxVI_ObjectContent **tail = virtualMachineList;
+    int result = -1;
+
+    if (!cache || !esxVI_VirtualMachineCache_Covers(propertyNameList))
+        return 0;
+
+    virMutexLock(&cache->lock);
+
+    if (esxVI_VirtualMachineCache_Refresh(ctx) < 0) {
+        result = 0;
+        goto cleanup;
+    }
+
+    for (candidate = cache->virtualMachineList; candidate;
+         candidate = candidate->_next) {
+        esxVI_ObjectContent *virtualMachine = NULL;
+
+        if (uuid) {
+            unsigned char uuid_candidate[VIR_UUID_BUFLEN];
+
+            if (esxVI_GetVirtualMachineIdentity(candidate, NULL, NULL,
+                                                uuid_candidate) < 0) {
+                virResetLastError();
+                continue;
+            }
+
+            if (memcmp(uuid, uuid_candidate, VIR_UUID_BUFLEN) != 0)
+                continue;
+        }
+
+        if (esxVI_ObjectContent_DeepCopy(&virtualMachine, candidate) < 0) {
+            esxVI_ObjectContent_Free(virtualMachineList);
+            goto cleanup;
+        }
+
+        *tail = virtualMachine;
+        tail = &virtualMachine->_next;
+
+        if (uuid)
+            break;
+    }
+
+    result = 1;
+
+ cleanup:
+    virMutexUnlock(&cache->lock);
+
+    return result;
+}
+
+
+
 int
 esxVI_LookupVirtualMachineList(esxVI_Context *ctx,
                                esxVI_String *propertyNameList,
                                esxVI_ObjectContent **virtualMachineList)
 {
+    int rc;
+
+    ESX_VI_CHECK_ARG_LIST(virtualMachineList);
+
+    if ((rc = esxVI_VirtualMachineCache_Lookup(ctx, propertyNameList, NULL,
+                                               virtualMachineList)) != 0) {
+        return rc < 0 ? -1 : 0;
+    }
+
     /* FIXME: Switch from ctx->hostSystem to ctx->computeResource->resourcePool
      *        for cluster support */
     return esxVI_LookupObjectContentByType(ctx, ctx->hostSystem->_reference,
@@ -2722,11 +3223,26 @@ esxVI_LookupVirtualMachineByUuid(esxVI_Context *ctx, const unsigned char *uuid,
     int result = -1;
     esxVI_ManagedObjectReference *managedObjectReference = NULL;
     char uuid_string[VIR_UUID_STRING_BUFLEN] = "";
+    int rc;
 
     ESX_VI_CHECK_ARG_LIST(virtualMachine);
 
     virUUIDFormat(uuid, uuid_string);
 
+    if ((rc = esxVI_VirtualMachineCache_Lookup(ctx, propertyNameList, uuid,
+                                               virtualMachine)) < 0) {
+        return -1;
+    } else if (rc > 0) {
+        if (!(*virtualMachine) && occurrence != esxVI_Occurrence_OptionalItem) {
+            virReportError(VIR_ERR_NO_DOMAIN,
+                           _("Could not find domain with UUID '%s'"),
+                           uuid_string);
+            return -1;
+        }
+
+        return 0;
+    }
+
     if (esxVI_FindByUuid(ctx, ctx->datacenter->_reference, uuid_string,
                          esxVI_Boolean_True, esxVI_Boolean_Undefined,
                          &managedObjectReference) < 0) {
@@ -4267,7 +4783,8 @@ esxVI_WaitForTaskCompletion(esxVI_Context *ctx,
 
     objectSpec_isAppended = true;
 
-    if (esxVI_CreateFilter(ctx, propertyFilterSpec, esxVI_Boolean_True,
+    if (esxVI_CreateFilter(ctx, ctx->service->propertyCollector,
+                           propertyFilterSpec, esxVI_Boolean_True,
                            &propertyFilter) < 0) {
         goto cleanup;
     }
@@ -77,6 +77,7 @@ typedef struct _esxVI_CURL esxVI_CURL;
 typedef struct _esxVI_SharedCURL esxVI_SharedCURL;
 typedef struct _esxVI_MultiCURL esxVI_MultiCURL;
 typedef struct _esxVI_Context esxVI_Context;
+typedef struct _esxVI_VirtualMachineCache esxVI_VirtualMachineCache;
 typedef struct _esxVI_Response esxVI_Response;
 typedef struct _esxVI_Enumeration esxVI_Enumeration;
 typedef struct _esxVI_EnumerationValue esxVI_EnumerationValue;
@@ -137,7 +138,7 @@ int esxVI_CURL_Upload(esxVI_CURL *curl, const char *url, const char *content);
 
 struct _esxVI_SharedCURL {
     CURLSH *handle;
-    virMutex locks[3]; /* share, cookie, dns */
+    virMutex locks[4]; /* share, cookie, dns, ssl session */
     size_t count; /* number of added easy handle */
 };
 
@@ -172,9 +173,16 @@ int esxVI_MultiCURL_CheckFirstMessage(esxVI_MultiCURL *multi, long *responseCode
  * Context
  */
 
+/* Number of CURL handles in addition to the primary one that concurrent
+ * calls of esxVI_Context_Execute can use */
+#define ESX_VI__CURL__POOL_SIZE 3
+
 struct _esxVI_Context {
     /* All members are used read-only after esxVI_Context_Connect ... */
     esxVI_CURL *curl;
+    esxVI_CURL *curlPool[ESX_VI__CURL__POOL_SIZE]; /* sharing the session
+                                                   * cookie with curl */
+    unsigned int curlPoolNext; /* ... except this round-robin counter */
     char *url;
     char *ipAddress;
     char *username;
@@ -200,6 +208,8 @@ struct _esxVI_Context {
     esxVI_SelectionSpec *selectSet_datacenterToNetwork;
     bool hasQueryVirtualDiskUuid;
     bool hasSessionIsActive;
+    esxVI_VirtualMachineCache *vmCache; /* ... and the cache of virtual
+                                         * machines, that has its own lock */
 };
 
 int esxVI_Context_Alloc(esxVI_Context **ctx);
@@ -45,6 +45,10 @@
 
 #define HYPERV_JOB_TIMEOUT_MS 300000
 
+/* Objects asked for per enumeration round trip. The service sends fewer
+ * if they don't fit in its maximum envelope size. */
+#define HYPERV_MAX_ELEMENTS 64
+
 VIR_LOG_INIT("hyperv.hyperv_wmi");
 
 static int
@@ -949,6 +953,84 @@ hypervInvokeMethod(hypervPrivate *priv, hypervInvokeParamsListPtr params,
  * Object
  */
 
+/*
+ * Append the objects carried by an enumeration response to the list
+ * from @head to @tail. @responseName is the element of the SOAP body
+ * holding the items, which live in the @itemsNs namespace: a pull
+ * response uses the enumeration namespace, the items returned with an
+ * optimized enumerate response use the WS-Management one. @end is set
+ * if the response marks the end of the enumeration.
+ *
+ * Returns the number of objects found, or -1 on error.
+ */
+static int
+hypervParseEnumResponse(WsSerializerContextH serializerContext,
+                        hypervWmiClassInfoPtr wmiInfo,
+                        WsXmlDocH response,
+                        const char *responseName,
+                        const char *itemsNs,
+                        hypervObject **head,
+                        hypervObject **tail,
+                        bool *end)
+{
+    WsXmlNodeH node = NULL;
+    WsXmlNodeH items = NULL;
+    XML_TYPE_PTR data = NULL;
+    hypervObject *object;
+    int count;
+
+    node = ws_xml_get_soap_body(response);
+
+    if (node == NULL) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Could not lookup SOAP body"));
+        return -1;
+    }
+
+    node = ws_xml_get_child(node, 0, XML_NS_ENUMERATION, responseName);
+
+    if (node == NULL) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Could not lookup %s"), responseName);
+        return -1;
+    }
+
+    *end = ws_xml_get_child(node, 0, itemsNs, WSENUM_END_OF_SEQUENCE) != NULL;
+
+    /* Servers not supporting optimized enumeration send no items with the
+     * enumerate response at all */
+    if (!(items = ws_xml_get_child(node, 0, itemsNs, WSENUM_ITEMS)))
+        return 0;
+
+    for (count = 0;
+         ws_xml_get_child(items, count, wmiInfo->resourceUri, wmiInfo->name);
+         count++) {
+        data = ws_deserialize(serializerContext, items, wmiInfo->serializerInfo,
+                              wmiInfo->name, wmiInfo->resourceUri, NULL,
+                              count, 0);
+
+        if (data == NULL) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Could not deserialize pull response item"));
+            return -1;
+        }
+
+        object = g_new0(hypervObject, 1);
+        object->info = wmiInfo;
+        object->data.common = data;
+
+        if (*head == NULL) {
+            *head = object;
+        } else {
+            (*tail)->next = object;
+        }
+
+        *tail = object;
+    }
+
+    return count;
+}
+
 /* This function guarantees that wqlQuery->query is reset, even on failure */
 int
 hypervEnumAndPull(hypervPrivate *priv, hypervWqlQueryPtr wqlQuery,
@@ -964,9 +1046,8 @@ hypervEnumAndPull(hypervPrivate *priv, hypervWqlQueryPtr wqlQuery,
     char *enumContext = NULL;
     hypervObject *head = NULL;
     hypervObject *tail = NULL;
-    WsXmlNodeH node = NULL;
-    XML_TYPE_PTR data = NULL;
-    hypervObject *object;
+    bool end = false;
+    int count;
 
     query_string = virBufferContentAndReset(wqlQuery->query);
 
@@ -989,6 +1070,12 @@ hypervEnumAndPull(hypervPrivate *priv, hypervWqlQueryPtr wqlQuery,
         goto cleanup;
     }
 
+    /* Have the first items sent along with the enumerate response and
+     * then fetch several items per pull, instead of a round trip for
+     * every object and one more to learn that there are no more. */
+    wsmc_set_action_option(options, FLAG_ENUMERATION_OPTIMIZATION);
+    options->max_elements = HYPERV_MAX_ELEMENTS;
+
     filter = filter_create_simple(WSM_WQL_FILTER_DIALECT, query_string);
 
     if (filter == NULL) {
@@ -1003,71 +1090,32 @@ hypervEnumAndPull(hypervPrivate *priv, hypervWqlQueryPtr wqlQuery,
     if (hypervVerifyResponse(priv->client, response, "enumeration") < 0)
         goto cleanup;
 
+    if (hypervParseEnumResponse(serializerContext, wmiInfo, response,
+                                WSENUM_ENUMERATE_RESP, XML_NS_WS_MAN,
+                                &head, &tail, &end) < 0)
+        goto cleanup;
+
     enumContext = wsmc_get_enum_context(response);
 
     ws_xml_destroy_doc(response);
     response = NULL;
 
-    while (enumContext != NULL && *enumContext != '\0') {
+    while (!end && enumContext != NULL && *enumContext != '\0') {
         response = wsmc_action_pull(priv->client, wmiInfo->resourceUri, options,
                                     filter, enumContext);
 
         if (hypervVerifyResponse(priv->client, response, "pull") < 0)
             goto cleanup;
 
-        node = ws_xml_get_soap_body(response);
-
-        if (node == NULL) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("Could not lookup SOAP body"));
+        if ((count = hypervParseEnumResponse(serializerContext, wmiInfo,
+                                             response, WSENUM_PULL_RESP,
+                                             XML_NS_ENUMERATION,
+                                             &head, &tail, &end)) < 0)
             goto cleanup;
-        }
-
-        node = ws_xml_get_child(node, 0, XML_NS_ENUMERATION, WSENUM_PULL_RESP);
 
-        if (node == NULL) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("Could not lookup pull response"));
-            goto cleanup;
-        }
-
-        node = ws_xml_get_child(node, 0, XML_NS_ENUMERATION, WSENUM_ITEMS);
-
-        if (node == NULL) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("Could not lookup pull response items"));
-            goto cleanup;
-        }
-
-        if (ws_xml_get_child(node, 0, wmiInfo->resourceUri,
-                             wmiInfo->name) == NULL)
+        if (count == 0)
             break;
 
-        data = ws_deserialize(serializerContext, node, wmiInfo->serializerInfo,
-                              wmiInfo->name, wmiInfo->resourceUri, NULL, 0, 0);
-
-        if (data == NULL) {
-            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                           _("Could not deserialize pull response item"));
-            goto cleanup;
-        }
-
-        if (VIR_ALLOC(object) < 0)
-            goto cleanup;
-
-        object->info = wmiInfo;
-        object->data.common = data;
-
-        data = NULL;
-
-        if (head == NULL) {
-            head = object;
-        } else {
-            tail->next = object;
-        }
-
-        tail = object;
-
         VIR_FREE(enumContext);
         enumContext = wsmc_get_enum_context(response);
 
@@ -1087,17 +1135,6 @@ hypervEnumAndPull(hypervPrivate *priv, hypervWqlQueryPtr wqlQuery,
     if (filter != NULL)
         filter_destroy(filter);
 
-    if (data != NULL) {
-#if WS_SERIALIZER_FREE_MEM_WORKS
-        /* FIXME: ws_serializer_free_mem is broken in openwsman <= 2.2.6,
-         *        see hypervFreeObject for a detailed explanation. */
-        if (ws_serializer_free_mem(serializerContext, data,
-                                   wmiInfo->serializerInfo) < 0) {
-            VIR_ERROR(_("Could not free deserialized data"));
-        }
-#endif
-    }
-
     VIR_FREE(query_string);
     ws_xml_destroy_doc(response);
     VIR_FREE(enumContext);
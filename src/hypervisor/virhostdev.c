@@ -34,6 +34,7 @@
 #include "virlog.h"
 #include "virutil.h"
 #include "virnetdev.h"
+#include "virthread.h"
 #include "configmake.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
@@ -130,6 +131,8 @@ virHostdevManagerDispose(void *obj)
 
     virObjectUnref(hostdevMgr->activePCIHostdevs);
     virObjectUnref(hostdevMgr->inactivePCIHostdevs);
+    virObjectUnref(hostdevMgr->pooledPCIHostdevs);
+    virObjectUnref(hostdevMgr->readyPCIHostdevs);
     virObjectUnref(hostdevMgr->activeUSBHostdevs);
     virObjectUnref(hostdevMgr->activeSCSIHostdevs);
     virObjectUnref(hostdevMgr->activeSCSIVHostHostdevs);
@@ -156,6 +159,12 @@ virHostdevManagerNew(void)
     if (!(hostdevMgr->inactivePCIHostdevs = virPCIDeviceListNew()))
         return NULL;
 
+    if (!(hostdevMgr->pooledPCIHostdevs = virPCIDeviceListNew()))
+        return NULL;
+
+    if (!(hostdevMgr->readyPCIHostdevs = virPCIDeviceListNew()))
+        return NULL;
+
     if (!(hostdevMgr->activeSCSIHostdevs = virSCSIDeviceListNew()))
         return NULL;
 
@@ -617,38 +626,261 @@ virHostdevRestoreNetConfig(virDomainHostdevDefPtr hostdev,
     }
 }
 
+/* Upper limit of threads detaching, resetting or reattaching the PCI
+ * devices of one domain */
+#define VIR_HOSTDEV_PCI_PARALLEL_THREADS 8
+
+typedef int (*virHostdevPCIParallelCallback)(virHostdevManagerPtr mgr,
+                                             virPCIDevicePtr pci);
+
+typedef struct _virHostdevPCIParallelData virHostdevPCIParallelData;
+typedef virHostdevPCIParallelData *virHostdevPCIParallelDataPtr;
+struct _virHostdevPCIParallelData {
+    virMutex lock;
+    virPCIDevicePtr *devs;
+    size_t ndevs;
+    size_t next; /* protected by @lock */
+    virErrorPtr error; /* protected by @lock */
+
+    virHostdevManagerPtr mgr;
+    virHostdevPCIParallelCallback cb;
+    int *results;
+};
+
+
+static bool
+virHostdevPCISameBus(virPCIDevicePtr a,
+                     virPCIDevicePtr b)
+{
+    virPCIDeviceAddressPtr addrA = virPCIDeviceGetAddress(a);
+    virPCIDeviceAddressPtr addrB = virPCIDeviceGetAddress(b);
+
+    return addrA->domain == addrB->domain && addrA->bus == addrB->bus;
+}
+
+
+/* Devices sitting on the same bus as an earlier one are processed
+ * along with that one */
+static bool
+virHostdevPCIParallelIsFirst(virHostdevPCIParallelDataPtr data,
+                             size_t dev)
+{
+    size_t i;
+
+    for (i = 0; i < dev; i++) {
+        if (virHostdevPCISameBus(data->devs[i], data->devs[dev]))
+            return false;
+    }
+
+    return true;
+}
+
+
+static void
+virHostdevPCIParallelWorker(void *opaque)
+{
+    virHostdevPCIParallelDataPtr data = opaque;
+
+    while (true) {
+        size_t first;
+        size_t i;
+
+        virMutexLock(&data->lock);
+        while (data->next < data->ndevs &&
+               !virHostdevPCIParallelIsFirst(data, data->next))
+            data->next++;
+        first = data->next++;
+        virMutexUnlock(&data->lock);
+
+        if (first >= data->ndevs)
+            break;
+
+        for (i = first; i < data->ndevs; i++) {
+            if (i != first &&
+                !virHostdevPCISameBus(data->devs[first], data->devs[i]))
+                continue;
+
+            if ((data->results[i] = data->cb(data->mgr, data->devs[i])) < 0) {
+                virErrorPtr err;
+
+                virErrorPreserveLast(&err);
+                virMutexLock(&data->lock);
+                if (!data->error)
+                    data->error = g_steal_pointer(&err);
+                virMutexUnlock(&data->lock);
+                virFreeError(err);
+            }
+        }
+    }
+}
+
+
+/**
+ * virHostdevPCIRunParallel:
+ * @mgr: hostdev manager
+ * @devs: devices to process, NULL items are skipped
+ * @ndevs: number of items in @devs
+ * @cb: callback processing one device
+ * @results: filled with the return value of @cb for each device
+ *
+ * Calls @cb on each device in @devs, devices on distinct PCI buses
+ * concurrently. Devices on the same bus are processed in their original
+ * order by a single thread, as resetting one of them might affect the
+ * others. Devices which were not processed have 1 stored in @results.
+ *
+ * The callback must not modify the device lists of @mgr, the caller
+ * is expected to hold their locks and update them afterwards according
+ * to @results.
+ *
+ * Returns 0 if all devices were processed successfully, -1 with the
+ * error of the first failed device set otherwise.
+ */
 static int
-virHostdevResetAllPCIDevices(virHostdevManagerPtr mgr,
-                             virPCIDeviceListPtr pcidevs)
+virHostdevPCIRunParallel(virHostdevManagerPtr mgr,
+                         virPCIDevicePtr *devs,
+                         size_t ndevs,
+                         virHostdevPCIParallelCallback cb,
+                         int *results)
 {
-    int ret = 0;
+    g_autofree virPCIDevicePtr *todo = g_new0(virPCIDevicePtr, ndevs);
+    g_autofree int *todoResults = g_new0(int, ndevs);
+    g_autofree virThread *threads = NULL;
+    virHostdevPCIParallelData data = {
+        .devs = todo, .mgr = mgr, .cb = cb, .results = todoResults,
+    };
+    size_t nthreads = 0;
+    size_t ngroups = 0;
     size_t i;
+    size_t j;
 
-    for (i = 0; i < virPCIDeviceListCount(pcidevs); i++) {
-        virPCIDevicePtr pci = virPCIDeviceListGet(pcidevs, i);
+    for (i = 0; i < ndevs; i++) {
+        results[i] = 1;
+        if (devs[i])
+            todo[data.ndevs++] = devs[i];
+    }
 
-        /* We can avoid looking up the actual device here, because performing
-         * a PCI reset on a device doesn't require any information other than
-         * the address, which 'pci' already contains */
-        VIR_DEBUG("Resetting PCI device %s", virPCIDeviceGetName(pci));
-        if (virPCIDeviceReset(pci, mgr->activePCIHostdevs,
-                              mgr->inactivePCIHostdevs) < 0) {
-            VIR_ERROR(_("Failed to reset PCI device: %s"),
-                      virGetLastErrorMessage());
-            ret = -1;
+    for (i = 0; i < data.ndevs; i++) {
+        todoResults[i] = 1;
+        if (virHostdevPCIParallelIsFirst(&data, i))
+            ngroups++;
+    }
+
+    if (virMutexInit(&data.lock) < 0) {
+        virReportSystemError(errno, "%s", _("unable to init mutex"));
+        return -1;
+    }
+
+    /* the calling thread works too */
+    ngroups = MIN(ngroups, VIR_HOSTDEV_PCI_PARALLEL_THREADS);
+    if (ngroups > 1)
+        threads = g_new0(virThread, ngroups - 1);
+
+    for (i = 0; i + 1 < ngroups; i++) {
+        if (virThreadCreateFull(&threads[nthreads], true,
+                                virHostdevPCIParallelWorker, "hostdev-pci",
+                                false, &data) < 0) {
+            VIR_DEBUG("Unable to create PCI hostdev thread, continuing "
+                      "with %zu", nthreads + 1);
+            break;
         }
+        nthreads++;
     }
 
-    return ret;
+    virHostdevPCIParallelWorker(&data);
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    virMutexDestroy(&data.lock);
+
+    for (i = 0, j = 0; i < ndevs; i++) {
+        if (devs[i])
+            results[i] = todoResults[j++];
+    }
+
+    if (data.error) {
+        virErrorRestore(&data.error);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+virHostdevResetPCIDevice(virHostdevManagerPtr mgr,
+                         virPCIDevicePtr pci)
+{
+    /* We can avoid looking up the actual device here, because performing
+     * a PCI reset on a device doesn't require any information other than
+     * the address, which 'pci' already contains */
+    VIR_DEBUG("Resetting PCI device %s", virPCIDeviceGetName(pci));
+    if (virPCIDeviceReset(pci, mgr->activePCIHostdevs,
+                          mgr->inactivePCIHostdevs) < 0) {
+        VIR_ERROR(_("Failed to reset PCI device: %s"),
+                  virGetLastErrorMessage());
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Devices with @skip set (if not NULL) are not reset. Results of the
+ * individual resets are stored in @results (if not NULL), see
+ * virHostdevPCIRunParallel() */
+static int
+virHostdevResetAllPCIDevices(virHostdevManagerPtr mgr,
+                             virPCIDeviceListPtr pcidevs,
+                             const bool *skip,
+                             int *results)
+{
+    size_t ndevs = virPCIDeviceListCount(pcidevs);
+    g_autofree virPCIDevicePtr *devs = g_new0(virPCIDevicePtr, ndevs);
+    g_autofree int *tmp = NULL;
+    size_t i;
+
+    if (!results)
+        results = tmp = g_new0(int, ndevs);
+
+    for (i = 0; i < ndevs; i++) {
+        if (skip && skip[i])
+            continue;
+        devs[i] = virPCIDeviceListGet(pcidevs, i);
+    }
+
+    return virHostdevPCIRunParallel(mgr, devs, ndevs,
+                                    virHostdevResetPCIDevice, results);
+}
+
+static int
+virHostdevReattachPCIDevice(virHostdevManagerPtr mgr,
+                            virPCIDevicePtr actual)
+{
+    VIR_DEBUG("Reattaching managed PCI device %s",
+              virPCIDeviceGetName(actual));
+
+    /* The inactive list is updated by the caller once all devices
+     * are processed */
+    if (virPCIDeviceReattach(actual, mgr->activePCIHostdevs, NULL) < 0) {
+        VIR_ERROR(_("Failed to re-attach PCI device: %s"),
+                  virGetLastErrorMessage());
+        return -1;
+    }
+
+    return 0;
 }
 
 static void
 virHostdevReattachAllPCIDevices(virHostdevManagerPtr mgr,
                                 virPCIDeviceListPtr pcidevs)
 {
+    size_t ndevs = virPCIDeviceListCount(pcidevs);
+    g_autofree virPCIDevicePtr *devs = g_new0(virPCIDevicePtr, ndevs);
+    g_autofree int *results = g_new0(int, ndevs);
+    virErrorPtr orig_err;
     size_t i;
 
-    for (i = 0; i < virPCIDeviceListCount(pcidevs); i++) {
+    for (i = 0; i < ndevs; i++) {
         virPCIDevicePtr pci = virPCIDeviceListGet(pcidevs, i);
         virPCIDevicePtr actual;
 
@@ -657,20 +889,45 @@ virHostdevReattachAllPCIDevices(virHostdevManagerPtr mgr,
         if (!(actual = virPCIDeviceListFind(mgr->inactivePCIHostdevs, pci)))
             continue;
 
-        if (virPCIDeviceGetManaged(actual)) {
-            VIR_DEBUG("Reattaching managed PCI device %s",
-                      virPCIDeviceGetName(pci));
-            if (virPCIDeviceReattach(actual,
-                                     mgr->activePCIHostdevs,
-                                     mgr->inactivePCIHostdevs) < 0) {
-                VIR_ERROR(_("Failed to re-attach PCI device: %s"),
-                          virGetLastErrorMessage());
-            }
+        if (virPCIDeviceListFind(mgr->pooledPCIHostdevs, actual)) {
+            VIR_DEBUG("Keeping pooled PCI device %s bound to %s",
+                      virPCIDeviceGetName(actual),
+                      virPCIStubDriverTypeToString(virPCIDeviceGetStubDriver(actual)));
+        } else if (virPCIDeviceGetManaged(actual)) {
+            devs[i] = actual;
         } else {
             VIR_DEBUG("Not reattaching unmanaged PCI device %s",
                       virPCIDeviceGetName(actual));
         }
     }
+
+    virErrorPreserveLast(&orig_err);
+    ignore_value(virHostdevPCIRunParallel(mgr, devs, ndevs,
+                                          virHostdevReattachPCIDevice,
+                                          results));
+    virErrorRestore(&orig_err);
+
+    for (i = 0; i < ndevs; i++) {
+        if (results[i] != 0)
+            continue;
+
+        VIR_DEBUG("Removing PCI device %s from inactive list",
+                  virPCIDeviceGetName(devs[i]));
+        virPCIDeviceListDel(mgr->inactivePCIHostdevs, devs[i]);
+    }
+}
+
+static int
+virHostdevDetachPCIDevice(virHostdevManagerPtr mgr,
+                          virPCIDevicePtr pci)
+{
+    /* We can't look up the actual device because it has not been
+     * created yet: the caller will insert a copy of 'pci' into the
+     * list of inactive devices once all devices are processed, and
+     * that copy will be the actual device going forward */
+    VIR_DEBUG("Detaching managed PCI device %s",
+              virPCIDeviceGetName(pci));
+    return virPCIDeviceDetach(pci, mgr->activePCIHostdevs, NULL);
 }
 
 
@@ -685,7 +942,12 @@ virHostdevPreparePCIDevicesImpl(virHostdevManagerPtr mgr,
                                 unsigned int flags)
 {
     int last_processed_hostdev_vf = -1;
+    g_autofree virPCIDevicePtr *devs = NULL;
+    g_autofree int *results = NULL;
+    g_autofree bool *claimed = NULL;
+    size_t ndevs;
     size_t i;
+    int detached;
     int ret = -1;
     virPCIDeviceAddressPtr devAddr = NULL;
 
@@ -752,21 +1014,28 @@ virHostdevPreparePCIDevicesImpl(virHostdevManagerPtr mgr,
 
     /* Step 2: detach managed devices and make sure unmanaged devices
      *         have already been taken care of */
-    for (i = 0; i < virPCIDeviceListCount(pcidevs); i++) {
-        virPCIDevicePtr pci = virPCIDeviceListGet(pcidevs, i);
+    ndevs = virPCIDeviceListCount(pcidevs);
+    devs = g_new0(virPCIDevicePtr, ndevs);
+    results = g_new0(int, ndevs);
+    claimed = g_new0(bool, ndevs);
 
-        if (virPCIDeviceGetManaged(pci)) {
+    for (i = 0; i < ndevs; i++) {
+        virPCIDevicePtr pci = virPCIDeviceListGet(pcidevs, i);
 
-            /* We can't look up the actual device because it has not been
-             * created yet: virPCIDeviceDetach() will insert a copy of 'pci'
-             * into the list of inactive devices, and that copy will be the
-             * actual device going forward */
-            VIR_DEBUG("Detaching managed PCI device %s",
+        if (virPCIDeviceGetStubDriver(pci) == VIR_PCI_STUB_DRIVER_VFIO &&
+            virPCIDeviceListFind(mgr->readyPCIHostdevs, pci) &&
+            virPCIDeviceListFind(mgr->inactivePCIHostdevs, pci)) {
+            /* Idle pooled devices are bound to the stub driver and were
+             * reset when they were last released: claim them as they are.
+             * A device is no longer ready once claimed, so a failure
+             * below gets it reset before its next use. */
+            VIR_DEBUG("Claiming pooled PCI device %s",
                       virPCIDeviceGetName(pci));
-            if (virPCIDeviceDetach(pci,
-                                   mgr->activePCIHostdevs,
-                                   mgr->inactivePCIHostdevs) < 0)
-                goto reattachdevs;
+            virPCIDeviceListDel(mgr->readyPCIHostdevs, pci);
+            claimed[i] = true;
+        } else if (virPCIDeviceGetManaged(pci)) {
+            /* Managed devices are detached concurrently below */
+            devs[i] = pci;
         } else {
             g_autofree char *driverPath = NULL;
             g_autofree char *driverName = NULL;
@@ -816,12 +1085,31 @@ virHostdevPreparePCIDevicesImpl(virHostdevManagerPtr mgr,
         }
     }
 
+    detached = virHostdevPCIRunParallel(mgr, devs, ndevs,
+                                        virHostdevDetachPCIDevice, results);
+
+    /* Track all the devices which made it to the stub driver, including
+     * those detached before a failure so that they're reattached below */
+    for (i = 0; i < ndevs; i++) {
+        if (results[i] != 0 ||
+            virPCIDeviceListFind(mgr->inactivePCIHostdevs, devs[i]))
+            continue;
+
+        VIR_DEBUG("Adding PCI device %s to inactive list",
+                  virPCIDeviceGetName(devs[i]));
+        if (virPCIDeviceListAddCopy(mgr->inactivePCIHostdevs, devs[i]) < 0)
+            detached = -1;
+    }
+
+    if (detached < 0)
+        goto reattachdevs;
+
     /* At this point, all devices are attached to the stub driver and have
      * been marked as inactive */
 
     /* Step 3: Now that all the PCI hostdevs have been detached, we
      * can safely reset them */
-    if (virHostdevResetAllPCIDevices(mgr, pcidevs) < 0)
+    if (virHostdevResetAllPCIDevices(mgr, pcidevs, claimed, NULL) < 0)
         goto reattachdevs;
 
     /* Step 4: For SRIOV network devices, Now that we have detached the
@@ -970,6 +1258,7 @@ virHostdevReAttachPCIDevicesImpl(virHostdevManagerPtr mgr,
                                  int nhostdevs,
                                  const char *oldStateDir)
 {
+    g_autofree int *results = NULL;
     size_t i;
 
     virObjectLock(mgr->activePCIHostdevs);
@@ -1057,10 +1346,29 @@ virHostdevReAttachPCIDevicesImpl(virHostdevManagerPtr mgr,
     }
 
     /* Step 4: perform a PCI Reset on all devices */
-    virHostdevResetAllPCIDevices(mgr, pcidevs);
+    results = g_new0(int, virPCIDeviceListCount(pcidevs));
+    virHostdevResetAllPCIDevices(mgr, pcidevs, NULL, results);
+
+    /* Step 5: Pooled devices which were reset successfully stay bound
+     *         to the stub driver, ready to be claimed again */
+    for (i = 0; i < virPCIDeviceListCount(pcidevs); i++) {
+        virPCIDevicePtr pci = virPCIDeviceListGet(pcidevs, i);
+
+        if (results[i] != 0 ||
+            !virPCIDeviceListFind(mgr->pooledPCIHostdevs, pci))
+            continue;
 
-    /* Step 5: Reattach managed devices to their host drivers; unmanaged
-     *         devices don't need to be processed further */
+        VIR_DEBUG("Returning PCI device %s to the pool",
+                  virPCIDeviceGetName(pci));
+        if (virPCIDeviceListAddCopy(mgr->readyPCIHostdevs, pci) < 0) {
+            VIR_ERROR(_("Failed to return PCI device %s to the pool: %s"),
+                      virPCIDeviceGetName(pci), virGetLastErrorMessage());
+            virResetLastError();
+        }
+    }
+
+    /* Step 6: Reattach managed devices to their host drivers; unmanaged
+     *         and pooled devices don't need to be processed further */
     virHostdevReattachAllPCIDevices(mgr, pcidevs);
 
     virObjectUnlock(mgr->activePCIHostdevs);
@@ -2057,6 +2365,10 @@ virHostdevPCINodeDeviceReAttach(virHostdevManagerPtr mgr,
     virPCIDeviceSetRemoveSlot(pci, true);
     virPCIDeviceSetReprobe(pci, true);
 
+    /* A pooled device given back to the host is detached and reset
+     * again by its next user */
+    virPCIDeviceListDel(mgr->readyPCIHostdevs, pci);
+
     if (virPCIDeviceReattach(pci, mgr->activePCIHostdevs,
                              mgr->inactivePCIHostdevs) < 0)
         goto cleanup;
@@ -2089,6 +2401,164 @@ virHostdevPCINodeDeviceReset(virHostdevManagerPtr mgr,
     return ret;
 }
 
+/* Returns 1 if @pci was left alone because it is bound to its stub
+ * driver already: it might be assigned to a running domain the daemon
+ * has not reconnected to yet, so it must not be reset here. It is
+ * detached and reset by its next user instead. */
+static int
+virHostdevPoolPCIDevice(virHostdevManagerPtr mgr,
+                        virPCIDevicePtr pci)
+{
+    g_autofree char *driverPath = NULL;
+    g_autofree char *driverName = NULL;
+
+    if (virPCIDeviceGetDriverPathAndName(pci, &driverPath, &driverName) < 0)
+        return -1;
+
+    if (STREQ_NULLABLE(driverName,
+                       virPCIStubDriverTypeToString(virPCIDeviceGetStubDriver(pci)))) {
+        VIR_DEBUG("Pooled PCI device %s is bound to %s already",
+                  virPCIDeviceGetName(pci), driverName);
+        return 1;
+    }
+
+    VIR_DEBUG("Binding pooled PCI device %s to %s",
+              virPCIDeviceGetName(pci),
+              virPCIStubDriverTypeToString(virPCIDeviceGetStubDriver(pci)));
+
+    if (virPCIDeviceDetach(pci, mgr->activePCIHostdevs, NULL) < 0)
+        return -1;
+
+    return virPCIDeviceReset(pci, mgr->activePCIHostdevs,
+                             mgr->inactivePCIHostdevs);
+}
+
+
+/**
+ * virHostdevManagerSetPCIPool:
+ * @mgr: hostdev manager
+ * @addrs: NULL terminated list of PCI addresses, or NULL
+ *
+ * Makes the PCI devices at @addrs the VFIO pool of @mgr. Devices in
+ * the pool are bound to vfio-pci and reset right away, unless they
+ * are in use by a domain or bound to vfio-pci already. Instead of
+ * being rebound to their host driver when a domain releases them,
+ * they are reset and kept bound to vfio-pci, so that the next domain
+ * can claim them without waiting for the driver unbind and another
+ * reset. Devices removed from the pool while idle are reattached to
+ * their host drivers.
+ *
+ * Failing to bind or reset a device is not fatal: the device stays
+ * in the pool and is detached and reset when a domain needs it, same
+ * as devices skipped above.
+ *
+ * Returns 0 on success, -1 if @addrs is invalid.
+ */
+int
+virHostdevManagerSetPCIPool(virHostdevManagerPtr mgr,
+                            char **addrs)
+{
+    g_autoptr(virPCIDeviceList) pool = NULL;
+    g_autoptr(virPCIDeviceList) removed = NULL;
+    g_autofree virPCIDevicePtr *devs = NULL;
+    g_autofree int *results = NULL;
+    size_t ndevs;
+    size_t i;
+    char **addr;
+
+    if (!(pool = virPCIDeviceListNew()) ||
+        !(removed = virPCIDeviceListNew()))
+        return -1;
+
+    for (addr = addrs; addr && *addr; addr++) {
+        virPCIDeviceAddress devAddr;
+        g_autoptr(virPCIDevice) actual = NULL;
+
+        if (virPCIDeviceAddressParse(*addr, &devAddr) < 0) {
+            virReportError(VIR_ERR_CONF_SYNTAX,
+                           _("Invalid PCI address '%s' in the VFIO pool"),
+                           *addr);
+            return -1;
+        }
+
+        if (!(actual = virPCIDeviceNew(devAddr.domain, devAddr.bus,
+                                       devAddr.slot, devAddr.function)))
+            return -1;
+
+        virPCIDeviceSetManaged(actual, true);
+        virPCIDeviceSetStubDriver(actual, VIR_PCI_STUB_DRIVER_VFIO);
+
+        if (virPCIDeviceListFind(pool, actual))
+            continue;
+
+        if (virPCIDeviceListAdd(pool, actual) < 0)
+            return -1;
+        actual = NULL;
+    }
+
+    virObjectLock(mgr->activePCIHostdevs);
+    virObjectLock(mgr->inactivePCIHostdevs);
+
+    /* Idle devices leaving the pool go back to their host drivers */
+    for (i = 0; i < virPCIDeviceListCount(mgr->pooledPCIHostdevs); i++) {
+        virPCIDevicePtr pci = virPCIDeviceListGet(mgr->pooledPCIHostdevs, i);
+
+        if (virPCIDeviceListFind(pool, pci))
+            continue;
+
+        virPCIDeviceListDel(mgr->readyPCIHostdevs, pci);
+        if (virPCIDeviceListFind(mgr->inactivePCIHostdevs, pci) &&
+            virPCIDeviceListAddCopy(removed, pci) < 0)
+            VIR_WARN("Unable to reattach PCI device %s leaving the pool",
+                     virPCIDeviceGetName(pci));
+    }
+
+    virObjectUnref(mgr->pooledPCIHostdevs);
+    mgr->pooledPCIHostdevs = virObjectRef(pool);
+
+    virHostdevReattachAllPCIDevices(mgr, removed);
+
+    /* Bind and reset the idle devices which are not ready yet */
+    ndevs = virPCIDeviceListCount(pool);
+    devs = g_new0(virPCIDevicePtr, ndevs);
+    results = g_new0(int, ndevs);
+
+    for (i = 0; i < ndevs; i++) {
+        virPCIDevicePtr pci = virPCIDeviceListGet(pool, i);
+
+        if (virPCIDeviceListFind(mgr->activePCIHostdevs, pci) ||
+            virPCIDeviceListFind(mgr->readyPCIHostdevs, pci))
+            continue;
+
+        devs[i] = pci;
+    }
+
+    if (virHostdevPCIRunParallel(mgr, devs, ndevs,
+                                 virHostdevPoolPCIDevice, results) < 0) {
+        VIR_WARN("Unable to prepare all devices of the VFIO pool: %s",
+                 virGetLastErrorMessage());
+        virResetLastError();
+    }
+
+    for (i = 0; i < ndevs; i++) {
+        if (results[i] != 0)
+            continue;
+
+        if ((!virPCIDeviceListFind(mgr->inactivePCIHostdevs, devs[i]) &&
+             virPCIDeviceListAddCopy(mgr->inactivePCIHostdevs, devs[i]) < 0) ||
+            virPCIDeviceListAddCopy(mgr->readyPCIHostdevs, devs[i]) < 0) {
+            VIR_WARN("Unable to add PCI device %s to the VFIO pool: %s",
+                     virPCIDeviceGetName(devs[i]), virGetLastErrorMessage());
+            virResetLastError();
+        }
+    }
+
+    virObjectUnlock(mgr->inactivePCIHostdevs);
+    virObjectUnlock(mgr->activePCIHostdevs);
+
+    return 0;
+}
+
 int
 virHostdevPrepareDomainDevices(virHostdevManagerPtr mgr,
                                const char *driver,
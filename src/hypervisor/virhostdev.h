@@ -50,6 +50,11 @@ struct _virHostdevManager {
 
     virPCIDeviceListPtr activePCIHostdevs;
     virPCIDeviceListPtr inactivePCIHostdevs;
+    /* Devices of the VFIO pool, kept bound to vfio-pci between uses, and
+     * those of them which are idle and were reset since their last use.
+     * Both are protected by the lock of activePCIHostdevs. */
+    virPCIDeviceListPtr pooledPCIHostdevs;
+    virPCIDeviceListPtr readyPCIHostdevs;
     virUSBDeviceListPtr activeUSBHostdevs;
     virSCSIDeviceListPtr activeSCSIHostdevs;
     virSCSIVHostDeviceListPtr activeSCSIVHostHostdevs;
@@ -64,6 +69,10 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(virHostdevManager, virObjectUnref);
 
 virHostdevManagerPtr virHostdevManagerGetDefault(void);
 int
+virHostdevManagerSetPCIPool(virHostdevManagerPtr mgr,
+                            char **addrs)
+    ATTRIBUTE_NONNULL(1);
+int
 virHostdevPreparePCIDevices(virHostdevManagerPtr hostdev_mgr,
                             const char *drv_name,
                             const char *dom_name,
@@ -1525,6 +1525,104 @@ virDomainShutdownFlags(virDomainPtr domain, unsigned int flags)
 }
 
 
+/**
+ * virDomainListShutdown:
+ * @doms: NULL terminated array of domains
+ * @timeout: seconds to wait for the domains to shut down, 0 means forever
+ * @flags: bitwise-OR of virDomainListShutdownFlags
+ *
+ * Shut down all domains provided by @doms and wait until they are no longer
+ * running. Note that all domains in @doms must share the same connection.
+ * This is mainly useful when the host itself is going down, because the
+ * shutdown requests are sent to all domains at once and their completion
+ * is tracked by the hypervisor driver rather than by polling from the
+ * client.
+ *
+ * Each domain is asked to shut down the same way virDomainShutdown() does.
+ * If any of them is still running when @timeout expires, the API fails,
+ * unless VIR_DOMAIN_LIST_SHUTDOWN_DESTROY is specified in which case the
+ * remaining domains are destroyed as if by virDomainDestroy().
+ *
+ * With VIR_DOMAIN_LIST_SHUTDOWN_MANAGED_SAVE, the domains are saved by
+ * virDomainManagedSave() instead, several of them at the same time, and
+ * @timeout must be 0. VIR_DOMAIN_LIST_SHUTDOWN_BYPASS_CACHE has the same
+ * meaning as VIR_DOMAIN_SAVE_BYPASS_CACHE for the individual saves.
+ *
+ * Domains which are not running are skipped.
+ *
+ * Returns 0 if all domains were stopped, -1 otherwise. The error reported
+ * in the latter case comes from the first domain which failed.
+ */
+int
+virDomainListShutdown(virDomainPtr *doms,
+                      unsigned int timeout,
+                      unsigned int flags)
+{
+    virConnectPtr conn = NULL;
+    virDomainPtr *nextdom = doms;
+    unsigned int ndoms = 0;
+    int ret = -1;
+
+    VIR_DEBUG("doms=%p, timeout=%u, flags=0x%x", doms, timeout, flags);
+
+    virResetLastError();
+
+    virCheckNonNullArgGoto(doms, cleanup);
+
+    if (!*doms) {
+        virReportError(VIR_ERR_INVALID_ARG,
+                       _("doms array in %s must contain at least one domain"),
+                       __FUNCTION__);
+        goto cleanup;
+    }
+
+    conn = doms[0]->conn;
+    virCheckConnectReturn(conn, -1);
+    virCheckReadOnlyGoto(conn->flags, cleanup);
+
+    VIR_EXCLUSIVE_FLAGS_GOTO(VIR_DOMAIN_LIST_SHUTDOWN_MANAGED_SAVE,
+                             VIR_DOMAIN_LIST_SHUTDOWN_DESTROY,
+                             cleanup);
+    VIR_REQUIRE_FLAG_GOTO(VIR_DOMAIN_LIST_SHUTDOWN_BYPASS_CACHE,
+                          VIR_DOMAIN_LIST_SHUTDOWN_MANAGED_SAVE,
+                          cleanup);
+
+    if ((flags & VIR_DOMAIN_LIST_SHUTDOWN_MANAGED_SAVE) && timeout) {
+        virReportInvalidArg(timeout, "%s",
+                            _("timeout is not supported with managed save"));
+        goto cleanup;
+    }
+
+    if (!conn->driver->domainListShutdown) {
+        virReportUnsupportedError();
+        goto cleanup;
+    }
+
+    while (*nextdom) {
+        virDomainPtr dom = *nextdom;
+
+        virCheckDomainGoto(dom, cleanup);
+
+        if (dom->conn != conn) {
+            virReportError(VIR_ERR_INVALID_ARG, "%s",
+                           _("domains in 'doms' array must belong to a "
+                             "single connection"));
+            goto cleanup;
+        }
+
+        ndoms++;
+        nextdom++;
+    }
+
+    ret = conn->driver->domainListShutdown(conn, doms, ndoms, timeout, flags);
+
+ cleanup:
+    if (ret < 0)
+        virDispatchError(conn);
+    return ret;
+}
+
+
 /**
  * virDomainReboot:
  * @domain: a domain object
@@ -2602,6 +2700,70 @@ virDomainGetXMLDesc(virDomainPtr domain, unsigned int flags)
 }
 
 
+/**
+ * virDomainGetXMLDigest:
+ * @domain: a domain object
+ * @generation: pointer to store the definition generation, or NULL
+ * @digest: pointer to store the digest, or NULL
+ * @flags: bitwise-OR of virDomainXMLFlags
+ *
+ * Provide a cheap way of telling whether the XML description of the
+ * domain changed, without formatting and transferring the XML itself.
+ *
+ * If @digest is not NULL, it is filled with the SHA-256 of the XML
+ * description of the domain as a hexadecimal string, which changes
+ * whenever the description does and is stable across restarts of the
+ * daemon. If @flags includes VIR_DOMAIN_XML_INACTIVE, the digest covers
+ * the configuration that will be used on the next boot of a persistent
+ * domain, and @digest is set to NULL for a transient domain; otherwise it
+ * covers the currently running domain. Only VIR_DOMAIN_XML_INACTIVE is
+ * supported; security-sensitive data is never included in the digest.
+ *
+ * If @generation is not NULL, it is filled with a counter which increases
+ * whenever the live or the persistent description of the domain changes.
+ * It is only comparable between calls made while the daemon keeps
+ * running, but lets clients tracking many domains fetch the XML of just
+ * those whose generation changed since their last poll.
+ *
+ * The same information is reported by the VIR_DOMAIN_STATS_DEFINITION
+ * group of virConnectGetAllDomainStats().
+ *
+ * Returns 0 on success, -1 in case of error. The caller must free() the
+ * returned @digest.
+ */
+int
+virDomainGetXMLDigest(virDomainPtr domain,
+                      unsigned long long *generation,
+                      char **digest,
+                      unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(domain, "generation=%p, digest=%p, flags=0x%x",
+                     generation, digest, flags);
+
+    virResetLastError();
+
+    virCheckDomainReturn(domain, -1);
+    conn = domain->conn;
+
+    if (conn->driver->domainGetXMLDigest) {
+        int ret;
+        ret = conn->driver->domainGetXMLDigest(domain, generation, digest,
+                                               flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(domain->conn);
+    return -1;
+}
+
+
 /**
  * virConnectDomainXMLFromNative:
  * @conn: a connection object
@@ -4249,6 +4411,110 @@ virDomainMigrateToURI3(virDomainPtr domain,
 }
 
 
+/**
+ * virDomainListMigrate:
+ * @doms: NULL terminated array of domains
+ * @dconnuri: URI for target libvirtd
+ * @params: (optional) migration parameters
+ * @nparams: (optional) number of migration parameters in @params
+ * @flags: bitwise-OR of virDomainMigrateFlags
+ *
+ * Migrate all domains provided by @doms from their current host to the
+ * destination host given by @dconnuri. Note that all domains in @doms must
+ * share the same connection. This is mainly useful for evacuating a host,
+ * because the migrations are scheduled by the source daemon rather than
+ * the client.
+ *
+ * Only peer-to-peer migration is supported, thus @flags must include
+ * VIR_MIGRATE_PEER2PEER. The parameters and flags apply to each migration
+ * in the same way they would in virDomainMigrateToURI3, except for the
+ * parameters describing a single domain (VIR_MIGRATE_PARAM_DEST_NAME,
+ * VIR_MIGRATE_PARAM_DEST_XML, and VIR_MIGRATE_PARAM_PERSIST_XML) which are
+ * rejected.
+ *
+ * At most VIR_MIGRATE_PARAM_PARALLEL_DOMAINS domains are migrated at the
+ * same time and VIR_MIGRATE_PARAM_BANDWIDTH, if set, limits the bandwidth
+ * used by all these migrations together. Domains with less memory are
+ * migrated first. The progress of the individual migrations is reported
+ * by the usual domain events.
+ *
+ * Returns 0 if all domains were migrated, -1 if any of the migrations
+ * failed. The error reported in the latter case comes from the first
+ * migration which failed.
+ */
+int
+virDomainListMigrate(virDomainPtr *doms,
+                     const char *dconnuri,
+                     virTypedParameterPtr params,
+                     unsigned int nparams,
+                     unsigned int flags)
+{
+    virConnectPtr conn = NULL;
+    virDomainPtr *nextdom = doms;
+    unsigned int ndoms = 0;
+    int ret = -1;
+
+    VIR_DEBUG("doms=%p, dconnuri=%s, params=%p, nparams=%u, flags=0x%x",
+              doms, NULLSTR(dconnuri), params, nparams, flags);
+    VIR_TYPED_PARAMS_DEBUG(params, nparams);
+
+    virResetLastError();
+
+    virCheckNonNullArgGoto(doms, cleanup);
+    virCheckNonNullArgGoto(dconnuri, cleanup);
+
+    if (!*doms) {
+        virReportError(VIR_ERR_INVALID_ARG,
+                       _("doms array in %s must contain at least one domain"),
+                       __FUNCTION__);
+        goto cleanup;
+    }
+
+    conn = doms[0]->conn;
+    virCheckConnectReturn(conn, -1);
+    virCheckReadOnlyGoto(conn->flags, cleanup);
+
+    VIR_EXCLUSIVE_FLAGS_GOTO(VIR_MIGRATE_TUNNELLED,
+                             VIR_MIGRATE_PARALLEL,
+                             cleanup);
+
+    if (!(flags & VIR_MIGRATE_PEER2PEER)) {
+        virReportInvalidArg(flags, "%s",
+                            _("only peer-to-peer migration is supported"));
+        goto cleanup;
+    }
+
+    if (!conn->driver->domainListMigrate) {
+        virReportUnsupportedError();
+        goto cleanup;
+    }
+
+    while (*nextdom) {
+        virDomainPtr dom = *nextdom;
+
+        virCheckDomainGoto(dom, cleanup);
+
+        if (dom->conn != conn) {
+            virReportError(VIR_ERR_INVALID_ARG, "%s",
+                           _("domains in 'doms' array must belong to a "
+                             "single connection"));
+            goto cleanup;
+        }
+
+        ndoms++;
+        nextdom++;
+    }
+
+    ret = conn->driver->domainListMigrate(conn, doms, ndoms, dconnuri,
+                                          params, nparams, flags);
+
+ cleanup:
+    if (ret < 0)
+        virDispatchError(conn);
+    return ret;
+}
+
+
 /*
  * Not for public use.  This function is part of the internal
  * implementation of migration in the remote case.
@@ -4930,6 +5196,56 @@ virDomainMigratePrepareTunnel3Params(virConnectPtr conn,
 }
 
 
+/*
+ * Not for public use.  This function is part of the internal
+ * implementation of migration in the remote case.
+ *
+ * Attaches @st as an additional data channel to the incoming tunnelled
+ * migration of @domain which was set up by
+ * virDomainMigratePrepareTunnel3Params with parallel channels.
+ */
+int
+virDomainMigrateTunnelChannel(virDomainPtr domain,
+                              virStreamPtr st,
+                              unsigned int channel,
+                              unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(domain, "stream=%p, channel=%u, flags=0x%x",
+                     st, channel, flags);
+
+    virResetLastError();
+
+    virCheckDomainReturn(domain, -1);
+    conn = domain->conn;
+
+    virCheckStreamGoto(st, error);
+    virCheckReadOnlyGoto(conn->flags, error);
+
+    if (conn != st->conn) {
+        virReportInvalidArg(conn, "%s",
+                            _("conn must match stream connection"));
+        goto error;
+    }
+
+    if (conn->driver->domainMigrateTunnelChannel) {
+        int rv;
+        rv = conn->driver->domainMigrateTunnelChannel(domain, st,
+                                                      channel, flags);
+        if (rv < 0)
+            goto error;
+        return rv;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(conn);
+    return -1;
+}
+
+
 /*
  * Not for public use.  This function is part of the internal
  * implementation of migration in the remote case.
@@ -8371,6 +8687,110 @@ virDomainDetachDeviceFlags(virDomainPtr domain,
 }
 
 
+/**
+ * virDomainAttachDevices:
+ * @domain: pointer to domain object
+ * @xml: XML description of the devices, as children of a <devices> element
+ * @flags: bitwise-OR of virDomainDeviceModifyFlags
+ *
+ * Attach all the virtual devices described by @xml to a domain. The flags
+ * have the same meaning as for virDomainAttachDeviceFlags() and apply to
+ * each of the devices. Hypervisors may use this to prepare the host for all
+ * the devices at once and to avoid the per call overhead of attaching them
+ * one by one, which makes a difference when attaching many devices.
+ *
+ * The devices are attached in the order they appear in @xml. The operation
+ * is not atomic: if attaching a device fails, the devices before it stay
+ * attached to the running domain, and an error is returned. The persistent
+ * configuration is only modified if all the devices were added to it.
+ *
+ * Returns 0 in case of success, -1 in case of failure.
+ */
+int
+virDomainAttachDevices(virDomainPtr domain,
+                       const char *xml,
+                       unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(domain, "xml=%s, flags=0x%x", xml, flags);
+
+    virResetLastError();
+
+    virCheckDomainReturn(domain, -1);
+    conn = domain->conn;
+
+    virCheckNonNullArgGoto(xml, error);
+    virCheckReadOnlyGoto(conn->flags, error);
+
+    if (conn->driver->domainAttachDevices) {
+        int ret;
+        ret = conn->driver->domainAttachDevices(domain, xml, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(domain->conn);
+    return -1;
+}
+
+
+/**
+ * virDomainDetachDevices:
+ * @domain: pointer to domain object
+ * @xml: XML description of the devices, as children of a <devices> element
+ * @flags: bitwise-OR of virDomainDeviceModifyFlags
+ *
+ * Detach all the virtual devices described by @xml from a domain. The flags
+ * have the same meaning as for virDomainDetachDeviceFlags() and apply to
+ * each of the devices, and so do the remarks about asynchronous removal
+ * and matching of devices given there.
+ *
+ * The devices are detached in the order they appear in @xml. The operation
+ * is not atomic: if detaching a device fails, the removal of the devices
+ * before it has already been requested, and an error is returned. The
+ * persistent configuration is only modified if all the devices were removed
+ * from it.
+ *
+ * Returns 0 in case of success, -1 in case of failure.
+ */
+int
+virDomainDetachDevices(virDomainPtr domain,
+                       const char *xml,
+                       unsigned int flags)
+{
+    virConnectPtr conn;
+
+    VIR_DOMAIN_DEBUG(domain, "xml=%s, flags=0x%x", xml, flags);
+
+    virResetLastError();
+
+    virCheckDomainReturn(domain, -1);
+    conn = domain->conn;
+
+    virCheckNonNullArgGoto(xml, error);
+    virCheckReadOnlyGoto(conn->flags, error);
+
+    if (conn->driver->domainDetachDevices) {
+        int ret;
+        ret = conn->driver->domainDetachDevices(domain, xml, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(domain->conn);
+    return -1;
+}
+
+
 /**
  * virDomainUpdateDeviceFlags:
  * @domain: pointer to domain object
@@ -11632,6 +12052,25 @@ virConnectGetDomainCapabilities(virConnectPtr conn,
  *     "perf.emulation_faults" - The count of emulation faults as unsigned
  *                               long long. It is produced by the
  *                               emulation_faults perf event
+ *     "perf.ipc" - instructions per cpu cycle as double. It is reported if
+ *                  both the instructions and cpu_cycles perf events are
+ *                  enabled.
+ *     "perf.cache_misses_pki" - cache misses per thousand instructions as
+ *                               double. It is reported if both the
+ *                               cache_misses and instructions perf events
+ *                               are enabled.
+ *     "perf.stalled_frontend_ratio" - share of cpu cycles stalled in the
+ *                                     frontend as double. It is reported if
+ *                                     both the stalled_cycles_frontend and
+ *                                     cpu_cycles perf events are enabled.
+ *     "perf.stalled_backend_ratio" - share of cpu cycles stalled in the
+ *                                    backend as double. It is reported if
+ *                                    both the stalled_cycles_backend and
+ *                                    cpu_cycles perf events are enabled.
+ *
+ *     Counts of events which had to share the hardware counters with
+ *     others are scaled up to the whole time they were enabled. The
+ *     derived metrics cover the time since the events were enabled.
  *
  * VIR_DOMAIN_STATS_IOTHREAD:
  *     Return IOThread statistics if available. IOThread polling is a
@@ -11692,6 +12131,90 @@ virConnectGetDomainCapabilities(virConnectPtr conn,
  *                       bytes consumed by @vcpus that passing through all
  *                       memory controllers, either local or remote controller.
  *
+ * VIR_DOMAIN_STATS_MONITOR:
+ *     Return statistics about the commands the hypervisor driver sent to the
+ *     management interface of the domain's emulator. Latencies are reported
+ *     as histograms with power-of-two microsecond buckets: bucket 0 counts
+ *     samples below 1us and bucket <b> samples in [2^(b-1), 2^b) us. Empty
+ *     buckets are omitted. The typed parameter keys are in this format:
+ *
+ *     "monitor.pending" - time in microseconds the command currently being
+ *                         processed has been waiting for a reply, as
+ *                         unsigned long long. 0 if no command is in flight.
+ *     "monitor.job_wait.count" - number of times a job for talking to the
+ *                                monitor was acquired, as unsigned long long.
+ *     "monitor.job_wait.<b>" - number of those which waited for the job a
+ *                              time in bucket <b>, as unsigned long long.
+ *     "monitor.command.count" - number of distinct commands reported.
+ *     "monitor.command.<num>.name" - name of command <num> as string.
+ *     "monitor.command.<num>.calls" - number of times the command was issued,
+ *                                     as unsigned long long.
+ *     "monitor.command.<num>.errors" - number of times the command failed,
+ *                                      as unsigned long long.
+ *     "monitor.command.<num>.latency.<b>" - number of calls whose reply
+ *                                           arrived within bucket <b>, as
+ *                                           unsigned long long.
+ *     "monitor.job_wait.<type>.count" - number of jobs of <type> acquired,
+ *                                       as unsigned long long. <type> is
+ *                                       one of "query", "destroy",
+ *                                       "suspend", "modify", "abort",
+ *                                       "migration_operation", "async",
+ *                                       "async_nested", "agent_query" and
+ *                                       "agent_modify". Types of jobs which
+ *                                       were never requested are omitted.
+ *     "monitor.job_wait.<type>.timeouts" - number of jobs of <type> which
+ *                                          could not be acquired in time,
+ *                                          as unsigned long long.
+ *     "monitor.job_wait.<type>.total" - total time in milliseconds spent
+ *                                       waiting for jobs of <type>, as
+ *                                       unsigned long long.
+ *     "monitor.job_wait.<type>.max" - longest time in milliseconds spent
+ *                                     waiting for a job of <type>, as
+ *                                     unsigned long long.
+ *
+ * VIR_DOMAIN_STATS_PRESSURE:
+ *     Return statistics about contention of host resources, as seen by the
+ *     control group of the domain and the ones of its vCPUs. Pressure stall
+ *     information is reported only on hosts whose kernel provides it. For
+ *     each <res> of "cpu", "memory" and "io" and each <kind> of "some" (at
+ *     least some tasks were stalled waiting for the resource) and "full" (all
+ *     non-idle tasks were stalled at the same time) the typed parameter keys
+ *     are in this format:
+ *
+ *     "pressure.<res>.<kind>.avg10" - percentage of the last 10 seconds spent
+ *                                     stalled, as double.
+ *     "pressure.<res>.<kind>.avg60" - same for the last 60 seconds, as double.
+ *     "pressure.<res>.<kind>.avg300" - same for the last 300 seconds, as
+ *                                      double.
+ *     "pressure.<res>.<kind>.total" - total stall time in microseconds, as
+ *                                     unsigned long long.
+ *     "pressure.throttle.periods" - number of CPU bandwidth enforcement
+ *                                   periods elapsed, as unsigned long long.
+ *     "pressure.throttle.throttled" - number of those periods in which the
+ *                                     domain was throttled, as unsigned long
+ *                                     long.
+ *     "pressure.throttle.time" - total time the domain was throttled in
+ *                                nanoseconds, as unsigned long long.
+ *     "pressure.vcpu.<num>.cpu.<kind>.*" - same as "pressure.cpu.<kind>.*"
+ *                                          for vCPU <num>.
+ *     "pressure.vcpu.<num>.throttle.*" - same as "pressure.throttle.*" for
+ *                                        vCPU <num>.
+ *
+ * VIR_DOMAIN_STATS_DEFINITION:
+ *     Return digests of the XML description of the domain, allowing clients
+ *     to fetch the XML only of the domains which changed. See
+ *     virDomainGetXMLDigest() for details. The typed parameter keys are in
+ *     this format:
+ *
+ *     "definition.generation" - counter increased whenever either the live
+ *                               or the persistent definition changes, as
+ *                               unsigned long long. It is only comparable
+ *                               while the daemon keeps running.
+ *     "definition.digest" - SHA-256 of the live XML description, as string.
+ *     "definition.config.digest" - SHA-256 of the XML description of the
+ *                                  persistent configuration, as string.
+ *                                  Missing for transient domains.
+ *
  * Note that entire stats groups or individual stat fields may be missing from
  * the output in case they are not supported by the given hypervisor, are not
  * applicable for the current state of the guest domain, or their retrieval
@@ -11898,6 +12421,82 @@ virDomainStatsRecordListFree(virDomainStatsRecordPtr *stats)
 }
 
 
+/**
+ * virConnectOpenDomainStatsFD:
+ * @conn: pointer to the hypervisor connection
+ * @flags: extra flags; not used yet, so callers should always pass 0
+ *
+ * Opens a read-only shared memory region into which the hypervisor driver
+ * periodically publishes the statistics of all running domains, so that
+ * collectors on the same host can read them without any further API
+ * calls. The statistics are the same as those of the domain 'stats' event
+ * and are refreshed at the same interval. The hypervisor has to be
+ * configured to publish them, e.g. by stats_shm in qemu.conf.
+ *
+ * The region starts with a header of this layout, in host byte order:
+ *
+ *   char magic[8]          "LVSTATS" followed by a NUL
+ *   uint32_t version       1
+ *   uint32_t headersize    offset of the first record
+ *   uint64_t seq           odd while the region is being updated
+ *   uint64_t size          size of the region
+ *   uint64_t datalen       bytes of records following the header
+ *   uint64_t timestamp     time of the sample, ms since the epoch
+ *   uint32_t nrecords      number of records
+ *
+ * Each record starts with uint32_t length of the record including this
+ * field, uint32_t number of parameters, the 16 bytes of the domain UUID
+ * and the domain name. Then each parameter follows as a uint32_t
+ * virTypedParameterType, the field name and the value, which is an
+ * int64_t for signed integers and booleans, uint64_t for unsigned
+ * integers, a double, or a string. Strings are stored as a uint32_t
+ * length followed by the bytes and a NUL. Nothing is aligned within
+ * the records.
+ *
+ * To read a consistent sample, readers load @seq, copy the data they need
+ * and load @seq again; if it was odd or has changed, they retry. The
+ * region only grows, and readers should map it again whenever @size
+ * exceeds their mapping.
+ *
+ * Since the region carries the statistics of all domains, it is only
+ * available on local connections and access control can't filter the
+ * domains it contains.
+ *
+ * Returns a file descriptor the caller must close, or -1 on error.
+ */
+int
+virConnectOpenDomainStatsFD(virConnectPtr conn,
+                            unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, flags=0x%x", conn, flags);
+
+    virResetLastError();
+
+    virCheckConnectReturn(conn, -1);
+
+    if (!VIR_DRV_SUPPORTS_FEATURE(conn->driver, conn,
+                                  VIR_DRV_FEATURE_FD_PASSING)) {
+        virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED, "%s",
+                       _("fd passing is not supported by this connection"));
+        goto error;
+    }
+
+    if (conn->driver->connectOpenDomainStatsFD) {
+        int ret;
+        ret = conn->driver->connectOpenDomainStatsFD(conn, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(conn);
+    return -1;
+}
+
+
 /**
  * virDomainGetFSInfo:
  * @dom: a domain object
@@ -47,6 +47,12 @@ VIR_LOG_INIT("libvirt.stream");
  * If a non-blocking data stream is required passed
  * VIR_STREAM_NONBLOCK for flags, otherwise pass 0.
  *
+ * Passing VIR_STREAM_LARGE_PACKETS makes virStreamSendAll(),
+ * virStreamRecvAll() and their sparse variants move data in chunks
+ * of several megabytes rather than 256 KiB, which lowers the per
+ * packet overhead of fast transfers. When talking to a server which
+ * does not accept such large packets, data is split up transparently.
+ *
  * Returns the new stream, or NULL upon error
  */
 virStreamPtr
@@ -71,6 +77,19 @@ virStreamNew(virConnectPtr conn,
 }
 
 
+/* Size of the chunks the *All helpers move data in */
+#define VIR_STREAM_LARGE_PACKET_SIZE (4 * 1024 * 1024)
+
+static size_t
+virStreamGetChunkSize(virStreamPtr stream)
+{
+    if (stream->flags & VIR_STREAM_LARGE_PACKETS)
+        return VIR_STREAM_LARGE_PACKET_SIZE;
+
+    return VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX;
+}
+
+
 /**
  * virStreamRef:
  * @stream: pointer to the stream
@@ -573,7 +592,7 @@ virStreamSendAll(virStreamPtr stream,
                  void *opaque)
 {
     g_autofree char *bytes = NULL;
-    size_t want = VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX;
+    size_t want;
     int ret = -1;
     VIR_DEBUG("stream=%p, handler=%p, opaque=%p", stream, handler, opaque);
 
@@ -588,6 +607,7 @@ virStreamSendAll(virStreamPtr stream,
         goto cleanup;
     }
 
+    want = virStreamGetChunkSize(stream);
     if (VIR_ALLOC_N(bytes, want) < 0)
         goto cleanup;
 
@@ -704,7 +724,7 @@ int virStreamSparseSendAll(virStreamPtr stream,
                            void *opaque)
 {
     g_autofree char *bytes = NULL;
-    size_t bufLen = VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX;
+    size_t bufLen;
     int ret = -1;
     unsigned long long dataLen = 0;
 
@@ -724,6 +744,7 @@ int virStreamSparseSendAll(virStreamPtr stream,
         goto cleanup;
     }
 
+    bufLen = virStreamGetChunkSize(stream);
     if (VIR_ALLOC_N(bytes, bufLen) < 0)
         goto cleanup;
 
@@ -843,7 +864,7 @@ virStreamRecvAll(virStreamPtr stream,
                  void *opaque)
 {
     g_autofree char *bytes = NULL;
-    size_t want = VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX;
+    size_t want;
     int ret = -1;
     VIR_DEBUG("stream=%p, handler=%p, opaque=%p", stream, handler, opaque);
 
@@ -859,6 +880,7 @@ virStreamRecvAll(virStreamPtr stream,
     }
 
 
+    want = virStreamGetChunkSize(stream);
     if (VIR_ALLOC_N(bytes, want) < 0)
         goto cleanup;
 
@@ -958,7 +980,7 @@ virStreamSparseRecvAll(virStreamPtr stream,
                        void *opaque)
 {
     g_autofree char *bytes = NULL;
-    size_t want = VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX;
+    size_t want;
     const unsigned int flags = VIR_STREAM_RECV_STOP_AT_HOLE;
     int ret = -1;
 
@@ -977,6 +999,7 @@ virStreamSparseRecvAll(virStreamPtr stream,
         goto cleanup;
     }
 
+    want = virStreamGetChunkSize(stream);
     if (VIR_ALLOC_N(bytes, want) < 0)
         goto cleanup;
 
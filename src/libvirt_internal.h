@@ -124,6 +124,26 @@ typedef enum {
      * Support for driver close callback rpc
      */
     VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK = 15,
+
+    /*
+     * Support for compact domain stats rpc with key dictionary and deltas
+     */
+    VIR_DRV_FEATURE_REMOTE_STATS_COMPACT = 16,
+
+    /*
+     * Support for raising the limit of concurrent calls per connection
+     */
+    VIR_DRV_FEATURE_REMOTE_PIPELINE = 17,
+
+    /*
+     * Support for embedding multiple calls in a single batch call
+     */
+    VIR_DRV_FEATURE_REMOTE_CALL_BATCH = 18,
+
+    /*
+     * Support for stream packets larger than the legacy payload size
+     */
+    VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PACKETS = 19,
 } virDrvFeature;
 
 
@@ -262,6 +282,11 @@ int virDomainMigratePrepareTunnel3Params(virConnectPtr conn,
                                          int *cookieoutlen,
                                          unsigned int flags);
 
+int virDomainMigrateTunnelChannel(virDomainPtr domain,
+                                  virStreamPtr st,
+                                  unsigned int channel,
+                                  unsigned int flags);
+
 int virDomainMigratePerform3Params(virDomainPtr domain,
                                    const char *dconnuri,
                                    virTypedParameterPtr params,
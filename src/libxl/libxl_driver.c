@@ -5695,6 +5695,321 @@ libxlDomainBlockStatsFlags(virDomainPtr dom,
     return ret;
 }
 
+#define LIBXL_DOMAIN_STATS_SUPPORTED \
+    (VIR_DOMAIN_STATS_STATE | \
+     VIR_DOMAIN_STATS_CPU_TOTAL | \
+     VIR_DOMAIN_STATS_BALLOON | \
+     VIR_DOMAIN_STATS_VCPU | \
+     VIR_DOMAIN_STATS_INTERFACE | \
+     VIR_DOMAIN_STATS_BLOCK)
+
+static int
+libxlDomainGetStatsVcpu(libxlDriverConfigPtr cfg,
+                        virDomainObjPtr vm,
+                        virTypedParamListPtr params)
+{
+    libxl_vcpuinfo *vcpuinfo;
+    int maxcpu, hostcpus;
+    size_t i;
+    int ret = -1;
+
+    if (virTypedParamListAddUInt(params, virDomainDefGetVcpus(vm->def),
+                                 "vcpu.current") < 0 ||
+        virTypedParamListAddUInt(params, virDomainDefGetVcpusMax(vm->def),
+                                 "vcpu.maximum") < 0)
+        return -1;
+
+    if (!(vcpuinfo = libxl_list_vcpu(cfg->ctx, vm->def->id, &maxcpu,
+                                     &hostcpus))) {
+        VIR_DEBUG("Failed to list vcpus of domain '%d'", vm->def->id);
+        return 0;
+    }
+
+    for (i = 0; i < maxcpu; i++) {
+        int state;
+
+        if (vcpuinfo[i].running)
+            state = VIR_VCPU_RUNNING;
+        else if (vcpuinfo[i].blocked)
+            state = VIR_VCPU_BLOCKED;
+        else
+            state = VIR_VCPU_OFFLINE;
+
+        if (virTypedParamListAddInt(params, state,
+                                    "vcpu.%u.state", vcpuinfo[i].vcpuid) < 0 ||
+            virTypedParamListAddULLong(params, vcpuinfo[i].vcpu_time,
+                                       "vcpu.%u.time", vcpuinfo[i].vcpuid) < 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    libxl_vcpuinfo_list_free(vcpuinfo, maxcpu);
+    return ret;
+}
+
+static int
+libxlDomainGetStatsInterface(virDomainObjPtr vm,
+                             virTypedParamListPtr params)
+{
+    size_t i;
+
+    if (virTypedParamListAddUInt(params, vm->def->nnets, "net.count") < 0)
+        return -1;
+
+    for (i = 0; i < vm->def->nnets; i++) {
+        virDomainNetDefPtr net = vm->def->nets[i];
+        virDomainInterfaceStatsStruct tmp;
+
+        if (!net->ifname)
+            continue;
+
+        if (virTypedParamListAddString(params, net->ifname,
+                                       "net.%zu.name", i) < 0)
+            return -1;
+
+        if (virNetDevTapInterfaceStats(net->ifname, &tmp,
+                                       !virDomainNetTypeSharesHostView(net)) < 0) {
+            virResetLastError();
+            continue;
+        }
+
+        if (virTypedParamListAddULLong(params, tmp.rx_bytes,
+                                       "net.%zu.rx.bytes", i) < 0 ||
+            virTypedParamListAddULLong(params, tmp.rx_packets,
+                                       "net.%zu.rx.pkts", i) < 0 ||
+            virTypedParamListAddULLong(params, tmp.rx_errs,
+                                       "net.%zu.rx.errs", i) < 0 ||
+            virTypedParamListAddULLong(params, tmp.rx_drop,
+                                       "net.%zu.rx.drop", i) < 0 ||
+            virTypedParamListAddULLong(params, tmp.tx_bytes,
+                                       "net.%zu.tx.bytes", i) < 0 ||
+            virTypedParamListAddULLong(params, tmp.tx_packets,
+                                       "net.%zu.tx.pkts", i) < 0 ||
+            virTypedParamListAddULLong(params, tmp.tx_errs,
+                                       "net.%zu.tx.errs", i) < 0 ||
+            virTypedParamListAddULLong(params, tmp.tx_drop,
+                                       "net.%zu.tx.drop", i) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+libxlDomainGetStatsBlock(virDomainObjPtr vm,
+                         virTypedParamListPtr params)
+{
+    size_t i;
+
+    if (virTypedParamListAddUInt(params, vm->def->ndisks, "block.count") < 0)
+        return -1;
+
+    for (i = 0; i < vm->def->ndisks; i++) {
+        virDomainDiskDefPtr disk = vm->def->disks[i];
+        libxlBlockStats blkstats;
+        int rc;
+
+        if (virTypedParamListAddString(params, disk->dst,
+                                       "block.%zu.name", i) < 0)
+            return -1;
+
+        if (virDomainDiskGetSource(disk) &&
+            virTypedParamListAddString(params, virDomainDiskGetSource(disk),
+                                       "block.%zu.path", i) < 0)
+            return -1;
+
+        /* Counters are only available for some backends, report the
+         * name and path of the other disks */
+        memset(&blkstats, 0, sizeof(blkstats));
+        rc = libxlDomainBlockStatsGatherSingle(vm, disk->dst, &blkstats);
+        VIR_FREE(blkstats.backend);
+        if (rc < 0) {
+            virResetLastError();
+            continue;
+        }
+
+        if (virTypedParamListAddULLong(params, blkstats.rd_req,
+                                       "block.%zu.rd.reqs", i) < 0 ||
+            virTypedParamListAddULLong(params, blkstats.rd_bytes,
+                                       "block.%zu.rd.bytes", i) < 0 ||
+            virTypedParamListAddULLong(params, blkstats.wr_req,
+                                       "block.%zu.wr.reqs", i) < 0 ||
+            virTypedParamListAddULLong(params, blkstats.wr_bytes,
+                                       "block.%zu.wr.bytes", i) < 0 ||
+            virTypedParamListAddULLong(params, blkstats.f_req,
+                                       "block.%zu.fl.reqs", i) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+/* Fills @params with the stats of @vm selected by @stats. @d_info is the
+ * entry of the domain in the list of all domains, NULL if there's none. */
+static int
+libxlDomainGetStatsParams(libxlDriverConfigPtr cfg,
+                          virDomainObjPtr vm,
+                          const libxl_dominfo *d_info,
+                          unsigned int stats,
+                          virTypedParamListPtr params)
+{
+    if (stats & VIR_DOMAIN_STATS_STATE) {
+        int state;
+        int reason;
+
+        state = virDomainObjGetState(vm, &reason);
+        if (virTypedParamListAddInt(params, state, "state.state") < 0 ||
+            virTypedParamListAddInt(params, reason, "state.reason") < 0)
+            return -1;
+    }
+
+    if (!virDomainObjIsActive(vm))
+        return 0;
+
+    if ((stats & VIR_DOMAIN_STATS_CPU_TOTAL) && d_info &&
+        virTypedParamListAddULLong(params, d_info->cpu_time, "cpu.time") < 0)
+        return -1;
+
+    if (stats & VIR_DOMAIN_STATS_BALLOON) {
+        if (d_info &&
+            virTypedParamListAddULLong(params, d_info->current_memkb,
+                                       "balloon.current") < 0)
+            return -1;
+        if (virTypedParamListAddULLong(params,
+                                       virDomainDefGetMemoryTotal(vm->def),
+                                       "balloon.maximum") < 0)
+            return -1;
+    }
+
+    if ((stats & VIR_DOMAIN_STATS_VCPU) &&
+        libxlDomainGetStatsVcpu(cfg, vm, params) < 0)
+        return -1;
+
+    if ((stats & VIR_DOMAIN_STATS_INTERFACE) &&
+        libxlDomainGetStatsInterface(vm, params) < 0)
+        return -1;
+
+    if ((stats & VIR_DOMAIN_STATS_BLOCK) &&
+        libxlDomainGetStatsBlock(vm, params) < 0)
+        return -1;
+
+    return 0;
+}
+
+static int
+libxlConnectGetAllDomainStats(virConnectPtr conn,
+                              virDomainPtr *doms,
+                              unsigned int ndoms,
+                              unsigned int stats,
+                              virDomainStatsRecordPtr **retStats,
+                              unsigned int flags)
+{
+    libxlDriverPrivatePtr driver = conn->privateData;
+    g_autoptr(libxlDriverConfig) cfg = NULL;
+    virDomainObjPtr *vms = NULL;
+    size_t nvms;
+    virDomainStatsRecordPtr *tmpstats = NULL;
+    libxl_dominfo *dominfo = NULL;
+    int ndominfo = 0;
+    int nstats = 0;
+    size_t i;
+    int j;
+    int ret = -1;
+    unsigned int lflags = flags & (VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE);
+
+    virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                  VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                  VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
+
+    if (virConnectGetAllDomainStatsEnsureACL(conn) < 0)
+        return -1;
+
+    if (stats == 0) {
+        stats = LIBXL_DOMAIN_STATS_SUPPORTED;
+    } else if (stats & ~LIBXL_DOMAIN_STATS_SUPPORTED) {
+        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS) {
+            virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED,
+                           _("Stats types bits 0x%x are not supported by this daemon"),
+                           stats & ~LIBXL_DOMAIN_STATS_SUPPORTED);
+            return -1;
+        }
+        stats &= LIBXL_DOMAIN_STATS_SUPPORTED;
+    }
+
+    if (ndoms) {
+        if (virDomainObjListConvert(driver->domains, conn, doms, ndoms, &vms,
+                                    &nvms,
+                                    virConnectGetAllDomainStatsCheckACLList,
+                                    lflags, true) < 0)
+            return -1;
+    } else {
+        if (virDomainObjListCollect(driver->domains, conn, &vms, &nvms,
+                                    virConnectGetAllDomainStatsCheckACLList,
+                                    lflags) < 0)
+            return -1;
+    }
+
+    cfg = libxlDriverConfigGet(driver);
+
+    /* The CPU time and memory of all domains come from a single query
+     * instead of one per domain */
+    if ((stats & (VIR_DOMAIN_STATS_CPU_TOTAL | VIR_DOMAIN_STATS_BALLOON)) &&
+        !(dominfo = libxl_list_domain(cfg->ctx, &ndominfo))) {
+        VIR_DEBUG("Failed to list domains with libxenlight");
+        ndominfo = 0;
+    }
+
+    tmpstats = g_new0(virDomainStatsRecordPtr, nvms + 1);
+
+    for (i = 0; i < nvms; i++) {
+        g_autoptr(virTypedParamList) params = g_new0(virTypedParamList, 1);
+        virDomainStatsRecordPtr tmp;
+        const libxl_dominfo *d_info = NULL;
+        int rc;
+
+        virObjectLock(vms[i]);
+
+        for (j = 0; j < ndominfo; j++) {
+            if (dominfo[j].domid == vms[i]->def->id) {
+                d_info = &dominfo[j];
+                break;
+            }
+        }
+
+        rc = libxlDomainGetStatsParams(cfg, vms[i], d_info, stats, params);
+        virObjectUnlock(vms[i]);
+
+        if (rc < 0)
+            goto cleanup;
+
+        tmp = g_new0(virDomainStatsRecord, 1);
+        if (!(tmp->dom = virGetDomain(conn, vms[i]->def->name,
+                                      vms[i]->def->uuid, vms[i]->def->id))) {
+            g_free(tmp);
+            goto cleanup;
+        }
+        tmp->nparams = virTypedParamListStealParams(params, &tmp->params);
+        tmpstats[nstats++] = tmp;
+    }
+
+    *retStats = g_steal_pointer(&tmpstats);
+    ret = nstats;
+
+ cleanup:
+    if (dominfo)
+        libxl_dominfo_list_free(dominfo, ndominfo);
+    virDomainStatsRecordListFree(tmpstats);
+    virObjectListFreeCount(vms, nvms);
+    return ret;
+}
+
 static int
 libxlConnectDomainEventRegisterAny(virConnectPtr conn, virDomainPtr dom, int eventID,
                                    virConnectDomainEventGenericCallback callback,
@@ -5752,7 +6067,7 @@ libxlConnectListAllDomains(virConnectPtr conn,
         return -1;
 
     return virDomainObjListExport(driver->domains, conn, domains,
-                                  virConnectListAllDomainsCheckACL, flags);
+                                  virConnectListAllDomainsCheckACLList, flags);
 }
 
 /* Which features are supported by this driver? */
@@ -5778,6 +6093,10 @@ libxlConnectSupportsFeature(virConnectPtr conn, int feature)
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_STATS_COMPACT:
+    case VIR_DRV_FEATURE_REMOTE_PIPELINE:
+    case VIR_DRV_FEATURE_REMOTE_CALL_BATCH:
+    case VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PACKETS:
     case VIR_DRV_FEATURE_XML_MIGRATABLE:
     default:
         return 0;
@@ -6733,6 +7052,7 @@ static virHypervisorDriver libxlHypervisorDriver = {
     .domainInterfaceStats = libxlDomainInterfaceStats, /* 1.3.2 */
     .domainBlockStats = libxlDomainBlockStats, /* 2.1.0 */
     .domainBlockStatsFlags = libxlDomainBlockStatsFlags, /* 2.1.0 */
+    .connectGetAllDomainStats = libxlConnectGetAllDomainStats, /* 6.7.0 */
     .connectDomainEventRegister = libxlConnectDomainEventRegister, /* 0.9.0 */
     .connectDomainEventDeregister = libxlConnectDomainEventDeregister, /* 0.9.0 */
     .domainManagedSave = libxlDomainManagedSave, /* 0.9.2 */
@@ -1486,7 +1486,7 @@ xenParseGeneralMeta(virConfPtr conf, virDomainDefPtr def, virCapsPtr caps)
         goto out;
 
     def->os.arch = capsdata->arch;
-    def->os.machine = g_strdup(capsdata->machinetype);
+    def->os.machine = virStringIntern(capsdata->machinetype);
 
     ret = 0;
  out:
@@ -1505,6 +1505,8 @@ xenParseConfigCommon(virConfPtr conf,
                      const char *nativeFormat,
                      virDomainXMLOptionPtr xmlopt)
 {
+    g_autofree char *emulator = NULL;
+
     if (xenParseGeneralMeta(conf, def, caps) < 0)
         return -1;
 
@@ -1523,8 +1525,9 @@ xenParseConfigCommon(virConfPtr conf,
     if (xenParseTimeOffset(conf, def) < 0)
         return -1;
 
-    if (xenConfigCopyStringOpt(conf, "device_model", &def->emulator) < 0)
+    if (xenConfigCopyStringOpt(conf, "device_model", &emulator) < 0)
         return -1;
+    def->emulator = virStringIntern(emulator);
 
     if (STREQ(nativeFormat, XEN_CONFIG_FORMAT_XL)) {
         if (xenParseVifList(conf, def, "vif") < 0)
@@ -345,6 +345,158 @@ virLockSpaceProtocolDispatchReleaseResource(virNetServerPtr server G_GNUC_UNUSED
 }
 
 
+static int
+virLockSpaceProtocolDispatchAcquireResources(virNetServerPtr server G_GNUC_UNUSED,
+                                             virNetServerClientPtr client,
+                                             virNetMessagePtr msg G_GNUC_UNUSED,
+                                             virNetMessageErrorPtr rerr,
+                                             virLockSpaceProtocolAcquireResourcesArgs *args)
+{
+    int rv = -1;
+    virLockDaemonClientPtr priv =
+        virNetServerClientGetPrivateData(client);
+    g_autofree virLockSpacePtr *lockspaces = NULL;
+    size_t nacquired = 0;
+    size_t i;
+
+    virMutexLock(&priv->lock);
+
+    virCheckFlagsGoto(0, cleanup);
+
+    if (priv->restricted) {
+        virReportError(VIR_ERR_OPERATION_DENIED, "%s",
+                       _("lock manager connection has been restricted"));
+        goto cleanup;
+    }
+
+    if (!priv->ownerId) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("lock owner details have not been registered"));
+        goto cleanup;
+    }
+
+    lockspaces = g_new0(virLockSpacePtr, args->resources.resources_len);
+
+    for (i = 0; i < args->resources.resources_len; i++) {
+        virLockSpaceProtocolResource *res = &args->resources.resources_val[i];
+        unsigned int newFlags = 0;
+
+        if (res->flags & ~(VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_SHARED |
+                           VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_AUTOCREATE)) {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("unsupported flags (0x%x) for resource %s"),
+                           res->flags, res->name);
+            goto cleanup;
+        }
+
+        if (!(lockspaces[i] = virLockDaemonFindLockSpace(lockDaemon, res->path))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Lockspace for path %s does not exist"),
+                           res->path);
+            goto cleanup;
+        }
+
+        if (res->flags & VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_SHARED)
+            newFlags |= VIR_LOCK_SPACE_ACQUIRE_SHARED;
+        if (res->flags & VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_AUTOCREATE)
+            newFlags |= VIR_LOCK_SPACE_ACQUIRE_AUTOCREATE;
+
+        if (virLockSpaceAcquireResource(lockspaces[i],
+                                        res->name,
+                                        priv->ownerPid,
+                                        newFlags) < 0)
+            goto cleanup;
+
+        nacquired++;
+    }
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0) {
+        virErrorPtr orig_err;
+
+        /* Either all the resources are acquired or none */
+        virErrorPreserveLast(&orig_err);
+        while (nacquired-- > 0) {
+            virLockSpaceProtocolResource *res = &args->resources.resources_val[nacquired];
+
+            ignore_value(virLockSpaceReleaseResource(lockspaces[nacquired],
+                                                     res->name,
+                                                     priv->ownerPid));
+        }
+        virErrorRestore(&orig_err);
+
+        virNetMessageSaveError(rerr);
+    }
+    virMutexUnlock(&priv->lock);
+    return rv;
+}
+
+
+static int
+virLockSpaceProtocolDispatchReleaseResources(virNetServerPtr server G_GNUC_UNUSED,
+                                             virNetServerClientPtr client,
+                                             virNetMessagePtr msg G_GNUC_UNUSED,
+                                             virNetMessageErrorPtr rerr,
+                                             virLockSpaceProtocolReleaseResourcesArgs *args)
+{
+    int rv = -1;
+    virLockDaemonClientPtr priv =
+        virNetServerClientGetPrivateData(client);
+    virErrorPtr orig_err = NULL;
+    size_t i;
+
+    virMutexLock(&priv->lock);
+
+    virCheckFlagsGoto(0, cleanup);
+
+    if (priv->restricted) {
+        virReportError(VIR_ERR_OPERATION_DENIED, "%s",
+                       _("lock manager connection has been restricted"));
+        goto cleanup;
+    }
+
+    if (!priv->ownerId) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("lock owner details have not been registered"));
+        goto cleanup;
+    }
+
+    /* Release as many resources as possible, reporting the first failure */
+    for (i = 0; i < args->resources.resources_len; i++) {
+        virLockSpaceProtocolResource *res = &args->resources.resources_val[i];
+        virLockSpacePtr lockspace;
+
+        if (!(lockspace = virLockDaemonFindLockSpace(lockDaemon, res->path))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Lockspace for path %s does not exist"),
+                           res->path);
+        } else if (virLockSpaceReleaseResource(lockspace,
+                                               res->name,
+                                               priv->ownerPid) == 0) {
+            continue;
+        }
+
+        if (!orig_err)
+            virErrorPreserveLast(&orig_err);
+    }
+
+    if (orig_err) {
+        virErrorRestore(&orig_err);
+        goto cleanup;
+    }
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    virMutexUnlock(&priv->lock);
+    return rv;
+}
+
+
 static int
 virLockSpaceProtocolDispatchRestrict(virNetServerPtr server G_GNUC_UNUSED,
                                      virNetServerClientPtr client,
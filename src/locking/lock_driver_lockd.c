@@ -597,6 +597,82 @@ static int virLockManagerLockDaemonAddResource(virLockManagerPtr lock,
 }
 
 
+/*
+ * Acquires or releases all the resources of @priv in a single call to the
+ * daemon. Returns 0 on success, -1 on error and -2 if the daemon doesn't
+ * know this call, leaving the resources untouched.
+ */
+static int
+virLockManagerLockDaemonBatchResources(virLockManagerLockDaemonPrivatePtr priv,
+                                       virNetClientPtr client,
+                                       virNetClientProgramPtr program,
+                                       int *counter,
+                                       bool acquire)
+{
+    virLockSpaceProtocolAcquireResourcesArgs acquireArgs;
+    virLockSpaceProtocolReleaseResourcesArgs releaseArgs;
+    g_autofree virLockSpaceProtocolResource *resources = NULL;
+    int rc;
+    size_t i;
+
+    if (priv->nresources > VIR_LOCK_SPACE_PROTOCOL_RESOURCES_MAX)
+        return -2;
+
+    resources = g_new0(virLockSpaceProtocolResource, priv->nresources);
+    for (i = 0; i < priv->nresources; i++) {
+        resources[i].path = priv->resources[i].lockspace;
+        resources[i].name = priv->resources[i].name;
+        resources[i].flags = priv->resources[i].flags;
+        if (!acquire)
+            resources[i].flags &=
+                ~(VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_SHARED |
+                  VIR_LOCK_SPACE_PROTOCOL_ACQUIRE_RESOURCE_AUTOCREATE);
+    }
+
+    if (acquire) {
+        memset(&acquireArgs, 0, sizeof(acquireArgs));
+        acquireArgs.resources.resources_len = priv->nresources;
+        acquireArgs.resources.resources_val = resources;
+
+        rc = virNetClientProgramCall(program,
+                                     client,
+                                     (*counter)++,
+                                     VIR_LOCK_SPACE_PROTOCOL_PROC_ACQUIRE_RESOURCES,
+                                     0, NULL, NULL, NULL,
+                                     (xdrproc_t)xdr_virLockSpaceProtocolAcquireResourcesArgs,
+                                     (char*)&acquireArgs,
+                                     (xdrproc_t)xdr_void, NULL);
+    } else {
+        memset(&releaseArgs, 0, sizeof(releaseArgs));
+        releaseArgs.resources.resources_len = priv->nresources;
+        releaseArgs.resources.resources_val = resources;
+
+        rc = virNetClientProgramCall(program,
+                                     client,
+                                     (*counter)++,
+                                     VIR_LOCK_SPACE_PROTOCOL_PROC_RELEASE_RESOURCES,
+                                     0, NULL, NULL, NULL,
+                                     (xdrproc_t)xdr_virLockSpaceProtocolReleaseResourcesArgs,
+                                     (char*)&releaseArgs,
+                                     (xdrproc_t)xdr_void, NULL);
+    }
+
+    if (rc < 0) {
+        /* A daemon started before the call was added, it will be replaced
+         * on its next restart */
+        if (virGetLastErrorCode() == VIR_ERR_RPC) {
+            VIR_DEBUG("Lock daemon doesn't support batched calls: %s",
+                      virGetLastErrorMessage());
+            virResetLastError();
+            return -2;
+        }
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int virLockManagerLockDaemonAcquire(virLockManagerPtr lock,
                                            const char *state G_GNUC_UNUSED,
                                            unsigned int flags,
@@ -627,9 +703,16 @@ static int virLockManagerLockDaemonAcquire(virLockManagerPtr lock,
         (*fd = virNetClientDupFD(client, false)) < 0)
         goto cleanup;
 
-    if (!(flags & VIR_LOCK_MANAGER_ACQUIRE_REGISTER_ONLY)) {
+    if (!(flags & VIR_LOCK_MANAGER_ACQUIRE_REGISTER_ONLY) &&
+        priv->nresources > 0) {
         size_t i;
-        for (i = 0; i < priv->nresources; i++) {
+        int rc;
+
+        if ((rc = virLockManagerLockDaemonBatchResources(priv, client, program,
+                                                         &counter, true)) == -1)
+            goto cleanup;
+
+        for (i = 0; rc == -2 && i < priv->nresources; i++) {
             virLockSpaceProtocolAcquireResourceArgs args;
 
             memset(&args, 0, sizeof(args));
@@ -673,6 +756,7 @@ static int virLockManagerLockDaemonRelease(virLockManagerPtr lock,
     virNetClientProgramPtr program = NULL;
     int counter = 0;
     int rv = -1;
+    int rc = -2;
     size_t i;
     virLockManagerLockDaemonPrivatePtr priv = lock->privateData;
 
@@ -684,7 +768,12 @@ static int virLockManagerLockDaemonRelease(virLockManagerPtr lock,
     if (!(client = virLockManagerLockDaemonConnect(lock, &program, &counter)))
         goto cleanup;
 
-    for (i = 0; i < priv->nresources; i++) {
+    if (priv->nresources > 0 &&
+        (rc = virLockManagerLockDaemonBatchResources(priv, client, program,
+                                                     &counter, false)) == -1)
+        goto cleanup;
+
+    for (i = 0; rc == -2 && i < priv->nresources; i++) {
         virLockSpaceProtocolReleaseResourceArgs args;
 
         memset(&args, 0, sizeof(args));
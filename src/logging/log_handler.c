@@ -43,6 +43,10 @@ VIR_LOG_INIT("logging.log_handler");
 
 #define DEFAULT_MODE 0600
 
+/* Most data relayed from a log pipe to its file at once, the size of a
+ * pipe buffer on Linux */
+#define VIR_LOG_HANDLER_RELAY_SIZE (64 * 1024)
+
 typedef struct _virLogHandlerLogFile virLogHandlerLogFile;
 typedef virLogHandlerLogFile *virLogHandlerLogFilePtr;
 
@@ -143,8 +147,6 @@ virLogHandlerDomainLogFileEvent(int watch,
 {
     virLogHandlerPtr handler = opaque;
     virLogHandlerLogFilePtr logfile;
-    char buf[1024];
-    ssize_t len;
 
     virObjectLock(handler);
     logfile = virLogHandlerGetLogFileFromWatch(handler, watch);
@@ -159,18 +161,8 @@ virLogHandlerDomainLogFileEvent(int watch,
         goto cleanup;
     }
 
- reread:
-    len = read(fd, buf, sizeof(buf));
-    if (len < 0) {
-        if (errno == EINTR)
-            goto reread;
-
-        virReportSystemError(errno, "%s",
-                             _("Unable to read from log pipe"));
-        goto error;
-    }
-
-    if (virRotatingFileWriterAppend(logfile->file, buf, len) != len)
+    if (virRotatingFileWriterAppendFromFD(logfile->file, fd,
+                                          VIR_LOG_HANDLER_RELAY_SIZE) < 0)
         goto error;
 
     if (events & VIR_EVENT_HANDLE_HANGUP)
@@ -437,8 +429,6 @@ virLogHandlerDomainOpenLogFile(virLogHandlerPtr handler,
 static void
 virLogHandlerDomainLogFileDrain(virLogHandlerLogFilePtr file)
 {
-    char buf[1024];
-    ssize_t len;
     struct pollfd pfd;
     int ret;
 
@@ -458,15 +448,9 @@ virLogHandlerDomainLogFileDrain(virLogHandlerLogFilePtr file)
         if (ret == 0)
             return;
 
-        len = read(file->pipefd, buf, sizeof(buf));
         file->drained = true;
-        if (len < 0) {
-            if (errno == EINTR)
-                continue;
-            return;
-        }
-
-        if (virRotatingFileWriterAppend(file->file, buf, len) != len)
+        if (virRotatingFileWriterAppendFromFD(file->file, file->pipefd,
+                                              VIR_LOG_HANDLER_RELAY_SIZE) <= 0)
             return;
     }
 }
@@ -601,6 +601,73 @@ static int lxcContainerResolveSymlinks(virDomainFSDefPtr fs, bool gentle)
     return 0;
 }
 
+/*
+ * Clones the pre-built root filesystem of a template for this start of the
+ * container. The template directory becomes the lower layer of an overlay
+ * whose upper layer holds the changes of the container until it stops, so
+ * a start doesn't copy or unpack anything.
+ */
+static int lxcContainerPrepareRootTemplate(virDomainDefPtr def,
+                                           virDomainFSDefPtr root,
+                                           const char *sec_mount_options)
+{
+    g_autofree char *dir = NULL;
+    g_autofree char *upper = NULL;
+    g_autofree char *work = NULL;
+    g_autofree char *dst = NULL;
+    g_autofree char *data = NULL;
+
+    if (lxcContainerResolveSymlinks(root, false) < 0)
+        return -1;
+
+    dir = g_strdup_printf("%s/%s.overlay", LXC_STATE_DIR, def->name);
+    upper = g_strdup_printf("%s/upper", dir);
+    work = g_strdup_printf("%s/work", dir);
+    dst = g_strdup_printf("%s/%s.root", LXC_STATE_DIR, def->name);
+
+    /* Changes left behind by a container that wasn't cleaned up */
+    if (virFileExists(dir) && virFileDeleteTree(dir) < 0)
+        return -1;
+
+    if (root->readonly) {
+        /* An overlay without an upper layer is read-only */
+        data = g_strdup_printf("lowerdir=%s%s",
+                               root->src->path, sec_mount_options);
+    } else {
+        if (virFileMakePath(upper) < 0 ||
+            virFileMakePath(work) < 0) {
+            virReportSystemError(errno,
+                                 _("Failed to create %s"), dir);
+            return -1;
+        }
+
+        data = g_strdup_printf("lowerdir=%s,upperdir=%s,workdir=%s%s",
+                               root->src->path, upper, work,
+                               sec_mount_options);
+    }
+
+    if (virFileMakePath(dst) < 0) {
+        virReportSystemError(errno,
+                             _("Failed to create %s"), dst);
+        return -1;
+    }
+
+    VIR_DEBUG("Mounting template %s as overlay on %s", root->src->path, dst);
+
+    if (mount("overlay", dst, "overlay", 0, data) < 0) {
+        virReportSystemError(errno,
+                             _("Failed to mount template %s as overlay on %s"),
+                             root->src->path, dst);
+        return -1;
+    }
+
+    root->type = VIR_DOMAIN_FS_TYPE_MOUNT;
+    g_free(root->src->path);
+    root->src->path = g_steal_pointer(&dst);
+
+    return 0;
+}
+
 static int lxcContainerPrepareRoot(virDomainDefPtr def,
                                    virDomainFSDefPtr root,
                                    const char *sec_mount_options)
@@ -613,6 +680,9 @@ static int lxcContainerPrepareRoot(virDomainDefPtr def,
     if (root->type == VIR_DOMAIN_FS_TYPE_MOUNT)
         return 0;
 
+    if (root->type == VIR_DOMAIN_FS_TYPE_TEMPLATE)
+        return lxcContainerPrepareRootTemplate(def, root, sec_mount_options);
+
     if (root->type == VIR_DOMAIN_FS_TYPE_FILE) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Unexpected root filesystem without loop device"));
@@ -352,9 +352,14 @@ virLXCDomainDefPostParse(virDomainDefPtr def,
         return -1;
 
     /* check for emulator and create a default one if needed */
-    if (!def->emulator &&
-        !(def->emulator = virDomainDefGetDefaultEmulator(def, caps)))
-        return -1;
+    if (!def->emulator) {
+        g_autofree char *emulator = NULL;
+
+        if (!(emulator = virDomainDefGetDefaultEmulator(def, caps)))
+            return -1;
+
+        def->emulator = virStringIntern(emulator);
+    }
 
     return 0;
 }
@@ -1660,6 +1660,10 @@ lxcConnectSupportsFeature(virConnectPtr conn, int feature)
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_STATS_COMPACT:
+    case VIR_DRV_FEATURE_REMOTE_PIPELINE:
+    case VIR_DRV_FEATURE_REMOTE_CALL_BATCH:
+    case VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PACKETS:
     case VIR_DRV_FEATURE_XML_MIGRATABLE:
     default:
         return 0;
@@ -2877,7 +2881,7 @@ lxcConnectListAllDomains(virConnectPtr conn,
         return -1;
 
     return virDomainObjListExport(driver->domains, conn, domains,
-                                  virConnectListAllDomainsCheckACL, flags);
+                                  virConnectListAllDomainsCheckACLList, flags);
 }
 
 
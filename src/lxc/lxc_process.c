@@ -163,6 +163,7 @@ static void virLXCProcessCleanup(virLXCDriverPtr driver,
     const virNetDevVPortProfile *vport = NULL;
     virLXCDriverConfigPtr cfg = virLXCDriverGetConfig(driver);
     virConnectPtr conn = NULL;
+    virDomainFSDefPtr root;
 
     VIR_DEBUG("Cleanup VM name=%s pid=%d reason=%d",
               vm->def->name, (int)vm->pid, (int)reason);
@@ -204,6 +205,19 @@ static void virLXCProcessCleanup(virLXCDriverPtr driver,
     virPidFileDelete(cfg->stateDir, vm->def->name);
     lxcProcessRemoveDomainStatus(cfg, vm);
 
+    if ((root = virDomainGetFilesystemForTarget(vm->def, "/")) &&
+        root->type == VIR_DOMAIN_FS_TYPE_TEMPLATE) {
+        g_autofree char *overlay = g_strdup_printf("%s/%s.overlay",
+                                                   cfg->stateDir, vm->def->name);
+
+        /* Discard the changes the container made to its template */
+        if (virFileExists(overlay) && virFileDeleteTree(overlay) < 0) {
+            VIR_WARN("Unable to remove %s: %s",
+                     overlay, virGetLastErrorMessage());
+            virResetLastError();
+        }
+    }
+
     virDomainObjSetState(vm, VIR_DOMAIN_SHUTOFF, reason);
     vm->pid = -1;
     vm->def->id = -1;
@@ -1667,6 +1667,32 @@ networkStartDhcpDaemon(virNetworkDriverStatePtr driver,
 }
 
 
+/* networkGetDhcpHostsIP:
+ *  Look for first address of @family that has dhcp defined and
+ *  store its index into @idx. We only support dhcp-host config on
+ *  one IPv4 subnetwork and on one IPv6 subnetwork.
+ *
+ *  Returns the address, or NULL if there is none.
+ */
+static virNetworkIPDefPtr
+networkGetDhcpHostsIP(virNetworkDefPtr def,
+                      int family,
+                      size_t *idx)
+{
+    virNetworkIPDefPtr ipdef;
+    size_t i;
+
+    for (i = 0; (ipdef = virNetworkDefGetIPByIndex(def, family, i)); i++) {
+        if (ipdef->nranges || ipdef->nhosts) {
+            *idx = i;
+            return ipdef;
+        }
+    }
+
+    return NULL;
+}
+
+
 /* networkRefreshDhcpDaemon:
  *  Update dnsmasq config files, then send a SIGHUP so that it rereads
  *  them.   This only works for the dhcp-hostsfile and the
@@ -1679,9 +1705,9 @@ networkRefreshDhcpDaemon(virNetworkDriverStatePtr driver,
                          virNetworkObjPtr obj)
 {
     virNetworkDefPtr def = virNetworkObjGetDef(obj);
-    size_t i;
+    size_t idx;
     pid_t dnsmasqPid;
-    virNetworkIPDefPtr ipdef, ipv4def, ipv6def;
+    virNetworkIPDefPtr ipv4def, ipv6def;
     g_autoptr(dnsmasqContext) dctx = NULL;
 
     /* if no IP addresses specified, nothing to do */
@@ -1697,25 +1723,8 @@ networkRefreshDhcpDaemon(virNetworkDriverStatePtr driver,
     if (!(dctx = dnsmasqContextNew(def->name, driver->dnsmasqStateDir)))
         return -1;
 
-    /* Look for first IPv4 address that has dhcp defined.
-     * We only support dhcp-host config on one IPv4 subnetwork
-     * and on one IPv6 subnetwork.
-     */
-    ipv4def = NULL;
-    for (i = 0;
-         (ipdef = virNetworkDefGetIPByIndex(def, AF_INET, i));
-         i++) {
-        if (!ipv4def && (ipdef->nranges || ipdef->nhosts))
-            ipv4def = ipdef;
-    }
-
-    ipv6def = NULL;
-    for (i = 0;
-         (ipdef = virNetworkDefGetIPByIndex(def, AF_INET6, i));
-         i++) {
-        if (!ipv6def && (ipdef->nranges || ipdef->nhosts))
-            ipv6def = ipdef;
-    }
+    ipv4def = networkGetDhcpHostsIP(def, AF_INET, &idx);
+    ipv6def = networkGetDhcpHostsIP(def, AF_INET6, &idx);
 
     if (ipv4def && (networkBuildDnsmasqDhcpHostsList(dctx, ipv4def) < 0))
         return -1;
@@ -1735,6 +1744,50 @@ networkRefreshDhcpDaemon(virNetworkDriverStatePtr driver,
 }
 
 
+/* networkAppendDhcpHost:
+ *  Append @host of @ipdef to the dnsmasq dhcp-hostsfile, then send
+ *  a SIGHUP so that dnsmasq rereads it. Unlike
+ *  networkRefreshDhcpDaemon this leaves the rest of the dnsmasq
+ *  config files untouched.
+ *
+ *  Returns 0 on success, -1 on failure.
+ */
+static int
+networkAppendDhcpHost(virNetworkDriverStatePtr driver,
+                      virNetworkObjPtr obj,
+                      virNetworkIPDefPtr ipdef,
+                      virNetworkDHCPHostDefPtr host)
+{
+    virNetworkDefPtr def = virNetworkObjGetDef(obj);
+    pid_t dnsmasqPid;
+    g_autoptr(dnsmasqContext) dctx = NULL;
+    g_autofree char *leasetime = NULL;
+
+    dnsmasqPid = virNetworkObjGetDnsmasqPid(obj);
+    if (dnsmasqPid <= 0 || (kill(dnsmasqPid, 0) < 0))
+        return networkRefreshDhcpDaemon(driver, obj);
+
+    if (!VIR_SOCKET_ADDR_VALID(&host->ip))
+        return 0;
+
+    VIR_INFO("Adding dhcp host to dnsmasq for network %s", def->bridge);
+    if (!(dctx = dnsmasqContextNew(def->name, driver->dnsmasqStateDir)))
+        return -1;
+
+    leasetime = networkBuildDnsmasqLeaseTime(host->lease);
+    if (dnsmasqAddDhcpHost(dctx, host->mac, &host->ip,
+                           host->name, host->id, leasetime,
+                           VIR_SOCKET_ADDR_IS_FAMILY(&ipdef->address,
+                                                     AF_INET6)) < 0)
+        return -1;
+
+    if (dnsmasqAppendDhcpHosts(dctx) < 0)
+        return -1;
+
+    return kill(dnsmasqPid, SIGHUP);
+}
+
+
 /* networkRestartDhcpDaemon:
  *
  * kill and restart dnsmasq, in order to update any config that is on
@@ -3685,7 +3738,9 @@ networkUpdate(virNetworkPtr net,
     virNetworkIPDefPtr ipdef;
     bool oldDhcpActive = false;
     bool needFirewallRefresh = false;
-
+    int families[] = { AF_INET, AF_INET6 };
+    size_t oldHostsIdx[G_N_ELEMENTS(families)];
+    ssize_t oldNHosts[G_N_ELEMENTS(families)];
 
     virCheckFlags(VIR_NETWORK_UPDATE_AFFECT_LIVE |
                   VIR_NETWORK_UPDATE_AFFECT_CONFIG,
@@ -3708,6 +3763,14 @@ networkUpdate(virNetworkPtr net,
         }
     }
 
+    /* remember where dhcp hosts live pre-modification, so that a
+     * single added host can be appended to the dnsmasq hostsfile */
+    for (i = 0; i < G_N_ELEMENTS(families); i++) {
+        oldNHosts[i] = -1;
+        if ((ipdef = networkGetDhcpHostsIP(def, families[i], &oldHostsIdx[i])))
+            oldNHosts[i] = ipdef->nhosts;
+    }
+
     /* VIR_NETWORK_UPDATE_AFFECT_CURRENT means "change LIVE if network
      * is active, else change CONFIG
      */
@@ -3811,9 +3874,13 @@ networkUpdate(virNetworkPtr net,
             /* if we previously weren't listening for dhcp and now we
              * are (or vice-versa) then we need to do a restart,
              * otherwise we just need to do a refresh (redo the config
-             * files and send SIGHUP)
+             * files and send SIGHUP). A single host added to one
+             * subnetwork can be appended to the existing hostsfile
+             * instead of rewriting all of it.
              */
             bool newDhcpActive = false;
+            virNetworkIPDefPtr addedIPDef = NULL;
+            virNetworkDHCPHostDefPtr addedHost = NULL;
 
             for (i = 0; (ipdef = virNetworkDefGetIPByIndex(def, AF_INET, i));
                  i++) {
@@ -3823,9 +3890,52 @@ networkUpdate(virNetworkPtr net,
                 }
             }
 
-            if ((newDhcpActive != oldDhcpActive &&
-                 networkRestartDhcpDaemon(driver, obj) < 0) ||
-                networkRefreshDhcpDaemon(driver, obj) < 0) {
+            if (newDhcpActive == oldDhcpActive &&
+                (command == VIR_NETWORK_UPDATE_COMMAND_ADD_FIRST ||
+                 command == VIR_NETWORK_UPDATE_COMMAND_ADD_LAST)) {
+                size_t changed = 0;
+
+                for (i = 0; i < G_N_ELEMENTS(families); i++) {
+                    size_t idx;
+
+                    ipdef = networkGetDhcpHostsIP(def, families[i], &idx);
+                    if (!ipdef && oldNHosts[i] < 0)
+                        continue;
+
+                    if (!ipdef || oldNHosts[i] < 0 || idx != oldHostsIdx[i]) {
+                        changed = 0;
+                        break;
+                    }
+
+                    if (ipdef->nhosts == (size_t) oldNHosts[i])
+                        continue;
+
+                    if (ipdef->nhosts != (size_t) oldNHosts[i] + 1) {
+                        changed = 0;
+                        break;
+                    }
+
+                    changed++;
+                    addedIPDef = ipdef;
+                }
+
+                if (changed != 1)
+                    addedIPDef = NULL;
+            }
+
+            if (addedIPDef) {
+                if (command == VIR_NETWORK_UPDATE_COMMAND_ADD_FIRST)
+                    addedHost = &addedIPDef->hosts[0];
+                else
+                    addedHost = &addedIPDef->hosts[addedIPDef->nhosts - 1];
+
+                if (networkAppendDhcpHost(driver, obj,
+                                          addedIPDef, addedHost) < 0 &&
+                    networkRefreshDhcpDaemon(driver, obj) < 0)
+                    goto cleanup;
+            } else if ((newDhcpActive != oldDhcpActive &&
+                        networkRestartDhcpDaemon(driver, obj) < 0) ||
+                       networkRefreshDhcpDaemon(driver, obj) < 0) {
                 goto cleanup;
             }
 
@@ -354,6 +354,9 @@ nodeDeviceGetXMLDesc(virNodeDevicePtr device,
     if (virNodeDeviceUpdateCaps(def) < 0)
         goto cleanup;
 
+    if (driver->fillDetails && driver->fillDetails(def) < 0)
+        goto cleanup;
+
     ret = virNodeDeviceDefFormat(def);
 
  cleanup:
@@ -443,10 +443,8 @@ dev_create(const char *udi)
     char *parent_key = NULL;
     virNodeDeviceObjPtr obj = NULL;
     virNodeDeviceDefPtr def = NULL;
-    virNodeDeviceDefPtr objdef;
     const char *name = hal_name(udi);
     int rv;
-    char *devicePath = NULL;
 
     nodeDeviceLock();
     ctx = DRV_STATE_HAL_CTX(driver);
@@ -468,15 +466,12 @@ dev_create(const char *udi)
         goto cleanup;
 
     /* Some devices don't have a path in sysfs, so ignore failure */
-    (void)get_str_prop(ctx, udi, "linux.sysfs_path", &devicePath);
+    (void)get_str_prop(ctx, udi, "linux.sysfs_path", &def->sysfs_path);
 
-    if (!(obj = virNodeDeviceObjListAssignDef(driver->devs, def))) {
-        VIR_FREE(devicePath);
+    /* The device list indexes the sysfs path when the definition is
+     * assigned, so it must be set before */
+    if (!(obj = virNodeDeviceObjListAssignDef(driver->devs, def)))
         goto failure;
-    }
-    objdef = virNodeDeviceObjGetDef(obj);
-
-    objdef->sysfs_path = devicePath;
 
     virNodeDeviceObjEndAPI(&obj);
 
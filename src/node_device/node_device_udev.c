@@ -40,6 +40,7 @@
 #include "virstring.h"
 #include "virnetdev.h"
 #include "virmdev.h"
+#include "virthread.h"
 #include "virutil.h"
 
 #include "configmake.h"
@@ -314,6 +315,9 @@ udevGenerateDeviceName(struct udev_device *device,
 }
 
 
+/* libpciaccess loads pci.ids into shared state on first use */
+static virMutex udevPCIIdsLock = VIR_MUTEX_INITIALIZER;
+
 static int
 udevTranslatePCIIds(unsigned int vendor,
                     unsigned int product,
@@ -331,6 +335,8 @@ udevTranslatePCIIds(unsigned int vendor,
     m.device_class_mask = 0;
     m.match_data = 0;
 
+    virMutexLock(&udevPCIIdsLock);
+
     /* pci_get_strings returns void */
     pci_get_strings(&m,
                     &device_name,
@@ -341,6 +347,34 @@ udevTranslatePCIIds(unsigned int vendor,
     *vendor_string = g_strdup(vendor_name);
     *product_string = g_strdup(device_name);
 
+    virMutexUnlock(&udevPCIIdsLock);
+
+    return 0;
+}
+
+
+/* Looking the names up in pci.ids is left until a definition is
+ * formatted, so that enumerating thousands of devices at startup
+ * doesn't have to do it for each of them. */
+static int
+udevFillDeviceDetails(virNodeDeviceDefPtr def)
+{
+    virNodeDevCapsDefPtr cap;
+
+    for (cap = def->caps; cap; cap = cap->next) {
+        virNodeDevCapPCIDevPtr pci_dev = &cap->data.pci_dev;
+
+        if (cap->data.type != VIR_NODE_DEV_CAP_PCI_DEV ||
+            pci_dev->vendor_name || pci_dev->product_name)
+            continue;
+
+        if (udevTranslatePCIIds(pci_dev->vendor,
+                                pci_dev->product,
+                                &pci_dev->vendor_name,
+                                &pci_dev->product_name) < 0)
+            return -1;
+    }
+
     return 0;
 }
 
@@ -381,13 +415,6 @@ udevProcessPCI(struct udev_device *device,
     if (udevGetUintSysfsAttr(device, "device", &pci_dev->product, 16) < 0)
         goto cleanup;
 
-    if (udevTranslatePCIIds(pci_dev->vendor,
-                            pci_dev->product,
-                            &pci_dev->vendor_name,
-                            &pci_dev->product_name) != 0) {
-        goto cleanup;
-    }
-
     if (udevGenerateDeviceName(device, def, NULL) != 0)
         goto cleanup;
 
@@ -1299,35 +1326,55 @@ udevSetParent(struct udev_device *device,
 }
 
 
-static int
-udevAddOneDevice(struct udev_device *device)
+/* Parses @device into a new definition. This doesn't depend on
+ * other node devices, so it is safe to call for multiple devices
+ * concurrently. */
+static virNodeDeviceDefPtr
+udevGetDeviceDef(struct udev_device *device)
 {
     virNodeDeviceDefPtr def = NULL;
-    virNodeDeviceObjPtr obj = NULL;
-    virNodeDeviceDefPtr objdef;
-    virObjectEventPtr event = NULL;
-    bool new_device = true;
-    int ret = -1;
 
     if (VIR_ALLOC(def) != 0)
-        goto cleanup;
+        goto error;
 
     def->sysfs_path = g_strdup(udev_device_get_syspath(device));
 
     if (udevGetStringProperty(device, "DRIVER", &def->driver) < 0)
-        goto cleanup;
+        goto error;
 
     if (VIR_ALLOC(def->caps) != 0)
-        goto cleanup;
+        goto error;
 
     if (udevGetDeviceType(device, &def->caps->data.type) != 0)
-        goto cleanup;
+        goto error;
 
     if (udevGetDeviceNodes(device, def) != 0)
-        goto cleanup;
+        goto error;
 
     if (udevGetDeviceDetails(device, def) != 0)
-        goto cleanup;
+        goto error;
+
+    return def;
+
+ error:
+    VIR_DEBUG("Discarding device %p %s", def,
+              def ? NULLSTR(def->sysfs_path) : "");
+    virNodeDeviceDefFree(def);
+    return NULL;
+}
+
+
+/* Adds @def parsed from @device to the list of node devices. Parents
+ * must be added before their children. Consumes @def. */
+static int
+udevAddOneDeviceDef(struct udev_device *device,
+                    virNodeDeviceDefPtr def)
+{
+    virNodeDeviceObjPtr obj = NULL;
+    virNodeDeviceDefPtr objdef;
+    virObjectEventPtr event = NULL;
+    bool new_device = true;
+    int ret = -1;
 
     if (udevSetParent(device, def) != 0)
         goto cleanup;
@@ -1368,28 +1415,67 @@ udevAddOneDevice(struct udev_device *device)
 
 
 static int
-udevProcessDeviceListEntry(struct udev *udev,
-                           struct udev_list_entry *list_entry)
+udevAddOneDevice(struct udev_device *device)
 {
-    struct udev_device *device;
-    const char *name = NULL;
-    int ret = -1;
+    virNodeDeviceDefPtr def;
 
-    name = udev_list_entry_get_name(list_entry);
+    if (!(def = udevGetDeviceDef(device)))
+        return -1;
 
-    device = udev_device_new_from_syspath(udev, name);
+    return udevAddOneDeviceDef(device, def);
+}
 
-    if (device != NULL) {
-        if (udevAddOneDevice(device) != 0) {
-            VIR_DEBUG("Failed to create node device for udev device '%s'",
-                      name);
-        }
-        ret = 0;
-    }
 
-    udev_device_unref(device);
+/* Upper limit of threads parsing devices found at startup */
+#define UDEV_ENUMERATE_THREADS 8
+/* Below this many devices per thread another one isn't worth it */
+#define UDEV_ENUMERATE_BATCH 64
 
-    return ret;
+typedef struct _udevEnumerateData udevEnumerateData;
+typedef udevEnumerateData *udevEnumerateDataPtr;
+struct _udevEnumerateData {
+    virMutex lock;
+    size_t next; /* protected by @lock */
+
+    struct udev *udev;
+    const char **paths;
+    struct udev_device **devices;
+    virNodeDeviceDefPtr *defs;
+    size_t ndevices;
+};
+
+
+static void
+udevEnumerateWorker(void *opaque)
+{
+    udevEnumerateDataPtr data = opaque;
+
+    while (true) {
+        size_t first;
+        size_t last;
+        size_t i;
+
+        virMutexLock(&data->lock);
+        first = data->next;
+        data->next = MIN(data->next + UDEV_ENUMERATE_BATCH, data->ndevices);
+        last = data->next;
+        virMutexUnlock(&data->lock);
+
+        if (first >= last)
+            break;
+
+        for (i = first; i < last; i++) {
+            if (!(data->devices[i] = udev_device_new_from_syspath(data->udev,
+                                                                  data->paths[i])))
+                continue;
+
+            if (!(data->defs[i] = udevGetDeviceDef(data->devices[i]))) {
+                VIR_DEBUG("Failed to create node device for udev device '%s': %s",
+                          data->paths[i], virGetLastErrorMessage());
+                virResetLastError();
+            }
+        }
+    }
 }
 
 
@@ -1417,11 +1503,21 @@ udevEnumerateAddMatches(struct udev_enumerate *udev_enumerate)
 }
 
 
+/*
+ * Devices are parsed in batches by up to UDEV_ENUMERATE_THREADS threads
+ * including the caller, which then adds them to the device list in the
+ * order udev listed them, so that parents are known before children.
+ */
 static int
 udevEnumerateDevices(struct udev *udev)
 {
     struct udev_enumerate *udev_enumerate = NULL;
     struct udev_list_entry *list_entry = NULL;
+    g_autofree virThread *threads = NULL;
+    udevEnumerateData data = { .udev = udev };
+    size_t nthreads = 0;
+    size_t nworkers;
+    size_t i;
     int ret = -1;
 
     udev_enumerate = udev_enumerate_new(udev);
@@ -1433,12 +1529,63 @@ udevEnumerateDevices(struct udev *udev)
 
     udev_list_entry_foreach(list_entry,
                             udev_enumerate_get_list_entry(udev_enumerate)) {
+        const char *name = udev_list_entry_get_name(list_entry);
+
+        if (VIR_APPEND_ELEMENT_COPY(data.paths, data.ndevices, name) < 0)
+            goto cleanup;
+    }
+
+    data.devices = g_new0(struct udev_device *, data.ndevices);
+    data.defs = g_new0(virNodeDeviceDefPtr, data.ndevices);
 
-        udevProcessDeviceListEntry(udev, list_entry);
+    if (virMutexInit(&data.lock) < 0) {
+        virReportSystemError(errno, "%s", _("unable to init mutex"));
+        goto cleanup;
+    }
+
+    nworkers = VIR_DIV_UP(data.ndevices, UDEV_ENUMERATE_BATCH);
+    nworkers = MIN(nworkers, UDEV_ENUMERATE_THREADS);
+    if (nworkers > 1)
+        threads = g_new0(virThread, nworkers - 1);
+
+    for (i = 0; i + 1 < nworkers; i++) {
+        if (virThreadCreateFull(&threads[nthreads], true, udevEnumerateWorker,
+                                "nodedev-enum", false, &data) < 0) {
+            VIR_DEBUG("Unable to create enumeration thread, continuing "
+                      "with %zu", nthreads + 1);
+            break;
+        }
+        nthreads++;
+    }
+
+    udevEnumerateWorker(&data);
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    virMutexDestroy(&data.lock);
+
+    for (i = 0; i < data.ndevices; i++) {
+        if (!data.defs[i])
+            continue;
+
+        if (udevAddOneDeviceDef(data.devices[i],
+                                g_steal_pointer(&data.defs[i])) != 0) {
+            VIR_DEBUG("Failed to create node device for udev device '%s'",
+                      data.paths[i]);
+        }
     }
 
     ret = 0;
  cleanup:
+    for (i = 0; data.devices && i < data.ndevices; i++) {
+        if (data.devices[i])
+            udev_device_unref(data.devices[i]);
+        virNodeDeviceDefFree(data.defs[i]);
+    }
+    g_free(data.devices);
+    g_free(data.defs);
+    g_free(data.paths);
     udev_enumerate_unref(udev_enumerate);
     return ret;
 }
@@ -1499,6 +1646,12 @@ udevHandleOneDevice(struct udev_device *device)
 
     VIR_DEBUG("udev action: '%s'", action);
 
+    /* Parents, ACS and IOMMU groups of PCI devices remembered by virpci
+     * may change with any PCI device coming or going */
+    if (STREQ_NULLABLE(udev_device_get_subsystem(device), "pci") &&
+        STRNEQ(action, "change"))
+        virPCITopologyInvalidate();
+
     if (STREQ(action, "add") || STREQ(action, "change"))
         return udevAddOneDevice(device);
 
@@ -1759,6 +1912,10 @@ nodeStateInitializeEnumerate(void *opaque)
     struct udev *udev = opaque;
     udevEventDataPtr priv = driver->privateData;
 
+    /* The udev monitor is running already, so changes of the host PCI
+     * topology are noticed from now on */
+    virPCITopologyEnable();
+
     /* Populate with known devices */
     if (udevEnumerateDevices(udev) != 0)
         goto error;
@@ -1839,6 +1996,7 @@ nodeStateInitialize(bool privileged,
     }
 
     driver->privileged = privileged;
+    driver->fillDetails = udevFillDeviceDetails;
 
     if (privileged) {
         driver->stateDir = g_strdup_printf("%s/libvirt/nodedev", RUNSTATEDIR);
@@ -57,6 +57,8 @@
 #include "virfile.h"
 #include "virsocketaddr.h"
 #include "virthreadpool.h"
+#include "virevent.h"
+#include "virbuffer.h"
 #include "configmake.h"
 #include "virtime.h"
 #include "virstring.h"
@@ -71,11 +73,17 @@ VIR_LOG_INIT("nwfilter.nwfilter_dhcpsnoop");
 # define LEASEFILE LEASEFILE_DIR "nwfilter.leases"
 # define TMPLEASEFILE LEASEFILE_DIR "nwfilter.ltmp"
 
+/* delay in ms for coalescing lease file updates into a single write */
+# define LEASEFILE_FLUSH_DELAY 1000
+
 struct virNWFilterSnoopState {
     /* lease file */
     int                  leaseFD;
     int                  nLeases; /* number of active leases */
     int                  wLeases; /* number of written leases */
+    virBuffer            journal; /* leases not yet written to the file */
+    int                  journalTimer; /* flushes the journal, or -1 */
+    bool                 journalTimerArmed;
     int                  nThreads; /* number of running threads */
     /* thread management */
     virHashTablePtr      snoopReqs;
@@ -83,6 +91,8 @@ struct virNWFilterSnoopState {
     virMutex             snoopLock;  /* protects SnoopReqs and IfNameToKey */
     virHashTablePtr      active;
     virMutex             activeLock; /* protects Active */
+    /* decodes the packets captured on all interfaces */
+    virThreadPoolPtr     decodePool;
 };
 
 # define virNWFilterSnoopLock() \
@@ -110,6 +120,9 @@ typedef virNWFilterSnoopReq *virNWFilterSnoopReqPtr;
 typedef struct _virNWFilterSnoopIPLease virNWFilterSnoopIPLease;
 typedef virNWFilterSnoopIPLease *virNWFilterSnoopIPLeasePtr;
 
+typedef struct _virNWFilterDHCPDecodeJob virNWFilterDHCPDecodeJob;
+typedef virNWFilterDHCPDecodeJob *virNWFilterDHCPDecodeJobPtr;
+
 typedef enum {
     THREAD_STATUS_NONE,
     THREAD_STATUS_OK,
@@ -139,7 +152,18 @@ struct _virNWFilterSnoopReq {
     virCond                              threadStatusCond;
 
     int                                  jobCompletionStatus;
-    /* the number of submitted jobs in the worker's queue */
+
+    /*
+     * Captured packets waiting to be decoded, oldest first. They are
+     * decoded in order by a single worker of the shared decode pool
+     * at a time, which is the case while @decoding is set.
+     */
+    virNWFilterDHCPDecodeJobPtr         *jobs;
+    size_t                               njobs;
+    bool                                 decoding;
+    virMutex                             jobLock; /* protects the above */
+    virCond                              jobCond; /* @decoding was cleared */
+
     /*
      * protect those members that can change while the
      * req is on the public SnoopReq hash and
@@ -227,9 +251,6 @@ G_STATIC_ASSERT(sizeof(struct _virNWFilterSnoopDHCPHdr) == 236);
 # define PCAP_READ_MAXERRS          25 /* retries on failing device */
 # define PCAP_FLOOD_TIMEOUT_MS      10 /* ms */
 
-typedef struct _virNWFilterDHCPDecodeJob virNWFilterDHCPDecodeJob;
-typedef virNWFilterDHCPDecodeJob *virNWFilterDHCPDecodeJobPtr;
-
 struct _virNWFilterDHCPDecodeJob {
     unsigned char packet[PCAP_PBUFSIZE];
     int caplen;
@@ -243,6 +264,9 @@ struct _virNWFilterDHCPDecodeJob {
 
 # define MAX_QUEUED_JOBS        (DHCP_PKT_BURST + 2 * DHCP_PKT_RATE)
 
+/* threads decoding packets, shared by all interfaces */
+# define DHCP_DECODE_WORKERS    4
+
 typedef struct _virNWFilterSnoopRateLimitConf virNWFilterSnoopRateLimitConf;
 typedef virNWFilterSnoopRateLimitConf *virNWFilterSnoopRateLimitConfPtr;
 
@@ -278,12 +302,14 @@ static int virNWFilterSnoopReqLeaseDel(virNWFilterSnoopReqPtr req,
 static void virNWFilterSnoopReqLock(virNWFilterSnoopReqPtr req);
 static void virNWFilterSnoopReqUnlock(virNWFilterSnoopReqPtr req);
 
-static void virNWFilterSnoopLeaseFileLoad(void);
+static void virNWFilterSnoopLeaseFileRefresh(void);
 static void virNWFilterSnoopLeaseFileSave(virNWFilterSnoopIPLeasePtr ipl);
 
 /* local variables */
 static struct virNWFilterSnoopState virNWFilterSnoopState = {
     .leaseFD = -1,
+    .journal = VIR_BUFFER_INITIALIZER,
+    .journalTimer = -1,
 };
 
 static const unsigned char dhcp_magic[4] = { 99, 130, 83, 99 };
@@ -569,6 +595,19 @@ virNWFilterSnoopReqNew(const char *ifkey)
         return NULL;
     }
 
+    if (virMutexInit(&req->jobLock) < 0) {
+        virCondDestroy(&req->threadStatusCond);
+        virMutexDestroy(&req->lock);
+        return NULL;
+    }
+
+    if (virCondInit(&req->jobCond) < 0) {
+        virMutexDestroy(&req->jobLock);
+        virCondDestroy(&req->threadStatusCond);
+        virMutexDestroy(&req->lock);
+        return NULL;
+    }
+
     virNWFilterSnoopReqGet(req);
     return g_steal_pointer(&req);
 }
@@ -598,6 +637,8 @@ virNWFilterSnoopReqFree(virNWFilterSnoopReqPtr req)
 
     virMutexDestroy(&req->lock);
     virCondDestroy(&req->threadStatusCond);
+    virMutexDestroy(&req->jobLock);
+    virCondDestroy(&req->jobCond);
     virFreeError(req->threadError);
 
     g_free(req);
@@ -1102,37 +1143,54 @@ virNWFilterSnoopDHCPOpen(const char *ifname, virMacAddr *mac,
 }
 
 /*
- * Worker function to decode the DHCP message and with that
- * also do the time-consuming work of instantiating the filters
+ * Worker function to decode the DHCP messages queued for @jobdata,
+ * a snoop request, and with that also do the time-consuming work
+ * of instantiating the filters
  */
-static void virNWFilterDHCPDecodeWorker(void *jobdata, void *opaque)
+static void virNWFilterDHCPDecodeWorker(void *jobdata,
+                                        void *opaque G_GNUC_UNUSED)
 {
-    virNWFilterSnoopReqPtr req = opaque;
-    g_autofree virNWFilterDHCPDecodeJobPtr job = jobdata;
-    virNWFilterSnoopEthHdrPtr packet = (virNWFilterSnoopEthHdrPtr)job->packet;
+    virNWFilterSnoopReqPtr req = jobdata;
 
-    if (virNWFilterSnoopDHCPDecode(req, packet,
-                                   job->caplen, job->fromVM) == -1) {
-        req->jobCompletionStatus = -1;
+    virMutexLock(&req->jobLock);
 
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Instantiation of rules failed on "
-                         "interface '%s'"), req->binding->portdevname);
+    while (req->njobs > 0) {
+        g_autofree virNWFilterDHCPDecodeJobPtr job = req->jobs[0];
+        virNWFilterSnoopEthHdrPtr packet;
+
+        VIR_DELETE_ELEMENT(req->jobs, 0, req->njobs);
+        virMutexUnlock(&req->jobLock);
+
+        packet = (virNWFilterSnoopEthHdrPtr)job->packet;
+        if (virNWFilterSnoopDHCPDecode(req, packet,
+                                       job->caplen, job->fromVM) == -1) {
+            req->jobCompletionStatus = -1;
+
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Instantiation of rules failed on "
+                             "interface '%s'"), req->binding->portdevname);
+        }
+        ignore_value(!!g_atomic_int_dec_and_test(job->qCtr));
+
+        virMutexLock(&req->jobLock);
     }
-    ignore_value(!!g_atomic_int_dec_and_test(job->qCtr));
+
+    req->decoding = false;
+    virCondBroadcast(&req->jobCond);
+    virMutexUnlock(&req->jobLock);
 }
 
 /*
- * Submit a job to the worker thread doing the time-consuming work...
+ * Submit a job to the worker threads doing the time-consuming work...
  */
 static int
-virNWFilterSnoopDHCPDecodeJobSubmit(virThreadPoolPtr pool,
+virNWFilterSnoopDHCPDecodeJobSubmit(virNWFilterSnoopReqPtr req,
                                     virNWFilterSnoopEthHdrPtr pep,
                                     int len, pcap_direction_t dir,
                                     int *qCtr)
 {
     virNWFilterDHCPDecodeJobPtr job;
-    int ret;
+    int ret = 0;
 
     if (len <= MIN_VALID_DHCP_PKT_SIZE || len > sizeof(job->packet))
         return 0;
@@ -1144,16 +1202,44 @@ virNWFilterSnoopDHCPDecodeJobSubmit(virThreadPoolPtr pool,
     job->fromVM = (dir == PCAP_D_IN);
     job->qCtr = qCtr;
 
-    ret = virThreadPoolSendJob(pool, 0, job);
+    virMutexLock(&req->jobLock);
 
-    if (ret == 0)
-        g_atomic_int_add(qCtr, 1);
-    else
-        g_free(job);
+    ignore_value(VIR_APPEND_ELEMENT(req->jobs, req->njobs, job));
+    g_atomic_int_add(qCtr, 1);
+
+    /* Whoever decodes the request's packets picks this one up too */
+    if (!req->decoding) {
+        if ((ret = virThreadPoolSendJob(virNWFilterSnoopState.decodePool,
+                                        0, req)) < 0) {
+            job = req->jobs[--req->njobs];
+            ignore_value(!!g_atomic_int_dec_and_test(qCtr));
+            g_free(job);
+        } else {
+            req->decoding = true;
+        }
+    }
+
+    virMutexUnlock(&req->jobLock);
 
     return ret;
 }
 
+
+/*
+ * Wait for the decoding of all the packets submitted for @req
+ * to finish.
+ */
+static void
+virNWFilterSnoopDHCPDecodeJobsWait(virNWFilterSnoopReqPtr req)
+{
+    virMutexLock(&req->jobLock);
+    while (req->decoding) {
+        if (virCondWait(&req->jobCond, &req->jobLock) < 0)
+            break;
+    }
+    virMutexUnlock(&req->jobLock);
+}
+
 /*
  * virNWFilterSnoopRateLimit -- limit the rate of jobs submitted to the
  *                              worker thread
@@ -1287,7 +1373,6 @@ virNWFilterDHCPSnoopThread(void *req0)
     int tmp = -1, rv, n, pollTo;
     size_t i;
     g_autofree char *threadkey = NULL;
-    virThreadPoolPtr worker = NULL;
     time_t last_displayed = 0, last_displayed_queue = 0;
     virNWFilterSnoopPcapConf pcapConf[] = {
         {
@@ -1342,14 +1427,10 @@ virNWFilterDHCPSnoopThread(void *req0)
         }
         tmp = virNetDevGetIndex(req->binding->portdevname, &ifindex);
         threadkey = g_strdup(req->threadkey);
-        worker = virThreadPoolNewFull(1, 1, 0,
-                                      virNWFilterDHCPDecodeWorker,
-                                      "dhcp-decode",
-                                      req);
     }
 
     /* let creator know how well we initialized */
-    if (error || !threadkey || tmp < 0 || !worker ||
+    if (error || !threadkey || tmp < 0 ||
         ifindex != req->ifindex) {
         virErrorPreserveLast(&req->threadError);
         req->threadStatus = THREAD_STATUS_FAIL;
@@ -1477,7 +1558,7 @@ virNWFilterDHCPSnoopThread(void *req0)
                     continue;
                 }
 
-                if (virNWFilterSnoopDHCPDecodeJobSubmit(worker, packet,
+                if (virNWFilterSnoopDHCPDecodeJobSubmit(req, packet,
                                                       hdr->caplen,
                                                       pcapConf[i].dir,
                                                       &pcapConf[i].qCtr) < 0) {
@@ -1508,7 +1589,7 @@ virNWFilterDHCPSnoopThread(void *req0)
     virNWFilterSnoopUnlock();
 
  cleanup:
-    virThreadPoolFree(worker);
+    virNWFilterSnoopDHCPDecodeJobsWait(req);
 
     virNWFilterSnoopReqPut(req);
 
@@ -1691,23 +1772,36 @@ virNWFilterSnoopLeaseFileOpen(void)
 }
 
 /*
- * Write a single lease to the given file.
- *
+ * Format a single lease as a line of the lease file.
  */
 static int
-virNWFilterSnoopLeaseFileWrite(int lfd, const char *ifkey,
-                               virNWFilterSnoopIPLeasePtr ipl)
+virNWFilterSnoopLeaseFileFormat(virBufferPtr buf, const char *ifkey,
+                                virNWFilterSnoopIPLeasePtr ipl)
 {
-    g_autofree char *lbuf = NULL;
     g_autofree char *ipstr = virSocketAddrFormat(&ipl->ipAddress);
     g_autofree char *dhcpstr = virSocketAddrFormat(&ipl->ipServer);
-    int len;
 
     if (!dhcpstr || !ipstr)
         return -1;
 
     /* time intf ip dhcpserver */
-    lbuf = g_strdup_printf("%u %s %s %s\n", ipl->timeout, ifkey, ipstr, dhcpstr);
+    virBufferAsprintf(buf, "%u %s %s %s\n", ipl->timeout, ifkey, ipstr, dhcpstr);
+    return 0;
+}
+
+/*
+ * Write the leases formatted into @buf to the given file with
+ * a single write and reset @buf.
+ */
+static int
+virNWFilterSnoopLeaseFileWrite(int lfd, virBufferPtr buf)
+{
+    g_autofree char *lbuf = virBufferContentAndReset(buf);
+    size_t len;
+
+    if (!lbuf)
+        return 0;
+
     len = strlen(lbuf);
 
     if (safewrite(lfd, lbuf, len) != len) {
@@ -1719,9 +1813,53 @@ virNWFilterSnoopLeaseFileWrite(int lfd, const char *ifkey,
     return 0;
 }
 
+static void
+virNWFilterSnoopLeaseJournalDisarm(void)
+{
+    if (!virNWFilterSnoopState.journalTimerArmed)
+        return;
+
+    virEventUpdateTimeout(virNWFilterSnoopState.journalTimer, -1);
+    virNWFilterSnoopState.journalTimerArmed = false;
+}
+
+/*
+ * Append the leases in the journal to the end of the lease file.
+ * Call this function with the SnoopLock held.
+ */
+static void
+virNWFilterSnoopLeaseJournalFlush(void)
+{
+    virNWFilterSnoopLeaseJournalDisarm();
+
+    if (virBufferUse(&virNWFilterSnoopState.journal) == 0)
+        return;
+
+    if (virNWFilterSnoopState.leaseFD < 0)
+        virNWFilterSnoopLeaseFileOpen();
+    if (virNWFilterSnoopState.leaseFD < 0) {
+        virBufferFreeAndReset(&virNWFilterSnoopState.journal);
+        return;
+    }
+
+    ignore_value(virNWFilterSnoopLeaseFileWrite(virNWFilterSnoopState.leaseFD,
+                                                &virNWFilterSnoopState.journal));
+}
+
+static void
+virNWFilterSnoopLeaseJournalTimer(int timer G_GNUC_UNUSED,
+                                  void *opaque G_GNUC_UNUSED)
+{
+    virNWFilterSnoopLock();
+    virNWFilterSnoopLeaseJournalFlush();
+    virNWFilterSnoopUnlock();
+}
+
 /*
  * Append a single lease to the end of the lease file.
- * To keep a limited number of dead leases, re-read the lease
+ * Changes arriving in a burst are collected in a journal that
+ * is written to the file at most once per LEASEFILE_FLUSH_DELAY.
+ * To keep a limited number of dead leases, rewrite the lease
  * file if the threshold of active leases versus written ones
  * exceeds a threshold.
  */
@@ -1732,16 +1870,22 @@ virNWFilterSnoopLeaseFileSave(virNWFilterSnoopIPLeasePtr ipl)
 
     virNWFilterSnoopLock();
 
-    if (virNWFilterSnoopState.leaseFD < 0)
-        virNWFilterSnoopLeaseFileOpen();
-    if (virNWFilterSnoopLeaseFileWrite(virNWFilterSnoopState.leaseFD,
-                                       req->ifkey, ipl) < 0)
+    if (virNWFilterSnoopLeaseFileFormat(&virNWFilterSnoopState.journal,
+                                        req->ifkey, ipl) < 0)
         goto error;
 
     /* keep dead leases at < ~95% of file size */
     if (g_atomic_int_add(&virNWFilterSnoopState.wLeases, 1) >=
-        g_atomic_int_get(&virNWFilterSnoopState.nLeases) * 20)
-        virNWFilterSnoopLeaseFileLoad();   /* load & refresh lease file */
+        g_atomic_int_get(&virNWFilterSnoopState.nLeases) * 20) {
+        virNWFilterSnoopLeaseFileRefresh();   /* rewrite the lease file */
+    } else if (virNWFilterSnoopState.journalTimer < 0) {
+        /* no event loop to coalesce the writes */
+        virNWFilterSnoopLeaseJournalFlush();
+    } else if (!virNWFilterSnoopState.journalTimerArmed) {
+        virEventUpdateTimeout(virNWFilterSnoopState.journalTimer,
+                              LEASEFILE_FLUSH_DELAY);
+        virNWFilterSnoopState.journalTimerArmed = true;
+    }
 
  error:
     virNWFilterSnoopUnlock();
@@ -1779,7 +1923,7 @@ virNWFilterSnoopPruneIter(const void *payload,
 }
 
 /*
- * Iterator to write all leases of a single request to a file.
+ * Iterator to format all leases of a single request into a buffer.
  * Call this function with the SnoopLock held.
  */
 static int
@@ -1788,14 +1932,14 @@ virNWFilterSnoopSaveIter(void *payload,
                          void *data)
 {
     virNWFilterSnoopReqPtr req = payload;
-    int tfd = *(int *)data;
+    virBufferPtr buf = data;
     virNWFilterSnoopIPLeasePtr ipl;
 
     /* protect req->start */
     virNWFilterSnoopReqLock(req);
 
     for (ipl = req->start; ipl; ipl = ipl->next)
-        ignore_value(virNWFilterSnoopLeaseFileWrite(tfd, req->ifkey, ipl));
+        ignore_value(virNWFilterSnoopLeaseFileFormat(buf, req->ifkey, ipl));
 
     virNWFilterSnoopReqUnlock(req);
     return 0;
@@ -1809,8 +1953,13 @@ virNWFilterSnoopSaveIter(void *payload,
 static void
 virNWFilterSnoopLeaseFileRefresh(void)
 {
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
     int tfd;
 
+    /* the journaled leases are part of what gets written below */
+    virBufferFreeAndReset(&virNWFilterSnoopState.journal);
+    virNWFilterSnoopLeaseJournalDisarm();
+
     if (virFileMakePathWithMode(LEASEFILE_DIR, 0700) < 0) {
         virReportError(errno, _("mkdir(\"%s\")"), LEASEFILE_DIR);
         return;
@@ -1832,7 +1981,13 @@ virNWFilterSnoopLeaseFileRefresh(void)
                          virNWFilterSnoopPruneIter, NULL);
         /* now save them */
         virHashForEach(virNWFilterSnoopState.snoopReqs,
-                       virNWFilterSnoopSaveIter, (void *)&tfd);
+                       virNWFilterSnoopSaveIter, &buf);
+    }
+
+    if (virNWFilterSnoopLeaseFileWrite(tfd, &buf) < 0) {
+        VIR_FORCE_CLOSE(tfd);
+        unlink(TMPLEASEFILE);
+        goto cleanup;
     }
 
     if (VIR_CLOSE(tfd) < 0) {
@@ -1867,6 +2022,9 @@ virNWFilterSnoopLeaseFileLoad(void)
     /* protect the lease file */
     virNWFilterSnoopLock();
 
+    /* the file must be complete for replaying it over the current leases */
+    virNWFilterSnoopLeaseJournalFlush();
+
     fp = fopen(LEASEFILE, "r");
     time(&now);
     while (fp && fgets(line, sizeof(line), fp)) {
@@ -2009,18 +2167,30 @@ virNWFilterDHCPSnoopInit(void)
     virNWFilterSnoopState.active = virHashCreate(0, NULL);
     virNWFilterSnoopState.snoopReqs =
         virHashCreate(0, virNWFilterSnoopReqRelease);
+    virNWFilterSnoopState.decodePool =
+        virThreadPoolNewFull(1, DHCP_DECODE_WORKERS, 0,
+                             virNWFilterDHCPDecodeWorker,
+                             "dhcp-decode", NULL);
 
     if (!virNWFilterSnoopState.ifnameToKey ||
         !virNWFilterSnoopState.snoopReqs ||
-        !virNWFilterSnoopState.active)
+        !virNWFilterSnoopState.active ||
+        !virNWFilterSnoopState.decodePool)
         goto error;
 
+    /* without an event loop the lease file is written synchronously */
+    virNWFilterSnoopState.journalTimer =
+        virEventAddTimeout(-1, virNWFilterSnoopLeaseJournalTimer, NULL, NULL);
+
     virNWFilterSnoopLeaseFileLoad();
     virNWFilterSnoopLeaseFileOpen();
 
     return 0;
 
  error:
+    virThreadPoolFree(virNWFilterSnoopState.decodePool);
+    virNWFilterSnoopState.decodePool = NULL;
+
     virHashFree(virNWFilterSnoopState.ifnameToKey);
     virNWFilterSnoopState.ifnameToKey = NULL;
 
@@ -2105,8 +2275,17 @@ virNWFilterDHCPSnoopShutdown(void)
     virNWFilterSnoopEndThreads();
     virNWFilterSnoopJoinThreads();
 
+    virThreadPoolFree(virNWFilterSnoopState.decodePool);
+    virNWFilterSnoopState.decodePool = NULL;
+
     virNWFilterSnoopLock();
 
+    virNWFilterSnoopLeaseJournalFlush();
+    if (virNWFilterSnoopState.journalTimer >= 0) {
+        virEventRemoveTimeout(virNWFilterSnoopState.journalTimer);
+        virNWFilterSnoopState.journalTimer = -1;
+    }
+
     virNWFilterSnoopLeaseFileClose();
     virHashFree(virNWFilterSnoopState.ifnameToKey);
     virHashFree(virNWFilterSnoopState.snoopReqs);
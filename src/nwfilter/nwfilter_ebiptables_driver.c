@@ -3343,7 +3343,9 @@ ebiptablesApplyNewRules(const char *ifname,
     ebtablesRemoveTmpRootChainFW(fw, true, ifname);
     ebtablesRemoveTmpRootChainFW(fw, false, ifname);
 
-    virFirewallStartTransaction(fw, 0);
+    /* The filter rules are mostly plain additions to the temporary
+     * chains, which can be applied at once per table */
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_BATCH);
 
     /* walk the list of rules and increase the priority
      * of rules in case the chain priority is of higher value;
@@ -37,6 +37,7 @@
 #include "datatypes.h"
 #include "virsocketaddr.h"
 #include "virstring.h"
+#include "vircrypto.h"
 
 #define VIR_FROM_THIS VIR_FROM_NWFILTER
 
@@ -71,6 +72,14 @@ static virNWFilterTechDriverPtr filter_tech_drivers[] = {
  */
 static virMutex updateMutex;
 
+/*
+ * Digest of the rules last applied to each interface, so that a
+ * filter update can skip interfaces whose rules it doesn't change.
+ * An interface isn't listed if the state of its rules is not known.
+ */
+static virMutex digestLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr instDigests;
+
 int virNWFilterTechDriversInit(bool privileged)
 {
     size_t i = 0;
@@ -78,6 +87,11 @@ int virNWFilterTechDriversInit(bool privileged)
     if (virMutexInitRecursive(&updateMutex) < 0)
         return -1;
 
+    if (!(instDigests = virHashNew(g_free))) {
+        virMutexDestroy(&updateMutex);
+        return -1;
+    }
+
     while (filter_tech_drivers[i]) {
         if (!(filter_tech_drivers[i]->flags & TECHDRV_FLAG_INITIALIZED))
             filter_tech_drivers[i]->init(privileged);
@@ -96,6 +110,11 @@ void virNWFilterTechDriversShutdown(void)
         i++;
     }
     virMutexDestroy(&updateMutex);
+
+    virMutexLock(&digestLock);
+    virHashFree(instDigests);
+    instDigests = NULL;
+    virMutexUnlock(&digestLock);
 }
 
 
@@ -244,6 +263,73 @@ virNWFilterInstReset(virNWFilterInstPtr inst)
 }
 
 
+/*
+ * Compute a digest of the rules of @inst, covering everything the
+ * tech driver builds the firewall rules of an interface from.
+ */
+static char *
+virNWFilterInstDigest(virNWFilterInstPtr inst)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    char *digest = NULL;
+    size_t i;
+
+    for (i = 0; i < inst->nrules; i++) {
+        virNWFilterRuleInstPtr rule = inst->rules[i];
+
+        virBufferAsprintf(&buf, "<inst chain='%s' chainpriority='%d' "
+                          "priority='%d'/>\n",
+                          rule->chainSuffix, rule->chainPriority,
+                          rule->priority);
+        if (virNWFilterRuleDefFormat(&buf, rule->def) < 0 ||
+            virNWFilterFormatParamAttributes(&buf, rule->vars, "") < 0)
+            return NULL;
+    }
+
+    if (virCryptoHashString(VIR_CRYPTO_HASH_SHA256,
+                            virBufferCurrentContent(&buf), &digest) < 0)
+        return NULL;
+
+    return digest;
+}
+
+
+static bool
+virNWFilterInstDigestMatches(const char *ifname,
+                             const char *digest)
+{
+    const char *old;
+    bool ret;
+
+    virMutexLock(&digestLock);
+    ret = instDigests && (old = virHashLookup(instDigests, ifname)) &&
+        STREQ(old, digest);
+    virMutexUnlock(&digestLock);
+
+    return ret;
+}
+
+
+/* Record @digest for @ifname, or forget about it if @digest is NULL */
+static void
+virNWFilterInstDigestUpdate(const char *ifname,
+                            char *digest)
+{
+    virMutexLock(&digestLock);
+    if (!instDigests) {
+        g_free(digest);
+    } else if (!digest) {
+        virHashRemoveEntry(instDigests, ifname);
+    } else if (virHashUpdateEntry(instDigests, ifname, digest) < 0) {
+        virResetLastError();
+        g_free(digest);
+        virHashRemoveEntry(instDigests, ifname);
+    }
+    virMutexUnlock(&digestLock);
+}
+
+
+
 
 static int
 virNWFilterDefToInst(virNWFilterDriverStatePtr driver,
@@ -512,6 +598,7 @@ virNWFilterDoInstantiate(virNWFilterTechDriverPtr techdriver,
     virNWFilterInst inst;
     bool instantiate = true;
     g_autofree char *buf = NULL;
+    g_autofree char *digest = NULL;
     virNWFilterVarValuePtr lv;
     const char *learning;
     bool reportIP = false;
@@ -600,11 +687,30 @@ virNWFilterDoInstantiate(virNWFilterTechDriverPtr techdriver,
     }
 
     if (instantiate) {
+        /* Failing to compute the digest only means that the rules
+         * can't be skipped next time */
+        if (!(digest = virNWFilterInstDigest(&inst)))
+            virResetLastError();
+
+        if (useNewFilter == INSTANTIATE_FOLLOW_NEWFILTER && digest &&
+            virNWFilterInstDigestMatches(binding->portdevname, digest)) {
+            VIR_DEBUG("Rules of %s are unchanged by the new filter",
+                      binding->portdevname);
+            *foundNewFilter = false;
+            goto error;
+        }
+
         if (virNWFilterLockIface(binding->portdevname) < 0)
             goto error;
 
         rc = techdriver->applyNewRules(binding->portdevname, inst.rules, inst.nrules);
 
+        if (rc == 0)
+            virNWFilterInstDigestUpdate(binding->portdevname,
+                                        g_steal_pointer(&digest));
+        else
+            virNWFilterInstDigestUpdate(binding->portdevname, NULL);
+
         if (teardownOld && rc == 0)
             techdriver->tearOldRules(binding->portdevname);
 
@@ -858,6 +964,9 @@ virNWFilterRollbackUpdateFilter(virNWFilterBindingDefPtr binding)
     else if (virNWFilterHasLearnReq(ifindex))
         return 0;
 
+    /* The digest was recorded for the rules being rolled back */
+    virNWFilterInstDigestUpdate(binding->portdevname, NULL);
+
     return techdriver->tearNewRules(binding->portdevname);
 }
 
@@ -911,6 +1020,7 @@ _virNWFilterTeardownFilter(const char *ifname)
         return -1;
 
     techdriver->allTeardown(ifname);
+    virNWFilterInstDigestUpdate(ifname, NULL);
 
     virNWFilterIPAddrMapDelIPAddr(ifname, NULL);
 
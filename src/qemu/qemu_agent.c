@@ -93,6 +93,12 @@ struct _qemuAgentMessage {
     /* id of the issued sync command */
     unsigned long long id;
     bool first;
+
+    /* Number of replies expected for several commands sent at once,
+     * which are collected in rxObjects instead of rxObject */
+    size_t nreplies;
+    virJSONValuePtr *rxObjects;
+    size_t nrxObjects;
 };
 
 
@@ -111,6 +117,10 @@ struct _qemuAgent {
     bool singleSync;
     bool inSync;
 
+    /* replies of commands sent by qemuAgentPrefetch which weren't used
+     * yet, keyed by command name */
+    virHashTablePtr prefetched;
+
     virDomainObjPtr vm;
 
     qemuAgentCallbacksPtr cb;
@@ -177,6 +187,7 @@ static void qemuAgentDispose(void *obj)
     if (agent->cb && agent->cb->destroy)
         (agent->cb->destroy)(agent, agent->vm);
     virCondDestroy(&agent->notify);
+    virHashFree(agent->prefetched);
     VIR_FREE(agent->buffer);
     g_main_context_unref(agent->context);
     virResetError(&agent->lastError);
@@ -304,6 +315,14 @@ qemuAgentIOProcessLine(qemuAgentPtr agent,
                     ret = 0;
                     goto cleanup;
                 }
+            } else if (msg->nreplies > 0) {
+                /* the agent answers commands in the order it got them */
+                if (VIR_APPEND_ELEMENT(msg->rxObjects, msg->nrxObjects, obj) < 0)
+                    goto cleanup;
+                if (msg->nrxObjects == msg->nreplies)
+                    msg->finished = true;
+                ret = 0;
+                goto cleanup;
             }
             msg->rxObject = obj;
             msg->finished = true;
@@ -747,6 +766,7 @@ qemuAgentNotifyCloseLocked(qemuAgentPtr agent)
 {
     if (agent) {
         agent->running = false;
+        qemuAgentPrefetchReset(agent);
 
         /* If there is somebody waiting for a message
          * wake him up. No message will arrive anyway. */
@@ -1092,6 +1112,14 @@ qemuAgentCommandFull(qemuAgentPtr agent,
         goto cleanup;
     }
 
+    if (agent->prefetched &&
+        !virJSONValueObjectHasKey(cmd, "arguments") &&
+        (*reply = virHashSteal(agent->prefetched, qemuAgentCommandName(cmd)))) {
+        VIR_DEBUG("Using prefetched reply of '%s'", qemuAgentCommandName(cmd));
+        ret = qemuAgentCheckError(cmd, *reply, report_unsupported);
+        goto cleanup;
+    }
+
     if (qemuAgentGuestSync(agent) < 0)
         goto cleanup;
 
@@ -1176,6 +1204,112 @@ qemuAgentMakeCommand(const char *cmdname,
     return NULL;
 }
 
+
+/**
+ * qemuAgentPrefetch:
+ * @agent: agent object
+ * @cmdnames: NULL terminated list of commands which take no arguments
+ *
+ * Sends all of @cmdnames to the guest agent at once after a single
+ * guest-sync and keeps their replies. The next call issuing one of the
+ * commands then uses the kept reply instead of another round trip to the
+ * guest. The agent executes commands in the order it receives them, so
+ * the replies are matched by their order. Replies which were not used
+ * have to be dropped by qemuAgentPrefetchReset().
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuAgentPrefetch(qemuAgentPtr agent,
+                  const char **cmdnames)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    qemuAgentMessage msg;
+    size_t ncmds = 0;
+    size_t i;
+    int ret = -1;
+
+    memset(&msg, 0, sizeof(msg));
+
+    qemuAgentPrefetchReset(agent);
+
+    for (ncmds = 0; cmdnames[ncmds]; ncmds++) {
+        g_autoptr(virJSONValue) cmd = NULL;
+        g_autofree char *cmdstr = NULL;
+
+        if (!(cmd = qemuAgentMakeCommand(cmdnames[ncmds], NULL)) ||
+            !(cmdstr = virJSONValueToString(cmd, false)))
+            return -1;
+
+        virBufferAsprintf(&buf, "%s" LINE_ENDING, cmdstr);
+    }
+
+    if (ncmds == 0)
+        return 0;
+
+    if (!agent->running) {
+        virReportError(VIR_ERR_AGENT_UNRESPONSIVE, "%s",
+                       _("Guest agent disappeared while executing command"));
+        return -1;
+    }
+
+    if (!agent->prefetched &&
+        !(agent->prefetched = virHashCreate(ncmds, virJSONValueHashFree)))
+        return -1;
+
+    if (qemuAgentGuestSync(agent) < 0)
+        return -1;
+
+    msg.txBuffer = virBufferContentAndReset(&buf);
+    msg.txLength = strlen(msg.txBuffer);
+    msg.nreplies = ncmds;
+
+    VIR_DEBUG("Send %zu commands for write, seconds = %d",
+              ncmds, agent->timeout);
+
+    if (qemuAgentSend(agent, &msg, agent->timeout) < 0)
+        goto cleanup;
+
+    if (msg.nrxObjects != ncmds) {
+        virReportError(VIR_ERR_AGENT_UNRESPONSIVE, "%s",
+                       _("Guest agent disappeared while executing command"));
+        goto cleanup;
+    }
+
+    for (i = 0; i < ncmds; i++) {
+        if (virHashUpdateEntry(agent->prefetched, cmdnames[i],
+                               msg.rxObjects[i]) < 0)
+            goto cleanup;
+        msg.rxObjects[i] = NULL;
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < msg.nrxObjects; i++)
+        virJSONValueFree(msg.rxObjects[i]);
+    VIR_FREE(msg.rxObjects);
+    VIR_FREE(msg.txBuffer);
+    if (ret < 0)
+        qemuAgentPrefetchReset(agent);
+    return ret;
+}
+
+
+/**
+ * qemuAgentPrefetchReset:
+ * @agent: agent object
+ *
+ * Drops replies kept by qemuAgentPrefetch() which were not used.
+ */
+void
+qemuAgentPrefetchReset(qemuAgentPtr agent)
+{
+    if (agent->prefetched)
+        virHashRemoveAll(agent->prefetched);
+}
+
+
 static virJSONValuePtr
 qemuAgentMakeStringsArray(const char **strings, unsigned int len)
 {
@@ -49,6 +49,10 @@ void qemuAgentClose(qemuAgentPtr mon);
 
 void qemuAgentNotifyClose(qemuAgentPtr mon);
 
+int qemuAgentPrefetch(qemuAgentPtr mon,
+                      const char **cmdnames);
+void qemuAgentPrefetchReset(qemuAgentPtr mon);
+
 typedef enum {
     QEMU_AGENT_EVENT_NONE = 0,
     QEMU_AGENT_EVENT_SHUTDOWN,
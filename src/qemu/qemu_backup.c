@@ -300,9 +300,29 @@ qemuBackupDiskPrepareDataOne(virDomainObjPtr vm,
 }
 
 
+/**
+ * qemuBackupDiskSpeed:
+ * @cfg: driver config
+ * @njobs: number of copy jobs sharing the bandwidth
+ *
+ * Returns the speed in bytes/s each of @njobs copy jobs of a push mode
+ * backup gets from 'backup_bandwidth', 0 if unlimited.
+ */
+static unsigned long long
+qemuBackupDiskSpeed(virQEMUDriverConfigPtr cfg,
+                    size_t njobs)
+{
+    if (cfg->backupBandwidth == 0 || njobs == 0)
+        return 0;
+
+    return MAX(((unsigned long long) cfg->backupBandwidth << 20) / njobs, 1);
+}
+
+
 static int
 qemuBackupDiskPrepareDataOnePush(virJSONValuePtr actions,
-                                 struct qemuBackupDiskData *dd)
+                                 struct qemuBackupDiskData *dd,
+                                 unsigned long long speed)
 {
     qemuMonitorTransactionBackupSyncMode syncmode = QEMU_MONITOR_TRANSACTION_BACKUP_SYNC_MODE_FULL;
 
@@ -314,7 +334,8 @@ qemuBackupDiskPrepareDataOnePush(virJSONValuePtr actions,
                                      dd->blockjob->name,
                                      dd->store->nodeformat,
                                      dd->incrementalBitmap,
-                                     syncmode) < 0)
+                                     syncmode,
+                                     speed) < 0)
         return -1;
 
     return 0;
@@ -334,7 +355,8 @@ qemuBackupDiskPrepareDataOnePull(virJSONValuePtr actions,
                                      dd->blockjob->name,
                                      dd->store->nodeformat,
                                      NULL,
-                                     QEMU_MONITOR_TRANSACTION_BACKUP_SYNC_MODE_NONE) < 0)
+                                     QEMU_MONITOR_TRANSACTION_BACKUP_SYNC_MODE_NONE,
+                                     0) < 0)
         return -1;
 
     return 0;
@@ -351,11 +373,21 @@ qemuBackupDiskPrepareData(virDomainObjPtr vm,
 {
     struct qemuBackupDiskData *disks = NULL;
     ssize_t ndisks = 0;
+    size_t njobs = 0;
+    unsigned long long speed;
     size_t i;
     bool pull = def->type == VIR_DOMAIN_BACKUP_TYPE_PULL;
 
     disks = g_new0(struct qemuBackupDiskData, def->ndisks);
 
+    for (i = 0; i < def->ndisks; i++) {
+        if (def->disks[i].store)
+            njobs++;
+    }
+
+    /* all copy jobs start at once as part of one transaction */
+    speed = qemuBackupDiskSpeed(cfg, njobs);
+
     for (i = 0; i < def->ndisks; i++) {
         virDomainBackupDiskDef *backupdisk = &def->disks[i];
         struct qemuBackupDiskData *dd = disks + ndisks;
@@ -373,7 +405,7 @@ qemuBackupDiskPrepareData(virDomainObjPtr vm,
             if (qemuBackupDiskPrepareDataOnePull(actions, dd) < 0)
                 goto error;
         } else {
-            if (qemuBackupDiskPrepareDataOnePush(actions, dd) < 0)
+            if (qemuBackupDiskPrepareDataOnePush(actions, dd, speed) < 0)
                 goto error;
         }
     }
@@ -643,6 +675,68 @@ qemuBackupJobCancelBlockjobs(virDomainObjPtr vm,
 }
 
 
+/**
+ * qemuBackupJobRebalanceBlockjobs:
+ * @vm: domain object
+ * @backup: backup definition
+ * @asyncJob: asynchronous job type
+ *
+ * Splits 'backup_bandwidth' among the copy jobs of the push mode @backup
+ * which are still running, so that the jobs of larger disks take over
+ * the bandwidth of those already finished.
+ */
+static void
+qemuBackupJobRebalanceBlockjobs(virDomainObjPtr vm,
+                                virDomainBackupDefPtr backup,
+                                int asyncJob)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(priv->driver);
+    unsigned long long speed;
+    size_t nrunning = 0;
+    size_t i;
+
+    if (cfg->backupBandwidth == 0)
+        return;
+
+    for (i = 0; i < backup->ndisks; i++) {
+        if (backup->disks[i].store &&
+            backup->disks[i].state == VIR_DOMAIN_BACKUP_DISK_STATE_RUNNING)
+            nrunning++;
+    }
+
+    speed = qemuBackupDiskSpeed(cfg, nrunning);
+
+    for (i = 0; i < backup->ndisks; i++) {
+        virDomainBackupDiskDefPtr backupdisk = backup->disks + i;
+        virDomainDiskDefPtr disk;
+        g_autoptr(qemuBlockJobData) job = NULL;
+        int rc;
+
+        if (!backupdisk->store ||
+            backupdisk->state != VIR_DOMAIN_BACKUP_DISK_STATE_RUNNING)
+            continue;
+
+        if (!(disk = virDomainDiskByTarget(vm->def, backupdisk->name)) ||
+            !(job = qemuBlockJobDiskGetJob(disk)))
+            continue;
+
+        if (qemuDomainObjEnterMonitorAsync(priv->driver, vm, asyncJob) < 0)
+            return;
+
+        rc = qemuMonitorBlockJobSetSpeed(priv->mon, job->name, speed);
+
+        if (qemuDomainObjExitMonitor(priv->driver, vm) < 0)
+            return;
+
+        if (rc < 0) {
+            VIR_WARN("failed to set speed of backup job '%s': %s",
+                     job->name, virGetLastErrorMessage());
+        }
+    }
+}
+
+
 #define QEMU_BACKUP_TLS_ALIAS_BASE "libvirt_backup"
 
 static int
@@ -1010,6 +1104,8 @@ qemuBackupNotifyBlockjobEnd(virDomainObjPtr vm,
     if (has_running && (has_failed || has_cancelled)) {
         /* cancel the rest of the jobs */
         qemuBackupJobCancelBlockjobs(vm, backup, false, asyncJob);
+    } else if (has_running && backup->type == VIR_DOMAIN_BACKUP_TYPE_PUSH) {
+        qemuBackupJobRebalanceBlockjobs(vm, backup, asyncJob);
     } else if (!has_running && !has_cancelling) {
         /* all sub-jobs have stopped */
 
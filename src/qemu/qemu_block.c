@@ -1930,6 +1930,179 @@ qemuBlockStorageSourceChainDetachPrepareDrive(virStorageSourcePtr src,
 }
 
 
+/* Maximum number of commands submitted for one qemuBlockStorageSourceAttachData */
+#define QEMU_BLOCK_ATTACH_PIPELINE_CMDS 9
+
+typedef struct _qemuBlockAttachPipeline qemuBlockAttachPipeline;
+typedef qemuBlockAttachPipeline *qemuBlockAttachPipelinePtr;
+
+typedef struct _qemuBlockAttachPipelineCmd qemuBlockAttachPipelineCmd;
+typedef qemuBlockAttachPipelineCmd *qemuBlockAttachPipelineCmdPtr;
+struct _qemuBlockAttachPipelineCmd {
+    qemuBlockAttachPipelinePtr pipeline;
+    bool *attached; /* set once a blockdev was added */
+    char **alias; /* filled with @id once an object was added */
+    char *id;
+};
+
+struct _qemuBlockAttachPipeline {
+    qemuBlockAttachPipelineCmdPtr cmds;
+    size_t ncmds;
+
+    char *errcmd; /* first failed command */
+    char *errmsg;
+    bool failed;
+};
+
+
+static void
+qemuBlockAttachPipelineDone(qemuMonitorPtr mon G_GNUC_UNUSED,
+                            const char *cmdname,
+                            virJSONValuePtr data,
+                            const char *error,
+                            void *opaque)
+{
+    qemuBlockAttachPipelineCmdPtr cmd = opaque;
+    qemuBlockAttachPipelinePtr pipeline = cmd->pipeline;
+
+    if (!data) {
+        if (!pipeline->failed) {
+            pipeline->errcmd = g_strdup(cmdname);
+            pipeline->errmsg = g_strdup(error);
+            pipeline->failed = true;
+        }
+        return;
+    }
+
+    if (cmd->attached)
+        *cmd->attached = true;
+
+    if (cmd->alias)
+        *cmd->alias = g_steal_pointer(&cmd->id);
+}
+
+
+static int
+qemuBlockAttachPipelineAddObject(qemuMonitorPtr mon,
+                                 qemuBlockAttachPipelinePtr pipeline,
+                                 virJSONValuePtr *props,
+                                 char **alias)
+{
+    qemuBlockAttachPipelineCmdPtr cmd;
+
+    if (!*props)
+        return 0;
+
+    cmd = pipeline->cmds + pipeline->ncmds++;
+    cmd->pipeline = pipeline;
+    cmd->alias = alias;
+    cmd->id = g_strdup(virJSONValueObjectGetString(*props, "id"));
+
+    return qemuMonitorAddObjectAsync(mon, props, qemuBlockAttachPipelineDone, cmd);
+}
+
+
+static int
+qemuBlockAttachPipelineBlockdevAdd(qemuMonitorPtr mon,
+                                   qemuBlockAttachPipelinePtr pipeline,
+                                   virJSONValuePtr *props,
+                                   bool *attached)
+{
+    qemuBlockAttachPipelineCmdPtr cmd;
+
+    if (!*props)
+        return 0;
+
+    cmd = pipeline->cmds + pipeline->ncmds++;
+    cmd->pipeline = pipeline;
+    cmd->attached = attached;
+
+    return qemuMonitorBlockdevAddAsync(mon, props, qemuBlockAttachPipelineDone, cmd);
+}
+
+
+static int
+qemuBlockAttachPipelineSubmit(qemuMonitorPtr mon,
+                              qemuBlockAttachPipelinePtr pipeline,
+                              qemuBlockStorageSourceAttachDataPtr data)
+{
+    /* same order as qemuBlockStorageSourceAttachApply */
+    if (qemuBlockAttachPipelineAddObject(mon, pipeline, &data->prmgrProps,
+                                         &data->prmgrAlias) < 0 ||
+        qemuBlockAttachPipelineAddObject(mon, pipeline, &data->authsecretProps,
+                                         &data->authsecretAlias) < 0 ||
+        qemuBlockAttachPipelineAddObject(mon, pipeline, &data->httpcookiesecretProps,
+                                         &data->httpcookiesecretAlias) < 0 ||
+        qemuBlockAttachPipelineAddObject(mon, pipeline, &data->tlsKeySecretProps,
+                                         &data->tlsKeySecretAlias) < 0 ||
+        qemuBlockAttachPipelineAddObject(mon, pipeline, &data->tlsProps,
+                                         &data->tlsAlias) < 0 ||
+        qemuBlockAttachPipelineBlockdevAdd(mon, pipeline, &data->storageProps,
+                                           &data->storageAttached) < 0 ||
+        qemuBlockAttachPipelineBlockdevAdd(mon, pipeline, &data->storageSliceProps,
+                                           &data->storageSliceAttached) < 0 ||
+        qemuBlockAttachPipelineAddObject(mon, pipeline, &data->encryptsecretProps,
+                                         &data->encryptsecretAlias) < 0 ||
+        qemuBlockAttachPipelineBlockdevAdd(mon, pipeline, &data->formatProps,
+                                           &data->formatAttached) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/**
+ * qemuBlockStorageSourceChainAttachPipelined:
+ * @mon: monitor object
+ * @data: storage source chain data
+ *
+ * Submits all commands needed to attach the chain described by @data back
+ * to back and waits for their replies only once, so that attaching a long
+ * backing chain takes a single round trip to QEMU. QEMU executes the
+ * commands in order, so a node is always added before the nodes using it.
+ */
+static int
+qemuBlockStorageSourceChainAttachPipelined(qemuMonitorPtr mon,
+                                           qemuBlockStorageSourceChainDataPtr data)
+{
+    qemuBlockAttachPipeline pipeline = { 0 };
+    int ret = -1;
+    int rc = 0;
+    size_t i;
+
+    pipeline.cmds = g_new0(qemuBlockAttachPipelineCmd,
+                           data->nsrcdata * QEMU_BLOCK_ATTACH_PIPELINE_CMDS);
+
+    for (i = data->nsrcdata; i > 0; i--) {
+        if ((rc = qemuBlockAttachPipelineSubmit(mon, &pipeline,
+                                                data->srcdata[i - 1])) < 0)
+            break;
+    }
+
+    /* wait for the already submitted commands even if submitting failed so
+     * that the rollback knows what was attached */
+    if (qemuMonitorWaitAsync(mon) < 0 || rc < 0)
+        goto cleanup;
+
+    if (pipeline.failed) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("unable to execute QEMU command '%s': %s"),
+                       pipeline.errcmd, NULLSTR(pipeline.errmsg));
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < pipeline.ncmds; i++)
+        g_free(pipeline.cmds[i].id);
+    g_free(pipeline.cmds);
+    g_free(pipeline.errcmd);
+    g_free(pipeline.errmsg);
+    return ret;
+}
+
+
 /**
  * qemuBlockStorageSourceChainAttach:
  * @mon: monitor object
@@ -1946,6 +2119,15 @@ qemuBlockStorageSourceChainAttach(qemuMonitorPtr mon,
 {
     size_t i;
 
+    for (i = 0; i < data->nsrcdata; i++) {
+        if (data->srcdata[i]->driveCmd)
+            break;
+    }
+
+    /* the legacy 'drive_add' is an HMP command which can't be pipelined */
+    if (data->nsrcdata > 0 && i == data->nsrcdata)
+        return qemuBlockStorageSourceChainAttachPipelined(mon, data);
+
     for (i = data->nsrcdata; i > 0; i--) {
         if (qemuBlockStorageSourceAttachApply(mon, data->srcdata[i - 1]) < 0)
             return -1;
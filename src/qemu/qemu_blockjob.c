@@ -1796,6 +1796,78 @@ qemuBlockJobSyncEnd(virDomainObjPtr vm,
 }
 
 
+static int
+qemuBlockJobUpdateInfo(void *payload,
+                       const void *name G_GNUC_UNUSED,
+                       void *opaque)
+{
+    qemuBlockJobDataPtr job = payload;
+    virHashTablePtr all = opaque;
+    qemuMonitorBlockJobInfoPtr info;
+
+    if ((info = virHashLookup(all, job->name))) {
+        job->info = *info;
+        job->infoValid = true;
+    } else {
+        job->infoValid = false;
+    }
+
+    return 0;
+}
+
+
+/**
+ * qemuBlockJobGetInfo:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @job: block job data
+ * @info: filled with the progress of @job
+ *
+ * Fetches the progress of @job. A single query of qemu refreshes the
+ * progress of all block jobs of @vm, which is then reused for
+ * 'block_job_cache_timeout' seconds unless an event changes the state of
+ * the job in the meantime. The caller must hold a (non-async) job.
+ *
+ * Returns 1 if @info was filled, 0 if qemu doesn't know about @job and
+ * -1 on error.
+ */
+int
+qemuBlockJobGetInfo(virQEMUDriverPtr driver,
+                    virDomainObjPtr vm,
+                    qemuBlockJobDataPtr job,
+                    qemuMonitorBlockJobInfoPtr info)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    long long now = g_get_monotonic_time();
+    virHashTablePtr all;
+
+    if (cfg->blockJobCacheTimeout > 0 && job->infoValid &&
+        now - priv->blockjobsInfoStamp < cfg->blockJobCacheTimeout * G_USEC_PER_SEC) {
+        VIR_DEBUG("using cached progress of job '%s'", job->name);
+        *info = job->info;
+        return 1;
+    }
+
+    qemuDomainObjEnterMonitor(driver, vm);
+    all = qemuMonitorGetAllBlockJobInfo(priv->mon, true);
+    if (qemuDomainObjExitMonitor(driver, vm) < 0 || !all) {
+        virHashFree(all);
+        return -1;
+    }
+
+    priv->blockjobsInfoStamp = now;
+    virHashForEach(priv->blockjobs, qemuBlockJobUpdateInfo, all);
+    virHashFree(all);
+
+    if (!job->infoValid)
+        return 0;
+
+    *info = job->info;
+    return 1;
+}
+
+
 qemuBlockJobDataPtr
 qemuBlockJobGetByDisk(virDomainDiskDefPtr disk)
 {
@@ -23,6 +23,7 @@
 
 #include "internal.h"
 #include "qemu_conf.h"
+#include "qemu_monitor.h"
 
 /**
  * This enum has to map all known block job states from enum virDomainBlockJobType
@@ -149,6 +150,9 @@ struct _qemuBlockJobData {
 
     int brokentype; /* the previous type of a broken blockjob qemuBlockJobType */
 
+    qemuMonitorBlockJobInfo info; /* progress from the last query of qemu */
+    bool infoValid; /* 'info' is set and no event arrived since */
+
     bool invalidData; /* the job data (except name) is not valid */
     bool reconnected; /* internal field for tracking whether job is live after reconnect to qemu */
 };
@@ -239,6 +243,12 @@ void qemuBlockJobSyncEnd(virDomainObjPtr vm,
                          qemuBlockJobDataPtr job,
                          int asyncJob);
 
+int
+qemuBlockJobGetInfo(virQEMUDriverPtr driver,
+                    virDomainObjPtr vm,
+                    qemuBlockJobDataPtr job,
+                    qemuMonitorBlockJobInfoPtr info);
+
 qemuBlockJobDataPtr
 qemuBlockJobGetByDisk(virDomainDiskDefPtr disk)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
@@ -597,6 +597,9 @@ VIR_ENUM_IMPL(virQEMUCaps,
               "spapr-tpm-proxy",
               "numa.hmat",
               "blockdev-hostdev-scsi",
+
+              /* 380 */
+              "memory-backend.prealloc-threads",
     );
 
 
@@ -635,6 +638,9 @@ typedef virQEMUCapsAccel *virQEMUCapsAccelPtr;
 struct _virQEMUCapsAccel {
     size_t nmachineTypes;
     virQEMUCapsMachineTypePtr machineTypes;
+    /* machine type name/alias -> index in machineTypes + 1 */
+    virHashTablePtr machineNames;
+    virHashTablePtr machineAliases;
     virQEMUCapsHostCPUData hostCPU;
     qemuMonitorCPUDefsPtr cpuModels;
 };
@@ -688,6 +694,9 @@ struct _virQEMUCaps {
     char *hostCPUSignature;
     char *package;
     char *kernelVersion;
+    /* hash of the QEMU data which the probe sections depend on, used to
+     * tell whether a changed binary needs to be probed again */
+    char *fingerprint;
 
     virArch arch;
 
@@ -808,6 +817,61 @@ virQEMUCapsGetAccel(virQEMUCapsPtr qemuCaps,
 }
 
 
+static void
+virQEMUCapsAccelIndexMachine(virQEMUCapsAccelPtr caps,
+                             size_t idx)
+{
+    virQEMUCapsMachineTypePtr mach = &caps->machineTypes[idx];
+
+    if (!caps->machineNames) {
+        caps->machineNames = virHashNew(NULL);
+        caps->machineAliases = virHashNew(NULL);
+    }
+
+    /* the first machine type of a given name wins, just like it
+     * would when searching the list */
+    if (mach->name &&
+        !virHashLookup(caps->machineNames, mach->name))
+        ignore_value(virHashAddEntry(caps->machineNames, mach->name,
+                                     GSIZE_TO_POINTER(idx + 1)));
+
+    if (mach->alias &&
+        !virHashLookup(caps->machineAliases, mach->alias))
+        ignore_value(virHashAddEntry(caps->machineAliases, mach->alias,
+                                     GSIZE_TO_POINTER(idx + 1)));
+}
+
+
+/* Rebuilds the lookup tables of machine types after the list changed */
+static void
+virQEMUCapsAccelIndexMachines(virQEMUCapsAccelPtr caps)
+{
+    size_t i;
+
+    virHashRemoveAll(caps->machineNames);
+    virHashRemoveAll(caps->machineAliases);
+
+    for (i = 0; i < caps->nmachineTypes; i++)
+        virQEMUCapsAccelIndexMachine(caps, i);
+}
+
+
+static virQEMUCapsMachineTypePtr
+virQEMUCapsAccelFindMachine(virQEMUCapsAccelPtr caps,
+                            const char *name)
+{
+    size_t idx;
+
+    if (!name || !caps->machineNames)
+        return NULL;
+
+    if (!(idx = GPOINTER_TO_SIZE(virHashLookup(caps->machineNames, name))))
+        return NULL;
+
+    return &caps->machineTypes[idx - 1];
+}
+
+
 static void
 virQEMUCapsSetDefaultMachine(virQEMUCapsAccelPtr caps,
                              size_t defIdx)
@@ -819,6 +883,8 @@ virQEMUCapsSetDefaultMachine(virQEMUCapsAccelPtr caps,
             sizeof(caps->machineTypes[0]) * defIdx);
 
     caps->machineTypes[0] = tmp;
+
+    virQEMUCapsAccelIndexMachines(caps);
 }
 
 
@@ -1094,6 +1160,89 @@ virQEMUCapsProbeHostCPU(virArch hostArch,
 }
 
 
+typedef struct _virQEMUCapsProbeData virQEMUCapsProbeData;
+typedef virQEMUCapsProbeData *virQEMUCapsProbeDataPtr;
+struct _virQEMUCapsProbeData {
+    virFileCachePtr cache;
+    char *binary;
+    virThread thread;
+    bool started;
+};
+
+
+static void
+virQEMUCapsProbeThread(void *opaque)
+{
+    virQEMUCapsProbeDataPtr data = opaque;
+    virQEMUCapsPtr qemuCaps;
+
+    /* Errors are reported again by the lookup in virQEMUCapsInitGuest */
+    if ((qemuCaps = virQEMUCapsCacheLookup(data->cache, data->binary)))
+        virObjectUnref(qemuCaps);
+    virResetLastError();
+}
+
+
+/*
+ * Look up the capabilities of all emulator binaries concurrently, so
+ * that binaries which need to be probed are not probed one after
+ * another. The results end up in @cache for virQEMUCapsInitGuest.
+ */
+static void
+virQEMUCapsPrefetch(virFileCachePtr cache,
+                    virArch hostarch)
+{
+    g_autofree virQEMUCapsProbeDataPtr probes = NULL;
+    size_t nprobes = 0;
+    size_t i;
+    size_t j;
+
+    probes = g_new0(virQEMUCapsProbeData, VIR_ARCH_LAST);
+
+    for (i = 0; i < VIR_ARCH_LAST; i++) {
+        g_autofree char *binary = virQEMUCapsGetDefaultEmulator(hostarch, i);
+
+        if (!binary)
+            continue;
+
+        for (j = 0; j < nprobes; j++) {
+            if (STREQ(probes[j].binary, binary))
+                break;
+        }
+
+        if (j == nprobes) {
+            probes[nprobes].cache = cache;
+            probes[nprobes].binary = g_steal_pointer(&binary);
+            nprobes++;
+        }
+    }
+
+    if (nprobes > 1) {
+        for (i = 0; i < nprobes; i++) {
+            if (virThreadCreateFull(&probes[i].thread, true,
+                                    virQEMUCapsProbeThread,
+                                    "qemu-caps-probe", false,
+                                    &probes[i]) < 0) {
+                /* Not fatal, the binary is probed by virQEMUCapsInitGuest */
+                VIR_WARN("Unable to create thread to probe '%s'",
+                         probes[i].binary);
+                virResetLastError();
+                continue;
+            }
+            probes[i].started = true;
+        }
+
+        for (i = 0; i < nprobes; i++) {
+            if (probes[i].started)
+                virThreadJoin(&probes[i].thread);
+        }
+    }
+
+    for (i = 0; i < nprobes; i++)
+        g_free(probes[i].binary);
+}
+
+
 virCapsPtr
 virQEMUCapsInit(virFileCachePtr cache)
 {
@@ -1123,6 +1272,8 @@ virQEMUCapsInit(virFileCachePtr cache)
     virCapabilitiesAddHostMigrateTransport(caps, "tcp");
     virCapabilitiesAddHostMigrateTransport(caps, "rdma");
 
+    virQEMUCapsPrefetch(cache, hostarch);
+
     /* QEMU can support pretty much every arch that exists,
      * so just probe for them all - we gracefully fail
      * if a qemu-system-$ARCH binary can't be found
@@ -1654,6 +1805,7 @@ static struct virQEMUCapsStringFlags virQEMUCapsObjectPropsMemoryBackendFile[] =
     { "discard-data", QEMU_CAPS_OBJECT_MEMORY_FILE_DISCARD },
     { "align", QEMU_CAPS_OBJECT_MEMORY_FILE_ALIGN },
     { "pmem", QEMU_CAPS_OBJECT_MEMORY_FILE_PMEM },
+    { "prealloc-threads", QEMU_CAPS_OBJECT_MEMORY_PREALLOC_THREADS },
 };
 
 static struct virQEMUCapsStringFlags virQEMUCapsObjectPropsMemoryBackendMemfd[] = {
@@ -1888,6 +2040,8 @@ virQEMUCapsAccelCopyMachineTypes(virQEMUCapsAccelPtr dst,
         dst->machineTypes[i].qemuDefault = src->machineTypes[i].qemuDefault;
         dst->machineTypes[i].numaMemSupported = src->machineTypes[i].numaMemSupported;
     }
+
+    virQEMUCapsAccelIndexMachines(dst);
 }
 
 
@@ -1929,6 +2083,7 @@ virQEMUCapsPtr virQEMUCapsNewCopy(virQEMUCapsPtr qemuCaps)
 
     ret->package = g_strdup(qemuCaps->package);
     ret->kernelVersion = g_strdup(qemuCaps->kernelVersion);
+    ret->fingerprint = g_strdup(qemuCaps->fingerprint);
 
     ret->arch = qemuCaps->arch;
 
@@ -1966,6 +2121,8 @@ virQEMUCapsAccelClear(virQEMUCapsAccelPtr caps)
         VIR_FREE(caps->machineTypes[i].defaultCPU);
     }
     VIR_FREE(caps->machineTypes);
+    virHashFree(caps->machineNames);
+    virHashFree(caps->machineAliases);
 
     virQEMUCapsHostCPUDataClear(&caps->hostCPU);
     qemuMonitorCPUDefsFree(caps->cpuModels);
@@ -1981,6 +2138,7 @@ void virQEMUCapsDispose(void *obj)
 
     VIR_FREE(qemuCaps->package);
     VIR_FREE(qemuCaps->kernelVersion);
+    VIR_FREE(qemuCaps->fingerprint);
     VIR_FREE(qemuCaps->binary);
     VIR_FREE(qemuCaps->hostCPUSignature);
 
@@ -2438,21 +2596,18 @@ virQEMUCapsGetCanonicalMachine(virQEMUCapsPtr qemuCaps,
                                const char *name)
 {
     virQEMUCapsAccelPtr accel;
-    size_t i;
+    size_t idx;
 
     if (!name || !qemuCaps)
         return name;
 
     accel = virQEMUCapsGetAccel(qemuCaps, virtType);
 
-    for (i = 0; i < accel->nmachineTypes; i++) {
-        if (!accel->machineTypes[i].alias)
-            continue;
-        if (STREQ(accel->machineTypes[i].alias, name))
-            return accel->machineTypes[i].name;
-    }
+    if (!accel->machineAliases ||
+        !(idx = GPOINTER_TO_SIZE(virHashLookup(accel->machineAliases, name))))
+        return name;
 
-    return name;
+    return accel->machineTypes[idx - 1].name;
 }
 
 
@@ -2461,22 +2616,14 @@ virQEMUCapsGetMachineMaxCpus(virQEMUCapsPtr qemuCaps,
                              virDomainVirtType virtType,
                              const char *name)
 {
-    virQEMUCapsAccelPtr accel;
-    size_t i;
+    virQEMUCapsMachineTypePtr mach;
 
-    if (!name)
+    mach = virQEMUCapsAccelFindMachine(virQEMUCapsGetAccel(qemuCaps, virtType),
+                                       name);
+    if (!mach)
         return 0;
 
-    accel = virQEMUCapsGetAccel(qemuCaps, virtType);
-
-    for (i = 0; i < accel->nmachineTypes; i++) {
-        if (!accel->machineTypes[i].maxCpus)
-            continue;
-        if (STREQ(accel->machineTypes[i].name, name))
-            return accel->machineTypes[i].maxCpus;
-    }
-
-    return 0;
+    return mach->maxCpus;
 }
 
 
@@ -2485,17 +2632,14 @@ virQEMUCapsGetMachineHotplugCpus(virQEMUCapsPtr qemuCaps,
                                  virDomainVirtType virtType,
                                  const char *name)
 {
-    virQEMUCapsAccelPtr accel;
-    size_t i;
-
-    accel = virQEMUCapsGetAccel(qemuCaps, virtType);
+    virQEMUCapsMachineTypePtr mach;
 
-    for (i = 0; i < accel->nmachineTypes; i++) {
-        if (STREQ_NULLABLE(accel->machineTypes[i].name, name))
-            return accel->machineTypes[i].hotplugCpus;
-    }
+    mach = virQEMUCapsAccelFindMachine(virQEMUCapsGetAccel(qemuCaps, virtType),
+                                       name);
+    if (!mach)
+        return false;
 
-    return false;
+    return mach->hotplugCpus;
 }
 
 
@@ -2506,18 +2650,15 @@ virQEMUCapsGetMachineDefaultCPU(virQEMUCapsPtr qemuCaps,
 {
     virQEMUCapsAccelPtr accel = virQEMUCapsGetAccel(qemuCaps, type);
     qemuMonitorCPUDefsPtr defs = accel->cpuModels;
+    virQEMUCapsMachineTypePtr mach;
     const char *cpuType = NULL;
     size_t i;
 
     if (!name || !defs)
         return NULL;
 
-    for (i = 0; i < accel->nmachineTypes; i++) {
-        if (STREQ(accel->machineTypes[i].name, name)) {
-            cpuType = accel->machineTypes[i].defaultCPU;
-            break;
-        }
-    }
+    if ((mach = virQEMUCapsAccelFindMachine(accel, name)))
+        cpuType = mach->defaultCPU;
 
     if (!cpuType)
         return NULL;
@@ -2536,17 +2677,14 @@ virQEMUCapsGetMachineNumaMemSupported(virQEMUCapsPtr qemuCaps,
                                       virDomainVirtType virtType,
                                       const char *name)
 {
-    virQEMUCapsAccelPtr accel;
-    size_t i;
-
-    accel = virQEMUCapsGetAccel(qemuCaps, virtType);
+    virQEMUCapsMachineTypePtr mach;
 
-    for (i = 0; i < accel->nmachineTypes; i++) {
-        if (STREQ(accel->machineTypes[i].name, name))
-            return accel->machineTypes[i].numaMemSupported;
-    }
+    mach = virQEMUCapsAccelFindMachine(virQEMUCapsGetAccel(qemuCaps, virtType),
+                                       name);
+    if (!mach)
+        return false;
 
-    return false;
+    return mach->numaMemSupported;
 }
 
 
@@ -2807,6 +2945,8 @@ virQEMUCapsAddMachine(virQEMUCapsPtr qemuCaps,
     mach->qemuDefault = isDefault;
 
     mach->numaMemSupported = numaMemSupported;
+
+    virQEMUCapsAccelIndexMachine(accel, accel->nmachineTypes - 1);
 }
 
 /**
@@ -2892,13 +3032,8 @@ virQEMUCapsIsMachineSupported(virQEMUCapsPtr qemuCaps,
                               const char *canonical_machine)
 {
     virQEMUCapsAccelPtr accel = virQEMUCapsGetAccel(qemuCaps, virtType);
-    size_t i;
 
-    for (i = 0; i < accel->nmachineTypes; i++) {
-        if (STREQ(canonical_machine, accel->machineTypes[i].name))
-            return true;
-    }
-    return false;
+    return !!virQEMUCapsAccelFindMachine(accel, canonical_machine);
 }
 
 
@@ -3538,7 +3673,7 @@ virQEMUCapsInitCPUModelS390(virQEMUCapsPtr qemuCaps,
         if (prop->type != QEMU_MONITOR_CPU_PROPERTY_BOOLEAN)
             continue;
 
-        feature->name = g_strdup(name);
+        feature->name = virStringIntern(name);
 
         if (!prop->value.boolean ||
             (migratable && prop->migratable == VIR_TRISTATE_BOOL_NO))
@@ -4082,6 +4217,8 @@ virQEMUCapsLoadMachines(virQEMUCapsAccelPtr caps,
         caps->machineTypes[i].defaultCPU = virXMLPropString(nodes[i], "defaultCPU");
     }
 
+    virQEMUCapsAccelIndexMachines(caps);
+
     return 0;
 }
 
@@ -4283,6 +4420,21 @@ virQEMUCapsLoadCache(virArch hostArch,
     }
     qemuCaps->ctime = (time_t)l;
 
+    /* virQEMUCapsIsValid would throw the data away anyway if the binary
+     * changed, so don't bother loading all the flags, CPU models and
+     * machine types from the cache in that case */
+    if (!skipInvalidation) {
+        struct stat sb;
+
+        if (stat(qemuCaps->binary, &sb) < 0 ||
+            sb.st_ctime != qemuCaps->ctime) {
+            VIR_DEBUG("Outdated capabilities in %s: QEMU binary changed, "
+                      "stopping load", qemuCaps->binary);
+            ret = 1;
+            goto cleanup;
+        }
+    }
+
     if ((n = virXPathNodeSet("./flag", ctxt, &nodes)) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("failed to parse qemu capabilities flags"));
@@ -4340,6 +4492,8 @@ virQEMUCapsLoadCache(virArch hostArch,
             goto cleanup;
     }
 
+    qemuCaps->fingerprint = virXPathString("string(./fingerprint)", ctxt);
+
     if (!(str = virXPathString("string(./arch)", ctxt))) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("missing arch in QEMU capabilities cache"));
@@ -4646,6 +4800,9 @@ virQEMUCapsFormatCache(virQEMUCapsPtr qemuCaps)
         virBufferAsprintf(&buf, "<kernelVersion>%s</kernelVersion>\n",
                           qemuCaps->kernelVersion);
 
+    virBufferEscapeString(&buf, "<fingerprint>%s</fingerprint>\n",
+                          qemuCaps->fingerprint);
+
     virBufferAsprintf(&buf, "<arch>%s</arch>\n",
                       virArchToString(qemuCaps->arch));
 
@@ -4865,12 +5022,12 @@ virQEMUCapsKVMUsable(virQEMUCapsCachePrivPtr priv)
 }
 
 
+/* With @checkBinary false, changes of the QEMU binary are ignored */
 static bool
-virQEMUCapsIsValid(void *data,
-                   void *privData)
+virQEMUCapsIsValidInternal(virQEMUCapsPtr qemuCaps,
+                           virQEMUCapsCachePrivPtr priv,
+                           bool checkBinary)
 {
-    virQEMUCapsPtr qemuCaps = data;
-    virQEMUCapsCachePrivPtr priv = privData;
     bool kvmUsable;
     struct stat sb;
     bool kvmSupportsNesting;
@@ -4893,19 +5050,21 @@ virQEMUCapsIsValid(void *data,
         return false;
     }
 
-    if (stat(qemuCaps->binary, &sb) < 0) {
-        VIR_DEBUG("Failed to stat QEMU binary '%s': %s",
-                  qemuCaps->binary,
-                  g_strerror(errno));
-        return false;
-    }
+    if (checkBinary) {
+        if (stat(qemuCaps->binary, &sb) < 0) {
+            VIR_DEBUG("Failed to stat QEMU binary '%s': %s",
+                      qemuCaps->binary,
+                      g_strerror(errno));
+            return false;
+        }
 
-    if (sb.st_ctime != qemuCaps->ctime) {
-        VIR_DEBUG("Outdated capabilities for '%s': QEMU binary changed "
-                  "(%lld vs %lld)",
-                  qemuCaps->binary,
-                  (long long)sb.st_ctime, (long long)qemuCaps->ctime);
-        return false;
+        if (sb.st_ctime != qemuCaps->ctime) {
+            VIR_DEBUG("Outdated capabilities for '%s': QEMU binary changed "
+                      "(%lld vs %lld)",
+                      qemuCaps->binary,
+                      (long long)sb.st_ctime, (long long)qemuCaps->ctime);
+            return false;
+        }
     }
 
     if (!virQEMUCapsGuestIsNative(priv->hostArch, qemuCaps->arch)) {
@@ -4982,6 +5141,14 @@ virQEMUCapsIsValid(void *data,
 }
 
 
+static bool
+virQEMUCapsIsValid(void *data,
+                   void *privData)
+{
+    return virQEMUCapsIsValidInternal(data, privData, true);
+}
+
+
 /**
  * virQEMUCapsInitQMPArch:
  * @qemuCaps: QEMU capabilities
@@ -5375,12 +5542,79 @@ virQEMUCapsLogProbeFailure(const char *binary)
 }
 
 
+/**
+ * virQEMUCapsProbeQMPFingerprint:
+ * @mon: monitor of the QEMU process being probed
+ *
+ * Hashes the version, QMP schema and machine types reported by QEMU.
+ * Rebuilds of the binary which don't change any of them don't change
+ * the rest of the probed data either.
+ *
+ * Returns the fingerprint or NULL if QEMU can't provide it. No error is
+ * reported.
+ */
+static char *
+virQEMUCapsProbeQMPFingerprint(qemuMonitorPtr mon)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virJSONValue) schema = NULL;
+    g_autofree char *schemastr = NULL;
+    g_autofree char *package = NULL;
+    qemuMonitorMachineInfoPtr *machines = NULL;
+    int nmachines = -1;
+    int major, minor, micro;
+    char *fingerprint = NULL;
+    size_t i;
+
+    if (qemuMonitorGetVersion(mon, &major, &minor, &micro, &package) < 0 ||
+        !(schema = qemuMonitorQueryQMPSchema(mon)) ||
+        !(schemastr = virJSONValueToString(schema, false)) ||
+        (nmachines = qemuMonitorGetMachines(mon, &machines)) < 0)
+        goto cleanup;
+
+    virBufferAsprintf(&buf, "%d.%d.%d %s\n%s\n",
+                      major, minor, micro, NULLSTR(package), schemastr);
+
+    for (i = 0; i < nmachines; i++) {
+        virBufferAsprintf(&buf, "%s %s %s %u %d %d %d\n",
+                          machines[i]->name,
+                          NULLSTR(machines[i]->alias),
+                          NULLSTR(machines[i]->defaultCPU),
+                          machines[i]->maxCpus,
+                          machines[i]->hotplugCpus,
+                          machines[i]->isDefault,
+                          machines[i]->numaMemSupported);
+    }
+
+    ignore_value(virCryptoHashString(VIR_CRYPTO_HASH_SHA256,
+                                     virBufferCurrentContent(&buf),
+                                     &fingerprint));
+
+ cleanup:
+    for (i = 0; i < nmachines; i++)
+        qemuMonitorMachineInfoFree(machines[i]);
+    VIR_FREE(machines);
+    virResetLastError();
+    return fingerprint;
+}
+
+
+/**
+ * virQEMUCapsInitQMPSingle:
+ * @fingerprint: whether to probe the fingerprint
+ * @prev: outdated capabilities of the same binary or NULL
+ *
+ * Returns 1 if @prev still describes the binary, 0 if @qemuCaps was
+ * probed, -1 on error.
+ */
 static int
 virQEMUCapsInitQMPSingle(virQEMUCapsPtr qemuCaps,
                          const char *libDir,
                          uid_t runUid,
                          gid_t runGid,
-                         bool onlyTCG)
+                         bool onlyTCG,
+                         bool fingerprint,
+                         virQEMUCapsPtr prev)
 {
     g_autoptr(qemuProcessQMP) proc = NULL;
     int ret = -1;
@@ -5392,6 +5626,16 @@ virQEMUCapsInitQMPSingle(virQEMUCapsPtr qemuCaps,
     if (qemuProcessQMPStart(proc) < 0)
         goto cleanup;
 
+    if (fingerprint) {
+        qemuCaps->fingerprint = virQEMUCapsProbeQMPFingerprint(proc->mon);
+
+        if (prev && qemuCaps->fingerprint &&
+            STREQ_NULLABLE(prev->fingerprint, qemuCaps->fingerprint)) {
+            VIR_DEBUG("Capabilities of '%s' didn't change", qemuCaps->binary);
+            return 1;
+        }
+    }
+
     if (onlyTCG)
         ret = virQEMUCapsInitQMPMonitorTCG(qemuCaps, proc->mon);
     else
@@ -5405,14 +5649,20 @@ virQEMUCapsInitQMPSingle(virQEMUCapsPtr qemuCaps,
 }
 
 
+/* Returns 1 if @prev is still valid, 0 on success, -1 on error */
 static int
 virQEMUCapsInitQMP(virQEMUCapsPtr qemuCaps,
                    const char *libDir,
                    uid_t runUid,
-                   gid_t runGid)
+                   gid_t runGid,
+                   bool fingerprint,
+                   virQEMUCapsPtr prev)
 {
-    if (virQEMUCapsInitQMPSingle(qemuCaps, libDir, runUid, runGid, false) < 0)
-        return -1;
+    int rc;
+
+    if ((rc = virQEMUCapsInitQMPSingle(qemuCaps, libDir, runUid, runGid,
+                                       false, fingerprint, prev)) != 0)
+        return rc;
 
     /*
      * If KVM was enabled during the first probe, we need to explicitly probe
@@ -5421,13 +5671,23 @@ virQEMUCapsInitQMP(virQEMUCapsPtr qemuCaps,
      */
     if (virQEMUCapsGet(qemuCaps, QEMU_CAPS_KVM) &&
         virQEMUCapsGet(qemuCaps, QEMU_CAPS_TCG) &&
-        virQEMUCapsInitQMPSingle(qemuCaps, libDir, runUid, runGid, true) < 0)
+        virQEMUCapsInitQMPSingle(qemuCaps, libDir, runUid, runGid,
+                                 true, false, NULL) < 0)
         return -1;
 
     return 0;
 }
 
 
+/**
+ * virQEMUCapsNewForBinaryInternal:
+ * @fingerprint: whether to probe the fingerprint of @binary
+ * @prev: outdated capabilities of @binary or NULL
+ *
+ * Probes the capabilities of @binary. If @prev is given, the binary
+ * changed but nothing else did, so @prev is reused if QEMU reports the
+ * same fingerprint.
+ */
 virQEMUCapsPtr
 virQEMUCapsNewForBinaryInternal(virArch hostArch,
                                 const char *binary,
@@ -5436,10 +5696,13 @@ virQEMUCapsNewForBinaryInternal(virArch hostArch,
                                 gid_t runGid,
                                 const char *hostCPUSignature,
                                 unsigned int microcodeVersion,
-                                const char *kernelVersion)
+                                const char *kernelVersion,
+                                bool fingerprint,
+                                virQEMUCapsPtr prev)
 {
     virQEMUCapsPtr qemuCaps;
     struct stat sb;
+    int rc;
 
     if (!(qemuCaps = virQEMUCapsNewBinary(binary)))
         goto error;
@@ -5463,9 +5726,20 @@ virQEMUCapsNewForBinaryInternal(virArch hostArch,
         goto error;
     }
 
-    if (virQEMUCapsInitQMP(qemuCaps, libDir, runUid, runGid) < 0)
+    if ((rc = virQEMUCapsInitQMP(qemuCaps, libDir, runUid, runGid,
+                                 fingerprint, prev)) < 0)
         goto error;
 
+    /* @prev was checked against the host already, so only the binary
+     * ctime needs to be updated */
+    if (rc == 1) {
+        virObjectUnref(qemuCaps);
+        if (!(qemuCaps = virQEMUCapsNewCopy(prev)))
+            return NULL;
+        qemuCaps->ctime = sb.st_ctime;
+        return qemuCaps;
+    }
+
     qemuCaps->libvirtCtime = virGetSelfLastChanged();
     qemuCaps->libvirtVersion = LIBVIR_VERSION_NUMBER;
 
@@ -5503,7 +5777,37 @@ virQEMUCapsNewData(const char *binary,
                                            priv->runGid,
                                            priv->hostCPUSignature,
                                            virHostCPUGetMicrocodeVersion(),
-                                           priv->kernelVersion);
+                                           priv->kernelVersion,
+                                           true, NULL);
+}
+
+
+static void *
+virQEMUCapsUpdateData(const char *binary,
+                      void *outdated,
+                      void *privData)
+{
+    virQEMUCapsCachePrivPtr priv = privData;
+    virQEMUCapsPtr prev = outdated;
+
+    /* Only the data of a changed binary can be reused. Changes of libvirt
+     * may change how the same data is interpreted and changes of the host
+     * what QEMU reports. */
+    if (!prev->fingerprint ||
+        prev->libvirtCtime != virGetSelfLastChanged() ||
+        prev->libvirtVersion != LIBVIR_VERSION_NUMBER ||
+        !virQEMUCapsIsValidInternal(prev, priv, false))
+        prev = NULL;
+
+    return virQEMUCapsNewForBinaryInternal(priv->hostArch,
+                                           binary,
+                                           priv->libDir,
+                                           priv->runUid,
+                                           priv->runGid,
+                                           priv->hostCPUSignature,
+                                           virHostCPUGetMicrocodeVersion(),
+                                           priv->kernelVersion,
+                                           true, prev);
 }
 
 
@@ -5581,6 +5885,7 @@ virFileCacheHandlers qemuCapsCacheHandlers = {
     .loadFile = virQEMUCapsLoadFile,
     .saveFile = virQEMUCapsSaveFile,
     .privFree = virQEMUCapsCachePrivFree,
+    .updateData = virQEMUCapsUpdateData,
 };
 
 
@@ -37,6 +37,7 @@
 #include "virtypedparam.h"
 #include "virnuma.h"
 #include "virdevmapper.h"
+#include "virprocess.h"
 #include "virutil.h"
 
 #define VIR_FROM_THIS VIR_FROM_QEMU
@@ -1068,6 +1069,7 @@ qemuSetupCgroup(virDomainObjPtr vm,
                 int *nicindexes)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
+    int ret = -1;
 
     if (!vm->pid) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -1081,22 +1083,27 @@ qemuSetupCgroup(virDomainObjPtr vm,
     if (!priv->cgroup)
         return 0;
 
+    virCgroupBatchBegin(priv->cgroup);
+
     if (qemuSetupDevicesCgroup(vm) < 0)
-        return -1;
+        goto cleanup;
 
     if (qemuSetupBlkioCgroup(vm) < 0)
-        return -1;
+        goto cleanup;
 
     if (qemuSetupMemoryCgroup(vm) < 0)
-        return -1;
+        goto cleanup;
 
     if (qemuSetupCpuCgroup(vm) < 0)
-        return -1;
+        goto cleanup;
 
     if (qemuSetupCpusetCgroup(vm) < 0)
-        return -1;
+        goto cleanup;
 
-    return 0;
+    ret = 0;
+ cleanup:
+    virCgroupBatchEnd(priv->cgroup);
+    return ret;
 }
 
 int
@@ -1116,6 +1123,111 @@ qemuSetupCgroupCpusetCpus(virCgroupPtr cgroup,
 }
 
 
+static int
+qemuCgroupUpdateAutoPlacementThread(virDomainObjPtr vm,
+                                    virCgroupThreadName nameval,
+                                    int id,
+                                    pid_t pid,
+                                    virBitmapPtr cpuset,
+                                    const char *mems)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    virCgroupPtr cgroup = NULL;
+    int ret = -1;
+
+    if (virCgroupNewThread(priv->cgroup, nameval, id, false, &cgroup) < 0)
+        return -1;
+
+    virCgroupBatchBegin(cgroup);
+
+    if (virCgroupSetCpusetMemoryMigrate(cgroup, true) < 0 ||
+        qemuSetupCgroupCpusetCpus(cgroup, cpuset) < 0 ||
+        virCgroupSetCpusetMems(cgroup, mems) < 0)
+        goto cleanup;
+
+    if (pid > 0 && virProcessSetAffinity(pid, cpuset) < 0)
+        goto cleanup;
+
+    ret = 0;
+ cleanup:
+    virCgroupBatchEnd(cgroup);
+    virCgroupFree(&cgroup);
+    return ret;
+}
+
+
+/**
+ * qemuCgroupUpdateAutoPlacement:
+ * @vm: domain object
+ * @nodeset: new host NUMA nodes of the domain
+ * @cpuset: host CPUs of @nodeset
+ *
+ * Move the emulator, vCPU and IOThread threads of a running domain with
+ * automatic placement to @cpuset and migrate their memory to @nodeset.
+ * The caller is responsible for updating autoNodeset and autoCpuset of
+ * the domain.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuCgroupUpdateAutoPlacement(virDomainObjPtr vm,
+                              virBitmapPtr nodeset,
+                              virBitmapPtr cpuset)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    g_autoptr(virBitmap) allNodes = NULL;
+    g_autofree char *allMems = NULL;
+    g_autofree char *mems = NULL;
+    size_t i;
+
+    if (!virCgroupHasController(priv->cgroup, VIR_CGROUP_CONTROLLER_CPUSET)) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("cgroup cpuset controller is required for changing "
+                         "placement of a running domain"));
+        return -1;
+    }
+
+    if (!(mems = virBitmapFormat(nodeset)))
+        return -1;
+
+    /* The threads must stay within the nodes of the domain cgroup while
+     * they are being moved */
+    if (!(allNodes = virBitmapNewCopy(nodeset)) ||
+        virBitmapUnion(allNodes, priv->autoNodeset) < 0 ||
+        !(allMems = virBitmapFormat(allNodes)) ||
+        virCgroupSetCpusetMems(priv->cgroup, allMems) < 0)
+        return -1;
+
+    for (i = 0; i < virDomainDefGetVcpusMax(vm->def); i++) {
+        virDomainVcpuDefPtr vcpu = virDomainDefGetVcpu(vm->def, i);
+
+        if (!vcpu->online)
+            continue;
+
+        if (qemuCgroupUpdateAutoPlacementThread(vm, VIR_CGROUP_THREAD_VCPU, i,
+                                                qemuDomainGetVcpuPid(vm, i),
+                                                cpuset, mems) < 0)
+            return -1;
+    }
+
+    for (i = 0; i < vm->def->niothreadids; i++) {
+        virDomainIOThreadIDDefPtr iothread = vm->def->iothreadids[i];
+
+        if (qemuCgroupUpdateAutoPlacementThread(vm, VIR_CGROUP_THREAD_IOTHREAD,
+                                                iothread->iothread_id,
+                                                iothread->thread_id,
+                                                cpuset, mems) < 0)
+            return -1;
+    }
+
+    if (qemuCgroupUpdateAutoPlacementThread(vm, VIR_CGROUP_THREAD_EMULATOR, 0,
+                                            vm->pid, cpuset, mems) < 0)
+        return -1;
+
+    return virCgroupSetCpusetMems(priv->cgroup, mems);
+}
+
+
 int
 qemuSetupCgroupForExtDevices(virDomainObjPtr vm,
                              virQEMUDriverPtr driver)
@@ -64,6 +64,9 @@ int qemuSetupCgroupVcpuBW(virCgroupPtr cgroup,
                           unsigned long long period,
                           long long quota);
 int qemuSetupCgroupCpusetCpus(virCgroupPtr cgroup, virBitmapPtr cpumask);
+int qemuCgroupUpdateAutoPlacement(virDomainObjPtr vm,
+                                  virBitmapPtr nodeset,
+                                  virBitmapPtr cpuset);
 int qemuSetupGlobalCpuCgroup(virDomainObjPtr vm);
 int qemuSetupCgroupForExtDevices(virDomainObjPtr vm,
                                  virQEMUDriverPtr driver);
@@ -2945,6 +2945,42 @@ qemuBuildMemoryGetDefaultPagesize(virQEMUDriverConfigPtr cfg,
 }
 
 
+/* Upper limit of threads pre-faulting a single memory backend */
+#define QEMU_PREALLOC_THREADS_MAX 16
+
+/**
+ * qemuBuildMemoryPreallocThreads:
+ * @def: domain definition
+ * @targetNode: guest NUMA node the memory belongs to, or -1
+ *
+ * Pre-faulting huge memory backends with a single thread takes long, use
+ * as many threads as there are vCPUs which are going to use the memory.
+ * Those are already placed close to it and are idle until the guest
+ * starts.
+ *
+ * Returns the number of threads, 0 if the default should be used.
+ */
+static unsigned int
+qemuBuildMemoryPreallocThreads(const virDomainDef *def,
+                               int targetNode)
+{
+    unsigned int threads;
+
+    if (targetNode >= 0) {
+        virBitmapPtr cpus = virDomainNumaGetNodeCpumask(def->numa, targetNode);
+
+        threads = cpus ? virBitmapCountBits(cpus) : 0;
+    } else {
+        threads = virDomainDefGetVcpus(def);
+    }
+
+    if (threads <= 1)
+        return 0;
+
+    return MIN(threads, QEMU_PREALLOC_THREADS_MAX);
+}
+
+
 /**
  * qemuBuildMemoryBackendProps:
  * @backendProps: [out] constructed object
@@ -2986,6 +3022,7 @@ qemuBuildMemoryBackendProps(virJSONValuePtr *backendProps,
     size_t i;
     g_autofree char *memPath = NULL;
     bool prealloc = false;
+    unsigned int preallocThreads = 0;
     virBitmapPtr nodemask = NULL;
     int rc;
     g_autoptr(virJSONValue) props = NULL;
@@ -3112,8 +3149,13 @@ qemuBuildMemoryBackendProps(virJSONValuePtr *backendProps,
         } else if (useHugepage) {
             if (qemuGetDomainHupageMemPath(priv->driver, def, pagesize, &memPath) < 0)
                 return -1;
-            if (!priv->memPrealloc)
+            if (!priv->memPrealloc) {
                 prealloc = true;
+                if (virQEMUCapsGet(priv->qemuCaps,
+                                   QEMU_CAPS_OBJECT_MEMORY_PREALLOC_THREADS))
+                    preallocThreads = qemuBuildMemoryPreallocThreads(def,
+                                                                     mem->targetNode);
+            }
         } else {
             /* We can have both pagesize and mem source. If that's the case,
              * prefer hugepages as those are more specific. */
@@ -3123,6 +3165,7 @@ qemuBuildMemoryBackendProps(virJSONValuePtr *backendProps,
 
         if (virJSONValueObjectAdd(props,
                                   "B:prealloc", prealloc,
+                                  "p:prealloc-threads", preallocThreads,
                                   "s:mem-path", memPath,
                                   NULL) < 0)
             return -1;
@@ -278,6 +278,17 @@ virQEMUDriverConfigPtr virQEMUDriverConfigNew(bool privileged,
     cfg->glusterDebugLevel = 4;
     cfg->stdioLogD = true;
 
+#if !HAVE_NUMAD
+    cfg->numaPlacementBuiltin = true;
+#endif
+    cfg->numaRebalanceMaxMoves = 1;
+    cfg->numaRebalanceHoldoff = 600;
+    cfg->resctrlControlStep = 10;
+    cfg->memoryManagerMinFree = 1024;
+    cfg->memoryManagerPressure = 10;
+    cfg->memoryManagerGuestMin = 50;
+    cfg->autoStartParallel = 1;
+
     if (!(cfg->namespaces = virBitmapNew(QEMU_DOMAIN_NS_LAST)))
         return NULL;
 
@@ -302,6 +313,7 @@ static void virQEMUDriverConfigDispose(void *obj)
     virBitmapFree(cfg->namespaces);
 
     g_strfreev(cfg->cgroupDeviceACL);
+    g_strfreev(cfg->vfioPool);
     VIR_FREE(cfg->uri);
 
     VIR_FREE(cfg->configBaseDir);
@@ -615,6 +627,17 @@ virQEMUDriverConfigLoadSaveEntry(virQEMUDriverConfigPtr cfg,
         return -1;
     if (virConfGetValueBool(conf, "auto_start_bypass_cache", &cfg->autoStartBypassCache) < 0)
         return -1;
+    if (virConfGetValueUInt(conf, "auto_start_parallel", &cfg->autoStartParallel) < 0)
+        return -1;
+    if (cfg->autoStartParallel == 0) {
+        virReportError(VIR_ERR_CONF_SYNTAX, "%s",
+                       _("auto_start_parallel must be greater than 0"));
+        return -1;
+    }
+    if (virConfGetValueUInt(conf, "auto_start_delay", &cfg->autoStartDelay) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "auto_start_max_pressure", &cfg->autoStartMaxPressure) < 0)
+        return -1;
 
     return 0;
 }
@@ -721,6 +744,8 @@ virQEMUDriverConfigLoadDeviceEntry(virQEMUDriverConfigPtr cfg,
 
     if (virConfGetValueBool(conf, "relaxed_acs_check", &cfg->relaxedACS) < 0)
         return -1;
+    if (virConfGetValueStringList(conf, "vfio_pool", false, &cfg->vfioPool) < 0)
+        return -1;
     if (virConfGetValueString(conf, "lock_manager", &cfg->lockManagerName) < 0)
         return -1;
     if ((rv = virConfGetValueBool(conf, "allow_disk_format_probing", &tmp)) < 0)
@@ -741,6 +766,47 @@ virQEMUDriverConfigLoadRPCEntry(virQEMUDriverConfigPtr cfg,
 {
     if (virConfGetValueUInt(conf, "max_queued", &cfg->maxQueuedJobs) < 0)
         return -1;
+    if (virConfGetValueUInt(conf, "stats_cache_timeout", &cfg->statsCacheTimeout) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "stats_workers", &cfg->statsWorkers) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "stats_timeout", &cfg->statsTimeout) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "stats_event_interval", &cfg->statsEventInterval) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "stats_event_types", &cfg->statsEventTypes) < 0)
+        return -1;
+    if (virConfGetValueBool(conf, "stats_shm", &cfg->statsShm) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "block_job_cache_timeout", &cfg->blockJobCacheTimeout) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "backup_bandwidth", &cfg->backupBandwidth) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "guest_info_cache_timeout", &cfg->guestInfoCacheTimeout) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "balloon_stats_interval", &cfg->balloonStatsInterval) < 0)
+        return -1;
+    if (virConfGetValueBool(conf, "hugepage_reserve", &cfg->hugepageReserve) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "memory_manager_interval", &cfg->memoryManagerInterval) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "memory_manager_min_free", &cfg->memoryManagerMinFree) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "memory_manager_pressure", &cfg->memoryManagerPressure) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "memory_manager_guest_min", &cfg->memoryManagerGuestMin) < 0)
+        return -1;
+    if (cfg->memoryManagerGuestMin > 100) {
+        virReportError(VIR_ERR_CONF_SYNTAX, "%s",
+                       _("memory_manager_guest_min must not exceed 100"));
+        return -1;
+    }
+    if (virConfGetValueUInt(conf, "monitor_event_threads", &cfg->monitorEventThreads) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "reconnect_workers", &cfg->reconnectWorkers) < 0)
+        return -1;
+    if (virConfGetValueBool(conf, "reconnect_defer_refresh", &cfg->reconnectDeferRefresh) < 0)
+        return -1;
     if (virConfGetValueInt(conf, "keepalive_interval", &cfg->keepAliveInterval) < 0)
         return -1;
     if (virConfGetValueUInt(conf, "keepalive_count", &cfg->keepAliveCount) < 0)
@@ -775,6 +841,10 @@ virQEMUDriverConfigLoadNetworkEntry(virQEMUDriverConfigPtr cfg,
         return -1;
     }
 
+    if (virConfGetValueUInt(conf, "migration_auto_tune_downtime",
+                            &cfg->migrationAutoTuneDowntime) < 0)
+        return -1;
+
     if (virConfGetValueString(conf, "migration_host", &cfg->migrateHost) < 0)
         return -1;
     virStringStripIPv6Brackets(cfg->migrateHost);
@@ -987,6 +1057,7 @@ virQEMUDriverConfigLoadMemoryEntry(virQEMUDriverConfigPtr cfg,
                                    virConfPtr conf)
 {
     g_autofree char *dir = NULL;
+    g_autofree char *placement = NULL;
     int rc;
 
     if ((rc = virConfGetValueString(conf, "memory_backing_dir", &dir)) < 0) {
@@ -994,7 +1065,40 @@ virQEMUDriverConfigLoadMemoryEntry(virQEMUDriverConfigPtr cfg,
     } else if (rc > 0) {
         VIR_FREE(cfg->memoryBackingDir);
         cfg->memoryBackingDir = g_strdup_printf("%s/libvirt/qemu", dir);
-        return 0;
+    }
+
+    if (virConfGetValueString(conf, "numa_placement", &placement) < 0)
+        return -1;
+    if (placement) {
+        if (STREQ(placement, "numad")) {
+            cfg->numaPlacementBuiltin = false;
+        } else if (STREQ(placement, "builtin")) {
+            cfg->numaPlacementBuiltin = true;
+        } else {
+            virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
+                           _("Unknown NUMA placement engine %s"),
+                           placement);
+            return -1;
+        }
+    }
+
+    if (virConfGetValueUInt(conf, "numa_rebalance_interval", &cfg->numaRebalanceInterval) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "numa_rebalance_max_moves", &cfg->numaRebalanceMaxMoves) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "numa_rebalance_holdoff", &cfg->numaRebalanceHoldoff) < 0)
+        return -1;
+
+    if (virConfGetValueUInt(conf, "resctrl_control_interval", &cfg->resctrlControlInterval) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "resctrl_bandwidth_limit", &cfg->resctrlBandwidthLimit) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "resctrl_control_step", &cfg->resctrlControlStep) < 0)
+        return -1;
+    if (cfg->resctrlControlStep == 0 || cfg->resctrlControlStep > 100) {
+        virReportError(VIR_ERR_CONF_SYNTAX, "%s",
+                       _("resctrl_control_step must be between 1 and 100"));
+        return -1;
     }
 
     return 0;
@@ -1320,6 +1424,70 @@ virQEMUDriverGetHostCPU(virQEMUDriverPtr driver)
 }
 
 
+/**
+ * virQEMUDriverUpdateNUMALoad:
+ * @driver: qemu driver data
+ * @nodeset: host NUMA nodes
+ * @ncpus: count of CPUs on every node in @nodeset
+ * @claim: whether to claim or release the CPUs
+ *
+ * Track CPUs claimed on host NUMA nodes by automatically placed domains.
+ */
+void
+virQEMUDriverUpdateNUMALoad(virQEMUDriverPtr driver,
+                            virBitmapPtr nodeset,
+                            unsigned int ncpus,
+                            bool claim)
+{
+    ssize_t last = virBitmapLastSetBit(nodeset);
+    ssize_t node = -1;
+
+    if (last < 0)
+        return;
+
+    qemuDriverLock(driver);
+
+    if (claim && last >= driver->nnumaLoad)
+        ignore_value(VIR_EXPAND_N(driver->numaLoad, driver->nnumaLoad,
+                                  last + 1 - driver->nnumaLoad));
+
+    while ((node = virBitmapNextSetBit(nodeset, node)) >= 0 &&
+           node < driver->nnumaLoad) {
+        if (claim)
+            driver->numaLoad[node] += ncpus;
+        else if (driver->numaLoad[node] > ncpus)
+            driver->numaLoad[node] -= ncpus;
+        else
+            driver->numaLoad[node] = 0;
+    }
+
+    qemuDriverUnlock(driver);
+}
+
+
+/**
+ * virQEMUDriverGetNUMALoad:
+ * @driver: qemu driver data
+ * @node: host NUMA node
+ *
+ * Returns the count of CPUs claimed on @node by automatically placed
+ * domains.
+ */
+unsigned int
+virQEMUDriverGetNUMALoad(virQEMUDriverPtr driver,
+                         int node)
+{
+    unsigned int ret = 0;
+
+    qemuDriverLock(driver);
+    if (node >= 0 && node < driver->nnumaLoad)
+        ret = driver->numaLoad[node];
+    qemuDriverUnlock(driver);
+
+    return ret;
+}
+
+
 virCapsPtr virQEMUDriverCreateCapabilities(virQEMUDriverPtr driver)
 {
     size_t i, j;
@@ -41,6 +41,8 @@
 #include "virportallocator.h"
 #include "vircommand.h"
 #include "virthreadpool.h"
+#include "virstatsshm.h"
+#include "vireventthread.h"
 #include "locking/lock_manager.h"
 #include "qemu_capabilities.h"
 #include "virclosecallbacks.h"
@@ -174,6 +176,7 @@ struct _virQEMUDriverConfig {
     bool macFilter;
 
     bool relaxedACS;
+    char **vfioPool;
     bool vncAllowHostAudio;
     bool nogfxAllowHostAudio;
     bool setProcessName;
@@ -186,6 +189,27 @@ struct _virQEMUDriverConfig {
 
     unsigned int maxQueuedJobs;
 
+    unsigned int statsCacheTimeout;
+    unsigned int statsWorkers;
+    unsigned int statsTimeout;
+    unsigned int statsEventInterval;
+    unsigned int statsEventTypes;
+    bool statsShm;
+
+    unsigned int blockJobCacheTimeout;
+    unsigned int backupBandwidth;
+    unsigned int guestInfoCacheTimeout;
+    unsigned int balloonStatsInterval;
+    unsigned int memoryManagerInterval;
+    unsigned int memoryManagerMinFree;
+    unsigned int memoryManagerPressure;
+    unsigned int memoryManagerGuestMin;
+    bool hugepageReserve;
+
+    unsigned int monitorEventThreads;
+    unsigned int reconnectWorkers;
+    bool reconnectDeferRefresh;
+
     char **securityDriverNames;
     bool securityDefaultConfined;
     bool securityRequireConfined;
@@ -197,6 +221,9 @@ struct _virQEMUDriverConfig {
     char *autoDumpPath;
     bool autoDumpBypassCache;
     bool autoStartBypassCache;
+    unsigned int autoStartParallel;
+    unsigned int autoStartDelay;
+    unsigned int autoStartMaxPressure;
 
     char *lockManagerName;
 
@@ -210,6 +237,7 @@ struct _virQEMUDriverConfig {
     char *migrationAddress;
     unsigned int migrationPortMin;
     unsigned int migrationPortMax;
+    unsigned int migrationAutoTuneDowntime;
 
     bool logTimestamp;
     bool stdioLogD;
@@ -220,6 +248,13 @@ struct _virQEMUDriverConfig {
     bool virtiofsdDebug;
 
     char *memoryBackingDir;
+    bool numaPlacementBuiltin;
+    unsigned int numaRebalanceInterval;
+    unsigned int numaRebalanceMaxMoves;
+    unsigned int numaRebalanceHoldoff;
+    unsigned int resctrlControlInterval;
+    unsigned int resctrlBandwidthLimit;
+    unsigned int resctrlControlStep;
 
     uid_t swtpm_user;
     gid_t swtpm_group;
@@ -244,6 +279,72 @@ struct _virQEMUDriver {
     /* Immutable pointer, self-locking APIs */
     virThreadPoolPtr workerPool;
 
+    /* Immutable pointer, self-locking APIs */
+    virThreadPoolPtr statsPool;
+
+    /* Immutable pointer, self-locking APIs. Stats published by the stats
+     * event thread if stats_shm is set */
+    virStatsShmPtr statsShm;
+
+    /* Immutable once initialized. Event loops shared by the monitors and
+     * agents of all domains if monitor_event_threads is set, along with
+     * the number of domains using each of them (atomic) */
+    virEventThread **eventThreads;
+    int *eventThreadUsers;
+    size_t neventThreads;
+
+    /* Immutable pointer, self-locking APIs. Reconnects to running
+     * domains on startup if reconnect_workers is set */
+    virThreadPoolPtr reconnectPool;
+
+    /* Thread emitting VIR_DOMAIN_EVENT_ID_STATS, statsEventQuit is
+     * protected by the driver lock */
+    virThread statsEventThread;
+    virCond statsEventCond;
+    bool statsEventThreadActive;
+    bool statsEventQuit;
+
+    /* Thread rebalancing domains between host NUMA nodes,
+     * numaRebalanceQuit is protected by the driver lock */
+    virThread numaRebalanceThread;
+    virCond numaRebalanceCond;
+    bool numaRebalanceThreadActive;
+    bool numaRebalanceQuit;
+
+    /* Thread throttling memory bandwidth allocations of domains,
+     * resctrlControlQuit is protected by the driver lock */
+    virThread resctrlControlThread;
+    virCond resctrlControlCond;
+    bool resctrlControlThreadActive;
+    bool resctrlControlQuit;
+
+    /* Thread polling balloon statistics of all domains,
+     * balloonStatsQuit is protected by the driver lock */
+    virThread balloonStatsThread;
+    virCond balloonStatsCond;
+    bool balloonStatsThreadActive;
+    bool balloonStatsQuit;
+
+    /* Thread adjusting balloons of domains to the host free memory,
+     * memoryManagerQuit is protected by the driver lock */
+    virThread memoryManagerThread;
+    virCond memoryManagerCond;
+    bool memoryManagerThreadActive;
+    bool memoryManagerQuit;
+
+    /* Thread scheduling the start of autostarted domains, autostartQuit
+     * and autostartInflight are protected by the driver lock */
+    virThread autostartThread;
+    virCond autostartCond;
+    bool autostartThreadActive;
+    bool autostartQuit;
+    size_t autostartInflight;
+
+    /* Protected by the driver lock. CPUs claimed on each host NUMA node
+     * by automatically placed domains, indexed by node */
+    unsigned int *numaLoad;
+    size_t nnumaLoad;
+
     /* Atomic increment only */
     int lastvmid;
 
@@ -341,6 +442,12 @@ virQEMUDriverConfigPtr virQEMUDriverGetConfig(virQEMUDriverPtr driver);
 
 virCapsHostNUMAPtr virQEMUDriverGetHostNUMACaps(virQEMUDriverPtr driver);
 virCPUDefPtr virQEMUDriverGetHostCPU(virQEMUDriverPtr driver);
+void virQEMUDriverUpdateNUMALoad(virQEMUDriverPtr driver,
+                                 virBitmapPtr nodeset,
+                                 unsigned int ncpus,
+                                 bool claim);
+unsigned int virQEMUDriverGetNUMALoad(virQEMUDriverPtr driver,
+                                      int node);
 virCapsPtr virQEMUDriverCreateCapabilities(virQEMUDriverPtr driver);
 virCapsPtr virQEMUDriverGetCapabilities(virQEMUDriverPtr driver,
                                         bool refresh);
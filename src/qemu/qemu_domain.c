@@ -1556,12 +1556,39 @@ qemuDomainSetPrivatePaths(virQEMUDriverPtr driver,
 }
 
 
+/* Picks the shared event loop used by the fewest domains */
+static size_t
+qemuDomainObjPickEventThread(virQEMUDriverPtr driver)
+{
+    size_t best = 0;
+    size_t i;
+
+    for (i = 1; i < driver->neventThreads; i++) {
+        if (g_atomic_int_get(&driver->eventThreadUsers[i]) <
+            g_atomic_int_get(&driver->eventThreadUsers[best]))
+            best = i;
+    }
+
+    return best;
+}
+
+
 int
 qemuDomainObjStartWorker(virDomainObjPtr dom)
 {
     qemuDomainObjPrivatePtr priv = dom->privateData;
+    virQEMUDriverPtr driver = priv->driver;
+
+    if (priv->eventThread)
+        return 0;
+
+    if (driver->neventThreads > 0) {
+        size_t shard = qemuDomainObjPickEventThread(driver);
 
-    if (!priv->eventThread) {
+        g_atomic_int_inc(&driver->eventThreadUsers[shard]);
+        priv->eventThread = g_object_ref(driver->eventThreads[shard]);
+        priv->eventThreadShard = shard;
+    } else {
         g_autofree char *threadName = g_strdup_printf("vm-%s", dom->def->name);
         if (!(priv->eventThread = virEventThreadNew(threadName)))
             return -1;
@@ -1575,11 +1602,17 @@ void
 qemuDomainObjStopWorker(virDomainObjPtr dom)
 {
     qemuDomainObjPrivatePtr priv = dom->privateData;
+    virQEMUDriverPtr driver = priv->driver;
 
     if (priv->eventThread) {
         g_object_unref(priv->eventThread);
         priv->eventThread = NULL;
     }
+
+    if (priv->eventThreadShard >= 0) {
+        ignore_value(g_atomic_int_dec_and_test(&driver->eventThreadUsers[priv->eventThreadShard]));
+        priv->eventThreadShard = -1;
+    }
 }
 
 
@@ -1603,9 +1636,16 @@ qemuDomainObjPrivateAlloc(void *opaque)
     if (!(priv->blockjobs = virHashCreate(5, virObjectFreeHashData)))
         goto error;
 
+    if (virMutexInit(&priv->balloonStatsLock) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to init qemu driver mutexes"));
+        goto error;
+    }
+
     /* agent commands block by default, user can choose different behavior */
     priv->agentTimeout = VIR_DOMAIN_AGENT_RESPONSE_TIMEOUT_BLOCK;
     priv->migMaxBandwidth = QEMU_DOMAIN_MIG_BANDWIDTH_MAX;
+    priv->eventThreadShard = -1;
     priv->driver = opaque;
 
     return priv;
@@ -1622,6 +1662,335 @@ qemuDomainObjPrivateAlloc(void *opaque)
  * Clears private data entries, which are not necessary or stale if the VM is
  * not running.
  */
+/**
+ * qemuDomainStatsCacheClear:
+ * @priv: domain private data
+ *
+ * Drops all cached bulk stats of the domain.
+ */
+void
+qemuDomainStatsCacheClear(qemuDomainObjPrivatePtr priv)
+{
+    size_t i;
+
+    for (i = 0; i < priv->nstatsCache; i++)
+        virTypedParamsFree(priv->statsCache[i].params,
+                           priv->statsCache[i].nparams);
+
+    VIR_FREE(priv->statsCache);
+    priv->nstatsCache = 0;
+}
+
+
+/**
+ * qemuDomainGuestInfoCacheClear:
+ * @priv: domain private data
+ *
+ * Drops the cached guest agent information of the domain.
+ */
+void
+qemuDomainGuestInfoCacheClear(qemuDomainObjPrivatePtr priv)
+{
+    virTypedParamsFree(priv->guestInfoCache.params,
+                       priv->guestInfoCache.nparams);
+    memset(&priv->guestInfoCache, 0, sizeof(priv->guestInfoCache));
+}
+
+
+/**
+ * qemuDomainBalloonStatsStore:
+ * @priv: domain private data
+ * @stats: balloon statistics gathered by the periodic poll
+ * @nstats: number of items in @stats
+ *
+ * Remembers @stats as the latest balloon statistics of the domain. Passing
+ * NULL @stats drops the remembered data. Safe to be called without the
+ * domain object lock.
+ */
+void
+qemuDomainBalloonStatsStore(qemuDomainObjPrivatePtr priv,
+                            virDomainMemoryStatPtr stats,
+                            int nstats)
+{
+    virMutexLock(&priv->balloonStatsLock);
+
+    priv->balloonStatsPending = false;
+    priv->nballoonStats = 0;
+    priv->balloonStatsTimestamp = 0;
+
+    if (stats && nstats >= 0) {
+        nstats = MIN(nstats, (int) G_N_ELEMENTS(priv->balloonStats));
+        memcpy(priv->balloonStats, stats, nstats * sizeof(*stats));
+        priv->nballoonStats = nstats;
+        priv->balloonStatsTimestamp = g_get_monotonic_time();
+    }
+
+    virMutexUnlock(&priv->balloonStatsLock);
+}
+
+
+/**
+ * qemuDomainBalloonStatsLookup:
+ * @priv: domain private data
+ * @maxAge: maximum age of the statistics in seconds
+ * @stats: array to fill
+ * @nr_stats: size of @stats
+ *
+ * Returns the number of items of @stats filled from the latest balloon
+ * statistics, or -1 if there are none younger than @maxAge.
+ */
+int
+qemuDomainBalloonStatsLookup(qemuDomainObjPrivatePtr priv,
+                             unsigned int maxAge,
+                             virDomainMemoryStatPtr stats,
+                             unsigned int nr_stats)
+{
+    int ret = -1;
+
+    virMutexLock(&priv->balloonStatsLock);
+
+    if (priv->balloonStatsTimestamp > 0 &&
+        g_get_monotonic_time() - priv->balloonStatsTimestamp <=
+        (long long) maxAge * G_USEC_PER_SEC) {
+        ret = MIN(priv->nballoonStats, (int) nr_stats);
+        memcpy(stats, priv->balloonStats, ret * sizeof(*stats));
+    }
+
+    virMutexUnlock(&priv->balloonStatsLock);
+    return ret;
+}
+
+
+/**
+ * qemuDomainStatsCacheLookup:
+ * @priv: domain private data
+ * @stats: VIR_DOMAIN_STATS_* group
+ * @flags: flags the stats must have been gathered with
+ * @maxAge: maximum age of the entry in microseconds, 0 for any
+ *
+ * Returns the cached entry for @stats or NULL if there's no entry fresh
+ * enough.
+ */
+qemuDomainStatsCacheEntryPtr
+qemuDomainStatsCacheLookup(qemuDomainObjPrivatePtr priv,
+                           unsigned int stats,
+                           unsigned int flags,
+                           long long maxAge)
+{
+    size_t i;
+
+    for (i = 0; i < priv->nstatsCache; i++) {
+        qemuDomainStatsCacheEntryPtr entry = priv->statsCache + i;
+
+        if (entry->stats != stats || entry->flags != flags)
+            continue;
+
+        if (maxAge > 0 &&
+            g_get_monotonic_time() - entry->timestamp > maxAge)
+            return NULL;
+
+        return entry;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * qemuDomainStatsCacheStore:
+ * @priv: domain private data
+ * @stats: VIR_DOMAIN_STATS_* group
+ * @flags: flags the stats were gathered with
+ * @params: stats to cache
+ * @nparams: number of items in @params
+ *
+ * Stores a copy of @params as the current result of @stats group
+ * replacing any previous entry.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuDomainStatsCacheStore(qemuDomainObjPrivatePtr priv,
+                          unsigned int stats,
+                          unsigned int flags,
+                          virTypedParameterPtr params,
+                          int nparams)
+{
+    qemuDomainStatsCacheEntryPtr entry = NULL;
+    size_t i;
+
+    for (i = 0; i < priv->nstatsCache; i++) {
+        if (priv->statsCache[i].stats == stats) {
+            entry = priv->statsCache + i;
+            break;
+        }
+    }
+
+    if (!entry) {
+        if (VIR_EXPAND_N(priv->statsCache, priv->nstatsCache, 1) < 0)
+            return -1;
+        entry = priv->statsCache + priv->nstatsCache - 1;
+    } else {
+        virTypedParamsFree(entry->params, entry->nparams);
+        entry->params = NULL;
+        entry->nparams = 0;
+    }
+
+    entry->stats = stats;
+    entry->flags = flags;
+    entry->timestamp = g_get_monotonic_time();
+
+    if (virTypedParamsCopy(&entry->params, params, nparams) < 0)
+        return -1;
+    entry->nparams = nparams;
+
+    return 0;
+}
+
+
+static void
+qemuDomainQueryFlightFree(qemuDomainQueryFlightPtr flight)
+{
+    if (!flight)
+        return;
+
+    if (flight->data && flight->freeData)
+        flight->freeData(flight->data);
+    g_free(flight->key);
+    g_free(flight);
+}
+
+
+/**
+ * qemuDomainQueryFlightBegin:
+ * @vm: domain object
+ * @key: string identifying the query and its arguments
+ *
+ * Announces that the caller, which holds a QEMU_JOB_QUERY job of @vm, is
+ * about to run the query identified by @key. Threads calling
+ * qemuDomainQueryFlightJoin() with the same @key until the job ends will
+ * share its result. The caller must finish the flight by calling
+ * qemuDomainQueryFlightEnd() before ending the job.
+ *
+ * Returns the new flight.
+ */
+qemuDomainQueryFlightPtr
+qemuDomainQueryFlightBegin(virDomainObjPtr vm,
+                           const char *key)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainQueryFlightPtr flight = g_new0(qemuDomainQueryFlight, 1);
+
+    flight->key = g_strdup(key);
+    flight->seq = priv->job.seq;
+    flight->refs = 1;
+
+    ignore_value(VIR_APPEND_ELEMENT_COPY(priv->queryFlights,
+                                         priv->nqueryFlights, flight));
+    return flight;
+}
+
+
+/**
+ * qemuDomainQueryFlightEnd:
+ * @vm: domain object
+ * @flight: flight returned by qemuDomainQueryFlightBegin()
+ * @ret: return value of the query
+ * @data: result of the query to share, may be NULL
+ * @freeData: callback to free @data with
+ *
+ * Publishes the result of the query for the threads waiting for it. The
+ * flight takes ownership of @data. Only results with @ret >= 0 are shared.
+ */
+void
+qemuDomainQueryFlightEnd(virDomainObjPtr vm,
+                         qemuDomainQueryFlightPtr flight,
+                         int ret,
+                         void *data,
+                         virFreeCallback freeData)
+{
+    flight->done = true;
+    flight->ret = ret;
+    flight->data = data;
+    flight->freeData = freeData;
+
+    qemuDomainQueryFlightLeave(vm, flight);
+}
+
+
+/**
+ * qemuDomainQueryFlightJoin:
+ * @vm: locked domain object
+ * @key: string identifying the query and its arguments
+ *
+ * If another thread is running the query identified by @key, waits for it
+ * to finish instead of queueing for a job to run the same query.
+ *
+ * Returns the finished flight whose result the caller has to copy and
+ * release by qemuDomainQueryFlightLeave(), or NULL if the caller has to
+ * run the query itself.
+ */
+qemuDomainQueryFlightPtr
+qemuDomainQueryFlightJoin(virDomainObjPtr vm,
+                          const char *key)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainQueryFlightPtr flight = NULL;
+    size_t i;
+
+    for (i = 0; i < priv->nqueryFlights; i++) {
+        if (!priv->queryFlights[i]->done &&
+            STREQ(priv->queryFlights[i]->key, key)) {
+            flight = priv->queryFlights[i];
+            break;
+        }
+    }
+
+    if (!flight)
+        return NULL;
+
+    VIR_DEBUG("Waiting for query '%s' of domain %s", key, vm->def->name);
+
+    flight->refs++;
+
+    if (qemuDomainObjWaitJobEnd(vm, flight->seq) < 0 ||
+        !flight->done || flight->ret < 0) {
+        qemuDomainQueryFlightLeave(vm, flight);
+        return NULL;
+    }
+
+    return flight;
+}
+
+
+/**
+ * qemuDomainQueryFlightLeave:
+ * @vm: domain object
+ * @flight: flight returned by qemuDomainQueryFlightJoin()
+ *
+ * Releases @flight once the caller copied its result.
+ */
+void
+qemuDomainQueryFlightLeave(virDomainObjPtr vm,
+                           qemuDomainQueryFlightPtr flight)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    size_t i;
+
+    if (--flight->refs > 0)
+        return;
+
+    for (i = 0; i < priv->nqueryFlights; i++) {
+        if (priv->queryFlights[i] == flight) {
+            VIR_DELETE_ELEMENT(priv->queryFlights, i, priv->nqueryFlights);
+            break;
+        }
+    }
+
+    qemuDomainQueryFlightFree(flight);
+}
+
+
 void
 qemuDomainObjPrivateDataClear(qemuDomainObjPrivatePtr priv)
 {
@@ -1651,6 +2020,9 @@ qemuDomainObjPrivateDataClear(qemuDomainObjPrivatePtr priv)
     virBitmapFree(priv->autoCpuset);
     priv->autoCpuset = NULL;
 
+    VIR_FREE(priv->resctrlControl);
+    priv->nresctrlControl = 0;
+
     /* remove address data */
     virDomainPCIAddressSetFree(priv->pciaddrs);
     priv->pciaddrs = NULL;
@@ -1663,6 +2035,10 @@ qemuDomainObjPrivateDataClear(qemuDomainObjPrivatePtr priv)
     /* clear previously used namespaces */
     virBitmapFree(priv->namespaces);
     priv->namespaces = NULL;
+    priv->nsBatchQueue = false;
+    g_clear_pointer(&priv->nsBatchMknod, g_strfreev);
+    g_clear_pointer(&priv->nsBatchUnlink, g_strfreev);
+    g_clear_pointer(&priv->nsBatchCreated, g_strfreev);
 
     priv->rememberOwner = false;
 
@@ -1691,6 +2067,10 @@ qemuDomainObjPrivateDataClear(qemuDomainObjPrivatePtr priv)
     priv->dbusVMStateIds = NULL;
 
     priv->dbusVMState = false;
+
+    qemuDomainStatsCacheClear(priv);
+    qemuDomainGuestInfoCacheClear(priv);
+    qemuDomainBalloonStatsStore(priv, NULL, 0);
 }
 
 
@@ -1705,6 +2085,7 @@ qemuDomainObjPrivateFree(void *data)
     qemuDomainObjFreeJob(&priv->job);
     VIR_FREE(priv->lockState);
     VIR_FREE(priv->origname);
+    VIR_FREE(priv->migrationTunnelSocket);
 
     virChrdevFree(priv->devs);
 
@@ -1723,6 +2104,12 @@ qemuDomainObjPrivateFree(void *data)
     qemuDomainMasterKeyFree(priv);
 
     virHashFree(priv->blockjobs);
+    virMutexDestroy(&priv->balloonStatsLock);
+
+    /* all threads using the flights hold a reference to the domain */
+    while (priv->nqueryFlights > 0)
+        qemuDomainQueryFlightFree(priv->queryFlights[--priv->nqueryFlights]);
+    VIR_FREE(priv->queryFlights);
 
     /* This should never be non-NULL if we get here, but just in case... */
     if (priv->eventThread) {
@@ -3703,10 +4090,8 @@ qemuCanonicalizeMachine(virDomainDefPtr def, virQEMUCapsPtr qemuCaps)
         return 0;
 
     if (STRNEQ(canon, def->os.machine)) {
-        char *tmp;
-        tmp = g_strdup(canon);
-        VIR_FREE(def->os.machine);
-        def->os.machine = tmp;
+        virStringInternRelease(def->os.machine);
+        def->os.machine = virStringIntern(canon);
     }
 
     return 0;
@@ -3985,7 +4370,7 @@ qemuDomainDefCPUPostParse(virDomainDefPtr def,
                 return -1;
             }
 
-            def->cpu->features[def->cpu->nfeatures].name = g_strdup("sve");
+            def->cpu->features[def->cpu->nfeatures].name = virStringIntern("sve");
             def->cpu->features[def->cpu->nfeatures].policy = VIR_CPU_FEATURE_REQUIRE;
 
             def->cpu->nfeatures++;
@@ -4162,13 +4547,17 @@ qemuDomainDefPostParseBasic(virDomainDefPtr def,
 
     /* check for emulator and create a default one if needed */
     if (!def->emulator) {
-        if (!(def->emulator = virQEMUCapsGetDefaultEmulator(
-                  driver->hostarch, def->os.arch))) {
+        g_autofree char *emulator = NULL;
+
+        if (!(emulator = virQEMUCapsGetDefaultEmulator(driver->hostarch,
+                                                       def->os.arch))) {
             virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                            _("No emulator found for arch '%s'"),
                            virArchToString(def->os.arch));
             return 1;
         }
+
+        def->emulator = virStringIntern(emulator);
     }
 
     return 0;
@@ -4209,7 +4598,7 @@ qemuDomainDefPostParse(virDomainDefPtr def,
             return -1;
         }
 
-        def->os.machine = g_strdup(machine);
+        def->os.machine = virStringIntern(machine);
     }
 
     qemuDomainNVRAMPathGenerate(cfg, def);
@@ -6300,15 +6689,15 @@ qemuFindQemuImgBinary(virQEMUDriverPtr driver)
     return driver->qemuImgBinary;
 }
 
-int
-qemuDomainSnapshotWriteMetadata(virDomainObjPtr vm,
-                                virDomainMomentObjPtr snapshot,
-                                virDomainXMLOptionPtr xmlopt,
-                                const char *snapshotDir)
+static int
+qemuDomainSnapshotFormatMetadata(virDomainObjPtr vm,
+                                 virDomainMomentObjPtr snapshot,
+                                 virDomainXMLOptionPtr xmlopt,
+                                 const char *snapshotDir,
+                                 char **snapFile,
+                                 char **xml)
 {
-    g_autofree char *newxml = NULL;
     g_autofree char *snapDir = NULL;
-    g_autofree char *snapFile = NULL;
     char uuidstr[VIR_UUID_STRING_BUFLEN];
     unsigned int flags = VIR_DOMAIN_SNAPSHOT_FORMAT_SECURE |
         VIR_DOMAIN_SNAPSHOT_FORMAT_INTERNAL;
@@ -6317,8 +6706,7 @@ qemuDomainSnapshotWriteMetadata(virDomainObjPtr vm,
     if (virDomainSnapshotGetCurrent(vm->snapshots) == snapshot)
         flags |= VIR_DOMAIN_SNAPSHOT_FORMAT_CURRENT;
     virUUIDFormat(vm->def->uuid, uuidstr);
-    newxml = virDomainSnapshotDefFormat(uuidstr, def, xmlopt, flags);
-    if (newxml == NULL)
+    if (!(*xml = virDomainSnapshotDefFormat(uuidstr, def, xmlopt, flags)))
         return -1;
 
     snapDir = g_strdup_printf("%s/%s", snapshotDir, vm->def->name);
@@ -6328,12 +6716,59 @@ qemuDomainSnapshotWriteMetadata(virDomainObjPtr vm,
         return -1;
     }
 
-    snapFile = g_strdup_printf("%s/%s.xml", snapDir, def->parent.name);
+    *snapFile = g_strdup_printf("%s/%s.xml", snapDir, def->parent.name);
+    return 0;
+}
+
+
+int
+qemuDomainSnapshotWriteMetadata(virDomainObjPtr vm,
+                                virDomainMomentObjPtr snapshot,
+                                virDomainXMLOptionPtr xmlopt,
+                                const char *snapshotDir)
+{
+    g_autofree char *newxml = NULL;
+    g_autofree char *snapFile = NULL;
+
+    if (qemuDomainSnapshotFormatMetadata(vm, snapshot, xmlopt, snapshotDir,
+                                         &snapFile, &newxml) < 0)
+        return -1;
 
     return virXMLSaveFile(snapFile, NULL, "snapshot-edit", newxml);
 }
 
 
+/* Like qemuDomainSnapshotWriteMetadata, but writes the metadata of all
+ * @nsnapshots snapshots with a single flush to disk. */
+int
+qemuDomainSnapshotWriteMetadataList(virDomainObjPtr vm,
+                                    virDomainMomentObjPtr *snapshots,
+                                    size_t nsnapshots,
+                                    virDomainXMLOptionPtr xmlopt,
+                                    const char *snapshotDir)
+{
+    char **snapFiles = g_new0(char *, nsnapshots + 1);
+    char **xmls = g_new0(char *, nsnapshots + 1);
+    size_t i;
+    int ret = -1;
+
+    for (i = 0; i < nsnapshots; i++) {
+        if (qemuDomainSnapshotFormatMetadata(vm, snapshots[i], xmlopt,
+                                             snapshotDir, &snapFiles[i],
+                                             &xmls[i]) < 0)
+            goto cleanup;
+    }
+
+    ret = virXMLSaveFiles((const char **) snapFiles, (const char **) xmls,
+                          nsnapshots, NULL, "snapshot-edit");
+
+ cleanup:
+    g_strfreev(snapFiles);
+    g_strfreev(xmls);
+    return ret;
+}
+
+
 /* The domain is expected to be locked and inactive. Return -1 on normal
  * failure, 1 if we skipped a disk due to try_all.  */
 static int
@@ -10384,6 +10819,7 @@ qemuProcessEventFree(struct qemuProcessEvent *event)
         virObjectUnref(event->data);
         break;
     case QEMU_PROCESS_EVENT_PR_DISCONNECT:
+    case QEMU_PROCESS_EVENT_RECONNECT_REFRESH:
     case QEMU_PROCESS_EVENT_LAST:
         break;
     }
@@ -10679,3 +11115,54 @@ qemuDomainDiskBlockJobIsSupported(virDomainObjPtr vm,
 
     return true;
 }
+
+
+
+/**
+ * qemuDomainNUMALoadCharge:
+ * @driver: qemu driver data
+ * @vm: domain object
+ *
+ * Account the vCPUs and IOThreads of @vm to the host NUMA nodes of its
+ * automatic placement, so that the builtin placement engine steers other
+ * domains away from them. The CPUs are split evenly among the nodes.
+ */
+void
+qemuDomainNUMALoadCharge(virQEMUDriverPtr driver,
+                         virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    unsigned int ncpus = virDomainDefGetVcpus(vm->def) + vm->def->niothreadids;
+    size_t nnodes;
+
+    if (!priv->autoNodeset || priv->numaLoad > 0)
+        return;
+
+    if ((nnodes = virBitmapCountBits(priv->autoNodeset)) == 0)
+        return;
+
+    priv->numaLoad = VIR_DIV_UP(ncpus, nnodes);
+    virQEMUDriverUpdateNUMALoad(driver, priv->autoNodeset, priv->numaLoad, true);
+}
+
+
+/**
+ * qemuDomainNUMALoadRelease:
+ * @driver: qemu driver data
+ * @vm: domain object
+ *
+ * Undo qemuDomainNUMALoadCharge(). Must be called before the automatic
+ * placement of @vm changes or is cleared.
+ */
+void
+qemuDomainNUMALoadRelease(virQEMUDriverPtr driver,
+                          virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    if (!priv->autoNodeset || priv->numaLoad == 0)
+        return;
+
+    virQEMUDriverUpdateNUMALoad(driver, priv->autoNodeset, priv->numaLoad, false);
+    priv->numaLoad = 0;
+}
@@ -128,16 +128,67 @@ struct _qemuDomainSecretInfo {
     } s;
 };
 
+typedef struct _qemuDomainResctrlControl qemuDomainResctrlControl;
+typedef qemuDomainResctrlControl *qemuDomainResctrlControlPtr;
+struct _qemuDomainResctrlControl {
+    size_t resctrl; /* index into def->resctrls */
+    unsigned int node; /* host memory bandwidth node id */
+    unsigned int bandwidth; /* bandwidth applied by the controller */
+    unsigned long long bytes; /* mbm_total_bytes at the last sample */
+    unsigned long long sampled; /* time of the last sample in milliseconds */
+    double rate; /* MiB/s used between the last two samples */
+};
+
 typedef struct _qemuDomainObjPrivate qemuDomainObjPrivate;
 typedef qemuDomainObjPrivate *qemuDomainObjPrivatePtr;
+typedef struct _qemuDomainHugepageReservation qemuDomainHugepageReservation;
+typedef qemuDomainHugepageReservation *qemuDomainHugepageReservationPtr;
+struct _qemuDomainHugepageReservation {
+    int node;                   /* host NUMA node */
+    unsigned int pagesize;      /* in KiB */
+    unsigned long long count;   /* pages added to the pool of @node */
+};
+
+typedef struct _qemuDomainStatsCacheEntry qemuDomainStatsCacheEntry;
+typedef qemuDomainStatsCacheEntry *qemuDomainStatsCacheEntryPtr;
+struct _qemuDomainStatsCacheEntry {
+    unsigned int stats; /* VIR_DOMAIN_STATS_* group */
+    unsigned int flags; /* flags the stats were gathered with */
+    long long timestamp; /* monotonic time of gathering in microseconds */
+
+    virTypedParameterPtr params;
+    int nparams;
+};
+
+typedef struct _qemuDomainQueryFlight qemuDomainQueryFlight;
+typedef qemuDomainQueryFlight *qemuDomainQueryFlightPtr;
+struct _qemuDomainQueryFlight {
+    char *key;              /* identifies the query and its arguments */
+    unsigned long long seq; /* job.seq of the job running the query */
+    size_t refs;            /* the thread running the query and those
+                               waiting for its result */
+    bool done;
+
+    int ret;                /* return value of the query */
+    void *data;             /* result of the query, may be NULL */
+    virFreeCallback freeData;
+};
+
 struct _qemuDomainObjPrivate {
     virQEMUDriverPtr driver;
 
     qemuDomainJobObj job;
 
     virBitmapPtr namespaces;
+    /* See qemuDomainNamespaceBatchBegin() */
+    bool nsBatchQueue;
+    char **nsBatchMknod;
+    char **nsBatchUnlink;
+    char **nsBatchCreated;
 
     virEventThread *eventThread;
+    /* index into driver->eventThreads if @eventThread is shared, or -1 */
+    int eventThreadShard;
 
     qemuMonitorPtr mon;
     virDomainChrSourceDefPtr monConfig;
@@ -167,6 +218,9 @@ struct _qemuDomainObjPrivate {
     char *origname;
     int nbdPort; /* Port used for migration with NBD */
     unsigned short migrationPort;
+    /* Socket of the incoming QEMU accepting parallel tunnel streams */
+    char *migrationTunnelSocket;
+    unsigned int migrationTunnelChannels;
     int preMigrationState;
 
     virChrdevsPtr devs;
@@ -180,6 +234,9 @@ struct _qemuDomainObjPrivate {
     virPerfPtr perf;
 
     qemuDomainUnpluggingDevice unplug;
+    /* devices detached together by qemuDomainDetachDevicesLive */
+    qemuDomainUnpluggingDevicePtr unplugBatch;
+    size_t nunplugBatch;
 
     char **qemuDevices; /* NULL-terminated list of devices aliases known to QEMU */
 
@@ -188,6 +245,16 @@ struct _qemuDomainObjPrivate {
     /* Bitmaps below hold data from the auto NUMA feature */
     virBitmapPtr autoNodeset;
     virBitmapPtr autoCpuset;
+    unsigned int numaLoad; /* CPUs claimed on each node of autoNodeset */
+    /* NUMA rebalancing state: CPU time in nanoseconds at the last sample,
+     * and when it was taken and the domain was last moved in milliseconds */
+    unsigned long long numaCpuTime;
+    unsigned long long numaSampled;
+    unsigned long long numaMoved;
+
+    /* memory bandwidth controller state of each memorytune node */
+    qemuDomainResctrlControlPtr resctrlControl;
+    size_t nresctrlControl;
 
     bool signalIOError; /* true if the domain condition should be signalled on
                            I/O error */
@@ -245,6 +312,9 @@ struct _qemuDomainObjPrivate {
 
     /* running block jobs */
     virHashTablePtr blockjobs;
+    /* g_get_monotonic_time() of the last query of progress of all
+     * block jobs, see qemuBlockJobGetInfo */
+    long long blockjobsInfoStamp;
 
     bool disableSlirp;
 
@@ -263,6 +333,41 @@ struct _qemuDomainObjPrivate {
     char **dbusVMStateIds;
     /* true if -object dbus-vmstate was added */
     bool dbusVMState;
+
+    /* cached results of bulk stats groups requiring a job */
+    qemuDomainStatsCacheEntryPtr statsCache;
+    size_t nstatsCache;
+    /* number of parameters of the last bulk stats record, used to size
+     * the next one up front */
+    size_t statsParamsHint;
+    /* bulk stats groups being gathered by the current job, the flags they
+     * are gathered with and when the job started, for callers which want
+     * to share the result */
+    unsigned int statsGathering;
+    unsigned int statsGatheringFlags;
+    long long statsGatheringStart;
+
+    /* queries whose results are shared with identical concurrent ones,
+     * see qemuDomainQueryFlightJoin() */
+    qemuDomainQueryFlightPtr *queryFlights;
+    size_t nqueryFlights;
+
+    /* cached result of virDomainGetGuestInfo, 'stats' holds the
+     * requested virDomainGuestInfoTypes */
+    qemuDomainStatsCacheEntry guestInfoCache;
+
+    /* balloon statistics gathered by the periodic poll or the last
+     * monitor query; guarded by @balloonStatsLock as they are updated
+     * from the monitor event thread without the domain object lock */
+    virMutex balloonStatsLock;
+    virDomainMemoryStatStruct balloonStats[VIR_DOMAIN_MEMORY_STAT_NR];
+    int nballoonStats;
+    long long balloonStatsTimestamp;
+    bool balloonStatsPending;
+
+    /* huge pages added to host pools for the domain by hugepage_reserve */
+    qemuDomainHugepageReservationPtr hugepageReservations;
+    size_t nhugepageReservations;
 };
 
 #define QEMU_DOMAIN_PRIVATE(vm) \
@@ -437,6 +542,7 @@ typedef enum {
     QEMU_PROCESS_EVENT_PR_DISCONNECT,
     QEMU_PROCESS_EVENT_RDMA_GID_STATUS_CHANGED,
     QEMU_PROCESS_EVENT_GUEST_CRASHLOADED,
+    QEMU_PROCESS_EVENT_RECONNECT_REFRESH,
 
     QEMU_PROCESS_EVENT_LAST
 } qemuProcessEventType;
@@ -606,6 +712,11 @@ int qemuDomainSnapshotWriteMetadata(virDomainObjPtr vm,
                                     virDomainMomentObjPtr snapshot,
                                     virDomainXMLOptionPtr xmlopt,
                                     const char *snapshotDir);
+int qemuDomainSnapshotWriteMetadataList(virDomainObjPtr vm,
+                                        virDomainMomentObjPtr *snapshots,
+                                        size_t nsnapshots,
+                                        virDomainXMLOptionPtr xmlopt,
+                                        const char *snapshotDir);
 
 int qemuDomainSnapshotForEachQcow2(virQEMUDriverPtr driver,
                                    virDomainObjPtr vm,
@@ -722,6 +833,39 @@ void qemuDomainCleanupRun(virQEMUDriverPtr driver,
 
 void qemuDomainObjPrivateDataClear(qemuDomainObjPrivatePtr priv);
 
+void qemuDomainStatsCacheClear(qemuDomainObjPrivatePtr priv);
+void qemuDomainGuestInfoCacheClear(qemuDomainObjPrivatePtr priv);
+
+void qemuDomainBalloonStatsStore(qemuDomainObjPrivatePtr priv,
+                                 virDomainMemoryStatPtr stats,
+                                 int nstats);
+int qemuDomainBalloonStatsLookup(qemuDomainObjPrivatePtr priv,
+                                 unsigned int maxAge,
+                                 virDomainMemoryStatPtr stats,
+                                 unsigned int nr_stats);
+qemuDomainStatsCacheEntryPtr
+qemuDomainStatsCacheLookup(qemuDomainObjPrivatePtr priv,
+                           unsigned int stats,
+                           unsigned int flags,
+                           long long maxAge);
+int qemuDomainStatsCacheStore(qemuDomainObjPrivatePtr priv,
+                              unsigned int stats,
+                              unsigned int flags,
+                              virTypedParameterPtr params,
+                              int nparams);
+
+qemuDomainQueryFlightPtr qemuDomainQueryFlightBegin(virDomainObjPtr vm,
+                                                    const char *key);
+void qemuDomainQueryFlightEnd(virDomainObjPtr vm,
+                              qemuDomainQueryFlightPtr flight,
+                              int ret,
+                              void *data,
+                              virFreeCallback freeData);
+qemuDomainQueryFlightPtr qemuDomainQueryFlightJoin(virDomainObjPtr vm,
+                                                   const char *key);
+void qemuDomainQueryFlightLeave(virDomainObjPtr vm,
+                                qemuDomainQueryFlightPtr flight);
+
 extern virDomainXMLPrivateDataCallbacks virQEMUDriverPrivateDataCallbacks;
 extern virXMLNamespace virQEMUDriverDomainXMLNamespace;
 extern virDomainDefParserConfig virQEMUDriverDomainDefParserConfig;
@@ -1017,3 +1161,11 @@ qemuDomainDiskBlockJobIsSupported(virDomainObjPtr vm,
 int
 qemuDomainDefNumaCPUsRectify(virDomainDefPtr def,
                              virQEMUCapsPtr qemuCaps);
+
+void
+qemuDomainNUMALoadCharge(virQEMUDriverPtr driver,
+                         virDomainObjPtr vm);
+
+void
+qemuDomainNUMALoadRelease(virQEMUDriverPtr driver,
+                          virDomainObjPtr vm);
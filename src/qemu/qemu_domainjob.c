@@ -26,6 +26,11 @@
 #include "virerror.h"
 #include "virtime.h"
 #include "virthreadjob.h"
+#include "virprobe.h"
+
+#ifdef WITH_DTRACE_PROBES
+# include "libvirt_qemu_probes.h"
+#endif
 
 #define VIR_FROM_THIS VIR_FROM_QEMU
 
@@ -63,6 +68,21 @@ VIR_ENUM_IMPL(qemuDomainAsyncJob,
               "backup",
 );
 
+VIR_ENUM_IMPL(qemuDomainStartPhase,
+              QEMU_DOMAIN_START_PHASE_LAST,
+              "init",
+              "prepare-domain",
+              "prepare-host",
+              "hostdev",
+              "launch",
+              "exec",
+              "cgroup",
+              "security-label",
+              "monitor",
+              "refresh-state",
+              "finish-startup",
+);
+
 const char *
 qemuDomainAsyncJobPhaseToString(qemuDomainAsyncJob job,
                                 int phase G_GNUC_UNUSED)
@@ -373,6 +393,7 @@ qemuDomainJobInfoToInfo(qemuDomainJobInfoPtr jobInfo,
         info->fileRemaining = info->fileTotal - info->fileProcessed;
         break;
 
+    case QEMU_DOMAIN_JOB_STATS_TYPE_START:
     case QEMU_DOMAIN_JOB_STATS_TYPE_NONE:
         break;
     }
@@ -662,6 +683,61 @@ qemuDomainBackupJobInfoToParams(qemuDomainJobInfoPtr jobInfo,
 }
 
 
+/* job statistics fields of the phases of domain startup */
+static const char *qemuDomainStartPhaseFields[] = {
+    [QEMU_DOMAIN_START_PHASE_INIT] = VIR_DOMAIN_JOB_START_TIME_INIT,
+    [QEMU_DOMAIN_START_PHASE_PREPARE_DOMAIN] = VIR_DOMAIN_JOB_START_TIME_PREPARE_DOMAIN,
+    [QEMU_DOMAIN_START_PHASE_PREPARE_HOST] = VIR_DOMAIN_JOB_START_TIME_PREPARE_HOST,
+    [QEMU_DOMAIN_START_PHASE_HOSTDEV] = VIR_DOMAIN_JOB_START_TIME_HOSTDEV,
+    [QEMU_DOMAIN_START_PHASE_LAUNCH] = VIR_DOMAIN_JOB_START_TIME_LAUNCH,
+    [QEMU_DOMAIN_START_PHASE_EXEC] = VIR_DOMAIN_JOB_START_TIME_EXEC,
+    [QEMU_DOMAIN_START_PHASE_CGROUP] = VIR_DOMAIN_JOB_START_TIME_CGROUP,
+    [QEMU_DOMAIN_START_PHASE_SECURITY_LABEL] = VIR_DOMAIN_JOB_START_TIME_SECURITY_LABEL,
+    [QEMU_DOMAIN_START_PHASE_MONITOR] = VIR_DOMAIN_JOB_START_TIME_MONITOR,
+    [QEMU_DOMAIN_START_PHASE_REFRESH_STATE] = VIR_DOMAIN_JOB_START_TIME_REFRESH_STATE,
+    [QEMU_DOMAIN_START_PHASE_FINISH_STARTUP] = VIR_DOMAIN_JOB_START_TIME_FINISH_STARTUP,
+};
+G_STATIC_ASSERT(G_N_ELEMENTS(qemuDomainStartPhaseFields) == QEMU_DOMAIN_START_PHASE_LAST);
+
+
+static int
+qemuDomainStartJobInfoToParams(qemuDomainJobInfoPtr jobInfo,
+                               int *type,
+                               virTypedParameterPtr *params,
+                               int *nparams)
+{
+    g_autoptr(virTypedParamList) par = g_new0(virTypedParamList, 1);
+    size_t i;
+
+    if (virTypedParamListAddInt(par, jobInfo->operation,
+                                VIR_DOMAIN_JOB_OPERATION) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(par, jobInfo->timeElapsed,
+                                   VIR_DOMAIN_JOB_TIME_ELAPSED) < 0)
+        return -1;
+
+    for (i = 0; i < QEMU_DOMAIN_START_PHASE_LAST; i++) {
+        if (!(jobInfo->startPhasesDone & (1U << i)))
+            continue;
+
+        if (virTypedParamListAddULLong(par, jobInfo->startPhases[i], "%s",
+                                       qemuDomainStartPhaseFields[i]) < 0)
+            return -1;
+    }
+
+    if (jobInfo->status != QEMU_DOMAIN_JOB_STATUS_ACTIVE &&
+        virTypedParamListAddBoolean(par,
+                                    jobInfo->status == QEMU_DOMAIN_JOB_STATUS_COMPLETED,
+                                    VIR_DOMAIN_JOB_SUCCESS) < 0)
+        return -1;
+
+    *nparams = virTypedParamListStealParams(par, params);
+    *type = qemuDomainJobStatusToType(jobInfo->status);
+    return 0;
+}
+
+
 int
 qemuDomainJobInfoToParams(qemuDomainJobInfoPtr jobInfo,
                           int *type,
@@ -679,6 +755,9 @@ qemuDomainJobInfoToParams(qemuDomainJobInfoPtr jobInfo,
     case QEMU_DOMAIN_JOB_STATS_TYPE_BACKUP:
         return qemuDomainBackupJobInfoToParams(jobInfo, type, params, nparams);
 
+    case QEMU_DOMAIN_JOB_STATS_TYPE_START:
+        return qemuDomainStartJobInfoToParams(jobInfo, type, params, nparams);
+
     case QEMU_DOMAIN_JOB_STATS_TYPE_NONE:
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("invalid job statistics type"));
@@ -729,6 +808,8 @@ qemuDomainObjSetAsyncJobMask(virDomainObjPtr obj,
         return;
 
     priv->job.mask = allowedJobs | JOB_MASK(QEMU_JOB_DESTROY);
+    /* jobs waiting for the async job to finish may be allowed now */
+    virCondBroadcast(&priv->job.asyncCond);
 }
 
 void
@@ -783,6 +864,140 @@ qemuDomainObjCanSetJob(qemuDomainJobObjPtr job,
              job->agentActive == QEMU_AGENT_JOB_NONE));
 }
 
+struct _qemuDomainJobWaiter {
+    qemuDomainJob job;
+    qemuDomainAgentJob agentJob;
+    bool nested;
+
+    qemuDomainJobWaiterPtr next;
+};
+
+/* Jobs which are queued ahead of the others. Neither destroying the domain
+ * nor the async job everyone else waits for should be stuck behind a pile
+ * of queries. */
+#define QEMU_JOB_PRIORITY_MASK \
+    (JOB_MASK(QEMU_JOB_DESTROY) | \
+     JOB_MASK(QEMU_JOB_ABORT) | \
+     JOB_MASK(QEMU_JOB_ASYNC_NESTED))
+
+static bool
+qemuDomainJobWaiterIsPriority(qemuDomainJobWaiterPtr waiter)
+{
+    return (QEMU_JOB_PRIORITY_MASK & JOB_MASK(waiter->job)) != 0;
+}
+
+
+static void
+qemuDomainJobWaiterEnqueue(qemuDomainJobObjPtr job,
+                           qemuDomainJobWaiterPtr waiter)
+{
+    qemuDomainJobWaiterPtr *next = &job->waiters;
+    bool priority = qemuDomainJobWaiterIsPriority(waiter);
+
+    while (*next && (!priority || qemuDomainJobWaiterIsPriority(*next)))
+        next = &(*next)->next;
+
+    waiter->next = *next;
+    *next = waiter;
+}
+
+
+static void
+qemuDomainJobWaiterDequeue(qemuDomainJobObjPtr job,
+                           qemuDomainJobWaiterPtr waiter)
+{
+    qemuDomainJobWaiterPtr *next = &job->waiters;
+    int save_errno = errno;
+
+    while (*next && *next != waiter)
+        next = &(*next)->next;
+
+    if (*next)
+        *next = waiter->next;
+    waiter->next = NULL;
+
+    /* threads queued behind @waiter may be first in line now */
+    virCondBroadcast(&job->cond);
+    errno = save_errno;
+}
+
+
+static bool
+qemuDomainJobWaiterReady(qemuDomainJobObjPtr job,
+                         qemuDomainJobWaiterPtr waiter)
+{
+    return (waiter->nested ||
+            qemuDomainNestedJobAllowed(job, waiter->job)) &&
+           qemuDomainObjCanSetJob(job, waiter->job, waiter->agentJob);
+}
+
+
+/**
+ * qemuDomainJobWaiterIsFirst:
+ * @job: job object
+ * @waiter: thread waiting for a job
+ *
+ * Checks that no thread queued before @waiter could start a job which
+ * excludes the job @waiter wants right away. Threads waiting for the end
+ * of an async job or for a different kind of job don't hold @waiter up.
+ * The whole queue is checked if @waiter is not queued.
+ *
+ * Returns true if @waiter is allowed to start its job.
+ */
+static bool
+qemuDomainJobWaiterIsFirst(qemuDomainJobObjPtr job,
+                           qemuDomainJobWaiterPtr waiter)
+{
+    qemuDomainJobWaiterPtr w;
+
+    for (w = job->waiters; w && w != waiter; w = w->next) {
+        if (((w->job && waiter->job) ||
+             (w->agentJob && waiter->agentJob)) &&
+            qemuDomainJobWaiterReady(job, w))
+            return false;
+    }
+
+    return true;
+}
+
+
+static void
+qemuDomainJobWaitStatsRecord(qemuDomainJobObjPtr job,
+                             qemuDomainJob newJob,
+                             qemuDomainAgentJob newAgentJob,
+                             unsigned long long wait,
+                             bool timeout)
+{
+    qemuDomainJobWaitStatsPtr stats;
+
+    if (newJob)
+        stats = job->wait + newJob;
+    else
+        stats = job->agentWait + newAgentJob;
+
+    if (timeout) {
+        stats->timeouts++;
+        return;
+    }
+
+    stats->count++;
+    stats->total += wait;
+    stats->max = MAX(stats->max, wait);
+}
+
+
+/* Returns milliseconds elapsed since @started, for the job probes */
+static unsigned long long G_GNUC_UNUSED
+qemuDomainObjJobElapsed(unsigned long long started)
+{
+    unsigned long long now;
+
+    if (!started || virTimeMillisNow(&now) < 0)
+        return 0;
+
+    return now - started;
+}
+
 /* Give up waiting for mutex after 30 seconds */
 #define QEMU_JOB_WAIT_TIME (1000ull * 30)
 
@@ -797,7 +1012,9 @@ qemuDomainObjCanSetJob(qemuDomainJobObjPtr job,
  * Acquires job for a domain object which must be locked before
  * calling. If there's already a job running waits up to
  * QEMU_JOB_WAIT_TIME after which the functions fails reporting
- * an error unless @nowait is set.
+ * an error unless @nowait is set. Waiting threads get their jobs
+ * in the order they asked for them, except for destroy, abort
+ * and nested async jobs which are queued before the others.
  *
  * If @nowait is true this function tries to acquire job and if
  * it fails, then it returns immediately without waiting. No
@@ -819,6 +1036,7 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
     qemuDomainObjPrivatePtr priv = obj->privateData;
     unsigned long long now;
     unsigned long long then;
+    unsigned long long start;
     bool nested = job == QEMU_JOB_ASYNC_NESTED;
     bool async = job == QEMU_JOB_ASYNC;
     g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
@@ -828,6 +1046,11 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
     unsigned long long duration = 0;
     unsigned long long agentDuration = 0;
     unsigned long long asyncDuration = 0;
+    qemuDomainJobWaiter waiter = {
+        .job = job,
+        .agentJob = agentJob,
+        .nested = nested,
+    };
 
     VIR_DEBUG("Starting job: job=%s agentJob=%s asyncJob=%s "
               "(vm=%p name=%s, current job=%s agentJob=%s async=%s)",
@@ -843,40 +1066,58 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
         return -1;
 
     priv->jobs_queued++;
+    start = now;
     then = now + QEMU_JOB_WAIT_TIME;
 
- retry:
     if ((!async && job != QEMU_JOB_DESTROY) &&
         cfg->maxQueuedJobs &&
         priv->jobs_queued > cfg->maxQueuedJobs) {
         goto error;
     }
 
-    while (!nested && !qemuDomainNestedJobAllowed(&priv->job, job)) {
-        if (nowait)
+    if (nowait) {
+        if (!qemuDomainJobWaiterReady(&priv->job, &waiter) ||
+            !qemuDomainJobWaiterIsFirst(&priv->job, &waiter))
             goto cleanup;
+    } else {
+        qemuDomainJobWaiterEnqueue(&priv->job, &waiter);
+
+        while (true) {
+            int rc;
+
+            /* A new async job could have been started while obj was
+             * unlocked, so it's checked on every wakeup. */
+            if (!nested && !qemuDomainNestedJobAllowed(&priv->job, job)) {
+                VIR_DEBUG("Waiting for async job (vm=%p name=%s)",
+                          obj, obj->def->name);
+                rc = virCondWaitUntil(&priv->job.asyncCond,
+                                      &obj->parent.lock, then);
+            } else if (!qemuDomainObjCanSetJob(&priv->job, job, agentJob) ||
+                       !qemuDomainJobWaiterIsFirst(&priv->job, &waiter)) {
+                VIR_DEBUG("Waiting for job (vm=%p name=%s)",
+                          obj, obj->def->name);
+                rc = virCondWaitUntil(&priv->job.cond,
+                                      &obj->parent.lock, then);
+            } else {
+                break;
+            }
 
-        VIR_DEBUG("Waiting for async job (vm=%p name=%s)", obj, obj->def->name);
-        if (virCondWaitUntil(&priv->job.asyncCond, &obj->parent.lock, then) < 0)
-            goto error;
-    }
-
-    while (!qemuDomainObjCanSetJob(&priv->job, job, agentJob)) {
-        if (nowait)
-            goto cleanup;
+            if (rc < 0) {
+                qemuDomainJobWaiterDequeue(&priv->job, &waiter);
+                goto error;
+            }
+        }
 
-        VIR_DEBUG("Waiting for job (vm=%p name=%s)", obj, obj->def->name);
-        if (virCondWaitUntil(&priv->job.cond, &obj->parent.lock, then) < 0)
-            goto error;
+        qemuDomainJobWaiterDequeue(&priv->job, &waiter);
     }
 
-    /* No job is active but a new async job could have been started while obj
-     * was unlocked, so we need to recheck it. */
-    if (!nested && !qemuDomainNestedJobAllowed(&priv->job, job))
-        goto retry;
-
     ignore_value(virTimeMillisNow(&now));
 
+    qemuDomainJobWaitStatsRecord(&priv->job, job, agentJob, now - start, false);
+
+    if (job && !async && priv->mon)
+        qemuMonitorRecordJobWait(priv->mon, (now - start) * 1000);
+
     if (job) {
         qemuDomainObjResetJob(&priv->job);
 
@@ -918,6 +1159,14 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
         priv->job.agentStarted = now;
     }
 
+    PROBE_QUIET(QEMU_JOB_BEGIN,
+                "vm=%s job=%s agentjob=%s asyncjob=%s wait=%llu",
+                obj->def->name,
+                qemuDomainJobTypeToString(job),
+                qemuDomainAgentJobTypeToString(agentJob),
+                qemuDomainAsyncJobTypeToString(asyncJob),
+                now - start);
+
     if (qemuDomainTrackJob(job))
         qemuDomainObjSaveStatus(driver, obj);
 
@@ -960,6 +1209,8 @@ qemuDomainObjBeginJobInternal(virQEMUDriverPtr driver,
         agentBlocker = priv->job.agentOwnerAPI;
 
     if (errno == ETIMEDOUT) {
+        qemuDomainJobWaitStatsRecord(&priv->job, job, agentJob, 0, true);
+
         if (blocker && agentBlocker) {
             virReportError(VIR_ERR_OPERATION_TIMEOUT,
                            _("cannot acquire state change "
@@ -1120,6 +1371,38 @@ qemuDomainObjBeginJobNowait(virQEMUDriverPtr driver,
                                          QEMU_ASYNC_JOB_NONE, true);
 }
 
+/**
+ * qemuDomainObjWaitJobEnd:
+ * @obj: domain object
+ * @seq: value of job.seq read while the job to wait for was active
+ *
+ * Waits up to QEMU_JOB_WAIT_TIME for the end of the QEMU_JOB_* job which
+ * was active when job.seq was @seq, e.g. to reuse its result instead of
+ * queueing for a job doing the same. The domain object must be locked
+ * before calling.
+ *
+ * Returns 0 once the job finished, -1 on timeout or error. No error is
+ * reported.
+ */
+int
+qemuDomainObjWaitJobEnd(virDomainObjPtr obj,
+                        unsigned long long seq)
+{
+    qemuDomainObjPrivatePtr priv = obj->privateData;
+    unsigned long long now;
+
+    if (virTimeMillisNowRaw(&now) < 0)
+        return -1;
+
+    while (priv->job.seq == seq) {
+        if (virCondWaitUntil(&priv->job.cond, &obj->parent.lock,
+                             now + QEMU_JOB_WAIT_TIME) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
 /*
  * obj must be locked and have a reference before calling
  *
@@ -1139,9 +1422,21 @@ qemuDomainObjEndJob(virQEMUDriverPtr driver, virDomainObjPtr obj)
               qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
               obj, obj->def->name);
 
+    PROBE_QUIET(QEMU_JOB_END,
+                "vm=%s job=%s agentjob=%s asyncjob=%s duration=%llu",
+                obj->def->name,
+                qemuDomainJobTypeToString(job),
+                qemuDomainAgentJobTypeToString(QEMU_AGENT_JOB_NONE),
+                qemuDomainAsyncJobTypeToString(QEMU_ASYNC_JOB_NONE),
+                qemuDomainObjJobElapsed(priv->job.started));
+
     qemuDomainObjResetJob(&priv->job);
-    if (qemuDomainTrackJob(job))
+    priv->job.seq++;
+    if (qemuDomainTrackJob(job)) {
+        /* the job might have changed what the cached stats describe */
+        qemuDomainStatsCacheClear(priv);
         qemuDomainObjSaveStatus(driver, obj);
+    }
     /* We indeed need to wake up ALL threads waiting because
      * grabbing a job requires checking more variables. */
     virCondBroadcast(&priv->job.cond);
@@ -1160,6 +1455,14 @@ qemuDomainObjEndAgentJob(virDomainObjPtr obj)
               qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
               obj, obj->def->name);
 
+    PROBE_QUIET(QEMU_JOB_END,
+                "vm=%s job=%s agentjob=%s asyncjob=%s duration=%llu",
+                obj->def->name,
+                qemuDomainJobTypeToString(QEMU_JOB_NONE),
+                qemuDomainAgentJobTypeToString(agentJob),
+                qemuDomainAsyncJobTypeToString(QEMU_ASYNC_JOB_NONE),
+                qemuDomainObjJobElapsed(priv->job.agentStarted));
+
     qemuDomainObjResetAgentJob(&priv->job);
     /* We indeed need to wake up ALL threads waiting because
      * grabbing a job requires checking more variables. */
@@ -1177,6 +1480,14 @@ qemuDomainObjEndAsyncJob(virQEMUDriverPtr driver, virDomainObjPtr obj)
               qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
               obj, obj->def->name);
 
+    PROBE_QUIET(QEMU_JOB_END,
+                "vm=%s job=%s agentjob=%s asyncjob=%s duration=%llu",
+                obj->def->name,
+                qemuDomainJobTypeToString(QEMU_JOB_ASYNC),
+                qemuDomainAgentJobTypeToString(QEMU_AGENT_JOB_NONE),
+                qemuDomainAsyncJobTypeToString(priv->job.asyncJob),
+                qemuDomainObjJobElapsed(priv->job.asyncStarted));
+
     qemuDomainObjResetAsyncJob(&priv->job);
     qemuDomainObjSaveStatus(driver, obj);
     virCondBroadcast(&priv->job.asyncCond);
@@ -97,8 +97,27 @@ typedef enum {
     QEMU_DOMAIN_JOB_STATS_TYPE_SAVEDUMP,
     QEMU_DOMAIN_JOB_STATS_TYPE_MEMDUMP,
     QEMU_DOMAIN_JOB_STATS_TYPE_BACKUP,
+    QEMU_DOMAIN_JOB_STATS_TYPE_START,
 } qemuDomainJobStatsType;
 
+/* Phases of domain startup timed in qemuDomainJobInfo */
+typedef enum {
+    QEMU_DOMAIN_START_PHASE_INIT,
+    QEMU_DOMAIN_START_PHASE_PREPARE_DOMAIN,
+    QEMU_DOMAIN_START_PHASE_PREPARE_HOST,
+    QEMU_DOMAIN_START_PHASE_HOSTDEV,
+    QEMU_DOMAIN_START_PHASE_LAUNCH,
+    QEMU_DOMAIN_START_PHASE_EXEC,
+    QEMU_DOMAIN_START_PHASE_CGROUP,
+    QEMU_DOMAIN_START_PHASE_SECURITY_LABEL,
+    QEMU_DOMAIN_START_PHASE_MONITOR,
+    QEMU_DOMAIN_START_PHASE_REFRESH_STATE,
+    QEMU_DOMAIN_START_PHASE_FINISH_STARTUP,
+
+    QEMU_DOMAIN_START_PHASE_LAST
+} qemuDomainStartPhase;
+VIR_ENUM_DECL(qemuDomainStartPhase);
+
 
 typedef struct _qemuDomainMirrorStats qemuDomainMirrorStats;
 typedef qemuDomainMirrorStats *qemuDomainMirrorStatsPtr;
@@ -143,6 +162,12 @@ struct _qemuDomainJobInfo {
     } stats;
     qemuDomainMirrorStats mirrorStats;
 
+    /* Durations of the phases of domain startup in ms, valid for phases
+     * with their bit set in startPhasesDone. Phases which haven't finished
+     * yet store the time they began at. */
+    unsigned long long startPhases[QEMU_DOMAIN_START_PHASE_LAST];
+    unsigned int startPhasesDone;
+
     char *errmsg; /* optional error message for failed completed jobs */
 };
 
@@ -154,6 +179,18 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(qemuDomainJobInfo, qemuDomainJobInfoFree);
 qemuDomainJobInfoPtr
 qemuDomainJobInfoCopy(qemuDomainJobInfoPtr info);
 
+typedef struct _qemuDomainJobWaiter qemuDomainJobWaiter;
+typedef qemuDomainJobWaiter *qemuDomainJobWaiterPtr;
+
+typedef struct _qemuDomainJobWaitStats qemuDomainJobWaitStats;
+typedef qemuDomainJobWaitStats *qemuDomainJobWaitStatsPtr;
+struct _qemuDomainJobWaitStats {
+    unsigned long long count;           /* number of acquired jobs */
+    unsigned long long timeouts;        /* number of jobs which timed out */
+    unsigned long long total;           /* total time waited in ms */
+    unsigned long long max;             /* longest time waited in ms */
+};
+
 typedef struct _qemuDomainJobObj qemuDomainJobObj;
 typedef qemuDomainJobObj *qemuDomainJobObjPtr;
 
@@ -177,6 +214,11 @@ struct _qemuDomainObjPrivateJobCallbacks {
 
 struct _qemuDomainJobObj {
     virCond cond;                       /* Use to coordinate jobs */
+    qemuDomainJobWaiterPtr waiters;     /* Threads waiting for a job in the
+                                           order they will get it */
+    unsigned long long seq;             /* Number of finished QEMU_JOB_* */
+    qemuDomainJobWaitStats wait[QEMU_JOB_LAST];
+    qemuDomainJobWaitStats agentWait[QEMU_AGENT_JOB_LAST];
 
     /* The following members are for QEMU_JOB_* */
     qemuDomainJob active;               /* Currently running job */
@@ -238,6 +280,9 @@ int qemuDomainObjBeginJobNowait(virQEMUDriverPtr driver,
                                 virDomainObjPtr obj,
                                 qemuDomainJob job)
     G_GNUC_WARN_UNUSED_RESULT;
+int qemuDomainObjWaitJobEnd(virDomainObjPtr obj,
+                            unsigned long long seq)
+    G_GNUC_WARN_UNUSED_RESULT;
 
 void qemuDomainObjEndJob(virQEMUDriverPtr driver,
                          virDomainObjPtr obj);
@@ -106,6 +106,13 @@
 #include "virdomaincheckpointobjlist.h"
 #include "virsocket.h"
 #include "virutil.h"
+#include "viridentity.h"
+#include "virprobe.h"
+#include "virwritebehind.h"
+
+#ifdef WITH_DTRACE_PROBES
+# include "libvirt_qemu_probes.h"
+#endif
 
 #define VIR_FROM_THIS VIR_FROM_QEMU
 
@@ -139,6 +146,13 @@ static void qemuProcessEventHandler(void *data, void *opaque);
 
 static int qemuStateCleanup(void);
 
+static void qemuDomainGetStatsWorkerHandler(void *data, void *opaque);
+static void qemuDomainStatsEventThread(void *opaque);
+static void qemuDomainNUMARebalanceThread(void *opaque);
+static void qemuDomainResctrlControlThread(void *opaque);
+static void qemuDomainBalloonStatsThread(void *opaque);
+static void qemuDomainMemoryManagerThread(void *opaque);
+
 static int qemuDomainObjStart(virConnectPtr conn,
                               virQEMUDriverPtr driver,
                               virDomainObjPtr vm,
@@ -190,20 +204,38 @@ qemuSnapObjFromSnapshot(virDomainObjPtr vm,
 }
 
 
-static int
-qemuAutostartDomain(virDomainObjPtr vm,
-                    void *opaque)
+/* How long a domain is held back by the host pressure at most, in
+ * milliseconds, so that a permanently loaded host still starts it */
+#define QEMU_AUTOSTART_PRESSURE_MAX_WAIT (60 * 1000)
+#define QEMU_AUTOSTART_PRESSURE_POLL 1000
+
+typedef struct _qemuAutostartEntry qemuAutostartEntry;
+typedef qemuAutostartEntry *qemuAutostartEntryPtr;
+struct _qemuAutostartEntry {
+    virDomainObjPtr vm;
+    int priority;
+    unsigned int delay;
+};
+
+typedef struct _qemuAutostartList qemuAutostartList;
+typedef qemuAutostartList *qemuAutostartListPtr;
+struct _qemuAutostartList {
+    qemuAutostartEntryPtr entries;
+    size_t nentries;
+};
+
+
+/* Starts @vm, consuming the reference and the lock held by the caller */
+static void
+qemuAutostartDomain(virQEMUDriverPtr driver,
+                    virDomainObjPtr vm)
 {
-    virQEMUDriverPtr driver = opaque;
     int flags = 0;
     g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
-    int ret = -1;
 
     if (cfg->autoStartBypassCache)
         flags |= VIR_DOMAIN_START_BYPASS_CACHE;
 
-    virObjectLock(vm);
-    virObjectRef(vm);
     virResetLastError();
     if (vm->autostart &&
         !virDomainObjIsActive(vm)) {
@@ -225,17 +257,252 @@ qemuAutostartDomain(virDomainObjPtr vm,
         qemuProcessEndJob(driver, vm);
     }
 
-    ret = 0;
  cleanup:
     virDomainObjEndAPI(&vm);
-    return ret;
+}
+
+
+static void
+qemuAutostartWorker(void *jobdata,
+                    void *opaque)
+{
+    virQEMUDriverPtr driver = opaque;
+    virDomainObjPtr vm = jobdata;
+
+    virObjectLock(vm);
+    qemuAutostartDomain(driver, vm);
+
+    virMutexLock(&driver->lock);
+    driver->autostartInflight--;
+    virCondBroadcast(&driver->autostartCond);
+    virMutexUnlock(&driver->lock);
+}
+
+
+static int
+qemuAutostartCollect(virDomainObjPtr vm,
+                     void *opaque)
+{
+    qemuAutostartListPtr list = opaque;
+    qemuAutostartEntry entry = { 0 };
+
+    virObjectLock(vm);
+    if (vm->autostart && !virDomainObjIsActive(vm)) {
+        entry.vm = virObjectRef(vm);
+        entry.priority = vm->def->autostart.priority;
+        entry.delay = vm->def->autostart.delay;
+        ignore_value(VIR_APPEND_ELEMENT(list->entries, list->nentries, entry));
+    }
+    virObjectUnlock(vm);
+
+    return 0;
+}
+
+
+static int
+qemuAutostartEntryCompare(const void *a,
+                          const void *b)
+{
+    const qemuAutostartEntry *ea = a;
+    const qemuAutostartEntry *eb = b;
+
+    if (ea->priority != eb->priority)
+        return ea->priority > eb->priority ? -1 : 1;
+    if (ea->delay != eb->delay)
+        return ea->delay < eb->delay ? -1 : 1;
+    return 0;
+}
+
+
+static bool
+qemuAutostartHostUnderPressure(unsigned int maxPressure)
+{
+    virCgroupPressure some;
+    virCgroupPressure full;
+    bool hasFull;
+    size_t i;
+
+    for (i = 0; i < VIR_CGROUP_PRESSURE_LAST; i++) {
+        int rc = virCgroupGetHostPressure(i, &some, &full, &hasFull);
+
+        if (rc < 0) {
+            virResetLastError();
+            continue;
+        }
+
+        if (rc > 0 && some.avg10 >= maxPressure) {
+            VIR_DEBUG("Host %s pressure is %.2f%%",
+                      virCgroupPressureResourceTypeToString(i), some.avg10);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/* Waits until @entry may be started. Must be called with the driver lock
+ * held. Returns false if the driver is shutting down. */
+static bool
+qemuAutostartWait(virQEMUDriverPtr driver,
+                  virQEMUDriverConfigPtr cfg,
+                  qemuAutostartEntryPtr entry,
+                  bool newPriority,
+                  unsigned long long start,
+                  unsigned long long lastStart)
+{
+    unsigned long long now;
+    unsigned long long until;
+    unsigned long long pressureSince = 0;
+
+    while (!driver->autostartQuit) {
+        if (virTimeMillisNow(&now) < 0) {
+            virResetLastError();
+            return !driver->autostartQuit;
+        }
+
+        /* domains of a lower priority wait for all domains with a higher
+         * one to finish starting */
+        if (driver->autostartInflight >= cfg->autoStartParallel ||
+            (newPriority && driver->autostartInflight > 0)) {
+            if (virCondWait(&driver->autostartCond, &driver->lock) < 0)
+                return false;
+            continue;
+        }
+
+        until = MAX(start + entry->delay * 1000ull,
+                    lastStart + cfg->autoStartDelay);
+        if (now < until) {
+            ignore_value(virCondWaitUntil(&driver->autostartCond,
+                                          &driver->lock, until));
+            continue;
+        }
+
+        if (cfg->autoStartMaxPressure > 0) {
+            bool pressure;
+
+            if (pressureSince == 0)
+                pressureSince = now;
+
+            virMutexUnlock(&driver->lock);
+            pressure = qemuAutostartHostUnderPressure(cfg->autoStartMaxPressure);
+            virMutexLock(&driver->lock);
+
+            if (pressure) {
+                if (now - pressureSince < QEMU_AUTOSTART_PRESSURE_MAX_WAIT) {
+                    ignore_value(virCondWaitUntil(&driver->autostartCond,
+                                                  &driver->lock,
+                                                  now + QEMU_AUTOSTART_PRESSURE_POLL));
+                    continue;
+                }
+
+                VIR_WARN("Starting domain %s despite host pressure",
+                         entry->vm->def->name);
+            }
+        }
+
+        return !driver->autostartQuit;
+    }
+
+    return false;
+}
+
+
+/*
+ * Starts the autostarted domains by their priority, at most
+ * auto_start_parallel of them at the same time, while keeping the
+ * delays and the limit of the host pressure set in qemu.conf.
+ */
+static void
+qemuAutostartThread(void *opaque)
+{
+    virQEMUDriverPtr driver = opaque;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuAutostartList list = { 0 };
+    virThreadPoolPtr pool = NULL;
+    unsigned long long start = 0;
+    unsigned long long lastStart = 0;
+    size_t i;
+
+    virDomainObjListForEach(driver->domains, false, qemuAutostartCollect, &list);
+
+    if (list.nentries == 0)
+        return;
+
+    qsort(list.entries, list.nentries, sizeof(*list.entries),
+          qemuAutostartEntryCompare);
+
+    if (cfg->autoStartParallel > 1 &&
+        !(pool = virThreadPoolNewFull(0, cfg->autoStartParallel, 0,
+                                      qemuAutostartWorker,
+                                      "qemu-autostart-worker", driver))) {
+        VIR_WARN("Unable to create autostart workers, starting domains "
+                 "one by one: %s", virGetLastErrorMessage());
+        virResetLastError();
+    }
+
+    if (virTimeMillisNow(&start) < 0)
+        virResetLastError();
+
+    VIR_DEBUG("Autostarting %zu domains", list.nentries);
+
+    virMutexLock(&driver->lock);
+    for (i = 0; i < list.nentries; i++) {
+        qemuAutostartEntryPtr entry = &list.entries[i];
+        bool newPriority = i > 0 &&
+            entry->priority != list.entries[i - 1].priority;
+
+        if (!qemuAutostartWait(driver, cfg, entry, newPriority,
+                               start, lastStart))
+            break;
+
+        if (virTimeMillisNow(&lastStart) < 0)
+            virResetLastError();
+        driver->autostartInflight++;
+        virMutexUnlock(&driver->lock);
+
+        if (!pool || virThreadPoolSendJob(pool, VIR_THREAD_POOL_JOB_NORMAL,
+                                          entry->vm) < 0) {
+            virResetLastError();
+            qemuAutostartWorker(entry->vm, driver);
+        }
+        entry->vm = NULL;
+
+        virMutexLock(&driver->lock);
+    }
+
+    /* the pool can't go away while its workers are starting domains */
+    while (driver->autostartInflight > 0) {
+        if (virCondWait(&driver->autostartCond, &driver->lock) < 0)
+            break;
+    }
+    virMutexUnlock(&driver->lock);
+
+    virThreadPoolFree(pool);
+
+    for (i = 0; i < list.nentries; i++)
+        virObjectUnref(list.entries[i].vm);
+    VIR_FREE(list.entries);
 }
 
 
 static void
 qemuAutostartDomains(virQEMUDriverPtr driver)
 {
-    virDomainObjListForEach(driver->domains, false, qemuAutostartDomain, driver);
+    if (virCondInit(&driver->autostartCond) < 0) {
+        VIR_ERROR(_("cannot initialize autostart condition"));
+        return;
+    }
+
+    if (virThreadCreateFull(&driver->autostartThread, true,
+                            qemuAutostartThread, "qemu-autostart",
+                            false, driver) < 0) {
+        VIR_ERROR(_("cannot create autostart thread"));
+        virCondDestroy(&driver->autostartCond);
+        return;
+    }
+
+    driver->autostartThreadActive = true;
 }
 
 
@@ -804,6 +1071,10 @@ qemuStateInitialize(bool privileged,
     if (!(qemu_driver->hostdevMgr = virHostdevManagerGetDefault()))
         goto error;
 
+    if (privileged && cfg->vfioPool &&
+        virHostdevManagerSetPCIPool(qemu_driver->hostdevMgr, cfg->vfioPool) < 0)
+        goto error;
+
     if (!(qemu_driver->sharedDevices = virHashCreate(30, qemuSharedDeviceEntryFree)))
         goto error;
 
@@ -989,6 +1260,20 @@ qemuStateInitialize(bool privileged,
                             qemuDomainManagedSaveLoad,
                             qemu_driver);
 
+    if (cfg->monitorEventThreads > 0) {
+        qemu_driver->eventThreads = g_new0(virEventThread *,
+                                           cfg->monitorEventThreads);
+        qemu_driver->eventThreadUsers = g_new0(int, cfg->monitorEventThreads);
+
+        for (i = 0; i < cfg->monitorEventThreads; i++) {
+            g_autofree char *threadName = g_strdup_printf("qemu-mon-%zu", i);
+
+            if (!(qemu_driver->eventThreads[i] = virEventThreadNew(threadName)))
+                goto error;
+            qemu_driver->neventThreads++;
+        }
+    }
+
     /* must be initialized before trying to reconnect to all the
      * running domains since there might occur some QEMU monitor
      * events that will be dispatched to the worker pool */
@@ -997,6 +1282,109 @@ qemuStateInitialize(bool privileged,
     if (!qemu_driver->workerPool)
         goto error;
 
+    if (cfg->statsWorkers > 0 &&
+        !(qemu_driver->statsPool = virThreadPoolNewFull(0, cfg->statsWorkers, 0,
+                                                        qemuDomainGetStatsWorkerHandler,
+                                                        "qemu-stats", NULL)))
+        goto error;
+
+    if (cfg->statsShm) {
+        if (cfg->statsEventInterval == 0)
+            VIR_WARN("stats_shm requires stats_event_interval to be set");
+        else if (!(qemu_driver->statsShm = virStatsShmNew("libvirt-qemu-stats")))
+            goto error;
+    }
+
+    if (cfg->statsEventInterval > 0) {
+        if (virCondInit(&qemu_driver->statsEventCond) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot initialize condition variable"));
+            goto error;
+        }
+
+        if (virThreadCreateFull(&qemu_driver->statsEventThread, true,
+                                qemuDomainStatsEventThread, "qemu-stats-event",
+                                false, qemu_driver) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot create stats event thread"));
+            virCondDestroy(&qemu_driver->statsEventCond);
+            goto error;
+        }
+        qemu_driver->statsEventThreadActive = true;
+    }
+
+    if (cfg->numaRebalanceInterval > 0 && virNumaIsAvailable()) {
+        if (virCondInit(&qemu_driver->numaRebalanceCond) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot initialize condition variable"));
+            goto error;
+        }
+
+        if (virThreadCreateFull(&qemu_driver->numaRebalanceThread, true,
+                                qemuDomainNUMARebalanceThread, "qemu-numa-balance",
+                                false, qemu_driver) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot create NUMA rebalancing thread"));
+            virCondDestroy(&qemu_driver->numaRebalanceCond);
+            goto error;
+        }
+        qemu_driver->numaRebalanceThreadActive = true;
+    }
+
+    if (cfg->resctrlControlInterval > 0 && cfg->resctrlBandwidthLimit > 0) {
+        if (virCondInit(&qemu_driver->resctrlControlCond) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot initialize condition variable"));
+            goto error;
+        }
+
+        if (virThreadCreateFull(&qemu_driver->resctrlControlThread, true,
+                                qemuDomainResctrlControlThread, "qemu-resctrl",
+                                false, qemu_driver) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot create memory bandwidth control thread"));
+            virCondDestroy(&qemu_driver->resctrlControlCond);
+            goto error;
+        }
+        qemu_driver->resctrlControlThreadActive = true;
+    }
+
+    if (cfg->balloonStatsInterval > 0) {
+        if (virCondInit(&qemu_driver->balloonStatsCond) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot initialize condition variable"));
+            goto error;
+        }
+
+        if (virThreadCreateFull(&qemu_driver->balloonStatsThread, true,
+                                qemuDomainBalloonStatsThread, "qemu-balloon",
+                                false, qemu_driver) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot create balloon stats thread"));
+            virCondDestroy(&qemu_driver->balloonStatsCond);
+            goto error;
+        }
+        qemu_driver->balloonStatsThreadActive = true;
+    }
+
+    if (cfg->memoryManagerInterval > 0) {
+        if (virCondInit(&qemu_driver->memoryManagerCond) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot initialize condition variable"));
+            goto error;
+        }
+
+        if (virThreadCreateFull(&qemu_driver->memoryManagerThread, true,
+                                qemuDomainMemoryManagerThread, "qemu-memory-mgr",
+                                false, qemu_driver) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot create memory manager thread"));
+            virCondDestroy(&qemu_driver->memoryManagerCond);
+            goto error;
+        }
+        qemu_driver->memoryManagerThreadActive = true;
+    }
+
     qemuProcessReconnectAll(qemu_driver);
 
     if (virDriverShouldAutostart(cfg->stateDir, &autostart) < 0)
@@ -1114,9 +1502,71 @@ qemuStateStop(void)
 static int
 qemuStateCleanup(void)
 {
+    size_t i;
+
     if (!qemu_driver)
         return -1;
 
+    if (qemu_driver->statsEventThreadActive) {
+        virMutexLock(&qemu_driver->lock);
+        qemu_driver->statsEventQuit = true;
+        virCondSignal(&qemu_driver->statsEventCond);
+        virMutexUnlock(&qemu_driver->lock);
+
+        virThreadJoin(&qemu_driver->statsEventThread);
+        virCondDestroy(&qemu_driver->statsEventCond);
+    }
+
+    if (qemu_driver->numaRebalanceThreadActive) {
+        virMutexLock(&qemu_driver->lock);
+        qemu_driver->numaRebalanceQuit = true;
+        virCondSignal(&qemu_driver->numaRebalanceCond);
+        virMutexUnlock(&qemu_driver->lock);
+
+        virThreadJoin(&qemu_driver->numaRebalanceThread);
+        virCondDestroy(&qemu_driver->numaRebalanceCond);
+    }
+
+    if (qemu_driver->resctrlControlThreadActive) {
+        virMutexLock(&qemu_driver->lock);
+        qemu_driver->resctrlControlQuit = true;
+        virCondSignal(&qemu_driver->resctrlControlCond);
+        virMutexUnlock(&qemu_driver->lock);
+
+        virThreadJoin(&qemu_driver->resctrlControlThread);
+        virCondDestroy(&qemu_driver->resctrlControlCond);
+    }
+
+    if (qemu_driver->balloonStatsThreadActive) {
+        virMutexLock(&qemu_driver->lock);
+        qemu_driver->balloonStatsQuit = true;
+        virCondSignal(&qemu_driver->balloonStatsCond);
+        virMutexUnlock(&qemu_driver->lock);
+
+        virThreadJoin(&qemu_driver->balloonStatsThread);
+        virCondDestroy(&qemu_driver->balloonStatsCond);
+    }
+
+    if (qemu_driver->autostartThreadActive) {
+        virMutexLock(&qemu_driver->lock);
+        qemu_driver->autostartQuit = true;
+        virCondBroadcast(&qemu_driver->autostartCond);
+        virMutexUnlock(&qemu_driver->lock);
+
+        virThreadJoin(&qemu_driver->autostartThread);
+        virCondDestroy(&qemu_driver->autostartCond);
+    }
+
+    if (qemu_driver->memoryManagerThreadActive) {
+        virMutexLock(&qemu_driver->lock);
+        qemu_driver->memoryManagerQuit = true;
+        virCondSignal(&qemu_driver->memoryManagerCond);
+        virMutexUnlock(&qemu_driver->lock);
+
+        virThreadJoin(&qemu_driver->memoryManagerThread);
+        virCondDestroy(&qemu_driver->memoryManagerCond);
+    }
+
     virObjectUnref(qemu_driver->migrationErrors);
     virObjectUnref(qemu_driver->closeCallbacks);
     virLockManagerPluginUnref(qemu_driver->lockManager);
@@ -1136,7 +1586,16 @@ qemuStateCleanup(void)
     ebtablesContextFree(qemu_driver->ebtables);
     VIR_FREE(qemu_driver->qemuImgBinary);
     virObjectUnref(qemu_driver->domains);
+    virThreadPoolFree(qemu_driver->reconnectPool);
     virThreadPoolFree(qemu_driver->workerPool);
+    virThreadPoolFree(qemu_driver->statsPool);
+    virStatsShmFree(qemu_driver->statsShm);
+
+    for (i = 0; i < qemu_driver->neventThreads; i++)
+        g_object_unref(qemu_driver->eventThreads[i]);
+    VIR_FREE(qemu_driver->eventThreads);
+    VIR_FREE(qemu_driver->eventThreadUsers);
+    VIR_FREE(qemu_driver->numaLoad);
 
     if (qemu_driver->lockFD != -1)
         virPidFileRelease(qemu_driver->config->stateDir, "driver", qemu_driver->lockFD);
@@ -1245,6 +1704,10 @@ qemuConnectSupportsFeature(virConnectPtr conn, int feature)
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_STATS_COMPACT:
+    case VIR_DRV_FEATURE_REMOTE_PIPELINE:
+    case VIR_DRV_FEATURE_REMOTE_CALL_BATCH:
+    case VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PACKETS:
     default:
         return 0;
     }
@@ -2795,6 +3258,7 @@ typedef enum {
      */
     QEMU_SAVE_FORMAT_XZ = 3,
     QEMU_SAVE_FORMAT_LZOP = 4,
+    QEMU_SAVE_FORMAT_ZSTD = 5,
     /* Note: add new members only at the end.
        These values are used in the on-disk format.
        Do not change or re-use numbers. */
@@ -2810,6 +3274,7 @@ VIR_ENUM_IMPL(qemuSaveCompression,
               "bzip2",
               "xz",
               "lzop",
+              "zstd",
 );
 
 VIR_ENUM_DECL(qemuDumpFormat);
@@ -3022,6 +3487,8 @@ qemuCompressGetCommand(virQEMUSaveFormat compression)
 
     if (compression == QEMU_SAVE_FORMAT_LZOP)
         virCommandAddArg(ret, "--ignore-warn");
+    if (compression == QEMU_SAVE_FORMAT_ZSTD)
+        virCommandAddArg(ret, "-q");
 
     return ret;
 }
@@ -3471,6 +3938,9 @@ qemuGetCompressionProgram(const char *imageFormat,
     virCommandAddArg(*compressor, "-c");
     if (ret == QEMU_SAVE_FORMAT_XZ)
         virCommandAddArg(*compressor, "-3");
+    /* Unlike the other compressors, zstd can use all host CPUs */
+    if (ret == QEMU_SAVE_FORMAT_ZSTD)
+        virCommandAddArgList(*compressor, "-q", "-T0", NULL);
 
     return ret;
 
@@ -3692,54 +4162,408 @@ qemuDomainManagedSaveRemove(virDomainPtr dom, unsigned int flags)
 }
 
 
-/**
- * qemuDumpWaitForCompletion:
- * @vm: domain object
- *
- * If the query dump capability exists, then it's possible to start a
- * guest memory dump operation using a thread via a 'detach' qualifier
- * to the dump guest memory command. This allows the async check if the
- * dump is done.
- *
- * Returns 0 on success, -1 on failure
- */
-static int
-qemuDumpWaitForCompletion(virDomainObjPtr vm)
+#define QEMU_LIST_SHUTDOWN_PARALLEL_SAVES 4
+
+typedef struct _qemuDomainListShutdownData qemuDomainListShutdownData;
+typedef qemuDomainListShutdownData *qemuDomainListShutdownDataPtr;
+struct _qemuDomainListShutdownData {
+    int refs;
+    virMutex lock;
+    virCond cond;
+    GHashTable *pending; /* UUIDs of domains we wait for to stop */
+    size_t nfailed;
+    virErrorPtr err;
+
+    /* used by managed save workers */
+    virIdentityPtr identity;
+    virDomainPtr *doms;
+    size_t ndoms;
+    size_t next;
+    unsigned int saveFlags;
+};
+
+
+static qemuDomainListShutdownDataPtr
+qemuDomainListShutdownDataNew(void)
 {
-    qemuDomainObjPrivatePtr priv = vm->privateData;
-    qemuDomainJobPrivatePtr jobPriv = priv->job.privateData;
+    qemuDomainListShutdownDataPtr data = g_new0(qemuDomainListShutdownData, 1);
 
-    VIR_DEBUG("Waiting for dump completion");
-    while (!jobPriv->dumpCompleted && !priv->job.abortJob) {
-        if (virDomainObjWait(vm) < 0)
-            return -1;
+    if (virMutexInit(&data->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        g_free(data);
+        return NULL;
     }
 
-    if (priv->job.current->stats.dump.status == QEMU_MONITOR_DUMP_STATUS_FAILED) {
-        if (priv->job.error)
-            virReportError(VIR_ERR_OPERATION_FAILED,
-                           _("memory-only dump failed: %s"),
-                           priv->job.error);
-        else
-            virReportError(VIR_ERR_OPERATION_FAILED, "%s",
-                           _("memory-only dump failed for unknown reason"));
-
-        return -1;
+    if (virCondInit(&data->cond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot initialize condition"));
+        virMutexDestroy(&data->lock);
+        g_free(data);
+        return NULL;
     }
-    qemuDomainJobInfoUpdateTime(priv->job.current);
 
-    return 0;
+    data->refs = 1;
+    data->pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    return data;
 }
 
 
-static int
-qemuDumpToFd(virQEMUDriverPtr driver,
-             virDomainObjPtr vm,
-             int fd,
-             qemuDomainAsyncJob asyncJob,
-             const char *dumpformat)
+/* The lifecycle callback holds a reference of its own, because the event
+ * state may release it only after virDomainListShutdown returned */
+static void
+qemuDomainListShutdownDataUnref(void *opaque)
 {
-    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainListShutdownDataPtr data = opaque;
+
+    if (!data || !g_atomic_int_dec_and_test(&data->refs))
+        return;
+
+    g_hash_table_unref(data->pending);
+    virFreeError(data->err);
+    g_clear_object(&data->identity);
+    virCondDestroy(&data->cond);
+    virMutexDestroy(&data->lock);
+    g_free(data);
+}
+
+
+static void
+qemuDomainListShutdownFailed(qemuDomainListShutdownDataPtr data,
+                             virDomainPtr dom)
+{
+    VIR_WARN("Shutdown of domain %s failed: %s",
+             dom->name, virGetLastErrorMessage());
+
+    virMutexLock(&data->lock);
+    data->nfailed++;
+    if (!data->err)
+        virErrorPreserveLast(&data->err);
+    virMutexUnlock(&data->lock);
+}
+
+
+/* Unlike qemuDomainObjFromDomain, this doesn't report an error if a
+ * transient domain has already gone away */
+static bool
+qemuDomainListShutdownIsActive(virQEMUDriverPtr driver,
+                               virDomainPtr dom)
+{
+    virDomainObjPtr vm;
+    bool ret;
+
+    if (!(vm = virDomainObjListFindByUUID(driver->domains, dom->uuid)))
+        return false;
+
+    ret = virDomainObjIsActive(vm);
+    virDomainObjEndAPI(&vm);
+    return ret;
+}
+
+
+static int
+qemuDomainListShutdownLifecycle(virConnectPtr conn G_GNUC_UNUSED,
+                                virDomainPtr dom,
+                                int event,
+                                int detail G_GNUC_UNUSED,
+                                void *opaque)
+{
+    qemuDomainListShutdownDataPtr data = opaque;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (event != VIR_DOMAIN_EVENT_STOPPED)
+        return 0;
+
+    virUUIDFormat(dom->uuid, uuidstr);
+
+    virMutexLock(&data->lock);
+    if (g_hash_table_remove(data->pending, uuidstr))
+        virCondBroadcast(&data->cond);
+    virMutexUnlock(&data->lock);
+
+    return 0;
+}
+
+
+/* Asks all domains to shut down at once and waits for their lifecycle
+ * events, destroying the domains which are still running on timeout if
+ * @destroy is true */
+static int
+qemuDomainListShutdownSignal(virConnectPtr conn,
+                             qemuDomainListShutdownDataPtr data,
+                             virDomainPtr *doms,
+                             unsigned int ndoms,
+                             unsigned int timeout,
+                             bool destroy)
+{
+    virQEMUDriverPtr driver = conn->privateData;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    unsigned long long deadline = 0;
+    int callbackID = -1;
+    size_t i;
+
+    if (timeout > 0) {
+        if (virTimeMillisNow(&deadline) < 0)
+            return -1;
+        deadline += timeout * 1000ull;
+    }
+
+    g_atomic_int_inc(&data->refs);
+    if (virDomainEventStateRegisterID(conn, driver->domainEventState, NULL,
+                                      VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+                                      VIR_DOMAIN_EVENT_CALLBACK(qemuDomainListShutdownLifecycle),
+                                      data, qemuDomainListShutdownDataUnref,
+                                      &callbackID) < 0) {
+        qemuDomainListShutdownDataUnref(data);
+        return -1;
+    }
+
+    for (i = 0; i < ndoms; i++) {
+        virUUIDFormat(doms[i]->uuid, uuidstr);
+
+        /* the domain may stop as soon as it's been asked to, so it has to
+         * be pending already */
+        virMutexLock(&data->lock);
+        g_hash_table_add(data->pending, g_strdup(uuidstr));
+        virMutexUnlock(&data->lock);
+
+        if (!qemuDomainListShutdownIsActive(driver, doms[i]) ||
+            qemuDomainShutdownFlags(doms[i], 0) < 0) {
+            if (qemuDomainListShutdownIsActive(driver, doms[i]))
+                qemuDomainListShutdownFailed(data, doms[i]);
+
+            virMutexLock(&data->lock);
+            g_hash_table_remove(data->pending, uuidstr);
+            virMutexUnlock(&data->lock);
+        }
+    }
+
+    VIR_DEBUG("Waiting for %u domains to shut down", ndoms);
+
+    virMutexLock(&data->lock);
+    while (g_hash_table_size(data->pending) > 0) {
+        int rc;
+
+        if (deadline > 0)
+            rc = virCondWaitUntil(&data->cond, &data->lock, deadline);
+        else
+            rc = virCondWait(&data->cond, &data->lock);
+
+        if (rc < 0)
+            break;
+    }
+    virMutexUnlock(&data->lock);
+
+    virObjectEventStateDeregisterID(conn, driver->domainEventState,
+                                    callbackID, true);
+
+    for (i = 0; i < ndoms; i++) {
+        bool pending;
+
+        virUUIDFormat(doms[i]->uuid, uuidstr);
+
+        virMutexLock(&data->lock);
+        pending = g_hash_table_contains(data->pending, uuidstr);
+        virMutexUnlock(&data->lock);
+
+        /* events of domains which stopped just now may still be queued */
+        if (!pending || !qemuDomainListShutdownIsActive(driver, doms[i]))
+            continue;
+
+        if (destroy) {
+            VIR_WARN("Domain %s did not shut down in time, destroying it",
+                     doms[i]->name);
+            if (qemuDomainDestroyFlags(doms[i], 0) < 0)
+                qemuDomainListShutdownFailed(data, doms[i]);
+        } else {
+            virReportError(VIR_ERR_OPERATION_TIMEOUT,
+                           _("domain '%s' did not shut down in time"),
+                           doms[i]->name);
+            qemuDomainListShutdownFailed(data, doms[i]);
+        }
+    }
+
+    return 0;
+}
+
+
+static void
+qemuDomainListShutdownSaveWorker(void *opaque)
+{
+    qemuDomainListShutdownDataPtr data = opaque;
+    virQEMUDriverPtr driver;
+
+    /* access control checks of the individual saves need to see the
+     * identity of the client which called virDomainListShutdown */
+    if (virIdentitySetCurrent(data->identity) < 0)
+        return;
+
+    while (true) {
+        virDomainPtr dom;
+
+        virMutexLock(&data->lock);
+        if (data->next == data->ndoms) {
+            virMutexUnlock(&data->lock);
+            break;
+        }
+        dom = data->doms[data->next++];
+        virMutexUnlock(&data->lock);
+
+        driver = dom->conn->privateData;
+        if (!qemuDomainListShutdownIsActive(driver, dom))
+            continue;
+
+        VIR_DEBUG("Saving domain %s", dom->name);
+
+        if (qemuDomainManagedSave(dom, data->saveFlags) < 0 &&
+            qemuDomainListShutdownIsActive(driver, dom))
+            qemuDomainListShutdownFailed(data, dom);
+    }
+
+    ignore_value(virIdentitySetCurrent(NULL));
+}
+
+
+/* Saves the domains by a few threads, as each save is mostly waiting for
+ * the disk */
+static int
+qemuDomainListShutdownSave(qemuDomainListShutdownDataPtr data,
+                           virDomainPtr *doms,
+                           unsigned int ndoms,
+                           bool bypassCache)
+{
+    g_autofree virThreadPtr threads = NULL;
+    size_t nthreads = MIN(QEMU_LIST_SHUTDOWN_PARALLEL_SAVES, ndoms);
+    size_t i;
+
+    data->identity = virIdentityGetCurrent();
+    data->doms = doms;
+    data->ndoms = ndoms;
+    if (bypassCache)
+        data->saveFlags |= VIR_DOMAIN_SAVE_BYPASS_CACHE;
+
+    VIR_DEBUG("Saving %u domains using %zu threads", ndoms, nthreads);
+
+    threads = g_new0(virThread, nthreads);
+    for (i = 0; i < nthreads; i++) {
+        if (virThreadCreateFull(&threads[i], true,
+                                qemuDomainListShutdownSaveWorker,
+                                "qemu-save-list", false, data) < 0) {
+            if (i == 0) {
+                virReportSystemError(errno, "%s",
+                                     _("Unable to create save thread"));
+                return -1;
+            }
+
+            /* let the threads we already have drain the list */
+            VIR_WARN("Unable to create save thread, using only %zu", i);
+            nthreads = i;
+            break;
+        }
+    }
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    return 0;
+}
+
+
+static int
+qemuDomainListShutdown(virConnectPtr conn,
+                       virDomainPtr *doms,
+                       unsigned int ndoms,
+                       unsigned int timeout,
+                       unsigned int flags)
+{
+    qemuDomainListShutdownDataPtr data = NULL;
+    int rc;
+    int ret = -1;
+
+    virCheckFlags(VIR_DOMAIN_LIST_SHUTDOWN_MANAGED_SAVE |
+                  VIR_DOMAIN_LIST_SHUTDOWN_BYPASS_CACHE |
+                  VIR_DOMAIN_LIST_SHUTDOWN_DESTROY, -1);
+
+    if (virDomainListShutdownEnsureACL(conn) < 0)
+        return -1;
+
+    if (!(data = qemuDomainListShutdownDataNew()))
+        return -1;
+
+    if (flags & VIR_DOMAIN_LIST_SHUTDOWN_MANAGED_SAVE) {
+        rc = qemuDomainListShutdownSave(data, doms, ndoms,
+                                        flags & VIR_DOMAIN_LIST_SHUTDOWN_BYPASS_CACHE);
+    } else {
+        rc = qemuDomainListShutdownSignal(conn, data, doms, ndoms, timeout,
+                                          flags & VIR_DOMAIN_LIST_SHUTDOWN_DESTROY);
+    }
+
+    if (rc < 0)
+        goto cleanup;
+
+    if (data->nfailed > 0) {
+        VIR_WARN("Shutdown of %zu out of %u domains failed",
+                 data->nfailed, ndoms);
+        virErrorRestore(&data->err);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    qemuDomainListShutdownDataUnref(data);
+    return ret;
+}
+
+
+/**
+ * qemuDumpWaitForCompletion:
+ * @vm: domain object
+ *
+ * If the query dump capability exists, then it's possible to start a
+ * guest memory dump operation using a thread via a 'detach' qualifier
+ * to the dump guest memory command. This allows the async check if the
+ * dump is done.
+ *
+ * Returns 0 on success, -1 on failure
+ */
+static int
+qemuDumpWaitForCompletion(virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainJobPrivatePtr jobPriv = priv->job.privateData;
+
+    VIR_DEBUG("Waiting for dump completion");
+    while (!jobPriv->dumpCompleted && !priv->job.abortJob) {
+        if (virDomainObjWait(vm) < 0)
+            return -1;
+    }
+
+    if (priv->job.current->stats.dump.status == QEMU_MONITOR_DUMP_STATUS_FAILED) {
+        if (priv->job.error)
+            virReportError(VIR_ERR_OPERATION_FAILED,
+                           _("memory-only dump failed: %s"),
+                           priv->job.error);
+        else
+            virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                           _("memory-only dump failed for unknown reason"));
+
+        return -1;
+    }
+    qemuDomainJobInfoUpdateTime(priv->job.current);
+
+    return 0;
+}
+
+
+static int
+qemuDumpToFd(virQEMUDriverPtr driver,
+             virDomainObjPtr vm,
+             int fd,
+             qemuDomainAsyncJob asyncJob,
+             const char *dumpformat)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
     bool detach = false;
     int ret = -1;
 
@@ -4896,6 +5720,35 @@ processGuestCrashloadedEvent(virQEMUDriverPtr driver,
 }
 
 
+static void
+processReconnectRefreshEvent(virQEMUDriverPtr driver,
+                             virDomainObjPtr vm)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+
+    if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_MODIFY) < 0)
+        return;
+
+    if (!virDomainObjIsActive(vm)) {
+        VIR_DEBUG("Domain is not running");
+        goto endjob;
+    }
+
+    if (qemuProcessReconnectRefresh(driver, vm) < 0) {
+        VIR_WARN("Unable to refresh state of domain '%s' after reconnect",
+                 vm->def->name);
+        goto endjob;
+    }
+
+    if (virDomainObjSave(vm, driver->xmlopt, cfg->stateDir) < 0)
+        VIR_WARN("Unable to save status on vm %s after state change",
+                 vm->def->name);
+
+ endjob:
+    qemuDomainObjEndJob(driver, vm);
+}
+
+
 static void qemuProcessEventHandler(void *data, void *opaque)
 {
     struct qemuProcessEvent *processEvent = data;
@@ -4906,6 +5759,9 @@ static void qemuProcessEventHandler(void *data, void *opaque)
 
     virObjectLock(vm);
 
+    PROBE_QUIET(QEMU_EVENT_DISPATCH_BEGIN, "vm=%s event=%d",
+                vm->def->name, processEvent->eventType);
+
     switch (processEvent->eventType) {
     case QEMU_PROCESS_EVENT_WATCHDOG:
         processWatchdogEvent(driver, vm, processEvent->action);
@@ -4945,10 +5801,16 @@ static void qemuProcessEventHandler(void *data, void *opaque)
     case QEMU_PROCESS_EVENT_GUEST_CRASHLOADED:
         processGuestCrashloadedEvent(driver, vm);
         break;
+    case QEMU_PROCESS_EVENT_RECONNECT_REFRESH:
+        processReconnectRefreshEvent(driver, vm);
+        break;
     case QEMU_PROCESS_EVENT_LAST:
         break;
     }
 
+    PROBE_QUIET(QEMU_EVENT_DISPATCH_END, "vm=%s event=%d",
+                vm->def->name, processEvent->eventType);
+
     virDomainObjEndAPI(&vm);
     qemuProcessEventFree(processEvent);
 }
@@ -7368,6 +8230,34 @@ static char
 }
 
 
+static int
+qemuDomainGetXMLDigest(virDomainPtr dom,
+                       unsigned long long *generation,
+                       char **digest,
+                       unsigned int flags)
+{
+    virQEMUDriverPtr driver = dom->conn->privateData;
+    virDomainObjPtr vm;
+    int ret = -1;
+
+    virCheckFlags(VIR_DOMAIN_XML_INACTIVE, -1);
+
+    if (!(vm = qemuDomainObjFromDomain(dom)))
+        goto cleanup;
+
+    if (virDomainGetXMLDigestEnsureACL(dom->conn, vm->def) < 0)
+        goto cleanup;
+
+    ret = virDomainObjGetDigest(vm, driver->xmlopt,
+                                !!(flags & VIR_DOMAIN_XML_INACTIVE),
+                                generation, digest);
+
+ cleanup:
+    virDomainObjEndAPI(&vm);
+    return ret;
+}
+
+
 static char *qemuConnectDomainXMLToNative(virConnectPtr conn,
                                           const char *format,
                                           const char *xmlData,
@@ -8663,18 +9553,31 @@ qemuDomainAttachDeviceLiveAndConfigHomogenize(const virDomainDeviceDef *devConf,
 }
 
 
+/**
+ * qemuDomainAttachDeviceLiveAndConfig:
+ * @vm: domain object
+ * @driver: qemu driver
+ * @xmls: NULL terminated list of device XMLs
+ * @flags: bitwise-OR of virDomainDeviceModifyFlags
+ *
+ * Attaches the devices in @xmls in their order. The namespace of a running
+ * @vm is prepared for all of the devices at once, and the status and
+ * config are saved once for all of them.
+ */
 static int
 qemuDomainAttachDeviceLiveAndConfig(virDomainObjPtr vm,
                                     virQEMUDriverPtr driver,
-                                    const char *xml,
+                                    const char **xmls,
                                     unsigned int flags)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
     virDomainDefPtr vmdef = NULL;
     g_autoptr(virQEMUDriverConfig) cfg = NULL;
-    virDomainDeviceDefPtr devConf = NULL;
-    virDomainDeviceDef devConfSave = { 0 };
-    virDomainDeviceDefPtr devLive = NULL;
+    size_t ndevs = virStringListLength(xmls);
+    g_autofree virDomainDeviceDef *devConfSave = NULL;
+    virDomainDeviceDefPtr *devLive = NULL;
+    size_t nattached = 0;
+    size_t i;
     int ret = -1;
     unsigned int parse_flags = VIR_DOMAIN_DEF_PARSE_INACTIVE |
                                VIR_DOMAIN_DEF_PARSE_ABI_UPDATE;
@@ -8684,6 +9587,9 @@ qemuDomainAttachDeviceLiveAndConfig(virDomainObjPtr vm,
 
     cfg = virQEMUDriverGetConfig(driver);
 
+    devConfSave = g_new0(virDomainDeviceDef, ndevs);
+    devLive = g_new0(virDomainDeviceDefPtr, ndevs);
+
     /* The config and live post processing address auto-generation algorithms
      * rely on the correct vm->def or vm->newDef being passed, so call the
      * device parse based on which definition is in use */
@@ -8693,59 +9599,91 @@ qemuDomainAttachDeviceLiveAndConfig(virDomainObjPtr vm,
         if (!vmdef)
             goto cleanup;
 
-        if (!(devConf = virDomainDeviceDefParse(xml, vmdef,
-                                                driver->xmlopt, priv->qemuCaps,
-                                                parse_flags)))
-            goto cleanup;
+        for (i = 0; i < ndevs; i++) {
+            g_autoptr(virDomainDeviceDef) devConf = NULL;
 
-        /*
-         * devConf will be NULLed out by
-         * qemuDomainAttachDeviceConfig(), so save it for later use by
-         * qemuDomainAttachDeviceLiveAndConfigHomogenize()
-         */
-        devConfSave = *devConf;
+            if (!(devConf = virDomainDeviceDefParse(xmls[i], vmdef,
+                                                    driver->xmlopt, priv->qemuCaps,
+                                                    parse_flags)))
+                goto cleanup;
 
-        if (virDomainDeviceValidateAliasForHotplug(vm, devConf,
-                                                   VIR_DOMAIN_AFFECT_CONFIG) < 0)
-            goto cleanup;
+            /*
+             * devConf will be NULLed out by
+             * qemuDomainAttachDeviceConfig(), so save it for later use by
+             * qemuDomainAttachDeviceLiveAndConfigHomogenize()
+             */
+            devConfSave[i] = *devConf;
 
-        if (virDomainDefCompatibleDevice(vmdef, devConf, NULL,
-                                         VIR_DOMAIN_DEVICE_ACTION_ATTACH,
-                                         false) < 0)
-            goto cleanup;
+            if (virDomainDeviceValidateAliasForHotplug(vm, devConf,
+                                                       VIR_DOMAIN_AFFECT_CONFIG) < 0)
+                goto cleanup;
 
-        if (qemuDomainAttachDeviceConfig(vmdef, devConf, priv->qemuCaps,
-                                         parse_flags,
-                                         driver->xmlopt) < 0)
-            goto cleanup;
-    }
+            if (virDomainDefCompatibleDevice(vmdef, devConf, NULL,
+                                             VIR_DOMAIN_DEVICE_ACTION_ATTACH,
+                                             false) < 0)
+                goto cleanup;
+
+            if (qemuDomainAttachDeviceConfig(vmdef, devConf, priv->qemuCaps,
+                                             parse_flags,
+                                             driver->xmlopt) < 0)
+                goto cleanup;
+        }
+    }
 
     if (flags & VIR_DOMAIN_AFFECT_LIVE) {
-        if (!(devLive = virDomainDeviceDefParse(xml, vm->def,
-                                                driver->xmlopt, priv->qemuCaps,
-                                                parse_flags)))
-            goto cleanup;
+        int rc = 0;
 
-        if (flags & VIR_DOMAIN_AFFECT_CONFIG)
-            qemuDomainAttachDeviceLiveAndConfigHomogenize(&devConfSave, devLive);
+        for (i = 0; i < ndevs; i++) {
+            if (!(devLive[i] = virDomainDeviceDefParse(xmls[i], vm->def,
+                                                       driver->xmlopt, priv->qemuCaps,
+                                                       parse_flags)))
+                goto cleanup;
 
-        if (virDomainDeviceValidateAliasForHotplug(vm, devLive,
-                                                   VIR_DOMAIN_AFFECT_LIVE) < 0)
-            goto cleanup;
+            if (flags & VIR_DOMAIN_AFFECT_CONFIG)
+                qemuDomainAttachDeviceLiveAndConfigHomogenize(&devConfSave[i],
+                                                              devLive[i]);
+        }
 
-        if (virDomainDefCompatibleDevice(vm->def, devLive, NULL,
-                                         VIR_DOMAIN_DEVICE_ACTION_ATTACH,
-                                         true) < 0)
-            goto cleanup;
+        /* Create the device nodes of all devices in the namespace at once
+         * rather than forking into it for every device */
+        if (ndevs > 1) {
+            qemuDomainNamespaceBatchBegin(vm);
+
+            for (i = 0; i < ndevs; i++) {
+                if (qemuDomainNamespaceSetupDevice(vm, devLive[i]) < 0)
+                    break;
+            }
+
+            if (i < ndevs || qemuDomainNamespaceBatchCommit(vm) < 0) {
+                qemuDomainNamespaceBatchEnd(vm);
+                goto cleanup;
+            }
+        }
+
+        for (i = 0; i < ndevs; i++) {
+            if ((rc = virDomainDeviceValidateAliasForHotplug(vm, devLive[i],
+                                                             VIR_DOMAIN_AFFECT_LIVE)) < 0 ||
+                (rc = virDomainDefCompatibleDevice(vm->def, devLive[i], NULL,
+                                                   VIR_DOMAIN_DEVICE_ACTION_ATTACH,
+                                                   true)) < 0 ||
+                (rc = qemuDomainAttachDeviceLive(vm, devLive[i], driver)) < 0)
+                break;
+
+            nattached++;
+        }
+
+        qemuDomainNamespaceBatchEnd(vm);
 
-        if (qemuDomainAttachDeviceLive(vm, devLive, driver) < 0)
-            goto cleanup;
         /*
          * update domain status forcibly because the domain status may be
          * changed even if we failed to attach the device. For example,
          * a new controller may be created.
          */
-        if (virDomainObjSave(vm, driver->xmlopt, cfg->stateDir) < 0)
+        if ((rc == 0 || nattached > 0) &&
+            virDomainObjSave(vm, driver->xmlopt, cfg->stateDir) < 0)
+            goto cleanup;
+
+        if (rc < 0)
             goto cleanup;
     }
 
@@ -8761,8 +9699,9 @@ qemuDomainAttachDeviceLiveAndConfig(virDomainObjPtr vm,
     ret = 0;
  cleanup:
     virDomainDefFree(vmdef);
-    virDomainDeviceDefFree(devConf);
-    virDomainDeviceDefFree(devLive);
+    for (i = 0; i < ndevs; i++)
+        virDomainDeviceDefFree(devLive[i]);
+    g_free(devLive);
 
     return ret;
 }
@@ -8774,6 +9713,7 @@ qemuDomainAttachDeviceFlags(virDomainPtr dom,
 {
     virQEMUDriverPtr driver = dom->conn->privateData;
     virDomainObjPtr vm = NULL;
+    const char *xmls[] = { xml, NULL };
     int ret = -1;
 
     virNWFilterReadLockFilterUpdates();
@@ -8790,7 +9730,50 @@ qemuDomainAttachDeviceFlags(virDomainPtr dom,
     if (virDomainObjUpdateModificationImpact(vm, &flags) < 0)
         goto endjob;
 
-    if (qemuDomainAttachDeviceLiveAndConfig(vm, driver, xml, flags) < 0)
+    if (qemuDomainAttachDeviceLiveAndConfig(vm, driver, xmls, flags) < 0)
+        goto endjob;
+
+    ret = 0;
+
+ endjob:
+    qemuDomainObjEndJob(driver, vm);
+
+ cleanup:
+    virDomainObjEndAPI(&vm);
+    virNWFilterUnlockFilterUpdates();
+    return ret;
+}
+
+
+static int
+qemuDomainAttachDevices(virDomainPtr dom,
+                        const char *xml,
+                        unsigned int flags)
+{
+    virQEMUDriverPtr driver = dom->conn->privateData;
+    virDomainObjPtr vm = NULL;
+    VIR_AUTOSTRINGLIST xmls = NULL;
+    int ret = -1;
+
+    if (!(xmls = virDomainDeviceXMLSplit(xml)))
+        return -1;
+
+    virNWFilterReadLockFilterUpdates();
+
+    if (!(vm = qemuDomainObjFromDomain(dom)))
+        goto cleanup;
+
+    if (virDomainAttachDevicesEnsureACL(dom->conn, vm->def, flags) < 0)
+        goto cleanup;
+
+    if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_MODIFY) < 0)
+        goto cleanup;
+
+    if (virDomainObjUpdateModificationImpact(vm, &flags) < 0)
+        goto endjob;
+
+    if (qemuDomainAttachDeviceLiveAndConfig(vm, driver, (const char **) xmls,
+                                            flags) < 0)
         goto endjob;
 
     ret = 0;
@@ -8922,17 +9905,31 @@ static int qemuDomainUpdateDeviceFlags(virDomainPtr dom,
     return ret;
 }
 
+/**
+ * qemuDomainDetachDeviceLiveAndConfig:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @xmls: NULL terminated list of device XMLs
+ * @flags: bitwise-OR of virDomainDeviceModifyFlags
+ *
+ * Detaches the devices in @xmls. Live devices are unplugged together by
+ * qemuDomainDetachDevicesLive. The device list, status and config are
+ * updated and saved once for all of them.
+ */
 static int
 qemuDomainDetachDeviceLiveAndConfig(virQEMUDriverPtr driver,
                                     virDomainObjPtr vm,
-                                    const char *xml,
+                                    const char **xmls,
                                     unsigned int flags)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
     g_autoptr(virQEMUDriverConfig) cfg = NULL;
-    virDomainDeviceDefPtr dev = NULL, dev_copy = NULL;
+    size_t ndevs = virStringListLength(xmls);
+    virDomainDeviceDefPtr *devs = NULL;
+    virDomainDeviceDefPtr *devs_copy = NULL;
     unsigned int parse_flags = VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE;
     virDomainDefPtr vmdef = NULL;
+    size_t i;
     int ret = -1;
 
     virCheckFlags(VIR_DOMAIN_AFFECT_LIVE |
@@ -8944,22 +9941,28 @@ qemuDomainDetachDeviceLiveAndConfig(virQEMUDriverPtr driver,
         !(flags & VIR_DOMAIN_AFFECT_LIVE))
         parse_flags |= VIR_DOMAIN_DEF_PARSE_INACTIVE;
 
-    dev = dev_copy = virDomainDeviceDefParse(xml, vm->def,
-                                             driver->xmlopt, priv->qemuCaps,
-                                             parse_flags);
-    if (dev == NULL)
-        goto cleanup;
+    devs = g_new0(virDomainDeviceDefPtr, ndevs);
+    devs_copy = g_new0(virDomainDeviceDefPtr, ndevs);
 
-    if (flags & VIR_DOMAIN_AFFECT_CONFIG &&
-        flags & VIR_DOMAIN_AFFECT_LIVE) {
-        /* If we are affecting both CONFIG and LIVE
-         * create a deep copy of device as adding
-         * to CONFIG takes one instance.
-         */
-        dev_copy = virDomainDeviceDefCopy(dev, vm->def,
-                                          driver->xmlopt, priv->qemuCaps);
-        if (!dev_copy)
+    for (i = 0; i < ndevs; i++) {
+        devs[i] = devs_copy[i] = virDomainDeviceDefParse(xmls[i], vm->def,
+                                                         driver->xmlopt,
+                                                         priv->qemuCaps,
+                                                         parse_flags);
+        if (devs[i] == NULL)
             goto cleanup;
+
+        if (flags & VIR_DOMAIN_AFFECT_CONFIG &&
+            flags & VIR_DOMAIN_AFFECT_LIVE) {
+            /* If we are affecting both CONFIG and LIVE
+             * create a deep copy of device as adding
+             * to CONFIG takes one instance.
+             */
+            devs_copy[i] = virDomainDeviceDefCopy(devs[i], vm->def,
+                                                  driver->xmlopt, priv->qemuCaps);
+            if (!devs_copy[i])
+                goto cleanup;
+        }
     }
 
     if (flags & VIR_DOMAIN_AFFECT_CONFIG) {
@@ -8968,19 +9971,28 @@ qemuDomainDetachDeviceLiveAndConfig(virQEMUDriverPtr driver,
         if (!vmdef)
             goto cleanup;
 
-        if (qemuDomainDetachDeviceConfig(vmdef, dev, priv->qemuCaps,
-                                         parse_flags,
-                                         driver->xmlopt) < 0)
-            goto cleanup;
+        for (i = 0; i < ndevs; i++) {
+            if (qemuDomainDetachDeviceConfig(vmdef, devs[i], priv->qemuCaps,
+                                             parse_flags,
+                                             driver->xmlopt) < 0)
+                goto cleanup;
+        }
     }
 
     if (flags & VIR_DOMAIN_AFFECT_LIVE) {
+        size_t ndetached = 0;
         int rc;
 
-        if ((rc = qemuDomainDetachDeviceLive(vm, dev_copy, driver, false)) < 0)
-            goto cleanup;
+        if (ndevs == 1) {
+            if ((rc = qemuDomainDetachDeviceLive(vm, devs_copy[0], driver, false)) == 0)
+                ndetached = 1;
+        } else {
+            rc = qemuDomainDetachDevicesLive(vm, devs_copy, ndevs, driver,
+                                             &ndetached);
+        }
 
-        if (rc == 0 && qemuDomainUpdateDeviceList(driver, vm, QEMU_ASYNC_JOB_NONE) < 0)
+        if (ndetached > 0 &&
+            qemuDomainUpdateDeviceList(driver, vm, QEMU_ASYNC_JOB_NONE) < 0)
             goto cleanup;
 
         /*
@@ -8988,7 +10000,11 @@ qemuDomainDetachDeviceLiveAndConfig(virQEMUDriverPtr driver,
          * changed even if we failed to attach the device. For example,
          * a new controller may be created.
          */
-        if (virDomainObjSave(vm, driver->xmlopt, cfg->stateDir) < 0)
+        if ((rc >= 0 || ndetached > 0) &&
+            virDomainObjSave(vm, driver->xmlopt, cfg->stateDir) < 0)
+            goto cleanup;
+
+        if (rc < 0)
             goto cleanup;
     }
 
@@ -9004,9 +10020,13 @@ qemuDomainDetachDeviceLiveAndConfig(virQEMUDriverPtr driver,
     ret = 0;
 
  cleanup:
-    if (dev != dev_copy)
-        virDomainDeviceDefFree(dev_copy);
-    virDomainDeviceDefFree(dev);
+    for (i = 0; i < ndevs; i++) {
+        if (devs[i] != devs_copy[i])
+            virDomainDeviceDefFree(devs_copy[i]);
+        virDomainDeviceDefFree(devs[i]);
+    }
+    g_free(devs_copy);
+    g_free(devs);
     virDomainDefFree(vmdef);
     return ret;
 }
@@ -9088,6 +10108,7 @@ qemuDomainDetachDeviceFlags(virDomainPtr dom,
 {
     virQEMUDriverPtr driver = dom->conn->privateData;
     virDomainObjPtr vm = NULL;
+    const char *xmls[] = { xml, NULL };
     int ret = -1;
 
     if (!(vm = qemuDomainObjFromDomain(dom)))
@@ -9102,7 +10123,47 @@ qemuDomainDetachDeviceFlags(virDomainPtr dom,
     if (virDomainObjUpdateModificationImpact(vm, &flags) < 0)
         goto endjob;
 
-    if (qemuDomainDetachDeviceLiveAndConfig(driver, vm, xml, flags) < 0)
+    if (qemuDomainDetachDeviceLiveAndConfig(driver, vm, xmls, flags) < 0)
+        goto endjob;
+
+    ret = 0;
+
+ endjob:
+    qemuDomainObjEndJob(driver, vm);
+
+ cleanup:
+    virDomainObjEndAPI(&vm);
+    return ret;
+}
+
+
+static int
+qemuDomainDetachDevices(virDomainPtr dom,
+                        const char *xml,
+                        unsigned int flags)
+{
+    virQEMUDriverPtr driver = dom->conn->privateData;
+    virDomainObjPtr vm = NULL;
+    VIR_AUTOSTRINGLIST xmls = NULL;
+    int ret = -1;
+
+    if (!(xmls = virDomainDeviceXMLSplit(xml)))
+        return -1;
+
+    if (!(vm = qemuDomainObjFromDomain(dom)))
+        goto cleanup;
+
+    if (virDomainDetachDevicesEnsureACL(dom->conn, vm->def, flags) < 0)
+        goto cleanup;
+
+    if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_MODIFY) < 0)
+        goto cleanup;
+
+    if (virDomainObjUpdateModificationImpact(vm, &flags) < 0)
+        goto endjob;
+
+    if (qemuDomainDetachDeviceLiveAndConfig(driver, vm, (const char **) xmls,
+                                            flags) < 0)
         goto endjob;
 
     ret = 0;
@@ -11491,6 +12552,82 @@ qemuDomainGetInterfaceParameters(virDomainPtr dom,
     return ret;
 }
 
+/**
+ * qemuDomainMemoryStatsCached:
+ * @driver: qemu driver
+ * @vm: domain object
+ * @stats: array to fill
+ * @nr_stats: size of @stats
+ *
+ * Fills @stats from the balloon size kept up to date by BALLOON_CHANGE
+ * events and the guest statistics remembered from the periodic poll
+ * configured by balloon_stats_interval or from the last monitor query,
+ * without talking to the monitor.
+ *
+ * Returns the number of filled items of @stats, -1 if there are no recent
+ * enough statistics.
+ */
+static int
+qemuDomainMemoryStatsCached(virQEMUDriverPtr driver,
+                            virDomainObjPtr vm,
+                            virDomainMemoryStatPtr stats,
+                            unsigned int nr_stats)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    unsigned int maxAge;
+    int got;
+
+    if (nr_stats == 0 || !virDomainDefHasMemballoon(vm->def))
+        return -1;
+
+    stats[0].tag = VIR_DOMAIN_MEMORY_STAT_ACTUAL_BALLOON;
+    stats[0].val = vm->def->mem.cur_balloon;
+
+    /* the guest doesn't report any statistics, the balloon size is all
+     * there is to know */
+    if (vm->def->memballoon->period <= 0)
+        return 1;
+
+    /* with the poll allow one missed round before falling back to the
+     * monitor, otherwise the guest refreshes its statistics only once
+     * per period anyway */
+    if (cfg->balloonStatsInterval > 0)
+        maxAge = 2 * cfg->balloonStatsInterval;
+    else
+        maxAge = vm->def->memballoon->period;
+
+    if ((got = qemuDomainBalloonStatsLookup(vm->privateData, maxAge,
+                                            stats + 1, nr_stats - 1)) < 0)
+        return -1;
+
+    return got + 1;
+}
+
+
+static int
+qemuDomainMemoryStatsAddRSS(virDomainObjPtr vm,
+                            virDomainMemoryStatPtr stats,
+                            unsigned int nr_stats,
+                            int nstats)
+{
+    long rss;
+
+    if (nstats >= nr_stats)
+        return nstats;
+
+    if (qemuGetProcessInfo(NULL, NULL, &rss, vm->pid, 0) < 0) {
+        virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                       _("cannot get RSS for domain"));
+    } else {
+        stats[nstats].tag = VIR_DOMAIN_MEMORY_STAT_RSS;
+        stats[nstats].val = rss;
+        nstats++;
+    }
+
+    return nstats;
+}
+
+
 /* This functions assumes that job QEMU_JOB_QUERY is started by a caller */
 static int
 qemuDomainMemoryStatsInternal(virQEMUDriverPtr driver,
@@ -11500,34 +12637,30 @@ qemuDomainMemoryStatsInternal(virQEMUDriverPtr driver,
 
 {
     int ret = -1;
-    long rss;
 
     if (virDomainObjCheckActive(vm) < 0)
         return -1;
 
-    if (virDomainDefHasMemballoon(vm->def)) {
+    if ((ret = qemuDomainMemoryStatsCached(driver, vm, stats, nr_stats)) < 0 &&
+        virDomainDefHasMemballoon(vm->def)) {
         qemuDomainObjEnterMonitor(driver, vm);
         ret = qemuMonitorGetMemoryStats(qemuDomainGetMonitor(vm),
                                         vm->def->memballoon, stats, nr_stats);
         if (qemuDomainObjExitMonitor(driver, vm) < 0)
             ret = -1;
 
-        if (ret < 0 || ret >= nr_stats)
-            return ret;
-    } else {
-        ret = 0;
-    }
+        if (ret < 0)
+            return -1;
 
-    if (qemuGetProcessInfo(NULL, NULL, &rss, vm->pid, 0) < 0) {
-        virReportError(VIR_ERR_OPERATION_FAILED, "%s",
-                       _("cannot get RSS for domain"));
-    } else {
-        stats[ret].tag = VIR_DOMAIN_MEMORY_STAT_RSS;
-        stats[ret].val = rss;
-        ret++;
+        /* remember complete guest statistics for the next caller */
+        if (ret > 1 && nr_stats >= VIR_DOMAIN_MEMORY_STAT_NR &&
+            stats[0].tag == VIR_DOMAIN_MEMORY_STAT_ACTUAL_BALLOON)
+            qemuDomainBalloonStatsStore(vm->privateData, stats + 1, ret - 1);
+    } else if (ret < 0) {
+        ret = 0;
     }
 
-    return ret;
+    return qemuDomainMemoryStatsAddRSS(vm, stats, nr_stats, ret);
 }
 
 static int
@@ -11538,6 +12671,8 @@ qemuDomainMemoryStats(virDomainPtr dom,
 {
     virQEMUDriverPtr driver = dom->conn->privateData;
     virDomainObjPtr vm;
+    qemuDomainQueryFlightPtr flight;
+    g_autofree char *key = NULL;
     int ret = -1;
 
     virCheckFlags(0, -1);
@@ -11548,11 +12683,35 @@ qemuDomainMemoryStats(virDomainPtr dom,
     if (virDomainMemoryStatsEnsureACL(dom->conn, vm->def) < 0)
         goto cleanup;
 
+    /* Answer from the cached statistics without waiting for a job, so
+     * that long running jobs don't block the query */
+    if (virDomainObjIsActive(vm) &&
+        (ret = qemuDomainMemoryStatsCached(driver, vm, stats, nr_stats)) >= 0) {
+        ret = qemuDomainMemoryStatsAddRSS(vm, stats, nr_stats, ret);
+        goto cleanup;
+    }
+
+    key = g_strdup_printf("memory-stats:%u", nr_stats);
+
+    if ((flight = qemuDomainQueryFlightJoin(vm, key))) {
+        ret = flight->ret;
+        if (ret > 0)
+            memcpy(stats, flight->data, ret * sizeof(*stats));
+        qemuDomainQueryFlightLeave(vm, flight);
+        goto cleanup;
+    }
+
     if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY) < 0)
         goto cleanup;
 
+    flight = qemuDomainQueryFlightBegin(vm, key);
+
     ret = qemuDomainMemoryStatsInternal(driver, vm, stats, nr_stats);
 
+    qemuDomainQueryFlightEnd(vm, flight, ret,
+                             ret > 0 ? g_memdup(stats, ret * sizeof(*stats)) : NULL,
+                             g_free);
+
     qemuDomainObjEndJob(driver, vm);
 
  cleanup:
@@ -11922,6 +13081,8 @@ qemuDomainGetBlockInfo(virDomainPtr dom,
     virDomainDiskDefPtr disk;
     g_autoptr(virQEMUDriverConfig) cfg = NULL;
     qemuBlockStatsPtr entry = NULL;
+    qemuDomainQueryFlightPtr flight;
+    g_autofree char *key = NULL;
 
     virCheckFlags(0, -1);
 
@@ -11933,9 +13094,20 @@ qemuDomainGetBlockInfo(virDomainPtr dom,
     if (virDomainGetBlockInfoEnsureACL(dom->conn, vm->def) < 0)
         goto cleanup;
 
+    key = g_strdup_printf("block-info:%s", path);
+
+    if ((flight = qemuDomainQueryFlightJoin(vm, key))) {
+        memcpy(info, flight->data, sizeof(*info));
+        ret = flight->ret;
+        qemuDomainQueryFlightLeave(vm, flight);
+        goto cleanup;
+    }
+
     if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY) < 0)
         goto cleanup;
 
+    flight = qemuDomainQueryFlightBegin(vm, key);
+
     if (!(disk = virDomainDiskByName(vm->def, path, false))) {
         virReportError(VIR_ERR_INVALID_ARG,
                        _("invalid path %s not assigned to domain"), path);
@@ -12005,6 +13177,9 @@ qemuDomainGetBlockInfo(virDomainPtr dom,
     ret = 0;
 
  endjob:
+    qemuDomainQueryFlightEnd(vm, flight, ret,
+                             ret == 0 ? g_memdup(info, sizeof(*info)) : NULL,
+                             g_free);
     qemuDomainObjEndJob(driver, vm);
  cleanup:
     VIR_FREE(entry);
@@ -12625,6 +13800,32 @@ qemuDomainMigratePrepareTunnel3Params(virConnectPtr dconn,
 }
 
 
+static int
+qemuDomainMigrateTunnelChannel(virDomainPtr dom,
+                               virStreamPtr st,
+                               unsigned int channel,
+                               unsigned int flags)
+{
+    virQEMUDriverPtr driver = dom->conn->privateData;
+    virDomainObjPtr vm;
+    int ret = -1;
+
+    virCheckFlags(0, -1);
+
+    if (!(vm = qemuDomainObjFromDomain(dom)))
+        return -1;
+
+    if (virDomainMigrateTunnelChannelEnsureACL(dom->conn, vm->def) < 0)
+        goto cleanup;
+
+    ret = qemuMigrationDstTunnelChannel(driver, vm, st, channel);
+
+ cleanup:
+    virDomainObjEndAPI(&vm);
+    return ret;
+}
+
+
 static int
 qemuDomainMigratePerform3(virDomainPtr dom,
                           const char *xmlin,
@@ -12752,40 +13953,262 @@ qemuDomainMigratePerform3Params(virDomainPtr dom,
 }
 
 
-static virDomainPtr
-qemuDomainMigrateFinish3(virConnectPtr dconn,
-                         const char *dname,
-                         const char *cookiein,
-                         int cookieinlen,
-                         char **cookieout,
-                         int *cookieoutlen,
-                         const char *dconnuri G_GNUC_UNUSED,
-                         const char *uri G_GNUC_UNUSED,
-                         unsigned long flags,
-                         int cancelled)
-{
-    virQEMUDriverPtr driver = dconn->privateData;
-    virDomainObjPtr vm;
-
-    virCheckFlags(QEMU_MIGRATION_FLAGS, NULL);
+#define QEMU_MIGRATION_PARALLEL_DOMAINS_DEFAULT 2
 
-    if (!dname) {
-        virReportError(VIR_ERR_NO_DOMAIN, "%s", _("missing domain name"));
-        return NULL;
-    }
+typedef struct _qemuDomainListMigrateEntry qemuDomainListMigrateEntry;
+typedef qemuDomainListMigrateEntry *qemuDomainListMigrateEntryPtr;
+struct _qemuDomainListMigrateEntry {
+    virDomainPtr dom;
+    unsigned long long memory;
+};
 
-    vm = virDomainObjListFindByName(driver->domains, dname);
-    if (!vm) {
-        virReportError(VIR_ERR_NO_DOMAIN,
-                       _("no domain with matching name '%s'"), dname);
-        qemuMigrationDstErrorReport(driver, dname);
-        return NULL;
-    }
+typedef struct _qemuDomainListMigrateData qemuDomainListMigrateData;
+typedef qemuDomainListMigrateData *qemuDomainListMigrateDataPtr;
+struct _qemuDomainListMigrateData {
+    virMutex lock;
+    qemuDomainListMigrateEntryPtr entries;
+    size_t nentries;
+    size_t next;
+    size_t nfailed;
+    virErrorPtr err;
+
+    virIdentityPtr identity;
+    const char *dconnuri;
+    virTypedParameterPtr params;
+    int nparams;
+    unsigned int flags;
+};
 
-    if (virDomainMigrateFinish3EnsureACL(dconn, vm->def) < 0) {
-        virDomainObjEndAPI(&vm);
-        return NULL;
-    }
+
+static int
+qemuDomainListMigrateEntryCompare(const void *a,
+                                  const void *b)
+{
+    const qemuDomainListMigrateEntry *ea = a;
+    const qemuDomainListMigrateEntry *eb = b;
+
+    if (ea->memory < eb->memory)
+        return -1;
+    if (ea->memory > eb->memory)
+        return 1;
+    return 0;
+}
+
+
+static void
+qemuDomainListMigrateWorker(void *opaque)
+{
+    qemuDomainListMigrateDataPtr data = opaque;
+
+    /* access control checks of the individual migrations need to see the
+     * identity of the client which called virDomainListMigrate */
+    if (virIdentitySetCurrent(data->identity) < 0)
+        return;
+
+    while (true) {
+        virDomainPtr dom;
+        int rc;
+
+        virMutexLock(&data->lock);
+        if (data->next == data->nentries) {
+            virMutexUnlock(&data->lock);
+            break;
+        }
+        dom = data->entries[data->next++].dom;
+        virMutexUnlock(&data->lock);
+
+        VIR_DEBUG("Migrating domain %s to %s", dom->name, data->dconnuri);
+
+        rc = qemuDomainMigratePerform3Params(dom, data->dconnuri,
+                                             data->params, data->nparams,
+                                             NULL, 0, NULL, NULL,
+                                             data->flags);
+
+        if (rc < 0) {
+            VIR_WARN("Migration of domain %s failed: %s",
+                     dom->name, virGetLastErrorMessage());
+
+            virMutexLock(&data->lock);
+            data->nfailed++;
+            if (!data->err)
+                virErrorPreserveLast(&data->err);
+            virMutexUnlock(&data->lock);
+        }
+    }
+
+    ignore_value(virIdentitySetCurrent(NULL));
+}
+
+
+static int
+qemuDomainListMigrate(virConnectPtr conn,
+                      virDomainPtr *doms,
+                      unsigned int ndoms,
+                      const char *dconnuri,
+                      virTypedParameterPtr params,
+                      int nparams,
+                      unsigned int flags)
+{
+    qemuDomainListMigrateData data = { 0 };
+    g_autofree qemuDomainListMigrateEntryPtr entries = NULL;
+    g_autofree virThreadPtr threads = NULL;
+    virTypedParameterPtr migParams = NULL;
+    int nmigParams = 0;
+    unsigned int parallel = QEMU_MIGRATION_PARALLEL_DOMAINS_DEFAULT;
+    unsigned long long bandwidth = 0;
+    size_t nthreads = 0;
+    size_t i;
+    int ret = -1;
+
+    virCheckFlags(QEMU_MIGRATION_FLAGS, -1);
+
+    if (virDomainListMigrateEnsureACL(conn) < 0)
+        return -1;
+
+    if (virTypedParamsGetUInt(params, nparams,
+                              VIR_MIGRATE_PARAM_PARALLEL_DOMAINS,
+                              &parallel) < 0 ||
+        virTypedParamsGetULLong(params, nparams,
+                                VIR_MIGRATE_PARAM_BANDWIDTH,
+                                &bandwidth) < 0)
+        return -1;
+
+    if (parallel == 0) {
+        virReportError(VIR_ERR_INVALID_ARG, "%s",
+                       _("number of parallel migrations must be positive"));
+        return -1;
+    }
+
+    if (virTypedParamsGet(params, nparams, VIR_MIGRATE_PARAM_DEST_NAME) ||
+        virTypedParamsGet(params, nparams, VIR_MIGRATE_PARAM_DEST_XML) ||
+        virTypedParamsGet(params, nparams, VIR_MIGRATE_PARAM_PERSIST_XML)) {
+        virReportError(VIR_ERR_INVALID_ARG, "%s",
+                       _("domain specific migration parameters cannot be "
+                         "used when migrating a list of domains"));
+        return -1;
+    }
+
+    nthreads = MIN(parallel, ndoms);
+
+    /* each migration gets an equal share of the total bandwidth */
+    if (virTypedParamsCopy(&migParams, params, nparams) < 0)
+        return -1;
+
+    for (i = 0; i < nparams; i++) {
+        if (STREQ(migParams[i].field, VIR_MIGRATE_PARAM_PARALLEL_DOMAINS))
+            continue;
+
+        if (STREQ(migParams[i].field, VIR_MIGRATE_PARAM_BANDWIDTH))
+            migParams[i].value.ul = MAX(bandwidth / nthreads, 1);
+
+        migParams[nmigParams++] = migParams[i];
+    }
+
+    /* migrate domains with less memory first */
+    entries = g_new0(qemuDomainListMigrateEntry, ndoms);
+    for (i = 0; i < ndoms; i++) {
+        virDomainObjPtr vm;
+
+        if (!(vm = qemuDomainObjFromDomain(doms[i])))
+            goto cleanup;
+
+        entries[i].dom = doms[i];
+        entries[i].memory = virDomainDefGetMemoryTotal(vm->def);
+        virDomainObjEndAPI(&vm);
+    }
+
+    qsort(entries, ndoms, sizeof(*entries), qemuDomainListMigrateEntryCompare);
+
+    if (virMutexInit(&data.lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        goto cleanup;
+    }
+
+    data.entries = entries;
+    data.nentries = ndoms;
+    data.identity = virIdentityGetCurrent();
+    data.dconnuri = dconnuri;
+    data.params = migParams;
+    data.nparams = nmigParams;
+    data.flags = flags;
+
+    VIR_DEBUG("Migrating %u domains to %s using %zu parallel migrations",
+              ndoms, dconnuri, nthreads);
+
+    threads = g_new0(virThread, nthreads);
+    for (i = 0; i < nthreads; i++) {
+        if (virThreadCreateFull(&threads[i], true, qemuDomainListMigrateWorker,
+                                "qemu-migrate-list", false, &data) < 0) {
+            if (i == 0) {
+                virReportSystemError(errno, "%s",
+                                     _("Unable to create migration thread"));
+                goto cleanup;
+            }
+
+            /* let the threads we already have drain the list */
+            VIR_WARN("Unable to create migration thread, using only %zu", i);
+            nthreads = i;
+            break;
+        }
+    }
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    if (data.nfailed > 0) {
+        VIR_WARN("Migration of %zu out of %u domains failed",
+                 data.nfailed, ndoms);
+        virErrorRestore(&data.err);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    if (data.entries)
+        virMutexDestroy(&data.lock);
+    g_clear_object(&data.identity);
+    virFreeError(data.err);
+    virTypedParamsFree(migParams, nmigParams);
+    return ret;
+}
+
+
+static virDomainPtr
+qemuDomainMigrateFinish3(virConnectPtr dconn,
+                         const char *dname,
+                         const char *cookiein,
+                         int cookieinlen,
+                         char **cookieout,
+                         int *cookieoutlen,
+                         const char *dconnuri G_GNUC_UNUSED,
+                         const char *uri G_GNUC_UNUSED,
+                         unsigned long flags,
+                         int cancelled)
+{
+    virQEMUDriverPtr driver = dconn->privateData;
+    virDomainObjPtr vm;
+
+    virCheckFlags(QEMU_MIGRATION_FLAGS, NULL);
+
+    if (!dname) {
+        virReportError(VIR_ERR_NO_DOMAIN, "%s", _("missing domain name"));
+        return NULL;
+    }
+
+    vm = virDomainObjListFindByName(driver->domains, dname);
+    if (!vm) {
+        virReportError(VIR_ERR_NO_DOMAIN,
+                       _("no domain with matching name '%s'"), dname);
+        qemuMigrationDstErrorReport(driver, dname);
+        return NULL;
+    }
+
+    if (virDomainMigrateFinish3EnsureACL(dconn, vm->def) < 0) {
+        virDomainObjEndAPI(&vm);
+        return NULL;
+    }
 
     return qemuMigrationDstFinish(driver, dconn, vm,
                                   cookiein, cookieinlen,
@@ -13568,6 +14991,13 @@ qemuDomainGetJobInfoDumpStats(virQEMUDriverPtr driver,
 }
 
 
+static void
+qemuDomainGetJobStatsFlightFree(void *opaque)
+{
+    qemuDomainJobInfoFree(opaque);
+}
+
+
 static int
 qemuDomainGetJobStatsInternal(virQEMUDriverPtr driver,
                               virDomainObjPtr vm,
@@ -13575,6 +15005,7 @@ qemuDomainGetJobStatsInternal(virQEMUDriverPtr driver,
                               qemuDomainJobInfoPtr *jobInfo)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainQueryFlightPtr flight;
     int ret = -1;
 
     *jobInfo = NULL;
@@ -13593,9 +15024,19 @@ qemuDomainGetJobStatsInternal(virQEMUDriverPtr driver,
         return -1;
     }
 
+    if ((flight = qemuDomainQueryFlightJoin(vm, "job-stats"))) {
+        if (flight->data)
+            *jobInfo = qemuDomainJobInfoCopy(flight->data);
+        ret = flight->ret;
+        qemuDomainQueryFlightLeave(vm, flight);
+        return ret;
+    }
+
     if (qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY) < 0)
         return -1;
 
+    flight = qemuDomainQueryFlightBegin(vm, "job-stats");
+
     if (virDomainObjCheckActive(vm) < 0)
         goto cleanup;
 
@@ -13622,6 +15063,11 @@ qemuDomainGetJobStatsInternal(virQEMUDriverPtr driver,
             goto cleanup;
         break;
 
+    case QEMU_DOMAIN_JOB_STATS_TYPE_START:
+        if (qemuDomainJobInfoUpdateTime(*jobInfo) < 0)
+            goto cleanup;
+        break;
+
     case QEMU_DOMAIN_JOB_STATS_TYPE_NONE:
         break;
     }
@@ -13629,6 +15075,10 @@ qemuDomainGetJobStatsInternal(virQEMUDriverPtr driver,
     ret = 0;
 
  cleanup:
+    qemuDomainQueryFlightEnd(vm, flight, ret,
+                             ret == 0 && *jobInfo ?
+                             qemuDomainJobInfoCopy(*jobInfo) : NULL,
+                             qemuDomainGetJobStatsFlightFree);
     qemuDomainObjEndJob(driver, vm);
     return ret;
 }
@@ -15277,6 +16727,24 @@ qemuDomainSnapshotDiskPrepare(virQEMUDriverPtr driver,
     if (VIR_ALLOC_N(data, snapdef->ndisks) < 0)
         return -1;
 
+    /* Expose all the pre-existing block device targets in the domain's
+     * namespace at once rather than one disk at a time. */
+    qemuDomainNamespaceBatchBegin(vm);
+
+    for (i = 0; i < snapdef->ndisks; i++) {
+        virStorageSourcePtr src = snapdef->disks[i].src;
+
+        if (snapdef->disks[i].snapshot == VIR_DOMAIN_SNAPSHOT_LOCATION_NONE ||
+            virStorageSourceGetActualType(src) != VIR_STORAGE_TYPE_BLOCK)
+            continue;
+
+        if (qemuDomainNamespaceSetupDisk(vm, src) < 0)
+            goto cleanup;
+    }
+
+    if (qemuDomainNamespaceBatchCommit(vm) < 0)
+        goto cleanup;
+
     for (i = 0; i < snapdef->ndisks; i++) {
         if (snapdef->disks[i].snapshot == VIR_DOMAIN_SNAPSHOT_LOCATION_NONE)
             continue;
@@ -15296,6 +16764,7 @@ qemuDomainSnapshotDiskPrepare(virQEMUDriverPtr driver,
     ret = 0;
 
  cleanup:
+    qemuDomainNamespaceBatchEnd(vm);
     qemuDomainSnapshotDiskCleanup(data, ndata, driver, vm, asyncJob);
     return ret;
 }
@@ -16749,13 +18218,9 @@ qemuDomainRevertToSnapshot(virDomainSnapshotPtr snapshot,
 typedef struct _virQEMUMomentReparent virQEMUMomentReparent;
 typedef virQEMUMomentReparent *virQEMUMomentReparentPtr;
 struct _virQEMUMomentReparent {
-    const char *dir;
     virDomainMomentObjPtr parent;
-    virDomainObjPtr vm;
-    virDomainXMLOptionPtr xmlopt;
-    int err;
-    int (*writeMetadata)(virDomainObjPtr, virDomainMomentObjPtr,
-                         virDomainXMLOptionPtr, const char *);
+    virDomainMomentObjPtr *children;
+    size_t nchildren;
 };
 
 
@@ -16767,16 +18232,12 @@ qemuDomainMomentReparentChildren(void *payload,
     virDomainMomentObjPtr moment = payload;
     virQEMUMomentReparentPtr rep = data;
 
-    if (rep->err < 0)
-        return 0;
-
     VIR_FREE(moment->def->parent_name);
 
     if (rep->parent->def)
         moment->def->parent_name = g_strdup(rep->parent->def->name);
 
-    rep->err = rep->writeMetadata(rep->vm, moment, rep->xmlopt,
-                                  rep->dir);
+    rep->children[rep->nchildren++] = moment;
     return 0;
 }
 
@@ -16858,16 +18319,21 @@ qemuDomainSnapshotDelete(virDomainSnapshotPtr snapshot,
             }
         }
     } else if (snap->nchildren) {
-        rep.dir = cfg->snapshotDir;
+        g_autofree virDomainMomentObjPtr *children = NULL;
+
+        /* write the metadata of all children at once, deep hierarchies
+         * can have many snapshots sharing a parent */
+        children = g_new0(virDomainMomentObjPtr, snap->nchildren);
         rep.parent = snap->parent;
-        rep.vm = vm;
-        rep.err = 0;
-        rep.xmlopt = driver->xmlopt;
-        rep.writeMetadata = qemuDomainSnapshotWriteMetadata;
+        rep.children = children;
+        rep.nchildren = 0;
         virDomainMomentForEachChild(snap,
                                     qemuDomainMomentReparentChildren,
                                     &rep);
-        if (rep.err < 0)
+        if (qemuDomainSnapshotWriteMetadataList(vm, rep.children,
+                                                rep.nchildren,
+                                                driver->xmlopt,
+                                                cfg->snapshotDir) < 0)
             goto endjob;
         virDomainMomentMoveChildren(snap, snap->parent);
     }
@@ -17776,11 +19242,7 @@ qemuDomainGetBlockJobInfo(virDomainPtr dom,
         goto endjob;
     }
 
-    qemuDomainObjEnterMonitor(driver, vm);
-    ret = qemuMonitorGetBlockJobInfo(qemuDomainGetMonitor(vm), job->name, &rawInfo);
-    if (qemuDomainObjExitMonitor(driver, vm) < 0)
-        ret = -1;
-    if (ret <= 0)
+    if ((ret = qemuBlockJobGetInfo(driver, vm, job, &rawInfo)) <= 0)
         goto endjob;
 
     if (qemuBlockJobInfoTranslate(&rawInfo, info, disk,
@@ -17852,6 +19314,9 @@ qemuDomainBlockJobSetSpeed(virDomainPtr dom,
     if (qemuDomainObjExitMonitor(driver, vm) < 0)
         ret = -1;
 
+    /* the cached progress reports the old bandwidth */
+    job->infoValid = false;
+
  endjob:
     qemuDomainObjEndJob(driver, vm);
 
@@ -19958,7 +21423,7 @@ qemuConnectListAllDomains(virConnectPtr conn,
         return -1;
 
     return virDomainObjListExport(driver->domains, conn, domains,
-                                  virConnectListAllDomainsCheckACL, flags);
+                                  virConnectListAllDomainsCheckACLList, flags);
 }
 
 static char *
@@ -20644,11 +22109,95 @@ qemuConnectGetDomainCapabilities(virConnectPtr conn,
 }
 
 
+/*
+ * Data shared by gathering the stats of all the domains of a single
+ * qemuConnectGetAllDomainStats call.
+ */
+typedef struct _qemuDomainGetStatsSweep qemuDomainGetStatsSweep;
+typedef qemuDomainGetStatsSweep *qemuDomainGetStatsSweepPtr;
+struct _qemuDomainGetStatsSweep {
+    virMutex lock;
+
+    /* statistics of host and OVS interfaces, read on first use */
+    bool ifstatsRead;
+    virHashTablePtr ifstats;
+    bool ovsstatsRead;
+    virHashTablePtr ovsstats;
+};
+
+
+static int
+qemuDomainGetStatsSweepInit(qemuDomainGetStatsSweepPtr sweep)
+{
+    memset(sweep, 0, sizeof(*sweep));
+
+    if (virMutexInit(&sweep->lock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void
+qemuDomainGetStatsSweepClear(qemuDomainGetStatsSweepPtr sweep)
+{
+    virHashFree(sweep->ifstats);
+    virHashFree(sweep->ovsstats);
+    virMutexDestroy(&sweep->lock);
+}
+
+
+/*
+ * Returns the statistics of all host interfaces, reading them on first
+ * use within @sweep, or NULL if they can't be read.
+ */
+static virHashTablePtr
+qemuDomainGetStatsSweepIfStats(qemuDomainGetStatsSweepPtr sweep)
+{
+    virHashTablePtr ret;
+
+    virMutexLock(&sweep->lock);
+    if (!sweep->ifstatsRead) {
+        if (!(sweep->ifstats = virNetDevTapInterfaceStatsTable()))
+            virResetLastError();
+        sweep->ifstatsRead = true;
+    }
+    ret = sweep->ifstats;
+    virMutexUnlock(&sweep->lock);
+
+    return ret;
+}
+
+
+/*
+ * Like qemuDomainGetStatsSweepIfStats, for OVS interfaces.
+ */
+static virHashTablePtr
+qemuDomainGetStatsSweepOvsStats(qemuDomainGetStatsSweepPtr sweep)
+{
+    virHashTablePtr ret;
+
+    virMutexLock(&sweep->lock);
+    if (!sweep->ovsstatsRead) {
+        if (!(sweep->ovsstats = virNetDevOpenvswitchInterfaceStatsTable()))
+            virResetLastError();
+        sweep->ovsstatsRead = true;
+    }
+    ret = sweep->ovsstats;
+    virMutexUnlock(&sweep->lock);
+
+    return ret;
+}
+
+
 static int
 qemuDomainGetStatsState(virQEMUDriverPtr driver G_GNUC_UNUSED,
                         virDomainObjPtr dom,
                         virTypedParamListPtr params,
-                        unsigned int privflags G_GNUC_UNUSED)
+                        unsigned int privflags G_GNUC_UNUSED,
+                        qemuDomainGetStatsSweepPtr sweep G_GNUC_UNUSED)
 {
     if (virTypedParamListAddInt(params, dom->state.state, "state.state") < 0)
         return -1;
@@ -20665,12 +22214,15 @@ typedef enum {
                                             accessed */
     QEMU_DOMAIN_STATS_BACKING  = 1 << 1, /* include backing chain in
                                             block stats */
+    QEMU_DOMAIN_STATS_CACHED   = 1 << 2, /* stats requiring a job are
+                                            reported from the cache */
 } qemuDomainStatsFlags;
 
 
 #define HAVE_JOB(flags) ((flags) & QEMU_DOMAIN_STATS_HAVE_JOB)
 
 
+
 typedef struct _virQEMUResctrlMonData virQEMUResctrlMonData;
 typedef virQEMUResctrlMonData *virQEMUResctrlMonDataPtr;
 struct _virQEMUResctrlMonData {
@@ -20977,7 +22529,8 @@ static int
 qemuDomainGetStatsCpu(virQEMUDriverPtr driver,
                       virDomainObjPtr dom,
                       virTypedParamListPtr params,
-                      unsigned int privflags G_GNUC_UNUSED)
+                      unsigned int privflags G_GNUC_UNUSED,
+                      qemuDomainGetStatsSweepPtr sweep G_GNUC_UNUSED)
 {
     if (qemuDomainGetStatsCpuCgroup(dom, params) < 0)
         return -1;
@@ -20993,7 +22546,8 @@ static int
 qemuDomainGetStatsMemory(virQEMUDriverPtr driver,
                          virDomainObjPtr dom,
                          virTypedParamListPtr params,
-                         unsigned int privflags G_GNUC_UNUSED)
+                         unsigned int privflags G_GNUC_UNUSED,
+                         qemuDomainGetStatsSweepPtr sweep G_GNUC_UNUSED)
 
 {
     return qemuDomainGetStatsMemoryBandwidth(driver, dom, params);
@@ -21001,44 +22555,335 @@ qemuDomainGetStatsMemory(virQEMUDriverPtr driver,
 
 
 static int
-qemuDomainGetStatsBalloon(virQEMUDriverPtr driver,
-                          virDomainObjPtr dom,
-                          virTypedParamListPtr params,
-                          unsigned int privflags)
+qemuDomainGetStatsPressureAdd(virTypedParamListPtr params,
+                              const virCgroupPressure *pressure,
+                              const char *prefix)
 {
-    virDomainMemoryStatStruct stats[VIR_DOMAIN_MEMORY_STAT_NR];
-    int nr_stats;
-    unsigned long long cur_balloon = 0;
+    if (virTypedParamListAddDouble(params, pressure->avg10,
+                                   "%s.avg10", prefix) < 0 ||
+        virTypedParamListAddDouble(params, pressure->avg60,
+                                   "%s.avg60", prefix) < 0 ||
+        virTypedParamListAddDouble(params, pressure->avg300,
+                                   "%s.avg300", prefix) < 0 ||
+        virTypedParamListAddULLong(params, pressure->total,
+                                   "%s.total", prefix) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/**
+ * qemuDomainGetStatsPressureCgroup:
+ * @cgroup: cgroup to report on
+ * @params: list to add the stats to
+ * @prefix: prefix of the typed parameter names
+ * @cpuOnly: report only CPU related stats
+ *
+ * Stats which can't be read from @cgroup (e.g. pressure stall
+ * information on cgroups v1 hosts) are silently left out.
+ */
+static int
+qemuDomainGetStatsPressureCgroup(virCgroupPtr cgroup,
+                                 virTypedParamListPtr params,
+                                 const char *prefix,
+                                 bool cpuOnly)
+{
+    unsigned long long periods;
+    unsigned long long throttled;
+    unsigned long long throttledTime;
     size_t i;
 
-    if (!virDomainDefHasMemballoon(dom->def)) {
-        cur_balloon = virDomainDefGetMemoryTotal(dom->def);
-    } else {
-        cur_balloon = dom->def->mem.cur_balloon;
-    }
+    for (i = 0; i < VIR_CGROUP_PRESSURE_LAST; i++) {
+        const char *resource = virCgroupPressureResourceTypeToString(i);
+        g_autofree char *some_prefix = NULL;
+        g_autofree char *full_prefix = NULL;
+        virCgroupPressure some;
+        virCgroupPressure full;
+        bool hasFull;
+        int rc;
 
-    if (virTypedParamListAddULLong(params, cur_balloon, "balloon.current") < 0)
-        return -1;
+        if (cpuOnly && i != VIR_CGROUP_PRESSURE_CPU)
+            continue;
 
-    if (virTypedParamListAddULLong(params, virDomainDefGetMemoryTotal(dom->def),
-                                   "balloon.maximum") < 0)
-        return -1;
+        if ((rc = virCgroupGetPressure(cgroup, i, &some, &full, &hasFull)) < 0) {
+            virResetLastError();
+            continue;
+        }
 
-    if (!HAVE_JOB(privflags) || !virDomainObjIsActive(dom))
+        if (rc == 0)
+            continue;
+
+        some_prefix = g_strdup_printf("%s%s.some", prefix, resource);
+        if (qemuDomainGetStatsPressureAdd(params, &some, some_prefix) < 0)
+            return -1;
+
+        if (hasFull) {
+            full_prefix = g_strdup_printf("%s%s.full", prefix, resource);
+            if (qemuDomainGetStatsPressureAdd(params, &full, full_prefix) < 0)
+                return -1;
+        }
+    }
+
+    if (!virCgroupHasController(cgroup, VIR_CGROUP_CONTROLLER_CPU))
         return 0;
 
-    nr_stats = qemuDomainMemoryStatsInternal(driver, dom, stats,
-                                             VIR_DOMAIN_MEMORY_STAT_NR);
-    if (nr_stats < 0)
+    if (virCgroupGetCpuThrottleStat(cgroup, &periods, &throttled,
+                                    &throttledTime) < 0) {
+        virResetLastError();
         return 0;
+    }
 
-#define STORE_MEM_RECORD(TAG, NAME) \
-    if (stats[i].tag == VIR_DOMAIN_MEMORY_STAT_ ##TAG) \
-        if (virTypedParamListAddULLong(params, stats[i].val, "balloon." NAME) < 0) \
-            return -1;
+    if (virTypedParamListAddULLong(params, periods,
+                                   "%sthrottle.periods", prefix) < 0 ||
+        virTypedParamListAddULLong(params, throttled,
+                                   "%sthrottle.throttled", prefix) < 0 ||
+        virTypedParamListAddULLong(params, throttledTime,
+                                   "%sthrottle.time", prefix) < 0)
+        return -1;
 
-    for (i = 0; i < nr_stats; i++) {
-        STORE_MEM_RECORD(SWAP_IN, "swap_in")
+    return 0;
+}
+
+
+static int
+qemuDomainGetStatsPressure(virQEMUDriverPtr driver G_GNUC_UNUSED,
+                           virDomainObjPtr dom,
+                           virTypedParamListPtr params,
+                           unsigned int privflags G_GNUC_UNUSED,
+                           qemuDomainGetStatsSweepPtr sweep G_GNUC_UNUSED)
+{
+    qemuDomainObjPrivatePtr priv = dom->privateData;
+    size_t i;
+
+    if (!virDomainObjIsActive(dom) || !priv->cgroup)
+        return 0;
+
+    if (qemuDomainGetStatsPressureCgroup(priv->cgroup, params,
+                                         "pressure.", false) < 0)
+        return -1;
+
+    /* vCPU threads have their own cgroups only if the domain has
+     * the cpu controller, see qemuProcessSetupPid */
+    if (!virCgroupHasController(priv->cgroup, VIR_CGROUP_CONTROLLER_CPU))
+        return 0;
+
+    for (i = 0; i < virDomainDefGetVcpusMax(dom->def); i++) {
+        virDomainVcpuDefPtr vcpu = virDomainDefGetVcpu(dom->def, i);
+        virCgroupPtr cgroup_vcpu = NULL;
+        g_autofree char *prefix = NULL;
+        int rc;
+
+        if (!vcpu->online)
+            continue;
+
+        if (virCgroupNewThread(priv->cgroup, VIR_CGROUP_THREAD_VCPU, i,
+                               false, &cgroup_vcpu) < 0) {
+            virResetLastError();
+            continue;
+        }
+
+        prefix = g_strdup_printf("pressure.vcpu.%zu.", i);
+        rc = qemuDomainGetStatsPressureCgroup(cgroup_vcpu, params,
+                                              prefix, true);
+        virCgroupFree(&cgroup_vcpu);
+
+        if (rc < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+qemuDomainGetStatsDefinition(virQEMUDriverPtr driver,
+                             virDomainObjPtr dom,
+                             virTypedParamListPtr params,
+                             unsigned int privflags G_GNUC_UNUSED,
+                             qemuDomainGetStatsSweepPtr sweep G_GNUC_UNUSED)
+{
+    unsigned long long generation;
+    g_autofree char *digest = NULL;
+    g_autofree char *configDigest = NULL;
+
+    if (virDomainObjGetDigest(dom, driver->xmlopt, false,
+                              &generation, &digest) < 0 ||
+        virDomainObjGetDigest(dom, driver->xmlopt, true,
+                              NULL, &configDigest) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(params, generation,
+                                   "definition.generation") < 0 ||
+        virTypedParamListAddString(params, digest, "definition.digest") < 0)
+        return -1;
+
+    if (configDigest &&
+        virTypedParamListAddString(params, configDigest,
+                                   "definition.config.digest") < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+qemuDomainGetStatsMonitorHistogram(virTypedParamListPtr params,
+                                   unsigned long long *histogram,
+                                   const char *prefix)
+{
+    size_t i;
+
+    for (i = 0; i < QEMU_MONITOR_STATS_BUCKETS; i++) {
+        if (histogram[i] &&
+            virTypedParamListAddULLong(params, histogram[i],
+                                       "%s.%zu", prefix, i) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+qemuDomainGetStatsJobWait(virTypedParamListPtr params,
+                          qemuDomainJobWaitStatsPtr stats,
+                          const char *type)
+{
+    g_autofree char *name = g_strdelimit(g_strdup(type), " ", '_');
+
+    if (!stats->count && !stats->timeouts)
+        return 0;
+
+    if (virTypedParamListAddULLong(params, stats->count,
+                                   "monitor.job_wait.%s.count", name) < 0 ||
+        virTypedParamListAddULLong(params, stats->timeouts,
+                                   "monitor.job_wait.%s.timeouts", name) < 0 ||
+        virTypedParamListAddULLong(params, stats->total,
+                                   "monitor.job_wait.%s.total", name) < 0 ||
+        virTypedParamListAddULLong(params, stats->max,
+                                   "monitor.job_wait.%s.max", name) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+qemuDomainGetStatsMonitor(virQEMUDriverPtr driver G_GNUC_UNUSED,
+                          virDomainObjPtr dom,
+                          virTypedParamListPtr params,
+                          unsigned int privflags G_GNUC_UNUSED,
+                          qemuDomainGetStatsSweepPtr sweep G_GNUC_UNUSED)
+{
+    qemuDomainObjPrivatePtr priv = dom->privateData;
+    qemuMonitorStats stats;
+    size_t i;
+    int ret = -1;
+
+    if (!virDomainObjIsActive(dom) || !priv->mon)
+        return 0;
+
+    if (qemuMonitorGetStats(priv->mon, &stats) < 0)
+        return 0;
+
+    if (virTypedParamListAddULLong(params, stats.pending,
+                                   "monitor.pending") < 0 ||
+        virTypedParamListAddULLong(params, stats.jobWaitCount,
+                                   "monitor.job_wait.count") < 0 ||
+        qemuDomainGetStatsMonitorHistogram(params, stats.jobWait,
+                                           "monitor.job_wait") < 0 ||
+        virTypedParamListAddUInt(params, stats.ncommands,
+                                 "monitor.command.count") < 0)
+        goto cleanup;
+
+    for (i = 0; i < stats.ncommands; i++) {
+        qemuMonitorCommandStatsPtr cmd = stats.commands + i;
+        g_autofree char *prefix = g_strdup_printf("monitor.command.%zu.latency",
+                                                  i);
+
+        if (virTypedParamListAddString(params, cmd->name,
+                                       "monitor.command.%zu.name", i) < 0 ||
+            virTypedParamListAddULLong(params, cmd->calls,
+                                       "monitor.command.%zu.calls", i) < 0 ||
+            virTypedParamListAddULLong(params, cmd->errors,
+                                       "monitor.command.%zu.errors", i) < 0 ||
+            qemuDomainGetStatsMonitorHistogram(params, cmd->latency,
+                                               prefix) < 0)
+            goto cleanup;
+    }
+
+    for (i = QEMU_JOB_QUERY; i < QEMU_JOB_LAST; i++) {
+        const char *type = qemuDomainJobTypeToString(i);
+
+        /* async jobs are not stored in job.active */
+        if (i == QEMU_JOB_ASYNC)
+            type = "async";
+
+        if (qemuDomainGetStatsJobWait(params, priv->job.wait + i, type) < 0)
+            goto cleanup;
+    }
+
+    for (i = QEMU_AGENT_JOB_QUERY; i < QEMU_AGENT_JOB_LAST; i++) {
+        g_autofree char *type = g_strdup_printf("agent_%s",
+                                                qemuDomainAgentJobTypeToString(i));
+
+        if (qemuDomainGetStatsJobWait(params, priv->job.agentWait + i, type) < 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    qemuMonitorStatsClear(&stats);
+    return ret;
+}
+
+
+static int
+qemuDomainGetStatsBalloon(virQEMUDriverPtr driver,
+                          virDomainObjPtr dom,
+                          virTypedParamListPtr params,
+                          unsigned int privflags,
+                          qemuDomainGetStatsSweepPtr sweep G_GNUC_UNUSED)
+{
+    virDomainMemoryStatStruct stats[VIR_DOMAIN_MEMORY_STAT_NR];
+    int nr_stats;
+    unsigned long long cur_balloon = 0;
+    size_t i;
+
+    if (!virDomainDefHasMemballoon(dom->def)) {
+        cur_balloon = virDomainDefGetMemoryTotal(dom->def);
+    } else {
+        cur_balloon = dom->def->mem.cur_balloon;
+    }
+
+    if (virTypedParamListAddULLong(params, cur_balloon, "balloon.current") < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(params, virDomainDefGetMemoryTotal(dom->def),
+                                   "balloon.maximum") < 0)
+        return -1;
+
+    if (!virDomainObjIsActive(dom))
+        return 0;
+
+    if (HAVE_JOB(privflags))
+        nr_stats = qemuDomainMemoryStatsInternal(driver, dom, stats,
+                                                 VIR_DOMAIN_MEMORY_STAT_NR);
+    else
+        nr_stats = qemuDomainMemoryStatsCached(driver, dom, stats,
+                                               VIR_DOMAIN_MEMORY_STAT_NR);
+    if (nr_stats < 0)
+        return 0;
+
+#define STORE_MEM_RECORD(TAG, NAME) \
+    if (stats[i].tag == VIR_DOMAIN_MEMORY_STAT_ ##TAG) \
+        if (virTypedParamListAddULLong(params, stats[i].val, "balloon." NAME) < 0) \
+            return -1;
+
+    for (i = 0; i < nr_stats; i++) {
+        STORE_MEM_RECORD(SWAP_IN, "swap_in")
         STORE_MEM_RECORD(SWAP_OUT, "swap_out")
         STORE_MEM_RECORD(MAJOR_FAULT, "major_fault")
         STORE_MEM_RECORD(MINOR_FAULT, "minor_fault")
@@ -21062,7 +22907,8 @@ static int
 qemuDomainGetStatsVcpu(virQEMUDriverPtr driver,
                        virDomainObjPtr dom,
                        virTypedParamListPtr params,
-                       unsigned int privflags)
+                       unsigned int privflags,
+                       qemuDomainGetStatsSweepPtr sweep G_GNUC_UNUSED)
 {
     virDomainVcpuDefPtr vcpu;
     qemuDomainVcpuPrivatePtr vcpupriv;
@@ -21140,16 +22986,19 @@ qemuDomainGetStatsVcpu(virQEMUDriverPtr driver,
 #define QEMU_ADD_NET_PARAM(params, num, name, value) \
     if (value >= 0 && \
         virTypedParamListAddULLong((params), (value), "net.%zu.%s", (num), (name)) < 0) \
-        return -1;
+        goto cleanup;
 
 static int
 qemuDomainGetStatsInterface(virQEMUDriverPtr driver G_GNUC_UNUSED,
                             virDomainObjPtr dom,
                             virTypedParamListPtr params,
-                            unsigned int privflags G_GNUC_UNUSED)
+                            unsigned int privflags G_GNUC_UNUSED,
+                            qemuDomainGetStatsSweepPtr sweep)
 {
     size_t i;
     struct _virDomainInterfaceStats tmp;
+    qemuDomainGetStatsSweep domsweep;
+    int ret = -1;
 
     if (!virDomainObjIsActive(dom))
         return 0;
@@ -21157,6 +23006,13 @@ qemuDomainGetStatsInterface(virQEMUDriverPtr driver G_GNUC_UNUSED,
     if (virTypedParamListAddUInt(params, dom->def->nnets, "net.count") < 0)
         return -1;
 
+    /* read the statistics of all interfaces at most once per domain */
+    if (!sweep) {
+        if (qemuDomainGetStatsSweepInit(&domsweep) < 0)
+            return -1;
+        sweep = &domsweep;
+    }
+
     /* Check the path is one of the domain's network interfaces. */
     for (i = 0; i < dom->def->nnets; i++) {
         virDomainNetDefPtr net = dom->def->nets[i];
@@ -21170,16 +23026,23 @@ qemuDomainGetStatsInterface(virQEMUDriverPtr driver G_GNUC_UNUSED,
         actualType = virDomainNetGetActualType(net);
 
         if (virTypedParamListAddString(params, net->ifname, "net.%zu.name", i) < 0)
-            return -1;
+            goto cleanup;
 
         if (actualType == VIR_DOMAIN_NET_TYPE_VHOSTUSER) {
-            if (virNetDevOpenvswitchInterfaceStats(net->ifname, &tmp) < 0) {
+            virHashTablePtr ovsstats = qemuDomainGetStatsSweepOvsStats(sweep);
+
+            if (!ovsstats ||
+                virNetDevOpenvswitchInterfaceStatsLookup(ovsstats, net->ifname,
+                                                         &tmp) < 0) {
                 virResetLastError();
                 continue;
             }
         } else {
-            if (virNetDevTapInterfaceStats(net->ifname, &tmp,
-                                           !virDomainNetTypeSharesHostView(net)) < 0) {
+            virHashTablePtr ifstats = qemuDomainGetStatsSweepIfStats(sweep);
+
+            if (!ifstats ||
+                virNetDevTapInterfaceStatsLookup(ifstats, net->ifname, &tmp,
+                                                 !virDomainNetTypeSharesHostView(net)) < 0) {
                 virResetLastError();
                 continue;
             }
@@ -21203,7 +23066,12 @@ qemuDomainGetStatsInterface(virQEMUDriverPtr driver G_GNUC_UNUSED,
                            "tx.drop", tmp.tx_drop);
     }
 
-    return 0;
+    ret = 0;
+
+ cleanup:
+    if (sweep == &domsweep)
+        qemuDomainGetStatsSweepClear(&domsweep);
+    return ret;
 }
 
 #undef QEMU_ADD_NET_PARAM
@@ -21487,7 +23355,8 @@ static int
 qemuDomainGetStatsBlock(virQEMUDriverPtr driver,
                         virDomainObjPtr dom,
                         virTypedParamListPtr params,
-                        unsigned int privflags)
+                        unsigned int privflags,
+                        qemuDomainGetStatsSweepPtr sweep G_GNUC_UNUSED)
 {
     size_t i;
     int ret = -1;
@@ -21562,7 +23431,8 @@ static int
 qemuDomainGetStatsIOThread(virQEMUDriverPtr driver,
                            virDomainObjPtr dom,
                            virTypedParamListPtr params,
-                           unsigned int privflags)
+                           unsigned int privflags,
+                           qemuDomainGetStatsSweepPtr sweep G_GNUC_UNUSED)
 {
     qemuDomainObjPrivatePtr priv = dom->privateData;
     size_t i;
@@ -21620,249 +23490,2051 @@ qemuDomainGetStatsIOThread(virQEMUDriverPtr driver,
 static int
 qemuDomainGetStatsPerfOneEvent(virPerfPtr perf,
                                virPerfEventType type,
-                               virTypedParamListPtr params)
+                               virTypedParamListPtr params,
+                               uint64_t *value)
+{
+    if (virPerfReadEvent(perf, type, value) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(params, *value, "perf.%s",
+                                   virPerfEventTypeToString(type)) < 0)
+        return -1;
+
+    return 0;
+}
+
+static int
+qemuDomainGetStatsPerf(virQEMUDriverPtr driver G_GNUC_UNUSED,
+                       virDomainObjPtr dom,
+                       virTypedParamListPtr params,
+                       unsigned int privflags G_GNUC_UNUSED,
+                       qemuDomainGetStatsSweepPtr sweep G_GNUC_UNUSED)
+{
+    size_t i;
+    qemuDomainObjPrivatePtr priv = dom->privateData;
+    uint64_t values[VIR_PERF_EVENT_LAST] = { 0 };
+    bool have[VIR_PERF_EVENT_LAST] = { false };
+
+    for (i = 0; i < VIR_PERF_EVENT_LAST; i++) {
+        if (!virPerfEventIsEnabled(priv->perf, i))
+             continue;
+
+        if (qemuDomainGetStatsPerfOneEvent(priv->perf, i, params,
+                                           &values[i]) < 0)
+            return -1;
+        have[i] = true;
+    }
+
+    /* metrics derived from the counters since they were enabled */
+    if (have[VIR_PERF_EVENT_INSTRUCTIONS] &&
+        have[VIR_PERF_EVENT_CPU_CYCLES] &&
+        values[VIR_PERF_EVENT_CPU_CYCLES] > 0 &&
+        virTypedParamListAddDouble(params,
+                                   (double) values[VIR_PERF_EVENT_INSTRUCTIONS] /
+                                   values[VIR_PERF_EVENT_CPU_CYCLES],
+                                   "perf.ipc") < 0)
+        return -1;
+
+    if (have[VIR_PERF_EVENT_INSTRUCTIONS] &&
+        have[VIR_PERF_EVENT_CACHE_MISSES] &&
+        values[VIR_PERF_EVENT_INSTRUCTIONS] > 0 &&
+        virTypedParamListAddDouble(params,
+                                   values[VIR_PERF_EVENT_CACHE_MISSES] * 1000.0 /
+                                   values[VIR_PERF_EVENT_INSTRUCTIONS],
+                                   "perf.cache_misses_pki") < 0)
+        return -1;
+
+    if (have[VIR_PERF_EVENT_CPU_CYCLES] &&
+        values[VIR_PERF_EVENT_CPU_CYCLES] > 0) {
+        if (have[VIR_PERF_EVENT_STALLED_CYCLES_FRONTEND] &&
+            virTypedParamListAddDouble(params,
+                                       (double) values[VIR_PERF_EVENT_STALLED_CYCLES_FRONTEND] /
+                                       values[VIR_PERF_EVENT_CPU_CYCLES],
+                                       "perf.stalled_frontend_ratio") < 0)
+            return -1;
+
+        if (have[VIR_PERF_EVENT_STALLED_CYCLES_BACKEND] &&
+            virTypedParamListAddDouble(params,
+                                       (double) values[VIR_PERF_EVENT_STALLED_CYCLES_BACKEND] /
+                                       values[VIR_PERF_EVENT_CPU_CYCLES],
+                                       "perf.stalled_backend_ratio") < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+typedef int
+(*qemuDomainGetStatsFunc)(virQEMUDriverPtr driver,
+                          virDomainObjPtr dom,
+                          virTypedParamListPtr list,
+                          unsigned int flags,
+                          qemuDomainGetStatsSweepPtr sweep);
+
+struct qemuDomainGetStatsWorker {
+    qemuDomainGetStatsFunc func;
+    unsigned int stats;
+    bool monitor;
+};
+
+static struct qemuDomainGetStatsWorker qemuDomainGetStatsWorkers[] = {
+    { qemuDomainGetStatsState, VIR_DOMAIN_STATS_STATE, false },
+    { qemuDomainGetStatsCpu, VIR_DOMAIN_STATS_CPU_TOTAL, false },
+    { qemuDomainGetStatsBalloon, VIR_DOMAIN_STATS_BALLOON, true },
+    { qemuDomainGetStatsVcpu, VIR_DOMAIN_STATS_VCPU, true },
+    { qemuDomainGetStatsInterface, VIR_DOMAIN_STATS_INTERFACE, false },
+    { qemuDomainGetStatsBlock, VIR_DOMAIN_STATS_BLOCK, true },
+    { qemuDomainGetStatsPerf, VIR_DOMAIN_STATS_PERF, false },
+    { qemuDomainGetStatsIOThread, VIR_DOMAIN_STATS_IOTHREAD, true },
+    { qemuDomainGetStatsMemory, VIR_DOMAIN_STATS_MEMORY, false },
+    { qemuDomainGetStatsMonitor, VIR_DOMAIN_STATS_MONITOR, false },
+    { qemuDomainGetStatsPressure, VIR_DOMAIN_STATS_PRESSURE, false },
+    { qemuDomainGetStatsDefinition, VIR_DOMAIN_STATS_DEFINITION, false },
+    { NULL, 0, false }
+};
+
+
+static int
+qemuDomainGetStatsCheckSupport(unsigned int *stats,
+                               bool enforce)
+{
+    unsigned int supportedstats = 0;
+    size_t i;
+
+    for (i = 0; qemuDomainGetStatsWorkers[i].func; i++)
+        supportedstats |= qemuDomainGetStatsWorkers[i].stats;
+
+    if (*stats == 0) {
+        *stats = supportedstats;
+        return 0;
+    }
+
+    if (enforce &&
+        *stats & ~supportedstats) {
+        virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED,
+                       _("Stats types bits 0x%x are not supported by this daemon"),
+                       *stats & ~supportedstats);
+        return -1;
+    }
+
+    *stats &= supportedstats;
+    return 0;
+}
+
+
+static bool
+qemuDomainGetStatsNeedMonitor(unsigned int stats)
+{
+    size_t i;
+
+    for (i = 0; qemuDomainGetStatsWorkers[i].func; i++)
+        if (stats & qemuDomainGetStatsWorkers[i].stats &&
+            qemuDomainGetStatsWorkers[i].monitor)
+            return true;
+
+    return false;
+}
+
+
+/**
+ * qemuDomainGetStatsCacheValid:
+ * @dom: domain object
+ * @stats: requested stats groups
+ * @flags: qemuDomainStatsFlags
+ * @maxAge: maximum age of cached data in microseconds
+ *
+ * Returns true if all groups of @stats requiring the monitor can be reported
+ * from the cache.
+ */
+static bool
+qemuDomainGetStatsCacheValid(virDomainObjPtr dom,
+                             unsigned int stats,
+                             unsigned int flags,
+                             long long maxAge)
+{
+    qemuDomainObjPrivatePtr priv = dom->privateData;
+    size_t i;
+
+    for (i = 0; qemuDomainGetStatsWorkers[i].func; i++) {
+        if (!(stats & qemuDomainGetStatsWorkers[i].stats) ||
+            !qemuDomainGetStatsWorkers[i].monitor)
+            continue;
+
+        if (!qemuDomainStatsCacheLookup(priv, qemuDomainGetStatsWorkers[i].stats,
+                                        flags & QEMU_DOMAIN_STATS_BACKING,
+                                        maxAge))
+            return false;
+    }
+
+    return true;
+}
+
+
+static int
+qemuDomainGetStatsParams(virQEMUDriverPtr driver,
+                         virDomainObjPtr dom,
+                         unsigned int stats,
+                         virTypedParamListPtr params,
+                         unsigned int flags,
+                         qemuDomainGetStatsSweepPtr sweep)
+{
+    qemuDomainObjPrivatePtr priv = dom->privateData;
+    unsigned int cacheflags = flags & QEMU_DOMAIN_STATS_BACKING;
+    size_t i;
+
+    for (i = 0; qemuDomainGetStatsWorkers[i].func; i++) {
+        struct qemuDomainGetStatsWorker *worker = qemuDomainGetStatsWorkers + i;
+        qemuDomainStatsCacheEntryPtr entry;
+        size_t npar = params->npar;
+
+        if (!(stats & worker->stats))
+            continue;
+
+        if (worker->monitor && flags & QEMU_DOMAIN_STATS_CACHED &&
+            (entry = qemuDomainStatsCacheLookup(priv, worker->stats,
+                                                cacheflags, 0))) {
+            if (virTypedParamListAddParams(params, entry->params,
+                                           entry->nparams) < 0)
+                return -1;
+            continue;
+        }
+
+        if (worker->func(driver, dom, params, flags, sweep) < 0)
+            return -1;
+
+        /* only complete data gathered with the job is worth caching; it's
+         * cached even if stats_cache_timeout is disabled so that callers
+         * waiting for this job can share it */
+        if (worker->monitor && HAVE_JOB(flags) &&
+            qemuDomainStatsCacheStore(priv, worker->stats, cacheflags,
+                                      params->par + npar,
+                                      params->npar - npar) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+qemuDomainGetStats(virConnectPtr conn,
+                   virDomainObjPtr dom,
+                   unsigned int stats,
+                   virDomainStatsRecordPtr *record,
+                   unsigned int flags,
+                   qemuDomainGetStatsSweepPtr sweep)
+{
+    qemuDomainObjPrivatePtr priv = dom->privateData;
+    g_autofree virDomainStatsRecordPtr tmp = NULL;
+    g_autoptr(virTypedParamList) params = NULL;
+
+    if (VIR_ALLOC(params) < 0)
+        return -1;
+
+    virTypedParamListReserve(params, priv->statsParamsHint);
+
+    if (qemuDomainGetStatsParams(conn->privateData, dom, stats, params,
+                                 flags, sweep) < 0)
+        return -1;
+
+    priv->statsParamsHint = params->npar;
+
+    if (VIR_ALLOC(tmp) < 0)
+        return -1;
+
+    if (!(tmp->dom = virGetDomain(conn, dom->def->name,
+                                  dom->def->uuid, dom->def->id)))
+        return -1;
+
+    tmp->nparams = virTypedParamListStealParams(params, &tmp->params);
+    *record = g_steal_pointer(&tmp);
+    return 0;
+}
+
+
+/**
+ * qemuDomainGetStatsShare:
+ * @vm: locked domain object
+ * @stats: requested stats groups
+ * @flags: qemuDomainStatsFlags
+ *
+ * The job needed for gathering stats serializes all callers asking for them.
+ * If the current job is already gathering every monitor group of @stats,
+ * waits for it to finish and shares the result it cached instead of
+ * queueing for another job doing the same.
+ *
+ * Returns true if @stats can be reported from the cache.
+ */
+static bool
+qemuDomainGetStatsShare(virDomainObjPtr vm,
+                        unsigned int stats,
+                        unsigned int flags)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    long long started = priv->statsGatheringStart;
+    size_t i;
+
+    if (!priv->statsGathering ||
+        priv->statsGatheringFlags != (flags & QEMU_DOMAIN_STATS_BACKING))
+        return false;
+
+    for (i = 0; qemuDomainGetStatsWorkers[i].func; i++) {
+        if (stats & qemuDomainGetStatsWorkers[i].stats &&
+            qemuDomainGetStatsWorkers[i].monitor &&
+            !(priv->statsGathering & qemuDomainGetStatsWorkers[i].stats))
+            return false;
+    }
+
+    VIR_DEBUG("Waiting for stats of domain %s being gathered", vm->def->name);
+
+    if (qemuDomainObjWaitJobEnd(vm, priv->job.seq) < 0)
+        return false;
+
+    /* only accept data gathered by the job we waited for or a later one */
+    return qemuDomainGetStatsCacheValid(vm, stats, flags,
+                                        MAX(g_get_monotonic_time() - started,
+                                            1));
+}
+
+
+/**
+ * qemuDomainGetStatsBeginJob:
+ * @driver: qemu driver
+ * @vm: locked domain object
+ * @stats: requested stats groups
+ * @flags: virConnectGetAllDomainStatsFlags
+ * @privflags: QEMU_DOMAIN_STATS_HAVE_JOB if the job is needed
+ *
+ * Acquires the job for gathering @stats of @vm unless the stats can be
+ * served from the cache.
+ *
+ * Returns qemuDomainStatsFlags to gather the stats with.
+ */
+static unsigned int
+qemuDomainGetStatsBeginJob(virQEMUDriverPtr driver,
+                           virDomainObjPtr vm,
+                           unsigned int stats,
+                           unsigned int flags,
+                           unsigned int privflags)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    unsigned int domflags = 0;
+
+    if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
+        domflags |= QEMU_DOMAIN_STATS_BACKING;
+
+    if (HAVE_JOB(privflags) && cfg->statsCacheTimeout > 0 &&
+        qemuDomainGetStatsCacheValid(vm, stats, domflags,
+                                     cfg->statsCacheTimeout * G_USEC_PER_SEC)) {
+        domflags |= QEMU_DOMAIN_STATS_CACHED;
+    } else if (HAVE_JOB(privflags) &&
+               !(flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT) &&
+               qemuDomainGetStatsShare(vm, stats, domflags)) {
+        domflags |= QEMU_DOMAIN_STATS_CACHED;
+    } else if (HAVE_JOB(privflags)) {
+        int rv;
+
+        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT)
+            rv = qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_QUERY);
+        else
+            rv = qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY);
+
+        if (rv == 0) {
+            domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+            priv->statsGathering = stats;
+            priv->statsGatheringFlags = domflags & QEMU_DOMAIN_STATS_BACKING;
+            priv->statsGatheringStart = g_get_monotonic_time();
+        }
+    }
+    /* else: without a job it's still possible to gather some data */
+
+    return domflags;
+}
+
+
+static void
+qemuDomainGetStatsEndJob(virQEMUDriverPtr driver,
+                         virDomainObjPtr vm,
+                         unsigned int domflags)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    if (!HAVE_JOB(domflags))
+        return;
+
+    priv->statsGathering = 0;
+    qemuDomainObjEndJob(driver, vm);
+}
+
+
+static int
+qemuDomainGetStatsOne(virConnectPtr conn,
+                      virDomainObjPtr vm,
+                      unsigned int stats,
+                      unsigned int flags,
+                      unsigned int privflags,
+                      qemuDomainGetStatsSweepPtr sweep,
+                      virDomainStatsRecordPtr *record)
+{
+    virQEMUDriverPtr driver = conn->privateData;
+    unsigned int domflags;
+    int ret;
+
+    virObjectLock(vm);
+
+    domflags = qemuDomainGetStatsBeginJob(driver, vm, stats, flags, privflags);
+
+    ret = qemuDomainGetStats(conn, vm, stats, record, domflags, sweep);
+
+    qemuDomainGetStatsEndJob(driver, vm, domflags);
+
+    virObjectUnlock(vm);
+    return ret;
+}
+
+
+static void
+qemuDomainStatsRecordFree(virDomainStatsRecordPtr record)
+{
+    if (!record)
+        return;
+
+    virTypedParamsFree(record->params, record->nparams);
+    virObjectUnref(record->dom);
+    g_free(record);
+}
+
+
+/*
+ * State shared between qemuConnectGetAllDomainStats and the stats pool
+ * workers gathering the records of individual domains. The caller may
+ * stop waiting for workers when the stats timeout expires, thus the
+ * object is reference counted and results arriving afterwards are
+ * discarded.
+ */
+typedef struct _qemuDomainGetStatsCollector qemuDomainGetStatsCollector;
+typedef qemuDomainGetStatsCollector *qemuDomainGetStatsCollectorPtr;
+struct _qemuDomainGetStatsCollector {
+    virObjectLockable parent;
+
+    virCond cond;
+
+    virConnectPtr conn;
+    unsigned int stats;
+    unsigned int flags;
+    unsigned int privflags;
+    qemuDomainGetStatsSweep sweep;
+
+    size_t nvms;
+    virDomainObjPtr *vms;
+    virDomainStatsRecordPtr *records;
+    bool *done; /* record was gathered or the caller stopped waiting */
+    size_t nremaining;
+
+    virErrorPtr error; /* first error reported by a worker */
+};
+
+typedef struct _qemuDomainGetStatsCollectorJob qemuDomainGetStatsCollectorJob;
+typedef qemuDomainGetStatsCollectorJob *qemuDomainGetStatsCollectorJobPtr;
+struct _qemuDomainGetStatsCollectorJob {
+    qemuDomainGetStatsCollectorPtr collector;
+    size_t idx;
+};
+
+static virClassPtr qemuDomainGetStatsCollectorClass;
+
+static void
+qemuDomainGetStatsCollectorDispose(void *obj)
+{
+    qemuDomainGetStatsCollectorPtr collector = obj;
+    size_t i;
+
+    for (i = 0; i < collector->nvms; i++)
+        qemuDomainStatsRecordFree(collector->records[i]);
+    g_free(collector->records);
+    g_free(collector->done);
+    virObjectListFreeCount(collector->vms, collector->nvms);
+    virObjectUnref(collector->conn);
+    virFreeError(collector->error);
+    qemuDomainGetStatsSweepClear(&collector->sweep);
+    virCondDestroy(&collector->cond);
+}
+
+
+static int
+qemuDomainGetStatsCollectorOnceInit(void)
+{
+    if (!VIR_CLASS_NEW(qemuDomainGetStatsCollector, virClassForObjectLockable()))
+        return -1;
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(qemuDomainGetStatsCollector);
+
+
+static qemuDomainGetStatsCollectorPtr
+qemuDomainGetStatsCollectorNew(virConnectPtr conn,
+                               virDomainObjPtr *vms,
+                               size_t nvms,
+                               unsigned int stats,
+                               unsigned int flags,
+                               unsigned int privflags)
+{
+    qemuDomainGetStatsCollectorPtr collector;
+    size_t i;
+
+    if (qemuDomainGetStatsCollectorInitialize() < 0)
+        return NULL;
+
+    if (!(collector = virObjectLockableNew(qemuDomainGetStatsCollectorClass)))
+        return NULL;
+
+    if (virCondInit(&collector->cond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot initialize condition variable"));
+        virObjectUnref(collector);
+        return NULL;
+    }
+
+    if (qemuDomainGetStatsSweepInit(&collector->sweep) < 0) {
+        virCondDestroy(&collector->cond);
+        virObjectUnref(collector);
+        return NULL;
+    }
+
+    collector->conn = virObjectRef(conn);
+    collector->stats = stats;
+    collector->flags = flags;
+    collector->privflags = privflags;
+
+    collector->vms = g_new0(virDomainObjPtr, nvms);
+    for (i = 0; i < nvms; i++)
+        collector->vms[i] = virObjectRef(vms[i]);
+    collector->nvms = nvms;
+
+    collector->records = g_new0(virDomainStatsRecordPtr, nvms);
+    collector->done = g_new0(bool, nvms);
+    collector->nremaining = nvms;
+
+    return collector;
+}
+
+
+static void
+qemuDomainGetStatsWorkerHandler(void *data,
+                                void *opaque G_GNUC_UNUSED)
+{
+    g_autofree qemuDomainGetStatsCollectorJobPtr job = data;
+    qemuDomainGetStatsCollectorPtr collector = job->collector;
+    virDomainStatsRecordPtr record = NULL;
+    bool abandoned;
+    int rc = 0;
+
+    virObjectLock(collector);
+    abandoned = collector->done[job->idx];
+    virObjectUnlock(collector);
+
+    if (!abandoned)
+        rc = qemuDomainGetStatsOne(collector->conn, collector->vms[job->idx],
+                                   collector->stats, collector->flags,
+                                   collector->privflags, &collector->sweep,
+                                   &record);
+
+    virObjectLock(collector);
+    if (rc < 0 && !collector->error)
+        collector->error = virSaveLastError();
+
+    if (!collector->done[job->idx]) {
+        collector->records[job->idx] = g_steal_pointer(&record);
+        collector->done[job->idx] = true;
+        collector->nremaining--;
+        virCondSignal(&collector->cond);
+    }
+    virObjectUnlock(collector);
+
+    qemuDomainStatsRecordFree(record);
+    virObjectUnref(collector);
+}
+
+
+/**
+ * qemuDomainGetStatsParallel:
+ *
+ * Gathers stats of @vms concurrently in the stats worker pool. Domains
+ * whose stats are not gathered within stats_timeout get a record containing
+ * only the data which can be obtained without the domain job.
+ *
+ * Returns 0 on success and fills @records in the order of @vms, -1 on error.
+ */
+static int
+qemuDomainGetStatsParallel(virConnectPtr conn,
+                           virDomainObjPtr *vms,
+                           size_t nvms,
+                           unsigned int stats,
+                           unsigned int flags,
+                           unsigned int privflags,
+                           virDomainStatsRecordPtr *records)
+{
+    virQEMUDriverPtr driver = conn->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuDomainGetStatsCollectorPtr collector;
+    g_autofree bool *timedout = NULL;
+    unsigned long long then = 0;
+    size_t i;
+    int ret = -1;
+
+    if (!(collector = qemuDomainGetStatsCollectorNew(conn, vms, nvms, stats,
+                                                     flags, privflags)))
+        return -1;
+
+    timedout = g_new0(bool, nvms);
+
+    if (cfg->statsTimeout > 0) {
+        if (virTimeMillisNow(&then) < 0)
+            goto cleanup;
+        then += cfg->statsTimeout * 1000ull;
+    }
+
+    virObjectLock(collector);
+
+    for (i = 0; i < nvms; i++) {
+        qemuDomainGetStatsCollectorJobPtr job = g_new0(qemuDomainGetStatsCollectorJob, 1);
+
+        job->collector = virObjectRef(collector);
+        job->idx = i;
+
+        if (virThreadPoolSendJob(driver->statsPool, 0, job) < 0) {
+            virObjectUnref(collector);
+            g_free(job);
+
+            /* don't let the workers already queued gather the rest */
+            for (; i < nvms; i++)
+                collector->done[i] = true;
+            virObjectUnlock(collector);
+            goto cleanup;
+        }
+    }
+
+    while (collector->nremaining > 0) {
+        if (then) {
+            if (virCondWaitUntil(&collector->cond, &collector->parent.lock,
+                                 then) < 0) {
+                if (errno == ETIMEDOUT)
+                    break;
+
+                virReportSystemError(errno, "%s",
+                                     _("failed to wait for domain stats"));
+                virObjectUnlock(collector);
+                goto cleanup;
+            }
+        } else if (virCondWait(&collector->cond, &collector->parent.lock) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("failed to wait for domain stats"));
+            virObjectUnlock(collector);
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < nvms; i++) {
+        if (!collector->done[i]) {
+            collector->done[i] = true;
+            timedout[i] = true;
+        }
+        records[i] = g_steal_pointer(&collector->records[i]);
+    }
+
+    if (collector->error) {
+        virSetError(collector->error);
+        virObjectUnlock(collector);
+        goto cleanup;
+    }
+
+    virObjectUnlock(collector);
+
+    /* report at least the data which doesn't need the job for domains
+     * which are stuck */
+    for (i = 0; i < nvms; i++) {
+        if (!timedout[i])
+            continue;
+
+        VIR_WARN("Timed out gathering stats of domain '%s'",
+                 vms[i]->def->name);
+
+        if (qemuDomainGetStatsOne(conn, vms[i], stats, flags, 0,
+                                  &collector->sweep, &records[i]) < 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    if (ret < 0) {
+        for (i = 0; i < nvms; i++) {
+            qemuDomainStatsRecordFree(records[i]);
+            records[i] = NULL;
+        }
+    }
+    virObjectUnref(collector);
+    return ret;
+}
+
+
+static int
+qemuConnectGetAllDomainStats(virConnectPtr conn,
+                             virDomainPtr *doms,
+                             unsigned int ndoms,
+                             unsigned int stats,
+                             virDomainStatsRecordPtr **retStats,
+                             unsigned int flags)
+{
+    virQEMUDriverPtr driver = conn->privateData;
+    virErrorPtr orig_err = NULL;
+    virDomainObjPtr *vms = NULL;
+    size_t nvms;
+    virDomainStatsRecordPtr *tmpstats = NULL;
+    bool enforce = !!(flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS);
+    int nstats = 0;
+    size_t i;
+    int ret = -1;
+    unsigned int privflags = 0;
+    unsigned int lflags = flags & (VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE);
+
+    virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                  VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                  VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
+
+    if (virConnectGetAllDomainStatsEnsureACL(conn) < 0)
+        return -1;
+
+    if (qemuDomainGetStatsCheckSupport(&stats, enforce) < 0)
+        return -1;
+
+    if (ndoms) {
+        if (virDomainObjListConvert(driver->domains, conn, doms, ndoms, &vms,
+                                    &nvms,
+                                    virConnectGetAllDomainStatsCheckACLList,
+                                    lflags, true) < 0)
+            return -1;
+    } else {
+        if (virDomainObjListCollect(driver->domains, conn, &vms, &nvms,
+                                    virConnectGetAllDomainStatsCheckACLList,
+                                    lflags) < 0)
+            return -1;
+    }
+
+    if (VIR_ALLOC_N(tmpstats, nvms + 1) < 0)
+        goto cleanup;
+
+    if (qemuDomainGetStatsNeedMonitor(stats))
+        privflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+
+    if (driver->statsPool && nvms > 1) {
+        if (qemuDomainGetStatsParallel(conn, vms, nvms, stats, flags,
+                                       privflags, tmpstats) < 0)
+            goto cleanup;
+
+        /* keep the records packed at the beginning of the list */
+        for (i = 0; i < nvms; i++) {
+            if (tmpstats[i])
+                tmpstats[nstats++] = tmpstats[i];
+        }
+        for (i = nstats; i < nvms; i++)
+            tmpstats[i] = NULL;
+    } else {
+        qemuDomainGetStatsSweep sweep;
+
+        if (qemuDomainGetStatsSweepInit(&sweep) < 0)
+            goto cleanup;
+
+        for (i = 0; i < nvms; i++) {
+            virDomainStatsRecordPtr tmp = NULL;
+
+            if (qemuDomainGetStatsOne(conn, vms[i], stats, flags, privflags,
+                                      &sweep, &tmp) < 0) {
+                qemuDomainGetStatsSweepClear(&sweep);
+                goto cleanup;
+            }
+
+            if (tmp)
+                tmpstats[nstats++] = tmp;
+        }
+
+        qemuDomainGetStatsSweepClear(&sweep);
+    }
+
+    *retStats = tmpstats;
+    tmpstats = NULL;
+
+    ret = nstats;
+
+ cleanup:
+    virErrorPreserveLast(&orig_err);
+    virDomainStatsRecordListFree(tmpstats);
+    virObjectListFreeCount(vms, nvms);
+    virErrorRestore(&orig_err);
+
+    return ret;
+}
+
+
+/* Gathers the stats of @vm and emits them as an event if @emit is true,
+ * and/or stores them in @record if it's non-NULL */
+static int
+qemuDomainStatsEventGatherOne(virQEMUDriverPtr driver,
+                              virDomainObjPtr vm,
+                              unsigned int stats,
+                              unsigned int privflags,
+                              bool emit,
+                              virStatsShmRecordPtr record)
+{
+    g_autoptr(virTypedParamList) params = g_new0(virTypedParamList, 1);
+    virObjectEventPtr event = NULL;
+    unsigned int domflags;
+    virTypedParameterPtr par = NULL;
+    size_t npar = 0;
+    int ret = -1;
+
+    virObjectLock(vm);
+
+    /* don't let a busy domain delay the events of others */
+    domflags = qemuDomainGetStatsBeginJob(driver, vm, stats,
+                                          VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT,
+                                          privflags);
+
+    if (qemuDomainGetStatsParams(driver, vm, stats, params, domflags,
+                                 NULL) < 0) {
+        VIR_WARN("Unable to gather stats of domain '%s': %s",
+                 vm->def->name, virGetLastErrorMessage());
+        goto endjob;
+    }
+
+    npar = virTypedParamListStealParams(params, &par);
+
+    if (record) {
+        if (emit) {
+            if (virTypedParamsCopy(&record->params, par, npar) < 0)
+                goto endjob;
+        } else {
+            record->params = g_steal_pointer(&par);
+        }
+        record->nparams = npar;
+        record->name = g_strdup(vm->def->name);
+        memcpy(record->uuid, vm->def->uuid, VIR_UUID_BUFLEN);
+    }
+
+    if (emit)
+        event = virDomainEventStatsNewFromObj(vm, g_steal_pointer(&par), npar);
+
+    ret = 0;
+
+ endjob:
+    qemuDomainGetStatsEndJob(driver, vm, domflags);
+
+    virObjectUnlock(vm);
+
+    virTypedParamsFree(par, npar);
+    virObjectEventStateQueue(driver->domainEventState, event);
+
+    return ret;
+}
+
+
+/*
+ * Gathers the stats of all running domains once per stats_event_interval,
+ * delivers them as VIR_DOMAIN_EVENT_ID_STATS events to all subscribers
+ * and publishes them to the shared memory region if stats_shm is set.
+ */
+static void
+qemuDomainStatsEventThread(void *opaque)
+{
+    virQEMUDriverPtr driver = opaque;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    unsigned int stats = cfg->statsEventTypes;
+    unsigned int privflags = 0;
+    unsigned long long then;
+
+    ignore_value(qemuDomainGetStatsCheckSupport(&stats, false));
+
+    if (qemuDomainGetStatsNeedMonitor(stats))
+        privflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+
+    virMutexLock(&driver->lock);
+    while (!driver->statsEventQuit) {
+        virDomainObjPtr *vms = NULL;
+        size_t nvms = 0;
+        g_autofree virStatsShmRecordPtr records = NULL;
+        size_t nrecords = 0;
+        bool emit;
+        size_t i;
+
+        if (virTimeMillisNow(&then) < 0)
+            break;
+        then += cfg->statsEventInterval * 1000ull;
+
+        while (!driver->statsEventQuit &&
+               virCondWaitUntil(&driver->statsEventCond, &driver->lock, then) == 0)
+            ;
+
+        if (driver->statsEventQuit)
+            break;
+
+        virMutexUnlock(&driver->lock);
+
+        emit = virDomainEventStateHasCallbacks(driver->domainEventState,
+                                               VIR_DOMAIN_EVENT_ID_STATS);
+
+        if ((emit || driver->statsShm) &&
+            virDomainObjListCollect(driver->domains, NULL, &vms, &nvms, NULL,
+                                    VIR_CONNECT_LIST_DOMAINS_ACTIVE) == 0) {
+            if (driver->statsShm)
+                records = g_new0(virStatsShmRecord, nvms);
+
+            for (i = 0; i < nvms; i++) {
+                virStatsShmRecordPtr record = NULL;
+
+                if (records)
+                    record = &records[nrecords];
+
+                if (qemuDomainStatsEventGatherOne(driver, vms[i], stats,
+                                                  privflags, emit, record) == 0 &&
+                    record)
+                    nrecords++;
+            }
+
+            virObjectListFreeCount(vms, nvms);
+
+            if (driver->statsShm &&
+                (virTimeMillisNow(&then) < 0 ||
+                 virStatsShmPublish(driver->statsShm, records, nrecords,
+                                    then) < 0)) {
+                VIR_WARN("Unable to publish domain stats: %s",
+                         virGetLastErrorMessage());
+                virResetLastError();
+            }
+
+            for (i = 0; i < nrecords; i++)
+                virStatsShmRecordClear(&records[i]);
+        }
+
+        virMutexLock(&driver->lock);
+    }
+    virMutexUnlock(&driver->lock);
+}
+
+
+static int
+qemuConnectOpenDomainStatsFD(virConnectPtr conn,
+                             unsigned int flags)
+{
+    virQEMUDriverPtr driver = conn->privateData;
+
+    virCheckFlags(0, -1);
+
+    if (virConnectOpenDomainStatsFdEnsureACL(conn) < 0)
+        return -1;
+
+    if (!driver->statsShm) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("publishing of stats to shared memory is not enabled"));
+        return -1;
+    }
+
+    return virStatsShmOpenReader(driver->statsShm);
+}
+
+
+/* Difference of utilization between the busiest and least busy host NUMA
+ * nodes above which domains are moved */
+#define QEMU_NUMA_REBALANCE_THRESHOLD 0.25
+
+typedef struct _qemuNUMARebalanceDomain qemuNUMARebalanceDomain;
+struct _qemuNUMARebalanceDomain {
+    virDomainObjPtr vm;
+    int node;       /* host NUMA node the domain is placed on */
+    double busy;    /* host CPUs used by the domain since the last sample */
+    bool done;
+};
+
+
+static bool
+qemuDomainNUMARebalanceIsMovable(virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    virDomainDefPtr def = vm->def;
+    virDomainNumatuneMemMode mode;
+    size_t i;
+
+    if (def->placement_mode != VIR_DOMAIN_CPU_PLACEMENT_MODE_AUTO ||
+        !virDomainNumatuneHasPlacementAuto(def->numa) ||
+        virDomainNumatuneGetMode(def->numa, -1, &mode) < 0 ||
+        mode != VIR_DOMAIN_NUMATUNE_MEM_STRICT)
+        return false;
+
+    if (!priv->autoNodeset ||
+        virBitmapCountBits(priv->autoNodeset) != 1 ||
+        !virCgroupHasController(priv->cgroup, VIR_CGROUP_CONTROLLER_CPUSET))
+        return false;
+
+    /* QEMU binds memory backends to host nodes itself */
+    if (virDomainNumaGetNodeCount(def->numa) > 0 ||
+        def->nmems > 0 ||
+        def->mem.nhugepages > 0)
+        return false;
+
+    if (def->cputune.emulatorpin)
+        return false;
+
+    for (i = 0; i < virDomainDefGetVcpusMax(def); i++) {
+        if (virDomainDefGetVcpu(def, i)->cpumask)
+            return false;
+    }
+
+    for (i = 0; i < def->niothreadids; i++) {
+        if (def->iothreadids[i]->cpumask)
+            return false;
+    }
+
+    /* keep the domain close to its devices */
+    for (i = 0; i < def->nhostdevs; i++) {
+        virDomainHostdevDefPtr hostdev = def->hostdevs[i];
+
+        if (hostdev->mode == VIR_DOMAIN_HOSTDEV_MODE_SUBSYS &&
+            hostdev->source.subsys.type == VIR_DOMAIN_HOSTDEV_SUBSYS_TYPE_PCI)
+            return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * Move @vm from host NUMA node @from to @to, provided the memory it has
+ * on @from fits into @memfree of @to. Returns 0 if the domain was moved,
+ * -1 otherwise.
+ */
+static int
+qemuDomainNUMARebalanceMove(virQEMUDriverPtr driver,
+                            virQEMUDriverConfigPtr cfg,
+                            virDomainObjPtr vm,
+                            int from,
+                            int to,
+                            unsigned long long *memfree,
+                            unsigned long long now)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    g_autoptr(virCapsHostNUMA) caps = NULL;
+    g_autoptr(virBitmap) nodeset = NULL;
+    g_autoptr(virBitmap) cpuset = NULL;
+    g_autofree unsigned long long *memory = NULL;
+    size_t nmemory = 0;
+    unsigned long long moving;
+    int ret = -1;
+
+    virObjectLock(vm);
+
+    if (qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_MODIFY) < 0) {
+        virResetLastError();
+        virObjectUnlock(vm);
+        return -1;
+    }
+
+    if (!virDomainObjIsActive(vm) ||
+        !qemuDomainNUMARebalanceIsMovable(vm) ||
+        !virBitmapIsBitSet(priv->autoNodeset, from))
+        goto endjob;
+
+    if (virNumaGetProcessMemory(vm->pid, &memory, &nmemory) < 0)
+        goto endjob;
+
+    moving = from < nmemory ? memory[from] : 0;
+    if (moving > *memfree) {
+        VIR_DEBUG("Domain '%s' has %llu KiB on node %d, node %d has only "
+                  "%llu KiB free", vm->def->name, moving, from, to, *memfree);
+        goto endjob;
+    }
+
+    if (!(caps = virQEMUDriverGetHostNUMACaps(driver)) ||
+        !(nodeset = virBitmapNew(to + 1)) ||
+        virBitmapSetBit(nodeset, to) < 0 ||
+        !(cpuset = virCapabilitiesHostNUMAGetCpus(caps, nodeset)))
+        goto endjob;
+
+    VIR_INFO("Moving domain '%s' from host NUMA node %d to %d",
+             vm->def->name, from, to);
+
+    if (qemuCgroupUpdateAutoPlacement(vm, nodeset, cpuset) < 0) {
+        VIR_WARN("Unable to move domain '%s' to host NUMA node %d: %s",
+                 vm->def->name, to, virGetLastErrorMessage());
+        /* put back the threads which were moved already */
+        ignore_value(qemuCgroupUpdateAutoPlacement(vm, priv->autoNodeset,
+                                                   priv->autoCpuset));
+        goto endjob;
+    }
+
+    qemuDomainNUMALoadRelease(driver, vm);
+    virBitmapFree(priv->autoNodeset);
+    priv->autoNodeset = g_steal_pointer(&nodeset);
+    virBitmapFree(priv->autoCpuset);
+    priv->autoCpuset = g_steal_pointer(&cpuset);
+    qemuDomainNUMALoadCharge(driver, vm);
+
+    priv->numaMoved = now;
+    *memfree -= moving;
+
+    if (virDomainObjSave(vm, driver->xmlopt, cfg->stateDir) < 0)
+        VIR_WARN("Unable to save status of domain '%s'", vm->def->name);
+
+    ret = 0;
+
+ endjob:
+    qemuDomainObjEndJob(driver, vm);
+    virObjectUnlock(vm);
+    virResetLastError();
+    return ret;
+}
+
+
+static void
+qemuDomainNUMARebalance(virQEMUDriverPtr driver,
+                        virQEMUDriverConfigPtr cfg)
+{
+    virDomainObjPtr *vms = NULL;
+    size_t nvms = 0;
+    g_autofree virNumaPlacementNodePtr nodes = NULL;
+    size_t nnodes = 0;
+    g_autofree double *busy = NULL;
+    g_autofree qemuNUMARebalanceDomain *doms = NULL;
+    size_t ndoms = 0;
+    unsigned int moves = 0;
+    unsigned long long now;
+    size_t i;
+    size_t j;
+
+    if (virTimeMillisNow(&now) < 0 ||
+        virNumaGetPlacementNodes(0, &nodes, &nnodes) < 0) {
+        VIR_WARN("Unable to get host NUMA nodes: %s", virGetLastErrorMessage());
+        virResetLastError();
+        return;
+    }
+
+    if (virDomainObjListCollect(driver->domains, NULL, &vms, &nvms, NULL,
+                                VIR_CONNECT_LIST_DOMAINS_ACTIVE) < 0) {
+        virResetLastError();
+        return;
+    }
+
+    busy = g_new0(double, nnodes);
+    doms = g_new0(qemuNUMARebalanceDomain, nvms);
+
+    /* Sample the CPU usage of automatically placed domains and account it
+     * to their nodes */
+    for (i = 0; i < nvms; i++) {
+        virDomainObjPtr vm = vms[i];
+        qemuDomainObjPrivatePtr priv = vm->privateData;
+        unsigned long long cputime;
+        double used = -1;
+        size_t nodecount;
+
+        virObjectLock(vm);
+
+        if (!virDomainObjIsActive(vm) ||
+            !priv->autoNodeset ||
+            !(nodecount = virBitmapCountBits(priv->autoNodeset)) ||
+            virCgroupGetCpuacctUsage(priv->cgroup, &cputime) < 0) {
+            virResetLastError();
+            virObjectUnlock(vm);
+            continue;
+        }
+
+        if (priv->numaSampled > 0 && now > priv->numaSampled &&
+            cputime >= priv->numaCpuTime)
+            used = (cputime - priv->numaCpuTime) /
+                   ((now - priv->numaSampled) * 1000.0 * 1000.0);
+
+        priv->numaCpuTime = cputime;
+        priv->numaSampled = now;
+
+        if (used >= 0) {
+            for (j = 0; j < nnodes; j++) {
+                if (virBitmapIsBitSet(priv->autoNodeset, nodes[j].node))
+                    busy[j] += used / nodecount;
+            }
+
+            if (qemuDomainNUMARebalanceIsMovable(vm) &&
+                now - priv->numaMoved >= cfg->numaRebalanceHoldoff * 1000ull) {
+                doms[ndoms].vm = vm;
+                doms[ndoms].node = virBitmapNextSetBit(priv->autoNodeset, -1);
+                doms[ndoms].busy = used;
+                ndoms++;
+            }
+        }
+
+        virObjectUnlock(vm);
+    }
+
+    while (moves < cfg->numaRebalanceMaxMoves) {
+        ssize_t hot = -1;
+        ssize_t cold = -1;
+        ssize_t best = -1;
+        double hotUtil = 0;
+        double coldUtil = 0;
+        double bestGap = 0;
+
+        for (j = 0; j < nnodes; j++) {
+            double util;
+
+            if (nodes[j].ncpus == 0)
+                continue;
+
+            util = busy[j] / nodes[j].ncpus;
+            if (hot < 0 || util > hotUtil) {
+                hot = j;
+                hotUtil = util;
+            }
+            if (cold < 0 || util < coldUtil) {
+                cold = j;
+                coldUtil = util;
+            }
+        }
+
+        if (hot < 0 || hot == cold ||
+            hotUtil - coldUtil < QEMU_NUMA_REBALANCE_THRESHOLD)
+            break;
+
+        /* pick the domain evening out the two nodes the most without
+         * making the target node the new hot spot */
+        for (i = 0; i < ndoms; i++) {
+            double newHot;
+            double newCold;
+            double gap;
+
+            if (doms[i].done ||
+                doms[i].node != nodes[hot].node ||
+                doms[i].busy <= 0)
+                continue;
+
+            newHot = hotUtil - doms[i].busy / nodes[hot].ncpus;
+            newCold = coldUtil + doms[i].busy / nodes[cold].ncpus;
+            if (newCold >= hotUtil)
+                continue;
+
+            gap = newHot > newCold ? newHot - newCold : newCold - newHot;
+            if (best < 0 || gap < bestGap) {
+                best = i;
+                bestGap = gap;
+            }
+        }
+
+        if (best < 0)
+            break;
+
+        doms[best].done = true;
+
+        if (qemuDomainNUMARebalanceMove(driver, cfg, doms[best].vm,
+                                        nodes[hot].node, nodes[cold].node,
+                                        &nodes[cold].memfree, now) < 0)
+            continue;
+
+        busy[hot] -= doms[best].busy;
+        busy[cold] += doms[best].busy;
+        moves++;
+    }
+
+    virObjectListFreeCount(vms, nvms);
+}
+
+
+/*
+ * Rebalances automatically placed domains between host NUMA nodes once
+ * per numa_rebalance_interval.
+ */
+static void
+qemuDomainNUMARebalanceThread(void *opaque)
+{
+    virQEMUDriverPtr driver = opaque;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    unsigned long long then;
+
+    virMutexLock(&driver->lock);
+    while (!driver->numaRebalanceQuit) {
+        if (virTimeMillisNow(&then) < 0)
+            break;
+        then += cfg->numaRebalanceInterval * 1000ull;
+
+        while (!driver->numaRebalanceQuit &&
+               virCondWaitUntil(&driver->numaRebalanceCond, &driver->lock, then) == 0)
+            ;
+
+        if (driver->numaRebalanceQuit)
+            break;
+
+        virMutexUnlock(&driver->lock);
+        qemuDomainNUMARebalance(driver, cfg);
+        virMutexLock(&driver->lock);
+    }
+    virMutexUnlock(&driver->lock);
+}
+
+
+/* Fraction of resctrl_bandwidth_limit below which throttled memory
+ * bandwidth allocations get their bandwidth back */
+#define QEMU_RESCTRL_RELEASE_THRESHOLD 0.8
+
+typedef struct _qemuResctrlControlDomain qemuResctrlControlDomain;
+struct _qemuResctrlControlDomain {
+    virDomainObjPtr vm;
+    size_t resctrl;         /* index into def->resctrls */
+    unsigned int node;      /* host memory bandwidth node id */
+    unsigned int bandwidth; /* currently applied bandwidth */
+    unsigned int minimum;   /* min_bandwidth of the allocation */
+    unsigned int maximum;   /* configured bandwidth of the allocation */
+    double rate;            /* MiB/s used since the last sample */
+};
+
+struct qemuResctrlControlSampleData {
+    virDomainObjPtr vm;
+    size_t resctrl;
+    virResctrlAllocPtr alloc;
+    qemuResctrlControlDomain **doms;
+    size_t *ndoms;
+};
+
+
+static qemuDomainResctrlControlPtr
+qemuDomainResctrlControlGet(qemuDomainObjPrivatePtr priv,
+                            size_t resctrl,
+                            unsigned int node,
+                            bool create)
+{
+    size_t i;
+
+    for (i = 0; i < priv->nresctrlControl; i++) {
+        if (priv->resctrlControl[i].resctrl == resctrl &&
+            priv->resctrlControl[i].node == node)
+            return &priv->resctrlControl[i];
+    }
+
+    if (!create ||
+        VIR_EXPAND_N(priv->resctrlControl, priv->nresctrlControl, 1) < 0)
+        return NULL;
+
+    priv->resctrlControl[i].resctrl = resctrl;
+    priv->resctrlControl[i].node = node;
+    return &priv->resctrlControl[i];
+}
+
+
+/*
+ * Sum up mbm_total_bytes of the memory bandwidth monitors of @resctrl per
+ * host node id. The default monitor covers the whole allocation, if there
+ * is none the remaining monitors are disjoint.
+ */
+static int
+qemuDomainResctrlControlGetBytes(virDomainResctrlDefPtr resctrl,
+                                 unsigned long long **bytes,
+                                 size_t *nbytes)
+{
+    const char *features[] = { "mbm_total_bytes", NULL };
+    ssize_t only = -1;
+    size_t i;
+    size_t j;
+    int ret = -1;
+
+    for (i = 0; i < resctrl->nmonitors; i++) {
+        if (resctrl->monitors[i]->tag == VIR_RESCTRL_MONITOR_TYPE_MEMBW &&
+            virBitmapEqual(resctrl->monitors[i]->vcpus, resctrl->vcpus)) {
+            only = i;
+            break;
+        }
+    }
+
+    for (i = 0; i < resctrl->nmonitors; i++) {
+        virDomainResctrlMonDefPtr domresmon = resctrl->monitors[i];
+        virResctrlMonitorStatsPtr *stats = NULL;
+        size_t nstats = 0;
+
+        if (domresmon->tag != VIR_RESCTRL_MONITOR_TYPE_MEMBW ||
+            (only >= 0 && i != only))
+            continue;
+
+        if (virResctrlMonitorGetStats(domresmon->instance, features,
+                                      &stats, &nstats) < 0)
+            goto cleanup;
+
+        for (j = 0; j < nstats; j++) {
+            if (stats[j]->nvals == 0)
+                continue;
+
+            if (*nbytes <= stats[j]->id &&
+                VIR_EXPAND_N(*bytes, *nbytes, stats[j]->id - *nbytes + 1) < 0)
+                break;
+
+            (*bytes)[stats[j]->id] += stats[j]->vals[0];
+        }
+
+        for (j = 0; j < nstats; j++)
+            virResctrlMonitorStatsFree(stats[j]);
+        VIR_FREE(stats);
+    }
+
+    ret = 0;
+ cleanup:
+    return ret;
+}
+
+
+static int
+qemuDomainResctrlControlAddNode(unsigned int id,
+                                unsigned int bandwidth,
+                                void *opaque)
+{
+    struct qemuResctrlControlSampleData *data = opaque;
+    qemuDomainResctrlControlPtr ctl;
+    qemuResctrlControlDomain dom = { 0 };
+    unsigned int minimum;
+
+    if (!(minimum = virResctrlAllocGetMemoryBandwidthMin(data->alloc, id)))
+        return 0;
+
+    if (!(ctl = qemuDomainResctrlControlGet(data->vm->privateData,
+                                            data->resctrl, id, true)))
+        return -1;
+
+    if (ctl->bandwidth == 0 || ctl->bandwidth > bandwidth)
+        ctl->bandwidth = bandwidth;
+
+    dom.vm = data->vm;
+    dom.resctrl = data->resctrl;
+    dom.node = id;
+    dom.bandwidth = ctl->bandwidth;
+    dom.minimum = minimum;
+    dom.maximum = bandwidth;
+    dom.rate = ctl->rate;
+
+    return VIR_APPEND_ELEMENT(*data->doms, *data->ndoms, dom);
+}
+
+
+/*
+ * Sample the memory bandwidth used by the allocations of @vm, add it to
+ * @usage indexed by host node id and append the adjustable allocations
+ * to @doms.
+ */
+static void
+qemuDomainResctrlControlSample(virDomainObjPtr vm,
+                               unsigned long long now,
+                               double **usage,
+                               size_t *nusage,
+                               qemuResctrlControlDomain **doms,
+                               size_t *ndoms)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < vm->def->nresctrls; i++) {
+        virDomainResctrlDefPtr resctrl = vm->def->resctrls[i];
+        struct qemuResctrlControlSampleData data = { vm, i, resctrl->alloc,
+                                                     doms, ndoms };
+        g_autofree unsigned long long *bytes = NULL;
+        size_t nbytes = 0;
+
+        if (qemuDomainResctrlControlGetBytes(resctrl, &bytes, &nbytes) < 0) {
+            VIR_DEBUG("Unable to sample memory bandwidth of domain '%s': %s",
+                      vm->def->name, virGetLastErrorMessage());
+            virResetLastError();
+            nbytes = 0;
+        }
+
+        for (j = 0; j < nbytes; j++) {
+            qemuDomainResctrlControlPtr ctl;
+
+            if (!(ctl = qemuDomainResctrlControlGet(priv, i, j, true)))
+                break;
+
+            ctl->rate = 0;
+            if (ctl->sampled > 0 && now > ctl->sampled &&
+                bytes[j] >= ctl->bytes)
+                ctl->rate = (bytes[j] - ctl->bytes) /
+                            ((now - ctl->sampled) / 1000.0) / (1024 * 1024);
+
+            ctl->bytes = bytes[j];
+            ctl->sampled = now;
+
+            if (*nusage <= j &&
+                VIR_EXPAND_N(*usage, *nusage, j - *nusage + 1) < 0)
+                break;
+            (*usage)[j] += ctl->rate;
+        }
+
+        if (virResctrlAllocForeachMemory(resctrl->alloc,
+                                         qemuDomainResctrlControlAddNode,
+                                         &data) < 0)
+            virResetLastError();
+    }
+}
+
+
+static void
+qemuDomainResctrlControlApply(virQEMUDriverPtr driver,
+                              qemuResctrlControlDomain *dom,
+                              unsigned int bandwidth)
+{
+    virDomainObjPtr vm = dom->vm;
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    virDomainResctrlDefPtr resctrl;
+    qemuDomainResctrlControlPtr ctl;
+    virObjectEventPtr event = NULL;
+    virTypedParameterPtr eventParams = NULL;
+    int eventNparams = 0;
+    int eventMaxparams = 0;
+    char paramField[VIR_TYPED_PARAM_FIELD_LENGTH] = "";
+
+    virObjectLock(vm);
+
+    if (qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_MODIFY) < 0) {
+        virResetLastError();
+        virObjectUnlock(vm);
+        return;
+    }
+
+    if (!virDomainObjIsActive(vm) ||
+        dom->resctrl >= vm->def->nresctrls ||
+        !(ctl = qemuDomainResctrlControlGet(priv, dom->resctrl,
+                                            dom->node, false)))
+        goto endjob;
+
+    resctrl = vm->def->resctrls[dom->resctrl];
+
+    VIR_INFO("Changing memory bandwidth of allocation '%s' of domain '%s' "
+             "on node %u from %u%% to %u%%",
+             virResctrlAllocGetID(resctrl->alloc), vm->def->name,
+             dom->node, ctl->bandwidth, bandwidth);
+
+    if (virResctrlAllocApplyMemoryBandwidth(resctrl->alloc, dom->node,
+                                            bandwidth) < 0) {
+        VIR_WARN("Unable to change memory bandwidth of domain '%s': %s",
+                 vm->def->name, virGetLastErrorMessage());
+        goto endjob;
+    }
+
+    ctl->bandwidth = bandwidth;
+
+    if (g_snprintf(paramField, VIR_TYPED_PARAM_FIELD_LENGTH,
+                   VIR_DOMAIN_TUNABLE_CPU_MEMORYTUNE_BANDWIDTH,
+                   virResctrlAllocGetID(resctrl->alloc), dom->node) < 0)
+        goto endjob;
+
+    if (virTypedParamsAddUInt(&eventParams, &eventNparams,
+                              &eventMaxparams, paramField, bandwidth) < 0)
+        goto endjob;
+
+    event = virDomainEventTunableNewFromObj(vm, eventParams, eventNparams);
+
+ endjob:
+    qemuDomainObjEndJob(driver, vm);
+    virObjectUnlock(vm);
+    virObjectEventStateQueue(driver->domainEventState, event);
+    virResetLastError();
+}
+
+
+static void
+qemuDomainResctrlControlAdjust(virQEMUDriverPtr driver,
+                               virQEMUDriverConfigPtr cfg)
+{
+    g_autoptr(virCaps) caps = NULL;
+    virDomainObjPtr *vms = NULL;
+    size_t nvms = 0;
+    g_autofree double *usage = NULL;
+    size_t nusage = 0;
+    g_autofree qemuResctrlControlDomain *doms = NULL;
+    size_t ndoms = 0;
+    unsigned long long now;
+    size_t i;
+    size_t j;
+
+    if (!(caps = virQEMUDriverGetCapabilities(driver, false)) ||
+        virTimeMillisNow(&now) < 0) {
+        virResetLastError();
+        return;
+    }
+
+    if (caps->host.memBW.nnodes == 0)
+        return;
+
+    if (virDomainObjListCollect(driver->domains, NULL, &vms, &nvms, NULL,
+                                VIR_CONNECT_LIST_DOMAINS_ACTIVE) < 0) {
+        virResetLastError();
+        return;
+    }
+
+    for (i = 0; i < nvms; i++) {
+        virObjectLock(vms[i]);
+        if (virDomainObjIsActive(vms[i]))
+            qemuDomainResctrlControlSample(vms[i], now, &usage, &nusage,
+                                           &doms, &ndoms);
+        virObjectUnlock(vms[i]);
+    }
+
+    /* change at most one allocation per node and interval */
+    for (i = 0; i < caps->host.memBW.nnodes; i++) {
+        virCapsHostMemBWNodePtr node = caps->host.memBW.nodes[i];
+        unsigned int granularity = MAX(node->control.granularity, 1);
+        unsigned int step = VIR_DIV_UP(cfg->resctrlControlStep,
+                                       granularity) * granularity;
+        double used = node->id < nusage ? usage[node->id] : 0;
+        ssize_t best = -1;
+        unsigned int bandwidth;
+
+        if (used > cfg->resctrlBandwidthLimit) {
+            /* throttle the allocation using the most bandwidth */
+            for (j = 0; j < ndoms; j++) {
+                if (doms[j].node != node->id ||
+                    doms[j].bandwidth <= doms[j].minimum)
+                    continue;
+
+                if (best < 0 || doms[j].rate > doms[best].rate)
+                    best = j;
+            }
+
+            if (best < 0)
+                continue;
+
+            if (doms[best].bandwidth > doms[best].minimum + step)
+                bandwidth = doms[best].bandwidth - step;
+            else
+                bandwidth = doms[best].minimum;
+        } else if (used < cfg->resctrlBandwidthLimit *
+                          QEMU_RESCTRL_RELEASE_THRESHOLD) {
+            /* give bandwidth back to the most throttled allocation */
+            for (j = 0; j < ndoms; j++) {
+                if (doms[j].node != node->id ||
+                    doms[j].bandwidth >= doms[j].maximum)
+                    continue;
+
+                if (best < 0 ||
+                    (double) doms[j].bandwidth / doms[j].maximum <
+                    (double) doms[best].bandwidth / doms[best].maximum)
+                    best = j;
+            }
+
+            if (best < 0)
+                continue;
+
+            bandwidth = MIN(doms[best].bandwidth + step, doms[best].maximum);
+        } else {
+            continue;
+        }
+
+        VIR_DEBUG("Host memory bandwidth node %u uses %.0f MiB/s, limit "
+                  "%u MiB/s", node->id, used, cfg->resctrlBandwidthLimit);
+
+        qemuDomainResctrlControlApply(driver, &doms[best], bandwidth);
+    }
+
+    virObjectListFreeCount(vms, nvms);
+}
+
+
+/*
+ * Adjusts memory bandwidth allocations with min_bandwidth set to the
+ * bandwidth used on each host node once per resctrl_control_interval.
+ */
+static void
+qemuDomainResctrlControlThread(void *opaque)
+{
+    virQEMUDriverPtr driver = opaque;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    unsigned long long then;
+
+    virMutexLock(&driver->lock);
+    while (!driver->resctrlControlQuit) {
+        if (virTimeMillisNow(&then) < 0)
+            break;
+        then += cfg->resctrlControlInterval * 1000ull;
+
+        while (!driver->resctrlControlQuit &&
+               virCondWaitUntil(&driver->resctrlControlCond, &driver->lock, then) == 0)
+            ;
+
+        if (driver->resctrlControlQuit)
+            break;
+
+        virMutexUnlock(&driver->lock);
+        qemuDomainResctrlControlAdjust(driver, cfg);
+        virMutexLock(&driver->lock);
+    }
+    virMutexUnlock(&driver->lock);
+}
+
+
+static void
+qemuDomainBalloonStatsPollDone(qemuMonitorPtr mon G_GNUC_UNUSED,
+                               const char *cmdname G_GNUC_UNUSED,
+                               virJSONValuePtr data,
+                               const char *error,
+                               void *opaque)
+{
+    virDomainObjPtr vm = opaque;
+    virDomainMemoryStatStruct stats[VIR_DOMAIN_MEMORY_STAT_NR];
+    int nstats = -1;
+
+    if (data)
+        nstats = qemuMonitorParseMemoryStats(data, stats, G_N_ELEMENTS(stats));
+    else
+        VIR_DEBUG("Polling balloon stats failed: %s", NULLSTR(error));
+
+    qemuDomainBalloonStatsStore(vm->privateData,
+                                nstats >= 0 ? stats : NULL, nstats);
+    virObjectUnref(vm);
+}
+
+
+static void
+qemuDomainBalloonStatsPollOne(virQEMUDriverPtr driver,
+                              virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    bool pending;
+    int rc;
+
+    if (!virDomainObjIsActive(vm) ||
+        !virDomainDefHasMemballoon(vm->def) ||
+        vm->def->memballoon->period <= 0)
+        return;
+
+    virMutexLock(&priv->balloonStatsLock);
+    pending = priv->balloonStatsPending;
+    priv->balloonStatsPending = true;
+    virMutexUnlock(&priv->balloonStatsLock);
+
+    if (pending)
+        return;
+
+    /* skip domains which are busy, they'll be polled next time */
+    if (qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_QUERY) < 0) {
+        rc = -1;
+        goto cleanup;
+    }
+
+    if (!virDomainObjIsActive(vm)) {
+        rc = -1;
+        goto endjob;
+    }
+
+    qemuDomainObjEnterMonitor(driver, vm);
+    rc = qemuMonitorGetMemoryStatsAsync(priv->mon,
+                                        qemuDomainBalloonStatsPollDone,
+                                        virObjectRef(vm));
+    ignore_value(qemuDomainObjExitMonitor(driver, vm));
+
+    /* the reference is released by the callback only if the query was sent */
+    if (rc <= 0)
+        virObjectUnref(vm);
+
+ endjob:
+    qemuDomainObjEndJob(driver, vm);
+
+ cleanup:
+    if (rc <= 0) {
+        virMutexLock(&priv->balloonStatsLock);
+        priv->balloonStatsPending = false;
+        virMutexUnlock(&priv->balloonStatsLock);
+        virResetLastError();
+    }
+}
+
+
+/*
+ * Submits the balloon statistics queries of all running domains with
+ * stats collection enabled at once per balloon_stats_interval, so that
+ * memory stats APIs can be answered without talking to the monitor.
+ */
+static void
+qemuDomainBalloonStatsThread(void *opaque)
 {
-    uint64_t value = 0;
+    virQEMUDriverPtr driver = opaque;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    unsigned long long then;
 
-    if (virPerfReadEvent(perf, type, &value) < 0)
-        return -1;
+    virMutexLock(&driver->lock);
+    while (!driver->balloonStatsQuit) {
+        virDomainObjPtr *vms = NULL;
+        size_t nvms = 0;
+        size_t i;
 
-    if (virTypedParamListAddULLong(params, value, "perf.%s",
-                                   virPerfEventTypeToString(type)) < 0)
-        return -1;
+        if (virTimeMillisNow(&then) < 0)
+            break;
+        then += cfg->balloonStatsInterval * 1000ull;
 
-    return 0;
-}
+        while (!driver->balloonStatsQuit &&
+               virCondWaitUntil(&driver->balloonStatsCond, &driver->lock, then) == 0)
+            ;
 
-static int
-qemuDomainGetStatsPerf(virQEMUDriverPtr driver G_GNUC_UNUSED,
-                       virDomainObjPtr dom,
-                       virTypedParamListPtr params,
-                       unsigned int privflags G_GNUC_UNUSED)
-{
-    size_t i;
-    qemuDomainObjPrivatePtr priv = dom->privateData;
+        if (driver->balloonStatsQuit)
+            break;
 
-    for (i = 0; i < VIR_PERF_EVENT_LAST; i++) {
-        if (!virPerfEventIsEnabled(priv->perf, i))
-             continue;
+        virMutexUnlock(&driver->lock);
 
-        if (qemuDomainGetStatsPerfOneEvent(priv->perf, i, params) < 0)
-            return -1;
-    }
+        if (virDomainObjListCollect(driver->domains, NULL, &vms, &nvms, NULL,
+                                    VIR_CONNECT_LIST_DOMAINS_ACTIVE) < 0) {
+            virResetLastError();
+        } else {
+            for (i = 0; i < nvms; i++) {
+                virObjectLock(vms[i]);
+                qemuDomainBalloonStatsPollOne(driver, vms[i]);
+                virObjectUnlock(vms[i]);
+            }
+            virObjectListFreeCount(vms, nvms);
+        }
 
-    return 0;
+        virMutexLock(&driver->lock);
+    }
+    virMutexUnlock(&driver->lock);
 }
 
-typedef int
-(*qemuDomainGetStatsFunc)(virQEMUDriverPtr driver,
-                          virDomainObjPtr dom,
-                          virTypedParamListPtr list,
-                          unsigned int flags);
 
-struct qemuDomainGetStatsWorker {
-    qemuDomainGetStatsFunc func;
-    unsigned int stats;
-    bool monitor;
-};
+/* Largest change of the balloon of a domain in one memory manager
+ * interval, in percent of its current size */
+#define QEMU_MEMORY_MANAGER_STEP 10
 
-static struct qemuDomainGetStatsWorker qemuDomainGetStatsWorkers[] = {
-    { qemuDomainGetStatsState, VIR_DOMAIN_STATS_STATE, false },
-    { qemuDomainGetStatsCpu, VIR_DOMAIN_STATS_CPU_TOTAL, false },
-    { qemuDomainGetStatsBalloon, VIR_DOMAIN_STATS_BALLOON, true },
-    { qemuDomainGetStatsVcpu, VIR_DOMAIN_STATS_VCPU, true },
-    { qemuDomainGetStatsInterface, VIR_DOMAIN_STATS_INTERFACE, false },
-    { qemuDomainGetStatsBlock, VIR_DOMAIN_STATS_BLOCK, true },
-    { qemuDomainGetStatsPerf, VIR_DOMAIN_STATS_PERF, false },
-    { qemuDomainGetStatsIOThread, VIR_DOMAIN_STATS_IOTHREAD, true },
-    { qemuDomainGetStatsMemory, VIR_DOMAIN_STATS_MEMORY, false },
-    { NULL, 0, false }
-};
+/* Guests with less memory left to them, in percent of their current
+ * size, get memory back when the host isn't short of it */
+#define QEMU_MEMORY_MANAGER_GROW_THRESHOLD 20
 
 
-static int
-qemuDomainGetStatsCheckSupport(unsigned int *stats,
-                               bool enforce)
+/**
+ * qemuDomainMemoryManagerAdjust:
+ * @driver: qemu driver
+ * @cfg: driver config
+ * @vm: domain object, locked
+ * @reclaim: whether the host is short of memory
+ *
+ * Inflates the balloon of @vm by the memory its guest doesn't use if
+ * @reclaim is set, or deflates it if the guest runs short of memory and
+ * @reclaim isn't set. The balloon stays between memory_manager_guest_min
+ * percent of the memory of the domain, or its <min_guarantee> if larger,
+ * and the full memory of the domain.
+ *
+ * Returns the amount of memory reclaimed from the guest in KiB, negative
+ * if memory was given back to it.
+ */
+static long long
+qemuDomainMemoryManagerAdjust(virQEMUDriverPtr driver,
+                              virQEMUDriverConfigPtr cfg,
+                              virDomainObjPtr vm,
+                              bool reclaim)
 {
-    unsigned int supportedstats = 0;
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    virDomainMemoryStatStruct stats[VIR_DOMAIN_MEMORY_STAT_NR];
+    unsigned long long maxmem;
+    unsigned long long minmem;
+    unsigned long long cur;
+    unsigned long long target;
+    unsigned long long step;
+    long long usable = -1;
+    long long ret = 0;
+    int nstats;
+    int rc;
     size_t i;
 
-    for (i = 0; qemuDomainGetStatsWorkers[i].func; i++)
-        supportedstats |= qemuDomainGetStatsWorkers[i].stats;
-
-    if (*stats == 0) {
-        *stats = supportedstats;
+    if (!virDomainObjIsActive(vm) ||
+        !virDomainDefHasMemballoon(vm->def) ||
+        vm->def->memballoon->period <= 0)
         return 0;
-    }
 
-    if (enforce &&
-        *stats & ~supportedstats) {
-        virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED,
-                       _("Stats types bits 0x%x are not supported by this daemon"),
-                       *stats & ~supportedstats);
-        return -1;
+    /* don't wait for domains busy with other jobs */
+    if (qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_MODIFY) < 0) {
+        virResetLastError();
+        return 0;
     }
 
-    *stats &= supportedstats;
-    return 0;
-}
-
+    if (!virDomainObjIsActive(vm))
+        goto endjob;
 
-static bool
-qemuDomainGetStatsNeedMonitor(unsigned int stats)
-{
-    size_t i;
+    if ((nstats = qemuDomainMemoryStatsCached(driver, vm, stats,
+                                              G_N_ELEMENTS(stats))) < 0) {
+        qemuDomainObjEnterMonitor(driver, vm);
+        nstats = qemuMonitorGetMemoryStats(priv->mon, vm->def->memballoon,
+                                           stats, G_N_ELEMENTS(stats));
+        if (qemuDomainObjExitMonitor(driver, vm) < 0 || nstats < 0)
+            goto endjob;
+    }
 
-    for (i = 0; qemuDomainGetStatsWorkers[i].func; i++)
-        if (stats & qemuDomainGetStatsWorkers[i].stats &&
-            qemuDomainGetStatsWorkers[i].monitor)
-            return true;
+    /* prefer the memory the guest can use without swapping over the
+     * memory it leaves completely unused */
+    for (i = 0; i < nstats; i++) {
+        if (stats[i].tag == VIR_DOMAIN_MEMORY_STAT_USABLE)
+            usable = stats[i].val;
+        else if (stats[i].tag == VIR_DOMAIN_MEMORY_STAT_UNUSED && usable < 0)
+            usable = stats[i].val;
+    }
 
-    return false;
-}
+    if (usable < 0) {
+        VIR_DEBUG("Guest of domain %s doesn't report unused memory",
+                  vm->def->name);
+        goto endjob;
+    }
 
+    maxmem = virDomainDefGetMemoryTotal(vm->def);
+    minmem = MAX(maxmem * cfg->memoryManagerGuestMin / 100,
+                 vm->def->mem.min_guarantee);
+    cur = vm->def->mem.cur_balloon;
+    step = cur * QEMU_MEMORY_MANAGER_STEP / 100;
 
-static int
-qemuDomainGetStats(virConnectPtr conn,
-                   virDomainObjPtr dom,
-                   unsigned int stats,
-                   virDomainStatsRecordPtr *record,
-                   unsigned int flags)
-{
-    g_autofree virDomainStatsRecordPtr tmp = NULL;
-    g_autoptr(virTypedParamList) params = NULL;
-    size_t i;
+    if (reclaim) {
+        if (cur <= minmem)
+            goto endjob;
+        target = cur - MIN(MIN(step, (unsigned long long) usable / 2),
+                           cur - minmem);
+    } else {
+        if (cur >= maxmem ||
+            (unsigned long long) usable * 100 >=
+            cur * QEMU_MEMORY_MANAGER_GROW_THRESHOLD)
+            goto endjob;
+        target = MIN(cur + step, maxmem);
+    }
 
-    if (VIR_ALLOC(params) < 0)
-        return -1;
+    if (target == cur)
+        goto endjob;
 
-    for (i = 0; qemuDomainGetStatsWorkers[i].func; i++) {
-        if (stats & qemuDomainGetStatsWorkers[i].stats) {
-            if (qemuDomainGetStatsWorkers[i].func(conn->privateData, dom, params,
-                                                  flags) < 0)
-                return -1;
-        }
-    }
+    VIR_DEBUG("Changing balloon of domain %s from %llu KiB to %llu KiB, "
+              "guest has %lld KiB unused", vm->def->name, cur, target, usable);
 
-    if (VIR_ALLOC(tmp) < 0)
-        return -1;
+    qemuDomainObjEnterMonitor(driver, vm);
+    rc = qemuMonitorSetBalloon(priv->mon, target);
+    if (qemuDomainObjExitMonitor(driver, vm) < 0 || rc <= 0)
+        goto endjob;
 
-    if (!(tmp->dom = virGetDomain(conn, dom->def->name,
-                                  dom->def->uuid, dom->def->id)))
-        return -1;
+    ret = (long long) cur - (long long) target;
 
-    tmp->nparams = virTypedParamListStealParams(params, &tmp->params);
-    *record = g_steal_pointer(&tmp);
-    return 0;
+ endjob:
+    qemuDomainObjEndJob(driver, vm);
+    virResetLastError();
+    return ret;
 }
 
 
-static int
-qemuConnectGetAllDomainStats(virConnectPtr conn,
-                             virDomainPtr *doms,
-                             unsigned int ndoms,
-                             unsigned int stats,
-                             virDomainStatsRecordPtr **retStats,
-                             unsigned int flags)
+/**
+ * qemuDomainMemoryManagerRun:
+ * @driver: qemu driver
+ * @cfg: driver config
+ *
+ * Checks whether the host is short of memory, either because its free
+ * memory dropped below memory_manager_min_free or because tasks stall on
+ * memory for more than memory_manager_pressure percent of the time, and
+ * reclaims unused guest memory until the minimum is expected to be free
+ * again. Otherwise gives memory back to guests running short of it while
+ * the host has twice the minimum free.
+ */
+static void
+qemuDomainMemoryManagerRun(virQEMUDriverPtr driver,
+                           virQEMUDriverConfigPtr cfg)
 {
-    virQEMUDriverPtr driver = conn->privateData;
-    virErrorPtr orig_err = NULL;
     virDomainObjPtr *vms = NULL;
-    virDomainObjPtr vm;
-    size_t nvms;
-    virDomainStatsRecordPtr *tmpstats = NULL;
-    bool enforce = !!(flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS);
-    int nstats = 0;
+    size_t nvms = 0;
+    unsigned long long freeMem;
+    unsigned long long minFree = cfg->memoryManagerMinFree * 1024ull * 1024;
+    virCgroupPressure some = { 0 };
+    virCgroupPressure full;
+    bool hasFull;
+    long long needed = 0;
+    bool reclaim;
     size_t i;
-    int ret = -1;
-    unsigned int privflags = 0;
-    unsigned int domflags = 0;
-    unsigned int lflags = flags & (VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
-                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
-                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE);
-
-    virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
-                  VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
-                  VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE |
-                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT |
-                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING |
-                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
-
-    if (virConnectGetAllDomainStatsEnsureACL(conn) < 0)
-        return -1;
 
-    if (qemuDomainGetStatsCheckSupport(&stats, enforce) < 0)
-        return -1;
+    if (virHostMemGetInfo(NULL, &freeMem) < 0) {
+        VIR_WARN("Unable to get host free memory: %s",
+                 virGetLastErrorMessage());
+        virResetLastError();
+        return;
+    }
 
-    if (ndoms) {
-        if (virDomainObjListConvert(driver->domains, conn, doms, ndoms, &vms,
-                                    &nvms, virConnectGetAllDomainStatsCheckACL,
-                                    lflags, true) < 0)
-            return -1;
+    if (cfg->memoryManagerPressure > 0 &&
+        virCgroupGetHostPressure(VIR_CGROUP_PRESSURE_MEMORY,
+                                 &some, &full, &hasFull) < 0) {
+        virResetLastError();
+        some.avg10 = 0;
+    }
+
+    if (freeMem < minFree) {
+        needed = (minFree - freeMem) / 1024;
+        reclaim = true;
+    } else if (cfg->memoryManagerPressure > 0 &&
+               some.avg10 >= cfg->memoryManagerPressure) {
+        /* stalls despite free memory, e.g. page cache being thrashed,
+         * reclaim one step from every guest */
+        needed = LLONG_MAX;
+        reclaim = true;
+    } else if (freeMem >= 2 * minFree) {
+        reclaim = false;
     } else {
-        if (virDomainObjListCollect(driver->domains, conn, &vms, &nvms,
-                                    virConnectGetAllDomainStatsCheckACL,
-                                    lflags) < 0)
-            return -1;
+        return;
     }
 
-    if (VIR_ALLOC_N(tmpstats, nvms + 1) < 0)
-        goto cleanup;
+    VIR_DEBUG("Host has %llu bytes free, memory pressure %.2f%%, %s guest memory",
+              freeMem, some.avg10, reclaim ? "reclaiming" : "releasing");
 
-    if (qemuDomainGetStatsNeedMonitor(stats))
-        privflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+    if (virDomainObjListCollect(driver->domains, NULL, &vms, &nvms, NULL,
+                                VIR_CONNECT_LIST_DOMAINS_ACTIVE) < 0) {
+        virResetLastError();
+        return;
+    }
 
     for (i = 0; i < nvms; i++) {
-        virDomainStatsRecordPtr tmp = NULL;
-        domflags = 0;
-        vm = vms[i];
-
-        virObjectLock(vm);
-
-        if (HAVE_JOB(privflags)) {
-            int rv;
-
-            if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT)
-                rv = qemuDomainObjBeginJobNowait(driver, vm, QEMU_JOB_QUERY);
-            else
-                rv = qemuDomainObjBeginJob(driver, vm, QEMU_JOB_QUERY);
+        long long changed;
 
-            if (rv == 0)
-                domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
-        }
-        /* else: without a job it's still possible to gather some data */
+        if (reclaim && needed <= 0)
+            break;
 
-        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
-            domflags |= QEMU_DOMAIN_STATS_BACKING;
-        if (qemuDomainGetStats(conn, vm, stats, &tmp, domflags) < 0) {
-            if (HAVE_JOB(domflags) && vm)
-                qemuDomainObjEndJob(driver, vm);
+        virObjectLock(vms[i]);
+        changed = qemuDomainMemoryManagerAdjust(driver, cfg, vms[i], reclaim);
+        virObjectUnlock(vms[i]);
 
-            virObjectUnlock(vm);
-            goto cleanup;
-        }
+        if (reclaim)
+            needed -= changed;
+    }
 
-        if (tmp)
-            tmpstats[nstats++] = tmp;
+    virObjectListFreeCount(vms, nvms);
+}
 
-        if (HAVE_JOB(domflags))
-            qemuDomainObjEndJob(driver, vm);
 
-        virObjectUnlock(vm);
-    }
+/*
+ * Balances memory between the host and ballooned guests once per
+ * memory_manager_interval.
+ */
+static void
+qemuDomainMemoryManagerThread(void *opaque)
+{
+    virQEMUDriverPtr driver = opaque;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    unsigned long long then;
 
-    *retStats = tmpstats;
-    tmpstats = NULL;
+    virMutexLock(&driver->lock);
+    while (!driver->memoryManagerQuit) {
+        if (virTimeMillisNow(&then) < 0)
+            break;
+        then += cfg->memoryManagerInterval * 1000ull;
 
-    ret = nstats;
+        while (!driver->memoryManagerQuit &&
+               virCondWaitUntil(&driver->memoryManagerCond, &driver->lock, then) == 0)
+            ;
 
- cleanup:
-    virErrorPreserveLast(&orig_err);
-    virDomainStatsRecordListFree(tmpstats);
-    virObjectListFreeCount(vms, nvms);
-    virErrorRestore(&orig_err);
+        if (driver->memoryManagerQuit)
+            break;
 
-    return ret;
+        virMutexUnlock(&driver->lock);
+        qemuDomainMemoryManagerRun(driver, cfg);
+        virMutexLock(&driver->lock);
+    }
+    virMutexUnlock(&driver->lock);
 }
 
 
@@ -22192,9 +25864,13 @@ qemuDomainRenameCallback(virDomainObjPtr vm,
     vm->def->name = new_dom_name;
     new_dom_name = NULL;
 
-    if (virDomainDefSave(vm->def, driver->xmlopt, cfg->configDir) < 0)
+    /* The config under the new name has to be on disk before the old one
+     * is removed */
+    if (virDomainDefSave(vm->def, driver->xmlopt, cfg->configDir) < 0 ||
+        virWriteBehindFlush() < 0)
         goto rollback;
 
+    virWriteBehindCancel(old_dom_cfg_file);
     if (virFileExists(old_dom_cfg_file) &&
         unlink(old_dom_cfg_file) < 0) {
         virReportSystemError(errno,
@@ -22996,6 +26672,40 @@ qemuAgentFSInfoFormatParams(qemuAgentFSInfoPtr *fsinfo,
 }
 
 
+/**
+ * qemuDomainGetGuestInfoCached:
+ * @vm: domain object
+ * @types: requested virDomainGuestInfoTypes
+ * @maxAge: maximum age of the cached data in seconds
+ * @params: filled with a copy of the cached data
+ * @nparams: number of items in @params
+ *
+ * Returns true if there was a fresh enough result of an earlier call
+ * asking for the same @types.
+ */
+static bool
+qemuDomainGetGuestInfoCached(virDomainObjPtr vm,
+                             unsigned int types,
+                             unsigned int maxAge,
+                             virTypedParameterPtr *params,
+                             int *nparams)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainStatsCacheEntryPtr entry = &priv->guestInfoCache;
+
+    if (maxAge == 0 || !entry->params || entry->stats != types ||
+        g_get_monotonic_time() - entry->timestamp > maxAge * G_USEC_PER_SEC)
+        return false;
+
+    if (virTypedParamsCopy(params, entry->params, entry->nparams) < 0)
+        return false;
+    *nparams = entry->nparams;
+
+    VIR_DEBUG("Using cached guest info of domain %s", vm->def->name);
+    return true;
+}
+
+
 static int
 qemuDomainGetGuestInfo(virDomainPtr dom,
                        unsigned int types,
@@ -23004,6 +26714,7 @@ qemuDomainGetGuestInfo(virDomainPtr dom,
                        unsigned int flags)
 {
     virQEMUDriverPtr driver = dom->conn->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     virDomainObjPtr vm = NULL;
     qemuAgentPtr agent;
     int ret = -1;
@@ -23014,6 +26725,8 @@ qemuDomainGetGuestInfo(virDomainPtr dom,
     int rc;
     size_t nfs = 0;
     qemuAgentFSInfoPtr *agentfsinfo = NULL;
+    const char *prefetch[6] = { NULL };
+    size_t nprefetch = 0;
     size_t i;
 
     virCheckFlags(0, -1);
@@ -23027,6 +26740,13 @@ qemuDomainGetGuestInfo(virDomainPtr dom,
     if (virDomainGetGuestInfoEnsureACL(dom->conn, vm->def) < 0)
         goto cleanup;
 
+    if (virDomainObjIsActive(vm) &&
+        qemuDomainGetGuestInfoCached(vm, types, cfg->guestInfoCacheTimeout,
+                                     params, nparams)) {
+        ret = 0;
+        goto cleanup;
+    }
+
     if (qemuDomainObjBeginAgentJob(driver, vm,
                                    QEMU_AGENT_JOB_QUERY) < 0)
         goto cleanup;
@@ -23034,8 +26754,25 @@ qemuDomainGetGuestInfo(virDomainPtr dom,
     if (!qemuDomainAgentAvailable(vm, true))
         goto endagentjob;
 
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_USERS)
+        prefetch[nprefetch++] = "guest-get-users";
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_OS)
+        prefetch[nprefetch++] = "guest-get-osinfo";
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_TIMEZONE)
+        prefetch[nprefetch++] = "guest-get-timezone";
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_HOSTNAME)
+        prefetch[nprefetch++] = "guest-get-host-name";
+    if (supportedTypes & VIR_DOMAIN_GUEST_INFO_FILESYSTEM)
+        prefetch[nprefetch++] = "guest-get-fsinfo";
+
     agent = qemuDomainObjEnterAgent(vm);
 
+    /* The commands are independent of each other, send them all at once
+     * and let the individual calls below pick up the replies. */
+    if (nprefetch > 1 &&
+        qemuAgentPrefetch(agent, prefetch) < 0)
+        goto exitagent;
+
     /* The agent info commands will return -2 for any commands that are not
      * supported by the agent, or -1 for all other errors. In the case where no
      * categories were explicitly requested (i.e. 'types' is 0), ignore
@@ -23073,6 +26810,7 @@ qemuDomainGetGuestInfo(virDomainPtr dom,
     ret = 0;
 
  exitagent:
+    qemuAgentPrefetchReset(agent);
     qemuDomainObjExitAgent(vm, agent);
 
  endagentjob:
@@ -23093,6 +26831,19 @@ qemuDomainGetGuestInfo(virDomainPtr dom,
         qemuDomainObjEndJob(driver, vm);
     }
 
+    if (ret == 0 && cfg->guestInfoCacheTimeout > 0 &&
+        virDomainObjIsActive(vm)) {
+        qemuDomainObjPrivatePtr priv = vm->privateData;
+
+        qemuDomainGuestInfoCacheClear(priv);
+        if (virTypedParamsCopy(&priv->guestInfoCache.params,
+                               *params, *nparams) == 0) {
+            priv->guestInfoCache.nparams = *nparams;
+            priv->guestInfoCache.stats = types;
+            priv->guestInfoCache.timestamp = g_get_monotonic_time();
+        }
+    }
+
  cleanup:
     for (i = 0; i < nfs; i++)
         qemuAgentFSInfoFree(agentfsinfo[i]);
@@ -23396,6 +27147,13 @@ static virHypervisorDriver qemuHypervisorDriver = {
     .domainAgentSetResponseTimeout = qemuDomainAgentSetResponseTimeout, /* 5.10.0 */
     .domainBackupBegin = qemuDomainBackupBegin, /* 6.0.0 */
     .domainBackupGetXMLDesc = qemuDomainBackupGetXMLDesc, /* 6.0.0 */
+    .domainMigrateTunnelChannel = qemuDomainMigrateTunnelChannel, /* 6.7.0 */
+    .domainListMigrate = qemuDomainListMigrate, /* 6.7.0 */
+    .domainAttachDevices = qemuDomainAttachDevices, /* 6.7.0 */
+    .domainDetachDevices = qemuDomainDetachDevices, /* 6.7.0 */
+    .connectOpenDomainStatsFD = qemuConnectOpenDomainStatsFD, /* 6.7.0 */
+    .domainListShutdown = qemuDomainListShutdown, /* 6.7.0 */
+    .domainGetXMLDigest = qemuDomainGetXMLDigest, /* 6.7.0 */
 };
 
 
@@ -172,6 +172,12 @@ qemuExtDevicesStart(virQEMUDriverPtr driver,
     if (qemuExtDevicesInitPaths(driver, def) < 0)
         return -1;
 
+    /* swtpm daemonizes on its own and has to be waited for. Start it
+     * first and sync with it only after the other helpers, which are
+     * ready once their pidfile is written, were started. */
+    if (def->ntpms > 0 && qemuExtTPMStart(driver, vm, incomingMigration) < 0)
+        return -1;
+
     for (i = 0; i < def->nvideos; i++) {
         virDomainVideoDefPtr video = def->videos[i];
 
@@ -181,9 +187,6 @@ qemuExtDevicesStart(virQEMUDriverPtr driver,
         }
     }
 
-    if (def->ntpms > 0 && qemuExtTPMStart(driver, vm, incomingMigration) < 0)
-        return -1;
-
     for (i = 0; i < def->nnets; i++) {
         virDomainNetDefPtr net = def->nets[i];
         qemuSlirpPtr slirp = QEMU_DOMAIN_NETWORK_PRIVATE(net)->slirp;
@@ -202,6 +205,9 @@ qemuExtDevicesStart(virQEMUDriverPtr driver,
         }
     }
 
+    if (def->ntpms > 0 && qemuExtTPMWaitStarted(driver, vm) < 0)
+        return -1;
+
     return 0;
 }
 
@@ -74,6 +74,10 @@ VIR_LOG_INIT("qemu.qemu_hotplug");
 static void
 qemuDomainResetDeviceRemoval(virDomainObjPtr vm);
 
+static qemuDomainUnpluggingDevicePtr
+qemuDomainFindBatchDeviceRemoval(qemuDomainObjPrivatePtr priv,
+                                 const char *alias);
+
 /**
  * qemuDomainDeleteDevice:
  * @vm: domain object
@@ -100,6 +104,7 @@ qemuDomainDeleteDevice(virDomainObjPtr vm,
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
     virQEMUDriverPtr driver = priv->driver;
+    qemuDomainUnpluggingDevicePtr batch;
     int rc;
 
     qemuDomainObjEnterMonitor(driver, vm);
@@ -116,7 +121,15 @@ qemuDomainDeleteDevice(virDomainObjPtr vm,
          * even arrived. If it did, we need to claim success to
          * make the caller remove device from domain XML. */
 
-        if (priv->unplug.eventSeen) {
+        if ((batch = qemuDomainFindBatchDeviceRemoval(priv, alias))) {
+            if (batch->eventSeen) {
+                VIR_DEBUG("Detaching of device %s failed, but event arrived", alias);
+                rc = 0;
+            } else if (rc == -2) {
+                VIR_DEBUG("Detaching of device %s failed and no event arrived", alias);
+                rc = 0;
+            }
+        } else if (priv->unplug.eventSeen) {
             /* The event arrived. Return success. */
             VIR_DEBUG("Detaching of device %s failed, but event arrived", alias);
             qemuDomainResetDeviceRemoval(vm);
@@ -5086,6 +5099,21 @@ qemuDomainResetDeviceRemoval(virDomainObjPtr vm)
 }
 
 
+static qemuDomainUnpluggingDevicePtr
+qemuDomainFindBatchDeviceRemoval(qemuDomainObjPrivatePtr priv,
+                                 const char *alias)
+{
+    size_t i;
+
+    for (i = 0; i < priv->nunplugBatch; i++) {
+        if (STREQ_NULLABLE(priv->unplugBatch[i].alias, alias))
+            return &priv->unplugBatch[i];
+    }
+
+    return NULL;
+}
+
+
 unsigned long long G_GNUC_NO_INLINE
 qemuDomainGetUnplugTimeout(virDomainObjPtr vm)
 {
@@ -5148,6 +5176,7 @@ qemuDomainSignalDeviceRemoval(virDomainObjPtr vm,
                               qemuDomainUnpluggingDeviceStatus status)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainUnpluggingDevicePtr batch;
 
     if (STREQ_NULLABLE(priv->unplug.alias, devAlias)) {
         VIR_DEBUG("Removal of device '%s' continues in waiting thread", devAlias);
@@ -5157,6 +5186,16 @@ qemuDomainSignalDeviceRemoval(virDomainObjPtr vm,
         virDomainObjBroadcast(vm);
         return true;
     }
+
+    if ((batch = qemuDomainFindBatchDeviceRemoval(priv, devAlias)) &&
+        !batch->eventSeen) {
+        VIR_DEBUG("Removal of device '%s' continues in batch detach", devAlias);
+        batch->status = status;
+        batch->eventSeen = true;
+        virDomainObjBroadcast(vm);
+        return true;
+    }
+
     return false;
 }
 
@@ -5705,27 +5744,36 @@ qemuDomainDetachDeviceLease(virQEMUDriverPtr driver,
 }
 
 
-int
-qemuDomainDetachDeviceLive(virDomainObjPtr vm,
+/**
+ * qemuDomainDetachPrepDevice:
+ * @vm: domain object
+ * @match: prototype of the device to detach
+ * @detach: filled with the device of @vm to detach
+ * @retinfo: filled with the device info of @detach
+ *
+ * Looks up the device matching @match in @vm and checks that it can be
+ * unplugged. Lease and chr devices are not handled here, they have their
+ * own self-contained Detach functions.
+ *
+ * Returns 0 on success, -1 otherwise.
+ */
+static int
+qemuDomainDetachPrepDevice(virDomainObjPtr vm,
                            virDomainDeviceDefPtr match,
-                           virQEMUDriverPtr driver,
-                           bool async)
+                           virDomainDeviceDefPtr detach,
+                           virDomainDeviceInfoPtr *retinfo)
 {
-    virDomainDeviceDef detach = { .type = match->type };
-    virDomainDeviceInfoPtr info = NULL;
-    int ret = -1;
+    virDomainDeviceInfoPtr info;
+
+    detach->type = match->type;
 
     switch ((virDomainDeviceType)match->type) {
-        /*
-         * lease and chr devices don't follow the standard pattern of
-         * the others, so they must have their own self-contained
-         * Detach functions.
-         */
     case VIR_DOMAIN_DEVICE_LEASE:
-        return qemuDomainDetachDeviceLease(driver, vm, match->data.lease);
-
     case VIR_DOMAIN_DEVICE_CHR:
-        return qemuDomainDetachDeviceChr(driver, vm, match->data.chr, async);
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("unexpected detach of %s device"),
+                       virDomainDeviceTypeToString(match->type));
+        return -1;
 
         /*
          * All the other device types follow a very similar pattern -
@@ -5736,67 +5784,67 @@ qemuDomainDetachDeviceLive(virDomainObjPtr vm,
          */
     case VIR_DOMAIN_DEVICE_DISK:
         if (qemuDomainDetachPrepDisk(vm, match->data.disk,
-                                     &detach.data.disk) < 0) {
+                                     &detach->data.disk) < 0) {
             return -1;
         }
         break;
     case VIR_DOMAIN_DEVICE_CONTROLLER:
         if (qemuDomainDetachPrepController(vm, match->data.controller,
-                                           &detach.data.controller) < 0) {
+                                           &detach->data.controller) < 0) {
             return -1;
         }
         break;
     case VIR_DOMAIN_DEVICE_NET:
         if (qemuDomainDetachPrepNet(vm, match->data.net,
-                                    &detach.data.net) < 0) {
+                                    &detach->data.net) < 0) {
             return -1;
         }
         break;
     case VIR_DOMAIN_DEVICE_HOSTDEV:
         if (qemuDomainDetachPrepHostdev(vm, match->data.hostdev,
-                                        &detach.data.hostdev) < 0) {
+                                        &detach->data.hostdev) < 0) {
             return -1;
         }
         break;
     case VIR_DOMAIN_DEVICE_RNG:
         if (qemuDomainDetachPrepRNG(vm, match->data.rng,
-                                    &detach.data.rng) < 0) {
+                                    &detach->data.rng) < 0) {
             return -1;
         }
         break;
     case VIR_DOMAIN_DEVICE_MEMORY:
         if (qemuDomainDetachPrepMemory(vm, match->data.memory,
-                                       &detach.data.memory) < 0) {
+                                       &detach->data.memory) < 0) {
             return -1;
         }
         break;
     case VIR_DOMAIN_DEVICE_SHMEM:
         if (qemuDomainDetachPrepShmem(vm, match->data.shmem,
-                                      &detach.data.shmem) < 0) {
+                                      &detach->data.shmem) < 0) {
             return -1;
         }
         break;
     case VIR_DOMAIN_DEVICE_WATCHDOG:
         if (qemuDomainDetachPrepWatchdog(vm, match->data.watchdog,
-                                         &detach.data.watchdog) < 0) {
+                                         &detach->data.watchdog) < 0) {
             return -1;
         }
         break;
     case VIR_DOMAIN_DEVICE_INPUT:
         if (qemuDomainDetachPrepInput(vm, match->data.input,
-                                      &detach.data.input) < 0) {
+                                      &detach->data.input) < 0) {
             return -1;
         }
         break;
     case VIR_DOMAIN_DEVICE_REDIRDEV:
         if (qemuDomainDetachPrepRedirdev(vm, match->data.redirdev,
-                                         &detach.data.redirdev) < 0) {
+                                         &detach->data.redirdev) < 0) {
             return -1;
         }
         break;
     case VIR_DOMAIN_DEVICE_VSOCK:
         if (qemuDomainDetachPrepVsock(vm, match->data.vsock,
-                                      &detach.data.vsock) < 0) {
+                                      &detach->data.vsock) < 0) {
             return -1;
         }
         break;
@@ -5822,7 +5870,7 @@ qemuDomainDetachDeviceLive(virDomainObjPtr vm,
 
     /* "detach" now points to the actual device we want to detach */
 
-    if (!(info = virDomainDeviceGetInfo(&detach))) {
+    if (!(info = virDomainDeviceGetInfo(detach))) {
         /*
          * This should never happen, since all of the device types in
          * the switch cases that end with a "break" instead of a
@@ -5830,7 +5878,7 @@ qemuDomainDetachDeviceLive(virDomainObjPtr vm,
          */
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("device of type '%s' has no device info"),
-                       virDomainDeviceTypeToString(detach.type));
+                       virDomainDeviceTypeToString(detach->type));
         return -1;
     }
 
@@ -5840,7 +5888,7 @@ qemuDomainDetachDeviceLive(virDomainObjPtr vm,
     if (!info->alias) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Cannot detach %s device with no alias"),
-                       virDomainDeviceTypeToString(detach.type));
+                       virDomainDeviceTypeToString(detach->type));
         return -1;
     }
 
@@ -5848,7 +5896,7 @@ qemuDomainDetachDeviceLive(virDomainObjPtr vm,
         virReportError(VIR_ERR_OPERATION_FAILED,
                        _("cannot hot unplug %s device with multifunction PCI guest address: "
                          VIR_PCI_DEVICE_ADDRESS_FMT),
-                       virDomainDeviceTypeToString(detach.type),
+                       virDomainDeviceTypeToString(detach->type),
                        info->addr.pci.domain, info->addr.pci.bus,
                        info->addr.pci.slot, info->addr.pci.function);
         return -1;
@@ -5865,7 +5913,7 @@ qemuDomainDetachDeviceLive(virDomainObjPtr vm,
                            _("cannot hot unplug %s device with PCI guest address: "
                              VIR_PCI_DEVICE_ADDRESS_FMT
                              " - controller not found"),
-                           virDomainDeviceTypeToString(detach.type),
+                           virDomainDeviceTypeToString(detach->type),
                            info->addr.pci.domain, info->addr.pci.bus,
                            info->addr.pci.slot, info->addr.pci.function);
             return -1;
@@ -5877,13 +5925,42 @@ qemuDomainDetachDeviceLive(virDomainObjPtr vm,
                            _("cannot hot unplug %s device with PCI guest address: "
                              VIR_PCI_DEVICE_ADDRESS_FMT
                              " - not allowed by controller"),
-                           virDomainDeviceTypeToString(detach.type),
+                           virDomainDeviceTypeToString(detach->type),
                            info->addr.pci.domain, info->addr.pci.bus,
                            info->addr.pci.slot, info->addr.pci.function);
             return -1;
         }
     }
 
+    *retinfo = info;
+    return 0;
+}
+
+
+int
+qemuDomainDetachDeviceLive(virDomainObjPtr vm,
+                           virDomainDeviceDefPtr match,
+                           virQEMUDriverPtr driver,
+                           bool async)
+{
+    virDomainDeviceDef detach = { .type = match->type };
+    virDomainDeviceInfoPtr info = NULL;
+    int ret = -1;
+
+    /*
+     * lease and chr devices don't follow the standard pattern of
+     * the others, so they must have their own self-contained
+     * Detach functions.
+     */
+    if (match->type == VIR_DOMAIN_DEVICE_LEASE)
+        return qemuDomainDetachDeviceLease(driver, vm, match->data.lease);
+
+    if (match->type == VIR_DOMAIN_DEVICE_CHR)
+        return qemuDomainDetachDeviceChr(driver, vm, match->data.chr, async);
+
+    if (qemuDomainDetachPrepDevice(vm, match, &detach, &info) < 0)
+        return -1;
+
     /*
      * Issue the qemu monitor command to delete the device (based on
      * its alias), and optionally wait a short time in case the
@@ -5913,6 +5990,188 @@ qemuDomainDetachDeviceLive(virDomainObjPtr vm,
 }
 
 
+/* Returns:
+ *   0 removal of some devices of the batch did not finish in time
+ *
+ *   1 the DEVICE_DELETED events of all devices in the batch arrived, or
+ *     we failed to reliably wait for them and thus use fallback behavior
+ */
+static int
+qemuDomainWaitForBatchDeviceRemoval(virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    unsigned long long until;
+    size_t i;
+    int rc;
+
+    if (virTimeMillisNow(&until) < 0)
+        return 1;
+    until += qemuDomainGetUnplugTimeout(vm);
+
+    for (i = 0; i < priv->nunplugBatch; i++) {
+        qemuDomainUnpluggingDevicePtr unplug = &priv->unplugBatch[i];
+
+        while (unplug->alias && !unplug->eventSeen) {
+            if ((rc = virDomainObjWaitUntil(vm, until)) == 1)
+                return 0;
+
+            if (rc < 0) {
+                VIR_WARN("Failed to wait on unplug condition for domain '%s' "
+                         "device '%s'", vm->def->name, unplug->alias);
+                return 1;
+            }
+        }
+    }
+
+    return 1;
+}
+
+
+static void
+qemuDomainResetBatchDeviceRemoval(virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    g_clear_pointer(&priv->unplugBatch, g_free);
+    priv->nunplugBatch = 0;
+}
+
+
+/**
+ * qemuDomainDetachDevicesLive:
+ * @vm: domain object
+ * @matches: prototypes of the devices to detach
+ * @nmatches: number of items in @matches
+ * @driver: qemu driver
+ * @ndetached: filled with the number of devices whose unplug was started
+ *
+ * Detaches all devices in @matches. Unlike calling
+ * qemuDomainDetachDeviceLive() for each of them, device_del is issued for
+ * all devices first and their DEVICE_DELETED events are then waited for
+ * together, so detaching N devices takes at most one unplug timeout
+ * rather than N of them. Devices whose event did not arrive in time are
+ * removed once it arrives, as with async detach.
+ *
+ * Lease, chr and controller devices are detached one by one after the
+ * others, as a controller can only be unplugged once the devices using
+ * it are gone.
+ *
+ * Returns 0 on success, -1 on error. @ndetached is set even on error so
+ * that the caller knows whether the domain status needs saving.
+ */
+int
+qemuDomainDetachDevicesLive(virDomainObjPtr vm,
+                            virDomainDeviceDefPtr *matches,
+                            size_t nmatches,
+                            virQEMUDriverPtr driver,
+                            size_t *ndetached)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    g_autofree virDomainDeviceDef *detach = g_new0(virDomainDeviceDef, nmatches);
+    g_autofree virDomainDeviceInfoPtr *info = g_new0(virDomainDeviceInfoPtr, nmatches);
+    virErrorPtr orig_err = NULL;
+    size_t i;
+    size_t j;
+    int ret = -1;
+    int rc;
+
+    *ndetached = 0;
+
+    for (i = 0; i < nmatches; i++) {
+        if (matches[i]->type == VIR_DOMAIN_DEVICE_LEASE ||
+            matches[i]->type == VIR_DOMAIN_DEVICE_CHR ||
+            matches[i]->type == VIR_DOMAIN_DEVICE_CONTROLLER)
+            continue;
+
+        if (qemuDomainDetachPrepDevice(vm, matches[i], &detach[i], &info[i]) < 0)
+            return -1;
+
+        for (j = 0; j < i; j++) {
+            if (info[j] == info[i]) {
+                virReportError(VIR_ERR_OPERATION_INVALID,
+                               _("device '%s' is listed more than once"),
+                               info[i]->alias);
+                return -1;
+            }
+        }
+    }
+
+    priv->unplugBatch = g_new0(qemuDomainUnpluggingDevice, nmatches);
+    priv->nunplugBatch = nmatches;
+
+    for (i = 0; i < nmatches; i++) {
+        if (!info[i])
+            continue;
+
+        priv->unplugBatch[i].alias = info[i]->alias;
+
+        if (qemuDomainDeleteDevice(vm, info[i]->alias) < 0) {
+            priv->unplugBatch[i].alias = NULL;
+            if (!virDomainObjIsActive(vm))
+                goto cleanup;
+
+            qemuDomainRemoveAuditDevice(vm, &detach[i], false);
+            virErrorPreserveLast(&orig_err);
+            break;
+        }
+    }
+
+    rc = qemuDomainWaitForBatchDeviceRemoval(vm);
+
+    for (i = 0; i < nmatches; i++) {
+        qemuDomainUnpluggingDevicePtr unplug = &priv->unplugBatch[i];
+
+        if (!unplug->alias)
+            continue;
+
+        (*ndetached)++;
+
+        /* Events arriving from now on, e.g. while the monitor is entered
+         * to remove other devices, are handled by
+         * processDeviceDeletedEvent as for async detach. */
+        unplug->alias = NULL;
+
+        if (unplug->status == QEMU_DOMAIN_UNPLUGGING_DEVICE_STATUS_GUEST_REJECTED) {
+            if (!orig_err) {
+                virReportError(VIR_ERR_OPERATION_FAILED,
+                               _("unplug of device '%s' was rejected by the guest"),
+                               info[i]->alias);
+                virErrorPreserveLast(&orig_err);
+            }
+            continue;
+        }
+
+        if (!unplug->eventSeen && rc == 0)
+            continue;
+
+        if (qemuDomainRemoveDevice(driver, vm, &detach[i]) < 0 && !orig_err)
+            virErrorPreserveLast(&orig_err);
+    }
+
+    if (orig_err)
+        goto cleanup;
+
+    qemuDomainResetBatchDeviceRemoval(vm);
+
+    for (i = 0; i < nmatches; i++) {
+        if (info[i])
+            continue;
+
+        if (qemuDomainDetachDeviceLive(vm, matches[i], driver, false) < 0)
+            goto cleanup;
+
+        (*ndetached)++;
+    }
+
+    ret = 0;
+
+ cleanup:
+    qemuDomainResetBatchDeviceRemoval(vm);
+    virErrorRestore(&orig_err);
+    return ret;
+}
+
+
 static int
 qemuDomainRemoveVcpu(virQEMUDriverPtr driver,
                      virDomainObjPtr vm,
@@ -118,6 +118,12 @@ int qemuDomainDetachDeviceLive(virDomainObjPtr vm,
                                virQEMUDriverPtr driver,
                                bool async);
 
+int qemuDomainDetachDevicesLive(virDomainObjPtr vm,
+                                virDomainDeviceDefPtr *matches,
+                                size_t nmatches,
+                                virQEMUDriverPtr driver,
+                                size_t *ndetached);
+
 void qemuDomainRemoveVcpuAlias(virQEMUDriverPtr driver,
                                virDomainObjPtr vm,
                                const char *alias);
@@ -62,6 +62,7 @@
 #include "virdomainsnapshotobjlist.h"
 #include "virsocket.h"
 #include "virutil.h"
+#include "virwritebehind.h"
 
 #define VIR_FROM_THIS VIR_FROM_QEMU
 
@@ -295,6 +296,49 @@ qemuMigrationAnyCopyDisk(virDomainDiskDef const *disk,
 }
 
 
+/* Maximum number of volumes created concurrently during Prepare */
+#define QEMU_MIGRATION_PRECREATE_THREADS 4
+
+typedef struct _qemuMigrationDstPrecreateData qemuMigrationDstPrecreateData;
+typedef qemuMigrationDstPrecreateData *qemuMigrationDstPrecreateDataPtr;
+struct _qemuMigrationDstPrecreateData {
+    virMutex lock;
+    virConnectPtr conn;
+    virDomainDiskDefPtr *disks;
+    unsigned long long *capacities;
+    size_t ndisks;
+    size_t next;
+    virErrorPtr err;
+};
+
+
+static void
+qemuMigrationDstPrecreateWorker(void *opaque)
+{
+    qemuMigrationDstPrecreateDataPtr data = opaque;
+
+    while (true) {
+        size_t i;
+
+        virMutexLock(&data->lock);
+        if (data->err || data->next == data->ndisks) {
+            virMutexUnlock(&data->lock);
+            break;
+        }
+        i = data->next++;
+        virMutexUnlock(&data->lock);
+
+        if (qemuMigrationDstPrecreateDisk(data->conn, data->disks[i],
+                                          data->capacities[i]) < 0) {
+            virMutexLock(&data->lock);
+            if (!data->err)
+                virErrorPreserveLast(&data->err);
+            virMutexUnlock(&data->lock);
+        }
+    }
+}
+
+
 static int
 qemuMigrationDstPrecreateStorage(virDomainObjPtr vm,
                                  qemuMigrationCookieNBDPtr nbd,
@@ -302,15 +346,17 @@ qemuMigrationDstPrecreateStorage(virDomainObjPtr vm,
                                  const char **migrate_disks,
                                  bool incremental)
 {
+    qemuMigrationDstPrecreateData data = { 0 };
+    g_autofree virThreadPtr threads = NULL;
+    size_t nthreads = 0;
     int ret = -1;
     size_t i = 0;
-    virConnectPtr conn;
 
     if (!nbd || !nbd->ndisks)
         return 0;
 
-    if (!(conn = virGetConnectStorage()))
-        return -1;
+    data.disks = g_new0(virDomainDiskDefPtr, nbd->ndisks);
+    data.capacities = g_new0(unsigned long long, nbd->ndisks);
 
     for (i = 0; i < nbd->ndisks; i++) {
         virDomainDiskDefPtr disk;
@@ -349,13 +395,63 @@ qemuMigrationDstPrecreateStorage(virDomainObjPtr vm,
 
         VIR_DEBUG("Proceeding with disk source %s", NULLSTR(diskSrcPath));
 
-        if (qemuMigrationDstPrecreateDisk(conn, disk, nbd->disks[i].capacity) < 0)
-            goto cleanup;
+        data.disks[data.ndisks] = disk;
+        data.capacities[data.ndisks] = nbd->disks[i].capacity;
+        data.ndisks++;
+    }
+
+    if (data.ndisks == 0) {
+        ret = 0;
+        goto cleanup;
+    }
+
+    if (!(data.conn = virGetConnectStorage()))
+        goto cleanup;
+
+    /* Creating a volume may mean allocating all of it, which the source
+     * has to wait for. Volumes are independent of each other, so create
+     * them concurrently rather than one after another. */
+    if (data.ndisks == 1) {
+        ret = qemuMigrationDstPrecreateDisk(data.conn, data.disks[0],
+                                            data.capacities[0]);
+        goto cleanup;
+    }
+
+    if (virMutexInit(&data.lock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        goto cleanup;
+    }
+
+    threads = g_new0(virThread, MIN(data.ndisks,
+                                    QEMU_MIGRATION_PRECREATE_THREADS));
+    for (i = 0; i < MIN(data.ndisks, QEMU_MIGRATION_PRECREATE_THREADS); i++) {
+        if (virThreadCreateFull(&threads[nthreads], true,
+                                qemuMigrationDstPrecreateWorker,
+                                "qemu-mig-precreate", false, &data) < 0) {
+            VIR_WARN("Unable to create thread for storage pre-creation");
+            break;
+        }
+        nthreads++;
+    }
+
+    /* Whatever is left over is handled here as well */
+    qemuMigrationDstPrecreateWorker(&data);
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    virMutexDestroy(&data.lock);
+
+    if (data.err) {
+        virErrorRestore(&data.err);
+        goto cleanup;
     }
 
     ret = 0;
  cleanup:
-    virObjectUnref(conn);
+    virObjectUnref(data.conn);
+    g_free(data.disks);
+    g_free(data.capacities);
     return ret;
 }
 
@@ -975,6 +1071,94 @@ qemuMigrationSrcNBDStorageCopyOne(virQEMUDriverPtr driver,
 }
 
 
+/* Minimum bandwidth of a single mirror job; QEMU treats 0 as unlimited */
+#define QEMU_MIGRATION_NBD_MIN_SPEED (1ULL << 20)
+
+/**
+ * qemuMigrationSrcNBDStorageCopyBalance:
+ * @driver: qemu driver
+ * @vm: domain
+ * @speed: total bandwidth limit in bytes/s
+ *
+ * Spreads @speed across the mirror jobs of all migrated disks proportionally
+ * to the amount of data each of them still has to copy. Since the remaining
+ * amount includes data written by the guest since the mirror started, disks
+ * with a higher dirty rate get a larger share of the bandwidth while mirrors
+ * which already reached the ready state only get what they need to keep up.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+qemuMigrationSrcNBDStorageCopyBalance(virQEMUDriverPtr driver,
+                                      virDomainObjPtr vm,
+                                      unsigned long long speed)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    g_autoptr(virHashTable) blockinfo = NULL;
+    unsigned long long total = 0;
+    size_t nmirrors = 0;
+    size_t i;
+    int rc = 0;
+
+    if (qemuDomainObjEnterMonitorAsync(driver, vm,
+                                       QEMU_ASYNC_JOB_MIGRATION_OUT) < 0)
+        return -1;
+
+    if (!(blockinfo = qemuMonitorGetAllBlockJobInfo(priv->mon, false)))
+        goto exit_monitor;
+
+    for (i = 0; i < vm->def->ndisks; i++) {
+        virDomainDiskDefPtr disk = vm->def->disks[i];
+        qemuMonitorBlockJobInfoPtr data;
+
+        if (!QEMU_DOMAIN_DISK_PRIVATE(disk)->migrating ||
+            !(data = virHashLookup(blockinfo, disk->info.alias)))
+            continue;
+
+        if (data->end > data->cur)
+            total += data->end - data->cur;
+        nmirrors++;
+    }
+
+    for (i = 0; i < vm->def->ndisks && rc == 0; i++) {
+        virDomainDiskDefPtr disk = vm->def->disks[i];
+        qemuMonitorBlockJobInfoPtr data;
+        qemuBlockJobDataPtr job;
+        unsigned long long share;
+
+        if (!QEMU_DOMAIN_DISK_PRIVATE(disk)->migrating ||
+            !(data = virHashLookup(blockinfo, disk->info.alias)))
+            continue;
+
+        if (total == 0)
+            share = speed / nmirrors;
+        else if (data->end > data->cur)
+            share = (double) speed * (data->end - data->cur) / total;
+        else
+            share = 0;
+
+        share = MAX(share, QEMU_MIGRATION_NBD_MIN_SPEED);
+
+        if (share == data->bandwidth)
+            continue;
+
+        if (!(job = qemuBlockJobDiskGetJob(disk)))
+            continue;
+
+        VIR_DEBUG("Setting mirror speed of disk %s to %llu B/s",
+                  disk->dst, share);
+        rc = qemuMonitorBlockJobSetSpeed(priv->mon, job->name, share);
+        virObjectUnref(job);
+    }
+
+ exit_monitor:
+    if (qemuDomainObjExitMonitor(driver, vm) < 0 || !blockinfo || rc < 0)
+        return -1;
+
+    return 0;
+}
+
+
 /**
  * qemuMigrationSrcNBDStorageCopy:
  * @driver: qemu driver
@@ -986,6 +1170,8 @@ qemuMigrationSrcNBDStorageCopyOne(virQEMUDriverPtr driver,
  *
  * Migrate non-shared storage using the NBD protocol to the server running
  * inside the qemu process on dst and wait until the copy converges.
+ * Unless @speed is unlimited it is shared by all disks and rebalanced
+ * every time a mirror gets ready.
  * On success update @migrate_flags so we don't tell 'migrate' command
  * to do the very same operation. On failure, the caller is
  * expected to call qemuMigrationSrcNBDCopyCancel to stop all
@@ -1012,6 +1198,9 @@ qemuMigrationSrcNBDStorageCopy(virQEMUDriverPtr driver,
     size_t i;
     unsigned long long mirror_speed = speed;
     bool mirror_shallow = *migrate_flags & QEMU_MONITOR_MIGRATE_NON_SHARED_INC;
+    bool balance = speed < QEMU_DOMAIN_MIG_BANDWIDTH_MAX;
+    size_t ndisks = 0;
+    size_t nready = 0;
     int rv;
     g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
 
@@ -1029,6 +1218,19 @@ qemuMigrationSrcNBDStorageCopy(virQEMUDriverPtr driver,
     port = mig->nbd->port;
     mig->nbd->port = 0;
 
+    /* start with an equal share and rebalance once the sizes are known */
+    if (balance) {
+        for (i = 0; i < vm->def->ndisks; i++) {
+            if (qemuMigrationAnyCopyDisk(vm->def->disks[i],
+                                         nmigrate_disks, migrate_disks))
+                ndisks++;
+        }
+
+        if (ndisks > 0)
+            mirror_speed = MAX(mirror_speed / ndisks,
+                               QEMU_MIGRATION_NBD_MIN_SPEED);
+    }
+
     for (i = 0; i < vm->def->ndisks; i++) {
         virDomainDiskDefPtr disk = vm->def->disks[i];
 
@@ -1047,10 +1249,31 @@ qemuMigrationSrcNBDStorageCopy(virQEMUDriverPtr driver,
         }
     }
 
+    if (ndisks > 1 &&
+        qemuMigrationSrcNBDStorageCopyBalance(driver, vm, speed << 20) < 0)
+        return -1;
+
     while ((rv = qemuMigrationSrcNBDStorageCopyReady(vm, QEMU_ASYNC_JOB_MIGRATION_OUT)) != 1) {
+        size_t ready = 0;
+
         if (rv < 0)
             return -1;
 
+        for (i = 0; i < vm->def->ndisks; i++) {
+            virDomainDiskDefPtr disk = vm->def->disks[i];
+
+            if (QEMU_DOMAIN_DISK_PRIVATE(disk)->migrating &&
+                disk->mirrorState == VIR_DOMAIN_DISK_MIRROR_STATE_READY)
+                ready++;
+        }
+
+        if (ndisks > 1 && ready != nready) {
+            nready = ready;
+            if (qemuMigrationSrcNBDStorageCopyBalance(driver, vm,
+                                                      speed << 20) < 0)
+                return -1;
+        }
+
         if (priv->job.abortJob) {
             priv->job.current->status = QEMU_DOMAIN_JOB_STATUS_CANCELED;
             virReportError(VIR_ERR_OPERATION_ABORTED, _("%s: %s"),
@@ -1069,6 +1292,11 @@ qemuMigrationSrcNBDStorageCopy(virQEMUDriverPtr driver,
             return -1;
     }
 
+    /* all mirrors only copy guest writes from now on */
+    if (ndisks > 1 &&
+        qemuMigrationSrcNBDStorageCopyBalance(driver, vm, speed << 20) < 0)
+        return -1;
+
     qemuMigrationSrcFetchMirrorStats(driver, vm, QEMU_ASYNC_JOB_MIGRATION_OUT,
                                      priv->job.current);
 
@@ -1700,6 +1928,177 @@ qemuMigrationAnyCompleted(virQEMUDriverPtr driver,
 }
 
 
+/* How often (in ms) the auto-tuning policy samples migration statistics
+ * when QEMU does not send MIGRATION_PASS events */
+#define QEMU_MIGRATION_AUTO_TUNE_INTERVAL 1000
+/* Number of consecutive samples without convergence before acting */
+#define QEMU_MIGRATION_AUTO_TUNE_STALLED 3
+/* Page size assumed when QEMU does not report one */
+#define QEMU_MIGRATION_AUTO_TUNE_PAGE_SIZE 4096
+
+typedef struct _qemuMigrationAutoTune qemuMigrationAutoTune;
+typedef qemuMigrationAutoTune *qemuMigrationAutoTunePtr;
+struct _qemuMigrationAutoTune {
+    unsigned long long downtime; /* target downtime in ms */
+    unsigned long bandwidth; /* current bandwidth limit in MiB/s */
+    bool postcopy; /* switching to post-copy is allowed */
+
+    unsigned long long lastSample; /* time of the last sample in ms */
+    unsigned long long lastIteration; /* iteration of the last sample */
+    unsigned int stalled; /* consecutive samples without convergence */
+};
+
+
+static int
+qemuMigrationSrcAutoTuneSetSpeed(virQEMUDriverPtr driver,
+                                 virDomainObjPtr vm,
+                                 qemuDomainAsyncJob asyncJob,
+                                 unsigned long bandwidth)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    g_autoptr(qemuMigrationParams) migParams = NULL;
+    int rc;
+
+    if (virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_MIGRATION_PARAM_BANDWIDTH)) {
+        if (!(migParams = qemuMigrationParamsNew()))
+            return -1;
+
+        if (qemuMigrationParamsSetULL(migParams,
+                                      QEMU_MIGRATION_PARAM_MAX_BANDWIDTH,
+                                      bandwidth * 1024 * 1024) < 0)
+            return -1;
+
+        return qemuMigrationParamsApply(driver, vm, asyncJob, migParams);
+    }
+
+    if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
+        return -1;
+
+    rc = qemuMonitorSetMigrationSpeed(priv->mon, bandwidth);
+
+    if (qemuDomainObjExitMonitor(driver, vm) < 0 || rc < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/**
+ * qemuMigrationSrcAutoTune:
+ *
+ * Samples the progress of an outgoing migration after every pass over guest
+ * memory (or periodically if QEMU does not report migration events) and
+ * adjusts its runtime parameters when the guest dirties memory faster than QEMU is able to
+ * transfer it. The bandwidth limit is doubled first as long as the
+ * migration is saturating it; once that does not help and post-copy was
+ * enabled for the migration, QEMU is asked to switch to post-copy.
+ *
+ * Capabilities such as compression or multifd cannot be changed once the
+ * migration started and are thus left untouched.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+qemuMigrationSrcAutoTune(virQEMUDriverPtr driver,
+                         virDomainObjPtr vm,
+                         qemuDomainAsyncJob asyncJob,
+                         qemuMigrationAutoTunePtr tune)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainJobInfoPtr jobInfo = priv->job.current;
+    qemuMonitorMigrationStatsPtr stats = &jobInfo->stats.mig;
+    bool events = virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_MIGRATION_EVENT);
+    unsigned long long pageSize;
+    unsigned long long dirtyRate;
+    unsigned long long now;
+    int rc;
+
+    if (events) {
+        /* ram_iteration is updated by MIGRATION_PASS events; statistics
+         * only need to be fetched once QEMU finished another pass */
+        if (stats->ram_iteration == tune->lastIteration)
+            return 0;
+
+        if (qemuMigrationAnyFetchStats(driver, vm, asyncJob, jobInfo, NULL) < 0)
+            return -1;
+    } else {
+        /* the statistics were just refreshed by qemuMigrationJobCheckStatus */
+        if (virTimeMillisNow(&now) < 0)
+            return -1;
+
+        if (now - tune->lastSample < QEMU_MIGRATION_AUTO_TUNE_INTERVAL)
+            return 0;
+        tune->lastSample = now;
+    }
+    tune->lastIteration = stats->ram_iteration;
+
+    /* The dirty page rate is only known after the first pass over
+     * guest memory finished. */
+    if (stats->status != QEMU_MONITOR_MIGRATION_STATUS_ACTIVE ||
+        stats->ram_iteration < 2 ||
+        stats->ram_bps == 0)
+        return 0;
+
+    pageSize = stats->ram_page_size;
+    if (pageSize == 0)
+        pageSize = QEMU_MIGRATION_AUTO_TUNE_PAGE_SIZE;
+    dirtyRate = stats->ram_dirty_rate * pageSize;
+
+    VIR_DEBUG("Auto-tune sample: dirty rate %llu B/s, transfer rate %llu B/s, "
+              "expected downtime %llu ms (target %llu ms)",
+              dirtyRate, stats->ram_bps,
+              stats->downtime_set ? stats->downtime : 0, tune->downtime);
+
+    /* Migration converges when the remaining memory shrinks faster than
+     * the guest dirties it; leave a 10% margin for the noisy estimate. */
+    if ((stats->downtime_set && stats->downtime <= tune->downtime) ||
+        dirtyRate < stats->ram_bps / 10 * 9) {
+        tune->stalled = 0;
+        return 0;
+    }
+
+    if (++tune->stalled < QEMU_MIGRATION_AUTO_TUNE_STALLED)
+        return 0;
+    tune->stalled = 0;
+
+    if (tune->bandwidth < QEMU_DOMAIN_MIG_BANDWIDTH_MAX &&
+        stats->ram_bps >= tune->bandwidth * 1024ULL * 1024 / 10 * 9) {
+        unsigned long bandwidth = QEMU_DOMAIN_MIG_BANDWIDTH_MAX;
+
+        if (tune->bandwidth < QEMU_DOMAIN_MIG_BANDWIDTH_MAX / 2)
+            bandwidth = tune->bandwidth * 2;
+
+        VIR_DEBUG("Migration does not converge, raising bandwidth limit "
+                  "from %lu MiB/s to %lu MiB/s", tune->bandwidth, bandwidth);
+
+        if (qemuMigrationSrcAutoTuneSetSpeed(driver, vm, asyncJob,
+                                             bandwidth) < 0)
+            return -1;
+
+        tune->bandwidth = bandwidth;
+        return 0;
+    }
+
+    if (tune->postcopy) {
+        VIR_DEBUG("Migration does not converge, switching to post-copy");
+
+        if (qemuDomainObjEnterMonitorAsync(driver, vm, asyncJob) < 0)
+            return -1;
+
+        rc = qemuMonitorMigrateStartPostCopy(priv->mon);
+
+        if (qemuDomainObjExitMonitor(driver, vm) < 0 || rc < 0)
+            return -1;
+
+        tune->postcopy = false;
+        return 0;
+    }
+
+    VIR_DEBUG("Migration does not converge and cannot be tuned any further");
+    return 0;
+}
+
+
 /* Returns 0 on success, -2 when migration needs to be cancelled, or -1 when
  * QEMU reports failed migration.
  */
@@ -1708,7 +2107,8 @@ qemuMigrationSrcWaitForCompletion(virQEMUDriverPtr driver,
                                   virDomainObjPtr vm,
                                   qemuDomainAsyncJob asyncJob,
                                   virConnectPtr dconn,
-                                  unsigned int flags)
+                                  unsigned int flags,
+                                  qemuMigrationAutoTunePtr tune)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
     qemuDomainJobInfoPtr jobInfo = priv->job.current;
@@ -1722,6 +2122,12 @@ qemuMigrationSrcWaitForCompletion(virQEMUDriverPtr driver,
         if (rv < 0)
             return rv;
 
+        if (tune &&
+            qemuMigrationSrcAutoTune(driver, vm, asyncJob, tune) < 0) {
+            jobInfo->status = QEMU_DOMAIN_JOB_STATUS_FAILED;
+            return -2;
+        }
+
         if (events) {
             if (virDomainObjWait(vm) < 0) {
                 if (virDomainObjIsActive(vm))
@@ -2165,6 +2571,11 @@ qemuMigrationSrcBeginPhase(virQEMUDriverPtr driver,
     if (!(flags & VIR_MIGRATE_OFFLINE))
         cookieFlags |= QEMU_MIGRATION_COOKIE_CAPS;
 
+    /* Offer parallel tunnel streams, the destination decides how many */
+    if (flags & VIR_MIGRATE_TUNNELLED &&
+        flags & VIR_MIGRATE_PARALLEL)
+        cookieFlags |= QEMU_MIGRATION_COOKIE_TUNNEL;
+
     if (!(mig = qemuMigrationEatCookie(driver, vm->def,
                                        priv->origname, priv, NULL, 0, 0)))
         return NULL;
@@ -2302,14 +2713,86 @@ qemuMigrationDstPrepareCleanup(virQEMUDriverPtr driver,
     virPortAllocatorRelease(priv->migrationPort);
     priv->migrationPort = 0;
 
+    VIR_FREE(priv->migrationTunnelSocket);
+    priv->migrationTunnelChannels = 0;
+
     if (!qemuMigrationJobIsActive(vm, QEMU_ASYNC_JOB_MIGRATION_IN))
         return;
     qemuDomainObjDiscardAsyncJob(driver, vm);
 }
 
+/*
+ * Connects a new stream to the socket on which the incoming QEMU listens
+ * for tunnelled migration with parallel streams.
+ */
+static int
+qemuMigrationDstTunnelConnect(virDomainObjPtr vm,
+                              virStreamPtr st)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    virNetSocketPtr sock = NULL;
+    VIR_AUTOCLOSE fd = -1;
+
+    if (virNetSocketNewConnectUNIX(priv->migrationTunnelSocket,
+                                   false, NULL, &sock) < 0)
+        return -1;
+
+    fd = virNetSocketDupFD(sock, true);
+    virObjectUnref(sock);
+    if (fd < 0)
+        return -1;
+
+    if (virFDStreamOpen(st, fd) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot pass socket for tunnelled migration"));
+        return -1;
+    }
+    fd = -1; /* 'st' owns the FD now & will close it */
+
+    return 0;
+}
+
+
+/*
+ * Attaches an additional stream of a tunnelled migration with parallel
+ * streams to the incoming domain @vm. QEMU tells the streams apart by
+ * their content, we just check the stream is one of those agreed on in
+ * the Prepare phase.
+ */
+int
+qemuMigrationDstTunnelChannel(virQEMUDriverPtr driver G_GNUC_UNUSED,
+                              virDomainObjPtr vm,
+                              virStreamPtr st,
+                              unsigned int channel)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    VIR_DEBUG("vm=%s, st=%p, channel=%u", vm->def->name, st, channel);
+
+    if (!qemuMigrationJobIsActive(vm, QEMU_ASYNC_JOB_MIGRATION_IN) ||
+        !priv->migrationTunnelSocket) {
+        virReportError(VIR_ERR_OPERATION_INVALID,
+                       _("domain '%s' is not waiting for tunnelled migration "
+                         "streams"), vm->def->name);
+        return -1;
+    }
+
+    if (channel >= priv->migrationTunnelChannels) {
+        virReportError(VIR_ERR_INVALID_ARG,
+                       _("migration stream %u out of range, only %u parallel "
+                         "streams were negotiated"),
+                       channel, priv->migrationTunnelChannels);
+        return -1;
+    }
+
+    return qemuMigrationDstTunnelConnect(vm, st);
+}
+
+
 static qemuProcessIncomingDefPtr
 qemuMigrationDstPrepare(virDomainObjPtr vm,
                         bool tunnel,
+                        const char *tunnelSocket,
                         const char *protocol,
                         const char *listenAddress,
                         unsigned short port,
@@ -2318,7 +2801,9 @@ qemuMigrationDstPrepare(virDomainObjPtr vm,
     qemuDomainObjPrivatePtr priv = vm->privateData;
     g_autofree char *migrateFrom = NULL;
 
-    if (tunnel) {
+    if (tunnel && tunnelSocket) {
+        migrateFrom = g_strdup_printf("unix:%s", tunnelSocket);
+    } else if (tunnel) {
         migrateFrom = g_strdup("stdio");
     } else {
         bool encloseAddress = false;
@@ -2409,6 +2894,8 @@ qemuMigrationDstPrepareAny(virQEMUDriverPtr driver,
     bool relabel = false;
     int rv;
     g_autofree char *tlsAlias = NULL;
+    bool tunnelOffered = false;
+    unsigned int tunnelChannels = 0;
 
     virNWFilterReadLockFilterUpdates();
 
@@ -2510,7 +2997,8 @@ qemuMigrationDstPrepareAny(virQEMUDriverPtr driver,
                                        QEMU_MIGRATION_COOKIE_CPU_HOTPLUG |
                                        QEMU_MIGRATION_COOKIE_CPU |
                                        QEMU_MIGRATION_COOKIE_ALLOW_REBOOT |
-                                       QEMU_MIGRATION_COOKIE_CAPS)))
+                                       QEMU_MIGRATION_COOKIE_CAPS |
+                                       QEMU_MIGRATION_COOKIE_TUNNEL)))
         goto cleanup;
 
     if (!(vm = virDomainObjListAdd(driver->domains, *def,
@@ -2551,13 +3039,16 @@ qemuMigrationDstPrepareAny(virQEMUDriverPtr driver,
     /* Domain starts inactive, even if the domain XML had an id field. */
     vm->def->id = -1;
 
+    /* The source offered parallel tunnel streams; we only answer the
+     * offer if we actually accept them */
+    if (mig->flags & QEMU_MIGRATION_COOKIE_TUNNEL) {
+        mig->flags &= ~QEMU_MIGRATION_COOKIE_TUNNEL;
+        tunnelOffered = true;
+    }
+
     if (flags & VIR_MIGRATE_OFFLINE)
         goto done;
 
-    if (tunnel &&
-        virPipe(dataFD) < 0)
-        goto stopjob;
-
     startFlags = VIR_QEMU_PROCESS_START_AUTODESTROY;
 
     if (qemuProcessInit(driver, vm, mig->cpu, QEMU_ASYNC_JOB_MIGRATION_IN,
@@ -2567,8 +3058,23 @@ qemuMigrationDstPrepareAny(virQEMUDriverPtr driver,
 
     priv->allowReboot = mig->allowReboot;
 
-    if (!(incoming = qemuMigrationDstPrepare(vm, tunnel, protocol,
-                                             listenAddress, port,
+    /* Multifd channels can only be tunnelled if QEMU listens on a socket
+     * we can connect to once for every stream. */
+    if (tunnel && tunnelOffered &&
+        flags & VIR_MIGRATE_PARALLEL &&
+        virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_INCOMING_DEFER)) {
+        tunnelChannels = qemuMigrationParamsGetMultifdChannels(migParams);
+        priv->migrationTunnelSocket = g_strdup_printf("%s/migrate-in.sock",
+                                                      priv->libDir);
+    }
+
+    if (tunnel && !tunnelChannels &&
+        virPipe(dataFD) < 0)
+        goto stopjob;
+
+    if (!(incoming = qemuMigrationDstPrepare(vm, tunnel,
+                                             priv->migrationTunnelSocket,
+                                             protocol, listenAddress, port,
                                              dataFD[0])))
         goto stopjob;
 
@@ -2589,7 +3095,7 @@ qemuMigrationDstPrepareAny(virQEMUDriverPtr driver,
     }
     relabel = true;
 
-    if (tunnel) {
+    if (tunnel && !tunnelChannels) {
         if (virFDStreamOpen(st, dataFD[1]) < 0) {
             virReportSystemError(errno, "%s",
                                  _("cannot pass pipe for tunnelled migration"));
@@ -2661,6 +3167,18 @@ qemuMigrationDstPrepareAny(virQEMUDriverPtr driver,
                             QEMU_ASYNC_JOB_MIGRATION_IN) < 0)
         goto stopjob;
 
+    /* QEMU is listening now, the main stream has to be its first
+     * connection; the remaining ones are attached by
+     * qemuMigrationDstTunnelChannel. */
+    if (tunnelChannels) {
+        if (qemuMigrationDstTunnelConnect(vm, st) < 0)
+            goto stopjob;
+
+        priv->migrationTunnelChannels = tunnelChannels;
+        mig->tunnelChannels = tunnelChannels;
+        cookieFlags |= QEMU_MIGRATION_COOKIE_TUNNEL;
+    }
+
     if (qemuProcessFinishStartup(driver, vm, QEMU_ASYNC_JOB_MIGRATION_IN,
                                  false, VIR_DOMAIN_PAUSED_MIGRATION) < 0)
         goto stopjob;
@@ -2710,6 +3228,8 @@ qemuMigrationDstPrepareAny(virQEMUDriverPtr driver,
         /* priv is set right after vm is added to the list of domains
          * and there is no 'goto cleanup;' in the middle of those */
         VIR_FREE(priv->origname);
+        VIR_FREE(priv->migrationTunnelSocket);
+        priv->migrationTunnelChannels = 0;
         /* release if port is auto selected which is not the case if
          * it is given in parameters
          */
@@ -3142,6 +3662,7 @@ enum qemuMigrationDestinationType {
     MIGRATION_DEST_HOST,
     MIGRATION_DEST_CONNECT_HOST,
     MIGRATION_DEST_FD,
+    MIGRATION_DEST_SOCKET,
 };
 
 enum qemuMigrationForwardType {
@@ -3164,12 +3685,22 @@ struct _qemuMigrationSpec {
             int qemu;
             int local;
         } fd;
+
+        struct {
+            const char *path;
+            virNetSocketPtr listen;
+        } socket;
     } dest;
 
     enum qemuMigrationForwardType fwdType;
     union {
         virStreamPtr stream;
     } fwd;
+
+    /* Streams for the connections QEMU opens after the main one, i.e.,
+     * multifd channels, if (destType == MIGRATION_DEST_SOCKET) */
+    virStreamPtr *channels;
+    size_t nchannels;
 };
 
 #define TUNNEL_SEND_BUF_SIZE 65536
@@ -3362,6 +3893,183 @@ qemuMigrationSrcStopTunnel(qemuMigrationIOThreadPtr io, bool error)
     return rv;
 }
 
+
+/* With parallel tunnel streams QEMU connects to a socket we listen on,
+ * once for the main migration stream and once for each multifd channel.
+ * The acceptor hands the connections to migration tunnel threads in the
+ * order they arrive, the first one always being the main stream. */
+typedef struct _qemuMigrationTunnelAccept qemuMigrationTunnelAccept;
+typedef qemuMigrationTunnelAccept *qemuMigrationTunnelAcceptPtr;
+struct _qemuMigrationTunnelAccept {
+    virThread thread;
+    virNetSocketPtr sock;
+    virStreamPtr *streams;
+    size_t nstreams;
+    qemuMigrationIOThreadPtr *io;
+    size_t nio;
+    virError err;
+    int wakeupRecvFD;
+    int wakeupSendFD;
+};
+
+static void qemuMigrationSrcAcceptFunc(void *arg)
+{
+    qemuMigrationTunnelAcceptPtr data = arg;
+    struct pollfd fds[2];
+
+    VIR_DEBUG("Accepting %zu migration tunnel connections", data->nstreams);
+
+    fds[0].fd = virNetSocketGetFD(data->sock);
+    fds[1].fd = data->wakeupRecvFD;
+
+    while (data->nio < data->nstreams) {
+        virNetSocketPtr client = NULL;
+        qemuMigrationIOThreadPtr io;
+        int fd;
+        int ret;
+
+        fds[0].events = fds[1].events = POLLIN;
+        fds[0].revents = fds[1].revents = 0;
+
+        ret = poll(fds, G_N_ELEMENTS(fds), -1);
+
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            virReportSystemError(errno, "%s",
+                                 _("poll failed in migration tunnel"));
+            goto error;
+        }
+
+        if (fds[1].revents & (POLLIN | POLLERR | POLLHUP)) {
+            VIR_DEBUG("Migration tunnel was asked to stop accepting");
+            break;
+        }
+
+        if (!(fds[0].revents & (POLLIN | POLLERR | POLLHUP)))
+            continue;
+
+        if (virNetSocketAccept(data->sock, &client) < 0)
+            goto error;
+
+        /* spurious wakeup */
+        if (!client)
+            continue;
+
+        fd = virNetSocketDupFD(client, true);
+        virObjectUnref(client);
+        if (fd < 0)
+            goto error;
+
+        VIR_DEBUG("Accepted migration tunnel connection %zu", data->nio);
+
+        if (!(io = qemuMigrationSrcStartTunnel(data->streams[data->nio], fd))) {
+            VIR_FORCE_CLOSE(fd);
+            goto error;
+        }
+        data->io[data->nio++] = io;
+    }
+
+    return;
+
+ error:
+    virCopyLastError(&data->err);
+    virResetLastError();
+}
+
+
+static qemuMigrationTunnelAcceptPtr
+qemuMigrationSrcStartTunnelAccept(qemuMigrationSpecPtr spec)
+{
+    qemuMigrationTunnelAcceptPtr acc = NULL;
+    int wakeupFD[2] = { -1, -1 };
+    size_t i;
+
+    if (virPipe(wakeupFD) < 0)
+        goto error;
+
+    if (VIR_ALLOC(acc) < 0 ||
+        VIR_ALLOC_N(acc->streams, spec->nchannels + 1) < 0 ||
+        VIR_ALLOC_N(acc->io, spec->nchannels + 1) < 0)
+        goto error;
+
+    acc->sock = spec->dest.socket.listen;
+    acc->streams[0] = spec->fwd.stream;
+    for (i = 0; i < spec->nchannels; i++)
+        acc->streams[i + 1] = spec->channels[i];
+    acc->nstreams = spec->nchannels + 1;
+    acc->wakeupRecvFD = wakeupFD[0];
+    acc->wakeupSendFD = wakeupFD[1];
+
+    if (virThreadCreateFull(&acc->thread, true,
+                            qemuMigrationSrcAcceptFunc,
+                            "qemu-mig-accept",
+                            false,
+                            acc) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to create migration thread"));
+        goto error;
+    }
+
+    return acc;
+
+ error:
+    VIR_FORCE_CLOSE(wakeupFD[0]);
+    VIR_FORCE_CLOSE(wakeupFD[1]);
+    if (acc) {
+        VIR_FREE(acc->streams);
+        VIR_FREE(acc->io);
+    }
+    VIR_FREE(acc);
+    return NULL;
+}
+
+
+static int
+qemuMigrationSrcStopTunnelAccept(qemuMigrationTunnelAcceptPtr acc,
+                                 bool error)
+{
+    int rv = -1;
+    char stop = 1;
+    size_t i;
+
+    /* make sure the acceptor doesn't wait for more connections */
+    if (safewrite(acc->wakeupSendFD, &stop, 1) != 1) {
+        virReportSystemError(errno, "%s",
+                             _("failed to wakeup migration tunnel"));
+        goto cleanup;
+    }
+
+    virThreadJoin(&acc->thread);
+
+    rv = 0;
+
+    for (i = 0; i < acc->nio; i++) {
+        if (qemuMigrationSrcStopTunnel(acc->io[i], error) < 0)
+            rv = -1;
+    }
+
+    /* Streams QEMU never connected to have nothing to send */
+    for (i = acc->nio; i < acc->nstreams; i++)
+        virStreamAbort(acc->streams[i]);
+
+    if (acc->err.code != VIR_ERR_OK) {
+        if (!error && rv == 0) {
+            virSetError(&acc->err);
+            rv = -1;
+        }
+        virResetError(&acc->err);
+    }
+
+ cleanup:
+    VIR_FORCE_CLOSE(acc->wakeupSendFD);
+    VIR_FORCE_CLOSE(acc->wakeupRecvFD);
+    VIR_FREE(acc->streams);
+    VIR_FREE(acc->io);
+    VIR_FREE(acc);
+    return rv;
+}
+
 static int
 qemuMigrationSrcConnect(virQEMUDriverPtr driver,
                         virDomainObjPtr vm,
@@ -3482,6 +4190,7 @@ qemuMigrationSrcRun(virQEMUDriverPtr driver,
     g_autoptr(qemuMigrationCookie) mig = NULL;
     g_autofree char *tlsAlias = NULL;
     qemuMigrationIOThreadPtr iothread = NULL;
+    qemuMigrationTunnelAcceptPtr tunnelAccept = NULL;
     VIR_AUTOCLOSE fd = -1;
     unsigned long migrate_speed = resource ? resource : priv->migMaxBandwidth;
     virErrorPtr orig_err = NULL;
@@ -3492,6 +4201,8 @@ qemuMigrationSrcRun(virQEMUDriverPtr driver,
     bool cancel = false;
     unsigned int waitFlags;
     g_autoptr(virDomainDef) persistDef = NULL;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuMigrationAutoTune tune = { 0 };
     g_autofree char *timestamp = NULL;
     int rc;
 
@@ -3647,6 +4358,15 @@ qemuMigrationSrcRun(virQEMUDriverPtr driver,
         qemuMonitorSetMigrationSpeed(priv->mon, migrate_speed) < 0)
         goto exit_monitor;
 
+    if (cfg->migrationAutoTuneDowntime > 0) {
+        tune.downtime = cfg->migrationAutoTuneDowntime;
+        tune.bandwidth = migrate_speed;
+        tune.postcopy = !!(flags & VIR_MIGRATE_POSTCOPY);
+
+        if (qemuMonitorSetMigrationDowntime(priv->mon, tune.downtime) < 0)
+            goto exit_monitor;
+    }
+
     /* connect to the destination qemu if needed */
     if (spec->destType == MIGRATION_DEST_CONNECT_HOST &&
         qemuMigrationSrcConnect(driver, vm, spec) < 0) {
@@ -3683,6 +4403,11 @@ qemuMigrationSrcRun(virQEMUDriverPtr driver,
                                     spec->dest.fd.qemu);
         VIR_FORCE_CLOSE(spec->dest.fd.qemu);
         break;
+
+    case MIGRATION_DEST_SOCKET:
+        rc = qemuMonitorMigrateToSocket(priv->mon, migrate_flags,
+                                        spec->dest.socket.path);
+        break;
     }
 
     if (qemuDomainObjExitMonitor(driver, vm) < 0 || rc < 0)
@@ -3692,7 +4417,11 @@ qemuMigrationSrcRun(virQEMUDriverPtr driver,
      * migration on source if anything goes wrong */
     cancel = true;
 
-    if (spec->fwdType != MIGRATION_FWD_DIRECT) {
+    if (spec->fwdType != MIGRATION_FWD_DIRECT &&
+        spec->destType == MIGRATION_DEST_SOCKET) {
+        if (!(tunnelAccept = qemuMigrationSrcStartTunnelAccept(spec)))
+            goto error;
+    } else if (spec->fwdType != MIGRATION_FWD_DIRECT) {
         if (!(iothread = qemuMigrationSrcStartTunnel(spec->fwd.stream, fd)))
             goto error;
         /* If we've created a tunnel, then the 'fd' will be closed in the
@@ -3711,7 +4440,8 @@ qemuMigrationSrcRun(virQEMUDriverPtr driver,
 
     rc = qemuMigrationSrcWaitForCompletion(driver, vm,
                                            QEMU_ASYNC_JOB_MIGRATION_OUT,
-                                           dconn, waitFlags);
+                                           dconn, waitFlags,
+                                           tune.downtime ? &tune : NULL);
     if (rc == -2) {
         goto error;
     } else if (rc == -1) {
@@ -3751,7 +4481,7 @@ qemuMigrationSrcRun(virQEMUDriverPtr driver,
 
         rc = qemuMigrationSrcWaitForCompletion(driver, vm,
                                                QEMU_ASYNC_JOB_MIGRATION_OUT,
-                                               dconn, waitFlags);
+                                               dconn, waitFlags, NULL);
         if (rc == -2) {
             goto error;
         } else if (rc == -1) {
@@ -3769,6 +4499,14 @@ qemuMigrationSrcRun(virQEMUDriverPtr driver,
             goto error;
     }
 
+    if (tunnelAccept) {
+        qemuMigrationTunnelAcceptPtr acc;
+
+        acc = g_steal_pointer(&tunnelAccept);
+        if (qemuMigrationSrcStopTunnelAccept(acc, false) < 0)
+            goto error;
+    }
+
     if (priv->job.completed) {
         priv->job.completed->stopped = priv->job.current->stopped;
         qemuDomainJobInfoUpdateTime(priv->job.completed);
@@ -3821,6 +4559,9 @@ qemuMigrationSrcRun(virQEMUDriverPtr driver,
     if (iothread)
         qemuMigrationSrcStopTunnel(iothread, true);
 
+    if (tunnelAccept)
+        qemuMigrationSrcStopTunnelAccept(tunnelAccept, true);
+
     goto cleanup;
 
  exit_monitor:
@@ -3909,6 +4650,103 @@ qemuMigrationSrcPerformNative(virQEMUDriverPtr driver,
 }
 
 
+static int virConnectCredType[] = {
+    VIR_CRED_AUTHNAME,
+    VIR_CRED_PASSPHRASE,
+};
+
+
+static virConnectAuth virConnectAuthConfig = {
+    .credtype = virConnectCredType,
+    .ncredtype = G_N_ELEMENTS(virConnectCredType),
+};
+
+
+typedef struct _qemuMigrationTunnelChannels qemuMigrationTunnelChannels;
+typedef qemuMigrationTunnelChannels *qemuMigrationTunnelChannelsPtr;
+struct _qemuMigrationTunnelChannels {
+    size_t nchannels;
+    virConnectPtr *conns;
+    virStreamPtr *streams;
+};
+
+
+static void
+qemuMigrationSrcCloseTunnelChannels(qemuMigrationTunnelChannelsPtr channels)
+{
+    size_t i;
+
+    for (i = 0; i < channels->nchannels; i++) {
+        virObjectUnref(channels->streams[i]);
+        if (channels->conns[i])
+            virConnectClose(channels->conns[i]);
+    }
+
+    VIR_FREE(channels->streams);
+    VIR_FREE(channels->conns);
+    channels->nchannels = 0;
+}
+
+
+/*
+ * Every parallel stream of a tunnelled migration gets its own connection
+ * to the destination daemon so that the streams are not serialized by a
+ * single RPC client and its TLS session.
+ */
+static int
+qemuMigrationSrcOpenTunnelChannels(virDomainObjPtr vm,
+                                   const char *dconnuri,
+                                   size_t nchannels,
+                                   qemuMigrationTunnelChannelsPtr channels)
+{
+    virDomainPtr ddomain = NULL;
+    size_t i;
+    int ret = -1;
+
+    VIR_DEBUG("vm=%s, dconnuri=%s, nchannels=%zu",
+              vm->def->name, dconnuri, nchannels);
+
+    if (VIR_ALLOC_N(channels->conns, nchannels) < 0 ||
+        VIR_ALLOC_N(channels->streams, nchannels) < 0)
+        return -1;
+    channels->nchannels = nchannels;
+
+    qemuDomainObjEnterRemote(vm);
+
+    for (i = 0; i < nchannels; i++) {
+        if (!(channels->conns[i] = virConnectOpenAuth(dconnuri,
+                                                      &virConnectAuthConfig,
+                                                      0))) {
+            virReportError(VIR_ERR_OPERATION_FAILED,
+                           _("Failed to connect to remote libvirt URI %s: %s"),
+                           dconnuri, virGetLastErrorMessage());
+            goto exit_remote;
+        }
+
+        if (!(channels->streams[i] = virStreamNew(channels->conns[i], 0)) ||
+            !(ddomain = virDomainLookupByUUID(channels->conns[i],
+                                              vm->def->uuid)))
+            goto exit_remote;
+
+        if (virDomainMigrateTunnelChannel(ddomain, channels->streams[i],
+                                          i, 0) < 0)
+            goto exit_remote;
+
+        virObjectUnref(ddomain);
+        ddomain = NULL;
+    }
+
+    ret = 0;
+
+ exit_remote:
+    virObjectUnref(ddomain);
+    if (qemuDomainObjExitRemote(vm, true) < 0)
+        ret = -1;
+
+    return ret;
+}
+
+
 static int
 qemuMigrationSrcPerformTunnel(virQEMUDriverPtr driver,
                               virDomainObjPtr vm,
@@ -3921,6 +4759,7 @@ qemuMigrationSrcPerformTunnel(virQEMUDriverPtr driver,
                               unsigned long flags,
                               unsigned long resource,
                               virConnectPtr dconn,
+                              const char *dconnuri,
                               const char *graphicsuri,
                               size_t nmigrate_disks,
                               const char **migrate_disks,
@@ -3928,36 +4767,78 @@ qemuMigrationSrcPerformTunnel(virQEMUDriverPtr driver,
 {
     int ret = -1;
     qemuMigrationSpec spec;
+    qemuDomainObjPrivatePtr priv = vm->privateData;
     virQEMUDriverConfigPtr cfg = virQEMUDriverGetConfig(driver);
     int fds[2] = { -1, -1 };
+    qemuMigrationTunnelChannels channels = { 0 };
+    g_autofree char *socketPath = NULL;
+    virNetSocketPtr sock = NULL;
 
     VIR_DEBUG("driver=%p, vm=%p, st=%p, cookiein=%s, cookieinlen=%d, "
               "cookieout=%p, cookieoutlen=%p, flags=0x%lx, resource=%lu, "
-              "graphicsuri=%s, nmigrate_disks=%zu, migrate_disks=%p",
+              "dconnuri=%s, graphicsuri=%s, nmigrate_disks=%zu, "
+              "migrate_disks=%p",
               driver, vm, st, NULLSTR(cookiein), cookieinlen,
-              cookieout, cookieoutlen, flags, resource,
+              cookieout, cookieoutlen, flags, resource, NULLSTR(dconnuri),
               NULLSTR(graphicsuri), nmigrate_disks, migrate_disks);
 
+    memset(&spec, 0, sizeof(spec));
     spec.fwdType = MIGRATION_FWD_STREAM;
     spec.fwd.stream = st;
 
+    if (flags & VIR_MIGRATE_PARALLEL) {
+        g_autoptr(qemuMigrationCookie) mig = NULL;
 
-    spec.destType = MIGRATION_DEST_FD;
-    spec.dest.fd.qemu = -1;
-    spec.dest.fd.local = -1;
+        if (!(mig = qemuMigrationEatCookie(driver, vm->def, priv->origname,
+                                           priv, cookiein, cookieinlen,
+                                           QEMU_MIGRATION_COOKIE_TUNNEL)))
+            goto cleanup;
 
-    if (virPipe(fds) < 0)
-        goto cleanup;
+        if (!dconnuri || mig->tunnelChannels == 0) {
+            virReportError(VIR_ERR_OPERATION_UNSUPPORTED, "%s",
+                           _("destination does not support parallel "
+                             "tunnelled migration"));
+            goto cleanup;
+        }
+
+        if (qemuMigrationSrcOpenTunnelChannels(vm, dconnuri,
+                                               mig->tunnelChannels,
+                                               &channels) < 0)
+            goto cleanup;
 
-    spec.dest.fd.qemu = fds[1];
-    spec.dest.fd.local = fds[0];
+        socketPath = g_strdup_printf("%s/migrate-out.sock", priv->libDir);
 
-    if (spec.dest.fd.qemu == -1 ||
-        qemuSecuritySetImageFDLabel(driver->securityManager, vm->def,
-                                    spec.dest.fd.qemu) < 0) {
-        virReportSystemError(errno, "%s",
-                             _("cannot create pipe for tunnelled migration"));
-        goto cleanup;
+        if (virNetSocketNewListenUNIX(socketPath, 0700, cfg->user, cfg->group,
+                                      &sock) < 0 ||
+            virNetSocketListen(sock, channels.nchannels + 1) < 0)
+            goto cleanup;
+
+        if (qemuSecurityDomainSetPathLabel(driver, vm, socketPath, false) < 0)
+            goto cleanup;
+
+        spec.destType = MIGRATION_DEST_SOCKET;
+        spec.dest.socket.path = socketPath;
+        spec.dest.socket.listen = sock;
+        spec.channels = channels.streams;
+        spec.nchannels = channels.nchannels;
+    } else {
+        spec.destType = MIGRATION_DEST_FD;
+        spec.dest.fd.qemu = -1;
+        spec.dest.fd.local = -1;
+
+        if (virPipe(fds) < 0)
+            goto cleanup;
+
+        spec.dest.fd.qemu = fds[1];
+        spec.dest.fd.local = fds[0];
+
+        if (spec.dest.fd.qemu == -1 ||
+            qemuSecuritySetImageFDLabel(driver->securityManager, vm->def,
+                                        spec.dest.fd.qemu) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot create pipe for tunnelled migration"));
+            goto cleanup;
+        }
     }
 
     ret = qemuMigrationSrcRun(driver, vm, persist_xml, cookiein, cookieinlen,
@@ -3966,8 +4847,16 @@ qemuMigrationSrcPerformTunnel(virQEMUDriverPtr driver,
                               migParams);
 
  cleanup:
-    VIR_FORCE_CLOSE(spec.dest.fd.qemu);
-    VIR_FORCE_CLOSE(spec.dest.fd.local);
+    if (spec.destType == MIGRATION_DEST_FD) {
+        VIR_FORCE_CLOSE(spec.dest.fd.qemu);
+        VIR_FORCE_CLOSE(spec.dest.fd.local);
+    }
+
+    if (sock) {
+        virNetSocketClose(sock);
+        virObjectUnref(sock);
+    }
+    qemuMigrationSrcCloseTunnelChannels(&channels);
 
     virObjectUnref(cfg);
     return ret;
@@ -4063,7 +4952,7 @@ qemuMigrationSrcPerformPeer2Peer2(virQEMUDriverPtr driver,
     if (flags & VIR_MIGRATE_TUNNELLED)
         ret = qemuMigrationSrcPerformTunnel(driver, vm, st, NULL,
                                             NULL, 0, NULL, NULL,
-                                            flags, resource, dconn,
+                                            flags, resource, dconn, NULL,
                                             NULL, 0, NULL, migParams);
     else
         ret = qemuMigrationSrcPerformNative(driver, vm, NULL, uri_out,
@@ -4306,9 +5195,9 @@ qemuMigrationSrcPerformPeer2Peer3(virQEMUDriverPtr driver,
         ret = qemuMigrationSrcPerformTunnel(driver, vm, st, persist_xml,
                                             cookiein, cookieinlen,
                                             &cookieout, &cookieoutlen,
-                                            flags, bandwidth, dconn, graphicsuri,
-                                            nmigrate_disks, migrate_disks,
-                                            migParams);
+                                            flags, bandwidth, dconn, dconnuri,
+                                            graphicsuri, nmigrate_disks,
+                                            migrate_disks, migParams);
     } else {
         ret = qemuMigrationSrcPerformNative(driver, vm, persist_xml, uri,
                                             cookiein, cookieinlen,
@@ -4465,18 +5354,6 @@ qemuMigrationSrcConnectionClosed(virConnectPtr conn,
 }
 
 
-static int virConnectCredType[] = {
-    VIR_CRED_AUTHNAME,
-    VIR_CRED_PASSPHRASE,
-};
-
-
-static virConnectAuth virConnectAuthConfig = {
-    .credtype = virConnectCredType,
-    .ncredtype = G_N_ELEMENTS(virConnectCredType),
-};
-
-
 static int
 qemuMigrationSrcPerformPeer2Peer(virQEMUDriverPtr driver,
                                  virConnectPtr sconn,
@@ -4955,7 +5832,10 @@ qemuMigrationDstPersist(virQEMUDriverPtr driver,
                                                priv->qemuCaps)))
         goto error;
 
-    if (virDomainDefSave(vmdef, driver->xmlopt, cfg->configDir) < 0 &&
+    /* The source removes its copy of the config once migration finishes,
+     * so ours must not stay in the write behind queue */
+    if ((virDomainDefSave(vmdef, driver->xmlopt, cfg->configDir) < 0 ||
+         virWriteBehindFlush() < 0) &&
         !ignoreSaveError)
         goto error;
 
@@ -5260,6 +6140,8 @@ qemuMigrationDstFinish(virQEMUDriverPtr driver,
     if (priv->mon)
         qemuMonitorSetDomainLog(priv->mon, NULL, NULL, NULL);
     VIR_FREE(priv->origname);
+    VIR_FREE(priv->migrationTunnelSocket);
+    priv->migrationTunnelChannels = 0;
     virDomainObjEndAPI(&vm);
     virErrorRestore(&orig_err);
 
@@ -5369,7 +6251,8 @@ qemuMigrationSrcToFile(virQEMUDriverPtr driver, virDomainObjPtr vm,
     if (rc < 0)
         goto cleanup;
 
-    rc = qemuMigrationSrcWaitForCompletion(driver, vm, asyncJob, NULL, 0);
+    rc = qemuMigrationSrcWaitForCompletion(driver, vm, asyncJob,
+                                           NULL, 0, NULL);
 
     if (rc < 0) {
         if (rc == -2) {
@@ -134,6 +134,12 @@ qemuMigrationDstPrepareTunnel(virQEMUDriverPtr driver,
                               qemuMigrationParamsPtr migParams,
                               unsigned long flags);
 
+int
+qemuMigrationDstTunnelChannel(virQEMUDriverPtr driver,
+                              virDomainObjPtr vm,
+                              virStreamPtr st,
+                              unsigned int channel);
+
 int
 qemuMigrationDstPrepareDirect(virQEMUDriverPtr driver,
                               virConnectPtr dconn,
@@ -18,6 +18,7 @@
 
 #include <config.h>
 
+#include <gio/gio.h>
 #include <gnutls/gnutls.h>
 #include <gnutls/x509.h>
 
@@ -51,8 +52,13 @@ VIR_ENUM_IMPL(qemuMigrationCookieFlag,
               "cpu",
               "allowReboot",
               "capabilities",
+              "tunnel",
+              "compress",
 );
 
+/* Upper limit for the size of a decompressed cookie */
+#define QEMU_MIGRATION_COOKIE_MAX_SIZE (64 * 1024 * 1024)
+
 
 static void
 qemuMigrationCookieGraphicsFree(qemuMigrationCookieGraphicsPtr grap)
@@ -858,6 +864,17 @@ qemuMigrationCookieXMLFormat(virQEMUDriverPtr driver,
     if (mig->flags & QEMU_MIGRATION_COOKIE_CAPS)
         qemuMigrationCookieCapsXMLFormat(buf, mig->caps);
 
+    if (mig->flags & QEMU_MIGRATION_COOKIE_TUNNEL) {
+        if (mig->tunnelChannels)
+            virBufferAsprintf(buf, "<tunnel channels='%u'/>\n",
+                              mig->tunnelChannels);
+        else
+            virBufferAddLit(buf, "<tunnel/>\n");
+    }
+
+    if (mig->flags & QEMU_MIGRATION_COOKIE_COMPRESS)
+        virBufferAddLit(buf, "<compress/>\n");
+
     virBufferAdjustIndent(buf, -2);
     virBufferAddLit(buf, "</qemu-migration>\n");
     return 0;
@@ -1355,6 +1372,22 @@ qemuMigrationCookieXMLParse(qemuMigrationCookiePtr mig,
         !(mig->caps = qemuMigrationCookieCapsXMLParse(ctxt)))
         goto error;
 
+    if (flags & QEMU_MIGRATION_COOKIE_TUNNEL &&
+        virXPathBoolean("boolean(./tunnel)", ctxt)) {
+        if (virXPathBoolean("boolean(./tunnel/@channels)", ctxt) &&
+            virXPathUInt("string(./tunnel/@channels)", ctxt,
+                         &mig->tunnelChannels) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("malformed tunnel channels in migration data"));
+            goto error;
+        }
+        mig->flags |= QEMU_MIGRATION_COOKIE_TUNNEL;
+    }
+
+    /* Not tied to any phase: the peer understands compressed cookies */
+    if (virXPathBoolean("boolean(./compress)", ctxt))
+        mig->flags |= QEMU_MIGRATION_COOKIE_COMPRESS;
+
     return 0;
 
  error:
@@ -1390,6 +1423,109 @@ qemuMigrationCookieXMLParseStr(qemuMigrationCookiePtr mig,
 }
 
 
+/**
+ * qemuMigrationCookieCompress:
+ * @cookie: NUL terminated XML cookie, replaced by the compressed data
+ * @cookielen: length of @cookie including the NUL byte, updated
+ *
+ * Compresses the XML cookie with gzip. The result is recognized by its
+ * magic bytes, which can never start a cookie in the XML format.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+qemuMigrationCookieCompress(char **cookie,
+                            int *cookielen)
+{
+    g_autoptr(GOutputStream) mem = g_memory_output_stream_new_resizable();
+    g_autoptr(GZlibCompressor) compressor = NULL;
+    g_autoptr(GOutputStream) stream = NULL;
+    g_autoptr(GError) err = NULL;
+
+    compressor = g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1);
+    stream = g_converter_output_stream_new(mem, G_CONVERTER(compressor));
+
+    if (!g_output_stream_write_all(stream, *cookie, *cookielen,
+                                   NULL, NULL, &err) ||
+        !g_output_stream_close(stream, NULL, &err)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("failed to compress migration cookie: %s"),
+                       err->message);
+        return -1;
+    }
+
+    g_free(*cookie);
+    *cookielen = g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(mem));
+    *cookie = g_memory_output_stream_steal_data(G_MEMORY_OUTPUT_STREAM(mem));
+
+    return 0;
+}
+
+
+static bool
+qemuMigrationCookieIsCompressed(const char *cookie,
+                                int cookielen)
+{
+    return cookielen >= 2 &&
+           (unsigned char) cookie[0] == 0x1f &&
+           (unsigned char) cookie[1] == 0x8b;
+}
+
+
+/**
+ * qemuMigrationCookieDecompress:
+ * @cookie: gzip compressed cookie
+ * @cookielen: length of @cookie
+ * @xml: filled in with the NUL terminated XML cookie
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+qemuMigrationCookieDecompress(const char *cookie,
+                              int cookielen,
+                              char **xml)
+{
+    g_autoptr(GInputStream) mem = NULL;
+    g_autoptr(GZlibDecompressor) decompressor = NULL;
+    g_autoptr(GInputStream) stream = NULL;
+    g_autoptr(GByteArray) data = g_byte_array_new();
+    g_autoptr(GError) err = NULL;
+    guint8 buf[8192];
+    gssize got;
+
+    mem = g_memory_input_stream_new_from_data(cookie, cookielen, NULL);
+    decompressor = g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+    stream = g_converter_input_stream_new(mem, G_CONVERTER(decompressor));
+
+    while ((got = g_input_stream_read(stream, buf, sizeof(buf),
+                                      NULL, &err)) > 0) {
+        if (data->len + got > QEMU_MIGRATION_COOKIE_MAX_SIZE) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("migration cookie exceeds maximum size %d"),
+                           QEMU_MIGRATION_COOKIE_MAX_SIZE);
+            return -1;
+        }
+        g_byte_array_append(data, buf, got);
+    }
+
+    if (got < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("failed to decompress migration cookie: %s"),
+                       err->message);
+        return -1;
+    }
+
+    if (data->len == 0 || data->data[data->len - 1] != '\0') {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Migration cookie was not NULL terminated"));
+        return -1;
+    }
+
+    *xml = (char *) g_byte_array_free(g_steal_pointer(&data), FALSE);
+    return 0;
+}
+
+
 int
 qemuMigrationBakeCookie(qemuMigrationCookiePtr mig,
                         virQEMUDriverPtr driver,
@@ -1400,12 +1536,17 @@ qemuMigrationBakeCookie(qemuMigrationCookiePtr mig,
                         unsigned int flags)
 {
     qemuDomainObjPrivatePtr priv = dom->privateData;
+    bool compress = !!(mig->flags & QEMU_MIGRATION_COOKIE_COMPRESS);
 
     if (!cookieout || !cookieoutlen)
         return 0;
 
     *cookieoutlen = 0;
 
+    /* Always advertise we can read compressed cookies, but only send one
+     * if the peer did the same in the cookie we got from it. */
+    mig->flags |= QEMU_MIGRATION_COOKIE_COMPRESS;
+
     if (flags & QEMU_MIGRATION_COOKIE_GRAPHICS &&
         qemuMigrationCookieAddGraphics(mig, driver, dom) < 0)
         return -1;
@@ -1444,6 +1585,9 @@ qemuMigrationBakeCookie(qemuMigrationCookiePtr mig,
         qemuMigrationCookieAddCaps(mig, dom, party) < 0)
         return -1;
 
+    if (flags & QEMU_MIGRATION_COOKIE_TUNNEL)
+        mig->flags |= QEMU_MIGRATION_COOKIE_TUNNEL;
+
     if (!(*cookieout = qemuMigrationCookieXMLFormatStr(driver, priv->qemuCaps, mig)))
         return -1;
 
@@ -1451,6 +1595,16 @@ qemuMigrationBakeCookie(qemuMigrationCookiePtr mig,
 
     VIR_DEBUG("cookielen=%d cookie=%s", *cookieoutlen, *cookieout);
 
+    if (compress) {
+        if (qemuMigrationCookieCompress(cookieout, cookieoutlen) < 0) {
+            VIR_FREE(*cookieout);
+            *cookieoutlen = 0;
+            return -1;
+        }
+
+        VIR_DEBUG("compressed cookielen=%d", *cookieoutlen);
+    }
+
     return 0;
 }
 
@@ -1465,6 +1619,16 @@ qemuMigrationEatCookie(virQEMUDriverPtr driver,
                        unsigned int flags)
 {
     g_autoptr(qemuMigrationCookie) mig = NULL;
+    g_autofree char *xml = NULL;
+
+    if (cookiein && cookieinlen &&
+        qemuMigrationCookieIsCompressed(cookiein, cookieinlen)) {
+        if (qemuMigrationCookieDecompress(cookiein, cookieinlen, &xml) < 0)
+            return NULL;
+
+        cookiein = xml;
+        cookieinlen = strlen(xml) + 1;
+    }
 
     /* Parse & validate incoming cookie (if any) */
     if (cookiein && cookieinlen &&
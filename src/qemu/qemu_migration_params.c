@@ -40,6 +40,9 @@ VIR_LOG_INIT("qemu.qemu_migration_params");
 
 #define QEMU_MIGRATION_TLS_ALIAS_BASE "libvirt_migrate"
 
+/* Number of multifd channels QEMU uses unless told otherwise */
+#define QEMU_MIGRATION_MULTIFD_CHANNELS_DEFAULT 2
+
 typedef enum {
     QEMU_MIGRATION_PARAM_TYPE_INT,
     QEMU_MIGRATION_PARAM_TYPE_ULL,
@@ -1136,6 +1139,27 @@ qemuMigrationParamsGetULL(qemuMigrationParamsPtr migParams,
 }
 
 
+/**
+ * qemuMigrationParamsGetMultifdChannels:
+ * @migParams: migration parameters
+ *
+ * Returns the number of multifd channels QEMU opens for a migration
+ * described by @migParams, i.e., the requested number of channels or
+ * QEMU's default.
+ */
+unsigned int
+qemuMigrationParamsGetMultifdChannels(qemuMigrationParamsPtr migParams)
+{
+    qemuMigrationParamValuePtr pv;
+
+    pv = &migParams->params[QEMU_MIGRATION_PARAM_MULTIFD_CHANNELS];
+    if (pv->set && pv->value.i > 0)
+        return pv->value.i;
+
+    return QEMU_MIGRATION_MULTIFD_CHANNELS_DEFAULT;
+}
+
+
 /**
  * qemuMigrationParamsCheck:
  *
@@ -129,6 +129,9 @@ qemuMigrationParamsGetULL(qemuMigrationParamsPtr migParams,
                           qemuMigrationParam param,
                           unsigned long long *value);
 
+unsigned int
+qemuMigrationParamsGetMultifdChannels(qemuMigrationParamsPtr migParams);
+
 int
 qemuMigrationParamsCheck(virQEMUDriverPtr driver,
                          virDomainObjPtr vm,
@@ -58,6 +58,8 @@ VIR_LOG_INIT("qemu.qemu_monitor");
 #define DEBUG_IO 0
 #define DEBUG_RAW_IO 0
 
+static void qemuMonitorAsyncFailAll(qemuMonitorPtr mon);
+
 /* We read from QEMU until seeing a \r\n pair to indicate a
  * completed reply or event. To avoid memory denial-of-service
  * though, we must have a size limit on amount of data we
@@ -67,6 +69,18 @@ VIR_LOG_INIT("qemu.qemu_monitor");
  */
 #define QEMU_MONITOR_MAX_RESPONSE (10 * 1024 * 1024)
 
+typedef struct _qemuMonitorAsyncMessage qemuMonitorAsyncMessage;
+typedef qemuMonitorAsyncMessage *qemuMonitorAsyncMessagePtr;
+struct _qemuMonitorAsyncMessage {
+    qemuMonitorMessage msg;
+    char *cmdname;
+    char *id;
+    unsigned long long sent;
+
+    qemuMonitorAsyncCallback cb;
+    void *opaque;
+};
+
 struct _qemuMonitor {
     virObjectLockable parent;
 
@@ -87,6 +101,12 @@ struct _qemuMonitor {
      * non-NULL */
     qemuMonitorMessagePtr msg;
 
+    /* Asynchronous commands awaiting their reply, in submission order */
+    qemuMonitorAsyncMessagePtr *async;
+    size_t nasync;
+    /* number of completion callbacks currently being run */
+    size_t asyncRunning;
+
     /* Buffer incoming data ready for Text/QMP monitor
      * code to process & find message boundaries */
     size_t bufferOffset;
@@ -112,6 +132,13 @@ struct _qemuMonitor {
     qemuMonitorReportDomainLogError logFunc;
     void *logOpaque;
     virFreeCallback logDestroy;
+
+    /* Per-command statistics, command name -> qemuMonitorCommandStatsPtr */
+    virHashTablePtr commandStats;
+    unsigned long long jobWaitCount;
+    unsigned long long jobWait[QEMU_MONITOR_STATS_BUCKETS];
+    /* monotonic time at which @msg was handed over to the IO thread */
+    unsigned long long msgSent;
 };
 
 /**
@@ -234,6 +261,8 @@ qemuMonitorDispose(void *obj)
     VIR_FREE(mon->buffer);
     virJSONValueFree(mon->options);
     VIR_FREE(mon->balloonpath);
+    virHashFree(mon->commandStats);
+    VIR_FREE(mon->async);
 }
 
 
@@ -406,6 +435,31 @@ qemuMonitorIOWriteWithFD(qemuMonitorPtr mon,
 }
 
 
+/*
+ * Returns the message whose data is to be written next, if any. The
+ * synchronous message is installed only once all asynchronous ones were
+ * answered, so any asynchronous message queued while it is being
+ * transmitted must wait for it to avoid interleaving.
+ */
+static qemuMonitorMessagePtr
+qemuMonitorNextTxMessage(qemuMonitorPtr mon)
+{
+    size_t i;
+
+    if (mon->msg && mon->msg->txOffset < mon->msg->txLength)
+        return mon->msg;
+
+    for (i = 0; i < mon->nasync; i++) {
+        qemuMonitorMessagePtr msg = &mon->async[i]->msg;
+
+        if (msg->txOffset < msg->txLength)
+            return msg;
+    }
+
+    return NULL;
+}
+
+
 /*
  * Called when the monitor is able to write data
  * Call this function while holding the monitor lock.
@@ -413,29 +467,30 @@ qemuMonitorIOWriteWithFD(qemuMonitorPtr mon,
 static int
 qemuMonitorIOWrite(qemuMonitorPtr mon)
 {
+    qemuMonitorMessagePtr msg;
     int done;
     char *buf;
     size_t len;
 
-    /* If no active message, or fully transmitted, the no-op */
-    if (!mon->msg || mon->msg->txOffset == mon->msg->txLength)
+    /* If no message has data left to transmit, then no-op */
+    if (!(msg = qemuMonitorNextTxMessage(mon)))
         return 0;
 
-    buf = mon->msg->txBuffer + mon->msg->txOffset;
-    len = mon->msg->txLength - mon->msg->txOffset;
-    if (mon->msg->txFD == -1)
+    buf = msg->txBuffer + msg->txOffset;
+    len = msg->txLength - msg->txOffset;
+    if (msg->txFD == -1)
         done = write(mon->fd, buf, len);
     else
-        done = qemuMonitorIOWriteWithFD(mon, buf, len, mon->msg->txFD);
+        done = qemuMonitorIOWriteWithFD(mon, buf, len, msg->txFD);
 
     PROBE(QEMU_MONITOR_IO_WRITE,
           "mon=%p buf=%s len=%zu ret=%d errno=%d",
           mon, buf, len, done, done < 0 ? errno : 0);
 
-    if (mon->msg->txFD != -1) {
+    if (msg->txFD != -1) {
         PROBE(QEMU_MONITOR_IO_SEND_FD,
               "mon=%p fd=%d ret=%d errno=%d",
-              mon, mon->msg->txFD, done, done < 0 ? errno : 0);
+              mon, msg->txFD, done, done < 0 ? errno : 0);
     }
 
     if (done < 0) {
@@ -446,7 +501,7 @@ qemuMonitorIOWrite(qemuMonitorPtr mon)
                              _("Unable to write to monitor"));
         return -1;
     }
-    mon->msg->txOffset += done;
+    msg->txOffset += done;
     return done;
 }
 
@@ -622,6 +677,8 @@ qemuMonitorIO(GSocket *socket G_GNUC_UNUSED,
             mon->msg->finished = true;
             virCondSignal(&mon->notify);
         }
+
+        qemuMonitorAsyncFailAll(mon);
     }
 
     qemuMonitorUpdateWatch(mon);
@@ -690,6 +747,8 @@ qemuMonitorOpenInternal(virDomainObjPtr vm,
                        _("cannot initialize monitor condition"));
         goto cleanup;
     }
+    if (!(mon->commandStats = virHashNew(virHashValueFree)))
+        goto cleanup;
     mon->fd = fd;
     mon->context = g_main_context_ref(context);
     mon->vm = virObjectRef(vm);
@@ -826,8 +885,7 @@ qemuMonitorRegister(qemuMonitorPtr mon)
     if (mon->lastError.code == VIR_ERR_OK) {
         cond |= G_IO_IN;
 
-        if ((mon->msg && mon->msg->txOffset < mon->msg->txLength) &&
-            !mon->waitGreeting)
+        if (qemuMonitorNextTxMessage(mon) && !mon->waitGreeting)
             cond |= G_IO_OUT;
     }
 
@@ -877,7 +935,7 @@ qemuMonitorClose(qemuMonitorPtr mon)
     /* In case another thread is waiting for its monitor command to be
      * processed, we need to wake it up with appropriate error set.
      */
-    if (mon->msg) {
+    if (mon->msg || mon->nasync) {
         if (mon->lastError.code == VIR_ERR_OK) {
             virErrorPtr err;
 
@@ -891,10 +949,14 @@ qemuMonitorClose(qemuMonitorPtr mon)
             else
                 virResetLastError();
         }
-        mon->msg->finished = true;
-        virCondSignal(&mon->notify);
+        if (mon->msg) {
+            mon->msg->finished = true;
+            virCondSignal(&mon->notify);
+        }
     }
 
+    qemuMonitorAsyncFailAll(mon);
+
     /* Propagate existing monitor error in case the current thread has no
      * error set.
      */
@@ -924,6 +986,141 @@ qemuMonitorResetCommandID(qemuMonitorPtr mon)
 }
 
 
+static size_t
+qemuMonitorStatsBucket(unsigned long long usec)
+{
+    size_t bucket = 0;
+
+    while (usec && bucket < QEMU_MONITOR_STATS_BUCKETS - 1) {
+        usec >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+
+static void
+qemuMonitorUpdateCommandStats(qemuMonitorPtr mon,
+                              qemuMonitorMessagePtr msg,
+                              unsigned long long usec,
+                              bool failed)
+{
+    qemuMonitorCommandStatsPtr stats;
+
+    if (!msg->cmdName)
+        return;
+
+    if (!(stats = virHashLookup(mon->commandStats, msg->cmdName))) {
+        stats = g_new0(qemuMonitorCommandStats, 1);
+        if (virHashAddEntry(mon->commandStats, msg->cmdName, stats) < 0) {
+            VIR_FREE(stats);
+            return;
+        }
+    }
+
+    stats->calls++;
+    if (failed)
+        stats->errors++;
+    stats->latency[qemuMonitorStatsBucket(usec)]++;
+}
+
+
+/**
+ * qemuMonitorRecordJobWait:
+ * @mon: monitor object
+ * @usec: time in microseconds
+ *
+ * Accounts @usec spent waiting for the domain job which is about to be
+ * used to talk to @mon.
+ */
+void
+qemuMonitorRecordJobWait(qemuMonitorPtr mon,
+                         unsigned long long usec)
+{
+    virObjectLock(mon);
+    mon->jobWaitCount++;
+    mon->jobWait[qemuMonitorStatsBucket(usec)]++;
+    virObjectUnlock(mon);
+}
+
+
+static int
+qemuMonitorCommandStatsCompare(const void *a,
+                               const void *b)
+{
+    const qemuMonitorCommandStats *sa = a;
+    const qemuMonitorCommandStats *sb = b;
+
+    return strcmp(sa->name, sb->name);
+}
+
+
+static int
+qemuMonitorCollectCommandStats(void *payload,
+                               const void *name,
+                               void *opaque)
+{
+    qemuMonitorStatsPtr stats = opaque;
+    qemuMonitorCommandStatsPtr cmd = &stats->commands[stats->ncommands++];
+
+    memcpy(cmd, payload, sizeof(*cmd));
+    cmd->name = g_strdup(name);
+    return 0;
+}
+
+
+/**
+ * qemuMonitorGetStats:
+ * @mon: monitor object
+ * @stats: filled with a snapshot of the statistics
+ *
+ * Collects the per-command latency statistics of @mon, sorted by command
+ * name. The caller has to release @stats with qemuMonitorStatsClear().
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMonitorGetStats(qemuMonitorPtr mon,
+                    qemuMonitorStatsPtr stats)
+{
+    QEMU_CHECK_MONITOR(mon);
+
+    memset(stats, 0, sizeof(*stats));
+
+    virObjectLock(mon);
+
+    stats->commands = g_new0(qemuMonitorCommandStats,
+                             virHashSize(mon->commandStats));
+    virHashForEach(mon->commandStats, qemuMonitorCollectCommandStats, stats);
+
+    stats->jobWaitCount = mon->jobWaitCount;
+    memcpy(stats->jobWait, mon->jobWait, sizeof(stats->jobWait));
+
+    if (mon->msg && !mon->msg->finished)
+        stats->pending = g_get_monotonic_time() - mon->msgSent;
+
+    virObjectUnlock(mon);
+
+    qsort(stats->commands, stats->ncommands, sizeof(*stats->commands),
+          qemuMonitorCommandStatsCompare);
+
+    return 0;
+}
+
+
+void
+qemuMonitorStatsClear(qemuMonitorStatsPtr stats)
+{
+    size_t i;
+
+    for (i = 0; i < stats->ncommands; i++)
+        VIR_FREE(stats->commands[i].name);
+    VIR_FREE(stats->commands);
+    stats->ncommands = 0;
+}
+
+
 int
 qemuMonitorSend(qemuMonitorPtr mon,
                 qemuMonitorMessagePtr msg)
@@ -938,7 +1135,14 @@ qemuMonitorSend(qemuMonitorPtr mon,
         return -1;
     }
 
+    /* Sending a message while asynchronous ones are still pending would
+     * make its reply arrive at a point where the JSON code can't tell it
+     * apart reliably if the reply is filtered, so wait for them first */
+    if (qemuMonitorWaitAsync(mon) < 0)
+        return -1;
+
     mon->msg = msg;
+    mon->msgSent = g_get_monotonic_time();
     qemuMonitorUpdateWatch(mon);
 
     PROBE(QEMU_MONITOR_SEND_MSG,
@@ -963,6 +1167,11 @@ qemuMonitorSend(qemuMonitorPtr mon,
     ret = 0;
 
  cleanup:
+    qemuMonitorUpdateCommandStats(mon, msg,
+                                  g_get_monotonic_time() - mon->msgSent,
+                                  ret < 0 || !msg->rxObject ||
+                                  virJSONValueObjectHasKey(msg->rxObject,
+                                                           "error") == 1);
     mon->msg = NULL;
     qemuMonitorUpdateWatch(mon);
 
@@ -970,6 +1179,239 @@ qemuMonitorSend(qemuMonitorPtr mon,
 }
 
 
+static void
+qemuMonitorAsyncMessageFree(qemuMonitorAsyncMessagePtr amsg)
+{
+    if (!amsg)
+        return;
+
+    virJSONValueFree(amsg->msg.rxObject);
+    VIR_FREE(amsg->msg.txBuffer);
+    VIR_FREE(amsg->cmdname);
+    VIR_FREE(amsg->id);
+    VIR_FREE(amsg);
+}
+
+
+/*
+ * Runs the completion callback of @amsg, which was already removed from
+ * the queue, and frees it. The monitor lock is dropped while the callback
+ * runs, waiters are woken up afterwards.
+ */
+static void
+qemuMonitorAsyncComplete(qemuMonitorPtr mon,
+                         qemuMonitorAsyncMessagePtr amsg)
+{
+    virJSONValuePtr reply = amsg->msg.rxObject;
+    virJSONValuePtr data = NULL;
+    const char *error = NULL;
+
+    if (reply && virJSONValueObjectHasKey(reply, "error") == 1) {
+        virJSONValuePtr err = virJSONValueObjectGet(reply, "error");
+
+        if (!(error = virJSONValueObjectGetString(err, "desc")))
+            error = _("unknown QEMU error");
+    } else if (reply) {
+        data = virJSONValueObjectGet(reply, "return");
+    }
+
+    qemuMonitorUpdateCommandStats(mon, &amsg->msg,
+                                  g_get_monotonic_time() - amsg->sent,
+                                  !data);
+
+    mon->asyncRunning++;
+    virObjectRef(mon);
+    virObjectUnlock(mon);
+
+    (amsg->cb)(mon, amsg->cmdname, data, error, amsg->opaque);
+
+    virObjectLock(mon);
+    virObjectUnref(mon);
+    mon->asyncRunning--;
+
+    qemuMonitorAsyncMessageFree(amsg);
+    virCondBroadcast(&mon->notify);
+}
+
+
+/*
+ * Completes all pending asynchronous messages without a reply. To be
+ * called with the monitor lock held once the monitor failed.
+ */
+static void
+qemuMonitorAsyncFailAll(qemuMonitorPtr mon)
+{
+    while (mon->nasync > 0) {
+        qemuMonitorAsyncMessagePtr amsg = mon->async[0];
+
+        VIR_DELETE_ELEMENT(mon->async, 0, mon->nasync);
+        qemuMonitorAsyncComplete(mon, amsg);
+    }
+}
+
+
+/**
+ * qemuMonitorSendAsync:
+ * @mon: monitor object
+ * @cmdname: name of the command, for accounting and the callback
+ * @id: the command ID embedded in @txBuffer
+ * @txBuffer: the serialized command, consumed by this function
+ * @cb: callback to run once the reply arrives
+ * @opaque: data for @cb
+ *
+ * Queues a command which doesn't need a file descriptor to be passed and
+ * returns without waiting for its reply. The caller has to hold the
+ * monitor lock.
+ *
+ * Returns 0 on success, -1 on error. @cb is never run on failure.
+ */
+int
+qemuMonitorSendAsync(qemuMonitorPtr mon,
+                     const char *cmdname,
+                     const char *id,
+                     char *txBuffer,
+                     qemuMonitorAsyncCallback cb,
+                     void *opaque)
+{
+    qemuMonitorAsyncMessagePtr amsg;
+
+    if (mon->lastError.code != VIR_ERR_OK) {
+        VIR_DEBUG("Attempt to send command while error is set %s",
+                  NULLSTR(mon->lastError.message));
+        virSetError(&mon->lastError);
+        VIR_FREE(txBuffer);
+        return -1;
+    }
+
+    amsg = g_new0(qemuMonitorAsyncMessage, 1);
+    amsg->msg.txFD = -1;
+    amsg->msg.txBuffer = txBuffer;
+    amsg->msg.txLength = strlen(txBuffer);
+    amsg->cmdname = g_strdup(cmdname);
+    amsg->msg.cmdName = amsg->cmdname;
+    amsg->id = g_strdup(id);
+    amsg->cb = cb;
+    amsg->opaque = opaque;
+    amsg->sent = g_get_monotonic_time();
+
+    if (VIR_APPEND_ELEMENT(mon->async, mon->nasync, amsg) < 0) {
+        qemuMonitorAsyncMessageFree(amsg);
+        return -1;
+    }
+
+    PROBE(QEMU_MONITOR_SEND_MSG,
+          "mon=%p msg=%s fd=%d",
+          mon, txBuffer, -1);
+
+    qemuMonitorUpdateWatch(mon);
+    return 0;
+}
+
+
+/**
+ * qemuMonitorAsyncReply:
+ * @mon: monitor object
+ * @id: command ID the reply refers to
+ * @reply: the reply object
+ *
+ * Hands @reply over to the asynchronous command with @id, if there is
+ * one, and runs its completion callback. The monitor lock is temporarily
+ * dropped in that case.
+ *
+ * Returns true if @reply was consumed, false if it belongs to no pending
+ * asynchronous command.
+ */
+bool
+qemuMonitorAsyncReply(qemuMonitorPtr mon,
+                      const char *id,
+                      virJSONValuePtr reply)
+{
+    qemuMonitorAsyncMessagePtr amsg;
+    size_t i;
+
+    for (i = 0; i < mon->nasync; i++) {
+        if (STREQ(mon->async[i]->id, id))
+            break;
+    }
+
+    if (i == mon->nasync)
+        return false;
+
+    amsg = mon->async[i];
+    VIR_DELETE_ELEMENT(mon->async, i, mon->nasync);
+
+    amsg->msg.rxObject = reply;
+    amsg->msg.finished = true;
+    qemuMonitorAsyncComplete(mon, amsg);
+    return true;
+}
+
+
+/**
+ * qemuMonitorWaitAsync:
+ * @mon: monitor object
+ *
+ * Waits until all asynchronous commands submitted on @mon were answered
+ * and their callbacks finished. The caller has to hold the monitor lock.
+ *
+ * Returns 0 on success, -1 if the monitor failed in the meantime, in which
+ * case the pending callbacks were run without a reply.
+ */
+int
+qemuMonitorWaitAsync(qemuMonitorPtr mon)
+{
+    /* pending commands are failed as soon as an error is recorded, so
+     * this terminates even if the monitor goes away */
+    while (mon->nasync > 0 || mon->asyncRunning > 0) {
+        if (virCondWait(&mon->notify, &mon->parent.lock) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Unable to wait on monitor condition"));
+            return -1;
+        }
+    }
+
+    if (mon->lastError.code != VIR_ERR_OK) {
+        VIR_DEBUG("Asynchronous command resulted in error %s",
+                  NULLSTR(mon->lastError.message));
+        virSetError(&mon->lastError);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * qemuMonitorQueryAsync:
+ * @mon: monitor object
+ * @cmdname: name of a query command which takes no arguments
+ * @cb: callback to run with the returned data
+ * @opaque: data for @cb
+ *
+ * Submits @cmdname without waiting for its reply, so that several
+ * independent queries can be sent back to back and answered in one round
+ * trip. @cb is run from the event loop thread without the monitor lock
+ * held once the reply arrives, or with NULL data if the command failed or
+ * the monitor was closed. Callbacks must not call any monitor API nor
+ * lock the domain object. Use qemuMonitorWaitAsync() to wait until all
+ * submitted queries are answered.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMonitorQueryAsync(qemuMonitorPtr mon,
+                      const char *cmdname,
+                      qemuMonitorAsyncCallback cb,
+                      void *opaque)
+{
+    VIR_DEBUG("cmdname=%s", cmdname);
+
+    QEMU_CHECK_MONITOR(mon);
+
+    return qemuMonitorJSONQueryAsync(mon, cmdname, cb, opaque);
+}
+
+
 /**
  * This function returns a new virError object; the caller is responsible
  * for freeing it.
@@ -2004,6 +2446,59 @@ qemuMonitorGetMemoryStats(qemuMonitorPtr mon,
 }
 
 
+/**
+ * qemuMonitorGetMemoryStatsAsync:
+ * @mon: monitor object
+ * @cb: callback to run with the returned data
+ * @opaque: data for @cb
+ *
+ * Submits the query of the balloon statistics without waiting for the
+ * reply, see qemuMonitorQueryAsync() for the rules @cb has to follow. The
+ * data passed to @cb can be converted by qemuMonitorParseMemoryStats().
+ * As looking up the balloon device would require synchronous commands,
+ * nothing is submitted unless the device was already found by an earlier
+ * call to qemuMonitorGetMemoryStats() or qemuMonitorSetMemoryStatsPeriod().
+ *
+ * Returns 1 if the query was submitted, 0 if the balloon device is not
+ * known yet and -1 on error.
+ */
+int
+qemuMonitorGetMemoryStatsAsync(qemuMonitorPtr mon,
+                               qemuMonitorAsyncCallback cb,
+                               void *opaque)
+{
+    QEMU_CHECK_MONITOR(mon);
+
+    if (!mon->balloonpath)
+        return 0;
+
+    if (qemuMonitorJSONGetMemoryStatsAsync(mon, mon->balloonpath,
+                                           cb, opaque) < 0)
+        return -1;
+
+    return 1;
+}
+
+
+/**
+ * qemuMonitorParseMemoryStats:
+ * @data: data returned by the query submitted by
+ *        qemuMonitorGetMemoryStatsAsync()
+ * @stats: array to fill
+ * @nr_stats: size of @stats
+ *
+ * Returns the number of filled items of @stats, -1 if @data doesn't
+ * contain balloon statistics.
+ */
+int
+qemuMonitorParseMemoryStats(virJSONValuePtr data,
+                            virDomainMemoryStatPtr stats,
+                            unsigned int nr_stats)
+{
+    return qemuMonitorJSONParseMemoryStats(data, stats, nr_stats, 0);
+}
+
+
 /**
  * qemuMonitorSetMemoryStatsPeriod:
  *
@@ -2555,6 +3050,23 @@ qemuMonitorMigrateToHost(qemuMonitorPtr mon,
 }
 
 
+int
+qemuMonitorMigrateToSocket(qemuMonitorPtr mon,
+                           unsigned int flags,
+                           const char *socketPath)
+{
+    g_autofree char *uri = NULL;
+
+    VIR_DEBUG("socketPath=%s flags=0x%x", socketPath, flags);
+
+    QEMU_CHECK_MONITOR(mon);
+
+    uri = g_strdup_printf("unix:%s", socketPath);
+
+    return qemuMonitorJSONMigrate(mon, flags, uri);
+}
+
+
 int
 qemuMonitorMigrateCancel(qemuMonitorPtr mon)
 {
@@ -2996,6 +3508,40 @@ qemuMonitorAddObject(qemuMonitorPtr mon,
 }
 
 
+/**
+ * qemuMonitorAddObjectAsync:
+ * @mon: monitor object
+ * @props: JSON object describing the object to add, consumed
+ * @cb: callback to run once the reply arrives
+ * @opaque: data for @cb
+ *
+ * Submits 'object-add' without waiting for the reply, see
+ * qemuMonitorBlockdevAddAsync().
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMonitorAddObjectAsync(qemuMonitorPtr mon,
+                          virJSONValuePtr *props,
+                          qemuMonitorAsyncCallback cb,
+                          void *opaque)
+{
+    virJSONValuePtr pr = g_steal_pointer(props);
+
+    VIR_DEBUG("type=%s id=%s",
+              NULLSTR(virJSONValueObjectGetString(pr, "qom-type")),
+              NULLSTR(virJSONValueObjectGetString(pr, "id")));
+
+    QEMU_CHECK_MONITOR_GOTO(mon, error);
+
+    return qemuMonitorJSONCommandAsync(mon, "object-add", pr, cb, opaque);
+
+ error:
+    virJSONValueFree(pr);
+    return -1;
+}
+
+
 int
 qemuMonitorDelObject(qemuMonitorPtr mon,
                      const char *objalias,
@@ -4385,6 +4931,41 @@ qemuMonitorBlockdevAdd(qemuMonitorPtr mon,
 }
 
 
+/**
+ * qemuMonitorBlockdevAddAsync:
+ * @mon: monitor object
+ * @props: JSON object describing the blockdev to add, consumed
+ * @cb: callback to run once the reply arrives
+ * @opaque: data for @cb
+ *
+ * Submits 'blockdev-add' without waiting for the reply, see
+ * qemuMonitorQueryAsync() for the rules @cb has to follow. QEMU executes
+ * commands in the order they were sent, so nodes depending on each other
+ * can be submitted back to back.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMonitorBlockdevAddAsync(qemuMonitorPtr mon,
+                            virJSONValuePtr *props,
+                            qemuMonitorAsyncCallback cb,
+                            void *opaque)
+{
+    virJSONValuePtr pr = g_steal_pointer(props);
+
+    VIR_DEBUG("props=%p (node-name=%s)", pr,
+              NULLSTR(virJSONValueObjectGetString(pr, "node-name")));
+
+    QEMU_CHECK_MONITOR_GOTO(mon, error);
+
+    return qemuMonitorJSONCommandAsync(mon, "blockdev-add", pr, cb, opaque);
+
+ error:
+    virJSONValueFree(pr);
+    return -1;
+}
+
+
 int
 qemuMonitorBlockdevReopen(qemuMonitorPtr mon,
                           virJSONValuePtr *props)
@@ -4630,8 +5211,9 @@ qemuMonitorTransactionBackup(virJSONValuePtr actions,
                              const char *jobname,
                              const char *target,
                              const char *bitmap,
-                             qemuMonitorTransactionBackupSyncMode syncmode)
+                             qemuMonitorTransactionBackupSyncMode syncmode,
+                             unsigned long long speed)
 {
     return qemuMonitorJSONTransactionBackup(actions, device, jobname, target,
-                                            bitmap, syncmode);
+                                            bitmap, syncmode, speed);
 }
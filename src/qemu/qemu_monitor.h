@@ -51,11 +51,68 @@ struct _qemuMonitorMessage {
     int rxLength;
     /* Used by the JSON monitor to hold reply / error */
     void *rxObject;
+    /* Optional callback of the JSON monitor consuming the "return" member
+     * of the reply as it is parsed instead of storing it in rxObject. It
+     * must not fail; errors are to be recorded in rxFilterOpaque. */
+    virJSONStreamParserCallback rxFilter;
+    void *rxFilterOpaque;
 
     /* True if rxBuffer / rxObject are ready, or a
      * fatal error occurred on the monitor channel
      */
     bool finished;
+
+    /* Name of the command, used to account its latency. May be NULL */
+    const char *cmdName;
+};
+
+/* Latency histograms have log2 buckets in microseconds: bucket 0 counts
+ * samples below 1us and bucket i samples in [2^(i-1), 2^i) us, the last
+ * one collecting everything larger. */
+#define QEMU_MONITOR_STATS_BUCKETS 24
+
+typedef struct _qemuMonitorCommandStats qemuMonitorCommandStats;
+typedef qemuMonitorCommandStats *qemuMonitorCommandStatsPtr;
+struct _qemuMonitorCommandStats {
+    char *name;
+    unsigned long long calls;
+    unsigned long long errors;
+    /* time from handing the command to the monitor until its reply */
+    unsigned long long latency[QEMU_MONITOR_STATS_BUCKETS];
+};
+
+/**
+ * qemuMonitorAsyncCallback:
+ * @mon: monitor object
+ * @cmdname: name of the completed command
+ * @data: the "return" member of the reply, NULL if the command failed
+ * @error: description of the error reported by QEMU, NULL if the command
+ *         succeeded or the monitor failed before replying
+ * @opaque: data passed along with the command
+ *
+ * Completion callback of commands submitted asynchronously, e.g. via
+ * qemuMonitorQueryAsync(). @data and @error are owned by the monitor and
+ * valid only during the call.
+ */
+typedef void (*qemuMonitorAsyncCallback)(qemuMonitorPtr mon,
+                                         const char *cmdname,
+                                         virJSONValuePtr data,
+                                         const char *error,
+                                         void *opaque);
+
+typedef struct _qemuMonitorStats qemuMonitorStats;
+typedef qemuMonitorStats *qemuMonitorStatsPtr;
+struct _qemuMonitorStats {
+    qemuMonitorCommandStatsPtr commands;
+    size_t ncommands;
+
+    /* time spent waiting for the domain job before talking to the monitor */
+    unsigned long long jobWaitCount;
+    unsigned long long jobWait[QEMU_MONITOR_STATS_BUCKETS];
+
+    /* how long the command currently in flight (if any) has been waiting
+     * for its reply, in microseconds */
+    unsigned long long pending;
 };
 
 typedef enum {
@@ -400,6 +457,13 @@ virErrorPtr qemuMonitorLastError(qemuMonitorPtr mon);
 
 int qemuMonitorSetCapabilities(qemuMonitorPtr mon);
 
+int qemuMonitorQueryAsync(qemuMonitorPtr mon,
+                          const char *cmdname,
+                          qemuMonitorAsyncCallback cb,
+                          void *opaque)
+    ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(3);
+int qemuMonitorWaitAsync(qemuMonitorPtr mon);
+
 int qemuMonitorSetLink(qemuMonitorPtr mon,
                        const char *name,
                        virDomainNetInterfaceLinkState state)
@@ -409,6 +473,21 @@ int qemuMonitorSetLink(qemuMonitorPtr mon,
 char *qemuMonitorNextCommandID(qemuMonitorPtr mon);
 int qemuMonitorSend(qemuMonitorPtr mon,
                     qemuMonitorMessagePtr msg) G_GNUC_NO_INLINE;
+int qemuMonitorSendAsync(qemuMonitorPtr mon,
+                         const char *cmdname,
+                         const char *id,
+                         char *txBuffer,
+                         qemuMonitorAsyncCallback cb,
+                         void *opaque);
+bool qemuMonitorAsyncReply(qemuMonitorPtr mon,
+                           const char *id,
+                           virJSONValuePtr reply);
+
+void qemuMonitorRecordJobWait(qemuMonitorPtr mon,
+                              unsigned long long usec);
+int qemuMonitorGetStats(qemuMonitorPtr mon,
+                        qemuMonitorStatsPtr stats);
+void qemuMonitorStatsClear(qemuMonitorStatsPtr stats);
 virJSONValuePtr qemuMonitorGetOptions(qemuMonitorPtr mon)
     ATTRIBUTE_NONNULL(1);
 void qemuMonitorSetOptions(qemuMonitorPtr mon, virJSONValuePtr options)
@@ -625,6 +704,12 @@ int qemuMonitorGetVirtType(qemuMonitorPtr mon,
                            virDomainVirtType *virtType);
 int qemuMonitorGetBalloonInfo(qemuMonitorPtr mon,
                               unsigned long long *currmem);
+int qemuMonitorGetMemoryStatsAsync(qemuMonitorPtr mon,
+                                   qemuMonitorAsyncCallback cb,
+                                   void *opaque);
+int qemuMonitorParseMemoryStats(virJSONValuePtr data,
+                                virDomainMemoryStatPtr stats,
+                                unsigned int nr_stats);
 int qemuMonitorGetMemoryStats(qemuMonitorPtr mon,
                               virDomainMemballoonDefPtr balloon,
                               virDomainMemoryStatPtr stats,
@@ -853,6 +938,10 @@ int qemuMonitorMigrateToHost(qemuMonitorPtr mon,
                              const char *hostname,
                              int port);
 
+int qemuMonitorMigrateToSocket(qemuMonitorPtr mon,
+                               unsigned int flags,
+                               const char *socketPath);
+
 int qemuMonitorMigrateCancel(qemuMonitorPtr mon);
 
 int qemuMonitorGetDumpGuestMemoryCapability(qemuMonitorPtr mon,
@@ -936,6 +1025,12 @@ int qemuMonitorAddObject(qemuMonitorPtr mon,
                          char **alias)
     ATTRIBUTE_NONNULL(2);
 
+int qemuMonitorAddObjectAsync(qemuMonitorPtr mon,
+                              virJSONValuePtr *props,
+                              qemuMonitorAsyncCallback cb,
+                              void *opaque)
+    ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(3);
+
 int qemuMonitorDelObject(qemuMonitorPtr mon,
                          const char *objalias,
                          bool report_error);
@@ -1329,6 +1424,12 @@ int qemuMonitorBlockdevCreate(qemuMonitorPtr mon,
 int qemuMonitorBlockdevAdd(qemuMonitorPtr mon,
                            virJSONValuePtr *props);
 
+int qemuMonitorBlockdevAddAsync(qemuMonitorPtr mon,
+                                virJSONValuePtr *props,
+                                qemuMonitorAsyncCallback cb,
+                                void *opaque)
+    ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(3);
+
 int qemuMonitorBlockdevReopen(qemuMonitorPtr mon,
                               virJSONValuePtr *props);
 
@@ -1434,4 +1535,5 @@ qemuMonitorTransactionBackup(virJSONValuePtr actions,
                              const char *jobname,
                              const char *target,
                              const char *bitmap,
-                             qemuMonitorTransactionBackupSyncMode syncmode);
+                             qemuMonitorTransactionBackupSyncMode syncmode,
+                             unsigned long long speed);
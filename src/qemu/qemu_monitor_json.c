@@ -209,6 +209,120 @@ qemuMonitorJSONIOProcessEvent(qemuMonitorPtr mon,
     return 0;
 }
 
+typedef struct _qemuMonitorJSONFilterData qemuMonitorJSONFilterData;
+struct _qemuMonitorJSONFilterData {
+    qemuMonitorMessagePtr msg;
+    virJSONValuePtr obj; /* the reply with members other than "return" */
+    bool inReturn;
+};
+
+
+static int
+qemuMonitorJSONFilterForward(virJSONStreamParserPtr parser,
+                             virJSONStreamEvent event,
+                             const char *key,
+                             const char *str,
+                             size_t len,
+                             qemuMonitorMessagePtr msg)
+{
+    int rc = msg->rxFilter(parser, event, key, str, len, msg->rxFilterOpaque);
+
+    /* the filter is not supposed to fail, ignore the rest of the data */
+    if (rc < 0)
+        return VIR_JSON_STREAM_SKIP;
+
+    return rc;
+}
+
+
+static int
+qemuMonitorJSONFilterReply(virJSONStreamParserPtr parser,
+                           virJSONStreamEvent event,
+                           const char *key,
+                           const char *str,
+                           size_t len,
+                           void *opaque)
+{
+    qemuMonitorJSONFilterData *data = opaque;
+    size_t depth = virJSONStreamParserGetDepth(parser);
+    g_autoptr(virJSONValue) val = NULL;
+
+    if (depth == 0) {
+        if (event == VIR_JSON_STREAM_EVENT_OBJECT_START) {
+            data->obj = virJSONValueNewObject();
+            return VIR_JSON_STREAM_CONTINUE;
+        }
+
+        if (event == VIR_JSON_STREAM_EVENT_OBJECT_END)
+            return VIR_JSON_STREAM_CONTINUE;
+
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Parsed JSON reply isn't an object"));
+        return -1;
+    }
+
+    if (data->inReturn) {
+        /* only the end of "return" itself is reported at depth 1 */
+        if (depth == 1)
+            data->inReturn = false;
+
+        return qemuMonitorJSONFilterForward(parser, event, key, str, len,
+                                            data->msg);
+    }
+
+    if (depth == 1 && STREQ_NULLABLE(key, "return") &&
+        (event == VIR_JSON_STREAM_EVENT_OBJECT_START ||
+         event == VIR_JSON_STREAM_EVENT_ARRAY_START)) {
+        /* keep an empty container of the right type so that the reply
+         * can be checked as usual */
+        if (event == VIR_JSON_STREAM_EVENT_OBJECT_START)
+            val = virJSONValueNewObject();
+        else
+            val = virJSONValueNewArray();
+
+        if (virJSONValueObjectAppend(data->obj, "return", val) < 0)
+            return -1;
+        val = NULL;
+
+        data->inReturn = true;
+        ignore_value(qemuMonitorJSONFilterForward(parser, event, key, str, len,
+                                                  data->msg));
+        return VIR_JSON_STREAM_CONTINUE;
+    }
+
+    if (event == VIR_JSON_STREAM_EVENT_VALUE) {
+        val = virJSONStreamParserStealValue(parser);
+
+        if (virJSONValueObjectAppend(data->obj, key, val) < 0)
+            return -1;
+        val = NULL;
+
+        return VIR_JSON_STREAM_CONTINUE;
+    }
+
+    return VIR_JSON_STREAM_CAPTURE;
+}
+
+
+/*
+ * Parses @line while passing the "return" member of a reply to the
+ * filter of @msg rather than building it in memory.
+ */
+static virJSONValuePtr
+qemuMonitorJSONParseFiltered(const char *line,
+                             qemuMonitorMessagePtr msg)
+{
+    qemuMonitorJSONFilterData data = { msg, NULL, false };
+
+    if (virJSONStreamParse(line, qemuMonitorJSONFilterReply, &data) < 0) {
+        virJSONValueFree(data.obj);
+        return NULL;
+    }
+
+    return data.obj;
+}
+
+
 int
 qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
                              const char *line,
@@ -219,8 +333,15 @@ qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
 
     VIR_DEBUG("Line [%s]", line);
 
-    if (!(obj = virJSONValueFromString(line)))
-        goto cleanup;
+    if (msg && msg->rxFilter) {
+        if (!(obj = qemuMonitorJSONParseFiltered(line, msg)))
+            goto cleanup;
+    } else {
+        /* Replies and events are short lived, parse them into a single
+         * arena so that the whole document is released in one go. */
+        if (!(obj = virJSONValueFromStringArena(line)))
+            goto cleanup;
+    }
 
     if (virJSONValueGetType(obj) != VIR_JSON_TYPE_OBJECT) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -236,9 +357,14 @@ qemuMonitorJSONIOProcessLine(qemuMonitorPtr mon,
         ret = qemuMonitorJSONIOProcessEvent(mon, obj);
     } else if (virJSONValueObjectHasKey(obj, "error") == 1 ||
                virJSONValueObjectHasKey(obj, "return") == 1) {
+        const char *id = virJSONValueObjectGetString(obj, "id");
+
         PROBE(QEMU_MONITOR_RECV_REPLY,
               "mon=%p reply=%s", mon, line);
-        if (msg) {
+        if (id && qemuMonitorAsyncReply(mon, id, obj)) {
+            obj = NULL;
+            ret = 0;
+        } else if (msg) {
             msg->rxObject = obj;
             msg->finished = 1;
             obj = NULL;
@@ -274,6 +400,10 @@ int qemuMonitorJSONIOProcess(qemuMonitorPtr mon,
             line = g_strndup(data + used, got);
             used += got + strlen(LINE_ENDING);
             line[got] = '\0'; /* kill \n */
+            /* once its reply was seen any further line belongs to
+             * someone else */
+            if (msg && msg->finished)
+                msg = NULL;
             if (qemuMonitorJSONIOProcessLine(mon, line, msg) < 0) {
                 VIR_FREE(line);
                 return -1;
@@ -293,10 +423,12 @@ int qemuMonitorJSONIOProcess(qemuMonitorPtr mon,
 }
 
 static int
-qemuMonitorJSONCommandWithFd(qemuMonitorPtr mon,
-                             virJSONValuePtr cmd,
-                             int scm_fd,
-                             virJSONValuePtr *reply)
+qemuMonitorJSONCommandInternal(qemuMonitorPtr mon,
+                               virJSONValuePtr cmd,
+                               int scm_fd,
+                               virJSONStreamParserCallback filter,
+                               void *filterOpaque,
+                               virJSONValuePtr *reply)
 {
     int ret = -1;
     qemuMonitorMessage msg;
@@ -324,6 +456,9 @@ qemuMonitorJSONCommandWithFd(qemuMonitorPtr mon,
     msg.txLength = virBufferUse(&cmdbuf);
     msg.txBuffer = virBufferContentAndReset(&cmdbuf);
     msg.txFD = scm_fd;
+    msg.rxFilter = filter;
+    msg.rxFilterOpaque = filterOpaque;
+    msg.cmdName = virJSONValueObjectGetString(cmd, "execute");
 
     ret = qemuMonitorSend(mon, &msg);
 
@@ -345,6 +480,33 @@ qemuMonitorJSONCommandWithFd(qemuMonitorPtr mon,
 }
 
 
+static int
+qemuMonitorJSONCommandWithFd(qemuMonitorPtr mon,
+                             virJSONValuePtr cmd,
+                             int scm_fd,
+                             virJSONValuePtr *reply)
+{
+    return qemuMonitorJSONCommandInternal(mon, cmd, scm_fd, NULL, NULL, reply);
+}
+
+
+/*
+ * Like qemuMonitorJSONCommand, but the "return" member of the reply is
+ * passed to @filter as it is being parsed. The "return" member of @reply
+ * is then an empty object or array.
+ */
+static int
+qemuMonitorJSONCommandWithFilter(qemuMonitorPtr mon,
+                                 virJSONValuePtr cmd,
+                                 virJSONStreamParserCallback filter,
+                                 void *filterOpaque,
+                                 virJSONValuePtr *reply)
+{
+    return qemuMonitorJSONCommandInternal(mon, cmd, -1, filter, filterOpaque,
+                                          reply);
+}
+
+
 static int
 qemuMonitorJSONCommand(qemuMonitorPtr mon,
                        virJSONValuePtr cmd,
@@ -1625,6 +1787,66 @@ qemuMonitorJSONSetCapabilities(qemuMonitorPtr mon)
 }
 
 
+/**
+ * qemuMonitorJSONCommandAsync:
+ * @mon: monitor object
+ * @cmdname: name of the command
+ * @arguments: arguments of the command, consumed (may be NULL)
+ * @cb: callback to run once the reply arrives
+ * @opaque: data for @cb
+ *
+ * Submits @cmdname without waiting for its reply.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuMonitorJSONCommandAsync(qemuMonitorPtr mon,
+                            const char *cmdname,
+                            virJSONValuePtr arguments,
+                            qemuMonitorAsyncCallback cb,
+                            void *opaque)
+{
+    g_autoptr(virJSONValue) cmd = NULL;
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *id = NULL;
+
+    if (arguments) {
+        if (!(cmd = qemuMonitorJSONMakeCommandInternal(cmdname, arguments)))
+            return -1;
+    } else {
+        if (!(cmd = qemuMonitorJSONMakeCommand(cmdname, NULL)))
+            return -1;
+    }
+
+    if (!(id = qemuMonitorNextCommandID(mon)))
+        return -1;
+
+    if (virJSONValueObjectAppendString(cmd, "id", id) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to append command 'id' string"));
+        return -1;
+    }
+
+    if (virJSONValueToBuffer(cmd, &cmdbuf, false) < 0)
+        return -1;
+    virBufferAddLit(&cmdbuf, "\r\n");
+
+    return qemuMonitorSendAsync(mon, cmdname, id,
+                                virBufferContentAndReset(&cmdbuf),
+                                cb, opaque);
+}
+
+
+int
+qemuMonitorJSONQueryAsync(qemuMonitorPtr mon,
+                          const char *cmdname,
+                          qemuMonitorAsyncCallback cb,
+                          void *opaque)
+{
+    return qemuMonitorJSONCommandAsync(mon, cmdname, NULL, cb, opaque);
+}
+
+
 int
 qemuMonitorJSONStartCPUs(qemuMonitorPtr mon)
 {
@@ -2244,6 +2466,58 @@ qemuMonitorJSONGetBalloonInfo(qemuMonitorPtr mon,
     }
 
 
+/**
+ * qemuMonitorJSONParseMemoryStats:
+ * @data: the "return" member of the 'guest-stats' qom-get reply
+ * @stats: array to fill
+ * @nr_stats: size of @stats
+ * @got: number of items of @stats already filled
+ *
+ * Returns the number of filled items of @stats or -1 if @data doesn't
+ * contain the balloon statistics.
+ */
+int
+qemuMonitorJSONParseMemoryStats(virJSONValuePtr data,
+                                virDomainMemoryStatPtr stats,
+                                unsigned int nr_stats,
+                                int got)
+{
+    virJSONValuePtr statsdata;
+    unsigned long long mem;
+
+    if (!(statsdata = virJSONValueObjectGet(data, "stats"))) {
+        VIR_DEBUG("data does not include 'stats'");
+        return -1;
+    }
+
+    GET_BALLOON_STATS(statsdata, "stat-swap-in",
+                      VIR_DOMAIN_MEMORY_STAT_SWAP_IN, 1024);
+    GET_BALLOON_STATS(statsdata, "stat-swap-out",
+                      VIR_DOMAIN_MEMORY_STAT_SWAP_OUT, 1024);
+    GET_BALLOON_STATS(statsdata, "stat-major-faults",
+                      VIR_DOMAIN_MEMORY_STAT_MAJOR_FAULT, 1);
+    GET_BALLOON_STATS(statsdata, "stat-minor-faults",
+                      VIR_DOMAIN_MEMORY_STAT_MINOR_FAULT, 1);
+    GET_BALLOON_STATS(statsdata, "stat-free-memory",
+                      VIR_DOMAIN_MEMORY_STAT_UNUSED, 1024);
+    GET_BALLOON_STATS(statsdata, "stat-total-memory",
+                      VIR_DOMAIN_MEMORY_STAT_AVAILABLE, 1024);
+    GET_BALLOON_STATS(statsdata, "stat-available-memory",
+                      VIR_DOMAIN_MEMORY_STAT_USABLE, 1024);
+    GET_BALLOON_STATS(data, "last-update",
+                      VIR_DOMAIN_MEMORY_STAT_LAST_UPDATE, 1);
+    GET_BALLOON_STATS(statsdata, "stat-disk-caches",
+                      VIR_DOMAIN_MEMORY_STAT_DISK_CACHES, 1024);
+    GET_BALLOON_STATS(statsdata, "stat-htlb-pgalloc",
+                      VIR_DOMAIN_MEMORY_STAT_HUGETLB_PGALLOC, 1);
+    GET_BALLOON_STATS(statsdata, "stat-htlb-pgfail",
+                      VIR_DOMAIN_MEMORY_STAT_HUGETLB_PGFAIL, 1);
+
+    return got;
+}
+#undef GET_BALLOON_STATS
+
+
 int qemuMonitorJSONGetMemoryStats(qemuMonitorPtr mon,
                                   char *balloonpath,
                                   virDomainMemoryStatPtr stats,
@@ -2253,7 +2527,6 @@ int qemuMonitorJSONGetMemoryStats(qemuMonitorPtr mon,
     virJSONValuePtr cmd = NULL;
     virJSONValuePtr reply = NULL;
     virJSONValuePtr data;
-    virJSONValuePtr statsdata;
     unsigned long long mem;
     int got = 0;
 
@@ -2293,33 +2566,8 @@ int qemuMonitorJSONGetMemoryStats(qemuMonitorPtr mon,
 
     data = virJSONValueObjectGetObject(reply, "return");
 
-    if (!(statsdata = virJSONValueObjectGet(data, "stats"))) {
-        VIR_DEBUG("data does not include 'stats'");
+    if ((got = qemuMonitorJSONParseMemoryStats(data, stats, nr_stats, got)) < 0)
         goto cleanup;
-    }
-
-    GET_BALLOON_STATS(statsdata, "stat-swap-in",
-                      VIR_DOMAIN_MEMORY_STAT_SWAP_IN, 1024);
-    GET_BALLOON_STATS(statsdata, "stat-swap-out",
-                      VIR_DOMAIN_MEMORY_STAT_SWAP_OUT, 1024);
-    GET_BALLOON_STATS(statsdata, "stat-major-faults",
-                      VIR_DOMAIN_MEMORY_STAT_MAJOR_FAULT, 1);
-    GET_BALLOON_STATS(statsdata, "stat-minor-faults",
-                      VIR_DOMAIN_MEMORY_STAT_MINOR_FAULT, 1);
-    GET_BALLOON_STATS(statsdata, "stat-free-memory",
-                      VIR_DOMAIN_MEMORY_STAT_UNUSED, 1024);
-    GET_BALLOON_STATS(statsdata, "stat-total-memory",
-                      VIR_DOMAIN_MEMORY_STAT_AVAILABLE, 1024);
-    GET_BALLOON_STATS(statsdata, "stat-available-memory",
-                      VIR_DOMAIN_MEMORY_STAT_USABLE, 1024);
-    GET_BALLOON_STATS(data, "last-update",
-                      VIR_DOMAIN_MEMORY_STAT_LAST_UPDATE, 1);
-    GET_BALLOON_STATS(statsdata, "stat-disk-caches",
-                      VIR_DOMAIN_MEMORY_STAT_DISK_CACHES, 1024);
-    GET_BALLOON_STATS(statsdata, "stat-htlb-pgalloc",
-                      VIR_DOMAIN_MEMORY_STAT_HUGETLB_PGALLOC, 1);
-    GET_BALLOON_STATS(statsdata, "stat-htlb-pgfail",
-                      VIR_DOMAIN_MEMORY_STAT_HUGETLB_PGFAIL, 1);
 
     ret = got;
  cleanup:
@@ -2327,7 +2575,24 @@ int qemuMonitorJSONGetMemoryStats(qemuMonitorPtr mon,
     virJSONValueFree(reply);
     return ret;
 }
-#undef GET_BALLOON_STATS
+
+
+int
+qemuMonitorJSONGetMemoryStatsAsync(qemuMonitorPtr mon,
+                                   char *balloonpath,
+                                   qemuMonitorAsyncCallback cb,
+                                   void *opaque)
+{
+    virJSONValuePtr args = NULL;
+
+    if (virJSONValueObjectCreate(&args,
+                                 "s:path", balloonpath,
+                                 "s:property", "guest-stats",
+                                 NULL) < 0)
+        return -1;
+
+    return qemuMonitorJSONCommandAsync(mon, "qom-get", args, cb, opaque);
+}
 
 
 /*
@@ -2872,25 +3137,135 @@ qemuMonitorJSONBlockStatsUpdateCapacityBlockdevWorker(size_t pos G_GNUC_UNUSED,
 }
 
 
+typedef struct _qemuMonitorJSONBlockCapacityFilterData qemuMonitorJSONBlockCapacityFilterData;
+struct _qemuMonitorJSONBlockCapacityFilterData {
+    virHashTablePtr stats;
+    virJSONValuePtr node; /* trimmed copy of the node being parsed */
+    virJSONValuePtr image; /* trimmed copy of its "image" member */
+    int rc;
+};
+
+
+/*
+ * The output of query-named-block-nodes contains the whole backing chain
+ * of each node which makes it huge for long chains. Only a trimmed copy of
+ * the members needed by the stats is built for each node:
+ *
+ * depth 1: the "return" array
+ * depth 2: the node objects
+ * depth 3: members of a node
+ * depth 4: members of "image"
+ */
+static int
+qemuMonitorJSONBlockStatsUpdateCapacityBlockdevFilter(virJSONStreamParserPtr parser,
+                                                      virJSONStreamEvent event,
+                                                      const char *key,
+                                                      const char *str G_GNUC_UNUSED,
+                                                      size_t len G_GNUC_UNUSED,
+                                                      void *opaque)
+{
+    qemuMonitorJSONBlockCapacityFilterData *data = opaque;
+    size_t depth = virJSONStreamParserGetDepth(parser);
+    g_autoptr(virJSONValue) val = NULL;
+
+    if (data->rc < 0)
+        return VIR_JSON_STREAM_SKIP;
+
+    switch (event) {
+    case VIR_JSON_STREAM_EVENT_OBJECT_START:
+        if (depth == 2) {
+            data->node = virJSONValueNewObject();
+            return VIR_JSON_STREAM_CONTINUE;
+        }
+
+        if (depth == 3 && STREQ_NULLABLE(key, "image")) {
+            data->image = virJSONValueNewObject();
+            return VIR_JSON_STREAM_CONTINUE;
+        }
+
+        return depth < 2 ? VIR_JSON_STREAM_CONTINUE : VIR_JSON_STREAM_SKIP;
+
+    case VIR_JSON_STREAM_EVENT_ARRAY_START:
+        return depth < 2 ? VIR_JSON_STREAM_CONTINUE : VIR_JSON_STREAM_SKIP;
+
+    case VIR_JSON_STREAM_EVENT_OBJECT_END:
+        if (depth == 3 && data->image) {
+            val = g_steal_pointer(&data->image);
+
+            if (virJSONValueObjectAppend(data->node, "image", val) < 0) {
+                data->rc = -1;
+                return VIR_JSON_STREAM_SKIP;
+            }
+            val = NULL;
+        } else if (depth == 2 && data->node) {
+            val = g_steal_pointer(&data->node);
+
+            if (qemuMonitorJSONBlockStatsUpdateCapacityBlockdevWorker(0, val,
+                                                                      data->stats) < 0)
+                data->rc = -1;
+        }
+        return VIR_JSON_STREAM_CONTINUE;
+
+    case VIR_JSON_STREAM_EVENT_NULL:
+    case VIR_JSON_STREAM_EVENT_BOOLEAN:
+    case VIR_JSON_STREAM_EVENT_NUMBER:
+    case VIR_JSON_STREAM_EVENT_STRING:
+        if ((depth == 3 &&
+             (STREQ_NULLABLE(key, "node-name") ||
+              STREQ_NULLABLE(key, "write_threshold"))) ||
+            (depth == 4 && data->image &&
+             (STREQ_NULLABLE(key, "virtual-size") ||
+              STREQ_NULLABLE(key, "actual-size"))))
+            return VIR_JSON_STREAM_CAPTURE;
+
+        return VIR_JSON_STREAM_CONTINUE;
+
+    case VIR_JSON_STREAM_EVENT_VALUE:
+        val = virJSONStreamParserStealValue(parser);
+
+        if (virJSONValueObjectAppend(depth == 4 ? data->image : data->node,
+                                     key, val) < 0) {
+            data->rc = -1;
+            return VIR_JSON_STREAM_SKIP;
+        }
+        val = NULL;
+        return VIR_JSON_STREAM_CONTINUE;
+
+    case VIR_JSON_STREAM_EVENT_ARRAY_END:
+        break;
+    }
+
+    return VIR_JSON_STREAM_CONTINUE;
+}
+
+
 int
 qemuMonitorJSONBlockStatsUpdateCapacityBlockdev(qemuMonitorPtr mon,
                                                 virHashTablePtr stats)
 {
-    virJSONValuePtr nodes;
+    qemuMonitorJSONBlockCapacityFilterData data = { stats, NULL, NULL, 0 };
+    g_autoptr(virJSONValue) cmd = NULL;
+    g_autoptr(virJSONValue) reply = NULL;
     int ret = -1;
 
-    if (!(nodes = qemuMonitorJSONQueryNamedBlockNodes(mon, false)))
+    if (!(cmd = qemuMonitorJSONMakeCommand("query-named-block-nodes",
+                                           "B:flat", false,
+                                           NULL)))
         return -1;
 
-    if (virJSONValueArrayForeachSteal(nodes,
-                                      qemuMonitorJSONBlockStatsUpdateCapacityBlockdevWorker,
-                                      stats) < 0)
+    if (qemuMonitorJSONCommandWithFilter(mon, cmd,
+                                         qemuMonitorJSONBlockStatsUpdateCapacityBlockdevFilter,
+                                         &data, &reply) < 0)
         goto cleanup;
 
-    ret = 0;
+    if (qemuMonitorJSONCheckReply(cmd, reply, VIR_JSON_TYPE_ARRAY) < 0)
+        goto cleanup;
+
+    ret = data.rc;
 
  cleanup:
-    virJSONValueFree(nodes);
+    virJSONValueFree(data.image);
+    virJSONValueFree(data.node);
     return ret;
 }
 
@@ -5813,7 +6188,7 @@ qemuMonitorJSONMakeCPUModel(virCPUDefPtr cpu,
         props = virJSONValueNewObject();
 
         for (i = 0; i < cpu->nfeatures; i++) {
-            char *name = cpu->features[i].name;
+            const char *name = cpu->features[i].name;
             bool enabled = false;
 
             /* policy may be reported as -1 if the CPU def is a host model */
@@ -9302,7 +9677,8 @@ qemuMonitorJSONTransactionBackup(virJSONValuePtr actions,
                                  const char *jobname,
                                  const char *target,
                                  const char *bitmap,
-                                 qemuMonitorTransactionBackupSyncMode syncmode)
+                                 qemuMonitorTransactionBackupSyncMode syncmode,
+                                 unsigned long long speed)
 {
     const char *syncmodestr = qemuMonitorTransactionBackupSyncModeTypeToString(syncmode);
 
@@ -9313,6 +9689,7 @@ qemuMonitorJSONTransactionBackup(virJSONValuePtr actions,
                                          "s:target", target,
                                          "s:sync", syncmodestr,
                                          "S:bitmap", bitmap,
+                                         "P:speed", speed,
                                          "T:auto-finalize", VIR_TRISTATE_BOOL_YES,
                                          "T:auto-dismiss", VIR_TRISTATE_BOOL_NO,
                                          NULL);
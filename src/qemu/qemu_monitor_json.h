@@ -43,6 +43,16 @@ int qemuMonitorJSONHumanCommand(qemuMonitorPtr mon,
 
 int qemuMonitorJSONSetCapabilities(qemuMonitorPtr mon);
 
+int qemuMonitorJSONCommandAsync(qemuMonitorPtr mon,
+                                const char *cmdname,
+                                virJSONValuePtr arguments,
+                                qemuMonitorAsyncCallback cb,
+                                void *opaque);
+int qemuMonitorJSONQueryAsync(qemuMonitorPtr mon,
+                              const char *cmdname,
+                              qemuMonitorAsyncCallback cb,
+                              void *opaque);
+
 int qemuMonitorJSONStartCPUs(qemuMonitorPtr mon);
 int qemuMonitorJSONStopCPUs(qemuMonitorPtr mon);
 int qemuMonitorJSONGetStatus(qemuMonitorPtr mon,
@@ -71,6 +81,14 @@ int qemuMonitorJSONGetMemoryStats(qemuMonitorPtr mon,
                                   char *balloonpath,
                                   virDomainMemoryStatPtr stats,
                                   unsigned int nr_stats);
+int qemuMonitorJSONGetMemoryStatsAsync(qemuMonitorPtr mon,
+                                       char *balloonpath,
+                                       qemuMonitorAsyncCallback cb,
+                                       void *opaque);
+int qemuMonitorJSONParseMemoryStats(virJSONValuePtr data,
+                                    virDomainMemoryStatPtr stats,
+                                    unsigned int nr_stats,
+                                    int got);
 int qemuMonitorJSONSetMemoryStatsPeriod(qemuMonitorPtr mon,
                                         char *balloonpath,
                                         int period);
@@ -684,7 +702,8 @@ qemuMonitorJSONTransactionBackup(virJSONValuePtr actions,
                                  const char *jobname,
                                  const char *target,
                                  const char *bitmap,
-                                 qemuMonitorTransactionBackupSyncMode syncmode);
+                                 qemuMonitorTransactionBackupSyncMode syncmode,
+                                 unsigned long long speed);
 
 int qemuMonitorJSONSetDBusVMStateIdList(qemuMonitorPtr mon,
                                         const char *vmstatepath,
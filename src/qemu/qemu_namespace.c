@@ -881,6 +881,7 @@ struct _qemuNamespaceMknodData {
     virDomainObjPtr vm;
     qemuNamespaceMknodItemPtr items;
     size_t nitems;
+    char **unlinkPaths;
 };
 
 
@@ -907,6 +908,7 @@ qemuNamespaceMknodDataClear(qemuNamespaceMknodDataPtr data)
     }
 
     VIR_FREE(data->items);
+    g_clear_pointer(&data->unlinkPaths, g_strfreev);
 }
 
 
@@ -1064,6 +1066,17 @@ qemuNamespaceMknodHelper(pid_t pid G_GNUC_UNUSED,
 
     qemuSecurityPostFork(data->driver->securityManager);
 
+    for (i = 0; data->unlinkPaths && data->unlinkPaths[i]; i++) {
+        const char *path = data->unlinkPaths[i];
+
+        VIR_DEBUG("Unlinking %s", path);
+        if (unlink(path) < 0 && errno != ENOENT) {
+            virReportSystemError(errno,
+                                 _("Unable to remove device %s"), path);
+            goto cleanup;
+        }
+    }
+
     for (i = 0; i < data->nitems; i++) {
         if (qemuNamespaceMknodOne(&data->items[i]) < 0)
             goto cleanup;
@@ -1149,6 +1162,24 @@ qemuNamespaceMknodItemInit(qemuNamespaceMknodItemPtr item,
 }
 
 
+static bool
+qemuNamespacePathIsPreserved(const char *file,
+                             char * const *devMountsPath,
+                             size_t ndevMountsPath)
+{
+    size_t i;
+
+    for (i = 0; i < ndevMountsPath; i++) {
+        if (STREQ(devMountsPath[i], "/dev"))
+            continue;
+        if (STRPREFIX(file, devMountsPath[i]))
+            return true;
+    }
+
+    return false;
+}
+
+
 static int
 qemuNamespacePrepareOneItem(qemuNamespaceMknodDataPtr data,
                             virQEMUDriverConfigPtr cfg,
@@ -1159,7 +1190,6 @@ qemuNamespacePrepareOneItem(qemuNamespaceMknodDataPtr data,
 {
     long ttl = sysconf(_SC_SYMLOOP_MAX);
     const char *next = file;
-    size_t i;
 
     while (1) {
         qemuNamespaceMknodItem item = { 0 };
@@ -1167,18 +1197,10 @@ qemuNamespacePrepareOneItem(qemuNamespaceMknodDataPtr data,
         if (qemuNamespaceMknodItemInit(&item, cfg, vm, next) < 0)
             return -1;
 
-        if (STRPREFIX(next, QEMU_DEVPREFIX)) {
-            for (i = 0; i < ndevMountsPath; i++) {
-                if (STREQ(devMountsPath[i], "/dev"))
-                    continue;
-                if (STRPREFIX(next, devMountsPath[i]))
-                    break;
-            }
-
-            if (i == ndevMountsPath &&
-                VIR_APPEND_ELEMENT_COPY(data->items, data->nitems, item) < 0)
-                return -1;
-        }
+        if (STRPREFIX(next, QEMU_DEVPREFIX) &&
+            !qemuNamespacePathIsPreserved(next, devMountsPath, ndevMountsPath) &&
+            VIR_APPEND_ELEMENT_COPY(data->items, data->nitems, item) < 0)
+            return -1;
 
         if (!S_ISLNK(item.sb.st_mode))
             break;
@@ -1197,22 +1219,36 @@ qemuNamespacePrepareOneItem(qemuNamespaceMknodDataPtr data,
 }
 
 
+/**
+ * qemuNamespaceApplyPaths:
+ * @vm: domain object
+ * @mknodPaths: NULL terminated list of paths to create
+ * @unlinkPaths: NULL terminated list of paths to remove
+ *
+ * Removes @unlinkPaths and then creates @mknodPaths in the mount namespace
+ * of @vm. Both lists are handled by a single child process entering the
+ * namespace, and no child is spawned at all if neither of the lists
+ * contains a path that lives under the namespace's private /dev.
+ *
+ * Returns: 0 on success,
+ *         -1 otherwise (with error reported).
+ */
 static int
-qemuNamespaceMknodPaths(virDomainObjPtr vm,
-                        const char **paths)
+qemuNamespaceApplyPaths(virDomainObjPtr vm,
+                        const char **mknodPaths,
+                        const char **unlinkPaths)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
     virQEMUDriverPtr driver = priv->driver;
     g_autoptr(virQEMUDriverConfig) cfg = NULL;
     char **devMountsPath = NULL;
     size_t ndevMountsPath = 0;
-    size_t npaths = 0;
     qemuNamespaceMknodData data = { 0 };
     size_t i;
     int ret = -1;
 
-    npaths = virStringListLength(paths);
-    if (npaths == 0)
+    if (virStringListLength(mknodPaths) == 0 &&
+        virStringListLength(unlinkPaths) == 0)
         return 0;
 
     cfg = virQEMUDriverGetConfig(driver);
@@ -1224,12 +1260,28 @@ qemuNamespaceMknodPaths(virDomainObjPtr vm,
     data.driver = driver;
     data.vm = vm;
 
-    for (i = 0; i < npaths; i++) {
-        if (qemuNamespacePrepareOneItem(&data, cfg, vm, paths[i],
+    for (i = 0; unlinkPaths && unlinkPaths[i]; i++) {
+        const char *file = unlinkPaths[i];
+
+        if (!STRPREFIX(file, QEMU_DEVPREFIX) ||
+            qemuNamespacePathIsPreserved(file, devMountsPath, ndevMountsPath))
+            continue;
+
+        if (virStringListAdd(&data.unlinkPaths, file) < 0)
+            goto cleanup;
+    }
+
+    for (i = 0; mknodPaths && mknodPaths[i]; i++) {
+        if (qemuNamespacePrepareOneItem(&data, cfg, vm, mknodPaths[i],
                                         devMountsPath, ndevMountsPath) < 0)
             goto cleanup;
     }
 
+    if (data.nitems == 0 && !data.unlinkPaths) {
+        ret = 0;
+        goto cleanup;
+    }
+
     for (i = 0; i < data.nitems; i++) {
         qemuNamespaceMknodItemPtr item = &data.items[i];
         if (item->target &&
@@ -1269,8 +1321,9 @@ qemuNamespaceMknodPaths(virDomainObjPtr vm,
 
 
 static int
-qemuNamespaceMknodPaths(virDomainObjPtr vm G_GNUC_UNUSED,
-                        const char **paths G_GNUC_UNUSED)
+qemuNamespaceApplyPaths(virDomainObjPtr vm G_GNUC_UNUSED,
+                        const char **mknodPaths G_GNUC_UNUSED,
+                        const char **unlinkPaths G_GNUC_UNUSED)
 {
     virReportSystemError(ENOSYS, "%s",
                          _("Namespaces are not supported on this platform."));
@@ -1282,80 +1335,166 @@ qemuNamespaceMknodPaths(virDomainObjPtr vm G_GNUC_UNUSED,
 
 
 static int
-qemuNamespaceUnlinkHelper(pid_t pid G_GNUC_UNUSED,
-                          void *opaque)
+qemuNamespaceBatchQueue(char ***queue,
+                        char ***other,
+                        const char **paths)
 {
-    char **paths = opaque;
     size_t i;
 
     for (i = 0; paths[i]; i++) {
-        const char *path = paths[i];
+        /* The latest request for a path wins */
+        virStringListRemove(other, paths[i]);
 
-        VIR_DEBUG("Unlinking %s", path);
-        if (unlink(path) < 0 && errno != ENOENT) {
-            virReportSystemError(errno,
-                                 _("Unable to remove device %s"), path);
+        if (virStringListHasString((const char **) *queue, paths[i]))
+            continue;
+
+        if (virStringListAdd(queue, paths[i]) < 0)
             return -1;
-        }
     }
 
-    g_strfreev(paths);
     return 0;
 }
 
 
+static int
+qemuNamespaceMknodPaths(virDomainObjPtr vm,
+                        const char **paths)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    VIR_AUTOSTRINGLIST missing = NULL;
+    size_t i;
+
+    if (virStringListLength(paths) == 0)
+        return 0;
+
+    if (priv->nsBatchQueue)
+        return qemuNamespaceBatchQueue(&priv->nsBatchMknod,
+                                       &priv->nsBatchUnlink, paths);
+
+    if (!priv->nsBatchCreated)
+        return qemuNamespaceApplyPaths(vm, paths, NULL);
+
+    /* Skip paths the committed batch has already created */
+    for (i = 0; paths[i]; i++) {
+        if (virStringListHasString((const char **) priv->nsBatchCreated,
+                                   paths[i]))
+            continue;
+
+        if (virStringListAdd(&missing, paths[i]) < 0)
+            return -1;
+    }
+
+    return qemuNamespaceApplyPaths(vm, (const char **) missing, NULL);
+}
+
+
 static int
 qemuNamespaceUnlinkPaths(virDomainObjPtr vm,
                          const char **paths)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
-    virQEMUDriverPtr driver = priv->driver;
-    g_autoptr(virQEMUDriverConfig) cfg = NULL;
-    VIR_AUTOSTRINGLIST unlinkPaths = NULL;
-    char **devMountsPath = NULL;
-    size_t ndevMountsPath = 0;
-    size_t npaths;
     size_t i;
-    int ret = -1;
 
-    npaths = virStringListLength(paths);
-    if (!npaths)
+    if (virStringListLength(paths) == 0)
         return 0;
 
-    cfg = virQEMUDriverGetConfig(driver);
+    if (priv->nsBatchQueue)
+        return qemuNamespaceBatchQueue(&priv->nsBatchUnlink,
+                                       &priv->nsBatchMknod, paths);
 
-    if (qemuDomainGetPreservedMounts(cfg, vm,
-                                     &devMountsPath, NULL,
-                                     &ndevMountsPath) < 0)
-        goto cleanup;
+    for (i = 0; paths[i]; i++)
+        virStringListRemove(&priv->nsBatchCreated, paths[i]);
 
-    for (i = 0; i < npaths; i++) {
-        const char *file = paths[i];
+    return qemuNamespaceApplyPaths(vm, NULL, paths);
+}
 
-        if (STRPREFIX(file, QEMU_DEVPREFIX)) {
-            for (i = 0; i < ndevMountsPath; i++) {
-                if (STREQ(devMountsPath[i], "/dev"))
-                    continue;
-                if (STRPREFIX(file, devMountsPath[i]))
-                    break;
-            }
 
-            if (i == ndevMountsPath &&
-                virStringListAdd(&unlinkPaths, file) < 0)
-                return -1;
-        }
-    }
+/**
+ * qemuDomainNamespaceBatchBegin:
+ * @vm: domain object
+ *
+ * Starts a batch of namespace modifications. Until
+ * qemuDomainNamespaceBatchCommit() is called, the qemuDomainNamespaceSetup*()
+ * and qemuDomainNamespaceTeardown*() functions only queue the paths they'd
+ * create or remove in the mount namespace of @vm and return immediately.
+ * Callers must therefore not rely on the queued device nodes being present
+ * before the batch is committed.
+ *
+ * Once committed, paths created by the batch are not created again by
+ * further qemuDomainNamespaceSetup*() calls until qemuDomainNamespaceBatchEnd()
+ * is called. This allows a caller to set up the namespace for a whole set of
+ * devices at once and then process them one by one using the usual helpers.
+ *
+ * Must be called with an active job on @vm.
+ */
+void
+qemuDomainNamespaceBatchBegin(virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    qemuDomainNamespaceBatchEnd(vm);
+
+    if (!qemuDomainNamespaceEnabled(vm, QEMU_DOMAIN_NS_MOUNT))
+        return;
+
+    priv->nsBatchQueue = true;
+}
+
+
+/**
+ * qemuDomainNamespaceBatchCommit:
+ * @vm: domain object
+ *
+ * Applies all the modifications queued since qemuDomainNamespaceBatchBegin()
+ * using a single child process running in the mount namespace of @vm.
+ *
+ * Returns: 0 on success,
+ *         -1 otherwise (with error reported).
+ */
+int
+qemuDomainNamespaceBatchCommit(virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    VIR_AUTOSTRINGLIST mknodPaths = g_steal_pointer(&priv->nsBatchMknod);
+    VIR_AUTOSTRINGLIST unlinkPaths = g_steal_pointer(&priv->nsBatchUnlink);
 
-    if (unlinkPaths &&
-        virProcessRunInMountNamespace(vm->pid,
-                                      qemuNamespaceUnlinkHelper,
-                                      unlinkPaths) < 0)
+    if (!priv->nsBatchQueue)
+        return 0;
+
+    priv->nsBatchQueue = false;
+
+    VIR_DEBUG("Committing namespace batch of %zu mknod and %zu unlink paths",
+              virStringListLength((const char **) mknodPaths),
+              virStringListLength((const char **) unlinkPaths));
+
+    if (qemuNamespaceApplyPaths(vm, (const char **) mknodPaths,
+                                (const char **) unlinkPaths) < 0)
         return -1;
 
-    ret = 0;
- cleanup:
-    virStringListFreeCount(devMountsPath, ndevMountsPath);
-    return ret;
+    priv->nsBatchCreated = g_steal_pointer(&mknodPaths);
+    if (!priv->nsBatchCreated)
+        priv->nsBatchCreated = g_new0(char *, 1);
+
+    return 0;
+}
+
+
+/**
+ * qemuDomainNamespaceBatchEnd:
+ * @vm: domain object
+ *
+ * Finishes the batch started by qemuDomainNamespaceBatchBegin(). Modifications
+ * which were queued but not committed are discarded.
+ */
+void
+qemuDomainNamespaceBatchEnd(virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    priv->nsBatchQueue = false;
+    g_clear_pointer(&priv->nsBatchMknod, g_strfreev);
+    g_clear_pointer(&priv->nsBatchUnlink, g_strfreev);
+    g_clear_pointer(&priv->nsBatchCreated, g_strfreev);
 }
 
 
@@ -1607,3 +1746,63 @@ qemuDomainNamespaceTeardownInput(virDomainObjPtr vm,
 
     return 0;
 }
+
+
+/**
+ * qemuDomainNamespaceSetupDevice:
+ * @vm: domain object
+ * @dev: device about to be attached to @vm
+ *
+ * Creates the devfs representation of @dev in @vm's namespace using the
+ * qemuDomainNamespaceSetup*() helper for its type. Devices which don't need
+ * any device nodes are ignored. This is mainly useful to queue the nodes of
+ * several devices in a single namespace batch.
+ *
+ * Returns: 0 on success,
+ *         -1 otherwise.
+ */
+int
+qemuDomainNamespaceSetupDevice(virDomainObjPtr vm,
+                               virDomainDeviceDefPtr dev)
+{
+    switch ((virDomainDeviceType) dev->type) {
+    case VIR_DOMAIN_DEVICE_DISK:
+        if (virStorageSourceIsEmpty(dev->data.disk->src))
+            return 0;
+        return qemuDomainNamespaceSetupDisk(vm, dev->data.disk->src);
+    case VIR_DOMAIN_DEVICE_HOSTDEV:
+        return qemuDomainNamespaceSetupHostdev(vm, dev->data.hostdev);
+    case VIR_DOMAIN_DEVICE_MEMORY:
+        return qemuDomainNamespaceSetupMemory(vm, dev->data.memory);
+    case VIR_DOMAIN_DEVICE_CHR:
+        return qemuDomainNamespaceSetupChardev(vm, dev->data.chr);
+    case VIR_DOMAIN_DEVICE_RNG:
+        return qemuDomainNamespaceSetupRNG(vm, dev->data.rng);
+    case VIR_DOMAIN_DEVICE_INPUT:
+        return qemuDomainNamespaceSetupInput(vm, dev->data.input);
+
+    case VIR_DOMAIN_DEVICE_NONE:
+    case VIR_DOMAIN_DEVICE_LEASE:
+    case VIR_DOMAIN_DEVICE_FS:
+    case VIR_DOMAIN_DEVICE_NET:
+    case VIR_DOMAIN_DEVICE_SOUND:
+    case VIR_DOMAIN_DEVICE_VIDEO:
+    case VIR_DOMAIN_DEVICE_WATCHDOG:
+    case VIR_DOMAIN_DEVICE_CONTROLLER:
+    case VIR_DOMAIN_DEVICE_GRAPHICS:
+    case VIR_DOMAIN_DEVICE_HUB:
+    case VIR_DOMAIN_DEVICE_REDIRDEV:
+    case VIR_DOMAIN_DEVICE_SMARTCARD:
+    case VIR_DOMAIN_DEVICE_MEMBALLOON:
+    case VIR_DOMAIN_DEVICE_NVRAM:
+    case VIR_DOMAIN_DEVICE_SHMEM:
+    case VIR_DOMAIN_DEVICE_TPM:
+    case VIR_DOMAIN_DEVICE_PANIC:
+    case VIR_DOMAIN_DEVICE_IOMMU:
+    case VIR_DOMAIN_DEVICE_VSOCK:
+    case VIR_DOMAIN_DEVICE_LAST:
+        break;
+    }
+
+    return 0;
+}
@@ -49,6 +49,12 @@ void qemuDomainDestroyNamespace(virQEMUDriverPtr driver,
 
 bool qemuDomainNamespaceAvailable(qemuDomainNamespace ns);
 
+void qemuDomainNamespaceBatchBegin(virDomainObjPtr vm);
+
+int qemuDomainNamespaceBatchCommit(virDomainObjPtr vm);
+
+void qemuDomainNamespaceBatchEnd(virDomainObjPtr vm);
+
 int qemuDomainNamespaceSetupDisk(virDomainObjPtr vm,
                                  virStorageSourcePtr src);
 
@@ -84,3 +90,6 @@ int qemuDomainNamespaceSetupInput(virDomainObjPtr vm,
 
 int qemuDomainNamespaceTeardownInput(virDomainObjPtr vm,
                                      virDomainInputDefPtr input);
+
+int qemuDomainNamespaceSetupDevice(virDomainObjPtr vm,
+                                   virDomainDeviceDefPtr dev);
@@ -93,6 +93,11 @@
 #include "viridentity.h"
 #include "virthreadjob.h"
 #include "virutil.h"
+#include "virprobe.h"
+
+#ifdef WITH_DTRACE_PROBES
+# include "libvirt_qemu_probes.h"
+#endif
 
 #define VIR_FROM_THIS VIR_FROM_QEMU
 
@@ -156,6 +161,7 @@ qemuProcessHandleAgentEOF(qemuAgentPtr agent,
     qemuAgentClose(agent);
     priv->agent = NULL;
     priv->agentError = false;
+    qemuDomainGuestInfoCacheClear(priv);
 
     virObjectUnlock(vm);
     return;
@@ -957,6 +963,9 @@ qemuProcessHandleBlockJob(qemuMonitorPtr mon G_GNUC_UNUSED,
 
     job = qemuBlockJobDiskGetJob(disk);
 
+    if (job)
+        job->infoValid = false;
+
     if (job && job->synchronous) {
         /* We have a SYNC API waiting for this event, dispatch it back */
         job->newstate = status;
@@ -1024,6 +1033,7 @@ qemuProcessHandleJobStatusChange(qemuMonitorPtr mon G_GNUC_UNUSED,
     }
 
     job->newstate = jobnewstate;
+    job->infoValid = false;
 
     if (job->synchronous) {
         VIR_DEBUG("job '%s' handled synchronously", jobname);
@@ -1715,6 +1725,9 @@ qemuProcessHandleMigrationPass(qemuMonitorPtr mon G_GNUC_UNUSED,
         goto cleanup;
     }
 
+    priv->job.current->stats.mig.ram_iteration = pass;
+    virDomainObjBroadcast(vm);
+
     virObjectEventStateQueue(driver->domainEventState,
                          virDomainEventMigrationIterationNewFromObj(vm, pass));
 
@@ -2630,14 +2643,74 @@ qemuProcessSetLinkStates(virQEMUDriverPtr driver,
 }
 
 
+/* Data shared by the setup of all threads of one kind while starting
+ * a domain, so that it's gathered only once */
+typedef struct _qemuProcessSetupPidCache qemuProcessSetupPidCache;
+typedef qemuProcessSetupPidCache *qemuProcessSetupPidCachePtr;
+struct _qemuProcessSetupPidCache {
+    bool hostcpumapValid;
+    virBitmapPtr hostcpumap;    /* affinity of threads without pinning */
+    bool memMaskValid;
+    char *memMask;              /* cpuset.mems of strict NUMA tuning */
+    /* cpuset.cpus and cpuset.mems of the domain cgroup which the new
+     * thread groups start with */
+    char *parentCpus;
+    char *parentMems;
+};
+
+
+static void
+qemuProcessSetupPidCacheInit(virDomainObjPtr vm,
+                             qemuProcessSetupPidCachePtr cache)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+
+    memset(cache, 0, sizeof(*cache));
+
+    if (!virCgroupHasController(priv->cgroup, VIR_CGROUP_CONTROLLER_CPUSET))
+        return;
+
+    /* Not knowing the values only means they'll be written */
+    if (virCgroupGetCpusetCpus(priv->cgroup, &cache->parentCpus) < 0 ||
+        virCgroupGetCpusetMems(priv->cgroup, &cache->parentMems) < 0)
+        virResetLastError();
+}
+
+
+static void
+qemuProcessSetupPidCacheClear(qemuProcessSetupPidCachePtr cache)
+{
+    virBitmapFree(cache->hostcpumap);
+    g_free(cache->memMask);
+    g_free(cache->parentCpus);
+    g_free(cache->parentMems);
+    memset(cache, 0, sizeof(*cache));
+}
+
+
+/* Returns true if the cpuset value @value needn't be written to a thread
+ * group which was just created and inherited @parent */
+static bool
+qemuProcessSetupPidInherited(const char *parent,
+                             const char *value)
+{
+    return parent && value && STREQ(parent, value);
+}
+
+
 /**
  * qemuProcessSetupPid:
+ * @cache: data shared with the setup of other threads, may be NULL
  *
  * This function sets resource properties (affinity, cgroups,
  * scheduler) for any PID associated with a domain.  It should be used
  * to set up emulator PIDs as well as vCPU and I/O thread pids to
  * ensure they are all handled the same way.
  *
+ * With @cache, which must be used only for the threads of a domain being
+ * started, cpuset values equal to the ones the new thread group inherited
+ * from the domain group are not written again.
+ *
  * Returns 0 on success, -1 on error.
  */
 static int
@@ -2648,7 +2721,8 @@ qemuProcessSetupPid(virDomainObjPtr vm,
                     virBitmapPtr cpumask,
                     unsigned long long period,
                     long long quota,
-                    virDomainThreadSchedParamPtr sched)
+                    virDomainThreadSchedParamPtr sched,
+                    qemuProcessSetupPidCachePtr cache)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
     virDomainNumatuneMemMode mem_mode;
@@ -2657,6 +2731,8 @@ qemuProcessSetupPid(virDomainObjPtr vm,
     virBitmapPtr affinity_cpumask = NULL;
     g_autoptr(virBitmap) hostcpumap = NULL;
     g_autofree char *mem_mask = NULL;
+    g_autofree char *cpus = NULL;
+    const char *use_mem_mask = NULL;
     int ret = -1;
 
     if ((period || quota) &&
@@ -2673,6 +2749,13 @@ qemuProcessSetupPid(virDomainObjPtr vm,
         use_cpumask = priv->autoCpuset;
     } else if (vm->def->cpumask) {
         use_cpumask = vm->def->cpumask;
+    } else if (cache) {
+        if (!cache->hostcpumapValid) {
+            if (qemuProcessGetAllCpuAffinity(&cache->hostcpumap) < 0)
+                goto cleanup;
+            cache->hostcpumapValid = true;
+        }
+        affinity_cpumask = cache->hostcpumap;
     } else {
         /* You may think this is redundant, but we can't assume libvirtd
          * itself is running on all pCPUs, so we need to explicitly set
@@ -2691,22 +2774,44 @@ qemuProcessSetupPid(virDomainObjPtr vm,
     if (virCgroupHasController(priv->cgroup, VIR_CGROUP_CONTROLLER_CPU) ||
         virCgroupHasController(priv->cgroup, VIR_CGROUP_CONTROLLER_CPUSET)) {
 
-        if (virDomainNumatuneGetMode(vm->def->numa, -1, &mem_mode) == 0 &&
-            mem_mode == VIR_DOMAIN_NUMATUNE_MEM_STRICT &&
-            virDomainNumatuneMaybeFormatNodeset(vm->def->numa,
-                                                priv->autoNodeset,
-                                                &mem_mask, -1) < 0)
-            goto cleanup;
+        if (cache && cache->memMaskValid) {
+            use_mem_mask = cache->memMask;
+        } else {
+            if (virDomainNumatuneGetMode(vm->def->numa, -1, &mem_mode) == 0 &&
+                mem_mode == VIR_DOMAIN_NUMATUNE_MEM_STRICT &&
+                virDomainNumatuneMaybeFormatNodeset(vm->def->numa,
+                                                    priv->autoNodeset,
+                                                    &mem_mask, -1) < 0)
+                goto cleanup;
+
+            use_mem_mask = mem_mask;
+            if (cache) {
+                cache->memMask = g_steal_pointer(&mem_mask);
+                cache->memMaskValid = true;
+            }
+        }
 
         if (virCgroupNewThread(priv->cgroup, nameval, id, true, &cgroup) < 0)
             goto cleanup;
 
+        virCgroupBatchBegin(cgroup);
+
         if (virCgroupHasController(priv->cgroup, VIR_CGROUP_CONTROLLER_CPUSET)) {
-            if (use_cpumask &&
-                qemuSetupCgroupCpusetCpus(cgroup, use_cpumask) < 0)
-                goto cleanup;
+            if (use_cpumask) {
+                if (!(cpus = virBitmapFormat(use_cpumask)))
+                    goto cleanup;
+
+                if (!(cache &&
+                      qemuProcessSetupPidInherited(cache->parentCpus, cpus)) &&
+                    virCgroupSetCpusetCpus(cgroup, cpus) < 0)
+                    goto cleanup;
+            }
 
-            if (mem_mask && virCgroupSetCpusetMems(cgroup, mem_mask) < 0)
+            if (use_mem_mask &&
+                !(cache &&
+                  qemuProcessSetupPidInherited(cache->parentMems,
+                                               use_mem_mask)) &&
+                virCgroupSetCpusetMems(cgroup, use_mem_mask) < 0)
                 goto cleanup;
 
         }
@@ -2719,6 +2824,7 @@ qemuProcessSetupPid(virDomainObjPtr vm,
         if (virCgroupAddThread(cgroup, pid) < 0)
             goto cleanup;
 
+        virCgroupBatchEnd(cgroup);
     }
 
     if (!affinity_cpumask)
@@ -2737,6 +2843,7 @@ qemuProcessSetupPid(virDomainObjPtr vm,
     ret = 0;
  cleanup:
     if (cgroup) {
+        virCgroupBatchEnd(cgroup);
         if (ret < 0)
             virCgroupRemove(cgroup);
         virCgroupFree(&cgroup);
@@ -2753,7 +2860,8 @@ qemuProcessSetupEmulator(virDomainObjPtr vm)
                                0, vm->def->cputune.emulatorpin,
                                vm->def->cputune.emulator_period,
                                vm->def->cputune.emulator_quota,
-                               vm->def->cputune.emulatorsched);
+                               vm->def->cputune.emulatorsched,
+                               NULL);
 }
 
 
@@ -3938,6 +4046,202 @@ qemuProcessDestroyMemoryBackingPath(virQEMUDriverPtr driver,
 }
 
 
+/**
+ * qemuProcessGetCellHugepageSize:
+ * @cfg: driver config
+ * @def: domain definition
+ * @cell: guest NUMA node, or -1 for domains without NUMA
+ *
+ * Returns the size in KiB of huge pages backing guest NUMA node @cell, or
+ * 0 if it isn't backed by huge pages.
+ */
+static unsigned long long
+qemuProcessGetCellHugepageSize(virQEMUDriverConfigPtr cfg,
+                               virDomainDefPtr def,
+                               int cell)
+{
+    virDomainHugePagePtr hugepage = NULL;
+    virHugeTLBFSPtr fs;
+    size_t i;
+
+    for (i = 0; i < def->mem.nhugepages; i++) {
+        bool thisHugepage = false;
+
+        if (!def->mem.hugepages[i].nodemask) {
+            if (!hugepage)
+                hugepage = &def->mem.hugepages[i];
+            continue;
+        }
+
+        if (cell >= 0 &&
+            virBitmapGetBit(def->mem.hugepages[i].nodemask, cell,
+                            &thisHugepage) == 0 &&
+            thisHugepage) {
+            hugepage = &def->mem.hugepages[i];
+            break;
+        }
+    }
+
+    if (!hugepage)
+        return 0;
+
+    if (hugepage->size)
+        return hugepage->size;
+
+    if (cfg->nhugetlbfs == 0)
+        return 0;
+
+    if (!(fs = virFileGetDefaultHugepage(cfg->hugetlbfs, cfg->nhugetlbfs)))
+        fs = &cfg->hugetlbfs[0];
+
+    return fs->size;
+}
+
+
+static void
+qemuProcessReserveHugepagesNode(qemuDomainObjPrivatePtr priv,
+                                int node,
+                                unsigned int pagesize,
+                                unsigned long long count)
+{
+    qemuDomainHugepageReservation res = { node, pagesize, count };
+
+    if (virNumaSetPagePoolSize(node, pagesize, count, true) < 0) {
+        VIR_WARN("Unable to reserve %llu huge pages of %u KiB on host node %d: %s",
+                 count, pagesize, node, virGetLastErrorMessage());
+        virResetLastError();
+        return;
+    }
+
+    VIR_DEBUG("Reserved %llu huge pages of %u KiB on host node %d",
+              count, pagesize, node);
+
+    ignore_value(VIR_APPEND_ELEMENT(priv->hugepageReservations,
+                                    priv->nhugepageReservations, res));
+}
+
+
+/**
+ * qemuProcessReserveHugepages:
+ * @driver: qemu driver
+ * @vm: domain object
+ *
+ * With hugepage_reserve set, grows the huge page pools of the host NUMA
+ * nodes the memory of @vm is bound to so that they have enough free
+ * pages for its memory. The pages added are remembered and given back
+ * by qemuProcessReleaseHugepages() once the domain stops. Guest NUMA
+ * nodes whose memory isn't bound to host nodes are skipped as the
+ * kernel may place it anywhere. Failures are not fatal, QEMU reports
+ * insufficient huge pages itself.
+ */
+static void
+qemuProcessReserveHugepages(virQEMUDriverPtr driver,
+                            virDomainObjPtr vm)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    virDomainDefPtr def = vm->def;
+    size_t ncells = virDomainNumaGetNodeCount(def->numa);
+    int cell;
+
+    if (!cfg->hugepageReserve || def->mem.nhugepages == 0)
+        return;
+
+    virMutexLock(&driver->lock);
+
+    for (cell = ncells ? 0 : -1; cell < (int) ncells; cell++) {
+        unsigned long long pagesize;
+        unsigned long long size;
+        unsigned long long needed;
+        unsigned long long nfree = 0;
+        unsigned long long share;
+        virBitmapPtr nodemask = NULL;
+        ssize_t node;
+        size_t nnodes;
+
+        if ((pagesize = qemuProcessGetCellHugepageSize(cfg, def, cell)) == 0 ||
+            pagesize == virGetSystemPageSizeKB())
+            continue;
+
+        if (virDomainNumatuneMaybeGetNodeset(def->numa, priv->autoNodeset,
+                                             &nodemask, cell) < 0 ||
+            !nodemask || (nnodes = virBitmapCountBits(nodemask)) == 0) {
+            virResetLastError();
+            continue;
+        }
+
+        if (cell >= 0)
+            size = virDomainNumaGetNodeMemorySize(def->numa, cell);
+        else
+            size = virDomainDefGetMemoryInitial(def);
+        needed = VIR_DIV_UP(size, pagesize);
+
+        node = -1;
+        while ((node = virBitmapNextSetBit(nodemask, node)) >= 0) {
+            unsigned long long nodeFree = 0;
+
+            if (virNumaGetPageInfo(node, pagesize, 0, NULL, &nodeFree) < 0) {
+                virResetLastError();
+                continue;
+            }
+            nfree += nodeFree;
+        }
+
+        if (nfree >= needed)
+            continue;
+
+        /* spread the missing pages over the nodes the memory is bound to */
+        share = VIR_DIV_UP(needed - nfree, nnodes);
+        node = -1;
+        while ((node = virBitmapNextSetBit(nodemask, node)) >= 0)
+            qemuProcessReserveHugepagesNode(priv, node, pagesize, share);
+    }
+
+    virMutexUnlock(&driver->lock);
+}
+
+
+/**
+ * qemuProcessReleaseHugepages:
+ * @driver: qemu driver
+ * @vm: domain object
+ *
+ * Shrinks the huge page pools by the pages reserved for @vm by
+ * qemuProcessReserveHugepages().
+ */
+static void
+qemuProcessReleaseHugepages(virQEMUDriverPtr driver,
+                            virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    size_t i;
+
+    if (priv->nhugepageReservations == 0)
+        return;
+
+    virMutexLock(&driver->lock);
+
+    for (i = 0; i < priv->nhugepageReservations; i++) {
+        qemuDomainHugepageReservationPtr res = &priv->hugepageReservations[i];
+        unsigned long long total = 0;
+
+        if (virNumaGetPageInfo(res->node, res->pagesize, 0, &total, NULL) < 0 ||
+            virNumaSetPagePoolSize(res->node, res->pagesize,
+                                   total - MIN(total, res->count), false) < 0) {
+            VIR_WARN("Unable to release %llu huge pages of %u KiB on host node %d: %s",
+                     res->count, res->pagesize, res->node,
+                     virGetLastErrorMessage());
+            virResetLastError();
+        }
+    }
+
+    virMutexUnlock(&driver->lock);
+
+    VIR_FREE(priv->hugepageReservations);
+    priv->nhugepageReservations = 0;
+}
+
+
 static int
 qemuProcessVNCAllocatePorts(virQEMUDriverPtr driver,
                             virDomainGraphicsDefPtr graphics,
@@ -4592,6 +4896,19 @@ void
 qemuProcessEndJob(virQEMUDriverPtr driver,
                   virDomainObjPtr vm)
 {
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainJobInfoPtr jobInfo = priv->job.current;
+
+    /* keep the timing of the startup phases for
+     * VIR_DOMAIN_JOB_STATS_COMPLETED */
+    if (jobInfo && jobInfo->statsType == QEMU_DOMAIN_JOB_STATS_TYPE_START) {
+        ignore_value(qemuDomainJobInfoUpdateTime(jobInfo));
+        jobInfo->status = virDomainObjIsActive(vm) ?
+            QEMU_DOMAIN_JOB_STATUS_COMPLETED : QEMU_DOMAIN_JOB_STATUS_FAILED;
+        g_clear_pointer(&priv->job.completed, qemuDomainJobInfoFree);
+        priv->job.completed = qemuDomainJobInfoCopy(jobInfo);
+    }
+
     qemuDomainObjEndAsyncJob(driver, vm);
 }
 
@@ -5506,6 +5823,83 @@ qemuProcessPrepareQEMUCaps(virDomainObjPtr vm,
 }
 
 
+/*
+ * qemuProcessPhaseBegin/qemuProcessPhaseEnd mark a phase of domain
+ * startup for the qemu_process_phase_begin/end probes and time it in the
+ * statistics of the current job. The latter returns @ret so that it can
+ * wrap the call implementing the phase.
+ */
+static void
+qemuProcessPhaseBegin(virDomainObjPtr vm,
+                      qemuDomainStartPhase phase)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainJobInfoPtr jobInfo = priv->job.current;
+    const char *name = qemuDomainStartPhaseTypeToString(phase);
+
+    VIR_DEBUG("Starting phase %s of domain %s", name, vm->def->name);
+    PROBE_QUIET(QEMU_PROCESS_PHASE_BEGIN, "vm=%s phase=%s",
+                vm->def->name, name);
+
+    if (!jobInfo)
+        return;
+
+    if (jobInfo->statsType == QEMU_DOMAIN_JOB_STATS_TYPE_NONE)
+        jobInfo->statsType = QEMU_DOMAIN_JOB_STATS_TYPE_START;
+
+    jobInfo->startPhasesDone &= ~(1U << phase);
+    if (virTimeMillisNow(&jobInfo->startPhases[phase]) < 0)
+        jobInfo->startPhases[phase] = 0;
+}
+
+
+static int
+qemuProcessPhaseEnd(virDomainObjPtr vm,
+                    qemuDomainStartPhase phase,
+                    int ret)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainJobInfoPtr jobInfo = priv->job.current;
+    const char *name = qemuDomainStartPhaseTypeToString(phase);
+    unsigned long long now;
+
+    VIR_DEBUG("Finished phase %s of domain %s: %d", name, vm->def->name, ret);
+    PROBE_QUIET(QEMU_PROCESS_PHASE_END, "vm=%s phase=%s ret=%d",
+                vm->def->name, name, ret);
+
+    if (jobInfo && jobInfo->startPhases[phase] &&
+        virTimeMillisNow(&now) == 0) {
+        jobInfo->startPhases[phase] = now - jobInfo->startPhases[phase];
+        jobInfo->startPhasesDone |= 1U << phase;
+    }
+
+    return ret;
+}
+
+
+/* Logs how long the phases of starting @vm took */
+static void
+qemuProcessLogStartPhases(virDomainObjPtr vm)
+{
+    qemuDomainObjPrivatePtr priv = vm->privateData;
+    qemuDomainJobInfoPtr jobInfo = priv->job.current;
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+
+    if (!jobInfo || !jobInfo->startPhasesDone)
+        return;
+
+    for (i = 0; i < QEMU_DOMAIN_START_PHASE_LAST; i++) {
+        if (jobInfo->startPhasesDone & (1U << i))
+            virBufferAsprintf(&buf, " %s=%llums",
+                              qemuDomainStartPhaseTypeToString(i),
+                              jobInfo->startPhases[i]);
+    }
+
+    VIR_INFO("Domain %s started:%s", vm->def->name, virBufferCurrentContent(&buf));
+}
+
+
 /**
  * qemuProcessInit:
  *
@@ -5675,20 +6069,10 @@ qemuProcessNetworkPrepareDevices(virQEMUDriverPtr driver,
 }
 
 
-/**
- * qemuProcessSetupVcpu:
- * @vm: domain object
- * @vcpuid: id of VCPU to set defaults
- *
- * This function sets resource properties (cgroups, affinity, scheduler) for a
- * vCPU. This function expects that the vCPU is online and the vCPU pids were
- * correctly detected at the point when it's called.
- *
- * Returns 0 on success, -1 on error.
- */
-int
-qemuProcessSetupVcpu(virDomainObjPtr vm,
-                     unsigned int vcpuid)
+static int
+qemuProcessSetupVcpuInternal(virDomainObjPtr vm,
+                             unsigned int vcpuid,
+                             qemuProcessSetupPidCachePtr cache)
 {
     pid_t vcpupid = qemuDomainGetVcpuPid(vm, vcpuid);
     virDomainVcpuDefPtr vcpu = virDomainDefGetVcpu(vm->def, vcpuid);
@@ -5699,7 +6083,7 @@ qemuProcessSetupVcpu(virDomainObjPtr vm,
                             vcpuid, vcpu->cpumask,
                             vm->def->cputune.period,
                             vm->def->cputune.quota,
-                            &vcpu->sched) < 0)
+                            &vcpu->sched, cache) < 0)
         return -1;
 
     for (i = 0; i < vm->def->nresctrls; i++) {
@@ -5732,12 +6116,33 @@ qemuProcessSetupVcpu(virDomainObjPtr vm,
 }
 
 
+/**
+ * qemuProcessSetupVcpu:
+ * @vm: domain object
+ * @vcpuid: id of VCPU to set defaults
+ *
+ * This function sets resource properties (cgroups, affinity, scheduler) for a
+ * vCPU. This function expects that the vCPU is online and the vCPU pids were
+ * correctly detected at the point when it's called.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuProcessSetupVcpu(virDomainObjPtr vm,
+                     unsigned int vcpuid)
+{
+    return qemuProcessSetupVcpuInternal(vm, vcpuid, NULL);
+}
+
+
 static int
 qemuProcessSetupVcpus(virDomainObjPtr vm)
 {
     virDomainVcpuDefPtr vcpu;
     unsigned int maxvcpus = virDomainDefGetVcpusMax(vm->def);
+    qemuProcessSetupPidCache cache;
     size_t i;
+    int ret = -1;
 
     if ((vm->def->cputune.period || vm->def->cputune.quota) &&
         !virCgroupHasController(((qemuDomainObjPrivatePtr) vm->privateData)->cgroup,
@@ -5767,23 +6172,30 @@ qemuProcessSetupVcpus(virDomainObjPtr vm)
         return 0;
     }
 
+    qemuProcessSetupPidCacheInit(vm, &cache);
+
     for (i = 0; i < maxvcpus; i++) {
         vcpu = virDomainDefGetVcpu(vm->def, i);
 
         if (!vcpu->online)
             continue;
 
-        if (qemuProcessSetupVcpu(vm, i) < 0)
-            return -1;
+        if (qemuProcessSetupVcpuInternal(vm, i, &cache) < 0)
+            goto cleanup;
     }
 
-    return 0;
+    ret = 0;
+
+ cleanup:
+    qemuProcessSetupPidCacheClear(&cache);
+    return ret;
 }
 
 
-int
-qemuProcessSetupIOThread(virDomainObjPtr vm,
-                         virDomainIOThreadIDDefPtr iothread)
+static int
+qemuProcessSetupIOThreadInternal(virDomainObjPtr vm,
+                                 virDomainIOThreadIDDefPtr iothread,
+                                 qemuProcessSetupPidCachePtr cache)
 {
     return qemuProcessSetupPid(vm, iothread->thread_id,
                                VIR_CGROUP_THREAD_IOTHREAD,
@@ -5791,23 +6203,39 @@ qemuProcessSetupIOThread(virDomainObjPtr vm,
                                iothread->cpumask,
                                vm->def->cputune.iothread_period,
                                vm->def->cputune.iothread_quota,
-                               &iothread->sched);
+                               &iothread->sched, cache);
+}
+
+
+int
+qemuProcessSetupIOThread(virDomainObjPtr vm,
+                         virDomainIOThreadIDDefPtr iothread)
+{
+    return qemuProcessSetupIOThreadInternal(vm, iothread, NULL);
 }
 
 
 static int
 qemuProcessSetupIOThreads(virDomainObjPtr vm)
 {
+    qemuProcessSetupPidCache cache;
     size_t i;
+    int ret = -1;
+
+    qemuProcessSetupPidCacheInit(vm, &cache);
 
     for (i = 0; i < vm->def->niothreadids; i++) {
         virDomainIOThreadIDDefPtr info = vm->def->iothreadids[i];
 
-        if (qemuProcessSetupIOThread(vm, info) < 0)
-            return -1;
+        if (qemuProcessSetupIOThreadInternal(vm, info, &cache) < 0)
+            goto cleanup;
     }
 
-    return 0;
+    ret = 0;
+
+ cleanup:
+    qemuProcessSetupPidCacheClear(&cache);
+    return ret;
 }
 
 
@@ -6090,34 +6518,108 @@ qemuProcessUpdateGuestCPU(virDomainDefPtr def,
 }
 
 
+/**
+ * qemuProcessGetBuiltinNUMAPlacement:
+ * @driver: qemu driver data
+ * @def: domain definition
+ *
+ * Pick host NUMA nodes fitting the vCPUs, IOThreads and memory of @def
+ * without asking numad. The memory is checked against free pages of the
+ * hugepage size backing the domain, if any. Nodes with PCI host devices of
+ * the domain attached are preferred, and CPUs claimed by other automatically
+ * placed domains are accounted for.
+ *
+ * Returns the bitmap of nodes on success, NULL on error.
+ */
+static virBitmapPtr
+qemuProcessGetBuiltinNUMAPlacement(virQEMUDriverPtr driver,
+                                   virDomainDefPtr def)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    g_autofree virNumaPlacementNodePtr nodes = NULL;
+    size_t nnodes = 0;
+    unsigned int pageSize = 0;
+    size_t i;
+    size_t j;
+
+    if (def->mem.nhugepages > 0) {
+        pageSize = def->mem.hugepages[0].size;
+
+        if (pageSize == 0) {
+            virHugeTLBFSPtr fs = virFileGetDefaultHugepage(cfg->hugetlbfs,
+                                                           cfg->nhugetlbfs);
+
+            if (fs)
+                pageSize = fs->size;
+        }
+    }
+
+    if (virNumaGetPlacementNodes(pageSize, &nodes, &nnodes) < 0)
+        return NULL;
+
+    for (i = 0; i < nnodes; i++)
+        nodes[i].load = virQEMUDriverGetNUMALoad(driver, nodes[i].node);
+
+    for (i = 0; i < def->nhostdevs; i++) {
+        virDomainHostdevDefPtr hostdev = def->hostdevs[i];
+        int node;
+
+        if (hostdev->mode != VIR_DOMAIN_HOSTDEV_MODE_SUBSYS ||
+            hostdev->source.subsys.type != VIR_DOMAIN_HOSTDEV_SUBSYS_TYPE_PCI)
+            continue;
+
+        if ((node = virPCIDeviceAddressGetNUMANode(&hostdev->source.subsys.u.pci.addr)) < 0)
+            continue;
+
+        for (j = 0; j < nnodes; j++) {
+            if (nodes[j].node == node)
+                nodes[j].local = true;
+        }
+    }
+
+    return virNumaSelectPlacement(nodes, nnodes,
+                                  virDomainDefGetVcpus(def) + def->niothreadids,
+                                  virDomainDefGetMemoryTotal(def));
+}
+
+
 static int
 qemuProcessPrepareDomainNUMAPlacement(virQEMUDriverPtr driver,
                                       virDomainObjPtr vm)
 {
     qemuDomainObjPrivatePtr priv = vm->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     g_autofree char *nodeset = NULL;
-    g_autoptr(virBitmap) numadNodeset = NULL;
+    g_autoptr(virBitmap) autoNodeset = NULL;
     g_autoptr(virBitmap) hostMemoryNodeset = NULL;
     g_autoptr(virCapsHostNUMA) caps = NULL;
 
-    /* Get the advisory nodeset from numad if 'placement' of
-     * either <vcpu> or <numatune> is 'auto'.
+    /* Get the advisory nodeset from numad or the builtin engine if
+     * 'placement' of either <vcpu> or <numatune> is 'auto'.
      */
     if (!virDomainDefNeedsPlacementAdvice(vm->def))
         return 0;
 
-    nodeset = virNumaGetAutoPlacementAdvice(virDomainDefGetVcpus(vm->def),
-                                            virDomainDefGetMemoryTotal(vm->def));
+    if (cfg->numaPlacementBuiltin) {
+        if (!(autoNodeset = qemuProcessGetBuiltinNUMAPlacement(driver, vm->def)))
+            return -1;
 
-    if (!nodeset)
-        return -1;
+        nodeset = virBitmapFormat(autoNodeset);
+        VIR_DEBUG("Nodeset picked by builtin placement: %s", NULLSTR(nodeset));
+    } else {
+        nodeset = virNumaGetAutoPlacementAdvice(virDomainDefGetVcpus(vm->def),
+                                                virDomainDefGetMemoryTotal(vm->def));
 
-    if (!(hostMemoryNodeset = virNumaGetHostMemoryNodeset()))
-        return -1;
+        if (!nodeset)
+            return -1;
+
+        VIR_DEBUG("Nodeset returned from numad: %s", nodeset);
 
-    VIR_DEBUG("Nodeset returned from numad: %s", nodeset);
+        if (virBitmapParse(nodeset, &autoNodeset, VIR_DOMAIN_CPUMASK_LEN) < 0)
+            return -1;
+    }
 
-    if (virBitmapParse(nodeset, &numadNodeset, VIR_DOMAIN_CPUMASK_LEN) < 0)
+    if (!(hostMemoryNodeset = virNumaGetHostMemoryNodeset()))
         return -1;
 
     if (!(caps = virQEMUDriverGetHostNUMACaps(driver)))
@@ -6126,12 +6628,14 @@ qemuProcessPrepareDomainNUMAPlacement(virQEMUDriverPtr driver,
     /* numad may return a nodeset that only contains cpus but cgroups don't play
      * well with that. Set the autoCpuset from all cpus from that nodeset, but
      * assign autoNodeset only with nodes containing memory. */
-    if (!(priv->autoCpuset = virCapabilitiesHostNUMAGetCpus(caps, numadNodeset)))
+    if (!(priv->autoCpuset = virCapabilitiesHostNUMAGetCpus(caps, autoNodeset)))
         return -1;
 
-    virBitmapIntersect(numadNodeset, hostMemoryNodeset);
+    virBitmapIntersect(autoNodeset, hostMemoryNodeset);
 
-    priv->autoNodeset = g_steal_pointer(&numadNodeset);
+    priv->autoNodeset = g_steal_pointer(&autoNodeset);
+
+    qemuDomainNUMALoadCharge(driver, vm);
 
     return 0;
 }
@@ -6488,8 +6992,11 @@ qemuProcessPrepareHost(virQEMUDriverPtr driver,
         hostdev_flags |= VIR_HOSTDEV_STRICT_ACS_CHECK;
     if (flags & VIR_QEMU_PROCESS_START_NEW)
         hostdev_flags |= VIR_HOSTDEV_COLD_BOOT;
-    if (qemuHostdevPrepareDomainDevices(driver, vm->def, priv->qemuCaps,
-                                        hostdev_flags) < 0)
+    qemuProcessPhaseBegin(vm, QEMU_DOMAIN_START_PHASE_HOSTDEV);
+    if (qemuProcessPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_HOSTDEV,
+                            qemuHostdevPrepareDomainDevices(driver, vm->def,
+                                                            priv->qemuCaps,
+                                                            hostdev_flags)) < 0)
         return -1;
 
     VIR_DEBUG("Preparing chr devices");
@@ -6502,6 +7009,8 @@ qemuProcessPrepareHost(virQEMUDriverPtr driver,
     if (qemuProcessBuildDestroyMemoryPaths(driver, vm, NULL, true) < 0)
         return -1;
 
+    qemuProcessReserveHugepages(driver, vm);
+
     /* Ensure no historical cgroup for this VM is lying around bogus
      * settings */
     VIR_DEBUG("Ensuring no historical cgroup is lying around");
@@ -6800,7 +7309,9 @@ qemuProcessLaunch(virConnectPtr conn,
 
     if (qemuSecurityPreFork(driver->securityManager) < 0)
         goto cleanup;
-    rv = virCommandRun(cmd, NULL);
+    qemuProcessPhaseBegin(vm, QEMU_DOMAIN_START_PHASE_EXEC);
+    rv = qemuProcessPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_EXEC,
+                             virCommandRun(cmd, NULL));
     qemuSecurityPostFork(driver->securityManager);
 
     /* wait for qemu process to show up */
@@ -6836,7 +7347,9 @@ qemuProcessLaunch(virConnectPtr conn,
         goto cleanup;
 
     VIR_DEBUG("Setting up domain cgroup (if required)");
-    if (qemuSetupCgroup(vm, nnicindexes, nicindexes) < 0)
+    qemuProcessPhaseBegin(vm, QEMU_DOMAIN_START_PHASE_CGROUP);
+    if (qemuProcessPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_CGROUP,
+                            qemuSetupCgroup(vm, nnicindexes, nicindexes)) < 0)
         goto cleanup;
 
     if (!(priv->perf = virPerfNew()))
@@ -6871,10 +7384,12 @@ qemuProcessLaunch(virConnectPtr conn,
         goto cleanup;
 
     VIR_DEBUG("Setting domain security labels");
-    if (qemuSecuritySetAllLabel(driver,
-                                vm,
-                                incoming ? incoming->path : NULL,
-                                incoming != NULL) < 0)
+    qemuProcessPhaseBegin(vm, QEMU_DOMAIN_START_PHASE_SECURITY_LABEL);
+    if (qemuProcessPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_SECURITY_LABEL,
+                            qemuSecuritySetAllLabel(driver,
+                                                    vm,
+                                                    incoming ? incoming->path : NULL,
+                                                    incoming != NULL)) < 0)
         goto cleanup;
 
     /* Security manager labeled all devices, therefore
@@ -6917,7 +7432,10 @@ qemuProcessLaunch(virConnectPtr conn,
         goto cleanup;
 
     VIR_DEBUG("Waiting for monitor to show up");
-    if (qemuProcessWaitForMonitor(driver, vm, asyncJob, logCtxt) < 0)
+    qemuProcessPhaseBegin(vm, QEMU_DOMAIN_START_PHASE_MONITOR);
+    if (qemuProcessPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_MONITOR,
+                            qemuProcessWaitForMonitor(driver, vm, asyncJob,
+                                                      logCtxt)) < 0)
         goto cleanup;
 
     if (qemuConnectAgent(driver, vm) < 0)
@@ -7126,8 +7644,10 @@ qemuProcessStart(virConnectPtr conn,
     if (!migrateFrom && !snapshot)
         flags |= VIR_QEMU_PROCESS_START_NEW;
 
-    if (qemuProcessInit(driver, vm, updatedCPU,
-                        asyncJob, !!migrateFrom, flags) < 0)
+    qemuProcessPhaseBegin(vm, QEMU_DOMAIN_START_PHASE_INIT);
+    if (qemuProcessPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_INIT,
+                            qemuProcessInit(driver, vm, updatedCPU,
+                                            asyncJob, !!migrateFrom, flags)) < 0)
         goto cleanup;
 
     if (migrateFrom) {
@@ -7137,10 +7657,14 @@ qemuProcessStart(virConnectPtr conn,
             goto stop;
     }
 
-    if (qemuProcessPrepareDomain(driver, vm, flags) < 0)
+    qemuProcessPhaseBegin(vm, QEMU_DOMAIN_START_PHASE_PREPARE_DOMAIN);
+    if (qemuProcessPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_PREPARE_DOMAIN,
+                            qemuProcessPrepareDomain(driver, vm, flags)) < 0)
         goto stop;
 
-    if (qemuProcessPrepareHost(driver, vm, flags) < 0)
+    qemuProcessPhaseBegin(vm, QEMU_DOMAIN_START_PHASE_PREPARE_HOST);
+    if (qemuProcessPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_PREPARE_HOST,
+                            qemuProcessPrepareHost(driver, vm, flags)) < 0)
         goto stop;
 
     if (migratePath) {
@@ -7150,8 +7674,11 @@ qemuProcessStart(virConnectPtr conn,
         relabelSavedState = true;
     }
 
-    if ((rv = qemuProcessLaunch(conn, driver, vm, asyncJob, incoming,
-                                snapshot, vmop, flags)) < 0) {
+    qemuProcessPhaseBegin(vm, QEMU_DOMAIN_START_PHASE_LAUNCH);
+    if ((rv = qemuProcessPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_LAUNCH,
+                                  qemuProcessLaunch(conn, driver, vm, asyncJob,
+                                                    incoming, snapshot, vmop,
+                                                    flags))) < 0) {
         if (rv == -2)
             relabel = true;
         goto stop;
@@ -7166,15 +7693,20 @@ qemuProcessStart(virConnectPtr conn,
         /* Refresh state of devices from QEMU. During migration this happens
          * in qemuMigrationDstFinish to ensure that state information is fully
          * transferred. */
-        if (qemuProcessRefreshState(driver, vm, asyncJob) < 0)
+        qemuProcessPhaseBegin(vm, QEMU_DOMAIN_START_PHASE_REFRESH_STATE);
+        if (qemuProcessPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_REFRESH_STATE,
+                                qemuProcessRefreshState(driver, vm,
+                                                        asyncJob)) < 0)
             goto stop;
     }
 
-    if (qemuProcessFinishStartup(driver, vm, asyncJob,
-                                 !(flags & VIR_QEMU_PROCESS_START_PAUSED),
-                                 incoming ?
-                                 VIR_DOMAIN_PAUSED_MIGRATION :
-                                 VIR_DOMAIN_PAUSED_USER) < 0)
+    qemuProcessPhaseBegin(vm, QEMU_DOMAIN_START_PHASE_FINISH_STARTUP);
+    if (qemuProcessPhaseEnd(vm, QEMU_DOMAIN_START_PHASE_FINISH_STARTUP,
+                            qemuProcessFinishStartup(driver, vm, asyncJob,
+                                                     !(flags & VIR_QEMU_PROCESS_START_PAUSED),
+                                                     incoming ?
+                                                     VIR_DOMAIN_PAUSED_MIGRATION :
+                                                     VIR_DOMAIN_PAUSED_USER)) < 0)
         goto stop;
 
     if (!incoming) {
@@ -7183,6 +7715,8 @@ qemuProcessStart(virConnectPtr conn,
         qemuMonitorSetDomainLog(priv->mon, NULL, NULL, NULL);
     }
 
+    qemuProcessLogStartPhases(vm);
+
     ret = 0;
 
  cleanup:
@@ -7639,6 +8173,9 @@ void qemuProcessStop(virQEMUDriverPtr driver,
         }
     }
 
+    qemuDomainNUMALoadRelease(driver, vm);
+    qemuProcessReleaseHugepages(driver, vm);
+
     /* clear all private data entries which are no longer needed */
     qemuDomainObjPrivateDataClear(priv);
 
@@ -7998,11 +8535,82 @@ qemuProcessRefreshBlockjobs(virQEMUDriverPtr driver,
 }
 
 
+/**
+ * qemuProcessReconnectRefresh:
+ * @driver: qemu driver
+ * @vm: domain object
+ *
+ * Refreshes the state which doesn't need to be known right after
+ * reconnecting to a running domain and can thus be left to a background
+ * job if reconnect_defer_refresh is set. The caller has to hold a job.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+qemuProcessReconnectRefresh(virQEMUDriverPtr driver,
+                            virDomainObjPtr vm)
+{
+    if (qemuRefreshVirtioChannelState(driver, vm, QEMU_ASYNC_JOB_NONE) < 0)
+        return -1;
+
+    /* If querying of guest's RTC failed, report error, but do not kill the domain. */
+    qemuRefreshRTC(driver, vm);
+
+    if (qemuProcessRefreshBalloonState(driver, vm, QEMU_ASYNC_JOB_NONE) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static void
+qemuProcessReconnectScheduleRefresh(virQEMUDriverPtr driver,
+                                    virDomainObjPtr vm)
+{
+    struct qemuProcessEvent *processEvent;
+
+    if (VIR_ALLOC(processEvent) < 0)
+        return;
+
+    processEvent->eventType = QEMU_PROCESS_EVENT_RECONNECT_REFRESH;
+    processEvent->vm = virObjectRef(vm);
+
+    if (virThreadPoolSendJob(driver->workerPool, 0, processEvent) < 0) {
+        virObjectUnref(vm);
+        qemuProcessEventFree(processEvent);
+    }
+}
+
+
 struct qemuProcessReconnectData {
     virQEMUDriverPtr driver;
     virDomainObjPtr obj;
     virIdentityPtr identity;
+
+    /* set if the job was already acquired by qemuProcessReconnectBegin */
+    bool begun;
+    bool jobStarted;
+    qemuDomainJobObj oldjob;
+    /* lower value is reconnected sooner when using reconnectPool */
+    int priority;
 };
+
+
+/*
+ * Restores the job saved in the status XML and acquires a new one for
+ * the reconnect. Called with @data->obj locked.
+ */
+static void
+qemuProcessReconnectBegin(struct qemuProcessReconnectData *data)
+{
+    qemuDomainObjRestoreJob(data->obj, &data->oldjob);
+
+    if (qemuDomainObjBeginJob(data->driver, data->obj, QEMU_JOB_MODIFY) == 0)
+        data->jobStarted = true;
+
+    data->begun = true;
+}
+
 /*
  * Open an existing VM's monitor, re-detect VCPU threads
  * and re-reserve the security labels in use
@@ -8037,21 +8645,30 @@ qemuProcessReconnect(void *opaque)
     bool jobStarted = false;
     bool retry = true;
     bool tryMonReconn = false;
+    bool deferRefresh;
 
     virIdentitySetCurrent(data->identity);
     g_clear_object(&data->identity);
+
+    if (!data->begun)
+        qemuProcessReconnectBegin(data);
+    memcpy(&oldjob, &data->oldjob, sizeof(oldjob));
+    jobStarted = data->jobStarted;
     VIR_FREE(data);
 
-    qemuDomainObjRestoreJob(obj, &oldjob);
     if (oldjob.asyncJob == QEMU_ASYNC_JOB_MIGRATION_IN)
         stopFlags |= VIR_QEMU_PROCESS_STOP_MIGRATED;
 
     cfg = virQEMUDriverGetConfig(driver);
     priv = obj->privateData;
+    /* a domain with an unfinished job needs accurate state for recovering
+     * it, so the fast path is only taken for idle ones */
+    deferRefresh = cfg->reconnectDeferRefresh &&
+                   oldjob.active == QEMU_JOB_NONE &&
+                   oldjob.asyncJob == QEMU_ASYNC_JOB_NONE;
 
-    if (qemuDomainObjBeginJob(driver, obj, QEMU_JOB_MODIFY) < 0)
+    if (!jobStarted)
         goto error;
-    jobStarted = true;
 
     /* XXX If we ever gonna change pid file pattern, come up with
      * some intelligence here to deal with old paths. */
@@ -8069,6 +8686,8 @@ qemuProcessReconnect(void *opaque)
     if (qemuHostdevUpdateActiveDomainDevices(driver, obj->def) < 0)
         goto error;
 
+    qemuDomainNUMALoadCharge(driver, obj);
+
     if (priv->qemuCaps &&
         virQEMUCapsGet(priv->qemuCaps, QEMU_CAPS_CHARDEV_FD_PASS))
         retry = false;
@@ -8204,13 +8823,8 @@ qemuProcessReconnect(void *opaque)
         qemuBlockNodeNamesDetect(driver, obj, QEMU_ASYNC_JOB_NONE) < 0)
         goto error;
 
-    if (qemuRefreshVirtioChannelState(driver, obj, QEMU_ASYNC_JOB_NONE) < 0)
-        goto error;
-
-    /* If querying of guest's RTC failed, report error, but do not kill the domain. */
-    qemuRefreshRTC(driver, obj);
-
-    if (qemuProcessRefreshBalloonState(driver, obj, QEMU_ASYNC_JOB_NONE) < 0)
+    if (!deferRefresh &&
+        qemuProcessReconnectRefresh(driver, obj) < 0)
         goto error;
 
     if (qemuProcessRecoverJob(driver, obj, &oldjob, &stopFlags) < 0)
@@ -8272,6 +8886,9 @@ qemuProcessReconnect(void *opaque)
     if (g_atomic_int_add(&driver->nactive, 1) == 0 && driver->inhibitCallback)
         driver->inhibitCallback(true, driver->inhibitOpaque);
 
+    if (deferRefresh)
+        qemuProcessReconnectScheduleRefresh(driver, obj);
+
  cleanup:
     if (jobStarted) {
         if (!virDomainObjIsActive(obj))
@@ -8314,6 +8931,90 @@ qemuProcessReconnect(void *opaque)
     goto cleanup;
 }
 
+/* Worker of driver->reconnectPool */
+static void
+qemuProcessReconnectWorker(void *jobdata,
+                           void *opaque G_GNUC_UNUSED)
+{
+    struct qemuProcessReconnectData *data = jobdata;
+
+    /* qemuProcessReconnect inherits the lock, the reference was taken by
+     * qemuProcessReconnectQueue */
+    virObjectLock(data->obj);
+    qemuProcessReconnect(data);
+}
+
+
+struct qemuProcessReconnectQueueData {
+    virQEMUDriverPtr driver;
+    struct qemuProcessReconnectData **list;
+    size_t nlist;
+};
+
+
+/*
+ * Prepares reconnecting to @obj from driver->reconnectPool. The job is
+ * acquired right away so that no API can get to the domain before it's
+ * reconnected, the domain object itself is unlocked.
+ */
+static int
+qemuProcessReconnectQueue(virDomainObjPtr obj,
+                          void *opaque)
+{
+    struct qemuProcessReconnectQueueData *queue = opaque;
+    struct qemuProcessReconnectData *data;
+    int state;
+
+    /* If the VM was inactive, we don't need to reconnect */
+    if (!obj->pid)
+        return 0;
+
+    data = g_new0(struct qemuProcessReconnectData, 1);
+    data->driver = queue->driver;
+    data->obj = obj;
+
+    if (VIR_APPEND_ELEMENT_COPY(queue->list, queue->nlist, data) < 0) {
+        VIR_FREE(data);
+        return -1;
+    }
+
+    data->identity = virIdentityGetCurrent();
+
+    virNWFilterReadLockFilterUpdates();
+
+    /* the reference will be eventually transferred to the worker
+     * which handles the reconnect */
+    virObjectLock(obj);
+    virObjectRef(obj);
+
+    qemuProcessReconnectBegin(data);
+
+    state = virDomainObjGetState(obj, NULL);
+    if (data->oldjob.active != QEMU_JOB_NONE ||
+        data->oldjob.asyncJob != QEMU_ASYNC_JOB_NONE)
+        data->priority = 0;
+    else if (state == VIR_DOMAIN_RUNNING)
+        data->priority = 1;
+    else
+        data->priority = 2;
+
+    virObjectUnlock(obj);
+
+    return 0;
+}
+
+
+static int
+qemuProcessReconnectCompare(const void *a,
+                            const void *b)
+{
+    const struct qemuProcessReconnectData *da = *(void * const *)a;
+    const struct qemuProcessReconnectData *db = *(void * const *)b;
+
+    return da->priority - db->priority;
+}
+
+
 static int
 qemuProcessReconnectHelper(virDomainObjPtr obj,
                            void *opaque)
@@ -8376,9 +9077,42 @@ qemuProcessReconnectHelper(virDomainObjPtr obj,
 void
 qemuProcessReconnectAll(virQEMUDriverPtr driver)
 {
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     struct qemuProcessReconnectData data = {.driver = driver};
+    struct qemuProcessReconnectQueueData queue = {.driver = driver};
+    size_t i;
+
+    if (cfg->reconnectWorkers == 0 ||
+        !(driver->reconnectPool = virThreadPoolNewFull(0, cfg->reconnectWorkers,
+                                                       0, qemuProcessReconnectWorker,
+                                                       "qemu-reconnect", driver))) {
+        virDomainObjListForEach(driver->domains, true,
+                                qemuProcessReconnectHelper, &data);
+        return;
+    }
+
     virDomainObjListForEach(driver->domains, true,
-                            qemuProcessReconnectHelper, &data);
+                            qemuProcessReconnectQueue, &queue);
+
+    qsort(queue.list, queue.nlist, sizeof(*queue.list),
+          qemuProcessReconnectCompare);
+
+    for (i = 0; i < queue.nlist; i++) {
+        struct qemuProcessReconnectData *item = queue.list[i];
+        unsigned int jobClass = VIR_THREAD_POOL_JOB_NORMAL;
+
+        if (item->priority == 0)
+            jobClass = VIR_THREAD_POOL_JOB_PRIORITY;
+
+        if (virThreadPoolSendJob(driver->reconnectPool, jobClass, item) < 0) {
+            /* run it right here rather than leaving the domain with a
+             * job nobody will ever finish */
+            virObjectLock(item->obj);
+            qemuProcessReconnect(item);
+        }
+    }
+
+    VIR_FREE(queue.list);
 }
 
 
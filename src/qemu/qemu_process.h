@@ -48,6 +48,8 @@ int qemuProcessDestroyMemoryBackingPath(virQEMUDriverPtr driver,
                                         virDomainMemoryDefPtr mem);
 
 void qemuProcessReconnectAll(virQEMUDriverPtr driver);
+int qemuProcessReconnectRefresh(virQEMUDriverPtr driver,
+                                virDomainObjPtr vm);
 
 typedef struct _qemuProcessIncomingDef qemuProcessIncomingDef;
 typedef qemuProcessIncomingDef *qemuProcessIncomingDefPtr;
@@ -43,6 +43,7 @@
 #include "qemu_tpm.h"
 #include "virtpm.h"
 #include "virsecret.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -743,7 +744,10 @@ qemuExtTPMCleanupHost(virDomainDefPtr def)
  *
  * Start the external TPM Emulator:
  * - have the command line built
- * - start the external TPM Emulator and sync with it before QEMU start
+ * - start the external TPM Emulator
+ *
+ * swtpm daemonizes and writes its pidfile on its own, use
+ * qemuExtTPMWaitEmulator to sync with it before QEMU start.
  */
 static int
 qemuExtTPMStartEmulator(virQEMUDriverPtr driver,
@@ -756,8 +760,7 @@ qemuExtTPMStartEmulator(virQEMUDriverPtr driver,
     g_autofree char *errbuf = NULL;
     g_autoptr(virQEMUDriverConfig) cfg = NULL;
     g_autofree char *shortName = virDomainDefGetShortName(vm->def);
-    int cmdret = 0, timeout, rc;
-    pid_t pid;
+    int cmdret = 0;
 
     if (!shortName)
         return -1;
@@ -792,25 +795,46 @@ qemuExtTPMStartEmulator(virQEMUDriverPtr driver,
         return -1;
     }
 
-    /* check that the swtpm has written its pid into the file */
-    timeout = 1000; /* ms */
-    while (timeout > 0) {
-        rc = qemuTPMEmulatorGetPid(cfg->swtpmStateDir, shortName, &pid);
-        if (rc < 0) {
-            timeout -= 50;
-            g_usleep(50 * 1000);
+    return 0;
+}
+
+
+/*
+ * qemuExtTPMWaitEmulator:
+ *
+ * @driver: QEMU driver
+ * @vm: the domain object
+ *
+ * Wait for the TPM Emulator started by qemuExtTPMStartEmulator to write
+ * its pid into the pidfile. The pidfile is checked with an exponential
+ * backoff starting at 1ms, so that a quickly starting swtpm does not
+ * delay QEMU start by a fixed polling interval.
+ */
+static int
+qemuExtTPMWaitEmulator(virQEMUDriverPtr driver,
+                       virDomainObjPtr vm)
+{
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    g_autofree char *shortName = virDomainDefGetShortName(vm->def);
+    virTimeBackOffVar timebackoff;
+    pid_t pid;
+
+    if (!shortName)
+        return -1;
+
+    if (virTimeBackOffStart(&timebackoff, 1, 1000) < 0)
+        return -1;
+
+    while (virTimeBackOffWait(&timebackoff)) {
+        if (qemuTPMEmulatorGetPid(cfg->swtpmStateDir, shortName, &pid) < 0)
             continue;
-        }
-        if (rc == 0 && pid == (pid_t)-1)
-            goto error;
-        break;
-    }
-    if (timeout <= 0)
-        goto error;
 
-    return 0;
+        if (pid == (pid_t)-1)
+            break;
+
+        return 0;
+    }
 
- error:
     virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                    _("swtpm failed to start"));
     return -1;
@@ -836,6 +860,23 @@ qemuExtTPMStart(virQEMUDriverPtr driver,
 }
 
 
+int
+qemuExtTPMWaitStarted(virQEMUDriverPtr driver,
+                      virDomainObjPtr vm)
+{
+    size_t i;
+
+    for (i = 0; i < vm->def->ntpms; i++) {
+        if (vm->def->tpms[i]->type != VIR_DOMAIN_TPM_TYPE_EMULATOR)
+            continue;
+
+        return qemuExtTPMWaitEmulator(driver, vm);
+    }
+
+    return 0;
+}
+
+
 void
 qemuExtTPMStop(virQEMUDriverPtr driver,
                virDomainObjPtr vm)
@@ -41,6 +41,11 @@ int qemuExtTPMStart(virQEMUDriverPtr driver,
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2)
     G_GNUC_WARN_UNUSED_RESULT;
 
+int qemuExtTPMWaitStarted(virQEMUDriverPtr driver,
+                          virDomainObjPtr vm)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2)
+    G_GNUC_WARN_UNUSED_RESULT;
+
 void qemuExtTPMStop(virQEMUDriverPtr driver,
                     virDomainObjPtr vm)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
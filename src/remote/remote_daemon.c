@@ -58,6 +58,9 @@
 #include "virsystemd.h"
 #include "virhostuptime.h"
 #include "virdaemon.h"
+#include "vircommand.h"
+#include "vireventglib.h"
+#include "virwritebehind.h"
 
 #include "driver.h"
 
@@ -76,6 +79,8 @@ virNetSASLContextPtr saslCtxt = NULL;
 #endif
 virNetServerProgramPtr remoteProgram = NULL;
 virNetServerProgramPtr qemuProgram = NULL;
+size_t remoteMaxClientPipelineRequests;
+size_t remoteMaxClientEvents;
 
 volatile bool driversInitialized = false;
 
@@ -190,8 +195,9 @@ static int daemonInitialize(void)
 }
 
 
-static int ATTRIBUTE_NONNULL(3)
+static int ATTRIBUTE_NONNULL(4)
 daemonSetupNetworking(virNetServerPtr srv,
+                      virNetServerPtr srvRO,
                       virNetServerPtr srvAdm,
                       struct daemonConfig *config,
 #ifdef WITH_IP
@@ -290,7 +296,7 @@ daemonSetupNetworking(virNetServerPtr srv,
                                    config->max_client_requests) < 0)
         return -1;
     if (sock_path_ro &&
-        virNetServerAddServiceUNIX(srv,
+        virNetServerAddServiceUNIX(srvRO,
                                    act,
                                    DAEMON_NAME "-ro.socket",
                                    sock_path_ro,
@@ -483,6 +489,14 @@ static void daemonReloadHandler(virNetDaemonPtr dmn G_GNUC_UNUSED,
     }
 }
 
+static void daemonLogDumpHandler(virNetDaemonPtr dmn G_GNUC_UNUSED,
+                                 siginfo_t *sig G_GNUC_UNUSED,
+                                 void *opaque G_GNUC_UNUSED)
+{
+    if (virLogDumpBuffers("SIGUSR2") < 0)
+        VIR_WARN("Failed to dump log buffers");
+}
+
 static int daemonSetupSignals(virNetDaemonPtr dmn)
 {
     if (virNetDaemonAddSignalHandler(dmn, SIGINT, daemonShutdownHandler, NULL) < 0)
@@ -493,6 +507,8 @@ static int daemonSetupSignals(virNetDaemonPtr dmn)
         return -1;
     if (virNetDaemonAddSignalHandler(dmn, SIGHUP, daemonReloadHandler, NULL) < 0)
         return -1;
+    if (virNetDaemonAddSignalHandler(dmn, SIGUSR2, daemonLogDumpHandler, NULL) < 0)
+        return -1;
     return 0;
 }
 
@@ -759,6 +775,7 @@ daemonUsage(const char *argv0, bool privileged)
 int main(int argc, char **argv) {
     virNetDaemonPtr dmn = NULL;
     virNetServerPtr srv = NULL;
+    virNetServerPtr srvRO = NULL;
     virNetServerPtr srvAdm = NULL;
     virNetServerProgramPtr adminProgram = NULL;
     virNetServerProgramPtr lxcProgram = NULL;
@@ -919,6 +936,12 @@ int main(int argc, char **argv) {
                           verbose,
                           godaemon);
 
+    if (virErrorSetLogDumpDomains((const char *const *)config->log_buffer_dump_errors) < 0) {
+        VIR_ERROR(_("Invalid log_buffer_dump_errors: %s"),
+                  virGetLastErrorMessage());
+        exit(EXIT_FAILURE);
+    }
+
     /* Let's try to initialize global variable that holds the host's boot time. */
     if (virHostBootTimeInit() < 0) {
         /* This is acceptable failure. Maybe we won't need the boot time
@@ -929,6 +952,13 @@ int main(int argc, char **argv) {
 
     daemonSetupNetDevOpenvswitch(config);
 
+    virEventGLibSetSlowThreshold(config->event_loop_slow_threshold);
+
+    if (virWriteBehindSetDelay(config->config_write_delay) < 0) {
+        VIR_ERROR(_("Can't initialize deferred config writes"));
+        exit(EXIT_FAILURE);
+    }
+
     if (daemonSetupAccessManager(config) < 0) {
         VIR_ERROR(_("Can't initialize access manager"));
         exit(EXIT_FAILURE);
@@ -972,6 +1002,22 @@ int main(int argc, char **argv) {
         }
     }
 
+    /* Fork the command helpers while the daemon is still small */
+    if (config->command_helpers > 0 &&
+        virCommandHelpersStart(config->command_helpers) < 0) {
+        VIR_ERROR(_("Failed to start command helpers: %s"),
+                  virGetLastErrorMessage());
+        goto cleanup;
+    }
+
+    /* The log writer thread wouldn't survive the fork above */
+    if (config->log_async &&
+        virLogSetAsync(true) < 0) {
+        VIR_ERROR(_("Failed to enable asynchronous logging: %s"),
+                  virGetLastErrorMessage());
+        goto cleanup;
+    }
+
     /* Try to claim the pidfile, exiting if we can't */
     if ((pid_file_fd = virPidFileAcquirePath(pid_file, false, getpid())) < 0) {
         ret = VIR_DAEMON_ERR_PIDFILE;
@@ -1038,6 +1084,8 @@ int main(int argc, char **argv) {
     remoteProcs[REMOTE_PROC_AUTH_SASL_STEP].needAuth = false;
     remoteProcs[REMOTE_PROC_AUTH_SASL_START].needAuth = false;
     remoteProcs[REMOTE_PROC_AUTH_POLKIT].needAuth = false;
+    remoteMaxClientPipelineRequests = config->max_client_pipeline_requests;
+    remoteMaxClientEvents = config->max_client_events;
     if (!(remoteProgram = virNetServerProgramNew(REMOTE_PROGRAM,
                                                  REMOTE_PROTOCOL_VERSION,
                                                  remoteProcs,
@@ -1074,6 +1122,36 @@ int main(int argc, char **argv) {
         goto cleanup;
     }
 
+    /* Read-only clients get their own workers if asked for, so that
+     * their queries can't hold up the calls of the other clients */
+    if (sock_file_ro && config->ro_max_workers > 0) {
+        if (!(srvRO = virNetServerNew(DAEMON_NAME "-ro", 1,
+                                      config->ro_min_workers,
+                                      config->ro_max_workers,
+                                      0,
+                                      config->max_clients,
+                                      config->max_anonymous_clients,
+                                      config->keepalive_interval,
+                                      config->keepalive_count,
+                                      remoteClientNew,
+                                      NULL,
+                                      remoteClientFree,
+                                      NULL))) {
+            ret = VIR_DAEMON_ERR_INIT;
+            goto cleanup;
+        }
+
+        if (virNetDaemonAddServer(dmn, srvRO) < 0 ||
+            virNetServerAddProgram(srvRO, remoteProgram) < 0 ||
+            virNetServerAddProgram(srvRO, lxcProgram) < 0 ||
+            virNetServerAddProgram(srvRO, qemuProgram) < 0) {
+            ret = VIR_DAEMON_ERR_INIT;
+            goto cleanup;
+        }
+    } else {
+        srvRO = virObjectRef(srv);
+    }
+
     if (!(srvAdm = virNetServerNew("admin", 1,
                                    config->admin_min_workers,
                                    config->admin_max_workers,
@@ -1147,7 +1225,7 @@ int main(int argc, char **argv) {
     virHookCall(VIR_HOOK_DRIVER_DAEMON, "-", VIR_HOOK_DAEMON_OP_START,
                 0, "start", NULL, NULL);
 
-    if (daemonSetupNetworking(srv, srvAdm,
+    if (daemonSetupNetworking(srv, srvRO, srvAdm,
                               config,
 #ifdef WITH_IP
                               ipsock,
@@ -1213,11 +1291,14 @@ int main(int argc, char **argv) {
         virStateCleanup();
     }
 
+    virWriteBehindShutdown();
+
     virObjectUnref(adminProgram);
     virObjectUnref(srvAdm);
     virObjectUnref(qemuProgram);
     virObjectUnref(lxcProgram);
     virObjectUnref(remoteProgram);
+    virObjectUnref(srvRO);
     virObjectUnref(srv);
     virObjectUnref(dmn);
 
@@ -1246,5 +1327,8 @@ int main(int argc, char **argv) {
     VIR_FREE(remote_config_file);
     daemonConfigFree(config);
 
+    /* Write any messages still buffered */
+    virLogSetAsync(false);
+
     return ret;
 }
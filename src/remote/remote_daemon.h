@@ -29,6 +29,7 @@
 #include "lxc_protocol.h"
 #include "qemu_protocol.h"
 #include "virthread.h"
+#include "virhash.h"
 
 #if WITH_SASL
 # include "virnetsaslcontext.h"
@@ -91,6 +92,14 @@ struct daemonClientPrivate {
     bool readonly;
 
     daemonClientStreamPtr streams;
+
+    /* Compact domain stats state: the key dictionary sent to the
+     * client so far, and the last sample of each domain keyed by UUID */
+    char **statsKeys;
+    size_t nstatsKeys;
+    virHashTablePtr statsKeyIndex;
+    virHashTablePtr statsSamples;
+    unsigned long long statsSerial;
 };
 
 
@@ -99,3 +108,5 @@ extern virNetSASLContextPtr saslCtxt;
 #endif
 extern virNetServerProgramPtr remoteProgram;
 extern virNetServerProgramPtr qemuProgram;
+extern size_t remoteMaxClientPipelineRequests;
+extern size_t remoteMaxClientEvents;
@@ -144,6 +144,11 @@ daemonConfigNew(bool privileged G_GNUC_UNUSED)
     data->prio_workers = 5;
 
     data->max_client_requests = 5;
+    data->max_client_pipeline_requests = 0;
+    data->max_client_events = 1024;
+
+    data->ro_min_workers = 1;
+    data->ro_max_workers = 0;
 
     data->audit_level = 1;
     data->audit_logging = false;
@@ -219,6 +224,7 @@ daemonConfigFree(struct daemonConfig *data)
     VIR_FREE(data->host_uuid_source);
     VIR_FREE(data->log_filters);
     VIR_FREE(data->log_outputs);
+    g_strfreev(data->log_buffer_dump_errors);
 
     VIR_FREE(data);
 }
@@ -326,6 +332,18 @@ daemonConfigLoadOptions(struct daemonConfig *data,
 
     if (virConfGetValueUInt(conf, "max_client_requests", &data->max_client_requests) < 0)
         return -1;
+    if (virConfGetValueUInt(conf, "max_client_pipeline_requests", &data->max_client_pipeline_requests) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "max_client_events", &data->max_client_events) < 0)
+        return -1;
+
+    if (virConfGetValueUInt(conf, "command_helpers", &data->command_helpers) < 0)
+        return -1;
+
+    if (virConfGetValueUInt(conf, "ro_min_workers", &data->ro_min_workers) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "ro_max_workers", &data->ro_max_workers) < 0)
+        return -1;
 
     if (virConfGetValueUInt(conf, "admin_min_workers", &data->admin_min_workers) < 0)
         return -1;
@@ -354,6 +372,11 @@ daemonConfigLoadOptions(struct daemonConfig *data,
         return -1;
     if (virConfGetValueString(conf, "log_outputs", &data->log_outputs) < 0)
         return -1;
+    if (virConfGetValueBool(conf, "log_async", &data->log_async) < 0)
+        return -1;
+    if (virConfGetValueStringList(conf, "log_buffer_dump_errors", false,
+                                  &data->log_buffer_dump_errors) < 0)
+        return -1;
 
     if (virConfGetValueInt(conf, "keepalive_interval", &data->keepalive_interval) < 0)
         return -1;
@@ -368,6 +391,14 @@ daemonConfigLoadOptions(struct daemonConfig *data,
     if (virConfGetValueUInt(conf, "ovs_timeout", &data->ovs_timeout) < 0)
         return -1;
 
+    if (virConfGetValueUInt(conf, "event_loop_slow_threshold",
+                            &data->event_loop_slow_threshold) < 0)
+        return -1;
+
+    if (virConfGetValueUInt(conf, "config_write_delay",
+                            &data->config_write_delay) < 0)
+        return -1;
+
     return 0;
 }
 
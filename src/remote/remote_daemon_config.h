@@ -74,10 +74,19 @@ struct daemonConfig {
     unsigned int prio_workers;
 
     unsigned int max_client_requests;
+    unsigned int max_client_pipeline_requests;
+    unsigned int max_client_events;
+
+    unsigned int command_helpers;
+
+    unsigned int ro_min_workers;
+    unsigned int ro_max_workers;
 
     unsigned int log_level;
     char *log_filters;
     char *log_outputs;
+    bool log_async;
+    char **log_buffer_dump_errors;
 
     unsigned int audit_level;
     bool audit_logging;
@@ -95,6 +104,10 @@ struct daemonConfig {
     unsigned int admin_keepalive_count;
 
     unsigned int ovs_timeout;
+
+    unsigned int event_loop_slow_threshold;
+
+    unsigned int config_write_delay;
 };
 
 
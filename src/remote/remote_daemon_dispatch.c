@@ -143,6 +143,32 @@ remoteDispatchObjectEventSend(virNetServerClientPtr client,
                               xdrproc_t proc,
                               void *data);
 
+static void
+remoteDispatchObjectEventSendCoalesce(virNetServerClientPtr client,
+                                      virNetServerProgramPtr program,
+                                      int procnr,
+                                      xdrproc_t proc,
+                                      void *data,
+                                      char *key);
+
+
+/* Events which only report the latest state of something are given a key
+ * so that a newer one can replace an older one still queued for a slow
+ * client, see virNetServerClientSendEvent */
+static char *
+remoteRelayDomainEventKey(daemonClientEventCallbackPtr callback,
+                          int procnr,
+                          virDomainPtr dom,
+                          const char *detail)
+{
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    virUUIDFormat(dom->uuid, uuidstr);
+
+    return g_strdup_printf("%d:%d:%s:%s", procnr, callback->callbackID,
+                           uuidstr, NULLSTR_EMPTY(detail));
+}
+
 static void
 remoteEventCallbackFree(void *opaque)
 {
@@ -648,16 +674,22 @@ remoteRelayDomainEventBlockJob(virConnectPtr conn,
     make_nonnull_domain(&data.dom, dom);
 
     if (callback->legacy) {
-        remoteDispatchObjectEventSend(callback->client, callback->program,
-                                      REMOTE_PROC_DOMAIN_EVENT_BLOCK_JOB,
-                                      (xdrproc_t)xdr_remote_domain_event_block_job_msg, &data);
+        remoteDispatchObjectEventSendCoalesce(callback->client, callback->program,
+                                              REMOTE_PROC_DOMAIN_EVENT_BLOCK_JOB,
+                                              (xdrproc_t)xdr_remote_domain_event_block_job_msg, &data,
+                                              remoteRelayDomainEventKey(callback,
+                                                                        REMOTE_PROC_DOMAIN_EVENT_BLOCK_JOB,
+                                                                        dom, path));
     } else {
         remote_domain_event_callback_block_job_msg msg = { callback->callbackID,
                                                            data };
 
-        remoteDispatchObjectEventSend(callback->client, callback->program,
-                                      REMOTE_PROC_DOMAIN_EVENT_CALLBACK_BLOCK_JOB,
-                                      (xdrproc_t)xdr_remote_domain_event_callback_block_job_msg, &msg);
+        remoteDispatchObjectEventSendCoalesce(callback->client, callback->program,
+                                              REMOTE_PROC_DOMAIN_EVENT_CALLBACK_BLOCK_JOB,
+                                              (xdrproc_t)xdr_remote_domain_event_callback_block_job_msg, &msg,
+                                              remoteRelayDomainEventKey(callback,
+                                                                        REMOTE_PROC_DOMAIN_EVENT_CALLBACK_BLOCK_JOB,
+                                                                        dom, path));
     }
 
     return 0;
@@ -887,16 +919,22 @@ remoteRelayDomainEventBalloonChange(virConnectPtr conn,
     data.actual = actual;
 
     if (callback->legacy) {
-        remoteDispatchObjectEventSend(callback->client, callback->program,
-                                      REMOTE_PROC_DOMAIN_EVENT_BALLOON_CHANGE,
-                                      (xdrproc_t)xdr_remote_domain_event_balloon_change_msg, &data);
+        remoteDispatchObjectEventSendCoalesce(callback->client, callback->program,
+                                              REMOTE_PROC_DOMAIN_EVENT_BALLOON_CHANGE,
+                                              (xdrproc_t)xdr_remote_domain_event_balloon_change_msg, &data,
+                                              remoteRelayDomainEventKey(callback,
+                                                                        REMOTE_PROC_DOMAIN_EVENT_BALLOON_CHANGE,
+                                                                        dom, NULL));
     } else {
         remote_domain_event_callback_balloon_change_msg msg = { callback->callbackID,
                                                                 data };
 
-        remoteDispatchObjectEventSend(callback->client, callback->program,
-                                      REMOTE_PROC_DOMAIN_EVENT_CALLBACK_BALLOON_CHANGE,
-                                      (xdrproc_t)xdr_remote_domain_event_callback_balloon_change_msg, &msg);
+        remoteDispatchObjectEventSendCoalesce(callback->client, callback->program,
+                                              REMOTE_PROC_DOMAIN_EVENT_CALLBACK_BALLOON_CHANGE,
+                                              (xdrproc_t)xdr_remote_domain_event_callback_balloon_change_msg, &msg,
+                                              remoteRelayDomainEventKey(callback,
+                                                                        REMOTE_PROC_DOMAIN_EVENT_CALLBACK_BALLOON_CHANGE,
+                                                                        dom, NULL));
     }
 
     return 0;
@@ -1007,9 +1045,12 @@ remoteRelayDomainEventBlockJob2(virConnectPtr conn,
     data.status = status;
     make_nonnull_domain(&data.dom, dom);
 
-    remoteDispatchObjectEventSend(callback->client, callback->program,
-                                  REMOTE_PROC_DOMAIN_EVENT_BLOCK_JOB_2,
-                                  (xdrproc_t)xdr_remote_domain_event_block_job_2_msg, &data);
+    remoteDispatchObjectEventSendCoalesce(callback->client, callback->program,
+                                          REMOTE_PROC_DOMAIN_EVENT_BLOCK_JOB_2,
+                                          (xdrproc_t)xdr_remote_domain_event_block_job_2_msg, &data,
+                                          remoteRelayDomainEventKey(callback,
+                                                                    REMOTE_PROC_DOMAIN_EVENT_BLOCK_JOB_2,
+                                                                    dom, dst));
 
     return 0;
 }
@@ -1193,6 +1234,47 @@ remoteRelayDomainEventJobCompleted(virConnectPtr conn,
 }
 
 
+static int
+remoteRelayDomainEventStats(virConnectPtr conn,
+                            virDomainPtr dom,
+                            virTypedParameterPtr params,
+                            int nparams,
+                            void *opaque)
+{
+    daemonClientEventCallbackPtr callback = opaque;
+    remote_domain_event_callback_stats_msg data;
+
+    if (callback->callbackID < 0 ||
+        !remoteRelayDomainEventCheckACL(callback->client, conn, dom))
+        return -1;
+
+    VIR_DEBUG("Relaying domain stats event %s %d, callback %d, params %p %d",
+              dom->name, dom->id, callback->callbackID, params, nparams);
+
+    /* build return data */
+    memset(&data, 0, sizeof(data));
+
+    if (virTypedParamsSerialize(params, nparams,
+                                REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX,
+                                (virTypedParameterRemotePtr *) &data.params.params_val,
+                                &data.params.params_len,
+                                VIR_TYPED_PARAM_STRING_OKAY) < 0)
+        return -1;
+
+    data.callbackID = callback->callbackID;
+    make_nonnull_domain(&data.dom, dom);
+
+    remoteDispatchObjectEventSendCoalesce(callback->client, callback->program,
+                                          REMOTE_PROC_DOMAIN_EVENT_CALLBACK_STATS,
+                                          (xdrproc_t)xdr_remote_domain_event_callback_stats_msg,
+                                          &data,
+                                          remoteRelayDomainEventKey(callback,
+                                                                    REMOTE_PROC_DOMAIN_EVENT_CALLBACK_STATS,
+                                                                    dom, NULL));
+    return 0;
+}
+
+
 static int
 remoteRelayDomainEventDeviceRemovalFailed(virConnectPtr conn,
                                           virDomainPtr dom,
@@ -1329,6 +1411,7 @@ static virConnectDomainEventGenericCallback domainEventCallbacks[] = {
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventDeviceRemovalFailed),
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventMetadataChange),
     VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventBlockThreshold),
+    VIR_DOMAIN_EVENT_CALLBACK(remoteRelayDomainEventStats),
 };
 
 G_STATIC_ASSERT(G_N_ELEMENTS(domainEventCallbacks) == VIR_DOMAIN_EVENT_ID_LAST);
@@ -1717,6 +1800,10 @@ void remoteClientFree(void *data)
     if (priv->storageConn)
         virConnectClose(priv->storageConn);
 
+    virStringListFreeCount(priv->statsKeys, priv->nstatsKeys);
+    virHashFree(priv->statsKeyIndex);
+    virHashFree(priv->statsSamples);
+
     VIR_FREE(priv);
 }
 
@@ -4337,16 +4424,21 @@ remoteDispatchConnectDomainEventDeregister(virNetServerPtr server G_GNUC_UNUSED,
 }
 
 static void
-remoteDispatchObjectEventSend(virNetServerClientPtr client,
-                              virNetServerProgramPtr program,
-                              int procnr,
-                              xdrproc_t proc,
-                              void *data)
+remoteDispatchObjectEventSendCoalesce(virNetServerClientPtr client,
+                                      virNetServerProgramPtr program,
+                                      int procnr,
+                                      xdrproc_t proc,
+                                      void *data,
+                                      char *key)
 {
     virNetMessagePtr msg;
 
-    if (!(msg = virNetMessageNew(false)))
+    if (!(msg = virNetMessageNew(false))) {
+        g_free(key);
         goto cleanup;
+    }
+
+    msg->eventKey = key;
 
     msg->header.prog = virNetServerProgramGetID(program);
     msg->header.vers = virNetServerProgramGetVersion(program);
@@ -4362,7 +4454,7 @@ remoteDispatchObjectEventSend(virNetServerClientPtr client,
         goto cleanup;
 
     VIR_DEBUG("Queue event %d %zu", procnr, msg->bufferLength);
-    if (virNetServerClientSendMessage(client, msg) < 0)
+    if (virNetServerClientSendEvent(client, msg, remoteMaxClientEvents) < 0)
         goto cleanup;
 
     xdr_free(proc, data);
@@ -4373,6 +4465,17 @@ remoteDispatchObjectEventSend(virNetServerClientPtr client,
     xdr_free(proc, data);
 }
 
+static void
+remoteDispatchObjectEventSend(virNetServerClientPtr client,
+                              virNetServerProgramPtr program,
+                              int procnr,
+                              xdrproc_t proc,
+                              void *data)
+{
+    remoteDispatchObjectEventSendCoalesce(client, program, procnr,
+                                          proc, data, NULL);
+}
+
 static int
 remoteDispatchSecretGetValue(virNetServerPtr server G_GNUC_UNUSED,
                              virNetServerClientPtr client,
@@ -4995,6 +5098,10 @@ static int remoteDispatchConnectSupportsFeature(virNetServerPtr server G_GNUC_UN
     case VIR_DRV_FEATURE_FD_PASSING:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_STATS_COMPACT:
+    case VIR_DRV_FEATURE_REMOTE_PIPELINE:
+    case VIR_DRV_FEATURE_REMOTE_CALL_BATCH:
+    case VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PACKETS:
         supported = 1;
         break;
     case VIR_DRV_FEATURE_MIGRATION_V1:
@@ -5106,6 +5213,39 @@ remoteDispatchDomainOpenGraphicsFd(virNetServerPtr server G_GNUC_UNUSED,
 }
 
 
+static int
+remoteDispatchConnectOpenDomainStatsFd(virNetServerPtr server G_GNUC_UNUSED,
+                                       virNetServerClientPtr client,
+                                       virNetMessagePtr msg,
+                                       virNetMessageErrorPtr rerr,
+                                       remote_connect_open_domain_stats_fd_args *args)
+{
+    int rv = -1;
+    int fd = -1;
+    virConnectPtr conn = remoteGetHypervisorConn(client);
+
+    if (!conn)
+        goto cleanup;
+
+    if ((fd = virConnectOpenDomainStatsFD(conn, args->flags)) < 0)
+        goto cleanup;
+
+    if (virNetMessageAddFD(msg, fd) < 0)
+        goto cleanup;
+
+    /* return 1 here to let virNetServerProgramDispatchCall know
+     * we are passing a FD */
+    rv = 1;
+
+ cleanup:
+    VIR_FORCE_CLOSE(fd);
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+
+    return rv;
+}
+
+
 static int
 remoteDispatchDomainGetInterfaceParameters(virNetServerPtr server G_GNUC_UNUSED,
                                            virNetServerClientPtr client,
@@ -5753,6 +5893,134 @@ remoteDispatchDomainMigratePerform3Params(virNetServerPtr server G_GNUC_UNUSED,
 }
 
 
+static int
+remoteDispatchDomainListMigrate(virNetServerPtr server G_GNUC_UNUSED,
+                                virNetServerClientPtr client,
+                                virNetMessagePtr msg G_GNUC_UNUSED,
+                                virNetMessageErrorPtr rerr,
+                                remote_domain_list_migrate_args *args)
+{
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    virDomainPtr *doms = NULL;
+    size_t i;
+    int rv = -1;
+    virConnectPtr conn = remoteGetHypervisorConn(client);
+
+    if (!conn)
+        goto cleanup;
+
+    if (args->params.params_len > REMOTE_DOMAIN_MIGRATE_PARAM_LIST_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("Too many migration parameters '%d' for limit '%d'"),
+                       args->params.params_len, REMOTE_DOMAIN_MIGRATE_PARAM_LIST_MAX);
+        goto cleanup;
+    }
+
+    if (VIR_ALLOC_N(doms, args->doms.doms_len + 1) < 0)
+        goto cleanup;
+
+    for (i = 0; i < args->doms.doms_len; i++) {
+        if (!(doms[i] = get_nonnull_domain(conn, args->doms.doms_val[i])))
+            goto cleanup;
+    }
+
+    if (virTypedParamsDeserialize((virTypedParameterRemotePtr) args->params.params_val,
+                                  args->params.params_len,
+                                  0, &params, &nparams) < 0)
+        goto cleanup;
+
+    if (virDomainListMigrate(doms, args->dconnuri, params, nparams,
+                             args->flags) < 0)
+        goto cleanup;
+
+    rv = 0;
+
+ cleanup:
+    virTypedParamsFree(params, nparams);
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    virObjectListFree(doms);
+    return rv;
+}
+
+
+static int
+remoteDispatchDomainListShutdown(virNetServerPtr server G_GNUC_UNUSED,
+                                 virNetServerClientPtr client,
+                                 virNetMessagePtr msg G_GNUC_UNUSED,
+                                 virNetMessageErrorPtr rerr,
+                                 remote_domain_list_shutdown_args *args)
+{
+    virDomainPtr *doms = NULL;
+    size_t i;
+    int rv = -1;
+    virConnectPtr conn = remoteGetHypervisorConn(client);
+
+    if (!conn)
+        goto cleanup;
+
+    if (VIR_ALLOC_N(doms, args->doms.doms_len + 1) < 0)
+        goto cleanup;
+
+    for (i = 0; i < args->doms.doms_len; i++) {
+        if (!(doms[i] = get_nonnull_domain(conn, args->doms.doms_val[i])))
+            goto cleanup;
+    }
+
+    if (virDomainListShutdown(doms, args->timeout, args->flags) < 0)
+        goto cleanup;
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    virObjectListFree(doms);
+    return rv;
+}
+
+
+static int
+remoteDispatchDomainGetXMLDigest(virNetServerPtr server G_GNUC_UNUSED,
+                                 virNetServerClientPtr client,
+                                 virNetMessagePtr msg G_GNUC_UNUSED,
+                                 virNetMessageErrorPtr rerr,
+                                 remote_domain_get_xml_digest_args *args,
+                                 remote_domain_get_xml_digest_ret *ret)
+{
+    virDomainPtr dom = NULL;
+    unsigned long long generation = 0;
+    g_autofree char *digest = NULL;
+    int rv = -1;
+    virConnectPtr conn = remoteGetHypervisorConn(client);
+
+    if (!conn)
+        goto cleanup;
+
+    if (!(dom = get_nonnull_domain(conn, args->dom)))
+        goto cleanup;
+
+    if (virDomainGetXMLDigest(dom, &generation, &digest, args->flags) < 0)
+        goto cleanup;
+
+    ret->generation = generation;
+    if (digest) {
+        /* remoteDispatchClientRequest will free this. */
+        ret->digest = g_new0(char *, 1);
+        *ret->digest = g_steal_pointer(&digest);
+    }
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0)
+        virNetMessageSaveError(rerr);
+    virObjectUnref(dom);
+    return rv;
+}
+
+
 static int
 remoteDispatchDomainMigrateFinish3Params(virNetServerPtr server G_GNUC_UNUSED,
                                          virNetServerClientPtr client,
@@ -6898,6 +7166,390 @@ remoteDispatchConnectGetAllDomainStats(virNetServerPtr server G_GNUC_UNUSED,
 }
 
 
+/* Dictionaries growing beyond this are dropped and resent from scratch,
+ * so that a client watching many short lived devices does not make the
+ * daemon hold on to stale key names forever. */
+#define REMOTE_STATS_COMPACT_KEYS_MAX 65536
+
+static void
+remoteStatsCompactSampleFree(void *opaque)
+{
+    virTypedParamListFree(opaque);
+}
+
+
+static void
+remoteStatsCompactResetKeys(struct daemonClientPrivate *priv)
+{
+    virStringListFreeCount(priv->statsKeys, priv->nstatsKeys);
+    priv->statsKeys = NULL;
+    priv->nstatsKeys = 0;
+    virHashFree(priv->statsKeyIndex);
+    priv->statsKeyIndex = NULL;
+}
+
+
+static int
+remoteStatsCompactInternKey(struct daemonClientPrivate *priv,
+                            const char *name,
+                            unsigned int *key)
+{
+    size_t idx;
+    char *tmp;
+
+    if ((idx = GPOINTER_TO_SIZE(virHashLookup(priv->statsKeyIndex, name)))) {
+        *key = idx - 1;
+        return 0;
+    }
+
+    if (priv->nstatsKeys >= REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("too many distinct stats keys, limit is %d"),
+                       REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX);
+        return -1;
+    }
+
+    if (virHashAddEntry(priv->statsKeyIndex, name,
+                        GSIZE_TO_POINTER(priv->nstatsKeys + 1)) < 0)
+        return -1;
+
+    tmp = g_strdup(name);
+    if (VIR_APPEND_ELEMENT(priv->statsKeys, priv->nstatsKeys, tmp) < 0) {
+        VIR_FREE(tmp);
+        virHashRemoveEntry(priv->statsKeyIndex, name);
+        return -1;
+    }
+
+    *key = priv->nstatsKeys - 1;
+    return 0;
+}
+
+
+static int
+remoteStatsCompactEncodeParams(struct daemonClientPrivate *priv,
+                               virTypedParameterPtr params,
+                               size_t nparams,
+                               remote_domain_stats_compact_record *dst)
+{
+    size_t i;
+
+    if (nparams > REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("too many parameters '%zu' for limit '%d'"),
+                       nparams, REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX);
+        return -1;
+    }
+
+    dst->params.params_val = g_new0(remote_domain_stats_compact_param,
+                                    nparams);
+    dst->params.params_len = nparams;
+
+    for (i = 0; i < nparams; i++) {
+        virTypedParameterPtr param = params + i;
+        remote_domain_stats_compact_param *val = dst->params.params_val + i;
+
+        if (remoteStatsCompactInternKey(priv, param->field, &val->key) < 0)
+            return -1;
+
+        val->value.type = param->type;
+        switch (param->type) {
+        case VIR_TYPED_PARAM_INT:
+            val->value.remote_typed_param_value_u.i = param->value.i;
+            break;
+        case VIR_TYPED_PARAM_UINT:
+            val->value.remote_typed_param_value_u.ui = param->value.ui;
+            break;
+        case VIR_TYPED_PARAM_LLONG:
+            val->value.remote_typed_param_value_u.l = param->value.l;
+            break;
+        case VIR_TYPED_PARAM_ULLONG:
+            val->value.remote_typed_param_value_u.ul = param->value.ul;
+            break;
+        case VIR_TYPED_PARAM_DOUBLE:
+            val->value.remote_typed_param_value_u.d = param->value.d;
+            break;
+        case VIR_TYPED_PARAM_BOOLEAN:
+            val->value.remote_typed_param_value_u.b = param->value.b;
+            break;
+        case VIR_TYPED_PARAM_STRING:
+            val->value.remote_typed_param_value_u.s = g_strdup(param->value.s);
+            break;
+        default:
+            virReportError(VIR_ERR_RPC, _("unknown parameter type: %d"),
+                           param->type);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * Compact variant of remoteDispatchConnectGetAllDomainStats. Parameter
+ * names are interned in a per-client dictionary of which only the part
+ * the client does not know yet is sent, and if the client still holds
+ * the sample from the previous call, records only carry the differences
+ * against it. The daemon keeps the sample exactly as the client will
+ * reconstruct it, so both sides stay in lockstep.
+ */
+static int
+remoteDispatchConnectGetAllDomainStatsCompact(virNetServerPtr server G_GNUC_UNUSED,
+                                              virNetServerClientPtr client,
+                                              virNetMessagePtr msg G_GNUC_UNUSED,
+                                              virNetMessageErrorPtr rerr,
+                                              remote_connect_get_all_domain_stats_compact_args *args,
+                                              remote_connect_get_all_domain_stats_compact_ret *ret)
+{
+    int rv = -1;
+    size_t i;
+    virDomainStatsRecordPtr *retStats = NULL;
+    int nrecords = 0;
+    virDomainPtr *doms = NULL;
+    virConnectPtr conn = remoteGetHypervisorConn(client);
+    struct daemonClientPrivate *priv =
+        virNetServerClientGetPrivateData(client);
+    g_autoptr(virHashTable) samples = NULL;
+    bool usedelta;
+
+    if (!conn)
+        goto cleanup;
+
+    if (args->doms.doms_len) {
+        if (VIR_ALLOC_N(doms, args->doms.doms_len + 1) < 0)
+            goto cleanup;
+
+        for (i = 0; i < args->doms.doms_len; i++) {
+            if (!(doms[i] = get_nonnull_domain(conn, args->doms.doms_val[i])))
+                goto cleanup;
+        }
+
+        if ((nrecords = virDomainListGetStats(doms,
+                                              args->stats,
+                                              &retStats,
+                                              args->flags)) < 0)
+            goto cleanup;
+    } else {
+        if ((nrecords = virConnectGetAllDomainStats(conn,
+                                                    args->stats,
+                                                    &retStats,
+                                                    args->flags)) < 0)
+            goto cleanup;
+    }
+
+    if (nrecords > REMOTE_DOMAIN_LIST_MAX) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Number of domain stats records is %d, "
+                         "which exceeds max limit: %d"),
+                       nrecords, REMOTE_DOMAIN_LIST_MAX);
+        goto cleanup;
+    }
+
+    if (!(samples = virHashNew(remoteStatsCompactSampleFree)))
+        goto cleanup;
+
+    virMutexLock(&priv->lock);
+
+    if (priv->nstatsKeys > REMOTE_STATS_COMPACT_KEYS_MAX ||
+        args->nkeys > priv->nstatsKeys)
+        remoteStatsCompactResetKeys(priv);
+
+    if (!priv->statsKeyIndex &&
+        !(priv->statsKeyIndex = virHashNew(NULL)))
+        goto unlock;
+
+    ret->key_base = priv->nstatsKeys ? args->nkeys : 0;
+
+    usedelta = priv->statsSamples && args->serial != 0 &&
+               args->serial == priv->statsSerial;
+
+    if (nrecords) {
+        ret->retStats.retStats_val = g_new0(remote_domain_stats_compact_record,
+                                            nrecords);
+        ret->retStats.retStats_len = nrecords;
+    }
+
+    for (i = 0; i < nrecords; i++) {
+        remote_domain_stats_compact_record *dst = ret->retStats.retStats_val + i;
+        virDomainStatsRecordPtr rec = retStats[i];
+        g_autoptr(virTypedParamList) changed = NULL;
+        g_autoptr(virTypedParamList) sample = NULL;
+        g_autofree size_t *removed = NULL;
+        size_t nremoved = 0;
+        char uuidstr[VIR_UUID_STRING_BUFLEN];
+        size_t j;
+
+        make_nonnull_domain(&dst->dom, rec->dom);
+        virUUIDFormat(rec->dom->uuid, uuidstr);
+
+        if (usedelta)
+            sample = virHashSteal(priv->statsSamples, uuidstr);
+
+        if (sample) {
+            changed = g_new0(virTypedParamList, 1);
+
+            if (virTypedParamsDiff(sample->par, sample->npar,
+                                   rec->params, rec->nparams,
+                                   changed, &removed, &nremoved) < 0 ||
+                virTypedParamsPatch(sample, changed->par, changed->npar,
+                                    removed, nremoved) < 0 ||
+                remoteStatsCompactEncodeParams(priv, changed->par,
+                                               changed->npar, dst) < 0)
+                goto unlock;
+
+            dst->delta = 1;
+            if (nremoved) {
+                dst->removed.removed_val = g_new0(u_int, nremoved);
+                dst->removed.removed_len = nremoved;
+                for (j = 0; j < nremoved; j++)
+                    dst->removed.removed_val[j] = removed[j];
+            }
+        } else {
+            sample = g_new0(virTypedParamList, 1);
+
+            if (virTypedParamListAddParams(sample, rec->params,
+                                           rec->nparams) < 0 ||
+                remoteStatsCompactEncodeParams(priv, rec->params,
+                                               rec->nparams, dst) < 0)
+                goto unlock;
+        }
+
+        if (virHashUpdateEntry(samples, uuidstr, sample) < 0)
+            goto unlock;
+        sample = NULL;
+    }
+
+    if (priv->nstatsKeys - ret->key_base > 0) {
+        ret->keys.keys_len = priv->nstatsKeys - ret->key_base;
+        ret->keys.keys_val = g_new0(char *, ret->keys.keys_len);
+        for (i = 0; i < ret->keys.keys_len; i++)
+            ret->keys.keys_val[i] = g_strdup(priv->statsKeys[ret->key_base + i]);
+    }
+
+    virHashFree(priv->statsSamples);
+    priv->statsSamples = g_steal_pointer(&samples);
+    ret->serial = ++priv->statsSerial;
+
+    rv = 0;
+
+ unlock:
+    if (rv < 0) {
+        /* Samples of the previous call were partially consumed, make sure
+         * the next call sends full records */
+        virHashFree(priv->statsSamples);
+        priv->statsSamples = NULL;
+        priv->statsSerial++;
+    }
+    virMutexUnlock(&priv->lock);
+
+ cleanup:
+    if (rv < 0) {
+        virNetMessageSaveError(rerr);
+        xdr_free((xdrproc_t)xdr_remote_connect_get_all_domain_stats_compact_ret,
+                 (char *) ret);
+    }
+
+    virDomainStatsRecordListFree(retStats);
+    virObjectListFree(doms);
+
+    return rv;
+}
+
+
+static int
+remoteDispatchConnectSetPipelineDepth(virNetServerPtr server G_GNUC_UNUSED,
+                                      virNetServerClientPtr client,
+                                      virNetMessagePtr msg G_GNUC_UNUSED,
+                                      virNetMessageErrorPtr rerr,
+                                      remote_connect_set_pipeline_depth_args *args,
+                                      remote_connect_set_pipeline_depth_ret *ret)
+{
+    size_t current = virNetServerClientGetMaxRequests(client);
+    size_t depth = MIN(args->depth, remoteMaxClientPipelineRequests);
+    unsigned int flags = args->flags;
+
+    virCheckFlagsGoto(0, error);
+
+    /* The limit configured by the admin is a floor, pipelining
+     * can only ever raise it */
+    if (depth > current) {
+        VIR_DEBUG("Raising concurrent requests of client=%p from %zu to %zu",
+                  client, current, depth);
+        virNetServerClientSetMaxRequests(client, depth);
+        current = depth;
+    }
+
+    ret->depth = current;
+    return 0;
+
+ error:
+    virNetMessageSaveError(rerr);
+    return -1;
+}
+
+
+static int
+remoteDispatchConnectCallBatch(virNetServerPtr server,
+                               virNetServerClientPtr client,
+                               virNetMessagePtr msg G_GNUC_UNUSED,
+                               virNetMessageErrorPtr rerr,
+                               remote_connect_call_batch_args *args,
+                               remote_connect_call_batch_ret *ret)
+{
+    virNetMessagePtr call = NULL;
+    unsigned int flags = args->flags;
+    size_t i;
+    int rv = -1;
+
+    virCheckFlagsGoto(0, cleanup);
+
+    if (VIR_ALLOC_N(ret->replies.replies_val, args->calls.calls_len) < 0)
+        goto cleanup;
+
+    /* The calls are run in order, each one to completion, so that
+     * a batch behaves just like the same calls issued one by one */
+    for (i = 0; i < args->calls.calls_len; i++) {
+        remote_call_batch_packet *packet = args->calls.calls_val + i;
+        remote_call_batch_packet *reply = ret->replies.replies_val + i;
+
+        if (!(call = virNetMessageNew(false)))
+            goto cleanup;
+
+        if (virNetMessageReserveBuffer(call, packet->data.data_len) < 0)
+            goto cleanup;
+        memcpy(call->buffer, packet->data.data_val, packet->data.data_len);
+        call->bufferLength = packet->data.data_len;
+
+        if (virNetServerProgramDispatchBatched(remoteProgram, server,
+                                               client, call) < 0)
+            goto cleanup;
+
+        if (call->bufferLength > REMOTE_CALL_BATCH_PACKET_MAX) {
+            virReportError(VIR_ERR_RPC,
+                           _("reply of batched call %zu is too large"), i);
+            goto cleanup;
+        }
+
+        reply->data.data_len = call->bufferLength;
+        reply->data.data_val = g_steal_pointer(&call->buffer);
+        ret->replies.replies_len++;
+
+        virNetMessageFree(call);
+        call = NULL;
+    }
+
+    rv = 0;
+
+ cleanup:
+    if (rv < 0) {
+        virNetMessageSaveError(rerr);
+        xdr_free((xdrproc_t)xdr_remote_connect_call_batch_ret, (char *)ret);
+    }
+    virNetMessageFree(call);
+    return rv;
+}
+
+
 static int
 remoteDispatchNodeAllocPages(virNetServerPtr server G_GNUC_UNUSED,
                              virNetServerClientPtr client,
@@ -49,6 +49,8 @@
 #include "virauthconfig.h"
 #include "virstring.h"
 #include "virutil.h"
+#include "viruuid.h"
+#include "virhash.h"
 
 #define VIR_FROM_THIS VIR_FROM_REMOTE
 
@@ -134,9 +136,50 @@ struct private_data {
     bool serverKeepAlive;       /* Does server support keepalive protocol? */
     bool serverEventFilter;     /* Does server support modern event filtering */
     bool serverCloseCallback;   /* Does server support driver close callback */
+    bool compactStats;          /* Use compact domain stats rpc */
+    bool serverCallBatch;       /* Does server support batch calls */
+    bool serverStreamLargePackets; /* Does server accept stream packets
+                                      above the legacy payload size */
 
     virObjectEventStatePtr eventState;
     virConnectCloseCallbackDataPtr closeCallback;
+
+    /* Compact domain stats state, mirrors the server side. Guarded by
+     * statsLock which is held for the duration of the whole call. */
+    virMutex statsLock;
+    char **statsKeys;
+    size_t nstatsKeys;
+    virHashTablePtr statsSamples; /* UUID string -> virTypedParamList */
+    unsigned long long statsSerial;
+
+    /* Opt-in cache of domain lookups, XML and info, invalidated by the
+     * domain events received. Guarded by cacheLock, which is never held
+     * during calls. */
+    virMutex cacheLock;
+    bool domainCacheRequested;  /* Asked for by the "cache" URI parameter */
+    bool domainCache;           /* Events needed by the cache registered */
+    virHashTablePtr cacheEntries; /* UUID string -> remoteDomainCacheEntry */
+    unsigned long long cacheGeneration; /* bumped by every invalidation */
+};
+
+typedef struct _remoteDomainCacheXML remoteDomainCacheXML;
+struct _remoteDomainCacheXML {
+    unsigned int flags;
+    char *xml;
+};
+
+typedef struct _remoteDomainCacheEntry remoteDomainCacheEntry;
+typedef remoteDomainCacheEntry *remoteDomainCacheEntryPtr;
+struct _remoteDomainCacheEntry {
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    char *name;
+    int id;
+
+    bool haveInfo;      /* only cached for inactive domains */
+    virDomainInfo info;
+
+    remoteDomainCacheXML *xmls; /* one per flags value asked for */
+    size_t nxmls;
 };
 
 enum {
@@ -144,6 +187,19 @@ enum {
     REMOTE_CALL_LXC               = (1 << 1),
 };
 
+/* A single call of a batch, see callBatch() */
+typedef struct _remoteBatchCall remoteBatchCall;
+struct _remoteBatchCall {
+    int proc_nr;
+    xdrproc_t args_filter;
+    char *args;
+    xdrproc_t ret_filter;
+    char *ret;
+
+    int rv;             /* Result of the call, filled in by callBatch() */
+    virErrorPtr error;  /* Error of a failed call, to be freed by caller */
+};
+
 
 static void remoteDriverLock(struct private_data *driver)
 {
@@ -166,6 +222,8 @@ static int callFull(virConnectPtr conn, struct private_data *priv,
                     int proc_nr,
                     xdrproc_t args_filter, char *args,
                     xdrproc_t ret_filter, char *ret);
+static int callBatch(virConnectPtr conn, struct private_data *priv,
+                     remoteBatchCall *calls, size_t ncalls);
 static int remoteAuthenticate(virConnectPtr conn, struct private_data *priv,
                               virConnectAuthPtr auth, const char *authtype);
 #if WITH_SASL
@@ -468,6 +526,11 @@ remoteDomainBuildEventBlockThreshold(virNetClientProgramPtr prog,
                                      virNetClientPtr client,
                                      void *evdata, void *opaque);
 
+static void
+remoteDomainBuildEventCallbackStats(virNetClientProgramPtr prog,
+                                    virNetClientPtr client,
+                                    void *evdata, void *opaque);
+
 static void
 remoteConnectNotifyEventConnectionClosed(virNetClientProgramPtr prog G_GNUC_UNUSED,
                                          virNetClientPtr client G_GNUC_UNUSED,
@@ -679,6 +742,10 @@ static virNetClientProgramEvent remoteEvents[] = {
       remoteDomainBuildEventBlockThreshold,
       sizeof(remote_domain_event_block_threshold_msg),
       (xdrproc_t)xdr_remote_domain_event_block_threshold_msg },
+    { REMOTE_PROC_DOMAIN_EVENT_CALLBACK_STATS,
+      remoteDomainBuildEventCallbackStats,
+      sizeof(remote_domain_event_callback_stats_msg),
+      (xdrproc_t)xdr_remote_domain_event_callback_stats_msg },
 };
 
 static void
@@ -737,6 +804,43 @@ remoteConnectSupportsFeatureUnlocked(virConnectPtr conn,
     return rc != -1 && ret.supported;
 }
 
+static void
+remoteConnectSupportsFeaturesUnlocked(virConnectPtr conn,
+                                      struct private_data *priv,
+                                      const int *features,
+                                      bool *supported,
+                                      size_t nfeatures)
+{
+    g_autofree remote_connect_supports_feature_args *args = NULL;
+    g_autofree remote_connect_supports_feature_ret *ret = NULL;
+    g_autofree remoteBatchCall *calls = NULL;
+    size_t i;
+
+    args = g_new0(remote_connect_supports_feature_args, nfeatures);
+    ret = g_new0(remote_connect_supports_feature_ret, nfeatures);
+    calls = g_new0(remoteBatchCall, nfeatures);
+
+    for (i = 0; i < nfeatures; i++) {
+        args[i].feature = features[i];
+        calls[i].proc_nr = REMOTE_PROC_CONNECT_SUPPORTS_FEATURE;
+        calls[i].args_filter = (xdrproc_t)xdr_remote_connect_supports_feature_args;
+        calls[i].args = (char *) &args[i];
+        calls[i].ret_filter = (xdrproc_t)xdr_remote_connect_supports_feature_ret;
+        calls[i].ret = (char *) &ret[i];
+    }
+
+    if (callBatch(conn, priv, calls, nfeatures) < 0) {
+        for (i = 0; i < nfeatures; i++)
+            supported[i] = false;
+        return;
+    }
+
+    for (i = 0; i < nfeatures; i++) {
+        supported[i] = calls[i].rv != -1 && ret[i].supported;
+        virFreeError(calls[i].error);
+    }
+}
+
 /* helper macro to ease extraction of arguments from the URI */
 #define EXTRACT_URI_ARG_STR(ARG_NAME, ARG_VAR) \
     if (STRCASEEQ(var->name, ARG_NAME)) { \
@@ -956,6 +1060,12 @@ doRemoteOpen(virConnectPtr conn,
 #ifndef WIN32
     bool tty = true;
 #endif
+    bool compactStats = false;
+    bool domainCache = false;
+    unsigned int pipelineDepth = 0;
+    int features[5];
+    bool supported[G_N_ELEMENTS(features)];
+    size_t nfeatures = 0;
     int mode;
 
     if (inside_daemon && !conn->uri->server) {
@@ -1037,6 +1147,43 @@ doRemoteOpen(virConnectPtr conn,
             EXTRACT_URI_ARG_BOOL("no_tty", tty);
 #endif
 
+            if (STRCASEEQ(var->name, "compact_stats")) {
+                int tmp;
+                if (virStrToLong_i(var->value, NULL, 10, &tmp) < 0) {
+                    virReportError(VIR_ERR_INVALID_ARG,
+                                   _("Failed to parse value of URI component %s"),
+                                   var->name);
+                    goto failed;
+                }
+                compactStats = tmp != 0;
+                var->ignore = 1;
+                continue;
+            }
+
+            if (STRCASEEQ(var->name, "cache")) {
+                int tmp;
+                if (virStrToLong_i(var->value, NULL, 10, &tmp) < 0) {
+                    virReportError(VIR_ERR_INVALID_ARG,
+                                   _("Failed to parse value of URI component %s"),
+                                   var->name);
+                    goto failed;
+                }
+                domainCache = tmp != 0;
+                var->ignore = 1;
+                continue;
+            }
+
+            if (STRCASEEQ(var->name, "pipeline")) {
+                if (virStrToLong_ui(var->value, NULL, 10, &pipelineDepth) < 0) {
+                    virReportError(VIR_ERR_INVALID_ARG,
+                                   _("Failed to parse value of URI component %s"),
+                                   var->name);
+                    goto failed;
+                }
+                var->ignore = 1;
+                continue;
+            }
+
             if (STRCASEEQ(var->name, "authfile")) {
                 /* Strip this param, used by virauth.c */
                 var->ignore = 1;
@@ -1267,6 +1414,10 @@ doRemoteOpen(virConnectPtr conn,
         VIR_DEBUG("Failed to add event watch, disabling events and support for"
                   " keepalive messages");
         virResetLastError();
+        if (domainCache) {
+            VIR_INFO("Not caching domains since events can't be received");
+            domainCache = false;
+        }
     } else {
         if (virNetClientRegisterKeepAlive(priv->client) < 0)
             goto failed;
@@ -1352,20 +1503,70 @@ doRemoteOpen(virConnectPtr conn,
     if (!(priv->eventState = virObjectEventStateNew()))
         goto failed;
 
-    priv->serverEventFilter = remoteConnectSupportsFeatureUnlocked(conn,
-                                priv, VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK);
+    priv->serverCallBatch = remoteConnectSupportsFeatureUnlocked(conn,
+                                priv, VIR_DRV_FEATURE_REMOTE_CALL_BATCH);
+
+    /* The remaining features are probed with a single batch call,
+     * if the server supports it */
+    features[nfeatures++] = VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK;
+    features[nfeatures++] = VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK;
+    features[nfeatures++] = VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PACKETS;
+    if (compactStats)
+        features[nfeatures++] = VIR_DRV_FEATURE_REMOTE_STATS_COMPACT;
+    if (pipelineDepth)
+        features[nfeatures++] = VIR_DRV_FEATURE_REMOTE_PIPELINE;
+
+    remoteConnectSupportsFeaturesUnlocked(conn, priv, features,
+                                          supported, nfeatures);
+    nfeatures = 0;
+
+    priv->serverEventFilter = supported[nfeatures++];
     if (!priv->serverEventFilter) {
         VIR_INFO("Avoiding server event filtering since it is not "
                  "supported by the server");
     }
 
-    priv->serverCloseCallback = remoteConnectSupportsFeatureUnlocked(conn,
-                                    priv, VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK);
+    priv->serverCloseCallback = supported[nfeatures++];
     if (!priv->serverCloseCallback) {
         VIR_INFO("Close callback registering isn't supported "
                  "by the remote side.");
     }
 
+    priv->serverStreamLargePackets = supported[nfeatures++];
+
+    /* The cache relies on events sent for all domains without a local
+     * callback to dispatch them to */
+    if (domainCache && !priv->serverEventFilter)
+        VIR_INFO("Not caching domains since the server can't filter events");
+    else
+        priv->domainCacheRequested = domainCache;
+
+    if (compactStats) {
+        priv->compactStats = supported[nfeatures++];
+        if (!priv->compactStats) {
+            VIR_INFO("Compact domain stats aren't supported "
+                     "by the remote side.");
+        }
+    }
+
+    if (pipelineDepth) {
+        if (supported[nfeatures++]) {
+            remote_connect_set_pipeline_depth_args args = { pipelineDepth, 0 };
+            remote_connect_set_pipeline_depth_ret ret = { 0 };
+
+            if (call(conn, priv, 0, REMOTE_PROC_CONNECT_SET_PIPELINE_DEPTH,
+                     (xdrproc_t) xdr_remote_connect_set_pipeline_depth_args, (char *) &args,
+                     (xdrproc_t) xdr_remote_connect_set_pipeline_depth_ret, (char *) &ret) == -1)
+                goto failed;
+
+            VIR_DEBUG("Requested pipeline depth %u, server granted %u",
+                      pipelineDepth, ret.depth);
+        } else {
+            VIR_INFO("Raising the pipeline depth isn't supported "
+                     "by the remote side.");
+        }
+    }
+
     return VIR_DRV_OPEN_SUCCESS;
 
  failed:
@@ -1399,6 +1600,21 @@ remoteAllocPrivateData(void)
         VIR_FREE(priv);
         return NULL;
     }
+    if (virMutexInit(&priv->statsLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        virMutexDestroy(&priv->lock);
+        VIR_FREE(priv);
+        return NULL;
+    }
+    if (virMutexInit(&priv->cacheLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        virMutexDestroy(&priv->statsLock);
+        virMutexDestroy(&priv->lock);
+        VIR_FREE(priv);
+        return NULL;
+    }
     remoteDriverLock(priv);
     priv->localUses = 1;
 
@@ -1546,6 +1762,18 @@ doRemoteClose(virConnectPtr conn, struct private_data *priv)
     virObjectUnref(priv->eventState);
     priv->eventState = NULL;
 
+    virStringListFreeCount(priv->statsKeys, priv->nstatsKeys);
+    priv->statsKeys = NULL;
+    priv->nstatsKeys = 0;
+    virHashFree(priv->statsSamples);
+    priv->statsSamples = NULL;
+
+    virMutexLock(&priv->cacheLock);
+    priv->domainCache = false;
+    virHashFree(priv->cacheEntries);
+    priv->cacheEntries = NULL;
+    virMutexUnlock(&priv->cacheLock);
+
     return ret;
 }
 
@@ -1561,6 +1789,8 @@ remoteConnectClose(virConnectPtr conn)
         ret = doRemoteClose(conn, priv);
         conn->privateData = NULL;
         remoteDriverUnlock(priv);
+        virMutexDestroy(&priv->cacheLock);
+        virMutexDestroy(&priv->statsLock);
         virMutexDestroy(&priv->lock);
         VIR_FREE(priv);
     }
@@ -4570,167 +4800,622 @@ remoteConnectDomainEventDeregister(virConnectPtr conn,
 }
 
 
-static void
-remoteDomainBuildEventLifecycleHelper(virConnectPtr conn,
-                                      remote_domain_event_lifecycle_msg *msg,
-                                      int callbackID)
-{
-    struct private_data *priv = conn->privateData;
-    virDomainPtr dom;
-    virObjectEventPtr event = NULL;
+/*
+ * Domain cache
+ *
+ * With the "cache" URI parameter, lookups of domains, their XML and the
+ * info of inactive domains are served from memory once fetched. Entries
+ * are dropped whenever an event is received for their domain, for which
+ * the events that come with changes of the definition or state of a
+ * domain are registered for all domains on first use of the cache. The
+ * generation counter keeps a reply fetched while an event arrived from
+ * being cached.
+ */
 
-    dom = get_nonnull_domain(conn, msg->dom);
-    if (!dom)
-        return;
+/* Events after which cached data of a domain may be stale */
+static const int remoteDomainCacheEvents[] = {
+    VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+    VIR_DOMAIN_EVENT_ID_DEVICE_ADDED,
+    VIR_DOMAIN_EVENT_ID_DEVICE_REMOVED,
+    VIR_DOMAIN_EVENT_ID_TUNABLE,
+    VIR_DOMAIN_EVENT_ID_METADATA_CHANGE,
+    VIR_DOMAIN_EVENT_ID_BALLOON_CHANGE,
+    VIR_DOMAIN_EVENT_ID_DISK_CHANGE,
+    VIR_DOMAIN_EVENT_ID_TRAY_CHANGE,
+    VIR_DOMAIN_EVENT_ID_BLOCK_JOB_2,
+};
 
-    event = virDomainEventLifecycleNewFromDom(dom, msg->event, msg->detail);
-    virObjectUnref(dom);
 
-    virObjectEventStateQueueRemote(priv->eventState, event, callbackID);
-}
-static void
-remoteDomainBuildEventLifecycle(virNetClientProgramPtr prog G_GNUC_UNUSED,
-                                virNetClientPtr client G_GNUC_UNUSED,
-                                void *evdata, void *opaque)
-{
-    virConnectPtr conn = opaque;
-    remote_domain_event_lifecycle_msg *msg = evdata;
-    remoteDomainBuildEventLifecycleHelper(conn, msg, -1);
-}
 static void
-remoteDomainBuildEventCallbackLifecycle(virNetClientProgramPtr prog G_GNUC_UNUSED,
-                                        virNetClientPtr client G_GNUC_UNUSED,
-                                        void *evdata, void *opaque)
+remoteDomainCacheEntryFree(void *opaque)
 {
-    virConnectPtr conn = opaque;
-    remote_domain_event_callback_lifecycle_msg *msg = evdata;
-    remoteDomainBuildEventLifecycleHelper(conn, &msg->msg, msg->callbackID);
+    remoteDomainCacheEntryPtr entry = opaque;
+    size_t i;
+
+    if (!entry)
+        return;
+
+    for (i = 0; i < entry->nxmls; i++)
+        g_free(entry->xmls[i].xml);
+    g_free(entry->xmls);
+    g_free(entry->name);
+    g_free(entry);
 }
 
 
-static void
-remoteDomainBuildEventRebootHelper(virConnectPtr conn,
-                                   remote_domain_event_reboot_msg *msg,
-                                   int callbackID)
+/*
+ * Must be called with priv->lock held. Returns true if the cache may be
+ * used, registering the events needed to keep it up to date if that
+ * wasn't done yet.
+ */
+static bool
+remoteDomainCacheActive(virConnectPtr conn,
+                        struct private_data *priv)
 {
-    struct private_data *priv = conn->privateData;
-    virDomainPtr dom;
-    virObjectEventPtr event = NULL;
+    remote_connect_domain_event_callback_register_any_args args[G_N_ELEMENTS(remoteDomainCacheEvents)];
+    remote_connect_domain_event_callback_register_any_ret ret[G_N_ELEMENTS(remoteDomainCacheEvents)];
+    remoteBatchCall calls[G_N_ELEMENTS(remoteDomainCacheEvents)];
+    bool ok = true;
+    size_t i;
 
-    dom = get_nonnull_domain(conn, msg->dom);
-    if (!dom)
-        return;
+    if (priv->domainCache || !priv->domainCacheRequested)
+        return priv->domainCache;
 
-    event = virDomainEventRebootNewFromDom(dom);
-    virObjectUnref(dom);
+    /* Only try once */
+    priv->domainCacheRequested = false;
 
-    virObjectEventStateQueueRemote(priv->eventState, event, callbackID);
-}
-static void
-remoteDomainBuildEventReboot(virNetClientProgramPtr prog G_GNUC_UNUSED,
-                             virNetClientPtr client G_GNUC_UNUSED,
-                             void *evdata, void *opaque)
-{
-    virConnectPtr conn = opaque;
-    remote_domain_event_reboot_msg *msg = evdata;
-    remoteDomainBuildEventRebootHelper(conn, msg, -1);
+    memset(args, 0, sizeof(args));
+    memset(ret, 0, sizeof(ret));
+    memset(calls, 0, sizeof(calls));
+
+    for (i = 0; i < G_N_ELEMENTS(remoteDomainCacheEvents); i++) {
+        args[i].eventID = remoteDomainCacheEvents[i];
+        calls[i].proc_nr = REMOTE_PROC_CONNECT_DOMAIN_EVENT_CALLBACK_REGISTER_ANY;
+        calls[i].args_filter = (xdrproc_t)xdr_remote_connect_domain_event_callback_register_any_args;
+        calls[i].args = (char *) &args[i];
+        calls[i].ret_filter = (xdrproc_t)xdr_remote_connect_domain_event_callback_register_any_ret;
+        calls[i].ret = (char *) &ret[i];
+    }
+
+    if (callBatch(conn, priv, calls, G_N_ELEMENTS(calls)) < 0) {
+        VIR_WARN("Unable to register events for the domain cache: %s",
+                 virGetLastErrorMessage());
+        virResetLastError();
+        return false;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(calls); i++) {
+        if (calls[i].rv < 0) {
+            VIR_WARN("Unable to register event %d for the domain cache: %s",
+                     remoteDomainCacheEvents[i],
+                     calls[i].error ? NULLSTR(calls[i].error->message) : "");
+            ok = false;
+        }
+        virFreeError(calls[i].error);
+    }
+
+    /* Registrations which succeeded are left in place, their events are
+     * not dispatched anywhere as there are no local callbacks for them */
+    if (!ok)
+        return false;
+
+    virMutexLock(&priv->cacheLock);
+    priv->cacheEntries = virHashNew(remoteDomainCacheEntryFree);
+    priv->domainCache = true;
+    virMutexUnlock(&priv->cacheLock);
+
+    return true;
 }
+
+
+/* Drop the cached data of the domain with @uuid, if any */
 static void
-remoteDomainBuildEventCallbackReboot(virNetClientProgramPtr prog G_GNUC_UNUSED,
-                                     virNetClientPtr client G_GNUC_UNUSED,
-                                     void *evdata, void *opaque)
+remoteDomainCacheInvalidate(struct private_data *priv,
+                            const unsigned char *uuid)
 {
-    virConnectPtr conn = opaque;
-    remote_domain_event_callback_reboot_msg *msg = evdata;
-    remoteDomainBuildEventRebootHelper(conn, &msg->msg, msg->callbackID);
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    virMutexLock(&priv->cacheLock);
+    if (priv->cacheEntries) {
+        virUUIDFormat(uuid, uuidstr);
+        virHashRemoveEntry(priv->cacheEntries, uuidstr);
+        priv->cacheGeneration++;
+    }
+    virMutexUnlock(&priv->cacheLock);
 }
 
-static void
-remoteDomainBuildEventRTCChangeHelper(virConnectPtr conn,
-                                      remote_domain_event_rtc_change_msg *msg,
-                                      int callbackID)
+
+/* Must be called with priv->cacheLock held */
+static remoteDomainCacheEntryPtr
+remoteDomainCacheGetEntry(struct private_data *priv,
+                          const unsigned char *uuid,
+                          const char *name,
+                          int id)
 {
-    struct private_data *priv = conn->privateData;
-    virDomainPtr dom;
-    virObjectEventPtr event = NULL;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    remoteDomainCacheEntryPtr entry;
 
-    dom = get_nonnull_domain(conn, msg->dom);
-    if (!dom)
-        return;
+    virUUIDFormat(uuid, uuidstr);
+    if ((entry = virHashLookup(priv->cacheEntries, uuidstr)))
+        return entry;
 
-    event = virDomainEventRTCChangeNewFromDom(dom, msg->offset);
-    virObjectUnref(dom);
+    entry = g_new0(remoteDomainCacheEntry, 1);
+    memcpy(entry->uuid, uuid, VIR_UUID_BUFLEN);
+    entry->name = g_strdup(name);
+    entry->id = id;
 
-    virObjectEventStateQueueRemote(priv->eventState, event, callbackID);
-}
-static void
-remoteDomainBuildEventRTCChange(virNetClientProgramPtr prog G_GNUC_UNUSED,
-                                virNetClientPtr client G_GNUC_UNUSED,
-                                void *evdata, void *opaque)
-{
-    virConnectPtr conn = opaque;
-    remote_domain_event_rtc_change_msg *msg = evdata;
-    remoteDomainBuildEventRTCChangeHelper(conn, msg, -1);
+    if (virHashAddEntry(priv->cacheEntries, uuidstr, entry) < 0) {
+        remoteDomainCacheEntryFree(entry);
+        return NULL;
+    }
+
+    return entry;
 }
-static void
-remoteDomainBuildEventCallbackRTCChange(virNetClientProgramPtr prog G_GNUC_UNUSED,
-                                        virNetClientPtr client G_GNUC_UNUSED,
-                                        void *evdata, void *opaque)
+
+
+/*
+ * Remember @dom, fetched from the server while the cache generation was
+ * @generation. Must be called with priv->cacheLock held.
+ */
+static remoteDomainCacheEntryPtr
+remoteDomainCacheStore(struct private_data *priv,
+                       unsigned long long generation,
+                       virDomainPtr dom)
 {
-    virConnectPtr conn = opaque;
-    remote_domain_event_callback_rtc_change_msg *msg = evdata;
-    remoteDomainBuildEventRTCChangeHelper(conn, &msg->msg, msg->callbackID);
+    if (!priv->cacheEntries || generation != priv->cacheGeneration)
+        return NULL;
+
+    return remoteDomainCacheGetEntry(priv, dom->uuid, dom->name, dom->id);
 }
 
-static void
-remoteDomainBuildEventWatchdogHelper(virConnectPtr conn,
-                                     remote_domain_event_watchdog_msg *msg,
-                                     int callbackID)
+
+static int
+remoteDomainCacheSearchName(const void *payload,
+                            const void *name G_GNUC_UNUSED,
+                            const void *opaque)
 {
-    struct private_data *priv = conn->privateData;
-    virDomainPtr dom;
-    virObjectEventPtr event = NULL;
+    const remoteDomainCacheEntry *entry = payload;
 
-    dom = get_nonnull_domain(conn, msg->dom);
-    if (!dom)
-        return;
+    return STREQ(entry->name, opaque);
+}
 
-    event = virDomainEventWatchdogNewFromDom(dom, msg->action);
-    virObjectUnref(dom);
 
-    virObjectEventStateQueueRemote(priv->eventState, event, callbackID);
-}
-static void
-remoteDomainBuildEventWatchdog(virNetClientProgramPtr prog G_GNUC_UNUSED,
-                               virNetClientPtr client G_GNUC_UNUSED,
-                               void *evdata, void *opaque)
+static int
+remoteDomainCacheSearchID(const void *payload,
+                          const void *name G_GNUC_UNUSED,
+                          const void *opaque)
 {
-    virConnectPtr conn = opaque;
-    remote_domain_event_watchdog_msg *msg = evdata;
-    remoteDomainBuildEventWatchdogHelper(conn, msg, -1);
+    const remoteDomainCacheEntry *entry = payload;
+
+    return entry->id != -1 && entry->id == *(const int *) opaque;
 }
-static void
-remoteDomainBuildEventCallbackWatchdog(virNetClientProgramPtr prog G_GNUC_UNUSED,
-                                       virNetClientPtr client G_GNUC_UNUSED,
-                                       void *evdata, void *opaque)
-{
-    virConnectPtr conn = opaque;
-    remote_domain_event_callback_watchdog_msg *msg = evdata;
-    remoteDomainBuildEventWatchdogHelper(conn, &msg->msg, msg->callbackID);
+
+
+/*
+ * Look up a cached domain by @uuid, @name or @id, whichever is set.
+ * Returns a new reference to the domain if found, NULL otherwise, filling
+ * @generation with the current cache generation then. Must be called with
+ * priv->lock held.
+ */
+static virDomainPtr
+remoteDomainCacheLookup(virConnectPtr conn,
+                        struct private_data *priv,
+                        const unsigned char *uuid,
+                        const char *name,
+                        int id,
+                        unsigned long long *generation)
+{
+    remoteDomainCacheEntryPtr entry = NULL;
+    virDomainPtr dom = NULL;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (!remoteDomainCacheActive(conn, priv))
+        return NULL;
+
+    virMutexLock(&priv->cacheLock);
+
+    if (uuid) {
+        virUUIDFormat(uuid, uuidstr);
+        entry = virHashLookup(priv->cacheEntries, uuidstr);
+    } else if (name) {
+        entry = virHashSearch(priv->cacheEntries,
+                              remoteDomainCacheSearchName, name, NULL);
+    } else {
+        entry = virHashSearch(priv->cacheEntries,
+                              remoteDomainCacheSearchID, &id, NULL);
+    }
+
+    if (entry)
+        dom = virGetDomain(conn, entry->name, entry->uuid, entry->id);
+
+    *generation = priv->cacheGeneration;
+    virMutexUnlock(&priv->cacheLock);
+
+    return dom;
 }
 
-static void
-remoteDomainBuildEventIOErrorHelper(virConnectPtr conn,
-                                    remote_domain_event_io_error_msg *msg,
-                                    int callbackID)
+
+static virDomainPtr
+remoteDomainLookupHelper(virConnectPtr conn,
+                         const unsigned char *uuid,
+                         const char *name,
+                         int id)
 {
+    virDomainPtr rv = NULL;
     struct private_data *priv = conn->privateData;
-    virDomainPtr dom;
-    virObjectEventPtr event = NULL;
+    unsigned long long generation = 0;
+    int proc_nr;
+    xdrproc_t args_filter;
+    char *args;
+    remote_domain_lookup_by_uuid_args uuidArgs;
+    remote_domain_lookup_by_name_args nameArgs;
+    remote_domain_lookup_by_id_args idArgs;
+    /* The three procedures have the same return structure */
+    remote_domain_lookup_by_uuid_ret ret;
 
-    dom = get_nonnull_domain(conn, msg->dom);
-    if (!dom)
-        return;
+    remoteDriverLock(priv);
+
+    if ((rv = remoteDomainCacheLookup(conn, priv, uuid, name, id,
+                                      &generation)))
+        goto done;
+
+    if (uuid) {
+        memcpy(uuidArgs.uuid, uuid, VIR_UUID_BUFLEN);
+        proc_nr = REMOTE_PROC_DOMAIN_LOOKUP_BY_UUID;
+        args_filter = (xdrproc_t)xdr_remote_domain_lookup_by_uuid_args;
+        args = (char *) &uuidArgs;
+    } else if (name) {
+        nameArgs.name = (char *) name;
+        proc_nr = REMOTE_PROC_DOMAIN_LOOKUP_BY_NAME;
+        args_filter = (xdrproc_t)xdr_remote_domain_lookup_by_name_args;
+        args = (char *) &nameArgs;
+    } else {
+        idArgs.id = id;
+        proc_nr = REMOTE_PROC_DOMAIN_LOOKUP_BY_ID;
+        args_filter = (xdrproc_t)xdr_remote_domain_lookup_by_id_args;
+        args = (char *) &idArgs;
+    }
+
+    memset(&ret, 0, sizeof(ret));
+
+    if (call(conn, priv, 0, proc_nr,
+             args_filter, args,
+             (xdrproc_t)xdr_remote_domain_lookup_by_uuid_ret, (char *) &ret) == -1)
+        goto done;
+
+    rv = get_nonnull_domain(conn, ret.dom);
+    xdr_free((xdrproc_t)xdr_remote_domain_lookup_by_uuid_ret, (char *) &ret);
+
+    if (rv && priv->domainCache) {
+        virMutexLock(&priv->cacheLock);
+        remoteDomainCacheStore(priv, generation, rv);
+        virMutexUnlock(&priv->cacheLock);
+    }
+
+ done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+
+static virDomainPtr
+remoteDomainLookupByUUID(virConnectPtr conn,
+                         const unsigned char *uuid)
+{
+    return remoteDomainLookupHelper(conn, uuid, NULL, -1);
+}
+
+
+static virDomainPtr
+remoteDomainLookupByName(virConnectPtr conn,
+                         const char *name)
+{
+    return remoteDomainLookupHelper(conn, NULL, name, -1);
+}
+
+
+static virDomainPtr
+remoteDomainLookupByID(virConnectPtr conn,
+                       int id)
+{
+    return remoteDomainLookupHelper(conn, NULL, NULL, id);
+}
+
+
+static char *
+remoteDomainGetXMLDesc(virDomainPtr dom,
+                       unsigned int flags)
+{
+    char *rv = NULL;
+    struct private_data *priv = dom->conn->privateData;
+    remote_domain_get_xml_desc_args args;
+    remote_domain_get_xml_desc_ret ret;
+    remoteDomainCacheEntryPtr entry;
+    unsigned long long generation = 0;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+    size_t i;
+
+    remoteDriverLock(priv);
+
+    if (remoteDomainCacheActive(dom->conn, priv)) {
+        virMutexLock(&priv->cacheLock);
+        virUUIDFormat(dom->uuid, uuidstr);
+        if ((entry = virHashLookup(priv->cacheEntries, uuidstr))) {
+            for (i = 0; i < entry->nxmls; i++) {
+                if (entry->xmls[i].flags == flags) {
+                    rv = g_strdup(entry->xmls[i].xml);
+                    break;
+                }
+            }
+        }
+        generation = priv->cacheGeneration;
+        virMutexUnlock(&priv->cacheLock);
+
+        if (rv)
+            goto done;
+    }
+
+    make_nonnull_domain(&args.dom, dom);
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+
+    if (call(dom->conn, priv, 0, REMOTE_PROC_DOMAIN_GET_XML_DESC,
+             (xdrproc_t)xdr_remote_domain_get_xml_desc_args, (char *) &args,
+             (xdrproc_t)xdr_remote_domain_get_xml_desc_ret, (char *) &ret) == -1)
+        goto done;
+
+    rv = ret.xml;
+
+    if (priv->domainCache) {
+        virMutexLock(&priv->cacheLock);
+        if ((entry = remoteDomainCacheStore(priv, generation, dom))) {
+            remoteDomainCacheXML cached = { flags, g_strdup(rv) };
+
+            ignore_value(VIR_APPEND_ELEMENT(entry->xmls, entry->nxmls, cached));
+        }
+        virMutexUnlock(&priv->cacheLock);
+    }
+
+ done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+
+static int
+remoteDomainGetInfo(virDomainPtr dom,
+                    virDomainInfoPtr info)
+{
+    int rv = -1;
+    struct private_data *priv = dom->conn->privateData;
+    remote_domain_get_info_args args;
+    remote_domain_get_info_ret ret;
+    remoteDomainCacheEntryPtr entry;
+    unsigned long long generation = 0;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    remoteDriverLock(priv);
+
+    if (remoteDomainCacheActive(dom->conn, priv)) {
+        virMutexLock(&priv->cacheLock);
+        virUUIDFormat(dom->uuid, uuidstr);
+        if ((entry = virHashLookup(priv->cacheEntries, uuidstr)) &&
+            entry->haveInfo) {
+            *info = entry->info;
+            rv = 0;
+        }
+        generation = priv->cacheGeneration;
+        virMutexUnlock(&priv->cacheLock);
+
+        if (rv == 0)
+            goto done;
+    }
+
+    make_nonnull_domain(&args.dom, dom);
+
+    memset(&ret, 0, sizeof(ret));
+
+    if (call(dom->conn, priv, 0, REMOTE_PROC_DOMAIN_GET_INFO,
+             (xdrproc_t)xdr_remote_domain_get_info_args, (char *) &args,
+             (xdrproc_t)xdr_remote_domain_get_info_ret, (char *) &ret) == -1)
+        goto done;
+
+    info->state = ret.state;
+    info->maxMem = ret.maxMem;
+    info->memory = ret.memory;
+    info->nrVirtCpu = ret.nrVirtCpu;
+    info->cpuTime = ret.cpuTime;
+
+    /* The CPU time and memory of running domains change without events */
+    if (priv->domainCache && info->state == VIR_DOMAIN_SHUTOFF) {
+        virMutexLock(&priv->cacheLock);
+        if ((entry = remoteDomainCacheStore(priv, generation, dom))) {
+            entry->info = *info;
+            entry->haveInfo = true;
+        }
+        virMutexUnlock(&priv->cacheLock);
+    }
+
+    rv = 0;
+
+ done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+
+static void
+remoteDomainBuildEventLifecycleHelper(virConnectPtr conn,
+                                      remote_domain_event_lifecycle_msg *msg,
+                                      int callbackID)
+{
+    struct private_data *priv = conn->privateData;
+    virDomainPtr dom;
+    virObjectEventPtr event = NULL;
+
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
+    dom = get_nonnull_domain(conn, msg->dom);
+    if (!dom)
+        return;
+
+    event = virDomainEventLifecycleNewFromDom(dom, msg->event, msg->detail);
+    virObjectUnref(dom);
+
+    virObjectEventStateQueueRemote(priv->eventState, event, callbackID);
+}
+static void
+remoteDomainBuildEventLifecycle(virNetClientProgramPtr prog G_GNUC_UNUSED,
+                                virNetClientPtr client G_GNUC_UNUSED,
+                                void *evdata, void *opaque)
+{
+    virConnectPtr conn = opaque;
+    remote_domain_event_lifecycle_msg *msg = evdata;
+    remoteDomainBuildEventLifecycleHelper(conn, msg, -1);
+}
+static void
+remoteDomainBuildEventCallbackLifecycle(virNetClientProgramPtr prog G_GNUC_UNUSED,
+                                        virNetClientPtr client G_GNUC_UNUSED,
+                                        void *evdata, void *opaque)
+{
+    virConnectPtr conn = opaque;
+    remote_domain_event_callback_lifecycle_msg *msg = evdata;
+    remoteDomainBuildEventLifecycleHelper(conn, &msg->msg, msg->callbackID);
+}
+
+
+static void
+remoteDomainBuildEventRebootHelper(virConnectPtr conn,
+                                   remote_domain_event_reboot_msg *msg,
+                                   int callbackID)
+{
+    struct private_data *priv = conn->privateData;
+    virDomainPtr dom;
+    virObjectEventPtr event = NULL;
+
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
+    dom = get_nonnull_domain(conn, msg->dom);
+    if (!dom)
+        return;
+
+    event = virDomainEventRebootNewFromDom(dom);
+    virObjectUnref(dom);
+
+    virObjectEventStateQueueRemote(priv->eventState, event, callbackID);
+}
+static void
+remoteDomainBuildEventReboot(virNetClientProgramPtr prog G_GNUC_UNUSED,
+                             virNetClientPtr client G_GNUC_UNUSED,
+                             void *evdata, void *opaque)
+{
+    virConnectPtr conn = opaque;
+    remote_domain_event_reboot_msg *msg = evdata;
+    remoteDomainBuildEventRebootHelper(conn, msg, -1);
+}
+static void
+remoteDomainBuildEventCallbackReboot(virNetClientProgramPtr prog G_GNUC_UNUSED,
+                                     virNetClientPtr client G_GNUC_UNUSED,
+                                     void *evdata, void *opaque)
+{
+    virConnectPtr conn = opaque;
+    remote_domain_event_callback_reboot_msg *msg = evdata;
+    remoteDomainBuildEventRebootHelper(conn, &msg->msg, msg->callbackID);
+}
+
+static void
+remoteDomainBuildEventRTCChangeHelper(virConnectPtr conn,
+                                      remote_domain_event_rtc_change_msg *msg,
+                                      int callbackID)
+{
+    struct private_data *priv = conn->privateData;
+    virDomainPtr dom;
+    virObjectEventPtr event = NULL;
+
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
+    dom = get_nonnull_domain(conn, msg->dom);
+    if (!dom)
+        return;
+
+    event = virDomainEventRTCChangeNewFromDom(dom, msg->offset);
+    virObjectUnref(dom);
+
+    virObjectEventStateQueueRemote(priv->eventState, event, callbackID);
+}
+static void
+remoteDomainBuildEventRTCChange(virNetClientProgramPtr prog G_GNUC_UNUSED,
+                                virNetClientPtr client G_GNUC_UNUSED,
+                                void *evdata, void *opaque)
+{
+    virConnectPtr conn = opaque;
+    remote_domain_event_rtc_change_msg *msg = evdata;
+    remoteDomainBuildEventRTCChangeHelper(conn, msg, -1);
+}
+static void
+remoteDomainBuildEventCallbackRTCChange(virNetClientProgramPtr prog G_GNUC_UNUSED,
+                                        virNetClientPtr client G_GNUC_UNUSED,
+                                        void *evdata, void *opaque)
+{
+    virConnectPtr conn = opaque;
+    remote_domain_event_callback_rtc_change_msg *msg = evdata;
+    remoteDomainBuildEventRTCChangeHelper(conn, &msg->msg, msg->callbackID);
+}
+
+static void
+remoteDomainBuildEventWatchdogHelper(virConnectPtr conn,
+                                     remote_domain_event_watchdog_msg *msg,
+                                     int callbackID)
+{
+    struct private_data *priv = conn->privateData;
+    virDomainPtr dom;
+    virObjectEventPtr event = NULL;
+
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
+    dom = get_nonnull_domain(conn, msg->dom);
+    if (!dom)
+        return;
+
+    event = virDomainEventWatchdogNewFromDom(dom, msg->action);
+    virObjectUnref(dom);
+
+    virObjectEventStateQueueRemote(priv->eventState, event, callbackID);
+}
+static void
+remoteDomainBuildEventWatchdog(virNetClientProgramPtr prog G_GNUC_UNUSED,
+                               virNetClientPtr client G_GNUC_UNUSED,
+                               void *evdata, void *opaque)
+{
+    virConnectPtr conn = opaque;
+    remote_domain_event_watchdog_msg *msg = evdata;
+    remoteDomainBuildEventWatchdogHelper(conn, msg, -1);
+}
+static void
+remoteDomainBuildEventCallbackWatchdog(virNetClientProgramPtr prog G_GNUC_UNUSED,
+                                       virNetClientPtr client G_GNUC_UNUSED,
+                                       void *evdata, void *opaque)
+{
+    virConnectPtr conn = opaque;
+    remote_domain_event_callback_watchdog_msg *msg = evdata;
+    remoteDomainBuildEventWatchdogHelper(conn, &msg->msg, msg->callbackID);
+}
+
+static void
+remoteDomainBuildEventIOErrorHelper(virConnectPtr conn,
+                                    remote_domain_event_io_error_msg *msg,
+                                    int callbackID)
+{
+    struct private_data *priv = conn->privateData;
+    virDomainPtr dom;
+    virObjectEventPtr event = NULL;
+
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
+    dom = get_nonnull_domain(conn, msg->dom);
+    if (!dom)
+        return;
 
     event = virDomainEventIOErrorNewFromDom(dom,
                                             msg->srcPath,
@@ -4768,6 +5453,8 @@ remoteDomainBuildEventIOErrorReasonHelper(virConnectPtr conn,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -4810,6 +5497,8 @@ remoteDomainBuildEventBlockJobHelper(virConnectPtr conn,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -4850,6 +5539,8 @@ remoteDomainBuildEventBlockJob2(virNetClientProgramPtr prog G_GNUC_UNUSED,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -4875,6 +5566,8 @@ remoteDomainBuildEventGraphicsHelper(virConnectPtr conn,
     virDomainEventGraphicsSubjectPtr subject = NULL;
     size_t i;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -4963,6 +5656,8 @@ remoteDomainBuildEventControlErrorHelper(virConnectPtr conn,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -5002,6 +5697,8 @@ remoteDomainBuildEventDiskChangeHelper(virConnectPtr conn,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -5045,6 +5742,8 @@ remoteDomainBuildEventTrayChangeHelper(virConnectPtr conn,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -5086,6 +5785,8 @@ remoteDomainBuildEventPMWakeupHelper(virConnectPtr conn,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -5126,6 +5827,8 @@ remoteDomainBuildEventPMSuspendHelper(virConnectPtr conn,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -5166,6 +5869,8 @@ remoteDomainBuildEventBalloonChangeHelper(virConnectPtr conn,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -5205,6 +5910,8 @@ remoteDomainBuildEventPMSuspendDiskHelper(virConnectPtr conn,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -5245,6 +5952,8 @@ remoteDomainBuildEventDeviceRemovedHelper(virConnectPtr conn,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -5285,6 +5994,8 @@ remoteDomainBuildEventCallbackDeviceAdded(virNetClientProgramPtr prog G_GNUC_UNU
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -5308,6 +6019,8 @@ remoteDomainBuildEventCallbackDeviceRemovalFailed(virNetClientProgramPtr prog G_
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     if (!(dom = get_nonnull_domain(conn, msg->dom)))
         return;
 
@@ -5337,6 +6050,8 @@ remoteDomainBuildEventCallbackTunable(virNetClientProgramPtr prog G_GNUC_UNUSED,
                                   &params, &nparams) < 0)
         return;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom) {
         virTypedParamsFree(params, nparams);
@@ -5362,6 +6077,8 @@ remoteDomainBuildEventCallbackAgentLifecycle(virNetClientProgramPtr prog G_GNUC_
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     if (!(dom = get_nonnull_domain(conn, msg->dom)))
         return;
 
@@ -5386,6 +6103,8 @@ remoteDomainBuildEventCallbackMigrationIteration(virNetClientProgramPtr prog G_G
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     if (!(dom = get_nonnull_domain(conn, msg->dom)))
         return;
 
@@ -5417,6 +6136,8 @@ remoteDomainBuildEventCallbackJobCompleted(virNetClientProgramPtr prog G_GNUC_UN
                                   &params, &nparams) < 0)
         return;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     if (!(dom = get_nonnull_domain(conn, msg->dom))) {
         virTypedParamsFree(params, nparams);
         return;
@@ -5430,6 +6151,41 @@ remoteDomainBuildEventCallbackJobCompleted(virNetClientProgramPtr prog G_GNUC_UN
 }
 
 
+static void
+remoteDomainBuildEventCallbackStats(virNetClientProgramPtr prog G_GNUC_UNUSED,
+                                    virNetClientPtr client G_GNUC_UNUSED,
+                                    void *evdata,
+                                    void *opaque)
+{
+    virConnectPtr conn = opaque;
+    remote_domain_event_callback_stats_msg *msg = evdata;
+    struct private_data *priv = conn->privateData;
+    virDomainPtr dom;
+    virObjectEventPtr event = NULL;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+
+    if (virTypedParamsDeserialize((virTypedParameterRemotePtr) msg->params.params_val,
+                                  msg->params.params_len,
+                                  REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX,
+                                  &params, &nparams) < 0)
+        return;
+
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
+    if (!(dom = get_nonnull_domain(conn, msg->dom))) {
+        virTypedParamsFree(params, nparams);
+        return;
+    }
+
+    event = virDomainEventStatsNewFromDom(dom, params, nparams);
+
+    virObjectUnref(dom);
+
+    virObjectEventStateQueueRemote(priv->eventState, event, msg->callbackID);
+}
+
+
 static void
 remoteDomainBuildEventCallbackMetadataChange(virNetClientProgramPtr prog G_GNUC_UNUSED,
                                              virNetClientPtr client G_GNUC_UNUSED,
@@ -5441,6 +6197,8 @@ remoteDomainBuildEventCallbackMetadataChange(virNetClientProgramPtr prog G_GNUC_
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     if (!(dom = get_nonnull_domain(conn, msg->dom)))
         return;
 
@@ -5614,6 +6372,8 @@ remoteDomainBuildQemuMonitorEvent(virNetClientProgramPtr prog G_GNUC_UNUSED,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     dom = get_nonnull_domain(conn, msg->dom);
     if (!dom)
         return;
@@ -5674,6 +6434,8 @@ remoteDomainBuildEventBlockThreshold(virNetClientProgramPtr prog G_GNUC_UNUSED,
     virDomainPtr dom;
     virObjectEventPtr event = NULL;
 
+    remoteDomainCacheInvalidate(priv, msg->dom.uuid);
+
     if (!(dom = get_nonnull_domain(conn, msg->dom)))
         return;
 
@@ -5695,17 +6457,35 @@ remoteStreamSend(virStreamPtr st,
     VIR_DEBUG("st=%p data=%p nbytes=%zu", st, data, nbytes);
     struct private_data *priv = st->conn->privateData;
     virNetClientStreamPtr privst = st->privateData;
+    size_t sent = 0;
     int rv;
 
     remoteDriverLock(priv);
     priv->localUses++;
     remoteDriverUnlock(priv);
 
-    rv = virNetClientStreamSendPacket(privst,
-                                      priv->client,
-                                      VIR_NET_CONTINUE,
-                                      data,
-                                      nbytes);
+    /* Older servers reject packets above the legacy payload size,
+     * split up whatever the caller handed us for them */
+    do {
+        size_t len = nbytes - sent;
+
+        if (!priv->serverStreamLargePackets &&
+            len > VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX)
+            len = VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX;
+        else if (len > VIR_NET_MESSAGE_PAYLOAD_MAX)
+            len = VIR_NET_MESSAGE_PAYLOAD_MAX;
+
+        rv = virNetClientStreamSendPacket(privst,
+                                          priv->client,
+                                          VIR_NET_CONTINUE,
+                                          data + sent,
+                                          len);
+        if (rv < 0)
+            break;
+
+        sent += rv;
+        rv = sent;
+    } while (sent < nbytes);
 
     remoteDriverLock(priv);
     priv->localUses--;
@@ -6621,6 +7401,50 @@ remoteDomainOpenGraphicsFD(virDomainPtr dom,
 }
 
 
+static int
+remoteConnectOpenDomainStatsFD(virConnectPtr conn,
+                               unsigned int flags)
+{
+    int rv = -1;
+    remote_connect_open_domain_stats_fd_args args;
+    struct private_data *priv = conn->privateData;
+    int *fdout = NULL;
+    size_t fdoutlen = 0;
+
+    remoteDriverLock(priv);
+
+    args.flags = flags;
+
+    if (callFull(conn, priv, 0,
+                 NULL, 0,
+                 &fdout, &fdoutlen,
+                 REMOTE_PROC_CONNECT_OPEN_DOMAIN_STATS_FD,
+                 (xdrproc_t) xdr_remote_connect_open_domain_stats_fd_args, (char *) &args,
+                 (xdrproc_t) xdr_void, NULL) == -1)
+        goto done;
+
+    if (fdoutlen != 1) {
+        if (fdoutlen) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("too many file descriptors received"));
+            while (fdoutlen)
+                VIR_FORCE_CLOSE(fdout[--fdoutlen]);
+        } else {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("no file descriptor received"));
+        }
+        goto done;
+    }
+    rv = fdout[0];
+
+ done:
+    VIR_FREE(fdout);
+    remoteDriverUnlock(priv);
+
+    return rv;
+}
+
+
 static int
 remoteConnectSetKeepAlive(virConnectPtr conn, int interval, unsigned int count)
 {
@@ -6782,6 +7606,98 @@ call(virConnectPtr conn,
 }
 
 
+/*
+ * Issues @calls to the remote program, in a single round trip if the
+ * server supports batch calls, or one by one otherwise. The calls
+ * must not pass file descriptors nor open streams. The result of
+ * each call is stored in its rv field, together with the error if it
+ * failed. Returns -1 if the calls could not be issued at all.
+ */
+static int
+callBatch(virConnectPtr conn,
+          struct private_data *priv,
+          remoteBatchCall *calls,
+          size_t ncalls)
+{
+    remote_connect_call_batch_args args;
+    remote_connect_call_batch_ret ret;
+    g_autofree unsigned int *serials = NULL;
+    size_t i;
+    int rv = -1;
+
+    if (!priv->serverCallBatch) {
+        for (i = 0; i < ncalls; i++) {
+            calls[i].rv = call(conn, priv, 0, calls[i].proc_nr,
+                               calls[i].args_filter, calls[i].args,
+                               calls[i].ret_filter, calls[i].ret);
+            if (calls[i].rv < 0)
+                virErrorPreserveLast(&calls[i].error);
+        }
+        return 0;
+    }
+
+    if (ncalls > REMOTE_CALL_BATCH_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("too many calls in a batch: %zu > %d"),
+                       ncalls, REMOTE_CALL_BATCH_MAX);
+        return -1;
+    }
+
+    memset(&args, 0, sizeof(args));
+    memset(&ret, 0, sizeof(ret));
+
+    serials = g_new0(unsigned int, ncalls);
+    args.calls.calls_val = g_new0(remote_call_batch_packet, ncalls);
+
+    for (i = 0; i < ncalls; i++) {
+        remote_call_batch_packet *packet = args.calls.calls_val + i;
+        size_t len;
+
+        serials[i] = priv->counter++;
+        if (virNetClientProgramEncodeCall(priv->remoteProgram, serials[i],
+                                          calls[i].proc_nr,
+                                          calls[i].args_filter, calls[i].args,
+                                          &packet->data.data_val, &len) < 0)
+            goto cleanup;
+        packet->data.data_len = len;
+        args.calls.calls_len++;
+    }
+
+    if (call(conn, priv, 0, REMOTE_PROC_CONNECT_CALL_BATCH,
+             (xdrproc_t) xdr_remote_connect_call_batch_args, (char *) &args,
+             (xdrproc_t) xdr_remote_connect_call_batch_ret, (char *) &ret) == -1)
+        goto cleanup;
+
+    if (ret.replies.replies_len != ncalls) {
+        virReportError(VIR_ERR_RPC,
+                       _("batch call returned %u replies for %zu calls"),
+                       ret.replies.replies_len, ncalls);
+        goto cleanup;
+    }
+
+    for (i = 0; i < ncalls; i++) {
+        remote_call_batch_packet *reply = ret.replies.replies_val + i;
+
+        calls[i].rv = virNetClientProgramDecodeReply(priv->remoteProgram,
+                                                     serials[i],
+                                                     calls[i].proc_nr,
+                                                     reply->data.data_val,
+                                                     reply->data.data_len,
+                                                     calls[i].ret_filter,
+                                                     calls[i].ret);
+        if (calls[i].rv < 0)
+            virErrorPreserveLast(&calls[i].error);
+    }
+
+    rv = 0;
+
+ cleanup:
+    xdr_free((xdrproc_t) xdr_remote_connect_call_batch_args, (char *) &args);
+    xdr_free((xdrproc_t) xdr_remote_connect_call_batch_ret, (char *) &ret);
+    return rv;
+}
+
+
 static int
 remoteDomainGetInterfaceParameters(virDomainPtr domain,
                                    const char *device,
@@ -7333,6 +8249,151 @@ remoteDomainMigratePerform3Params(virDomainPtr dom,
 }
 
 
+static int
+remoteDomainListShutdown(virConnectPtr conn,
+                         virDomainPtr *doms,
+                         unsigned int ndoms,
+                         unsigned int timeout,
+                         unsigned int flags)
+{
+    int rv = -1;
+    size_t i;
+    remote_domain_list_shutdown_args args;
+    struct private_data *priv = conn->privateData;
+
+    remoteDriverLock(priv);
+
+    memset(&args, 0, sizeof(args));
+
+    if (ndoms > REMOTE_DOMAIN_LIST_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("too many domains: %u > %d"),
+                       ndoms, REMOTE_DOMAIN_LIST_MAX);
+        goto cleanup;
+    }
+
+    if (VIR_ALLOC_N(args.doms.doms_val, ndoms) < 0)
+        goto cleanup;
+    args.doms.doms_len = ndoms;
+
+    for (i = 0; i < ndoms; i++)
+        make_nonnull_domain(args.doms.doms_val + i, doms[i]);
+
+    args.timeout = timeout;
+    args.flags = flags;
+
+    if (call(conn, priv, 0, REMOTE_PROC_DOMAIN_LIST_SHUTDOWN,
+             (xdrproc_t) xdr_remote_domain_list_shutdown_args,
+             (char *) &args,
+             (xdrproc_t) xdr_void, (char *) NULL) == -1)
+        goto cleanup;
+
+    rv = 0;
+
+ cleanup:
+    VIR_FREE(args.doms.doms_val);
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+
+static int
+remoteDomainGetXMLDigest(virDomainPtr dom,
+                         unsigned long long *generation,
+                         char **digest,
+                         unsigned int flags)
+{
+    int rv = -1;
+    remote_domain_get_xml_digest_args args;
+    remote_domain_get_xml_digest_ret ret;
+    struct private_data *priv = dom->conn->privateData;
+
+    remoteDriverLock(priv);
+
+    make_nonnull_domain(&args.dom, dom);
+    args.flags = flags;
+
+    memset(&ret, 0, sizeof(ret));
+    if (call(dom->conn, priv, 0, REMOTE_PROC_DOMAIN_GET_XML_DIGEST,
+             (xdrproc_t) xdr_remote_domain_get_xml_digest_args,
+             (char *) &args,
+             (xdrproc_t) xdr_remote_domain_get_xml_digest_ret,
+             (char *) &ret) == -1)
+        goto done;
+
+    if (generation)
+        *generation = ret.generation;
+    if (digest)
+        *digest = ret.digest ? g_steal_pointer(ret.digest) : NULL;
+
+    rv = 0;
+    xdr_free((xdrproc_t) xdr_remote_domain_get_xml_digest_ret, (char *) &ret);
+
+ done:
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+
+static int
+remoteDomainListMigrate(virConnectPtr conn,
+                        virDomainPtr *doms,
+                        unsigned int ndoms,
+                        const char *dconnuri,
+                        virTypedParameterPtr params,
+                        int nparams,
+                        unsigned int flags)
+{
+    int rv = -1;
+    size_t i;
+    remote_domain_list_migrate_args args;
+    struct private_data *priv = conn->privateData;
+
+    remoteDriverLock(priv);
+
+    memset(&args, 0, sizeof(args));
+
+    if (ndoms > REMOTE_DOMAIN_LIST_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("too many domains: %u > %d"),
+                       ndoms, REMOTE_DOMAIN_LIST_MAX);
+        goto cleanup;
+    }
+
+    if (VIR_ALLOC_N(args.doms.doms_val, ndoms) < 0)
+        goto cleanup;
+    args.doms.doms_len = ndoms;
+
+    for (i = 0; i < ndoms; i++)
+        make_nonnull_domain(args.doms.doms_val + i, doms[i]);
+
+    args.dconnuri = (char *) dconnuri;
+    args.flags = flags;
+
+    if (virTypedParamsSerialize(params, nparams,
+                                REMOTE_DOMAIN_MIGRATE_PARAM_LIST_MAX,
+                                (virTypedParameterRemotePtr *) &args.params.params_val,
+                                &args.params.params_len,
+                                VIR_TYPED_PARAM_STRING_OKAY) < 0)
+        goto cleanup;
+
+    if (call(conn, priv, 0, REMOTE_PROC_DOMAIN_LIST_MIGRATE,
+             (xdrproc_t) xdr_remote_domain_list_migrate_args,
+             (char *) &args,
+             (xdrproc_t) xdr_void, (char *) NULL) == -1)
+        goto cleanup;
+
+    rv = 0;
+
+ cleanup:
+    virTypedParamsRemoteFree((virTypedParameterRemotePtr) args.params.params_val,
+                             args.params.params_len);
+    VIR_FREE(args.doms.doms_val);
+    remoteDriverUnlock(priv);
+    return rv;
+}
+
+
 static virDomainPtr
 remoteDomainMigrateFinish3Params(virConnectPtr dconn,
                                  virTypedParameterPtr params,
@@ -7711,6 +8772,265 @@ remoteNetworkGetDHCPLeases(virNetworkPtr net,
 }
 
 
+static void
+remoteStatsCompactSampleFree(void *opaque)
+{
+    virTypedParamListFree(opaque);
+}
+
+
+/* Must be called with priv->statsLock held */
+static void
+remoteStatsCompactReset(struct private_data *priv)
+{
+    virStringListFreeCount(priv->statsKeys, priv->nstatsKeys);
+    priv->statsKeys = NULL;
+    priv->nstatsKeys = 0;
+    virHashFree(priv->statsSamples);
+    priv->statsSamples = NULL;
+    priv->statsSerial = 0;
+}
+
+
+static int
+remoteStatsCompactDecodeParams(struct private_data *priv,
+                               remote_domain_stats_compact_record *rec,
+                               virTypedParamListPtr list)
+{
+    size_t i;
+
+    if (rec->params.params_len > REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("too many parameters '%u' for limit '%d'"),
+                       rec->params.params_len,
+                       REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX);
+        return -1;
+    }
+
+    for (i = 0; i < rec->params.params_len; i++) {
+        remote_domain_stats_compact_param *val = rec->params.params_val + i;
+        virTypedParameterPtr param;
+
+        if (val->key >= priv->nstatsKeys) {
+            virReportError(VIR_ERR_RPC,
+                           _("unknown stats key index '%u'"), val->key);
+            return -1;
+        }
+
+        if (VIR_RESIZE_N(list->par, list->par_alloc, list->npar, 1) < 0)
+            return -1;
+        param = list->par + list->npar;
+
+        if (virStrcpyStatic(param->field, priv->statsKeys[val->key]) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Parameter %s too big for destination"),
+                           priv->statsKeys[val->key]);
+            return -1;
+        }
+
+        param->type = val->value.type;
+        switch (param->type) {
+        case VIR_TYPED_PARAM_INT:
+            param->value.i = val->value.remote_typed_param_value_u.i;
+            break;
+        case VIR_TYPED_PARAM_UINT:
+            param->value.ui = val->value.remote_typed_param_value_u.ui;
+            break;
+        case VIR_TYPED_PARAM_LLONG:
+            param->value.l = val->value.remote_typed_param_value_u.l;
+            break;
+        case VIR_TYPED_PARAM_ULLONG:
+            param->value.ul = val->value.remote_typed_param_value_u.ul;
+            break;
+        case VIR_TYPED_PARAM_DOUBLE:
+            param->value.d = val->value.remote_typed_param_value_u.d;
+            break;
+        case VIR_TYPED_PARAM_BOOLEAN:
+            param->value.b = val->value.remote_typed_param_value_u.b;
+            break;
+        case VIR_TYPED_PARAM_STRING:
+            param->value.s = g_strdup(val->value.remote_typed_param_value_u.s);
+            break;
+        default:
+            virReportError(VIR_ERR_RPC, _("unknown parameter type: %d"),
+                           param->type);
+            return -1;
+        }
+        list->npar++;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Counterpart of remoteDispatchConnectGetAllDomainStatsCompact. Any
+ * failure drops the whole compact state so that the next call starts
+ * over with the full dictionary and full records.
+ */
+static int
+remoteConnectGetAllDomainStatsCompact(virConnectPtr conn,
+                                      virDomainPtr *doms,
+                                      unsigned int ndoms,
+                                      unsigned int stats,
+                                      virDomainStatsRecordPtr **retStats,
+                                      unsigned int flags)
+{
+    struct private_data *priv = conn->privateData;
+    int rv = -1;
+    size_t i;
+    remote_connect_get_all_domain_stats_compact_args args;
+    remote_connect_get_all_domain_stats_compact_ret ret;
+    virDomainStatsRecordPtr elem = NULL;
+    virDomainStatsRecordPtr *tmpret = NULL;
+    g_autoptr(virHashTable) samples = NULL;
+
+    memset(&args, 0, sizeof(args));
+    memset(&ret, 0, sizeof(ret));
+
+    virMutexLock(&priv->statsLock);
+
+    if (ndoms) {
+        if (VIR_ALLOC_N(args.doms.doms_val, ndoms) < 0)
+            goto cleanup;
+
+        for (i = 0; i < ndoms; i++)
+            make_nonnull_domain(args.doms.doms_val + i, doms[i]);
+    }
+    args.doms.doms_len = ndoms;
+
+    args.stats = stats;
+    args.flags = flags;
+    args.nkeys = priv->nstatsKeys;
+    args.serial = priv->statsSerial;
+
+    remoteDriverLock(priv);
+    if (call(conn, priv, 0, REMOTE_PROC_CONNECT_GET_ALL_DOMAIN_STATS_COMPACT,
+             (xdrproc_t)xdr_remote_connect_get_all_domain_stats_compact_args, (char *)&args,
+             (xdrproc_t)xdr_remote_connect_get_all_domain_stats_compact_ret, (char *)&ret) == -1) {
+        remoteDriverUnlock(priv);
+        goto cleanup;
+    }
+    remoteDriverUnlock(priv);
+
+    if (ret.retStats.retStats_len > REMOTE_DOMAIN_LIST_MAX) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Number of stats entries is %d, which exceeds max limit: %d"),
+                       ret.retStats.retStats_len, REMOTE_DOMAIN_LIST_MAX);
+        goto cleanup;
+    }
+
+    if (ret.key_base != 0 && ret.key_base != priv->nstatsKeys) {
+        virReportError(VIR_ERR_RPC,
+                       _("unexpected stats key base '%u'"), ret.key_base);
+        goto cleanup;
+    }
+
+    if (ret.key_base == 0) {
+        virStringListFreeCount(priv->statsKeys, priv->nstatsKeys);
+        priv->statsKeys = NULL;
+        priv->nstatsKeys = 0;
+    }
+
+    if (ret.keys.keys_len > REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX ||
+        priv->nstatsKeys + ret.keys.keys_len > REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX) {
+        virReportError(VIR_ERR_RPC, "%s", _("too many stats keys"));
+        goto cleanup;
+    }
+
+    if (VIR_EXPAND_N(priv->statsKeys, priv->nstatsKeys, ret.keys.keys_len) < 0)
+        goto cleanup;
+    for (i = 0; i < ret.keys.keys_len; i++) {
+        size_t idx = priv->nstatsKeys - ret.keys.keys_len + i;
+        priv->statsKeys[idx] = g_steal_pointer(&ret.keys.keys_val[i]);
+    }
+
+    if (!(samples = virHashNew(remoteStatsCompactSampleFree)))
+        goto cleanup;
+
+    *retStats = NULL;
+
+    if (VIR_ALLOC_N(tmpret, ret.retStats.retStats_len + 1) < 0)
+        goto cleanup;
+
+    for (i = 0; i < ret.retStats.retStats_len; i++) {
+        remote_domain_stats_compact_record *rec = ret.retStats.retStats_val + i;
+        g_autoptr(virTypedParamList) sample = NULL;
+        g_autoptr(virTypedParamList) changed = NULL;
+        g_autofree size_t *removed = NULL;
+        char uuidstr[VIR_UUID_STRING_BUFLEN];
+        size_t j;
+
+        if (VIR_ALLOC(elem) < 0)
+            goto cleanup;
+
+        if (!(elem->dom = get_nonnull_domain(conn, rec->dom)))
+            goto cleanup;
+
+        virUUIDFormat(elem->dom->uuid, uuidstr);
+
+        if (rec->delta) {
+            if (!priv->statsSamples ||
+                !(sample = virHashSteal(priv->statsSamples, uuidstr))) {
+                virReportError(VIR_ERR_RPC,
+                               _("missing previous stats sample of domain '%s'"),
+                               rec->dom.name);
+                goto cleanup;
+            }
+
+            changed = g_new0(virTypedParamList, 1);
+            removed = g_new0(size_t, rec->removed.removed_len);
+            for (j = 0; j < rec->removed.removed_len; j++)
+                removed[j] = rec->removed.removed_val[j];
+
+            if (remoteStatsCompactDecodeParams(priv, rec, changed) < 0 ||
+                virTypedParamsPatch(sample, changed->par, changed->npar,
+                                    removed, rec->removed.removed_len) < 0)
+                goto cleanup;
+        } else {
+            sample = g_new0(virTypedParamList, 1);
+
+            if (remoteStatsCompactDecodeParams(priv, rec, sample) < 0)
+                goto cleanup;
+        }
+
+        if (virTypedParamsCopy(&elem->params, sample->par, sample->npar) < 0)
+            goto cleanup;
+        elem->nparams = sample->npar;
+
+        if (virHashUpdateEntry(samples, uuidstr, sample) < 0)
+            goto cleanup;
+        sample = NULL;
+
+        tmpret[i] = elem;
+        elem = NULL;
+    }
+
+    virHashFree(priv->statsSamples);
+    priv->statsSamples = g_steal_pointer(&samples);
+    priv->statsSerial = ret.serial;
+
+    *retStats = tmpret;
+    tmpret = NULL;
+    rv = ret.retStats.retStats_len;
+
+ cleanup:
+    if (rv < 0)
+        remoteStatsCompactReset(priv);
+    virMutexUnlock(&priv->statsLock);
+    if (elem) {
+        virObjectUnref(elem->dom);
+        VIR_FREE(elem);
+    }
+    virDomainStatsRecordListFree(tmpret);
+    VIR_FREE(args.doms.doms_val);
+    xdr_free((xdrproc_t)xdr_remote_connect_get_all_domain_stats_compact_ret,
+             (char *) &ret);
+
+    return rv;
+}
+
+
 static int
 remoteConnectGetAllDomainStats(virConnectPtr conn,
                                virDomainPtr *doms,
@@ -7727,6 +9047,10 @@ remoteConnectGetAllDomainStats(virConnectPtr conn,
     virDomainStatsRecordPtr elem = NULL;
     virDomainStatsRecordPtr *tmpret = NULL;
 
+    if (priv->compactStats)
+        return remoteConnectGetAllDomainStatsCompact(conn, doms, ndoms, stats,
+                                                     retStats, flags);
+
     memset(&args, 0, sizeof(args));
 
     if (ndoms) {
@@ -8684,6 +10008,13 @@ static virHypervisorDriver hypervisor_driver = {
     .domainAgentSetResponseTimeout = remoteDomainAgentSetResponseTimeout, /* 5.10.0 */
     .domainBackupBegin = remoteDomainBackupBegin, /* 6.0.0 */
     .domainBackupGetXMLDesc = remoteDomainBackupGetXMLDesc, /* 6.0.0 */
+    .domainMigrateTunnelChannel = remoteDomainMigrateTunnelChannel, /* 6.7.0 */
+    .domainListMigrate = remoteDomainListMigrate, /* 6.7.0 */
+    .domainAttachDevices = remoteDomainAttachDevices, /* 6.7.0 */
+    .domainDetachDevices = remoteDomainDetachDevices, /* 6.7.0 */
+    .connectOpenDomainStatsFD = remoteConnectOpenDomainStatsFD, /* 6.7.0 */
+    .domainListShutdown = remoteDomainListShutdown, /* 6.7.0 */
+    .domainGetXMLDigest = remoteDomainGetXMLDigest, /* 6.7.0 */
 };
 
 static virNetworkDriver network_driver = {
@@ -280,6 +280,12 @@ const REMOTE_DOMAIN_GUEST_INFO_PARAMS_MAX = 2048;
  */
 const REMOTE_NETWORK_PORT_PARAMETERS_MAX = 16;
 
+/* Upper limit on number of calls embedded in a single batch */
+const REMOTE_CALL_BATCH_MAX = 256;
+
+/* Upper limit on size of a single call or reply packet in a batch */
+const REMOTE_CALL_BATCH_PACKET_MAX = 4194304;
+
 
 /* UUID.  VIR_UUID_BUFLEN definition comes from libvirt.h */
 typedef opaque remote_uuid[VIR_UUID_BUFLEN];
@@ -3111,6 +3117,19 @@ struct remote_domain_migrate_prepare_tunnel3_params_ret {
     opaque cookie_out<REMOTE_MIGRATE_COOKIE_MAX>;
 };
 
+struct remote_domain_migrate_tunnel_channel_args {
+    remote_nonnull_domain dom;
+    unsigned int channel;
+    unsigned int flags;
+};
+
+struct remote_domain_list_migrate_args {
+    remote_nonnull_domain doms<REMOTE_DOMAIN_LIST_MAX>;
+    remote_nonnull_string dconnuri;
+    remote_typed_param params<REMOTE_DOMAIN_MIGRATE_PARAM_LIST_MAX>;
+    unsigned int flags;
+};
+
 struct remote_domain_migrate_perform3_params_args {
     remote_nonnull_domain dom;
     remote_string dconnuri;
@@ -3359,6 +3378,39 @@ struct remote_connect_get_all_domain_stats_ret {
     remote_domain_stats_record retStats<REMOTE_DOMAIN_LIST_MAX>;
 };
 
+/* Compact variant of remote_connect_get_all_domain_stats. Parameter
+ * names are replaced by indexes into a per-connection key dictionary
+ * which the server only sends once. Records may be deltas against the
+ * previous sample the client decoded: integer values are then
+ * differences, unchanged parameters are omitted and @removed lists
+ * indexes of parameters of the previous sample which went away. */
+struct remote_domain_stats_compact_param {
+    unsigned int key;
+    remote_typed_param_value value;
+};
+
+struct remote_domain_stats_compact_record {
+    remote_nonnull_domain dom;
+    int delta;
+    remote_domain_stats_compact_param params<REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX>;
+    unsigned int removed<REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX>;
+};
+
+struct remote_connect_get_all_domain_stats_compact_args {
+    remote_nonnull_domain doms<REMOTE_DOMAIN_LIST_MAX>;
+    unsigned int stats;
+    unsigned int flags;
+    unsigned int nkeys;         /* dictionary keys known to the client */
+    unsigned hyper serial;      /* last sample decoded by the client, 0 if none */
+};
+
+struct remote_connect_get_all_domain_stats_compact_ret {
+    unsigned int key_base;      /* index of keys[0], either 0 or args.nkeys */
+    remote_nonnull_string keys<REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX>;
+    unsigned hyper serial;
+    remote_domain_stats_compact_record retStats<REMOTE_DOMAIN_LIST_MAX>;
+};
+
 struct remote_domain_fsinfo {
     remote_nonnull_string mountpoint;
     remote_nonnull_string name;
@@ -3427,6 +3479,34 @@ struct remote_domain_event_callback_job_completed_msg {
     remote_typed_param params<REMOTE_DOMAIN_JOB_STATS_MAX>;
 };
 
+struct remote_connect_set_pipeline_depth_args {
+    unsigned int depth;
+    unsigned int flags;
+};
+
+struct remote_connect_set_pipeline_depth_ret {
+    unsigned int depth;
+};
+
+struct remote_call_batch_packet {
+    opaque data<REMOTE_CALL_BATCH_PACKET_MAX>;
+};
+
+struct remote_connect_call_batch_args {
+    remote_call_batch_packet calls<REMOTE_CALL_BATCH_MAX>;
+    unsigned int flags;
+};
+
+struct remote_connect_call_batch_ret {
+    remote_call_batch_packet replies<REMOTE_CALL_BATCH_MAX>;
+};
+
+struct remote_domain_event_callback_stats_msg {
+    int callbackID;
+    remote_nonnull_domain dom;
+    remote_typed_param params<REMOTE_CONNECT_GET_ALL_DOMAIN_STATS_MAX>;
+};
+
 struct remote_domain_migrate_start_post_copy_args {
     remote_nonnull_domain dom;
     unsigned int flags;
@@ -3771,6 +3851,38 @@ struct remote_domain_backup_get_xml_desc_ret {
     remote_nonnull_string xml;
 };
 
+struct remote_domain_attach_devices_args {
+    remote_nonnull_domain dom;
+    remote_nonnull_string xml;
+    unsigned int flags;
+};
+
+struct remote_domain_detach_devices_args {
+    remote_nonnull_domain dom;
+    remote_nonnull_string xml;
+    unsigned int flags;
+};
+
+struct remote_connect_open_domain_stats_fd_args {
+    unsigned int flags;
+};
+
+struct remote_domain_list_shutdown_args {
+    remote_nonnull_domain doms<REMOTE_DOMAIN_LIST_MAX>;
+    unsigned int timeout;
+    unsigned int flags;
+};
+
+struct remote_domain_get_xml_digest_args {
+    remote_nonnull_domain dom;
+    unsigned int flags;
+};
+
+struct remote_domain_get_xml_digest_ret {
+    unsigned hyper generation;
+    remote_string digest;
+};
+
 /*----- Protocol. -----*/
 
 /* Define the program number, protocol version and procedure numbers here. */
@@ -3795,7 +3907,7 @@ enum remote_procedure {
      *   <paramnumber> specifies at which offset the stream parameter is inserted
      *   in the function parameter list.
      *
-     * - @priority: low|high
+     * - @priority: low|high|fast|long
      *
      *   Each API that might eventually access hypervisor's monitor (and thus
      *   block) MUST fall into low priority. However, there are some exceptions
@@ -3803,6 +3915,12 @@ enum remote_procedure {
      *   priority. If in doubt, it's safe to choose low. Low is taken as default,
      *   and thus can be left out.
      *
+     *   APIs that are low priority but usually finish quickly without
+     *   changing anything MAY be marked as fast, letting them run ahead of
+     *   other queued low priority calls. APIs that usually take a long time,
+     *   like saving or migrating a domain, SHOULD be marked as long, which
+     *   keeps them from occupying more than half of the worker threads.
+     *
      * - @acl: <object>:<permission>
      * - @acl: <object>:<permission>:<flagname>
      *
@@ -3912,7 +4030,8 @@ enum remote_procedure {
     REMOTE_PROC_DOMAIN_DETACH_DEVICE = 13,
 
     /**
-     * @generate: both
+     * @generate: server
+     * @priority: fast
      * @acl: domain:read
      * @acl: domain:read_secure:VIR_DOMAIN_XML_SECURE
      * @acl: domain:read_secure:VIR_DOMAIN_XML_MIGRATABLE
@@ -3927,7 +4046,7 @@ enum remote_procedure {
     REMOTE_PROC_DOMAIN_GET_AUTOSTART = 15,
 
     /**
-     * @generate: both
+     * @generate: server
      * @acl: domain:read
      */
     REMOTE_PROC_DOMAIN_GET_INFO = 16,
@@ -3969,21 +4088,21 @@ enum remote_procedure {
     REMOTE_PROC_CONNECT_LIST_DEFINED_DOMAINS = 21,
 
     /**
-     * @generate: both
+     * @generate: server
      * @priority: high
      * @acl: domain:getattr
      */
     REMOTE_PROC_DOMAIN_LOOKUP_BY_ID = 22,
 
     /**
-     * @generate: both
+     * @generate: server
      * @priority: high
      * @acl: domain:getattr
      */
     REMOTE_PROC_DOMAIN_LOOKUP_BY_NAME = 23,
 
     /**
-     * @generate: both
+     * @generate: server
      * @priority: high
      * @acl: domain:getattr
      */
@@ -4188,12 +4307,14 @@ enum remote_procedure {
 
     /**
      * @generate: both
+     * @priority: long
      * @acl: domain:core_dump
      */
     REMOTE_PROC_DOMAIN_CORE_DUMP = 53,
 
     /**
      * @generate: both
+     * @priority: long
      * @acl: domain:start
      * @acl: domain:write
      */
@@ -4201,6 +4322,7 @@ enum remote_procedure {
 
     /**
      * @generate: both
+     * @priority: long
      * @acl: domain:hibernate
      */
     REMOTE_PROC_DOMAIN_SAVE = 55,
@@ -4233,6 +4355,7 @@ enum remote_procedure {
     /**
      * @generate: client
      * @priority: high
+     * @batch: yes
      * @acl: connect:getattr
      */
     REMOTE_PROC_CONNECT_SUPPORTS_FEATURE = 60,
@@ -5081,6 +5204,7 @@ enum remote_procedure {
 
     /**
      * @generate: both
+     * @priority: long
      * @acl: domain:hibernate
      */
     REMOTE_PROC_DOMAIN_MANAGED_SAVE = 182,
@@ -5315,6 +5439,7 @@ enum remote_procedure {
 
     /**
      * @generate: none
+     * @priority: long
      * @acl: domain:migrate
      */
     REMOTE_PROC_DOMAIN_MIGRATE_PERFORM3 = 216,
@@ -5419,12 +5544,14 @@ enum remote_procedure {
 
     /**
      * @generate: both
+     * @priority: long
      * @acl: domain:hibernate
      */
     REMOTE_PROC_DOMAIN_SAVE_FLAGS = 232,
 
     /**
      * @generate: both
+     * @priority: long
      * @acl: domain:start
      * @acl: domain:write
      */
@@ -5904,6 +6031,7 @@ enum remote_procedure {
 
     /**
      * @generate: none
+     * @priority: long
      * @acl: domain:migrate
      */
     REMOTE_PROC_DOMAIN_MIGRATE_PERFORM3_PARAMS = 305,
@@ -6087,6 +6215,7 @@ enum remote_procedure {
 
     /**
      * @generate: both
+     * @priority: long
      * @acl: domain:core_dump
      */
     REMOTE_PROC_DOMAIN_CORE_DUMP_WITH_FORMAT = 334,
@@ -6664,5 +6793,80 @@ enum remote_procedure {
      * @priority: high
      * @acl: domain:read
      */
-    REMOTE_PROC_DOMAIN_BACKUP_GET_XML_DESC = 422
+    REMOTE_PROC_DOMAIN_BACKUP_GET_XML_DESC = 422,
+
+    /**
+     * @generate: both
+     * @acl: none
+     */
+    REMOTE_PROC_DOMAIN_EVENT_CALLBACK_STATS = 423,
+
+    /**
+     * @generate: none
+     * @acl: none
+     */
+    REMOTE_PROC_CONNECT_GET_ALL_DOMAIN_STATS_COMPACT = 424,
+
+    /**
+     * @generate: none
+     * @priority: high
+     * @acl: none
+     */
+    REMOTE_PROC_CONNECT_SET_PIPELINE_DEPTH = 425,
+
+    /**
+     * @generate: none
+     * @acl: none
+     */
+    REMOTE_PROC_CONNECT_CALL_BATCH = 426,
+
+    /**
+     * @generate: both
+     * @writestream: 1
+     * @acl: domain:migrate
+     */
+    REMOTE_PROC_DOMAIN_MIGRATE_TUNNEL_CHANNEL = 427,
+
+    /**
+     * @generate: none
+     * @priority: long
+     * @acl: connect:getattr
+     */
+    REMOTE_PROC_DOMAIN_LIST_MIGRATE = 428,
+
+    /**
+     * @generate: both
+     * @acl: domain:write
+     * @acl: domain:save:!VIR_DOMAIN_AFFECT_CONFIG|VIR_DOMAIN_AFFECT_LIVE
+     * @acl: domain:save:VIR_DOMAIN_AFFECT_CONFIG
+     */
+    REMOTE_PROC_DOMAIN_ATTACH_DEVICES = 429,
+
+    /**
+     * @generate: both
+     * @acl: domain:write
+     * @acl: domain:save:!VIR_DOMAIN_AFFECT_CONFIG|VIR_DOMAIN_AFFECT_LIVE
+     * @acl: domain:save:VIR_DOMAIN_AFFECT_CONFIG
+     */
+    REMOTE_PROC_DOMAIN_DETACH_DEVICES = 430,
+
+    /**
+     * @generate: none
+     * @acl: connect:search_domains
+     * @acl: connect:read
+     */
+    REMOTE_PROC_CONNECT_OPEN_DOMAIN_STATS_FD = 431,
+
+    /**
+     * @generate: none
+     * @priority: long
+     * @acl: connect:getattr
+     */
+    REMOTE_PROC_DOMAIN_LIST_SHUTDOWN = 432,
+
+    /**
+     * @generate: none
+     * @acl: domain:read
+     */
+    REMOTE_PROC_DOMAIN_GET_XML_DIGEST = 433
 };
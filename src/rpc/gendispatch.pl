@@ -362,13 +362,17 @@ while (<PROTOCOL>) {
         $calls{$name}->{acl} = $opts{acl};
         $calls{$name}->{aclfilter} = $opts{aclfilter};
 
-        # for now, we distinguish only two levels of priority:
-        # low (0) and high (1)
+        # the priority is the thread pool job class the call is
+        # processed as: low (0), high (1), fast (2) or long (3)
         if (exists $opts{priority}) {
             if ($opts{priority} eq "high") {
                 $calls{$name}->{priority} = 1;
             } elsif ($opts{priority} eq "low") {
                 $calls{$name}->{priority} = 0;
+            } elsif ($opts{priority} eq "fast") {
+                $calls{$name}->{priority} = 2;
+            } elsif ($opts{priority} eq "long") {
+                $calls{$name}->{priority} = 3;
             } else {
                 die "\@priority annotation value '$opts{priority}' invalid for $constname"
             }
@@ -376,6 +380,23 @@ while (<PROTOCOL>) {
             $calls{$name}->{priority} = 0;
         }
 
+        # procedures with a generated server side which don't create
+        # a stream can be safely embedded in a batch call
+        if (exists $opts{batch}) {
+            if ($opts{batch} eq "yes") {
+                $calls{$name}->{batch} = 1;
+            } elsif ($opts{batch} eq "no") {
+                $calls{$name}->{batch} = 0;
+            } else {
+                die "\@batch annotation value '$opts{batch}' invalid for $constname"
+            }
+        } elsif ($opts{generate} =~ /^(both|server)$/ &&
+                 $calls{$name}->{streamflag} eq "none") {
+            $calls{$name}->{batch} = 1;
+        } else {
+            $calls{$name}->{batch} = 0;
+        }
+
         $calls[$id] = $calls{$name};
 
         $collect_args_members = 0;
@@ -1266,7 +1287,7 @@ elsif ($mode eq "server") {
 
     print "virNetServerProgramProc ${structprefix}Procs[] = {\n";
     for ($id = 0 ; $id <= $#calls ; $id++) {
-        my ($comment, $name, $argtype, $arglen, $argfilter, $retlen, $retfilter, $priority);
+        my ($comment, $name, $argtype, $arglen, $argfilter, $retlen, $retfilter, $priority, $batch);
 
         if (defined $calls[$id] && !$calls[$id]->{msg}) {
             $comment = "/* Method $calls[$id]->{ProcName} => $id */";
@@ -1290,8 +1311,9 @@ elsif ($mode eq "server") {
         }
 
     $priority = defined $calls[$id]->{priority} ? $calls[$id]->{priority} : 0;
+    $batch = defined $calls[$id]->{batch} && $calls[$id]->{batch} ? "true" : "false";
 
-        print "{ $comment\n   ${name},\n   $arglen,\n   (xdrproc_t)$argfilter,\n   $retlen,\n   (xdrproc_t)$retfilter,\n   true,\n   $priority\n},\n";
+        print "{ $comment\n   ${name},\n   $arglen,\n   (xdrproc_t)$argfilter,\n   $retlen,\n   (xdrproc_t)$retfilter,\n   true,\n   $priority,\n   $batch\n},\n";
     }
     print "};\n";
     print "size_t ${structprefix}NProcs = G_N_ELEMENTS(${structprefix}Procs);\n";
@@ -2092,6 +2114,9 @@ elsif ($mode eq "client") {
             }
             if (defined $call->{aclfilter}) {
                 print $apiname . "CheckACL;\n";
+                if (&acl_list_supported($call)) {
+                    print $apiname . "CheckACLList;\n";
+                }
             }
             print $apiname . "EnsureACL;\n";
         } elsif ($mode eq "aclapi") {
@@ -2100,6 +2125,69 @@ elsif ($mode eq "client") {
             &generate_acl($call, $call->{acl}, "Ensure");
             if (defined $call->{aclfilter}) {
                 &generate_acl($call, $call->{aclfilter}, "Check");
+                if (&acl_list_supported($call)) {
+                    &generate_acl_list($call, $call->{aclfilter});
+                }
+            }
+        }
+
+        # Filters of the APIs listing all domains additionally get a
+        # variant checking all the domains at once
+        sub acl_list_supported {
+            my $call = shift;
+            my $acl = $call->{aclfilter};
+
+            return 0 unless $call->{ProcName} =~ /^Connect(ListAllDomains|GetAllDomainStats)$/;
+            return 0 if $#{$acl} != 0;
+
+            my @bits = split /:/, $acl->[0];
+            return $bits[0] eq "domain" && !defined $bits[2];
+        }
+
+        sub generate_acl_list {
+            my $call = shift;
+            my $acl = shift;
+
+            my @bits = split /:/, $acl->[0];
+
+            my $apiname = $prefix . $call->{ProcName};
+            if ($structprefix eq "qemu") {
+                $apiname =~ s/(vir(Connect)?Domain)/${1}Qemu/;
+            } elsif ($structprefix eq "lxc") {
+                $apiname =~ s/virDomain/virDomainLxc/;
+            }
+            $apiname .= "CheckACLList";
+
+            my @argdecls = ("$connect_ptr conn",
+                            "virDomainDefPtr *domains",
+                            "size_t ndomains",
+                            "virBitmapPtr allowed");
+
+            if ($mode eq "aclheader") {
+                print "extern int $apiname(" . join(", ", @argdecls) . ");\n";
+            } else {
+                my $perm = "vir_access_perm_" . $bits[0] . "_" . $bits[1];
+                $perm =~ tr/a-z/A-Z/;
+
+                print "/* Returns: -1 on error, 0 with the bits of allowed domains set in allowed */\n";
+                print "int $apiname(" . join(", ", @argdecls) . ")\n";
+                print "{\n";
+                print "    virAccessManagerPtr mgr;\n";
+                print "    int rv;\n";
+                print "\n";
+                print "    if (!(mgr = virAccessManagerGetDefault())) {\n";
+                print "        virResetLastError();\n";
+                print "        return -1;\n";
+                print "    }\n";
+                print "\n";
+                print "    rv = virAccessManagerCheckDomainList(mgr, conn->driver->name,\n";
+                print "                                         domains, ndomains,\n";
+                print "                                         $perm, allowed);\n";
+                print "    virObjectUnref(mgr);\n";
+                print "    if (rv < 0)\n";
+                print "        virResetLastError();\n";
+                print "    return rv;\n";
+                print "}\n\n";
             }
         }
 
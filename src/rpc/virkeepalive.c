@@ -114,6 +114,7 @@ virKeepAliveTimerInternal(virKeepAlivePtr ka,
                           virNetMessagePtr *msg)
 {
     time_t now = time(NULL);
+    time_t lag;
     int timeval;
 
     if (ka->interval <= 0 || ka->intervalStart == 0)
@@ -130,6 +131,22 @@ virKeepAliveTimerInternal(virKeepAlivePtr ka,
           "ka=%p client=%p countToDeath=%d idle=%d",
           ka, ka->client, ka->countToDeath, timeval);
 
+    /* The timer fires once per interval. If it fires another interval
+     * late, the thread running it, usually the main event loop, was
+     * blocked and so was reading from the peer. Any response the peer
+     * sent is likely still waiting in the socket, so the missed
+     * interval is not counted against it. */
+    lag = now - ka->intervalStart - ka->interval;
+    if (lag >= ka->interval) {
+        VIR_WARN("Keepalive timer for client %p is %lld seconds late, "
+                 "not counting the missed response",
+                 ka->client, (long long) lag);
+        ka->intervalStart = now;
+        *msg = virKeepAliveMessage(ka, KEEPALIVE_PROC_PING);
+        virEventUpdateTimeout(ka->timer, ka->interval * 1000);
+        return false;
+    }
+
     if (ka->countToDeath == 0) {
         VIR_DEBUG("No response from client %p after %d keepalive messages "
                   "in %d seconds",
@@ -1103,7 +1103,7 @@ virNetClientCallDispatchReply(virNetClientPtr client)
         return -1;
     }
 
-    if (VIR_REALLOC_N(thecall->msg->buffer, client->msg.bufferLength) < 0)
+    if (virNetMessageReserveBuffer(thecall->msg, client->msg.bufferLength) < 0)
         return -1;
 
     memcpy(thecall->msg->buffer, client->msg.buffer, client->msg.bufferLength);
@@ -1304,9 +1304,10 @@ virNetClientIOWriteMessage(virNetClientPtr client,
     ssize_t ret = 0;
 
     if (thecall->msg->bufferOffset < thecall->msg->bufferLength) {
-        ret = virNetSocketWrite(client->sock,
-                                thecall->msg->buffer + thecall->msg->bufferOffset,
-                                thecall->msg->bufferLength - thecall->msg->bufferOffset);
+        GOutputVector vec[2];
+        size_t nvec = virNetMessageGetOutputVector(thecall->msg, vec);
+
+        ret = virNetSocketWriteVector(client->sock, vec, nvec);
         if (ret <= 0)
             return ret;
 
@@ -398,3 +398,136 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
     }
     return -1;
 }
+
+
+/**
+ * virNetClientProgramEncodeCall:
+ * @prog: the program to call
+ * @serial: serial number of the call
+ * @proc: procedure to call
+ * @args_filter: XDR filter for @args
+ * @args: arguments of the call
+ * @packet: filled with the encoded call packet
+ * @packetlen: filled with the size of @packet
+ *
+ * Encodes a method call into a complete packet, as it would be sent
+ * on the wire, without sending it. This is used to embed calls into
+ * a batch call. The caller must free @packet.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int virNetClientProgramEncodeCall(virNetClientProgramPtr prog,
+                                  unsigned serial,
+                                  int proc,
+                                  xdrproc_t args_filter, void *args,
+                                  char **packet,
+                                  size_t *packetlen)
+{
+    virNetMessagePtr msg;
+    int ret = -1;
+
+    if (!(msg = virNetMessageNew(false)))
+        return -1;
+
+    msg->header.prog = prog->program;
+    msg->header.vers = prog->version;
+    msg->header.status = VIR_NET_OK;
+    msg->header.type = VIR_NET_CALL;
+    msg->header.serial = serial;
+    msg->header.proc = proc;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (virNetMessageEncodePayload(msg, args_filter, args) < 0)
+        goto cleanup;
+
+    *packet = g_steal_pointer(&msg->buffer);
+    *packetlen = msg->bufferLength;
+    ret = 0;
+
+ cleanup:
+    virNetMessageFree(msg);
+    return ret;
+}
+
+
+/**
+ * virNetClientProgramDecodeReply:
+ * @prog: the program which was called
+ * @serial: serial number of the call
+ * @proc: procedure which was called
+ * @packet: the reply packet
+ * @packetlen: size of @packet
+ * @ret_filter: XDR filter for @ret
+ * @ret: filled with the return value of the call
+ *
+ * Decodes a reply packet which was returned as part of a batch call
+ * reply. If the call failed on the server, the error it sent is
+ * reported.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int virNetClientProgramDecodeReply(virNetClientProgramPtr prog,
+                                   unsigned serial,
+                                   int proc,
+                                   const char *packet,
+                                   size_t packetlen,
+                                   xdrproc_t ret_filter, void *ret)
+{
+    virNetMessagePtr msg;
+    int rv = -1;
+
+    if (!(msg = virNetMessageNew(false)))
+        return -1;
+
+    if (packetlen < VIR_NET_MESSAGE_LEN_MAX ||
+        packetlen > VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX) {
+        virReportError(VIR_ERR_RPC,
+                       _("Unexpected batched reply size %zu"), packetlen);
+        goto cleanup;
+    }
+
+    if (virNetMessageReserveBuffer(msg, packetlen) < 0)
+        goto cleanup;
+    memcpy(msg->buffer, packet, packetlen);
+    msg->bufferLength = packetlen;
+
+    if (virNetMessageDecodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (!virNetClientProgramMatches(prog, msg) ||
+        msg->header.type != VIR_NET_REPLY ||
+        msg->header.proc != proc ||
+        msg->header.serial != serial) {
+        virReportError(VIR_ERR_RPC,
+                       _("Unexpected batched reply prog=%x vers=%x type=%d "
+                         "proc=%d serial=%u"),
+                       msg->header.prog, msg->header.vers, msg->header.type,
+                       msg->header.proc, msg->header.serial);
+        goto cleanup;
+    }
+
+    switch (msg->header.status) {
+    case VIR_NET_OK:
+        if (virNetMessageDecodePayload(msg, ret_filter, ret) < 0)
+            goto cleanup;
+        break;
+
+    case VIR_NET_ERROR:
+        virNetClientProgramDispatchError(prog, msg);
+        goto cleanup;
+
+    case VIR_NET_CONTINUE:
+    default:
+        virReportError(VIR_ERR_RPC,
+                       _("Unexpected message status %d"), msg->header.status);
+        goto cleanup;
+    }
+
+    rv = 0;
+
+ cleanup:
+    virNetMessageFree(msg);
+    return rv;
+}
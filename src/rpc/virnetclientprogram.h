@@ -77,3 +77,17 @@ int virNetClientProgramCall(virNetClientProgramPtr prog,
                             int **infds,
                             xdrproc_t args_filter, void *args,
                             xdrproc_t ret_filter, void *ret);
+
+int virNetClientProgramEncodeCall(virNetClientProgramPtr prog,
+                                  unsigned serial,
+                                  int proc,
+                                  xdrproc_t args_filter, void *args,
+                                  char **packet,
+                                  size_t *packetlen);
+
+int virNetClientProgramDecodeReply(virNetClientProgramPtr prog,
+                                   unsigned serial,
+                                   int proc,
+                                   const char *packet,
+                                   size_t packetlen,
+                                   xdrproc_t ret_filter, void *ret);
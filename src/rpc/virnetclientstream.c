@@ -346,8 +346,9 @@ int virNetClientStreamQueuePacket(virNetClientStreamPtr st,
     tmp_msg->buffer = msg->buffer;
     tmp_msg->bufferLength = msg->bufferLength;
     tmp_msg->bufferOffset = msg->bufferOffset;
+    tmp_msg->bufferAlloc = msg->bufferAlloc;
     msg->buffer = NULL;
-    msg->bufferLength = msg->bufferOffset = 0;
+    msg->bufferLength = msg->bufferOffset = msg->bufferAlloc = 0;
 
     virObjectLock(st);
 
@@ -392,7 +393,9 @@ int virNetClientStreamSendPacket(virNetClientStreamPtr st,
      * need a synchronous confirmation
      */
     if (status == VIR_NET_CONTINUE) {
-        if (virNetMessageEncodePayloadRaw(msg, data, nbytes) < 0)
+        /* The message is sent synchronously, so it can reference the
+         * caller's buffer instead of copying it */
+        if (virNetMessageEncodePayloadRef(msg, (char *) data, nbytes, false) < 0)
             goto error;
     } else {
         if (virNetMessageEncodePayloadRaw(msg, NULL, 0) < 0)
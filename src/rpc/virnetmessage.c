@@ -62,7 +62,14 @@ virNetMessageClearPayload(virNetMessagePtr msg)
 
     msg->bufferOffset = 0;
     msg->bufferLength = 0;
+    msg->bufferAlloc = 0;
     VIR_FREE(msg->buffer);
+
+    if (msg->payloadOwned)
+        VIR_FREE(msg->payload);
+    msg->payload = NULL;
+    msg->payloadLength = 0;
+    msg->payloadOwned = false;
 }
 
 
@@ -73,6 +80,7 @@ void virNetMessageClear(virNetMessagePtr msg)
     VIR_DEBUG("msg=%p nfds=%zu", msg, msg->nfds);
 
     virNetMessageClearPayload(msg);
+    g_free(msg->eventKey);
     memset(msg, 0, sizeof(*msg));
     msg->tracked = tracked;
 }
@@ -89,9 +97,68 @@ void virNetMessageFree(virNetMessagePtr msg)
         msg->cb(msg, msg->opaque);
 
     virNetMessageClearPayload(msg);
+    g_free(msg->eventKey);
     VIR_FREE(msg);
 }
 
+/**
+ * virNetMessageRecycle:
+ * @msg: message which is done with
+ * @maxBuffer: largest buffer allocation worth keeping
+ *
+ * Prepares @msg to be used again as a fresh message, as an alternative
+ * to freeing it and allocating a new one. The free callback is invoked
+ * as virNetMessageFree would do, and the message buffer allocation is
+ * kept for reuse unless it is larger than @maxBuffer bytes.
+ */
+void virNetMessageRecycle(virNetMessagePtr msg,
+                          size_t maxBuffer)
+{
+    char *buffer = NULL;
+    size_t bufferAlloc = 0;
+
+    VIR_DEBUG("msg=%p nfds=%zu cb=%p", msg, msg->nfds, msg->cb);
+
+    if (msg->cb)
+        msg->cb(msg, msg->opaque);
+
+    if (msg->bufferAlloc <= maxBuffer) {
+        buffer = g_steal_pointer(&msg->buffer);
+        bufferAlloc = msg->bufferAlloc;
+    }
+
+    virNetMessageClear(msg);
+
+    msg->buffer = buffer;
+    msg->bufferAlloc = bufferAlloc;
+}
+
+
+/**
+ * virNetMessageReserveBuffer:
+ * @msg: message
+ * @len: number of bytes needed
+ *
+ * Makes sure @msg->buffer can hold at least @len bytes. The buffer is
+ * only ever grown so that recycled messages can reuse their previous
+ * allocation. Note that it does not change @msg->bufferLength.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int virNetMessageReserveBuffer(virNetMessagePtr msg,
+                               size_t len)
+{
+    if (msg->buffer && len <= msg->bufferAlloc)
+        return 0;
+
+    if (VIR_REALLOC_N(msg->buffer, len) < 0)
+        return -1;
+    msg->bufferAlloc = len;
+
+    return 0;
+}
+
+
 void virNetMessageQueuePush(virNetMessagePtr *queue, virNetMessagePtr msg)
 {
     virNetMessagePtr tmp = *queue;
@@ -153,7 +220,7 @@ int virNetMessageDecodeLength(virNetMessagePtr msg)
     /* Extend our declared buffer length and carry
        on reading the header + payload */
     msg->bufferLength += len;
-    if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
+    if (virNetMessageReserveBuffer(msg, msg->bufferLength) < 0)
         goto cleanup;
 
     VIR_DEBUG("Got length, now need %zu total (%u more)",
@@ -230,7 +297,7 @@ int virNetMessageEncodeHeader(virNetMessagePtr msg)
     unsigned int len = 0;
 
     msg->bufferLength = VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX;
-    if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
+    if (virNetMessageReserveBuffer(msg, msg->bufferLength) < 0)
         return ret;
     msg->bufferOffset = 0;
 
@@ -351,6 +418,12 @@ int virNetMessageEncodePayload(virNetMessagePtr msg,
     XDR xdr;
     unsigned int msglen;
 
+    /* A recycled message may have a larger buffer than the initial
+     * length virNetMessageEncodeHeader set up, so make use of all of it */
+    if (msg->bufferAlloc > msg->bufferLength)
+        msg->bufferLength = MIN(msg->bufferAlloc,
+                                VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX);
+
     /* Serialise payload of the message. This assumes that
      * virNetMessageEncodeHeader has already been run, so
      * just appends to that data */
@@ -359,8 +432,15 @@ int virNetMessageEncodePayload(virNetMessagePtr msg,
 
     /* Try to encode the payload. If the buffer is too small increase it. */
     while (!(*filter)(&xdr, data, 0)) {
-        unsigned int newlen = msg->bufferLength - VIR_NET_MESSAGE_LEN_MAX;
-        newlen *= 2;
+        size_t newlen = (msg->bufferLength - VIR_NET_MESSAGE_LEN_MAX) * 2;
+#ifdef HAVE_XDR_SIZEOF
+        /* Rather than encoding large payloads again for every doubling
+         * of the buffer, grow it to the size of the payload at once */
+        size_t needed = msg->bufferOffset + xdr_sizeof(filter, data);
+
+        if (needed > newlen + VIR_NET_MESSAGE_LEN_MAX)
+            newlen = needed - VIR_NET_MESSAGE_LEN_MAX;
+#endif /* HAVE_XDR_SIZEOF */
 
         if (newlen > VIR_NET_MESSAGE_MAX) {
             virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message payload"));
@@ -371,7 +451,7 @@ int virNetMessageEncodePayload(virNetMessagePtr msg,
 
         msg->bufferLength = newlen + VIR_NET_MESSAGE_LEN_MAX;
 
-        if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
+        if (virNetMessageReserveBuffer(msg, msg->bufferLength) < 0)
             goto error;
 
         xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
@@ -455,7 +535,7 @@ int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
 
         msg->bufferLength = msg->bufferOffset + len;
 
-        if (VIR_REALLOC_N(msg->buffer, msg->bufferLength) < 0)
+        if (virNetMessageReserveBuffer(msg, msg->bufferLength) < 0)
             return -1;
 
         VIR_DEBUG("Increased message buffer length = %zu", msg->bufferLength);
@@ -484,6 +564,100 @@ int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
 }
 
 
+/**
+ * virNetMessageEncodePayloadRef:
+ * @msg: message with an encoded header
+ * @data: stream data to send
+ * @len: length of @data
+ * @owned: whether @msg takes ownership of @data
+ *
+ * Like virNetMessageEncodePayloadRaw, but instead of copying @data into
+ * the message buffer, the message only references it and the data is
+ * written straight from @data. Unless @owned is true, @data must stay
+ * valid until the message was sent. If @owned is true, @data is freed
+ * along with the message payload once this function succeeds.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int virNetMessageEncodePayloadRef(virNetMessagePtr msg,
+                                  char *data,
+                                  size_t len,
+                                  bool owned)
+{
+    XDR xdr;
+    unsigned int msglen;
+
+    if ((msg->bufferOffset + len) >
+        (VIR_NET_MESSAGE_MAX + VIR_NET_MESSAGE_LEN_MAX)) {
+        virReportError(VIR_ERR_RPC,
+                       _("Stream data too long to send "
+                         "(%zu bytes needed, %zu bytes available)"),
+                       len,
+                       VIR_NET_MESSAGE_MAX +
+                       VIR_NET_MESSAGE_LEN_MAX -
+                       msg->bufferOffset);
+        return -1;
+    }
+
+    /* Re-encode the length word. */
+    msglen = msg->bufferOffset + len;
+    VIR_DEBUG("Encode length as %u", msglen);
+    xdrmem_create(&xdr, msg->buffer, VIR_NET_MESSAGE_HEADER_XDR_LEN, XDR_ENCODE);
+    if (!xdr_u_int(&xdr, &msglen)) {
+        virReportError(VIR_ERR_RPC, "%s", _("Unable to encode message length"));
+        xdr_destroy(&xdr);
+        return -1;
+    }
+    xdr_destroy(&xdr);
+
+    msg->payload = data;
+    msg->payloadLength = len;
+    msg->payloadOwned = owned;
+
+    msg->bufferLength = msglen;
+    msg->bufferOffset = 0;
+    return 0;
+}
+
+
+/**
+ * virNetMessageGetOutputVector:
+ * @msg: message to send
+ * @vec: filled with the data still to be sent
+ *
+ * Describes the part of @msg which was not sent yet, i.e. from
+ * @msg->bufferOffset on, as a list of at most two buffers: the
+ * remainder of the message buffer and of the referenced payload.
+ *
+ * Returns the number of filled entries of @vec.
+ */
+size_t virNetMessageGetOutputVector(virNetMessagePtr msg,
+                                    GOutputVector vec[2])
+{
+    size_t headLength = msg->bufferLength - msg->payloadLength;
+    size_t nvec = 0;
+
+    if (msg->bufferOffset < headLength) {
+        vec[nvec].buffer = msg->buffer + msg->bufferOffset;
+        vec[nvec].size = headLength - msg->bufferOffset;
+        nvec++;
+    }
+
+    if (msg->bufferOffset < msg->bufferLength && msg->payloadLength) {
+        size_t offset = 0;
+
+        if (msg->bufferOffset > headLength)
+            offset = msg->bufferOffset - headLength;
+
+        vec[nvec].buffer = msg->payload + offset;
+        vec[nvec].size = msg->payloadLength - offset;
+        nvec++;
+    }
+
+    return nvec;
+}
+
+
 int virNetMessageEncodePayloadEmpty(virNetMessagePtr msg)
 {
     XDR xdr;
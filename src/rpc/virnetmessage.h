@@ -37,6 +37,14 @@ struct _virNetMessage {
                   /* Maximum   VIR_NET_MESSAGE_MAX     + VIR_NET_MESSAGE_LEN_MAX */
     size_t bufferLength;
     size_t bufferOffset;
+    size_t bufferAlloc; /* Allocated size of @buffer, may exceed bufferLength */
+
+    /* Optional payload kept outside of @buffer so that bulk stream data
+     * does not need to be copied. It is sent right after the contents
+     * of @buffer; @bufferLength and @bufferOffset cover both. */
+    char *payload;
+    size_t payloadLength;
+    bool payloadOwned;
 
     virNetMessageHeader header;
 
@@ -47,6 +55,16 @@ struct _virNetMessage {
     int *fds;
     size_t donefds;
 
+    /* When a call was handed to the server for dispatch, in
+     * microseconds, or 0 if unknown */
+    unsigned long long received;
+
+    /* Asynchronous event, which may be dropped if the client doesn't
+     * keep up with its events, or replaced by a newer event with the
+     * same @eventKey while still queued */
+    bool event;
+    char *eventKey;
+
     virNetMessagePtr next;
 };
 
@@ -59,6 +77,14 @@ void virNetMessageClear(virNetMessagePtr);
 
 void virNetMessageFree(virNetMessagePtr msg);
 
+void virNetMessageRecycle(virNetMessagePtr msg,
+                          size_t maxBuffer)
+    ATTRIBUTE_NONNULL(1);
+
+int virNetMessageReserveBuffer(virNetMessagePtr msg,
+                               size_t len)
+    ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
+
 virNetMessagePtr virNetMessageQueueServe(virNetMessagePtr *queue)
     ATTRIBUTE_NONNULL(1);
 void virNetMessageQueuePush(virNetMessagePtr *queue,
@@ -88,9 +114,18 @@ int virNetMessageEncodePayloadRaw(virNetMessagePtr msg,
                                   const char *buf,
                                   size_t len)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
+int virNetMessageEncodePayloadRef(virNetMessagePtr msg,
+                                  char *data,
+                                  size_t len,
+                                  bool owned)
+    ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 int virNetMessageEncodePayloadEmpty(virNetMessagePtr msg)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 
+size_t virNetMessageGetOutputVector(virNetMessagePtr msg,
+                                    GOutputVector vec[2])
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+
 void virNetMessageSaveError(virNetMessageErrorPtr rerr)
     ATTRIBUTE_NONNULL(1);
 
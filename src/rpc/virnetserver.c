@@ -22,6 +22,7 @@
 #include <config.h>
 
 #include "virnetserver.h"
+#include "virhash.h"
 #include "virlog.h"
 #include "viralloc.h"
 #include "virerror.h"
@@ -42,6 +43,29 @@ struct _virNetServerJob {
     virNetServerClientPtr client;
     virNetMessagePtr msg;
     virNetServerProgramPtr prog;
+
+    virNetServerJobPtr next; /* in the queue of the client's flow */
+};
+
+/* Worker time, in microseconds, a client may use every time its turn
+ * comes in the deficit round robin order of calls */
+#define VIR_NET_SERVER_SCHED_QUANTUM (10 * 1000)
+
+/* Turns a client may go without calls after an expensive one, which
+ * keeps a single very long call from delaying the client for long */
+#define VIR_NET_SERVER_SCHED_DEFICIT_MAX (10 * VIR_NET_SERVER_SCHED_QUANTUM)
+
+typedef struct _virNetServerFlow virNetServerFlow;
+typedef virNetServerFlow *virNetServerFlowPtr;
+
+/* Calls of a client waiting for a worker */
+struct _virNetServerFlow {
+    unsigned long long id;       /* of the client */
+    virNetServerJobPtr head;
+    virNetServerJobPtr tail;
+    long long deficit;           /* worker time left in the current turn */
+
+    virNetServerFlowPtr next;    /* in the ring of flows */
 };
 
 struct _virNetServer {
@@ -52,6 +76,15 @@ struct _virNetServer {
     /* Immutable pointer, self-locking APIs */
     virThreadPoolPtr workers;
 
+    /* Normal priority calls are queued per client and picked by the
+     * workers in deficit round robin order, so that clients issuing
+     * many or expensive calls don't hold up the others. Every queued
+     * call has a matching job without data in the thread pool. */
+    virMutex schedLock;
+    virHashTablePtr flows;              /* client ID -> virNetServerFlow */
+    virNetServerFlowPtr flowHead;       /* ring of flows with calls queued */
+    virNetServerFlowPtr flowTail;
+
     size_t nservices;
     virNetServerServicePtr *services;
 
@@ -143,17 +176,175 @@ static int virNetServerProcessMsg(virNetServerPtr srv,
     return 0;
 }
 
+static void
+virNetServerJobFree(virNetServerJobPtr job)
+{
+    virObjectUnref(job->prog);
+    virNetMessageFree(job->msg);
+    virObjectUnref(job->client);
+    g_free(job);
+}
+
+
+static void
+virNetServerFlowFree(void *opaque)
+{
+    virNetServerFlowPtr flow = opaque;
+    virNetServerJobPtr job;
+
+    while ((job = flow->head)) {
+        flow->head = job->next;
+        virNetServerJobFree(job);
+    }
+
+    g_free(flow);
+}
+
+
+static void
+virNetServerFlowKey(unsigned long long id,
+                    char *key,
+                    size_t keylen)
+{
+    g_snprintf(key, keylen, "%llu", id);
+}
+
+
+/* Queues @job behind the other calls of its client. Must be called with
+ * schedLock held. */
+static int
+virNetServerSchedPushLocked(virNetServerPtr srv,
+                            virNetServerJobPtr job)
+{
+    char key[VIR_INT64_STR_BUFLEN];
+    unsigned long long id = virNetServerClientGetID(job->client);
+    virNetServerFlowPtr flow;
+
+    virNetServerFlowKey(id, key, sizeof(key));
+
+    if (!(flow = virHashLookup(srv->flows, key))) {
+        flow = g_new0(virNetServerFlow, 1);
+        flow->id = id;
+
+        if (virHashAddEntry(srv->flows, key, flow) < 0) {
+            g_free(flow);
+            return -1;
+        }
+
+        if (srv->flowTail)
+            srv->flowTail->next = flow;
+        else
+            srv->flowHead = flow;
+        srv->flowTail = flow;
+    }
+
+    if (flow->tail)
+        flow->tail->next = job;
+    else
+        flow->head = job;
+    flow->tail = job;
+
+    return 0;
+}
+
+
+/* Takes the call to run next out of the queues. Must be called with
+ * schedLock held. */
+static virNetServerJobPtr
+virNetServerSchedPopLocked(virNetServerPtr srv)
+{
+    virNetServerFlowPtr flow;
+    virNetServerJobPtr job;
+    char key[VIR_INT64_STR_BUFLEN];
+
+    if (!srv->flowHead)
+        return NULL;
+
+    /* Flows which used up their turn get a new one and go to the back */
+    while (srv->flowHead->deficit <= 0) {
+        flow = srv->flowHead;
+        flow->deficit += VIR_NET_SERVER_SCHED_QUANTUM;
+
+        if (flow->next) {
+            srv->flowHead = flow->next;
+            srv->flowTail->next = flow;
+            srv->flowTail = flow;
+            flow->next = NULL;
+        }
+    }
+
+    flow = srv->flowHead;
+    job = flow->head;
+    flow->head = job->next;
+    job->next = NULL;
+
+    if (!flow->head) {
+        /* An idle client doesn't keep its turn */
+        flow->tail = NULL;
+        srv->flowHead = flow->next;
+        if (!srv->flowHead)
+            srv->flowTail = NULL;
+
+        virNetServerFlowKey(flow->id, key, sizeof(key));
+        virHashRemoveEntry(srv->flows, key);
+    }
+
+    return job;
+}
+
+
+/* Charges the client @id for @usec of worker time */
+static void
+virNetServerSchedCharge(virNetServerPtr srv,
+                        unsigned long long id,
+                        long long usec)
+{
+    char key[VIR_INT64_STR_BUFLEN];
+    virNetServerFlowPtr flow;
+
+    virNetServerFlowKey(id, key, sizeof(key));
+
+    virMutexLock(&srv->schedLock);
+    if ((flow = virHashLookup(srv->flows, key)))
+        flow->deficit = MAX(flow->deficit - usec,
+                            -VIR_NET_SERVER_SCHED_DEFICIT_MAX);
+    virMutexUnlock(&srv->schedLock);
+}
+
+
 static void virNetServerHandleJob(void *jobOpaque, void *opaque)
 {
     virNetServerPtr srv = opaque;
     virNetServerJobPtr job = jobOpaque;
+    bool scheduled = false;
+    long long start;
+    long long elapsed;
+
+    /* A job without data stands for the next call in fair order */
+    if (!job) {
+        virMutexLock(&srv->schedLock);
+        job = virNetServerSchedPopLocked(srv);
+        virMutexUnlock(&srv->schedLock);
+
+        if (!job)
+            return;
+        scheduled = true;
+    }
 
     VIR_DEBUG("server=%p client=%p message=%p prog=%p",
               srv, job->client, job->msg, job->prog);
 
+    start = g_get_monotonic_time();
+
     if (virNetServerProcessMsg(srv, job->client, job->prog, job->msg) < 0)
         goto error;
 
+    elapsed = g_get_monotonic_time() - start;
+    virNetServerClientAddCallTime(job->client, elapsed);
+    if (scheduled)
+        virNetServerSchedCharge(srv, virNetServerClientGetID(job->client),
+                                elapsed);
+
     virObjectUnref(job->prog);
     virObjectUnref(job->client);
     VIR_FREE(job);
@@ -200,6 +391,8 @@ virNetServerDispatchNewMessage(virNetServerClientPtr client,
     VIR_DEBUG("server=%p client=%p message=%p",
               srv, client, msg);
 
+    msg->received = g_get_monotonic_time();
+
     virObjectLock(srv);
     prog = virNetServerGetProgramLocked(srv, msg);
     /* we can unlock @srv since @prog can only become invalid in case
@@ -222,7 +415,28 @@ virNetServerDispatchNewMessage(virNetServerClientPtr client,
             priority = virNetServerProgramGetPriority(prog, msg->header.proc);
         }
 
-        if (virThreadPoolSendJob(srv->workers, priority, job) < 0) {
+        if (priority == VIR_THREAD_POOL_JOB_NORMAL) {
+            int rc;
+
+            virMutexLock(&srv->schedLock);
+            rc = virNetServerSchedPushLocked(srv, job);
+            virMutexUnlock(&srv->schedLock);
+
+            if (rc < 0) {
+                virObjectUnref(client);
+                VIR_FREE(job);
+                virObjectUnref(prog);
+                goto error;
+            }
+
+            /* The call is now owned by the queue and is dropped along
+             * with it if it can't be run */
+            if (virThreadPoolSendJob(srv->workers, priority, NULL) < 0) {
+                virNetServerClientClose(client);
+                virObjectUnref(srv);
+                return;
+            }
+        } else if (virThreadPoolSendJob(srv->workers, priority, job) < 0) {
             virObjectUnref(client);
             VIR_FREE(job);
             virObjectUnref(prog);
@@ -369,6 +583,16 @@ virNetServerPtr virNetServerNew(const char *name,
     if (!(srv = virObjectLockableNew(virNetServerClass)))
         return NULL;
 
+    if (virMutexInit(&srv->schedLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        virObjectUnref(srv);
+        return NULL;
+    }
+
+    if (!(srv->flows = virHashNew(virNetServerFlowFree)))
+        goto error;
+
     if (!(srv->workers = virThreadPoolNewFull(min_workers, max_workers,
                                               priority_workers,
                                               virNetServerHandleJob,
@@ -836,6 +1060,32 @@ int virNetServerAddProgram(virNetServerPtr srv,
     return -1;
 }
 
+/**
+ * virNetServerGetPrograms:
+ * @srv: server
+ * @progs: filled with a newly allocated list of programs
+ *
+ * Returns the number of programs of @srv stored in @progs, each of
+ * them holding a reference the caller has to release.
+ */
+size_t
+virNetServerGetPrograms(virNetServerPtr srv,
+                        virNetServerProgramPtr **progs)
+{
+    size_t nprogs;
+    size_t i;
+
+    virObjectLock(srv);
+
+    nprogs = srv->nprograms;
+    *progs = g_new0(virNetServerProgramPtr, nprogs);
+    for (i = 0; i < nprogs; i++)
+        (*progs)[i] = virObjectRef(srv->programs[i]);
+
+    virObjectUnlock(srv);
+    return nprogs;
+}
+
 int virNetServerSetTLSContext(virNetServerPtr srv,
                               virNetTLSContextPtr tls)
 {
@@ -914,6 +1164,10 @@ void virNetServerDispose(void *obj)
 
     virThreadPoolFree(srv->workers);
 
+    /* Frees the calls no worker got to */
+    virHashFree(srv->flows);
+    virMutexDestroy(&srv->schedLock);
+
     for (i = 0; i < srv->nservices; i++)
         virObjectUnref(srv->services[i]);
     VIR_FREE(srv->services);
@@ -1024,7 +1278,10 @@ virNetServerGetThreadPoolParameters(virNetServerPtr srv,
                                     size_t *nWorkers,
                                     size_t *freeWorkers,
                                     size_t *nPrioWorkers,
-                                    size_t *jobQueueDepth)
+                                    size_t *jobQueueDepth,
+                                    unsigned long long *targetLatency,
+                                    unsigned long long *jobWaitTime,
+                                    unsigned long long *jobRunTime)
 {
     virObjectLock(srv);
 
@@ -1034,6 +1291,9 @@ virNetServerGetThreadPoolParameters(virNetServerPtr srv,
     *nWorkers = virThreadPoolGetCurrentWorkers(srv->workers);
     *nPrioWorkers = virThreadPoolGetPriorityWorkers(srv->workers);
     *jobQueueDepth = virThreadPoolGetJobQueueDepth(srv->workers);
+    *targetLatency = virThreadPoolGetTargetLatency(srv->workers);
+    *jobWaitTime = virThreadPoolGetJobWaitTime(srv->workers);
+    *jobRunTime = virThreadPoolGetJobRunTime(srv->workers);
 
     virObjectUnlock(srv);
     return 0;
@@ -1043,13 +1303,15 @@ int
 virNetServerSetThreadPoolParameters(virNetServerPtr srv,
                                     long long int minWorkers,
                                     long long int maxWorkers,
-                                    long long int prioWorkers)
+                                    long long int prioWorkers,
+                                    long long int targetLatency)
 {
     int ret;
 
     virObjectLock(srv);
     ret = virThreadPoolSetParameters(srv->workers, minWorkers,
-                                     maxWorkers, prioWorkers);
+                                     maxWorkers, prioWorkers,
+                                     targetLatency);
     virObjectUnlock(srv);
 
     return ret;
@@ -87,6 +87,9 @@ int virNetServerAddServiceUNIX(virNetServerPtr srv,
 int virNetServerAddProgram(virNetServerPtr srv,
                            virNetServerProgramPtr prog);
 
+size_t virNetServerGetPrograms(virNetServerPtr srv,
+                               virNetServerProgramPtr **progs);
+
 int virNetServerSetTLSContext(virNetServerPtr srv,
                               virNetTLSContextPtr tls);
 
@@ -107,12 +110,16 @@ int virNetServerGetThreadPoolParameters(virNetServerPtr srv,
                                         size_t *nWorkers,
                                         size_t *freeWorkers,
                                         size_t *nPrioWorkers,
-                                        size_t *jobQueueDepth);
+                                        size_t *jobQueueDepth,
+                                        unsigned long long *targetLatency,
+                                        unsigned long long *jobWaitTime,
+                                        unsigned long long *jobRunTime);
 
 int virNetServerSetThreadPoolParameters(virNetServerPtr srv,
                                         long long int minWorkers,
                                         long long int maxWorkers,
-                                        long long int prioWorkers);
+                                        long long int prioWorkers,
+                                        long long int targetLatency);
 
 unsigned long long virNetServerNextClientID(virNetServerPtr srv);
 
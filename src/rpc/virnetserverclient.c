@@ -102,6 +102,19 @@ struct _virNetServerClient
     /* Zero or many messages waiting for transmit
      * back to client, including async events */
     virNetMessagePtr tx;
+    /* Count of async events in the 'tx' queue, and of
+     * events replaced by newer ones or dropped because
+     * the client didn't read them fast enough */
+    size_t nevents;
+    unsigned long long neventsCoalesced;
+    unsigned long long neventsDropped;
+    /* Time spent by workers running the calls of
+     * the client, in microseconds */
+    unsigned long long callTime;
+    /* Sent messages kept around, with their buffers,
+     * to be reused for receiving further calls */
+    virNetMessagePtr freeMsgs;
+    size_t nfreeMsgs;
 
     /* Filters to capture messages that would otherwise
      * end up on the 'dx' queue */
@@ -120,6 +133,12 @@ struct _virNetServerClient
 };
 
 
+/* Upper bounds for the per-client pool of recycled messages. Buffers
+ * grown beyond the initial size are not worth holding on to. */
+#define VIR_NET_SERVER_CLIENT_MSG_POOL_MAX 16
+#define VIR_NET_SERVER_CLIENT_MSG_POOL_BUFFER_MAX \
+    (VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX)
+
 static virClassPtr virNetServerClientClass;
 static void virNetServerClientDispose(void *obj);
 
@@ -140,6 +159,57 @@ static virNetMessagePtr virNetServerClientDispatchRead(virNetServerClientPtr cli
 static int virNetServerClientSendMessageLocked(virNetServerClientPtr client,
                                                virNetMessagePtr msg);
 
+
+/*
+ * Returns a message ready for receiving the next call, taken from
+ * the pool of recycled messages if possible.
+ */
+static virNetMessagePtr
+virNetServerClientNewRxMessage(virNetServerClientPtr client)
+{
+    virNetMessagePtr msg;
+
+    if (client->freeMsgs) {
+        msg = virNetMessageQueueServe(&client->freeMsgs);
+        client->nfreeMsgs--;
+        msg->tracked = true;
+    } else if (!(msg = virNetMessageNew(true))) {
+        return NULL;
+    }
+
+    msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
+    if (virNetMessageReserveBuffer(msg, msg->bufferLength) < 0) {
+        virNetMessageFree(msg);
+        return NULL;
+    }
+
+    return msg;
+}
+
+
+/*
+ * Disposes of a message the client is done with, keeping it
+ * for reuse by virNetServerClientNewRxMessage unless the pool
+ * is full already.
+ */
+static void
+virNetServerClientReleaseMessage(virNetServerClientPtr client,
+                                 virNetMessagePtr msg)
+{
+    if (!msg)
+        return;
+
+    if (client->nfreeMsgs >= VIR_NET_SERVER_CLIENT_MSG_POOL_MAX) {
+        virNetMessageFree(msg);
+        return;
+    }
+
+    virNetMessageRecycle(msg, VIR_NET_SERVER_CLIENT_MSG_POOL_BUFFER_MAX);
+    virNetMessageQueuePush(&client->freeMsgs, msg);
+    client->nfreeMsgs++;
+}
+
+
 /*
  * @client: a locked client object
  */
@@ -411,10 +481,7 @@ virNetServerClientNewInternal(unsigned long long id,
         goto error;
 
     /* Prepare one for packet receive */
-    if (!(client->rx = virNetMessageNew(true)))
-        goto error;
-    client->rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-    if (VIR_ALLOC_N(client->rx->buffer, client->rx->bufferLength) < 0)
+    if (!(client->rx = virNetServerClientNewRxMessage(client)))
         goto error;
     client->nrequests = 1;
 
@@ -677,6 +744,45 @@ virNetServerClientSetReadonly(virNetServerClientPtr client,
 }
 
 
+size_t
+virNetServerClientGetMaxRequests(virNetServerClientPtr client)
+{
+    size_t nrequests_max;
+    virObjectLock(client);
+    nrequests_max = client->nrequests_max;
+    virObjectUnlock(client);
+    return nrequests_max;
+}
+
+
+/**
+ * virNetServerClientSetMaxRequests:
+ * @client: the client
+ * @nrequests_max: new limit on concurrent calls
+ *
+ * Changes how many calls from @client may be in progress at the same
+ * time. Raising the limit immediately resumes reading from a throttled
+ * client; lowering it lets calls already in progress complete.
+ */
+void
+virNetServerClientSetMaxRequests(virNetServerClientPtr client,
+                                 size_t nrequests_max)
+{
+    virObjectLock(client);
+    client->nrequests_max = nrequests_max;
+
+    if (client->sock && !client->wantClose && !client->rx &&
+        client->nrequests < client->nrequests_max) {
+        if (!(client->rx = virNetServerClientNewRxMessage(client)))
+            client->wantClose = true;
+        else
+            client->nrequests++;
+        virNetServerClientUpdateEvent(client);
+    }
+    virObjectUnlock(client);
+}
+
+
 unsigned long long virNetServerClientGetID(virNetServerClientPtr client)
 {
     return client->id;
@@ -986,6 +1092,9 @@ void virNetServerClientDispose(void *obj)
     virObjectUnref(client->tls);
     virObjectUnref(client->tlsCtxt);
     virObjectUnref(client->sock);
+
+    while (client->freeMsgs)
+        virNetMessageFree(virNetMessageQueueServe(&client->freeMsgs));
 }
 
 
@@ -1049,6 +1158,7 @@ virNetServerClientCloseLocked(virNetServerClientPtr client)
             = virNetMessageQueueServe(&client->tx);
         virNetMessageFree(msg);
     }
+    client->nevents = 0;
 
     if (client->sock) {
         virObjectUnref(client->sock);
@@ -1271,7 +1381,7 @@ static virNetMessagePtr virNetServerClientDispatchRead(virNetServerClientPtr cli
               msg->header.type, msg->header.status, msg->header.serial);
 
         if (virKeepAliveCheckMessage(client->keepalive, msg, &response)) {
-            virNetMessageFree(msg);
+            virNetServerClientReleaseMessage(client, msg);
             client->nrequests--;
             msg = NULL;
 
@@ -1302,17 +1412,10 @@ static virNetMessagePtr virNetServerClientDispatchRead(virNetServerClientPtr cli
 
         /* Possibly need to create another receive buffer */
         if (client->nrequests < client->nrequests_max) {
-            if (!(client->rx = virNetMessageNew(true))) {
+            if (!(client->rx = virNetServerClientNewRxMessage(client)))
                 client->wantClose = true;
-            } else {
-                client->rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-                if (VIR_ALLOC_N(client->rx->buffer,
-                                client->rx->bufferLength) < 0) {
-                    client->wantClose = true;
-                } else {
-                    client->nrequests++;
-                }
-            }
+            else
+                client->nrequests++;
         }
         virNetServerClientUpdateEvent(client);
 
@@ -1331,6 +1434,8 @@ static virNetMessagePtr virNetServerClientDispatchRead(virNetServerClientPtr cli
  */
 static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
 {
+    GOutputVector vec[2];
+    size_t nvec;
     ssize_t ret;
 
     if (client->tx->bufferLength < client->tx->bufferOffset) {
@@ -1344,9 +1449,8 @@ static ssize_t virNetServerClientWrite(virNetServerClientPtr client)
     if (client->tx->bufferLength == client->tx->bufferOffset)
         return 1;
 
-    ret = virNetSocketWrite(client->sock,
-                            client->tx->buffer + client->tx->bufferOffset,
-                            client->tx->bufferLength - client->tx->bufferOffset);
+    nvec = virNetMessageGetOutputVector(client->tx, vec);
+    ret = virNetSocketWriteVector(client->sock, vec, nvec);
     if (ret <= 0)
         return ret; /* -1 error, 0 = egain */
 
@@ -1403,25 +1507,24 @@ virNetServerClientDispatchWrite(virNetServerClientPtr client)
             /* Get finished msg from head of tx queue */
             msg = virNetMessageQueueServe(&client->tx);
 
+            if (msg->event)
+                client->nevents--;
+
             if (msg->tracked) {
                 client->nrequests--;
                 /* See if the recv queue is currently throttled */
                 if (!client->rx &&
                     client->nrequests < client->nrequests_max) {
                     /* Ready to recv more messages */
-                    virNetMessageClear(msg);
-                    msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-                    if (VIR_ALLOC_N(msg->buffer, msg->bufferLength) < 0) {
-                        virNetMessageFree(msg);
-                        return;
-                    }
-                    client->rx = msg;
+                    virNetServerClientReleaseMessage(client, msg);
                     msg = NULL;
+                    if (!(client->rx = virNetServerClientNewRxMessage(client)))
+                        return;
                     client->nrequests++;
                 }
             }
 
-            virNetMessageFree(msg);
+            virNetServerClientReleaseMessage(client, msg);
 
             virNetServerClientUpdateEvent(client);
 
@@ -1538,6 +1641,126 @@ int virNetServerClientSendMessage(virNetServerClientPtr client,
 }
 
 
+/**
+ * virNetServerClientSendEvent:
+ * @client: the client
+ * @msg: the event message
+ * @maxEvents: most events to keep queued for @client, 0 for no limit
+ *
+ * Queues the asynchronous event @msg for transmission to @client. If
+ * @client already has @maxEvents events waiting, which happens when it
+ * doesn't read them as fast as they are generated, @msg replaces an
+ * undelivered event with the same @msg->eventKey, or is dropped if there
+ * is none, so that a stuck client can't make the daemon hold an unbounded
+ * amount of memory.
+ *
+ * Returns 0 if @msg was consumed, either by being queued or dropped,
+ * -1 if @client is closing and the caller keeps ownership of @msg.
+ */
+int
+virNetServerClientSendEvent(virNetServerClientPtr client,
+                            virNetMessagePtr msg,
+                            size_t maxEvents)
+{
+    virNetMessagePtr prev = NULL;
+    virNetMessagePtr tmp;
+    int ret = -1;
+
+    virObjectLock(client);
+
+    msg->event = true;
+
+    if (maxEvents == 0 || client->nevents < maxEvents) {
+        if ((ret = virNetServerClientSendMessageLocked(client, msg)) == 0)
+            client->nevents++;
+        goto cleanup;
+    }
+
+    if (!client->sock || client->wantClose)
+        goto cleanup;
+
+    ret = 0;
+
+    if (msg->eventKey) {
+        for (tmp = client->tx; tmp; prev = tmp, tmp = tmp->next) {
+            /* the head may be partially sent already */
+            if (!tmp->event || tmp->bufferOffset > 0 ||
+                STRNEQ_NULLABLE(tmp->eventKey, msg->eventKey))
+                continue;
+
+            VIR_DEBUG("client=%p replacing queued event %p with %p",
+                      client, tmp, msg);
+            msg->next = tmp->next;
+            if (prev)
+                prev->next = msg;
+            else
+                client->tx = msg;
+            tmp->next = NULL;
+            virNetMessageFree(tmp);
+            client->neventsCoalesced++;
+            goto cleanup;
+        }
+    }
+
+    if (client->neventsDropped++ == 0)
+        VIR_WARN("Client %llu doesn't keep up with its events, "
+                 "dropping events beyond %zu queued ones",
+                 client->id, maxEvents);
+    VIR_DEBUG("client=%p dropping event proc=%d", client, msg->header.proc);
+    virNetMessageFree(msg);
+
+ cleanup:
+    virObjectUnlock(client);
+    return ret;
+}
+
+
+void
+virNetServerClientGetEventStats(virNetServerClientPtr client,
+                                size_t *queued,
+                                unsigned long long *coalesced,
+                                unsigned long long *dropped)
+{
+    virObjectLock(client);
+    *queued = client->nevents;
+    *coalesced = client->neventsCoalesced;
+    *dropped = client->neventsDropped;
+    virObjectUnlock(client);
+}
+
+
+/**
+ * virNetServerClientAddCallTime:
+ * @client: the client
+ * @usec: time a worker spent on a call of @client
+ *
+ * Accounts @usec microseconds of worker time to @client.
+ */
+void
+virNetServerClientAddCallTime(virNetServerClientPtr client,
+                              unsigned long long usec)
+{
+    virObjectLock(client);
+    client->callTime += usec;
+    virObjectUnlock(client);
+}
+
+
+void
+virNetServerClientGetCallStats(virNetServerClientPtr client,
+                               size_t *inflight,
+                               unsigned long long *callTime)
+{
+    virObjectLock(client);
+    *inflight = client->nrequests;
+    /* The client holds one request slot while receiving */
+    if (client->rx && *inflight > 0)
+        (*inflight)--;
+    *callTime = client->callTime;
+    virObjectUnlock(client);
+}
+
+
 bool
 virNetServerClientIsAuthenticated(virNetServerClientPtr client)
 {
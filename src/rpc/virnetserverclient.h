@@ -98,6 +98,9 @@ int virNetServerClientGetAuth(virNetServerClientPtr client);
 void virNetServerClientSetAuthLocked(virNetServerClientPtr client, int auth);
 bool virNetServerClientGetReadonly(virNetServerClientPtr client);
 void virNetServerClientSetReadonly(virNetServerClientPtr client, bool readonly);
+size_t virNetServerClientGetMaxRequests(virNetServerClientPtr client);
+void virNetServerClientSetMaxRequests(virNetServerClientPtr client,
+                                      size_t nrequests_max);
 unsigned long long virNetServerClientGetID(virNetServerClientPtr client);
 long long virNetServerClientGetTimestamp(virNetServerClientPtr client);
 
@@ -162,6 +165,18 @@ const char *virNetServerClientRemoteAddrStringURI(virNetServerClientPtr client);
 
 int virNetServerClientSendMessage(virNetServerClientPtr client,
                                   virNetMessagePtr msg);
+int virNetServerClientSendEvent(virNetServerClientPtr client,
+                                virNetMessagePtr msg,
+                                size_t maxEvents);
+void virNetServerClientGetEventStats(virNetServerClientPtr client,
+                                     size_t *queued,
+                                     unsigned long long *coalesced,
+                                     unsigned long long *dropped);
+void virNetServerClientAddCallTime(virNetServerClientPtr client,
+                                   unsigned long long usec);
+void virNetServerClientGetCallStats(virNetServerClientPtr client,
+                                    size_t *inflight,
+                                    unsigned long long *callTime);
 
 bool virNetServerClientIsAuthenticated(virNetServerClientPtr client);
 bool virNetServerClientIsAuthPendingLocked(virNetServerClientPtr client);
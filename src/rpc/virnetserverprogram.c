@@ -41,6 +41,10 @@ struct _virNetServerProgram {
     unsigned version;
     virNetServerProgramProcPtr procs;
     size_t nprocs;
+
+    /* Indexed by procedure, allocated on its first call */
+    virMutex statsLock;
+    virNetServerProgramProcStatsPtr *stats;
 };
 
 
@@ -71,10 +75,18 @@ virNetServerProgramPtr virNetServerProgramNew(unsigned program,
     if (!(prog = virObjectNew(virNetServerProgramClass)))
         return NULL;
 
+    if (virMutexInit(&prog->statsLock) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to initialize mutex"));
+        virObjectUnref(prog);
+        return NULL;
+    }
+
     prog->program = program;
     prog->version = version;
     prog->procs = procs;
     prog->nprocs = nprocs;
+    prog->stats = g_new0(virNetServerProgramProcStatsPtr, nprocs);
 
     VIR_DEBUG("prog=%p", prog);
 
@@ -134,19 +146,99 @@ virNetServerProgramGetPriority(virNetServerProgramPtr prog,
     return proc->priority;
 }
 
-static int
-virNetServerProgramSendError(unsigned program,
-                             unsigned version,
-                             virNetServerClientPtr client,
-                             virNetMessagePtr msg,
-                             virNetMessageErrorPtr rerr,
-                             int procedure,
-                             int type,
-                             unsigned int serial)
+
+static size_t
+virNetServerProgramStatsBucket(unsigned long long usec)
 {
-    VIR_DEBUG("prog=%d ver=%d proc=%d type=%d serial=%u msg=%p rerr=%p",
-              program, version, procedure, type, serial, msg, rerr);
+    size_t bucket = 0;
+
+    while (usec > 0 && bucket < VIR_NET_SERVER_PROGRAM_STATS_BUCKETS - 1) {
+        usec >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+
+/*
+ * @start: when the dispatch of @msg started, in microseconds
+ * @bytesIn: size of the call packet
+ * @failed: whether an error is being sent back
+ *
+ * Account a call of @procedure whose reply has just been encoded
+ * into @msg.
+ */
+static void
+virNetServerProgramUpdateStats(virNetServerProgramPtr prog,
+                               int procedure,
+                               virNetMessagePtr msg,
+                               unsigned long long start,
+                               size_t bytesIn,
+                               bool failed)
+{
+    unsigned long long now = g_get_monotonic_time();
+    virNetServerProgramProcStatsPtr stats;
+
+    virMutexLock(&prog->statsLock);
+
+    if (!(stats = prog->stats[procedure])) {
+        stats = prog->stats[procedure] = g_new0(virNetServerProgramProcStats, 1);
+        stats->proc = procedure;
+    }
+
+    stats->calls++;
+    if (failed)
+        stats->errors++;
+    stats->bytesIn += bytesIn;
+    stats->bytesOut += msg->bufferLength;
+
+    /* calls embedded in a batch call were never queued themselves */
+    if (msg->received)
+        stats->queueTime[virNetServerProgramStatsBucket(start - msg->received)]++;
+    stats->execTime[virNetServerProgramStatsBucket(now - start)]++;
+
+    virMutexUnlock(&prog->statsLock);
+}
+
+
+/**
+ * virNetServerProgramGetStats:
+ * @prog: the program
+ * @stats: filled with a newly allocated array of statistics
+ * @nstats: filled with the number of elements of @stats
+ *
+ * Collects the statistics of all procedures of @prog which have been
+ * called at least once.
+ */
+void
+virNetServerProgramGetStats(virNetServerProgramPtr prog,
+                            virNetServerProgramProcStatsPtr *stats,
+                            size_t *nstats)
+{
+    size_t i;
+
+    *stats = NULL;
+    *nstats = 0;
+
+    virMutexLock(&prog->statsLock);
+    for (i = 0; i < prog->nprocs; i++) {
+        if (prog->stats[i])
+            ignore_value(VIR_APPEND_ELEMENT_COPY(*stats, *nstats,
+                                                 *prog->stats[i]));
+    }
+    virMutexUnlock(&prog->statsLock);
+}
 
+static int
+virNetServerProgramEncodeError(unsigned program,
+                               unsigned version,
+                               virNetMessagePtr msg,
+                               virNetMessageErrorPtr rerr,
+                               int procedure,
+                               int type,
+                               unsigned int serial)
+{
     virNetMessageSaveError(rerr);
 
     /* Return header. */
@@ -164,10 +256,6 @@ virNetServerProgramSendError(unsigned program,
         goto error;
     xdr_free((xdrproc_t)xdr_virNetMessageError, (void*)rerr);
 
-    /* Put reply on end of tx queue to send out  */
-    if (virNetServerClientSendMessage(client, msg) < 0)
-        return -1;
-
     return 0;
 
  error:
@@ -177,6 +265,31 @@ virNetServerProgramSendError(unsigned program,
 }
 
 
+static int
+virNetServerProgramSendError(unsigned program,
+                             unsigned version,
+                             virNetServerClientPtr client,
+                             virNetMessagePtr msg,
+                             virNetMessageErrorPtr rerr,
+                             int procedure,
+                             int type,
+                             unsigned int serial)
+{
+    VIR_DEBUG("prog=%d ver=%d proc=%d type=%d serial=%u msg=%p rerr=%p",
+              program, version, procedure, type, serial, msg, rerr);
+
+    if (virNetServerProgramEncodeError(program, version, msg, rerr,
+                                       procedure, type, serial) < 0)
+        return -1;
+
+    /* Put reply on end of tx queue to send out  */
+    if (virNetServerClientSendMessage(client, msg) < 0)
+        return -1;
+
+    return 0;
+}
+
+
 /*
  * @client: the client to send the error to
  * @req: the message this error is in reply to
@@ -351,27 +464,32 @@ int virNetServerProgramDispatch(virNetServerProgramPtr prog,
  * @server: the unlocked server object
  * @client: the unlocked client object
  * @msg: the complete incoming method call, with header already decoded
+ * @batched: whether the call was embedded in a batch call
  *
  * This method is used to dispatch a message representing an
  * incoming method call from a client. It decodes the payload
  * to obtain method call arguments, invokes the method and
- * then sends a reply packet with the return values
+ * then encodes a reply packet with the return values, or the
+ * error, into @msg
  *
- * Returns 0 if the reply was sent, or -1 upon fatal error
+ * Returns 0 if the reply was encoded, or -1 upon fatal error
  */
 static int
-virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
-                                virNetServerPtr server,
-                                virNetServerClientPtr client,
-                                virNetMessagePtr msg)
+virNetServerProgramDispatchCallEncode(virNetServerProgramPtr prog,
+                                      virNetServerPtr server,
+                                      virNetServerClientPtr client,
+                                      virNetMessagePtr msg,
+                                      bool batched)
 {
     g_autofree char *arg = NULL;
     g_autofree char *ret = NULL;
     int rv = -1;
-    virNetServerProgramProcPtr dispatcher;
+    virNetServerProgramProcPtr dispatcher = NULL;
     virNetMessageError rerr;
     size_t i;
     g_autoptr(virIdentity) identity = NULL;
+    unsigned long long start = g_get_monotonic_time();
+    size_t bytesIn = msg->bufferLength;
 
     memset(&rerr, 0, sizeof(rerr));
 
@@ -403,6 +521,15 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
         goto error;
     }
 
+    /* Procedures which pass file descriptors or open streams are
+     * tied to the message that carried them and can't be batched */
+    if (batched && !dispatcher->batchable) {
+        virReportError(VIR_ERR_RPC,
+                       _("procedure %d cannot be batched"),
+                       msg->header.proc);
+        goto error;
+    }
+
     if (VIR_ALLOC_N(arg, dispatcher->arg_len) < 0)
         goto error;
     if (VIR_ALLOC_N(ret, dispatcher->ret_len) < 0)
@@ -411,11 +538,14 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
     if (virNetMessageDecodePayload(msg, dispatcher->arg_filter, arg) < 0)
         goto error;
 
-    if (!(identity = virNetServerClientGetIdentity(client)))
-        goto error;
+    /* A batched call runs with the identity the batch call set */
+    if (!batched) {
+        if (!(identity = virNetServerClientGetIdentity(client)))
+            goto error;
 
-    if (virIdentitySetCurrent(identity) < 0)
-        goto error;
+        if (virIdentitySetCurrent(identity) < 0)
+            goto error;
+    }
 
     /*
      * When the RPC handler is called:
@@ -429,7 +559,7 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
      */
     rv = (dispatcher->func)(server, client, msg, &rerr, arg, ret);
 
-    if (virIdentitySetCurrent(NULL) < 0)
+    if (!batched && virIdentitySetCurrent(NULL) < 0)
         goto error;
 
     /*
@@ -480,18 +610,108 @@ virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
 
     xdr_free(dispatcher->ret_filter, ret);
 
-    /* Put reply on end of tx queue to send out  */
-    return virNetServerClientSendMessage(client, msg);
+    virNetServerProgramUpdateStats(prog, msg->header.proc, msg,
+                                   start, bytesIn, false);
+
+    return 0;
 
  error:
     /* Bad stuff (de-)serializing message, but we have an
      * RPC error message we can send back to the client */
-    rv = virNetServerProgramSendReplyError(prog, client, msg, &rerr, &msg->header);
+    rv = virNetServerProgramEncodeError(prog->program,
+                                        prog->version,
+                                        msg,
+                                        &rerr,
+                                        msg->header.proc,
+                                        VIR_NET_REPLY,
+                                        msg->header.serial);
+
+    if (dispatcher)
+        virNetServerProgramUpdateStats(prog, msg->header.proc, msg,
+                                       start, bytesIn, true);
 
     return rv;
 }
 
 
+/*
+ * @server: the unlocked server object
+ * @client: the unlocked client object
+ * @msg: the complete incoming method call, with header already decoded
+ *
+ * This method is used to dispatch a message representing an
+ * incoming method call from a client. It decodes the payload
+ * to obtain method call arguments, invokes the method and
+ * then sends a reply packet with the return values
+ *
+ * Returns 0 if the reply was sent, or -1 upon fatal error
+ */
+static int
+virNetServerProgramDispatchCall(virNetServerProgramPtr prog,
+                                virNetServerPtr server,
+                                virNetServerClientPtr client,
+                                virNetMessagePtr msg)
+{
+    if (virNetServerProgramDispatchCallEncode(prog, server, client,
+                                              msg, false) < 0)
+        return -1;
+
+    /* Put reply on end of tx queue to send out  */
+    return virNetServerClientSendMessage(client, msg);
+}
+
+
+/**
+ * virNetServerProgramDispatchBatched:
+ * @prog: the program the call belongs to
+ * @server: the unlocked server object
+ * @client: the unlocked client object
+ * @msg: a complete method call packet taken out of a batch call
+ *
+ * This method is used by the dispatch function of a batch call to
+ * run one of the calls embedded in it. @msg must hold the raw packet
+ * in its buffer, with bufferLength set to its size. Only procedures
+ * marked as batchable may be invoked. Rather than being put on the
+ * tx queue, the reply packet, or the error if the call failed, is
+ * encoded into @msg for the caller to collect into the batch reply.
+ *
+ * Returns 0 if the reply was encoded, or -1 upon fatal error
+ */
+int virNetServerProgramDispatchBatched(virNetServerProgramPtr prog,
+                                       virNetServerPtr server,
+                                       virNetServerClientPtr client,
+                                       virNetMessagePtr msg)
+{
+    virNetMessageError rerr;
+
+    memset(&rerr, 0, sizeof(rerr));
+
+    if (virNetMessageDecodeHeader(msg) < 0)
+        return -1;
+
+    VIR_DEBUG("prog=%d ver=%d type=%d status=%d serial=%u proc=%d",
+              msg->header.prog, msg->header.vers, msg->header.type,
+              msg->header.status, msg->header.serial, msg->header.proc);
+
+    if (!virNetServerProgramMatches(prog, msg) ||
+        msg->header.type != VIR_NET_CALL) {
+        virReportError(VIR_ERR_RPC,
+                       _("Unexpected batched message prog=%x vers=%x type=%u"),
+                       msg->header.prog, msg->header.vers, msg->header.type);
+        return virNetServerProgramEncodeError(prog->program,
+                                              prog->version,
+                                              msg,
+                                              &rerr,
+                                              msg->header.proc,
+                                              VIR_NET_REPLY,
+                                              msg->header.serial);
+    }
+
+    return virNetServerProgramDispatchCallEncode(prog, server, client,
+                                                 msg, true);
+}
+
+
 int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
                                       virNetServerClientPtr client,
                                       virNetMessagePtr msg,
@@ -534,6 +754,49 @@ int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
 }
 
 
+/**
+ * virNetServerProgramSendStreamBuffer:
+ *
+ * Same as virNetServerProgramSendStreamData, but instead of copying
+ * *@data into @msg, the message takes over the buffer, which must have
+ * been allocated on the heap. *@data is set to NULL once that happened,
+ * so the caller can unconditionally free it afterwards.
+ */
+int virNetServerProgramSendStreamBuffer(virNetServerProgramPtr prog,
+                                        virNetServerClientPtr client,
+                                        virNetMessagePtr msg,
+                                        int procedure,
+                                        unsigned int serial,
+                                        char **data,
+                                        size_t len)
+{
+    VIR_DEBUG("client=%p msg=%p data=%p len=%zu", client, msg, *data, len);
+
+    if (!len)
+        return virNetServerProgramSendStreamData(prog, client, msg,
+                                                 procedure, serial,
+                                                 *data, len);
+
+    msg->header.prog = prog->program;
+    msg->header.vers = prog->version;
+    msg->header.proc = procedure;
+    msg->header.type = VIR_NET_STREAM;
+    msg->header.serial = serial;
+    msg->header.status = VIR_NET_CONTINUE;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        return -1;
+
+    if (virNetMessageEncodePayloadRef(msg, *data, len, true) < 0)
+        return -1;
+    *data = NULL;
+
+    VIR_DEBUG("Total %zu", msg->bufferLength);
+
+    return virNetServerClientSendMessage(client, msg);
+}
+
+
 int virNetServerProgramSendStreamHole(virNetServerProgramPtr prog,
                                       virNetServerClientPtr client,
                                       virNetMessagePtr msg,
@@ -569,6 +832,13 @@ int virNetServerProgramSendStreamHole(virNetServerProgramPtr prog,
 }
 
 
-void virNetServerProgramDispose(void *obj G_GNUC_UNUSED)
+void virNetServerProgramDispose(void *obj)
 {
+    virNetServerProgramPtr prog = obj;
+    size_t i;
+
+    for (i = 0; i < prog->nprocs; i++)
+        VIR_FREE(prog->stats[i]);
+    VIR_FREE(prog->stats);
+    virMutexDestroy(&prog->statsLock);
 }
@@ -37,6 +37,24 @@ typedef virNetServerProgram *virNetServerProgramPtr;
 typedef struct _virNetServerProgramProc virNetServerProgramProc;
 typedef virNetServerProgramProc *virNetServerProgramProcPtr;
 
+/* Bucket 0 of a latency histogram counts calls taking less than 1us,
+ * bucket i those taking at least 2^(i-1)us but less than 2^i us, and
+ * the last bucket any calls taking longer. */
+#define VIR_NET_SERVER_PROGRAM_STATS_BUCKETS 24
+
+typedef struct _virNetServerProgramProcStats virNetServerProgramProcStats;
+typedef virNetServerProgramProcStats *virNetServerProgramProcStatsPtr;
+
+struct _virNetServerProgramProcStats {
+    int proc;
+    unsigned long long calls;
+    unsigned long long errors;
+    unsigned long long bytesIn;
+    unsigned long long bytesOut;
+    unsigned long long queueTime[VIR_NET_SERVER_PROGRAM_STATS_BUCKETS];
+    unsigned long long execTime[VIR_NET_SERVER_PROGRAM_STATS_BUCKETS];
+};
+
 typedef int (*virNetServerProgramDispatchFunc)(virNetServerPtr server,
                                                virNetServerClientPtr client,
                                                virNetMessagePtr msg,
@@ -52,6 +70,7 @@ struct _virNetServerProgramProc {
     xdrproc_t ret_filter;
     bool needAuth;
     unsigned int priority;
+    bool batchable;
 };
 
 virNetServerProgramPtr virNetServerProgramNew(unsigned program,
@@ -65,6 +84,10 @@ int virNetServerProgramGetVersion(virNetServerProgramPtr prog);
 unsigned int virNetServerProgramGetPriority(virNetServerProgramPtr prog,
                                             int procedure);
 
+void virNetServerProgramGetStats(virNetServerProgramPtr prog,
+                                 virNetServerProgramProcStatsPtr *stats,
+                                 size_t *nstats);
+
 int virNetServerProgramMatches(virNetServerProgramPtr prog,
                                virNetMessagePtr msg);
 
@@ -73,6 +96,11 @@ int virNetServerProgramDispatch(virNetServerProgramPtr prog,
                                 virNetServerClientPtr client,
                                 virNetMessagePtr msg);
 
+int virNetServerProgramDispatchBatched(virNetServerProgramPtr prog,
+                                       virNetServerPtr server,
+                                       virNetServerClientPtr client,
+                                       virNetMessagePtr msg);
+
 int virNetServerProgramSendReplyError(virNetServerProgramPtr prog,
                                       virNetServerClientPtr client,
                                       virNetMessagePtr msg,
@@ -98,6 +126,14 @@ int virNetServerProgramSendStreamData(virNetServerProgramPtr prog,
                                       const char *data,
                                       size_t len);
 
+int virNetServerProgramSendStreamBuffer(virNetServerProgramPtr prog,
+                                        virNetServerClientPtr client,
+                                        virNetMessagePtr msg,
+                                        int procedure,
+                                        unsigned int serial,
+                                        char **data,
+                                        size_t len);
+
 int virNetServerProgramSendStreamHole(virNetServerProgramPtr prog,
                                       virNetServerClientPtr client,
                                       virNetMessagePtr msg,
@@ -25,6 +25,9 @@
 #include <unistd.h>
 #include <signal.h>
 #include <fcntl.h>
+#ifndef WIN32
+# include <sys/uio.h>
+#endif
 #ifdef HAVE_IFADDRS_H
 # include <ifaddrs.h>
 #endif
@@ -2034,6 +2037,105 @@ ssize_t virNetSocketWrite(virNetSocketPtr sock, const char *buf, size_t len)
 }
 
 
+#ifndef WIN32
+# define VIR_NET_SOCKET_IOV_MAX 8
+
+static ssize_t
+virNetSocketWriteVectorWire(virNetSocketPtr sock,
+                            const GOutputVector *vec,
+                            size_t nvec)
+{
+    struct iovec iov[VIR_NET_SOCKET_IOV_MAX];
+    ssize_t ret;
+    size_t i;
+
+    /* A short write is fine, the caller retries with the rest */
+    if (nvec > VIR_NET_SOCKET_IOV_MAX)
+        nvec = VIR_NET_SOCKET_IOV_MAX;
+
+    for (i = 0; i < nvec; i++) {
+        iov[i].iov_base = (void *) vec[i].buffer;
+        iov[i].iov_len = vec[i].size;
+    }
+
+ rewrite:
+    ret = writev(sock->fd, iov, nvec);
+
+    if (ret < 0) {
+        if (errno == EINTR)
+            goto rewrite;
+        if (errno == EAGAIN)
+            return 0;
+
+        virReportSystemError(errno, "%s",
+                             _("Cannot write data"));
+        return -1;
+    }
+    if (ret == 0) {
+        virReportSystemError(EIO, "%s",
+                             _("End of file while writing data"));
+        return -1;
+    }
+
+    return ret;
+}
+#endif /* !WIN32 */
+
+
+/**
+ * virNetSocketWriteVector:
+ * @sock: socket to write to
+ * @vec: buffers to write
+ * @nvec: number of entries in @vec
+ *
+ * Writes the buffers described by @vec in order, like a sequence of
+ * virNetSocketWrite calls. On plain sockets this is done with a single
+ * writev() call. Transports which need to process the data first (TLS,
+ * SASL, SSH) only get the first buffer, relying on the caller to come
+ * back with the rest.
+ *
+ * Returns the number of bytes written, 0 if the write would block, or
+ * -1 on error.
+ */
+ssize_t virNetSocketWriteVector(virNetSocketPtr sock,
+                                const GOutputVector *vec,
+                                size_t nvec)
+{
+    ssize_t ret;
+
+    if (nvec == 0)
+        return 0;
+
+    virObjectLock(sock);
+#ifndef WIN32
+    if (nvec > 1 &&
+# if WITH_SSH2
+        !sock->sshSession &&
+# endif
+# if WITH_LIBSSH
+        !sock->libsshSession &&
+# endif
+# if WITH_SASL
+        !sock->saslSession &&
+# endif
+        !sock->tlsSession) {
+        ret = virNetSocketWriteVectorWire(sock, vec, nvec);
+        virObjectUnlock(sock);
+        return ret;
+    }
+#endif /* !WIN32 */
+
+#if WITH_SASL
+    if (sock->saslSession)
+        ret = virNetSocketWriteSASL(sock, vec[0].buffer, vec[0].size);
+    else
+#endif
+        ret = virNetSocketWriteWire(sock, vec[0].buffer, vec[0].size);
+    virObjectUnlock(sock);
+    return ret;
+}
+
+
 /*
  * Returns 1 if an FD was sent, 0 if it would block, -1 on error
  */
@@ -32,6 +32,7 @@
 #include "viralloc.h"
 #include "virerror.h"
 #include "virfile.h"
+#include "virhash.h"
 #include "virutil.h"
 #include "virlog.h"
 #include "virprobe.h"
@@ -40,6 +41,10 @@
 
 #define DH_BITS 2048
 
+/* Upper bound of remembered client sessions, the cache is dropped
+ * completely once it's reached */
+#define VIR_NET_TLS_SESSION_CACHE_MAX 64
+
 #define LIBVIRT_PKI_DIR SYSCONFDIR "/pki"
 #define LIBVIRT_CACERT LIBVIRT_PKI_DIR "/CA/cacert.pem"
 #define LIBVIRT_CACRL LIBVIRT_PKI_DIR "/CA/cacrl.pem"
@@ -62,6 +67,11 @@ struct _virNetTLSContext {
     bool requireValidCert;
     const char *const *x509dnACL;
     char *priority;
+
+    /* key for encrypting session tickets, server only */
+    gnutls_datum_t ticketKey;
+    /* hostname -> gnutls_datum_t data of the last session, client only */
+    virHashTablePtr sessions;
 };
 
 struct _virNetTLSSession {
@@ -71,6 +81,9 @@ struct _virNetTLSSession {
 
     bool isServer;
     char *hostname;
+    /* context the session data is stored to for resumption, client only */
+    virNetTLSContextPtr ctxt;
+    bool resumable;
     gnutls_session_t session;
     virNetTLSSessionWriteFunc writeFunc;
     virNetTLSSessionReadFunc readFunc;
@@ -84,6 +97,19 @@ static void virNetTLSContextDispose(void *obj);
 static void virNetTLSSessionDispose(void *obj);
 
 
+static void
+virNetTLSSessionDataFree(void *opaque)
+{
+    gnutls_datum_t *data = opaque;
+
+    if (!data)
+        return;
+
+    gnutls_free(data->data);
+    g_free(data);
+}
+
+
 static int virNetTLSContextOnceInit(void)
 {
     if (!VIR_CLASS_NEW(virNetTLSContext, virClassForObjectLockable()))
@@ -737,6 +763,19 @@ static virNetTLSContextPtr virNetTLSContextNew(const char *cacert,
 
         gnutls_certificate_set_dh_params(ctxt->x509cred,
                                          ctxt->dhParams);
+
+        /* Let clients resume their sessions with an abbreviated
+         * handshake. The key lives as long as the context, so tickets
+         * stay valid across reloads of the certificates. */
+        err = gnutls_session_ticket_key_generate(&ctxt->ticketKey);
+        if (err < 0) {
+            virReportError(VIR_ERR_SYSTEM_ERROR,
+                           _("Unable to generate TLS session ticket key: %s"),
+                           gnutls_strerror(err));
+            goto error;
+        }
+    } else {
+        ctxt->sessions = virHashNew(virNetTLSSessionDataFree);
     }
 
     ctxt->requireValidCert = requireValidCert;
@@ -1132,6 +1171,9 @@ int virNetTLSContextCheckCertificate(virNetTLSContextPtr ctxt,
         VIR_INFO("Ignoring bad certificate at user request");
     }
 
+    /* only sessions with trusted peers are worth resuming */
+    sess->resumable = true;
+
     ret = 0;
 
  cleanup:
@@ -1149,11 +1191,49 @@ void virNetTLSContextDispose(void *obj)
           "ctxt=%p", ctxt);
 
     VIR_FREE(ctxt->priority);
+    virHashFree(ctxt->sessions);
+    if (ctxt->ticketKey.data) {
+        memset(ctxt->ticketKey.data, 0, ctxt->ticketKey.size);
+        gnutls_free(ctxt->ticketKey.data);
+    }
     gnutls_dh_params_deinit(ctxt->dhParams);
     gnutls_certificate_free_credentials(ctxt->x509cred);
 }
 
 
+/*
+ * Remembers the parameters of the client session @sess, so that the next
+ * session to the same host can be resumed instead of doing a full
+ * handshake.
+ */
+static void
+virNetTLSContextStoreSession(virNetTLSContextPtr ctxt,
+                             virNetTLSSessionPtr sess)
+{
+    gnutls_datum_t *data;
+    int err;
+
+    data = g_new0(gnutls_datum_t, 1);
+
+    if ((err = gnutls_session_get_data2(sess->session, data)) < 0) {
+        VIR_DEBUG("Unable to get TLS session data for %s: %s",
+                  sess->hostname, gnutls_strerror(err));
+        g_free(data);
+        return;
+    }
+
+    virObjectLock(ctxt);
+    if (virHashSize(ctxt->sessions) >= VIR_NET_TLS_SESSION_CACHE_MAX)
+        virHashRemoveAll(ctxt->sessions);
+
+    if (virHashUpdateEntry(ctxt->sessions, sess->hostname, data) < 0) {
+        virNetTLSSessionDataFree(data);
+        virResetLastError();
+    }
+    virObjectUnlock(ctxt);
+}
+
+
 static ssize_t
 virNetTLSSessionPush(void *opaque, const void *buf, size_t len)
 {
@@ -1234,6 +1314,30 @@ virNetTLSSessionPtr virNetTLSSessionNew(virNetTLSContextPtr ctxt,
         gnutls_certificate_server_set_request(sess->session, GNUTLS_CERT_REQUEST);
 
         gnutls_dh_set_prime_bits(sess->session, DH_BITS);
+
+        if ((err = gnutls_session_ticket_enable_server(sess->session,
+                                                       &ctxt->ticketKey)) != 0) {
+            virReportError(VIR_ERR_SYSTEM_ERROR,
+                           _("Failed to enable TLS session tickets: %s"),
+                           gnutls_strerror(err));
+            goto error;
+        }
+    } else if (hostname) {
+        gnutls_datum_t *data;
+
+        virObjectLock(ctxt);
+        if ((data = virHashLookup(ctxt->sessions, hostname))) {
+            VIR_DEBUG("Trying to resume TLS session with %s", hostname);
+            if ((err = gnutls_session_set_data(sess->session,
+                                               data->data, data->size)) != 0) {
+                VIR_DEBUG("Unable to resume TLS session: %s",
+                          gnutls_strerror(err));
+                virHashRemoveEntry(ctxt->sessions, hostname);
+            }
+        }
+        virObjectUnlock(ctxt);
+
+        sess->ctxt = virObjectRef(ctxt);
     }
 
     gnutls_transport_set_ptr(sess->session, sess);
@@ -1341,7 +1445,8 @@ int virNetTLSSessionHandshake(virNetTLSSessionPtr sess)
     VIR_DEBUG("Ret=%d", ret);
     if (ret == 0) {
         sess->handshakeComplete = true;
-        VIR_DEBUG("Handshake is complete");
+        VIR_DEBUG("Handshake is complete, session %s",
+                  gnutls_session_is_resumed(sess->session) ? "resumed" : "new");
         goto cleanup;
     }
     if (ret == GNUTLS_E_INTERRUPTED || ret == GNUTLS_E_AGAIN) {
@@ -1417,6 +1522,12 @@ void virNetTLSSessionDispose(void *obj)
     PROBE(RPC_TLS_SESSION_DISPOSE,
           "sess=%p", sess);
 
+    /* TLS 1.3 servers send session tickets after the handshake, so the
+     * session data is only complete once the session is done */
+    if (sess->ctxt && sess->resumable && sess->hostname)
+        virNetTLSContextStoreSession(sess->ctxt, sess);
+    virObjectUnref(sess->ctxt);
+
     VIR_FREE(sess->x509dname);
     VIR_FREE(sess->hostname);
     gnutls_deinit(sess->session);
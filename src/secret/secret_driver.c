@@ -49,6 +49,9 @@ VIR_LOG_INIT("secret.secret_driver");
 
 enum { SECRET_MAX_XML_FILE = 10*1024*1024 };
 
+#define SECRET_STORE_FILE "secrets.store"
+#define SECRET_STORE_KEY_FILE "secrets-encryption-key"
+
 /* Internal driver state */
 
 typedef struct _virSecretDriverState virSecretDriverState;
@@ -453,6 +456,30 @@ secretStateCleanup(void)
 }
 
 
+/*
+ * Persistent secrets are kept in a single encrypted store rather than in
+ * separate files if the administrator provided a key for it.
+ */
+static int
+secretStateOpenStore(void)
+{
+    g_autoptr(virSecretStore) store = NULL;
+    g_autofree char *keyFile = NULL;
+    g_autofree char *storeFile = NULL;
+
+    keyFile = virFileBuildPath(driver->configDir, SECRET_STORE_KEY_FILE, NULL);
+    if (!virFileExists(keyFile))
+        return 0;
+
+    storeFile = virFileBuildPath(driver->configDir, SECRET_STORE_FILE, NULL);
+    if (!(store = virSecretStoreOpen(storeFile, keyFile)))
+        return -1;
+
+    virSecretObjListSetStore(driver->secrets, store);
+    return 0;
+}
+
+
 static int
 secretStateInitialize(bool privileged,
                       const char *root,
@@ -509,6 +536,9 @@ secretStateInitialize(bool privileged,
     if (!(driver->secrets = virSecretObjListNew()))
         goto error;
 
+    if (secretStateOpenStore() < 0)
+        goto error;
+
     if (virSecretLoadAllConfigs(driver->secrets, driver->configDir) < 0)
         goto error;
 
@@ -233,6 +233,27 @@ static int virSecuritySELinuxRestoreFileLabel(virSecurityManagerPtr mgr,
                                               bool recall);
 
 
+static int
+virSecuritySELinuxTransactionRunItem(size_t i,
+                                     void *opaque)
+{
+    virSecuritySELinuxContextListPtr list = opaque;
+    virSecuritySELinuxContextItemPtr item = list->items[i];
+    const bool remember = item->remember && list->lock;
+
+    if (!item->restore) {
+        return virSecuritySELinuxSetFilecon(list->manager,
+                                            item->path,
+                                            item->tcon,
+                                            remember);
+    }
+
+    return virSecuritySELinuxRestoreFileLabel(list->manager,
+                                              item->path,
+                                              remember);
+}
+
+
 /**
  * virSecuritySELinuxTransactionRun:
  * @pid: process pid
@@ -240,7 +261,7 @@ static int virSecuritySELinuxRestoreFileLabel(virSecurityManagerPtr mgr,
  *
  * This is the callback that runs in the same namespace as the domain we are
  * relabelling. For given transaction (@opaque) it relabels all the paths on
- * the list.
+ * the list, distinct paths concurrently.
  *
  * Returns: 0 on success
  *         -1 otherwise.
@@ -253,6 +274,8 @@ virSecuritySELinuxTransactionRun(pid_t pid G_GNUC_UNUSED,
     virSecurityManagerMetadataLockStatePtr state;
     const char **paths = NULL;
     size_t npaths = 0;
+    g_autofree const char **itemPaths = NULL;
+    g_autofree int *results = NULL;
     size_t i;
     int rv;
     int ret = -1;
@@ -287,30 +310,23 @@ virSecuritySELinuxTransactionRun(pid_t pid G_GNUC_UNUSED,
         }
     }
 
-    rv = 0;
-    for (i = 0; i < list->nItems; i++) {
-        virSecuritySELinuxContextItemPtr item = list->items[i];
-        const bool remember = item->remember && list->lock;
-
-        if (!item->restore) {
-            rv = virSecuritySELinuxSetFilecon(list->manager,
-                                              item->path,
-                                              item->tcon,
-                                              remember);
-        } else {
-            rv = virSecuritySELinuxRestoreFileLabel(list->manager,
-                                                    item->path,
-                                                    remember);
-        }
+    itemPaths = g_new0(const char *, list->nItems);
+    results = g_new0(int, list->nItems);
+    for (i = 0; i < list->nItems; i++)
+        itemPaths[i] = list->items[i]->path;
 
-        if (rv < 0)
-            break;
-    }
+    rv = virSecurityParallelRun(itemPaths, list->nItems,
+                                virSecuritySELinuxTransactionRunItem,
+                                list, results);
 
-    for (; rv < 0 && i > 0; i--) {
+    /* roll back items which succeeded */
+    for (i = list->nItems; rv < 0 && i > 0; i--) {
         virSecuritySELinuxContextItemPtr item = list->items[i - 1];
         const bool remember = item->remember && list->lock;
 
+        if (results[i - 1] != 0)
+            continue;
+
         if (!item->restore) {
             virSecuritySELinuxRestoreFileLabel(list->manager,
                                                item->path,
@@ -1257,9 +1273,23 @@ virSecuritySELinuxSetFileconImpl(const char *path,
                                  const char *tcon,
                                  bool privileged)
 {
+    char *econ = NULL;
+
     /* Be aware that this function might run in a separate process.
      * Therefore, any driver state changes would be thrown away. */
 
+    /* Looking the label up is much cheaper than changing it,
+     * especially on network filesystems */
+    if (getfilecon_raw(path, &econ) >= 0 && econ) {
+        bool same = STREQ(econ, tcon);
+
+        freecon(econ);
+        if (same) {
+            VIR_DEBUG("SELinux context on '%s' is '%s' already", path, tcon);
+            return 0;
+        }
+    }
+
     VIR_INFO("Setting SELinux context on '%s' to '%s'", path, tcon);
 
     if (setfilecon_raw(path, (const char *)tcon) < 0) {
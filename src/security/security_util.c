@@ -25,6 +25,7 @@
 #include "virlog.h"
 #include "viruuid.h"
 #include "virhostuptime.h"
+#include "virthread.h"
 
 #include "security_util.h"
 
@@ -525,3 +526,157 @@ virSecurityMoveRememberedLabel(const char *name,
 
     return 0;
 }
+
+
+/* Upper limit of threads relabeling the paths of one transaction */
+#define VIR_SECURITY_PARALLEL_THREADS 8
+
+typedef struct _virSecurityParallelData virSecurityParallelData;
+typedef virSecurityParallelData *virSecurityParallelDataPtr;
+struct _virSecurityParallelData {
+    virMutex lock;
+    const char **paths;
+    size_t nitems;
+    size_t next; /* protected by @lock */
+    virErrorPtr error; /* protected by @lock */
+
+    virSecurityParallelCallback cb;
+    void *opaque;
+    int *results;
+};
+
+
+/* Items sharing their path with an earlier one are processed along
+ * with that one */
+static bool
+virSecurityParallelIsFirst(virSecurityParallelDataPtr data,
+                           size_t item)
+{
+    size_t i;
+
+    if (!data->paths[item])
+        return true;
+
+    for (i = 0; i < item; i++) {
+        if (STREQ_NULLABLE(data->paths[i], data->paths[item]))
+            return false;
+    }
+
+    return true;
+}
+
+
+static void
+virSecurityParallelWorker(void *opaque)
+{
+    virSecurityParallelDataPtr data = opaque;
+
+    while (true) {
+        size_t first;
+        size_t i;
+
+        virMutexLock(&data->lock);
+        while (data->next < data->nitems &&
+               !virSecurityParallelIsFirst(data, data->next))
+            data->next++;
+        first = data->next++;
+        virMutexUnlock(&data->lock);
+
+        if (first >= data->nitems)
+            break;
+
+        for (i = first; i < data->nitems; i++) {
+            if (i != first &&
+                (!data->paths[first] ||
+                 STRNEQ_NULLABLE(data->paths[i], data->paths[first])))
+                continue;
+
+            if ((data->results[i] = data->cb(i, data->opaque)) < 0) {
+                virErrorPtr err;
+
+                virErrorPreserveLast(&err);
+                virMutexLock(&data->lock);
+                if (!data->error)
+                    data->error = g_steal_pointer(&err);
+                virMutexUnlock(&data->lock);
+                virFreeError(err);
+                break;
+            }
+        }
+    }
+}
+
+
+/**
+ * virSecurityParallelRun:
+ * @paths: path each item operates on, NULL if unknown
+ * @nitems: number of items
+ * @cb: callback processing one item
+ * @opaque: data passed to @cb
+ * @results: filled with the return value of @cb for each item
+ *
+ * Processes @nitems items by calling @cb on each of them, items with
+ * distinct @paths concurrently. Items sharing a path are processed in
+ * their original order by a single thread, which stops at the first
+ * failing one. Items which were not processed have 1 stored in @results.
+ *
+ * Returns 0 if all items succeeded, -1 with the error of a failed item
+ * set otherwise.
+ */
+int
+virSecurityParallelRun(const char **paths,
+                       size_t nitems,
+                       virSecurityParallelCallback cb,
+                       void *opaque,
+                       int *results)
+{
+    virSecurityParallelData data = {
+        .paths = paths, .nitems = nitems,
+        .cb = cb, .opaque = opaque, .results = results,
+    };
+    g_autofree virThread *threads = NULL;
+    size_t nthreads = 0;
+    size_t ngroups = 0;
+    size_t i;
+
+    for (i = 0; i < nitems; i++) {
+        results[i] = 1;
+        if (virSecurityParallelIsFirst(&data, i))
+            ngroups++;
+    }
+
+    if (virMutexInit(&data.lock) < 0) {
+        virReportSystemError(errno, "%s", _("unable to init mutex"));
+        return -1;
+    }
+
+    /* the calling thread works too */
+    ngroups = MIN(ngroups, VIR_SECURITY_PARALLEL_THREADS);
+    if (ngroups > 1)
+        threads = g_new0(virThread, ngroups - 1);
+
+    for (i = 0; i + 1 < ngroups; i++) {
+        if (virThreadCreateFull(&threads[nthreads], true,
+                                virSecurityParallelWorker, "sec-relabel",
+                                false, &data) < 0) {
+            VIR_DEBUG("Unable to create relabeling thread, continuing "
+                      "with %zu", nthreads + 1);
+            break;
+        }
+        nthreads++;
+    }
+
+    virSecurityParallelWorker(&data);
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    virMutexDestroy(&data.lock);
+
+    if (data.error) {
+        virErrorRestore(&data.error);
+        return -1;
+    }
+
+    return 0;
+}
@@ -32,3 +32,13 @@ int
 virSecurityMoveRememberedLabel(const char *name,
                                const char *src,
                                const char *dst);
+
+typedef int (*virSecurityParallelCallback)(size_t item,
+                                           void *opaque);
+
+int
+virSecurityParallelRun(const char **paths,
+                       size_t nitems,
+                       virSecurityParallelCallback cb,
+                       void *opaque,
+                       int *results);
@@ -105,6 +105,9 @@ struct _virStorageBackend {
     virStorageBackendStartPool startPool;
     virStorageBackendBuildPool buildPool;
     virStorageBackendRefreshPool refreshPool; /* Must be non-NULL */
+    /* refreshPool updates the existing volume list itself rather than
+     * expecting it to be cleared beforehand */
+    bool refreshKeepsVolumes;
     virStorageBackendStopPool stopPool;
     virStorageBackendDeletePool deletePool;
 
@@ -636,6 +636,7 @@ virStorageBackend virStorageBackendDirectory = {
     .buildPool = virStorageBackendFileSystemBuild,
     .checkPool = virStorageBackendFileSystemCheck,
     .refreshPool = virStorageBackendRefreshLocal,
+    .refreshKeepsVolumes = true,
     .deletePool = virStorageBackendDeleteLocal,
     .buildVol = virStorageBackendVolBuildLocal,
     .buildVolFrom = virStorageBackendVolBuildFromLocal,
@@ -656,6 +657,7 @@ virStorageBackend virStorageBackendFileSystem = {
     .checkPool = virStorageBackendFileSystemCheck,
     .startPool = virStorageBackendFileSystemStart,
     .refreshPool = virStorageBackendRefreshLocal,
+    .refreshKeepsVolumes = true,
     .stopPool = virStorageBackendFileSystemStop,
     .deletePool = virStorageBackendDeleteLocal,
     .buildVol = virStorageBackendVolBuildLocal,
@@ -676,6 +678,7 @@ virStorageBackend virStorageBackendNetFileSystem = {
     .startPool = virStorageBackendFileSystemStart,
     .findPoolSources = virStorageBackendFileSystemNetFindPoolSources,
     .refreshPool = virStorageBackendRefreshLocal,
+    .refreshKeepsVolumes = true,
     .stopPool = virStorageBackendFileSystemStop,
     .deletePool = virStorageBackendDeleteLocal,
     .buildVol = virStorageBackendVolBuildLocal,
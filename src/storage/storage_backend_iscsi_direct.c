@@ -20,6 +20,7 @@
 
 #include <config.h>
 
+#include <poll.h>
 #include <iscsi/iscsi.h>
 #include <iscsi/scsi-lowlevel.h>
 
@@ -29,9 +30,11 @@
 #include "storage_util.h"
 #include "viralloc.h"
 #include "virerror.h"
+#include "virhash.h"
 #include "virlog.h"
 #include "virobject.h"
 #include "virstring.h"
+#include "virthread.h"
 #include "virtime.h"
 #include "viruuid.h"
 
@@ -40,10 +43,47 @@
 #define ISCSI_DEFAULT_TARGET_PORT 3260
 #define VIR_ISCSI_TEST_UNIT_TIMEOUT 30 * 1000
 #define BLOCK_PER_PACKET 128
+#define WRITE_SAME_MAX_BLOCKS 65535
 #define VOL_NAME_PREFIX "unit:0:0:"
+/* Time to wait for the replies to commands sent to all the LUNs at once */
+#define VIR_ISCSI_ASYNC_TIMEOUT 30 * 1000
+/* Sessions idle for longer than this many seconds are checked to still
+ * work before they are used again */
+#define VIR_ISCSI_SESSION_IDLE_CHECK 30
 
 VIR_LOG_INIT("storage.storage_backend_iscsi_direct");
 
+typedef struct _virISCSIDirectSession virISCSIDirectSession;
+typedef virISCSIDirectSession *virISCSIDirectSessionPtr;
+struct _virISCSIDirectSession {
+    virObjectLockable parent;
+
+    struct iscsi_context *iscsi;
+    char *portal;
+    time_t lastused;
+};
+
+static virClassPtr virISCSIDirectSessionClass;
+static void virISCSIDirectSessionDispose(void *obj);
+
+/* Logged in sessions of active pools, keyed by pool UUID */
+static virHashTablePtr virISCSIDirectSessions;
+static virMutex virISCSIDirectSessionsLock = VIR_MUTEX_INITIALIZER;
+
+static int
+virISCSIDirectSessionOnceInit(void)
+{
+    if (!VIR_CLASS_NEW(virISCSIDirectSession, virClassForObjectLockable()))
+        return -1;
+
+    if (!(virISCSIDirectSessions = virHashNew(virObjectFreeHashData)))
+        return -1;
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virISCSIDirectSession);
+
 static struct iscsi_context *
 virISCSIDirectCreateContext(const char* initiator_iqn)
 {
@@ -295,34 +335,231 @@ virISCSIDirectGetVolumeCapacity(struct iscsi_context *iscsi,
     return ret;
 }
 
+typedef enum {
+    VIR_ISCSI_DIRECT_CMD_TEST_UNIT_READY,
+    VIR_ISCSI_DIRECT_CMD_INQUIRY,
+    VIR_ISCSI_DIRECT_CMD_READ_CAPACITY,
+} virISCSIDirectCommand;
+
+typedef struct _virISCSIDirectLun virISCSIDirectLun;
+typedef virISCSIDirectLun *virISCSIDirectLunPtr;
+struct _virISCSIDirectLun {
+    int lun;
+    bool directAccess;
+    uint32_t block_size;
+    uint64_t nb_block;
+
+    /* state of the command in flight */
+    struct scsi_task *task;
+    size_t *pending;
+};
+
+
+static void
+virISCSIDirectLunCallback(struct iscsi_context *iscsi G_GNUC_UNUSED,
+                          int status G_GNUC_UNUSED,
+                          void *command_data,
+                          void *private_data)
+{
+    virISCSIDirectLunPtr lun = private_data;
+
+    lun->task = command_data;
+    (*lun->pending)--;
+}
+
+
+/*
+ * Sends @cmd to all the @luns at once and waits for all the replies,
+ * which are left in the task of every LUN. Only LUNs with direct access
+ * are sent VIR_ISCSI_DIRECT_CMD_READ_CAPACITY.
+ *
+ * On failure commands may still be in flight and the caller must
+ * destroy the iSCSI context before freeing @luns.
+ */
+static int
+virISCSIDirectLunsRun(struct iscsi_context *iscsi,
+                      virISCSIDirectLunPtr luns,
+                      size_t nluns,
+                      virISCSIDirectCommand cmd)
+{
+    size_t pending = 0;
+    size_t i;
+
+    for (i = 0; i < nluns; i++) {
+        virISCSIDirectLunPtr lun = &luns[i];
+        struct scsi_task *task = NULL;
+
+        scsi_free_scsi_task(lun->task);
+        lun->task = NULL;
+        lun->pending = &pending;
+
+        switch (cmd) {
+        case VIR_ISCSI_DIRECT_CMD_TEST_UNIT_READY:
+            task = iscsi_testunitready_task(iscsi, lun->lun,
+                                            virISCSIDirectLunCallback, lun);
+            break;
+        case VIR_ISCSI_DIRECT_CMD_INQUIRY:
+            task = iscsi_inquiry_task(iscsi, lun->lun, 0, 0, 64,
+                                      virISCSIDirectLunCallback, lun);
+            break;
+        case VIR_ISCSI_DIRECT_CMD_READ_CAPACITY:
+            if (!lun->directAccess)
+                continue;
+            task = iscsi_readcapacity16_task(iscsi, lun->lun,
+                                             virISCSIDirectLunCallback, lun);
+            break;
+        }
+
+        if (!task) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Failed to send command to lun %d: %s"),
+                           lun->lun, iscsi_get_error(iscsi));
+            return -1;
+        }
+
+        pending++;
+    }
+
+    while (pending > 0) {
+        struct pollfd pfd = {
+            .fd = iscsi_get_fd(iscsi),
+            .events = iscsi_which_events(iscsi),
+        };
+        int rc = poll(&pfd, 1, VIR_ISCSI_ASYNC_TIMEOUT);
+
+        if (rc < 0 && errno == EINTR)
+            continue;
+
+        if (rc <= 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Failed to wait for %zu replies: %s"), pending,
+                           rc < 0 ? g_strerror(errno) : _("timed out"));
+            return -1;
+        }
+
+        if (iscsi_service(iscsi, pfd.revents) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Failed to process replies: %s"),
+                           iscsi_get_error(iscsi));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * Finds the capacity of all the @luns with one round trip per command
+ * rather than one per LUN and command.
+ */
+static int
+virISCSIDirectLunsGetCapacity(struct iscsi_context *iscsi,
+                              virISCSIDirectLunPtr luns,
+                              size_t nluns)
+{
+    size_t i;
+
+    if (virISCSIDirectLunsRun(iscsi, luns, nluns,
+                              VIR_ISCSI_DIRECT_CMD_TEST_UNIT_READY) < 0)
+        return -1;
+
+    for (i = 0; i < nluns; i++) {
+        struct scsi_task *task = luns[i].task;
+
+        if (task && task->status == SCSI_STATUS_GOOD)
+            continue;
+
+        /* Let the synchronous variant wait for units just reset */
+        if (task && task->status == SCSI_STATUS_CHECK_CONDITION &&
+            task->sense.key == SCSI_SENSE_UNIT_ATTENTION &&
+            task->sense.ascq == SCSI_SENSE_ASCQ_BUS_RESET) {
+            if (virISCSIDirectTestUnitReady(iscsi, luns[i].lun) < 0)
+                return -1;
+            continue;
+        }
+
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Failed testunitready: %s"),
+                       iscsi_get_error(iscsi));
+        return -1;
+    }
+
+    if (virISCSIDirectLunsRun(iscsi, luns, nluns,
+                              VIR_ISCSI_DIRECT_CMD_INQUIRY) < 0)
+        return -1;
+
+    for (i = 0; i < nluns; i++) {
+        struct scsi_inquiry_standard *inq = NULL;
+
+        if (!luns[i].task || luns[i].task->status != SCSI_STATUS_GOOD) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Failed to send inquiry command: %s"),
+                           iscsi_get_error(iscsi));
+            return -1;
+        }
+
+        if (!(inq = scsi_datain_unmarshall(luns[i].task))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Failed to unmarshall reply: %s"),
+                           iscsi_get_error(iscsi));
+            return -1;
+        }
+
+        luns[i].directAccess = inq->device_type == SCSI_INQUIRY_PERIPHERAL_DEVICE_TYPE_DIRECT_ACCESS;
+    }
+
+    if (virISCSIDirectLunsRun(iscsi, luns, nluns,
+                              VIR_ISCSI_DIRECT_CMD_READ_CAPACITY) < 0)
+        return -1;
+
+    for (i = 0; i < nluns; i++) {
+        struct scsi_readcapacity16 *rc16 = NULL;
+
+        if (!luns[i].directAccess)
+            continue;
+
+        if (!luns[i].task || luns[i].task->status != SCSI_STATUS_GOOD) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Failed to get capacity of lun: %s"),
+                           iscsi_get_error(iscsi));
+            return -1;
+        }
+
+        if (!(rc16 = scsi_datain_unmarshall(luns[i].task))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Failed to unmarshall reply: %s"),
+                           iscsi_get_error(iscsi));
+            return -1;
+        }
+
+        luns[i].block_size = rc16->block_length;
+        luns[i].nb_block = rc16->returned_lba;
+    }
+
+    return 0;
+}
+
+
 static int
 virISCSIDirectRefreshVol(virStoragePoolObjPtr pool,
-                         struct iscsi_context *iscsi,
-                         int lun,
+                         virISCSIDirectLunPtr lun,
                          char *portal)
 {
     virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
-    uint32_t block_size;
-    uint64_t nb_block;
     g_autoptr(virStorageVolDef) vol = NULL;
 
-    if (virISCSIDirectTestUnitReady(iscsi, lun) < 0)
-        return -1;
-
     if (VIR_ALLOC(vol) < 0)
         return -1;
 
     vol->type = VIR_STORAGE_VOL_NETWORK;
 
-    if (virISCSIDirectGetVolumeCapacity(iscsi, lun, &block_size, &nb_block) < 0)
-        return -1;
-
-    vol->target.capacity = block_size * nb_block;
-    vol->target.allocation = block_size * nb_block;
+    vol->target.capacity = lun->block_size * lun->nb_block;
+    vol->target.allocation = lun->block_size * lun->nb_block;
     def->capacity += vol->target.capacity;
     def->allocation += vol->target.allocation;
 
-    if (virISCSIDirectSetVolumeAttributes(pool, vol, lun, portal) < 0)
+    if (virISCSIDirectSetVolumeAttributes(pool, vol, lun->lun, portal) < 0)
         return -1;
 
     if (virStoragePoolObjAddVol(pool, vol) < 0)
@@ -334,12 +571,14 @@ virISCSIDirectRefreshVol(virStoragePoolObjPtr pool,
 
 static int
 virISCSIDirectReportLuns(virStoragePoolObjPtr pool,
-                         struct iscsi_context *iscsi,
-                         char *portal)
+                         virISCSIDirectSessionPtr session)
 {
     virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
+    struct iscsi_context *iscsi = session->iscsi;
     struct scsi_task *task = NULL;
     struct scsi_reportluns_list *list = NULL;
+    g_autofree virISCSIDirectLunPtr luns = NULL;
+    size_t nluns = 0;
     int full_size;
     size_t i;
     int ret = -1;
@@ -370,15 +609,31 @@ virISCSIDirectReportLuns(virStoragePoolObjPtr pool,
         goto cleanup;
     }
 
+    nluns = list->num;
+    luns = g_new0(virISCSIDirectLun, nluns);
+    for (i = 0; i < nluns; i++)
+        luns[i].lun = list->luns[i];
+
+    if (virISCSIDirectLunsGetCapacity(iscsi, luns, nluns) < 0)
+        goto cleanup;
+
     def->capacity = 0;
     def->allocation = 0;
-    for (i = 0; i < list->num; i++) {
-        if (virISCSIDirectRefreshVol(pool, iscsi, list->luns[i], portal) < 0)
+    for (i = 0; i < nluns; i++) {
+        if (virISCSIDirectRefreshVol(pool, &luns[i], session->portal) < 0)
             goto cleanup;
     }
 
     ret = 0;
  cleanup:
+    /* Commands may still be in flight after a failure, don't let their
+     * replies land in freed memory */
+    if (ret < 0 && luns) {
+        iscsi_destroy_context(iscsi);
+        session->iscsi = NULL;
+    }
+    for (i = 0; i < nluns; i++)
+        scsi_free_scsi_task(luns[i].task);
     scsi_free_scsi_task(task);
     return ret;
 }
@@ -579,21 +834,151 @@ virStorageBackendISCSIDirectSetConnection(virStoragePoolObjPtr pool,
     return NULL;
 }
 
+static void
+virISCSIDirectSessionClose(virISCSIDirectSessionPtr session)
+{
+    virErrorPtr orig_err;
+
+    if (!session->iscsi)
+        return;
+
+    virErrorPreserveLast(&orig_err);
+    virISCSIDirectDisconnect(session->iscsi);
+    virErrorRestore(&orig_err);
+
+    iscsi_destroy_context(session->iscsi);
+    session->iscsi = NULL;
+}
+
+
+static void
+virISCSIDirectSessionDispose(void *obj)
+{
+    virISCSIDirectSessionPtr session = obj;
+
+    virISCSIDirectSessionClose(session);
+    g_free(session->portal);
+}
+
+
+/*
+ * Drops the cached session of @pool, if any. It is logged out once the
+ * operations still using it finish.
+ */
+static void
+virISCSIDirectSessionEvict(virStoragePoolObjPtr pool)
+{
+    virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (virISCSIDirectSessionInitialize() < 0)
+        return;
+
+    virUUIDFormat(def->uuid, uuidstr);
+
+    virMutexLock(&virISCSIDirectSessionsLock);
+    ignore_value(virHashRemoveEntry(virISCSIDirectSessions, uuidstr));
+    virMutexUnlock(&virISCSIDirectSessionsLock);
+}
+
+
+/*
+ * Returns the locked session of @pool, logging in unless the pool has a
+ * session which is still alive. A libiscsi context can't be used by
+ * multiple threads, so operations on the pool are serialized on the
+ * session. Release it with virISCSIDirectSessionRelease.
+ */
+static virISCSIDirectSessionPtr
+virISCSIDirectSessionAcquire(virStoragePoolObjPtr pool)
+{
+    virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
+    virISCSIDirectSessionPtr session;
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (virISCSIDirectSessionInitialize() < 0)
+        return NULL;
+
+    virUUIDFormat(def->uuid, uuidstr);
+
+    virMutexLock(&virISCSIDirectSessionsLock);
+    if (!(session = virHashLookup(virISCSIDirectSessions, uuidstr))) {
+        if (!(session = virObjectLockableNew(virISCSIDirectSessionClass)) ||
+            virHashAddEntry(virISCSIDirectSessions, uuidstr, session) < 0) {
+            virMutexUnlock(&virISCSIDirectSessionsLock);
+            virObjectUnref(session);
+            return NULL;
+        }
+    }
+    virObjectRef(session);
+    virMutexUnlock(&virISCSIDirectSessionsLock);
+
+    virObjectLock(session);
+
+    if (session->iscsi &&
+        time(0) - session->lastused >= VIR_ISCSI_SESSION_IDLE_CHECK) {
+        struct scsi_task *task = iscsi_testunitready_sync(session->iscsi, 0);
+
+        if (!task) {
+            VIR_DEBUG("iSCSI session of pool %s doesn't work anymore: %s",
+                      def->name, iscsi_get_error(session->iscsi));
+            iscsi_destroy_context(session->iscsi);
+            session->iscsi = NULL;
+        }
+        scsi_free_scsi_task(task);
+    }
+
+    if (!session->iscsi) {
+        g_free(session->portal);
+        session->portal = NULL;
+        if (!(session->iscsi = virStorageBackendISCSIDirectSetConnection(pool,
+                                                                         &session->portal))) {
+            virObjectUnlock(session);
+            virObjectUnref(session);
+            return NULL;
+        }
+    } else {
+        VIR_DEBUG("Reusing iSCSI session of pool %s", def->name);
+    }
+
+    return session;
+}
+
+
+static void
+virISCSIDirectSessionRelease(virISCSIDirectSessionPtr session)
+{
+    session->lastused = time(0);
+    virObjectUnlock(session);
+    virObjectUnref(session);
+}
+
+
 static int
 virStorageBackendISCSIDirectRefreshPool(virStoragePoolObjPtr pool)
 {
-    struct iscsi_context *iscsi = NULL;
-    int ret = -1;
-    g_autofree char *portal = NULL;
+    virISCSIDirectSessionPtr session;
+    int ret;
 
-    if (!(iscsi = virStorageBackendISCSIDirectSetConnection(pool, &portal)))
+    if (!(session = virISCSIDirectSessionAcquire(pool)))
         return -1;
-    ret = virISCSIDirectReportLuns(pool, iscsi, portal);
-    virISCSIDirectDisconnect(iscsi);
-    iscsi_destroy_context(iscsi);
+
+    if ((ret = virISCSIDirectReportLuns(pool, session)) < 0) {
+        /* start over with a new session next time */
+        virISCSIDirectSessionClose(session);
+    }
+
+    virISCSIDirectSessionRelease(session);
     return ret;
 }
 
+
+static int
+virStorageBackendISCSIDirectStopPool(virStoragePoolObjPtr pool)
+{
+    virISCSIDirectSessionEvict(pool);
+    return 0;
+}
+
 static int
 virStorageBackendISCSIDirectGetLun(virStorageVolDefPtr vol,
                                    int *lun)
@@ -631,6 +1016,25 @@ virStorageBackendISCSIDirectVolWipeZero(virStorageVolDefPtr vol,
     if (VIR_ALLOC_N(data, block_size * BLOCK_PER_PACKET))
         return ret;
 
+    /* Have the target replicate a single zeroed block over the LUN with
+     * WRITE SAME, falling back to sending all the zeroes if it refuses */
+    while (lba < nb_block) {
+        const uint64_t to_write = MIN(nb_block - lba, WRITE_SAME_MAX_BLOCKS);
+
+        task = iscsi_writesame16_sync(iscsi, lun, lba, data, block_size,
+                                      to_write, 0, 0, 0, 0);
+
+        if (!task || task->status != SCSI_STATUS_GOOD) {
+            VIR_DEBUG("WRITE SAME failed on LUN %d at LBA %llu: %s",
+                      lun, (unsigned long long) lba, iscsi_get_error(iscsi));
+            scsi_free_scsi_task(task);
+            break;
+        }
+
+        scsi_free_scsi_task(task);
+        lba += to_write;
+    }
+
     while (lba < nb_block) {
         const uint64_t to_write = MIN(nb_block - lba + 1, BLOCK_PER_PACKET);
 
@@ -660,21 +1064,21 @@ virStorageBackenISCSIDirectWipeVol(virStoragePoolObjPtr pool,
                                    unsigned int algorithm,
                                    unsigned int flags)
 {
-    struct iscsi_context *iscsi = NULL;
+    virISCSIDirectSessionPtr session;
     int ret = -1;
 
     virCheckFlags(0, -1);
 
     virObjectLock(pool);
-    iscsi = virStorageBackendISCSIDirectSetConnection(pool, NULL);
+    session = virISCSIDirectSessionAcquire(pool);
     virObjectUnlock(pool);
 
-    if (!iscsi)
+    if (!session)
         return -1;
 
     switch ((virStorageVolWipeAlgorithm) algorithm) {
     case VIR_STORAGE_VOL_WIPE_ALG_ZERO:
-        if (virStorageBackendISCSIDirectVolWipeZero(vol, iscsi) < 0)
+        if (virStorageBackendISCSIDirectVolWipeZero(vol, session->iscsi) < 0)
             goto cleanup;
         break;
     case VIR_STORAGE_VOL_WIPE_ALG_TRIM:
@@ -694,8 +1098,9 @@ virStorageBackenISCSIDirectWipeVol(virStoragePoolObjPtr pool,
 
     ret = 0;
  cleanup:
-    virISCSIDirectDisconnect(iscsi);
-    iscsi_destroy_context(iscsi);
+    if (ret < 0)
+        virISCSIDirectSessionClose(session);
+    virISCSIDirectSessionRelease(session);
     return ret;
 }
 
@@ -706,6 +1111,7 @@ virStorageBackend virStorageBackendISCSIDirect = {
     .checkPool = virStorageBackendISCSIDirectCheckPool,
     .findPoolSources = virStorageBackendISCSIDirectFindPoolSources,
     .refreshPool = virStorageBackendISCSIDirectRefreshPool,
+    .stopPool = virStorageBackendISCSIDirectStopPool,
     .wipeVol = virStorageBackenISCSIDirectWipeVol,
 };
 
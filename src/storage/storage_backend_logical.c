@@ -34,6 +34,7 @@
 #include "virfile.h"
 #include "virstring.h"
 #include "virutil.h"
+#include "virjson.h"
 #include "storage_util.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
@@ -118,100 +119,74 @@ static int
 virStorageBackendLogicalParseVolExtents(virStorageVolDefPtr vol,
                                         char **const groups)
 {
-    g_autoptr(GRegex) re = NULL;
-    g_autoptr(GError) err = NULL;
-    g_autoptr(GMatchInfo) info = NULL;
-    int nextents, ret = -1;
-    const char *regex_unit = "(\\S+)\\((\\S+)\\)";
+    g_auto(GStrv) devices = NULL;
+    int nextents;
     size_t i;
     unsigned long long offset, size, length;
-    virStorageVolSourceExtent extent;
-    g_autofree char *regex = NULL;
 
-    memset(&extent, 0, sizeof(extent));
-
-    /* Assume 1 extent (the regex for 'devices' is "(\\S+)") and only
-     * check the 'stripes' field if we have a striped, mirror, or one of
-     * the raid (raid1, raid4, raid5*, raid6*, or raid10) segtypes in which
-     * case the stripes field will denote the number of lv's within the
-     * 'devices' field in order to generate the proper regex to decode
-     * the field
+    /* Assume 1 extent and only check the 'stripes' field if we have a
+     * striped, mirror, or one of the raid (raid1, raid4, raid5*, raid6*,
+     * or raid10) segtypes in which case the stripes field will denote
+     * the number of lv's within the 'devices' field
      */
     nextents = 1;
     if (STREQ(groups[4], VIR_STORAGE_VOL_LOGICAL_SEGTYPE_STRIPED) ||
         STREQ(groups[4], VIR_STORAGE_VOL_LOGICAL_SEGTYPE_MIRROR) ||
         STRPREFIX(groups[4], VIR_STORAGE_VOL_LOGICAL_SEGTYPE_RAID)) {
-        if (virStrToLong_i(groups[5], NULL, 10, &nextents) < 0) {
+        if (virStrToLong_i(groups[5], NULL, 10, &nextents) < 0 ||
+            nextents < 1) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("malformed volume extent stripes value"));
-            goto cleanup;
+            return -1;
         }
     }
 
     if (virStrToLong_ull(groups[6], NULL, 10, &length) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        "%s", _("malformed volume extent length value"));
-        goto cleanup;
+        return -1;
     }
 
     if (virStrToLong_ull(groups[7], NULL, 10, &size) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        "%s", _("malformed volume extent size value"));
-        goto cleanup;
-    }
-
-    /* Allocate space for 'nextents' regex_unit strings plus a comma for each */
-    if (VIR_ALLOC_N(regex, nextents * (strlen(regex_unit) + 1) + 1) < 0)
-        goto cleanup;
-    strcat(regex, regex_unit);
-    for (i = 1; i < nextents; i++) {
-        /* "," is the separator of "devices" field */
-        strcat(regex, ",");
-        strcat(regex, regex_unit);
-    }
-
-    re = g_regex_new(regex, 0, 0, &err);
-    if (!re) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Failed to compile regex %s"), err->message);
         return -1;
     }
 
-    if (!g_regex_match(re, groups[3], 0, &info)) {
+    /* "," is the separator of "devices" field, each of them being
+     * a "path(offset)" pair */
+    devices = g_strsplit(groups[3], ",", 0);
+    if (g_strv_length(devices) < nextents) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("malformed volume extent devices value"));
-        goto cleanup;
+        return -1;
     }
 
-    /* Each extent has a "path:offset" pair, and match #0
-     * is the whole matched string.
-     */
     for (i = 0; i < nextents; i++) {
-        size_t j;
-        g_autofree char *offset_str = NULL;
+        virStorageVolSourceExtent extent = { 0 };
+        char *paren = strrchr(devices[i], '(');
+        char *end;
 
-        j = (i * 2) + 1;
-        extent.path = g_match_info_fetch(info, j);
-        offset_str = g_match_info_fetch(info, j + 1);
-
-        if (virStrToLong_ull(offset_str, NULL, 10, &offset) < 0) {
+        if (!paren || paren == devices[i] ||
+            virStrToLong_ull(paren + 1, &end, 10, &offset) < 0 ||
+            STRNEQ(end, ")")) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                            _("malformed volume extent offset value"));
-            goto cleanup;
+            return -1;
         }
+
+        extent.path = g_strndup(devices[i], paren - devices[i]);
         extent.start = offset * size;
         extent.end = (offset * size) + length;
 
         if (VIR_APPEND_ELEMENT(vol->source.extents, vol->source.nextent,
-                               extent) < 0)
-            goto cleanup;
+                               extent) < 0) {
+            VIR_FREE(extent.path);
+            return -1;
+        }
     }
 
-    ret = 0;
-
- cleanup:
-    VIR_FREE(extent.path);
-    return ret;
+    return 0;
 }
 
 
@@ -348,9 +323,136 @@ virStorageBackendLogicalMakeVol(char **const groups,
            VIR_STORAGE_VOL_LOGICAL_LV_ATTR_REGEX \
            VIR_STORAGE_VOL_LOGICAL_SUFFIX_REGEX
 
+/* Fields of the lvs JSON report in the order of the regex groups above,
+ * followed by the size and free space of the volume group */
+static const char *virStorageBackendLogicalLVFields[] = {
+    "lv_name", "origin", "lv_uuid", "devices", "segtype", "stripes",
+    "seg_size", "vg_extent_size", "lv_size", "lv_attr", "vg_size", "vg_free",
+    NULL
+};
+#define VIR_STORAGE_VOL_LOGICAL_JSON_COUNT (VIR_STORAGE_VOL_LOGICAL_REGEX_COUNT + 2)
+G_STATIC_ASSERT(G_N_ELEMENTS(virStorageBackendLogicalLVFields) ==
+                VIR_STORAGE_VOL_LOGICAL_JSON_COUNT + 1);
+
+/* Set once lvs turned out not to support --reportformat (LVM older than
+ * 2.02.158) so that the text output is parsed right away */
+static bool virStorageBackendLogicalNoJSON;
+
+static int virStorageBackendLogicalRefreshPoolFunc(char **const groups,
+                                                   void *data);
+
+
+/*
+ * Returns the rows of the lvs JSON report @json, which looks like
+ *
+ *   {"report": [{"lv": [{"lv_name": "RootLV", ...}, ...]}]}
+ */
+static virJSONValuePtr
+virStorageBackendLogicalGetReportRows(virJSONValuePtr json)
+{
+    virJSONValuePtr report;
+    virJSONValuePtr rows;
+
+    if (!(report = virJSONValueObjectGetArray(json, "report")) ||
+        virJSONValueArraySize(report) < 1 ||
+        !(report = virJSONValueArrayGet(report, 0)))
+        return NULL;
+
+    if (!(rows = virJSONValueObjectGetArray(report, "lv")) &&
+        !(rows = virJSONValueObjectGetArray(report, "seg")))
+        return NULL;
+
+    return rows;
+}
+
+
+/*
+ * Lists the volumes of @pool, or only @vol, with a single lvs call
+ * reporting JSON. The size and free space of the volume group are
+ * reported alongside and stored in the pool definition if @vginfo is
+ * not NULL, in which case @vginfo is set to whether there were any.
+ *
+ * Returns 0 on success, -1 on error and -2 if lvs failed, which may
+ * be because it doesn't know the JSON report format.
+ */
 static int
-virStorageBackendLogicalFindLVs(virStoragePoolObjPtr pool,
-                                virStorageVolDefPtr vol)
+virStorageBackendLogicalFindLVsJSON(virStoragePoolObjPtr pool,
+                                    virStorageVolDefPtr vol,
+                                    bool *vginfo)
+{
+    virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
+    struct virStorageBackendLogicalPoolVolData cbdata = {
+        .pool = pool,
+        .vol = vol,
+    };
+    g_autoptr(virCommand) cmd = NULL;
+    g_autoptr(virJSONValue) json = NULL;
+    g_autofree char *fields = NULL;
+    g_autofree char *output = NULL;
+    virJSONValuePtr rows;
+    int status;
+    size_t i;
+    size_t j;
+
+    fields = g_strjoinv(",", (char **) virStorageBackendLogicalLVFields);
+    cmd = virCommandNewArgList(LVS,
+                               "--reportformat", "json",
+                               "--units", "b",
+                               "--nosuffix",
+                               "--options", fields,
+                               def->source.name,
+                               NULL);
+    virCommandSetOutputBuffer(cmd, &output);
+
+    if (virCommandRun(cmd, &status) < 0)
+        return -1;
+
+    if (status != 0)
+        return -2;
+
+    if (!(json = virJSONValueFromString(output)) ||
+        !(rows = virStorageBackendLogicalGetReportRows(json))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("malformed JSON report of lvs"));
+        return -1;
+    }
+
+    for (i = 0; i < virJSONValueArraySize(rows); i++) {
+        virJSONValuePtr row = virJSONValueArrayGet(rows, i);
+        char *groups[VIR_STORAGE_VOL_LOGICAL_JSON_COUNT];
+
+        for (j = 0; j < VIR_STORAGE_VOL_LOGICAL_JSON_COUNT; j++) {
+            const char *field = virStorageBackendLogicalLVFields[j];
+
+            if (!(groups[j] = (char *) virJSONValueObjectGetStringOrNumber(row, field))) {
+                virReportError(VIR_ERR_INTERNAL_ERROR,
+                               _("missing field '%s' in JSON report of lvs"),
+                               field);
+                return -1;
+            }
+        }
+
+        if (virStorageBackendLogicalMakeVol(groups, &cbdata) < 0)
+            return -1;
+
+        if (vginfo && !*vginfo) {
+            if (virStorageBackendLogicalRefreshPoolFunc(groups + VIR_STORAGE_VOL_LOGICAL_REGEX_COUNT,
+                                                        pool) < 0) {
+                virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                               _("malformed volume group size in JSON report of lvs"));
+                return -1;
+            }
+            *vginfo = true;
+        }
+    }
+
+    return 0;
+}
+
+
+static int
+virStorageBackendLogicalFindLVsText(virStoragePoolObjPtr pool,
+                                    virStorageVolDefPtr vol)
 {
     /*
      * # lvs --separator # --noheadings --units b --unbuffered --nosuffix --options \
@@ -405,6 +507,40 @@ virStorageBackendLogicalFindLVs(virStoragePoolObjPtr pool,
                               &cbdata, "lvs", NULL);
 }
 
+
+/*
+ * Lists the volumes of @pool, or only @vol. See
+ * virStorageBackendLogicalFindLVsJSON for @vginfo, which is set to
+ * false if the text output of lvs had to be parsed.
+ */
+static int
+virStorageBackendLogicalFindLVs(virStoragePoolObjPtr pool,
+                                virStorageVolDefPtr vol,
+                                bool *vginfo)
+{
+    int rc;
+
+    if (vginfo)
+        *vginfo = false;
+
+    if (!virStorageBackendLogicalNoJSON) {
+        if ((rc = virStorageBackendLogicalFindLVsJSON(pool, vol, vginfo)) != -2)
+            return rc;
+
+        VIR_DEBUG("lvs failed to report JSON, parsing its text output");
+    }
+
+    if (virStorageBackendLogicalFindLVsText(pool, vol) < 0)
+        return -1;
+
+    if (!virStorageBackendLogicalNoJSON) {
+        VIR_INFO("lvs doesn't support JSON reports, using text output");
+        virStorageBackendLogicalNoJSON = true;
+    }
+
+    return 0;
+}
+
 static int
 virStorageBackendLogicalRefreshPoolFunc(char **const groups,
                                         void *data)
@@ -732,13 +868,18 @@ virStorageBackendLogicalRefreshPool(virStoragePoolObjPtr pool)
     };
     virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
     g_autoptr(virCommand) cmd = NULL;
+    bool vginfo;
 
     virWaitForDevices();
 
-    /* Get list of all logical volumes */
-    if (virStorageBackendLogicalFindLVs(pool, NULL) < 0)
+    /* Get list of all logical volumes, along with the size of the volume
+     * group if lvs reports JSON and the group isn't empty */
+    if (virStorageBackendLogicalFindLVs(pool, NULL, &vginfo) < 0)
         return -1;
 
+    if (vginfo)
+        return 0;
+
     cmd = virCommandNewArgList(VGS,
                                "--separator", ":",
                                "--noheadings",
@@ -923,7 +1064,7 @@ virStorageBackendLogicalCreateVol(virStoragePoolObjPtr pool,
     }
 
     /* Fill in data about this new vol */
-    if (virStorageBackendLogicalFindLVs(pool, vol) < 0) {
+    if (virStorageBackendLogicalFindLVs(pool, vol, NULL) < 0) {
         virReportSystemError(errno,
                              _("cannot find newly created volume '%s'"),
                              vol->target.path);
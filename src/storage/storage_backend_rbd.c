@@ -31,6 +31,9 @@
 #include "viruuid.h"
 #include "virstring.h"
 #include "virrandom.h"
+#include "virobject.h"
+#include "virhash.h"
+#include "virthread.h"
 #include "rados/librados.h"
 #include "rbd/librbd.h"
 #include "virsecret.h"
@@ -40,15 +43,43 @@
 
 VIR_LOG_INIT("storage.storage_backend_rbd");
 
+/* Cached connections idle for longer than this many seconds are checked
+ * to still work before they are handed out again */
+#define VIR_STORAGE_BACKEND_RBD_IDLE_CHECK 30
+
 struct _virStorageBackendRBDState {
+    virObject parent;
+
     rados_t cluster;
     rados_ioctx_t ioctx;
     time_t starttime;
+    time_t lastused;
 };
 
 typedef struct _virStorageBackendRBDState virStorageBackendRBDState;
 typedef virStorageBackendRBDState *virStorageBackendRBDStatePtr;
 
+static virClassPtr virStorageBackendRBDStateClass;
+static void virStorageBackendRBDStateDispose(void *obj);
+
+/* Connected states of active pools, keyed by pool UUID */
+static virHashTablePtr virStorageBackendRBDStates;
+static virMutex virStorageBackendRBDStatesLock = VIR_MUTEX_INITIALIZER;
+
+static int
+virStorageBackendRBDStateOnceInit(void)
+{
+    if (!VIR_CLASS_NEW(virStorageBackendRBDState, virClassForObject()))
+        return -1;
+
+    if (!(virStorageBackendRBDStates = virHashNew(virObjectFreeHashData)))
+        return -1;
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virStorageBackendRBDState);
+
 typedef struct _virStoragePoolRBDConfigOptionsDef virStoragePoolRBDConfigOptionsDef;
 typedef virStoragePoolRBDConfigOptionsDef *virStoragePoolRBDConfigOptionsDefPtr;
 struct _virStoragePoolRBDConfigOptionsDef {
@@ -366,25 +397,112 @@ virStorageBackendRBDCloseRADOSConn(virStorageBackendRBDStatePtr ptr)
 }
 
 
+static void
+virStorageBackendRBDStateDispose(void *obj)
+{
+    virStorageBackendRBDStatePtr ptr = obj;
+
+    virStorageBackendRBDCloseRADOSConn(ptr);
+}
+
+
+/*
+ * Releases the reference to the state obtained from
+ * virStorageBackendRBDNewState. The connection itself stays open for
+ * further operations on the pool unless it was evicted from the cache.
+ */
 static void
 virStorageBackendRBDFreeState(virStorageBackendRBDStatePtr *ptr)
 {
     if (!*ptr)
         return;
 
-    virStorageBackendRBDCloseRADOSConn(*ptr);
+    (*ptr)->lastused = time(0);
+    virObjectUnref(*ptr);
+    *ptr = NULL;
+}
+
 
-    VIR_FREE(*ptr);
+/*
+ * Checks that a cached connection which wasn't used for a while can
+ * still reach the cluster, the monitors may have closed the session or
+ * the cluster may have been rebuilt in the meantime.
+ */
+static bool
+virStorageBackendRBDStateIsHealthy(virStorageBackendRBDStatePtr ptr)
+{
+    struct rados_cluster_stat_t clusterstat;
+    struct rados_pool_stat_t poolstat;
+
+    if (time(0) - ptr->lastused < VIR_STORAGE_BACKEND_RBD_IDLE_CHECK)
+        return true;
+
+    if (rados_cluster_stat(ptr->cluster, &clusterstat) < 0 ||
+        rados_ioctx_pool_stat(ptr->ioctx, &poolstat) < 0) {
+        VIR_DEBUG("Cached RADOS connection doesn't work anymore: %s",
+                  g_strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * Drops the cached connection of @pool, if any. Operations still using
+ * it keep their reference and the connection is closed once they finish.
+ */
+static void
+virStorageBackendRBDEvictState(virStoragePoolObjPtr pool)
+{
+    virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (virStorageBackendRBDStateInitialize() < 0)
+        return;
+
+    virUUIDFormat(def->uuid, uuidstr);
+
+    virMutexLock(&virStorageBackendRBDStatesLock);
+    ignore_value(virHashRemoveEntry(virStorageBackendRBDStates, uuidstr));
+    virMutexUnlock(&virStorageBackendRBDStatesLock);
 }
 
 
+/*
+ * Returns a connected state for @pool, reusing the cached connection of
+ * the pool if it's still healthy and connecting to the cluster
+ * otherwise. The caller must release it with
+ * virStorageBackendRBDFreeState.
+ */
 static virStorageBackendRBDStatePtr
 virStorageBackendRBDNewState(virStoragePoolObjPtr pool)
 {
     virStorageBackendRBDStatePtr ptr;
     virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
+
+    if (virStorageBackendRBDStateInitialize() < 0)
+        return NULL;
 
-    if (VIR_ALLOC(ptr) < 0)
+    virUUIDFormat(def->uuid, uuidstr);
+
+    virMutexLock(&virStorageBackendRBDStatesLock);
+    ptr = virObjectRef(virHashLookup(virStorageBackendRBDStates, uuidstr));
+    virMutexUnlock(&virStorageBackendRBDStatesLock);
+
+    if (ptr) {
+        if (virStorageBackendRBDStateIsHealthy(ptr)) {
+            VIR_DEBUG("Reusing RADOS connection of pool %s", def->name);
+            ptr->lastused = time(0);
+            return ptr;
+        }
+
+        virStorageBackendRBDEvictState(pool);
+        virObjectUnref(ptr);
+    }
+
+    if (!(ptr = virObjectNew(virStorageBackendRBDStateClass)))
         return NULL;
 
     if (virStorageBackendRBDOpenRADOSConn(ptr, def) < 0)
@@ -393,14 +511,32 @@ virStorageBackendRBDNewState(virStoragePoolObjPtr pool)
     if (virStorageBackendRBDOpenIoCTX(ptr, pool) < 0)
         goto error;
 
+    ptr->lastused = time(0);
+
+    virMutexLock(&virStorageBackendRBDStatesLock);
+    if (virHashUpdateEntry(virStorageBackendRBDStates, uuidstr,
+                           virObjectRef(ptr)) < 0) {
+        virObjectUnref(ptr);
+        virResetLastError();
+    }
+    virMutexUnlock(&virStorageBackendRBDStatesLock);
+
     return ptr;
 
  error:
-    virStorageBackendRBDFreeState(&ptr);
+    virObjectUnref(ptr);
     return NULL;
 }
 
 
+static int
+virStorageBackendRBDStopPool(virStoragePoolObjPtr pool)
+{
+    virStorageBackendRBDEvictState(pool);
+    return 0;
+}
+
+
 static int
 volStorageBackendRBDGetFeatures(rbd_image_t image,
                                 const char *volname,
@@ -505,10 +641,17 @@ virStorageBackendRBDSetAllocation(virStorageVolDefPtr vol G_GNUC_UNUSED,
 }
 #endif
 
+/*
+ * Refreshes the capacity and allocation of @vol. The allocation is
+ * computed exactly using the fast-diff object map if the pool asks for
+ * it, with the 'lazy' refresh mode only for a query of the volume
+ * itself and not when the whole pool is being refreshed (@poolrefresh).
+ */
 static int
 volStorageBackendRBDRefreshVolInfo(virStorageVolDefPtr vol,
                                    virStoragePoolObjPtr pool,
-                                   virStorageBackendRBDStatePtr ptr)
+                                   virStorageBackendRBDStatePtr ptr,
+                                   bool poolrefresh)
 {
     int rc, ret = -1;
     virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
@@ -516,6 +659,7 @@ volStorageBackendRBDRefreshVolInfo(virStorageVolDefPtr vol,
     rbd_image_info_t info;
     uint64_t features;
     uint64_t flags;
+    bool exact = false;
 
     if ((rc = rbd_open_read_only(ptr->ioctx, vol->name, &image, NULL)) < 0) {
         ret = rc;
@@ -545,9 +689,21 @@ volStorageBackendRBDRefreshVolInfo(virStorageVolDefPtr vol,
     vol->type = VIR_STORAGE_VOL_NETWORK;
     vol->target.format = VIR_STORAGE_FILE_RAW;
 
-    if (def->refresh &&
-        def->refresh->volume.allocation == VIR_STORAGE_VOL_DEF_REFRESH_ALLOCATION_DEFAULT &&
-        volStorageBackendRBDUseFastDiff(features, flags)) {
+    if (def->refresh) {
+        switch ((virStorageVolDefRefreshAllocation) def->refresh->volume.allocation) {
+        case VIR_STORAGE_VOL_DEF_REFRESH_ALLOCATION_DEFAULT:
+            exact = true;
+            break;
+        case VIR_STORAGE_VOL_DEF_REFRESH_ALLOCATION_LAZY:
+            exact = !poolrefresh;
+            break;
+        case VIR_STORAGE_VOL_DEF_REFRESH_ALLOCATION_CAPACITY:
+        case VIR_STORAGE_VOL_DEF_REFRESH_ALLOCATION_LAST:
+            break;
+        }
+    }
+
+    if (exact && volStorageBackendRBDUseFastDiff(features, flags)) {
         VIR_DEBUG("RBD image %s/%s has fast-diff feature enabled. "
                   "Querying for actual allocation",
                   def->source.name, vol->name);
@@ -672,15 +828,92 @@ virStorageBackendRBDGetVolNames(virStorageBackendRBDStatePtr ptr)
 #endif /* ! HAVE_RBD_LIST2 */
 
 
+/* Upper bound of threads refreshing the images of a pool */
+#define VIR_STORAGE_BACKEND_RBD_REFRESH_WORKERS 8
+
+typedef struct _virStorageBackendRBDRefreshJob virStorageBackendRBDRefreshJob;
+typedef virStorageBackendRBDRefreshJob *virStorageBackendRBDRefreshJobPtr;
+struct _virStorageBackendRBDRefreshJob {
+    virStorageVolDefPtr vol;
+    int rc;
+    virErrorPtr error;
+};
+
+typedef struct _virStorageBackendRBDRefreshData virStorageBackendRBDRefreshData;
+typedef virStorageBackendRBDRefreshData *virStorageBackendRBDRefreshDataPtr;
+struct _virStorageBackendRBDRefreshData {
+    virStoragePoolObjPtr pool;
+    virStorageBackendRBDStatePtr ptr;
+    virStorageBackendRBDRefreshJobPtr jobs;
+    size_t njobs;
+    int next; /* index of the first job nobody picked yet */
+};
+
+
+static void
+virStorageBackendRBDRefreshWorker(void *opaque)
+{
+    virStorageBackendRBDRefreshDataPtr data = opaque;
+    int i;
+
+    while ((i = g_atomic_int_add(&data->next, 1)) < (int) data->njobs) {
+        virStorageBackendRBDRefreshJobPtr job = &data->jobs[i];
+
+        if ((job->rc = volStorageBackendRBDRefreshVolInfo(job->vol, data->pool,
+                                                          data->ptr, true)) < 0)
+            virErrorPreserveLast(&job->error);
+        else
+            virResetLastError();
+    }
+}
+
+
+/*
+ * Refreshing an image takes a few round trips to the cluster, plus
+ * walking its object map if the allocation is computed. The IoCTX is
+ * thread safe, so refresh the @data images using a few threads which
+ * spend most of their time waiting for the OSDs.
+ */
+static void
+virStorageBackendRBDRefreshVols(virStorageBackendRBDRefreshDataPtr data)
+{
+    g_autofree virThread *threads = NULL;
+    size_t nthreads = 0;
+    size_t nworkers = MIN(VIR_STORAGE_BACKEND_RBD_REFRESH_WORKERS, data->njobs);
+    size_t i;
+
+    /* The calling thread is one of the workers */
+    if (nworkers > 1) {
+        threads = g_new0(virThread, nworkers - 1);
+        for (i = 0; i < nworkers - 1; i++) {
+            if (virThreadCreateFull(&threads[nthreads], true,
+                                    virStorageBackendRBDRefreshWorker,
+                                    "rbd-refresh", false, data) < 0) {
+                /* Not fatal; whoever runs picks up the remaining jobs */
+                VIR_WARN("Unable to create RBD image refresh thread");
+                break;
+            }
+            nthreads++;
+        }
+    }
+
+    virStorageBackendRBDRefreshWorker(data);
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+}
+
+
 static int
 virStorageBackendRBDRefreshPool(virStoragePoolObjPtr pool)
 {
-    int rc, ret = -1;
+    int ret = -1;
     virStoragePoolDefPtr def = virStoragePoolObjGetDef(pool);
     virStorageBackendRBDStatePtr ptr = NULL;
     struct rados_cluster_stat_t clusterstat;
     struct rados_pool_stat_t poolstat;
     char **names = NULL;
+    virStorageBackendRBDRefreshData refresh = { 0 };
     size_t i;
 
     if (!(ptr = virStorageBackendRBDNewState(pool)))
@@ -688,6 +921,7 @@ virStorageBackendRBDRefreshPool(virStoragePoolObjPtr pool)
 
     if (rados_cluster_stat(ptr->cluster, &clusterstat) < 0) {
         virReportSystemError(errno, "%s", _("failed to stat the RADOS cluster"));
+        virStorageBackendRBDEvictState(pool);
         goto cleanup;
     }
 
@@ -709,15 +943,20 @@ virStorageBackendRBDRefreshPool(virStoragePoolObjPtr pool)
     if (!(names = virStorageBackendRBDGetVolNames(ptr)))
         goto cleanup;
 
-    for (i = 0; names[i] != NULL; i++) {
-        g_autoptr(virStorageVolDef) vol = NULL;
+    refresh.pool = pool;
+    refresh.ptr = ptr;
+    refresh.njobs = g_strv_length(names);
+    refresh.jobs = g_new0(virStorageBackendRBDRefreshJob, refresh.njobs);
 
-        if (VIR_ALLOC(vol) < 0)
-            goto cleanup;
+    for (i = 0; i < refresh.njobs; i++) {
+        refresh.jobs[i].vol = g_new0(virStorageVolDef, 1);
+        refresh.jobs[i].vol->name = g_steal_pointer(&names[i]);
+    }
 
-        vol->name = g_steal_pointer(&names[i]);
+    virStorageBackendRBDRefreshVols(&refresh);
 
-        rc = volStorageBackendRBDRefreshVolInfo(vol, pool, ptr);
+    for (i = 0; i < refresh.njobs; i++) {
+        virStorageBackendRBDRefreshJobPtr job = &refresh.jobs[i];
 
         /* It could be that a volume has been deleted through a different route
          * then libvirt and that will cause a -ENOENT to be returned.
@@ -728,16 +967,17 @@ virStorageBackendRBDRefreshPool(virStoragePoolObjPtr pool)
          *
          * Do not error out and simply ignore the volume
          */
-        if (rc < 0) {
-            if (rc == -ENOENT || rc == -ETIMEDOUT)
+        if (job->rc < 0) {
+            if (job->rc == -ENOENT || job->rc == -ETIMEDOUT)
                 continue;
 
+            virErrorRestore(&job->error);
             goto cleanup;
         }
 
-        if (virStoragePoolObjAddVol(pool, vol) < 0)
+        if (virStoragePoolObjAddVol(pool, job->vol) < 0)
             goto cleanup;
-        vol = NULL;
+        job->vol = NULL;
     }
 
     VIR_DEBUG("Found %zu images in RBD pool %s",
@@ -746,6 +986,11 @@ virStorageBackendRBDRefreshPool(virStoragePoolObjPtr pool)
     ret = 0;
 
  cleanup:
+    for (i = 0; i < refresh.njobs; i++) {
+        virStorageVolDefFree(refresh.jobs[i].vol);
+        virFreeError(refresh.jobs[i].error);
+    }
+    g_free(refresh.jobs);
     g_strfreev(names);
     virStorageBackendRBDFreeState(&ptr);
     return ret;
@@ -1264,7 +1509,7 @@ virStorageBackendRBDRefreshVol(virStoragePoolObjPtr pool,
     if (!(ptr = virStorageBackendRBDNewState(pool)))
         goto cleanup;
 
-    if (volStorageBackendRBDRefreshVolInfo(vol, pool, ptr) < 0)
+    if (volStorageBackendRBDRefreshVolInfo(vol, pool, ptr, false) < 0)
         goto cleanup;
 
     ret = 0;
@@ -1319,6 +1564,19 @@ virStorageBackendRBDVolWipeZero(rbd_image_t image,
     unsigned long long offset = 0;
     unsigned long long length;
     g_autofree char *writebuf = NULL;
+#ifdef LIBRBD_SUPPORTS_WRITE_ZEROES
+    ssize_t rc;
+
+    /* Let the OSDs zero the objects without shipping the zeroes */
+    if ((rc = rbd_write_zeroes(image, 0, info->size, 0, 0)) >= 0) {
+        VIR_DEBUG("Zeroed %"PRIu64" bytes of RBD image %s in place",
+                  info->size, imgname);
+        return 0;
+    }
+
+    VIR_DEBUG("Failed to zero RBD image %s in place, writing zeroes: %s",
+              imgname, g_strerror(-rc));
+#endif /* LIBRBD_SUPPORTS_WRITE_ZEROES */
 
     if (VIR_ALLOC_N(writebuf, info->obj_size * stripe_count) < 0)
         return -1;
@@ -1463,6 +1721,7 @@ virStorageBackend virStorageBackendRBD = {
     .type = VIR_STORAGE_POOL_RBD,
 
     .refreshPool = virStorageBackendRBDRefreshPool,
+    .stopPool = virStorageBackendRBDStopPool,
     .createVol = virStorageBackendRBDCreateVol,
     .buildVol = virStorageBackendRBDBuildVol,
     .buildVolFrom = virStorageBackendRBDBuildVolFrom,
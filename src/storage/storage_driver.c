@@ -99,7 +99,8 @@ storagePoolRefreshImpl(virStorageBackendPtr backend,
                        virStoragePoolObjPtr obj,
                        const char *stateFile)
 {
-    virStoragePoolObjClearVols(obj);
+    if (!backend->refreshKeepsVolumes)
+        virStoragePoolObjClearVols(obj);
     if (backend->refreshPool(obj) < 0) {
         storagePoolRefreshFailCleanup(backend, obj, stateFile);
         return -1;
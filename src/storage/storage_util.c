@@ -71,6 +71,8 @@
 #include "virxml.h"
 #include "virfdstream.h"
 #include "virutil.h"
+#include "virhostcpu.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
@@ -119,6 +121,55 @@ reflinkCloneFile(int dest_fd G_GNUC_UNUSED,
 #endif
 
 
+/*
+ * Let the kernel copy up to @total bytes from @src_fd to @dest_fd,
+ * starting at their current offsets which are advanced accordingly.
+ * Depending on the filesystem this can share extents or perform a
+ * server side copy instead of moving the data through userspace.
+ * Returns 0 on success or when copying in the kernel is not possible
+ * for the pair of files, in which case @total tells how much is left
+ * to be copied by other means. Otherwise returns -1 and sets errno.
+ */
+#if HAVE_COPY_FILE_RANGE
+static int
+storageBackendCopyFileRange(int dest_fd,
+                            int src_fd,
+                            unsigned long long *total)
+{
+    while (*total > 0) {
+        size_t len = MIN(*total, SSIZE_MAX & ~(1024 * 1024 - 1));
+        ssize_t copied;
+
+        copied = copy_file_range(src_fd, NULL, dest_fd, NULL, len, 0);
+
+        if (copied < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+                errno == EOPNOTSUPP || errno == EBADF)
+                return 0;
+            return -1;
+        }
+
+        if (copied == 0)
+            break;
+
+        *total -= copied;
+    }
+
+    return 0;
+}
+#else
+static int
+storageBackendCopyFileRange(int dest_fd G_GNUC_UNUSED,
+                            int src_fd G_GNUC_UNUSED,
+                            unsigned long long *total G_GNUC_UNUSED)
+{
+    return 0;
+}
+#endif
+
+
 static int ATTRIBUTE_NONNULL(2)
 virStorageBackendCopyToFD(virStorageVolDefPtr vol,
                           virStorageVolDefPtr inputvol,
@@ -173,6 +224,20 @@ virStorageBackendCopyToFD(virStorageVolDefPtr vol,
         }
     }
 
+    /* Zero blocks can only be skipped when copying through userspace */
+    if (!want_sparse) {
+        unsigned long long remain = *total;
+
+        if (storageBackendCopyFileRange(fd, inputfd, total) < 0) {
+            ret = -errno;
+            virReportSystemError(errno,
+                                 _("failed to copy '%s' to '%s'"),
+                                 inputvol->target.path, vol->target.path);
+            return ret;
+        }
+        VIR_DEBUG("copied %llu bytes in kernel", remain - *total);
+    }
+
     while (amtread != 0) {
         int amtleft;
 
@@ -2478,32 +2543,152 @@ storageBackendVolZeroSparseFileLocal(const char *path,
 }
 
 
+/* Size of the chunks zeroed by a single write */
+#define STORAGE_BACKEND_WIPE_CHUNK (8 * 1024 * 1024)
+
+/* Upper bound of threads writing zeroes to a volume */
+#define STORAGE_BACKEND_WIPE_WORKERS 4
+
+typedef struct _storageBackendWipeData storageBackendWipeData;
+typedef storageBackendWipeData *storageBackendWipeDataPtr;
+struct _storageBackendWipeData {
+    const char *path;
+    int fd;
+    off_t start;
+    unsigned long long len;
+    const char *zeroes;
+
+    int nextChunk; /* index of the first chunk nobody picked yet */
+    int doneChunks;
+    int nchunks;
+    int err; /* errno of the first failed write */
+};
+
+
+/*
+ * Lets the storage zero the range in place: the block layer turns
+ * BLKZEROOUT into WRITE ZEROES, or an unmap if the device guarantees
+ * unmapped blocks read back as zeroes, and filesystems convert
+ * FALLOC_FL_ZERO_RANGE into unwritten extents.
+ *
+ * Returns 0 if the range was zeroed, 1 if the storage can't do it and
+ * -1 on error.
+ */
 static int
-storageBackendWipeLocal(const char *path,
-                        int fd,
-                        unsigned long long wipe_len,
-                        size_t writebuf_length,
-                        bool zero_end)
+storageBackendWipeLocalOffload(const char *path,
+                               int fd,
+                               off_t start,
+                               unsigned long long len)
 {
-    int written = 0;
-    unsigned long long remaining = 0;
-    off_t size;
-    size_t write_size = 0;
-    g_autofree char *writebuf = NULL;
+    struct stat st;
 
-    if (VIR_ALLOC_N(writebuf, writebuf_length) < 0)
+    if (fstat(fd, &st) < 0) {
+        virReportSystemError(errno,
+                             _("Failed to stat storage volume with path '%s'"),
+                             path);
         return -1;
+    }
 
-    if (!zero_end) {
-        if ((size = lseek(fd, 0, SEEK_SET)) < 0) {
+#if defined(__linux__) && defined(BLKZEROOUT)
+    if (S_ISBLK(st.st_mode)) {
+        uint64_t range[2] = { start, len };
+
+        if (ioctl(fd, BLKZEROOUT, &range) == 0)
+            return 0;
+
+        if (errno != ENOTTY && errno != EOPNOTSUPP && errno != EINVAL) {
             virReportSystemError(errno,
-                                 _("Failed to seek to the start in volume "
-                                   "with path '%s'"),
-                                 path);
+                                 _("Failed to zero out %llu bytes of "
+                                   "volume with path '%s'"),
+                                 len, path);
             return -1;
         }
+
+        VIR_DEBUG("BLKZEROOUT not supported by '%s'", path);
+        return 1;
+    }
+#endif /* __linux__ && BLKZEROOUT */
+
+#if HAVE_FALLOCATE - 0 && defined(FALLOC_FL_ZERO_RANGE)
+    if (S_ISREG(st.st_mode)) {
+        if (fallocate(fd, FALLOC_FL_ZERO_RANGE | FALLOC_FL_KEEP_SIZE,
+                      start, len) == 0)
+            return 0;
+
+        if (errno != ENOSYS && errno != EOPNOTSUPP && errno != EINVAL) {
+            virReportSystemError(errno,
+                                 _("Failed to zero out %llu bytes of "
+                                   "volume with path '%s'"),
+                                 len, path);
+            return -1;
+        }
+
+        VIR_DEBUG("FALLOC_FL_ZERO_RANGE not supported for '%s'", path);
+        return 1;
+    }
+#endif /* HAVE_FALLOCATE && FALLOC_FL_ZERO_RANGE */
+
+    return 1;
+}
+
+
+static void
+storageBackendWipeLocalWorker(void *opaque)
+{
+    storageBackendWipeDataPtr data = opaque;
+    int i;
+
+    while (!g_atomic_int_get(&data->err) &&
+           (i = g_atomic_int_add(&data->nextChunk, 1)) < data->nchunks) {
+        unsigned long long offset = (unsigned long long) i * STORAGE_BACKEND_WIPE_CHUNK;
+        size_t chunk = MIN(STORAGE_BACKEND_WIPE_CHUNK, data->len - offset);
+        size_t written = 0;
+        int done;
+
+        while (written < chunk) {
+            ssize_t rc = pwrite(data->fd, data->zeroes + written,
+                                chunk - written,
+                                data->start + offset + written);
+
+            if (rc < 0 && errno == EINTR)
+                continue;
+
+            if (rc <= 0) {
+                g_atomic_int_compare_and_exchange(&data->err, 0,
+                                                  rc < 0 ? errno : EIO);
+                return;
+            }
+
+            written += rc;
+        }
+
+        done = g_atomic_int_add(&data->doneChunks, 1) + 1;
+        if (done % MAX(data->nchunks / 10, 1) == 0)
+            VIR_INFO("Wiped %d%% of volume with path '%s'",
+                     (int) (done * 100ULL / data->nchunks), data->path);
+    }
+}
+
+
+static int
+storageBackendWipeLocal(const char *path,
+                        int fd,
+                        unsigned long long wipe_len,
+                        bool zero_end)
+{
+    storageBackendWipeData data = { 0 };
+    g_autofree virThread *threads = NULL;
+    g_autofree char *zeroes = NULL;
+    size_t nthreads = 0;
+    size_t nworkers;
+    off_t start;
+    size_t i;
+    int rc;
+
+    if (!zero_end) {
+        start = 0;
     } else {
-        if ((size = lseek(fd, -wipe_len, SEEK_END)) < 0) {
+        if ((start = lseek(fd, -wipe_len, SEEK_END)) < 0) {
             virReportSystemError(errno,
                                  _("Failed to seek to %llu bytes to the end "
                                    "in volume with path '%s'"),
@@ -2512,23 +2697,57 @@ storageBackendWipeLocal(const char *path,
         }
     }
 
-    VIR_DEBUG("wiping start: %zd len: %llu", (ssize_t)size, wipe_len);
+    VIR_DEBUG("wiping start: %zd len: %llu", (ssize_t)start, wipe_len);
 
-    remaining = wipe_len;
-    while (remaining > 0) {
+    if (wipe_len == 0)
+        return 0;
 
-        write_size = (writebuf_length < remaining) ? writebuf_length : remaining;
-        written = safewrite(fd, writebuf, write_size);
-        if (written < 0) {
-            virReportSystemError(errno,
-                                 _("Failed to write %zu bytes to "
-                                   "storage volume with path '%s'"),
-                                 write_size, path);
+    if ((rc = storageBackendWipeLocalOffload(path, fd, start, wipe_len)) < 0)
+        return -1;
 
-            return -1;
+    if (rc == 0) {
+        VIR_DEBUG("Zeroed %llu bytes of volume with path '%s' in place",
+                  wipe_len, path);
+        return 0;
+    }
+
+    zeroes = g_new0(char, MIN(wipe_len, STORAGE_BACKEND_WIPE_CHUNK));
+
+    data.path = path;
+    data.fd = fd;
+    data.start = start;
+    data.len = wipe_len;
+    data.zeroes = zeroes;
+    data.nchunks = VIR_DIV_UP(wipe_len, STORAGE_BACKEND_WIPE_CHUNK);
+
+    /* Several writes in flight keep the queues of the storage busy; the
+     * calling thread is one of the workers */
+    nworkers = MIN(STORAGE_BACKEND_WIPE_WORKERS, data.nchunks);
+    if (nworkers > 1) {
+        threads = g_new0(virThread, nworkers - 1);
+        for (i = 0; i < nworkers - 1; i++) {
+            if (virThreadCreateFull(&threads[nthreads], true,
+                                    storageBackendWipeLocalWorker,
+                                    "vol-wipe", false, &data) < 0) {
+                /* Not fatal; whoever runs writes the remaining chunks */
+                VIR_WARN("Unable to create volume wiping thread");
+                break;
+            }
+            nthreads++;
         }
+    }
+
+    storageBackendWipeLocalWorker(&data);
 
-        remaining -= written;
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+
+    if (data.err) {
+        virReportSystemError(data.err,
+                             _("Failed to write zeroes to "
+                               "storage volume with path '%s'"),
+                             path);
+        return -1;
     }
 
     if (virFileDataSync(fd) < 0) {
@@ -2621,8 +2840,7 @@ storageBackendVolWipeLocalFile(const char *path,
     if (S_ISREG(st.st_mode) && st.st_blocks < (st.st_size / DEV_BSIZE))
         return storageBackendVolZeroSparseFileLocal(path, st.st_size, fd);
 
-    return storageBackendWipeLocal(path, fd, allocation, st.st_blksize,
-                                   zero_end);
+    return storageBackendWipeLocal(path, fd, allocation, zero_end);
 }
 
 
@@ -3471,9 +3689,144 @@ virStorageBackendRefreshVolTargetUpdate(virStorageVolDefPtr vol)
 }
 
 
+/*
+ * Check whether the file described by @sb is still the one @vol was
+ * probed from, judging by its change and modification times.
+ */
+static bool
+storageBackendVolIsUnchanged(virStorageVolDefPtr vol,
+                             struct stat *sb)
+{
+    virStorageTimestampsPtr ts = vol->target.timestamps;
+    struct timespec ctime;
+    struct timespec mtime;
+
+    if (!ts)
+        return false;
+
+#ifdef __APPLE__
+    ctime = sb->st_ctimespec;
+    mtime = sb->st_mtimespec;
+#else /* ! __APPLE__ */
+    ctime = sb->st_ctim;
+    mtime = sb->st_mtim;
+#endif /* ! __APPLE__ */
+
+    return ts->ctime.tv_sec == ctime.tv_sec &&
+        ts->ctime.tv_nsec == ctime.tv_nsec &&
+        ts->mtime.tv_sec == mtime.tv_sec &&
+        ts->mtime.tv_nsec == mtime.tv_nsec;
+}
+
+
+struct storageBackendStaleVolsData {
+    virHashTablePtr seen;
+    virStorageVolDefPtr *vols;
+    size_t nvols;
+};
+
+
+static int
+storageBackendCollectStaleVol(virStorageVolDefPtr vol,
+                              const void *opaque)
+{
+    struct storageBackendStaleVolsData *data = (void *)opaque;
+
+    if (virHashLookup(data->seen, vol->name))
+        return 0;
+
+    return VIR_APPEND_ELEMENT(data->vols, data->nvols, vol);
+}
+
+
+/* Upper bound of threads probing the volumes of a pool */
+#define STORAGE_BACKEND_PROBE_WORKERS 16
+
+typedef struct _storageBackendProbeJob storageBackendProbeJob;
+typedef storageBackendProbeJob *storageBackendProbeJobPtr;
+struct _storageBackendProbeJob {
+    virStorageVolDefPtr vol;
+    int err;
+    virErrorPtr error;
+};
+
+typedef struct _storageBackendProbeData storageBackendProbeData;
+typedef storageBackendProbeData *storageBackendProbeDataPtr;
+struct _storageBackendProbeData {
+    storageBackendProbeJobPtr jobs;
+    size_t njobs;
+    int next; /* index of the first job nobody picked yet */
+};
+
+
+static void
+storageBackendProbeWorker(void *opaque)
+{
+    storageBackendProbeDataPtr data = opaque;
+    int i;
+
+    while ((i = g_atomic_int_add(&data->next, 1)) < (int) data->njobs) {
+        storageBackendProbeJobPtr job = &data->jobs[i];
+
+        if ((job->err = virStorageBackendRefreshVolTargetUpdate(job->vol)) < 0)
+            virErrorPreserveLast(&job->error);
+        else
+            virResetLastError();
+    }
+}
+
+
+/*
+ * Probing a volume means opening the file and reading its header,
+ * which is mostly waiting for the storage, especially on network
+ * filesystems. Do that for all the @data jobs using a few threads.
+ */
+static void
+storageBackendProbeVols(storageBackendProbeDataPtr data)
+{
+    g_autofree virThread *threads = NULL;
+    size_t nthreads = 0;
+    size_t nworkers;
+    int ncpus;
+    size_t i;
+
+    if ((ncpus = virHostCPUGetCount()) <= 0) {
+        virResetLastError();
+        ncpus = 1;
+    }
+
+    nworkers = MIN(MIN(ncpus, STORAGE_BACKEND_PROBE_WORKERS), data->njobs);
+
+    /* The calling thread is one of the workers */
+    if (nworkers > 1) {
+        threads = g_new0(virThread, nworkers - 1);
+        for (i = 0; i < nworkers - 1; i++) {
+            if (virThreadCreateFull(&threads[nthreads], true,
+                                    storageBackendProbeWorker,
+                                    "vol-probe", false, data) < 0) {
+                /* Not fatal; whoever runs picks up the remaining jobs */
+                VIR_WARN("Unable to create volume probing thread");
+                break;
+            }
+            nthreads++;
+        }
+    }
+
+    storageBackendProbeWorker(data);
+
+    for (i = 0; i < nthreads; i++)
+        virThreadJoin(&threads[i]);
+}
+
+
 /**
  * Iterate over the pool's directory and enumerate all disk images
  * within it. This is non-recursive.
+ *
+ * Volumes already known from a previous refresh are kept as they are
+ * if their file wasn't changed since, which saves reopening and
+ * probing every image in large pools. Volumes whose file is gone are
+ * removed from the pool.
  */
 int
 virStorageBackendRefreshLocal(virStoragePoolObjPtr pool)
@@ -3485,15 +3838,23 @@ virStorageBackendRefreshLocal(virStoragePoolObjPtr pool)
     struct stat statbuf;
     int direrr;
     int ret = -1;
+    size_t i;
     g_autoptr(virStorageVolDef) vol = NULL;
     VIR_AUTOCLOSE fd = -1;
     g_autoptr(virStorageSource) target = NULL;
+    g_autoptr(virHashTable) seen = NULL;
+    struct storageBackendStaleVolsData stale = { 0 };
+    storageBackendProbeData probe = { 0 };
+
+    if (!(seen = virHashNew(NULL)))
+        goto cleanup;
 
     if (virDirOpen(&dir, def->target.path) < 0)
         goto cleanup;
 
     while ((direrr = virDirRead(dir, &ent, def->target.path)) > 0) {
-        int err;
+        virStorageVolDefPtr oldvol;
+        storageBackendProbeJob job = { 0 };
 
         if (virStringHasControlChars(ent->d_name)) {
             VIR_WARN("Ignoring file '%s' with control characters under '%s'",
@@ -3501,6 +3862,21 @@ virStorageBackendRefreshLocal(virStoragePoolObjPtr pool)
             continue;
         }
 
+        if ((oldvol = virStorageVolDefFindByName(pool, ent->d_name))) {
+            g_autofree char *path = g_strdup_printf("%s/%s", def->target.path,
+                                                    ent->d_name);
+
+            if (stat(path, &statbuf) == 0 &&
+                storageBackendVolIsUnchanged(oldvol, &statbuf)) {
+                if (virHashAddEntry(seen, ent->d_name, (void *)1) < 0)
+                    goto cleanup;
+                continue;
+            }
+
+            /* Probe the volume anew */
+            virStoragePoolObjRemoveVol(pool, oldvol);
+        }
+
         if (VIR_ALLOC(vol) < 0)
             goto cleanup;
 
@@ -3511,24 +3887,43 @@ virStorageBackendRefreshLocal(virStoragePoolObjPtr pool)
 
         vol->key = g_strdup(vol->target.path);
 
-        if ((err = virStorageBackendRefreshVolTargetUpdate(vol)) < 0) {
-            if (err == -2) {
-                /* Silently ignore non-regular files,
-                 * eg 'lost+found', dangling symbolic link */
-                virStorageVolDefFree(vol);
-                vol = NULL;
+        job.vol = g_steal_pointer(&vol);
+        if (VIR_APPEND_ELEMENT(probe.jobs, probe.njobs, job) < 0)
+            goto cleanup;
+    }
+    if (direrr < 0)
+        goto cleanup;
+    VIR_DIR_CLOSE(dir);
+
+    storageBackendProbeVols(&probe);
+
+    for (i = 0; i < probe.njobs; i++) {
+        storageBackendProbeJobPtr probed = &probe.jobs[i];
+
+        if (probed->err < 0) {
+            /* Silently ignore non-regular files,
+             * eg 'lost+found', dangling symbolic link */
+            if (probed->err == -2)
                 continue;
-            }
+
+            virErrorRestore(&probed->error);
             goto cleanup;
         }
 
-        if (virStoragePoolObjAddVol(pool, vol) < 0)
+        if (virStoragePoolObjAddVol(pool, probed->vol) < 0)
+            goto cleanup;
+
+        if (virHashAddEntry(seen, probed->vol->name, (void *)1) < 0) {
+            probed->vol = NULL;
             goto cleanup;
-        vol = NULL;
+        }
+        probed->vol = NULL;
     }
-    if (direrr < 0)
-        goto cleanup;
-    VIR_DIR_CLOSE(dir);
+
+    stale.seen = seen;
+    virStoragePoolObjForEachVolume(pool, storageBackendCollectStaleVol, &stale);
+    for (i = 0; i < stale.nvols; i++)
+        virStoragePoolObjRemoveVol(pool, stale.vols[i]);
 
     if (!(target = virStorageSourceNew()))
         goto cleanup;
@@ -3573,6 +3968,12 @@ virStorageBackendRefreshLocal(virStoragePoolObjPtr pool)
     ret = 0;
  cleanup:
     VIR_DIR_CLOSE(dir);
+    VIR_FREE(stale.vols);
+    for (i = 0; i < probe.njobs; i++) {
+        virStorageVolDefFree(probe.jobs[i].vol);
+        virFreeError(probe.jobs[i].error);
+    }
+    VIR_FREE(probe.jobs);
     return ret;
 }
 
@@ -118,11 +118,19 @@ struct _testDriver {
     virDomainObjListPtr domains;
     virNetworkObjListPtr networks;
     virObjectEventStatePtr eventState;
+
+    /* synthetic events of test:///scale, protected by the object lock */
+    int scaleTimer;
+    size_t scaleEvents; /* per firing of the timer */
+    size_t scaleDomains;
+    size_t scaleNext;
 };
 typedef struct _testDriver testDriver;
 typedef testDriver *testDriverPtr;
 
 static testDriverPtr defaultPrivconn;
+static testDriverPtr scalePrivconn;
+static char *scaleQuery;
 static virMutex defaultLock = VIR_MUTEX_INITIALIZER;
 
 static virClassPtr testDriverClass;
@@ -157,6 +165,9 @@ testDriverDispose(void *obj)
     testDriverPtr driver = obj;
     size_t i;
 
+    if (driver->scaleTimer >= 0)
+        virEventRemoveTimeout(driver->scaleTimer);
+
     virObjectUnref(driver->caps);
     virObjectUnref(driver->xmlopt);
     virObjectUnref(driver->domains);
@@ -480,6 +491,7 @@ testDriverNew(void)
         goto error;
 
     g_atomic_int_set(&ret->nextDomID, 1);
+    ret->scaleTimer = -1;
 
     return ret;
 
@@ -1393,6 +1405,333 @@ testOpenDefault(virConnectPtr conn)
     goto cleanup;
 }
 
+typedef struct _testScaleParams testScaleParams;
+struct _testScaleParams {
+    unsigned int domains;
+    unsigned int disks;
+    unsigned int nics;
+    unsigned int networks;
+    unsigned int pools;
+    unsigned int events;
+};
+
+static int
+testScaleParseParams(virURIPtr uri,
+                     testScaleParams *params)
+{
+    size_t i;
+
+    params->domains = 1000;
+    params->disks = 1;
+    params->nics = 1;
+    params->networks = 1;
+    params->pools = 1;
+    params->events = 0;
+
+    for (i = 0; i < uri->paramsCount; i++) {
+        virURIParamPtr param = &uri->params[i];
+        unsigned int *value;
+
+        if (STREQ(param->name, "domains"))
+            value = &params->domains;
+        else if (STREQ(param->name, "disks"))
+            value = &params->disks;
+        else if (STREQ(param->name, "nics"))
+            value = &params->nics;
+        else if (STREQ(param->name, "networks"))
+            value = &params->networks;
+        else if (STREQ(param->name, "pools"))
+            value = &params->pools;
+        else if (STREQ(param->name, "events"))
+            value = &params->events;
+        else
+            continue;
+
+        if (virStrToLong_uip(param->value, NULL, 10, value) < 0) {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("invalid value '%s' of parameter '%s'"),
+                           param->value, param->name);
+            return -1;
+        }
+    }
+
+    if (params->nics > 0 && params->networks == 0) {
+        virReportError(VIR_ERR_INVALID_ARG, "%s",
+                       _("domains with interfaces need at least one network"));
+        return -1;
+    }
+
+    if (params->disks > 26 * 27 || params->nics > 1024) {
+        virReportError(VIR_ERR_INVALID_ARG, "%s",
+                       _("too many disks or interfaces per domain"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* Generates the <node> document of test:///scale. Every fourth domain is
+ * shut off, the others run. */
+static char *
+testScaleFormatNode(const testScaleParams *params)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+    size_t j;
+
+    virBufferAddLit(&buf, "<node xmlns:test='http://libvirt.org/schemas/domain/test/1.0'>\n");
+    virBufferAdjustIndent(&buf, 2);
+
+    for (i = 0; i < params->domains; i++) {
+        virBufferAddLit(&buf, "<domain type='test'>\n");
+        virBufferAdjustIndent(&buf, 2);
+        virBufferAsprintf(&buf, "<name>scale-%zu</name>\n", i);
+        virBufferAsprintf(&buf, "<uuid>5ca1e000-0000-4000-8000-%012zx</uuid>\n", i);
+        virBufferAddLit(&buf, "<memory>2097152</memory>\n");
+        virBufferAddLit(&buf, "<currentMemory>1048576</currentMemory>\n");
+        virBufferAsprintf(&buf, "<vcpu>%zu</vcpu>\n", 1 + i % 4);
+        virBufferAddLit(&buf, "<os><type>hvm</type></os>\n");
+        virBufferAddLit(&buf, "<devices>\n");
+        virBufferAdjustIndent(&buf, 2);
+
+        for (j = 0; j < params->disks; j++) {
+            g_autofree char *dev = virIndexToDiskName(j, "vd");
+
+            virBufferAddLit(&buf, "<disk type='file' device='disk'>\n");
+            virBufferAsprintf(&buf, "  <source file='/scale-pool-%zu/scale-%zu-%s.img'/>\n",
+                              (i + j) % MAX(params->pools, 1), i, dev);
+            virBufferAsprintf(&buf, "  <target dev='%s' bus='virtio'/>\n", dev);
+            virBufferAddLit(&buf, "</disk>\n");
+        }
+
+        for (j = 0; j < params->nics; j++) {
+            size_t mac = i * params->nics + j;
+
+            virBufferAddLit(&buf, "<interface type='network'>\n");
+            virBufferAsprintf(&buf, "  <mac address='52:54:00:%02zx:%02zx:%02zx'/>\n",
+                              (mac >> 16) & 0xff, (mac >> 8) & 0xff, mac & 0xff);
+            virBufferAsprintf(&buf, "  <source network='scale-net-%zu'/>\n",
+                              (i + j) % params->networks);
+            virBufferAddLit(&buf, "</interface>\n");
+        }
+
+        virBufferAddLit(&buf, "<memballoon model='virtio'/>\n");
+        virBufferAdjustIndent(&buf, -2);
+        virBufferAddLit(&buf, "</devices>\n");
+        if (i % 4 == 3)
+            virBufferAsprintf(&buf, "<test:runstate>%d</test:runstate>\n",
+                              VIR_DOMAIN_SHUTOFF);
+        virBufferAdjustIndent(&buf, -2);
+        virBufferAddLit(&buf, "</domain>\n");
+    }
+
+    for (i = 0; i < params->networks; i++) {
+        virBufferAddLit(&buf, "<network>\n");
+        virBufferAsprintf(&buf, "  <name>scale-net-%zu</name>\n", i);
+        virBufferAsprintf(&buf, "  <uuid>5ca1e000-0000-4000-8001-%012zx</uuid>\n", i);
+        virBufferAsprintf(&buf, "  <bridge name='scalebr%zu'/>\n", i);
+        virBufferAsprintf(&buf, "  <ip address='10.%zu.%zu.1' netmask='255.255.255.0'/>\n",
+                          (i >> 8) & 0xff, i & 0xff);
+        virBufferAddLit(&buf, "</network>\n");
+    }
+
+    for (i = 0; i < params->pools; i++) {
+        virBufferAddLit(&buf, "<pool type='dir'>\n");
+        virBufferAsprintf(&buf, "  <name>scale-pool-%zu</name>\n", i);
+        virBufferAsprintf(&buf, "  <uuid>5ca1e000-0000-4000-8002-%012zx</uuid>\n", i);
+        virBufferAsprintf(&buf, "  <target><path>/scale-pool-%zu</path></target>\n", i);
+        virBufferAddLit(&buf, "</pool>\n");
+    }
+
+    virBufferAdjustIndent(&buf, -2);
+    virBufferAddLit(&buf, "</node>\n");
+
+    return virBufferContentAndReset(&buf);
+}
+
+
+static void testDriverCloseInternal(testDriverPtr driver);
+
+/* Pauses or resumes the next domains of test:///scale in turn, so that
+ * clients see a steady stream of lifecycle events. */
+static void
+testScaleEmitEvents(int timer G_GNUC_UNUSED,
+                    void *opaque G_GNUC_UNUSED)
+{
+    testDriverPtr privconn;
+    size_t i;
+
+    virMutexLock(&defaultLock);
+    if ((privconn = scalePrivconn))
+        virObjectRef(privconn);
+    virMutexUnlock(&defaultLock);
+
+    if (!privconn)
+        return;
+
+    for (i = 0; i < privconn->scaleEvents; i++) {
+        g_autofree char *name = NULL;
+        virDomainObjPtr vm;
+        virObjectEventPtr event = NULL;
+
+        virObjectLock(privconn);
+        name = g_strdup_printf("scale-%zu",
+                               privconn->scaleNext++ % privconn->scaleDomains);
+        virObjectUnlock(privconn);
+
+        if (!(vm = virDomainObjListFindByName(privconn->domains, name)))
+            continue;
+
+        switch ((virDomainState) virDomainObjGetState(vm, NULL)) {
+        case VIR_DOMAIN_RUNNING:
+            virDomainObjSetState(vm, VIR_DOMAIN_PAUSED,
+                                 VIR_DOMAIN_PAUSED_USER);
+            event = virDomainEventLifecycleNewFromObj(vm,
+                                     VIR_DOMAIN_EVENT_SUSPENDED,
+                                     VIR_DOMAIN_EVENT_SUSPENDED_PAUSED);
+            break;
+
+        case VIR_DOMAIN_PAUSED:
+            virDomainObjSetState(vm, VIR_DOMAIN_RUNNING,
+                                 VIR_DOMAIN_RUNNING_UNPAUSED);
+            event = virDomainEventLifecycleNewFromObj(vm,
+                                     VIR_DOMAIN_EVENT_RESUMED,
+                                     VIR_DOMAIN_EVENT_RESUMED_UNPAUSED);
+            break;
+
+        case VIR_DOMAIN_NOSTATE:
+        case VIR_DOMAIN_BLOCKED:
+        case VIR_DOMAIN_SHUTDOWN:
+        case VIR_DOMAIN_SHUTOFF:
+        case VIR_DOMAIN_CRASHED:
+        case VIR_DOMAIN_PMSUSPENDED:
+        case VIR_DOMAIN_LAST:
+            break;
+        }
+
+        virDomainObjEndAPI(&vm);
+        virObjectEventStateQueue(privconn->eventState, event);
+    }
+
+    testDriverCloseInternal(privconn);
+}
+
+
+/* Simultaneous test:///scale connections with the same parameters share
+ * their state, just like test:///default, so that benchmarks of event
+ * delivery see the events of all clients. The objects are generated from
+ * the URI parameters:
+ *
+ *   domains, disks, nics: domains and their disks and interfaces
+ *   networks, pools: networks and storage pools used by the domains
+ *   events: lifecycle events generated per second
+ */
+static int
+testOpenScale(virConnectPtr conn)
+{
+    int ret = VIR_DRV_OPEN_ERROR;
+    testDriverPtr privconn = NULL;
+    testScaleParams params;
+    g_autofree char *query = NULL;
+    g_autofree char *xml = NULL;
+    xmlDocPtr doc = NULL;
+    xmlXPathContextPtr ctxt = NULL;
+    size_t i;
+
+    if (testScaleParseParams(conn->uri, &params) < 0)
+        return VIR_DRV_OPEN_ERROR;
+
+    query = g_strdup_printf("domains=%u&disks=%u&nics=%u&networks=%u&pools=%u&events=%u",
+                            params.domains, params.disks, params.nics,
+                            params.networks, params.pools, params.events);
+
+    virMutexLock(&defaultLock);
+    if (scalePrivconn) {
+        if (STRNEQ(scaleQuery, query)) {
+            virReportError(VIR_ERR_OPERATION_INVALID,
+                           _("test:///scale is already open with %s"),
+                           scaleQuery);
+            goto cleanup;
+        }
+
+        conn->privateData = virObjectRef(scalePrivconn);
+        ret = VIR_DRV_OPEN_SUCCESS;
+        goto cleanup;
+    }
+
+    if (!(privconn = testDriverNew()))
+        goto error;
+
+    conn->privateData = privconn;
+
+    memmove(&privconn->nodeInfo, &defaultNodeInfo, sizeof(defaultNodeInfo));
+
+    privconn->numCells = 2;
+    privconn->cells = g_new0(testCell, privconn->numCells);
+    for (i = 0; i < privconn->numCells; i++) {
+        privconn->cells[i].numCpus = 8;
+        privconn->cells[i].mem = (i + 1) * 2048 * 1024;
+        privconn->cells[i].freeMem = (i + 1) * 1024 * 1024;
+    }
+    for (i = 0; i < 16; i++) {
+        virBitmapPtr siblings = virBitmapNew(16);
+        if (!siblings)
+            goto error;
+        ignore_value(virBitmapSetBit(siblings, i));
+        privconn->cells[i / 8].cpus[(i % 8)].id = i;
+        privconn->cells[i / 8].cpus[(i % 8)].socket_id = i / 8;
+        privconn->cells[i / 8].cpus[(i % 8)].core_id = i % 8;
+        privconn->cells[i / 8].cpus[(i % 8)].siblings = siblings;
+    }
+
+    if (!(privconn->caps = testBuildCapabilities(conn)))
+        goto error;
+
+    xml = testScaleFormatNode(&params);
+
+    if (!(doc = virXMLParseStringCtxt(xml, _("(test driver)"), &ctxt)))
+        goto error;
+
+    if (testOpenParse(privconn, NULL, ctxt) < 0)
+        goto error;
+
+    if (params.events > 0 && params.domains > 0) {
+        int interval = 100;
+
+        /* fire at most ten times per second, in batches if necessary */
+        if (params.events <= 10) {
+            interval = 1000 / params.events;
+            privconn->scaleEvents = 1;
+        } else {
+            privconn->scaleEvents = params.events / 10;
+        }
+        privconn->scaleDomains = params.domains;
+
+        if ((privconn->scaleTimer = virEventAddTimeout(interval,
+                                                       testScaleEmitEvents,
+                                                       NULL, NULL)) < 0) {
+            virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                           _("generating events requires an event loop"));
+            goto error;
+        }
+    }
+
+    scalePrivconn = privconn;
+    scaleQuery = g_steal_pointer(&query);
+    ret = VIR_DRV_OPEN_SUCCESS;
+ cleanup:
+    virMutexUnlock(&defaultLock);
+    xmlXPathFreeContext(ctxt);
+    xmlFreeDoc(doc);
+    return ret;
+
+ error:
+    virObjectUnref(privconn);
+    conn->privateData = NULL;
+    goto cleanup;
+}
+
 static int
 testConnectAuthenticate(virConnectPtr conn,
                         virConnectAuthPtr auth)
@@ -1453,6 +1792,10 @@ testDriverCloseInternal(testDriverPtr driver)
     virObjectUnref(driver);
     if (testDriverDisposed && driver == defaultPrivconn)
         defaultPrivconn = NULL;
+    if (testDriverDisposed && driver == scalePrivconn) {
+        scalePrivconn = NULL;
+        VIR_FREE(scaleQuery);
+    }
     virMutexUnlock(&defaultLock);
 }
 
@@ -1476,6 +1819,8 @@ testConnectOpen(virConnectPtr conn,
 
     if (STREQ(conn->uri->path, "/default"))
         ret = testOpenDefault(conn);
+    else if (STREQ(conn->uri->path, "/scale"))
+        ret = testOpenScale(conn);
     else
         ret = testOpenFromFile(conn,
                                conn->uri->path);
@@ -1636,6 +1981,10 @@ testConnectSupportsFeature(virConnectPtr conn G_GNUC_UNUSED,
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_STATS_COMPACT:
+    case VIR_DRV_FEATURE_REMOTE_PIPELINE:
+    case VIR_DRV_FEATURE_REMOTE_CALL_BATCH:
+    case VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PACKETS:
     default:
         return 0;
     }
@@ -5174,6 +5523,229 @@ testDomainInterfaceStats(virDomainPtr domain,
 }
 
 
+
+#define TEST_DOMAIN_STATS_SUPPORTED \
+    (VIR_DOMAIN_STATS_STATE | \
+     VIR_DOMAIN_STATS_CPU_TOTAL | \
+     VIR_DOMAIN_STATS_BALLOON | \
+     VIR_DOMAIN_STATS_VCPU | \
+     VIR_DOMAIN_STATS_INTERFACE | \
+     VIR_DOMAIN_STATS_BLOCK)
+
+/* Fills @params with the stats of @dom selected by @stats. Counters grow
+ * with time like the ones of testDomainBlockStats and friends, but differ
+ * between domains and devices. */
+static int
+testDomainGetStatsParams(virDomainObjPtr dom,
+                         unsigned int stats,
+                         virTypedParamListPtr params)
+{
+    virDomainDefPtr def = dom->def;
+    bool active = virDomainObjIsActive(dom);
+    unsigned long long statbase = g_get_real_time();
+    unsigned long long seed = def->uuid[VIR_UUID_BUFLEN - 1] + 1;
+    size_t i;
+
+    if (stats & VIR_DOMAIN_STATS_STATE) {
+        int state;
+        int reason;
+
+        state = virDomainObjGetState(dom, &reason);
+        if (virTypedParamListAddInt(params, state, "state.state") < 0 ||
+            virTypedParamListAddInt(params, reason, "state.reason") < 0)
+            return -1;
+    }
+
+    if (!active)
+        return 0;
+
+    if (stats & VIR_DOMAIN_STATS_CPU_TOTAL) {
+        unsigned long long cputime = statbase * seed;
+
+        if (virTypedParamListAddULLong(params, cputime, "cpu.time") < 0 ||
+            virTypedParamListAddULLong(params, cputime / 4, "cpu.user") < 0 ||
+            virTypedParamListAddULLong(params, cputime / 8, "cpu.system") < 0)
+            return -1;
+    }
+
+    if (stats & VIR_DOMAIN_STATS_BALLOON) {
+        if (virTypedParamListAddULLong(params, def->mem.cur_balloon,
+                                       "balloon.current") < 0 ||
+            virTypedParamListAddULLong(params, virDomainDefGetMemoryTotal(def),
+                                       "balloon.maximum") < 0 ||
+            virTypedParamListAddULLong(params, def->mem.cur_balloon / (seed % 4 + 2),
+                                       "balloon.unused") < 0)
+            return -1;
+    }
+
+    if (stats & VIR_DOMAIN_STATS_VCPU) {
+        unsigned int vcpus = virDomainDefGetVcpus(def);
+
+        if (virTypedParamListAddUInt(params, vcpus, "vcpu.current") < 0 ||
+            virTypedParamListAddUInt(params, virDomainDefGetVcpusMax(def),
+                                     "vcpu.maximum") < 0)
+            return -1;
+
+        for (i = 0; i < vcpus; i++) {
+            if (virTypedParamListAddInt(params, VIR_VCPU_RUNNING,
+                                        "vcpu.%zu.state", i) < 0 ||
+                virTypedParamListAddULLong(params, statbase * seed / (i + 1),
+                                           "vcpu.%zu.time", i) < 0)
+                return -1;
+        }
+    }
+
+    if (stats & VIR_DOMAIN_STATS_INTERFACE) {
+        if (virTypedParamListAddUInt(params, def->nnets, "net.count") < 0)
+            return -1;
+
+        for (i = 0; i < def->nnets; i++) {
+            unsigned long long base = statbase / (i + 1) * seed;
+
+            if (def->nets[i]->ifname &&
+                virTypedParamListAddString(params, def->nets[i]->ifname,
+                                           "net.%zu.name", i) < 0)
+                return -1;
+
+            if (virTypedParamListAddULLong(params, base / 10,
+                                           "net.%zu.rx.bytes", i) < 0 ||
+                virTypedParamListAddULLong(params, base / 100,
+                                           "net.%zu.rx.pkts", i) < 0 ||
+                virTypedParamListAddULLong(params, base / (1000LL * 1000LL * 1),
+                                           "net.%zu.rx.errs", i) < 0 ||
+                virTypedParamListAddULLong(params, base / (1000LL * 1000LL * 2),
+                                           "net.%zu.rx.drop", i) < 0 ||
+                virTypedParamListAddULLong(params, base / 20,
+                                           "net.%zu.tx.bytes", i) < 0 ||
+                virTypedParamListAddULLong(params, base / 110,
+                                           "net.%zu.tx.pkts", i) < 0 ||
+                virTypedParamListAddULLong(params, base / (1000LL * 1000LL * 3),
+                                           "net.%zu.tx.errs", i) < 0 ||
+                virTypedParamListAddULLong(params, base / (1000LL * 1000LL * 4),
+                                           "net.%zu.tx.drop", i) < 0)
+                return -1;
+        }
+    }
+
+    if (stats & VIR_DOMAIN_STATS_BLOCK) {
+        if (virTypedParamListAddUInt(params, def->ndisks, "block.count") < 0)
+            return -1;
+
+        for (i = 0; i < def->ndisks; i++) {
+            virDomainDiskDefPtr disk = def->disks[i];
+            unsigned long long base = statbase / (i + 1) * seed;
+
+            if (virTypedParamListAddString(params, disk->dst,
+                                           "block.%zu.name", i) < 0)
+                return -1;
+
+            if (virDomainDiskGetSource(disk) &&
+                virTypedParamListAddString(params, virDomainDiskGetSource(disk),
+                                           "block.%zu.path", i) < 0)
+                return -1;
+
+            if (virTypedParamListAddULLong(params, base / 10,
+                                           "block.%zu.rd.reqs", i) < 0 ||
+                virTypedParamListAddULLong(params, base / 20,
+                                           "block.%zu.rd.bytes", i) < 0 ||
+                virTypedParamListAddULLong(params, base / 30,
+                                           "block.%zu.wr.reqs", i) < 0 ||
+                virTypedParamListAddULLong(params, base / 40,
+                                           "block.%zu.wr.bytes", i) < 0 ||
+                virTypedParamListAddULLong(params, 10ULL << 30,
+                                           "block.%zu.capacity", i) < 0 ||
+                virTypedParamListAddULLong(params, (seed % 10 + 1) << 29,
+                                           "block.%zu.allocation", i) < 0)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int
+testConnectGetAllDomainStats(virConnectPtr conn,
+                             virDomainPtr *doms,
+                             unsigned int ndoms,
+                             unsigned int stats,
+                             virDomainStatsRecordPtr **retStats,
+                             unsigned int flags)
+{
+    testDriverPtr privconn = conn->privateData;
+    virDomainObjPtr *vms = NULL;
+    size_t nvms;
+    virDomainStatsRecordPtr *tmpstats = NULL;
+    int nstats = 0;
+    size_t i;
+    int ret = -1;
+    unsigned int lflags = flags & (VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE);
+
+    virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                  VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                  VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
+
+    if (stats == 0) {
+        stats = TEST_DOMAIN_STATS_SUPPORTED;
+    } else if (stats & ~TEST_DOMAIN_STATS_SUPPORTED) {
+        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS) {
+            virReportError(VIR_ERR_ARGUMENT_UNSUPPORTED,
+                           _("Stats types bits 0x%x are not supported by this daemon"),
+                           stats & ~TEST_DOMAIN_STATS_SUPPORTED);
+            return -1;
+        }
+        stats &= TEST_DOMAIN_STATS_SUPPORTED;
+    }
+
+    if (ndoms) {
+        if (virDomainObjListConvert(privconn->domains, conn, doms, ndoms, &vms,
+                                    &nvms, NULL, lflags, true) < 0)
+            return -1;
+    } else {
+        if (virDomainObjListCollect(privconn->domains, conn, &vms, &nvms,
+                                    NULL, lflags) < 0)
+            return -1;
+    }
+
+    tmpstats = g_new0(virDomainStatsRecordPtr, nvms + 1);
+
+    for (i = 0; i < nvms; i++) {
+        g_autoptr(virTypedParamList) params = g_new0(virTypedParamList, 1);
+        virDomainStatsRecordPtr tmp;
+        int rc;
+
+        virObjectLock(vms[i]);
+        rc = testDomainGetStatsParams(vms[i], stats, params);
+        virObjectUnlock(vms[i]);
+
+        if (rc < 0)
+            goto cleanup;
+
+        tmp = g_new0(virDomainStatsRecord, 1);
+        if (!(tmp->dom = virGetDomain(conn, vms[i]->def->name,
+                                      vms[i]->def->uuid, vms[i]->def->id))) {
+            g_free(tmp);
+            goto cleanup;
+        }
+        tmp->nparams = virTypedParamListStealParams(params, &tmp->params);
+        tmpstats[nstats++] = tmp;
+    }
+
+    *retStats = g_steal_pointer(&tmpstats);
+    ret = nstats;
+
+ cleanup:
+    virDomainStatsRecordListFree(tmpstats);
+    virObjectListFreeCount(vms, nvms);
+    return ret;
+}
+
+
 static virNetworkObjPtr
 testNetworkObjFindByUUID(testDriverPtr privconn,
                          const unsigned char *uuid)
@@ -9386,6 +9958,7 @@ static virHypervisorDriver testHypervisorDriver = {
     .domainBlockStats = testDomainBlockStats, /* 0.7.0 */
     .domainInterfaceAddresses = testDomainInterfaceAddresses, /* 5.4.0 */
     .domainInterfaceStats = testDomainInterfaceStats, /* 0.7.0 */
+    .connectGetAllDomainStats = testConnectGetAllDomainStats, /* 6.7.0 */
     .nodeGetCellsFreeMemory = testNodeGetCellsFreeMemory, /* 0.4.2 */
     .connectDomainEventRegister = testConnectDomainEventRegister, /* 0.6.0 */
     .connectDomainEventDeregister = testConnectDomainEventDeregister, /* 0.6.0 */
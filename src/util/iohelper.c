@@ -42,32 +42,168 @@
 # define O_DIRECT 0
 #endif
 
+/* Number of buffers data read from the input is queued in while the
+ * writer thread drains them into the output, and size of each. */
+#define IOHELPER_NBUFS 4
+#define IOHELPER_BUFLEN (1024 * 1024)
+#define IOHELPER_ALIGN (64 * 1024)
+
+typedef struct _ioHelperBuf ioHelperBuf;
+typedef ioHelperBuf *ioHelperBufPtr;
+struct _ioHelperBuf {
+    void *base; /* Location to be freed */
+    char *buf; /* Aligned location within base */
+    ssize_t len;
+};
+
+typedef struct _ioHelperQueue ioHelperQueue;
+typedef ioHelperQueue *ioHelperQueuePtr;
+struct _ioHelperQueue {
+    virMutex lock;
+    virCond cond;
+
+    ioHelperBuf bufs[IOHELPER_NBUFS];
+    size_t head; /* next buffer to be filled by the reader */
+    size_t count; /* number of filled buffers waiting to be written */
+
+    bool eof; /* the reader won't queue any more buffers */
+    bool failed; /* the writer gave up, @err holds the reason */
+    virErrorPtr err;
+
+    int fd;
+    int fdout;
+    const char *fdoutname;
+    bool direct;
+};
+
+
+static int
+ioHelperBufAlloc(ioHelperBufPtr buf)
+{
+    intptr_t alignMask = IOHELPER_ALIGN - 1;
+
+#if HAVE_POSIX_MEMALIGN
+    if (posix_memalign(&buf->base, alignMask + 1, IOHELPER_BUFLEN)) {
+        virReportOOMError();
+        return -1;
+    }
+    buf->buf = buf->base;
+#else
+    if (VIR_ALLOC_N(buf->buf, IOHELPER_BUFLEN + alignMask) < 0)
+        return -1;
+    buf->base = buf->buf;
+    buf->buf = (char *) (((intptr_t) buf->base + alignMask) & ~alignMask);
+#endif
+    return 0;
+}
+
+
+static int
+ioHelperWrite(ioHelperQueuePtr queue,
+              ioHelperBufPtr buf,
+              unsigned long long *total)
+{
+    intptr_t alignMask = IOHELPER_ALIGN - 1;
+
+    *total += buf->len;
+
+    /* handle last write size align in direct case */
+    if (buf->len < IOHELPER_BUFLEN && queue->direct &&
+        queue->fdout == queue->fd) {
+        ssize_t aligned_len = (buf->len + alignMask) & ~alignMask;
+
+        memset(buf->buf + buf->len, 0, aligned_len - buf->len);
+
+        if (safewrite(queue->fdout, buf->buf, aligned_len) < 0) {
+            virReportSystemError(errno, _("Unable to write %s"),
+                                 queue->fdoutname);
+            return -1;
+        }
+
+        if (ftruncate(queue->fd, *total) < 0) {
+            virReportSystemError(errno, _("Unable to truncate %s"),
+                                 queue->fdoutname);
+            return -1;
+        }
+
+        return 0;
+    }
+
+    if (safewrite(queue->fdout, buf->buf, buf->len) < 0) {
+        virReportSystemError(errno, _("Unable to write %s"), queue->fdoutname);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* Drains buffers filled by runIO in the order they were queued, so that
+ * reading the next chunk of input overlaps writing the previous one. */
+static void
+ioHelperWriter(void *opaque)
+{
+    ioHelperQueuePtr queue = opaque;
+    unsigned long long total = 0;
+    size_t tail = 0;
+
+    virMutexLock(&queue->lock);
+
+    while (1) {
+        ioHelperBufPtr buf;
+        int rc;
+
+        while (queue->count == 0 && !queue->eof)
+            virCondWait(&queue->cond, &queue->lock);
+
+        if (queue->count == 0)
+            break;
+
+        buf = &queue->bufs[tail];
+
+        virMutexUnlock(&queue->lock);
+        rc = ioHelperWrite(queue, buf, &total);
+        virMutexLock(&queue->lock);
+
+        if (rc < 0) {
+            virErrorPreserveLast(&queue->err);
+            queue->failed = true;
+            virCondSignal(&queue->cond);
+            break;
+        }
+
+        tail = (tail + 1) % IOHELPER_NBUFS;
+        queue->count--;
+        virCondSignal(&queue->cond);
+    }
+
+    virMutexUnlock(&queue->lock);
+}
+
+
 static int
 runIO(const char *path, int fd, int oflags)
 {
-    g_autofree void *base = NULL; /* Location to be freed */
-    char *buf = NULL; /* Aligned location within base */
-    size_t buflen = 1024*1024;
-    intptr_t alignMask = 64*1024 - 1;
+    ioHelperQueue queue = { .fd = fd };
+    virThread writer;
+    bool done = false;
     int ret = -1;
     int fdin, fdout;
     const char *fdinname, *fdoutname;
-    unsigned long long total = 0;
     bool direct = O_DIRECT && ((oflags & O_DIRECT) != 0);
     off_t end = 0;
+    size_t i;
 
-#if HAVE_POSIX_MEMALIGN
-    if (posix_memalign(&base, alignMask + 1, buflen)) {
-        virReportOOMError();
+    if (virMutexInit(&queue.lock) < 0 ||
+        virCondInit(&queue.cond) < 0) {
+        virReportSystemError(errno, "%s", _("Unable to initialize I/O queue"));
         goto cleanup;
     }
-    buf = base;
-#else
-    if (VIR_ALLOC_N(buf, buflen + alignMask) < 0)
-        goto cleanup;
-    base = buf;
-    buf = (char *) (((intptr_t) base + alignMask) & ~alignMask);
-#endif
+
+    for (i = 0; i < IOHELPER_NBUFS; i++) {
+        if (ioHelperBufAlloc(&queue.bufs[i]) < 0)
+            goto cleanup;
+    }
 
     switch (oflags & O_ACCMODE) {
     case O_RDONLY:
@@ -105,9 +241,31 @@ runIO(const char *path, int fd, int oflags)
         goto cleanup;
     }
 
+    queue.fdout = fdout;
+    queue.fdoutname = fdoutname;
+    queue.direct = direct;
+
+    if (virThreadCreate(&writer, true, ioHelperWriter, &queue) < 0) {
+        virReportSystemError(errno, "%s", _("Unable to create writer thread"));
+        goto cleanup;
+    }
+
+    virMutexLock(&queue.lock);
+
     while (1) {
+        ioHelperBufPtr buf;
         ssize_t got;
 
+        while (queue.count == IOHELPER_NBUFS && !queue.failed)
+            virCondWait(&queue.cond, &queue.lock);
+
+        if (queue.failed)
+            break;
+
+        /* The writer never touches buffers which are not queued */
+        buf = &queue.bufs[queue.head];
+        virMutexUnlock(&queue.lock);
+
         /* If we read with O_DIRECT from file we can't use saferead as
          * it can lead to unaligned read after reading last bytes.
          * If we write with O_DIRECT use should use saferead so that
@@ -115,47 +273,50 @@ runIO(const char *path, int fd, int oflags)
          * In other cases using saferead reduces number of syscalls.
          */
         if (fdin == fd && direct) {
-            if ((got = read(fdin, buf, buflen)) < 0 &&
-                errno == EINTR)
-                continue;
+            while ((got = read(fdin, buf->buf, IOHELPER_BUFLEN)) < 0 &&
+                   errno == EINTR)
+                ;
         } else {
-            got = saferead(fdin, buf, buflen);
+            got = saferead(fdin, buf->buf, IOHELPER_BUFLEN);
         }
 
+        virMutexLock(&queue.lock);
+
         if (got < 0) {
             virReportSystemError(errno, _("Unable to read %s"), fdinname);
-            goto cleanup;
+            break;
         }
-        if (got == 0)
+        if (got == 0) {
+            done = true;
             break;
+        }
 
-        total += got;
-
-        /* handle last write size align in direct case */
-        if (got < buflen && direct && fdout == fd) {
-            ssize_t aligned_got = (got + alignMask) & ~alignMask;
-
-            memset(buf + got, 0, aligned_got - got);
-
-            if (safewrite(fdout, buf, aligned_got) < 0) {
-                virReportSystemError(errno, _("Unable to write %s"), fdoutname);
-                goto cleanup;
-            }
-
-            if (ftruncate(fd, total) < 0) {
-                virReportSystemError(errno, _("Unable to truncate %s"), fdoutname);
-                goto cleanup;
-            }
+        buf->len = got;
+        queue.head = (queue.head + 1) % IOHELPER_NBUFS;
+        queue.count++;
+        virCondSignal(&queue.cond);
 
+        /* The last, unaligned chunk of an O_DIRECT write ends the file */
+        if (got < IOHELPER_BUFLEN && direct && fdout == fd) {
+            done = true;
             break;
         }
+    }
 
-        if (safewrite(fdout, buf, got) < 0) {
-            virReportSystemError(errno, _("Unable to write %s"), fdoutname);
-            goto cleanup;
-        }
+    queue.eof = true;
+    virCondSignal(&queue.cond);
+    virMutexUnlock(&queue.lock);
+
+    virThreadJoin(&writer);
+
+    if (queue.failed) {
+        virErrorRestore(&queue.err);
+        goto cleanup;
     }
 
+    if (!done)
+        goto cleanup;
+
     /* Ensure all data is written */
     if (virFileDataSync(fdout) < 0) {
         if (errno != EINVAL && errno != EROFS) {
@@ -168,6 +329,11 @@ runIO(const char *path, int fd, int oflags)
     ret = 0;
 
  cleanup:
+    for (i = 0; i < IOHELPER_NBUFS; i++)
+        g_free(queue.bufs[i].base);
+    virFreeError(queue.err);
+    virCondDestroy(&queue.cond);
+    virMutexDestroy(&queue.lock);
     if (VIR_CLOSE(fd) < 0 &&
         ret == 0) {
         virReportSystemError(errno, _("Unable to close %s"), path);
@@ -231,6 +231,33 @@ virBitmapSetBitExpand(virBitmapPtr bitmap,
 }
 
 
+/*
+ * Sets bits @start to @last of @bitmap a whole unit at a time. Both have
+ * to be in the bitmap.
+ */
+static void
+virBitmapSetRangeInternal(virBitmapPtr bitmap,
+                          size_t start,
+                          size_t last)
+{
+    size_t nl = VIR_BITMAP_UNIT_OFFSET(start);
+    size_t ml = VIR_BITMAP_UNIT_OFFSET(last);
+    unsigned long first = -1UL << VIR_BITMAP_BIT_OFFSET(start);
+    unsigned long tail = -1UL >> (VIR_BITMAP_BITS_PER_UNIT - 1 -
+                                  VIR_BITMAP_BIT_OFFSET(last));
+
+    if (nl == ml) {
+        bitmap->map[nl] |= first & tail;
+        return;
+    }
+
+    bitmap->map[nl++] |= first;
+    for (; nl < ml; nl++)
+        bitmap->map[nl] = -1UL;
+    bitmap->map[ml] |= tail;
+}
+
+
 /**
  * virBitmapClearBit:
  * @bitmap: Pointer to bitmap
@@ -405,39 +432,21 @@ char *
 virBitmapFormat(virBitmapPtr bitmap)
 {
     g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
-    bool first = true;
-    int start, cur, prev;
-
-    if (!bitmap || (cur = virBitmapNextSetBit(bitmap, -1)) < 0) {
-        char *ret;
-        ret = g_strdup("");
-        return ret;
-    }
+    ssize_t start = -1;
+    ssize_t last = -1;
 
-    start = prev = cur;
-    while (prev >= 0) {
-        cur = virBitmapNextSetBit(bitmap, prev);
+    if (!bitmap || virBitmapNextSetBit(bitmap, -1) < 0)
+        return g_strdup("");
 
-        if (cur == prev + 1) {
-            prev = cur;
-            continue;
-        }
-
-        /* cur < 0 or cur > prev + 1 */
-
-        if (!first)
-            virBufferAddLit(&buf, ",");
+    while ((start = virBitmapNextSetRange(bitmap, last, &last)) >= 0) {
+        if (start == last)
+            virBufferAsprintf(&buf, "%zd,", start);
         else
-            first = false;
-
-        if (prev == start)
-            virBufferAsprintf(&buf, "%d", start);
-        else
-            virBufferAsprintf(&buf, "%d-%d", start, prev);
-
-        start = prev = cur;
+            virBufferAsprintf(&buf, "%zd-%zd,", start, last);
     }
 
+    virBufferTrim(&buf, ",");
+
     return virBufferContentAndReset(&buf);
 }
 
@@ -473,7 +482,6 @@ virBitmapParseSeparator(const char *str,
     bool neg = false;
     const char *cur = str;
     char *tmp;
-    size_t i;
     int start, last;
 
     if (!(*bitmap = virBitmapNew(bitmapSize)))
@@ -533,10 +541,10 @@ virBitmapParseSeparator(const char *str,
 
             cur = tmp;
 
-            for (i = start; i <= last; i++) {
-                if (virBitmapSetBit(*bitmap, i) < 0)
-                    goto error;
-            }
+            if ((size_t) last >= (*bitmap)->nbits)
+                goto error;
+
+            virBitmapSetRangeInternal(*bitmap, start, last);
 
             virSkipSpaces(&cur);
         }
@@ -609,7 +617,6 @@ virBitmapParseUnlimited(const char *str)
     bool neg = false;
     const char *cur = str;
     char *tmp;
-    size_t i;
     int start, last;
 
     if (!str)
@@ -666,10 +673,10 @@ virBitmapParseUnlimited(const char *str)
 
             cur = tmp;
 
-            for (i = start; i <= last; i++) {
-                if (virBitmapSetBitExpand(bitmap, i) < 0)
-                    goto error;
-            }
+            if (bitmap->nbits <= (size_t) last && virBitmapExpand(bitmap, last) < 0)
+                goto error;
+
+            virBitmapSetRangeInternal(bitmap, start, last);
 
             virSkipSpaces(&cur);
         }
@@ -1025,7 +1032,6 @@ virBitmapNextSetBit(virBitmapPtr bitmap,
 ssize_t
 virBitmapLastSetBit(virBitmapPtr bitmap)
 {
-    ssize_t i;
     int unusedBits;
     ssize_t sz;
     unsigned long bits;
@@ -1055,12 +1061,8 @@ virBitmapLastSetBit(virBitmapPtr bitmap)
     return -1;
 
  found:
-    for (i = VIR_BITMAP_BITS_PER_UNIT - 1; i >= 0; i--) {
-        if (bits & 1UL << i)
-            return i + sz * VIR_BITMAP_BITS_PER_UNIT;
-    }
-
-    return -1;
+    return VIR_BITMAP_BITS_PER_UNIT - 1 - __builtin_clzl(bits) +
+           sz * VIR_BITMAP_BITS_PER_UNIT;
 }
 
 
@@ -1113,6 +1115,43 @@ virBitmapNextClearBit(virBitmapPtr bitmap,
 }
 
 
+/**
+ * virBitmapNextSetRange:
+ * @bitmap: the bitmap
+ * @pos: the position after which to search for set bits
+ * @last: filled with the position of the last bit of the range
+ *
+ * Search for the first range of consecutive set bits after position
+ * @pos in bitmap @bitmap, a whole unit at a time. @pos can be -1 to
+ * search from the first bit. Passing the returned @last as @pos
+ * iterates over all the ranges of @bitmap:
+ *
+ *   ssize_t start, last = -1;
+ *   while ((start = virBitmapNextSetRange(bitmap, last, &last)) >= 0)
+ *       ...bits start to last are set...
+ *
+ * Returns the position of the first bit of the range, or -1 if no bit
+ * is set after @pos.
+ */
+ssize_t
+virBitmapNextSetRange(virBitmapPtr bitmap,
+                      ssize_t pos,
+                      ssize_t *last)
+{
+    ssize_t start;
+    ssize_t end;
+
+    if ((start = virBitmapNextSetBit(bitmap, pos)) < 0)
+        return -1;
+
+    if ((end = virBitmapNextClearBit(bitmap, start)) < 0)
+        end = bitmap->nbits;
+
+    *last = end - 1;
+    return start;
+}
+
+
 /**
  * virBitmapCountBits:
  * @bitmap: bitmap to inspect
@@ -134,6 +134,9 @@ ssize_t virBitmapLastSetBit(virBitmapPtr bitmap)
 ssize_t virBitmapNextClearBit(virBitmapPtr bitmap, ssize_t pos)
     ATTRIBUTE_NONNULL(1);
 
+ssize_t virBitmapNextSetRange(virBitmapPtr bitmap, ssize_t pos, ssize_t *last)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(3);
+
 size_t virBitmapCountBits(virBitmapPtr bitmap)
     ATTRIBUTE_NONNULL(1);
 
@@ -291,6 +291,36 @@ virBufferUse(const virBuffer *buf)
     return buf->str->len;
 }
 
+/**
+ * virBufferReserve:
+ * @buf: the buffer
+ * @len: number of bytes expected to be appended
+ *
+ * Make sure @buf can take at least @len more bytes without having to
+ * reallocate.  This is purely an optimization for callers which know
+ * the approximate size of the content upfront; the buffer still grows
+ * on demand if the estimate was too small.
+ */
+void
+virBufferReserve(virBufferPtr buf, size_t len)
+{
+    size_t use;
+
+    if (!buf || len == 0)
+        return;
+
+    if (!buf->str) {
+        buf->str = g_string_sized_new(len);
+        return;
+    }
+
+    /* GString has no reserve API, but growing and truncating it
+     * keeps the allocation around */
+    use = buf->str->len;
+    g_string_set_size(buf->str, use + len);
+    g_string_truncate(buf->str, use);
+}
+
 /**
  * virBufferAsprintf:
  * @buf: the buffer to append to
@@ -319,13 +349,96 @@ virBufferAsprintf(virBufferPtr buf, const char *format, ...)
 void
 virBufferVasprintf(virBufferPtr buf, const char *format, va_list argptr)
 {
+    va_list copy;
+    size_t len;
+    size_t avail;
+    int rc;
+
     if ((format == NULL) || (buf == NULL))
         return;
 
     virBufferInitialize(buf);
     virBufferApplyIndent(buf);
 
-    g_string_append_vprintf(buf->str, format, argptr);
+    /* g_string_append_vprintf would print into a temporary allocation
+     * first; print straight into the free space of the buffer instead,
+     * growing it for a second attempt if it wasn't large enough */
+    len = buf->str->len;
+    avail = buf->str->allocated_len - len;
+
+    va_copy(copy, argptr);
+    rc = g_vsnprintf(buf->str->str + len, avail, format, copy);
+    va_end(copy);
+
+    if (rc < 0) {
+        buf->str->str[len] = '\0';
+        return;
+    }
+
+    if ((size_t) rc >= avail) {
+        g_string_set_size(buf->str, len + rc);
+        g_vsnprintf(buf->str->str + len, rc + 1, format, argptr);
+        return;
+    }
+
+    buf->str->len += rc;
+}
+
+
+/* How each byte is written by virBufferEscapeString: as is (0), dropped
+ * as an invalid control character (1) or as an XML entity (2) */
+static const unsigned char virBufferXMLEscapeClass[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1,   1, 0, 0, 1, 1, 0, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1,   1, 1, 1, 1, 1, 1, 1, 1,
+    0, 0, 2, 0, 0, 0, 2, 2,   0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,   0, 0, 0, 0, 2, 0, 2, 0,
+};
+
+
+/*
+ * Append @str escaped for use in XML. Runs of characters which need no
+ * escaping are found with a table lookup and copied in one go, which is
+ * the only thing done for most strings.
+ */
+static void
+virBufferEscapeXML(virBufferPtr buf, const char *str)
+{
+    const unsigned char *cur = (const unsigned char *) str;
+
+    while (*cur) {
+        const unsigned char *start = cur;
+
+        while (virBufferXMLEscapeClass[*cur] == 0 && *cur)
+            cur++;
+
+        if (cur != start)
+            g_string_append_len(buf->str, (const char *) start, cur - start);
+
+        if (!*cur)
+            break;
+
+        switch (*cur) {
+        case '<':
+            g_string_append_len(buf->str, "&lt;", 4);
+            break;
+        case '>':
+            g_string_append_len(buf->str, "&gt;", 4);
+            break;
+        case '&':
+            g_string_append_len(buf->str, "&amp;", 5);
+            break;
+        case '"':
+            g_string_append_len(buf->str, "&quot;", 6);
+            break;
+        case '\'':
+            g_string_append_len(buf->str, "&apos;", 6);
+            break;
+        default:
+            /* silently ignore control characters */
+            break;
+        }
+        cur++;
+    }
 }
 
 
@@ -339,82 +452,34 @@ virBufferVasprintf(virBufferPtr buf, const char *format, va_list argptr)
  * string is escaped for use in XML.  If @str is NULL, nothing is
  * added (not even the rest of @format).  Auto indentation may be
  * applied.
+ *
+ * Note that characters over 0x80 are copied as they are, since our
+ * strings don't have an encoding we have to assume they are UTF-8 too.
  */
 void
 virBufferEscapeString(virBufferPtr buf, const char *format, const char *str)
 {
-    int len;
-    g_autofree char *escaped = NULL;
-    char *out;
-    const char *cur;
-    const char forbidden_characters[] = {
-        0x01,   0x02,   0x03,   0x04,   0x05,   0x06,   0x07,   0x08,
-        /*\t*/  /*\n*/  0x0B,   0x0C,   /*\r*/  0x0E,   0x0F,   0x10,
-        0x11,   0x12,   0x13,   0x14,   0x15,   0x16,   0x17,   0x18,
-        0x19,   '"',    '&',    '\'',   '<',    '>',
-        '\0'
-    };
+    const char *conv;
+    g_auto(virBuffer) escaped = VIR_BUFFER_INITIALIZER;
 
     if ((format == NULL) || (buf == NULL) || (str == NULL))
         return;
 
-    len = strlen(str);
-    if (strcspn(str, forbidden_characters) == len) {
-        virBufferAsprintf(buf, format, str);
+    /* The format is almost always text around a single %s, which is
+     * appended directly without going through printf */
+    if ((conv = strchr(format, '%')) && conv[1] == 's' &&
+        !strchr(conv + 2, '%')) {
+        virBufferInitialize(buf);
+        virBufferApplyIndent(buf);
+        g_string_append_len(buf->str, format, conv - format);
+        virBufferEscapeXML(buf, str);
+        g_string_append(buf->str, conv + 2);
         return;
     }
 
-    escaped = g_malloc0_n(len + 1, 6);
-
-    cur = str;
-    out = escaped;
-    while (*cur != 0) {
-        if (*cur == '<') {
-            *out++ = '&';
-            *out++ = 'l';
-            *out++ = 't';
-            *out++ = ';';
-        } else if (*cur == '>') {
-            *out++ = '&';
-            *out++ = 'g';
-            *out++ = 't';
-            *out++ = ';';
-        } else if (*cur == '&') {
-            *out++ = '&';
-            *out++ = 'a';
-            *out++ = 'm';
-            *out++ = 'p';
-            *out++ = ';';
-        } else if (*cur == '"') {
-            *out++ = '&';
-            *out++ = 'q';
-            *out++ = 'u';
-            *out++ = 'o';
-            *out++ = 't';
-            *out++ = ';';
-        } else if (*cur == '\'') {
-            *out++ = '&';
-            *out++ = 'a';
-            *out++ = 'p';
-            *out++ = 'o';
-            *out++ = 's';
-            *out++ = ';';
-        } else if (!strchr(forbidden_characters, *cur)) {
-            /*
-             * default case, just copy !
-             * Note that character over 0x80 are likely to give problem
-             * with UTF-8 XML, but since our string don't have an encoding
-             * it's hard to handle properly we have to assume it's UTF-8 too
-             */
-            *out++ = *cur;
-        } else {
-            /* silently ignore control characters */
-        }
-        cur++;
-    }
-    *out = 0;
-
-    virBufferAsprintf(buf, format, escaped);
+    virBufferInitialize(&escaped);
+    virBufferEscapeXML(&escaped, str);
+    virBufferAsprintf(buf, format, escaped.str->str);
 }
 
 /**
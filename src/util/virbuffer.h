@@ -56,6 +56,7 @@ void virBufferFreeAndReset(virBufferPtr buf);
 G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC(virBuffer, virBufferFreeAndReset);
 
 size_t virBufferUse(const virBuffer *buf);
+void virBufferReserve(virBufferPtr buf, size_t len);
 void virBufferAdd(virBufferPtr buf, const char *str, int len);
 void virBufferAddBuffer(virBufferPtr buf, virBufferPtr toadd);
 void virBufferAddChar(virBufferPtr buf, char c);
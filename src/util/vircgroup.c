@@ -63,6 +63,11 @@ VIR_ENUM_IMPL(virCgroupController,
               "name=systemd",
 );
 
+VIR_ENUM_IMPL(virCgroupPressureResource,
+              VIR_CGROUP_PRESSURE_LAST,
+              "cpu", "memory", "io",
+);
+
 
 /**
  * virCgroupGetDevicePermsString:
@@ -493,6 +498,114 @@ virCgroupGetValueRaw(const char *path,
 }
 
 
+/**
+ * virCgroupBatchDirFD:
+ *
+ * @group: The cgroup in batch mode
+ * @controller: The controller whose directory is wanted
+ *
+ * Returns the directory FD of @controller in @group, opening it on
+ * the first use within the batch, or -1 on error (with error
+ * reported).
+ */
+static int
+virCgroupBatchDirFD(virCgroupPtr group,
+                    int controller)
+{
+    g_autofree char *path = NULL;
+
+    if (group->batchfds[controller] >= 0)
+        return group->batchfds[controller];
+
+    if (virCgroupPathOfController(group, controller, "", &path) < 0)
+        return -1;
+
+    if ((group->batchfds[controller] = open(path, O_RDONLY | O_DIRECTORY |
+                                            O_CLOEXEC)) < 0) {
+        virReportSystemError(errno, _("Unable to open directory '%s'"), path);
+        return -1;
+    }
+
+    return group->batchfds[controller];
+}
+
+
+static bool
+virCgroupInBatch(virCgroupPtr group,
+                 int controller)
+{
+    return group->batch > 0 &&
+        controller >= 0 && controller < VIR_CGROUP_CONTROLLER_LAST;
+}
+
+
+static int
+virCgroupBatchSetValue(virCgroupPtr group,
+                       int controller,
+                       const char *key,
+                       const char *value)
+{
+    VIR_AUTOCLOSE fd = -1;
+    g_autofree char *keypath = NULL;
+    int dirfd;
+
+    if ((dirfd = virCgroupBatchDirFD(group, controller)) < 0)
+        return -1;
+
+    VIR_DEBUG("Set value '%s' of '%s' to '%s'", key, group->path, value);
+    if ((fd = openat(dirfd, key, O_WRONLY | O_TRUNC | O_CLOEXEC)) >= 0 &&
+        safewrite(fd, value, strlen(value)) >= 0 &&
+        VIR_CLOSE(fd) == 0)
+        return 0;
+
+    /* Report the same way virCgroupSetValueRaw() does */
+    if (errno == EINVAL) {
+        virReportSystemError(errno,
+                             _("Invalid value '%s' for '%s'"),
+                             value, key);
+        return -1;
+    }
+
+    if (virCgroupPathOfController(group, controller, key, &keypath) == 0)
+        virReportSystemError(errno,
+                             _("Unable to write to '%s'"), keypath);
+    return -1;
+}
+
+
+static int
+virCgroupBatchGetValue(virCgroupPtr group,
+                       int controller,
+                       const char *key,
+                       char **value)
+{
+    VIR_AUTOCLOSE fd = -1;
+    g_autofree char *keypath = NULL;
+    int dirfd;
+    int rc;
+
+    *value = NULL;
+
+    if ((dirfd = virCgroupBatchDirFD(group, controller)) < 0)
+        return -1;
+
+    VIR_DEBUG("Get value '%s' of '%s'", key, group->path);
+    if ((fd = openat(dirfd, key, O_RDONLY | O_CLOEXEC)) < 0 ||
+        (rc = virFileReadLimFD(fd, 1024*1024, value)) < 0) {
+        if (virCgroupPathOfController(group, controller, key, &keypath) == 0)
+            virReportSystemError(errno,
+                                 _("Unable to read from '%s'"), keypath);
+        return -1;
+    }
+
+    /* Terminated with '\n' has sometimes harmful effects to the caller */
+    if (rc > 0 && (*value)[rc - 1] == '\n')
+        (*value)[rc - 1] = '\0';
+
+    return 0;
+}
+
+
 int
 virCgroupSetValueStr(virCgroupPtr group,
                      int controller,
@@ -501,6 +614,9 @@ virCgroupSetValueStr(virCgroupPtr group,
 {
     g_autofree char *keypath = NULL;
 
+    if (virCgroupInBatch(group, controller))
+        return virCgroupBatchSetValue(group, controller, key, value);
+
     if (virCgroupPathOfController(group, controller, key, &keypath) < 0)
         return -1;
 
@@ -516,6 +632,9 @@ virCgroupGetValueStr(virCgroupPtr group,
 {
     g_autofree char *keypath = NULL;
 
+    if (virCgroupInBatch(group, controller))
+        return virCgroupBatchGetValue(group, controller, key, value);
+
     if (virCgroupPathOfController(group, controller, key, &keypath) < 0)
         return -1;
 
@@ -523,6 +642,273 @@ virCgroupGetValueStr(virCgroupPtr group,
 }
 
 
+/* Same limit as virCgroupGetValueRaw() has */
+#define VIR_CGROUP_STAT_FILE_MAX (1024*1024)
+
+static int
+virCgroupStatFileRead(int fd,
+                      char **value)
+{
+    size_t size = 4096;
+    size_t len = 0;
+    ssize_t got;
+    g_autofree char *buf = g_new0(char, size);
+
+    /* Reading from offset 0 makes cgroupfs generate fresh contents */
+    while ((got = pread(fd, buf + len, size - len - 1, len)) > 0) {
+        len += got;
+        if (len == size - 1) {
+            if (size >= VIR_CGROUP_STAT_FILE_MAX) {
+                errno = E2BIG;
+                return -1;
+            }
+            size *= 2;
+            buf = g_renew(char, buf, size);
+        }
+    }
+
+    if (got < 0)
+        return -1;
+
+    buf[len] = '\0';
+
+    /* Terminated with '\n' has sometimes harmful effects to the caller */
+    if (len > 0 && buf[len - 1] == '\n')
+        buf[len - 1] = '\0';
+
+    *value = g_steal_pointer(&buf);
+    return 0;
+}
+
+
+static int
+virCgroupGetStatValueStrInternal(virCgroupPtr group,
+                                 int controller,
+                                 const char *key,
+                                 bool optional,
+                                 char **value)
+{
+    g_autofree char *keypath = NULL;
+    virCgroupStatFile file = { .controller = controller, .fd = -1 };
+    size_t i;
+
+    *value = NULL;
+
+    for (i = 0; i < group->nstatfiles; i++) {
+        if (group->statfiles[i].controller == controller &&
+            STREQ(group->statfiles[i].key, key))
+            break;
+    }
+
+    if (i == group->nstatfiles) {
+        if (virCgroupPathOfController(group, controller, key, &keypath) < 0)
+            return -1;
+
+        VIR_DEBUG("Open stat file %s", keypath);
+        if ((file.fd = open(keypath, O_RDONLY | O_CLOEXEC)) < 0) {
+            if (optional && errno == ENOENT)
+                return 0;
+            virReportSystemError(errno,
+                                 _("Unable to read from '%s'"), keypath);
+            return -1;
+        }
+        file.key = g_strdup(key);
+
+        if (VIR_APPEND_ELEMENT(group->statfiles, group->nstatfiles, file) < 0) {
+            VIR_FORCE_CLOSE(file.fd);
+            VIR_FREE(file.key);
+            return -1;
+        }
+    }
+
+    if (virCgroupStatFileRead(group->statfiles[i].fd, value) < 0) {
+        int save_errno = errno;
+
+        /* Don't keep a file that went bad, e.g. because the group
+         * was removed meanwhile */
+        VIR_FORCE_CLOSE(group->statfiles[i].fd);
+        VIR_FREE(group->statfiles[i].key);
+        VIR_DELETE_ELEMENT(group->statfiles, i, group->nstatfiles);
+
+        if (!keypath &&
+            virCgroupPathOfController(group, controller, key, &keypath) < 0)
+            return -1;
+
+        virReportSystemError(save_errno,
+                             _("Unable to read from '%s'"), keypath);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * virCgroupGetStatValueStr:
+ *
+ * Like virCgroupGetValueStr(), but meant for statistics that are
+ * polled over and over again during the lifetime of @group. The
+ * file is opened on the first call only and kept open until @group
+ * is freed, later calls just re-read it.
+ *
+ * Returns 0 on success, -1 on error (with error reported).
+ */
+int
+virCgroupGetStatValueStr(virCgroupPtr group,
+                         int controller,
+                         const char *key,
+                         char **value)
+{
+    return virCgroupGetStatValueStrInternal(group, controller, key,
+                                            false, value);
+}
+
+
+/**
+ * virCgroupGetStatValueStrIfExists:
+ *
+ * Same as virCgroupGetStatValueStr(), except that a missing file
+ * is not an error, @value is set to NULL instead. Meant for files
+ * that depend on the kernel version or configuration.
+ *
+ * Returns 0 on success, -1 on error (with error reported).
+ */
+int
+virCgroupGetStatValueStrIfExists(virCgroupPtr group,
+                                 int controller,
+                                 const char *key,
+                                 char **value)
+{
+    return virCgroupGetStatValueStrInternal(group, controller, key,
+                                            true, value);
+}
+
+
+/**
+ * virCgroupGetStatKeyU64:
+ *
+ * @stat: contents of a flat keyed file, e.g. cpu.stat
+ * @file: name of the file for error messages
+ * @key: key to look up
+ * @value: filled with the value of @key
+ *
+ * Returns 0 on success, -1 if @key is missing or its value is not a
+ * number (with error reported).
+ */
+int
+virCgroupGetStatKeyU64(const char *stat,
+                       const char *file,
+                       const char *key,
+                       unsigned long long *value)
+{
+    size_t len = strlen(key);
+    const char *line = stat;
+    char *end;
+
+    while (line) {
+        if (STRPREFIX(line, key) && line[len] == ' ') {
+            if (virStrToLong_ull(line + len + 1, &end, 10, value) < 0 ||
+                (*end != '\n' && *end != '\0'))
+                break;
+            return 0;
+        }
+
+        if ((line = strchr(line, '\n')))
+            line++;
+    }
+
+    virReportError(VIR_ERR_INTERNAL_ERROR,
+                   _("cannot parse '%s' in '%s'"), key, file);
+    return -1;
+}
+
+
+static int
+virCgroupParsePressureLine(const char *line,
+                           virCgroupPressurePtr pressure)
+{
+    struct {
+        const char *prefix;
+        double *value;
+    } avgs[] = {
+        { "avg10=", &pressure->avg10 },
+        { "avg60=", &pressure->avg60 },
+        { "avg300=", &pressure->avg300 },
+    };
+    const char *cur = line;
+    char *end;
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS(avgs); i++) {
+        virSkipSpaces(&cur);
+        if (!(cur = STRSKIP(cur, avgs[i].prefix)) ||
+            virStrToDouble(cur, &end, avgs[i].value) < 0)
+            return -1;
+        cur = end;
+    }
+
+    virSkipSpaces(&cur);
+    if (!(cur = STRSKIP(cur, "total=")) ||
+        virStrToLong_ull(cur, &end, 10, &pressure->total) < 0 ||
+        (*end != '\0' && *end != '\n'))
+        return -1;
+
+    return 0;
+}
+
+
+/**
+ * virCgroupParsePressure:
+ *
+ * @str: contents of a <resource>.pressure file
+ * @file: name of the file for error messages
+ * @some: filled with the "some" line
+ * @full: filled with the "full" line
+ * @hasFull: set to whether there is a "full" line
+ *
+ * Older kernels don't report a "full" line for the cpu resource.
+ *
+ * Returns 0 on success, -1 on error (with error reported).
+ */
+int
+virCgroupParsePressure(const char *str,
+                       const char *file,
+                       virCgroupPressurePtr some,
+                       virCgroupPressurePtr full,
+                       bool *hasFull)
+{
+    const char *line = str;
+    bool hasSome = false;
+
+    *hasFull = false;
+
+    while (line && *line) {
+        const char *tmp;
+
+        if ((tmp = STRSKIP(line, "some "))) {
+            if (virCgroupParsePressureLine(tmp, some) < 0)
+                goto error;
+            hasSome = true;
+        } else if ((tmp = STRSKIP(line, "full "))) {
+            if (virCgroupParsePressureLine(tmp, full) < 0)
+                goto error;
+            *hasFull = true;
+        }
+
+        if ((line = strchr(line, '\n')))
+            line++;
+    }
+
+    if (hasSome)
+        return 0;
+
+ error:
+    virReportError(VIR_ERR_INTERNAL_ERROR,
+                   _("cannot parse '%s': '%s'"), file, str);
+    return -1;
+}
+
+
 int
 virCgroupGetValueForBlkDev(const char *str,
                            const char *path,
@@ -2681,6 +3067,123 @@ virCgroupGetCpuacctStat(virCgroupPtr group, unsigned long long *user,
 }
 
 
+/**
+ * virCgroupGetCpuThrottleStat:
+ *
+ * @group: The cgroup to get throttling statistics for
+ * @periods: number of elapsed enforcement periods
+ * @throttled: number of periods in which the group was throttled
+ * @throttledTime: total time the group was throttled in nanoseconds
+ *
+ * Returns: 0 on success, -1 on error
+ */
+int
+virCgroupGetCpuThrottleStat(virCgroupPtr group,
+                            unsigned long long *periods,
+                            unsigned long long *throttled,
+                            unsigned long long *throttledTime)
+{
+    VIR_CGROUP_BACKEND_CALL(group, VIR_CGROUP_CONTROLLER_CPU,
+                            getCpuThrottleStat, -1,
+                            periods, throttled, throttledTime);
+}
+
+
+/**
+ * virCgroupGetPressure:
+ *
+ * @group: The cgroup to get pressure stall information for
+ * @resource: which resource
+ * @some: share of time at least some tasks were stalled
+ * @full: share of time all non-idle tasks were stalled
+ * @hasFull: whether @full was filled in
+ *
+ * Pressure stall information is available only with cgroups v2 and
+ * a kernel that has it enabled.
+ *
+ * Returns: 1 on success, 0 if the information is not available,
+ *          -1 on error
+ */
+int
+virCgroupGetPressure(virCgroupPtr group,
+                     virCgroupPressureResource resource,
+                     virCgroupPressurePtr some,
+                     virCgroupPressurePtr full,
+                     bool *hasFull)
+{
+    int controllers[] = {
+        [VIR_CGROUP_PRESSURE_CPU] = VIR_CGROUP_CONTROLLER_CPU,
+        [VIR_CGROUP_PRESSURE_MEMORY] = VIR_CGROUP_CONTROLLER_MEMORY,
+        [VIR_CGROUP_PRESSURE_IO] = VIR_CGROUP_CONTROLLER_BLKIO,
+    };
+    virCgroupBackendPtr backend;
+
+    G_STATIC_ASSERT(G_N_ELEMENTS(controllers) == VIR_CGROUP_PRESSURE_LAST);
+
+    *hasFull = false;
+
+    if (resource >= VIR_CGROUP_PRESSURE_LAST) {
+        virReportEnumRangeError(virCgroupPressureResource, resource);
+        return -1;
+    }
+
+    if (!virCgroupHasController(group, controllers[resource]))
+        return 0;
+
+    backend = virCgroupBackendForController(group, controllers[resource]);
+    if (!backend || !backend->getPressure)
+        return 0;
+
+    return backend->getPressure(group, resource, some, full, hasFull);
+}
+
+
+/**
+ * virCgroupGetHostPressure:
+ *
+ * @resource: which resource
+ * @some: share of time at least some tasks were stalled
+ * @full: share of time all non-idle tasks were stalled
+ * @hasFull: whether @full was filled in
+ *
+ * Same as virCgroupGetPressure() but for the whole host, as reported in
+ * /proc/pressure. Works with both cgroups versions.
+ *
+ * Returns: 1 on success, 0 if the information is not available,
+ *          -1 on error
+ */
+int
+virCgroupGetHostPressure(virCgroupPressureResource resource,
+                         virCgroupPressurePtr some,
+                         virCgroupPressurePtr full,
+                         bool *hasFull)
+{
+    g_autofree char *file = NULL;
+    g_autofree char *str = NULL;
+
+    *hasFull = false;
+
+    if (resource >= VIR_CGROUP_PRESSURE_LAST) {
+        virReportEnumRangeError(virCgroupPressureResource, resource);
+        return -1;
+    }
+
+    file = g_strdup_printf("/proc/pressure/%s",
+                           virCgroupPressureResourceTypeToString(resource));
+
+    if (!virFileExists(file))
+        return 0;
+
+    if (virFileReadAll(file, 1024, &str) < 0)
+        return -1;
+
+    if (virCgroupParsePressure(str, file, some, full, hasFull) < 0)
+        return -1;
+
+    return 1;
+}
+
+
 int
 virCgroupSetFreezerState(virCgroupPtr group, const char *state)
 {
@@ -3441,6 +3944,41 @@ virCgroupGetCpuacctStat(virCgroupPtr group G_GNUC_UNUSED,
 }
 
 
+int
+virCgroupGetCpuThrottleStat(virCgroupPtr group G_GNUC_UNUSED,
+                            unsigned long long *periods G_GNUC_UNUSED,
+                            unsigned long long *throttled G_GNUC_UNUSED,
+                            unsigned long long *throttledTime G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Control groups not supported on this platform"));
+    return -1;
+}
+
+
+int
+virCgroupGetPressure(virCgroupPtr group G_GNUC_UNUSED,
+                     virCgroupPressureResource resource G_GNUC_UNUSED,
+                     virCgroupPressurePtr some G_GNUC_UNUSED,
+                     virCgroupPressurePtr full G_GNUC_UNUSED,
+                     bool *hasFull)
+{
+    *hasFull = false;
+    return 0;
+}
+
+
+int
+virCgroupGetHostPressure(virCgroupPressureResource resource G_GNUC_UNUSED,
+                         virCgroupPressurePtr some G_GNUC_UNUSED,
+                         virCgroupPressurePtr full G_GNUC_UNUSED,
+                         bool *hasFull)
+{
+    *hasFull = false;
+    return 0;
+}
+
+
 int
 virCgroupGetDomainTotalCpuStats(virCgroupPtr group G_GNUC_UNUSED,
                                 virTypedParameterPtr params G_GNUC_UNUSED,
@@ -3533,6 +4071,58 @@ virCgroupControllerAvailable(int controller G_GNUC_UNUSED)
 #endif /* !__linux__ */
 
 
+/**
+ * virCgroupBatchBegin:
+ *
+ * @group: The cgroup to configure
+ *
+ * Setting up a group means a lot of small reads and writes of its
+ * files, each of which resolves the whole cgroupfs path again.
+ * Until the matching virCgroupBatchEnd() the directories of @group
+ * are opened only once and its files are accessed relative to them.
+ * The accesses themselves still happen immediately and report
+ * errors as usual. Calls can be nested.
+ */
+void
+virCgroupBatchBegin(virCgroupPtr group)
+{
+    size_t i;
+
+    if (!group)
+        return;
+
+    if (group->batch++ > 0)
+        return;
+
+    for (i = 0; i < VIR_CGROUP_CONTROLLER_LAST; i++)
+        group->batchfds[i] = -1;
+}
+
+
+/**
+ * virCgroupBatchEnd:
+ *
+ * @group: The cgroup to configure
+ *
+ * Ends the batch started by virCgroupBatchBegin() and closes the
+ * directories opened meanwhile.
+ */
+void
+virCgroupBatchEnd(virCgroupPtr group)
+{
+    size_t i;
+
+    if (!group || group->batch == 0)
+        return;
+
+    if (--group->batch > 0)
+        return;
+
+    for (i = 0; i < VIR_CGROUP_CONTROLLER_LAST; i++)
+        VIR_FORCE_CLOSE(group->batchfds[i]);
+}
+
+
 /**
  * virCgroupFree:
  *
@@ -3546,6 +4136,17 @@ virCgroupFree(virCgroupPtr *group)
     if (*group == NULL)
         return;
 
+    if ((*group)->batch > 0) {
+        (*group)->batch = 1;
+        virCgroupBatchEnd(*group);
+    }
+
+    for (i = 0; i < (*group)->nstatfiles; i++) {
+        VIR_FORCE_CLOSE((*group)->statfiles[i].fd);
+        VIR_FREE((*group)->statfiles[i].key);
+    }
+    VIR_FREE((*group)->statfiles);
+
     for (i = 0; i < VIR_CGROUP_CONTROLLER_LAST; i++) {
         VIR_FREE((*group)->legacy[i].mountPoint);
         VIR_FREE((*group)->legacy[i].linkPoint);
@@ -50,6 +50,27 @@ VIR_ENUM_DECL(virCgroupController);
  * Make sure we will not overflow */
 G_STATIC_ASSERT(VIR_CGROUP_CONTROLLER_LAST < 8 * sizeof(int));
 
+typedef enum {
+    VIR_CGROUP_PRESSURE_CPU,
+    VIR_CGROUP_PRESSURE_MEMORY,
+    VIR_CGROUP_PRESSURE_IO,
+
+    VIR_CGROUP_PRESSURE_LAST
+} virCgroupPressureResource;
+
+VIR_ENUM_DECL(virCgroupPressureResource);
+
+/* Pressure stall information as reported in <resource>.pressure,
+ * averages are percentages of wall time, total in microseconds */
+typedef struct _virCgroupPressure virCgroupPressure;
+typedef virCgroupPressure *virCgroupPressurePtr;
+struct _virCgroupPressure {
+    double avg10;
+    double avg60;
+    double avg300;
+    unsigned long long total;
+};
+
 typedef enum {
     VIR_CGROUP_THREAD_VCPU = 0,
     VIR_CGROUP_THREAD_EMULATOR,
@@ -109,6 +130,9 @@ bool virCgroupNewIgnoreError(void);
 
 void virCgroupFree(virCgroupPtr *group);
 
+void virCgroupBatchBegin(virCgroupPtr group);
+void virCgroupBatchEnd(virCgroupPtr group);
+
 bool virCgroupHasController(virCgroupPtr cgroup, int controller);
 int virCgroupPathOfController(virCgroupPtr group,
                               unsigned int controller,
@@ -239,6 +263,21 @@ int virCgroupGetCpuacctPercpuUsage(virCgroupPtr group, char **usage);
 int virCgroupGetCpuacctStat(virCgroupPtr group, unsigned long long *user,
                             unsigned long long *sys);
 
+int virCgroupGetCpuThrottleStat(virCgroupPtr group,
+                                unsigned long long *periods,
+                                unsigned long long *throttled,
+                                unsigned long long *throttledTime);
+
+int virCgroupGetPressure(virCgroupPtr group,
+                         virCgroupPressureResource resource,
+                         virCgroupPressurePtr some,
+                         virCgroupPressurePtr full,
+                         bool *hasFull);
+int virCgroupGetHostPressure(virCgroupPressureResource resource,
+                             virCgroupPressurePtr some,
+                             virCgroupPressurePtr full,
+                             bool *hasFull);
+
 int virCgroupSetFreezerState(virCgroupPtr group, const char *state);
 int virCgroupGetFreezerState(virCgroupPtr group, char **state);
 
@@ -328,6 +328,19 @@ typedef int
                              unsigned long long *user,
                              unsigned long long *sys);
 
+typedef int
+(*virCgroupGetCpuThrottleStatCB)(virCgroupPtr group,
+                                 unsigned long long *periods,
+                                 unsigned long long *throttled,
+                                 unsigned long long *throttledTime);
+
+typedef int
+(*virCgroupGetPressureCB)(virCgroupPtr group,
+                          virCgroupPressureResource resource,
+                          virCgroupPressurePtr some,
+                          virCgroupPressurePtr full,
+                          bool *hasFull);
+
 typedef int
 (*virCgroupSetFreezerStateCB)(virCgroupPtr group,
                               const char *state);
@@ -427,6 +440,9 @@ struct _virCgroupBackend {
     virCgroupGetCpuacctUsageCB getCpuacctUsage;
     virCgroupGetCpuacctPercpuUsageCB getCpuacctPercpuUsage;
     virCgroupGetCpuacctStatCB getCpuacctStat;
+    virCgroupGetCpuThrottleStatCB getCpuThrottleStat;
+
+    virCgroupGetPressureCB getPressure;
 
     virCgroupSetFreezerStateCB setFreezerState;
     virCgroupGetFreezerStateCB getFreezerState;
@@ -59,6 +59,14 @@ struct _virCgroupV2Controller {
 typedef struct _virCgroupV2Controller virCgroupV2Controller;
 typedef virCgroupV2Controller *virCgroupV2ControllerPtr;
 
+struct _virCgroupStatFile {
+    int controller;
+    char *key;
+    int fd;
+};
+typedef struct _virCgroupStatFile virCgroupStatFile;
+typedef virCgroupStatFile *virCgroupStatFilePtr;
+
 struct _virCgroup {
     char *path;
 
@@ -66,6 +74,15 @@ struct _virCgroup {
 
     virCgroupV1Controller legacy[VIR_CGROUP_CONTROLLER_LAST];
     virCgroupV2Controller unified;
+
+    /* Nesting level of virCgroupBatchBegin() and directory FDs
+     * (per controller, -1 if not opened yet) used meanwhile */
+    unsigned int batch;
+    int batchfds[VIR_CGROUP_CONTROLLER_LAST];
+
+    /* Statistics files kept open by virCgroupGetStatValueStr() */
+    virCgroupStatFilePtr statfiles;
+    size_t nstatfiles;
 };
 
 int virCgroupSetValueRaw(const char *path,
@@ -84,6 +101,27 @@ int virCgroupGetValueStr(virCgroupPtr group,
                          const char *key,
                          char **value);
 
+int virCgroupGetStatValueStr(virCgroupPtr group,
+                             int controller,
+                             const char *key,
+                             char **value);
+
+int virCgroupGetStatValueStrIfExists(virCgroupPtr group,
+                                     int controller,
+                                     const char *key,
+                                     char **value);
+
+int virCgroupGetStatKeyU64(const char *stat,
+                           const char *file,
+                           const char *key,
+                           unsigned long long *value);
+
+int virCgroupParsePressure(const char *str,
+                           const char *file,
+                           virCgroupPressurePtr some,
+                           virCgroupPressurePtr full,
+                           bool *hasFull);
+
 int virCgroupSetValueU64(virCgroupPtr group,
                          int controller,
                          const char *key,
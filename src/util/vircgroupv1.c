@@ -1546,10 +1546,10 @@ virCgroupV1GetMemoryStat(virCgroupPtr group,
     unsigned long long inactiveFileVal = 0;
     unsigned long long unevictableVal = 0;
 
-    if (virCgroupGetValueStr(group,
-                             VIR_CGROUP_CONTROLLER_MEMORY,
-                             "memory.stat",
-                             &stat) < 0) {
+    if (virCgroupGetStatValueStr(group,
+                                 VIR_CGROUP_CONTROLLER_MEMORY,
+                                 "memory.stat",
+                                 &stat) < 0) {
         return -1;
     }
 
@@ -1948,9 +1948,19 @@ static int
 virCgroupV1GetCpuacctUsage(virCgroupPtr group,
                            unsigned long long *usage)
 {
-    return virCgroupGetValueU64(group,
-                                VIR_CGROUP_CONTROLLER_CPUACCT,
-                                "cpuacct.usage", usage);
+    g_autofree char *str = NULL;
+
+    if (virCgroupGetStatValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
+                                 "cpuacct.usage", &str) < 0)
+        return -1;
+
+    if (virStrToLong_ull(str, NULL, 10, usage) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unable to parse '%s' as an integer"), str);
+        return -1;
+    }
+
+    return 0;
 }
 
 
@@ -1958,8 +1968,8 @@ static int
 virCgroupV1GetCpuacctPercpuUsage(virCgroupPtr group,
                                  char **usage)
 {
-    return virCgroupGetValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
-                                "cpuacct.usage_percpu", usage);
+    return virCgroupGetStatValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
+                                    "cpuacct.usage_percpu", usage);
 }
 
 
@@ -1972,8 +1982,8 @@ virCgroupV1GetCpuacctStat(virCgroupPtr group,
     char *p;
     static double scale = -1.0;
 
-    if (virCgroupGetValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
-                             "cpuacct.stat", &str) < 0)
+    if (virCgroupGetStatValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
+                                 "cpuacct.stat", &str) < 0)
         return -1;
 
     if (!(p = STRSKIP(str, "user ")) ||
@@ -2009,6 +2019,27 @@ virCgroupV1GetCpuacctStat(virCgroupPtr group,
 }
 
 
+static int
+virCgroupV1GetCpuThrottleStat(virCgroupPtr group,
+                              unsigned long long *periods,
+                              unsigned long long *throttled,
+                              unsigned long long *throttledTime)
+{
+    g_autofree char *str = NULL;
+
+    if (virCgroupGetStatValueStr(group, VIR_CGROUP_CONTROLLER_CPU,
+                                 "cpu.stat", &str) < 0)
+        return -1;
+
+    if (virCgroupGetStatKeyU64(str, "cpu.stat", "nr_periods", periods) < 0 ||
+        virCgroupGetStatKeyU64(str, "cpu.stat", "nr_throttled", throttled) < 0 ||
+        virCgroupGetStatKeyU64(str, "cpu.stat", "throttled_time", throttledTime) < 0)
+        return -1;
+
+    return 0;
+}
+
+
 static int
 virCgroupV1SetFreezerState(virCgroupPtr group,
                            const char *state)
@@ -2163,6 +2194,7 @@ virCgroupBackend virCgroupV1Backend = {
     .getCpuacctUsage = virCgroupV1GetCpuacctUsage,
     .getCpuacctPercpuUsage = virCgroupV1GetCpuacctPercpuUsage,
     .getCpuacctStat = virCgroupV1GetCpuacctStat,
+    .getCpuThrottleStat = virCgroupV1GetCpuThrottleStat,
 
     .setFreezerState = virCgroupV1SetFreezerState,
     .getFreezerState = virCgroupV1GetFreezerState,
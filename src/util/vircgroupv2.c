@@ -1196,10 +1196,10 @@ virCgroupV2GetMemoryStat(virCgroupPtr group,
     unsigned long long inactiveFileVal = 0;
     unsigned long long unevictableVal = 0;
 
-    if (virCgroupGetValueStr(group,
-                             VIR_CGROUP_CONTROLLER_MEMORY,
-                             "memory.stat",
-                             &stat) < 0) {
+    if (virCgroupGetStatValueStr(group,
+                                 VIR_CGROUP_CONTROLLER_MEMORY,
+                                 "memory.stat",
+                                 &stat) < 0) {
         return -1;
     }
 
@@ -1606,8 +1606,8 @@ virCgroupV2GetCpuacctUsage(virCgroupPtr group,
     g_autofree char *str = NULL;
     char *tmp;
 
-    if (virCgroupGetValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
-                             "cpu.stat", &str) < 0) {
+    if (virCgroupGetStatValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
+                                 "cpu.stat", &str) < 0) {
         return -1;
     }
 
@@ -1640,8 +1640,8 @@ virCgroupV2GetCpuacctStat(virCgroupPtr group,
     unsigned long long userVal = 0;
     unsigned long long sysVal = 0;
 
-    if (virCgroupGetValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
-                             "cpu.stat", &str) < 0) {
+    if (virCgroupGetStatValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
+                                 "cpu.stat", &str) < 0) {
         return -1;
     }
 
@@ -1678,6 +1678,65 @@ virCgroupV2GetCpuacctStat(virCgroupPtr group,
 }
 
 
+static int
+virCgroupV2GetCpuThrottleStat(virCgroupPtr group,
+                              unsigned long long *periods,
+                              unsigned long long *throttled,
+                              unsigned long long *throttledTime)
+{
+    g_autofree char *str = NULL;
+
+    /* Same file as virCgroupV2GetCpuacctStat() reads, so that the
+     * cached FD is shared. */
+    if (virCgroupGetStatValueStr(group, VIR_CGROUP_CONTROLLER_CPUACCT,
+                                 "cpu.stat", &str) < 0)
+        return -1;
+
+    if (virCgroupGetStatKeyU64(str, "cpu.stat", "nr_periods", periods) < 0 ||
+        virCgroupGetStatKeyU64(str, "cpu.stat", "nr_throttled", throttled) < 0 ||
+        virCgroupGetStatKeyU64(str, "cpu.stat", "throttled_usec", throttledTime) < 0)
+        return -1;
+
+    *throttledTime *= 1000;
+
+    return 0;
+}
+
+
+static int
+virCgroupV2GetPressure(virCgroupPtr group,
+                       virCgroupPressureResource resource,
+                       virCgroupPressurePtr some,
+                       virCgroupPressurePtr full,
+                       bool *hasFull)
+{
+    int controllers[] = {
+        [VIR_CGROUP_PRESSURE_CPU] = VIR_CGROUP_CONTROLLER_CPU,
+        [VIR_CGROUP_PRESSURE_MEMORY] = VIR_CGROUP_CONTROLLER_MEMORY,
+        [VIR_CGROUP_PRESSURE_IO] = VIR_CGROUP_CONTROLLER_BLKIO,
+    };
+    g_autofree char *file = NULL;
+    g_autofree char *str = NULL;
+
+    file = g_strdup_printf("%s.pressure",
+                           virCgroupPressureResourceTypeToString(resource));
+
+    /* Missing if the kernel was built without pressure stall
+     * information. */
+    if (virCgroupGetStatValueStrIfExists(group, controllers[resource],
+                                         file, &str) < 0)
+        return -1;
+
+    if (!str)
+        return 0;
+
+    if (virCgroupParsePressure(str, file, some, full, hasFull) < 0)
+        return -1;
+
+    return 1;
+}
+
+
 static int
 virCgroupV2SetCpusetMems(virCgroupPtr group,
                          const char *mems)
@@ -1899,6 +1958,9 @@ virCgroupBackend virCgroupV2Backend = {
 
     .getCpuacctUsage = virCgroupV2GetCpuacctUsage,
     .getCpuacctStat = virCgroupV2GetCpuacctStat,
+    .getCpuThrottleStat = virCgroupV2GetCpuThrottleStat,
+
+    .getPressure = virCgroupV2GetPressure,
 
     .setCpusetMems = virCgroupV2SetCpusetMems,
     .getCpusetMems = virCgroupV2GetCpusetMems,
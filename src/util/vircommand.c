@@ -32,6 +32,9 @@
 #endif
 #include <fcntl.h>
 #include <unistd.h>
+#ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+# include <spawn.h>
+#endif
 
 #if WITH_CAPNG
 # include <cap-ng.h>
@@ -56,6 +59,7 @@
 #include "virbuffer.h"
 #include "virthread.h"
 #include "virstring.h"
+#include "virsocket.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -128,6 +132,7 @@ struct _virCommand {
     void *opaque;
 
     pid_t pid;
+    int helper; /* command helper running the command, or -1 */
     char *pidfile;
     bool reap;
     bool rawStatus;
@@ -548,6 +553,42 @@ virCommandMassClose(virCommandPtr cmd,
 
 # else /* ! __FreeBSD__ */
 
+#  ifdef HAVE_CLOSE_RANGE
+/* Closes the FDs up to the biggest one we need to preserve one by one,
+ * and all the remaining ones with a single close_range() call, instead
+ * of enumerating them. Fails if the kernel doesn't know close_range(). */
+static int
+virCommandMassCloseRange(virCommandPtr cmd,
+                         int childin,
+                         int childout,
+                         int childerr)
+{
+    int lastfd = MAX(MAX(childin, childout), childerr);
+    int fd;
+    size_t i;
+
+    for (i = 0; i < cmd->npassfd; i++)
+        lastfd = MAX(lastfd, cmd->passfd[i].fd);
+
+    if (close_range(lastfd + 1, ~0U, 0) < 0)
+        return -1;
+
+    for (fd = STDERR_FILENO + 1; fd <= lastfd; fd++) {
+        if (fd == childin || fd == childout || fd == childerr)
+            continue;
+        if (!virCommandFDIsSet(cmd, fd)) {
+            int tmpfd = fd;
+            VIR_MASS_CLOSE(tmpfd);
+        } else if (virSetInherit(fd, true) < 0) {
+            virReportSystemError(errno, _("failed to preserve fd %d"), fd);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+#  endif /* HAVE_CLOSE_RANGE */
+
 static int
 virCommandMassClose(virCommandPtr cmd,
                     int childin,
@@ -555,9 +596,17 @@ virCommandMassClose(virCommandPtr cmd,
                     int childerr)
 {
     g_autoptr(virBitmap) fds = NULL;
-    int openmax = sysconf(_SC_OPEN_MAX);
+    int openmax;
     int fd = -1;
 
+#  ifdef HAVE_CLOSE_RANGE
+    if (virCommandMassCloseRange(cmd, childin, childout, childerr) == 0)
+        return 0;
+    virResetLastError();
+#  endif /* HAVE_CLOSE_RANGE */
+
+    openmax = sysconf(_SC_OPEN_MAX);
+
     /* In general, it is not safe to call malloc() between fork() and exec()
      * because the child might have forked at the worst possible time, i.e.
      * when another thread was in malloc() and thus held its lock. That is to
@@ -600,13 +649,466 @@ virCommandMassClose(virCommandPtr cmd,
 
 # endif /* ! __FreeBSD__ */
 
+/*
+ * Whether @cmd needs nothing but its standard streams to be set up
+ * between fork and exec, so that it can be started with posix_spawn(),
+ * which doesn't duplicate the address space of the daemon, or by the
+ * command helper processes.
+ */
+static bool
+virExecIsSimple(virCommandPtr cmd)
+{
+    if (cmd->hook || cmd->handshake || cmd->pidfile || cmd->pwd ||
+        cmd->npassfd || cmd->mask ||
+        (cmd->flags & (VIR_EXEC_DAEMON | VIR_EXEC_CLEAR_CAPS)))
+        return false;
+
+    if (cmd->uid != (uid_t)-1 || cmd->gid != (gid_t)-1 || cmd->capabilities)
+        return false;
+
+    if (cmd->maxMemLock || cmd->maxProcesses || cmd->maxFiles ||
+        cmd->setMaxCore)
+        return false;
+
+# if defined(WITH_SECDRIVER_SELINUX)
+    if (cmd->seLinuxLabel)
+        return false;
+# endif
+# if defined(WITH_SECDRIVER_APPARMOR)
+    if (cmd->appArmorProfile)
+        return false;
+# endif
+
+    return true;
+}
+
+
+/*
+ * The command helpers are processes forked when the daemon starts, while
+ * it is still small, to which it can hand the commands it runs
+ * synchronously. Each helper runs one command at a time: it receives the
+ * binary, the arguments and the environment of the command on its socket
+ * followed by its standard streams, forks and executes it, replies with
+ * the pid of the command and then with its raw exit status.
+ */
+typedef struct _virCommandHelpers virCommandHelpers;
+typedef virCommandHelpers *virCommandHelpersPtr;
+
+struct _virCommandHelpers {
+    virMutex lock;
+    virCond cond;
+    size_t nhelpers;
+    int *socks; /* -1 once a helper failed */
+    bool *busy;
+};
+
+static virCommandHelpersPtr commandHelpers;
+
+/* Upper bound of a string in a helper request */
+# define VIR_COMMAND_HELPER_STRING_MAX (1024 * 1024)
+
+
+static int
+virCommandHelperSendStrings(int sock,
+                            const char *const *strs)
+{
+    uint32_t n = strs ? g_strv_length((char **)strs) : 0;
+    size_t i;
+
+    if (safewrite(sock, &n, sizeof(n)) != sizeof(n))
+        return -1;
+
+    for (i = 0; i < n; i++) {
+        uint32_t len = strlen(strs[i]);
+
+        if (safewrite(sock, &len, sizeof(len)) != sizeof(len) ||
+            safewrite(sock, strs[i], len) != len)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static char **
+virCommandHelperRecvStrings(int sock)
+{
+    g_auto(GStrv) strs = NULL;
+    uint32_t n;
+    size_t i;
+
+    if (saferead(sock, &n, sizeof(n)) != sizeof(n) ||
+        n > VIR_COMMAND_HELPER_STRING_MAX)
+        return NULL;
+
+    strs = g_new0(char *, n + 1);
+    for (i = 0; i < n; i++) {
+        uint32_t len;
+
+        if (saferead(sock, &len, sizeof(len)) != sizeof(len) ||
+            len > VIR_COMMAND_HELPER_STRING_MAX)
+            return NULL;
+
+        strs[i] = g_new0(char, len + 1);
+        if (saferead(sock, strs[i], len) != len)
+            return NULL;
+    }
+
+    return g_steal_pointer(&strs);
+}
+
+
+/*
+ * Main loop of a helper process, returns when the daemon closes its end
+ * of @sock.
+ */
+static void
+virCommandHelperRun(int sock)
+{
+    for (;;) {
+        g_auto(GStrv) binary = NULL;
+        g_auto(GStrv) args = NULL;
+        g_auto(GStrv) env = NULL;
+        int fds[3] = { -1, -1, -1 };
+        int64_t reply;
+        int status;
+        pid_t pid;
+        size_t i;
+
+        if (!(binary = virCommandHelperRecvStrings(sock)) || !binary[0] ||
+            !(args = virCommandHelperRecvStrings(sock)) || !args[0] ||
+            !(env = virCommandHelperRecvStrings(sock)))
+            return;
+
+        for (i = 0; i < G_N_ELEMENTS(fds); i++) {
+            if ((fds[i] = virSocketRecvFD(sock, 0)) < 0)
+                goto error;
+        }
+
+        if ((pid = fork()) == 0) {
+            for (i = 0; i < G_N_ELEMENTS(fds); i++) {
+                if (prepareStdFd(fds[i], i) < 0)
+                    _exit(EXIT_CANCELED);
+            }
+            for (i = 0; i < G_N_ELEMENTS(fds); i++) {
+                if (fds[i] > STDERR_FILENO)
+                    VIR_FORCE_CLOSE(fds[i]);
+            }
+            VIR_FORCE_CLOSE(sock);
+
+            execve(binary[0], args, env);
+            _exit(errno == ENOENT ? EXIT_ENOENT : EXIT_CANNOT_INVOKE);
+        }
+
+        for (i = 0; i < G_N_ELEMENTS(fds); i++)
+            VIR_FORCE_CLOSE(fds[i]);
+
+        reply = pid;
+        if (safewrite(sock, &reply, sizeof(reply)) != sizeof(reply))
+            goto error;
+
+        if (pid < 0)
+            continue;
+
+        while (waitpid(pid, &status, 0) < 0) {
+            if (errno != EINTR)
+                return;
+        }
+
+        reply = status;
+        if (safewrite(sock, &reply, sizeof(reply)) != sizeof(reply))
+            return;
+        continue;
+
+     error:
+        for (i = 0; i < G_N_ELEMENTS(fds); i++)
+            VIR_FORCE_CLOSE(fds[i]);
+        return;
+    }
+}
+
+
+/**
+ * virCommandHelpersStart:
+ * @nhelpers: number of helper processes
+ *
+ * Fork @nhelpers processes to which commands run with virCommandRun()
+ * are handed when they need nothing but their standard streams to be set
+ * up, so that the process running them doesn't have to duplicate the
+ * address space of the caller. At most @nhelpers such commands run at
+ * once, others wait for a helper to be free.
+ *
+ * Meant to be called once, early by daemons.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virCommandHelpersStart(size_t nhelpers)
+{
+    g_autofree virCommandHelpersPtr helpers = NULL;
+    size_t i;
+
+    if (commandHelpers) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("command helpers are already running"));
+        return -1;
+    }
+
+    if (nhelpers == 0)
+        return 0;
+
+    helpers = g_new0(virCommandHelpers, 1);
+    if (virMutexInit(&helpers->lock) < 0 ||
+        virCondInit(&helpers->cond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to initialize command helpers"));
+        return -1;
+    }
+
+    helpers->socks = g_new0(int, nhelpers);
+    helpers->busy = g_new0(bool, nhelpers);
+
+    for (i = 0; i < nhelpers; i++) {
+        int pair[2];
+        pid_t pid;
+
+        helpers->socks[i] = -1;
+
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("unable to create command helper socket"));
+            break;
+        }
+
+        if ((pid = virFork()) < 0) {
+            VIR_FORCE_CLOSE(pair[0]);
+            VIR_FORCE_CLOSE(pair[1]);
+            break;
+        }
+
+        if (pid == 0) {
+            g_autoptr(virCommand) self = virCommandNew("command-helper");
+
+            /* Keep nothing from the daemon but the socket and the
+             * standard streams */
+            virCommandPassFD(self, pair[1], 0);
+            if (virCommandMassClose(self, STDIN_FILENO, STDOUT_FILENO,
+                                    STDERR_FILENO) < 0)
+                _exit(EXIT_CANCELED);
+
+            virCommandHelperRun(pair[1]);
+            _exit(EXIT_SUCCESS);
+        }
+
+        VIR_DEBUG("Started command helper %zu with pid %lld",
+                  i, (long long)pid);
+        VIR_FORCE_CLOSE(pair[1]);
+        helpers->socks[i] = pair[0];
+        helpers->nhelpers++;
+    }
+
+    if (helpers->nhelpers == 0)
+        return -1;
+
+    /* The helpers exit when their socket is closed, no need to wait for
+     * them */
+    commandHelpers = g_steal_pointer(&helpers);
+    return 0;
+}
+
+
+/*
+ * Makes @helper available to other commands again, or stops using it if
+ * it is @broken.
+ */
+static void
+virCommandHelperRelease(size_t helper,
+                        bool broken)
+{
+    virCommandHelpersPtr helpers = commandHelpers;
+
+    virMutexLock(&helpers->lock);
+    if (broken)
+        VIR_FORCE_CLOSE(helpers->socks[helper]);
+    helpers->busy[helper] = false;
+    virCondBroadcast(&helpers->cond);
+    virMutexUnlock(&helpers->lock);
+}
+
+
+/*
+ * Waits for the command @cmd handed to a command helper to exit and
+ * stores its raw exit status in @status.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+static int
+virCommandHelperWait(virCommandPtr cmd,
+                     int *status)
+{
+    int sock = commandHelpers->socks[cmd->helper];
+    int64_t reply;
+
+    if (saferead(sock, &reply, sizeof(reply)) != sizeof(reply)) {
+        virReportSystemError(errno ? errno : EIO,
+                             _("unable to wait for process %lld"),
+                             (long long) cmd->pid);
+        virCommandHelperRelease(cmd->helper, true);
+        cmd->helper = -1;
+        return -1;
+    }
+
+    virCommandHelperRelease(cmd->helper, false);
+    cmd->helper = -1;
+    *status = reply;
+    return 0;
+}
+
+
+/*
+ * Hands @cmd to a free command helper, waiting for one if they are all
+ * busy. Returns the pid of the command, or -1 without reporting an error
+ * if it has to be run by this process.
+ */
+static pid_t
+virCommandHelperExec(virCommandPtr cmd,
+                     const char *binary,
+                     int childin,
+                     int childout,
+                     int childerr)
+{
+    virCommandHelpersPtr helpers = commandHelpers;
+    const char *binaryv[] = { binary, NULL };
+    int64_t reply;
+    ssize_t helper = -1;
+    int sock;
+    size_t i;
+
+    virMutexLock(&helpers->lock);
+    while (helper < 0) {
+        bool alive = false;
+
+        for (i = 0; i < helpers->nhelpers; i++) {
+            if (helpers->socks[i] < 0)
+                continue;
+            alive = true;
+            if (!helpers->busy[i]) {
+                helper = i;
+                break;
+            }
+        }
+
+        if (!alive)
+            break;
+
+        if (helper < 0 &&
+            virCondWait(&helpers->cond, &helpers->lock) < 0)
+            break;
+    }
+    if (helper >= 0)
+        helpers->busy[helper] = true;
+    virMutexUnlock(&helpers->lock);
+
+    if (helper < 0)
+        return -1;
+
+    sock = helpers->socks[helper];
+
+    if (virCommandHelperSendStrings(sock, binaryv) < 0 ||
+        virCommandHelperSendStrings(sock, (const char *const *)cmd->args) < 0 ||
+        virCommandHelperSendStrings(sock, cmd->env ?
+                                    (const char *const *)cmd->env :
+                                    (const char *const *)environ) < 0 ||
+        virSocketSendFD(sock, childin) < 0 ||
+        virSocketSendFD(sock, childout) < 0 ||
+        virSocketSendFD(sock, childerr) < 0 ||
+        saferead(sock, &reply, sizeof(reply)) != sizeof(reply)) {
+        VIR_WARN("Command helper %zd failed: %s", helper, g_strerror(errno));
+        virCommandHelperRelease(helper, true);
+        return -1;
+    }
+
+    if (reply < 0) {
+        virCommandHelperRelease(helper, false);
+        return -1;
+    }
+
+    cmd->helper = helper;
+    return reply;
+}
+
+
+# ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+/*
+ * Starts @binary with posix_spawn(), with the same standard streams,
+ * signal dispositions and signal mask as virExec() would set up in the
+ * child, and all the other FDs closed.
+ *
+ * Returns the pid of the child, or -1 with errno set if posix_spawn()
+ * failed, without reporting an error.
+ */
+static pid_t
+virExecSpawn(virCommandPtr cmd,
+             const char *binary,
+             int childin,
+             int childout,
+             int childerr)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t sigs;
+    pid_t pid = -1;
+    int rc;
+
+    if ((rc = posix_spawn_file_actions_init(&actions)) != 0) {
+        errno = rc;
+        return -1;
+    }
+
+    if ((rc = posix_spawnattr_init(&attr)) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        errno = rc;
+        return -1;
+    }
+
+    /* dup2() onto the same FD clears its close-on-exec flag */
+    if ((rc = posix_spawn_file_actions_adddup2(&actions, childin, STDIN_FILENO)) != 0 ||
+        (rc = posix_spawn_file_actions_adddup2(&actions, childout, STDOUT_FILENO)) != 0 ||
+        (rc = posix_spawn_file_actions_adddup2(&actions, childerr, STDERR_FILENO)) != 0 ||
+        (rc = posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1)) != 0)
+        goto cleanup;
+
+    sigfillset(&sigs);
+    if ((rc = posix_spawnattr_setsigdefault(&attr, &sigs)) != 0)
+        goto cleanup;
+    sigemptyset(&sigs);
+    if ((rc = posix_spawnattr_setsigmask(&attr, &sigs)) != 0 ||
+        (rc = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF |
+                                              POSIX_SPAWN_SETSIGMASK)) != 0)
+        goto cleanup;
+
+    rc = posix_spawn(&pid, binary, &actions, &attr, cmd->args,
+                     cmd->env ? cmd->env : environ);
+
+ cleanup:
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    return pid;
+}
+# endif /* HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP */
+
 /*
  * virExec:
  * @cmd virCommandPtr containing all information about the program to
  *      exec.
+ * @synchronous: whether the caller waits for the program to exit
  */
 static int
-virExec(virCommandPtr cmd)
+virExec(virCommandPtr cmd, bool synchronous)
 {
     pid_t pid;
     int null = -1;
@@ -620,7 +1122,7 @@ virExec(virCommandPtr cmd)
     const char *binary = NULL;
     int ret;
     g_autofree gid_t *groups = NULL;
-    int ngroups;
+    int ngroups = 0;
 
     if (cmd->args[0][0] != '/') {
         if (!(binary = binarystr = virFindFileInPath(cmd->args[0]))) {
@@ -685,13 +1187,33 @@ virExec(virCommandPtr cmd)
         childerr = null;
     }
 
-    if ((ngroups = virGetGroupList(cmd->uid, cmd->gid, &groups)) < 0)
-        goto cleanup;
+    pid = -1;
 
-    pid = virFork();
+    /* Commands which are waited for right away are run by the command
+     * helpers, the caller never has to reap them by itself */
+    if (synchronous && commandHelpers && virExecIsSimple(cmd) &&
+        (pid = virCommandHelperExec(cmd, binary, childin,
+                                    childout, childerr)) < 0) {
+        VIR_DEBUG("Unable to run %s by a command helper", binary);
+    }
 
-    if (pid < 0)
-        goto cleanup;
+# ifdef HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+    if (pid < 0 && virExecIsSimple(cmd) &&
+        (pid = virExecSpawn(cmd, binary, childin, childout, childerr)) < 0) {
+        /* Let the usual path report the failure */
+        VIR_DEBUG("Unable to spawn %s: %s", binary, g_strerror(errno));
+    }
+# endif /* HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP */
+
+    if (pid < 0) {
+        if ((ngroups = virGetGroupList(cmd->uid, cmd->gid, &groups)) < 0)
+            goto cleanup;
+
+        pid = virFork();
+
+        if (pid < 0)
+            goto cleanup;
+    }
 
     if (pid) { /* parent */
         VIR_FORCE_CLOSE(null);
@@ -903,6 +1425,15 @@ virFork(void)
     return -1;
 }
 
+
+int
+virCommandHelpersStart(size_t nhelpers G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Command helpers are not supported on Win32 platform"));
+    return -1;
+}
+
 #endif /* WIN32 */
 
 
@@ -945,6 +1476,7 @@ virCommandNewArgs(const char *const*args)
 
     cmd->infd = cmd->inpipe = cmd->outfd = cmd->errfd = -1;
     cmd->pid = -1;
+    cmd->helper = -1;
     cmd->uid = -1;
     cmd->gid = -1;
 
@@ -2615,7 +3147,7 @@ virCommandRunAsync(virCommandPtr cmd, pid_t *pid)
     }
 
     VIR_DEBUG("About to run %s", str ? str : cmd->args[0]);
-    ret = virExec(cmd);
+    ret = virExec(cmd, synchronous);
     VIR_DEBUG("Command result %d, with PID %d",
               ret, (int)cmd->pid);
 
@@ -2711,7 +3243,10 @@ virCommandWait(virCommandPtr cmd, int *exitstatus)
      * message is not as detailed as what we can provide.  So, we
      * guarantee that virProcessWait only fails due to failure to wait,
      * and repeat the exitstatus check code ourselves.  */
-    ret = virProcessWait(cmd->pid, &status, true);
+    if (cmd->helper >= 0)
+        ret = virCommandHelperWait(cmd, &status);
+    else
+        ret = virProcessWait(cmd->pid, &status, true);
     if (cmd->flags & VIR_EXEC_ASYNC_IO) {
         cmd->flags &= ~VIR_EXEC_ASYNC_IO;
         virThreadJoin(cmd->asyncioThread);
@@ -2763,7 +3298,18 @@ virCommandAbort(virCommandPtr cmd)
 {
     if (!cmd || cmd->pid == -1)
         return;
-    virProcessAbort(cmd->pid);
+    if (cmd->helper >= 0) {
+        virErrorPtr saved;
+        int status;
+
+        /* The command helper reaps the process */
+        virErrorPreserveLast(&saved);
+        kill(cmd->pid, SIGKILL);
+        ignore_value(virCommandHelperWait(cmd, &status));
+        virErrorRestore(&saved);
+    } else {
+        virProcessAbort(cmd->pid);
+    }
     cmd->pid = -1;
     cmd->reap = false;
 }
@@ -277,3 +277,150 @@ virCryptoEncryptData(virCryptoCipher algorithm,
                    _("algorithm=%d is not supported"), algorithm);
     return -1;
 }
+
+
+/* virCryptoDecryptDataAESgnutls:
+ *
+ * Performs the AES gnutls decryption
+ *
+ * Same input as virCryptoDecryptData, except the algorithm is replaced
+ * by the specific gnutls algorithm.
+ *
+ * Returns 0 on success with the data being filled. It is the caller's
+ * responsibility to clear and free it. Returns -1 on failure w/ error set.
+ */
+static int
+virCryptoDecryptDataAESgnutls(gnutls_cipher_algorithm_t gnutls_dec_alg,
+                              uint8_t *enckey,
+                              size_t enckeylen,
+                              uint8_t *iv,
+                              size_t ivlen,
+                              uint8_t *ciphertext,
+                              size_t ciphertextlen,
+                              uint8_t **dataret,
+                              size_t *datalenret)
+{
+    int rc;
+    size_t i;
+    gnutls_cipher_hd_t handle = NULL;
+    gnutls_datum_t enc_key;
+    gnutls_datum_t iv_buf;
+    uint8_t *data;
+    size_t padding;
+
+    if (ciphertextlen == 0 || ciphertextlen % 16 != 0) {
+        virReportError(VIR_ERR_INVALID_ARG,
+                       _("invalid ciphertext length %zu"), ciphertextlen);
+        return -1;
+    }
+
+    if (VIR_ALLOC_N(data, ciphertextlen) < 0)
+        return -1;
+    memcpy(data, ciphertext, ciphertextlen);
+
+    /* Initialize the gnutls cipher */
+    enc_key.size = enckeylen;
+    enc_key.data = enckey;
+    iv_buf.size = ivlen;
+    iv_buf.data = iv;
+    if ((rc = gnutls_cipher_init(&handle, gnutls_dec_alg,
+                                 &enc_key, &iv_buf)) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("failed to initialize cipher: '%s'"),
+                       gnutls_strerror(rc));
+        goto error;
+    }
+
+    /* Decrypt the data and free the memory for cipher operations */
+    rc = gnutls_cipher_decrypt(handle, data, ciphertextlen);
+    gnutls_cipher_deinit(handle);
+    memset(&enc_key, 0, sizeof(gnutls_datum_t));
+    memset(&iv_buf, 0, sizeof(gnutls_datum_t));
+    if (rc < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("failed to decrypt the data: '%s'"),
+                       gnutls_strerror(rc));
+        goto error;
+    }
+
+    /* Strip the padding added by virCryptoEncryptDataAESgnutls, every
+     * byte of which holds the size of the padding */
+    padding = data[ciphertextlen - 1];
+    if (padding == 0 || padding > 16)
+        goto badpadding;
+    for (i = ciphertextlen - padding; i < ciphertextlen; i++) {
+        if (data[i] != padding)
+            goto badpadding;
+    }
+
+    *dataret = data;
+    *datalenret = ciphertextlen - padding;
+    return 0;
+
+ badpadding:
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("failed to decrypt the data: invalid padding"));
+ error:
+    VIR_DISPOSE_N(data, ciphertextlen);
+    memset(&enc_key, 0, sizeof(gnutls_datum_t));
+    memset(&iv_buf, 0, sizeof(gnutls_datum_t));
+    return -1;
+}
+
+
+/* virCryptoDecryptData:
+ * @algorithm: algorithm used for encryption
+ * @enckey: encryption key
+ * @enckeylen: encryption key length
+ * @iv: initialization vector
+ * @ivlen: length of initialization vector
+ * @ciphertext: data to decrypt
+ * @ciphertextlen: length of data
+ * @data: stream of bytes allocated to store the decrypted data
+ * @datalen: size of the stream of bytes
+ *
+ * Reverses virCryptoEncryptData called with the same parameters.
+ *
+ * Returns 0 on success, -1 on failure with error set
+ */
+int
+virCryptoDecryptData(virCryptoCipher algorithm,
+                     uint8_t *enckey,
+                     size_t enckeylen,
+                     uint8_t *iv,
+                     size_t ivlen,
+                     uint8_t *ciphertext,
+                     size_t ciphertextlen,
+                     uint8_t **data,
+                     size_t *datalen)
+{
+    switch (algorithm) {
+    case VIR_CRYPTO_CIPHER_AES256CBC:
+        if (enckeylen != 32) {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("AES256CBC decryption invalid keylen=%zu"),
+                           enckeylen);
+            return -1;
+        }
+
+        if (!iv || ivlen != 16) {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("AES256CBC initialization vector invalid len=%zu"),
+                           ivlen);
+            return -1;
+        }
+
+        return virCryptoDecryptDataAESgnutls(GNUTLS_CIPHER_AES_256_CBC,
+                                             enckey, enckeylen, iv, ivlen,
+                                             ciphertext, ciphertextlen,
+                                             data, datalen);
+
+    case VIR_CRYPTO_CIPHER_NONE:
+    case VIR_CRYPTO_CIPHER_LAST:
+        break;
+    }
+
+    virReportError(VIR_ERR_INVALID_ARG,
+                   _("algorithm=%d is not supported"), algorithm);
+    return -1;
+}
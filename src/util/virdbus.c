@@ -1650,6 +1650,125 @@ int virDBusCallMethod(DBusConnection *conn,
 }
 
 
+struct virDBusCallAsyncData {
+    char *member;
+    char *ignoreError;
+};
+
+
+static void
+virDBusCallAsyncDataFree(void *opaque)
+{
+    struct virDBusCallAsyncData *data = opaque;
+
+    g_free(data->member);
+    g_free(data->ignoreError);
+    g_free(data);
+}
+
+
+static void
+virDBusCallAsyncNotify(DBusPendingCall *pending,
+                       void *opaque)
+{
+    struct virDBusCallAsyncData *data = opaque;
+    DBusMessage *reply = dbus_pending_call_steal_reply(pending);
+    const char *name;
+
+    if (!reply)
+        return;
+
+    if (dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR) {
+        name = dbus_message_get_error_name(reply);
+
+        if (STRNEQ_NULLABLE(name, data->ignoreError))
+            VIR_WARN("%s failed: %s", data->member, NULLSTR(name));
+    } else {
+        VIR_DEBUG("%s finished", data->member);
+    }
+
+    virDBusMessageUnref(reply);
+}
+
+
+/**
+ * virDBusCallMethodAsync:
+ * @conn: a DBus connection
+ * @ignoreError: name of a DBus error not worth logging, or NULL
+ * @destination: bus identifier of the target service
+ * @path: object path of the target service
+ * @iface: the interface of the object
+ * @member: the name of the method in the interface
+ * @types: type signature for following method arguments
+ * @...: method arguments
+ *
+ * This invokes a method on a remote service like virDBusCallMethod,
+ * but does not wait for its reply. The call is finished by the event
+ * loop the DBus connection is registered with, which logs any error
+ * it returns other than @ignoreError.
+ *
+ * Use this for calls whose result is not acted on, to save the
+ * caller a round trip to the service.
+ *
+ * Returns 0 if the call was queued, or -1 upon error
+ */
+int virDBusCallMethodAsync(DBusConnection *conn,
+                           const char *ignoreError,
+                           const char *destination,
+                           const char *path,
+                           const char *iface,
+                           const char *member,
+                           const char *types, ...)
+{
+    DBusMessage *call = NULL;
+    DBusPendingCall *pending = NULL;
+    struct virDBusCallAsyncData *data = NULL;
+    int ret = -1;
+    va_list args;
+
+    va_start(args, types);
+    ret = virDBusCreateMethodV(&call, destination, path,
+                               iface, member, types, args);
+    va_end(args);
+    if (ret < 0)
+        goto cleanup;
+
+    ret = -1;
+
+    PROBE(DBUS_METHOD_CALL,
+          "'%s.%s' on '%s' at '%s'",
+          iface, member, path, destination);
+
+    if (!dbus_connection_send_with_reply(conn, call, &pending,
+                                         VIR_DBUS_METHOD_CALL_TIMEOUT_MILLIS)) {
+        virReportOOMError();
+        goto cleanup;
+    }
+
+    /* @pending is NULL if the connection is already disconnected */
+    if (pending) {
+        data = g_new0(struct virDBusCallAsyncData, 1);
+        data->member = g_strdup(member);
+        data->ignoreError = g_strdup(ignoreError);
+
+        if (!dbus_pending_call_set_notify(pending, virDBusCallAsyncNotify,
+                                          data, virDBusCallAsyncDataFree)) {
+            virDBusCallAsyncDataFree(data);
+            virReportOOMError();
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    if (pending)
+        dbus_pending_call_unref(pending);
+    virDBusMessageUnref(call);
+    return ret;
+}
+
+
 static int virDBusIsServiceInList(const char *listMethod, const char *name)
 {
     DBusConnection *conn;
@@ -1824,6 +1943,19 @@ int virDBusCallMethod(DBusConnection *conn G_GNUC_UNUSED,
     return -1;
 }
 
+int virDBusCallMethodAsync(DBusConnection *conn G_GNUC_UNUSED,
+                           const char *ignoreError G_GNUC_UNUSED,
+                           const char *destination G_GNUC_UNUSED,
+                           const char *path G_GNUC_UNUSED,
+                           const char *iface G_GNUC_UNUSED,
+                           const char *member G_GNUC_UNUSED,
+                           const char *types G_GNUC_UNUSED, ...)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR,
+                   "%s", _("DBus support not compiled into this binary"));
+    return -1;
+}
+
 
 int virDBusMessageEncode(DBusMessage* msg G_GNUC_UNUSED,
                          const char *types G_GNUC_UNUSED,
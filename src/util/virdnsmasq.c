@@ -549,6 +549,48 @@ dnsmasqSave(const dnsmasqContext *ctx)
 }
 
 
+/**
+ * dnsmasqAppendDhcpHosts:
+ * @ctx: pointer to the dnsmasq context for each network
+ *
+ * Appends the DHCP hosts of the context to the hosts file written
+ * earlier by dnsmasqSave, leaving the rest of the file and the
+ * additional hosts file untouched.
+ *
+ * Returns 0 on success, -1 on failure (with error reported).
+ */
+int
+dnsmasqAppendDhcpHosts(const dnsmasqContext *ctx)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *content = NULL;
+    VIR_AUTOCLOSE fd = -1;
+    size_t len;
+    size_t i;
+
+    for (i = 0; i < ctx->hostsfile->nhosts; i++)
+        virBufferAsprintf(&buf, "%s\n", ctx->hostsfile->hosts[i].host);
+
+    if (!(content = virBufferContentAndReset(&buf)))
+        return 0;
+    len = strlen(content);
+
+    if ((fd = open(ctx->hostsfile->path, O_WRONLY | O_APPEND)) < 0) {
+        virReportSystemError(errno, _("cannot open config file '%s'"),
+                             ctx->hostsfile->path);
+        return -1;
+    }
+
+    if (safewrite(fd, content, len) != len) {
+        virReportSystemError(errno, _("cannot write config file '%s'"),
+                             ctx->hostsfile->path);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 /**
  * dnsmasqDelete:
  * @ctx: pointer to the dnsmasq context for each network
@@ -97,6 +97,7 @@ int              dnsmasqAddHost(dnsmasqContext *ctx,
                                 virSocketAddr *ip,
                                 const char *name);
 int              dnsmasqSave(const dnsmasqContext *ctx);
+int              dnsmasqAppendDhcpHosts(const dnsmasqContext *ctx);
 int              dnsmasqDelete(const dnsmasqContext *ctx);
 int              dnsmasqReload(pid_t pid);
 
@@ -33,6 +33,8 @@
 #include "virerrorpriv.h"
 #undef LIBVIRT_VIRERRORPRIV_H_ALLOW
 
+#define VIR_FROM_THIS VIR_FROM_NONE
+
 VIR_LOG_INIT("util.error");
 
 virThreadLocal virLastErr;
@@ -41,6 +43,9 @@ virErrorFunc virErrorHandler = NULL;     /* global error handler */
 void *virUserData = NULL;        /* associated data */
 virErrorLogPriorityFunc virErrorLogPriorityFilter = NULL;
 
+/* error domains whose errors dump the in-memory log buffers */
+static bool virErrorLogDumpDomains[VIR_ERR_DOMAIN_LAST];
+
 static virLogPriority virErrorLevelPriority(virErrorLevel level)
 {
     switch (level) {
@@ -854,6 +859,15 @@ virRaiseErrorFull(const char *filename,
     virRaiseErrorLog(filename, funcname, linenr,
                      to, meta);
 
+    if (level == VIR_ERR_ERROR &&
+        domain > 0 && domain < VIR_ERR_DOMAIN_LAST &&
+        virErrorLogDumpDomains[domain]) {
+        g_autofree char *reason = g_strdup_printf("%s error: %s",
+                                                  virErrorDomainTypeToString(domain),
+                                                  str);
+        virLogDumpBuffers(reason);
+    }
+
     errno = save_errno;
 }
 
@@ -1394,6 +1408,37 @@ void virSetErrorLogPriorityFunc(virErrorLogPriorityFunc func)
 }
 
 
+/**
+ * virErrorSetLogDumpDomains:
+ * @domains: NULL terminated list of error domain names, e.g. "QEMU Driver"
+ *
+ * Makes errors raised in any of @domains dump the in-memory log buffers,
+ * see virLogDumpBuffers(). Replaces the domains set by a previous call.
+ *
+ * Returns 0 on success, -1 if a name is not a known error domain.
+ */
+int
+virErrorSetLogDumpDomains(const char *const *domains)
+{
+    bool flags[VIR_ERR_DOMAIN_LAST] = { false };
+    size_t i;
+
+    for (i = 0; domains && domains[i]; i++) {
+        int domain = virErrorDomainTypeFromString(domains[i]);
+
+        if (domain <= 0) {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("Unknown error domain '%s'"), domains[i]);
+            return -1;
+        }
+        flags[domain] = true;
+    }
+
+    memcpy(virErrorLogDumpDomains, flags, sizeof(flags));
+    return 0;
+}
+
+
 /**
  * virErrorSetErrnoFromLastError:
  *
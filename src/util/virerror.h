@@ -198,6 +198,8 @@ void virSetErrorLogPriorityFunc(virErrorLogPriorityFunc func);
 
 void virErrorSetErrnoFromLastError(void);
 
+int virErrorSetLogDumpDomains(const char *const *domains);
+
 bool virLastErrorIsSystemErrno(int errnum);
 
 void virErrorPreserveLast(virErrorPtr *saveerr);
@@ -35,6 +35,10 @@
 # include <io.h>
 #endif
 
+#ifdef HAVE_DLFCN_H
+# include <dlfcn.h>
+#endif
+
 #define VIR_FROM_THIS VIR_FROM_EVENT
 
 VIR_LOG_INIT("util.eventglib");
@@ -70,6 +74,85 @@ static GPtrArray *handles;
 static int nexttimer = 1;
 static GPtrArray *timeouts;
 
+/* Callbacks are only dispatched from the thread running the event loop,
+ * so this lock is hardly ever contended */
+static GMutex statslock;
+static virEventGLibStats stats;
+static gint slowThreshold; /* in microseconds, 0 if disabled */
+
+
+static size_t
+virEventGLibStatsBucket(unsigned long long usec)
+{
+    size_t bucket = 0;
+
+    while (usec > 0 && bucket < VIR_EVENT_GLIB_STATS_BUCKETS - 1) {
+        usec >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+
+static void
+virEventGLibReportSlow(const char *what,
+                       int id,
+                       void *cb,
+                       unsigned long long usec)
+{
+#ifdef HAVE_DLFCN_H
+    Dl_info info;
+
+    /* Static functions are not in the dynamic symbol table, so the name
+     * is that of the closest preceding exported symbol, as in backtraces */
+    if (dladdr(cb, &info) != 0 && info.dli_sname) {
+        VIR_WARN("Event loop %s %d callback %s+%#tx (%s) took %llu ms",
+                 what, id, info.dli_sname,
+                 (char *) cb - (char *) info.dli_saddr,
+                 NULLSTR(info.dli_fname), usec / 1000);
+        return;
+    }
+#endif /* HAVE_DLFCN_H */
+
+    VIR_WARN("Event loop %s %d callback %p took %llu ms",
+             what, id, cb, usec / 1000);
+}
+
+
+/*
+ * @start: when the callback was invoked, in microseconds
+ * @lag: how late a timer callback was invoked in microseconds, or -1
+ *
+ * Account a dispatch of the @what callback @cb of the watch or timer @id
+ * which has just returned.
+ */
+static void
+virEventGLibUpdateStats(const char *what,
+                        int id,
+                        void *cb,
+                        gint64 start,
+                        gint64 lag)
+{
+    unsigned long long usec = MAX(g_get_monotonic_time() - start, 0);
+    int threshold = g_atomic_int_get(&slowThreshold);
+    bool slow = threshold > 0 && usec >= (unsigned long long) threshold;
+
+    g_mutex_lock(&statslock);
+    stats.dispatched++;
+    stats.dispatchTime[virEventGLibStatsBucket(usec)]++;
+    if (usec > stats.dispatchMax)
+        stats.dispatchMax = usec;
+    if (lag >= 0)
+        stats.timerLag[virEventGLibStatsBucket(lag)]++;
+    if (slow)
+        stats.slow++;
+    g_mutex_unlock(&statslock);
+
+    if (slow)
+        virEventGLibReportSlow(what, id, cb, usec);
+}
+
 static GIOCondition
 virEventGLibEventsToCondition(int events)
 {
@@ -109,6 +192,9 @@ virEventGLibHandleDispatch(int fd G_GNUC_UNUSED,
 {
     struct virEventGLibHandle *data = opaque;
     int events = virEventGLibConditionToEvents(condition);
+    int watch = data->watch;
+    virEventHandleCallback cb = data->cb;
+    gint64 start;
 
     VIR_DEBUG("Dispatch handler data=%p watch=%d fd=%d events=%d opaque=%p",
               data, data->watch, data->fd, events, data->opaque);
@@ -117,7 +203,9 @@ virEventGLibHandleDispatch(int fd G_GNUC_UNUSED,
           "watch=%d events=%d cb=%p opaque=%p",
           data->watch, events, data->cb, data->opaque);
 
+    start = g_get_monotonic_time();
     (data->cb)(data->watch, data->fd, events, data->opaque);
+    virEventGLibUpdateStats("handle", watch, (void *) cb, start, -1);
 
     return TRUE;
 }
@@ -318,6 +406,12 @@ static gboolean
 virEventGLibTimeoutDispatch(void *opaque)
 {
     struct virEventGLibTimeout *data = opaque;
+    int timer = data->timer;
+    virEventTimeoutCallback cb = data->cb;
+    gint64 start = g_get_monotonic_time();
+    /* the ready time of a timeout source is its expiry until it is
+     * rearmed after the callback returns */
+    gint64 lag = MAX(start - g_source_get_ready_time(g_main_current_source()), 0);
 
     VIR_DEBUG("Dispatch timeout data=%p cb=%p timer=%d opaque=%p",
               data, data->cb, data->timer, data->opaque);
@@ -326,6 +420,7 @@ virEventGLibTimeoutDispatch(void *opaque)
           "timer=%d cb=%p opaque=%p",
           data->timer, data->cb, data->opaque);
     (data->cb)(data->timer, data->opaque);
+    virEventGLibUpdateStats("timeout", timer, (void *) cb, start, lag);
 
     return TRUE;
 }
@@ -534,3 +629,36 @@ int virEventGLibRunOnce(void)
 
     return 0;
 }
+
+
+/**
+ * virEventGLibSetSlowThreshold:
+ * @msec: threshold in milliseconds, 0 to disable
+ *
+ * Log a warning naming the callback whenever dispatching a handle or
+ * timeout callback blocks the event loop for at least @msec.
+ */
+void virEventGLibSetSlowThreshold(unsigned int msec)
+{
+    g_atomic_int_set(&slowThreshold, MIN(msec, INT_MAX / 1000) * 1000);
+}
+
+
+/**
+ * virEventGLibGetStats:
+ * @stats: filled with the statistics
+ * @reset: whether to reset the statistics afterwards
+ *
+ * Retrieve the time spent in handle and timeout callbacks, and how late
+ * timeout callbacks were dispatched, since the process started or the
+ * statistics were last reset.
+ */
+void virEventGLibGetStats(virEventGLibStatsPtr ret,
+                          bool reset)
+{
+    g_mutex_lock(&statslock);
+    *ret = stats;
+    if (reset)
+        memset(&stats, 0, sizeof(stats));
+    g_mutex_unlock(&statslock);
+}
@@ -26,3 +26,23 @@
 void virEventGLibRegister(void);
 
 int virEventGLibRunOnce(void);
+
+/* Number of log2 histogram buckets of the event loop statistics: bucket 0
+ * counts samples shorter than 1us, bucket i those of at least 2^(i-1)us
+ * but less than 2^i us, and the last bucket any longer samples. */
+#define VIR_EVENT_GLIB_STATS_BUCKETS 24
+
+typedef struct _virEventGLibStats virEventGLibStats;
+typedef virEventGLibStats *virEventGLibStatsPtr;
+struct _virEventGLibStats {
+    unsigned long long dispatched; /* handle and timeout callbacks run */
+    unsigned long long slow; /* callbacks exceeding the slow threshold */
+    unsigned long long dispatchMax; /* longest callback, in us */
+    unsigned long long dispatchTime[VIR_EVENT_GLIB_STATS_BUCKETS];
+    unsigned long long timerLag[VIR_EVENT_GLIB_STATS_BUCKETS];
+};
+
+void virEventGLibSetSlowThreshold(unsigned int msec);
+
+void virEventGLibGetStats(virEventGLibStatsPtr stats,
+                          bool reset);
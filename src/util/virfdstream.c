@@ -416,6 +416,19 @@ virFDStreamThreadDataFree(virFDStreamThreadDataPtr data)
 }
 
 
+/* Comparing the buffer against itself shifted by one byte lets memcmp,
+ * which libc vectorizes, do the scanning. */
+static bool
+virFDStreamBufIsZero(const char *buf,
+                     size_t len)
+{
+    if (len == 0)
+        return false;
+
+    return buf[0] == 0 && memcmp(buf, buf + 1, len - 1) == 0;
+}
+
+
 static ssize_t
 virFDStreamThreadDoRead(virFDStreamDataPtr fdst,
                         bool sparse,
@@ -482,10 +495,18 @@ virFDStreamThreadDoRead(virFDStreamDataPtr fdst,
             goto error;
         }
 
-        msg->type = VIR_FDSTREAM_MSG_TYPE_DATA;
-        msg->stream.data.buf = buf;
-        msg->stream.data.len = got;
-        buf = NULL;
+        if (sparse && virFDStreamBufIsZero(buf, got)) {
+            /* Allocated, but zeroed out data reads the same as a hole
+             * on the other side, so don't bother transferring it. */
+            msg->type = VIR_FDSTREAM_MSG_TYPE_HOLE;
+            msg->stream.hole.len = got;
+            VIR_FREE(buf);
+        } else {
+            msg->type = VIR_FDSTREAM_MSG_TYPE_DATA;
+            msg->stream.data.buf = buf;
+            msg->stream.data.len = got;
+            buf = NULL;
+        }
         if (sparse)
             *dataLen -= got;
     }
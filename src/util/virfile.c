@@ -560,6 +560,128 @@ virFileRewriteStr(const char *path,
 }
 
 
+/**
+ * virFileRewriteBatch:
+ * @paths: files to rewrite
+ * @npaths: number of files in @paths
+ * @mode: mode of newly created files
+ * @rewrite: callback writing the new contents of a file
+ * @opaques: data passed to @rewrite for each of @paths
+ *
+ * Rewrites all of @paths the same way virFileRewrite does, but writes
+ * all the new files first, flushes them to disk at once, and only then
+ * renames them over the old ones. On failure no file is replaced
+ * unless the failure happened while renaming.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virFileRewriteBatch(const char **paths,
+                    size_t npaths,
+                    mode_t mode,
+                    virFileRewriteFunc rewrite,
+                    const void **opaques)
+{
+    g_autofree char **newfiles = NULL;
+    g_autofree int *fds = NULL;
+#ifdef HAVE_SYNCFS
+    g_autofree dev_t *devs = NULL;
+    size_t ndevs = 0;
+#endif /* HAVE_SYNCFS */
+    size_t i;
+    int ret = -1;
+
+    if (npaths == 0)
+        return 0;
+
+    newfiles = g_new0(char *, npaths);
+    fds = g_new(int, npaths);
+    for (i = 0; i < npaths; i++)
+        fds[i] = -1;
+
+    for (i = 0; i < npaths; i++) {
+        newfiles[i] = g_strdup_printf("%s.new", paths[i]);
+
+        if ((fds[i] = open(newfiles[i], O_WRONLY | O_CREAT | O_TRUNC, mode)) < 0) {
+            virReportSystemError(errno, _("cannot create file '%s'"),
+                                 newfiles[i]);
+            goto cleanup;
+        }
+
+        if (rewrite(fds[i], opaques[i]) < 0) {
+            virReportSystemError(errno, _("cannot write data to file '%s'"),
+                                 newfiles[i]);
+            goto cleanup;
+        }
+    }
+
+#ifdef HAVE_SYNCFS
+    /* a single sync of each filesystem is much cheaper than syncing the
+     * files one by one */
+    devs = g_new0(dev_t, npaths);
+    for (i = 0; i < npaths; i++) {
+        struct stat sb;
+        size_t j;
+
+        if (fstat(fds[i], &sb) < 0) {
+            virReportSystemError(errno, _("cannot stat file '%s'"),
+                                 newfiles[i]);
+            goto cleanup;
+        }
+
+        for (j = 0; j < ndevs; j++) {
+            if (devs[j] == sb.st_dev)
+                break;
+        }
+        if (j < ndevs)
+            continue;
+        devs[ndevs++] = sb.st_dev;
+
+        if (syncfs(fds[i]) < 0) {
+            virReportSystemError(errno, _("cannot sync file '%s'"),
+                                 newfiles[i]);
+            goto cleanup;
+        }
+    }
+#else /* !HAVE_SYNCFS */
+    for (i = 0; i < npaths; i++) {
+        if (g_fsync(fds[i]) < 0) {
+            virReportSystemError(errno, _("cannot sync file '%s'"),
+                                 newfiles[i]);
+            goto cleanup;
+        }
+    }
+#endif /* !HAVE_SYNCFS */
+
+    for (i = 0; i < npaths; i++) {
+        if (VIR_CLOSE(fds[i]) < 0) {
+            virReportSystemError(errno, _("cannot save file '%s'"),
+                                 newfiles[i]);
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < npaths; i++) {
+        if (rename(newfiles[i], paths[i]) < 0) {
+            virReportSystemError(errno, _("cannot rename file '%s' as '%s'"),
+                                 newfiles[i], paths[i]);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < npaths; i++) {
+        VIR_FORCE_CLOSE(fds[i]);
+        if (newfiles[i])
+            unlink(newfiles[i]);
+        g_free(newfiles[i]);
+    }
+    return ret;
+}
+
+
 int virFileTouch(const char *path, mode_t mode)
 {
     int fd = -1;
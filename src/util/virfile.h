@@ -126,6 +126,11 @@ int virFileRewrite(const char *path,
 int virFileRewriteStr(const char *path,
                       mode_t mode,
                       const char *str);
+int virFileRewriteBatch(const char **paths,
+                        size_t npaths,
+                        mode_t mode,
+                        virFileRewriteFunc rewrite,
+                        const void **opaques);
 
 int virFileTouch(const char *path, mode_t mode);
 
@@ -49,6 +49,13 @@ struct _virFileCache {
 
     virHashTablePtr table;
 
+    /* Names whose data is being created right now. The cache is
+     * unlocked while that happens so that data for different names
+     * can be created in parallel; lookups of the same name wait for
+     * @probeCond instead. */
+    virHashTablePtr probing;
+    virCond probeCond;
+
     char *dir;
     char *suffix;
 
@@ -78,6 +85,8 @@ virFileCacheDispose(void *obj)
     VIR_FREE(cache->suffix);
 
     virHashFree(cache->table);
+    virHashFree(cache->probing);
+    virCondDestroy(&cache->probeCond);
 
     virFileCachePrivFree(cache);
 }
@@ -125,7 +134,8 @@ virFileCacheGetFileName(virFileCachePtr cache,
 static int
 virFileCacheLoad(virFileCachePtr cache,
                  const char *name,
-                 void **data)
+                 void **data,
+                 void **outdatedData)
 {
     g_autofree char *file = NULL;
     int ret = -1;
@@ -162,6 +172,8 @@ virFileCacheLoad(virFileCachePtr cache,
     if (!cache->handlers.isValid(loadData, cache->priv)) {
         VIR_DEBUG("Outdated cached capabilities '%s' for '%s'", file, name);
         unlink(file);
+        if (cache->handlers.updateData && !*outdatedData)
+            *outdatedData = g_steal_pointer(&loadData);
         ret = 0;
         goto cleanup;
     }
@@ -194,26 +206,48 @@ virFileCacheSave(virFileCachePtr cache,
 }
 
 
+/* @outdated is the data which used to be cached for @name, if known */
 static void *
 virFileCacheNewData(virFileCachePtr cache,
-                    const char *name)
+                    const char *name,
+                    void *outdated)
 {
     void *data = NULL;
     int rv;
 
-    if ((rv = virFileCacheLoad(cache, name, &data)) < 0)
-        return NULL;
+    if (outdated)
+        virObjectRef(outdated);
+
+    if ((rv = virFileCacheLoad(cache, name, &data, &outdated)) < 0)
+        goto cleanup;
 
     if (rv == 0) {
-        if (!(data = cache->handlers.newData(name, cache->priv)))
+        /* Creating the data may take a long time (e.g. probing QEMU
+         * capabilities spawns the binary), don't block lookups of
+         * other names meanwhile */
+        if (virHashAddEntry(cache->probing, name, cache) < 0)
             return NULL;
 
-        if (virFileCacheSave(cache, name, data) < 0) {
+        virObjectUnlock(cache);
+
+        if (outdated && cache->handlers.updateData)
+            data = cache->handlers.updateData(name, outdated, cache->priv);
+        else
+            data = cache->handlers.newData(name, cache->priv);
+
+        if (data && virFileCacheSave(cache, name, data) < 0) {
             virObjectUnref(data);
             data = NULL;
         }
+
+        virObjectLock(cache);
+
+        virHashRemoveEntry(cache->probing, name);
+        virCondBroadcast(&cache->probeCond);
     }
 
+ cleanup:
+    virObjectUnref(outdated);
     return data;
 }
 
@@ -245,6 +279,15 @@ virFileCacheNew(const char *dir,
     if (!(cache->table = virHashCreate(10, virObjectFreeHashData)))
         goto cleanup;
 
+    if (!(cache->probing = virHashCreate(10, NULL)))
+        goto cleanup;
+
+    if (virCondInit(&cache->probeCond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot initialize condition variable"));
+        goto cleanup;
+    }
+
     cache->dir = g_strdup(dir);
 
     cache->suffix = g_strdup(suffix);
@@ -264,9 +307,13 @@ virFileCacheValidate(virFileCachePtr cache,
                      const char *name,
                      void **data)
 {
+    void *outdated = NULL;
+
     if (*data && !cache->handlers.isValid(*data, cache->priv)) {
         VIR_DEBUG("Cached data '%p' no longer valid for '%s'",
                   *data, NULLSTR(name));
+        if (cache->handlers.updateData)
+            outdated = virObjectRef(*data);
         if (name)
             virHashRemoveEntry(cache->table, name);
         *data = NULL;
@@ -274,7 +321,7 @@ virFileCacheValidate(virFileCachePtr cache,
 
     if (!*data && name) {
         VIR_DEBUG("Creating data for '%s'", name);
-        *data = virFileCacheNewData(cache, name);
+        *data = virFileCacheNewData(cache, name, outdated);
         if (*data) {
             VIR_DEBUG("Caching data '%p' for '%s'", *data, name);
             if (virHashAddEntry(cache->table, name, *data) < 0) {
@@ -283,6 +330,8 @@ virFileCacheValidate(virFileCachePtr cache,
             }
         }
     }
+
+    virObjectUnref(outdated);
 }
 
 
@@ -295,6 +344,9 @@ virFileCacheValidate(virFileCachePtr cache,
  * cached data, if it doesn't exist or is no longer valid new data
  * is created.
  *
+ * Lookups of different names may create their data concurrently,
+ * while lookups of a name whose data is being created wait for it.
+ *
  * Returns data object or NULL on error.  The caller is responsible for
  * unrefing the data.
  */
@@ -306,6 +358,15 @@ virFileCacheLookup(virFileCachePtr cache,
 
     virObjectLock(cache);
 
+    while (virHashLookup(cache->probing, name)) {
+        if (virCondWait(&cache->probeCond, &cache->parent.lock) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("failed to wait for cached data"));
+            virObjectUnlock(cache);
+            return NULL;
+        }
+    }
+
     data = virHashLookup(cache->table, name);
     virFileCacheValidate(cache, name, &data);
 
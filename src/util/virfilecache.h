@@ -57,6 +57,23 @@ typedef void *
 (*virFileCacheNewDataPtr)(const char *name,
                           void *priv);
 
+/**
+ * virFileCacheUpdateDataPtr:
+ * @name: name of the data
+ * @outdated: data object which is no longer valid
+ * @priv: private data created together with cache
+ *
+ * Optional replacement of virFileCacheNewDataPtr used when outdated
+ * data for @name is known. It may reuse the parts of @outdated which
+ * are still valid instead of creating everything again.
+ *
+ * Returns data object or NULL on error.
+ */
+typedef void *
+(*virFileCacheUpdateDataPtr)(const char *name,
+                             void *outdated,
+                             void *priv);
+
 /**
  * virFileCacheLoadFilePtr:
  * @filename: name of a file with cached data
@@ -110,6 +127,7 @@ struct _virFileCacheHandlers {
     virFileCacheLoadFilePtr loadFile;
     virFileCacheSaveFilePtr saveFile;
     virFileCachePrivFreePtr privFree;
+    virFileCacheUpdateDataPtr updateData;
 };
 
 virFileCachePtr
@@ -48,6 +48,14 @@ VIR_ENUM_IMPL(virFirewallLayerCommand,
               IP6TABLES_PATH,
 );
 
+VIR_ENUM_DECL(virFirewallLayerRestoreCommand);
+VIR_ENUM_IMPL(virFirewallLayerRestoreCommand,
+              VIR_FIREWALL_LAYER_LAST,
+              EBTABLES_RESTORE_PATH,
+              IPTABLES_RESTORE_PATH,
+              IP6TABLES_RESTORE_PATH,
+);
+
 struct _virFirewallRule {
     virFirewallLayer layer;
 
@@ -100,6 +108,9 @@ static bool iptablesUseLock;
 static bool ip6tablesUseLock;
 static bool ebtablesUseLock;
 static bool lockOverride; /* true to avoid lock probes */
+static bool batchOverride; /* true to avoid batched transactions */
+/* per layer, set once its restore command turned out not to work */
+static bool restoreUnusable[VIR_FIREWALL_LAYER_LAST];
 
 void
 virFirewallSetLockOverride(bool avoid)
@@ -107,6 +118,12 @@ virFirewallSetLockOverride(bool avoid)
     lockOverride = avoid;
 }
 
+void
+virFirewallSetBatchOverride(bool avoid)
+{
+    batchOverride = avoid;
+}
+
 static void
 virFirewallCheckUpdateLock(bool *lockflag,
                            const char *const*args)
@@ -203,6 +220,8 @@ virFirewallSetBackend(virFirewallBackend backend)
     if (virFirewallInitialize() < 0)
         return -1;
 
+    memset(restoreUnusable, 0, sizeof(restoreUnusable));
+
     return virFirewallValidateBackend(backend);
 }
 
@@ -761,23 +780,227 @@ virFirewallApplyRule(virFirewallPtr firewall,
     return 0;
 }
 
+/*
+ * Check whether @rule can be fed to the restore command of its
+ * layer and if so, store the table it applies to in @table.
+ */
+static bool
+virFirewallRuleGetRestoreTable(virFirewallRulePtr rule,
+                               const char **table)
+{
+    const char *const commands[] = {
+        "-A", "--append", "-I", "--insert", "-D", "--delete",
+        "-R", "--replace", "-N", "--new-chain", "-X", "--delete-chain",
+        "-F", "--flush", "-Z", "--zero",
+    };
+    bool command = false;
+    size_t i;
+    size_t j;
+
+    if (rule->queryCB || rule->ignoreErrors ||
+        restoreUnusable[rule->layer])
+        return false;
+
+    *table = "filter";
+
+    for (i = 0; i < rule->argsLen; i++) {
+        const char *arg = rule->args[i];
+
+        if (STREQ(arg, "-w") || STREQ(arg, "--concurrent"))
+            continue;
+
+        if (STREQ(arg, "-t") || STREQ(arg, "--table")) {
+            if (++i == rule->argsLen)
+                return false;
+            *table = rule->args[i];
+            continue;
+        }
+
+        if (!command) {
+            for (j = 0; j < G_N_ELEMENTS(commands); j++) {
+                if (STREQ(arg, commands[j]))
+                    break;
+            }
+            if (j == G_N_ELEMENTS(commands))
+                return false;
+            command = true;
+        }
+    }
+
+    return command;
+}
+
+
+/* Format @rule as a line of input for the restore command */
+static void
+virFirewallRuleFormatRestore(virFirewallRulePtr rule,
+                             virBufferPtr buf)
+{
+    size_t i;
+    bool first = true;
+
+    for (i = 0; i < rule->argsLen; i++) {
+        const char *arg = rule->args[i];
+
+        if (STREQ(arg, "-w") || STREQ(arg, "--concurrent"))
+            continue;
+
+        if (STREQ(arg, "-t") || STREQ(arg, "--table")) {
+            i++;
+            continue;
+        }
+
+        if (!first)
+            virBufferAddChar(buf, ' ');
+        first = false;
+
+        if (*arg && !strpbrk(arg, " \t\"'\\#")) {
+            virBufferAdd(buf, arg, -1);
+            continue;
+        }
+
+        virBufferAddChar(buf, '"');
+        for (; *arg; arg++) {
+            if (*arg == '"' || *arg == '\\')
+                virBufferAddChar(buf, '\\');
+            virBufferAddChar(buf, *arg);
+        }
+        virBufferAddChar(buf, '"');
+    }
+    virBufferAddChar(buf, '\n');
+}
+
+
+/*
+ * Count how many of the @nrules starting at @rules go to the same
+ * @table and can be applied at once through the restore command.
+ */
+static size_t
+virFirewallCountRestoreRules(virFirewallRulePtr *rules,
+                             size_t nrules,
+                             const char **table)
+{
+    const char *ruleTable;
+    size_t n;
+
+    if (nrules == 0 || !virFirewallRuleGetRestoreTable(rules[0], table))
+        return 0;
+
+    for (n = 1; n < nrules; n++) {
+        if (rules[n]->layer != rules[0]->layer ||
+            !virFirewallRuleGetRestoreTable(rules[n], &ruleTable) ||
+            STRNEQ(ruleTable, *table))
+            break;
+    }
+
+    return n;
+}
+
+
+/*
+ * Apply @nrules rules for @table with a single invocation of the
+ * restore command. The table is committed at once, so when this
+ * fails none of the rules took effect. Returns 0 on success, -1 on
+ * failure without reporting an error, so that the caller can fall
+ * back to applying the rules one by one.
+ */
+static int
+virFirewallApplyRulesRestore(virFirewallRulePtr *rules,
+                             size_t nrules,
+                             const char *table)
+{
+    virFirewallLayer layer = rules[0]->layer;
+    const char *bin = virFirewallLayerRestoreCommandTypeToString(layer);
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virCommand) cmd = NULL;
+    g_autofree char *input = NULL;
+    g_autofree char *error = NULL;
+    int status;
+    size_t i;
+
+    virBufferAsprintf(&buf, "*%s\n", table);
+    for (i = 0; i < nrules; i++)
+        virFirewallRuleFormatRestore(rules[i], &buf);
+    virBufferAddLit(&buf, "COMMIT\n");
+    input = virBufferContentAndReset(&buf);
+
+    VIR_INFO("Applying %zu rules for table '%s' at once:\n%s",
+             nrules, table, input);
+
+    cmd = virCommandNewArgList(bin, "--noflush", NULL);
+    if ((layer == VIR_FIREWALL_LAYER_IPV4 && iptablesUseLock) ||
+        (layer == VIR_FIREWALL_LAYER_IPV6 && ip6tablesUseLock))
+        virCommandAddArg(cmd, "-w");
+
+    virCommandSetInputBuffer(cmd, input);
+    virCommandSetErrorBuffer(cmd, &error);
+
+    if (virCommandRun(cmd, &status) < 0) {
+        VIR_WARN("Unable to run %s, applying rules one by one", bin);
+        virResetLastError();
+        restoreUnusable[layer] = true;
+        return -1;
+    }
+
+    if (status != 0) {
+        VIR_DEBUG("%s failed with status %d: %s",
+                  bin, status, NULLSTR(error));
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 virFirewallApplyGroup(virFirewallPtr firewall,
                       size_t idx)
 {
     virFirewallGroupPtr group = firewall->groups[idx];
     bool ignoreErrors = (group->actionFlags & VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS);
+    bool batch = (group->actionFlags & VIR_FIREWALL_TRANSACTION_BATCH) &&
+        !ignoreErrors && !batchOverride &&
+        currentBackend == VIR_FIREWALL_BACKEND_DIRECT;
     size_t i;
+    size_t j;
 
     VIR_INFO("Starting transaction for firewall=%p group=%p flags=0x%x",
              firewall, group, group->actionFlags);
     firewall->currentGroup = idx;
     group->addingRollback = false;
-    for (i = 0; i < group->naction; i++) {
-        if (virFirewallApplyRule(firewall,
-                                 group->action[i],
-                                 ignoreErrors) < 0)
-            return -1;
+    for (i = 0; i < group->naction;) {
+        const char *table = NULL;
+        size_t n = 0;
+
+        if (batch)
+            n = virFirewallCountRestoreRules(group->action + i,
+                                             group->naction - i, &table);
+
+        if (n > 1 &&
+            virFirewallApplyRulesRestore(group->action + i, n, table) == 0) {
+            i += n;
+            continue;
+        }
+
+        /* Possibly after a failed attempt to apply them all at once,
+         * which didn't change anything, so the first failing rule
+         * gets reported properly */
+        for (j = 0; j < MAX(n, 1); j++) {
+            if (virFirewallApplyRule(firewall,
+                                     group->action[i + j],
+                                     ignoreErrors) < 0)
+                return -1;
+        }
+
+        /* If every rule worked on its own, the restore command
+         * itself is what failed, so don't bother trying it again */
+        if (n > 1 && !restoreUnusable[group->action[i]->layer]) {
+            VIR_WARN("%s rejected rules which apply fine one by one, "
+                     "not batching them anymore",
+                     virFirewallLayerRestoreCommandTypeToString(group->action[i]->layer));
+            restoreUnusable[group->action[i]->layer] = true;
+        }
+        i += MAX(n, 1);
     }
     return 0;
 }
@@ -95,6 +95,9 @@ typedef enum {
     /* Ignore all errors when applying rules, so no
      * rollback block will be required */
     VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS = (1 << 0),
+    /* Where the backend allows it, apply consecutive rules
+     * for the same table with a single command */
+    VIR_FIREWALL_TRANSACTION_BATCH = (1 << 1),
 } virFirewallTransactionFlags;
 
 void virFirewallStartTransaction(virFirewallPtr firewall,
@@ -113,4 +116,6 @@ int virFirewallApply(virFirewallPtr firewall);
 
 void virFirewallSetLockOverride(bool avoid);
 
+void virFirewallSetBatchOverride(bool avoid);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virFirewall, virFirewallFree);
@@ -1,5 +1,5 @@
 /*
- * virhash.c: chained hash tables
+ * virhash.c: open addressing hash tables
  *
  * Reference: Your favorite introductory book on algorithms
  *
@@ -32,29 +32,40 @@
 
 VIR_LOG_INIT("util.hash");
 
-#define MAX_HASH_LEN 8
+#define VIR_HASH_MIN_SIZE 8
 
 /* #define DEBUG_GROW */
 
 /*
- * A single entry in the hash table
+ * A single slot in the hash table. Slots are stored inline in one
+ * array and collisions are resolved by linear probing. A slot is free
+ * if @name is NULL, and holds a removed entry if @name is
+ * VIR_HASH_DELETED; the latter keeps probe sequences intact until the
+ * table is rehashed.
  */
 typedef struct _virHashEntry virHashEntry;
 typedef virHashEntry *virHashEntryPtr;
 struct _virHashEntry {
-    struct _virHashEntry *next;
+    uint32_t code;
     void *name;
     void *payload;
 };
 
+static char virHashDeletedMarker;
+#define VIR_HASH_DELETED ((void *)&virHashDeletedMarker)
+
+#define VIR_HASH_ENTRY_USED(entry) \
+    ((entry)->name && (entry)->name != VIR_HASH_DELETED)
+
 /*
  * The entire hash table
  */
 struct _virHashTable {
-    virHashEntryPtr *table;
+    virHashEntryPtr table;
     uint32_t seed;
-    size_t size;
+    size_t size; /* always a power of two */
     size_t nbElems;
+    size_t nbDeleted;
     virHashDataFree dataFree;
     virHashKeyCode keyCode;
     virHashKeyEqual keyEqual;
@@ -68,14 +79,42 @@ struct _virHashAtomic {
     virHashTablePtr hash;
 };
 
+#define VIR_HASH_SHARDS 16
+
+/*
+ * A table of a sharded hash, with its own lock
+ */
+typedef struct _virHashShard virHashShard;
+typedef virHashShard *virHashShardPtr;
+struct _virHashShard {
+    virMutex lock;
+    virHashTablePtr hash;
+};
+
+/*
+ * A hash split into independently locked tables by key
+ */
+struct _virHashSharded {
+    virObject parent;
+    uint32_t seed;
+    size_t nshards;
+    virHashShard shards[VIR_HASH_SHARDS];
+};
+
 static virClassPtr virHashAtomicClass;
 static void virHashAtomicDispose(void *obj);
 
+static virClassPtr virHashShardedClass;
+static void virHashShardedDispose(void *obj);
+
 static int virHashAtomicOnceInit(void)
 {
     if (!VIR_CLASS_NEW(virHashAtomic, virClassForObjectLockable()))
         return -1;
 
+    if (!VIR_CLASS_NEW(virHashSharded, virClassForObject()))
+        return -1;
+
     return 0;
 }
 
@@ -119,10 +158,14 @@ virHashValueFree(void *value)
 
 
 static size_t
-virHashComputeKey(const virHashTable *table, const void *name)
+virHashRoundSize(size_t size)
 {
-    uint32_t value = table->keyCode(name, table->seed);
-    return value % table->size;
+    size_t ret = VIR_HASH_MIN_SIZE;
+
+    while (ret < size)
+        ret *= 2;
+
+    return ret;
 }
 
 /**
@@ -154,8 +197,9 @@ virHashTablePtr virHashCreateFull(ssize_t size,
     table = g_new0(virHashTable, 1);
 
     table->seed = virRandomBits(32);
-    table->size = size;
+    table->size = virHashRoundSize(size);
     table->nbElems = 0;
+    table->nbDeleted = 0;
     table->dataFree = dataFree;
     table->keyCode = keyCode;
     table->keyEqual = keyEqual;
@@ -163,7 +207,7 @@ virHashTablePtr virHashCreateFull(ssize_t size,
     table->keyPrint = keyPrint;
     table->keyFree = keyFree;
 
-    table->table = g_new0(virHashEntryPtr, table->size);
+    table->table = g_new0(virHashEntry, table->size);
 
     return table;
 }
@@ -241,68 +285,173 @@ virHashAtomicDispose(void *obj)
 
 
 /**
- * virHashGrow:
- * @table: the hash table
- * @size: the new size of the hash table
+ * virHashShardedNew:
+ * @size: the expected number of entries
+ * @dataFree: callback to free data
  *
- * resize the hash table
+ * Create a new hash with string keys that may be used by many threads
+ * at once. Unlike virHashAtomic, entries are spread over several
+ * tables, each with its own lock, so that operations on different
+ * keys rarely contend.
  *
- * Returns 0 in case of success, -1 in case of failure
+ * Returns the newly created object, or NULL on error.
  */
-static int
-virHashGrow(virHashTablePtr table, size_t size)
+virHashShardedPtr
+virHashShardedNew(ssize_t size,
+                  virHashDataFree dataFree)
 {
-    size_t oldsize, i;
-    virHashEntryPtr *oldtable;
+    virHashShardedPtr hash;
 
-#ifdef DEBUG_GROW
-    size_t nbElem = 0;
-#endif
+    if (virHashAtomicInitialize() < 0)
+        return NULL;
 
-    if (table == NULL)
-        return -1;
-    if (size < 8)
-        return -1;
-    if (size > 8 * 2048)
-        return -1;
+    if (!(hash = virObjectNew(virHashShardedClass)))
+        return NULL;
 
-    oldsize = table->size;
-    oldtable = table->table;
-    if (oldtable == NULL)
-        return -1;
+    hash->seed = virRandomBits(32);
 
-    if (VIR_ALLOC_N(table->table, size) < 0) {
-        table->table = oldtable;
-        return -1;
+    for (; hash->nshards < VIR_HASH_SHARDS; hash->nshards++) {
+        virHashShardPtr shard = &hash->shards[hash->nshards];
+
+        if (virMutexInit(&shard->lock) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("unable to init hash shard mutex"));
+            virObjectUnref(hash);
+            return NULL;
+        }
+
+        if (!(shard->hash = virHashCreate(size > 0 ? size / VIR_HASH_SHARDS + 1 : 0,
+                                          dataFree))) {
+            virMutexDestroy(&shard->lock);
+            virObjectUnref(hash);
+            return NULL;
+        }
     }
+
+    return hash;
+}
+
+
+static void
+virHashShardedDispose(void *obj)
+{
+    virHashShardedPtr hash = obj;
+    size_t i;
+
+    for (i = 0; i < hash->nshards; i++) {
+        virHashFree(hash->shards[i].hash);
+        virMutexDestroy(&hash->shards[i].lock);
+    }
+}
+
+
+/**
+ * virHashGrow:
+ * @table: the hash table
+ * @size: the new size of the hash table, a power of two
+ *
+ * Rehash all entries of the hash table into a new array of @size
+ * slots, dropping the markers of removed entries on the way.
+ */
+static void
+virHashGrow(virHashTablePtr table, size_t size)
+{
+    size_t oldsize = table->size;
+    virHashEntryPtr oldtable = table->table;
+    size_t i;
+
+    table->table = g_new0(virHashEntry, size);
     table->size = size;
+    table->nbDeleted = 0;
 
     for (i = 0; i < oldsize; i++) {
-        virHashEntryPtr iter = oldtable[i];
-        while (iter) {
-            virHashEntryPtr next = iter->next;
-            size_t key = virHashComputeKey(table, iter->name);
+        virHashEntryPtr old = &oldtable[i];
+        size_t key;
 
-            iter->next = table->table[key];
-            table->table[key] = iter;
+        if (!VIR_HASH_ENTRY_USED(old))
+            continue;
 
-#ifdef DEBUG_GROW
-            nbElem++;
-#endif
-            iter = next;
-        }
+        key = old->code & (size - 1);
+        while (table->table[key].name)
+            key = (key + 1) & (size - 1);
+
+        table->table[key] = *old;
     }
 
     VIR_FREE(oldtable);
 
 #ifdef DEBUG_GROW
-    VIR_DEBUG("virHashGrow : from %d to %d, %ld elems", oldsize,
-              size, nbElem);
+    VIR_DEBUG("virHashGrow : from %zu to %zu, %zu elems", oldsize,
+              size, table->nbElems);
 #endif
+}
 
-    return 0;
+
+/**
+ * virHashFindSlot:
+ * @table: the hash table
+ * @name: the key to look for
+ * @code: the hash code of @name
+ * @freeSlot: filled with the first slot @name may be inserted into
+ *
+ * Returns the slot holding @name or NULL if there is none.
+ */
+static virHashEntryPtr
+virHashFindSlot(const virHashTable *table,
+                const void *name,
+                uint32_t code,
+                virHashEntryPtr *freeSlot)
+{
+    size_t mask = table->size - 1;
+    size_t key = code & mask;
+    virHashEntryPtr deleted = NULL;
+
+    /* The table is never allowed to fill up, so there is always a free
+     * slot terminating the probe sequence. */
+    for (;; key = (key + 1) & mask) {
+        virHashEntryPtr entry = &table->table[key];
+
+        if (!entry->name) {
+            if (freeSlot)
+                *freeSlot = deleted ? deleted : entry;
+            return NULL;
+        }
+
+        if (entry->name == VIR_HASH_DELETED) {
+            if (!deleted)
+                deleted = entry;
+            continue;
+        }
+
+        if (entry->code == code && table->keyEqual(entry->name, name))
+            return entry;
+    }
 }
 
+
+/**
+ * virHashFreeSlot:
+ * @table: the hash table
+ * @entry: the slot to free
+ *
+ * Free the key and the userdata of @entry and mark it as removed.
+ */
+static void
+virHashFreeSlot(virHashTablePtr table,
+                virHashEntryPtr entry)
+{
+    if (table->dataFree)
+        table->dataFree(entry->payload);
+    if (table->keyFree)
+        table->keyFree(entry->name);
+
+    entry->name = VIR_HASH_DELETED;
+    entry->payload = NULL;
+    table->nbElems--;
+    table->nbDeleted++;
+}
+
+
 /**
  * virHashFree:
  * @table: the hash table
@@ -319,17 +468,15 @@ virHashFree(virHashTablePtr table)
         return;
 
     for (i = 0; i < table->size; i++) {
-        virHashEntryPtr iter = table->table[i];
-        while (iter) {
-            virHashEntryPtr next = iter->next;
+        virHashEntryPtr entry = &table->table[i];
 
-            if (table->dataFree)
-                table->dataFree(iter->payload);
-            if (table->keyFree)
-                table->keyFree(iter->name);
-            VIR_FREE(iter);
-            iter = next;
-        }
+        if (!VIR_HASH_ENTRY_USED(entry))
+            continue;
+
+        if (table->dataFree)
+            table->dataFree(entry->payload);
+        if (table->keyFree)
+            table->keyFree(entry->name);
     }
 
     VIR_FREE(table->table);
@@ -341,51 +488,55 @@ virHashAddOrUpdateEntry(virHashTablePtr table, const void *name,
                         void *userdata,
                         bool is_update)
 {
-    size_t key, len = 0;
     virHashEntryPtr entry;
-    virHashEntryPtr last = NULL;
+    virHashEntryPtr slot = NULL;
+    uint32_t code;
 
     if ((table == NULL) || (name == NULL))
         return -1;
 
-    key = virHashComputeKey(table, name);
+    code = table->keyCode(name, table->seed);
 
     /* Check for duplicate entry */
-    for (entry = table->table[key]; entry; entry = entry->next) {
-        if (table->keyEqual(entry->name, name)) {
-            if (is_update) {
-                if (table->dataFree)
-                    table->dataFree(entry->payload);
-                entry->payload = userdata;
-                return 0;
-            } else {
-                g_autofree char *keystr = NULL;
-
-                if (table->keyPrint)
-                    keystr = table->keyPrint(name);
-
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("Duplicate hash table key '%s'"), NULLSTR(keystr));
-                return -1;
-            }
+    if ((entry = virHashFindSlot(table, name, code, &slot))) {
+        if (is_update) {
+            if (table->dataFree)
+                table->dataFree(entry->payload);
+            entry->payload = userdata;
+            return 0;
+        } else {
+            g_autofree char *keystr = NULL;
+
+            if (table->keyPrint)
+                keystr = table->keyPrint(name);
+
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Duplicate hash table key '%s'"), NULLSTR(keystr));
+            return -1;
         }
-        last = entry;
-        len++;
     }
 
-    entry = g_new0(virHashEntry, 1);
-    entry->name = table->keyCopy(name);
-    entry->payload = userdata;
+    /* Keep at least a quarter of the slots free so that probe sequences
+     * stay short. Rehashing into the same size is enough if most of the
+     * used slots only hold markers of removed entries. */
+    if (slot->name != VIR_HASH_DELETED &&
+        (table->nbElems + table->nbDeleted + 1) * 4 > table->size * 3) {
+        if ((table->nbElems + 1) * 2 > table->size)
+            virHashGrow(table, table->size * 2);
+        else
+            virHashGrow(table, table->size);
+
+        virHashFindSlot(table, name, code, &slot);
+    }
 
-    if (last)
-        last->next = entry;
-    else
-        table->table[key] = entry;
+    if (slot->name == VIR_HASH_DELETED)
+        table->nbDeleted--;
 
-    table->nbElems++;
+    slot->code = code;
+    slot->name = table->keyCopy(name);
+    slot->payload = userdata;
 
-    if (len > MAX_HASH_LEN)
-        virHashGrow(table, MAX_HASH_LEN * table->size);
+    table->nbElems++;
 
     return 0;
 }
@@ -445,19 +596,11 @@ static virHashEntryPtr
 virHashGetEntry(const virHashTable *table,
                 const void *name)
 {
-    size_t key;
-    virHashEntryPtr entry;
-
     if (!table || !name)
         return NULL;
 
-    key = virHashComputeKey(table, name);
-    for (entry = table->table[key]; entry; entry = entry->next) {
-        if (table->keyEqual(entry->name, name))
-            return entry;
-    }
-
-    return NULL;
+    return virHashFindSlot(table, name,
+                           table->keyCode(name, table->seed), NULL);
 }
 
 
@@ -556,7 +699,7 @@ virHashSize(const virHashTable *table)
  * virHashTableSize:
  * @table: the hash table
  *
- * Query the size of the hash @table, i.e., number of buckets in the table.
+ * Query the size of the hash @table, i.e., number of slots in the table.
  *
  * Returns the number of keys in the hash table or
  * -1 in case of error
@@ -585,30 +728,14 @@ int
 virHashRemoveEntry(virHashTablePtr table, const void *name)
 {
     virHashEntryPtr entry;
-    virHashEntryPtr *nextptr;
 
-    if (table == NULL || name == NULL)
+    if (!(entry = virHashGetEntry(table, name)))
         return -1;
 
-    nextptr = table->table + virHashComputeKey(table, name);
-    for (entry = *nextptr; entry; entry = entry->next) {
-        if (table->keyEqual(entry->name, name)) {
-            if (table->dataFree)
-                table->dataFree(entry->payload);
-            if (table->keyFree)
-                table->keyFree(entry->name);
-            *nextptr = entry->next;
-            VIR_FREE(entry);
-            table->nbElems--;
-            return 0;
-        }
-        nextptr = &entry->next;
-    }
-
-    return -1;
+    virHashFreeSlot(table, entry);
+    return 0;
 }
 
-
 /**
  * virHashForEach
  * @table: the hash table to process
@@ -633,16 +760,17 @@ virHashForEach(virHashTablePtr table, virHashIterator iter, void *data)
         return -1;
 
     for (i = 0; i < table->size; i++) {
-        virHashEntryPtr entry = table->table[i];
-        while (entry) {
-            virHashEntryPtr next = entry->next;
-            ret = iter(entry->payload, entry->name, data);
+        virHashEntryPtr entry = &table->table[i];
 
-            if (ret < 0)
-                return ret;
+        if (!VIR_HASH_ENTRY_USED(entry))
+            continue;
 
-            entry = next;
-        }
+        /* Removing the current entry only marks its slot, so the
+         * iteration is not disturbed. */
+        ret = iter(entry->payload, entry->name, data);
+
+        if (ret < 0)
+            return ret;
     }
 
     return 0;
@@ -673,23 +801,20 @@ virHashRemoveSet(virHashTablePtr table,
         return -1;
 
     for (i = 0; i < table->size; i++) {
-        virHashEntryPtr *nextptr = table->table + i;
-
-        while (*nextptr) {
-            virHashEntryPtr entry = *nextptr;
-            if (!iter(entry->payload, entry->name, data)) {
-                nextptr = &entry->next;
-            } else {
-                count++;
-                if (table->dataFree)
-                    table->dataFree(entry->payload);
-                if (table->keyFree)
-                    table->keyFree(entry->name);
-                *nextptr = entry->next;
-                VIR_FREE(entry);
-                table->nbElems--;
-            }
-        }
+        virHashEntryPtr entry = &table->table[i];
+
+        if (!VIR_HASH_ENTRY_USED(entry) ||
+            !iter(entry->payload, entry->name, data))
+            continue;
+
+        count++;
+        virHashFreeSlot(table, entry);
+    }
+
+    /* Once the table is empty, all markers can be dropped at once */
+    if (table->nbElems == 0 && table->nbDeleted > 0) {
+        memset(table->table, 0, sizeof(*table->table) * table->size);
+        table->nbDeleted = 0;
     }
 
     return count;
@@ -747,13 +872,15 @@ void *virHashSearch(const virHashTable *ctable,
         return NULL;
 
     for (i = 0; i < table->size; i++) {
-        virHashEntryPtr entry;
-        for (entry = table->table[i]; entry; entry = entry->next) {
-            if (iter(entry->payload, entry->name, data)) {
-                if (name)
-                    *name = table->keyCopy(entry->name);
-                return entry->payload;
-            }
+        virHashEntryPtr entry = &table->table[i];
+
+        if (!VIR_HASH_ENTRY_USED(entry))
+            continue;
+
+        if (iter(entry->payload, entry->name, data)) {
+            if (name)
+                *name = table->keyCopy(entry->name);
+            return entry->payload;
         }
     }
 
@@ -849,3 +976,206 @@ bool virHashEqual(const virHashTable *table1,
 
     return data.equal;
 }
+
+
+static virHashShardPtr
+virHashShardedGetShard(virHashShardedPtr table,
+                       const void *name)
+{
+    return &table->shards[virHashStrCode(name, table->seed) % VIR_HASH_SHARDS];
+}
+
+
+/**
+ * virHashShardedLockKey:
+ * @table: the sharded hash
+ * @name: the key
+ *
+ * Locks the table holding @name and returns it, so that several
+ * operations on @name can be done atomically with the plain virHash
+ * functions. Entries other than @name must not be touched. The table
+ * must be released with virHashShardedUnlockKey.
+ *
+ * Returns the locked table @name belongs in.
+ */
+virHashTablePtr
+virHashShardedLockKey(virHashShardedPtr table,
+                      const void *name)
+{
+    virHashShardPtr shard = virHashShardedGetShard(table, name);
+
+    virMutexLock(&shard->lock);
+    return shard->hash;
+}
+
+
+/**
+ * virHashShardedUnlockKey:
+ * @table: the sharded hash
+ * @name: the key passed to virHashShardedLockKey
+ *
+ * Releases the table locked by virHashShardedLockKey.
+ */
+void
+virHashShardedUnlockKey(virHashShardedPtr table,
+                        const void *name)
+{
+    virMutexUnlock(&virHashShardedGetShard(table, name)->lock);
+}
+
+
+int
+virHashShardedAddEntry(virHashShardedPtr table,
+                       const void *name,
+                       void *userdata)
+{
+    virHashTablePtr hash = virHashShardedLockKey(table, name);
+    int ret;
+
+    ret = virHashAddOrUpdateEntry(hash, name, userdata, false);
+    virHashShardedUnlockKey(table, name);
+
+    return ret;
+}
+
+
+int
+virHashShardedUpdate(virHashShardedPtr table,
+                     const void *name,
+                     void *userdata)
+{
+    virHashTablePtr hash = virHashShardedLockKey(table, name);
+    int ret;
+
+    ret = virHashAddOrUpdateEntry(hash, name, userdata, true);
+    virHashShardedUnlockKey(table, name);
+
+    return ret;
+}
+
+
+int
+virHashShardedRemoveEntry(virHashShardedPtr table,
+                          const void *name)
+{
+    virHashTablePtr hash = virHashShardedLockKey(table, name);
+    int ret;
+
+    ret = virHashRemoveEntry(hash, name);
+    virHashShardedUnlockKey(table, name);
+
+    return ret;
+}
+
+
+void *
+virHashShardedSteal(virHashShardedPtr table,
+                    const void *name)
+{
+    virHashTablePtr hash = virHashShardedLockKey(table, name);
+    void *data;
+
+    data = virHashSteal(hash, name);
+    virHashShardedUnlockKey(table, name);
+
+    return data;
+}
+
+
+bool
+virHashShardedHasEntry(virHashShardedPtr table,
+                       const void *name)
+{
+    virHashTablePtr hash = virHashShardedLockKey(table, name);
+    bool ret;
+
+    ret = virHashHasEntry(hash, name);
+    virHashShardedUnlockKey(table, name);
+
+    return ret;
+}
+
+
+/**
+ * virHashShardedSize:
+ * @table: the sharded hash
+ *
+ * Returns the number of entries in @table. As the tables are counted
+ * one after another, the result is only accurate if @table isn't
+ * modified at the same time.
+ */
+ssize_t
+virHashShardedSize(virHashShardedPtr table)
+{
+    ssize_t count = 0;
+    size_t i;
+
+    for (i = 0; i < VIR_HASH_SHARDS; i++) {
+        virMutexLock(&table->shards[i].lock);
+        count += virHashSize(table->shards[i].hash);
+        virMutexUnlock(&table->shards[i].lock);
+    }
+
+    return count;
+}
+
+
+/**
+ * virHashShardedForEach:
+ * @table: the sharded hash
+ * @iter: callback to process each element
+ * @data: opaque data to pass to the iterator
+ *
+ * Iterates over every element of @table, holding only the lock of the
+ * table the element is in, so other threads can keep using the rest
+ * of @table meanwhile. Entries being added or removed concurrently
+ * may or may not be visited. The callback must not call any
+ * virHashSharded function on @table.
+ *
+ * Returns 0 on success or -1 if @iter stopped the iteration
+ */
+int
+virHashShardedForEach(virHashShardedPtr table,
+                      virHashIterator iter,
+                      void *data)
+{
+    size_t i;
+    int ret = 0;
+
+    for (i = 0; i < VIR_HASH_SHARDS && ret == 0; i++) {
+        virMutexLock(&table->shards[i].lock);
+        ret = virHashForEach(table->shards[i].hash, iter, data);
+        virMutexUnlock(&table->shards[i].lock);
+    }
+
+    return ret < 0 ? -1 : 0;
+}
+
+
+/**
+ * virHashShardedRemoveSet:
+ * @table: the sharded hash
+ * @iter: callback to identify elements for removal
+ * @data: opaque data to pass to the iterator
+ *
+ * Same as virHashRemoveSet, but holding only the lock of the table
+ * being processed, as described for virHashShardedForEach.
+ *
+ * Returns number of items removed
+ */
+ssize_t
+virHashShardedRemoveSet(virHashShardedPtr table,
+                        virHashSearcher iter,
+                        const void *data)
+{
+    ssize_t count = 0;
+    size_t i;
+
+    for (i = 0; i < VIR_HASH_SHARDS; i++) {
+        virMutexLock(&table->shards[i].lock);
+        count += virHashRemoveSet(table->shards[i].hash, iter, data);
+        virMutexUnlock(&table->shards[i].lock);
+    }
+
+    return count;
+}
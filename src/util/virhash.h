@@ -18,6 +18,9 @@ typedef virHashTable *virHashTablePtr;
 typedef struct _virHashAtomic virHashAtomic;
 typedef virHashAtomic *virHashAtomicPtr;
 
+typedef struct _virHashSharded virHashSharded;
+typedef virHashSharded *virHashShardedPtr;
+
 /*
  * function types:
  */
@@ -209,4 +212,33 @@ void *virHashSearch(const virHashTable *table, virHashSearcher iter,
 /* Convenience for when VIR_FREE(value) is sufficient as a data freer.  */
 void virHashValueFree(void *value);
 
+/*
+ * Hash with string keys split over several independently locked tables
+ */
+virHashShardedPtr virHashShardedNew(ssize_t size,
+                                    virHashDataFree dataFree);
+int virHashShardedAddEntry(virHashShardedPtr table,
+                           const void *name,
+                           void *userdata);
+int virHashShardedUpdate(virHashShardedPtr table,
+                         const void *name,
+                         void *userdata);
+int virHashShardedRemoveEntry(virHashShardedPtr table,
+                              const void *name);
+void *virHashShardedSteal(virHashShardedPtr table,
+                          const void *name);
+bool virHashShardedHasEntry(virHashShardedPtr table,
+                            const void *name);
+ssize_t virHashShardedSize(virHashShardedPtr table);
+int virHashShardedForEach(virHashShardedPtr table,
+                          virHashIterator iter,
+                          void *data);
+ssize_t virHashShardedRemoveSet(virHashShardedPtr table,
+                                virHashSearcher iter,
+                                const void *data);
+virHashTablePtr virHashShardedLockKey(virHashShardedPtr table,
+                                      const void *name);
+void virHashShardedUnlockKey(virHashShardedPtr table,
+                             const void *name);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virHashTable, virHashFree);
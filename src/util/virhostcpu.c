@@ -786,17 +786,90 @@ virHostCPUGetInfoPopulateLinux(FILE *cpuinfo,
 
 # define TICK_TO_NSEC (1000ull * 1000ull * 1000ull / sysconf(_SC_CLK_TCK))
 
-int
-virHostCPUGetStatsLinux(FILE *procstat,
-                        int cpuNum,
-                        virNodeCPUStatsPtr params,
-                        int *nparams)
+/* Parse a decimal number following optional spaces at @str and
+ * advance @str past it. */
+static int
+virHostCPUStatsParseNum(const char **str,
+                        unsigned long long *val)
 {
-    char line[1024];
-    unsigned long long usr, ni, sys, idle, iowait;
-    unsigned long long irq, softirq, steal, guest, guest_nice;
-    char cpu_header[4 + VIR_INT64_STR_BUFLEN];
+    const char *cur = *str;
+    unsigned long long ret = 0;
+
+    while (*cur == ' ')
+        cur++;
+
+    if (!g_ascii_isdigit(*cur))
+        return -1;
+
+    while (g_ascii_isdigit(*cur))
+        ret = ret * 10 + (*cur++ - '0');
+
+    *str = cur;
+    *val = ret;
+    return 0;
+}
+
+
+/* Parse one "cpu" or "cpuN" line of /proc/stat into @times. Returns 1 on
+ * success, 0 if @line doesn't hold CPU times. */
+static int
+virHostCPUStatsParseLine(const char *line,
+                         unsigned long long tick,
+                         virHostCPUTimePtr times)
+{
+    /* user nice system idle iowait irq softirq steal guest guest_nice */
+    unsigned long long val[10] = { 0 };
+    unsigned long long cpu;
+    size_t nval = 0;
+
+    if (!(line = STRSKIP(line, "cpu")))
+        return 0;
+
+    if (*line == ' ') {
+        times->cpu = VIR_NODE_CPU_STATS_ALL_CPUS;
+    } else {
+        if (virHostCPUStatsParseNum(&line, &cpu) < 0 ||
+            *line != ' ' || cpu > INT_MAX)
+            return 0;
+        times->cpu = cpu;
+    }
+
+    while (nval < G_N_ELEMENTS(val) &&
+           virHostCPUStatsParseNum(&line, &val[nval]) == 0)
+        nval++;
+
+    if (nval < 4)
+        return 0;
 
+    times->kernel = (val[2] + val[5] + val[6]) * tick;
+    times->user = (val[0] + val[1]) * tick;
+    times->idle = val[3] * tick;
+    times->iowait = val[4] * tick;
+    return 1;
+}
+
+
+static int
+virHostCPUTimeToParams(const virHostCPUTime *times,
+                       virNodeCPUStatsPtr params)
+{
+    if (virHostCPUStatsAssign(&params[0], VIR_NODE_CPU_STATS_KERNEL,
+                              times->kernel) < 0 ||
+        virHostCPUStatsAssign(&params[1], VIR_NODE_CPU_STATS_USER,
+                              times->user) < 0 ||
+        virHostCPUStatsAssign(&params[2], VIR_NODE_CPU_STATS_IDLE,
+                              times->idle) < 0 ||
+        virHostCPUStatsAssign(&params[3], VIR_NODE_CPU_STATS_IOWAIT,
+                              times->iowait) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+virHostCPUStatsCheckParams(int *nparams)
+{
     if ((*nparams) == 0) {
         /* Current number of cpu stats supported by linux */
         *nparams = LINUX_NB_CPU_STATS;
@@ -810,42 +883,28 @@ virHostCPUGetStatsLinux(FILE *procstat,
         return -1;
     }
 
-    if (cpuNum == VIR_NODE_CPU_STATS_ALL_CPUS) {
-        strcpy(cpu_header, "cpu ");
-    } else {
-        g_snprintf(cpu_header, sizeof(cpu_header), "cpu%d ", cpuNum);
-    }
-
-    while (fgets(line, sizeof(line), procstat) != NULL) {
-        char *buf = line;
-
-        if (STRPREFIX(buf, cpu_header)) { /* aka logical CPU time */
-            if (sscanf(buf,
-                       "%*s %llu %llu %llu %llu %llu" /* user ~ iowait */
-                       "%llu %llu %llu %llu %llu",    /* irq  ~ guest_nice */
-                       &usr, &ni, &sys, &idle, &iowait,
-                       &irq, &softirq, &steal, &guest, &guest_nice) < 4) {
-                continue;
-            }
-
-            if (virHostCPUStatsAssign(&params[0], VIR_NODE_CPU_STATS_KERNEL,
-                                      (sys + irq + softirq) * TICK_TO_NSEC) < 0)
-                return -1;
+    return 1;
+}
 
-            if (virHostCPUStatsAssign(&params[1], VIR_NODE_CPU_STATS_USER,
-                                      (usr + ni) * TICK_TO_NSEC) < 0)
-                return -1;
 
-            if (virHostCPUStatsAssign(&params[2], VIR_NODE_CPU_STATS_IDLE,
-                                      idle * TICK_TO_NSEC) < 0)
-                return -1;
+int
+virHostCPUGetStatsLinux(FILE *procstat,
+                        int cpuNum,
+                        virNodeCPUStatsPtr params,
+                        int *nparams)
+{
+    char line[1024];
+    unsigned long long tick = TICK_TO_NSEC;
+    virHostCPUTime times;
+    int rc;
 
-            if (virHostCPUStatsAssign(&params[3], VIR_NODE_CPU_STATS_IOWAIT,
-                                      iowait * TICK_TO_NSEC) < 0)
-                return -1;
+    if ((rc = virHostCPUStatsCheckParams(nparams)) <= 0)
+        return rc;
 
-            return 0;
-        }
+    while (fgets(line, sizeof(line), procstat) != NULL) {
+        if (virHostCPUStatsParseLine(line, tick, &times) == 1 &&
+            times.cpu == cpuNum)
+            return virHostCPUTimeToParams(&times, params);
     }
 
     virReportInvalidArg(cpuNum,
@@ -856,6 +915,70 @@ virHostCPUGetStatsLinux(FILE *procstat,
 }
 
 
+/**
+ * virHostCPUParseStatsLinux:
+ * @procstat: contents of /proc/stat
+ * @times: returns CPU times
+ * @ntimes: returns the count of items in @times
+ *
+ * Parse the CPU times of all host CPUs out of a single snapshot of
+ * /proc/stat. The totals come first, with @cpu set to
+ * VIR_NODE_CPU_STATS_ALL_CPUS, followed by the CPUs in the order the
+ * kernel lists them.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virHostCPUParseStatsLinux(const char *procstat,
+                          virHostCPUTimePtr *times,
+                          size_t *ntimes)
+{
+    g_autofree virHostCPUTimePtr ret = NULL;
+    size_t nret = 0;
+    size_t alloc = 0;
+    unsigned long long tick = TICK_TO_NSEC;
+    const char *line = procstat;
+
+    *times = NULL;
+    *ntimes = 0;
+
+    /* all CPU lines are at the top of the file */
+    while (line && STRPREFIX(line, "cpu")) {
+        if (VIR_RESIZE_N(ret, alloc, nret, 1) < 0)
+            return -1;
+
+        if (virHostCPUStatsParseLine(line, tick, &ret[nret]) == 1)
+            nret++;
+
+        if ((line = strchr(line, '\n')))
+            line++;
+    }
+
+    if (nret == 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("no CPU times found in " PROCSTAT_PATH));
+        return -1;
+    }
+
+    *times = g_steal_pointer(&ret);
+    *ntimes = nret;
+    return 0;
+}
+
+
+static int
+virHostCPUGetStatsAllLinux(virHostCPUTimePtr *times,
+                           size_t *ntimes)
+{
+    g_autofree char *procstat = NULL;
+
+    if (virFileReadAll(PROCSTAT_PATH, 16 * 1024 * 1024, &procstat) < 0)
+        return -1;
+
+    return virHostCPUParseStatsLinux(procstat, times, ntimes);
+}
+
+
 /* Determine the number of CPUs (maximum CPU id + 1) present in
  * the host. */
 static int
@@ -989,17 +1112,26 @@ virHostCPUGetStats(int cpuNum G_GNUC_UNUSED,
 
 #ifdef __linux__
     {
-        int ret;
-        FILE *procstat = fopen(PROCSTAT_PATH, "r");
-        if (!procstat) {
-            virReportSystemError(errno,
-                                 _("cannot open %s"), PROCSTAT_PATH);
+        g_autofree virHostCPUTimePtr times = NULL;
+        size_t ntimes = 0;
+        size_t i;
+        int rc;
+
+        if ((rc = virHostCPUStatsCheckParams(nparams)) <= 0)
+            return rc;
+
+        if (virHostCPUGetStatsAllLinux(&times, &ntimes) < 0)
             return -1;
+
+        for (i = 0; i < ntimes; i++) {
+            if (times[i].cpu == cpuNum)
+                return virHostCPUTimeToParams(&times[i], params);
         }
-        ret = virHostCPUGetStatsLinux(procstat, cpuNum, params, nparams);
-        VIR_FORCE_FCLOSE(procstat);
 
-        return ret;
+        virReportInvalidArg(cpuNum,
+                            _("Invalid cpuNum in %s"),
+                            __FUNCTION__);
+        return -1;
     }
 #elif defined(__FreeBSD__)
     return virHostCPUGetStatsFreeBSD(cpuNum, params, nparams);
@@ -1011,6 +1143,34 @@ virHostCPUGetStats(int cpuNum G_GNUC_UNUSED,
 }
 
 
+/**
+ * virHostCPUGetStatsAll:
+ * @times: returns CPU times
+ * @ntimes: returns the count of items in @times
+ *
+ * Get the CPU times of all host CPUs at once, which is cheaper than
+ * calling virHostCPUGetStats() for each of them. The totals come first,
+ * with @cpu set to VIR_NODE_CPU_STATS_ALL_CPUS.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virHostCPUGetStatsAll(virHostCPUTimePtr *times,
+                      size_t *ntimes)
+{
+    *times = NULL;
+    *ntimes = 0;
+
+#ifdef __linux__
+    return virHostCPUGetStatsAllLinux(times, ntimes);
+#else
+    virReportError(VIR_ERR_NO_SUPPORT, "%s",
+                   _("node CPU stats not implemented on this platform"));
+    return -1;
+#endif
+}
+
+
 int
 virHostCPUGetCount(void)
 {
@@ -35,10 +35,22 @@ struct _virHostCPUTscInfo {
 };
 
 
+typedef struct _virHostCPUTime virHostCPUTime;
+typedef virHostCPUTime *virHostCPUTimePtr;
+struct _virHostCPUTime {
+    int cpu;                    /* VIR_NODE_CPU_STATS_ALL_CPUS for totals */
+    unsigned long long kernel;  /* times in nanoseconds */
+    unsigned long long user;
+    unsigned long long idle;
+    unsigned long long iowait;
+};
+
 int virHostCPUGetStats(int cpuNum,
                        virNodeCPUStatsPtr params,
                        int *nparams,
                        unsigned int flags);
+int virHostCPUGetStatsAll(virHostCPUTimePtr *times,
+                          size_t *ntimes);
 
 bool virHostCPUHasBitmap(void);
 virBitmapPtr virHostCPUGetPresentBitmap(void);
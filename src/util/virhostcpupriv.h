@@ -41,6 +41,9 @@ int virHostCPUGetStatsLinux(FILE *procstat,
                             int cpuNum,
                             virNodeCPUStatsPtr params,
                             int *nparams);
+int virHostCPUParseStatsLinux(const char *procstat,
+                              virHostCPUTimePtr *times,
+                              size_t *ntimes);
 #endif
 
 int virHostCPUReadSignature(virArch arch,
@@ -31,6 +31,8 @@
 #include "virutil.h"
 #include "virbuffer.h"
 #include "virenum.h"
+#include "virhash.h"
+#include "virhashcode.h"
 
 #if WITH_YAJL
 # include <yajl/yajl_gen.h>
@@ -43,6 +45,14 @@
 
 VIR_LOG_INIT("util.json");
 
+/* Objects with at least this many members get a hash index of their keys
+ * built on first lookup, so that large QMP replies don't degrade every
+ * virJSONValueObjectGet* call into a linear scan.  */
+#define VIR_JSON_OBJECT_INDEX_THRESHOLD 32
+
+/* Minimum size of a memory chunk of a JSON document arena */
+#define VIR_JSON_ARENA_CHUNK_SIZE 4096
+
 typedef struct _virJSONObject virJSONObject;
 typedef virJSONObject *virJSONObjectPtr;
 
@@ -52,6 +62,12 @@ typedef virJSONObjectPair *virJSONObjectPairPtr;
 typedef struct _virJSONArray virJSONArray;
 typedef virJSONArray *virJSONArrayPtr;
 
+typedef struct _virJSONArenaChunk virJSONArenaChunk;
+typedef virJSONArenaChunk *virJSONArenaChunkPtr;
+
+typedef struct _virJSONArena virJSONArena;
+typedef virJSONArena *virJSONArenaPtr;
+
 
 struct _virJSONObjectPair {
     char *key;
@@ -61,6 +77,9 @@ struct _virJSONObjectPair {
 struct _virJSONObject {
     size_t npairs;
     virJSONObjectPairPtr pairs;
+    /* lazily built map of key -> (position in @pairs + 1); the keys are
+     * borrowed from @pairs. Dropped whenever positions shift. */
+    virHashTablePtr index;
 };
 
 struct _virJSONArray {
@@ -68,8 +87,37 @@ struct _virJSONArray {
     virJSONValuePtr *values;
 };
 
+struct _virJSONArenaChunk {
+    virJSONArenaChunkPtr next;
+    size_t size;
+    size_t used;
+    char *data;
+};
+
+/*
+ * A JSON document arena holds all values, keys and strings of a parsed
+ * document. The whole document is released at once when its root value
+ * is freed. Values which are stolen out of the document are copied to
+ * regular heap allocated values, so they may outlive the root.
+ */
+struct _virJSONArena {
+    virJSONValuePtr root;
+    virJSONArenaChunkPtr chunks; /* most recent chunk first */
+
+    /* objects and arrays whose members arrays need to be freed */
+    size_t ncontainers;
+    size_t ncontainers_max;
+    virJSONValuePtr *containers;
+
+    /* heap allocated values inserted into the document */
+    size_t nforeign;
+    size_t nforeign_max;
+    virJSONValuePtr *foreign;
+};
+
 struct _virJSONValue {
     int type; /* enum virJSONType */
+    virJSONArenaPtr arena; /* NULL for heap allocated values */
 
     union {
         virJSONObject object;
@@ -91,6 +139,7 @@ struct _virJSONParserState {
 typedef struct _virJSONParser virJSONParser;
 typedef virJSONParser *virJSONParserPtr;
 struct _virJSONParser {
+    virJSONArenaPtr arena;
     virJSONValuePtr head;
     virJSONParserStatePtr state;
     size_t nstate;
@@ -388,6 +437,319 @@ virJSONValueObjectCreate(virJSONValuePtr *obj, ...)
 }
 
 
+static uint32_t
+virJSONObjectIndexKeyCode(const void *name,
+                          uint32_t seed)
+{
+    return virHashCodeGen(name, strlen(name), seed);
+}
+
+
+static bool
+virJSONObjectIndexKeyEqual(const void *namea,
+                           const void *nameb)
+{
+    return STREQ(namea, nameb);
+}
+
+
+static void *
+virJSONObjectIndexKeyCopy(const void *name)
+{
+    /* keys are owned by the pairs array of the object */
+    return (void *)name;
+}
+
+
+static void
+virJSONObjectIndexClear(virJSONObjectPtr obj)
+{
+    virHashFree(obj->index);
+    obj->index = NULL;
+}
+
+
+static int
+virJSONObjectIndexAdd(virJSONObjectPtr obj,
+                      size_t pos)
+{
+    return virHashAddEntry(obj->index, obj->pairs[pos].key,
+                           GSIZE_TO_POINTER(pos + 1));
+}
+
+
+/**
+ * virJSONObjectIndexBuild:
+ * @obj: JSON object
+ *
+ * Build the key index of @obj if it is large enough to benefit from one
+ * and doesn't have it yet. Failure to build the index is not fatal since
+ * callers fall back to a linear scan.
+ */
+static void
+virJSONObjectIndexBuild(virJSONObjectPtr obj)
+{
+    size_t i;
+
+    if (obj->index || obj->npairs < VIR_JSON_OBJECT_INDEX_THRESHOLD)
+        return;
+
+    obj->index = virHashCreateFull(obj->npairs, NULL,
+                                   virJSONObjectIndexKeyCode,
+                                   virJSONObjectIndexKeyEqual,
+                                   virJSONObjectIndexKeyCopy,
+                                   NULL, NULL);
+
+    for (i = 0; i < obj->npairs; i++) {
+        if (virJSONObjectIndexAdd(obj, i) < 0) {
+            virJSONObjectIndexClear(obj);
+            return;
+        }
+    }
+}
+
+
+/**
+ * virJSONObjectFindPair:
+ * @obj: JSON object
+ * @key: key to look up
+ *
+ * Returns the position of @key in the pairs array of @obj or -1 if
+ * @obj doesn't contain @key.
+ */
+static ssize_t
+virJSONObjectFindPair(virJSONObjectPtr obj,
+                      const char *key)
+{
+    size_t i;
+
+    virJSONObjectIndexBuild(obj);
+
+    if (obj->index) {
+        void *pos = virHashLookup(obj->index, key);
+
+        if (!pos)
+            return -1;
+
+        return GPOINTER_TO_SIZE(pos) - 1;
+    }
+
+    for (i = 0; i < obj->npairs; i++) {
+        if (STREQ(obj->pairs[i].key, key))
+            return i;
+    }
+
+    return -1;
+}
+
+
+static void *
+virJSONArenaAlloc(virJSONArenaPtr arena,
+                  size_t size)
+{
+    virJSONArenaChunkPtr chunk = arena->chunks;
+    void *ret;
+
+    size = VIR_ROUND_UP(size, 2 * sizeof(void *));
+
+    if (!chunk || chunk->size - chunk->used < size) {
+        size_t chunksize = VIR_JSON_ARENA_CHUNK_SIZE;
+
+        if (chunk)
+            chunksize = chunk->size * 2;
+
+        chunk = g_new0(virJSONArenaChunk, 1);
+        chunk->size = MAX(chunksize, size);
+        chunk->data = g_malloc(chunk->size);
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    ret = chunk->data + chunk->used;
+    chunk->used += size;
+
+    return ret;
+}
+
+
+static char *
+virJSONArenaStrndup(virJSONArenaPtr arena,
+                    const char *str,
+                    size_t len)
+{
+    char *ret;
+
+    if (!arena)
+        return g_strndup(str, len);
+
+    ret = virJSONArenaAlloc(arena, len + 1);
+    memcpy(ret, str, len);
+    ret[len] = '\0';
+
+    return ret;
+}
+
+
+static void
+virJSONArenaFree(virJSONArenaPtr arena)
+{
+    virJSONArenaChunkPtr chunk;
+    size_t i;
+
+    if (!arena)
+        return;
+
+    for (i = 0; i < arena->ncontainers; i++) {
+        virJSONValuePtr value = arena->containers[i];
+
+        if (value->type == VIR_JSON_TYPE_OBJECT) {
+            g_free(value->data.object.pairs);
+            virHashFree(value->data.object.index);
+        } else {
+            g_free(value->data.array.values);
+        }
+    }
+    g_free(arena->containers);
+
+    for (i = 0; i < arena->nforeign; i++)
+        virJSONValueFree(arena->foreign[i]);
+    g_free(arena->foreign);
+
+    while ((chunk = arena->chunks)) {
+        arena->chunks = chunk->next;
+        g_free(chunk->data);
+        g_free(chunk);
+    }
+
+    g_free(arena);
+}
+
+
+/**
+ * virJSONValueIsOwned:
+ * @value: JSON value
+ *
+ * Returns true if freeing @value releases all memory held by it, i.e.
+ * @value is either allocated on the heap or is the root of an arena.
+ */
+static bool
+virJSONValueIsOwned(const virJSONValue *value)
+{
+    return !value->arena || value->arena->root == value;
+}
+
+
+/**
+ * virJSONValueForget:
+ * @container: JSON object or array
+ * @value: owned JSON value being removed from @container
+ *
+ * Stops tracking @value as a heap allocated member of the arena document
+ * @container belongs to, so that it's not freed along with the document.
+ */
+static void
+virJSONValueForget(virJSONValuePtr container,
+                   virJSONValuePtr value)
+{
+    virJSONArenaPtr arena = container->arena;
+    size_t i;
+
+    if (!arena)
+        return;
+
+    for (i = 0; i < arena->nforeign; i++) {
+        if (arena->foreign[i] == value) {
+            VIR_DELETE_ELEMENT_INPLACE(arena->foreign, i, arena->nforeign);
+            return;
+        }
+    }
+}
+
+
+/**
+ * virJSONValueDetach:
+ * @container: JSON object or array
+ * @value: JSON value removed from @container
+ *
+ * Values of an arena document can't outlive the document. If @value is
+ * such a value, return a heap allocated copy of it, otherwise return
+ * @value itself, which is now owned by the caller.
+ */
+static virJSONValuePtr
+virJSONValueDetach(virJSONValuePtr container,
+                   virJSONValuePtr value)
+{
+    if (!value)
+        return NULL;
+
+    if (!virJSONValueIsOwned(value))
+        return virJSONValueCopy(value);
+
+    virJSONValueForget(container, value);
+    return value;
+}
+
+
+/**
+ * virJSONValueAdopt:
+ * @container: JSON object or array @value is about to be inserted into
+ * @value: JSON value
+ *
+ * Makes sure that the lifetime of @value is tied to @container. Values
+ * which belong to a different arena are copied, heap allocated values
+ * inserted into an arena document are freed along with the document.
+ *
+ * Returns the value which should be stored into @container.
+ */
+static virJSONValuePtr
+virJSONValueAdopt(virJSONValuePtr container,
+                  virJSONValuePtr value)
+{
+    virJSONArenaPtr arena = container->arena;
+
+    if (value->arena == arena)
+        return value;
+
+    if (!virJSONValueIsOwned(value) &&
+        !(value = virJSONValueCopy(value)))
+        return NULL;
+
+    if (arena) {
+        VIR_RESIZE_N(arena->foreign, arena->nforeign_max, arena->nforeign, 1);
+        arena->foreign[arena->nforeign++] = value;
+    }
+
+    return value;
+}
+
+
+static virJSONValuePtr
+virJSONValueNewInternal(virJSONArenaPtr arena,
+                        virJSONType type)
+{
+    virJSONValuePtr val;
+
+    if (!arena) {
+        val = g_new0(virJSONValue, 1);
+        val->type = type;
+        return val;
+    }
+
+    val = virJSONArenaAlloc(arena, sizeof(*val));
+    memset(val, 0, sizeof(*val));
+    val->type = type;
+    val->arena = arena;
+
+    if (type == VIR_JSON_TYPE_OBJECT || type == VIR_JSON_TYPE_ARRAY) {
+        VIR_RESIZE_N(arena->containers, arena->ncontainers_max,
+                     arena->ncontainers, 1);
+        arena->containers[arena->ncontainers++] = val;
+    }
+
+    return val;
+}
+
+
 void
 virJSONValueFree(virJSONValuePtr value)
 {
@@ -395,6 +757,13 @@ virJSONValueFree(virJSONValuePtr value)
     if (!value)
         return;
 
+    /* members of an arena document are released along with its root */
+    if (value->arena) {
+        if (value->arena->root == value)
+            virJSONArenaFree(value->arena);
+        return;
+    }
+
     switch ((virJSONType) value->type) {
     case VIR_JSON_TYPE_OBJECT:
         for (i = 0; i < value->data.object.npairs; i++) {
@@ -402,6 +771,7 @@ virJSONValueFree(virJSONValuePtr value)
             virJSONValueFree(value->data.object.pairs[i].value);
         }
         VIR_FREE(value->data.object.pairs);
+        virJSONObjectIndexClear(&value->data.object);
         break;
     case VIR_JSON_TYPE_ARRAY:
         for (i = 0; i < value->data.array.nvalues; i++)
@@ -585,7 +955,7 @@ virJSONValueObjectInsert(virJSONValuePtr object,
                          virJSONValuePtr value,
                          bool prepend)
 {
-    virJSONObjectPair pair = { NULL, value };
+    virJSONObjectPair pair = { NULL, NULL };
     int ret = -1;
 
     if (object->type != VIR_JSON_TYPE_OBJECT) {
@@ -599,17 +969,28 @@ virJSONValueObjectInsert(virJSONValuePtr object,
         return -1;
     }
 
-    pair.key = g_strdup(key);
+    if (!(pair.value = virJSONValueAdopt(object, value)))
+        return -1;
+
+    pair.key = virJSONArenaStrndup(object->arena, key, strlen(key));
 
     if (prepend) {
+        /* all positions shift, the index will be rebuilt on next lookup */
+        virJSONObjectIndexClear(&object->data.object);
         ret = VIR_INSERT_ELEMENT(object->data.object.pairs, 0,
                                  object->data.object.npairs, pair);
     } else {
         ret = VIR_APPEND_ELEMENT(object->data.object.pairs,
                                  object->data.object.npairs, pair);
+
+        if (ret == 0 && object->data.object.index &&
+            virJSONObjectIndexAdd(&object->data.object,
+                                  object->data.object.npairs - 1) < 0)
+            virJSONObjectIndexClear(&object->data.object);
     }
 
-    VIR_FREE(pair.key);
+    if (!object->arena)
+        VIR_FREE(pair.key);
     return ret;
 }
 
@@ -795,6 +1176,9 @@ virJSONValueArrayAppend(virJSONValuePtr array,
         return -1;
     }
 
+    if (!(value = virJSONValueAdopt(array, value)))
+        return -1;
+
     if (VIR_REALLOC_N(array->data.array.values,
                       array->data.array.nvalues + 1) < 0)
         return -1;
@@ -843,8 +1227,15 @@ virJSONValueArrayConcat(virJSONValuePtr a,
     a->data.array.values = g_renew(virJSONValuePtr, a->data.array.values,
                                    a->data.array.nvalues + c->data.array.nvalues);
 
-    for (i = 0; i < c->data.array.nvalues; i++)
-        a->data.array.values[a->data.array.nvalues++] = g_steal_pointer(&c->data.array.values[i]);
+    for (i = 0; i < c->data.array.nvalues; i++) {
+        virJSONValuePtr value = g_steal_pointer(&c->data.array.values[i]);
+
+        if (!(value = virJSONValueDetach(c, value)) ||
+            !(value = virJSONValueAdopt(a, value)))
+            return -1;
+
+        a->data.array.values[a->data.array.nvalues++] = value;
+    }
 
     c->data.array.nvalues = 0;
 
@@ -856,17 +1247,13 @@ int
 virJSONValueObjectHasKey(virJSONValuePtr object,
                          const char *key)
 {
-    size_t i;
-
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return -1;
 
-    for (i = 0; i < object->data.object.npairs; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key))
-            return 1;
-    }
+    if (virJSONObjectFindPair(&object->data.object, key) < 0)
+        return 0;
 
-    return 0;
+    return 1;
 }
 
 
@@ -874,17 +1261,15 @@ virJSONValuePtr
 virJSONValueObjectGet(virJSONValuePtr object,
                       const char *key)
 {
-    size_t i;
+    ssize_t pos;
 
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return NULL;
 
-    for (i = 0; i < object->data.object.npairs; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key))
-            return object->data.object.pairs[i].value;
-    }
+    if ((pos = virJSONObjectFindPair(&object->data.object, key)) < 0)
+        return NULL;
 
-    return NULL;
+    return object->data.object.pairs[pos].value;
 }
 
 
@@ -892,23 +1277,23 @@ static virJSONValuePtr
 virJSONValueObjectSteal(virJSONValuePtr object,
                         const char *key)
 {
-    size_t i;
+    ssize_t pos;
     virJSONValuePtr obj = NULL;
 
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return NULL;
 
-    for (i = 0; i < object->data.object.npairs; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key)) {
-            obj = g_steal_pointer(&object->data.object.pairs[i].value);
-            VIR_FREE(object->data.object.pairs[i].key);
-            VIR_DELETE_ELEMENT(object->data.object.pairs, i,
-                               object->data.object.npairs);
-            break;
-        }
-    }
+    if ((pos = virJSONObjectFindPair(&object->data.object, key)) < 0)
+        return NULL;
+
+    obj = g_steal_pointer(&object->data.object.pairs[pos].value);
+    virJSONObjectIndexClear(&object->data.object);
+    if (!object->arena)
+        VIR_FREE(object->data.object.pairs[pos].key);
+    VIR_DELETE_ELEMENT(object->data.object.pairs, pos,
+                       object->data.object.npairs);
 
-    return obj;
+    return virJSONValueDetach(object, obj);
 }
 
 
@@ -974,7 +1359,7 @@ virJSONValueObjectRemoveKey(virJSONValuePtr object,
                             const char *key,
                             virJSONValuePtr *value)
 {
-    size_t i;
+    ssize_t pos;
 
     if (value)
         *value = NULL;
@@ -982,21 +1367,22 @@ virJSONValueObjectRemoveKey(virJSONValuePtr object,
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return -1;
 
-    for (i = 0; i < object->data.object.npairs; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key)) {
-            if (value) {
-                *value = object->data.object.pairs[i].value;
-                object->data.object.pairs[i].value = NULL;
-            }
-            VIR_FREE(object->data.object.pairs[i].key);
-            virJSONValueFree(object->data.object.pairs[i].value);
-            VIR_DELETE_ELEMENT(object->data.object.pairs, i,
-                               object->data.object.npairs);
-            return 1;
-        }
-    }
+    if ((pos = virJSONObjectFindPair(&object->data.object, key)) < 0)
+        return 0;
 
-    return 0;
+    if (value)
+        *value = virJSONValueDetach(object, object->data.object.pairs[pos].value);
+    else if (virJSONValueIsOwned(object->data.object.pairs[pos].value))
+        virJSONValueFree(virJSONValueDetach(object,
+                                            object->data.object.pairs[pos].value));
+    object->data.object.pairs[pos].value = NULL;
+
+    virJSONObjectIndexClear(&object->data.object);
+    if (!object->arena)
+        VIR_FREE(object->data.object.pairs[pos].key);
+    VIR_DELETE_ELEMENT(object->data.object.pairs, pos,
+                       object->data.object.npairs);
+    return 1;
 }
 
 
@@ -1070,7 +1456,7 @@ virJSONValueArraySteal(virJSONValuePtr array,
                        element,
                        array->data.array.nvalues);
 
-    return ret;
+    return virJSONValueDetach(array, ret);
 }
 
 
@@ -1106,13 +1492,28 @@ virJSONValueArrayForeachSteal(virJSONValuePtr array,
         return -1;
 
     for (i = 0; i < array->data.array.nvalues; i++) {
-        if ((rc = cb(i, array->data.array.values[i], opaque)) < 0) {
+        virJSONValuePtr elem = array->data.array.values[i];
+        virJSONValuePtr item = elem;
+
+        /* members of arena documents are handed out as copies */
+        if (!virJSONValueIsOwned(elem) &&
+            !(item = virJSONValueCopy(elem)))
+            return -1;
+
+        rc = cb(i, item, opaque);
+
+        if (rc == 0) {
+            array->data.array.values[i] = NULL;
+            if (item == elem)
+                virJSONValueForget(array, elem);
+        } else if (item != elem) {
+            virJSONValueFree(item);
+        }
+
+        if (rc < 0) {
             ret = -1;
             break;
         }
-
-        if (rc == 0)
-            array->data.array.values[i] = NULL;
     }
 
     /* condense the remaining entries at the beginning */
@@ -1564,6 +1965,17 @@ virJSONValueCopy(const virJSONValue *in)
 
 
 #if WITH_YAJL
+static void
+virJSONParserStateClearKey(virJSONParserPtr parser,
+                           virJSONParserStatePtr state)
+{
+    if (parser->arena)
+        state->key = NULL;
+    else
+        VIR_FREE(state->key);
+}
+
+
 static int
 virJSONParserInsertValue(virJSONParserPtr parser,
                          virJSONValuePtr value)
@@ -1591,7 +2003,7 @@ virJSONParserInsertValue(virJSONParserPtr parser,
                                          value) < 0)
                 return -1;
 
-            VIR_FREE(state->key);
+            virJSONParserStateClearKey(parser, state);
         }   break;
 
         case VIR_JSON_TYPE_ARRAY: {
@@ -1619,13 +2031,11 @@ static int
 virJSONParserHandleNull(void *ctx)
 {
     virJSONParserPtr parser = ctx;
-    virJSONValuePtr value = virJSONValueNewNull();
+    virJSONValuePtr value = virJSONValueNewInternal(parser->arena,
+                                                    VIR_JSON_TYPE_NULL);
 
     VIR_DEBUG("parser=%p", parser);
 
-    if (!value)
-        return 0;
-
     if (virJSONParserInsertValue(parser, value) < 0) {
         virJSONValueFree(value);
         return 0;
@@ -1640,12 +2050,12 @@ virJSONParserHandleBoolean(void *ctx,
                            int boolean_)
 {
     virJSONParserPtr parser = ctx;
-    virJSONValuePtr value = virJSONValueNewBoolean(boolean_);
+    virJSONValuePtr value = virJSONValueNewInternal(parser->arena,
+                                                    VIR_JSON_TYPE_BOOLEAN);
 
     VIR_DEBUG("parser=%p boolean=%d", parser, boolean_);
 
-    if (!value)
-        return 0;
+    value->data.boolean = boolean_;
 
     if (virJSONParserInsertValue(parser, value) < 0) {
         virJSONValueFree(value);
@@ -1662,17 +2072,12 @@ virJSONParserHandleNumber(void *ctx,
                           size_t l)
 {
     virJSONParserPtr parser = ctx;
-    char *str;
-    virJSONValuePtr value;
+    virJSONValuePtr value = virJSONValueNewInternal(parser->arena,
+                                                    VIR_JSON_TYPE_NUMBER);
 
-    str = g_strndup(s, l);
-    value = virJSONValueNewNumber(str);
-    VIR_FREE(str);
+    value->data.number = virJSONArenaStrndup(parser->arena, s, l);
 
-    VIR_DEBUG("parser=%p str=%s", parser, str);
-
-    if (!value)
-        return 0;
+    VIR_DEBUG("parser=%p str=%s", parser, value->data.number);
 
     if (virJSONParserInsertValue(parser, value) < 0) {
         virJSONValueFree(value);
@@ -1689,13 +2094,14 @@ virJSONParserHandleString(void *ctx,
                           size_t stringLen)
 {
     virJSONParserPtr parser = ctx;
-    virJSONValuePtr value = virJSONValueNewStringLen((const char *)stringVal,
-                                                     stringLen);
+    virJSONValuePtr value = virJSONValueNewInternal(parser->arena,
+                                                    VIR_JSON_TYPE_STRING);
 
     VIR_DEBUG("parser=%p str=%p", parser, (const char *)stringVal);
 
-    if (!value)
-        return 0;
+    value->data.string = virJSONArenaStrndup(parser->arena,
+                                             (const char *)stringVal,
+                                             stringLen);
 
     if (virJSONParserInsertValue(parser, value) < 0) {
         virJSONValueFree(value);
@@ -1722,7 +2128,8 @@ virJSONParserHandleMapKey(void *ctx,
     state = &parser->state[parser->nstate-1];
     if (state->key)
         return 0;
-    state->key = g_strndup((const char *)stringVal, stringLen);
+    state->key = virJSONArenaStrndup(parser->arena,
+                                     (const char *)stringVal, stringLen);
     return 1;
 }
 
@@ -1731,7 +2138,8 @@ static int
 virJSONParserHandleStartMap(void *ctx)
 {
     virJSONParserPtr parser = ctx;
-    virJSONValuePtr value = virJSONValueNewObject();
+    virJSONValuePtr value = virJSONValueNewInternal(parser->arena,
+                                                    VIR_JSON_TYPE_OBJECT);
 
     VIR_DEBUG("parser=%p", parser);
 
@@ -1766,7 +2174,7 @@ virJSONParserHandleEndMap(void *ctx)
 
     state = &(parser->state[parser->nstate-1]);
     if (state->key) {
-        VIR_FREE(state->key);
+        virJSONParserStateClearKey(parser, state);
         return 0;
     }
 
@@ -1780,7 +2188,8 @@ static int
 virJSONParserHandleStartArray(void *ctx)
 {
     virJSONParserPtr parser = ctx;
-    virJSONValuePtr value = virJSONValueNewArray();
+    virJSONValuePtr value = virJSONValueNewInternal(parser->arena,
+                                                    VIR_JSON_TYPE_ARRAY);
 
     VIR_DEBUG("parser=%p", parser);
 
@@ -1814,7 +2223,7 @@ virJSONParserHandleEndArray(void *ctx)
 
     state = &(parser->state[parser->nstate-1]);
     if (state->key) {
-        VIR_FREE(state->key);
+        virJSONParserStateClearKey(parser, state);
         return 0;
     }
 
@@ -1840,21 +2249,26 @@ static const yajl_callbacks parserCallbacks = {
 
 
 /* XXX add an incremental streaming parser - yajl trivially supports it */
-virJSONValuePtr
-virJSONValueFromString(const char *jsonstring)
+static virJSONValuePtr
+virJSONValueFromStringInternal(const char *jsonstring,
+                               bool arena)
 {
     yajl_handle hand;
-    virJSONParser parser = { NULL, NULL, 0, 0 };
+    virJSONParser parser = { NULL, NULL, NULL, 0, 0 };
     virJSONValuePtr ret = NULL;
     int rc;
     size_t len = strlen(jsonstring);
 
     VIR_DEBUG("string=%s", jsonstring);
 
+    if (arena)
+        parser.arena = g_new0(virJSONArena, 1);
+
     hand = yajl_alloc(&parserCallbacks, NULL, &parser);
     if (!hand) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                        _("Unable to create JSON parser"));
+        virJSONArenaFree(parser.arena);
         return NULL;
     }
 
@@ -1889,23 +2303,574 @@ virJSONValueFromString(const char *jsonstring)
     if (parser.nstate) {
         size_t i;
         for (i = 0; i < parser.nstate; i++)
-            VIR_FREE(parser.state[i].key);
+            virJSONParserStateClearKey(&parser, &parser.state[i]);
         VIR_FREE(parser.state);
     }
 
+    if (parser.arena) {
+        if (ret)
+            parser.arena->root = ret;
+        else
+            virJSONArenaFree(parser.arena);
+    }
+
     VIR_DEBUG("result=%p", ret);
 
     return ret;
 }
 
 
-static int
-virJSONValueToStringOne(virJSONValuePtr object,
-                        yajl_gen g)
+virJSONValuePtr
+virJSONValueFromString(const char *jsonstring)
 {
-    size_t i;
+    return virJSONValueFromStringInternal(jsonstring, false);
+}
 
-    VIR_DEBUG("object=%p type=%d gen=%p", object, object->type, g);
+
+/**
+ * virJSONValueFromStringArena:
+ * @jsonstring: JSON document
+ *
+ * Parses @jsonstring similarly to virJSONValueFromString, but all values,
+ * keys and strings of the document are allocated from a single arena which
+ * is released at once when the returned value is freed. This avoids
+ * allocator traffic for large, short lived documents such as replies from
+ * the QEMU monitor.
+ *
+ * Values obtained from the document without removing them are valid only
+ * as long as the document. Values removed from the document (e.g. by
+ * virJSONValueObjectRemoveKey or virJSONValueObjectStealArray) are copied
+ * into regular heap allocated values, which can outlive the document.
+ * virJSONValueCopy can be used to the same effect for other values.
+ *
+ * Returns the root of the document or NULL on error.
+ */
+virJSONValuePtr
+virJSONValueFromStringArena(const char *jsonstring)
+{
+    return virJSONValueFromStringInternal(jsonstring, true);
+}
+
+
+struct _virJSONStreamParser {
+    yajl_handle handle;
+    virJSONStreamParserCallback cb;
+    void *opaque;
+
+    size_t depth; /* number of containers enclosing the current value */
+    char *key; /* member name of the next value, if it is a member */
+
+    size_t skip; /* number of open containers being skipped */
+
+    /* state of the DOM builder used for capturing values */
+    virJSONParser capture;
+    size_t captureDepth;
+    char *captureKey;
+    bool capturing;
+
+    bool failed; /* the callback requested termination */
+};
+
+
+static int
+virJSONStreamParserEmit(virJSONStreamParserPtr parser,
+                        virJSONStreamEvent event,
+                        const char *key,
+                        const char *str,
+                        size_t len)
+{
+    int rc = parser->cb(parser, event, key, str, len, parser->opaque);
+
+    if (rc < 0)
+        parser->failed = true;
+
+    return rc;
+}
+
+
+static int
+virJSONStreamParserFinishCapture(virJSONStreamParserPtr parser)
+{
+    g_autofree char *key = g_steal_pointer(&parser->captureKey);
+    int rc;
+
+    parser->capturing = false;
+
+    rc = virJSONStreamParserEmit(parser, VIR_JSON_STREAM_EVENT_VALUE,
+                                 key, NULL, 0);
+
+    /* free the value if the callback didn't claim it */
+    virJSONValueFree(g_steal_pointer(&parser->capture.head));
+
+    return rc < 0 ? 0 : 1;
+}
+
+
+/*
+ * Common handling of all scalar values: @handler is the DOM builder
+ * callback used in case the value is captured.
+ */
+static int
+virJSONStreamParserScalar(virJSONStreamParserPtr parser,
+                          virJSONStreamEvent event,
+                          const char *str,
+                          size_t len,
+                          int (*handler)(virJSONParserPtr parser,
+                                         const char *str,
+                                         size_t len))
+{
+    g_autofree char *key = NULL;
+    int rc;
+
+    if (parser->skip)
+        return 1;
+
+    if (parser->capturing)
+        return handler(&parser->capture, str, len);
+
+    key = g_steal_pointer(&parser->key);
+
+    if ((rc = virJSONStreamParserEmit(parser, event, key, str, len)) < 0)
+        return 0;
+
+    if (rc == VIR_JSON_STREAM_CAPTURE) {
+        memset(&parser->capture, 0, sizeof(parser->capture));
+        parser->capturing = true;
+        parser->captureKey = g_steal_pointer(&key);
+
+        if (handler(&parser->capture, str, len) == 0)
+            return 0;
+
+        return virJSONStreamParserFinishCapture(parser);
+    }
+
+    return 1;
+}
+
+
+static int
+virJSONStreamParserCaptureNull(virJSONParserPtr parser,
+                               const char *str G_GNUC_UNUSED,
+                               size_t len G_GNUC_UNUSED)
+{
+    return virJSONParserHandleNull(parser);
+}
+
+
+static int
+virJSONStreamParserCaptureBoolean(virJSONParserPtr parser,
+                                  const char *str,
+                                  size_t len G_GNUC_UNUSED)
+{
+    return virJSONParserHandleBoolean(parser, STREQ(str, "true"));
+}
+
+
+static int
+virJSONStreamParserCaptureNumber(virJSONParserPtr parser,
+                                 const char *str,
+                                 size_t len)
+{
+    return virJSONParserHandleNumber(parser, str, len);
+}
+
+
+static int
+virJSONStreamParserCaptureString(virJSONParserPtr parser,
+                                 const char *str,
+                                 size_t len)
+{
+    return virJSONParserHandleString(parser, (const unsigned char *)str, len);
+}
+
+
+static int
+virJSONStreamParserHandleNull(void *ctx)
+{
+    return virJSONStreamParserScalar(ctx, VIR_JSON_STREAM_EVENT_NULL,
+                                     "null", 4,
+                                     virJSONStreamParserCaptureNull);
+}
+
+
+static int
+virJSONStreamParserHandleBoolean(void *ctx,
+                                 int boolean_)
+{
+    const char *str = boolean_ ? "true" : "false";
+
+    return virJSONStreamParserScalar(ctx, VIR_JSON_STREAM_EVENT_BOOLEAN,
+                                     str, strlen(str),
+                                     virJSONStreamParserCaptureBoolean);
+}
+
+
+static int
+virJSONStreamParserHandleNumber(void *ctx,
+                                const char *s,
+                                size_t l)
+{
+    return virJSONStreamParserScalar(ctx, VIR_JSON_STREAM_EVENT_NUMBER,
+                                     s, l,
+                                     virJSONStreamParserCaptureNumber);
+}
+
+
+static int
+virJSONStreamParserHandleString(void *ctx,
+                                const unsigned char *stringVal,
+                                size_t stringLen)
+{
+    return virJSONStreamParserScalar(ctx, VIR_JSON_STREAM_EVENT_STRING,
+                                     (const char *)stringVal, stringLen,
+                                     virJSONStreamParserCaptureString);
+}
+
+
+static int
+virJSONStreamParserHandleMapKey(void *ctx,
+                                const unsigned char *stringVal,
+                                size_t stringLen)
+{
+    virJSONStreamParserPtr parser = ctx;
+
+    if (parser->skip)
+        return 1;
+
+    if (parser->capturing)
+        return virJSONParserHandleMapKey(&parser->capture, stringVal, stringLen);
+
+    g_free(parser->key);
+    parser->key = g_strndup((const char *)stringVal, stringLen);
+    return 1;
+}
+
+
+static int
+virJSONStreamParserHandleStart(virJSONStreamParserPtr parser,
+                               virJSONStreamEvent event)
+{
+    g_autofree char *key = NULL;
+    int rc;
+
+    if (parser->skip) {
+        parser->skip++;
+        return 1;
+    }
+
+    if (parser->capturing) {
+        parser->captureDepth++;
+
+        if (event == VIR_JSON_STREAM_EVENT_OBJECT_START)
+            return virJSONParserHandleStartMap(&parser->capture);
+        else
+            return virJSONParserHandleStartArray(&parser->capture);
+    }
+
+    key = g_steal_pointer(&parser->key);
+
+    if ((rc = virJSONStreamParserEmit(parser, event, key, NULL, 0)) < 0)
+        return 0;
+
+    switch ((virJSONStreamAction) rc) {
+    case VIR_JSON_STREAM_SKIP:
+        parser->skip = 1;
+        break;
+
+    case VIR_JSON_STREAM_CAPTURE:
+        memset(&parser->capture, 0, sizeof(parser->capture));
+        parser->capturing = true;
+        parser->captureDepth = 1;
+        parser->captureKey = g_steal_pointer(&key);
+
+        if (event == VIR_JSON_STREAM_EVENT_OBJECT_START)
+            return virJSONParserHandleStartMap(&parser->capture);
+        else
+            return virJSONParserHandleStartArray(&parser->capture);
+
+    case VIR_JSON_STREAM_CONTINUE:
+        parser->depth++;
+        break;
+    }
+
+    return 1;
+}
+
+
+static int
+virJSONStreamParserHandleEnd(virJSONStreamParserPtr parser,
+                             virJSONStreamEvent event)
+{
+    if (parser->skip) {
+        parser->skip--;
+        return 1;
+    }
+
+    if (parser->capturing) {
+        int rc;
+
+        if (event == VIR_JSON_STREAM_EVENT_OBJECT_END)
+            rc = virJSONParserHandleEndMap(&parser->capture);
+        else
+            rc = virJSONParserHandleEndArray(&parser->capture);
+
+        if (rc == 0)
+            return 0;
+
+        if (--parser->captureDepth > 0)
+            return 1;
+
+        return virJSONStreamParserFinishCapture(parser);
+    }
+
+    if (parser->depth == 0)
+        return 0;
+
+    parser->depth--;
+
+    if (virJSONStreamParserEmit(parser, event, NULL, NULL, 0) < 0)
+        return 0;
+
+    return 1;
+}
+
+
+static int
+virJSONStreamParserHandleStartMap(void *ctx)
+{
+    return virJSONStreamParserHandleStart(ctx,
+                                          VIR_JSON_STREAM_EVENT_OBJECT_START);
+}
+
+
+static int
+virJSONStreamParserHandleEndMap(void *ctx)
+{
+    return virJSONStreamParserHandleEnd(ctx, VIR_JSON_STREAM_EVENT_OBJECT_END);
+}
+
+
+static int
+virJSONStreamParserHandleStartArray(void *ctx)
+{
+    return virJSONStreamParserHandleStart(ctx,
+                                          VIR_JSON_STREAM_EVENT_ARRAY_START);
+}
+
+
+static int
+virJSONStreamParserHandleEndArray(void *ctx)
+{
+    return virJSONStreamParserHandleEnd(ctx, VIR_JSON_STREAM_EVENT_ARRAY_END);
+}
+
+
+static const yajl_callbacks streamParserCallbacks = {
+    virJSONStreamParserHandleNull,
+    virJSONStreamParserHandleBoolean,
+    NULL,
+    NULL,
+    virJSONStreamParserHandleNumber,
+    virJSONStreamParserHandleString,
+    virJSONStreamParserHandleStartMap,
+    virJSONStreamParserHandleMapKey,
+    virJSONStreamParserHandleEndMap,
+    virJSONStreamParserHandleStartArray,
+    virJSONStreamParserHandleEndArray
+};
+
+
+/**
+ * virJSONStreamParserNew:
+ * @cb: callback invoked for every parsed token
+ * @opaque: data passed to @cb
+ *
+ * Creates an incremental event based JSON parser. Instead of building
+ * the whole document in memory @cb is invoked for every value of the
+ * document as it is parsed. The return value of @cb on the start of an
+ * object or array and on scalar values controls further processing:
+ *
+ *  VIR_JSON_STREAM_CONTINUE: report contents of the container one by one
+ *  VIR_JSON_STREAM_SKIP: ignore the whole container
+ *  VIR_JSON_STREAM_CAPTURE: build the value as a virJSONValue and report it
+ *                           via a VIR_JSON_STREAM_EVENT_VALUE event, where it
+ *                           can be claimed by virJSONStreamParserStealValue
+ *
+ * A negative return value from @cb terminates parsing; @cb is expected to
+ * report an error in such case.
+ *
+ * Returns the parser which must be freed by virJSONStreamParserFree.
+ */
+virJSONStreamParserPtr
+virJSONStreamParserNew(virJSONStreamParserCallback cb,
+                       void *opaque)
+{
+    g_autoptr(virJSONStreamParser) parser = g_new0(virJSONStreamParser, 1);
+
+    parser->cb = cb;
+    parser->opaque = opaque;
+
+    if (!(parser->handle = yajl_alloc(&streamParserCallbacks, NULL, parser))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to create JSON parser"));
+        return NULL;
+    }
+
+    return g_steal_pointer(&parser);
+}
+
+
+static int
+virJSONStreamParserCheck(virJSONStreamParserPtr parser,
+                         int rc,
+                         const char *data,
+                         size_t len)
+{
+    unsigned char *errstr;
+
+    if (rc == yajl_status_ok)
+        return 0;
+
+    /* the callback is responsible for reporting its own errors */
+    if (parser->failed)
+        return -1;
+
+    errstr = yajl_get_error(parser->handle, 1,
+                            (const unsigned char *)data, len);
+    virReportError(VIR_ERR_INTERNAL_ERROR,
+                   _("cannot parse json: %s"), (const char *)errstr);
+    yajl_free_error(parser->handle, errstr);
+    return -1;
+}
+
+
+/**
+ * virJSONStreamParserFeed:
+ * @parser: stream parser
+ * @data: chunk of the JSON document
+ * @len: length of @data
+ *
+ * Parses the next chunk of the document. The document may be split at any
+ * point.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virJSONStreamParserFeed(virJSONStreamParserPtr parser,
+                        const char *data,
+                        size_t len)
+{
+    int rc = yajl_parse(parser->handle, (const unsigned char *)data, len);
+
+    return virJSONStreamParserCheck(parser, rc, data, len);
+}
+
+
+/**
+ * virJSONStreamParserFinish:
+ * @parser: stream parser
+ *
+ * Signals the end of the document and checks that it was complete.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virJSONStreamParserFinish(virJSONStreamParserPtr parser)
+{
+    int rc = yajl_complete_parse(parser->handle);
+
+    return virJSONStreamParserCheck(parser, rc, NULL, 0);
+}
+
+
+/**
+ * virJSONStreamParserGetDepth:
+ * @parser: stream parser
+ *
+ * Returns the number of objects and arrays enclosing the value being
+ * reported by the current event. The top level value has depth 0.
+ */
+size_t
+virJSONStreamParserGetDepth(virJSONStreamParserPtr parser)
+{
+    return parser->depth;
+}
+
+
+/**
+ * virJSONStreamParserStealValue:
+ * @parser: stream parser
+ *
+ * Claims the value reported by the VIR_JSON_STREAM_EVENT_VALUE event. It's
+ * allowed to call this only from the callback handling such an event.
+ *
+ * Returns the captured value which is owned by the caller.
+ */
+virJSONValuePtr
+virJSONStreamParserStealValue(virJSONStreamParserPtr parser)
+{
+    return g_steal_pointer(&parser->capture.head);
+}
+
+
+void
+virJSONStreamParserFree(virJSONStreamParserPtr parser)
+{
+    size_t i;
+
+    if (!parser)
+        return;
+
+    if (parser->handle)
+        yajl_free(parser->handle);
+
+    for (i = 0; i < parser->capture.nstate; i++)
+        g_free(parser->capture.state[i].key);
+    g_free(parser->capture.state);
+    virJSONValueFree(parser->capture.head);
+
+    g_free(parser->captureKey);
+    g_free(parser->key);
+    g_free(parser);
+}
+
+
+/**
+ * virJSONStreamParse:
+ * @jsonstring: JSON document
+ * @cb: callback invoked for every parsed token
+ * @opaque: data passed to @cb
+ *
+ * Convenience wrapper parsing the whole @jsonstring by a stream parser.
+ * See virJSONStreamParserNew.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virJSONStreamParse(const char *jsonstring,
+                   virJSONStreamParserCallback cb,
+                   void *opaque)
+{
+    g_autoptr(virJSONStreamParser) parser = NULL;
+
+    if (!(parser = virJSONStreamParserNew(cb, opaque)))
+        return -1;
+
+    if (virJSONStreamParserFeed(parser, jsonstring, strlen(jsonstring)) < 0 ||
+        virJSONStreamParserFinish(parser) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+virJSONValueToStringOne(virJSONValuePtr object,
+                        yajl_gen g)
+{
+    size_t i;
+
+    VIR_DEBUG("object=%p type=%d gen=%p", object, object->type, g);
 
     switch (object->type) {
     case VIR_JSON_TYPE_OBJECT:
@@ -2007,6 +2972,73 @@ virJSONValueToBuffer(virJSONValuePtr object,
 
 
 #else
+struct _virJSONStreamParser {
+    int dummy;
+};
+
+
+virJSONStreamParserPtr
+virJSONStreamParserNew(virJSONStreamParserCallback cb G_GNUC_UNUSED,
+                       void *opaque G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return NULL;
+}
+
+
+int
+virJSONStreamParserFeed(virJSONStreamParserPtr parser G_GNUC_UNUSED,
+                        const char *data G_GNUC_UNUSED,
+                        size_t len G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return -1;
+}
+
+
+int
+virJSONStreamParserFinish(virJSONStreamParserPtr parser G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return -1;
+}
+
+
+size_t
+virJSONStreamParserGetDepth(virJSONStreamParserPtr parser G_GNUC_UNUSED)
+{
+    return 0;
+}
+
+
+virJSONValuePtr
+virJSONStreamParserStealValue(virJSONStreamParserPtr parser G_GNUC_UNUSED)
+{
+    return NULL;
+}
+
+
+void
+virJSONStreamParserFree(virJSONStreamParserPtr parser)
+{
+    g_free(parser);
+}
+
+
+int
+virJSONStreamParse(const char *jsonstring G_GNUC_UNUSED,
+                   virJSONStreamParserCallback cb G_GNUC_UNUSED,
+                   void *opaque G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return -1;
+}
+
+
 virJSONValuePtr
 virJSONValueFromString(const char *jsonstring G_GNUC_UNUSED)
 {
@@ -2016,6 +3048,15 @@ virJSONValueFromString(const char *jsonstring G_GNUC_UNUSED)
 }
 
 
+virJSONValuePtr
+virJSONValueFromStringArena(const char *jsonstring G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("No JSON parser implementation is available"));
+    return NULL;
+}
+
+
 int
 virJSONValueToBuffer(virJSONValuePtr object G_GNUC_UNUSED,
                      virBufferPtr buf G_GNUC_UNUSED,
@@ -2162,7 +3203,8 @@ virJSONValueObjectDeflattenArrays(virJSONValuePtr json)
     size_t i;
 
     if (!json ||
-        json->type != VIR_JSON_TYPE_OBJECT)
+        json->type != VIR_JSON_TYPE_OBJECT ||
+        json->arena)
         return;
 
     obj = &json->data.object;
@@ -2188,6 +3230,8 @@ virJSONValueObjectDeflattenArrays(virJSONValuePtr json)
         arraymembers[keynum] = pair->value;
     }
 
+    virJSONObjectIndexClear(obj);
+
     for (i = 0; i < obj->npairs; i++)
         g_free(obj->pairs[i].key);
 
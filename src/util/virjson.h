@@ -145,6 +145,55 @@ int virJSONValueObjectRemoveKey(virJSONValuePtr object, const char *key,
 int virJSONValueArrayAppendString(virJSONValuePtr object, const char *value);
 
 virJSONValuePtr virJSONValueFromString(const char *jsonstring);
+virJSONValuePtr virJSONValueFromStringArena(const char *jsonstring);
+
+typedef enum {
+    VIR_JSON_STREAM_EVENT_NULL,
+    VIR_JSON_STREAM_EVENT_BOOLEAN,
+    VIR_JSON_STREAM_EVENT_NUMBER,
+    VIR_JSON_STREAM_EVENT_STRING,
+    VIR_JSON_STREAM_EVENT_OBJECT_START,
+    VIR_JSON_STREAM_EVENT_OBJECT_END,
+    VIR_JSON_STREAM_EVENT_ARRAY_START,
+    VIR_JSON_STREAM_EVENT_ARRAY_END,
+    VIR_JSON_STREAM_EVENT_VALUE, /* a captured value is available */
+} virJSONStreamEvent;
+
+typedef enum {
+    VIR_JSON_STREAM_CONTINUE = 0,
+    VIR_JSON_STREAM_SKIP,
+    VIR_JSON_STREAM_CAPTURE,
+} virJSONStreamAction;
+
+typedef struct _virJSONStreamParser virJSONStreamParser;
+typedef virJSONStreamParser *virJSONStreamParserPtr;
+
+/*
+ * @key is the member name if the value is a member of an object or NULL.
+ * For scalar values @str and @len contain the unescaped string, the
+ * number or "true"/"false"/"null". Returns one of virJSONStreamAction
+ * or -1 on error.
+ */
+typedef int (*virJSONStreamParserCallback)(virJSONStreamParserPtr parser,
+                                           virJSONStreamEvent event,
+                                           const char *key,
+                                           const char *str,
+                                           size_t len,
+                                           void *opaque);
+
+virJSONStreamParserPtr virJSONStreamParserNew(virJSONStreamParserCallback cb,
+                                              void *opaque);
+int virJSONStreamParserFeed(virJSONStreamParserPtr parser,
+                            const char *data,
+                            size_t len);
+int virJSONStreamParserFinish(virJSONStreamParserPtr parser);
+size_t virJSONStreamParserGetDepth(virJSONStreamParserPtr parser);
+virJSONValuePtr virJSONStreamParserStealValue(virJSONStreamParserPtr parser);
+void virJSONStreamParserFree(virJSONStreamParserPtr parser);
+int virJSONStreamParse(const char *jsonstring,
+                       virJSONStreamParserCallback cb,
+                       void *opaque);
+
 char *virJSONValueToString(virJSONValuePtr object,
                            bool pretty);
 int virJSONValueToBuffer(virJSONValuePtr object,
@@ -167,3 +216,4 @@ char *virJSONStringReformat(const char *jsonstr, bool pretty);
 virJSONValuePtr virJSONValueObjectDeflatten(virJSONValuePtr json);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virJSONValue, virJSONValueFree);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virJSONStreamParser, virJSONStreamParserFree);
@@ -41,6 +41,11 @@ VIR_LOG_INIT("util.lockspace");
 
 #define VIR_LOCKSPACE_TABLE_SIZE 10
 
+/* Resources are spread over several tables with locks of their own, so
+ * that acquiring a resource, which may wait for slow shared storage,
+ * doesn't serialize all the other operations of the lockspace */
+#define VIR_LOCKSPACE_SHARDS 16
+
 typedef struct _virLockSpaceResource virLockSpaceResource;
 typedef virLockSpaceResource *virLockSpaceResourcePtr;
 
@@ -54,11 +59,18 @@ struct _virLockSpaceResource {
     pid_t *owners;
 };
 
+typedef struct _virLockSpaceShard virLockSpaceShard;
+typedef virLockSpaceShard *virLockSpaceShardPtr;
+
+struct _virLockSpaceShard {
+    virMutex lock;
+    virHashTablePtr resources;
+};
+
 struct _virLockSpace {
     char *dir;
-    virMutex lock;
 
-    virHashTablePtr resources;
+    virLockSpaceShard shards[VIR_LOCKSPACE_SHARDS];
 };
 
 
@@ -235,27 +247,81 @@ static void virLockSpaceResourceDataFree(void *opaque)
 }
 
 
-virLockSpacePtr virLockSpaceNew(const char *directory)
+static virLockSpacePtr
+virLockSpaceAlloc(void)
 {
     virLockSpacePtr lockspace;
-
-    VIR_DEBUG("directory=%s", NULLSTR(directory));
+    size_t i;
 
     if (VIR_ALLOC(lockspace) < 0)
         return NULL;
 
-    if (virMutexInit(&lockspace->lock) < 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Unable to initialize lockspace mutex"));
-        VIR_FREE(lockspace);
-        return NULL;
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++) {
+        virLockSpaceShardPtr shard = &lockspace->shards[i];
+
+        if (virMutexInit(&shard->lock) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Unable to initialize lockspace mutex"));
+            goto error;
+        }
+
+        if (!(shard->resources = virHashCreate(VIR_LOCKSPACE_TABLE_SIZE,
+                                               virLockSpaceResourceDataFree))) {
+            virMutexDestroy(&shard->lock);
+            goto error;
+        }
     }
 
-    lockspace->dir = g_strdup(directory);
+    return lockspace;
+
+ error:
+    while (i-- > 0) {
+        virHashFree(lockspace->shards[i].resources);
+        virMutexDestroy(&lockspace->shards[i].lock);
+    }
+    VIR_FREE(lockspace);
+    return NULL;
+}
 
-    if (!(lockspace->resources = virHashCreate(VIR_LOCKSPACE_TABLE_SIZE,
-                                               virLockSpaceResourceDataFree)))
-        goto error;
+
+static virLockSpaceShardPtr
+virLockSpaceGetShard(virLockSpacePtr lockspace,
+                     const char *resname)
+{
+    return &lockspace->shards[g_str_hash(resname) % VIR_LOCKSPACE_SHARDS];
+}
+
+
+static void
+virLockSpaceLockAll(virLockSpacePtr lockspace)
+{
+    size_t i;
+
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++)
+        virMutexLock(&lockspace->shards[i].lock);
+}
+
+
+static void
+virLockSpaceUnlockAll(virLockSpacePtr lockspace)
+{
+    size_t i;
+
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++)
+        virMutexUnlock(&lockspace->shards[i].lock);
+}
+
+
+virLockSpacePtr virLockSpaceNew(const char *directory)
+{
+    virLockSpacePtr lockspace;
+
+    VIR_DEBUG("directory=%s", NULLSTR(directory));
+
+    if (!(lockspace = virLockSpaceAlloc()))
+        return NULL;
+
+    lockspace->dir = g_strdup(directory);
 
     if (directory) {
         if (virFileExists(directory)) {
@@ -292,20 +358,9 @@ virLockSpacePtr virLockSpaceNewPostExecRestart(virJSONValuePtr object)
 
     VIR_DEBUG("object=%p", object);
 
-    if (VIR_ALLOC(lockspace) < 0)
+    if (!(lockspace = virLockSpaceAlloc()))
         return NULL;
 
-    if (virMutexInit(&lockspace->lock) < 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Unable to initialize lockspace mutex"));
-        VIR_FREE(lockspace);
-        return NULL;
-    }
-
-    if (!(lockspace->resources = virHashCreate(VIR_LOCKSPACE_TABLE_SIZE,
-                                               virLockSpaceResourceDataFree)))
-        goto error;
-
     if (virJSONValueObjectHasKey(object, "directory")) {
         const char *dir = virJSONValueObjectGetString(object, "directory");
         lockspace->dir = g_strdup(dir);
@@ -411,7 +466,8 @@ virLockSpacePtr virLockSpaceNewPostExecRestart(virJSONValuePtr object)
             res->owners[j] = (pid_t)owner;
         }
 
-        if (virHashAddEntry(lockspace->resources, res->name, res) < 0) {
+        if (virHashAddEntry(virLockSpaceGetShard(lockspace, res->name)->resources,
+                            res->name, res) < 0) {
             virLockSpaceResourceFree(res);
             goto error;
         }
@@ -430,8 +486,9 @@ virJSONValuePtr virLockSpacePreExecRestart(virLockSpacePtr lockspace)
     virJSONValuePtr object = virJSONValueNewObject();
     virJSONValuePtr resources;
     virHashKeyValuePairPtr pairs = NULL, tmp;
+    size_t shard;
 
-    virMutexLock(&lockspace->lock);
+    virLockSpaceLockAll(lockspace);
 
     if (lockspace->dir &&
         virJSONValueObjectAppendString(object, "directory", lockspace->dir) < 0)
@@ -444,72 +501,78 @@ virJSONValuePtr virLockSpacePreExecRestart(virLockSpacePtr lockspace)
         goto error;
     }
 
-    tmp = pairs = virHashGetItems(lockspace->resources, NULL);
-    while (tmp && tmp->value) {
-        virLockSpaceResourcePtr res = (virLockSpaceResourcePtr)tmp->value;
-        virJSONValuePtr child = virJSONValueNewObject();
-        virJSONValuePtr owners = NULL;
-        size_t i;
+    for (shard = 0; shard < VIR_LOCKSPACE_SHARDS; shard++) {
+        tmp = pairs = virHashGetItems(lockspace->shards[shard].resources, NULL);
+        while (tmp && tmp->value) {
+            virLockSpaceResourcePtr res = (virLockSpaceResourcePtr)tmp->value;
+            virJSONValuePtr child = virJSONValueNewObject();
+            virJSONValuePtr owners = NULL;
+            size_t i;
 
-        if (virJSONValueArrayAppend(resources, child) < 0) {
-            virJSONValueFree(child);
-            goto error;
-        }
-
-        if (virJSONValueObjectAppendString(child, "name", res->name) < 0 ||
-            virJSONValueObjectAppendString(child, "path", res->path) < 0 ||
-            virJSONValueObjectAppendNumberInt(child, "fd", res->fd) < 0 ||
-            virJSONValueObjectAppendBoolean(child, "lockHeld", res->lockHeld) < 0 ||
-            virJSONValueObjectAppendNumberUint(child, "flags", res->flags) < 0)
-            goto error;
+            if (virJSONValueArrayAppend(resources, child) < 0) {
+                virJSONValueFree(child);
+                goto error;
+            }
 
-        if (virSetInherit(res->fd, true) < 0) {
-            virReportSystemError(errno, "%s",
-                                 _("Cannot disable close-on-exec flag"));
-            goto error;
-        }
+            if (virJSONValueObjectAppendString(child, "name", res->name) < 0 ||
+                virJSONValueObjectAppendString(child, "path", res->path) < 0 ||
+                virJSONValueObjectAppendNumberInt(child, "fd", res->fd) < 0 ||
+                virJSONValueObjectAppendBoolean(child, "lockHeld", res->lockHeld) < 0 ||
+                virJSONValueObjectAppendNumberUint(child, "flags", res->flags) < 0)
+                goto error;
 
-        owners = virJSONValueNewArray();
+            if (virSetInherit(res->fd, true) < 0) {
+                virReportSystemError(errno, "%s",
+                                     _("Cannot disable close-on-exec flag"));
+                goto error;
+            }
 
-        if (virJSONValueObjectAppend(child, "owners", owners) < 0) {
-            virJSONValueFree(owners);
-            goto error;
-        }
+            owners = virJSONValueNewArray();
 
-        for (i = 0; i < res->nOwners; i++) {
-            virJSONValuePtr owner = virJSONValueNewNumberUlong(res->owners[i]);
-            if (!owner)
+            if (virJSONValueObjectAppend(child, "owners", owners) < 0) {
+                virJSONValueFree(owners);
                 goto error;
+            }
 
-            if (virJSONValueArrayAppend(owners, owner) < 0) {
-                virJSONValueFree(owner);
-                goto error;
+            for (i = 0; i < res->nOwners; i++) {
+                virJSONValuePtr owner = virJSONValueNewNumberUlong(res->owners[i]);
+                if (!owner)
+                    goto error;
+
+                if (virJSONValueArrayAppend(owners, owner) < 0) {
+                    virJSONValueFree(owner);
+                    goto error;
+                }
             }
-        }
 
-        tmp++;
+            tmp++;
+        }
+        VIR_FREE(pairs);
     }
-    VIR_FREE(pairs);
 
-    virMutexUnlock(&lockspace->lock);
+    virLockSpaceUnlockAll(lockspace);
     return object;
 
  error:
     VIR_FREE(pairs);
     virJSONValueFree(object);
-    virMutexUnlock(&lockspace->lock);
+    virLockSpaceUnlockAll(lockspace);
     return NULL;
 }
 
 
 void virLockSpaceFree(virLockSpacePtr lockspace)
 {
+    size_t i;
+
     if (!lockspace)
         return;
 
-    virHashFree(lockspace->resources);
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++) {
+        virHashFree(lockspace->shards[i].resources);
+        virMutexDestroy(&lockspace->shards[i].lock);
+    }
     VIR_FREE(lockspace->dir);
-    virMutexDestroy(&lockspace->lock);
     VIR_FREE(lockspace);
 }
 
@@ -523,14 +586,15 @@ const char *virLockSpaceGetDirectory(virLockSpacePtr lockspace)
 int virLockSpaceCreateResource(virLockSpacePtr lockspace,
                                const char *resname)
 {
+    virLockSpaceShardPtr shard = virLockSpaceGetShard(lockspace, resname);
     int ret = -1;
     char *respath = NULL;
 
     VIR_DEBUG("lockspace=%p resname=%s", lockspace, resname);
 
-    virMutexLock(&lockspace->lock);
+    virMutexLock(&shard->lock);
 
-    if (virHashLookup(lockspace->resources, resname) != NULL) {
+    if (virHashLookup(shard->resources, resname) != NULL) {
         virReportError(VIR_ERR_RESOURCE_BUSY,
                        _("Lockspace resource '%s' is locked"),
                        resname);
@@ -546,7 +610,7 @@ int virLockSpaceCreateResource(virLockSpacePtr lockspace,
     ret = 0;
 
  cleanup:
-    virMutexUnlock(&lockspace->lock);
+    virMutexUnlock(&shard->lock);
     VIR_FREE(respath);
     return ret;
 }
@@ -555,14 +619,15 @@ int virLockSpaceCreateResource(virLockSpacePtr lockspace,
 int virLockSpaceDeleteResource(virLockSpacePtr lockspace,
                                const char *resname)
 {
+    virLockSpaceShardPtr shard = virLockSpaceGetShard(lockspace, resname);
     int ret = -1;
     char *respath = NULL;
 
     VIR_DEBUG("lockspace=%p resname=%s", lockspace, resname);
 
-    virMutexLock(&lockspace->lock);
+    virMutexLock(&shard->lock);
 
-    if (virHashLookup(lockspace->resources, resname) != NULL) {
+    if (virHashLookup(shard->resources, resname) != NULL) {
         virReportError(VIR_ERR_RESOURCE_BUSY,
                        _("Lockspace resource '%s' is locked"),
                        resname);
@@ -583,7 +648,7 @@ int virLockSpaceDeleteResource(virLockSpacePtr lockspace,
     ret = 0;
 
  cleanup:
-    virMutexUnlock(&lockspace->lock);
+    virMutexUnlock(&shard->lock);
     VIR_FREE(respath);
     return ret;
 }
@@ -594,6 +659,7 @@ int virLockSpaceAcquireResource(virLockSpacePtr lockspace,
                                 pid_t owner,
                                 unsigned int flags)
 {
+    virLockSpaceShardPtr shard = virLockSpaceGetShard(lockspace, resname);
     int ret = -1;
     virLockSpaceResourcePtr res;
 
@@ -603,9 +669,9 @@ int virLockSpaceAcquireResource(virLockSpacePtr lockspace,
     virCheckFlags(VIR_LOCK_SPACE_ACQUIRE_SHARED |
                   VIR_LOCK_SPACE_ACQUIRE_AUTOCREATE, -1);
 
-    virMutexLock(&lockspace->lock);
+    virMutexLock(&shard->lock);
 
-    if ((res = virHashLookup(lockspace->resources, resname))) {
+    if ((res = virHashLookup(shard->resources, resname))) {
         if ((res->flags & VIR_LOCK_SPACE_ACQUIRE_SHARED) &&
             (flags & VIR_LOCK_SPACE_ACQUIRE_SHARED)) {
 
@@ -624,7 +690,7 @@ int virLockSpaceAcquireResource(virLockSpacePtr lockspace,
     if (!(res = virLockSpaceResourceNew(lockspace, resname, flags, owner)))
         goto cleanup;
 
-    if (virHashAddEntry(lockspace->resources, resname, res) < 0) {
+    if (virHashAddEntry(shard->resources, resname, res) < 0) {
         virLockSpaceResourceFree(res);
         goto cleanup;
     }
@@ -633,7 +699,7 @@ int virLockSpaceAcquireResource(virLockSpacePtr lockspace,
     ret = 0;
 
  cleanup:
-    virMutexUnlock(&lockspace->lock);
+    virMutexUnlock(&shard->lock);
     return ret;
 }
 
@@ -642,6 +708,7 @@ int virLockSpaceReleaseResource(virLockSpacePtr lockspace,
                                 const char *resname,
                                 pid_t owner)
 {
+    virLockSpaceShardPtr shard = virLockSpaceGetShard(lockspace, resname);
     int ret = -1;
     virLockSpaceResourcePtr res;
     size_t i;
@@ -649,9 +716,9 @@ int virLockSpaceReleaseResource(virLockSpacePtr lockspace,
     VIR_DEBUG("lockspace=%p resname=%s owner=%lld",
               lockspace, resname, (unsigned long long)owner);
 
-    virMutexLock(&lockspace->lock);
+    virMutexLock(&shard->lock);
 
-    if (!(res = virHashLookup(lockspace->resources, resname))) {
+    if (!(res = virHashLookup(shard->resources, resname))) {
         virReportError(VIR_ERR_RESOURCE_BUSY,
                        _("Lockspace resource '%s' is not locked"),
                        resname);
@@ -673,13 +740,13 @@ int virLockSpaceReleaseResource(virLockSpacePtr lockspace,
     VIR_DELETE_ELEMENT(res->owners, i, res->nOwners);
 
     if ((res->nOwners == 0) &&
-        virHashRemoveEntry(lockspace->resources, resname) < 0)
+        virHashRemoveEntry(shard->resources, resname) < 0)
         goto cleanup;
 
     ret = 0;
 
  cleanup:
-    virMutexUnlock(&lockspace->lock);
+    virMutexUnlock(&shard->lock);
     return ret;
 }
 
@@ -730,22 +797,22 @@ int virLockSpaceReleaseResourcesForOwner(virLockSpacePtr lockspace,
     struct virLockSpaceRemoveData data = {
         owner, 0
     };
+    size_t i;
 
     VIR_DEBUG("lockspace=%p owner=%lld", lockspace, (unsigned long long)owner);
 
-    virMutexLock(&lockspace->lock);
+    for (i = 0; i < VIR_LOCKSPACE_SHARDS; i++) {
+        virLockSpaceShardPtr shard = &lockspace->shards[i];
 
-    if (virHashRemoveSet(lockspace->resources,
-                         virLockSpaceRemoveResourcesForOwner,
-                         &data) < 0)
-        goto error;
-
-    ret = data.count;
+        virMutexLock(&shard->lock);
+        ret = virHashRemoveSet(shard->resources,
+                               virLockSpaceRemoveResourcesForOwner,
+                               &data);
+        virMutexUnlock(&shard->lock);
 
-    virMutexUnlock(&lockspace->lock);
-    return ret;
+        if (ret < 0)
+            return -1;
+    }
 
- error:
-    virMutexUnlock(&lockspace->lock);
-    return -1;
+    return data.count;
 }
@@ -69,7 +69,8 @@ static GRegex *virLogRegex;
 VIR_ENUM_DECL(virLogDestination);
 VIR_ENUM_IMPL(virLogDestination,
               VIR_LOG_TO_OUTPUT_LAST,
-              "stderr", "syslog", "file", "journald",
+              "stderr", "syslog", "file", "journald", "trace",
+              "buffer",
 );
 
 /*
@@ -91,6 +92,7 @@ static size_t virLogNbFilters;
  */
 struct _virLogOutput {
     bool logInitMessage;
+    bool raw; /* doesn't use the formatted message */
     void *data;
     virLogOutputFunc f;
     virLogCloseFunc c;
@@ -127,6 +129,54 @@ static void virLogOutputToFd(virLogSourcePtr src,
  */
 virMutex virLogMutex;
 
+/* Time and thread of the message being passed to the outputs, for the
+ * outputs which don't use the formatted string. Protected by virLogMutex */
+static unsigned long long virLogMessageWhen;
+static unsigned long long virLogMessageThread;
+
+
+/*
+ * In asynchronous mode each thread stores its messages in a ring buffer
+ * of its own, without taking virLogMutex or formatting anything beyond
+ * the message itself, and a writer thread passes them on to the outputs.
+ * The ring is written only by its thread and drained only by the writer,
+ * so the two indexes are all that needs to be accessed atomically.
+ */
+#define VIR_LOG_RING_SIZE 512
+
+struct _virLogRingEntry {
+    virLogSourcePtr source;
+    virLogPriority priority;
+    const char *filename;
+    int linenr;
+    const char *funcname;
+    unsigned long long when;
+    char *str;
+};
+typedef struct _virLogRingEntry virLogRingEntry;
+
+typedef struct _virLogRing virLogRing;
+typedef virLogRing *virLogRingPtr;
+struct _virLogRing {
+    unsigned long long thread;
+    int head; /* next entry to fill, advanced by the owning thread */
+    int tail; /* next entry to write, advanced by the writer */
+    int orphaned; /* the owning thread exited */
+    virLogRingPtr next;
+    virLogRingEntry entries[VIR_LOG_RING_SIZE];
+};
+
+static int virLogAsync;
+static bool virLogAsyncRunning;
+static virThread virLogAsyncThread;
+static virMutex virLogAsyncMutex;
+static virCond virLogAsyncCond;
+static virLogRingPtr virLogRings;
+
+static void virLogRingOrphan(void *opaque);
+static GPrivate virLogRingKey = G_PRIVATE_INIT(virLogRingOrphan);
+static GPrivate virLogAsyncWriterKey = G_PRIVATE_INIT(NULL);
+
 void
 virLogLock(void)
 {
@@ -247,7 +297,9 @@ virLogPriorityString(virLogPriority lvl)
 static int
 virLogOnceInit(void)
 {
-    if (virMutexInit(&virLogMutex) < 0)
+    if (virMutexInit(&virLogMutex) < 0 ||
+        virMutexInit(&virLogAsyncMutex) < 0 ||
+        virCondInit(&virLogAsyncCond) < 0)
         return -1;
 
     virLogLock();
@@ -283,6 +335,11 @@ virLogReset(void)
     if (virLogInitialize() < 0)
         return -1;
 
+    /* Forked children don't have the writer thread, so messages have to
+     * be written directly. Buffered messages are left to the writer in
+     * case it's still running. */
+    g_atomic_int_set(&virLogAsync, 0);
+
     virLogLock();
     virLogResetFilters();
     virLogResetOutputs();
@@ -416,6 +473,7 @@ virLogOutputListFree(virLogOutputPtr *list, int count)
 
 static void
 virLogFormatString(char **msg,
+                   unsigned long long thread,
                    int linenr,
                    const char *funcname,
                    virLogPriority priority,
@@ -423,11 +481,11 @@ virLogFormatString(char **msg,
 {
     if ((funcname != NULL)) {
         *msg = g_strdup_printf("%llu: %s : %s:%d : %s\n",
-                               virThreadSelfID(), virLogPriorityString(priority),
+                               thread, virLogPriorityString(priority),
                                funcname, linenr, str);
     } else {
         *msg = g_strdup_printf("%llu: %s : %s\n",
-                               virThreadSelfID(), virLogPriorityString(priority),
+                               thread, virLogPriorityString(priority),
                                str);
     }
 }
@@ -435,10 +493,12 @@ virLogFormatString(char **msg,
 
 static void
 virLogVersionString(const char **rawmsg,
-                    char **msg)
+                    char **msg,
+                    unsigned long long thread)
 {
     *rawmsg = VIR_LOG_VERSION_STRING;
-    virLogFormatString(msg, 0, NULL, VIR_LOG_INFO, VIR_LOG_VERSION_STRING);
+    virLogFormatString(msg, thread, 0, NULL, VIR_LOG_INFO,
+                       VIR_LOG_VERSION_STRING);
 }
 
 /* Similar to virGetHostname() but avoids use of error
@@ -446,13 +506,14 @@ virLogVersionString(const char **rawmsg,
  */
 static void
 virLogHostnameString(char **rawmsg,
-                     char **msg)
+                     char **msg,
+                     unsigned long long thread)
 {
     char *hoststr;
 
     hoststr = g_strdup_printf("hostname: %s", g_get_host_name());
 
-    virLogFormatString(msg, 0, NULL, VIR_LOG_INFO, hoststr);
+    virLogFormatString(msg, thread, 0, NULL, VIR_LOG_INFO, hoststr);
     *rawmsg = hoststr;
 }
 
@@ -479,87 +540,49 @@ virLogSourceUpdate(virLogSourcePtr source)
 }
 
 
-/**
- * virLogVMessage:
- * @source: where is that message coming from
- * @priority: the priority level
- * @filename: file where the message was emitted
- * @linenr: line where the message was emitted
- * @funcname: the function emitting the (debug) message
- * @metadata: NULL or metadata array, terminated by an item with NULL key
- * @fmt: the string format
- * @vargs: format args
+/*
+ * virLogOutputMessage:
  *
- * Call the libvirt logger with some information. Based on the configuration
- * the message may be stored, sent to output or just discarded
+ * Passes a message to the outputs defined, or to stderr if none exist.
+ * The caller must hold virLogMutex. @msg is the message formatted with its
+ * level and origin, or NULL to format it only if an output needs it.
  */
 static void
-G_GNUC_PRINTF(7, 0)
-virLogVMessage(virLogSourcePtr source,
-               virLogPriority priority,
-               const char *filename,
-               int linenr,
-               const char *funcname,
-               virLogMetadataPtr metadata,
-               const char *fmt,
-               va_list vargs)
+virLogOutputMessage(virLogSourcePtr source,
+                    virLogPriority priority,
+                    const char *filename,
+                    int linenr,
+                    const char *funcname,
+                    virLogMetadataPtr metadata,
+                    unsigned long long when,
+                    unsigned long long thread,
+                    const char *str,
+                    char *msg)
 {
     static bool logInitMessageStderr = true;
-    char *str = NULL;
-    char *msg = NULL;
     char timestamp[VIR_TIME_STRING_BUFLEN];
     size_t i;
-    int saved_errno = errno;
-
-    if (virLogInitialize() < 0)
-        return;
 
-    if (fmt == NULL)
-        return;
-
-    /*
-     * 3 intentionally non-thread safe variable reads.
-     * Since writes to the variable are serialized on
-     * virLogLock, worst case result is a log message
-     * is accidentally dropped or emitted, if another
-     * thread is updating log filter list concurrently
-     * with a log message emission.
-     */
-    if (source->serial < virLogFiltersSerial)
-        virLogSourceUpdate(source);
-    if (priority < source->priority)
-        goto cleanup;
-
-    /*
-     * serialize the error message, add level and timestamp
-     */
-    str = g_strdup_vprintf(fmt, vargs);
-
-    virLogFormatString(&msg, linenr, funcname, priority, str);
-
-    if (virTimeStringNowRaw(timestamp) < 0)
+    if (virTimeStringThenRaw(when, timestamp) < 0)
         timestamp[0] = '\0';
 
-    virLogLock();
+    virLogMessageWhen = when;
+    virLogMessageThread = thread;
 
-    /*
-     * Push the message to the outputs defined, if none exist then
-     * use stderr.
-     */
     for (i = 0; i < virLogNbOutputs; i++) {
         if (priority >= virLogOutputs[i]->priority) {
             if (virLogOutputs[i]->logInitMessage) {
                 const char *rawinitmsg;
                 char *hoststr = NULL;
                 char *initmsg = NULL;
-                virLogVersionString(&rawinitmsg, &initmsg);
+                virLogVersionString(&rawinitmsg, &initmsg, thread);
                 virLogOutputs[i]->f(&virLogSelf, VIR_LOG_INFO,
                                     __FILE__, __LINE__, __func__,
                                     timestamp, NULL, rawinitmsg, initmsg,
                                     virLogOutputs[i]->data);
                 VIR_FREE(initmsg);
 
-                virLogHostnameString(&hoststr, &initmsg);
+                virLogHostnameString(&hoststr, &initmsg, thread);
                 virLogOutputs[i]->f(&virLogSelf, VIR_LOG_INFO,
                                     __FILE__, __LINE__, __func__,
                                     timestamp, NULL, hoststr, initmsg,
@@ -568,6 +591,12 @@ virLogVMessage(virLogSourcePtr source,
                 VIR_FREE(initmsg);
                 virLogOutputs[i]->logInitMessage = false;
             }
+
+            /* the level and origin are only formatted if needed */
+            if (!msg && !virLogOutputs[i]->raw)
+                virLogFormatString(&msg, thread, linenr, funcname,
+                                   priority, str);
+
             virLogOutputs[i]->f(source, priority,
                                 filename, linenr, funcname,
                                 timestamp, metadata,
@@ -579,14 +608,14 @@ virLogVMessage(virLogSourcePtr source,
             const char *rawinitmsg;
             char *hoststr = NULL;
             char *initmsg = NULL;
-            virLogVersionString(&rawinitmsg, &initmsg);
+            virLogVersionString(&rawinitmsg, &initmsg, thread);
             virLogOutputToFd(&virLogSelf, VIR_LOG_INFO,
                              __FILE__, __LINE__, __func__,
                              timestamp, NULL, rawinitmsg, initmsg,
                              (void *) STDERR_FILENO);
             VIR_FREE(initmsg);
 
-            virLogHostnameString(&hoststr, &initmsg);
+            virLogHostnameString(&hoststr, &initmsg, thread);
             virLogOutputToFd(&virLogSelf, VIR_LOG_INFO,
                              __FILE__, __LINE__, __func__,
                              timestamp, NULL, hoststr, initmsg,
@@ -595,16 +624,334 @@ virLogVMessage(virLogSourcePtr source,
             VIR_FREE(initmsg);
             logInitMessageStderr = false;
         }
+        if (!msg)
+            virLogFormatString(&msg, thread, linenr, funcname, priority, str);
         virLogOutputToFd(source, priority,
                          filename, linenr, funcname,
                          timestamp, metadata,
                          str, msg, (void *) STDERR_FILENO);
     }
+
+    VIR_FREE(msg);
+}
+
+
+static void
+virLogRingOrphan(void *opaque)
+{
+    virLogRingPtr ring = opaque;
+
+    /* freed by the writer once it's drained */
+    g_atomic_int_set(&ring->orphaned, 1);
+}
+
+
+static void
+virLogAsyncWake(void)
+{
+    /* Signalled without the mutex, a lost wakeup only delays the writer
+     * until its next periodic check */
+    virCondSignal(&virLogAsyncCond);
+}
+
+
+static virLogRingPtr
+virLogRingGet(void)
+{
+    virLogRingPtr ring;
+
+    if ((ring = g_private_get(&virLogRingKey)))
+        return ring;
+
+    /* messages from the writer itself are written directly */
+    if (g_private_get(&virLogAsyncWriterKey))
+        return NULL;
+
+    ring = g_new0(virLogRing, 1);
+    ring->thread = virThreadSelfID();
+
+    virMutexLock(&virLogAsyncMutex);
+    ring->next = virLogRings;
+    virLogRings = ring;
+    virMutexUnlock(&virLogAsyncMutex);
+
+    g_private_set(&virLogRingKey, ring);
+    return ring;
+}
+
+
+/*
+ * virLogRingPush:
+ *
+ * Stores a message in the ring buffer of the calling thread, waiting for
+ * the writer to make room if it's full. On success the ring takes over
+ * @str.
+ *
+ * Returns true if the message was stored, false if it has to be written
+ * directly.
+ */
+static bool
+virLogRingPush(virLogSourcePtr source,
+               virLogPriority priority,
+               const char *filename,
+               int linenr,
+               const char *funcname,
+               char *str)
+{
+    virLogRingPtr ring;
+    virLogRingEntry *entry;
+    unsigned int head;
+    unsigned int used;
+
+    if (!g_atomic_int_get(&virLogAsync) ||
+        !(ring = virLogRingGet()))
+        return false;
+
+    head = ring->head;
+    while ((used = head - (unsigned int) g_atomic_int_get(&ring->tail)) >=
+           VIR_LOG_RING_SIZE) {
+        if (!g_atomic_int_get(&virLogAsync))
+            return false;
+        virLogAsyncWake();
+        g_usleep(100);
+    }
+
+    entry = &ring->entries[head % VIR_LOG_RING_SIZE];
+    entry->source = source;
+    entry->priority = priority;
+    entry->filename = filename;
+    entry->linenr = linenr;
+    entry->funcname = funcname;
+    if (virTimeMillisNowRaw(&entry->when) < 0)
+        entry->when = 0;
+    entry->str = str;
+
+    /* publishes the entry to the writer */
+    g_atomic_int_set(&ring->head, (int) (head + 1));
+
+    if (priority >= VIR_LOG_WARN || used + 1 >= VIR_LOG_RING_SIZE / 2)
+        virLogAsyncWake();
+
+    return true;
+}
+
+
+/*
+ * virLogRingDrain:
+ *
+ * Writes all messages stored in @ring so far. Called by the writer only,
+ * with virLogAsyncMutex held.
+ */
+static void
+virLogRingDrain(virLogRingPtr ring)
+{
+    unsigned int tail = ring->tail;
+    unsigned int head = g_atomic_int_get(&ring->head);
+
+    if (tail == head)
+        return;
+
+    virLogLock();
+    for (; tail != head; tail++) {
+        virLogRingEntry *entry = &ring->entries[tail % VIR_LOG_RING_SIZE];
+
+        virLogOutputMessage(entry->source, entry->priority,
+                            entry->filename, entry->linenr, entry->funcname,
+                            NULL, entry->when, ring->thread, entry->str,
+                            NULL);
+        VIR_FREE(entry->str);
+    }
+    virLogUnlock();
+
+    /* hands the entries back to the owning thread */
+    g_atomic_int_set(&ring->tail, (int) tail);
+}
+
+
+static void
+virLogAsyncWriter(void *opaque G_GNUC_UNUSED)
+{
+    g_private_set(&virLogAsyncWriterKey, GINT_TO_POINTER(1));
+
+    virMutexLock(&virLogAsyncMutex);
+    while (true) {
+        bool quit = !virLogAsyncRunning;
+        virLogRingPtr *ringp = &virLogRings;
+        unsigned long long then;
+
+        while (*ringp) {
+            virLogRingPtr ring = *ringp;
+            bool orphaned = g_atomic_int_get(&ring->orphaned);
+
+            virLogRingDrain(ring);
+
+            if (orphaned) {
+                *ringp = ring->next;
+                g_free(ring);
+                continue;
+            }
+            ringp = &ring->next;
+        }
+
+        if (quit)
+            break;
+
+        if (virTimeMillisNowRaw(&then) < 0)
+            then = 0;
+        ignore_value(virCondWaitUntil(&virLogAsyncCond, &virLogAsyncMutex,
+                                      then + 100));
+    }
+    virMutexUnlock(&virLogAsyncMutex);
+}
+
+
+/**
+ * virLogSetAsync:
+ * @async: whether messages should be written asynchronously
+ *
+ * Switches between writing messages to the outputs directly from the
+ * threads emitting them, which serializes the threads on the outputs, and
+ * handing them over to a writer thread through per-thread ring buffers.
+ * Disabling asynchronous mode writes all buffered messages before
+ * returning. Messages with metadata are always written directly.
+ *
+ * Asynchronous mode doesn't survive fork(), so it has to be enabled after
+ * a process daemonized itself.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virLogSetAsync(bool async)
+{
+    if (virLogInitialize() < 0)
+        return -1;
+
+    if (async) {
+        virMutexLock(&virLogAsyncMutex);
+        if (virLogAsyncRunning) {
+            virMutexUnlock(&virLogAsyncMutex);
+            g_atomic_int_set(&virLogAsync, 1);
+            return 0;
+        }
+        virLogAsyncRunning = true;
+        virMutexUnlock(&virLogAsyncMutex);
+
+        if (virThreadCreateFull(&virLogAsyncThread, true, virLogAsyncWriter,
+                                "log-writer", false, NULL) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("Unable to create log writer thread"));
+            virMutexLock(&virLogAsyncMutex);
+            virLogAsyncRunning = false;
+            virMutexUnlock(&virLogAsyncMutex);
+            return -1;
+        }
+
+        g_atomic_int_set(&virLogAsync, 1);
+        return 0;
+    }
+
+    g_atomic_int_set(&virLogAsync, 0);
+
+    virMutexLock(&virLogAsyncMutex);
+    if (!virLogAsyncRunning) {
+        virMutexUnlock(&virLogAsyncMutex);
+        return 0;
+    }
+    virLogAsyncRunning = false;
+    virCondSignal(&virLogAsyncCond);
+    virMutexUnlock(&virLogAsyncMutex);
+
+    virThreadJoin(&virLogAsyncThread);
+    return 0;
+}
+
+
+/**
+ * virLogGetAsync:
+ *
+ * Returns whether messages are written asynchronously.
+ */
+bool
+virLogGetAsync(void)
+{
+    return g_atomic_int_get(&virLogAsync);
+}
+
+
+/**
+ * virLogVMessage:
+ * @source: where is that message coming from
+ * @priority: the priority level
+ * @filename: file where the message was emitted
+ * @linenr: line where the message was emitted
+ * @funcname: the function emitting the (debug) message
+ * @metadata: NULL or metadata array, terminated by an item with NULL key
+ * @fmt: the string format
+ * @vargs: format args
+ *
+ * Call the libvirt logger with some information. Based on the configuration
+ * the message may be stored, sent to output or just discarded
+ */
+static void
+G_GNUC_PRINTF(7, 0)
+virLogVMessage(virLogSourcePtr source,
+               virLogPriority priority,
+               const char *filename,
+               int linenr,
+               const char *funcname,
+               virLogMetadataPtr metadata,
+               const char *fmt,
+               va_list vargs)
+{
+    char *str = NULL;
+    char *msg = NULL;
+    unsigned long long when;
+    unsigned long long thread;
+    int saved_errno = errno;
+
+    if (virLogInitialize() < 0)
+        return;
+
+    if (fmt == NULL)
+        return;
+
+    /*
+     * 3 intentionally non-thread safe variable reads.
+     * Since writes to the variable are serialized on
+     * virLogLock, worst case result is a log message
+     * is accidentally dropped or emitted, if another
+     * thread is updating log filter list concurrently
+     * with a log message emission.
+     */
+    if (source->serial < virLogFiltersSerial)
+        virLogSourceUpdate(source);
+    if (priority < source->priority)
+        goto cleanup;
+
+    /*
+     * serialize the error message, add level and timestamp
+     */
+    str = g_strdup_vprintf(fmt, vargs);
+
+    if (!metadata &&
+        virLogRingPush(source, priority, filename, linenr, funcname, str)) {
+        str = NULL;
+        goto cleanup;
+    }
+
+    thread = virThreadSelfID();
+    virLogFormatString(&msg, thread, linenr, funcname, priority, str);
+
+    if (virTimeMillisNowRaw(&when) < 0)
+        when = 0;
+
+    virLogLock();
+    virLogOutputMessage(source, priority, filename, linenr, funcname,
+                        metadata, when, thread, str, g_steal_pointer(&msg));
     virLogUnlock();
 
  cleanup:
     VIR_FREE(str);
-    VIR_FREE(msg);
     errno = saved_errno;
 }
 
@@ -705,6 +1052,251 @@ virLogNewOutputToFile(virLogPriority priority,
 }
 
 
+static void
+virLogOutputToTrace(virLogSourcePtr source,
+                    virLogPriority priority,
+                    const char *filename G_GNUC_UNUSED,
+                    int linenr,
+                    const char *funcname,
+                    const char *timestamp G_GNUC_UNUSED,
+                    virLogMetadataPtr metadata G_GNUC_UNUSED,
+                    const char *rawstr,
+                    const char *str G_GNUC_UNUSED,
+                    void *data)
+{
+    int fd = (intptr_t) data;
+    virLogTraceRecord rec = { 0 };
+    size_t namelen = strlen(source->name) + 1;
+    size_t funclen = funcname ? strlen(funcname) + 1 : 1;
+    size_t msglen = strlen(rawstr) + 1;
+    g_autofree char *buf = NULL;
+    char *tmp;
+
+    rec.when = virLogMessageWhen;
+    rec.thread = virLogMessageThread;
+    rec.linenr = linenr;
+    rec.priority = priority;
+    rec.len = namelen + funclen + msglen;
+
+    /* one write per record so that records of several processes
+     * appending to the same file don't interleave */
+    buf = g_new0(char, sizeof(rec) + rec.len);
+    memcpy(buf, &rec, sizeof(rec));
+    tmp = buf + sizeof(rec);
+    memcpy(tmp, source->name, namelen);
+    tmp += namelen;
+    if (funcname)
+        memcpy(tmp, funcname, funclen);
+    tmp += funclen;
+    memcpy(tmp, rawstr, msglen);
+
+    ignore_value(safewrite(fd, buf, sizeof(rec) + rec.len));
+}
+
+
+/*
+ * The 'buffer' output keeps the most recent messages in memory only, so
+ * that debug messages can be collected all the time and saved to a file
+ * when something went wrong.
+ */
+#define VIR_LOG_BUFFER_DEFAULT_SIZE 1024 /* KiB */
+
+struct _virLogBuffer {
+    int fd;
+    size_t size; /* in KiB */
+    char *data;
+    size_t alloc;
+    size_t start;
+    size_t len;
+};
+typedef struct _virLogBuffer virLogBuffer;
+typedef virLogBuffer *virLogBufferPtr;
+
+
+static void
+virLogBufferAppend(virLogBufferPtr buf,
+                   const char *str,
+                   size_t len)
+{
+    size_t pos;
+    size_t chunk;
+
+    /* only the end of a message larger than the buffer fits */
+    if (len > buf->alloc) {
+        str += len - buf->alloc;
+        len = buf->alloc;
+    }
+
+    /* drop the oldest data to make room */
+    if (buf->len + len > buf->alloc) {
+        size_t drop = buf->len + len - buf->alloc;
+
+        buf->start = (buf->start + drop) % buf->alloc;
+        buf->len -= drop;
+    }
+
+    pos = (buf->start + buf->len) % buf->alloc;
+    chunk = MIN(len, buf->alloc - pos);
+    memcpy(buf->data + pos, str, chunk);
+    memcpy(buf->data, str + chunk, len - chunk);
+    buf->len += len;
+}
+
+
+static void
+virLogOutputToBuffer(virLogSourcePtr source G_GNUC_UNUSED,
+                     virLogPriority priority G_GNUC_UNUSED,
+                     const char *filename G_GNUC_UNUSED,
+                     int linenr G_GNUC_UNUSED,
+                     const char *funcname G_GNUC_UNUSED,
+                     const char *timestamp,
+                     virLogMetadataPtr metadata G_GNUC_UNUSED,
+                     const char *rawstr G_GNUC_UNUSED,
+                     const char *str,
+                     void *data)
+{
+    virLogBufferPtr buf = data;
+
+    virLogBufferAppend(buf, timestamp, strlen(timestamp));
+    virLogBufferAppend(buf, ": ", 2);
+    virLogBufferAppend(buf, str, strlen(str));
+}
+
+
+/*
+ * Writes the contents of @buf to its file and empties it. The caller must
+ * hold virLogMutex.
+ */
+static void
+virLogBufferDump(virLogBufferPtr buf,
+                 const char *reason)
+{
+    char timestamp[VIR_TIME_STRING_BUFLEN];
+    g_autofree char *header = NULL;
+    size_t chunk = MIN(buf->len, buf->alloc - buf->start);
+
+    if (virTimeStringNowRaw(timestamp) < 0)
+        timestamp[0] = '\0';
+
+    header = g_strdup_printf("%s: ==== log buffer dump (%s), %zu bytes ====\n",
+                             timestamp, reason, buf->len);
+
+    ignore_value(safewrite(buf->fd, header, strlen(header)));
+    ignore_value(safewrite(buf->fd, buf->data + buf->start, chunk));
+    ignore_value(safewrite(buf->fd, buf->data, buf->len - chunk));
+
+    buf->start = 0;
+    buf->len = 0;
+}
+
+
+static void
+virLogCloseBuffer(void *data)
+{
+    virLogBufferPtr buf = data;
+
+    VIR_LOG_CLOSE(buf->fd);
+    g_free(buf->data);
+    g_free(buf);
+}
+
+
+static virLogOutputPtr
+virLogNewOutputToBuffer(virLogPriority priority,
+                        const char *file,
+                        size_t size)
+{
+    virLogBufferPtr buf;
+    virLogOutputPtr ret = NULL;
+    int fd;
+
+    fd = open(file, O_CREAT | O_APPEND | O_WRONLY, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        virReportSystemError(errno, _("failed to open %s"), file);
+        return NULL;
+    }
+
+    buf = g_new0(virLogBuffer, 1);
+    buf->fd = fd;
+    buf->size = size;
+    buf->alloc = size * 1024;
+    buf->data = g_new0(char, buf->alloc);
+
+    if (!(ret = virLogOutputNew(virLogOutputToBuffer, virLogCloseBuffer, buf,
+                                priority, VIR_LOG_TO_BUFFER, file))) {
+        virLogCloseBuffer(buf);
+        return NULL;
+    }
+    return ret;
+}
+
+
+/**
+ * virLogDumpBuffers:
+ * @reason: why the buffers are dumped, recorded in the dump
+ *
+ * Writes the messages kept by all 'buffer' outputs to their files, and
+ * empties the buffers.
+ *
+ * Returns the number of buffers dumped, or -1 on error.
+ */
+int
+virLogDumpBuffers(const char *reason)
+{
+    size_t i;
+    int ret = 0;
+
+    if (virLogInitialize() < 0)
+        return -1;
+
+    virLogLock();
+    for (i = 0; i < virLogNbOutputs; i++) {
+        if (virLogOutputs[i]->dest != VIR_LOG_TO_BUFFER)
+            continue;
+
+        virLogBufferDump(virLogOutputs[i]->data, reason);
+        ret++;
+    }
+    virLogUnlock();
+
+    return ret;
+}
+
+
+static virLogOutputPtr
+virLogNewOutputToTrace(virLogPriority priority,
+                       const char *file)
+{
+    int fd;
+    struct stat sb;
+    virLogOutputPtr ret = NULL;
+
+    fd = open(file, O_CREAT | O_APPEND | O_WRONLY, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        virReportSystemError(errno, _("failed to open %s"), file);
+        return NULL;
+    }
+
+    if (fstat(fd, &sb) < 0 ||
+        (sb.st_size == 0 &&
+         safewrite(fd, VIR_LOG_TRACE_MAGIC,
+                   strlen(VIR_LOG_TRACE_MAGIC)) < 0)) {
+        virReportSystemError(errno, _("failed to initialize %s"), file);
+        VIR_LOG_CLOSE(fd);
+        return NULL;
+    }
+
+    if (!(ret = virLogOutputNew(virLogOutputToTrace, virLogCloseFd,
+                                (void *)(intptr_t)fd,
+                                priority, VIR_LOG_TO_TRACE, file))) {
+        VIR_LOG_CLOSE(fd);
+        return NULL;
+    }
+    ret->raw = true;
+    return ret;
+}
+
+
 #if HAVE_SYSLOG_H || USE_JOURNALD
 
 /* Compat in case we build with journald, but no syslog */
@@ -1110,11 +1702,20 @@ virLogGetOutputs(void)
         switch (dest) {
             case VIR_LOG_TO_SYSLOG:
             case VIR_LOG_TO_FILE:
+            case VIR_LOG_TO_TRACE:
                 virBufferAsprintf(&outputbuf, "%d:%s:%s",
                                   virLogOutputs[i]->priority,
                                   virLogDestinationTypeToString(dest),
                                   virLogOutputs[i]->name);
                 break;
+            case VIR_LOG_TO_BUFFER: {
+                virLogBufferPtr buf = virLogOutputs[i]->data;
+                virBufferAsprintf(&outputbuf, "%d:%s:%s:%zu",
+                                  virLogOutputs[i]->priority,
+                                  virLogDestinationTypeToString(dest),
+                                  virLogOutputs[i]->name, buf->size);
+                break;
+            }
             case VIR_LOG_TO_STDERR:
             case VIR_LOG_TO_JOURNALD:
                 virBufferAsprintf(&outputbuf, "%d:%s",
@@ -1261,7 +1862,8 @@ virLogOutputNew(virLogOutputFunc f,
     virLogOutputPtr ret = NULL;
     char *ndup = NULL;
 
-    if (dest == VIR_LOG_TO_SYSLOG || dest == VIR_LOG_TO_FILE) {
+    if (dest == VIR_LOG_TO_SYSLOG || dest == VIR_LOG_TO_FILE ||
+        dest == VIR_LOG_TO_TRACE || dest == VIR_LOG_TO_BUFFER) {
         if (!name) {
             virReportError(VIR_ERR_INVALID_ARG, "%s",
                            _("Missing auxiliary data in output definition"));
@@ -1453,6 +2055,11 @@ virLogDefineFilters(virLogFilterPtr *filters, size_t nfilters)
  *    x:journald - output is sent to journald
  *    x:syslog:name - output is sent to syslog using 'name' as the message tag
  *    x:file:abs_file_path - output is sent to file specified by 'abs_file_path'
+ *    x:trace:abs_file_path - output is sent in binary trace format to file
+ *                            specified by 'abs_file_path'
+ *    x:buffer:abs_file_path[:size] - output is kept in a memory buffer of
+ *                            'size' KiB, written to 'abs_file_path' when
+ *                            virLogDumpBuffers() is called
  *
  *      'x' - minimal priority level which acts as a filter meaning that only
  *            messages with priority level greater than or equal to 'x' will be
@@ -1476,6 +2083,7 @@ virLogParseOutput(const char *src)
     char *abspath = NULL;
     size_t count = 0;
     virLogPriority prio;
+    unsigned int size;
     int dest;
 
     VIR_DEBUG("output=%s", src);
@@ -1507,7 +2115,9 @@ virLogParseOutput(const char *src)
     if (((dest == VIR_LOG_TO_STDERR ||
           dest == VIR_LOG_TO_JOURNALD) && count != 2) ||
         ((dest == VIR_LOG_TO_FILE ||
-          dest == VIR_LOG_TO_SYSLOG) && count != 3)) {
+          dest == VIR_LOG_TO_TRACE ||
+          dest == VIR_LOG_TO_SYSLOG) && count != 3) ||
+        (dest == VIR_LOG_TO_BUFFER && count != 3 && count != 4)) {
         virReportError(VIR_ERR_INVALID_ARG,
                        _("Output '%s' does not meet the format requirements "
                          "for destination type '%s'"), src, tokens[1]);
@@ -1529,6 +2139,26 @@ virLogParseOutput(const char *src)
         ret = virLogNewOutputToFile(prio, abspath);
         VIR_FREE(abspath);
         break;
+    case VIR_LOG_TO_TRACE:
+        if (virFileAbsPath(tokens[2], &abspath) < 0)
+            goto cleanup;
+        ret = virLogNewOutputToTrace(prio, abspath);
+        VIR_FREE(abspath);
+        break;
+    case VIR_LOG_TO_BUFFER:
+        size = VIR_LOG_BUFFER_DEFAULT_SIZE;
+        if (count == 4 &&
+            (virStrToLong_uip(tokens[3], NULL, 10, &size) < 0 || size == 0)) {
+            virReportError(VIR_ERR_INVALID_ARG,
+                           _("Invalid buffer size '%s' for output '%s'"),
+                           tokens[3], src);
+            goto cleanup;
+        }
+        if (virFileAbsPath(tokens[2], &abspath) < 0)
+            goto cleanup;
+        ret = virLogNewOutputToBuffer(prio, abspath, size);
+        VIR_FREE(abspath);
+        break;
     case VIR_LOG_TO_JOURNALD:
 #if USE_JOURNALD
         ret = virLogNewOutputToJournald(prio);
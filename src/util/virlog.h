@@ -53,6 +53,8 @@ typedef enum {
     VIR_LOG_TO_SYSLOG,
     VIR_LOG_TO_FILE,
     VIR_LOG_TO_JOURNALD,
+    VIR_LOG_TO_TRACE,
+    VIR_LOG_TO_BUFFER,
     VIR_LOG_TO_OUTPUT_LAST,
 } virLogDestination;
 
@@ -105,6 +107,26 @@ struct _virLogMetadata {
 typedef struct _virLogMetadata virLogMetadata;
 typedef struct _virLogMetadata *virLogMetadataPtr;
 
+/*
+ * The 'trace' output writes a compact binary format meant to be decoded
+ * by virt-log-decode: the file starts with VIR_LOG_TRACE_MAGIC followed
+ * by records, each made of a virLogTraceRecord in host byte order and
+ * @len bytes holding the NUL terminated name of the log source, name of
+ * the function and the message.
+ */
+#define VIR_LOG_TRACE_MAGIC "LVTRACE1"
+
+struct _virLogTraceRecord {
+    uint64_t when;      /* milliseconds since the epoch */
+    uint64_t thread;    /* virThreadSelfID() of the emitting thread */
+    uint32_t linenr;
+    uint32_t priority;
+    uint32_t len;
+    uint32_t reserved;
+};
+
+typedef struct _virLogTraceRecord virLogTraceRecord;
+
 typedef struct _virLogOutput virLogOutput;
 typedef virLogOutput *virLogOutputPtr;
 
@@ -168,6 +190,9 @@ void virLogSetDefaultOutput(const char *fname, bool godaemon, bool privileged);
 void virLogLock(void);
 void virLogUnlock(void);
 int virLogReset(void);
+int virLogSetAsync(bool async);
+bool virLogGetAsync(void);
+int virLogDumpBuffers(const char *reason);
 int virLogParseDefaultPriority(const char *priority);
 int virLogPriorityFromSyslog(int priority);
 void virLogMessage(virLogSourcePtr source,
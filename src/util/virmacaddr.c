@@ -185,11 +185,17 @@ const char *
 virMacAddrFormat(const virMacAddr *addr,
                  char *str)
 {
-    g_snprintf(str, VIR_MAC_STRING_BUFLEN,
-               "%02x:%02x:%02x:%02x:%02x:%02x",
-               addr->addr[0], addr->addr[1], addr->addr[2],
-               addr->addr[3], addr->addr[4], addr->addr[5]);
-    str[VIR_MAC_STRING_BUFLEN-1] = '\0';
+    static const char hex[] = "0123456789abcdef";
+    char *out = str;
+    size_t i;
+
+    for (i = 0; i < VIR_MAC_BUFLEN; i++) {
+        if (i > 0)
+            *out++ = ':';
+        *out++ = hex[addr->addr[i] >> 4];
+        *out++ = hex[addr->addr[i] & 0xf];
+    }
+    *out = '\0';
     return str;
 }
 
@@ -269,7 +269,8 @@ int virNetDevOpenvswitchSetMigrateData(char *migrate, const char *ifname)
 
     cmd = virCommandNew(OVS_VSCTL);
     virNetDevOpenvswitchAddTimeout(cmd);
-    virCommandAddArgList(cmd, "set", "Interface", ifname, NULL);
+    /* ovs-vswitchd doesn't act on external_ids, nothing to wait for */
+    virCommandAddArgList(cmd, "--no-wait", "set", "Interface", ifname, NULL);
     virCommandAddArgFormat(cmd, "external_ids:PortData=%s", migrate);
 
     /* Run the command */
@@ -284,29 +285,21 @@ int virNetDevOpenvswitchSetMigrateData(char *migrate, const char *ifname)
 }
 
 
-/**
- * virNetDevOpenvswitchInterfaceParseStats:
- * @json: Input string in JSON format
- * @stats: parsed stats
- *
- * For given input string @json parse interface statistics and store them into
- * @stats.
- *
- * Returns: 0 on success,
- *         -1 otherwise (with error reported).
+/*
+ * Parse the "statistics" column of an OVS interface, a JSON value such
+ * as ["map",[["rx_bytes",0],...]], into @stats.
  */
-int
-virNetDevOpenvswitchInterfaceParseStats(const char *json,
-                                        virDomainInterfaceStatsPtr stats)
+static int
+virNetDevOpenvswitchInterfaceParseStatsMap(virJSONValuePtr jsonStats,
+                                           virDomainInterfaceStatsPtr stats)
 {
-    g_autoptr(virJSONValue) jsonStats = NULL;
     virJSONValuePtr jsonMap = NULL;
     size_t i;
 
     stats->rx_bytes = stats->rx_packets = stats->rx_errs = stats->rx_drop = -1;
     stats->tx_bytes = stats->tx_packets = stats->tx_errs = stats->tx_drop = -1;
 
-    if (!(jsonStats = virJSONValueFromString(json)) ||
+    if (!jsonStats ||
         !virJSONValueIsArray(jsonStats) ||
         !(jsonMap = virJSONValueArrayGet(jsonStats, 1))) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -357,6 +350,107 @@ virNetDevOpenvswitchInterfaceParseStats(const char *json,
     return 0;
 }
 
+
+/*
+ * Report an error if none of the statistics of an interface is known.
+ */
+static int
+virNetDevOpenvswitchInterfaceCheckStats(const virDomainInterfaceStatsStruct *stats)
+{
+    if (stats->rx_bytes == -1 &&
+        stats->rx_packets == -1 &&
+        stats->rx_errs == -1 &&
+        stats->rx_drop == -1 &&
+        stats->tx_bytes == -1 &&
+        stats->tx_packets == -1 &&
+        stats->tx_errs == -1 &&
+        stats->tx_drop == -1) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Interface doesn't have any statistics"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * virNetDevOpenvswitchInterfaceParseStats:
+ * @json: Input string in JSON format
+ * @stats: parsed stats
+ *
+ * For given input string @json parse interface statistics and store them into
+ * @stats.
+ *
+ * Returns: 0 on success,
+ *         -1 otherwise (with error reported).
+ */
+int
+virNetDevOpenvswitchInterfaceParseStats(const char *json,
+                                        virDomainInterfaceStatsPtr stats)
+{
+    g_autoptr(virJSONValue) jsonStats = virJSONValueFromString(json);
+
+    return virNetDevOpenvswitchInterfaceParseStatsMap(jsonStats, stats);
+}
+
+
+/**
+ * virNetDevOpenvswitchInterfaceParseStatsTable:
+ * @json: output of 'ovs-vsctl --format=json --columns=name,statistics
+ *        list Interface'
+ *
+ * Parse the statistics of all interfaces listed in @json, which looks
+ * like {"data":[["vnet0",["map",[["rx_bytes",0],...]]],...],
+ * "headings":["name","statistics"]}.
+ *
+ * Returns a table of virDomainInterfaceStats keyed by the interface
+ * name, or NULL with error reported.
+ */
+virHashTablePtr
+virNetDevOpenvswitchInterfaceParseStatsTable(const char *json)
+{
+    g_autoptr(virHashTable) table = NULL;
+    g_autoptr(virJSONValue) jsonList = NULL;
+    virJSONValuePtr jsonData;
+    size_t i;
+
+    if (!(jsonList = virJSONValueFromString(json)) ||
+        !(jsonData = virJSONValueObjectGetArray(jsonList, "data"))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Unable to parse ovs-vsctl output"));
+        return NULL;
+    }
+
+    if (!(table = virHashCreate(32, g_free)))
+        return NULL;
+
+    for (i = 0; i < virJSONValueArraySize(jsonData); i++) {
+        virJSONValuePtr row = virJSONValueArrayGet(jsonData, i);
+        g_autofree virDomainInterfaceStatsPtr stats = NULL;
+        virJSONValuePtr jsonName;
+        const char *name;
+
+        if (!row ||
+            !(jsonName = virJSONValueArrayGet(row, 0)) ||
+            !(name = virJSONValueGetString(jsonName))) {
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("Malformed ovs-vsctl output"));
+            return NULL;
+        }
+
+        stats = g_new0(virDomainInterfaceStatsStruct, 1);
+        if (virNetDevOpenvswitchInterfaceParseStatsMap(virJSONValueArrayGet(row, 1),
+                                                       stats) < 0 ||
+            virHashUpdateEntry(table, name, stats) < 0)
+            return NULL;
+        stats = NULL;
+    }
+
+    return g_steal_pointer(&table);
+}
+
+
 /**
  * virNetDevOpenvswitchInterfaceStats:
  * @ifname: the name of the interface
@@ -399,20 +493,65 @@ virNetDevOpenvswitchInterfaceStats(const char *ifname,
     if (virNetDevOpenvswitchInterfaceParseStats(output, stats) < 0)
         return -1;
 
-    if (stats->rx_bytes == -1 &&
-        stats->rx_packets == -1 &&
-        stats->rx_errs == -1 &&
-        stats->rx_drop == -1 &&
-        stats->tx_bytes == -1 &&
-        stats->tx_packets == -1 &&
-        stats->tx_errs == -1 &&
-        stats->tx_drop == -1) {
+    return virNetDevOpenvswitchInterfaceCheckStats(stats);
+}
+
+
+/**
+ * virNetDevOpenvswitchInterfaceStatsTable:
+ *
+ * Retrieves the stats of all OVS interfaces with a single ovs-vsctl
+ * call, for callers that need the stats of many interfaces. Use
+ * virNetDevOpenvswitchInterfaceStatsLookup to get the stats of a single
+ * interface from the returned table.
+ *
+ * Returns the table, or NULL in case of failure
+ */
+virHashTablePtr
+virNetDevOpenvswitchInterfaceStatsTable(void)
+{
+    g_autoptr(virCommand) cmd = NULL;
+    g_autofree char *output = NULL;
+
+    cmd = virCommandNew(OVS_VSCTL);
+    virNetDevOpenvswitchAddTimeout(cmd);
+    virCommandAddArgList(cmd, "--format=json", "--columns=name,statistics",
+                         "list", "Interface", NULL);
+    virCommandSetOutputBuffer(cmd, &output);
+
+    if (virCommandRun(cmd, NULL) < 0)
+        return NULL;
+
+    return virNetDevOpenvswitchInterfaceParseStatsTable(output);
+}
+
+
+/**
+ * virNetDevOpenvswitchInterfaceStatsLookup:
+ * @table: stats returned by virNetDevOpenvswitchInterfaceStatsTable
+ * @ifname: the name of the interface
+ * @stats: the retrieved domain interface stat
+ *
+ * Like virNetDevOpenvswitchInterfaceStats, but takes the stats of
+ * @ifname from @table.
+ *
+ * Returns 0 in case of success or -1 in case of failure
+ */
+int
+virNetDevOpenvswitchInterfaceStatsLookup(virHashTablePtr table,
+                                         const char *ifname,
+                                         virDomainInterfaceStatsPtr stats)
+{
+    virDomainInterfaceStatsPtr found;
+
+    if (!(found = virHashLookup(table, ifname))) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Interface doesn't have any statistics"));
+                       _("Interface not found"));
         return -1;
     }
 
-    return 0;
+    *stats = *found;
+    return virNetDevOpenvswitchInterfaceCheckStats(stats);
 }
 
 
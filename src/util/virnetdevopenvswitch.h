@@ -23,6 +23,7 @@
 #include "internal.h"
 #include "virnetdevvportprofile.h"
 #include "virnetdevvlan.h"
+#include "virhash.h"
 
 #define VIR_NETDEV_OVS_DEFAULT_TIMEOUT 5
 
@@ -53,10 +54,21 @@ int virNetDevOpenvswitchInterfaceParseStats(const char *json,
                                             virDomainInterfaceStatsPtr stats)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 
+virHashTablePtr virNetDevOpenvswitchInterfaceParseStatsTable(const char *json)
+    ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
+
 int virNetDevOpenvswitchInterfaceStats(const char *ifname,
                                        virDomainInterfaceStatsPtr stats)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 
+virHashTablePtr virNetDevOpenvswitchInterfaceStatsTable(void)
+    G_GNUC_WARN_UNUSED_RESULT;
+
+int virNetDevOpenvswitchInterfaceStatsLookup(virHashTablePtr table,
+                                             const char *ifname,
+                                             virDomainInterfaceStatsPtr stats)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) G_GNUC_WARN_UNUSED_RESULT;
+
 int virNetDevOpenvswitchInterfaceGetMaster(const char *ifname, char **master)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 
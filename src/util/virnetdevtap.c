@@ -733,6 +733,61 @@ int virNetDevTapCreateInBridgePort(const char *brname,
 
 /*-------------------- interface stats --------------------*/
 
+/*
+ * Copy the statistics of an interface as seen by the host from @src
+ * to @dst, swapping RX/TX if @swapped.
+ */
+static void
+virNetDevTapInterfaceStatsCopy(virDomainInterfaceStatsPtr dst,
+                               const virDomainInterfaceStatsStruct *src,
+                               bool swapped)
+{
+    if (swapped) {
+        dst->rx_bytes = src->tx_bytes;
+        dst->rx_packets = src->tx_packets;
+        dst->rx_errs = src->tx_errs;
+        dst->rx_drop = src->tx_drop;
+        dst->tx_bytes = src->rx_bytes;
+        dst->tx_packets = src->rx_packets;
+        dst->tx_errs = src->rx_errs;
+        dst->tx_drop = src->rx_drop;
+    } else {
+        *dst = *src;
+    }
+}
+
+#ifdef __linux__
+/*
+ * Parse a line of /proc/net/dev, which looks like "   eth0: ...",
+ * into @stats. Returns the interface name within @line, or NULL if
+ * @line doesn't hold the statistics of an interface.
+ */
+static char *
+virNetDevTapParseProcNetDev(char *line,
+                            virDomainInterfaceStatsPtr stats)
+{
+    long long dummy;
+    char *colon;
+
+    /* Split it at the colon. */
+    if (!(colon = strchr(line, ':')))
+        return NULL;
+    *colon = '\0';
+
+    if (sscanf(colon + 1,
+               "%lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld",
+               &stats->rx_bytes, &stats->rx_packets,
+               &stats->rx_errs, &stats->rx_drop,
+               &dummy, &dummy, &dummy, &dummy,
+               &stats->tx_bytes, &stats->tx_packets,
+               &stats->tx_errs, &stats->tx_drop,
+               &dummy, &dummy, &dummy, &dummy) != 16)
+        return NULL;
+
+    return line + strspn(line, " ");
+}
+#endif /* __linux__ */
+
 /**
  * virNetDevTapInterfaceStats:
  * @ifname: interface
@@ -754,9 +809,8 @@ virNetDevTapInterfaceStats(const char *ifname,
                            virDomainInterfaceStatsPtr stats,
                            bool swapped)
 {
-    int ifname_len;
     FILE *fp;
-    char line[256], *colon;
+    char line[256];
 
     if (!ifname) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -771,56 +825,12 @@ virNetDevTapInterfaceStats(const char *ifname,
         return -1;
     }
 
-    ifname_len = strlen(ifname);
-
     while (fgets(line, sizeof(line), fp)) {
-        long long dummy;
-        long long rx_bytes;
-        long long rx_packets;
-        long long rx_errs;
-        long long rx_drop;
-        long long tx_bytes;
-        long long tx_packets;
-        long long tx_errs;
-        long long tx_drop;
-
-        /* The line looks like:
-         *   "   eth0:..."
-         * Split it at the colon.
-         */
-        colon = strchr(line, ':');
-        if (!colon) continue;
-        *colon = '\0';
-        if (colon-ifname_len >= line &&
-            STREQ(colon-ifname_len, ifname)) {
-            if (sscanf(colon+1,
-                       "%lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld",
-                       &rx_bytes, &rx_packets, &rx_errs, &rx_drop,
-                       &dummy, &dummy, &dummy, &dummy,
-                       &tx_bytes, &tx_packets, &tx_errs, &tx_drop,
-                       &dummy, &dummy, &dummy, &dummy) != 16)
-                continue;
-
-            if (swapped) {
-                stats->rx_bytes = tx_bytes;
-                stats->rx_packets = tx_packets;
-                stats->rx_errs = tx_errs;
-                stats->rx_drop = tx_drop;
-                stats->tx_bytes = rx_bytes;
-                stats->tx_packets = rx_packets;
-                stats->tx_errs = rx_errs;
-                stats->tx_drop = rx_drop;
-            } else {
-                stats->rx_bytes = rx_bytes;
-                stats->rx_packets = rx_packets;
-                stats->rx_errs = rx_errs;
-                stats->rx_drop = rx_drop;
-                stats->tx_bytes = tx_bytes;
-                stats->tx_packets = tx_packets;
-                stats->tx_errs = tx_errs;
-                stats->tx_drop = tx_drop;
-            }
+        virDomainInterfaceStatsStruct tmp;
+        const char *name = virNetDevTapParseProcNetDev(line, &tmp);
 
+        if (name && STREQ(name, ifname)) {
+            virNetDevTapInterfaceStatsCopy(stats, &tmp, swapped);
             VIR_FORCE_FCLOSE(fp);
             return 0;
         }
@@ -837,9 +847,7 @@ virNetDevTapInterfaceStats(const char *ifname,
                            virDomainInterfaceStatsPtr stats,
                            bool swapped)
 {
-    struct ifaddrs *ifap, *ifa;
-    struct if_data *ifd;
-    int ret = -1;
+    g_autoptr(virHashTable) table = NULL;
 
     if (!ifname) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -847,70 +855,166 @@ virNetDevTapInterfaceStats(const char *ifname,
         return -1;
     }
 
+    if (!(table = virNetDevTapInterfaceStatsTable()))
+        return -1;
+
+    return virNetDevTapInterfaceStatsLookup(table, ifname, stats, swapped);
+}
+#else
+int
+virNetDevTapInterfaceStats(const char *ifname G_GNUC_UNUSED,
+                           virDomainInterfaceStatsPtr stats G_GNUC_UNUSED,
+                           bool swapped G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                   _("interface stats not implemented on this platform"));
+    return -1;
+}
+
+#endif /* __linux__ */
+
+
+/**
+ * virNetDevTapInterfaceStatsTable:
+ *
+ * Fetch RX/TX statistics of all interfaces of the host at once, for
+ * callers that need the statistics of many interfaces. Use
+ * virNetDevTapInterfaceStatsLookup to get the statistics of a single
+ * interface from the returned table.
+ *
+ * Returns the table, or NULL on error (with error reported).
+ */
+#ifdef __linux__
+virHashTablePtr
+virNetDevTapInterfaceStatsTable(void)
+{
+    g_autoptr(virHashTable) table = NULL;
+    FILE *fp;
+    char line[256];
+
+    if (!(table = virHashCreate(32, g_free)))
+        return NULL;
+
+    fp = fopen("/proc/net/dev", "r");
+    if (!fp) {
+        virReportSystemError(errno, "%s",
+                             _("Could not open /proc/net/dev"));
+        return NULL;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        g_autofree virDomainInterfaceStatsPtr stats = NULL;
+        const char *name;
+
+        stats = g_new0(virDomainInterfaceStatsStruct, 1);
+        if (!(name = virNetDevTapParseProcNetDev(line, stats)))
+            continue;
+
+        if (virHashUpdateEntry(table, name, stats) < 0) {
+            VIR_FORCE_FCLOSE(fp);
+            return NULL;
+        }
+        stats = NULL;
+    }
+    VIR_FORCE_FCLOSE(fp);
+
+    return g_steal_pointer(&table);
+}
+#elif defined(HAVE_GETIFADDRS) && defined(AF_LINK)
+virHashTablePtr
+virNetDevTapInterfaceStatsTable(void)
+{
+    g_autoptr(virHashTable) table = NULL;
+    struct ifaddrs *ifap, *ifa;
+    struct if_data *ifd;
+
+    if (!(table = virHashCreate(32, g_free)))
+        return NULL;
+
     if (getifaddrs(&ifap) < 0) {
         virReportSystemError(errno, "%s",
                              _("Could not get interface list"));
-        return -1;
+        return NULL;
     }
 
     for (ifa = ifap; ifa; ifa = ifa->ifa_next) {
+        g_autofree virDomainInterfaceStatsPtr stats = NULL;
+
         if (!ifa->ifa_addr)
             continue;
 
         if (ifa->ifa_addr->sa_family != AF_LINK)
             continue;
 
-        if (STREQ(ifa->ifa_name, ifname)) {
-            ifd = (struct if_data *)ifa->ifa_data;
-            if (swapped) {
-                stats->tx_bytes = ifd->ifi_ibytes;
-                stats->tx_packets = ifd->ifi_ipackets;
-                stats->tx_errs = ifd->ifi_ierrors;
-                stats->tx_drop = ifd->ifi_iqdrops;
-                stats->rx_bytes = ifd->ifi_obytes;
-                stats->rx_packets = ifd->ifi_opackets;
-                stats->rx_errs = ifd->ifi_oerrors;
-# ifdef HAVE_STRUCT_IF_DATA_IFI_OQDROPS
-                stats->rx_drop = ifd->ifi_oqdrops;
-# else
-                stats->rx_drop = 0;
-# endif
-            } else {
-                stats->tx_bytes = ifd->ifi_obytes;
-                stats->tx_packets = ifd->ifi_opackets;
-                stats->tx_errs = ifd->ifi_oerrors;
+        ifd = (struct if_data *)ifa->ifa_data;
+        stats = g_new0(virDomainInterfaceStatsStruct, 1);
+
+        stats->tx_bytes = ifd->ifi_obytes;
+        stats->tx_packets = ifd->ifi_opackets;
+        stats->tx_errs = ifd->ifi_oerrors;
 # ifdef HAVE_STRUCT_IF_DATA_IFI_OQDROPS
-                stats->tx_drop = ifd->ifi_oqdrops;
+        stats->tx_drop = ifd->ifi_oqdrops;
 # else
-                stats->tx_drop = 0;
+        stats->tx_drop = 0;
 # endif
-                stats->rx_bytes = ifd->ifi_ibytes;
-                stats->rx_packets = ifd->ifi_ipackets;
-                stats->rx_errs = ifd->ifi_ierrors;
-                stats->rx_drop = ifd->ifi_iqdrops;
-            }
-
-            ret = 0;
-            break;
+        stats->rx_bytes = ifd->ifi_ibytes;
+        stats->rx_packets = ifd->ifi_ipackets;
+        stats->rx_errs = ifd->ifi_ierrors;
+        stats->rx_drop = ifd->ifi_iqdrops;
+
+        if (virHashUpdateEntry(table, ifa->ifa_name, stats) < 0) {
+            freeifaddrs(ifap);
+            return NULL;
         }
+        stats = NULL;
     }
 
-    if (ret < 0)
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("Interface not found"));
-
     freeifaddrs(ifap);
-    return ret;
+    return g_steal_pointer(&table);
 }
 #else
-int
-virNetDevTapInterfaceStats(const char *ifname G_GNUC_UNUSED,
-                           virDomainInterfaceStatsPtr stats G_GNUC_UNUSED,
-                           bool swapped G_GNUC_UNUSED)
+virHashTablePtr
+virNetDevTapInterfaceStatsTable(void)
 {
     virReportError(VIR_ERR_OPERATION_INVALID, "%s",
                    _("interface stats not implemented on this platform"));
-    return -1;
+    return NULL;
 }
-
 #endif /* __linux__ */
+
+
+/**
+ * virNetDevTapInterfaceStatsLookup:
+ * @table: statistics returned by virNetDevTapInterfaceStatsTable
+ * @ifname: interface
+ * @stats: where to store statistics
+ * @swapped: whether to swap RX/TX fields
+ *
+ * Like virNetDevTapInterfaceStats, but takes the statistics of
+ * @ifname from @table.
+ *
+ * Returns 0 on success, -1 otherwise (with error reported).
+ */
+int
+virNetDevTapInterfaceStatsLookup(virHashTablePtr table,
+                                 const char *ifname,
+                                 virDomainInterfaceStatsPtr stats,
+                                 bool swapped)
+{
+    virDomainInterfaceStatsPtr found;
+
+    if (!ifname) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Interface name not provided"));
+        return -1;
+    }
+
+    if (!(found = virHashLookup(table, ifname))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Interface not found"));
+        return -1;
+    }
+
+    virNetDevTapInterfaceStatsCopy(stats, found, swapped);
+    return 0;
+}
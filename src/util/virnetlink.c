@@ -90,6 +90,47 @@ static int nextWatch = 1;
 static virNetlinkEventSrvPrivatePtr server[MAX_LINKS] = {NULL};
 static virNetlinkHandle *placeholder_nlhandle;
 
+/* Netlink sockets a thread keeps open for its next request to the
+ * kernel, one per protocol, so that bursts of requests don't pay for
+ * creating and binding a socket each time. */
+typedef struct _virNetlinkSocketCache virNetlinkSocketCache;
+typedef virNetlinkSocketCache *virNetlinkSocketCachePtr;
+struct _virNetlinkSocketCache {
+    pid_t pid; /* the sockets are not shared with forked children */
+    virNetlinkHandle *handles[MAX_LINKS];
+};
+
+static virThreadLocal virNetlinkSocketCacheLocal;
+
+static void
+virNetlinkSocketCacheFree(void *opaque)
+{
+    virNetlinkSocketCachePtr cache = opaque;
+    size_t i;
+
+    if (!cache)
+        return;
+
+    for (i = 0; i < MAX_LINKS; i++)
+        virNetlinkFree(cache->handles[i]);
+    g_free(cache);
+}
+
+static int
+virNetlinkSocketCacheOnceInit(void)
+{
+    if (virThreadLocalInit(&virNetlinkSocketCacheLocal,
+                           virNetlinkSocketCacheFree) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("Cannot initialize thread local for netlink sockets"));
+        return -1;
+    }
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virNetlinkSocketCache);
+
 /* Function definitions */
 
 /**
@@ -193,10 +234,90 @@ virNetlinkCreateSocket(int protocol)
     return NULL;
 }
 
+/*
+ * Discard whatever an earlier user of @nlhandle left unread.
+ */
+static void
+virNetlinkDrainSocket(virNetlinkHandle *nlhandle)
+{
+    char buf[4096];
+    int fd = nl_socket_get_fd(nlhandle);
+
+    while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+        ;
+}
+
+/*
+ * Get a socket for sending a request with @protocol to the kernel,
+ * reusing the one the calling thread kept from an earlier request
+ * if there is any.
+ */
+static virNetlinkHandle *
+virNetlinkAcquireSocket(unsigned int protocol, bool cacheable)
+{
+    virNetlinkSocketCachePtr cache;
+    virNetlinkHandle *nlhandle;
+
+    if (!cacheable ||
+        virNetlinkSocketCacheInitialize() < 0 ||
+        !(cache = virThreadLocalGet(&virNetlinkSocketCacheLocal)) ||
+        cache->pid != getpid() ||
+        !cache->handles[protocol])
+        return virNetlinkCreateSocket(protocol);
+
+    nlhandle = g_steal_pointer(&cache->handles[protocol]);
+    virNetlinkDrainSocket(nlhandle);
+
+    return nlhandle;
+}
+
+/*
+ * Return @nlhandle acquired with virNetlinkAcquireSocket. It is kept
+ * for the next request of the calling thread if @reuse is true and
+ * the thread doesn't keep a socket for @protocol yet, and freed
+ * otherwise.
+ */
+static void
+virNetlinkReleaseSocket(virNetlinkHandle *nlhandle, unsigned int protocol,
+                        bool reuse)
+{
+    virNetlinkSocketCachePtr cache;
+
+    if (!nlhandle)
+        return;
+
+    if (!reuse || virNetlinkSocketCacheInitialize() < 0)
+        goto error;
+
+    if (!(cache = virThreadLocalGet(&virNetlinkSocketCacheLocal))) {
+        cache = g_new0(virNetlinkSocketCache, 1);
+        cache->pid = getpid();
+        if (virThreadLocalSet(&virNetlinkSocketCacheLocal, cache) < 0) {
+            g_free(cache);
+            goto error;
+        }
+    }
+
+    if (cache->pid != getpid() || cache->handles[protocol])
+        goto error;
+
+    cache->handles[protocol] = nlhandle;
+    return;
+
+ error:
+    virNetlinkFree(nlhandle);
+}
+
+/*
+ * Send @nl_msg on a socket acquired with virNetlinkAcquireSocket and
+ * wait for the response. @reuse is set to whether the socket may be
+ * kept for further requests once the response is read.
+ */
 static virNetlinkHandle *
 virNetlinkSendRequest(struct nl_msg *nl_msg, uint32_t src_pid,
                       struct sockaddr_nl nladdr,
-                      unsigned int protocol, unsigned int groups)
+                      unsigned int protocol, unsigned int groups,
+                      bool *reuse)
 {
     ssize_t nbytes;
     int fd;
@@ -205,13 +326,16 @@ virNetlinkSendRequest(struct nl_msg *nl_msg, uint32_t src_pid,
     struct pollfd fds[1];
     struct nlmsghdr *nlmsg = nlmsg_hdr(nl_msg);
 
+    /* Only plain requests to the kernel leave a socket as they found it */
+    *reuse = groups == 0 && nladdr.nl_pid == 0 && src_pid == 0;
+
     if (protocol >= MAX_LINKS) {
         virReportSystemError(EINVAL,
                              _("invalid protocol argument: %d"), protocol);
         goto error;
     }
 
-    if (!(nlhandle = virNetlinkCreateSocket(protocol)))
+    if (!(nlhandle = virNetlinkAcquireSocket(protocol, *reuse)))
         goto error;
 
     fd = nl_socket_get_fd(nlhandle);
@@ -245,6 +369,7 @@ virNetlinkSendRequest(struct nl_msg *nl_msg, uint32_t src_pid,
 
     n = poll(fds, G_N_ELEMENTS(fds), NETLINK_ACK_TIMEOUT_S);
     if (n <= 0) {
+        *reuse = false;
         if (n < 0)
             virReportSystemError(errno, "%s",
                                  _("error in poll call"));
@@ -287,26 +412,33 @@ int virNetlinkCommand(struct nl_msg *nl_msg,
     };
     struct pollfd fds[1];
     g_autofree struct nlmsghdr *temp_resp = NULL;
-    g_autoptr(virNetlinkHandle) nlhandle = NULL;
+    virNetlinkHandle *nlhandle = NULL;
+    bool reuse;
     int len = 0;
 
     memset(fds, 0, sizeof(fds));
 
     if (!(nlhandle = virNetlinkSendRequest(nl_msg, src_pid, nladdr,
-                                           protocol, groups)))
+                                           protocol, groups, &reuse)))
         return -1;
 
+    /* the rest of a dump would keep the kernel busy replying to us */
+    if (nlmsg_hdr(nl_msg)->nlmsg_flags & NLM_F_DUMP)
+        reuse = false;
+
     len = nl_recv(nlhandle, &nladdr, (unsigned char **)&temp_resp, NULL);
-    if (len == 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("nl_recv failed - returned 0 bytes"));
-        return -1;
-    }
-    if (len < 0) {
-        virReportSystemError(errno, "%s", _("nl_recv failed"));
+    if (len <= 0) {
+        if (len == 0)
+            virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                           _("nl_recv failed - returned 0 bytes"));
+        else
+            virReportSystemError(errno, "%s", _("nl_recv failed"));
+        virNetlinkReleaseSocket(nlhandle, protocol, false);
         return -1;
     }
 
+    virNetlinkReleaseSocket(nlhandle, protocol, reuse);
+
     *resp = g_steal_pointer(&temp_resp);
     *respbuflen = len;
     return 0;
@@ -328,10 +460,11 @@ virNetlinkDumpCommand(struct nl_msg *nl_msg,
             .nl_pid    = dst_pid,
             .nl_groups = 0,
     };
-    g_autoptr(virNetlinkHandle) nlhandle = NULL;
+    virNetlinkHandle *nlhandle = NULL;
+    bool reuse;
 
     if (!(nlhandle = virNetlinkSendRequest(nl_msg, src_pid, nladdr,
-                                           protocol, groups)))
+                                           protocol, groups, &reuse)))
         return -1;
 
     while (!end) {
@@ -344,14 +477,15 @@ virNetlinkDumpCommand(struct nl_msg *nl_msg,
             if (msg->nlmsg_type == NLMSG_DONE)
                 end = true;
 
-            if (virNetlinkGetErrorCode(msg, len) < 0)
-                return -1;
-
-            if (callback(msg, opaque) < 0)
+            if (virNetlinkGetErrorCode(msg, len) < 0 ||
+                callback(msg, opaque) < 0) {
+                virNetlinkReleaseSocket(nlhandle, protocol, false);
                 return -1;
+            }
         }
     }
 
+    virNetlinkReleaseSocket(nlhandle, protocol, reuse);
     return 0;
 }
 
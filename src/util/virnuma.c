@@ -1040,3 +1040,269 @@ virNumaGetHostMemoryNodeset(void)
 
     return nodeset;
 }
+
+
+/**
+ * virNumaGetPlacementNodes:
+ * @page_size: page size backing the guest memory in KiB, 0 for the system one
+ * @nodes: returns the list of host NUMA nodes
+ * @nnodes: returns the count of items in @nodes
+ *
+ * Gather the data virNumaSelectPlacement() needs for every online host NUMA
+ * node: count of CPUs and free memory in pages of @page_size. The @load and
+ * @local members are left to the caller to fill in.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virNumaGetPlacementNodes(unsigned int page_size,
+                         virNumaPlacementNodePtr *nodes,
+                         size_t *nnodes)
+{
+    g_autofree virNumaPlacementNodePtr ret = NULL;
+    size_t nret = 0;
+    int maxnode;
+    size_t i;
+
+    *nodes = NULL;
+    *nnodes = 0;
+
+    if ((maxnode = virNumaGetMaxNode()) < 0)
+        return -1;
+
+    if (page_size == 0)
+        page_size = virGetSystemPageSize() / 1024;
+
+    ret = g_new0(virNumaPlacementNode, maxnode + 1);
+
+    for (i = 0; i <= maxnode; i++) {
+        g_autoptr(virBitmap) cpus = NULL;
+        unsigned long long page_free;
+        int ncpus;
+
+        if (!virNumaNodeIsAvailable(i))
+            continue;
+
+        if ((ncpus = virNumaGetNodeCPUs(i, &cpus)) == -2)
+            continue;
+        if (ncpus < 0)
+            return -1;
+
+        if (virNumaGetPageInfo(i, page_size, 0, NULL, &page_free) < 0)
+            return -1;
+
+        ret[nret].node = i;
+        ret[nret].ncpus = ncpus;
+        ret[nret].memfree = page_free * page_size;
+        nret++;
+    }
+
+    *nodes = g_steal_pointer(&ret);
+    *nnodes = nret;
+    return 0;
+}
+
+
+static unsigned int
+virNumaPlacementNodeSpare(const virNumaPlacementNode *node)
+{
+    return node->ncpus > node->load ? node->ncpus - node->load : 0;
+}
+
+
+static int
+virNumaPlacementNodeCompare(const void *a, const void *b)
+{
+    const virNumaPlacementNode *na = a;
+    const virNumaPlacementNode *nb = b;
+    unsigned int sparea = virNumaPlacementNodeSpare(na);
+    unsigned int spareb = virNumaPlacementNodeSpare(nb);
+
+    if (na->local != nb->local)
+        return na->local ? -1 : 1;
+
+    if (sparea != spareb)
+        return sparea > spareb ? -1 : 1;
+
+    if (na->memfree != nb->memfree)
+        return na->memfree > nb->memfree ? -1 : 1;
+
+    return na->node - nb->node;
+}
+
+
+/**
+ * virNumaSelectPlacement:
+ * @nodes: list of host NUMA nodes to choose from
+ * @nnodes: count of items in @nodes
+ * @ncpus: count of CPUs the guest needs
+ * @memory: memory the guest needs in KiB
+ *
+ * Pick the host NUMA nodes for a guest. Nodes with host devices of the guest
+ * attached are preferred, followed by the ones with most CPUs not yet claimed
+ * by other guests and then by the ones with most free memory. A single node
+ * fitting the whole guest wins, otherwise nodes are added in the order of
+ * preference until there's enough of both CPUs and memory. If the nodes can't
+ * fit the guest without overcommitting CPUs, the load of the nodes is
+ * ignored. If even that doesn't help, all nodes are returned.
+ *
+ * Returns the bitmap of selected nodes on success, NULL on error.
+ */
+virBitmapPtr
+virNumaSelectPlacement(const virNumaPlacementNode *nodes,
+                       size_t nnodes,
+                       unsigned int ncpus,
+                       unsigned long long memory)
+{
+    g_autofree virNumaPlacementNodePtr sorted = NULL;
+    g_autoptr(virBitmap) ret = NULL;
+    int maxnode = -1;
+    size_t pass;
+    size_t i;
+
+    if (nnodes == 0) {
+        virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                       _("no host NUMA nodes available for placement"));
+        return NULL;
+    }
+
+    sorted = g_new0(virNumaPlacementNode, nnodes);
+    memcpy(sorted, nodes, sizeof(*nodes) * nnodes);
+    qsort(sorted, nnodes, sizeof(*sorted), virNumaPlacementNodeCompare);
+
+    for (i = 0; i < nnodes; i++)
+        maxnode = MAX(maxnode, nodes[i].node);
+
+    if (!(ret = virBitmapNew(maxnode + 1)))
+        return NULL;
+
+    /* First pass takes the load of nodes into account, second doesn't. */
+    for (pass = 0; pass < 2; pass++) {
+        unsigned long long summem = 0;
+        unsigned int sumcpus = 0;
+
+        for (i = 0; i < nnodes; i++) {
+            unsigned int avail = pass == 0 ?
+                virNumaPlacementNodeSpare(&sorted[i]) : sorted[i].ncpus;
+
+            if (avail >= ncpus && sorted[i].memfree >= memory) {
+                virBitmapClearAll(ret);
+                ignore_value(virBitmapSetBit(ret, sorted[i].node));
+                return g_steal_pointer(&ret);
+            }
+        }
+
+        virBitmapClearAll(ret);
+        for (i = 0; i < nnodes; i++) {
+            ignore_value(virBitmapSetBit(ret, sorted[i].node));
+            sumcpus += pass == 0 ?
+                virNumaPlacementNodeSpare(&sorted[i]) : sorted[i].ncpus;
+            summem += sorted[i].memfree;
+
+            if (sumcpus >= ncpus && summem >= memory)
+                return g_steal_pointer(&ret);
+        }
+    }
+
+    VIR_DEBUG("Host NUMA nodes can't fit %u CPUs and %llu KiB, using all",
+              ncpus, memory);
+    return g_steal_pointer(&ret);
+}
+
+
+/**
+ * virNumaParseProcessMemory:
+ * @maps: contents of /proc/$PID/numa_maps
+ * @memory: returns the memory on each host NUMA node in KiB, indexed by node
+ * @nmemory: returns the count of items in @memory
+ *
+ * Sum up the pages each mapping listed in @maps has on the host NUMA nodes.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virNumaParseProcessMemory(const char *maps,
+                          unsigned long long **memory,
+                          size_t *nmemory)
+{
+    g_autofree unsigned long long *ret = NULL;
+    size_t nret = 0;
+    g_auto(GStrv) lines = NULL;
+    size_t i;
+    size_t j;
+
+    *memory = NULL;
+    *nmemory = 0;
+
+    lines = g_strsplit(maps, "\n", 0);
+
+    for (i = 0; lines[i]; i++) {
+        g_auto(GStrv) fields = g_strsplit(lines[i], " ", 0);
+        unsigned long long pagesize = 4;
+
+        for (j = 0; fields[j]; j++) {
+            const char *val;
+
+            if ((val = STRSKIP(fields[j], "kernelpagesize_kB=")) &&
+                virStrToLong_ull(val, NULL, 10, &pagesize) < 0)
+                goto error;
+        }
+
+        for (j = 0; fields[j]; j++) {
+            unsigned int node;
+            unsigned long long pages;
+            char *end;
+
+            if (fields[j][0] != 'N' ||
+                virStrToLong_ui(fields[j] + 1, &end, 10, &node) < 0 ||
+                *end != '=')
+                continue;
+
+            if (virStrToLong_ull(end + 1, NULL, 10, &pages) < 0)
+                goto error;
+
+            if (node >= nret &&
+                VIR_EXPAND_N(ret, nret, node + 1 - nret) < 0)
+                return -1;
+
+            ret[node] += pages * pagesize;
+        }
+    }
+
+    *memory = g_steal_pointer(&ret);
+    *nmemory = nret;
+    return 0;
+
+ error:
+    virReportError(VIR_ERR_INTERNAL_ERROR,
+                   _("unable to parse numa_maps line '%s'"), lines[i]);
+    return -1;
+}
+
+
+/**
+ * virNumaGetProcessMemory:
+ * @pid: process ID
+ * @memory: returns the memory on each host NUMA node in KiB, indexed by node
+ * @nmemory: returns the count of items in @memory
+ *
+ * Get the memory process @pid has on the host NUMA nodes as reported by
+ * /proc/$PID/numa_maps.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virNumaGetProcessMemory(pid_t pid,
+                        unsigned long long **memory,
+                        size_t *nmemory)
+{
+    g_autofree char *path = NULL;
+    g_autofree char *maps = NULL;
+
+    path = g_strdup_printf("/proc/%lld/numa_maps", (long long) pid);
+
+    if (virFileReadAll(path, 16 * 1024 * 1024, &maps) < 0)
+        return -1;
+
+    return virNumaParseProcessMemory(maps, memory, nmemory);
+}
@@ -28,6 +28,31 @@
 char *virNumaGetAutoPlacementAdvice(unsigned short vcpus,
                                     unsigned long long balloon);
 
+typedef struct _virNumaPlacementNode virNumaPlacementNode;
+typedef virNumaPlacementNode *virNumaPlacementNodePtr;
+struct _virNumaPlacementNode {
+    int node;
+    unsigned int ncpus;             /* count of CPUs in the node */
+    unsigned long long memfree;     /* free memory of the page size, in KiB */
+    unsigned int load;              /* CPUs already claimed by other guests */
+    bool local;                     /* guest host devices are attached here */
+};
+
+int virNumaGetPlacementNodes(unsigned int page_size,
+                             virNumaPlacementNodePtr *nodes,
+                             size_t *nnodes);
+virBitmapPtr virNumaSelectPlacement(const virNumaPlacementNode *nodes,
+                                    size_t nnodes,
+                                    unsigned int ncpus,
+                                    unsigned long long memory);
+
+int virNumaParseProcessMemory(const char *maps,
+                              unsigned long long **memory,
+                              size_t *nmemory);
+int virNumaGetProcessMemory(pid_t pid,
+                            unsigned long long **memory,
+                            size_t *nmemory);
+
 int virNumaSetupMemoryPolicy(virDomainNumatuneMemMode mode,
                              virBitmapPtr nodeset);
 
@@ -45,6 +45,11 @@ struct _virClass {
     size_t objectSize;
 
     virObjectDisposeCallback dispose;
+
+    /* updated atomically by virObjectLock/virObjectUnlock */
+    virObjectLockStats lockStats;
+    /* link in virClassList */
+    virClassPtr next;
 };
 
 typedef struct _virObjectPrivate virObjectPrivate;
@@ -68,6 +73,12 @@ G_DEFINE_TYPE_WITH_PRIVATE(virObject, vir_object, G_TYPE_OBJECT)
     } while (0)
 
 
+/* all classes ever created, classes are never freed */
+static virClassPtr virClassList;
+static virMutex virClassListLock = VIR_MUTEX_INITIALIZER;
+
+static int virObjectLockProfiling;
+
 static virClassPtr virObjectClassImpl;
 static virClassPtr virObjectLockableClass;
 static virClassPtr virObjectRWLockableClass;
@@ -207,6 +218,12 @@ virClassNew(virClassPtr parent,
                                           0);
     }
     klass->dispose = dispose;
+    klass->lockStats.klass = klass->name;
+
+    virMutexLock(&virClassListLock);
+    klass->next = virClassList;
+    virClassList = klass;
+    virMutexUnlock(&virClassListLock);
 
     return klass;
 }
@@ -426,6 +443,80 @@ virObjectGetRWLockableObj(void *anyobj)
 }
 
 
+static void
+virObjectLockStatsMax(unsigned long long *max,
+                      unsigned long long val)
+{
+    unsigned long long cur = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+    while (val > cur &&
+           !__atomic_compare_exchange_n(max, &cur, val, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+
+static virClassPtr
+virObjectGetClass(void *anyobj)
+{
+    virObjectPrivate *priv = vir_object_get_instance_private(anyobj);
+
+    return priv->klass;
+}
+
+
+/*
+ * Acquires the lock of @obj measuring how long the thread had to wait
+ * for it, the lock is contended if it can't be acquired right away.
+ */
+static void
+virObjectLockProfiled(virObjectLockablePtr obj)
+{
+    virClassPtr klass = virObjectGetClass(obj);
+    virObjectLockStatsPtr stats = &klass->lockStats;
+    unsigned long long start = g_get_monotonic_time();
+    unsigned long long wait = 0;
+    bool contended = false;
+
+    if (!virMutexTryLock(&obj->lock)) {
+        contended = true;
+        virMutexLock(&obj->lock);
+    }
+
+    obj->lockedAt = g_get_monotonic_time();
+    if (contended) {
+        wait = obj->lockedAt - start;
+        __atomic_fetch_add(&stats->contended, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->wait, wait, __ATOMIC_RELAXED);
+        virObjectLockStatsMax(&stats->waitMax, wait);
+    }
+    __atomic_fetch_add(&stats->acquired, 1, __ATOMIC_RELAXED);
+
+    PROBE_QUIET(OBJECT_LOCK, "obj=%p classname=%s wait=%llu contended=%d",
+                obj, klass->name, wait, contended);
+}
+
+
+/*
+ * Accounts the time @obj was held for, which includes the time spent
+ * waiting on conditions using the lock of @obj.
+ */
+static void
+virObjectUnlockProfiled(virObjectLockablePtr obj)
+{
+    virClassPtr klass = virObjectGetClass(obj);
+    virObjectLockStatsPtr stats = &klass->lockStats;
+    unsigned long long hold = g_get_monotonic_time() - obj->lockedAt;
+
+    obj->lockedAt = 0;
+    __atomic_fetch_add(&stats->hold, hold, __ATOMIC_RELAXED);
+    virObjectLockStatsMax(&stats->holdMax, hold);
+
+    PROBE_QUIET(OBJECT_UNLOCK, "obj=%p classname=%s hold=%llu",
+                obj, klass->name, hold);
+}
+
+
 /**
  * virObjectLock:
  * @anyobj: any instance of virObjectLockable
@@ -446,7 +537,11 @@ virObjectLock(void *anyobj)
     if (!obj)
         return;
 
-    virMutexLock(&obj->lock);
+    if (g_atomic_int_get(&virObjectLockProfiling))
+        virObjectLockProfiled(obj);
+    else
+        virMutexLock(&obj->lock);
+    g_atomic_int_inc(&obj->seq);
 }
 
 
@@ -523,10 +618,155 @@ virObjectUnlock(void *anyobj)
     if (!obj)
         return;
 
+    if (obj->lockedAt)
+        virObjectUnlockProfiled(obj);
+    g_atomic_int_inc(&obj->seq);
     virMutexUnlock(&obj->lock);
 }
 
 
+/**
+ * virObjectReadBegin:
+ * @anyobj: any instance of virObjectLockable
+ * @seq: filled with the lock sequence number of @anyobj
+ *
+ * Start reading fields of @anyobj without locking it. Only fields
+ * stored in the object itself may be read this way, never memory the
+ * object points to, as a thread holding the lock may free it meanwhile.
+ * The values read are only valid if virObjectReadValid() returns true
+ * for @seq afterwards:
+ *
+ *   unsigned int seq;
+ *
+ *   if (virObjectReadBegin(obj, &seq)) {
+ *       value = obj->field;
+ *       if (virObjectReadValid(obj, seq))
+ *           return value;
+ *   }
+ *   ...lock @obj and read the field...
+ *
+ * Returns false if @anyobj is locked, in which case the caller should
+ * lock it instead of reading the fields.
+ */
+bool
+virObjectReadBegin(void *anyobj,
+                   unsigned int *seq)
+{
+    virObjectLockablePtr obj = virObjectGetLockableObj(anyobj);
+
+    if (!obj)
+        return false;
+
+    *seq = g_atomic_int_get(&obj->seq);
+    return !(*seq & 1);
+}
+
+
+/**
+ * virObjectReadValid:
+ * @anyobj: any instance of virObjectLockable
+ * @seq: sequence number from virObjectReadBegin()
+ *
+ * Returns true if @anyobj wasn't locked since virObjectReadBegin()
+ * returned @seq, so that the fields read in between are consistent.
+ */
+bool
+virObjectReadValid(void *anyobj,
+                   unsigned int seq)
+{
+    virObjectLockablePtr obj = virObjectGetLockableObj(anyobj);
+
+    if (!obj)
+        return false;
+
+    /* order the reads of the fields before the sequence check */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (unsigned int) g_atomic_int_get(&obj->seq) == seq;
+}
+
+
+/**
+ * virObjectSetLockProfiling:
+ * @enable: whether to profile locks
+ *
+ * Enables or disables accounting of lock contention of virObjectLockable
+ * instances per class. While enabled, every virObjectLock records how
+ * long it waited for the lock and every virObjectUnlock how long the
+ * lock was held, and the object_lock and object_unlock probes are fired.
+ */
+void
+virObjectSetLockProfiling(bool enable)
+{
+    VIR_DEBUG("enable=%d", enable);
+    g_atomic_int_set(&virObjectLockProfiling, enable);
+}
+
+
+/**
+ * virObjectGetLockProfiling:
+ *
+ * Returns true if lock profiling is enabled.
+ */
+bool
+virObjectGetLockProfiling(void)
+{
+    return g_atomic_int_get(&virObjectLockProfiling);
+}
+
+
+/**
+ * virObjectGetLockStats:
+ * @stats: filled with a newly allocated array of statistics
+ * @reset: whether to reset the statistics after reading them
+ *
+ * Collects the lock statistics of all classes whose instances were
+ * locked while lock profiling was enabled. The array is to be freed
+ * by the caller with g_free.
+ *
+ * Returns the number of elements in @stats.
+ */
+size_t
+virObjectGetLockStats(virObjectLockStatsPtr *stats,
+                      bool reset)
+{
+    virObjectLockStatsPtr ret = NULL;
+    size_t nret = 0;
+    virClassPtr klass;
+
+    virMutexLock(&virClassListLock);
+    for (klass = virClassList; klass; klass = klass->next) {
+        virObjectLockStatsPtr cur = &klass->lockStats;
+        virObjectLockStats copy = { .klass = klass->name };
+
+        if (reset) {
+            copy.acquired = __atomic_exchange_n(&cur->acquired, 0, __ATOMIC_RELAXED);
+            copy.contended = __atomic_exchange_n(&cur->contended, 0, __ATOMIC_RELAXED);
+            copy.wait = __atomic_exchange_n(&cur->wait, 0, __ATOMIC_RELAXED);
+            copy.waitMax = __atomic_exchange_n(&cur->waitMax, 0, __ATOMIC_RELAXED);
+            copy.hold = __atomic_exchange_n(&cur->hold, 0, __ATOMIC_RELAXED);
+            copy.holdMax = __atomic_exchange_n(&cur->holdMax, 0, __ATOMIC_RELAXED);
+        } else {
+            copy.acquired = __atomic_load_n(&cur->acquired, __ATOMIC_RELAXED);
+            copy.contended = __atomic_load_n(&cur->contended, __ATOMIC_RELAXED);
+            copy.wait = __atomic_load_n(&cur->wait, __ATOMIC_RELAXED);
+            copy.waitMax = __atomic_load_n(&cur->waitMax, __ATOMIC_RELAXED);
+            copy.hold = __atomic_load_n(&cur->hold, __ATOMIC_RELAXED);
+            copy.holdMax = __atomic_load_n(&cur->holdMax, __ATOMIC_RELAXED);
+        }
+
+        if (copy.acquired == 0)
+            continue;
+
+        ret = g_renew(virObjectLockStats, ret, nret + 1);
+        ret[nret++] = copy;
+    }
+    virMutexUnlock(&virClassListLock);
+
+    *stats = ret;
+    return nret;
+}
+
+
 /**
  * virObjectRWUnlock:
  * @anyobj: any instance of virObjectRWLockable
@@ -38,6 +38,9 @@ typedef virObjectLockable *virObjectLockablePtr;
 typedef struct _virObjectRWLockable virObjectRWLockable;
 typedef virObjectRWLockable *virObjectRWLockablePtr;
 
+typedef struct _virObjectLockStats virObjectLockStats;
+typedef virObjectLockStats *virObjectLockStatsPtr;
+
 typedef void (*virObjectDisposeCallback)(void *obj);
 
 #define VIR_TYPE_OBJECT vir_object_get_type()
@@ -50,6 +53,12 @@ struct _virObjectClass {
 struct _virObjectLockable {
     virObject parent;
     virMutex lock;
+    /* incremented by virObjectLock and virObjectUnlock, odd while the
+     * object is locked, see virObjectReadBegin */
+    int seq;
+    /* monotonic time the lock was acquired at while lock profiling
+     * is enabled, 0 otherwise */
+    unsigned long long lockedAt;
 };
 
 struct _virObjectRWLockable {
@@ -142,6 +151,39 @@ void
 virObjectRWUnlock(void *lockableobj)
     ATTRIBUTE_NONNULL(1);
 
+bool
+virObjectReadBegin(void *lockableobj,
+                   unsigned int *seq)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+
+bool
+virObjectReadValid(void *lockableobj,
+                   unsigned int seq)
+    ATTRIBUTE_NONNULL(1);
+
+/* Lock contention of all virObjectLockable instances of a class,
+ * times are in microseconds */
+struct _virObjectLockStats {
+    const char *klass;
+    unsigned long long acquired;
+    unsigned long long contended;
+    unsigned long long wait;
+    unsigned long long waitMax;
+    unsigned long long hold;
+    unsigned long long holdMax;
+};
+
+void
+virObjectSetLockProfiling(bool enable);
+
+bool
+virObjectGetLockProfiling(void);
+
+size_t
+virObjectGetLockStats(virObjectLockStatsPtr *stats,
+                      bool reset)
+    ATTRIBUTE_NONNULL(1);
+
 void
 virObjectListFree(void *list);
 
@@ -34,9 +34,11 @@
 #include "vircommand.h"
 #include "virerror.h"
 #include "virfile.h"
+#include "virhash.h"
 #include "virkmod.h"
 #include "virstring.h"
 #include "viralloc.h"
+#include "virthread.h"
 
 VIR_LOG_INIT("util.pci");
 
@@ -751,8 +753,108 @@ virPCIDeviceIsParent(virPCIDevicePtr dev, virPCIDevicePtr check, void *data)
     return ret;
 }
 
+/*
+ * Host PCI topology learned from sysfs and config space, keyed by device
+ * name. Finding the parent of a device means scanning the config space
+ * of every device on the host, and the ACS capability and IOMMU groups
+ * are read again for every device a domain is given. None of it changes
+ * unless devices are added or removed, so once a caller which learns
+ * about such changes (the node device driver) enabled the cache, the
+ * results are remembered until virPCITopologyInvalidate() is called.
+ */
+typedef struct _virPCITopologyEntry virPCITopologyEntry;
+typedef virPCITopologyEntry *virPCITopologyEntryPtr;
+struct _virPCITopologyEntry {
+    bool parentKnown;
+    bool hasParent;
+    virPCIDeviceAddress parent;
+
+    int lacksACS; /* -1 if unknown, see virPCIDeviceDownstreamLacksACS */
+
+    bool groupKnown;
+    bool hasGroup;
+    virPCIDeviceAddressPtr group; /* devices in its IOMMU group */
+    size_t ngroup;
+};
+
+static virMutex virPCITopologyLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr virPCITopology;
+static bool virPCITopologyEnabled;
+
+
+static void
+virPCITopologyEntryFree(void *payload)
+{
+    virPCITopologyEntryPtr entry = payload;
+
+    g_free(entry->group);
+    g_free(entry);
+}
+
+
+/**
+ * virPCITopologyEnable:
+ *
+ * Start remembering the host PCI topology. The caller must call
+ * virPCITopologyInvalidate() whenever a PCI device is added to or
+ * removed from the host.
+ */
+void
+virPCITopologyEnable(void)
+{
+    virMutexLock(&virPCITopologyLock);
+    virPCITopologyEnabled = true;
+    virMutexUnlock(&virPCITopologyLock);
+}
+
+
+/**
+ * virPCITopologyInvalidate:
+ *
+ * Forget everything learned about the host PCI topology.
+ */
+void
+virPCITopologyInvalidate(void)
+{
+    virMutexLock(&virPCITopologyLock);
+    if (virPCITopology)
+        virHashRemoveAll(virPCITopology);
+    virMutexUnlock(&virPCITopologyLock);
+}
+
+
+/* Returns the entry of @name, creating it if needed, or NULL if the
+ * cache is disabled. Must be called with virPCITopologyLock held. */
+static virPCITopologyEntryPtr
+virPCITopologyGetEntry(const char *name)
+{
+    virPCITopologyEntryPtr entry;
+
+    if (!virPCITopologyEnabled)
+        return NULL;
+
+    if (!virPCITopology &&
+        !(virPCITopology = virHashNew(virPCITopologyEntryFree)))
+        return NULL;
+
+    if ((entry = virHashLookup(virPCITopology, name)))
+        return entry;
+
+    entry = g_new0(virPCITopologyEntry, 1);
+    entry->lacksACS = -1;
+
+    if (virHashAddEntry(virPCITopology, name, entry) < 0) {
+        virPCITopologyEntryFree(entry);
+        virResetLastError();
+        return NULL;
+    }
+
+    return entry;
+}
+
+
 static int
-virPCIDeviceGetParent(virPCIDevicePtr dev, virPCIDevicePtr *parent)
+virPCIDeviceGetParentUncached(virPCIDevicePtr dev, virPCIDevicePtr *parent)
 {
     virPCIDevicePtr best = NULL;
     int ret;
@@ -766,6 +868,51 @@ virPCIDeviceGetParent(virPCIDevicePtr dev, virPCIDevicePtr *parent)
     return ret;
 }
 
+
+static int
+virPCIDeviceGetParent(virPCIDevicePtr dev, virPCIDevicePtr *parent)
+{
+    virPCITopologyEntryPtr entry;
+    virPCIDeviceAddress addr = { 0 };
+    bool known = false;
+    bool hasParent = false;
+
+    *parent = NULL;
+
+    virMutexLock(&virPCITopologyLock);
+    if ((entry = virPCITopologyGetEntry(dev->name)) && entry->parentKnown) {
+        known = true;
+        hasParent = entry->hasParent;
+        addr = entry->parent;
+    }
+    virMutexUnlock(&virPCITopologyLock);
+
+    if (known) {
+        if (hasParent &&
+            !(*parent = virPCIDeviceNew(addr.domain, addr.bus,
+                                        addr.slot, addr.function)))
+            return -1;
+        return 0;
+    }
+
+    if (virPCIDeviceGetParentUncached(dev, parent) < 0)
+        return -1;
+
+    virMutexLock(&virPCITopologyLock);
+    if ((entry = virPCITopologyGetEntry(dev->name))) {
+        entry->parentKnown = true;
+        entry->hasParent = !!*parent;
+        if (*parent)
+            entry->parent = (*parent)->address;
+    }
+    virMutexUnlock(&virPCITopologyLock);
+
+    return 0;
+}
+
+/* Serializes secondary bus resets */
+static virMutex virPCIBusResetLock = VIR_MUTEX_INITIALIZER;
+
 /* Secondary Bus Reset is our sledgehammer - it resets all
  * devices behind a bus.
  */
@@ -971,9 +1118,14 @@ virPCIDeviceReset(virPCIDevicePtr dev,
     if (dev->has_pm_reset)
         ret = virPCIDeviceTryPowerManagementReset(dev, fd);
 
-    /* Bus reset is not an option with the root bus */
-    if (ret < 0 && dev->address.bus != 0)
+    /* Bus reset is not an option with the root bus. Devices may be reset
+     * from several threads at once, but a bus reset also hits whatever
+     * sits behind the bridge, so never let two of them overlap. */
+    if (ret < 0 && dev->address.bus != 0) {
+        virMutexLock(&virPCIBusResetLock);
         ret = virPCIDeviceTrySecondaryBusReset(dev, fd, inactiveDevs);
+        virMutexUnlock(&virPCIBusResetLock);
+    }
 
     if (ret < 0) {
         virErrorPtr err = virGetLastError();
@@ -1773,16 +1925,53 @@ virPCIDeviceAddressIOMMUGroupIterate(virPCIDeviceAddressPtr orig,
                                      virPCIDeviceAddressActor actor,
                                      void *opaque)
 {
+    g_autofree char *name = NULL;
     g_autofree char *groupPath = NULL;
+    g_autofree virPCIDeviceAddressPtr group = NULL;
+    virPCITopologyEntryPtr entry;
+    size_t ngroup = 0;
+    bool known = false;
     DIR *groupDir = NULL;
     int ret = -1;
     struct dirent *ent;
     int direrr;
+    size_t i;
 
-    groupPath = g_strdup_printf(PCI_SYSFS "devices/" VIR_PCI_DEVICE_ADDRESS_FMT "/iommu_group/devices",
-                                orig->domain, orig->bus, orig->slot, orig->function);
+    name = g_strdup_printf(VIR_PCI_DEVICE_ADDRESS_FMT,
+                           orig->domain, orig->bus, orig->slot, orig->function);
+
+    virMutexLock(&virPCITopologyLock);
+    if ((entry = virPCITopologyGetEntry(name)) && entry->groupKnown) {
+        known = true;
+        if (entry->hasGroup) {
+            group = g_new0(virPCIDeviceAddress, entry->ngroup);
+            memcpy(group, entry->group, sizeof(*group) * entry->ngroup);
+            ngroup = entry->ngroup;
+        }
+    }
+    virMutexUnlock(&virPCITopologyLock);
+
+    if (known) {
+        if (!group)
+            return (actor)(orig, opaque);
+
+        for (i = 0; i < ngroup; i++) {
+            if ((actor)(&group[i], opaque) < 0)
+                return -1;
+        }
+        return 0;
+    }
+
+    groupPath = g_strdup_printf(PCI_SYSFS "devices/%s/iommu_group/devices", name);
 
     if (virDirOpenQuiet(&groupDir, groupPath) < 0) {
+        virMutexLock(&virPCITopologyLock);
+        if ((entry = virPCITopologyGetEntry(name))) {
+            entry->groupKnown = true;
+            entry->hasGroup = false;
+        }
+        virMutexUnlock(&virPCITopologyLock);
+
         /* just process the original device, nothing more */
         ret = (actor)(orig, opaque);
         goto cleanup;
@@ -1798,12 +1987,28 @@ virPCIDeviceAddressIOMMUGroupIterate(virPCIDeviceAddressPtr orig,
             goto cleanup;
         }
 
-        if ((actor)(&newDev, opaque) < 0)
+        if (VIR_APPEND_ELEMENT_COPY(group, ngroup, newDev) < 0)
             goto cleanup;
     }
     if (direrr < 0)
         goto cleanup;
 
+    virMutexLock(&virPCITopologyLock);
+    if ((entry = virPCITopologyGetEntry(name))) {
+        g_free(entry->group);
+        entry->group = g_new0(virPCIDeviceAddress, ngroup);
+        memcpy(entry->group, group, sizeof(*group) * ngroup);
+        entry->ngroup = ngroup;
+        entry->groupKnown = true;
+        entry->hasGroup = true;
+    }
+    virMutexUnlock(&virPCITopologyLock);
+
+    for (i = 0; i < ngroup; i++) {
+        if ((actor)(&group[i], opaque) < 0)
+            goto cleanup;
+    }
+
     ret = 0;
 
  cleanup:
@@ -1951,6 +2156,26 @@ virPCIDeviceAddressGetIOMMUGroupNum(virPCIDeviceAddressPtr addr)
 }
 
 
+/* virPCIDeviceAddressGetNUMANode - return the host NUMA node this PCI
+ * device is attached to, or -1 if it is not known. Does not report
+ * errors.
+ */
+int
+virPCIDeviceAddressGetNUMANode(virPCIDeviceAddressPtr addr)
+{
+    int node;
+
+    if (virFileReadValueInt(&node, PCI_SYSFS "devices/" VIR_PCI_DEVICE_ADDRESS_FMT
+                            "/numa_node", addr->domain, addr->bus,
+                            addr->slot, addr->function) < 0) {
+        virResetLastError();
+        return -1;
+    }
+
+    return node < 0 ? -1 : node;
+}
+
+
 char *
 virPCIDeviceAddressGetIOMMUGroupDev(const virPCIDeviceAddress *devAddr)
 {
@@ -2044,6 +2269,31 @@ virPCIDeviceDownstreamLacksACS(virPCIDevicePtr dev)
     return ret;
 }
 
+static int
+virPCIDeviceDownstreamLacksACSCached(virPCIDevicePtr dev)
+{
+    virPCITopologyEntryPtr entry;
+    int ret = -1;
+
+    virMutexLock(&virPCITopologyLock);
+    if ((entry = virPCITopologyGetEntry(dev->name)))
+        ret = entry->lacksACS;
+    virMutexUnlock(&virPCITopologyLock);
+
+    if (ret >= 0)
+        return ret;
+
+    if ((ret = virPCIDeviceDownstreamLacksACS(dev)) < 0)
+        return -1;
+
+    virMutexLock(&virPCITopologyLock);
+    if ((entry = virPCITopologyGetEntry(dev->name)))
+        entry->lacksACS = ret;
+    virMutexUnlock(&virPCITopologyLock);
+
+    return ret;
+}
+
 static int
 virPCIDeviceIsBehindSwitchLackingACS(virPCIDevicePtr dev)
 {
@@ -2075,7 +2325,7 @@ virPCIDeviceIsBehindSwitchLackingACS(virPCIDevicePtr dev)
         int acs;
         int ret;
 
-        acs = virPCIDeviceDownstreamLacksACS(parent);
+        acs = virPCIDeviceDownstreamLacksACSCached(parent);
 
         if (acs) {
             if (acs < 0)
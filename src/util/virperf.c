@@ -54,6 +54,7 @@ VIR_ENUM_IMPL(virPerfEvent,
 struct virPerfEvent {
     int fd;
     bool enabled;
+    bool leader; /* @fd leads a group of co-scheduled events */
     union {
         /* cmt */
         struct {
@@ -74,6 +75,18 @@ struct _virPerf {
 struct virPerfEventAttr {
     unsigned int attrType;
     unsigned long long attrConfig;
+    /* Events derived metrics are computed from are put into one group,
+     * so that the kernel schedules them onto the PMU together and their
+     * ratios stay exact when counters are multiplexed */
+    bool grouped;
+};
+
+/* Layout of read() with PERF_FORMAT_TOTAL_TIME_ENABLED and
+ * PERF_FORMAT_TOTAL_TIME_RUNNING */
+struct virPerfEventValue {
+    uint64_t value;
+    uint64_t time_enabled;
+    uint64_t time_running;
 };
 
 static struct virPerfEventAttr attrs[] = {
@@ -91,11 +104,13 @@ static struct virPerfEventAttr attrs[] = {
     },
     [VIR_PERF_EVENT_CPU_CYCLES] = {
         .attrType = PERF_TYPE_HARDWARE,
-        .attrConfig = PERF_COUNT_HW_CPU_CYCLES
+        .attrConfig = PERF_COUNT_HW_CPU_CYCLES,
+        .grouped = true
     },
     [VIR_PERF_EVENT_INSTRUCTIONS] = {
         .attrType = PERF_TYPE_HARDWARE,
-        .attrConfig = PERF_COUNT_HW_INSTRUCTIONS
+        .attrConfig = PERF_COUNT_HW_INSTRUCTIONS,
+        .grouped = true
     },
     [VIR_PERF_EVENT_CACHE_REFERENCES] = {
         .attrType = PERF_TYPE_HARDWARE,
@@ -103,7 +118,8 @@ static struct virPerfEventAttr attrs[] = {
     },
     [VIR_PERF_EVENT_CACHE_MISSES] = {
         .attrType = PERF_TYPE_HARDWARE,
-        .attrConfig = PERF_COUNT_HW_CACHE_MISSES
+        .attrConfig = PERF_COUNT_HW_CACHE_MISSES,
+        .grouped = true
     },
     [VIR_PERF_EVENT_BRANCH_INSTRUCTIONS] = {
         .attrType = PERF_TYPE_HARDWARE,
@@ -210,6 +226,8 @@ virPerfEventEnable(virPerfPtr perf,
     struct perf_event_attr attr;
     virPerfEventPtr event = &(perf->events[type]);
     virPerfEventAttrPtr event_attr = &attrs[type];
+    int group_fd = -1;
+    size_t i;
 
     if (event->enabled)
         return 0;
@@ -244,8 +262,27 @@ virPerfEventEnable(virPerfPtr perf,
     attr.enable_on_exec = 0;
     attr.type = event_attr->attrType;
     attr.config = event_attr->attrConfig;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    if (event_attr->grouped) {
+        for (i = 0; i < VIR_PERF_EVENT_LAST; i++) {
+            if (attrs[i].grouped && perf->events[i].enabled &&
+                perf->events[i].leader) {
+                group_fd = perf->events[i].fd;
+                break;
+            }
+        }
+    }
 
-    event->fd = syscall(__NR_perf_event_open, &attr, pid, -1, -1, 0);
+    event->fd = syscall(__NR_perf_event_open, &attr, pid, -1, group_fd, 0);
+    if (event->fd < 0 && group_fd >= 0) {
+        /* the group may not fit onto the PMU, count the event alone */
+        VIR_DEBUG("Unable to add perf event %s to group: %s",
+                  virPerfEventTypeToString(type), g_strerror(errno));
+        group_fd = -1;
+        event->fd = syscall(__NR_perf_event_open, &attr, pid, -1, -1, 0);
+    }
     if (event->fd < 0) {
         virReportSystemError(errno,
                              _("unable to open host cpu perf event for %s"),
@@ -261,6 +298,7 @@ virPerfEventEnable(virPerfPtr perf,
     }
 
     event->enabled = true;
+    event->leader = group_fd < 0;
     return 0;
 
  error:
@@ -273,6 +311,7 @@ virPerfEventDisable(virPerfPtr perf,
                     virPerfEventType type)
 {
     virPerfEventPtr event = &(perf->events[type]);
+    size_t i;
 
     if (!event->enabled)
         return 0;
@@ -284,7 +323,17 @@ virPerfEventDisable(virPerfPtr perf,
         return -1;
     }
 
+    /* Closing a group leader turns the remaining members into
+     * standalone events, which thus lead themselves */
+    if (event->leader && attrs[type].grouped) {
+        for (i = 0; i < VIR_PERF_EVENT_LAST; i++) {
+            if (attrs[i].grouped && perf->events[i].enabled)
+                perf->events[i].leader = true;
+        }
+    }
+
     event->enabled = false;
+    event->leader = false;
     VIR_FORCE_CLOSE(event->fd);
     return 0;
 }
@@ -301,17 +350,29 @@ virPerfReadEvent(virPerfPtr perf,
                  uint64_t *value)
 {
     virPerfEventPtr event = &perf->events[type];
+    struct virPerfEventValue data;
+
     if (!event->enabled)
         return -1;
 
-    if (saferead(event->fd, value, sizeof(uint64_t)) < 0) {
+    if (saferead(event->fd, &data, sizeof(data)) < 0) {
         virReportSystemError(errno, "%s",
                              _("Unable to read cache data"));
         return -1;
     }
 
-    if (type == VIR_PERF_EVENT_CMT)
+    *value = data.value;
+
+    if (type == VIR_PERF_EVENT_CMT) {
+        /* occupancy is a level rather than a count, nothing to scale */
         *value *= event->efields.cmt.scale;
+    } else if (data.time_running == 0) {
+        *value = 0;
+    } else if (data.time_running < data.time_enabled) {
+        /* the event shared the PMU with others, extrapolate the count
+         * to the whole time it was enabled */
+        *value = (double) data.value * data.time_enabled / data.time_running;
+    }
 
     return 0;
 }
@@ -30,18 +30,37 @@
 #include "virthread.h"
 #include "virerror.h"
 #include "virfile.h"
+#include "virlog.h"
 #include "virstring.h"
+#include "virtime.h"
 #include "virutil.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
+VIR_LOG_INIT("util.portallocator");
+
 #define VIR_PORT_ALLOCATOR_NUM_PORTS 65536
 
+/* How long (in milliseconds) to remember that a port was found
+ * bound by somebody else before probing it again. */
+#define VIR_PORT_ALLOCATOR_BUSY_TIMEOUT 5000
+
 typedef struct _virPortAllocator virPortAllocator;
 typedef virPortAllocator *virPortAllocatorPtr;
 struct _virPortAllocator {
     virObjectLockable parent;
     virBitmapPtr bitmap;
+
+    /* Ports that failed the bind probe, skipped until @busyExpiry
+     * so that a burst of acquisitions doesn't probe them over and
+     * over again. */
+    virBitmapPtr busy;
+    unsigned long long busyExpiry;
+
+    /* statistics */
+    unsigned long long nacquired;
+    unsigned long long nprobes;
+    unsigned long long nbusy;
 };
 
 struct _virPortAllocatorRange {
@@ -60,6 +79,7 @@ virPortAllocatorDispose(void *obj)
     virPortAllocatorPtr pa = obj;
 
     virBitmapFree(pa->bitmap);
+    virBitmapFree(pa->busy);
 }
 
 static virPortAllocatorPtr
@@ -70,7 +90,8 @@ virPortAllocatorNew(void)
     if (!(pa = virObjectLockableNew(virPortAllocatorClass)))
         return NULL;
 
-    if (!(pa->bitmap = virBitmapNew(VIR_PORT_ALLOCATOR_NUM_PORTS)))
+    if (!(pa->bitmap = virBitmapNew(VIR_PORT_ALLOCATOR_NUM_PORTS)) ||
+        !(pa->busy = virBitmapNew(VIR_PORT_ALLOCATOR_NUM_PORTS)))
         goto error;
 
     return pa;
@@ -211,7 +232,10 @@ virPortAllocatorAcquire(const virPortAllocatorRange *range,
                         unsigned short *port)
 {
     int ret = -1;
-    size_t i;
+    ssize_t i;
+    bool skipped;
+    unsigned long long now;
+    unsigned long long nprobes = 0;
     virPortAllocatorPtr pa = virPortAllocatorGet();
 
     *port = 0;
@@ -219,35 +243,75 @@ virPortAllocatorAcquire(const virPortAllocatorRange *range,
     if (!pa)
         return -1;
 
+    if (virTimeMillisNow(&now) < 0)
+        return -1;
+
     virObjectLock(pa);
 
-    for (i = range->start; i <= range->end && !*port; i++) {
+    if (now >= pa->busyExpiry)
+        virBitmapClearAll(pa->busy);
+
+ retry:
+    skipped = false;
+
+    /* Ports reserved by us are skipped a word at a time, only
+     * a candidate that is free as far as we know gets probed. */
+    for (i = virBitmapNextClearBit(pa->bitmap, (ssize_t) range->start - 1);
+         i >= 0 && i <= range->end;
+         i = virBitmapNextClearBit(pa->bitmap, i)) {
         bool used = false, v6used = false;
 
-        if (virBitmapIsBitSet(pa->bitmap, i))
+        if (virBitmapIsBitSet(pa->busy, i)) {
+            skipped = true;
             continue;
+        }
 
+        nprobes++;
         if (virPortAllocatorBindToPort(&v6used, i, AF_INET6) < 0 ||
             virPortAllocatorBindToPort(&used, i, AF_INET) < 0)
             goto cleanup;
 
-        if (!used && !v6used) {
-            /* Add port to bitmap of reserved ports */
-            if (virBitmapSetBit(pa->bitmap, i) < 0) {
-                virReportError(VIR_ERR_INTERNAL_ERROR,
-                               _("Failed to reserve port %zu"), i);
-                goto cleanup;
-            }
-            *port = i;
-            ret = 0;
+        if (used || v6used) {
+            if (virBitmapIsAllClear(pa->busy))
+                pa->busyExpiry = now + VIR_PORT_ALLOCATOR_BUSY_TIMEOUT;
+            ignore_value(virBitmapSetBit(pa->busy, i));
+            pa->nbusy++;
+            continue;
         }
+
+        /* Add port to bitmap of reserved ports */
+        if (virBitmapSetBit(pa->bitmap, i) < 0) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("Failed to reserve port %zd"), i);
+            goto cleanup;
+        }
+        *port = i;
+        break;
+    }
+
+    /* Some of the ports we skipped might have been released by
+     * their owners in the meantime, give them another chance. */
+    if (*port == 0 && skipped) {
+        virBitmapClearAll(pa->busy);
+        goto retry;
     }
 
+    pa->nprobes += nprobes;
+
     if (*port == 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unable to find an unused port in range '%s' (%d-%d)"),
                        range->name, range->start, range->end);
+        goto cleanup;
     }
+
+    pa->nacquired++;
+    VIR_DEBUG("Acquired port %u from range '%s' after %llu probes "
+              "(total acquired=%llu probes=%llu busy=%llu)",
+              *port, range->name, nprobes,
+              pa->nacquired, pa->nprobes, pa->nbusy);
+
+    ret = 0;
  cleanup:
     virObjectUnlock(pa);
     return ret;
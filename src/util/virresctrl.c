@@ -28,9 +28,11 @@
 #include "virresctrlpriv.h"
 #include "viralloc.h"
 #include "virfile.h"
+#include "virhash.h"
 #include "virlog.h"
 #include "virobject.h"
 #include "virstring.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_RESCTRL
 
@@ -331,6 +333,11 @@ struct _virResctrlAllocPerLevel {
 struct _virResctrlAllocMemBW {
     unsigned int **bandwidths;
     size_t nbandwidths;
+
+    /* Lowest bandwidth the allocation may be throttled to at runtime, 0 if
+     * the bandwidth is fixed. Indexed the same way as @bandwidths. */
+    unsigned int *minimums;
+    size_t nminimums;
 };
 
 struct _virResctrlAlloc {
@@ -413,6 +420,7 @@ virResctrlAllocDispose(void *obj)
         for (i = 0; i < mem_bw->nbandwidths; i++)
             VIR_FREE(mem_bw->bandwidths[i]);
         VIR_FREE(alloc->mem_bw->bandwidths);
+        VIR_FREE(alloc->mem_bw->minimums);
         VIR_FREE(alloc->mem_bw);
     }
 
@@ -1361,6 +1369,67 @@ virResctrlAllocSetMemoryBandwidth(virResctrlAllocPtr alloc,
 }
 
 
+/* virResctrlAllocSetMemoryBandwidthMin
+ * @alloc: Pointer to an active allocation
+ * @id: node id of MBA to be set
+ * @minimum: lowest memory bandwidth the allocation may be throttled to
+ *
+ * Mark the memory bandwidth of node @id in @alloc as adjustable at runtime
+ * between @minimum and the value set by virResctrlAllocSetMemoryBandwidth,
+ * which has to be called first.
+ *
+ * Returns 0 on success, -1 on failure with error message set.
+ */
+int
+virResctrlAllocSetMemoryBandwidthMin(virResctrlAllocPtr alloc,
+                                     unsigned int id,
+                                     unsigned int minimum)
+{
+    virResctrlAllocMemBWPtr mem_bw = alloc->mem_bw;
+
+    if (!mem_bw || mem_bw->nbandwidths <= id || !mem_bw->bandwidths[id]) {
+        virReportError(VIR_ERR_XML_ERROR,
+                       _("Memory Bandwidth not defined for node %u"),
+                       id);
+        return -1;
+    }
+
+    if (minimum > *(mem_bw->bandwidths[id])) {
+        virReportError(VIR_ERR_XML_ERROR,
+                       _("Minimal memory bandwidth %u of node %u exceeds "
+                         "its bandwidth %u"),
+                       minimum, id, *(mem_bw->bandwidths[id]));
+        return -1;
+    }
+
+    if (mem_bw->nminimums <= id &&
+        VIR_EXPAND_N(mem_bw->minimums, mem_bw->nminimums,
+                     id - mem_bw->nminimums + 1) < 0)
+        return -1;
+
+    mem_bw->minimums[id] = minimum;
+    return 0;
+}
+
+
+/* virResctrlAllocGetMemoryBandwidthMin
+ * @alloc: Pointer to an active allocation
+ * @id: node id of MBA
+ *
+ * Returns the lowest memory bandwidth the node @id entry of @alloc may be
+ * throttled to, or 0 if its bandwidth is fixed.
+ */
+unsigned int
+virResctrlAllocGetMemoryBandwidthMin(virResctrlAllocPtr alloc,
+                                     unsigned int id)
+{
+    if (!alloc || !alloc->mem_bw || alloc->mem_bw->nminimums <= id)
+        return 0;
+
+    return alloc->mem_bw->minimums[id];
+}
+
+
 /* virResctrlAllocForeachMemory
  * @alloc: Pointer to an active allocation
  * @cb: Callback function
@@ -1910,6 +1979,113 @@ virResctrlAllocNewFromInfo(virResctrlInfoPtr info)
     goto cleanup;
 }
 
+/*
+ * Parsed schemata of the entries under SYSFS_RESCTRL_PATH, keyed by their
+ * name.  Groups get their schemata written right after they are created
+ * with the resctrl lock held and their cache allocations are never changed
+ * afterwards, so every group only needs to be parsed the first time it is
+ * seen.  The inode number tells a group apart from a later one of the same
+ * name.
+ */
+typedef struct _virResctrlGroupCacheEntry virResctrlGroupCacheEntry;
+typedef virResctrlGroupCacheEntry *virResctrlGroupCacheEntryPtr;
+struct _virResctrlGroupCacheEntry {
+    ino_t ino;
+    virResctrlAllocPtr alloc; /* NULL if the entry is no resource group */
+    unsigned int generation; /* last scan the entry was seen in */
+};
+
+static virMutex virResctrlGroupCacheLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr virResctrlGroupCache;
+static unsigned int virResctrlGroupCacheGeneration;
+
+
+static void
+virResctrlGroupCacheEntryFree(void *payload)
+{
+    virResctrlGroupCacheEntryPtr entry = payload;
+
+    virObjectUnref(entry->alloc);
+    g_free(entry);
+}
+
+
+static int
+virResctrlGroupCacheIsStale(const void *payload,
+                            const void *name G_GNUC_UNUSED,
+                            const void *opaque)
+{
+    const virResctrlGroupCacheEntry *entry = payload;
+    const unsigned int *generation = opaque;
+
+    return entry->generation != *generation;
+}
+
+
+/* Parse @groupname and remember it. Must be called with
+ * virResctrlGroupCacheLock held. */
+static virResctrlGroupCacheEntryPtr
+virResctrlGroupCacheAdd(virResctrlInfoPtr resctrl,
+                        const char *groupname,
+                        ino_t ino)
+{
+    virResctrlGroupCacheEntryPtr entry = NULL;
+    virResctrlAllocPtr alloc = NULL;
+    int rv;
+
+    if (!virResctrlGroupCache &&
+        !(virResctrlGroupCache = virHashNew(virResctrlGroupCacheEntryFree)))
+        return NULL;
+
+    rv = virResctrlAllocGetGroup(resctrl, groupname, &alloc);
+    if (rv == -1) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Could not read schemata file for group %s"),
+                       groupname);
+        return NULL;
+    }
+
+    entry = g_new0(virResctrlGroupCacheEntry, 1);
+    entry->ino = ino;
+    entry->alloc = alloc;
+    entry->generation = virResctrlGroupCacheGeneration;
+
+    if (virHashUpdateEntry(virResctrlGroupCache, groupname, entry) < 0) {
+        virResctrlGroupCacheEntryFree(entry);
+        return NULL;
+    }
+
+    return entry;
+}
+
+
+/* Update the model of resource groups after @path was created or
+ * removed, the group is parsed again the next time it is needed if
+ * this fails. */
+static void
+virResctrlGroupCacheUpdate(virResctrlInfoPtr resctrl,
+                           const char *path,
+                           bool created)
+{
+    g_autofree char *groupname = g_path_get_basename(path);
+    struct stat sb;
+
+    virMutexLock(&virResctrlGroupCacheLock);
+
+    if (virResctrlGroupCache)
+        virHashRemoveEntry(virResctrlGroupCache, groupname);
+
+    if (created && stat(path, &sb) == 0 &&
+        !virResctrlGroupCacheAdd(resctrl, groupname, sb.st_ino)) {
+        VIR_DEBUG("Could not remember resctrl group %s: %s",
+                  groupname, virGetLastErrorMessage());
+        virResetLastError();
+    }
+
+    virMutexUnlock(&virResctrlGroupCacheLock);
+}
+
+
 /*
  * This function creates an allocation that represents all unused parts of all
  * caches in the system.  It uses virResctrlInfo for creating a new full
@@ -1918,7 +2094,7 @@ virResctrlAllocNewFromInfo(virResctrlInfoPtr info)
  * them from it.  That way it can then return an allocation with only bit set
  * being those that are not mentioned in any other allocation.  It is used for
  * two things, a) calculating the masks when creating allocations and b) from
- * tests.
+ * tests.  Only groups not seen before are parsed, see virResctrlGroupCache.
  *
  * MBA (Memory Bandwidth Allocation) is not taken into account as it is a
  * limiting setting, not an allocating one.  The way it works is also vastly
@@ -1931,6 +2107,7 @@ virResctrlAllocGetUnused(virResctrlInfoPtr resctrl)
     virResctrlAllocPtr alloc = NULL;
     struct dirent *ent = NULL;
     DIR *dirp = NULL;
+    unsigned int generation;
     int rv = -1;
 
     if (virResctrlInfoIsEmpty(resctrl)) {
@@ -1943,39 +2120,47 @@ virResctrlAllocGetUnused(virResctrlInfoPtr resctrl)
     if (!ret)
         return NULL;
 
+    virMutexLock(&virResctrlGroupCacheLock);
+
+    /* The default group is not cached, its schemata can be changed by
+     * anyone at any time */
     alloc = virResctrlAllocGetDefault(resctrl);
     if (!alloc)
         goto error;
 
     virResctrlAllocSubtract(ret, alloc);
-    virObjectUnref(alloc);
 
     if (virDirOpen(&dirp, SYSFS_RESCTRL_PATH) < 0)
         goto error;
 
+    generation = ++virResctrlGroupCacheGeneration;
+
     while ((rv = virDirRead(dirp, &ent, SYSFS_RESCTRL_PATH)) > 0) {
+        virResctrlGroupCacheEntryPtr entry = NULL;
+
         if (STREQ(ent->d_name, "info"))
             continue;
 
-        rv = virResctrlAllocGetGroup(resctrl, ent->d_name, &alloc);
-        if (rv == -2)
-            continue;
+        if (virResctrlGroupCache)
+            entry = virHashLookup(virResctrlGroupCache, ent->d_name);
 
-        if (rv < 0) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("Could not read schemata file for group %s"),
-                           ent->d_name);
+        if (entry && entry->ino == ent->d_ino)
+            entry->generation = generation;
+        else if (!(entry = virResctrlGroupCacheAdd(resctrl, ent->d_name,
+                                                   ent->d_ino)))
             goto error;
-        }
 
-        virResctrlAllocSubtract(ret, alloc);
-        virObjectUnref(alloc);
-        alloc = NULL;
+        virResctrlAllocSubtract(ret, entry->alloc);
     }
     if (rv < 0)
         goto error;
 
+    /* forget groups which were removed */
+    virHashRemoveSet(virResctrlGroupCache, virResctrlGroupCacheIsStale,
+                     &generation);
+
  cleanup:
+    virMutexUnlock(&virResctrlGroupCacheLock);
     virObjectUnref(alloc);
     VIR_DIR_CLOSE(dirp);
     return ret;
@@ -2156,6 +2341,17 @@ virResctrlAllocMemoryBandwidth(virResctrlInfoPtr resctrl,
                            mem_bw_info->min_bandwidth);
             return -1;
         }
+        if (i < mem_bw_alloc->nminimums && mem_bw_alloc->minimums[i] &&
+            (mem_bw_alloc->minimums[i] % mem_bw_info->bandwidth_granularity ||
+             mem_bw_alloc->minimums[i] < mem_bw_info->min_bandwidth)) {
+            virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
+                           _("Minimal memory bandwidth %u must be divisible "
+                             "by granularity %u and at least %u"),
+                           mem_bw_alloc->minimums[i],
+                           mem_bw_info->bandwidth_granularity,
+                           mem_bw_info->min_bandwidth);
+            return -1;
+        }
         if (i > mem_bw_info->max_id) {
             virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
                            _("bandwidth controller id %zd does not "
@@ -2441,6 +2637,8 @@ virResctrlAllocCreate(virResctrlInfoPtr resctrl,
         goto cleanup;
     }
 
+    virResctrlGroupCacheUpdate(resctrl, alloc->path, true);
+
     ret = 0;
  cleanup:
     virResctrlUnlock(lockfd);
@@ -2450,6 +2648,69 @@ virResctrlAllocCreate(virResctrlInfoPtr resctrl,
 }
 
 
+/* virResctrlAllocApplyMemoryBandwidth
+ * @alloc: Pointer to a created allocation
+ * @id: node id of MBA to be changed
+ * @memory_bandwidth: memory bandwidth to apply
+ *
+ * Throttle the running allocation @alloc on node @id to @memory_bandwidth
+ * percent. The value has to lie between the minimum set by
+ * virResctrlAllocSetMemoryBandwidthMin and the configured bandwidth, which
+ * itself is left untouched. Only the bandwidth of node @id is rewritten in
+ * the schemata file, any other resources of the group are kept.
+ *
+ * Returns 0 on success, -1 on failure with error message set.
+ */
+int
+virResctrlAllocApplyMemoryBandwidth(virResctrlAllocPtr alloc,
+                                    unsigned int id,
+                                    unsigned int memory_bandwidth)
+{
+    g_autofree char *schemata_path = NULL;
+    g_autofree char *alloc_str = NULL;
+    unsigned int minimum = virResctrlAllocGetMemoryBandwidthMin(alloc, id);
+    int ret = -1;
+    int lockfd = -1;
+
+    if (!alloc->path || STREQ(alloc->path, SYSFS_RESCTRL_PATH)) {
+        virReportError(VIR_ERR_OPERATION_INVALID, "%s",
+                       _("Cannot change bandwidth of a resctrl group "
+                         "which was not created"));
+        return -1;
+    }
+
+    if (!minimum ||
+        memory_bandwidth < minimum ||
+        memory_bandwidth > *(alloc->mem_bw->bandwidths[id])) {
+        virReportError(VIR_ERR_OPERATION_INVALID,
+                       _("Memory bandwidth %u of node %u is out of the "
+                         "adjustable range"),
+                       memory_bandwidth, id);
+        return -1;
+    }
+
+    schemata_path = g_strdup_printf("%s/schemata", alloc->path);
+    alloc_str = g_strdup_printf("MB:%u=%u\n", id, memory_bandwidth);
+
+    lockfd = virResctrlLock();
+    if (lockfd < 0)
+        return -1;
+
+    VIR_DEBUG("Writing resctrl schemata '%s' into '%s'", alloc_str, schemata_path);
+    if (virFileWriteStr(schemata_path, alloc_str, 0) < 0) {
+        virReportSystemError(errno,
+                             _("Cannot write into schemata file '%s'"),
+                             schemata_path);
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virResctrlUnlock(lockfd);
+    return ret;
+}
+
+
 static int
 virResctrlAddPID(const char *path,
                  pid_t pid)
@@ -2514,6 +2775,8 @@ virResctrlAllocRemove(virResctrlAllocPtr alloc)
         VIR_ERROR(_("Unable to remove %s (%d)"), alloc->path, errno);
     }
 
+    virResctrlGroupCacheUpdate(NULL, alloc->path, false);
+
     return ret;
 }
 
@@ -150,6 +150,15 @@ virResctrlAllocSetMemoryBandwidth(virResctrlAllocPtr alloc,
                                   unsigned int id,
                                   unsigned int memory_bandwidth);
 
+int
+virResctrlAllocSetMemoryBandwidthMin(virResctrlAllocPtr alloc,
+                                     unsigned int id,
+                                     unsigned int minimum);
+
+unsigned int
+virResctrlAllocGetMemoryBandwidthMin(virResctrlAllocPtr alloc,
+                                     unsigned int id);
+
 int
 virResctrlAllocForeachMemory(virResctrlAllocPtr alloc,
                              virResctrlAllocForeachMemoryCallback cb,
@@ -173,6 +182,11 @@ virResctrlAllocCreate(virResctrlInfoPtr r_info,
                       virResctrlAllocPtr alloc,
                       const char *machinename);
 
+int
+virResctrlAllocApplyMemoryBandwidth(virResctrlAllocPtr alloc,
+                                    unsigned int id,
+                                    unsigned int memory_bandwidth);
+
 int
 virResctrlAllocAddPID(virResctrlAllocPtr alloc,
                       pid_t pid);
@@ -38,6 +38,9 @@ VIR_LOG_INIT("util.rotatingfile");
 
 #define VIR_MAX_MAX_BACKUP 32
 
+/* Size of the buffer used to relay data which can't be spliced */
+#define VIR_ROTATING_FILE_RELAY_SIZE (64 * 1024)
+
 typedef struct virRotatingFileWriterEntry virRotatingFileWriterEntry;
 typedef virRotatingFileWriterEntry *virRotatingFileWriterEntryPtr;
 
@@ -57,6 +60,8 @@ struct virRotatingFileWriter {
     size_t maxbackup;
     mode_t mode;
     size_t maxlen;
+    bool nosplice; /* file doesn't support splice() */
+    char *relaybuf;
 };
 
 
@@ -108,7 +113,10 @@ virRotatingFileWriterEntryNew(const char *path,
     if (VIR_ALLOC(entry) < 0)
         return NULL;
 
-    if ((entry->fd = open(path, O_CREAT|O_APPEND|O_WRONLY|O_CLOEXEC, mode)) < 0) {
+    /* Not opened with O_APPEND as splice() refuses such files, the offset
+     * is moved to the end of the file below instead and we're the only
+     * writer */
+    if ((entry->fd = open(path, O_CREAT|O_WRONLY|O_CLOEXEC, mode)) < 0) {
         virReportSystemError(errno,
                              _("Unable to open file: %s"), path);
         goto error;
@@ -495,6 +503,78 @@ virRotatingFileWriterAppend(virRotatingFileWriterPtr file,
 }
 
 
+/**
+ * virRotatingFileWriterAppendFromFD:
+ * @file: the file context
+ * @fd: the file descriptor to read the data from
+ * @len: the maximum number of bytes to read
+ *
+ * Append up to @len bytes available from @fd to the file, performing
+ * rollover of the files if their size would exceed the limit. The data
+ * is moved directly from @fd to the file with splice() when @fd is a pipe
+ * and the data is sure to fit in the current file, or is read into a
+ * buffer and appended with virRotatingFileWriterAppend() otherwise.
+ *
+ * Returns the number of bytes appended, 0 at the end of @fd, or -1 on
+ * error
+ */
+ssize_t
+virRotatingFileWriterAppendFromFD(virRotatingFileWriterPtr file,
+                                  int fd,
+                                  size_t len)
+{
+    ssize_t got;
+
+#ifdef HAVE_SPLICE
+    if (!file->nosplice &&
+        file->entry->pos + len <= file->maxlen) {
+        do {
+            got = splice(fd, NULL, file->entry->fd, NULL, len, SPLICE_F_MOVE);
+        } while (got < 0 && errno == EINTR);
+
+        if (got >= 0) {
+            file->entry->pos += got;
+            file->entry->len += got;
+            return got;
+        }
+
+        if (errno != EINVAL && errno != ENOSYS) {
+            virReportSystemError(errno,
+                                 _("Unable to splice data to file %s"),
+                                 file->basepath);
+            return -1;
+        }
+
+        /* @fd isn't a pipe or the file system doesn't support splice */
+        VIR_DEBUG("Cannot splice to %s, falling back to buffered writes",
+                  file->basepath);
+        file->nosplice = true;
+    }
+#endif /* HAVE_SPLICE */
+
+    if (!file->relaybuf)
+        file->relaybuf = g_new0(char, VIR_ROTATING_FILE_RELAY_SIZE);
+
+    len = MIN(len, VIR_ROTATING_FILE_RELAY_SIZE);
+
+    do {
+        got = read(fd, file->relaybuf, len);
+    } while (got < 0 && errno == EINTR);
+
+    if (got < 0) {
+        virReportSystemError(errno,
+                             _("Unable to read data for file %s"),
+                             file->basepath);
+        return -1;
+    }
+
+    if (virRotatingFileWriterAppend(file, file->relaybuf, got) != got)
+        return -1;
+
+    return got;
+}
+
+
 /**
  * virRotatingFileReaderSeek
  * @file: the file context
@@ -612,6 +692,7 @@ virRotatingFileWriterFree(virRotatingFileWriterPtr file)
 
     virRotatingFileWriterEntryFree(file->entry);
     VIR_FREE(file->basepath);
+    VIR_FREE(file->relaybuf);
     VIR_FREE(file);
 }
 
@@ -0,0 +1,355 @@
+/*
+ * virstatsshm.c: domain stats published in shared memory
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef HAVE_MEMFD_CREATE
+# include <sys/mman.h>
+#endif
+
+#include "virstatsshm.h"
+#include "viralloc.h"
+#include "virerror.h"
+#include "virfile.h"
+#include "virlog.h"
+#include "virthread.h"
+#include "virtypedparam.h"
+#include "virutil.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+VIR_LOG_INIT("util.statsshm");
+
+struct _virStatsShm {
+    virMutex lock;
+    int fd;
+    char *map;
+    size_t mapsize;
+};
+
+
+void
+virStatsShmRecordClear(virStatsShmRecordPtr record)
+{
+    g_clear_pointer(&record->name, g_free);
+    virTypedParamsFree(record->params, record->nparams);
+    record->params = NULL;
+    record->nparams = 0;
+}
+
+
+#ifdef HAVE_MEMFD_CREATE
+
+static void
+virStatsShmAppendString(GByteArray *buf,
+                        const char *str)
+{
+    uint32_t len = strlen(str);
+
+    g_byte_array_append(buf, (const guint8 *) &len, sizeof(len));
+    g_byte_array_append(buf, (const guint8 *) str, len + 1);
+}
+
+
+static void
+virStatsShmAppendParam(GByteArray *buf,
+                       virTypedParameterPtr param)
+{
+    uint32_t type = param->type;
+    int64_t ival = 0;
+    uint64_t uval = 0;
+
+    g_byte_array_append(buf, (const guint8 *) &type, sizeof(type));
+    virStatsShmAppendString(buf, param->field);
+
+    switch ((virTypedParameterType) param->type) {
+    case VIR_TYPED_PARAM_INT:
+        ival = param->value.i;
+        break;
+    case VIR_TYPED_PARAM_LLONG:
+        ival = param->value.l;
+        break;
+    case VIR_TYPED_PARAM_BOOLEAN:
+        ival = param->value.b;
+        break;
+    case VIR_TYPED_PARAM_UINT:
+        uval = param->value.ui;
+        g_byte_array_append(buf, (const guint8 *) &uval, sizeof(uval));
+        return;
+    case VIR_TYPED_PARAM_ULLONG:
+        uval = param->value.ul;
+        g_byte_array_append(buf, (const guint8 *) &uval, sizeof(uval));
+        return;
+    case VIR_TYPED_PARAM_DOUBLE:
+        g_byte_array_append(buf, (const guint8 *) &param->value.d,
+                            sizeof(param->value.d));
+        return;
+    case VIR_TYPED_PARAM_STRING:
+        virStatsShmAppendString(buf, NULLSTR_EMPTY(param->value.s));
+        return;
+    case VIR_TYPED_PARAM_LAST:
+        break;
+    }
+
+    g_byte_array_append(buf, (const guint8 *) &ival, sizeof(ival));
+}
+
+
+static void
+virStatsShmAppendRecord(GByteArray *buf,
+                        virStatsShmRecordPtr record)
+{
+    size_t start = buf->len;
+    uint32_t len = 0;
+    uint32_t nparams = record->nparams;
+    size_t i;
+
+    g_byte_array_append(buf, (const guint8 *) &len, sizeof(len));
+    g_byte_array_append(buf, (const guint8 *) &nparams, sizeof(nparams));
+    g_byte_array_append(buf, record->uuid, VIR_UUID_BUFLEN);
+    virStatsShmAppendString(buf, record->name);
+
+    for (i = 0; i < record->nparams; i++)
+        virStatsShmAppendParam(buf, &record->params[i]);
+
+    len = buf->len - start;
+    memcpy(buf->data + start, &len, sizeof(len));
+}
+
+
+/* Grows the region so that it can hold @size bytes. Must be called with
+ * the header marked as being updated, as readers must not rely on the
+ * old size while they may still be copying data. */
+static int
+virStatsShmGrow(virStatsShmPtr shm,
+                size_t size)
+{
+    size_t newsize = shm->mapsize;
+    char *map;
+
+    while (newsize < size)
+        newsize *= 2;
+
+    if (ftruncate(shm->fd, newsize) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot resize stats shared memory"));
+        return -1;
+    }
+
+    map = mremap(shm->map, shm->mapsize, newsize, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED) {
+        virReportSystemError(errno, "%s",
+                             _("cannot remap stats shared memory"));
+        return -1;
+    }
+
+    shm->map = map;
+    shm->mapsize = newsize;
+    return 0;
+}
+
+
+/**
+ * virStatsShmNew:
+ * @name: name of the memfd, shown in /proc for debugging
+ *
+ * Creates a shared memory region for publishing domain stats to local
+ * readers, which get hold of it by virStatsShmOpenReader().
+ *
+ * Returns the new region or NULL on error.
+ */
+virStatsShmPtr
+virStatsShmNew(const char *name)
+{
+    g_autoptr(virStatsShm) shm = g_new0(virStatsShm, 1);
+    virStatsShmHeader *hdr;
+
+    shm->fd = -1;
+
+    if (virMutexInit(&shm->lock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        return NULL;
+    }
+
+    if ((shm->fd = memfd_create(name, MFD_CLOEXEC)) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot create stats shared memory"));
+        return NULL;
+    }
+
+    shm->mapsize = virGetSystemPageSize();
+    if (ftruncate(shm->fd, shm->mapsize) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot resize stats shared memory"));
+        return NULL;
+    }
+
+    shm->map = mmap(NULL, shm->mapsize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, shm->fd, 0);
+    if (shm->map == MAP_FAILED) {
+        shm->map = NULL;
+        virReportSystemError(errno, "%s",
+                             _("cannot map stats shared memory"));
+        return NULL;
+    }
+
+    hdr = (virStatsShmHeader *) shm->map;
+    memcpy(hdr->magic, VIR_STATS_SHM_MAGIC, sizeof(VIR_STATS_SHM_MAGIC));
+    hdr->version = VIR_STATS_SHM_VERSION;
+    hdr->headersize = sizeof(*hdr);
+    hdr->size = shm->mapsize;
+
+    return g_steal_pointer(&shm);
+}
+
+
+/**
+ * virStatsShmPublish:
+ * @shm: the region
+ * @records: stats of domains
+ * @nrecords: number of items in @records
+ * @timestamp: time the stats were gathered, in milliseconds since the epoch
+ *
+ * Replaces the contents of @shm by @records. Readers see either the old
+ * or the new contents in whole.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virStatsShmPublish(virStatsShmPtr shm,
+                   virStatsShmRecordPtr records,
+                   size_t nrecords,
+                   unsigned long long timestamp)
+{
+    g_autoptr(GByteArray) buf = g_byte_array_new();
+    virStatsShmHeader *hdr;
+    uint64_t seq;
+    size_t i;
+    int ret = 0;
+
+    /* serialize first so that readers retry for as short as possible */
+    for (i = 0; i < nrecords; i++)
+        virStatsShmAppendRecord(buf, &records[i]);
+
+    virMutexLock(&shm->lock);
+
+    hdr = (virStatsShmHeader *) shm->map;
+    seq = __atomic_load_n(&hdr->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&hdr->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (sizeof(*hdr) + buf->len > shm->mapsize &&
+        virStatsShmGrow(shm, sizeof(*hdr) + buf->len) < 0) {
+        ret = -1;
+    } else {
+        hdr = (virStatsShmHeader *) shm->map;
+        memcpy(shm->map + sizeof(*hdr), buf->data, buf->len);
+        hdr->size = shm->mapsize;
+        hdr->datalen = buf->len;
+        hdr->nrecords = nrecords;
+        hdr->timestamp = timestamp;
+    }
+
+    __atomic_store_n(&hdr->seq, seq + 2, __ATOMIC_RELEASE);
+
+    virMutexUnlock(&shm->lock);
+
+    return ret;
+}
+
+
+/**
+ * virStatsShmOpenReader:
+ * @shm: the region
+ *
+ * Opens @shm read-only, e.g. to pass the returned file descriptor to
+ * another process, which can only map it for reading.
+ *
+ * Returns a file descriptor the caller must close, or -1 on error.
+ */
+int
+virStatsShmOpenReader(virStatsShmPtr shm)
+{
+    g_autofree char *path = g_strdup_printf("/proc/self/fd/%d", shm->fd);
+    int fd;
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot open stats shared memory"));
+        return -1;
+    }
+
+    return fd;
+}
+
+
+void
+virStatsShmFree(virStatsShmPtr shm)
+{
+    if (!shm)
+        return;
+
+    if (shm->map)
+        munmap(shm->map, shm->mapsize);
+    VIR_FORCE_CLOSE(shm->fd);
+    virMutexDestroy(&shm->lock);
+    g_free(shm);
+}
+
+#else /* !HAVE_MEMFD_CREATE */
+
+virStatsShmPtr
+virStatsShmNew(const char *name G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("stats shared memory is not supported on this platform"));
+    return NULL;
+}
+
+
+int
+virStatsShmPublish(virStatsShmPtr shm G_GNUC_UNUSED,
+                   virStatsShmRecordPtr records G_GNUC_UNUSED,
+                   size_t nrecords G_GNUC_UNUSED,
+                   unsigned long long timestamp G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("stats shared memory is not supported on this platform"));
+    return -1;
+}
+
+
+int
+virStatsShmOpenReader(virStatsShmPtr shm G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("stats shared memory is not supported on this platform"));
+    return -1;
+}
+
+
+void
+virStatsShmFree(virStatsShmPtr shm)
+{
+    g_free(shm);
+}
+
+#endif /* !HAVE_MEMFD_CREATE */
@@ -0,0 +1,100 @@
+/*
+ * virstatsshm.h: domain stats published in shared memory
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "internal.h"
+#include "viruuid.h"
+
+#define VIR_STATS_SHM_MAGIC "LVSTATS"
+#define VIR_STATS_SHM_VERSION 1
+
+/*
+ * Layout of the region, all integers are in host byte order:
+ *
+ * The region starts with virStatsShmHeader followed by @nrecords records
+ * taking @datalen bytes. Each record is
+ *
+ *   uint32 length of the record including this field
+ *   uint32 number of parameters
+ *   uint8[16] domain UUID
+ *   string domain name
+ *
+ * followed by the parameters, each being
+ *
+ *   uint32 virTypedParameterType
+ *   string field name
+ *   value: int64 for VIR_TYPED_PARAM_INT, VIR_TYPED_PARAM_LLONG and
+ *          VIR_TYPED_PARAM_BOOLEAN, uint64 for VIR_TYPED_PARAM_UINT and
+ *          VIR_TYPED_PARAM_ULLONG, double for VIR_TYPED_PARAM_DOUBLE and
+ *          string for VIR_TYPED_PARAM_STRING
+ *
+ * where string is a uint32 length followed by that many bytes and a NUL.
+ * Nothing within the records is aligned.
+ *
+ * @seq is odd while the region is being updated. Readers load it, copy
+ * whatever they need and load it again, and retry if it was odd or has
+ * changed. The region never shrinks; readers remap it when @size grows
+ * past their mapping.
+ */
+typedef struct _virStatsShmHeader virStatsShmHeader;
+struct _virStatsShmHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headersize;
+    uint64_t seq;
+    uint64_t size;
+    uint64_t datalen;
+    uint64_t timestamp; /* milliseconds since the epoch */
+    uint32_t nrecords;
+    uint32_t reserved[3];
+};
+
+typedef struct _virStatsShmRecord virStatsShmRecord;
+typedef virStatsShmRecord *virStatsShmRecordPtr;
+struct _virStatsShmRecord {
+    char *name;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    virTypedParameterPtr params;
+    int nparams;
+};
+
+void
+virStatsShmRecordClear(virStatsShmRecordPtr record);
+
+typedef struct _virStatsShm virStatsShm;
+typedef virStatsShm *virStatsShmPtr;
+
+virStatsShmPtr
+virStatsShmNew(const char *name);
+
+void
+virStatsShmFree(virStatsShmPtr shm);
+
+int
+virStatsShmPublish(virStatsShmPtr shm,
+                   virStatsShmRecordPtr records,
+                   size_t nrecords,
+                   unsigned long long timestamp)
+    ATTRIBUTE_NONNULL(1);
+
+int
+virStatsShmOpenReader(virStatsShmPtr shm)
+    ATTRIBUTE_NONNULL(1);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virStatsShm, virStatsShmFree);
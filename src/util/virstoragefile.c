@@ -40,6 +40,7 @@
 #include "virstorageencryption.h"
 #include "virsecret.h"
 #include "virutil.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
 
@@ -5178,6 +5179,164 @@ virStorageFileReportBrokenChain(int errcode,
 }
 
 
+/*
+ * Headers of image files read while walking backing chains. Many
+ * domains commonly share the same base images, so each of their
+ * chains would otherwise read the same headers again. An entry is
+ * only used while the file still looks the same as when it was read,
+ * so it gets invalidated by any change to the file.
+ */
+#define VIR_STORAGE_HEADER_CACHE_MAX 1024
+
+/* Files modified this recently may still be written to within the
+ * resolution of their timestamps, so their headers are not cached */
+#define VIR_STORAGE_HEADER_CACHE_SETTLE_SEC 2
+
+typedef struct _virStorageFileHeaderCacheEntry virStorageFileHeaderCacheEntry;
+typedef virStorageFileHeaderCacheEntry *virStorageFileHeaderCacheEntryPtr;
+struct _virStorageFileHeaderCacheEntry {
+    uid_t uid;
+    gid_t gid;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+    char *buf;
+    size_t len;
+};
+
+static virMutex virStorageFileHeaderCacheLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr virStorageFileHeaderCache;
+
+
+static void
+virStorageFileHeaderCacheEntryFree(void *opaque)
+{
+    virStorageFileHeaderCacheEntryPtr entry = opaque;
+
+    g_free(entry->buf);
+    g_free(entry);
+}
+
+
+static void
+virStorageFileHeaderCacheFillEntry(virStorageFileHeaderCacheEntryPtr entry,
+                                   uid_t uid,
+                                   gid_t gid,
+                                   struct stat *st)
+{
+    entry->uid = uid;
+    entry->gid = gid;
+    entry->dev = st->st_dev;
+    entry->ino = st->st_ino;
+    entry->size = st->st_size;
+#ifdef __APPLE__
+    entry->mtime = st->st_mtimespec;
+    entry->ctime = st->st_ctimespec;
+#else /* ! __APPLE__ */
+    entry->mtime = st->st_mtim;
+    entry->ctime = st->st_ctim;
+#endif /* ! __APPLE__ */
+}
+
+
+static bool
+virStorageFileHeaderCacheEntryMatch(virStorageFileHeaderCacheEntryPtr a,
+                                    virStorageFileHeaderCacheEntryPtr b)
+{
+    return a->uid == b->uid &&
+        a->gid == b->gid &&
+        a->dev == b->dev &&
+        a->ino == b->ino &&
+        a->size == b->size &&
+        a->mtime.tv_sec == b->mtime.tv_sec &&
+        a->mtime.tv_nsec == b->mtime.tv_nsec &&
+        a->ctime.tv_sec == b->ctime.tv_sec &&
+        a->ctime.tv_nsec == b->ctime.tv_nsec;
+}
+
+
+/*
+ * Look up the header of @name, which is described by @st and about to
+ * be read on behalf of @uid:@gid. Returns true and fills @buf and @len
+ * with a copy of the header if it's cached.
+ */
+static bool
+virStorageFileHeaderCacheLookup(const char *name,
+                                uid_t uid,
+                                gid_t gid,
+                                struct stat *st,
+                                char **buf,
+                                size_t *len)
+{
+    virStorageFileHeaderCacheEntry key = { 0 };
+    virStorageFileHeaderCacheEntryPtr entry;
+    bool ret = false;
+
+    virStorageFileHeaderCacheFillEntry(&key, uid, gid, st);
+
+    virMutexLock(&virStorageFileHeaderCacheLock);
+
+    if (virStorageFileHeaderCache &&
+        (entry = virHashLookup(virStorageFileHeaderCache, name))) {
+        if (virStorageFileHeaderCacheEntryMatch(entry, &key)) {
+            *buf = g_memdup(entry->buf, entry->len);
+            *len = entry->len;
+            ret = true;
+        } else {
+            virHashRemoveEntry(virStorageFileHeaderCache, name);
+        }
+    }
+
+    virMutexUnlock(&virStorageFileHeaderCacheLock);
+
+    return ret;
+}
+
+
+static void
+virStorageFileHeaderCacheStore(const char *name,
+                               uid_t uid,
+                               gid_t gid,
+                               struct stat *st,
+                               const char *buf,
+                               size_t len)
+{
+    virStorageFileHeaderCacheEntryPtr entry;
+    time_t settled = time(NULL) - VIR_STORAGE_HEADER_CACHE_SETTLE_SEC;
+
+    if (len == 0 || st->st_mtime >= settled || st->st_ctime >= settled)
+        return;
+
+    entry = g_new0(virStorageFileHeaderCacheEntry, 1);
+    virStorageFileHeaderCacheFillEntry(entry, uid, gid, st);
+    entry->buf = g_memdup(buf, len);
+    entry->len = len;
+
+    virMutexLock(&virStorageFileHeaderCacheLock);
+
+    if (!virStorageFileHeaderCache &&
+        !(virStorageFileHeaderCache = virHashNew(virStorageFileHeaderCacheEntryFree))) {
+        virResetLastError();
+        virStorageFileHeaderCacheEntryFree(entry);
+        goto cleanup;
+    }
+
+    /* Rather than tracking usage, start over once the cache is full */
+    if (virHashSize(virStorageFileHeaderCache) >= VIR_STORAGE_HEADER_CACHE_MAX)
+        virHashRemoveAll(virStorageFileHeaderCache);
+
+    if (virHashUpdateEntry(virStorageFileHeaderCache, name, entry) < 0) {
+        virResetLastError();
+        virStorageFileHeaderCacheEntryFree(entry);
+    }
+
+ cleanup:
+    virMutexUnlock(&virStorageFileHeaderCacheLock);
+}
+
+
 static int
 virStorageFileGetMetadataRecurseReadHeader(virStorageSourcePtr src,
                                            virStorageSourcePtr parent,
@@ -5190,6 +5349,8 @@ virStorageFileGetMetadataRecurseReadHeader(virStorageSourcePtr src,
     int ret = -1;
     const char *uniqueName;
     ssize_t len;
+    struct stat st;
+    bool cacheable = false;
 
     if (virStorageFileInitAs(src, uid, gid) < 0)
         return -1;
@@ -5212,9 +5373,24 @@ virStorageFileGetMetadataRecurseReadHeader(virStorageSourcePtr src,
     if (virHashAddEntry(cycle, uniqueName, NULL) < 0)
         goto cleanup;
 
+    /* Only regular files reliably change their timestamps on writes */
+    if (virStorageFileStat(src, &st) == 0 && S_ISREG(st.st_mode))
+        cacheable = true;
+
+    if (cacheable &&
+        virStorageFileHeaderCacheLookup(uniqueName, uid, gid, &st,
+                                        buf, headerLen)) {
+        VIR_DEBUG("using cached header of '%s'", uniqueName);
+        ret = 0;
+        goto cleanup;
+    }
+
     if ((len = virStorageFileRead(src, 0, VIR_STORAGE_MAX_HEADER, buf)) < 0)
         goto cleanup;
 
+    if (cacheable)
+        virStorageFileHeaderCacheStore(uniqueName, uid, gid, &st, *buf, len);
+
     *headerLen = len;
     ret = 0;
 
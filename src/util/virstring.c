@@ -1349,3 +1349,112 @@ int virStringParseYesNo(const char *str, bool *result)
 
     return 0;
 }
+
+
+/* Interned strings and the number of references to each of them */
+static virMutex virStringInternLock = VIR_MUTEX_INITIALIZER;
+static GHashTable *virStringInternTable;
+static size_t virStringInternRefs;
+static size_t virStringInternBytes;
+
+
+/**
+ * virStringIntern:
+ * @str: string to intern, may be NULL
+ *
+ * Returns a shared copy of @str, which must not be modified and has to be
+ * released using virStringInternRelease() instead of being freed. Meant
+ * for strings repeated in many objects, such as CPU feature names, which
+ * are then kept in memory only once.
+ */
+const char *
+virStringIntern(const char *str)
+{
+    gpointer key;
+    gpointer value;
+    size_t *refs;
+
+    if (!str)
+        return NULL;
+
+    virMutexLock(&virStringInternLock);
+
+    if (!virStringInternTable)
+        virStringInternTable = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                     g_free, g_free);
+
+    if (g_hash_table_lookup_extended(virStringInternTable, str, &key, &value)) {
+        refs = value;
+    } else {
+        key = g_strdup(str);
+        refs = g_new0(size_t, 1);
+        g_hash_table_insert(virStringInternTable, key, refs);
+        virStringInternBytes += strlen(str) + 1;
+    }
+
+    (*refs)++;
+    virStringInternRefs++;
+
+    virMutexUnlock(&virStringInternLock);
+
+    return key;
+}
+
+
+/**
+ * virStringInternRelease:
+ * @str: string returned by virStringIntern() or NULL
+ *
+ * Releases a reference to an interned string.
+ */
+void
+virStringInternRelease(const char *str)
+{
+    gpointer key;
+    gpointer value;
+    size_t *refs;
+
+    if (!str)
+        return;
+
+    virMutexLock(&virStringInternLock);
+
+    if (!virStringInternTable ||
+        !g_hash_table_lookup_extended(virStringInternTable, str, &key, &value) ||
+        key != str) {
+        virMutexUnlock(&virStringInternLock);
+        VIR_WARN("string '%s' is not interned", str);
+        return;
+    }
+
+    refs = value;
+    virStringInternRefs--;
+
+    if (--(*refs) == 0) {
+        virStringInternBytes -= strlen(str) + 1;
+        g_hash_table_remove(virStringInternTable, key);
+    }
+
+    virMutexUnlock(&virStringInternLock);
+}
+
+
+/**
+ * virStringInternGetStats:
+ * @stats: filled with the statistics of interned strings
+ *
+ * Reports how many distinct strings are interned, how many references
+ * to them exist, and the memory used by the strings.
+ */
+void
+virStringInternGetStats(virStringInternStatsPtr stats)
+{
+    virMutexLock(&virStringInternLock);
+
+    stats->strings = virStringInternTable ?
+        g_hash_table_size(virStringInternTable) : 0;
+    stats->refs = virStringInternRefs;
+    stats->bytes = virStringInternBytes;
+
+    virMutexUnlock(&virStringInternLock);
+}
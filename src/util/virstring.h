@@ -179,6 +179,19 @@ int virStringParsePort(const char *str,
 int virStringParseYesNo(const char *str,
                         bool *result)
     G_GNUC_WARN_UNUSED_RESULT;
+const char *virStringIntern(const char *str);
+void virStringInternRelease(const char *str);
+
+typedef struct _virStringInternStats virStringInternStats;
+typedef virStringInternStats *virStringInternStatsPtr;
+struct _virStringInternStats {
+    size_t strings; /* number of distinct interned strings */
+    size_t refs; /* number of references to them */
+    size_t bytes; /* memory used by the strings themselves */
+};
+
+void virStringInternGetStats(virStringInternStatsPtr stats);
+
 /**
  * VIR_AUTOSTRINGLIST:
  *
@@ -278,7 +278,7 @@ int virSystemdCreateMachine(const char *name,
     DBusConnection *conn;
     char *creatorname = NULL;
     char *slicename = NULL;
-    char *scopename = NULL;
+    int nprops = maxthreads > 0 ? 4 : 3;
     static int hasCreateWithNetwork = 1;
 
     if ((ret = virSystemdHasMachined()) < 0)
@@ -343,7 +343,12 @@ int virSystemdCreateMachine(const char *name,
      *
      * @scope_properties:an array (not a dict!) of properties that are
      * passed on to PID 1 when creating a scope unit for your machine.
-     * Will allow initial settings for the cgroup & similar.
+     * Will allow initial settings for the cgroup & similar. TasksMax is
+     * set here too rather than by a separate SetUnitProperties call,
+     * saving a round trip to systemd on every machine start. It is the
+     * last property, so that leaving it out when @maxthreads is 0 only
+     * means passing a smaller count; the encoder ignores the trailing
+     * arguments.
      *
      * @path: a bus path returned for the machine object created, to
      * allow further API calls to be made against the object.
@@ -374,10 +379,11 @@ int virSystemdCreateMachine(const char *name,
                               (unsigned int)pidleader,
                               NULLSTR_EMPTY(rootdir),
                               nnicindexes, nicindexes,
-                              3,
+                              nprops,
                               "Slice", "s", slicename,
                               "After", "as", 1, "libvirtd.service",
-                              "Before", "as", 1, "virt-guest-shutdown.target") < 0)
+                              "Before", "as", 1, "virt-guest-shutdown.target",
+                              "TasksMax", "t", (uint64_t)maxthreads) < 0)
             goto cleanup;
 
         if (error.level == VIR_ERR_ERROR) {
@@ -415,28 +421,10 @@ int virSystemdCreateMachine(const char *name,
                               iscontainer ? "container" : "vm",
                               (unsigned int)pidleader,
                               NULLSTR_EMPTY(rootdir),
-                              3,
+                              nprops,
                               "Slice", "s", slicename,
                               "After", "as", 1, "libvirtd.service",
-                              "Before", "as", 1, "virt-guest-shutdown.target") < 0)
-            goto cleanup;
-    }
-
-    if (maxthreads > 0) {
-        if (!(scopename = virSystemdMakeScopeName(name, drivername, false)))
-            goto cleanup;
-
-        if (virDBusCallMethod(conn,
-                              NULL,
-                              NULL,
-                              "org.freedesktop.systemd1",
-                              "/org/freedesktop/systemd1",
-                              "org.freedesktop.systemd1.Manager",
-                              "SetUnitProperties",
-                              "sba(sv)",
-                              scopename,
-                              true,
-                              1,
+                              "Before", "as", 1, "virt-guest-shutdown.target",
                               "TasksMax", "t", (uint64_t)maxthreads) < 0)
             goto cleanup;
     }
@@ -446,28 +434,33 @@ int virSystemdCreateMachine(const char *name,
  cleanup:
     VIR_FREE(creatorname);
     VIR_FREE(slicename);
-    VIR_FREE(scopename);
     return ret;
 }
 
+/**
+ * virSystemdTerminateMachine:
+ * @name: name of the machine
+ *
+ * Asks systemd-machined to terminate the machine @name. The reply is not
+ * waited for, the caller has no use for it and machined may take its time
+ * stopping the scope. Errors other than the machine being gone already
+ * are logged once the reply arrives.
+ *
+ * Returns 0 on success, -1 on fatal error, or -2 if systemd-machine is not available
+ */
 int virSystemdTerminateMachine(const char *name)
 {
     int ret;
     DBusConnection *conn;
-    virError error;
 
     if (!name)
         return 0;
 
-    memset(&error, 0, sizeof(error));
-
     if ((ret = virSystemdHasMachined()) < 0)
-        goto cleanup;
-
-    ret = -1;
+        return ret;
 
     if (!(conn = virDBusGetSystemBus()))
-        goto cleanup;
+        return -1;
 
     /*
      * The systemd DBus API we're invoking has the
@@ -480,30 +473,14 @@ int virSystemdTerminateMachine(const char *name)
      */
 
     VIR_DEBUG("Attempting to terminate machine via systemd");
-    if (virDBusCallMethod(conn,
-                          NULL,
-                          &error,
-                          "org.freedesktop.machine1",
-                          "/org/freedesktop/machine1",
-                          "org.freedesktop.machine1.Manager",
-                          "TerminateMachine",
-                          "s",
-                          name) < 0)
-        goto cleanup;
-
-    if (error.level == VIR_ERR_ERROR &&
-        STRNEQ_NULLABLE("org.freedesktop.machine1.NoSuchMachine",
-                        error.str1)) {
-        virReportErrorObject(&error);
-        goto cleanup;
-    }
-
-    ret = 0;
-
- cleanup:
-    virResetError(&error);
-
-    return ret;
+    return virDBusCallMethodAsync(conn,
+                                  "org.freedesktop.machine1.NoSuchMachine",
+                                  "org.freedesktop.machine1",
+                                  "/org/freedesktop/machine1",
+                                  "org.freedesktop.machine1.Manager",
+                                  "TerminateMachine",
+                                  "s",
+                                  name);
 }
 
 void
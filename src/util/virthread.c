@@ -83,6 +83,12 @@ void virMutexLock(virMutexPtr m)
     pthread_mutex_lock(&m->lock);
 }
 
+/* Returns true if @m was acquired, false if it is held by another thread */
+bool virMutexTryLock(virMutexPtr m)
+{
+    return pthread_mutex_trylock(&m->lock) == 0;
+}
+
 void virMutexUnlock(virMutexPtr m)
 {
     pthread_mutex_unlock(&m->lock);
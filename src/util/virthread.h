@@ -130,6 +130,7 @@ int virMutexInitRecursive(virMutexPtr m) G_GNUC_WARN_UNUSED_RESULT;
 void virMutexDestroy(virMutexPtr m);
 
 void virMutexLock(virMutexPtr m);
+bool virMutexTryLock(virMutexPtr m) G_GNUC_WARN_UNUSED_RESULT;
 void virMutexUnlock(virMutexPtr m);
 
 
@@ -26,16 +26,23 @@
 #include "viralloc.h"
 #include "virthread.h"
 #include "virerror.h"
+#include "virtime.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
+/* Number of queues fast and normal jobs are spread over */
+#define VIR_THREAD_POOL_QUEUES 16
+
+/* How long a worker may be idle before an adaptive pool retires it, in ms */
+#define VIR_THREAD_POOL_IDLE_TIMEOUT 5000
+
 typedef struct _virThreadPoolJob virThreadPoolJob;
 typedef virThreadPoolJob *virThreadPoolJobPtr;
 
 struct _virThreadPoolJob {
-    virThreadPoolJobPtr prev;
     virThreadPoolJobPtr next;
-    unsigned int priority;
+    unsigned int jobClass;
+    unsigned long long queued; /* in microseconds */
 
     void *data;
 };
@@ -46,18 +53,57 @@ typedef virThreadPoolJobList *virThreadPoolJobListPtr;
 struct _virThreadPoolJobList {
     virThreadPoolJobPtr head;
     virThreadPoolJobPtr tail;
-    virThreadPoolJobPtr firstPrio;
+};
+
+/*
+ * Fast and normal jobs are queued round-robin in one of several
+ * queues, each with its own lock. A worker takes jobs from its home
+ * queue and steals them from the other queues once it is empty, so
+ * submitting and taking jobs rarely contends on a single lock.
+ */
+typedef struct _virThreadPoolQueue virThreadPoolQueue;
+typedef virThreadPoolQueue *virThreadPoolQueuePtr;
+
+struct _virThreadPoolQueue {
+    virMutex lock;
+    virThreadPoolJobList fastJobs;
+    virThreadPoolJobList jobs;
 };
 
 
 struct _virThreadPool {
-    bool quit;
+    int quit; /* atomic */
+    int resize; /* atomic, set if some workers have to quit */
 
     virThreadPoolJobFunc jobFunc;
     const char *jobName;
     void *jobOpaque;
-    virThreadPoolJobList jobList;
-    size_t jobQueueDepth;
+
+    virThreadPoolQueue queues[VIR_THREAD_POOL_QUEUES];
+    size_t nqueues;
+    int nextQueue; /* atomic */
+    int nFastQueued; /* atomic */
+    int nQueued; /* atomic, including @nFastQueued */
+
+    /* Priority and long running jobs are queued with @mutex held, but
+     * their counts may be peeked at without it */
+    virThreadPoolJobList prioJobs;
+    int nPrioJobs; /* atomic */
+    virThreadPoolJobList longJobs;
+    int nLongJobs; /* atomic */
+    size_t nLongRunning;
+
+    int jobQueueDepth; /* atomic */
+
+    /* Moving averages of how long jobs wait in the queue and how long
+     * they run, in microseconds */
+    virMutex statsLock;
+    unsigned long long waitTime;
+    unsigned long long runTime;
+
+    /* The queue wait an adaptive pool aims for, 0 if the pool grows
+     * whenever all workers are busy and never shrinks */
+    unsigned long long targetLatency;
 
     virMutex mutex;
     virCond cond;
@@ -65,8 +111,9 @@ struct _virThreadPool {
 
     size_t maxWorkers;
     size_t minWorkers;
-    size_t freeWorkers;
+    int freeWorkers; /* atomic, only modified with @mutex held */
     size_t nWorkers;
+    size_t nextHome;
     virThreadPtr workers;
 
     size_t maxPrioWorkers;
@@ -79,6 +126,7 @@ struct virThreadPoolWorkerData {
     virThreadPoolPtr pool;
     virCondPtr cond;
     bool priority;
+    size_t home;
 };
 
 /* Test whether the worker needs to quit if the current number of workers @count
@@ -89,87 +137,302 @@ static inline bool virThreadPoolWorkerQuitHelper(size_t count, size_t limit)
     return count > limit;
 }
 
+
+static void
+virThreadPoolJobListAppend(virThreadPoolJobListPtr list,
+                           virThreadPoolJobPtr job)
+{
+    if (list->tail)
+        list->tail->next = job;
+    else
+        list->head = job;
+    list->tail = job;
+}
+
+
+static virThreadPoolJobPtr
+virThreadPoolJobListPop(virThreadPoolJobListPtr list)
+{
+    virThreadPoolJobPtr job = list->head;
+
+    if (job) {
+        list->head = job->next;
+        if (!list->head)
+            list->tail = NULL;
+        job->next = NULL;
+    }
+
+    return job;
+}
+
+
+static void
+virThreadPoolJobListClear(virThreadPoolJobListPtr list)
+{
+    virThreadPoolJobPtr job;
+
+    while ((job = virThreadPoolJobListPop(list)))
+        VIR_FREE(job);
+}
+
+
+/* Long running jobs may occupy at most half of the workers so that
+ * there are always some left for the other jobs. */
+static size_t
+virThreadPoolLongJobLimit(virThreadPoolPtr pool)
+{
+    return pool->maxWorkers > 1 ? (pool->maxWorkers + 1) / 2 : 1;
+}
+
+
+/* Must be called with @pool->mutex held */
+static bool
+virThreadPoolHasJob(virThreadPoolPtr pool, bool priority)
+{
+    if (g_atomic_int_get(&pool->nPrioJobs) > 0)
+        return true;
+
+    if (priority)
+        return false;
+
+    return g_atomic_int_get(&pool->nQueued) > 0 ||
+        (g_atomic_int_get(&pool->nLongJobs) > 0 &&
+         pool->nLongRunning < virThreadPoolLongJobLimit(pool));
+}
+
+
+/* Must be called with @pool->mutex held */
+static void
+virThreadPoolResizeDone(virThreadPoolPtr pool)
+{
+    if (pool->nWorkers <= pool->maxWorkers &&
+        pool->nPrioWorkers <= pool->maxPrioWorkers)
+        g_atomic_int_set(&pool->resize, 0);
+}
+
+
+static void
+virThreadPoolUpdateStats(virThreadPoolPtr pool,
+                         unsigned long long waitTime,
+                         unsigned long long runTime)
+{
+    virMutexLock(&pool->statsLock);
+    pool->waitTime = (pool->waitTime * 7 + waitTime) / 8;
+    pool->runTime = (pool->runTime * 7 + runTime) / 8;
+    virMutexUnlock(&pool->statsLock);
+}
+
+
+/*
+ * Decide whether a job being submitted while all workers are busy
+ * should get a new worker. An adaptive pool only grows if the job is
+ * expected to wait longer than the latency target, either because
+ * jobs already do or because of the number of jobs queued ahead of it.
+ *
+ * Must be called with @pool->mutex held.
+ */
+static bool
+virThreadPoolNeedsWorker(virThreadPoolPtr pool)
+{
+    unsigned long long waitTime;
+    unsigned long long runTime;
+    unsigned long long expected;
+
+    if (pool->nWorkers >= pool->maxWorkers)
+        return false;
+
+    if (pool->targetLatency == 0 || pool->nWorkers == 0)
+        return true;
+
+    virMutexLock(&pool->statsLock);
+    waitTime = pool->waitTime;
+    runTime = pool->runTime;
+    virMutexUnlock(&pool->statsLock);
+
+    /* Nothing is known about the jobs yet, so play safe */
+    if (runTime == 0)
+        return true;
+
+    expected = runTime * (g_atomic_int_get(&pool->jobQueueDepth) + 1) /
+        pool->nWorkers;
+
+    return MAX(waitTime, expected) > pool->targetLatency;
+}
+
+
+static virThreadPoolJobPtr
+virThreadPoolStealJob(virThreadPoolPtr pool,
+                      size_t home,
+                      bool fast)
+{
+    virThreadPoolJobPtr job = NULL;
+    size_t i;
+
+    for (i = 0; i < VIR_THREAD_POOL_QUEUES && !job; i++) {
+        virThreadPoolQueuePtr queue;
+
+        queue = &pool->queues[(home + i) % VIR_THREAD_POOL_QUEUES];
+
+        virMutexLock(&queue->lock);
+        job = virThreadPoolJobListPop(fast ? &queue->fastJobs : &queue->jobs);
+        virMutexUnlock(&queue->lock);
+    }
+
+    if (job) {
+        if (fast)
+            g_atomic_int_add(&pool->nFastQueued, -1);
+        g_atomic_int_add(&pool->nQueued, -1);
+    }
+
+    return job;
+}
+
+
+/*
+ * Take the next job a worker should process. Priority jobs come
+ * first, followed by long running jobs as long as they don't occupy
+ * too many workers, fast and normal jobs. Priority workers only
+ * process priority jobs.
+ *
+ * Must be called without @pool->mutex held.
+ */
+static virThreadPoolJobPtr
+virThreadPoolTakeJob(virThreadPoolPtr pool,
+                     size_t home,
+                     bool priority)
+{
+    virThreadPoolJobPtr job = NULL;
+
+    if (g_atomic_int_get(&pool->nPrioJobs) > 0 ||
+        (!priority && g_atomic_int_get(&pool->nLongJobs) > 0)) {
+        virMutexLock(&pool->mutex);
+        if ((job = virThreadPoolJobListPop(&pool->prioJobs))) {
+            g_atomic_int_add(&pool->nPrioJobs, -1);
+        } else if (!priority &&
+                   pool->nLongRunning < virThreadPoolLongJobLimit(pool) &&
+                   (job = virThreadPoolJobListPop(&pool->longJobs))) {
+            g_atomic_int_add(&pool->nLongJobs, -1);
+            pool->nLongRunning++;
+        }
+        virMutexUnlock(&pool->mutex);
+    }
+
+    if (!job && !priority) {
+        if (g_atomic_int_get(&pool->nFastQueued) > 0)
+            job = virThreadPoolStealJob(pool, home, true);
+        if (!job && g_atomic_int_get(&pool->nQueued) > 0)
+            job = virThreadPoolStealJob(pool, home, false);
+    }
+
+    if (job)
+        g_atomic_int_add(&pool->jobQueueDepth, -1);
+
+    return job;
+}
+
+
 static void virThreadPoolWorker(void *opaque)
 {
     struct virThreadPoolWorkerData *data = opaque;
     virThreadPoolPtr pool = data->pool;
     virCondPtr cond = data->cond;
     bool priority = data->priority;
+    size_t home = data->home;
     size_t *curWorkers = priority ? &pool->nPrioWorkers : &pool->nWorkers;
     size_t *maxLimit = priority ? &pool->maxPrioWorkers : &pool->maxWorkers;
     virThreadPoolJobPtr job = NULL;
+    unsigned long long start;
 
     VIR_FREE(data);
 
-    virMutexLock(&pool->mutex);
-
     while (1) {
+        if (g_atomic_int_get(&pool->quit))
+            break;
+
         /* In order to support async worker termination, we need ensure that
          * both busy and free workers know if they need to terminated. Thus,
-         * busy workers need to check for this fact before they start waiting for
-         * another job (and before taking another one from the queue); and
-         * free workers need to check for this right after waking up.
+         * busy workers need to check for this fact before they take another
+         * job from the queue; and free workers need to check for this right
+         * after waking up.
          */
-        if (virThreadPoolWorkerQuitHelper(*curWorkers, *maxLimit))
-            goto out;
-        while (!pool->quit &&
-               ((!priority && !pool->jobList.head) ||
-                (priority && !pool->jobList.firstPrio))) {
-            if (!priority)
-                pool->freeWorkers++;
-            if (virCondWait(cond, &pool->mutex) < 0) {
-                if (!priority)
-                    pool->freeWorkers--;
-                goto out;
-            }
-            if (!priority)
-                pool->freeWorkers--;
-
+        if (g_atomic_int_get(&pool->resize)) {
+            virMutexLock(&pool->mutex);
             if (virThreadPoolWorkerQuitHelper(*curWorkers, *maxLimit))
                 goto out;
+            virThreadPoolResizeDone(pool);
+            virMutexUnlock(&pool->mutex);
         }
 
-        if (pool->quit)
-            break;
+        if (!(job = virThreadPoolTakeJob(pool, home, priority))) {
+            bool idle = false;
+            int rc = 0;
 
-        if (priority) {
-            job = pool->jobList.firstPrio;
-        } else {
-            job = pool->jobList.head;
-        }
+            virMutexLock(&pool->mutex);
+            if (pool->quit ||
+                virThreadPoolWorkerQuitHelper(*curWorkers, *maxLimit))
+                goto out;
 
-        if (job == pool->jobList.firstPrio) {
-            virThreadPoolJobPtr tmp = job->next;
-            while (tmp) {
-                if (tmp->priority)
-                    break;
-                tmp = tmp->next;
+            /* Submitters of fast and normal jobs only wake workers up
+             * if they see any free, so we have to announce ourselves
+             * before the final check for queued jobs. */
+            if (!priority)
+                g_atomic_int_inc(&pool->freeWorkers);
+            if (!virThreadPoolHasJob(pool, priority)) {
+                unsigned long long now;
+
+                if (!priority && pool->targetLatency > 0 &&
+                    virTimeMillisNow(&now) == 0) {
+                    rc = virCondWaitUntil(cond, &pool->mutex,
+                                          now + VIR_THREAD_POOL_IDLE_TIMEOUT);
+                    if (rc < 0 && errno == ETIMEDOUT) {
+                        idle = true;
+                        rc = 0;
+                    }
+                } else {
+                    rc = virCondWait(cond, &pool->mutex);
+                }
             }
-            pool->jobList.firstPrio = tmp;
-        }
+            if (!priority)
+                g_atomic_int_add(&pool->freeWorkers, -1);
 
-        if (job->prev)
-            job->prev->next = job->next;
-        else
-            pool->jobList.head = job->next;
-        if (job->next)
-            job->next->prev = job->prev;
-        else
-            pool->jobList.tail = job->prev;
+            if (rc < 0)
+                goto out;
+
+            /* An adaptive pool has more workers than it needs if one
+             * of them had nothing to do for the whole timeout */
+            if (idle && pool->targetLatency > 0 &&
+                pool->nWorkers > pool->minWorkers &&
+                !virThreadPoolHasJob(pool, false))
+                goto out;
 
-        pool->jobQueueDepth--;
+            virMutexUnlock(&pool->mutex);
+            continue;
+        }
 
-        virMutexUnlock(&pool->mutex);
+        start = g_get_monotonic_time();
         (pool->jobFunc)(job->data, pool->jobOpaque);
+        virThreadPoolUpdateStats(pool, start - job->queued,
+                                 g_get_monotonic_time() - start);
+
+        if (job->jobClass == VIR_THREAD_POOL_JOB_LONG) {
+            virMutexLock(&pool->mutex);
+            pool->nLongRunning--;
+            if (g_atomic_int_get(&pool->nLongJobs) > 0)
+                virCondSignal(&pool->cond);
+            virMutexUnlock(&pool->mutex);
+        }
+
         VIR_FREE(job);
-        virMutexLock(&pool->mutex);
     }
 
+    virMutexLock(&pool->mutex);
+
  out:
     if (priority)
         pool->nPrioWorkers--;
     else
         pool->nWorkers--;
+    virThreadPoolResizeDone(pool);
     if (pool->nWorkers == 0 && pool->nPrioWorkers == 0)
         virCondSignal(&pool->quit_cond);
     virMutexUnlock(&pool->mutex);
@@ -194,6 +457,7 @@ virThreadPoolExpand(virThreadPoolPtr pool, size_t gain, bool priority)
         data->pool = pool;
         data->cond = priority ? &pool->prioCond : &pool->cond;
         data->priority = priority;
+        data->home = pool->nextHome++ % VIR_THREAD_POOL_QUEUES;
 
         if (priority)
             name = g_strdup_printf("prio-%s", pool->jobName);
@@ -235,12 +499,17 @@ virThreadPoolNewFull(size_t minWorkers,
     if (VIR_ALLOC(pool) < 0)
         return NULL;
 
-    pool->jobList.tail = pool->jobList.head = NULL;
-
     pool->jobFunc = func;
     pool->jobName = name;
     pool->jobOpaque = opaque;
 
+    for (; pool->nqueues < VIR_THREAD_POOL_QUEUES; pool->nqueues++) {
+        if (virMutexInit(&pool->queues[pool->nqueues].lock) < 0)
+            goto error;
+    }
+
+    if (virMutexInit(&pool->statsLock) < 0)
+        goto error;
     if (virMutexInit(&pool->mutex) < 0)
         goto error;
     if (virCondInit(&pool->cond) < 0)
@@ -273,14 +542,14 @@ virThreadPoolNewFull(size_t minWorkers,
 
 void virThreadPoolFree(virThreadPoolPtr pool)
 {
-    virThreadPoolJobPtr job;
     bool priority = false;
+    size_t i;
 
     if (!pool)
         return;
 
     virMutexLock(&pool->mutex);
-    pool->quit = true;
+    g_atomic_int_set(&pool->quit, 1);
     if (pool->nWorkers > 0)
         virCondBroadcast(&pool->cond);
     if (pool->nPrioWorkers > 0) {
@@ -291,14 +560,18 @@ void virThreadPoolFree(virThreadPoolPtr pool)
     while (pool->nWorkers > 0 || pool->nPrioWorkers > 0)
         ignore_value(virCondWait(&pool->quit_cond, &pool->mutex));
 
-    while ((job = pool->jobList.head)) {
-        pool->jobList.head = pool->jobList.head->next;
-        VIR_FREE(job);
+    virThreadPoolJobListClear(&pool->prioJobs);
+    virThreadPoolJobListClear(&pool->longJobs);
+    for (i = 0; i < pool->nqueues; i++) {
+        virThreadPoolJobListClear(&pool->queues[i].fastJobs);
+        virThreadPoolJobListClear(&pool->queues[i].jobs);
+        virMutexDestroy(&pool->queues[i].lock);
     }
 
     VIR_FREE(pool->workers);
     virMutexUnlock(&pool->mutex);
     virMutexDestroy(&pool->mutex);
+    virMutexDestroy(&pool->statsLock);
     virCondDestroy(&pool->quit_cond);
     virCondDestroy(&pool->cond);
     if (priority) {
@@ -358,7 +631,7 @@ size_t virThreadPoolGetFreeWorkers(virThreadPoolPtr pool)
     size_t ret;
 
     virMutexLock(&pool->mutex);
-    ret = pool->freeWorkers;
+    ret = g_atomic_int_get(&pool->freeWorkers);
     virMutexUnlock(&pool->mutex);
 
     return ret;
@@ -368,68 +641,137 @@ size_t virThreadPoolGetJobQueueDepth(virThreadPoolPtr pool)
 {
     size_t ret;
 
+    ret = g_atomic_int_get(&pool->jobQueueDepth);
+
+    return ret;
+}
+
+unsigned long long virThreadPoolGetTargetLatency(virThreadPoolPtr pool)
+{
+    unsigned long long ret;
+
     virMutexLock(&pool->mutex);
-    ret = pool->jobQueueDepth;
+    ret = pool->targetLatency;
     virMutexUnlock(&pool->mutex);
 
     return ret;
 }
 
+unsigned long long virThreadPoolGetJobWaitTime(virThreadPoolPtr pool)
+{
+    unsigned long long ret;
+
+    virMutexLock(&pool->statsLock);
+    ret = pool->waitTime;
+    virMutexUnlock(&pool->statsLock);
+
+    return ret;
+}
+
+unsigned long long virThreadPoolGetJobRunTime(virThreadPoolPtr pool)
+{
+    unsigned long long ret;
+
+    virMutexLock(&pool->statsLock);
+    ret = pool->runTime;
+    virMutexUnlock(&pool->statsLock);
+
+    return ret;
+}
+
 /*
- * @priority - job priority
+ * @jobClass - one of virThreadPoolJobClass
  * Return: 0 on success, -1 otherwise
  */
 int virThreadPoolSendJob(virThreadPoolPtr pool,
-                         unsigned int priority,
+                         unsigned int jobClass,
                          void *jobData)
 {
     virThreadPoolJobPtr job;
 
-    virMutexLock(&pool->mutex);
-    if (pool->quit)
-        goto error;
+    if (jobClass >= VIR_THREAD_POOL_JOB_LAST) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("unknown thread pool job class %u"), jobClass);
+        return -1;
+    }
 
-    if (pool->freeWorkers - pool->jobQueueDepth <= 0 &&
-        pool->nWorkers < pool->maxWorkers &&
-        virThreadPoolExpand(pool, 1, false) < 0)
-        goto error;
+    if (g_atomic_int_get(&pool->quit))
+        return -1;
+
+    if (g_atomic_int_get(&pool->freeWorkers) <=
+        g_atomic_int_get(&pool->jobQueueDepth)) {
+        virMutexLock(&pool->mutex);
+        if (virThreadPoolNeedsWorker(pool) &&
+            virThreadPoolExpand(pool, 1, false) < 0) {
+            virMutexUnlock(&pool->mutex);
+            return -1;
+        }
+        virMutexUnlock(&pool->mutex);
+    }
 
     if (VIR_ALLOC(job) < 0)
-        goto error;
+        return -1;
 
     job->data = jobData;
-    job->priority = priority;
+    job->jobClass = jobClass;
+    job->queued = g_get_monotonic_time();
 
-    job->prev = pool->jobList.tail;
-    if (pool->jobList.tail)
-        pool->jobList.tail->next = job;
-    pool->jobList.tail = job;
+    if (jobClass == VIR_THREAD_POOL_JOB_PRIORITY ||
+        jobClass == VIR_THREAD_POOL_JOB_LONG) {
+        virMutexLock(&pool->mutex);
+        if (pool->quit) {
+            virMutexUnlock(&pool->mutex);
+            VIR_FREE(job);
+            return -1;
+        }
 
-    if (!pool->jobList.head)
-        pool->jobList.head = job;
+        g_atomic_int_inc(&pool->jobQueueDepth);
+        if (jobClass == VIR_THREAD_POOL_JOB_PRIORITY) {
+            virThreadPoolJobListAppend(&pool->prioJobs, job);
+            g_atomic_int_inc(&pool->nPrioJobs);
+            virCondSignal(&pool->prioCond);
+        } else {
+            virThreadPoolJobListAppend(&pool->longJobs, job);
+            g_atomic_int_inc(&pool->nLongJobs);
+        }
 
-    if (priority && !pool->jobList.firstPrio)
-        pool->jobList.firstPrio = job;
+        virCondSignal(&pool->cond);
+        virMutexUnlock(&pool->mutex);
+    } else {
+        unsigned int next = g_atomic_int_add(&pool->nextQueue, 1);
+        virThreadPoolQueuePtr queue = &pool->queues[next % VIR_THREAD_POOL_QUEUES];
 
-    pool->jobQueueDepth++;
+        g_atomic_int_inc(&pool->jobQueueDepth);
 
-    virCondSignal(&pool->cond);
-    if (priority)
-        virCondSignal(&pool->prioCond);
+        virMutexLock(&queue->lock);
+        if (jobClass == VIR_THREAD_POOL_JOB_FAST)
+            virThreadPoolJobListAppend(&queue->fastJobs, job);
+        else
+            virThreadPoolJobListAppend(&queue->jobs, job);
+        virMutexUnlock(&queue->lock);
+
+        if (jobClass == VIR_THREAD_POOL_JOB_FAST)
+            g_atomic_int_inc(&pool->nFastQueued);
+        g_atomic_int_inc(&pool->nQueued);
+
+        /* Pairs with the announcement of free workers before they go
+         * to sleep, see virThreadPoolWorker */
+        if (g_atomic_int_get(&pool->freeWorkers) > 0) {
+            virMutexLock(&pool->mutex);
+            virCondSignal(&pool->cond);
+            virMutexUnlock(&pool->mutex);
+        }
+    }
 
-    virMutexUnlock(&pool->mutex);
     return 0;
-
- error:
-    virMutexUnlock(&pool->mutex);
-    return -1;
 }
 
 int
 virThreadPoolSetParameters(virThreadPoolPtr pool,
                            long long int minWorkers,
                            long long int maxWorkers,
-                           long long int prioWorkers)
+                           long long int prioWorkers,
+                           long long int targetLatency)
 {
     size_t max;
     size_t min;
@@ -462,11 +804,14 @@ virThreadPoolSetParameters(virThreadPoolPtr pool,
 
     if (maxWorkers >= 0) {
         pool->maxWorkers = maxWorkers;
+        if (pool->nWorkers > pool->maxWorkers)
+            g_atomic_int_set(&pool->resize, 1);
         virCondBroadcast(&pool->cond);
     }
 
     if (prioWorkers >= 0) {
         if (prioWorkers < pool->nPrioWorkers) {
+            g_atomic_int_set(&pool->resize, 1);
             virCondBroadcast(&pool->prioCond);
         } else if ((size_t) prioWorkers > pool->nPrioWorkers &&
                    virThreadPoolExpand(pool, prioWorkers - pool->nPrioWorkers,
@@ -476,6 +821,12 @@ virThreadPoolSetParameters(virThreadPoolPtr pool,
         pool->maxPrioWorkers = prioWorkers;
     }
 
+    if (targetLatency >= 0) {
+        pool->targetLatency = targetLatency;
+        /* let idle workers start counting down their timeout */
+        virCondBroadcast(&pool->cond);
+    }
+
     virMutexUnlock(&pool->mutex);
     return 0;
 
@@ -28,6 +28,19 @@ typedef virThreadPool *virThreadPoolPtr;
 
 typedef void (*virThreadPoolJobFunc)(void *jobdata, void *opaque);
 
+typedef enum {
+    /* may block, processed in order of submission */
+    VIR_THREAD_POOL_JOB_NORMAL = 0,
+    /* must not block, processed by priority workers as well */
+    VIR_THREAD_POOL_JOB_PRIORITY = 1,
+    /* short, read-only, processed ahead of queued normal jobs */
+    VIR_THREAD_POOL_JOB_FAST = 2,
+    /* long running, limited to half of the workers */
+    VIR_THREAD_POOL_JOB_LONG = 3,
+
+    VIR_THREAD_POOL_JOB_LAST
+} virThreadPoolJobClass;
+
 #define virThreadPoolNew(min, max, prio, func, opaque) \
     virThreadPoolNewFull(min, max, prio, func, #func, opaque)
 
@@ -44,15 +57,19 @@ size_t virThreadPoolGetPriorityWorkers(virThreadPoolPtr pool);
 size_t virThreadPoolGetCurrentWorkers(virThreadPoolPtr pool);
 size_t virThreadPoolGetFreeWorkers(virThreadPoolPtr pool);
 size_t virThreadPoolGetJobQueueDepth(virThreadPoolPtr pool);
+unsigned long long virThreadPoolGetTargetLatency(virThreadPoolPtr pool);
+unsigned long long virThreadPoolGetJobWaitTime(virThreadPoolPtr pool);
+unsigned long long virThreadPoolGetJobRunTime(virThreadPoolPtr pool);
 
 void virThreadPoolFree(virThreadPoolPtr pool);
 
 int virThreadPoolSendJob(virThreadPoolPtr pool,
-                         unsigned int priority,
+                         unsigned int jobClass,
                          void *jobdata) ATTRIBUTE_NONNULL(1)
                                         G_GNUC_WARN_UNUSED_RESULT;
 
 int virThreadPoolSetParameters(virThreadPoolPtr pool,
                                long long int minWorkers,
                                long long int maxWorkers,
-                               long long int prioWorkers);
+                               long long int prioWorkers,
+                               long long int targetLatency);
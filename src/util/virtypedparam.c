@@ -26,6 +26,7 @@
 
 #include "viralloc.h"
 #include "virerror.h"
+#include "virhash.h"
 #include "virstring.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
@@ -748,12 +749,98 @@ virTypedParamListStealParams(virTypedParamListPtr list,
 }
 
 
+/**
+ * virTypedParamListReserve:
+ * @list: typed parameter list
+ * @nparams: number of parameters about to be added
+ *
+ * Makes room for at least @nparams more parameters in @list so that
+ * adding them doesn't need to grow the array again.
+ */
+void
+virTypedParamListReserve(virTypedParamListPtr list,
+                         size_t nparams)
+{
+    ignore_value(VIR_RESIZE_N(list->par, list->par_alloc, list->npar, nparams));
+}
+
+
+/*
+ * Formats a field name consisting only of literal text and "%zu" or "%s"
+ * conversions, which covers the templates used for bulk stats such as
+ * "block.%zu.rd.reqs", without the overhead of the full printf machinery.
+ *
+ * Returns the length of the name, or -1 if @fmt contains any other
+ * conversion, in which case nothing was consumed from @ap.
+ */
+static int
+virTypedParamFormatNameSimple(char *field,
+                              const char *fmt,
+                              va_list ap)
+{
+    const char *p;
+    size_t len = 0;
+
+    for (p = fmt; (p = strchr(p, '%')); p++) {
+        if (STRPREFIX(p, "%zu"))
+            p += 2;
+        else if (p[1] == 's')
+            p++;
+        else
+            return -1;
+    }
+
+    for (p = fmt; *p; p++) {
+        char num[VIR_INT64_STR_BUFLEN];
+        const char *str;
+        size_t n;
+
+        if (*p != '%') {
+            if (len < VIR_TYPED_PARAM_FIELD_LENGTH)
+                field[len] = *p;
+            len++;
+            continue;
+        }
+
+        if (p[1] == 's') {
+            str = va_arg(ap, const char *);
+            p++;
+        } else {
+            size_t val = va_arg(ap, size_t);
+            char *end = num + sizeof(num) - 1;
+
+            *end = '\0';
+            do {
+                *--end = '0' + val % 10;
+                val /= 10;
+            } while (val);
+            str = end;
+            p += 2;
+        }
+
+        n = strlen(str);
+        if (len < VIR_TYPED_PARAM_FIELD_LENGTH)
+            memcpy(field + len, str, MIN(n, VIR_TYPED_PARAM_FIELD_LENGTH - len));
+        len += n;
+    }
+
+    field[MIN(len, VIR_TYPED_PARAM_FIELD_LENGTH - 1)] = '\0';
+
+    return len;
+}
+
+
 static int G_GNUC_PRINTF(2, 0)
 virTypedParamSetNameVPrintf(virTypedParameterPtr par,
                             const char *fmt,
                             va_list ap)
 {
-    if (g_vsnprintf(par->field, VIR_TYPED_PARAM_FIELD_LENGTH, fmt, ap) > VIR_TYPED_PARAM_FIELD_LENGTH) {
+    int len;
+
+    if ((len = virTypedParamFormatNameSimple(par->field, fmt, ap)) < 0)
+        len = g_vsnprintf(par->field, VIR_TYPED_PARAM_FIELD_LENGTH, fmt, ap);
+
+    if (len >= VIR_TYPED_PARAM_FIELD_LENGTH) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _("Field name too long"));
         return -1;
     }
@@ -765,7 +852,8 @@ virTypedParamSetNameVPrintf(virTypedParameterPtr par,
 static virTypedParameterPtr
 virTypedParamListExtend(virTypedParamListPtr list)
 {
-    if (VIR_RESIZE_N(list->par, list->par_alloc, list->npar, 1) < 0)
+    if (list->npar == list->par_alloc &&
+        VIR_RESIZE_N(list->par, list->par_alloc, list->npar, 1) < 0)
         return NULL;
 
     list->npar++;
@@ -774,6 +862,312 @@ virTypedParamListExtend(virTypedParamListPtr list)
 }
 
 
+/**
+ * virTypedParamListAddParams:
+ * @list: typed parameter list
+ * @params: array of typed parameters
+ * @nparams: number of parameters in the @params array
+ *
+ * Appends a deep copy of @params to @list.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virTypedParamListAddParams(virTypedParamListPtr list,
+                           virTypedParameterPtr params,
+                           size_t nparams)
+{
+    size_t i;
+
+    if (VIR_RESIZE_N(list->par, list->par_alloc, list->npar, nparams) < 0)
+        return -1;
+
+    for (i = 0; i < nparams; i++) {
+        virTypedParameterPtr par = list->par + list->npar;
+
+        ignore_value(virStrcpyStatic(par->field, params[i].field));
+        par->type = params[i].type;
+        if (params[i].type == VIR_TYPED_PARAM_STRING)
+            par->value.s = g_strdup(params[i].value.s);
+        else
+            par->value = params[i].value;
+
+        list->npar++;
+    }
+
+    return 0;
+}
+
+
+static bool
+virTypedParamIsInteger(int type)
+{
+    return type == VIR_TYPED_PARAM_INT ||
+           type == VIR_TYPED_PARAM_UINT ||
+           type == VIR_TYPED_PARAM_LLONG ||
+           type == VIR_TYPED_PARAM_ULLONG;
+}
+
+
+static bool
+virTypedParamValueEqual(virTypedParameterPtr a,
+                        virTypedParameterPtr b)
+{
+    if (a->type != b->type)
+        return false;
+
+    switch ((virTypedParameterType) a->type) {
+    case VIR_TYPED_PARAM_INT:
+        return a->value.i == b->value.i;
+    case VIR_TYPED_PARAM_UINT:
+        return a->value.ui == b->value.ui;
+    case VIR_TYPED_PARAM_LLONG:
+        return a->value.l == b->value.l;
+    case VIR_TYPED_PARAM_ULLONG:
+        return a->value.ul == b->value.ul;
+    case VIR_TYPED_PARAM_DOUBLE:
+        return memcmp(&a->value.d, &b->value.d, sizeof(a->value.d)) == 0;
+    case VIR_TYPED_PARAM_BOOLEAN:
+        return !a->value.b == !b->value.b;
+    case VIR_TYPED_PARAM_STRING:
+        return STREQ_NULLABLE(a->value.s, b->value.s);
+    case VIR_TYPED_PARAM_LAST:
+        break;
+    }
+
+    return false;
+}
+
+
+/* Integer deltas are computed and applied in unsigned arithmetic so that
+ * counters which wrap around still round-trip exactly. */
+static void
+virTypedParamValueShift(virTypedParameterPtr par,
+                        virTypedParameterPtr by,
+                        bool subtract)
+{
+    switch ((virTypedParameterType) par->type) {
+    case VIR_TYPED_PARAM_INT:
+        if (subtract)
+            par->value.i = (int) ((unsigned int) par->value.i - (unsigned int) by->value.i);
+        else
+            par->value.i = (int) ((unsigned int) par->value.i + (unsigned int) by->value.i);
+        break;
+    case VIR_TYPED_PARAM_UINT:
+        if (subtract)
+            par->value.ui -= by->value.ui;
+        else
+            par->value.ui += by->value.ui;
+        break;
+    case VIR_TYPED_PARAM_LLONG:
+        if (subtract)
+            par->value.l = (long long) ((unsigned long long) par->value.l -
+                                        (unsigned long long) by->value.l);
+        else
+            par->value.l = (long long) ((unsigned long long) par->value.l +
+                                        (unsigned long long) by->value.l);
+        break;
+    case VIR_TYPED_PARAM_ULLONG:
+        if (subtract)
+            par->value.ul -= by->value.ul;
+        else
+            par->value.ul += by->value.ul;
+        break;
+    case VIR_TYPED_PARAM_DOUBLE:
+    case VIR_TYPED_PARAM_BOOLEAN:
+    case VIR_TYPED_PARAM_STRING:
+    case VIR_TYPED_PARAM_LAST:
+        break;
+    }
+}
+
+
+static virHashTablePtr
+virTypedParamsIndex(virTypedParameterPtr params,
+                    size_t nparams)
+{
+    g_autoptr(virHashTable) index = NULL;
+    size_t i;
+
+    if (!(index = virHashNew(NULL)))
+        return NULL;
+
+    /* Indexes are stored off by one so that a lookup miss (NULL) can be
+     * told apart from the first parameter. Duplicate names keep the
+     * first occurrence. */
+    for (i = 0; i < nparams; i++) {
+        if (virHashLookup(index, params[i].field))
+            continue;
+        if (virHashAddEntry(index, params[i].field, GSIZE_TO_POINTER(i + 1)) < 0)
+            return NULL;
+    }
+
+    return g_steal_pointer(&index);
+}
+
+
+/**
+ * virTypedParamsDiff:
+ * @prev: previous sample of typed parameters
+ * @nprev: number of parameters in @prev
+ * @cur: current sample of typed parameters
+ * @ncur: number of parameters in @cur
+ * @changed: typed parameter list to append the differences to
+ * @removed: filled with indexes into @prev which are missing in @cur
+ * @nremoved: filled with the number of entries in @removed
+ *
+ * Computes the difference between two samples of the same set of typed
+ * parameters. Parameters which did not change are omitted. For integer
+ * parameters whose type did not change, @changed holds the difference
+ * from @prev rather than the value itself; all other parameters are
+ * stored with their current value. Applying the result to @prev using
+ * virTypedParamsPatch yields a list equivalent to @cur.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virTypedParamsDiff(virTypedParameterPtr prev,
+                   size_t nprev,
+                   virTypedParameterPtr cur,
+                   size_t ncur,
+                   virTypedParamListPtr changed,
+                   size_t **removed,
+                   size_t *nremoved)
+{
+    g_autoptr(virHashTable) index = NULL;
+    g_autofree bool *seen = NULL;
+    g_autofree size_t *gone = NULL;
+    size_t ngone = 0;
+    size_t i;
+
+    *removed = NULL;
+    *nremoved = 0;
+
+    if (!(index = virTypedParamsIndex(prev, nprev)))
+        return -1;
+
+    seen = g_new0(bool, nprev + 1);
+
+    for (i = 0; i < ncur; i++) {
+        size_t p = GPOINTER_TO_SIZE(virHashLookup(index, cur[i].field));
+        virTypedParameterPtr old = NULL;
+
+        if (p) {
+            old = prev + p - 1;
+            seen[p - 1] = true;
+
+            if (virTypedParamValueEqual(old, cur + i))
+                continue;
+        }
+
+        if (virTypedParamListAddParams(changed, cur + i, 1) < 0)
+            return -1;
+
+        if (old && old->type == cur[i].type &&
+            virTypedParamIsInteger(old->type))
+            virTypedParamValueShift(changed->par + changed->npar - 1, old, true);
+    }
+
+    for (i = 0; i < nprev; i++) {
+        if (seen[i])
+            continue;
+
+        if (VIR_APPEND_ELEMENT_COPY(gone, ngone, i) < 0)
+            return -1;
+    }
+
+    *removed = g_steal_pointer(&gone);
+    *nremoved = ngone;
+    return 0;
+}
+
+
+/**
+ * virTypedParamsPatch:
+ * @list: typed parameter list holding the previous sample
+ * @changed: differences as computed by virTypedParamsDiff
+ * @nchanged: number of parameters in @changed
+ * @removed: indexes into @list of parameters to remove
+ * @nremoved: number of entries in @removed
+ *
+ * Updates @list in place so that it matches the sample @changed and
+ * @removed were computed against. Removed parameters are dropped first,
+ * keeping the order of the remaining ones; parameters which are not yet
+ * part of @list are appended at its end.
+ *
+ * Returns 0 on success, -1 on error (@list is left in an unspecified but
+ * consistent state).
+ */
+int
+virTypedParamsPatch(virTypedParamListPtr list,
+                    virTypedParameterPtr changed,
+                    size_t nchanged,
+                    const size_t *removed,
+                    size_t nremoved)
+{
+    g_autoptr(virHashTable) index = NULL;
+    g_autofree bool *drop = NULL;
+    size_t i;
+    size_t j;
+
+    if (nremoved) {
+        drop = g_new0(bool, list->npar + 1);
+
+        for (i = 0; i < nremoved; i++) {
+            if (removed[i] >= list->npar) {
+                virReportError(VIR_ERR_INVALID_ARG,
+                               _("parameter index '%zu' out of range"),
+                               removed[i]);
+                return -1;
+            }
+            drop[removed[i]] = true;
+        }
+
+        for (i = 0, j = 0; i < list->npar; i++) {
+            if (drop[i]) {
+                virTypedParamsClear(list->par + i, 1);
+                continue;
+            }
+            if (i != j)
+                list->par[j] = list->par[i];
+            j++;
+        }
+        memset(list->par + j, 0, sizeof(*list->par) * (list->npar - j));
+        list->npar = j;
+    }
+
+    if (!(index = virTypedParamsIndex(list->par, list->npar)))
+        return -1;
+
+    for (i = 0; i < nchanged; i++) {
+        size_t p = GPOINTER_TO_SIZE(virHashLookup(index, changed[i].field));
+        virTypedParameterPtr par;
+
+        if (!p) {
+            if (virTypedParamListAddParams(list, changed + i, 1) < 0)
+                return -1;
+            continue;
+        }
+
+        par = list->par + p - 1;
+
+        if (par->type == changed[i].type && virTypedParamIsInteger(par->type)) {
+            virTypedParamValueShift(par, changed + i, false);
+            continue;
+        }
+
+        virTypedParamsClear(par, 1);
+        par->type = changed[i].type;
+        if (changed[i].type == VIR_TYPED_PARAM_STRING)
+            par->value.s = g_strdup(changed[i].value.s);
+        else
+            par->value = changed[i].value;
+    }
+
+    return 0;
+}
+
+
 int
 virTypedParamListAddInt(virTypedParamListPtr list,
                         int value,
@@ -143,6 +143,27 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(virTypedParamList, virTypedParamListFree);
 size_t virTypedParamListStealParams(virTypedParamListPtr list,
                                     virTypedParameterPtr *params);
 
+void virTypedParamListReserve(virTypedParamListPtr list,
+                              size_t nparams);
+
+int virTypedParamListAddParams(virTypedParamListPtr list,
+                               virTypedParameterPtr params,
+                               size_t nparams);
+int virTypedParamsDiff(virTypedParameterPtr prev,
+                       size_t nprev,
+                       virTypedParameterPtr cur,
+                       size_t ncur,
+                       virTypedParamListPtr changed,
+                       size_t **removed,
+                       size_t *nremoved)
+    G_GNUC_WARN_UNUSED_RESULT;
+int virTypedParamsPatch(virTypedParamListPtr list,
+                        virTypedParameterPtr changed,
+                        size_t nchanged,
+                        const size_t *removed,
+                        size_t nremoved)
+    G_GNUC_WARN_UNUSED_RESULT;
+
 int virTypedParamListAddInt(virTypedParamListPtr list,
                             int value,
                             const char *namefmt,
@@ -148,13 +148,18 @@ virUUIDParse(const char *uuidstr, unsigned char *uuid)
 const char *
 virUUIDFormat(const unsigned char *uuid, char *uuidstr)
 {
-    g_snprintf(uuidstr, VIR_UUID_STRING_BUFLEN,
-               "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
-               uuid[0], uuid[1], uuid[2], uuid[3],
-               uuid[4], uuid[5], uuid[6], uuid[7],
-               uuid[8], uuid[9], uuid[10], uuid[11],
-               uuid[12], uuid[13], uuid[14], uuid[15]);
-    uuidstr[VIR_UUID_STRING_BUFLEN-1] = '\0';
+    static const char hex[] = "0123456789abcdef";
+    char *out = uuidstr;
+    size_t i;
+
+    /* called for every formatted domain and object, so spare printf */
+    for (i = 0; i < VIR_UUID_BUFLEN; i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10)
+            *out++ = '-';
+        *out++ = hex[uuid[i] >> 4];
+        *out++ = hex[uuid[i] & 0xf];
+    }
+    *out = '\0';
     return uuidstr;
 }
 
@@ -0,0 +1,443 @@
+/*
+ * virwritebehind.c: deferred and batched rewriting of files
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "virwritebehind.h"
+#include "viralloc.h"
+#include "virerror.h"
+#include "virfile.h"
+#include "virlog.h"
+#include "virthread.h"
+#include "virtime.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+VIR_LOG_INIT("util.writebehind");
+
+typedef struct _virWriteBehindEntry virWriteBehindEntry;
+typedef virWriteBehindEntry *virWriteBehindEntryPtr;
+struct _virWriteBehindEntry {
+    char *path;
+    mode_t mode;
+    char *data;
+};
+
+/* Files waiting to be written, indexed by path so that a newer content
+ * of a file replaces the older one instead of writing both */
+static virMutex virWriteBehindLock = VIR_MUTEX_INITIALIZER;
+static virCond virWriteBehindCond;
+static GHashTable *virWriteBehindPending;
+static unsigned int virWriteBehindDelay;
+static bool virWriteBehindWriting;
+static bool virWriteBehindFailed;
+static bool virWriteBehindQuit;
+static bool virWriteBehindThreadRunning;
+static virThread virWriteBehindThread;
+
+
+static int
+virWriteBehindOnceInit(void)
+{
+    if (virCondInit(&virWriteBehindCond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot initialize write behind condition"));
+        return -1;
+    }
+
+    virWriteBehindPending = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                  NULL, NULL);
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virWriteBehind);
+
+
+static void
+virWriteBehindEntryFree(virWriteBehindEntryPtr entry)
+{
+    if (!entry)
+        return;
+
+    g_free(entry->path);
+    g_free(entry->data);
+    g_free(entry);
+}
+
+
+static int
+virWriteBehindRewrite(int fd, const void *opaque)
+{
+    const char *data = opaque;
+
+    if (safewrite(fd, data, strlen(data)) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/* Makes the renames of the files written by a batch durable by syncing
+ * each of their directories once */
+static int
+virWriteBehindSyncDirs(virWriteBehindEntryPtr *entries,
+                       size_t nentries)
+{
+    g_autoptr(GHashTable) dirs = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                       g_free, NULL);
+    size_t i;
+    int ret = 0;
+
+    for (i = 0; i < nentries; i++) {
+        g_autofree char *dir = g_path_get_dirname(entries[i]->path);
+        int fd;
+
+        if (g_hash_table_contains(dirs, dir))
+            continue;
+
+        if ((fd = open(dir, O_RDONLY)) < 0 ||
+            g_fsync(fd) < 0) {
+            virReportSystemError(errno, _("cannot sync directory '%s'"), dir);
+            ret = -1;
+        }
+        VIR_FORCE_CLOSE(fd);
+
+        g_hash_table_add(dirs, g_steal_pointer(&dir));
+    }
+
+    return ret;
+}
+
+
+/* Writes @entries, which are no longer in the pending table. Files with
+ * different modes are written by separate batches. */
+static int
+virWriteBehindWrite(virWriteBehindEntryPtr *entries,
+                    size_t nentries)
+{
+    g_autofree const char **paths = g_new0(const char *, nentries);
+    g_autofree const void **datas = g_new0(const void *, nentries);
+    g_autofree bool *done = g_new0(bool, nentries);
+    size_t i;
+    size_t j;
+    int ret = 0;
+
+    for (i = 0; i < nentries; i++) {
+        size_t n = 0;
+
+        if (done[i])
+            continue;
+
+        for (j = i; j < nentries; j++) {
+            if (done[j] || entries[j]->mode != entries[i]->mode)
+                continue;
+
+            paths[n] = entries[j]->path;
+            datas[n] = entries[j]->data;
+            done[j] = true;
+            n++;
+        }
+
+        if (virFileRewriteBatch(paths, n, entries[i]->mode,
+                                virWriteBehindRewrite, datas) < 0)
+            ret = -1;
+    }
+
+    if (virWriteBehindSyncDirs(entries, nentries) < 0)
+        ret = -1;
+
+    return ret;
+}
+
+
+/* Takes all pending files and writes them. Must be called with the lock
+ * held, which is released while writing. */
+static int
+virWriteBehindWritePending(void)
+{
+    g_autofree virWriteBehindEntryPtr *entries = NULL;
+    GHashTableIter iter;
+    gpointer value;
+    size_t nentries = 0;
+    size_t i;
+    int ret;
+
+    while (virWriteBehindWriting)
+        virCondWait(&virWriteBehindCond, &virWriteBehindLock);
+
+    if (g_hash_table_size(virWriteBehindPending) == 0)
+        return 0;
+
+    entries = g_new0(virWriteBehindEntryPtr,
+                     g_hash_table_size(virWriteBehindPending));
+    g_hash_table_iter_init(&iter, virWriteBehindPending);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        entries[nentries++] = value;
+    g_hash_table_steal_all(virWriteBehindPending);
+
+    virWriteBehindWriting = true;
+    virMutexUnlock(&virWriteBehindLock);
+
+    VIR_DEBUG("Writing %zu files", nentries);
+    ret = virWriteBehindWrite(entries, nentries);
+
+    for (i = 0; i < nentries; i++)
+        virWriteBehindEntryFree(entries[i]);
+
+    virMutexLock(&virWriteBehindLock);
+    virWriteBehindWriting = false;
+    virCondBroadcast(&virWriteBehindCond);
+
+    return ret;
+}
+
+
+static void
+virWriteBehindWorker(void *opaque G_GNUC_UNUSED)
+{
+    unsigned long long deadline = 0;
+
+    virMutexLock(&virWriteBehindLock);
+
+    while (!virWriteBehindQuit) {
+        unsigned long long now = 0;
+
+        if (g_hash_table_size(virWriteBehindPending) == 0) {
+            deadline = 0;
+            if (virCondWait(&virWriteBehindCond, &virWriteBehindLock) < 0)
+                break;
+            continue;
+        }
+
+        /* let further updates accumulate until the first queued one is
+         * @delay old, so they share the flush */
+        if (virTimeMillisNowRaw(&now) == 0) {
+            if (deadline == 0)
+                deadline = now + virWriteBehindDelay;
+
+            if (now < deadline) {
+                ignore_value(virCondWaitUntil(&virWriteBehindCond,
+                                              &virWriteBehindLock, deadline));
+                continue;
+            }
+        }
+
+        deadline = 0;
+        if (virWriteBehindWritePending() < 0) {
+            VIR_ERROR(_("Failed to write deferred files: %s"),
+                      virGetLastErrorMessage());
+            virResetLastError();
+            virWriteBehindFailed = true;
+        }
+    }
+
+    virMutexUnlock(&virWriteBehindLock);
+}
+
+
+/**
+ * virWriteBehindSetDelay:
+ * @delay: time to defer writes by, in milliseconds
+ *
+ * Makes virWriteBehindQueue() defer writing files by @delay, so that the
+ * updates of many files share a single flush to disk and repeated updates
+ * of the same file are written once. If @delay is 0, files are written
+ * immediately, which is the default.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virWriteBehindSetDelay(unsigned int delay)
+{
+    int ret = 0;
+
+    if (virWriteBehindInitialize() < 0)
+        return -1;
+
+    virMutexLock(&virWriteBehindLock);
+
+    virWriteBehindDelay = delay;
+
+    if (delay > 0 && !virWriteBehindThreadRunning) {
+        virWriteBehindQuit = false;
+        if (virThreadCreateFull(&virWriteBehindThread, true,
+                                virWriteBehindWorker, "write-behind",
+                                false, NULL) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("cannot create write behind thread"));
+            virWriteBehindDelay = 0;
+            ret = -1;
+        } else {
+            virWriteBehindThreadRunning = true;
+        }
+    }
+
+    virMutexUnlock(&virWriteBehindLock);
+
+    if (delay == 0 && virWriteBehindThreadRunning)
+        virWriteBehindShutdown();
+
+    return ret;
+}
+
+
+/**
+ * virWriteBehindQueue:
+ * @path: file to rewrite
+ * @mode: mode of the file if it is created
+ * @data: new contents of the file
+ *
+ * Rewrites @path with @data like virFileRewriteStr() does. If a delay was
+ * set by virWriteBehindSetDelay(), the file is only written later by a
+ * background thread, replacing any write of @path still pending. Errors
+ * of deferred writes are logged and reported by the next call to
+ * virWriteBehindFlush().
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virWriteBehindQueue(const char *path,
+                    mode_t mode,
+                    const char *data)
+{
+    virWriteBehindEntryPtr entry;
+
+    if (virWriteBehindInitialize() < 0)
+        return -1;
+
+    virMutexLock(&virWriteBehindLock);
+
+    if (virWriteBehindDelay == 0) {
+        virMutexUnlock(&virWriteBehindLock);
+        return virFileRewriteStr(path, mode, data);
+    }
+
+    if ((entry = g_hash_table_lookup(virWriteBehindPending, path))) {
+        g_free(entry->data);
+        entry->data = g_strdup(data);
+        entry->mode = mode;
+    } else {
+        entry = g_new0(virWriteBehindEntry, 1);
+        entry->path = g_strdup(path);
+        entry->mode = mode;
+        entry->data = g_strdup(data);
+        g_hash_table_insert(virWriteBehindPending, entry->path, entry);
+        virCondBroadcast(&virWriteBehindCond);
+    }
+
+    virMutexUnlock(&virWriteBehindLock);
+    return 0;
+}
+
+
+/**
+ * virWriteBehindCancel:
+ * @path: file which is going to be removed
+ *
+ * Drops the pending write of @path, if any, so that it is not created
+ * again after being removed. If the file is being written right now,
+ * waits for the write to finish.
+ */
+void
+virWriteBehindCancel(const char *path)
+{
+    virWriteBehindEntryPtr entry;
+
+    if (virWriteBehindInitialize() < 0)
+        return;
+
+    virMutexLock(&virWriteBehindLock);
+
+    while (virWriteBehindWriting)
+        virCondWait(&virWriteBehindCond, &virWriteBehindLock);
+
+    if ((entry = g_hash_table_lookup(virWriteBehindPending, path))) {
+        g_hash_table_remove(virWriteBehindPending, path);
+        virWriteBehindEntryFree(entry);
+    }
+
+    virMutexUnlock(&virWriteBehindLock);
+}
+
+
+/**
+ * virWriteBehindFlush:
+ *
+ * Writes all pending files and waits for them to reach the disk. Meant
+ * for callers which need the files they queued to be durable.
+ *
+ * Returns 0 on success, -1 if writing any of the files failed, including
+ * deferred writes which failed since the last flush.
+ */
+int
+virWriteBehindFlush(void)
+{
+    int ret;
+
+    if (virWriteBehindInitialize() < 0)
+        return -1;
+
+    virMutexLock(&virWriteBehindLock);
+
+    ret = virWriteBehindWritePending();
+
+    if (virWriteBehindFailed) {
+        if (ret == 0)
+            virReportError(VIR_ERR_OPERATION_FAILED, "%s",
+                           _("writing of deferred files failed"));
+        virWriteBehindFailed = false;
+        ret = -1;
+    }
+
+    virMutexUnlock(&virWriteBehindLock);
+    return ret;
+}
+
+
+/**
+ * virWriteBehindShutdown:
+ *
+ * Writes all pending files and stops the background thread. Any files
+ * queued afterwards are written immediately.
+ */
+void
+virWriteBehindShutdown(void)
+{
+    if (virWriteBehindInitialize() < 0)
+        return;
+
+    virMutexLock(&virWriteBehindLock);
+    virWriteBehindDelay = 0;
+    virWriteBehindQuit = true;
+    virCondBroadcast(&virWriteBehindCond);
+    virMutexUnlock(&virWriteBehindLock);
+
+    if (virWriteBehindThreadRunning) {
+        virThreadJoin(&virWriteBehindThread);
+        virWriteBehindThreadRunning = false;
+    }
+
+    if (virWriteBehindFlush() < 0) {
+        VIR_ERROR(_("Failed to write deferred files: %s"),
+                  virGetLastErrorMessage());
+        virResetLastError();
+    }
+}
@@ -33,6 +33,9 @@
 #include "virfile.h"
 #include "virstring.h"
 #include "virutil.h"
+#include "virhash.h"
+#include "virthread.h"
+#include "virwritebehind.h"
 
 #define VIR_FROM_THIS VIR_FROM_XML
 
@@ -46,6 +49,340 @@ struct virParserData {
 };
 
 
+/*
+ * Most expressions used by the parsers are plain location paths relative
+ * to the context node, optionally wrapped by string(), count() or
+ * boolean(), such as "string(./source/@file)" or "./devices/disk". Those
+ * are evaluated by walking the children of the context node directly
+ * instead of running the XPath engine of libxml2.
+ */
+typedef enum {
+    VIR_XPATH_DIRECT_NODES,
+    VIR_XPATH_DIRECT_STRING,
+    VIR_XPATH_DIRECT_COUNT,
+    VIR_XPATH_DIRECT_BOOLEAN,
+} virXPathDirectResult;
+
+typedef struct _virXPathDirectStep virXPathDirectStep;
+struct _virXPathDirectStep {
+    char *name; /* element name, without prefix */
+    bool first; /* step is followed by [1] */
+};
+
+typedef struct _virXPathDirect virXPathDirect;
+typedef virXPathDirect *virXPathDirectPtr;
+struct _virXPathDirect {
+    virXPathDirectResult result;
+    size_t nsteps;
+    virXPathDirectStep *steps;
+    char *attr; /* final attribute step, if any */
+};
+
+/* Compiled XPath expressions, keyed by the expression. Entries are never
+ * removed, so they can be used without holding the lock. */
+typedef struct _virXPathCacheEntry virXPathCacheEntry;
+typedef virXPathCacheEntry *virXPathCacheEntryPtr;
+struct _virXPathCacheEntry {
+    xmlXPathCompExprPtr comp;
+    virXPathDirectPtr direct; /* NULL if @comp has to be evaluated */
+};
+
+static virMutex virXPathCacheLock = VIR_MUTEX_INITIALIZER;
+static virHashTablePtr virXPathCache;
+static bool virXPathDirectDisabled;
+
+/* Upper bound of the cached expressions, so that expressions built at
+ * runtime (e.g. with the name of a device) can't grow it forever */
+#define VIR_XPATH_CACHE_MAX 4096
+
+
+static void
+virXPathDirectFree(virXPathDirectPtr direct)
+{
+    size_t i;
+
+    if (!direct)
+        return;
+
+    for (i = 0; i < direct->nsteps; i++)
+        g_free(direct->steps[i].name);
+    g_free(direct->steps);
+    g_free(direct->attr);
+    g_free(direct);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virXPathDirect, virXPathDirectFree);
+
+
+/*
+ * Parses @xpath if it can be evaluated by virXPathDirectEval().
+ *
+ * Returns the parsed expression, or NULL if the XPath engine has to
+ * evaluate it.
+ */
+static virXPathDirectPtr
+virXPathDirectParse(const char *xpath)
+{
+    g_autoptr(virXPathDirect) direct = g_new0(virXPathDirect, 1);
+    const char *p = xpath;
+    const char *end = xpath + strlen(xpath);
+
+    if (STRPREFIX(p, "string(")) {
+        direct->result = VIR_XPATH_DIRECT_STRING;
+        p += strlen("string(");
+    } else if (STRPREFIX(p, "count(")) {
+        direct->result = VIR_XPATH_DIRECT_COUNT;
+        p += strlen("count(");
+    } else if (STRPREFIX(p, "boolean(")) {
+        direct->result = VIR_XPATH_DIRECT_BOOLEAN;
+        p += strlen("boolean(");
+    } else {
+        direct->result = VIR_XPATH_DIRECT_NODES;
+    }
+
+    if (direct->result != VIR_XPATH_DIRECT_NODES) {
+        if (end == p || end[-1] != ')')
+            return NULL;
+        end--;
+    }
+
+    if (p == end || *p != '.')
+        return NULL;
+    p++;
+
+    while (p < end) {
+        const char *name;
+        bool attr = false;
+
+        if (*p != '/' || direct->attr)
+            return NULL;
+        p++;
+
+        if (p < end && *p == '@') {
+            attr = true;
+            p++;
+        }
+
+        name = p;
+        if (p == end || !(g_ascii_isalpha(*p) || *p == '_'))
+            return NULL;
+        while (p < end &&
+               (g_ascii_isalnum(*p) || *p == '_' || *p == '-' || *p == '.'))
+            p++;
+
+        if (attr) {
+            direct->attr = g_strndup(name, p - name);
+            continue;
+        }
+
+        direct->steps = g_renew(virXPathDirectStep, direct->steps,
+                                direct->nsteps + 1);
+        direct->steps[direct->nsteps].name = g_strndup(name, p - name);
+        direct->steps[direct->nsteps].first = false;
+
+        if (end - p >= 3 && STRPREFIX(p, "[1]")) {
+            direct->steps[direct->nsteps].first = true;
+            p += 3;
+        }
+        direct->nsteps++;
+    }
+
+    return g_steal_pointer(&direct);
+}
+
+
+/*
+ * Adds the nodes matching the steps of @direct from @step on, relative to
+ * @node, to @set in document order. Stops at the first one if @first.
+ *
+ * Returns true once @first is set and a node was found.
+ */
+static bool
+virXPathDirectCollect(virXPathDirectPtr direct,
+                      size_t step,
+                      xmlNodePtr node,
+                      xmlNodeSetPtr set,
+                      bool first)
+{
+    xmlNodePtr cur;
+
+    if (step == direct->nsteps) {
+        xmlAttrPtr prop;
+
+        if (!direct->attr) {
+            ignore_value(xmlXPathNodeSetAddUnique(set, node));
+            return first;
+        }
+
+        if (node->type != XML_ELEMENT_NODE)
+            return false;
+
+        /* unprefixed names only match nodes without a namespace */
+        for (prop = node->properties; prop; prop = prop->next) {
+            if (!prop->ns && xmlStrEqual(prop->name, BAD_CAST direct->attr)) {
+                ignore_value(xmlXPathNodeSetAddUnique(set, (xmlNodePtr) prop));
+                return first;
+            }
+        }
+
+        return false;
+    }
+
+    for (cur = node->children; cur; cur = cur->next) {
+        if (cur->type != XML_ELEMENT_NODE || cur->ns ||
+            !xmlStrEqual(cur->name, BAD_CAST direct->steps[step].name))
+            continue;
+
+        if (virXPathDirectCollect(direct, step + 1, cur, set, first))
+            return true;
+
+        if (direct->steps[step].first)
+            break;
+    }
+
+    return false;
+}
+
+
+static xmlXPathObjectPtr
+virXPathDirectEval(virXPathDirectPtr direct,
+                   xmlNodePtr node)
+{
+    xmlNodeSetPtr set;
+    xmlChar *str = NULL;
+    int n;
+
+    if (!(set = xmlXPathNodeSetCreate(NULL)))
+        return NULL;
+
+    virXPathDirectCollect(direct, 0, node, set,
+                          direct->result == VIR_XPATH_DIRECT_STRING ||
+                          direct->result == VIR_XPATH_DIRECT_BOOLEAN);
+
+    switch (direct->result) {
+    case VIR_XPATH_DIRECT_NODES:
+        return xmlXPathWrapNodeSet(set);
+
+    case VIR_XPATH_DIRECT_STRING:
+        if (set->nodeNr > 0)
+            str = xmlNodeGetContent(set->nodeTab[0]);
+        xmlXPathFreeNodeSet(set);
+        if (!str)
+            return xmlXPathNewCString("");
+        return xmlXPathWrapString(str);
+
+    case VIR_XPATH_DIRECT_COUNT:
+        n = set->nodeNr;
+        xmlXPathFreeNodeSet(set);
+        return xmlXPathNewFloat(n);
+
+    case VIR_XPATH_DIRECT_BOOLEAN:
+        n = set->nodeNr;
+        xmlXPathFreeNodeSet(set);
+        return xmlXPathNewBoolean(n > 0);
+    }
+
+    xmlXPathFreeNodeSet(set);
+    return NULL;
+}
+
+
+static void
+virXPathCacheEntryFree(virXPathCacheEntryPtr entry)
+{
+    if (!entry)
+        return;
+
+    xmlXPathFreeCompExpr(entry->comp);
+    virXPathDirectFree(entry->direct);
+    g_free(entry);
+}
+
+
+static void
+virXPathCacheDataFree(void *payload)
+{
+    virXPathCacheEntryFree(payload);
+}
+
+
+/**
+ * virXPathSetDirectEval:
+ * @enable: whether to evaluate simple expressions directly
+ *
+ * Allows tests to check that simple expressions evaluate the same with
+ * and without the XPath engine of libxml2. Enabled by default.
+ */
+void
+virXPathSetDirectEval(bool enable)
+{
+    virXPathDirectDisabled = !enable;
+}
+
+
+/*
+ * Evaluates @xpath in @ctxt like xmlXPathEval(), but compiles any given
+ * expression only once and evaluates simple location paths without the
+ * XPath engine.
+ */
+static xmlXPathObjectPtr
+virXPathEval(const char *xpath,
+             xmlXPathContextPtr ctxt)
+{
+    virXPathCacheEntryPtr entry = NULL;
+    virXPathCacheEntryPtr uncached = NULL;
+    xmlXPathObjectPtr obj;
+
+    virMutexLock(&virXPathCacheLock);
+    if (virXPathCache)
+        entry = virHashLookup(virXPathCache, xpath);
+    virMutexUnlock(&virXPathCacheLock);
+
+    if (!entry) {
+        xmlXPathCompExprPtr comp;
+
+        /* Compiled without a context, so that the expression doesn't
+         * keep the dictionary of the document alive. Let xmlXPathEval
+         * report errors against @ctxt. */
+        if (!(comp = xmlXPathCompile(BAD_CAST xpath)))
+            return xmlXPathEval(BAD_CAST xpath, ctxt);
+
+        entry = g_new0(virXPathCacheEntry, 1);
+        entry->comp = comp;
+        entry->direct = virXPathDirectParse(xpath);
+
+        virMutexLock(&virXPathCacheLock);
+        if (!virXPathCache)
+            virXPathCache = virHashNew(virXPathCacheDataFree);
+
+        if (virXPathCache) {
+            virXPathCacheEntryPtr other = virHashLookup(virXPathCache, xpath);
+
+            if (other) {
+                /* compiled by another thread meanwhile */
+                virXPathCacheEntryFree(entry);
+                entry = other;
+            } else if (virHashSize(virXPathCache) >= VIR_XPATH_CACHE_MAX ||
+                       virHashAddEntry(virXPathCache, xpath, entry) < 0) {
+                virResetLastError();
+                uncached = entry;
+            }
+        } else {
+            uncached = entry;
+        }
+        virMutexUnlock(&virXPathCacheLock);
+    }
+
+    if (entry->direct && ctxt->node && !virXPathDirectDisabled)
+        obj = virXPathDirectEval(entry->direct, ctxt->node);
+    else
+        obj = xmlXPathCompiledEval(entry->comp, ctxt);
+
+    virXPathCacheEntryFree(uncached);
+    return obj;
+}
+
+
 xmlXPathContextPtr
 virXMLXPathContextNew(xmlDocPtr xml)
 {
@@ -82,7 +419,7 @@ virXPathString(const char *xpath,
                        "%s", _("Invalid parameter to virXPathString()"));
         return NULL;
     }
-    obj = xmlXPathEval(BAD_CAST xpath, ctxt);
+    obj = virXPathEval(xpath, ctxt);
     if ((obj == NULL) || (obj->type != XPATH_STRING) ||
         (obj->stringval == NULL) || (obj->stringval[0] == 0)) {
         xmlXPathFreeObject(obj);
@@ -156,7 +493,7 @@ virXPathNumber(const char *xpath,
                        "%s", _("Invalid parameter to virXPathNumber()"));
         return -1;
     }
-    obj = xmlXPathEval(BAD_CAST xpath, ctxt);
+    obj = virXPathEval(xpath, ctxt);
     if ((obj == NULL) || (obj->type != XPATH_NUMBER) ||
         (isnan(obj->floatval))) {
         xmlXPathFreeObject(obj);
@@ -182,7 +519,7 @@ virXPathLongBase(const char *xpath,
                        "%s", _("Invalid parameter to virXPathLong()"));
         return -1;
     }
-    obj = xmlXPathEval(BAD_CAST xpath, ctxt);
+    obj = virXPathEval(xpath, ctxt);
     if ((obj != NULL) && (obj->type == XPATH_STRING) &&
         (obj->stringval != NULL) && (obj->stringval[0] != 0)) {
         if (virStrToLong_l((char *) obj->stringval, NULL, base, value) < 0)
@@ -284,7 +621,7 @@ virXPathULongBase(const char *xpath,
                        "%s", _("Invalid parameter to virXPathULong()"));
         return -1;
     }
-    obj = xmlXPathEval(BAD_CAST xpath, ctxt);
+    obj = virXPathEval(xpath, ctxt);
     if ((obj != NULL) && (obj->type == XPATH_STRING) &&
         (obj->stringval != NULL) && (obj->stringval[0] != 0)) {
         if (virStrToLong_ul((char *) obj->stringval, NULL, base, value) < 0)
@@ -397,7 +734,7 @@ virXPathULongLong(const char *xpath,
                        "%s", _("Invalid parameter to virXPathULong()"));
         return -1;
     }
-    obj = xmlXPathEval(BAD_CAST xpath, ctxt);
+    obj = virXPathEval(xpath, ctxt);
     if ((obj != NULL) && (obj->type == XPATH_STRING) &&
         (obj->stringval != NULL) && (obj->stringval[0] != 0)) {
         if (virStrToLong_ull((char *) obj->stringval, NULL, 10, value) < 0)
@@ -440,7 +777,7 @@ virXPathLongLong(const char *xpath,
                        "%s", _("Invalid parameter to virXPathLongLong()"));
         return -1;
     }
-    obj = xmlXPathEval(BAD_CAST xpath, ctxt);
+    obj = virXPathEval(xpath, ctxt);
     if ((obj != NULL) && (obj->type == XPATH_STRING) &&
         (obj->stringval != NULL) && (obj->stringval[0] != 0)) {
         if (virStrToLong_ll((char *) obj->stringval, NULL, 10, value) < 0)
@@ -579,7 +916,7 @@ virXPathBoolean(const char *xpath,
                        "%s", _("Invalid parameter to virXPathBoolean()"));
         return -1;
     }
-    obj = xmlXPathEval(BAD_CAST xpath, ctxt);
+    obj = virXPathEval(xpath, ctxt);
     if ((obj == NULL) || (obj->type != XPATH_BOOLEAN) ||
         (obj->boolval < 0) || (obj->boolval > 1)) {
         xmlXPathFreeObject(obj);
@@ -613,7 +950,7 @@ virXPathNode(const char *xpath,
                        "%s", _("Invalid parameter to virXPathNode()"));
         return NULL;
     }
-    obj = xmlXPathEval(BAD_CAST xpath, ctxt);
+    obj = virXPathEval(xpath, ctxt);
     if ((obj == NULL) || (obj->type != XPATH_NODESET) ||
         (obj->nodesetval == NULL) || (obj->nodesetval->nodeNr <= 0) ||
         (obj->nodesetval->nodeTab == NULL)) {
@@ -654,7 +991,7 @@ virXPathNodeSet(const char *xpath,
     if (list != NULL)
         *list = NULL;
 
-    obj = xmlXPathEval(BAD_CAST xpath, ctxt);
+    obj = virXPathEval(xpath, ctxt);
     if (obj == NULL)
         return 0;
 
@@ -860,45 +1197,43 @@ const char *virXMLPickShellSafeComment(const char *str1, const char *str2)
     return NULL;
 }
 
+static void
+virXMLFormatWarning(virBufferPtr buf,
+                    const char *name,
+                    const char *cmd)
+{
+    virBufferAddLit(buf,
+                    "<!--\n"
+                    "WARNING: THIS IS AN AUTO-GENERATED FILE. CHANGES TO IT ARE LIKELY TO BE\n"
+                    "OVERWRITTEN AND LOST. Changes to this xml configuration should be made using:\n"
+                    "  virsh ");
+    virBufferAdd(buf, cmd, -1);
+
+    if (name)
+        virBufferAsprintf(buf, " %s", name);
+
+    virBufferAddLit(buf,
+                    "\n"
+                    "or other application using the libvirt API.\n"
+                    "-->\n\n");
+}
+
 static int virXMLEmitWarning(int fd,
                              const char *name,
                              const char *cmd)
 {
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
     size_t len;
-    const char *prologue =
-        "<!--\n"
-        "WARNING: THIS IS AN AUTO-GENERATED FILE. CHANGES TO IT ARE LIKELY TO BE\n"
-        "OVERWRITTEN AND LOST. Changes to this xml configuration should be made using:\n"
-        "  virsh ";
-    const char *epilogue =
-        "\n"
-        "or other application using the libvirt API.\n"
-        "-->\n\n";
 
     if (fd < 0 || !cmd) {
         errno = EINVAL;
         return -1;
     }
 
-    len = strlen(prologue);
-    if (safewrite(fd, prologue, len) != len)
-        return -1;
+    virXMLFormatWarning(&buf, name, cmd);
 
-    len = strlen(cmd);
-    if (safewrite(fd, cmd, len) != len)
-        return -1;
-
-    if (name) {
-        if (safewrite(fd, " ", 1) != 1)
-            return -1;
-
-        len = strlen(name);
-        if (safewrite(fd, name, len) != len)
-            return -1;
-    }
-
-    len = strlen(epilogue);
-    if (safewrite(fd, epilogue, len) != len)
+    len = virBufferUse(&buf);
+    if (safewrite(fd, virBufferCurrentContent(&buf), len) != len)
         return -1;
 
     return 0;
@@ -938,6 +1273,75 @@ virXMLSaveFile(const char *path,
     return virFileRewrite(path, S_IRUSR | S_IWUSR, virXMLRewriteFile, &data);
 }
 
+
+/**
+ * virXMLSaveFileDeferred:
+ * @path: file to save
+ * @warnName: name used in the warning comment, or NULL
+ * @warnCommand: command used in the warning comment, or NULL
+ * @xml: XML document to save
+ *
+ * Like virXMLSaveFile but hands the file over to virWriteBehindQueue, so
+ * it may be written to disk later together with other files.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virXMLSaveFileDeferred(const char *path,
+                       const char *warnName,
+                       const char *warnCommand,
+                       const char *xml)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *data = NULL;
+
+    if (warnCommand)
+        virXMLFormatWarning(&buf, warnName, warnCommand);
+    virBufferAdd(&buf, xml, -1);
+
+    data = virBufferContentAndReset(&buf);
+
+    return virWriteBehindQueue(path, S_IRUSR | S_IWUSR, data);
+}
+
+
+/**
+ * virXMLSaveFiles:
+ * @paths: files to save
+ * @xmls: XML documents to save to @paths
+ * @n: number of files
+ * @warnName: name used in the warning comment of each file, or NULL
+ * @warnCommand: command used in the warning comment, or NULL
+ *
+ * Like virXMLSaveFile but saves all @n files with a single flush to
+ * disk via virFileRewriteBatch.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virXMLSaveFiles(const char **paths,
+                const char **xmls,
+                size_t n,
+                const char *warnName,
+                const char *warnCommand)
+{
+    g_autofree struct virXMLRewriteFileData *data = NULL;
+    g_autofree const void **opaques = NULL;
+    size_t i;
+
+    data = g_new0(struct virXMLRewriteFileData, n);
+    opaques = g_new0(const void *, n);
+    for (i = 0; i < n; i++) {
+        data[i].warnName = warnName;
+        data[i].warnCommand = warnCommand;
+        data[i].xml = xmls[i];
+        opaques[i] = &data[i];
+    }
+
+    return virFileRewriteBatch(paths, n, S_IRUSR | S_IWUSR,
+                               virXMLRewriteFile, opaques);
+}
+
 /* Returns the number of children of node, or -1 on error.  */
 long
 virXMLChildElementCount(xmlNodePtr node)
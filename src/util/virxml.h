@@ -29,6 +29,8 @@
 
 #include "virbuffer.h"
 
+void virXPathSetDirectEval(bool enable);
+
 xmlXPathContextPtr virXMLXPathContextNew(xmlDocPtr xml)
     G_GNUC_WARN_UNUSED_RESULT;
 
@@ -169,6 +171,15 @@ int virXMLSaveFile(const char *path,
                    const char *warnName,
                    const char *warnCommand,
                    const char *xml);
+int virXMLSaveFileDeferred(const char *path,
+                           const char *warnName,
+                           const char *warnCommand,
+                           const char *xml);
+int virXMLSaveFiles(const char **paths,
+                    const char **xmls,
+                    size_t n,
+                    const char *warnName,
+                    const char *warnCommand);
 
 char *virXMLNodeToString(xmlDocPtr doc, xmlNodePtr node);
 
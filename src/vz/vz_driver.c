@@ -541,7 +541,7 @@ vzConnectListAllDomains(virConnectPtr conn,
         return -1;
 
     return virDomainObjListExport(privconn->driver->domains, conn, domains,
-                                  virConnectListAllDomainsCheckACL, flags);
+                                  virConnectListAllDomainsCheckACLList, flags);
 }
 
 static virDomainPtr
@@ -3041,6 +3041,10 @@ vzConnectSupportsFeature(virConnectPtr conn G_GNUC_UNUSED, int feature)
     case VIR_DRV_FEATURE_REMOTE:
     case VIR_DRV_FEATURE_REMOTE_CLOSE_CALLBACK:
     case VIR_DRV_FEATURE_REMOTE_EVENT_CALLBACK:
+    case VIR_DRV_FEATURE_REMOTE_STATS_COMPACT:
+    case VIR_DRV_FEATURE_REMOTE_PIPELINE:
+    case VIR_DRV_FEATURE_REMOTE_CALL_BATCH:
+    case VIR_DRV_FEATURE_REMOTE_STREAM_LARGE_PACKETS:
     case VIR_DRV_FEATURE_TYPED_PARAM_STRING:
     case VIR_DRV_FEATURE_XML_MIGRATABLE:
     default:
@@ -3791,12 +3795,13 @@ vzConnectGetAllDomainStats(virConnectPtr conn,
 
     if (ndomains) {
         if (virDomainObjListConvert(driver->domains, conn, domains, ndomains, &doms,
-                                    &ndoms, virConnectGetAllDomainStatsCheckACL,
+                                    &ndoms,
+                                    virConnectGetAllDomainStatsCheckACLList,
                                     lflags, true) < 0)
             return -1;
     } else {
         if (virDomainObjListCollect(driver->domains, conn, &doms, &ndoms,
-                                    virConnectGetAllDomainStatsCheckACL,
+                                    virConnectGetAllDomainStatsCheckACLList,
                                     lflags) < 0)
             return -1;
     }
@@ -1183,6 +1183,21 @@ test28(const void *unused G_GNUC_UNUSED)
 }
 
 
+/*
+ * Same as test14, but with the commands run by a command helper.
+ */
+static int
+test29(const void *unused G_GNUC_UNUSED)
+{
+    if (virCommandHelpersStart(1) < 0) {
+        printf("Cannot start command helpers %s\n", virGetLastErrorMessage());
+        return -1;
+    }
+
+    return test14(NULL);
+}
+
+
 static int
 mymain(void)
 {
@@ -1281,6 +1296,8 @@ mymain(void)
     DO_TEST(test26);
     DO_TEST(test27);
     DO_TEST(test28);
+    /* Must stay last, the command helpers run any later command */
+    DO_TEST(test29);
 
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
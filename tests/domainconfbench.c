@@ -0,0 +1,160 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "internal.h"
+#include "virstring.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+static virCapsPtr caps;
+static virDomainXMLOptionPtr xmlopt;
+
+/* The domain XMLs of the qemuxml2argv corpus that the generic parser
+ * accepts, and their parsed definitions */
+static char **xmls;
+static virDomainDefPtr *defs;
+static size_t ndefs;
+
+
+static int
+testBenchLoadCorpus(const char *dirname)
+{
+    DIR *dir = NULL;
+    struct dirent *ent;
+    size_t skipped = 0;
+    int rc;
+
+    if (virDirOpen(&dir, dirname) < 0)
+        return -1;
+
+    while ((rc = virDirRead(dir, &ent, dirname)) > 0) {
+        g_autofree char *path = NULL;
+        g_autofree char *xml = NULL;
+        virDomainDefPtr def;
+
+        if (!virStringHasSuffix(ent->d_name, ".xml"))
+            continue;
+
+        path = g_strdup_printf("%s/%s", dirname, ent->d_name);
+
+        if (virTestLoadFile(path, &xml) < 0) {
+            rc = -1;
+            break;
+        }
+
+        if (!(def = virDomainDefParseString(xml, xmlopt, NULL,
+                                            VIR_DOMAIN_DEF_PARSE_INACTIVE))) {
+            VIR_TEST_DEBUG("Skipping %s: %s", ent->d_name,
+                           virGetLastErrorMessage());
+            virResetLastError();
+            skipped++;
+            continue;
+        }
+
+        xmls = g_renew(char *, xmls, ndefs + 1);
+        defs = g_renew(virDomainDefPtr, defs, ndefs + 1);
+        xmls[ndefs] = g_steal_pointer(&xml);
+        defs[ndefs] = def;
+        ndefs++;
+    }
+
+    VIR_DIR_CLOSE(dir);
+
+    VIR_TEST_VERBOSE("Loaded %zu domain XMLs, skipped %zu", ndefs, skipped);
+
+    return rc;
+}
+
+
+static int
+testBenchParse(const void *opaque G_GNUC_UNUSED)
+{
+    size_t i;
+
+    for (i = 0; i < ndefs; i++) {
+        virDomainDefPtr def;
+
+        if (!(def = virDomainDefParseString(xmls[i], xmlopt, NULL,
+                                            VIR_DOMAIN_DEF_PARSE_INACTIVE)))
+            return -1;
+
+        virDomainDefFree(def);
+    }
+
+    return 0;
+}
+
+
+static int
+testBenchFormat(const void *opaque G_GNUC_UNUSED)
+{
+    size_t i;
+
+    for (i = 0; i < ndefs; i++) {
+        g_autofree char *xml = NULL;
+
+        if (!(xml = virDomainDefFormat(defs[i], xmlopt,
+                                       VIR_DOMAIN_DEF_FORMAT_SECURE)))
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+    size_t i;
+
+    if (!(caps = virTestGenericCapsInit()))
+        return EXIT_FAILURE;
+
+    if (!(xmlopt = virTestGenericDomainXMLConfInit()))
+        return EXIT_FAILURE;
+
+    if (testBenchLoadCorpus(abs_srcdir "/qemuxml2argvdata") < 0)
+        return EXIT_FAILURE;
+
+    if (virTestBench("virDomainDefParseString qemuxml2argvdata",
+                     testBenchParse, NULL) < 0)
+        ret = -1;
+
+    if (virTestBench("virDomainDefFormat qemuxml2argvdata",
+                     testBenchFormat, NULL) < 0)
+        ret = -1;
+
+    for (i = 0; i < ndefs; i++) {
+        virDomainDefFree(defs[i]);
+        g_free(xmls[i]);
+    }
+    g_free(defs);
+    g_free(xmls);
+    virObjectUnref(caps);
+    virObjectUnref(xmlopt);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#ifdef __linux__
+VIR_TEST_MAIN_PRELOAD(mymain, VIR_TEST_MOCK("virbenchalloc"))
+#else
+VIR_TEST_MAIN(mymain)
+#endif
@@ -82,6 +82,7 @@ mymain(void)
     DO_TEST("disk-formats");
     DO_TEST_DIFFERENT("filesystem-ram");
     DO_TEST("filesystem-root");
+    DO_TEST("filesystem-template");
     DO_TEST("idmap");
     DO_TEST("capabilities");
     DO_TEST("sharenet");
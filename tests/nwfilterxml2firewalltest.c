@@ -459,6 +459,8 @@ mymain(void)
     } while (0)
 
     virFirewallSetLockOverride(true);
+    /* The expected output lists the rules one by one */
+    virFirewallSetBatchOverride(true);
 
     if (virFirewallSetBackend(VIR_FIREWALL_BACKEND_DIRECT) < 0) {
         if (!hasNetfilterTools()) {
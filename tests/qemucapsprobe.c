@@ -77,7 +77,8 @@ main(int argc, char **argv)
         return EXIT_FAILURE;
 
     if (!(caps = virQEMUCapsNewForBinaryInternal(VIR_ARCH_NONE, argv[1], "/tmp",
-                                                 -1, -1, NULL, 0, NULL)))
+                                                 -1, -1, NULL, 0, NULL,
+                                                 false, NULL)))
         return EXIT_FAILURE;
 
     virObjectUnref(caps);
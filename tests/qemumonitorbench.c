@@ -0,0 +1,150 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "testutilsqemu.h"
+#include "qemumonitortestutils.h"
+#include "qemu/qemu_block.h"
+#include "qemu/qemu_monitor.h"
+#include "virstring.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+
+/* Time the monitor part of the block stats of a blockdev guest, as done by
+ * qemuDomainGetStatsBlock */
+static int
+testBenchBlockStats(const void *opaque)
+{
+    qemuMonitorPtr mon = qemuMonitorTestGetMonitor((qemuMonitorTestPtr) opaque);
+    g_autoptr(virHashTable) stats = NULL;
+
+    if (qemuMonitorGetAllBlockStatsInfo(mon, &stats, false) <= 0 ||
+        qemuMonitorBlockStatsUpdateCapacityBlockdev(mon, stats) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+/* The data of all nodes, as used by block jobs and checkpoints */
+static int
+testBenchNamedNodeData(const void *opaque)
+{
+    qemuMonitorPtr mon = qemuMonitorTestGetMonitor((qemuMonitorTestPtr) opaque);
+    g_autoptr(virHashTable) nodedata = NULL;
+
+    if (!(nodedata = qemuMonitorBlockGetNamedNodeData(mon, true)) ||
+        virHashSize(nodedata) == 0)
+        return -1;
+
+    return 0;
+}
+
+
+/* The node data used by the block stats of guests without blockdev */
+static int
+testBenchNodeData(const void *opaque)
+{
+    qemuMonitorPtr mon = qemuMonitorTestGetMonitor((qemuMonitorTestPtr) opaque);
+    g_autoptr(virJSONValue) nodes = NULL;
+    g_autoptr(virHashTable) nodedata = NULL;
+
+    if (!(nodes = qemuMonitorQueryNamedBlockNodes(mon)) ||
+        !(nodedata = qemuBlockGetNodeData(nodes)))
+        return -1;
+
+    return 0;
+}
+
+
+static int
+testBenchReplay(virQEMUDriverPtr driver,
+                const char *name)
+{
+    g_autofree char *path = NULL;
+    g_autofree char *title = NULL;
+    g_autoptr(qemuMonitorTest) test = NULL;
+    int ret = 0;
+
+    path = g_strdup_printf("%s/qemumonitorbenchdata/%s", abs_srcdir, name);
+
+    if (!(test = qemuMonitorTestNewReplay(path, driver, NULL)))
+        return -1;
+
+    title = g_strdup_printf("qemuMonitorGetAllBlockStatsInfo %s", name);
+    if (virTestBench(title, testBenchBlockStats, test) < 0)
+        ret = -1;
+
+    g_free(title);
+    title = g_strdup_printf("qemuMonitorBlockGetNamedNodeData %s", name);
+    if (virTestBench(title, testBenchNamedNodeData, test) < 0)
+        ret = -1;
+
+    g_free(title);
+    title = g_strdup_printf("qemuBlockGetNodeData %s", name);
+    if (virTestBench(title, testBenchNodeData, test) < 0)
+        ret = -1;
+
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    virQEMUDriver driver;
+    const char *dirname = abs_srcdir "/qemumonitorbenchdata";
+    DIR *dir = NULL;
+    struct dirent *ent;
+    int ret = 0;
+    int rc;
+
+    if (qemuTestDriverInit(&driver) < 0)
+        return EXIT_FAILURE;
+
+    virEventRegisterDefaultImpl();
+
+    if (virDirOpen(&dir, dirname) < 0) {
+        ret = -1;
+        goto cleanup;
+    }
+
+    while ((rc = virDirRead(dir, &ent, dirname)) > 0) {
+        if (!virStringHasSuffix(ent->d_name, ".replies"))
+            continue;
+
+        if (testBenchReplay(&driver, ent->d_name) < 0)
+            ret = -1;
+    }
+
+    if (rc < 0)
+        ret = -1;
+
+    VIR_DIR_CLOSE(dir);
+
+ cleanup:
+    qemuTestDriverFree(&driver);
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#ifdef __linux__
+VIR_TEST_MAIN_PRELOAD(mymain, VIR_TEST_MOCK("virbenchalloc"))
+#else
+VIR_TEST_MAIN(mymain)
+#endif
@@ -239,6 +239,205 @@ testQemuMonitorJSONGetStatus(const void *opaque)
     return 0;
 }
 
+
+struct testQemuMonitorJSONQueryAsyncData {
+    size_t completed;
+    size_t failed;
+    bool running;
+    size_t niothreads;
+};
+
+
+static void
+testQemuMonitorJSONQueryAsyncCallback(qemuMonitorPtr mon G_GNUC_UNUSED,
+                                      const char *cmdname,
+                                      virJSONValuePtr data,
+                                      const char *error G_GNUC_UNUSED,
+                                      void *opaque)
+{
+    struct testQemuMonitorJSONQueryAsyncData *res = opaque;
+
+    res->completed++;
+
+    if (!data) {
+        res->failed++;
+        return;
+    }
+
+    if (STREQ(cmdname, "query-status"))
+        ignore_value(virJSONValueObjectGetBoolean(data, "running",
+                                                  &res->running));
+    else if (STREQ(cmdname, "query-iothreads"))
+        res->niothreads = virJSONValueArraySize(data);
+}
+
+
+static int
+testQemuMonitorJSONQueryAsync(const void *opaque)
+{
+    const testGenericData *data = opaque;
+    virDomainXMLOptionPtr xmlopt = data->xmlopt;
+    struct testQemuMonitorJSONQueryAsyncData res = { 0 };
+    bool running = false;
+    virDomainPausedReason reason = 0;
+    qemuMonitorPtr mon;
+    g_autoptr(qemuMonitorTest) test = NULL;
+
+    if (!(test = qemuMonitorTestNewSchema(xmlopt, data->schema)))
+        return -1;
+
+    mon = qemuMonitorTestGetMonitor(test);
+
+    if (qemuMonitorTestAddItem(test, "query-status",
+                               "{ "
+                               "    \"return\": { "
+                               "        \"status\": \"running\", "
+                               "        \"singlestep\": false, "
+                               "        \"running\": true "
+                               "    } "
+                               "}") < 0 ||
+        qemuMonitorTestAddItem(test, "query-iothreads",
+                               "{ "
+                               "    \"return\": [ "
+                               "        { \"id\": \"iothread1\", "
+                               "          \"thread-id\": 30992 }, "
+                               "        { \"id\": \"iothread2\", "
+                               "          \"thread-id\": 30993 } "
+                               "    ] "
+                               "}") < 0 ||
+        qemuMonitorTestAddItem(test, "query-balloon",
+                               "{ "
+                               "    \"error\": { "
+                               "        \"class\": \"DeviceNotActive\", "
+                               "        \"desc\": \"No balloon device\" "
+                               "    } "
+                               "}") < 0 ||
+        qemuMonitorTestAddItem(test, "query-status",
+                               "{ "
+                               "    \"return\": { "
+                               "        \"status\": \"paused\", "
+                               "        \"singlestep\": false, "
+                               "        \"running\": false "
+                               "    } "
+                               "}") < 0)
+        return -1;
+
+    if (qemuMonitorQueryAsync(mon, "query-status",
+                              testQemuMonitorJSONQueryAsyncCallback, &res) < 0 ||
+        qemuMonitorQueryAsync(mon, "query-iothreads",
+                              testQemuMonitorJSONQueryAsyncCallback, &res) < 0 ||
+        qemuMonitorQueryAsync(mon, "query-balloon",
+                              testQemuMonitorJSONQueryAsyncCallback, &res) < 0)
+        return -1;
+
+    if (qemuMonitorWaitAsync(mon) < 0)
+        return -1;
+
+    if (res.completed != 3 || res.failed != 1 ||
+        !res.running || res.niothreads != 2) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "unexpected results completed=%zu failed=%zu "
+                       "running=%d iothreads=%zu",
+                       res.completed, res.failed, res.running, res.niothreads);
+        return -1;
+    }
+
+    /* synchronous commands keep working afterwards */
+    if (qemuMonitorGetStatus(mon, &running, &reason) < 0)
+        return -1;
+
+    if (running) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "Running was not false");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testQemuMonitorJSONGetStats(const void *opaque)
+{
+    const testGenericData *data = opaque;
+    virDomainXMLOptionPtr xmlopt = data->xmlopt;
+    bool running = false;
+    virDomainPausedReason reason = 0;
+    qemuMonitorStats stats;
+    qemuMonitorCommandStatsPtr cmd = NULL;
+    unsigned long long samples = 0;
+    size_t i;
+    int ret = -1;
+    g_autoptr(qemuMonitorTest) test = NULL;
+
+    if (!(test = qemuMonitorTestNewSchema(xmlopt, data->schema)))
+        return -1;
+
+    if (qemuMonitorTestAddItem(test, "query-status",
+                               "{ "
+                               "    \"return\": { "
+                               "        \"status\": \"running\", "
+                               "        \"singlestep\": false, "
+                               "        \"running\": true "
+                               "    } "
+                               "}") < 0 ||
+        qemuMonitorTestAddItem(test, "query-status",
+                               "{ "
+                               "    \"error\": { "
+                               "        \"class\": \"GenericError\", "
+                               "        \"desc\": \"failed\" "
+                               "    } "
+                               "}") < 0)
+        return -1;
+
+    if (qemuMonitorGetStatus(qemuMonitorTestGetMonitor(test),
+                             &running, &reason) < 0)
+        return -1;
+
+    if (qemuMonitorGetStatus(qemuMonitorTestGetMonitor(test),
+                             &running, &reason) == 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "error reply was not reported");
+        return -1;
+    }
+
+    if (qemuMonitorGetStats(qemuMonitorTestGetMonitor(test), &stats) < 0)
+        return -1;
+
+    for (i = 0; i < stats.ncommands; i++) {
+        if (STREQ(stats.commands[i].name, "query-status"))
+            cmd = stats.commands + i;
+    }
+
+    if (!cmd) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "missing stats for 'query-status'");
+        goto cleanup;
+    }
+
+    for (i = 0; i < QEMU_MONITOR_STATS_BUCKETS; i++)
+        samples += cmd->latency[i];
+
+    if (cmd->calls != 2 || cmd->errors != 1 || samples != 2) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "unexpected stats calls=%llu errors=%llu samples=%llu",
+                       cmd->calls, cmd->errors, samples);
+        goto cleanup;
+    }
+
+    if (stats.pending != 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       "no command should be pending");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    qemuMonitorStatsClear(&stats);
+    return ret;
+}
+
 static int
 testQemuMonitorJSONGetVersion(const void *opaque)
 {
@@ -2987,11 +3186,12 @@ testQemuMonitorJSONTransaction(const void *opaque)
         qemuMonitorTransactionSnapshotLegacy(actions, "dev6", "path", "qcow2", true) < 0 ||
         qemuMonitorTransactionSnapshotBlockdev(actions, "node7", "overlay7") < 0 ||
         qemuMonitorTransactionBackup(actions, "dev8", "job8", "target8", "bitmap8",
-                                     QEMU_MONITOR_TRANSACTION_BACKUP_SYNC_MODE_NONE) < 0 ||
+                                     QEMU_MONITOR_TRANSACTION_BACKUP_SYNC_MODE_NONE, 0) < 0 ||
         qemuMonitorTransactionBackup(actions, "dev9", "job9", "target9", "bitmap9",
-                                     QEMU_MONITOR_TRANSACTION_BACKUP_SYNC_MODE_INCREMENTAL) < 0 ||
+                                     QEMU_MONITOR_TRANSACTION_BACKUP_SYNC_MODE_INCREMENTAL, 0) < 0 ||
         qemuMonitorTransactionBackup(actions, "devA", "jobA", "targetA", "bitmapA",
-                                     QEMU_MONITOR_TRANSACTION_BACKUP_SYNC_MODE_FULL) < 0)
+                                     QEMU_MONITOR_TRANSACTION_BACKUP_SYNC_MODE_FULL,
+                                     1024 * 1024) < 0)
         return -1;
 
     if (qemuMonitorTestAddItem(test, "transaction", "{\"return\":{}}") < 0)
@@ -3184,6 +3384,8 @@ mymain(void)
     } while (0)
 
     DO_TEST(GetStatus);
+    DO_TEST(GetStats);
+    DO_TEST(QueryAsync);
     DO_TEST(GetVersion);
     DO_TEST(GetMachines);
     DO_TEST(GetCPUDefinitions);
@@ -59,6 +59,9 @@ struct _qemuMonitorTest {
 
     bool allowUnusedCommands;
 
+    /* items are kept after being processed, see qemuMonitorTestNewReplay */
+    bool replay;
+
     bool skipValidationDeprecated;
     bool skipValidationRemoved;
 
@@ -232,6 +235,9 @@ qemuMonitorTestProcessCommand(qemuMonitorTestPtr test,
 
     if (test->nitems == 0) {
         qemuMonitorTestError("unexpected command: '%s'", cmdstr);
+    } else if (test->replay) {
+        qemuMonitorTestItemPtr item = test->items[0];
+        ret = (item->cb)(test, item, cmdstr);
     } else {
         qemuMonitorTestItemPtr item = test->items[0];
         ret = (item->cb)(test, item, cmdstr);
@@ -581,6 +587,34 @@ qemuMonitorTestProcessCommandDefaultValidate(qemuMonitorTestPtr test,
 }
 
 
+/*
+ * Echo the 'id' of @cmd in @response like QEMU does, so that replies to
+ * asynchronously submitted commands can be matched. Responses which are
+ * not a plain JSON object are passed through unchanged.
+ */
+static int
+qemuMonitorTestAddReplyWithID(qemuMonitorTestPtr test,
+                              virJSONValuePtr cmd,
+                              const char *response)
+{
+    const char *id = virJSONValueObjectGetString(cmd, "id");
+    g_autoptr(virJSONValue) reply = NULL;
+    g_autofree char *replystr = NULL;
+
+    if (!id || strstr(response, "\n") ||
+        !(reply = virJSONValueFromString(response)) ||
+        virJSONValueGetType(reply) != VIR_JSON_TYPE_OBJECT ||
+        virJSONValueObjectHasKey(reply, "id") == 1 ||
+        virJSONValueObjectAppendString(reply, "id", id) < 0 ||
+        !(replystr = virJSONValueToString(reply, false))) {
+        virResetLastError();
+        return qemuMonitorTestAddResponse(test, response);
+    }
+
+    return qemuMonitorTestAddResponse(test, replystr);
+}
+
+
 static int
 qemuMonitorTestProcessCommandDefault(qemuMonitorTestPtr test,
                                      qemuMonitorTestItemPtr item,
@@ -607,7 +641,7 @@ qemuMonitorTestProcessCommandDefault(qemuMonitorTestPtr test,
         qemuMonitorTestErrorInvalidCommand(data->command_name, cmdname);
         return -1;
     } else {
-        return qemuMonitorTestAddResponse(test, data->response);
+        return qemuMonitorTestAddReplyWithID(test, val, data->response);
     }
 }
 
@@ -1331,30 +1365,22 @@ qemuMonitorTestFullAddItem(qemuMonitorTestPtr test,
 }
 
 
-/**
- * qemuMonitorTestNewFromFileFull:
- * @fileName: File name to load monitor replies from
- * @driver: qemu driver object
- * @vm: domain object (may be null if it's not needed by the test)
- * @qmpschema: QMP schema data hash table if QMP checking is required
- *
- * Create a JSON test monitor simulator object and fill it with expected command
- * sequence and replies specified in @fileName.
- *
- * The file contains a sequence of JSON commands and reply objects separated by
- * empty lines. A command is followed by a reply. The QMP greeting is added
- * automatically.
- *
- * Returns the monitor object on success; NULL on error.
+typedef int (*qemuMonitorTestFileCallback)(qemuMonitorTestPtr test,
+                                           const char *filename,
+                                           const char *command,
+                                           const char *response,
+                                           size_t line);
+
+/*
+ * Calls @cb for every pair of a command and its reply in @jsonstr, which is
+ * modified in the process.
  */
-qemuMonitorTestPtr
-qemuMonitorTestNewFromFileFull(const char *fileName,
-                               virQEMUDriverPtr driver,
-                               virDomainObjPtr vm,
-                               virHashTablePtr qmpschema)
+static int
+qemuMonitorTestForEachCommand(qemuMonitorTestPtr test,
+                              const char *fileName,
+                              char *jsonstr,
+                              qemuMonitorTestFileCallback cb)
 {
-    qemuMonitorTestPtr ret = NULL;
-    g_autofree char *jsonstr = NULL;
     char *tmp;
     size_t line = 0;
 
@@ -1362,13 +1388,6 @@ qemuMonitorTestNewFromFileFull(const char *fileName,
     char *response = NULL;
     size_t commandln = 0;
 
-    if (virTestLoadFile(fileName, &jsonstr) < 0)
-        return NULL;
-
-    if (!(ret = qemuMonitorTestNew(driver->xmlopt, vm, driver, NULL,
-                                   qmpschema)))
-        goto cleanup;
-
     tmp = jsonstr;
     command = tmp;
     while ((tmp = strchr(tmp, '\n'))) {
@@ -1389,9 +1408,8 @@ qemuMonitorTestNewFromFileFull(const char *fileName,
         *(tmp + 1) = '\0';
 
         if (response) {
-            if (qemuMonitorTestFullAddItem(ret, fileName, command,
-                                           response, commandln) < 0)
-                goto error;
+            if (cb(test, fileName, command, response, commandln) < 0)
+                return -1;
             command = NULL;
             response = NULL;
         }
@@ -1411,21 +1429,150 @@ qemuMonitorTestNewFromFileFull(const char *fileName,
         if (!response) {
             virReportError(VIR_ERR_INTERNAL_ERROR, "missing response for command "
                            "on line '%zu' in '%s'", commandln, fileName);
-            goto error;
+            return -1;
         }
 
-        if (qemuMonitorTestFullAddItem(ret, fileName, command,
-                                       response, commandln) < 0)
-            goto error;
+        if (cb(test, fileName, command, response, commandln) < 0)
+            return -1;
     }
 
- cleanup:
-    return ret;
+    return 0;
+}
 
- error:
-    qemuMonitorTestFree(ret);
-    ret = NULL;
-    goto cleanup;
+
+/**
+ * qemuMonitorTestNewFromFileFull:
+ * @fileName: File name to load monitor replies from
+ * @driver: qemu driver object
+ * @vm: domain object (may be null if it's not needed by the test)
+ * @qmpschema: QMP schema data hash table if QMP checking is required
+ *
+ * Create a JSON test monitor simulator object and fill it with expected command
+ * sequence and replies specified in @fileName.
+ *
+ * The file contains a sequence of JSON commands and reply objects separated by
+ * empty lines. A command is followed by a reply. The QMP greeting is added
+ * automatically.
+ *
+ * Returns the monitor object on success; NULL on error.
+ */
+qemuMonitorTestPtr
+qemuMonitorTestNewFromFileFull(const char *fileName,
+                               virQEMUDriverPtr driver,
+                               virDomainObjPtr vm,
+                               virHashTablePtr qmpschema)
+{
+    g_autoptr(qemuMonitorTest) ret = NULL;
+    g_autofree char *jsonstr = NULL;
+
+    if (virTestLoadFile(fileName, &jsonstr) < 0)
+        return NULL;
+
+    if (!(ret = qemuMonitorTestNew(driver->xmlopt, vm, driver, NULL,
+                                   qmpschema)))
+        return NULL;
+
+    if (qemuMonitorTestForEachCommand(ret, fileName, jsonstr,
+                                      qemuMonitorTestFullAddItem) < 0)
+        return NULL;
+
+    return g_steal_pointer(&ret);
+}
+
+
+static int
+qemuMonitorTestProcessCommandReplay(qemuMonitorTestPtr test,
+                                    qemuMonitorTestItemPtr item,
+                                    const char *cmdstr)
+{
+    virHashTablePtr replies = item->opaque;
+    g_autoptr(virJSONValue) val = NULL;
+    const char *cmdname;
+    const char *response;
+
+    if (!(val = virJSONValueFromString(cmdstr)))
+        return -1;
+
+    if (!(cmdname = virJSONValueObjectGetString(val, "execute"))) {
+        qemuMonitorTestError("Missing command name in %s", cmdstr);
+        return -1;
+    }
+
+    if (!(response = virHashLookup(replies, cmdname)))
+        return qemuMonitorTestAddErrorResponse(test,
+                                               "command '%s' was not recorded",
+                                               cmdname);
+
+    return qemuMonitorTestAddReplyWithID(test, val, response);
+}
+
+
+static int
+qemuMonitorTestReplayAddItem(qemuMonitorTestPtr test,
+                             const char *filename,
+                             const char *command,
+                             const char *response,
+                             size_t line)
+{
+    virHashTablePtr replies = test->items[0]->opaque;
+    g_autoptr(virJSONValue) cmd = NULL;
+    const char *cmdname;
+
+    if (!(cmd = virJSONValueFromString(command)) ||
+        !(cmdname = virJSONValueObjectGetString(cmd, "execute"))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       "invalid command on line '%zu' in '%s'", line, filename);
+        return -1;
+    }
+
+    return virHashUpdateEntry(replies, cmdname, g_strdup(response));
+}
+
+
+/**
+ * qemuMonitorTestNewReplay:
+ * @fileName: File name to load the recorded monitor traffic from
+ * @driver: qemu driver object
+ * @vm: domain object (may be null if it's not needed by the test)
+ *
+ * Create a JSON test monitor simulator object which replays the commands and
+ * replies recorded in @fileName, in the format of
+ * qemuMonitorTestNewFromFileFull. Unlike there, commands may be issued any
+ * number of times and in any order. They are matched by their name only and
+ * answered with the last reply recorded for that name, which makes the object
+ * suitable for benchmarking the monitor code with realistic data.
+ *
+ * Returns the monitor object on success; NULL on error.
+ */
+qemuMonitorTestPtr
+qemuMonitorTestNewReplay(const char *fileName,
+                         virQEMUDriverPtr driver,
+                         virDomainObjPtr vm)
+{
+    g_autoptr(qemuMonitorTest) ret = NULL;
+    g_autofree char *jsonstr = NULL;
+    virHashTablePtr replies;
+
+    if (virTestLoadFile(fileName, &jsonstr) < 0)
+        return NULL;
+
+    if (!(ret = qemuMonitorTestNew(driver->xmlopt, vm, driver, NULL, NULL)))
+        return NULL;
+
+    replies = virHashNew(g_free);
+    if (qemuMonitorTestAddHandler(ret, "replay",
+                                  qemuMonitorTestProcessCommandReplay,
+                                  replies, (virFreeCallback) virHashFree) < 0)
+        return NULL;
+
+    ret->replay = true;
+    ret->allowUnusedCommands = true;
+
+    if (qemuMonitorTestForEachCommand(ret, fileName, jsonstr,
+                                      qemuMonitorTestReplayAddItem) < 0)
+        return NULL;
+
+    return g_steal_pointer(&ret);
 }
 
 
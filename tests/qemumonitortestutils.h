@@ -95,6 +95,9 @@ qemuMonitorTestPtr qemuMonitorTestNewFromFileFull(const char *fileName,
                                                   virQEMUDriverPtr driver,
                                                   virDomainObjPtr vm,
                                                   virHashTablePtr qmpschema);
+qemuMonitorTestPtr qemuMonitorTestNewReplay(const char *fileName,
+                                            virQEMUDriverPtr driver,
+                                            virDomainObjPtr vm);
 
 qemuMonitorTestPtr qemuMonitorTestNewAgent(virDomainXMLOptionPtr xmlopt);
 
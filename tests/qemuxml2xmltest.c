@@ -43,6 +43,17 @@ static int
 testXML2XMLInactive(const void *opaque)
 {
     const struct testQemuInfo *info = opaque;
+    int ret;
+
+    /* Parse with the XPath engine evaluating every expression as well,
+     * both have to give the same result */
+    virXPathSetDirectEval(false);
+    ret = testCompareDomXML2XMLFiles(driver.caps, driver.xmlopt,
+                                     info->infile, info->outfile, false, 0,
+                                     TEST_COMPARE_DOM_XML2XML_RESULT_SUCCESS);
+    virXPathSetDirectEval(true);
+    if (ret < 0)
+        return ret;
 
     return testCompareDomXML2XMLFiles(driver.caps, driver.xmlopt,
                                       info->infile, info->outfile, false, 0,
@@ -98,6 +98,7 @@ mymain(void)
 #ifdef WITH_STORAGE_RBD
     DO_TEST("pool-rbd-ipv6");
     DO_TEST("pool-rbd-refresh-volume-allocation");
+    DO_TEST("pool-rbd-refresh-volume-allocation-lazy");
     DO_TEST("pool-rbd-ns-configopts");
 #endif
     DO_TEST("pool-vstorage");
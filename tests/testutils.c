@@ -26,6 +26,9 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#ifdef HAVE_DLFCN_H
+# include <dlfcn.h>
+#endif
 #include "testutils.h"
 #include "internal.h"
 #include "viralloc.h"
@@ -180,6 +183,152 @@ virTestRun(const char *title,
 }
 
 
+static int
+virTestBenchCompare(const void *a,
+                    const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+
+/* Returns the number of allocations made by the process so far, or -1 if
+ * the allocation counting mock isn't preloaded */
+static long long
+virTestBenchAllocations(void)
+{
+#ifdef HAVE_DLFCN_H
+    static unsigned long long (*count)(void);
+    static bool resolved;
+
+    if (!resolved) {
+        count = dlsym(RTLD_DEFAULT, "virBenchAllocMockCount");
+        resolved = true;
+    }
+
+    if (count)
+        return count();
+#endif /* HAVE_DLFCN_H */
+
+    return -1;
+}
+
+
+/**
+ * virTestBench:
+ * @title: name of the benchmark
+ * @body: function to benchmark
+ * @data: opaque data passed to @body
+ *
+ * Runs @body once as a test through virTestRun and, if it succeeds, times
+ * further runs of it. After VIR_TEST_BENCH_WARMUP (default 2) untimed runs
+ * it is run VIR_TEST_BENCH_ITERATIONS (default 10) times. The median, 90th
+ * and 99th percentile of the run times and the number of allocations per
+ * run, if the virbenchalloc mock is preloaded, are printed to stdout as a
+ * single line JSON object and appended to the file VIR_TEST_BENCH_OUTPUT
+ * points to, so that CI can track them over time.
+ *
+ * Returns: -1 = error, 0 = success, EXIT_AM_SKIP = skipped
+ */
+int
+virTestBench(const char *title,
+             int (*body)(const void *data),
+             const void *data)
+{
+    unsigned int warmup = 2;
+    unsigned int iterations = 10;
+    const char *output = getenv("VIR_TEST_BENCH_OUTPUT");
+    const char *value;
+    g_autofree unsigned long long *times = NULL;
+    g_autofree char *name = NULL;
+    g_autofree char *line = NULL;
+    g_autofree char *allocstr = NULL;
+    long long allocs = -1;
+    long long start;
+    unsigned long long total = 0;
+    size_t i;
+    int ret;
+
+    if ((ret = virTestRun(title, body, data)) != 0)
+        return ret;
+
+    /* honour the selection of tests through VIR_TEST_RANGE */
+    if (testBitmap && !virBitmapIsBitSet(testBitmap, testCounter))
+        return 0;
+
+    if ((value = getenv("VIR_TEST_BENCH_WARMUP")))
+        ignore_value(virStrToLong_ui(value, NULL, 10, &warmup));
+    if ((value = getenv("VIR_TEST_BENCH_ITERATIONS")))
+        ignore_value(virStrToLong_ui(value, NULL, 10, &iterations));
+    if (iterations == 0)
+        iterations = 1;
+
+    /* the run of virTestRun was the first warmup run */
+    for (i = 1; i < warmup; i++) {
+        if (body(data) < 0)
+            return -1;
+    }
+
+    times = g_new0(unsigned long long, iterations);
+
+    if ((start = virTestBenchAllocations()) >= 0)
+        allocs = start;
+
+    for (i = 0; i < iterations; i++) {
+        gint64 then = g_get_monotonic_time();
+
+        if (body(data) < 0)
+            return -1;
+
+        times[i] = g_get_monotonic_time() - then;
+        total += times[i];
+    }
+
+    if (allocs >= 0) {
+        allocs = (virTestBenchAllocations() - allocs) / iterations;
+        allocstr = g_strdup_printf("%lld", allocs);
+    } else {
+        allocstr = g_strdup("null");
+    }
+
+    qsort(times, iterations, sizeof(*times), virTestBenchCompare);
+
+    name = g_strescape(title, NULL);
+    line = g_strdup_printf("{\"name\": \"%s\", \"iterations\": %u, "
+                           "\"mean_us\": %llu, \"min_us\": %llu, "
+                           "\"p50_us\": %llu, \"p90_us\": %llu, "
+                           "\"p99_us\": %llu, \"max_us\": %llu, "
+                           "\"allocs\": %s}\n",
+                           name, iterations, total / iterations, times[0],
+                           times[(iterations - 1) * 50 / 100],
+                           times[(iterations - 1) * 90 / 100],
+                           times[(iterations - 1) * 99 / 100],
+                           times[iterations - 1], allocstr);
+
+    fputs(line, stdout);
+
+    if (output) {
+        FILE *fp;
+
+        if (!(fp = fopen(output, "a"))) {
+            fprintf(stderr, "Cannot open %s: %s\n", output, g_strerror(errno));
+            return -1;
+        }
+
+        fputs(line, fp);
+
+        if (VIR_FCLOSE(fp) < 0) {
+            fprintf(stderr, "Cannot write %s: %s\n", output, g_strerror(errno));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 /**
  * virTestLoadFile:
  * @file: name of the file to load
@@ -1063,6 +1212,25 @@ testCompareDomXML2XMLFiles(virCapsPtr caps G_GNUC_UNUSED,
         goto out;
     }
 
+    /* A copy must not differ from the original, even though it skips the
+     * hypervisor post parse callbacks */
+    if (!live) {
+        g_autoptr(virDomainDef) copy = NULL;
+        g_autofree char *copyXML = NULL;
+
+        if (!(copy = virDomainDefCopy(def, xmlopt, NULL, false)) ||
+            !(copyXML = virDomainDefFormat(copy, xmlopt, format_flags))) {
+            result = TEST_COMPARE_DOM_XML2XML_RESULT_FAIL_FORMAT;
+            goto out;
+        }
+
+        if (virTestCompareToFile(copyXML, outfile) < 0) {
+            VIR_TEST_DEBUG("Copy of %s differs from the original", infile);
+            result = TEST_COMPARE_DOM_XML2XML_RESULT_FAIL_COMPARE;
+            goto out;
+        }
+    }
+
     result = TEST_COMPARE_DOM_XML2XML_RESULT_SUCCESS;
 
  out:
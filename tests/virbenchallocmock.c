@@ -0,0 +1,62 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "internal.h"
+
+/* Counts the heap allocations of the process for virTestBench. The real
+ * allocator can't be looked up with dlsym() as that allocates itself, so
+ * this relies on the entry points glibc exports for its own wrappers. */
+#ifdef __GLIBC__
+
+unsigned long long virBenchAllocMockCount(void);
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static volatile gsize allocations;
+
+void *
+malloc(size_t size)
+{
+    g_atomic_pointer_add(&allocations, 1);
+    return __libc_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+    g_atomic_pointer_add(&allocations, 1);
+    return __libc_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+    if (!ptr)
+        g_atomic_pointer_add(&allocations, 1);
+    return __libc_realloc(ptr, size);
+}
+
+unsigned long long
+virBenchAllocMockCount(void)
+{
+    return g_atomic_pointer_add(&allocations, 0);
+}
+
+#endif /* __GLIBC__ */
@@ -767,6 +767,75 @@ test15(const void *opaque)
 }
 
 
+/* ranges of large bitmaps crossing unit boundaries */
+static int
+test16(const void *opaque G_GNUC_UNUSED)
+{
+    const char *str = "0-63,65,127-129,200-1000,1023-2047,4095";
+    g_autoptr(virBitmap) map = NULL;
+    g_autofree char *formatted = NULL;
+    ssize_t expect[][2] = {
+        { 0, 63 }, { 65, 65 }, { 127, 129 }, { 200, 1000 },
+        { 1023, 2047 }, { 4095, 4095 },
+    };
+    ssize_t start;
+    ssize_t last = -1;
+    size_t count = 0;
+    size_t i = 0;
+
+    if (virBitmapParse(str, &map, 4096) < 0)
+        return -1;
+
+    while ((start = virBitmapNextSetRange(map, last, &last)) >= 0) {
+        if (i >= G_N_ELEMENTS(expect) ||
+            start != expect[i][0] || last != expect[i][1]) {
+            fprintf(stderr, "
+ unexpected range %zd-%zd
+", start, last);
+            return -1;
+        }
+        count += last - start + 1;
+        i++;
+    }
+
+    if (i != G_N_ELEMENTS(expect) || count != virBitmapCountBits(map)) {
+        fprintf(stderr, "
+ expected %zu ranges of %zu bits
+",
+                G_N_ELEMENTS(expect), virBitmapCountBits(map));
+        return -1;
+    }
+
+    if (virBitmapLastSetBit(map) != 4095 ||
+        virBitmapNextClearBit(map, 1023) != 2048)
+        return -1;
+
+    if (!(formatted = virBitmapFormat(map)))
+        return -1;
+
+    if (STRNEQ(formatted, str)) {
+        fprintf(stderr, "
+ expected bitmap '%s' actual '%s'
+",
+                str, formatted);
+        return -1;
+    }
+
+    if (virBitmapClearBit(map, 4095) < 0 ||
+        virBitmapLastSetBit(map) != 2047)
+        return -1;
+
+    virBitmapFree(map);
+    map = NULL;
+
+    /* a range ending past the bitmap is rejected */
+    if (virBitmapParse("4000-4096", &map, 4096) == 0)
+        return -1;
+
+    return 0;
+}
+
+
 #define TESTBINARYOP(A, B, RES, FUNC) \
     testBinaryOpData.a = A; \
     testBinaryOpData.b = B; \
@@ -834,6 +903,9 @@ mymain(void)
     TESTBINARYOP("12345", "0,^0", "12345", test15);
     TESTBINARYOP("0,^0", "0,^0", "0,^0", test15);
 
+    if (virTestRun("test16", test16, NULL) < 0)
+        ret = -1;
+
     return ret;
 }
 
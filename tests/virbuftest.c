@@ -282,6 +282,38 @@ testBufAddStr(const void *opaque)
 }
 
 
+static int
+testBufAsprintf(const void *opaque G_GNUC_UNUSED)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *actual = NULL;
+    g_autoptr(GString) expected = g_string_new(NULL);
+    g_autofree char *longstr = g_strnfill(1000, 'x');
+    size_t i;
+
+    /* alternate between output fitting into the free space of the buffer
+     * and output which needs it to grow */
+    for (i = 0; i < 20; i++) {
+        virBufferAsprintf(&buf, "<a i='%zu'/>\n", i);
+        virBufferAsprintf(&buf, "<b>%s</b>\n", longstr);
+        g_string_append_printf(expected, "<a i='%zu'/>\n<b>%s</b>\n",
+                               i, longstr);
+    }
+
+    if (!(actual = virBufferContentAndReset(&buf))) {
+        VIR_TEST_DEBUG("buf is empty");
+        return -1;
+    }
+
+    if (STRNEQ(actual, expected->str)) {
+        virTestDifference(stderr, expected->str, actual);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 testBufEscapeStr(const void *opaque)
 {
@@ -357,6 +389,40 @@ testBufSetIndent(const void *opaque G_GNUC_UNUSED)
 }
 
 
+static int
+testBufReserve(const void *opaque G_GNUC_UNUSED)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *actual = NULL;
+    const char *expected = "<a>\n  <b/>\n</a>\n";
+
+    virBufferReserve(&buf, 1024);
+    if (virBufferUse(&buf) != 0) {
+        VIR_TEST_DEBUG("reserving space must not add content");
+        return -1;
+    }
+
+    virBufferAddLit(&buf, "<a>\n");
+    virBufferReserve(&buf, 4096);
+    virBufferAdjustIndent(&buf, 2);
+    virBufferAddLit(&buf, "<b/>\n");
+    virBufferAdjustIndent(&buf, -2);
+    virBufferAddLit(&buf, "</a>\n");
+
+    if (!(actual = virBufferContentAndReset(&buf))) {
+        VIR_TEST_DEBUG("buf is empty");
+        return -1;
+    }
+
+    if (STRNEQ(actual, expected)) {
+        virTestDifference(stderr, expected, actual);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 /* Result of this shows up only in valgrind or similar */
 static int
 testBufferAutoclean(const void *opaque G_GNUC_UNUSED)
@@ -385,6 +451,8 @@ mymain(void)
     DO_TEST("AddBuffer", testBufAddBuffer);
     DO_TEST("set indent", testBufSetIndent);
     DO_TEST("autoclean", testBufferAutoclean);
+    DO_TEST("reserve", testBufReserve);
+    DO_TEST("printf", testBufAsprintf);
 
 #define DO_TEST_ADD_STR(_data, _expect) \
     do { \
@@ -413,6 +481,10 @@ mymain(void)
                    "<c>\n  <el>,,&apos;..&apos;,,</el>\n</c>");
     DO_TEST_ESCAPE("\x01\x01\x02\x03\x05\x08",
                    "<c>\n  <el></el>\n</c>");
+    DO_TEST_ESCAPE("no escaping needed\t\r\n\xc5\xbe\x7f",
+                   "<c>\n  <el>no escaping needed\t\r\n\xc5\xbe\x7f</el>\n</c>");
+    DO_TEST_ESCAPE("a<b\x1f&c",
+                   "<c>\n  <el>a&lt;b&amp;c</el>\n</c>");
 
 #define DO_TEST_ESCAPE_REGEX(_data, _expect) \
     do { \
@@ -251,9 +251,11 @@ static int make_controller_v2(const char *path, mode_t mode)
               "usage_usec 0\n"
               "user_usec 0\n"
               "system_usec 0\n"
-              "nr_periods 0\n"
-              "nr_throttled 0\n"
-              "throttled_usec 0\n");
+              "nr_periods 20\n"
+              "nr_throttled 5\n"
+              "throttled_usec 1500\n");
+    MAKE_FILE("cpu.pressure",
+              "some avg10=1.50 avg60=0.75 avg300=0.20 total=123456\n");
     MAKE_FILE("cpu.weight", "100\n");
     MAKE_FILE("memory.current", "1455321088\n");
     MAKE_FILE("memory.high", "max\n");
@@ -795,6 +795,198 @@ static int testCgroupGetMemoryUsage(const void *args G_GNUC_UNUSED)
 }
 
 
+static int testCgroupGetPressure(const void *args G_GNUC_UNUSED)
+{
+    virCgroupPtr cgroup = NULL;
+    int ret = -1;
+    virCgroupPressure some;
+    virCgroupPressure full;
+    bool hasFull;
+    unsigned long long periods;
+    unsigned long long throttled;
+    unsigned long long throttledTime;
+
+    if (virCgroupNewSelf(&cgroup) < 0) {
+        fprintf(stderr, "Cannot create cgroup for self\n");
+        goto cleanup;
+    }
+
+    if (virCgroupGetPressure(cgroup, VIR_CGROUP_PRESSURE_CPU,
+                             &some, &full, &hasFull) != 1) {
+        fprintf(stderr, "Could not retrieve cpu pressure\n");
+        goto cleanup;
+    }
+
+    if (hasFull || some.avg10 != 1.5 || some.avg60 != 0.75 ||
+        some.avg300 != 0.2 || some.total != 123456) {
+        fprintf(stderr, "Wrong cpu pressure\n");
+        goto cleanup;
+    }
+
+    /* no memory.pressure in the mocked cgroupfs */
+    if (virCgroupGetPressure(cgroup, VIR_CGROUP_PRESSURE_MEMORY,
+                             &some, &full, &hasFull) != 0) {
+        fprintf(stderr, "Unexpected memory pressure\n");
+        goto cleanup;
+    }
+
+    if (virCgroupGetCpuThrottleStat(cgroup, &periods, &throttled,
+                                    &throttledTime) < 0) {
+        fprintf(stderr, "Could not retrieve cpu throttling\n");
+        goto cleanup;
+    }
+
+    if (periods != 20 || throttled != 5 || throttledTime != 1500000) {
+        fprintf(stderr, "Wrong cpu throttling %llu %llu %llu\n",
+                periods, throttled, throttledTime);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virCgroupFree(&cgroup);
+    return ret;
+}
+
+
+static int
+testCgroupParsePressure(const void *args G_GNUC_UNUSED)
+{
+    virCgroupPressure some;
+    virCgroupPressure full;
+    bool hasFull;
+    const char *str =
+        "some avg10=0.00 avg60=12.34 avg300=0.01 total=42\n"
+        "full avg10=99.99 avg60=0.00 avg300=0.00 total=18446744073709551615\n";
+
+    if (virCgroupParsePressure(str, "io.pressure", &some, &full, &hasFull) < 0)
+        return -1;
+
+    if (!hasFull || some.avg60 != 12.34 || some.total != 42 ||
+        full.avg10 != 99.99 || full.total != 18446744073709551615ULL) {
+        fprintf(stderr, "Wrong parsed pressure\n");
+        return -1;
+    }
+
+    if (virCgroupParsePressure("full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n",
+                               "io.pressure", &some, &full, &hasFull) == 0 ||
+        virCgroupParsePressure("some avg10=0.00 avg60=0.00 total=0\n",
+                               "io.pressure", &some, &full, &hasFull) == 0) {
+        fprintf(stderr, "Invalid pressure was accepted\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int testCgroupGetCpuacctUsage(const void *args G_GNUC_UNUSED)
+{
+    virCgroupPtr cgroup = NULL;
+    int rv, ret = -1;
+    unsigned long long usage;
+
+    if ((rv = virCgroupNewPartition("/virtualmachines", true,
+                                    (1 << VIR_CGROUP_CONTROLLER_CPU) |
+                                    (1 << VIR_CGROUP_CONTROLLER_CPUACCT),
+                                    &cgroup)) < 0) {
+        fprintf(stderr, "Could not create /virtualmachines cgroup: %d\n", -rv);
+        goto cleanup;
+    }
+
+    if (virCgroupGetCpuacctUsage(cgroup, &usage) < 0) {
+        fprintf(stderr, "Could not retrieve cpuacct usage\n");
+        goto cleanup;
+    }
+
+    if (usage != 2787788855799582ULL) {
+        fprintf(stderr, "Wrong cpuacct usage %llu\n", usage);
+        goto cleanup;
+    }
+
+    /* The stat file is kept open, changes must still show up */
+    if (virCgroupSetValueStr(cgroup, VIR_CGROUP_CONTROLLER_CPUACCT,
+                             "cpuacct.usage", "12345\n") < 0 ||
+        virCgroupGetCpuacctUsage(cgroup, &usage) < 0) {
+        fprintf(stderr, "Could not re-read cpuacct usage\n");
+        goto cleanup;
+    }
+
+    if (usage != 12345 || cgroup->nstatfiles != 1) {
+        fprintf(stderr, "Wrong re-read cpuacct usage %llu\n", usage);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    if (cgroup)
+        ignore_value(virCgroupSetValueStr(cgroup, VIR_CGROUP_CONTROLLER_CPUACCT,
+                                          "cpuacct.usage", "2787788855799582\n"));
+    virCgroupFree(&cgroup);
+    return ret;
+}
+
+
+static int testCgroupBatch(const void *args G_GNUC_UNUSED)
+{
+    virCgroupPtr cgroup = NULL;
+    int rv, ret = -1;
+    unsigned long long shares;
+
+    if ((rv = virCgroupNewPartition("/virtualmachines", true,
+                                    (1 << VIR_CGROUP_CONTROLLER_CPU) |
+                                    (1 << VIR_CGROUP_CONTROLLER_MEMORY),
+                                    &cgroup)) < 0) {
+        fprintf(stderr, "Could not create /virtualmachines cgroup: %d\n", -rv);
+        goto cleanup;
+    }
+
+    virCgroupBatchBegin(cgroup);
+    virCgroupBatchBegin(cgroup);
+
+    if (virCgroupSetCpuShares(cgroup, 2048) < 0 ||
+        virCgroupGetCpuShares(cgroup, &shares) < 0) {
+        fprintf(stderr, "Could not set cpu shares in batch\n");
+        goto cleanup;
+    }
+
+    if (shares != 2048) {
+        fprintf(stderr, "Wrong cpu shares in batch: %llu\n", shares);
+        goto cleanup;
+    }
+
+    virCgroupBatchEnd(cgroup);
+
+    if (cgroup->batch != 1 ||
+        cgroup->batchfds[VIR_CGROUP_CONTROLLER_CPU] < 0) {
+        fprintf(stderr, "Nested batch end closed the directories\n");
+        goto cleanup;
+    }
+
+    virCgroupBatchEnd(cgroup);
+
+    if (cgroup->batch != 0 ||
+        cgroup->batchfds[VIR_CGROUP_CONTROLLER_CPU] != -1) {
+        fprintf(stderr, "Batch end left directories open\n");
+        goto cleanup;
+    }
+
+    if (virCgroupGetCpuShares(cgroup, &shares) < 0 ||
+        shares != 2048) {
+        fprintf(stderr, "Batch write was not persisted\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virCgroupFree(&cgroup);
+    return ret;
+}
+
+
 static int
 testCgroupGetMemoryStat(const void *args G_GNUC_UNUSED)
 {
@@ -1090,6 +1282,15 @@ mymain(void)
 
     if (virTestRun("virCgroupGetPercpuStats works", testCgroupGetPercpuStats, NULL) < 0)
         ret = -1;
+
+    if (virTestRun("virCgroupGetCpuacctUsage works", testCgroupGetCpuacctUsage, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("virCgroupParsePressure works", testCgroupParsePressure, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("virCgroupBatch works", testCgroupBatch, NULL) < 0)
+        ret = -1;
     cleanupFakeFS(fakerootdir);
 
     fakerootdir = initFakeFS(NULL, "all-in-one");
@@ -1113,6 +1314,8 @@ mymain(void)
         ret = -1;
     if (virTestRun("Cgroup available (unified)", testCgroupAvailable, (void*)0x1) < 0)
         ret = -1;
+    if (virTestRun("virCgroupGetPressure works (unified)", testCgroupGetPressure, NULL) < 0)
+        ret = -1;
     cleanupFakeFS(fakerootdir);
 
     /* cgroup hybrid */
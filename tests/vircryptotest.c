@@ -76,6 +76,8 @@ testCryptoEncrypt(const void *opaque)
     size_t ivlen = 16;
     uint8_t *ciphertext = NULL;
     size_t ciphertextlen = 0;
+    uint8_t *plaintext = NULL;
+    size_t plaintextlen = 0;
     int ret = -1;
 
     if (!virCryptoHaveCipher(data->algorithm)) {
@@ -109,11 +111,23 @@ testCryptoEncrypt(const void *opaque)
         goto cleanup;
     }
 
+    if (virCryptoDecryptData(data->algorithm, enckey, enckeylen, iv, ivlen,
+                             ciphertext, ciphertextlen,
+                             &plaintext, &plaintextlen) < 0)
+        goto cleanup;
+
+    if (data->inputlen != plaintextlen ||
+        memcmp(data->input, plaintext, plaintextlen)) {
+        fprintf(stderr, "Decrypted data doesn't match the input\n");
+        goto cleanup;
+    }
+
     ret = 0;
  cleanup:
     VIR_FREE(enckey);
     VIR_FREE(iv);
     VIR_FREE(ciphertext);
+    VIR_FREE(plaintext);
 
     return ret;
 }
@@ -52,6 +52,14 @@ VIR_MOCK_STUB_RET_ARGS(dbus_message_set_reply_serial,
                        dbus_uint32_t, serial)
 
 
+VIR_MOCK_STUB_RET_ARGS(dbus_connection_send_with_reply,
+                       dbus_bool_t, 1,
+                       DBusConnection *, connection,
+                       DBusMessage *, message,
+                       DBusPendingCall **, pending_return,
+                       int, timeout_milliseconds)
+
+
 VIR_MOCK_LINK_RET_ARGS(dbus_connection_send_with_reply_and_block,
                        DBusMessage *,
                        DBusConnection *, connection,
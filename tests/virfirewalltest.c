@@ -190,6 +190,8 @@ VIR_MOCK_WRAP_RET_ARGS(dbus_connection_send_with_reply_and_block,
 }
 # endif
 
+static bool testFirewallBatchFail;
+
 struct testFirewallData {
     virFirewallBackend tryBackend;
     virFirewallBackend expectBackend;
@@ -1040,6 +1042,122 @@ testFirewallQuery(const void *opaque G_GNUC_UNUSED)
     return ret;
 }
 
+static void
+testFirewallBatchHook(const char *const*args,
+                      const char *const*env G_GNUC_UNUSED,
+                      const char *input,
+                      char **output G_GNUC_UNUSED,
+                      char **error G_GNUC_UNUSED,
+                      int *status,
+                      void *opaque)
+{
+    virBufferPtr buf = opaque;
+
+    if (input)
+        virBufferAdd(buf, input, -1);
+
+    /* Fake failure of the restore command if asked to */
+    if (STREQ(args[0], IPTABLES_RESTORE_PATH) && testFirewallBatchFail)
+        *status = 1;
+}
+
+static int
+testFirewallBatchImpl(bool fail)
+{
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virFirewall) fw = virFirewallNew();
+    int ret = -1;
+    const char *actual = NULL;
+    const char *expected =
+        IPTABLES_RESTORE_PATH " --noflush\n"
+        "*filter\n"
+        "-A INPUT --source-host 192.168.122.1 --jump ACCEPT\n"
+        "-A INPUT --source-host !192.168.122.1 --jump REJECT\n"
+        "COMMIT\n"
+        IPTABLES_RESTORE_PATH " --noflush\n"
+        "*nat\n"
+        "-A POSTROUTING -m comment --comment \"libvirt \\\"nat\\\" rule\" "
+        "--jump MASQUERADE\n"
+        "-A POSTROUTING --jump RETURN\n"
+        "COMMIT\n"
+        EBTABLES_PATH " -A FORWARD --jump DROP\n";
+    const char *expectedFail =
+        IPTABLES_RESTORE_PATH " --noflush\n"
+        "*filter\n"
+        "-A INPUT --source-host 192.168.122.1 --jump ACCEPT\n"
+        "-A INPUT --source-host !192.168.122.1 --jump REJECT\n"
+        "COMMIT\n"
+        IPTABLES_PATH " -A INPUT --source-host 192.168.122.1 --jump ACCEPT\n"
+        IPTABLES_PATH " -A INPUT --source-host '!192.168.122.1' --jump REJECT\n"
+        IPTABLES_PATH " -t nat -A POSTROUTING -m comment --comment "
+        "'libvirt \"nat\" rule' --jump MASQUERADE\n"
+        IPTABLES_PATH " -t nat -A POSTROUTING --jump RETURN\n"
+        EBTABLES_PATH " -A FORWARD --jump DROP\n";
+
+    if (virFirewallSetBackend(VIR_FIREWALL_BACKEND_DIRECT) < 0)
+        goto cleanup;
+
+    testFirewallBatchFail = fail;
+    virCommandSetDryRun(&cmdbuf, testFirewallBatchHook, &cmdbuf);
+
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_BATCH);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-A", "INPUT",
+                       "--source-host", "192.168.122.1",
+                       "--jump", "ACCEPT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-A", "INPUT",
+                       "--source-host", "!192.168.122.1",
+                       "--jump", "REJECT", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-t", "nat", "-A", "POSTROUTING",
+                       "-m", "comment", "--comment", "libvirt \"nat\" rule",
+                       "--jump", "MASQUERADE", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_IPV4,
+                       "-t", "nat", "-A", "POSTROUTING",
+                       "--jump", "RETURN", NULL);
+
+    virFirewallAddRule(fw, VIR_FIREWALL_LAYER_ETHERNET,
+                       "-A", "FORWARD",
+                       "--jump", "DROP", NULL);
+
+    if (virFirewallApply(fw) < 0)
+        goto cleanup;
+
+    actual = virBufferCurrentContent(&cmdbuf);
+
+    if (fail)
+        expected = expectedFail;
+
+    if (STRNEQ_NULLABLE(expected, actual)) {
+        fprintf(stderr, "Unexpected command execution\n");
+        virTestDifference(stderr, expected, actual);
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    testFirewallBatchFail = false;
+    virCommandSetDryRun(NULL, NULL, NULL);
+    return ret;
+}
+
+static int
+testFirewallBatch(const void *opaque G_GNUC_UNUSED)
+{
+    return testFirewallBatchImpl(false);
+}
+
+static int
+testFirewallBatchFallback(const void *opaque G_GNUC_UNUSED)
+{
+    return testFirewallBatchImpl(true);
+}
+
 static bool
 hasNetfilterTools(void)
 {
@@ -1109,6 +1227,8 @@ mymain(void)
     RUN_TEST("many rollback", testFirewallManyRollback);
     RUN_TEST("chained rollback", testFirewallChainedRollback);
     RUN_TEST("query transaction", testFirewallQuery);
+    RUN_TEST_DIRECT("batch transaction", testFirewallBatch);
+    RUN_TEST_DIRECT("batch transaction fallback", testFirewallBatchFallback);
 
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
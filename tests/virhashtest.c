@@ -9,6 +9,7 @@
 #include "viralloc.h"
 #include "virlog.h"
 #include "virstring.h"
+#include "virobject.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -23,8 +24,8 @@ testHashInit(int size)
     if (!(hash = virHashCreate(size, NULL)))
         return NULL;
 
-    /* entries are added in reverse order so that they will be linked in
-     * collision list in the same order as in the uuids array
+    /* entries are added in reverse order so that colliding entries are
+     * probed in the same order as in the uuids array
      */
     for (i = G_N_ELEMENTS(uuids) - 1; i >= 0; i--) {
         ssize_t oldsize = virHashTableSize(hash);
@@ -532,6 +533,201 @@ testHashDuplicate(const void *data G_GNUC_UNUSED)
 }
 
 
+static char **
+testHashBenchKeys(size_t count)
+{
+    char **keys = g_new0(char *, count + 1);
+    size_t i;
+
+    for (i = 0; i < count; i++)
+        keys[i] = g_strdup_printf("%08zx-bench-%zu", i * 2654435761U, i);
+
+    return keys;
+}
+
+
+static int
+testHashBenchInsert(const void *data)
+{
+    const struct testInfo *info = data;
+    g_auto(GStrv) keys = NULL;
+    virHashTablePtr hash;
+    gint64 start;
+    gint64 elapsed;
+    size_t i;
+    int ret = -1;
+
+    if (info->count > 10000 && virTestGetExpensive() == 0)
+        return EXIT_AM_SKIP;
+
+    keys = testHashBenchKeys(info->count);
+
+    if (!(hash = virHashNew(NULL)))
+        return -1;
+
+    start = g_get_monotonic_time();
+    for (i = 0; i < info->count; i++) {
+        if (virHashAddEntry(hash, keys[i], keys[i]) < 0)
+            goto cleanup;
+    }
+    elapsed = g_get_monotonic_time() - start;
+
+    VIR_TEST_DEBUG("inserted %zu entries in %lld us (%zd slots)",
+                   info->count, (long long)elapsed, virHashTableSize(hash));
+
+    if (testHashCheckCount(hash, info->count) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virHashFree(hash);
+    return ret;
+}
+
+
+static int
+testHashBenchLookup(const void *data)
+{
+    const struct testInfo *info = data;
+    g_auto(GStrv) keys = NULL;
+    g_auto(GStrv) missing = NULL;
+    virHashTablePtr hash;
+    gint64 start;
+    gint64 elapsed;
+    size_t i;
+    size_t j;
+    int ret = -1;
+
+    if (info->count > 10000 && virTestGetExpensive() == 0)
+        return EXIT_AM_SKIP;
+
+    keys = testHashBenchKeys(info->count);
+    missing = testHashBenchKeys(info->count * 2);
+
+    if (!(hash = virHashNew(NULL)))
+        return -1;
+
+    for (i = 0; i < info->count; i++) {
+        if (virHashAddEntry(hash, keys[i], keys[i]) < 0)
+            goto cleanup;
+    }
+
+    start = g_get_monotonic_time();
+    for (j = 0; j < 10; j++) {
+        for (i = 0; i < info->count; i++) {
+            if (virHashLookup(hash, keys[i]) != keys[i]) {
+                VIR_TEST_VERBOSE("\nentry \"%s\" could not be found", keys[i]);
+                goto cleanup;
+            }
+        }
+    }
+    elapsed = g_get_monotonic_time() - start;
+
+    VIR_TEST_DEBUG("%zu successful lookups in %lld us",
+                   info->count * 10, (long long)elapsed);
+
+    start = g_get_monotonic_time();
+    for (j = 0; j < 10; j++) {
+        for (i = info->count; i < info->count * 2; i++) {
+            if (virHashLookup(hash, missing[i])) {
+                VIR_TEST_VERBOSE("\nentry \"%s\" unexpectedly found",
+                                 missing[i]);
+                goto cleanup;
+            }
+        }
+    }
+    elapsed = g_get_monotonic_time() - start;
+
+    VIR_TEST_DEBUG("%zu failed lookups in %lld us",
+                   info->count * 10, (long long)elapsed);
+
+    ret = 0;
+
+ cleanup:
+    virHashFree(hash);
+    return ret;
+}
+
+
+static int
+testHashSharded(const void *data G_GNUC_UNUSED)
+{
+    virHashShardedPtr hash;
+    virHashTablePtr table;
+    size_t count = 0;
+    size_t i;
+    int ret = -1;
+
+    if (!(hash = virHashShardedNew(0, NULL)))
+        return -1;
+
+    for (i = 0; i < G_N_ELEMENTS(uuids); i++) {
+        if (virHashShardedAddEntry(hash, uuids[i], (void *) uuids[i]) < 0) {
+            VIR_TEST_VERBOSE("\nentry \"%s\" could not be added", uuids[i]);
+            goto cleanup;
+        }
+    }
+
+    if (virHashShardedAddEntry(hash, uuids[0], NULL) >= 0) {
+        VIR_TEST_VERBOSE("\nadding of duplicate key should have failed");
+        goto cleanup;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(uuids_subset); i++) {
+        if (virHashShardedSteal(hash, uuids_subset[i]) != uuids_subset[i]) {
+            VIR_TEST_VERBOSE("\nentry \"%s\" could not be stolen",
+                             uuids_subset[i]);
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(uuids_new); i++) {
+        if (virHashShardedUpdate(hash, uuids_new[i], (void *) uuids_new[i]) < 0) {
+            VIR_TEST_VERBOSE("\nentry \"%s\" could not be updated",
+                             uuids_new[i]);
+            goto cleanup;
+        }
+    }
+
+    table = virHashShardedLockKey(hash, uuids_new[0]);
+    if (virHashLookup(table, uuids_new[0]) != uuids_new[0]) {
+        VIR_TEST_VERBOSE("\nentry \"%s\" not in its shard", uuids_new[0]);
+        virHashShardedUnlockKey(hash, uuids_new[0]);
+        goto cleanup;
+    }
+    virHashShardedUnlockKey(hash, uuids_new[0]);
+
+    count = G_N_ELEMENTS(uuids) - G_N_ELEMENTS(uuids_subset) +
+            G_N_ELEMENTS(uuids_new);
+    if (virHashShardedSize(hash) != count) {
+        VIR_TEST_VERBOSE("\nhash contains %zd instead of %zu elements",
+                         virHashShardedSize(hash), count);
+        goto cleanup;
+    }
+
+    count = 0;
+    virHashShardedForEach(hash, testHashCheckForEachCount, &count);
+    if (virHashShardedSize(hash) != count) {
+        VIR_TEST_VERBOSE("\nhash claims to have %zd elements but iteration "
+                         "finds %zu", virHashShardedSize(hash), count);
+        goto cleanup;
+    }
+
+    if (virHashShardedHasEntry(hash, uuids_subset[0]) ||
+        !virHashShardedHasEntry(hash, uuids_new[0])) {
+        VIR_TEST_VERBOSE("\nunexpected entries in hash");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virObjectUnref(hash);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -569,6 +765,11 @@ mymain(void)
     DO_TEST("GetItems", GetItems);
     DO_TEST("Equal", Equal);
     DO_TEST("Duplicate entry", Duplicate);
+    DO_TEST("Sharded", Sharded);
+    DO_TEST_COUNT("Benchmark insert", BenchInsert, 1000);
+    DO_TEST_COUNT("Benchmark insert", BenchInsert, 100000);
+    DO_TEST_COUNT("Benchmark lookup", BenchLookup, 1000);
+    DO_TEST_COUNT("Benchmark lookup", BenchLookup, 100000);
 
     return (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -160,6 +160,58 @@ linuxCPUStatsCompareFiles(const char *cpustatfile,
 }
 
 
+static int
+linuxCPUStatsAllCompareFiles(const char *cpustatfile,
+                             size_t ncpus,
+                             const char *outfile)
+{
+    g_autofree char *procstat = NULL;
+    g_autofree char *actualData = NULL;
+    g_autofree virHostCPUTimePtr times = NULL;
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    size_t ntimes = 0;
+    size_t i;
+
+    if (virTestLoadFile(cpustatfile, &procstat) < 0)
+        return -1;
+
+    if (virHostCPUParseStatsLinux(procstat, &times, &ntimes) < 0)
+        return -1;
+
+    if (ntimes != ncpus + 1) {
+        fprintf(stderr, "Expected %zu CPUs, got %zu\n", ncpus, ntimes - 1);
+        return -1;
+    }
+
+    for (i = 0; i < ntimes; i++) {
+        virNodeCPUStats params[4];
+        int nparams = G_N_ELEMENTS(params);
+
+        if (times[i].cpu != (i == 0 ? VIR_NODE_CPU_STATS_ALL_CPUS : i - 1)) {
+            fprintf(stderr, "Unexpected CPU %d at %zu\n", times[i].cpu, i);
+            return -1;
+        }
+
+        if (virHostCPUStatsAssign(&params[0], VIR_NODE_CPU_STATS_KERNEL,
+                                  times[i].kernel) < 0 ||
+            virHostCPUStatsAssign(&params[1], VIR_NODE_CPU_STATS_USER,
+                                  times[i].user) < 0 ||
+            virHostCPUStatsAssign(&params[2], VIR_NODE_CPU_STATS_IDLE,
+                                  times[i].idle) < 0 ||
+            virHostCPUStatsAssign(&params[3], VIR_NODE_CPU_STATS_IOWAIT,
+                                  times[i].iowait) < 0)
+            return -1;
+
+        if (linuxCPUStatsToBuf(&buf, times[i].cpu, params, nparams) < 0)
+            return -1;
+    }
+
+    actualData = virBufferContentAndReset(&buf);
+
+    return virTestCompareToFile(actualData, outfile);
+}
+
+
 struct linuxTestHostCPUData {
     const char *testName;
     virArch arch;
@@ -247,6 +299,10 @@ linuxTestNodeCPUStats(const void *data)
     result = linuxCPUStatsCompareFiles(cpustatfile,
                                        testData->ncpus,
                                        outfile);
+    if (result == 0)
+        result = linuxCPUStatsAllCompareFiles(cpustatfile,
+                                              testData->ncpus,
+                                              outfile);
     if (result < 0) {
         if (testData->shouldFail) {
             /* Expected error */
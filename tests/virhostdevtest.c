@@ -110,6 +110,8 @@ myCleanup(void)
         virObjectUnref(mgr->activePCIHostdevs);
         virObjectUnref(mgr->activeUSBHostdevs);
         virObjectUnref(mgr->inactivePCIHostdevs);
+        virObjectUnref(mgr->pooledPCIHostdevs);
+        virObjectUnref(mgr->readyPCIHostdevs);
         virObjectUnref(mgr->activeSCSIHostdevs);
         virObjectUnref(mgr->activeNVMeHostdevs);
         VIR_FREE(mgr->stateDir);
@@ -157,6 +159,10 @@ myInit(void)
         goto cleanup;
     if ((mgr->inactivePCIHostdevs = virPCIDeviceListNew()) == NULL)
         goto cleanup;
+    if ((mgr->pooledPCIHostdevs = virPCIDeviceListNew()) == NULL)
+        goto cleanup;
+    if ((mgr->readyPCIHostdevs = virPCIDeviceListNew()) == NULL)
+        goto cleanup;
     if ((mgr->activeSCSIHostdevs = virSCSIDeviceListNew()) == NULL)
         goto cleanup;
     if ((mgr->activeNVMeHostdevs = virNVMeDeviceListNew()) == NULL)
@@ -583,6 +589,63 @@ testNVMeDiskRoundtrip(const void *opaque G_GNUC_UNUSED)
     return 0;
 }
 
+/**
+ * testVirHostdevRoundtripPooled:
+ * @opaque: unused
+ *
+ * Perform a roundtrip with managed devices from the VFIO pool.
+ *
+ *   1. Put devices into the pool
+ *   2. Attach devices to the guest as managed
+ *   3. Detach devices from the guest as managed
+ *   4. Empty the pool
+ */
+static int
+testVirHostdevRoundtripPooled(const void *opaque G_GNUC_UNUSED)
+{
+    g_auto(GStrv) addrs = NULL;
+    size_t i;
+
+    addrs = g_strsplit("0000:00:01.0,0000:00:02.0,0000:00:03.0", ",", 0);
+
+    for (i = 0; i < nhostdevs; i++)
+        hostdevs[i]->managed = true;
+
+    CHECK_PCI_LIST_COUNT(mgr->activePCIHostdevs, 0);
+    CHECK_PCI_LIST_COUNT(mgr->inactivePCIHostdevs, 0);
+
+    VIR_TEST_DEBUG("Test: fill the pool");
+    if (virHostdevManagerSetPCIPool(mgr, addrs) < 0)
+        return -1;
+    CHECK_PCI_LIST_COUNT(mgr->pooledPCIHostdevs, nhostdevs);
+    CHECK_PCI_LIST_COUNT(mgr->readyPCIHostdevs, nhostdevs);
+    CHECK_PCI_LIST_COUNT(mgr->inactivePCIHostdevs, nhostdevs);
+
+    VIR_TEST_DEBUG("Test: claim pooled devices");
+    if (virHostdevPreparePCIDevices(mgr, drv_name, dom_name, uuid,
+                                    hostdevs, nhostdevs, 0) < 0)
+        return -1;
+    CHECK_PCI_LIST_COUNT(mgr->activePCIHostdevs, nhostdevs);
+    CHECK_PCI_LIST_COUNT(mgr->inactivePCIHostdevs, 0);
+    CHECK_PCI_LIST_COUNT(mgr->readyPCIHostdevs, 0);
+
+    VIR_TEST_DEBUG("Test: release pooled devices");
+    virHostdevReAttachPCIDevices(mgr, drv_name, dom_name,
+                                 hostdevs, nhostdevs, NULL);
+    CHECK_PCI_LIST_COUNT(mgr->activePCIHostdevs, 0);
+    CHECK_PCI_LIST_COUNT(mgr->inactivePCIHostdevs, nhostdevs);
+    CHECK_PCI_LIST_COUNT(mgr->readyPCIHostdevs, nhostdevs);
+
+    VIR_TEST_DEBUG("Test: empty the pool");
+    if (virHostdevManagerSetPCIPool(mgr, NULL) < 0)
+        return -1;
+    CHECK_PCI_LIST_COUNT(mgr->pooledPCIHostdevs, 0);
+    CHECK_PCI_LIST_COUNT(mgr->readyPCIHostdevs, 0);
+    CHECK_PCI_LIST_COUNT(mgr->inactivePCIHostdevs, 0);
+
+    return 0;
+}
+
 
 # define FAKEROOTDIRTEMPLATE abs_builddir "/fakerootdir-XXXXXX"
 
@@ -619,6 +682,7 @@ mymain(void)
     DO_TEST(testVirHostdevRoundtripMixed);
     DO_TEST(testVirHostdevOther);
     DO_TEST(testNVMeDiskRoundtrip);
+    DO_TEST(testVirHostdevRoundtripPooled);
 
     myCleanup();
 
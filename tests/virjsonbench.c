@@ -0,0 +1,141 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "internal.h"
+#include "virjson.h"
+#include "virstring.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+/* The QMP replies of the qemumonitorjson corpus and their parsed values */
+static char **replies;
+static virJSONValuePtr *values;
+static size_t nvalues;
+
+
+static int
+testBenchLoadCorpus(const char *dirname)
+{
+    DIR *dir = NULL;
+    struct dirent *ent;
+    int rc;
+
+    if (virDirOpen(&dir, dirname) < 0)
+        return -1;
+
+    while ((rc = virDirRead(dir, &ent, dirname)) > 0) {
+        g_autofree char *path = NULL;
+        g_autofree char *reply = NULL;
+        virJSONValuePtr value;
+
+        if (!virStringHasSuffix(ent->d_name, ".json"))
+            continue;
+
+        path = g_strdup_printf("%s/%s", dirname, ent->d_name);
+
+        if (virTestLoadFile(path, &reply) < 0 ||
+            !(value = virJSONValueFromString(reply))) {
+            rc = -1;
+            break;
+        }
+
+        replies = g_renew(char *, replies, nvalues + 1);
+        values = g_renew(virJSONValuePtr, values, nvalues + 1);
+        replies[nvalues] = g_steal_pointer(&reply);
+        values[nvalues] = value;
+        nvalues++;
+    }
+
+    VIR_DIR_CLOSE(dir);
+
+    return rc;
+}
+
+
+static int
+testBenchParse(const void *opaque G_GNUC_UNUSED)
+{
+    size_t i;
+
+    for (i = 0; i < nvalues; i++) {
+        virJSONValuePtr value;
+
+        if (!(value = virJSONValueFromString(replies[i])))
+            return -1;
+
+        virJSONValueFree(value);
+    }
+
+    return 0;
+}
+
+
+static int
+testBenchFormat(const void *opaque)
+{
+    bool pretty = !!opaque;
+    size_t i;
+
+    for (i = 0; i < nvalues; i++) {
+        g_autofree char *str = NULL;
+
+        if (!(str = virJSONValueToString(values[i], pretty)))
+            return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+    size_t i;
+
+    if (testBenchLoadCorpus(abs_srcdir "/qemumonitorjsondata") < 0)
+        return EXIT_FAILURE;
+
+    if (virTestBench("virJSONValueFromString qemumonitorjsondata",
+                     testBenchParse, NULL) < 0)
+        ret = -1;
+
+    if (virTestBench("virJSONValueToString qemumonitorjsondata",
+                     testBenchFormat, NULL) < 0)
+        ret = -1;
+
+    if (virTestBench("virJSONValueToString pretty qemumonitorjsondata",
+                     testBenchFormat, (void *)1) < 0)
+        ret = -1;
+
+    for (i = 0; i < nvalues; i++) {
+        virJSONValueFree(values[i]);
+        g_free(replies[i]);
+    }
+    g_free(values);
+    g_free(replies);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#ifdef __linux__
+VIR_TEST_MAIN_PRELOAD(mymain, VIR_TEST_MOCK("virbenchalloc"))
+#else
+VIR_TEST_MAIN(mymain)
+#endif
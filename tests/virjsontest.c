@@ -470,6 +470,247 @@ testJSONObjectFormatSteal(const void *opaque G_GNUC_UNUSED)
 }
 
 
+static int
+testJSONLargeObject(const void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virJSONValue) json = virJSONValueNewObject();
+    g_autoptr(virJSONValue) removed = NULL;
+    g_autofree char *str = NULL;
+    unsigned long long val;
+    size_t nkeys = 100;
+    size_t i;
+
+    for (i = 0; i < nkeys; i++) {
+        g_autofree char *key = g_strdup_printf("key%zu", i);
+
+        if (virJSONValueObjectAppendNumberUlong(json, key, i) < 0)
+            return -1;
+    }
+
+    if (virJSONValueObjectAppendNumberUlong(json, "key42", 42) == 0) {
+        VIR_TEST_VERBOSE("duplicate key was not rejected");
+        return -1;
+    }
+
+    for (i = 0; i < nkeys; i++) {
+        g_autofree char *key = g_strdup_printf("key%zu", i);
+
+        if (virJSONValueObjectGetNumberUlong(json, key, &val) < 0 ||
+            val != i) {
+            VIR_TEST_VERBOSE("lookup of '%s' failed", key);
+            return -1;
+        }
+    }
+
+    if (virJSONValueObjectHasKey(json, "nope") != 0) {
+        VIR_TEST_VERBOSE("lookup of missing key succeeded");
+        return -1;
+    }
+
+    if (virJSONValueObjectRemoveKey(json, "key10", &removed) != 1 ||
+        virJSONValueObjectHasKey(json, "key10") != 0) {
+        VIR_TEST_VERBOSE("removal of 'key10' failed");
+        return -1;
+    }
+
+    if (virJSONValueObjectPrependString(json, "first", "value") < 0 ||
+        virJSONValueObjectAppendString(json, "last", "value") < 0)
+        return -1;
+
+    if (STRNEQ_NULLABLE(virJSONValueObjectGetKey(json, 0), "first") ||
+        STRNEQ_NULLABLE(virJSONValueObjectGetKey(json, nkeys), "last") ||
+        !virJSONValueObjectGetString(json, "last") ||
+        virJSONValueObjectGetNumberUlong(json, "key99", &val) < 0 ||
+        val != 99) {
+        VIR_TEST_VERBOSE("unexpected object layout after prepend/append");
+        return -1;
+    }
+
+    if (!(str = virJSONValueToString(json, false)) ||
+        !STRPREFIX(str, "{\"first\":\"value\",\"key0\":0,\"key1\":1,")) {
+        VIR_TEST_VERBOSE("unexpected member order: '%s'", NULLSTR(str));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testJSONArena(const void *opaque G_GNUC_UNUSED)
+{
+    const char *doc = "{\"return\": [{\"node-name\": \"a\", \"size\": 1},"
+                      "{\"node-name\": \"b\", \"size\": 2}],"
+                      "\"id\": \"libvirt-1\"}";
+    g_autoptr(virJSONValue) reply = NULL;
+    g_autoptr(virJSONValue) nodes = NULL;
+    g_autoptr(virJSONValue) copy = NULL;
+    g_autofree char *actual = NULL;
+    virJSONValuePtr node;
+    unsigned long long size;
+
+    if (!(reply = virJSONValueFromStringArena(doc)))
+        return -1;
+
+    if (STRNEQ_NULLABLE(virJSONValueObjectGetString(reply, "id"), "libvirt-1")) {
+        VIR_TEST_VERBOSE("failed to look up 'id' in arena document");
+        return -1;
+    }
+
+    if (virJSONValueObjectAppendString(reply, "extra", "value") < 0 ||
+        virJSONValueObjectRemoveKey(reply, "id", NULL) != 1)
+        return -1;
+
+    if (!(copy = virJSONValueCopy(reply)))
+        return -1;
+
+    /* stolen values must outlive the document */
+    if (!(nodes = virJSONValueObjectStealArray(reply, "return")))
+        return -1;
+
+    virJSONValueFree(g_steal_pointer(&reply));
+
+    if (virJSONValueArraySize(nodes) != 2 ||
+        !(node = virJSONValueArrayGet(nodes, 1)) ||
+        STRNEQ_NULLABLE(virJSONValueObjectGetString(node, "node-name"), "b") ||
+        virJSONValueObjectGetNumberUlong(node, "size", &size) < 0 ||
+        size != 2) {
+        VIR_TEST_VERBOSE("unexpected contents of stolen array");
+        return -1;
+    }
+
+    if (!(actual = virJSONValueToString(copy, false)))
+        return -1;
+
+    if (STRNEQ(actual,
+               "{\"return\":[{\"node-name\":\"a\",\"size\":1},"
+               "{\"node-name\":\"b\",\"size\":2}],\"extra\":\"value\"}")) {
+        VIR_TEST_VERBOSE("unexpected copy of arena document: '%s'", actual);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+struct testJSONStreamData {
+    virBuffer buf;
+    virJSONValuePtr captured;
+};
+
+
+static int
+testJSONStreamCallback(virJSONStreamParserPtr parser,
+                       virJSONStreamEvent event,
+                       const char *key,
+                       const char *str,
+                       size_t len,
+                       void *opaque)
+{
+    struct testJSONStreamData *data = opaque;
+
+    virBufferAsprintf(&data->buf, "%zu:", virJSONStreamParserGetDepth(parser));
+    if (key)
+        virBufferAsprintf(&data->buf, "%s=", key);
+
+    switch (event) {
+    case VIR_JSON_STREAM_EVENT_NULL:
+    case VIR_JSON_STREAM_EVENT_BOOLEAN:
+    case VIR_JSON_STREAM_EVENT_NUMBER:
+    case VIR_JSON_STREAM_EVENT_STRING:
+        virBufferAdd(&data->buf, str, len);
+        break;
+    case VIR_JSON_STREAM_EVENT_OBJECT_START:
+        virBufferAddLit(&data->buf, "{");
+        break;
+    case VIR_JSON_STREAM_EVENT_OBJECT_END:
+        virBufferAddLit(&data->buf, "}");
+        break;
+    case VIR_JSON_STREAM_EVENT_ARRAY_START:
+        virBufferAddLit(&data->buf, "[");
+        break;
+    case VIR_JSON_STREAM_EVENT_ARRAY_END:
+        virBufferAddLit(&data->buf, "]");
+        break;
+    case VIR_JSON_STREAM_EVENT_VALUE:
+        virBufferAddLit(&data->buf, "value");
+        data->captured = virJSONStreamParserStealValue(parser);
+        break;
+    }
+    virBufferAddLit(&data->buf, " ");
+
+    if (STREQ_NULLABLE(key, "skip"))
+        return VIR_JSON_STREAM_SKIP;
+
+    if (STREQ_NULLABLE(key, "capture") && event != VIR_JSON_STREAM_EVENT_VALUE)
+        return VIR_JSON_STREAM_CAPTURE;
+
+    return VIR_JSON_STREAM_CONTINUE;
+}
+
+
+static int
+testJSONStream(const void *opaque G_GNUC_UNUSED)
+{
+    const char *doc = "{\"a\": [1, \"two\", null, true],"
+                      "\"skip\": {\"b\": [3, {\"c\": 4}]},"
+                      "\"capture\": {\"d\": [5, 6]},"
+                      "\"e\": {}}";
+    const char *expect = "0:{ 1:a=[ 2:1 2:two 2:null 2:true 1:] "
+                         "1:skip={ 1:capture={ 1:capture=value "
+                         "1:e={ 1:} 0:} ";
+    struct testJSONStreamData data = { VIR_BUFFER_INITIALIZER, NULL };
+    g_autoptr(virJSONStreamParser) parser = NULL;
+    g_autoptr(virJSONValue) captured = NULL;
+    g_autofree char *actual = NULL;
+    g_autofree char *value = NULL;
+    size_t i;
+
+    if (!(parser = virJSONStreamParserNew(testJSONStreamCallback, &data)))
+        return -1;
+
+    /* feed the document in small chunks to test splitting of tokens */
+    for (i = 0; i < strlen(doc); i += 3) {
+        if (virJSONStreamParserFeed(parser, doc + i,
+                                    MIN(3, strlen(doc) - i)) < 0)
+            goto error;
+    }
+
+    if (virJSONStreamParserFinish(parser) < 0)
+        goto error;
+
+    captured = g_steal_pointer(&data.captured);
+    actual = virBufferContentAndReset(&data.buf);
+
+    if (STRNEQ_NULLABLE(actual, expect)) {
+        virTestDifference(stderr, expect, actual);
+        return -1;
+    }
+
+    if (!captured || !(value = virJSONValueToString(captured, false)))
+        return -1;
+
+    if (STRNEQ(value, "{\"d\":[5,6]}")) {
+        VIR_TEST_VERBOSE("unexpected captured value '%s'", value);
+        return -1;
+    }
+
+    if (virJSONStreamParse("{\"a\": [}", testJSONStreamCallback, &data) == 0) {
+        VIR_TEST_VERBOSE("malformed document was accepted");
+        goto error;
+    }
+
+    virBufferFreeAndReset(&data.buf);
+    virJSONValueFree(data.captured);
+    return 0;
+
+ error:
+    virBufferFreeAndReset(&data.buf);
+    virJSONValueFree(data.captured);
+    return -1;
+}
+
+
 static int
 mymain(void)
 {
@@ -593,6 +834,9 @@ mymain(void)
                  NULL, true);
     DO_TEST_FULL("create object with nested json in attribute", EscapeObj,
                  NULL, NULL, true);
+    DO_TEST_FULL("large object with hashed keys", LargeObject, NULL, NULL, true);
+    DO_TEST_FULL("arena document", Arena, NULL, NULL, true);
+    DO_TEST_FULL("stream parser", Stream, NULL, NULL, true);
     DO_TEST_FULL("stealing of attributes while creating objects",
                  ObjectFormatSteal, NULL, NULL, true);
 
@@ -30,6 +30,47 @@ struct _InterfaceParseStatsData {
 };
 
 
+typedef struct _InterfaceParseStatsTableData InterfaceParseStatsTableData;
+struct _InterfaceParseStatsTableData {
+    const char *filename;
+    const char *ifname;
+    int ret; /* expected result of the lookup */
+    const virDomainInterfaceStatsStruct stats;
+};
+
+
+static int
+testInterfaceCompareStats(const virDomainInterfaceStatsStruct *expected,
+                          const virDomainInterfaceStatsStruct *actual)
+{
+    if (memcmp(actual, expected, sizeof(*actual)) != 0) {
+        fprintf(stderr,
+                "Expected stats: %lld %lld %lld %lld %lld %lld %lld %lld\n"
+                "Actual stats: %lld %lld %lld %lld %lld %lld %lld %lld",
+                expected->rx_bytes,
+                expected->rx_packets,
+                expected->rx_errs,
+                expected->rx_drop,
+                expected->tx_bytes,
+                expected->tx_packets,
+                expected->tx_errs,
+                expected->tx_drop,
+                actual->rx_bytes,
+                actual->rx_packets,
+                actual->rx_errs,
+                actual->rx_drop,
+                actual->tx_bytes,
+                actual->tx_packets,
+                actual->tx_errs,
+                actual->tx_drop);
+
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 testInterfaceParseStats(const void *opaque)
 {
@@ -47,31 +88,42 @@ testInterfaceParseStats(const void *opaque)
     if (virNetDevOpenvswitchInterfaceParseStats(buf, &actual) < 0)
         return -1;
 
-    if (memcmp(&actual, &data->stats, sizeof(actual)) != 0) {
-        fprintf(stderr,
-                "Expected stats: %lld %lld %lld %lld %lld %lld %lld %lld\n"
-                "Actual stats: %lld %lld %lld %lld %lld %lld %lld %lld",
-                data->stats.rx_bytes,
-                data->stats.rx_packets,
-                data->stats.rx_errs,
-                data->stats.rx_drop,
-                data->stats.tx_bytes,
-                data->stats.tx_packets,
-                data->stats.tx_errs,
-                data->stats.tx_drop,
-                actual.rx_bytes,
-                actual.rx_packets,
-                actual.rx_errs,
-                actual.rx_drop,
-                actual.tx_bytes,
-                actual.tx_packets,
-                actual.tx_errs,
-                actual.tx_drop);
+    return testInterfaceCompareStats(&data->stats, &actual);
+}
+
 
+static int
+testInterfaceParseStatsTable(const void *opaque)
+{
+    const InterfaceParseStatsTableData *data = opaque;
+    g_autofree char *filename = NULL;
+    g_autofree char *buf = NULL;
+    g_autoptr(virHashTable) table = NULL;
+    virDomainInterfaceStatsStruct actual;
+    int rc;
+
+    filename = g_strdup_printf("%s/virnetdevopenvswitchdata/%s", abs_srcdir,
+                               data->filename);
+
+    if (virFileReadAll(filename, 4096, &buf) < 0)
+        return -1;
+
+    if (!(table = virNetDevOpenvswitchInterfaceParseStatsTable(buf)))
+        return -1;
+
+    rc = virNetDevOpenvswitchInterfaceStatsLookup(table, data->ifname, &actual);
+    if (rc != data->ret) {
+        fprintf(stderr, "Lookup of '%s' returned %d, expected %d\n",
+                data->ifname, rc, data->ret);
         return -1;
     }
 
-    return 0;
+    if (rc < 0) {
+        virResetLastError();
+        return 0;
+    }
+
+    return testInterfaceCompareStats(&data->stats, &actual);
 }
 
 
@@ -94,6 +146,27 @@ mymain(void)
     TEST_INTERFACE_STATS("stats1.json", 9, 12, 11, 10, 2, 8, 5, 4);
     TEST_INTERFACE_STATS("stats2.json", 12406, 173, 0, 0, 0, 0, 0, 0);
 
+#define TEST_INTERFACE_STATS_TABLE(file, ifname, rv, \
+                                   rxBytes, rxPackets, rxErrs, rxDrop, \
+                                   txBytes, txPackets, txErrs, txDrop) \
+    do { \
+        const InterfaceParseStatsTableData data = {file, ifname, rv, { \
+                             rxBytes, rxPackets, rxErrs, rxDrop, \
+                             txBytes, txPackets, txErrs, txDrop}}; \
+        if (virTestRun("Interface stats table " file " " ifname, \
+                       testInterfaceParseStatsTable, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+    TEST_INTERFACE_STATS_TABLE("statstable.json", "vnet0", 0,
+                               9, 12, 11, 10, 2, 8, 5, 4);
+    TEST_INTERFACE_STATS_TABLE("statstable.json", "vhost-user1", 0,
+                               12406, 173, 0, 0, 0, 0, 0, 0);
+    TEST_INTERFACE_STATS_TABLE("statstable.json", "br0", -1,
+                               0, 0, 0, 0, 0, 0, 0, 0);
+    TEST_INTERFACE_STATS_TABLE("statstable.json", "vnet1", -1,
+                               0, 0, 0, 0, 0, 0, 0, 0);
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
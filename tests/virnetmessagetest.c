@@ -26,6 +26,7 @@
 #include "virlog.h"
 #include "virstring.h"
 #include "rpc/virnetmessage.h"
+#include "rpc/virnetclientprogram.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
@@ -453,10 +454,16 @@ static int testMessagePayloadDecode(const void *args G_GNUC_UNUSED)
     return ret;
 }
 
-static int testMessagePayloadStreamEncode(const void *args G_GNUC_UNUSED)
+static int testMessagePayloadStreamEncode(const void *args)
 {
+    bool byRef = *(const bool *)args;
     char stream[] = "The quick brown fox jumps over the lazy dog";
     virNetMessagePtr msg = virNetMessageNew(true);
+    GOutputVector vec[2];
+    size_t nvec;
+    size_t i;
+    g_autofree char *wire = NULL;
+    size_t wireLength = 0;
     static const char expect[] = {
         0x00, 0x00, 0x00, 0x47,  /* Length */
         0x11, 0x22, 0x33, 0x44,  /* Program */
@@ -493,8 +500,13 @@ static int testMessagePayloadStreamEncode(const void *args G_GNUC_UNUSED)
     if (virNetMessageEncodeHeader(msg) < 0)
         goto cleanup;
 
-    if (virNetMessageEncodePayloadRaw(msg, stream, strlen(stream)) < 0)
-        goto cleanup;
+    if (byRef) {
+        if (virNetMessageEncodePayloadRef(msg, stream, strlen(stream), false) < 0)
+            goto cleanup;
+    } else {
+        if (virNetMessageEncodePayloadRaw(msg, stream, strlen(stream)) < 0)
+            goto cleanup;
+    }
 
     if (G_N_ELEMENTS(expect) != msg->bufferLength) {
         VIR_DEBUG("Expect message length %zu got %zu",
@@ -508,13 +520,215 @@ static int testMessagePayloadStreamEncode(const void *args G_GNUC_UNUSED)
         goto cleanup;
     }
 
-    if (memcmp(expect, msg->buffer, sizeof(expect)) != 0) {
-        virTestDifferenceBin(stderr, expect, msg->buffer, sizeof(expect));
+    nvec = virNetMessageGetOutputVector(msg, vec);
+    if (nvec != (byRef ? 2 : 1)) {
+        VIR_DEBUG("Expect %d output vectors got %zu", byRef ? 2 : 1, nvec);
+        goto cleanup;
+    }
+
+    wire = g_new0(char, msg->bufferLength);
+    for (i = 0; i < nvec; i++) {
+        if (wireLength + vec[i].size > msg->bufferLength) {
+            VIR_DEBUG("Output vectors exceed message length");
+            goto cleanup;
+        }
+        memcpy(wire + wireLength, vec[i].buffer, vec[i].size);
+        wireLength += vec[i].size;
+    }
+
+    if (wireLength != sizeof(expect) ||
+        memcmp(expect, wire, sizeof(expect)) != 0) {
+        virTestDifferenceBin(stderr, expect, wire, sizeof(expect));
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virNetMessageFree(msg);
+    return ret;
+}
+
+
+/* A payload larger than the initial buffer, which has to grow */
+static int testMessagePayloadEncodeLarge(const void *args G_GNUC_UNUSED)
+{
+    virNetMessageError err;
+    virNetMessagePtr msg = virNetMessageNew(true);
+    g_autofree char *message = g_strnfill(VIR_NET_MESSAGE_INITIAL * 3, 'x');
+    size_t expectlen = 28 + 16 + VIR_NET_MESSAGE_INITIAL * 3 + 32;
+    unsigned char *len;
+    int ret = -1;
+
+    if (!msg)
+        return -1;
+
+    memset(&err, 0, sizeof(err));
+
+    err.code = VIR_ERR_INTERNAL_ERROR;
+    err.domain = VIR_FROM_RPC;
+    err.level = VIR_ERR_ERROR;
+    err.message = &message;
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.type = VIR_NET_MESSAGE;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_ERROR;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (virNetMessageEncodePayload(msg, (xdrproc_t)xdr_virNetMessageError, &err) < 0)
+        goto cleanup;
+
+    if (msg->bufferLength != expectlen) {
+        VIR_DEBUG("Expect message length %zu got %zu",
+                  expectlen, msg->bufferLength);
+        goto cleanup;
+    }
+
+    len = (unsigned char *) msg->buffer;
+    if (((size_t) len[0] << 24 | len[1] << 16 | len[2] << 8 | len[3]) != expectlen) {
+        VIR_DEBUG("Length word doesn't match message length");
+        goto cleanup;
+    }
+
+    if (msg->buffer[expectlen - 32 - 1] != 'x') {
+        VIR_DEBUG("Message string not encoded completely");
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virNetMessageFree(msg);
+    return ret;
+}
+
+static int testMessageRecycle(const void *args G_GNUC_UNUSED)
+{
+    virNetMessagePtr msg = virNetMessageNew(true);
+    char *buffer;
+    int ret = -1;
+
+    if (!msg)
+        return -1;
+
+    msg->header.prog = 0x11223344;
+    msg->header.vers = 0x01;
+    msg->header.proc = 0x666;
+    msg->header.type = VIR_NET_REPLY;
+    msg->header.serial = 0x99;
+    msg->header.status = VIR_NET_OK;
+
+    if (virNetMessageEncodeHeader(msg) < 0 ||
+        virNetMessageEncodePayloadRaw(msg, NULL, 0) < 0)
+        goto cleanup;
+
+    buffer = msg->buffer;
+    virNetMessageRecycle(msg, msg->bufferAlloc);
+
+    if (msg->buffer != buffer || msg->bufferLength != 0 ||
+        msg->header.serial != 0 || !msg->tracked) {
+        VIR_DEBUG("Recycled message not reset or buffer not kept");
+        goto cleanup;
+    }
+
+    /* A smaller reservation must not reallocate the buffer */
+    if (virNetMessageReserveBuffer(msg, VIR_NET_MESSAGE_LEN_MAX) < 0)
+        goto cleanup;
+
+    if (msg->buffer != buffer) {
+        VIR_DEBUG("Buffer was reallocated");
+        goto cleanup;
+    }
+
+    /* Buffers above the limit are released */
+    virNetMessageRecycle(msg, 0);
+    if (msg->buffer || msg->bufferAlloc) {
+        VIR_DEBUG("Buffer above limit was kept");
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virNetMessageFree(msg);
+    return ret;
+}
+
+
+static int testMessageBatchCall(const void *args G_GNUC_UNUSED)
+{
+    virNetClientProgramPtr prog = NULL;
+    virNetMessagePtr msg = virNetMessageNew(false);
+    char *packet = NULL;
+    size_t packetlen;
+    unsigned int value = 42;
+    int ret = -1;
+
+    if (!msg)
+        return -1;
+
+    if (!(prog = virNetClientProgramNew(0x11223344, 0x01, NULL, 0, NULL)))
+        goto cleanup;
+
+    if (virNetClientProgramEncodeCall(prog, 0x99, 0x666,
+                                      (xdrproc_t)xdr_u_int, &value,
+                                      &packet, &packetlen) < 0)
+        goto cleanup;
+
+    /* Unpack the call as the server would */
+    if (virNetMessageReserveBuffer(msg, packetlen) < 0)
+        goto cleanup;
+    memcpy(msg->buffer, packet, packetlen);
+    msg->bufferLength = packetlen;
+    value = 0;
+
+    if (virNetMessageDecodeHeader(msg) < 0 ||
+        virNetMessageDecodePayload(msg, (xdrproc_t)xdr_u_int, &value) < 0)
+        goto cleanup;
+
+    if (msg->header.prog != 0x11223344 ||
+        msg->header.vers != 0x01 ||
+        msg->header.proc != 0x666 ||
+        msg->header.type != VIR_NET_CALL ||
+        msg->header.serial != 0x99 ||
+        msg->header.status != VIR_NET_OK ||
+        value != 42) {
+        VIR_DEBUG("Batched call not encoded as expected");
+        goto cleanup;
+    }
+
+    /* Reply with the value incremented */
+    value++;
+    msg->header.type = VIR_NET_REPLY;
+    if (virNetMessageEncodeHeader(msg) < 0 ||
+        virNetMessageEncodePayload(msg, (xdrproc_t)xdr_u_int, &value) < 0)
+        goto cleanup;
+    value = 0;
+
+    if (virNetClientProgramDecodeReply(prog, 0x99, 0x666,
+                                       msg->buffer, msg->bufferLength,
+                                       (xdrproc_t)xdr_u_int, &value) < 0)
+        goto cleanup;
+
+    if (value != 43) {
+        VIR_DEBUG("Expected reply value 43 got %u", value);
+        goto cleanup;
+    }
+
+    /* A reply to some other call must be refused */
+    if (virNetClientProgramDecodeReply(prog, 0x98, 0x666,
+                                       msg->buffer, msg->bufferLength,
+                                       (xdrproc_t)xdr_u_int, &value) == 0) {
+        VIR_DEBUG("Reply with mismatched serial was accepted");
         goto cleanup;
     }
 
     ret = 0;
  cleanup:
+    VIR_FREE(packet);
+    virObjectUnref(prog);
     virNetMessageFree(msg);
     return ret;
 }
@@ -524,6 +738,8 @@ static int
 mymain(void)
 {
     int ret = 0;
+    bool copy = false;
+    bool ref = true;
 
 #ifndef WIN32
     signal(SIGPIPE, SIG_IGN);
@@ -538,10 +754,22 @@ mymain(void)
     if (virTestRun("Message Payload Encode", testMessagePayloadEncode, NULL) < 0)
         ret = -1;
 
+    if (virTestRun("Message Payload Encode Large", testMessagePayloadEncodeLarge, NULL) < 0)
+        ret = -1;
+
     if (virTestRun("Message Payload Decode", testMessagePayloadDecode, NULL) < 0)
         ret = -1;
 
-    if (virTestRun("Message Payload Stream Encode", testMessagePayloadStreamEncode, NULL) < 0)
+    if (virTestRun("Message Payload Stream Encode", testMessagePayloadStreamEncode, &copy) < 0)
+        ret = -1;
+
+    if (virTestRun("Message Payload Stream Ref Encode", testMessagePayloadStreamEncode, &ref) < 0)
+        ret = -1;
+
+    if (virTestRun("Message Recycle", testMessageRecycle, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("Message Batch Call", testMessageBatchCall, NULL) < 0)
         ret = -1;
 
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2020 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "virnuma.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define GiB (1024ULL * 1024)
+
+struct testPlacementData {
+    const virNumaPlacementNode *nodes;
+    size_t nnodes;
+    unsigned int ncpus;
+    unsigned long long memory;
+    const char *expect;
+};
+
+static int
+testPlacement(const void *opaque)
+{
+    const struct testPlacementData *data = opaque;
+    g_autoptr(virBitmap) nodeset = NULL;
+    g_autofree char *actual = NULL;
+
+    if (!(nodeset = virNumaSelectPlacement(data->nodes, data->nnodes,
+                                           data->ncpus, data->memory)))
+        return -1;
+
+    if (!(actual = virBitmapFormat(nodeset)))
+        return -1;
+
+    if (STRNEQ(actual, data->expect)) {
+        fprintf(stderr, "Expected nodeset '%s', got '%s'\n",
+                data->expect, actual);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* Two nodes with eight CPUs each, the second one with more free memory */
+static const virNumaPlacementNode twoNodes[] = {
+    { .node = 0, .ncpus = 8, .memfree = 16 * GiB },
+    { .node = 1, .ncpus = 8, .memfree = 24 * GiB },
+};
+
+/* Same as above, but the second node already runs six vCPUs */
+static const virNumaPlacementNode twoNodesLoaded[] = {
+    { .node = 0, .ncpus = 8, .memfree = 16 * GiB },
+    { .node = 1, .ncpus = 8, .memfree = 24 * GiB, .load = 6 },
+};
+
+/* A single node with all CPUs claimed already */
+static const virNumaPlacementNode oneNodeLoaded[] = {
+    { .node = 0, .ncpus = 4, .memfree = 16 * GiB, .load = 4 },
+};
+
+/* Same as the first one, but a host device is attached to node 0 */
+static const virNumaPlacementNode twoNodesLocal[] = {
+    { .node = 0, .ncpus = 8, .memfree = 16 * GiB, .local = true },
+    { .node = 1, .ncpus = 8, .memfree = 24 * GiB },
+};
+
+/* Four nodes with sparse ids and a memoryless node */
+static const virNumaPlacementNode fourNodes[] = {
+    { .node = 0, .ncpus = 4, .memfree = 8 * GiB, .load = 4 },
+    { .node = 1, .ncpus = 4, .memfree = 8 * GiB },
+    { .node = 2, .ncpus = 4, .memfree = 0 },
+    { .node = 4, .ncpus = 4, .memfree = 4 * GiB },
+};
+
+
+static int
+testProcessMemory(const void *opaque G_GNUC_UNUSED)
+{
+    const char *maps =
+        "55d0c3a00000 default file=/usr/bin/qemu-system-x86_64 mapped=2048 "
+        "N0=2048 kernelpagesize_kB=4\n"
+        "7f2a40000000 bind:1 anon=262144 dirty=262144 N1=262144 "
+        "kernelpagesize_kB=4\n"
+        "7f2c00000000 default file=/dev/hugepages/qemu huge dirty=3 N0=1 "
+        "N2=2 kernelpagesize_kB=2048\n"
+        "7ffd5e1f0000 default stack anon=33 dirty=33 N0=33 "
+        "kernelpagesize_kB=4\n";
+    const unsigned long long expect[] = {
+        (2048 + 33) * 4 + 2048,
+        262144 * 4,
+        2 * 2048,
+    };
+    g_autofree unsigned long long *memory = NULL;
+    size_t nmemory = 0;
+    size_t i;
+
+    if (virNumaParseProcessMemory(maps, &memory, &nmemory) < 0)
+        return -1;
+
+    if (nmemory != G_N_ELEMENTS(expect)) {
+        fprintf(stderr, "Expected %zu nodes, got %zu\n",
+                G_N_ELEMENTS(expect), nmemory);
+        return -1;
+    }
+
+    for (i = 0; i < nmemory; i++) {
+        if (memory[i] != expect[i]) {
+            fprintf(stderr, "Expected %llu KiB on node %zu, got %llu\n",
+                    expect[i], i, memory[i]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+#define DO_TEST(name, nodes, ncpus, memory, expect) \
+    do { \
+        struct testPlacementData data = { \
+            nodes, G_N_ELEMENTS(nodes), ncpus, memory, expect, \
+        }; \
+        if (virTestRun("placement " name, testPlacement, &data) < 0) \
+            ret = -1; \
+    } while (0)
+
+    DO_TEST("single node most memory", twoNodes, 4, 8 * GiB, "1");
+    DO_TEST("single node fitting memory", twoNodes, 4, 20 * GiB, "1");
+    DO_TEST("spread memory", twoNodes, 4, 32 * GiB, "0-1");
+    DO_TEST("spread cpus", twoNodes, 12, 8 * GiB, "0-1");
+    DO_TEST("avoid loaded", twoNodesLoaded, 4, 8 * GiB, "0");
+    DO_TEST("spread loaded", twoNodesLoaded, 4, 20 * GiB, "0-1");
+    DO_TEST("overcommit loaded", oneNodeLoaded, 2, 8 * GiB, "0");
+    DO_TEST("prefer local", twoNodesLocal, 4, 8 * GiB, "0");
+    DO_TEST("local too small", twoNodesLocal, 4, 20 * GiB, "1");
+    DO_TEST("sparse spare cpus", fourNodes, 8, 8 * GiB, "1,4");
+    DO_TEST("too big", fourNodes, 32, 64 * GiB, "0-2,4");
+
+    if (virTestRun("process memory", testProcessMemory, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
@@ -46,6 +46,22 @@ test_virResctrlGetUnused(const void *opaque)
 
     alloc = virResctrlAllocGetUnused(caps->host.resctrl);
 
+    /* the second time the groups are known already */
+    if (alloc) {
+        g_autofree char *first = virResctrlAllocFormat(alloc);
+
+        virObjectUnref(alloc);
+        alloc = virResctrlAllocGetUnused(caps->host.resctrl);
+        schemata_str = alloc ? virResctrlAllocFormat(alloc) : NULL;
+
+        if (STRNEQ_NULLABLE(first, schemata_str)) {
+            VIR_TEST_DEBUG("Free resources differ on second lookup");
+            virFileWrapperClearPrefixes();
+            goto cleanup;
+        }
+        VIR_FREE(schemata_str);
+    }
+
     virFileWrapperClearPrefixes();
 
     if (!alloc) {
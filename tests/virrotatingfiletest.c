@@ -22,6 +22,8 @@
 #include <fcntl.h>
 
 #include "virrotatingfile.h"
+#include "virfile.h"
+#include "virutil.h"
 #include "virlog.h"
 #include "testutils.h"
 
@@ -247,6 +249,68 @@ static int testRotatingFileWriterAppend(const void *data G_GNUC_UNUSED)
 }
 
 
+static int testRotatingFileWriterAppendFromFD(const void *data G_GNUC_UNUSED)
+{
+    virRotatingFileWriterPtr file;
+    int ret = -1;
+    int pipefd[2] = { -1, -1 };
+    char buf[512];
+
+    if (testRotatingFileInitFiles(512,
+                                  (off_t)-1,
+                                  (off_t)-1) < 0)
+        return -1;
+
+    file = virRotatingFileWriterNew(FILENAME,
+                                    1024,
+                                    2,
+                                    false,
+                                    0700);
+    if (!file)
+        goto cleanup;
+
+    if (virPipeQuiet(pipefd) < 0)
+        goto cleanup;
+
+    memset(buf, 0x5e, sizeof(buf));
+
+    /* fits in the current file */
+    if (safewrite(pipefd[1], buf, sizeof(buf)) != sizeof(buf) ||
+        virRotatingFileWriterAppendFromFD(file, pipefd[0], sizeof(buf)) != sizeof(buf))
+        goto cleanup;
+
+    if (testRotatingFileWriterAssertFileSizes(1024,
+                                              (off_t)-1,
+                                              (off_t)-1) < 0)
+        goto cleanup;
+
+    /* needs a rollover */
+    if (safewrite(pipefd[1], buf, sizeof(buf)) != sizeof(buf) ||
+        virRotatingFileWriterAppendFromFD(file, pipefd[0], sizeof(buf)) != sizeof(buf))
+        goto cleanup;
+
+    if (testRotatingFileWriterAssertFileSizes(512,
+                                              1024,
+                                              (off_t)-1) < 0)
+        goto cleanup;
+
+    /* end of the pipe */
+    VIR_FORCE_CLOSE(pipefd[1]);
+    if (virRotatingFileWriterAppendFromFD(file, pipefd[0], sizeof(buf)) != 0)
+        goto cleanup;
+
+    ret = 0;
+ cleanup:
+    VIR_FORCE_CLOSE(pipefd[0]);
+    VIR_FORCE_CLOSE(pipefd[1]);
+    virRotatingFileWriterFree(file);
+    unlink(FILENAME);
+    unlink(FILENAME0);
+    unlink(FILENAME1);
+    return ret;
+}
+
+
 static int testRotatingFileWriterTruncate(const void *data G_GNUC_UNUSED)
 {
     virRotatingFileWriterPtr file;
@@ -702,6 +766,9 @@ mymain(void)
     if (virTestRun("Rotating file write append", testRotatingFileWriterAppend, NULL) < 0)
         ret = -1;
 
+    if (virTestRun("Rotating file write append from fd", testRotatingFileWriterAppendFromFD, NULL) < 0)
+        ret = -1;
+
     if (virTestRun("Rotating file write truncate", testRotatingFileWriterTruncate, NULL) < 0)
         ret = -1;
 
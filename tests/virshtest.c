@@ -126,6 +126,22 @@ static int testCompareListCustom(const void *data G_GNUC_UNUSED)
     return testCompareOutputLit(exp, NULL, argv);
 }
 
+static int testCompareListScale(const void *data G_GNUC_UNUSED)
+{
+    const char *const argv[] = { abs_top_builddir "/tools/virsh", "--connect",
+                                 "test:///scale?domains=4&disks=2",
+                                 "list", "--all", NULL };
+    const char *exp = "\
+ Id   Name      State\n\
+--------------------------\n\
+ 1    scale-0   running\n\
+ 2    scale-1   running\n\
+ 3    scale-2   running\n\
+ -    scale-3   shut off\n\
+\n";
+    return testCompareOutputLit(exp, NULL, argv);
+}
+
 static int testCompareNodeinfoDefault(const void *data G_GNUC_UNUSED)
 {
     const char *const argv[] = { VIRSH_DEFAULT, "nodeinfo", NULL };
@@ -274,6 +290,10 @@ mymain(void)
                    testCompareListCustom, NULL) != 0)
         ret = -1;
 
+    if (virTestRun("virsh list (scale)",
+                   testCompareListScale, NULL) != 0)
+        ret = -1;
+
     if (virTestRun("virsh nodeinfo (default)",
                    testCompareNodeinfoDefault, NULL) != 0)
         ret = -1;
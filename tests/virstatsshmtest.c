@@ -0,0 +1,184 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+
+#ifdef HAVE_MEMFD_CREATE
+
+# include <sys/mman.h>
+# include <sys/stat.h>
+
+# include "virfile.h"
+# include "virstatsshm.h"
+# include "virtypedparam.h"
+
+# define VIR_FROM_THIS VIR_FROM_NONE
+
+
+/* Reads the region the way an external reader does */
+static int
+testStatsShmRead(int fd,
+                 virStatsShmHeader *hdr,
+                 char **data)
+{
+    struct stat sb;
+    char *map;
+    uint64_t seq;
+
+    if (fstat(fd, &sb) < 0)
+        return -1;
+
+    map = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return -1;
+
+    memcpy(hdr, map, sizeof(*hdr));
+    seq = __atomic_load_n(&((virStatsShmHeader *) map)->seq, __ATOMIC_ACQUIRE);
+    *data = g_new0(char, hdr->datalen);
+    memcpy(*data, map + hdr->headersize, hdr->datalen);
+
+    munmap(map, sb.st_size);
+
+    if (seq % 2 == 1 || seq != hdr->seq) {
+        VIR_TEST_DEBUG("Inconsistent sequence number %llu",
+                       (unsigned long long) seq);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static const char *
+testStatsShmReadString(const char **pos)
+{
+    uint32_t len;
+    const char *str;
+
+    memcpy(&len, *pos, sizeof(len));
+    str = *pos + sizeof(len);
+    *pos = str + len + 1;
+
+    return str;
+}
+
+
+static int
+testStatsShm(const void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virStatsShm) shm = NULL;
+    g_autoptr(virTypedParamList) list = g_new0(virTypedParamList, 1);
+    virStatsShmRecord records[2] = { { 0 } };
+    virStatsShmHeader hdr;
+    g_autofree char *data = NULL;
+    g_autofree char *big = g_strnfill(10000, 'x');
+    VIR_AUTOCLOSE fd = -1;
+    const char *pos;
+    uint32_t nparams;
+    uint32_t type;
+    uint64_t value;
+    size_t i;
+
+    if (!(shm = virStatsShmNew("test")))
+        return -1;
+
+    if ((fd = virStatsShmOpenReader(shm)) < 0)
+        return -1;
+
+    if (virTypedParamListAddULLong(list, 42, "cpu.time") < 0 ||
+        virTypedParamListAddString(list, big, "test.string") < 0)
+        return -1;
+
+    records[0].name = g_strdup("first");
+    records[0].nparams = virTypedParamListStealParams(list, &records[0].params);
+    records[1].name = g_strdup("second");
+
+    /* the second record doesn't fit the initial size of the region */
+    if (virStatsShmPublish(shm, records, 2, 1234) < 0)
+        goto error;
+
+    for (i = 0; i < G_N_ELEMENTS(records); i++)
+        virStatsShmRecordClear(&records[i]);
+
+    if (testStatsShmRead(fd, &hdr, &data) < 0)
+        return -1;
+
+    if (memcmp(hdr.magic, VIR_STATS_SHM_MAGIC, sizeof(VIR_STATS_SHM_MAGIC)) != 0 ||
+        hdr.version != VIR_STATS_SHM_VERSION ||
+        hdr.seq != 2 ||
+        hdr.nrecords != 2 ||
+        hdr.timestamp != 1234) {
+        VIR_TEST_DEBUG("Unexpected header");
+        return -1;
+    }
+
+    pos = data + sizeof(uint32_t);
+    memcpy(&nparams, pos, sizeof(nparams));
+    pos += sizeof(nparams) + VIR_UUID_BUFLEN;
+
+    if (nparams != 2 ||
+        STRNEQ(testStatsShmReadString(&pos), "first")) {
+        VIR_TEST_DEBUG("Unexpected record");
+        return -1;
+    }
+
+    memcpy(&type, pos, sizeof(type));
+    pos += sizeof(type);
+    if (type != VIR_TYPED_PARAM_ULLONG ||
+        STRNEQ(testStatsShmReadString(&pos), "cpu.time")) {
+        VIR_TEST_DEBUG("Unexpected parameter");
+        return -1;
+    }
+
+    memcpy(&value, pos, sizeof(value));
+    if (value != 42) {
+        VIR_TEST_DEBUG("Unexpected value %llu", (unsigned long long) value);
+        return -1;
+    }
+
+    return 0;
+
+ error:
+    for (i = 0; i < G_N_ELEMENTS(records); i++)
+        virStatsShmRecordClear(&records[i]);
+    return -1;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virTestRun("Publish", testStatsShm, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
+
+#else /* !HAVE_MEMFD_CREATE */
+
+int
+main(void)
+{
+    return EXIT_AM_SKIP;
+}
+
+#endif /* !HAVE_MEMFD_CREATE */
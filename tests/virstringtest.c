@@ -649,6 +649,53 @@ static int testFilterChars(const void *args)
     return ret;
 }
 
+static int
+testStringIntern(const void *args G_GNUC_UNUSED)
+{
+    g_autofree char *copy = g_strdup("virt-ssbd");
+    virStringInternStats stats;
+    const char *a;
+    const char *b;
+    const char *c;
+    int ret = -1;
+
+    a = virStringIntern("virt-ssbd");
+    b = virStringIntern(copy);
+    c = virStringIntern("amd-ssbd");
+
+    if (a != b || a == c || STRNEQ(a, "virt-ssbd")) {
+        fprintf(stderr, "equal strings not shared\n");
+        goto cleanup;
+    }
+
+    virStringInternGetStats(&stats);
+    if (stats.strings != 2 || stats.refs != 3 ||
+        stats.bytes != sizeof("virt-ssbd") + sizeof("amd-ssbd")) {
+        fprintf(stderr, "unexpected stats: strings=%zu refs=%zu bytes=%zu\n",
+                stats.strings, stats.refs, stats.bytes);
+        goto cleanup;
+    }
+
+    virStringInternRelease(b);
+    virStringInternRelease(c);
+    b = c = NULL;
+
+    virStringInternGetStats(&stats);
+    if (stats.strings != 1 || stats.refs != 1 ||
+        STRNEQ(a, "virt-ssbd")) {
+        fprintf(stderr, "released string still referenced\n");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virStringInternRelease(a);
+    virStringInternRelease(b);
+    virStringInternRelease(c);
+    return ret;
+}
+
 static int
 mymain(void)
 {
@@ -977,6 +1024,9 @@ mymain(void)
     TEST_FILTER_CHARS(NULL, NULL, NULL);
     TEST_FILTER_CHARS("hello 123 hello", "helo", "hellohello");
 
+    if (virTestRun("virStringIntern", testStringIntern, NULL) < 0)
+        ret = -1;
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -200,6 +200,119 @@ testTypedParamsGetStringList(const void *opaque G_GNUC_UNUSED)
     return rv;
 }
 
+static int
+testTypedParamsDiffPatch(const void *opaque G_GNUC_UNUSED)
+{
+    virTypedParameter prev[] = {
+        { .field = "a", .type = VIR_TYPED_PARAM_ULLONG,
+          .value = { .ul = ULLONG_MAX - 1 } },
+        { .field = "b", .type = VIR_TYPED_PARAM_UINT, .value = { .ui = 5 } },
+        { .field = "c", .type = VIR_TYPED_PARAM_STRING,
+          .value = { .s = (char*)"x" } },
+        { .field = "d", .type = VIR_TYPED_PARAM_INT, .value = { .i = 1 } },
+    };
+    virTypedParameter cur[] = {
+        { .field = "a", .type = VIR_TYPED_PARAM_ULLONG, .value = { .ul = 3 } },
+        { .field = "b", .type = VIR_TYPED_PARAM_UINT, .value = { .ui = 5 } },
+        { .field = "c", .type = VIR_TYPED_PARAM_STRING,
+          .value = { .s = (char*)"y" } },
+        { .field = "e", .type = VIR_TYPED_PARAM_LLONG, .value = { .l = -7 } },
+    };
+    g_autoptr(virTypedParamList) changed = g_new0(virTypedParamList, 1);
+    g_autoptr(virTypedParamList) list = g_new0(virTypedParamList, 1);
+    g_autofree size_t *removed = NULL;
+    size_t nremoved = 0;
+    unsigned long long ul;
+    unsigned int ui;
+    long long l;
+    const char *s;
+
+    if (virTypedParamsDiff(prev, G_N_ELEMENTS(prev), cur, G_N_ELEMENTS(cur),
+                           changed, &removed, &nremoved) < 0)
+        return -1;
+
+    /* 'b' is unchanged and 'a' wrapped around to a delta of 5 */
+    if (changed->npar != 3 ||
+        STRNEQ(changed->par[0].field, "a") ||
+        changed->par[0].value.ul != 5 ||
+        STRNEQ(changed->par[1].field, "c") ||
+        STRNEQ(changed->par[2].field, "e") ||
+        nremoved != 1 || removed[0] != 3) {
+        fprintf(stderr, "unexpected diff\n");
+        return -1;
+    }
+
+    if (virTypedParamListAddParams(list, prev, G_N_ELEMENTS(prev)) < 0 ||
+        virTypedParamsPatch(list, changed->par, changed->npar,
+                            removed, nremoved) < 0)
+        return -1;
+
+    if (list->npar != G_N_ELEMENTS(cur) ||
+        virTypedParamsGetULLong(list->par, list->npar, "a", &ul) != 1 ||
+        ul != 3 ||
+        virTypedParamsGetUInt(list->par, list->npar, "b", &ui) != 1 ||
+        ui != 5 ||
+        virTypedParamsGetString(list->par, list->npar, "c", &s) != 1 ||
+        STRNEQ(s, "y") ||
+        virTypedParamsGetLLong(list->par, list->npar, "e", &l) != 1 ||
+        l != -7 ||
+        virTypedParamsGet(list->par, list->npar, "d")) {
+        fprintf(stderr, "unexpected patch result\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+testTypedParamsListNames(const void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virTypedParamList) list = g_new0(virTypedParamList, 1);
+    g_autofree char *longname = g_strnfill(VIR_TYPED_PARAM_FIELD_LENGTH - 3, 'x');
+    const char *expect[] = {
+        "block.count",
+        "block.0.rd.reqs",
+        "block.4294967295.name",
+        "net.3.vda.rx",
+        "vcpu.7.wait",
+        "100%",
+    };
+    size_t i;
+
+    virTypedParamListReserve(list, G_N_ELEMENTS(expect));
+    if (list->par_alloc < G_N_ELEMENTS(expect)) {
+        fprintf(stderr, "list wasn't resized\n");
+        return -1;
+    }
+
+    if (virTypedParamListAddUInt(list, 1, "block.count") < 0 ||
+        virTypedParamListAddULLong(list, 2, "block.%zu.rd.reqs", (size_t) 0) < 0 ||
+        virTypedParamListAddString(list, "vda", "block.%zu.name", (size_t) 4294967295U) < 0 ||
+        virTypedParamListAddULLong(list, 3, "net.%zu.%s.rx", (size_t) 3, "vda") < 0 ||
+        virTypedParamListAddULLong(list, 4, "vcpu.%u.wait", 7) < 0 ||
+        virTypedParamListAddInt(list, 5, "%d%%", 100) < 0)
+        return -1;
+
+    for (i = 0; i < G_N_ELEMENTS(expect); i++) {
+        if (STRNEQ(list->par[i].field, expect[i])) {
+            fprintf(stderr, "expected '%s', got '%s'\n",
+                    expect[i], list->par[i].field);
+            return -1;
+        }
+    }
+
+    if (virTypedParamListAddInt(list, 6, "%s%zu", longname, (size_t) 10) < 0 ||
+        STRNEQ_NULLABLE(list->par[list->npar - 1].field + strlen(longname), "10"))
+        return -1;
+
+    if (virTypedParamListAddInt(list, 7, "%s%zu", longname, (size_t) 100) == 0) {
+        fprintf(stderr, "name longer than the field was accepted\n");
+        return -1;
+    }
+
+    return 0;
+}
+
 static int
 testTypedParamsValidator(void)
 {
@@ -301,6 +414,12 @@ mymain(void)
     if (virTestRun("Add string list", testTypedParamsAddStringList, NULL) < 0)
         rv = -1;
 
+    if (virTestRun("Diff and patch", testTypedParamsDiffPatch, NULL) < 0)
+        rv = -1;
+
+    if (virTestRun("List names", testTypedParamsListNames, NULL) < 0)
+        rv = -1;
+
     if (rv < 0)
         return EXIT_FAILURE;
     return EXIT_SUCCESS;
@@ -0,0 +1,162 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "virfile.h"
+#include "virwritebehind.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+
+static int
+testCheckContent(const char *path,
+                 const char *expect)
+{
+    g_autofree char *content = NULL;
+
+    if (!expect) {
+        if (virFileExists(path)) {
+            VIR_TEST_DEBUG("File '%s' was written too early", path);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (virFileReadAll(path, 1024, &content) < 0)
+        return -1;
+
+    if (STRNEQ(content, expect)) {
+        virTestDifference(stderr, expect, content);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* The long delay keeps the background thread from writing anything
+ * before the flushes done by the tests */
+static int
+testWriteBehindFlush(const void *opaque)
+{
+    const char *dir = opaque;
+    g_autofree char *a = g_strdup_printf("%s/flush-a", dir);
+    g_autofree char *b = g_strdup_printf("%s/flush-b", dir);
+
+    if (virWriteBehindQueue(a, 0600, "a1") < 0 ||
+        virWriteBehindQueue(b, 0600, "b1") < 0 ||
+        virWriteBehindQueue(a, 0600, "a2") < 0)
+        return -1;
+
+    if (testCheckContent(a, NULL) < 0 ||
+        testCheckContent(b, NULL) < 0)
+        return -1;
+
+    if (virWriteBehindFlush() < 0)
+        return -1;
+
+    if (testCheckContent(a, "a2") < 0 ||
+        testCheckContent(b, "b1") < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+testWriteBehindCancel(const void *opaque)
+{
+    const char *dir = opaque;
+    g_autofree char *a = g_strdup_printf("%s/cancel-a", dir);
+    g_autofree char *b = g_strdup_printf("%s/cancel-b", dir);
+
+    if (virWriteBehindQueue(a, 0600, "a") < 0 ||
+        virWriteBehindQueue(b, 0600, "b") < 0)
+        return -1;
+
+    virWriteBehindCancel(a);
+
+    if (virWriteBehindFlush() < 0)
+        return -1;
+
+    if (testCheckContent(a, NULL) < 0 ||
+        testCheckContent(b, "b") < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+testWriteBehindShutdown(const void *opaque)
+{
+    const char *dir = opaque;
+    g_autofree char *a = g_strdup_printf("%s/shutdown-a", dir);
+    g_autofree char *b = g_strdup_printf("%s/shutdown-b", dir);
+
+    if (virWriteBehindQueue(a, 0600, "a") < 0)
+        return -1;
+
+    virWriteBehindShutdown();
+
+    if (testCheckContent(a, "a") < 0)
+        return -1;
+
+    /* without a delay files are written right away */
+    if (virWriteBehindQueue(b, 0600, "b") < 0)
+        return -1;
+
+    if (testCheckContent(b, "b") < 0)
+        return -1;
+
+    return 0;
+}
+
+
+#define SCRATCHDIRTEMPLATE abs_builddir "/writebehinddir-XXXXXX"
+
+static int
+mymain(void)
+{
+    char scratchdir[] = SCRATCHDIRTEMPLATE;
+    int ret = 0;
+
+    if (!g_mkdtemp(scratchdir)) {
+        fprintf(stderr, "Cannot create writebehinddir");
+        abort();
+    }
+
+    if (virWriteBehindSetDelay(3600 * 1000) < 0)
+        return EXIT_FAILURE;
+
+    if (virTestRun("Flush", testWriteBehindFlush, scratchdir) < 0)
+        ret = -1;
+    if (virTestRun("Cancel", testWriteBehindCancel, scratchdir) < 0)
+        ret = -1;
+    if (virTestRun("Shutdown", testWriteBehindShutdown, scratchdir) < 0)
+        ret = -1;
+
+    virWriteBehindShutdown();
+
+    if (getenv("LIBVIRT_SKIP_CLEANUP") == NULL)
+        virFileDeleteTree(scratchdir);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
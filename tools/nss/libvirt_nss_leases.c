@@ -25,6 +25,8 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include <yajl/yajl_gen.h>
 #include <yajl/yajl_parse.h>
@@ -40,26 +42,67 @@ enum {
 
 
 typedef struct {
-    const char *name;
-    char **macs;
-    size_t nmacs;
+    unsigned long long expiry;
+    char *ipaddr;
+    char *macaddr;
+    char *hostname;
+} leaseEntry;
+
+
+/*
+ * The parsed contents of a lease file, reused for as long as
+ * the file stays the same. The lease helper replaces the file
+ * on every update, so a new inode or mtime means new contents.
+ */
+typedef struct {
+    char *file;
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    off_t size;
+
+    leaseEntry *entries;
+    size_t nentries;
+} leaseFileCache;
+
+static pthread_mutex_t leaseFileCacheLock = PTHREAD_MUTEX_INITIALIZER;
+static leaseFileCache *leaseFileCaches;
+static size_t nleaseFileCaches;
+
+
+typedef struct {
     int state;
-    unsigned long long now;
-    int af;
-    bool *found;
-    leaseAddress **addrs;
-    size_t *naddrs;
 
     char *key;
-    struct {
-        unsigned long long expiry;
-        char *ipaddr;
-        char *macaddr;
-        char *hostname;
-    } entry;
+    leaseEntry entry;
+
+    leaseEntry *entries;
+    size_t nentries;
 } findLeasesParser;
 
 
+static void
+leaseEntryClear(leaseEntry *entry)
+{
+    free(entry->macaddr);
+    free(entry->ipaddr);
+    free(entry->hostname);
+    memset(entry, 0, sizeof(*entry));
+}
+
+
+static void
+leaseEntriesFree(leaseEntry *entries,
+                 size_t nentries)
+{
+    size_t i;
+
+    for (i = 0; i < nentries; i++)
+        leaseEntryClear(&entries[i]);
+    free(entries);
+}
+
+
 static int
 appendAddr(const char *name __attribute__((unused)),
            leaseAddress **tmpAddress,
@@ -252,8 +295,7 @@ static int
 findLeasesParserEndMap(void *ctx)
 {
     findLeasesParser *parser = ctx;
-    size_t i;
-    bool found = false;
+    leaseEntry *tmpEntries;
 
     DEBUG("Parse end map state=%d", parser->state);
 
@@ -263,44 +305,16 @@ findLeasesParserEndMap(void *ctx)
     if (parser->state != FIND_LEASES_STATE_ENTRY)
         return 0;
 
-    if (parser->nmacs) {
-        DEBUG("Check %zu macs", parser->nmacs);
-        for (i = 0; i < parser->nmacs && !found; i++) {
-            DEBUG("Check mac '%s' vs '%s'", parser->macs[i], NULLSTR(parser->entry.macaddr));
-            if (parser->entry.macaddr && !strcmp(parser->macs[i], parser->entry.macaddr))
-                found = true;
-        }
-    } else {
-        DEBUG("Check name '%s' vs '%s'", parser->name, NULLSTR(parser->entry.hostname));
-        if (parser->entry.hostname && !strcmp(parser->name, parser->entry.hostname))
-            found = true;
-    }
-    DEBUG("Found %d", found);
-    if (parser->entry.expiry < parser->now) {
-        DEBUG("Entry expired at %llu vs now %llu",
-              parser->entry.expiry, parser->now);
-        found = false;
-    }
-    if (!parser->entry.ipaddr)
-        found = false;
-
-    if (found) {
-        *parser->found = true;
-
-        if (appendAddr(parser->name,
-                       parser->addrs, parser->naddrs,
-                       parser->entry.ipaddr,
-                       parser->entry.expiry,
-                       parser->af) < 0)
-            return 0;
+    tmpEntries = realloc(parser->entries,
+                         sizeof(*tmpEntries) * (parser->nentries + 1));
+    if (!tmpEntries) {
+        ERROR("Out of memory");
+        return 0;
     }
+    parser->entries = tmpEntries;
 
-    free(parser->entry.macaddr);
-    free(parser->entry.ipaddr);
-    free(parser->entry.hostname);
-    parser->entry.macaddr = NULL;
-    parser->entry.ipaddr = NULL;
-    parser->entry.hostname = NULL;
+    parser->entries[parser->nentries++] = parser->entry;
+    memset(&parser->entry, 0, sizeof(parser->entry));
 
     parser->state = FIND_LEASES_STATE_LIST;
 
@@ -341,18 +355,15 @@ findLeasesParserEndArray(void *ctx)
 }
 
 
-int
-findLeases(const char *file,
-           const char *name,
-           char **macs,
-           size_t nmacs,
-           int af,
-           time_t now,
-           leaseAddress **addrs,
-           size_t *naddrs,
-           bool *found)
+/*
+ * Parse all leases in @file, which is open as @fd.
+ */
+static int
+parseLeases(const char *file,
+            int fd,
+            leaseEntry **entries,
+            size_t *nentries)
 {
-    int fd = -1;
     int ret = -1;
     const yajl_callbacks parserCallbacks = {
         NULL, /* null */
@@ -367,26 +378,12 @@ findLeases(const char *file,
         findLeasesParserStartArray,
         findLeasesParserEndArray,
     };
-    findLeasesParser parserState = {
-        .name = name,
-        .macs = macs,
-        .nmacs = nmacs,
-        .af = af,
-        .now = now,
-        .found = found,
-        .addrs = addrs,
-        .naddrs = naddrs,
-    };
+    findLeasesParser parserState = { 0 };
     yajl_handle parser = NULL;
     char line[1024];
     ssize_t nreadTotal = 0;
     int rv;
 
-    if ((fd = open(file, O_RDONLY)) < 0) {
-        ERROR("Cannot open %s", file);
-        goto cleanup;
-    }
-
     parser = yajl_alloc(&parserCallbacks, NULL, &parserState);
     if (!parser) {
         ERROR("Unable to create JSON parser");
@@ -405,7 +402,7 @@ findLeases(const char *file,
             yajl_status_ok) {
             unsigned char *err = yajl_get_error(parser, 1,
                                                 (const unsigned char*)line, rv);
-            ERROR("Parse failed %s", (const char *) err);
+            ERROR("Parse failed %s: %s", file, (const char *) err);
             yajl_free_error(parser, err);
             goto cleanup;
         }
@@ -418,21 +415,187 @@ findLeases(const char *file,
         goto cleanup;
     }
 
+    *entries = parserState.entries;
+    *nentries = parserState.nentries;
+    parserState.entries = NULL;
+    parserState.nentries = 0;
+
     ret = 0;
 
  cleanup:
+    if (parser)
+        yajl_free(parser);
+    leaseEntriesFree(parserState.entries, parserState.nentries);
+    leaseEntryClear(&parserState.entry);
+    free(parserState.key);
+    return ret;
+}
+
+
+/*
+ * Get the cache of @file, refreshing it if the file changed since
+ * it was parsed. Call with leaseFileCacheLock held.
+ */
+static leaseFileCache *
+getLeaseFileCache(const char *file)
+{
+    leaseFileCache *cache = NULL;
+    leaseEntry *entries = NULL;
+    size_t nentries = 0;
+    struct stat sb;
+    size_t i;
+    int fd = -1;
+
+    if ((fd = open(file, O_RDONLY)) < 0) {
+        ERROR("Cannot open %s", file);
+        return NULL;
+    }
+
+    if (fstat(fd, &sb) < 0) {
+        ERROR("Cannot stat %s", file);
+        goto cleanup;
+    }
+
+    for (i = 0; i < nleaseFileCaches; i++) {
+        if (!strcmp(leaseFileCaches[i].file, file)) {
+            cache = &leaseFileCaches[i];
+            break;
+        }
+    }
+
+    if (cache &&
+        cache->dev == sb.st_dev &&
+        cache->ino == sb.st_ino &&
+        cache->mtime.tv_sec == sb.st_mtim.tv_sec &&
+        cache->mtime.tv_nsec == sb.st_mtim.tv_nsec &&
+        cache->size == sb.st_size) {
+        DEBUG("Using cached leases of %s", file);
+        goto cleanup;
+    }
+
+    if (parseLeases(file, fd, &entries, &nentries) < 0) {
+        cache = NULL;
+        goto cleanup;
+    }
+
+    if (!cache) {
+        leaseFileCache *tmpCaches;
+        char *tmpFile;
+
+        if (!(tmpFile = strdup(file))) {
+            ERROR("Out of memory");
+            goto error;
+        }
+
+        tmpCaches = realloc(leaseFileCaches,
+                            sizeof(*tmpCaches) * (nleaseFileCaches + 1));
+        if (!tmpCaches) {
+            ERROR("Out of memory");
+            free(tmpFile);
+            goto error;
+        }
+        leaseFileCaches = tmpCaches;
+
+        cache = &leaseFileCaches[nleaseFileCaches++];
+        memset(cache, 0, sizeof(*cache));
+        cache->file = tmpFile;
+    }
+
+    leaseEntriesFree(cache->entries, cache->nentries);
+    cache->entries = entries;
+    cache->nentries = nentries;
+    cache->dev = sb.st_dev;
+    cache->ino = sb.st_ino;
+    cache->mtime = sb.st_mtim;
+    cache->size = sb.st_size;
+
+ cleanup:
+    close(fd);
+    return cache;
+
+ error:
+    leaseEntriesFree(entries, nentries);
+    close(fd);
+    return NULL;
+}
+
+
+static bool
+leaseEntryMatches(const leaseEntry *entry,
+                  const char *name,
+                  char **macs,
+                  size_t nmacs,
+                  time_t now)
+{
+    size_t i;
+    bool found = false;
+
+    if (nmacs) {
+        DEBUG("Check %zu macs", nmacs);
+        for (i = 0; i < nmacs && !found; i++) {
+            DEBUG("Check mac '%s' vs '%s'", macs[i], NULLSTR(entry->macaddr));
+            if (entry->macaddr && !strcmp(macs[i], entry->macaddr))
+                found = true;
+        }
+    } else {
+        DEBUG("Check name '%s' vs '%s'", name, NULLSTR(entry->hostname));
+        if (entry->hostname && !strcmp(name, entry->hostname))
+            found = true;
+    }
+    DEBUG("Found %d", found);
+    if (entry->expiry < (unsigned long long)now) {
+        DEBUG("Entry expired at %llu vs now %llu",
+              entry->expiry, (unsigned long long)now);
+        found = false;
+    }
+    if (!entry->ipaddr)
+        found = false;
+
+    return found;
+}
+
+
+int
+findLeases(const char *file,
+           const char *name,
+           char **macs,
+           size_t nmacs,
+           int af,
+           time_t now,
+           leaseAddress **addrs,
+           size_t *naddrs,
+           bool *found)
+{
+    leaseFileCache *cache;
+    size_t i;
+    int ret = -1;
+
+    pthread_mutex_lock(&leaseFileCacheLock);
+
+    if (!(cache = getLeaseFileCache(file)))
+        goto cleanup;
+
+    for (i = 0; i < cache->nentries; i++) {
+        leaseEntry *entry = &cache->entries[i];
+
+        if (!leaseEntryMatches(entry, name, macs, nmacs, now))
+            continue;
+
+        *found = true;
+
+        if (appendAddr(name, addrs, naddrs,
+                       entry->ipaddr, entry->expiry, af) < 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    pthread_mutex_unlock(&leaseFileCacheLock);
     if (ret != 0) {
         free(*addrs);
         *addrs = NULL;
         *naddrs = 0;
     }
-    if (parser)
-        yajl_free(parser);
-    free(parserState.entry.ipaddr);
-    free(parserState.entry.macaddr);
-    free(parserState.entry.hostname);
-    free(parserState.key);
-    if (fd != -1)
-        close(fd);
     return ret;
 }
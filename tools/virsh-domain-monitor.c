@@ -33,6 +33,8 @@
 #include "virstring.h"
 #include "vsh-table.h"
 #include "virenum.h"
+#include "virhash.h"
+#include "virjson.h"
 
 VIR_ENUM_DECL(virshDomainIOError);
 VIR_ENUM_IMPL(virshDomainIOError,
@@ -2127,6 +2129,18 @@ static const vshCmdOptDef opts_domstats[] = {
      .type = VSH_OT_BOOL,
      .help = N_("report domain memory usage"),
     },
+    {.name = "monitor",
+     .type = VSH_OT_BOOL,
+     .help = N_("report domain monitor command latencies"),
+    },
+    {.name = "pressure",
+     .type = VSH_OT_BOOL,
+     .help = N_("report domain resource pressure and throttling"),
+    },
+    {.name = "definition",
+     .type = VSH_OT_BOOL,
+     .help = N_("report digests of domain definitions"),
+    },
     {.name = "list-active",
      .type = VSH_OT_BOOL,
      .help = N_("list only active domains"),
@@ -2175,15 +2189,130 @@ static const vshCmdOptDef opts_domstats[] = {
      .type = VSH_OT_BOOL,
      .help = N_("report only stats that are accessible instantly"),
     },
+    {.name = "watch",
+     .type = VSH_OT_INT,
+     .flags = VSH_OFLAG_REQ_OPT,
+     .help = N_("report stats and rates every given number of seconds"),
+    },
+    {.name = "format",
+     .type = VSH_OT_STRING,
+     .flags = VSH_OFLAG_REQ_OPT,
+     .help = N_("output format, one of text (default), json or csv"),
+    },
     VIRSH_COMMON_OPT_DOMAIN_OT_ARGV(N_("list of domains to get stats for"), 0),
     {.name = NULL}
 };
 
 
+typedef enum {
+    VIRSH_DOMAIN_STATS_FORMAT_TEXT,
+    VIRSH_DOMAIN_STATS_FORMAT_JSON,
+    VIRSH_DOMAIN_STATS_FORMAT_CSV,
+
+    VIRSH_DOMAIN_STATS_FORMAT_LAST
+} virshDomainStatsFormat;
+
+VIR_ENUM_DECL(virshDomainStatsFormat);
+VIR_ENUM_IMPL(virshDomainStatsFormat,
+              VIRSH_DOMAIN_STATS_FORMAT_LAST,
+              "text",
+              "json",
+              "csv");
+
+
+/* Suffixes of the names of stats fields which count up over the lifetime
+ * of the domain, and whose rate of change is therefore reported in watch
+ * mode */
+static const char *virshDomainStatsCounterSuffixes[] = {
+    ".bytes", ".reqs", ".pkts", ".errs", ".drop",
+    ".time", ".times", ".user", ".system", ".wait",
+};
+
+
+static bool
+virshDomainStatsIsCounter(virTypedParameterPtr param)
+{
+    size_t i;
+
+    if (param->type != VIR_TYPED_PARAM_ULLONG &&
+        param->type != VIR_TYPED_PARAM_LLONG)
+        return false;
+
+    for (i = 0; i < G_N_ELEMENTS(virshDomainStatsCounterSuffixes); i++) {
+        if (virStringHasSuffix(param->field, virshDomainStatsCounterSuffixes[i]))
+            return true;
+    }
+
+    return false;
+}
+
+
+/* Finds @param in the earlier record @prev, which usually reports its
+ * fields in the same order, so look at the same index first */
+static virTypedParameterPtr
+virshDomainStatsFindPrevious(virDomainStatsRecordPtr prev,
+                             virTypedParameterPtr param,
+                             size_t idx)
+{
+    if (idx < prev->nparams && STREQ(prev->params[idx].field, param->field))
+        return prev->params + idx;
+
+    return virTypedParamsGet(prev->params, prev->nparams, param->field);
+}
+
+
+/* The rates of change of the counters in @record since @prev, which
+ * was collected @elapsed microseconds earlier */
+typedef struct _virshDomainStatsRate virshDomainStatsRate;
+struct _virshDomainStatsRate {
+    const char *field;
+    double rate; /* per second */
+};
+
+static virshDomainStatsRate *
+virshDomainStatsGetRates(virDomainStatsRecordPtr record,
+                         virDomainStatsRecordPtr prev,
+                         gint64 elapsed,
+                         size_t *nrates)
+{
+    virshDomainStatsRate *rates = g_new0(virshDomainStatsRate, record->nparams);
+    size_t i;
+
+    *nrates = 0;
+    for (i = 0; i < record->nparams; i++) {
+        virTypedParameterPtr param = record->params + i;
+        virTypedParameterPtr old;
+        double delta;
+
+        if (!virshDomainStatsIsCounter(param) ||
+            !(old = virshDomainStatsFindPrevious(prev, param, i)) ||
+            old->type != param->type)
+            continue;
+
+        if (param->type == VIR_TYPED_PARAM_ULLONG)
+            delta = (double) param->value.ul - (double) old->value.ul;
+        else
+            delta = (double) param->value.l - (double) old->value.l;
+
+        /* counters are reset e.g. by restarting the domain */
+        if (delta < 0)
+            continue;
+
+        rates[*nrates].field = param->field;
+        rates[*nrates].rate = delta * G_USEC_PER_SEC / elapsed;
+        (*nrates)++;
+    }
+
+    return rates;
+}
+
+
 static bool
 virshDomainStatsPrintRecord(vshControl *ctl G_GNUC_UNUSED,
                             virDomainStatsRecordPtr record,
-                            bool raw G_GNUC_UNUSED)
+                            bool raw G_GNUC_UNUSED,
+                            virshDomainStatsRate *rates,
+                            size_t nrates)
 {
     char *param;
     size_t i;
@@ -2201,9 +2330,214 @@ virshDomainStatsPrintRecord(vshControl *ctl G_GNUC_UNUSED,
         VIR_FREE(param);
     }
 
+    for (i = 0; i < nrates; i++) {
+        vshPrint(ctl, "  %s.rate=%.2f\n", rates[i].field, rates[i].rate);
+
+        /* CPU time is in nanoseconds, so this is the usage in percent
+         * of one host CPU */
+        if (STREQ(rates[i].field, "cpu.time"))
+            vshPrint(ctl, "  cpu.usage=%.2f\n", rates[i].rate / 1e7);
+    }
+
+    return true;
+}
+
+
+static bool
+virshDomainStatsPrintRecordJSON(vshControl *ctl,
+                                virDomainStatsRecordPtr record,
+                                long long timestamp,
+                                virshDomainStatsRate *rates,
+                                size_t nrates)
+{
+    g_autoptr(virJSONValue) obj = virJSONValueNewObject();
+    g_autoptr(virJSONValue) stats = virJSONValueNewObject();
+    g_autofree char *str = NULL;
+    size_t i;
+
+    for (i = 0; i < record->nparams; i++) {
+        virTypedParameterPtr param = record->params + i;
+        int rc = -1;
+
+        switch ((virTypedParameterType) param->type) {
+        case VIR_TYPED_PARAM_INT:
+            rc = virJSONValueObjectAppendNumberInt(stats, param->field,
+                                                   param->value.i);
+            break;
+        case VIR_TYPED_PARAM_UINT:
+            rc = virJSONValueObjectAppendNumberUint(stats, param->field,
+                                                    param->value.ui);
+            break;
+        case VIR_TYPED_PARAM_LLONG:
+            rc = virJSONValueObjectAppendNumberLong(stats, param->field,
+                                                    param->value.l);
+            break;
+        case VIR_TYPED_PARAM_ULLONG:
+            rc = virJSONValueObjectAppendNumberUlong(stats, param->field,
+                                                     param->value.ul);
+            break;
+        case VIR_TYPED_PARAM_DOUBLE:
+            rc = virJSONValueObjectAppendNumberDouble(stats, param->field,
+                                                      param->value.d);
+            break;
+        case VIR_TYPED_PARAM_BOOLEAN:
+            rc = virJSONValueObjectAppendBoolean(stats, param->field,
+                                                 param->value.b);
+            break;
+        case VIR_TYPED_PARAM_STRING:
+            rc = virJSONValueObjectAppendString(stats, param->field,
+                                                param->value.s);
+            break;
+        case VIR_TYPED_PARAM_LAST:
+        default:
+            rc = 0;
+            break;
+        }
+
+        if (rc < 0)
+            return false;
+    }
+
+    for (i = 0; i < nrates; i++) {
+        g_autofree char *field = g_strdup_printf("%s.rate", rates[i].field);
+
+        if (virJSONValueObjectAppendNumberDouble(stats, field,
+                                                 rates[i].rate) < 0)
+            return false;
+
+        if (STREQ(rates[i].field, "cpu.time") &&
+            virJSONValueObjectAppendNumberDouble(stats, "cpu.usage",
+                                                 rates[i].rate / 1e7) < 0)
+            return false;
+    }
+
+    if (virJSONValueObjectAppendNumberLong(obj, "timestamp", timestamp) < 0 ||
+        virJSONValueObjectAppendString(obj, "domain",
+                                       virDomainGetName(record->dom)) < 0 ||
+        virJSONValueObjectAppend(obj, "stats", stats) < 0)
+        return false;
+    stats = NULL;
+
+    if (!(str = virJSONValueToString(obj, false)))
+        return false;
+
+    vshPrint(ctl, "%s\n", str);
+    return true;
+}
+
+
+static bool
+virshDomainStatsPrintRecordCSV(vshControl *ctl,
+                               virDomainStatsRecordPtr record,
+                               long long timestamp,
+                               virshDomainStatsRate *rates,
+                               size_t nrates)
+{
+    const char *name = virDomainGetName(record->dom);
+    size_t i;
+
+    for (i = 0; i < record->nparams; i++) {
+        g_autofree char *value = NULL;
+        g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+
+        if (!(value = vshGetTypedParamValue(ctl, record->params + i)))
+            return false;
+
+        /* only strings may need quoting */
+        if (record->params[i].type == VIR_TYPED_PARAM_STRING) {
+            virBufferAddChar(&buf, '"');
+            virBufferEscape(&buf, '"', "\"", "%s", value);
+            virBufferAddChar(&buf, '"');
+        } else {
+            virBufferAdd(&buf, value, -1);
+        }
+
+        vshPrint(ctl, "%lld,%s,%s,%s\n", timestamp, name,
+                 record->params[i].field, virBufferCurrentContent(&buf));
+    }
+
+    for (i = 0; i < nrates; i++) {
+        vshPrint(ctl, "%lld,%s,%s.rate,%.2f\n", timestamp, name,
+                 rates[i].field, rates[i].rate);
+        if (STREQ(rates[i].field, "cpu.time"))
+            vshPrint(ctl, "%lld,%s,cpu.usage,%.2f\n", timestamp, name,
+                     rates[i].rate / 1e7);
+    }
+
+    return true;
+}
+
+
+/* Prints @records in @format, with the rates of change of counters
+ * since @prev if given, which was collected @elapsed microseconds
+ * earlier */
+static bool
+virshDomainStatsPrintRecords(vshControl *ctl,
+                             virDomainStatsRecordPtr *records,
+                             virDomainStatsRecordPtr *prev,
+                             gint64 elapsed,
+                             virshDomainStatsFormat format,
+                             bool raw)
+{
+    g_autoptr(virHashTable) prevByUUID = NULL;
+    long long timestamp = g_get_real_time() / 1000;
+    virDomainStatsRecordPtr *next;
+
+    if (prev && elapsed > 0) {
+        if (!(prevByUUID = virHashNew(NULL)))
+            return false;
+
+        for (next = prev; *next; next++) {
+            char uuid[VIR_UUID_STRING_BUFLEN];
+
+            if (virDomainGetUUIDString((*next)->dom, uuid) < 0 ||
+                virHashAddEntry(prevByUUID, uuid, *next) < 0)
+                return false;
+        }
+    }
+
+    for (next = records; *next; next++) {
+        g_autofree virshDomainStatsRate *rates = NULL;
+        size_t nrates = 0;
+        bool ok = false;
+
+        if (prevByUUID) {
+            char uuid[VIR_UUID_STRING_BUFLEN];
+            virDomainStatsRecordPtr old;
+
+            if (virDomainGetUUIDString((*next)->dom, uuid) < 0)
+                return false;
+
+            if ((old = virHashLookup(prevByUUID, uuid)))
+                rates = virshDomainStatsGetRates(*next, old, elapsed, &nrates);
+        }
+
+        switch (format) {
+        case VIRSH_DOMAIN_STATS_FORMAT_TEXT:
+            ok = virshDomainStatsPrintRecord(ctl, *next, raw, rates, nrates);
+            if (ok && *(next + 1))
+                vshPrint(ctl, "\n");
+            break;
+        case VIRSH_DOMAIN_STATS_FORMAT_JSON:
+            ok = virshDomainStatsPrintRecordJSON(ctl, *next, timestamp,
+                                                 rates, nrates);
+            break;
+        case VIRSH_DOMAIN_STATS_FORMAT_CSV:
+            ok = virshDomainStatsPrintRecordCSV(ctl, *next, timestamp,
+                                                rates, nrates);
+            break;
+        case VIRSH_DOMAIN_STATS_FORMAT_LAST:
+            break;
+        }
+
+        if (!ok)
+            return false;
+    }
+
     return true;
 }
 
+
 static bool
 cmdDomstats(vshControl *ctl, const vshCmd *cmd)
 {
@@ -2212,13 +2546,33 @@ cmdDomstats(vshControl *ctl, const vshCmd *cmd)
     virDomainPtr dom;
     size_t ndoms = 0;
     virDomainStatsRecordPtr *records = NULL;
-    virDomainStatsRecordPtr *next;
+    virDomainStatsRecordPtr *prev = NULL;
+    gint64 then = 0;
     bool raw = vshCommandOptBool(cmd, "raw");
     int flags = 0;
+    int watch = 0;
+    const char *formatStr = NULL;
+    int format = VIRSH_DOMAIN_STATS_FORMAT_TEXT;
+    bool eventStarted = false;
     const vshCmdOpt *opt = NULL;
     bool ret = false;
     virshControlPtr priv = ctl->privData;
 
+    if (vshCommandOptInt(ctl, cmd, "watch", &watch) < 0)
+        return false;
+    if (watch < 0) {
+        vshError(ctl, "%s", _("watch interval must be positive"));
+        return false;
+    }
+
+    if (vshCommandOptStringReq(ctl, cmd, "format", &formatStr) < 0)
+        return false;
+    if (formatStr &&
+        (format = virshDomainStatsFormatTypeFromString(formatStr)) < 0) {
+        vshError(ctl, _("unknown stats format '%s'"), formatStr);
+        return false;
+    }
+
     if (vshCommandOptBool(cmd, "state"))
         stats |= VIR_DOMAIN_STATS_STATE;
 
@@ -2246,6 +2600,15 @@ cmdDomstats(vshControl *ctl, const vshCmd *cmd)
     if (vshCommandOptBool(cmd, "memory"))
         stats |= VIR_DOMAIN_STATS_MEMORY;
 
+    if (vshCommandOptBool(cmd, "monitor"))
+        stats |= VIR_DOMAIN_STATS_MONITOR;
+
+    if (vshCommandOptBool(cmd, "pressure"))
+        stats |= VIR_DOMAIN_STATS_PRESSURE;
+
+    if (vshCommandOptBool(cmd, "definition"))
+        stats |= VIR_DOMAIN_STATS_DEFINITION;
+
     if (vshCommandOptBool(cmd, "list-active"))
         flags |= VIR_CONNECT_GET_ALL_DOMAINS_STATS_ACTIVE;
 
@@ -2293,32 +2656,60 @@ cmdDomstats(vshControl *ctl, const vshCmd *cmd)
             if (VIR_INSERT_ELEMENT(domlist, ndoms - 1, ndoms, dom) < 0)
                 goto cleanup;
         }
+    }
 
-        if (virDomainListGetStats(domlist,
-                                  stats,
-                                  &records,
-                                  flags) < 0)
+    /* In watch mode the event loop timer wakes us up once per interval,
+     * or SIGINT ends watching */
+    if (watch > 0) {
+        if (vshEventStart(ctl, watch * 1000) < 0)
             goto cleanup;
-    } else {
-       if ((virConnectGetAllDomainStats(priv->conn,
-                                        stats,
-                                        &records,
-                                        flags)) < 0)
-           goto cleanup;
+        eventStarted = true;
     }
 
-    next = records;
-    while (*next) {
-        if (!virshDomainStatsPrintRecord(ctl, *next, raw))
+    while (true) {
+        gint64 now = g_get_monotonic_time();
+
+        if (domlist) {
+            if (virDomainListGetStats(domlist, stats, &records, flags) < 0)
+                goto cleanup;
+        } else {
+            if (virConnectGetAllDomainStats(priv->conn, stats,
+                                            &records, flags) < 0)
+                goto cleanup;
+        }
+
+        if (!virshDomainStatsPrintRecords(ctl, records, prev, now - then,
+                                          format, raw))
             goto cleanup;
 
-        if (*(++next))
-            vshPrint(ctl, "\n");
+        if (watch == 0)
+            break;
+
+        fflush(stdout);
+        virDomainStatsRecordListFree(prev);
+        prev = g_steal_pointer(&records);
+        then = now;
+
+        switch (vshEventWait(ctl)) {
+        case VSH_EVENT_TIMEOUT:
+            if (format == VIRSH_DOMAIN_STATS_FORMAT_TEXT)
+                vshPrint(ctl, "\n");
+            continue;
+        case VSH_EVENT_INTERRUPT:
+        case VSH_EVENT_DONE:
+            break;
+        default:
+            goto cleanup;
+        }
+        break;
     }
 
     ret = true;
  cleanup:
+    if (eventStarted)
+        vshEventCleanup(ctl);
     virDomainStatsRecordListFree(records);
+    virDomainStatsRecordListFree(prev);
     virObjectListFree(domlist);
 
     return ret;
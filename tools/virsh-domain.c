@@ -145,6 +145,22 @@ static const vshCmdOptDef opts_attach_device[] = {
     {.name = NULL}
 };
 
+/*
+ * Returns 1 if @xml is a list of devices in a <devices> element, 0 if it's
+ * a single device, -1 if it isn't valid XML.
+ */
+static int
+virshDeviceXMLIsList(const char *xml)
+{
+    g_autoptr(xmlDoc) doc = NULL;
+    g_autoptr(xmlXPathContext) ctxt = NULL;
+
+    if (!(doc = virXMLParseStringCtxt(xml, _("(device_definition)"), &ctxt)))
+        return -1;
+
+    return virXMLNodeNameEqual(ctxt->node, "devices") ? 1 : 0;
+}
+
 static bool
 cmdAttachDevice(vshControl *ctl, const vshCmd *cmd)
 {
@@ -184,7 +200,15 @@ cmdAttachDevice(vshControl *ctl, const vshCmd *cmd)
         goto cleanup;
     }
 
-    if (flags || current)
+    if ((rv = virshDeviceXMLIsList(buffer)) < 0) {
+        vshReportError(ctl);
+        VIR_FREE(buffer);
+        goto cleanup;
+    }
+
+    if (rv == 1)
+        rv = virDomainAttachDevices(dom, buffer, flags);
+    else if (flags || current)
         rv = virDomainAttachDeviceFlags(dom, buffer, flags);
     else
         rv = virDomainAttachDevice(dom, buffer);
@@ -5978,6 +6002,101 @@ cmdShutdown(vshControl *ctl, const vshCmd *cmd)
     return ret;
 }
 
+/*
+ * "shutdown-domains" command
+ */
+static const vshCmdInfo info_shutdown_domains[] = {
+    {.name = "help",
+     .data = N_("gracefully shutdown several domains")
+    },
+    {.name = "desc",
+     .data = N_("Shutdown or save several domains at once and wait until "
+                "they are no longer running.")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_shutdown_domains[] = {
+    {.name = "managed-save",
+     .type = VSH_OT_BOOL,
+     .help = N_("managed save the domains instead of shutting them down")
+    },
+    {.name = "bypass-cache",
+     .type = VSH_OT_BOOL,
+     .help = N_("avoid file system cache when saving")
+    },
+    {.name = "timeout",
+     .type = VSH_OT_INT,
+     .help = N_("seconds to wait for the domains to shut down")
+    },
+    {.name = "destroy",
+     .type = VSH_OT_BOOL,
+     .help = N_("destroy domains still running when the timeout expires")
+    },
+    VIRSH_COMMON_OPT_DOMAIN_OT_ARGV(N_("list of domains to shutdown"),
+                                    VIR_CONNECT_LIST_DOMAINS_ACTIVE),
+    {.name = NULL}
+};
+
+static bool
+cmdShutdownDomains(vshControl *ctl, const vshCmd *cmd)
+{
+    virDomainPtr dom = NULL;
+    virDomainPtr *domlist = NULL;
+    size_t ndoms = 0;
+    const vshCmdOpt *opt = NULL;
+    unsigned int timeout = 0;
+    unsigned int flags = 0;
+    bool ret = false;
+
+    VSH_EXCLUSIVE_OPTIONS("managed-save", "destroy");
+    VSH_EXCLUSIVE_OPTIONS("managed-save", "timeout");
+    VSH_REQUIRE_OPTION("bypass-cache", "managed-save");
+    VSH_REQUIRE_OPTION("destroy", "timeout");
+
+    if (vshCommandOptUInt(ctl, cmd, "timeout", &timeout) < 0)
+        return false;
+
+    if (vshCommandOptBool(cmd, "managed-save"))
+        flags |= VIR_DOMAIN_LIST_SHUTDOWN_MANAGED_SAVE;
+    if (vshCommandOptBool(cmd, "bypass-cache"))
+        flags |= VIR_DOMAIN_LIST_SHUTDOWN_BYPASS_CACHE;
+    if (vshCommandOptBool(cmd, "destroy"))
+        flags |= VIR_DOMAIN_LIST_SHUTDOWN_DESTROY;
+
+    if (VIR_ALLOC_N(domlist, 1) < 0)
+        goto cleanup;
+    ndoms = 1;
+
+    while ((opt = vshCommandOptArgv(ctl, cmd, opt))) {
+        if (!(dom = virshLookupDomainBy(ctl, opt->data,
+                                        VIRSH_BYID |
+                                        VIRSH_BYUUID | VIRSH_BYNAME)))
+            goto cleanup;
+
+        if (VIR_INSERT_ELEMENT(domlist, ndoms - 1, ndoms, dom) < 0)
+            goto cleanup;
+    }
+
+    if (ndoms == 1) {
+        vshError(ctl, "%s", _("no domains to shutdown"));
+        goto cleanup;
+    }
+
+    if (virDomainListShutdown(domlist, timeout, flags) < 0)
+        goto cleanup;
+
+    if (flags & VIR_DOMAIN_LIST_SHUTDOWN_MANAGED_SAVE)
+        vshPrintExtra(ctl, _("Saved %zu domains\n"), ndoms - 1);
+    else
+        vshPrintExtra(ctl, _("Shut down %zu domains\n"), ndoms - 1);
+    ret = true;
+
+ cleanup:
+    virObjectListFree(domlist);
+    return ret;
+}
+
 /*
  * "reboot" command
  */
@@ -6206,6 +6325,24 @@ virshDomainJobStatsToDomainJobInfo(virTypedParameterPtr params,
 }
 
 
+static const struct {
+    const char *field;
+    const char *label;
+} virshDomainJobStartPhases[] = {
+    { VIR_DOMAIN_JOB_START_TIME_INIT, N_("Start init:") },
+    { VIR_DOMAIN_JOB_START_TIME_PREPARE_DOMAIN, N_("Start prepare domain:") },
+    { VIR_DOMAIN_JOB_START_TIME_PREPARE_HOST, N_("Start prepare host:") },
+    { VIR_DOMAIN_JOB_START_TIME_HOSTDEV, N_("Start host devices:") },
+    { VIR_DOMAIN_JOB_START_TIME_LAUNCH, N_("Start launch:") },
+    { VIR_DOMAIN_JOB_START_TIME_EXEC, N_("Start exec:") },
+    { VIR_DOMAIN_JOB_START_TIME_CGROUP, N_("Start cgroup:") },
+    { VIR_DOMAIN_JOB_START_TIME_SECURITY_LABEL, N_("Start security labels:") },
+    { VIR_DOMAIN_JOB_START_TIME_MONITOR, N_("Start monitor:") },
+    { VIR_DOMAIN_JOB_START_TIME_REFRESH_STATE, N_("Start refresh state:") },
+    { VIR_DOMAIN_JOB_START_TIME_FINISH_STARTUP, N_("Start finish:") },
+};
+
+
 static bool
 cmdDomjobinfo(vshControl *ctl, const vshCmd *cmd)
 {
@@ -6500,6 +6637,17 @@ cmdDomjobinfo(vshControl *ctl, const vshCmd *cmd)
         vshPrint(ctl, "%-17s %-.3lf %s\n", _("Temporary disk space total:"), val, unit);
     }
 
+    for (i = 0; i < G_N_ELEMENTS(virshDomainJobStartPhases); i++) {
+        if ((rc = virTypedParamsGetULLong(params, nparams,
+                                          virshDomainJobStartPhases[i].field,
+                                          &value)) < 0) {
+            goto save_error;
+        } else if (rc) {
+            vshPrint(ctl, "%-17s %-12llu ms\n",
+                     _(virshDomainJobStartPhases[i].label), value);
+        }
+    }
+
     if ((rc = virTypedParamsGetString(params, nparams, VIR_DOMAIN_JOB_ERRMSG,
                                       &svalue)) < 0) {
         goto save_error;
@@ -10211,6 +10359,58 @@ cmdDumpXML(vshControl *ctl, const vshCmd *cmd)
     return ret;
 }
 
+/*
+ * "domxml-digest" command
+ */
+static const vshCmdInfo info_domxmldigest[] = {
+    {.name = "help",
+     .data = N_("digest of domain XML")
+    },
+    {.name = "desc",
+     .data = N_("Output the digest and the generation of the domain "
+                "definition, which change whenever its XML does.")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_domxmldigest[] = {
+    VIRSH_COMMON_OPT_DOMAIN_FULL(0),
+    {.name = "inactive",
+     .type = VSH_OT_BOOL,
+     .help = N_("digest of inactive defined XML")
+    },
+    {.name = NULL}
+};
+
+static bool
+cmdDomXMLDigest(vshControl *ctl, const vshCmd *cmd)
+{
+    virDomainPtr dom;
+    bool ret = false;
+    unsigned long long generation;
+    char *digest = NULL;
+    unsigned int flags = 0;
+
+    if (vshCommandOptBool(cmd, "inactive"))
+        flags |= VIR_DOMAIN_XML_INACTIVE;
+
+    if (!(dom = virshCommandOptDomain(ctl, cmd, NULL)))
+        return false;
+
+    if (virDomainGetXMLDigest(dom, &generation, &digest, flags) < 0)
+        goto cleanup;
+
+    vshPrint(ctl, "%-15s %llu\n", _("Generation:"), generation);
+    vshPrint(ctl, "%-15s %s\n", _("Digest:"), NULLSTR_MINUS(digest));
+
+    ret = true;
+
+ cleanup:
+    VIR_FREE(digest);
+    virshDomainFree(dom);
+    return ret;
+}
+
 /*
  * "domxml-from-native" command
  */
@@ -11158,6 +11358,176 @@ cmdMigrate(vshControl *ctl, const vshCmd *cmd)
     return !data.ret;
 }
 
+/*
+ * "migrate-domains" command
+ */
+static const vshCmdInfo info_migrate_domains[] = {
+    {.name = "help",
+     .data = N_("migrate several domains to another host")
+    },
+    {.name = "desc",
+     .data = N_("Migrate several domains to another host using peer-to-peer "
+                "migration scheduled by the source host.")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_migrate_domains[] = {
+    {.name = "desturi",
+     .type = VSH_OT_DATA,
+     .flags = VSH_OFLAG_REQ,
+     .help = N_("connection URI of the destination host as seen from the source")
+    },
+    VIRSH_COMMON_OPT_LIVE(N_("live migration")),
+    {.name = "tunnelled",
+     .type = VSH_OT_BOOL,
+     .help = N_("tunnelled migration")
+    },
+    {.name = "persistent",
+     .type = VSH_OT_BOOL,
+     .help = N_("persist VMs on destination")
+    },
+    {.name = "undefinesource",
+     .type = VSH_OT_BOOL,
+     .help = N_("undefine VMs on source")
+    },
+    {.name = "copy-storage-all",
+     .type = VSH_OT_BOOL,
+     .help = N_("migration with non-shared storage with full disk copy")
+    },
+    {.name = "copy-storage-inc",
+     .type = VSH_OT_BOOL,
+     .help = N_("migration with non-shared storage with incremental copy (same base image shared between source and destination)")
+    },
+    {.name = "compressed",
+     .type = VSH_OT_BOOL,
+     .help = N_("compress repeated pages during live migration")
+    },
+    {.name = "auto-converge",
+     .type = VSH_OT_BOOL,
+     .help = N_("force convergence during live migration")
+    },
+    {.name = "abort-on-error",
+     .type = VSH_OT_BOOL,
+     .help = N_("abort on soft errors during migration")
+    },
+    {.name = "postcopy",
+     .type = VSH_OT_BOOL,
+     .help = N_("enable post-copy migration")
+    },
+    {.name = "parallel",
+     .type = VSH_OT_BOOL,
+     .help = N_("enable parallel migration")
+    },
+    {.name = "bandwidth",
+     .type = VSH_OT_INT,
+     .help = N_("total migration bandwidth limit in MiB/s")
+    },
+    {.name = "parallel-domains",
+     .type = VSH_OT_INT,
+     .help = N_("number of domains migrated at the same time")
+    },
+    VIRSH_COMMON_OPT_DOMAIN_OT_ARGV(N_("list of domains to migrate"),
+                                    VIR_CONNECT_LIST_DOMAINS_ACTIVE),
+    {.name = NULL}
+};
+
+static bool
+cmdMigrateDomains(vshControl *ctl, const vshCmd *cmd)
+{
+    virDomainPtr dom = NULL;
+    virDomainPtr *domlist = NULL;
+    size_t ndoms = 0;
+    const vshCmdOpt *opt = NULL;
+    const char *desturi = NULL;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    int maxparams = 0;
+    unsigned long long ullOpt = 0;
+    unsigned int uintOpt = 0;
+    unsigned int flags = VIR_MIGRATE_PEER2PEER;
+    int rv;
+    bool ret = false;
+
+    if (vshCommandOptStringReq(ctl, cmd, "desturi", &desturi) < 0)
+        return false;
+
+    if ((rv = vshCommandOptULongLong(ctl, cmd, "bandwidth", &ullOpt)) < 0) {
+        goto cleanup;
+    } else if (rv > 0) {
+        if (virTypedParamsAddULLong(&params, &nparams, &maxparams,
+                                    VIR_MIGRATE_PARAM_BANDWIDTH,
+                                    ullOpt) < 0)
+            goto save_error;
+    }
+
+    if ((rv = vshCommandOptUInt(ctl, cmd, "parallel-domains", &uintOpt)) < 0) {
+        goto cleanup;
+    } else if (rv > 0) {
+        if (virTypedParamsAddUInt(&params, &nparams, &maxparams,
+                                  VIR_MIGRATE_PARAM_PARALLEL_DOMAINS,
+                                  uintOpt) < 0)
+            goto save_error;
+    }
+
+    if (vshCommandOptBool(cmd, "live"))
+        flags |= VIR_MIGRATE_LIVE;
+    if (vshCommandOptBool(cmd, "tunnelled"))
+        flags |= VIR_MIGRATE_TUNNELLED;
+    if (vshCommandOptBool(cmd, "persistent"))
+        flags |= VIR_MIGRATE_PERSIST_DEST;
+    if (vshCommandOptBool(cmd, "undefinesource"))
+        flags |= VIR_MIGRATE_UNDEFINE_SOURCE;
+    if (vshCommandOptBool(cmd, "copy-storage-all"))
+        flags |= VIR_MIGRATE_NON_SHARED_DISK;
+    if (vshCommandOptBool(cmd, "copy-storage-inc"))
+        flags |= VIR_MIGRATE_NON_SHARED_INC;
+    if (vshCommandOptBool(cmd, "compressed"))
+        flags |= VIR_MIGRATE_COMPRESSED;
+    if (vshCommandOptBool(cmd, "auto-converge"))
+        flags |= VIR_MIGRATE_AUTO_CONVERGE;
+    if (vshCommandOptBool(cmd, "abort-on-error"))
+        flags |= VIR_MIGRATE_ABORT_ON_ERROR;
+    if (vshCommandOptBool(cmd, "postcopy"))
+        flags |= VIR_MIGRATE_POSTCOPY;
+    if (vshCommandOptBool(cmd, "parallel"))
+        flags |= VIR_MIGRATE_PARALLEL;
+
+    if (VIR_ALLOC_N(domlist, 1) < 0)
+        goto cleanup;
+    ndoms = 1;
+
+    while ((opt = vshCommandOptArgv(ctl, cmd, opt))) {
+        if (!(dom = virshLookupDomainBy(ctl, opt->data,
+                                        VIRSH_BYID |
+                                        VIRSH_BYUUID | VIRSH_BYNAME)))
+            goto cleanup;
+
+        if (VIR_INSERT_ELEMENT(domlist, ndoms - 1, ndoms, dom) < 0)
+            goto cleanup;
+    }
+
+    if (ndoms == 1) {
+        vshError(ctl, "%s", _("no domains to migrate"));
+        goto cleanup;
+    }
+
+    if (virDomainListMigrate(domlist, desturi, params, nparams, flags) < 0)
+        goto cleanup;
+
+    vshPrintExtra(ctl, _("Migrated %zu domains\n"), ndoms - 1);
+    ret = true;
+
+ cleanup:
+    virTypedParamsFree(params, nparams);
+    virObjectListFree(domlist);
+    return ret;
+
+ save_error:
+    vshSaveLibvirtError();
+    goto cleanup;
+}
+
 /*
  * "migrate-setmaxdowntime" command
  */
@@ -12084,7 +12454,14 @@ cmdDetachDevice(vshControl *ctl, const vshCmd *cmd)
         goto cleanup;
     }
 
-    if (flags != 0 || current)
+    if ((ret = virshDeviceXMLIsList(buffer)) < 0) {
+        vshReportError(ctl);
+        goto cleanup;
+    }
+
+    if (ret == 1)
+        ret = virDomainDetachDevices(dom, buffer, flags);
+    else if (flags != 0 || current)
         ret = virDomainDetachDeviceFlags(dom, buffer, flags);
     else
         ret = virDomainDetachDevice(dom, buffer);
@@ -13565,6 +13942,30 @@ virshEventBlockThresholdPrint(virConnectPtr conn G_GNUC_UNUSED,
 }
 
 
+static void
+virshEventStatsPrint(virConnectPtr conn G_GNUC_UNUSED,
+                     virDomainPtr dom,
+                     virTypedParameterPtr params,
+                     int nparams,
+                     void *opaque)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+    char *value;
+
+    virBufferAsprintf(&buf, _("event 'stats' for domain %s:\n"),
+                      virDomainGetName(dom));
+    for (i = 0; i < nparams; i++) {
+        value = virTypedParameterToString(&params[i]);
+        if (value) {
+            virBufferAsprintf(&buf, "\t%s: %s\n", params[i].field, value);
+            VIR_FREE(value);
+        }
+    }
+    virshEventPrint(opaque, &buf);
+}
+
+
 virshDomainEventCallback virshDomainEventCallbacks[] = {
     { "lifecycle",
       VIR_DOMAIN_EVENT_CALLBACK(virshEventLifecyclePrint), },
@@ -13614,6 +14015,8 @@ virshDomainEventCallback virshDomainEventCallbacks[] = {
       VIR_DOMAIN_EVENT_CALLBACK(virshEventMetadataChangePrint), },
     { "block-threshold",
       VIR_DOMAIN_EVENT_CALLBACK(virshEventBlockThresholdPrint), },
+    { "stats",
+      VIR_DOMAIN_EVENT_CALLBACK(virshEventStatsPrint), },
 };
 G_STATIC_ASSERT(VIR_DOMAIN_EVENT_ID_LAST == G_N_ELEMENTS(virshDomainEventCallbacks));
 
@@ -14561,6 +14964,12 @@ const vshCmdDef domManagementCmds[] = {
      .info = info_dumpxml,
      .flags = 0
     },
+    {.name = "domxml-digest",
+     .handler = cmdDomXMLDigest,
+     .opts = opts_domxmldigest,
+     .info = info_domxmldigest,
+     .flags = 0
+    },
     {.name = "edit",
      .handler = cmdEdit,
      .opts = opts_edit,
@@ -14681,6 +15090,12 @@ const vshCmdDef domManagementCmds[] = {
      .info = info_migrate,
      .flags = 0
     },
+    {.name = "migrate-domains",
+     .handler = cmdMigrateDomains,
+     .opts = opts_migrate_domains,
+     .info = info_migrate_domains,
+     .flags = 0
+    },
     {.name = "migrate-setmaxdowntime",
      .handler = cmdMigrateSetMaxDowntime,
      .opts = opts_migrate_setmaxdowntime,
@@ -14849,6 +15264,12 @@ const vshCmdDef domManagementCmds[] = {
      .info = info_shutdown,
      .flags = 0
     },
+    {.name = "shutdown-domains",
+     .handler = cmdShutdownDomains,
+     .opts = opts_shutdown_domains,
+     .info = info_shutdown_domains,
+     .flags = 0
+    },
     {.name = "start",
      .handler = cmdStart,
      .opts = opts_start,
@@ -660,9 +660,167 @@ static const vshCmdOptDef opts_vol_upload[] = {
      .type = VSH_OT_BOOL,
      .help = N_("preserve sparseness of volume")
     },
+    {.name = "parallel",
+     .type = VSH_OT_INT,
+     .help = N_("number of streams to upload the file with in parallel")
+    },
     {.name = NULL}
 };
 
+
+/* Split parallel uploads at multiples of this size */
+#define VIRSH_VOL_UPLOAD_ALIGN (1024 * 1024)
+
+typedef struct _virshVolUploadRange virshVolUploadRange;
+typedef virshVolUploadRange *virshVolUploadRangePtr;
+struct _virshVolUploadRange {
+    vshControl *ctl;
+    virStorageVolPtr vol;
+    const char *name;
+    int fd;
+    unsigned long long offset; /* volume offset of the file start */
+    unsigned long long start; /* of this range within the file */
+    unsigned long long length;
+    unsigned long long sent;
+    bool ok;
+    virThread thread;
+};
+
+
+static int
+virshVolUploadRangeSource(virStreamPtr st G_GNUC_UNUSED,
+                          char *bytes,
+                          size_t nbytes,
+                          void *opaque)
+{
+    virshVolUploadRangePtr range = opaque;
+    ssize_t got;
+
+    if (nbytes > range->length - range->sent)
+        nbytes = range->length - range->sent;
+
+    if (nbytes == 0)
+        return 0;
+
+    /* All ranges share the file descriptor, so they can't rely on
+     * its offset */
+    do {
+        got = pread(range->fd, bytes, nbytes, range->start + range->sent);
+    } while (got < 0 && errno == EINTR);
+
+    if (got > 0)
+        range->sent += got;
+
+    return got;
+}
+
+
+static void
+virshVolUploadRangeWorker(void *opaque)
+{
+    virshVolUploadRangePtr range = opaque;
+    virshControlPtr priv = range->ctl->privData;
+    virStreamPtr st = NULL;
+
+    if (!(st = virStreamNew(priv->conn, VIR_STREAM_LARGE_PACKETS))) {
+        vshError(range->ctl, _("cannot create a new stream"));
+        return;
+    }
+
+    if (virStorageVolUpload(range->vol, st, range->offset + range->start,
+                            range->length, 0) < 0) {
+        vshError(range->ctl, _("cannot upload to volume %s"), range->name);
+        goto cleanup;
+    }
+
+    if (virStreamSendAll(st, virshVolUploadRangeSource, range) < 0) {
+        vshError(range->ctl, _("cannot send data to volume %s"), range->name);
+        goto cleanup;
+    }
+
+    if (virStreamFinish(st) < 0) {
+        vshError(range->ctl, _("cannot close volume %s"), range->name);
+        goto cleanup;
+    }
+
+    range->ok = true;
+
+ cleanup:
+    virStreamFree(st);
+}
+
+
+/*
+ * Upload @fd into @vol using @nstreams streams, each of which covers
+ * its own part of the file. The streams are independent, so the
+ * daemon reads and writes the parts concurrently.
+ */
+static bool
+virshVolUploadParallel(vshControl *ctl,
+                       virStorageVolPtr vol,
+                       const char *name,
+                       const char *file,
+                       int fd,
+                       unsigned long long offset,
+                       unsigned long long length,
+                       unsigned int nstreams)
+{
+    g_autofree virshVolUploadRangePtr ranges = NULL;
+    unsigned long long size;
+    unsigned long long chunk;
+    struct stat sb;
+    size_t nranges = 0;
+    size_t i;
+    bool ret = true;
+
+    if (fstat(fd, &sb) < 0 || !S_ISREG(sb.st_mode)) {
+        vshError(ctl, _("parallel upload needs a regular file, '%s' isn't"),
+                 file);
+        return false;
+    }
+    size = sb.st_size;
+
+    if (length && size > length) {
+        vshError(ctl, _("file '%s' is larger than the requested length"),
+                 file);
+        return false;
+    }
+
+    chunk = VIR_DIV_UP(size, nstreams);
+    chunk = VIR_ROUND_UP(chunk, VIRSH_VOL_UPLOAD_ALIGN);
+
+    ranges = g_new0(virshVolUploadRange, nstreams);
+
+    for (i = 0; i < nstreams && (i == 0 || i * chunk < size); i++) {
+        virshVolUploadRangePtr range = &ranges[nranges];
+
+        range->ctl = ctl;
+        range->vol = vol;
+        range->name = name;
+        range->fd = fd;
+        range->offset = offset;
+        range->start = i * chunk;
+        range->length = MIN(chunk, size - range->start);
+
+        if (virThreadCreate(&range->thread, true,
+                            virshVolUploadRangeWorker, range) < 0) {
+            vshError(ctl, "%s", _("cannot create upload thread"));
+            ret = false;
+            break;
+        }
+        nranges++;
+    }
+
+    for (i = 0; i < nranges; i++) {
+        virThreadJoin(&ranges[i].thread);
+        if (!ranges[i].ok)
+            ret = false;
+    }
+
+    return ret;
+}
+
+
 static bool
 cmdVolUpload(vshControl *ctl, const vshCmd *cmd)
 {
@@ -675,14 +833,20 @@ cmdVolUpload(vshControl *ctl, const vshCmd *cmd)
     unsigned long long offset = 0, length = 0;
     virshControlPtr priv = ctl->privData;
     unsigned int flags = 0;
+    unsigned int parallel = 0;
     virshStreamCallbackData cbData;
 
+    VSH_EXCLUSIVE_OPTIONS("sparse", "parallel");
+
     if (vshCommandOptULongLong(ctl, cmd, "offset", &offset) < 0)
         return false;
 
     if (vshCommandOptULongLongWrap(ctl, cmd, "length", &length) < 0)
         return false;
 
+    if (vshCommandOptUInt(ctl, cmd, "parallel", &parallel) < 0)
+        return false;
+
     if (!(vol = virshCommandOptVol(ctl, cmd, "vol", "pool", &name)))
         return false;
 
@@ -694,13 +858,19 @@ cmdVolUpload(vshControl *ctl, const vshCmd *cmd)
         goto cleanup;
     }
 
+    if (parallel > 1) {
+        ret = virshVolUploadParallel(ctl, vol, name, file, fd,
+                                     offset, length, parallel);
+        goto cleanup;
+    }
+
     cbData.ctl = ctl;
     cbData.fd = fd;
 
     if (vshCommandOptBool(cmd, "sparse"))
         flags |= VIR_STORAGE_VOL_UPLOAD_SPARSE_STREAM;
 
-    if (!(st = virStreamNew(priv->conn, 0))) {
+    if (!(st = virStreamNew(priv->conn, VIR_STREAM_LARGE_PACKETS))) {
         vshError(ctl, _("cannot create a new stream"));
         goto cleanup;
     }
@@ -817,7 +987,7 @@ cmdVolDownload(vshControl *ctl, const vshCmd *cmd)
         created = true;
     }
 
-    if (!(st = virStreamNew(priv->conn, 0))) {
+    if (!(st = virStreamNew(priv->conn, VIR_STREAM_LARGE_PACKETS))) {
         vshError(ctl, _("cannot create a new stream"));
         goto cleanup;
     }
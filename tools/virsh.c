@@ -448,6 +448,9 @@ virshUsage(void)
     fprintf(stdout, _("\n%s [options]... [<command_string>]"
                       "\n%s [options]... <command> [args...]\n\n"
                       "  options:\n"
+                      "    -b | --batch[=NUM]      read commands from stdin and run NUM\n"
+                      "                            of them concurrently (default 1)\n"
+                      "         --batch-json       print results of batch mode as JSON\n"
                       "    -c | --connect=URI      hypervisor connection URI\n"
                       "    -d | --debug=NUM        debug level [0-4]\n"
                       "    -e | --escape <char>    set escape sequence for console\n"
@@ -645,7 +648,10 @@ virshParseArgv(vshControl *ctl, int argc, char **argv)
     size_t i;
     int longindex = -1;
     virshControlPtr priv = ctl->privData;
+    unsigned int jobs;
     struct option opt[] = {
+        {"batch", optional_argument, NULL, 'b'},
+        {"batch-json", no_argument, NULL, 'J'},
         {"connect", required_argument, NULL, 'c'},
         {"debug", required_argument, NULL, 'd'},
         {"escape", required_argument, NULL, 'e'},
@@ -663,8 +669,22 @@ virshParseArgv(vshControl *ctl, int argc, char **argv)
     /* Standard (non-command) options. The leading + ensures that no
      * argument reordering takes place, so that command options are
      * not confused with top-level virsh options. */
-    while ((arg = getopt_long(argc, argv, "+:c:d:e:hk:K:l:qrtvV", opt, &longindex)) != -1) {
+    while ((arg = getopt_long(argc, argv, "+:b::c:d:e:hk:K:l:qrtvV", opt, &longindex)) != -1) {
         switch (arg) {
+        case 'b':
+            jobs = 1;
+            if (optarg &&
+                (virStrToLong_ui(optarg, NULL, 10, &jobs) < 0 || jobs == 0)) {
+                vshError(ctl,
+                         _("option %s requires a positive integer argument"),
+                         longindex == -1 ? "-b" : "--batch");
+                exit(EXIT_FAILURE);
+            }
+            ctl->batchJobs = jobs;
+            break;
+        case 'J':
+            ctl->batchJSON = true;
+            break;
         case 'c':
             VIR_FREE(ctl->connname);
             ctl->connname = g_strdup(optarg);
@@ -777,7 +797,19 @@ virshParseArgv(vshControl *ctl, int argc, char **argv)
         longindex = -1;
     }
 
-    if (argc == optind) {
+    if (ctl->batchJSON && !ctl->batchJobs) {
+        vshError(ctl, "%s", _("option --batch-json requires --batch"));
+        exit(EXIT_FAILURE);
+    }
+
+    if (ctl->batchJobs) {
+        if (argc != optind) {
+            vshError(ctl, "%s",
+                     _("commands can't be given on the command line in batch mode"));
+            exit(EXIT_FAILURE);
+        }
+        ctl->imode = false;
+    } else if (argc == optind) {
         ctl->imode = true;
     } else {
         /* parse command */
@@ -899,7 +931,9 @@ main(int argc, char **argv)
     if (!ctl->connname)
         ctl->connname = g_strdup(getenv("VIRSH_DEFAULT_CONNECT_URI"));
 
-    if (!ctl->imode) {
+    if (ctl->batchJobs) {
+        ret = vshBatchRun(ctl, stdin);
+    } else if (!ctl->imode) {
         ret = vshCommandRun(ctl, ctl->cmd);
     } else {
         /* interactive mode */
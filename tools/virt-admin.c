@@ -475,6 +475,11 @@ static const vshCmdOptDef opts_srv_threadpool_set[] = {
      .type = VSH_OT_INT,
      .help = N_("Change the current number of priority workers"),
     },
+    {.name = "target-latency",
+     .type = VSH_OT_INT,
+     .help = N_("Change the queue wait in microseconds the number of "
+                "workers is adapted to, 0 to disable"),
+    },
     {.name = NULL}
 };
 
@@ -507,13 +512,14 @@ cmdSrvThreadpoolSet(vshControl *ctl, const vshCmd *cmd)
     PARSE_CMD_TYPED_PARAM("max-workers", VIR_THREADPOOL_WORKERS_MAX);
     PARSE_CMD_TYPED_PARAM("min-workers", VIR_THREADPOOL_WORKERS_MIN);
     PARSE_CMD_TYPED_PARAM("priority-workers", VIR_THREADPOOL_WORKERS_PRIORITY);
+    PARSE_CMD_TYPED_PARAM("target-latency", VIR_THREADPOOL_TARGET_LATENCY);
 
 #undef PARSE_CMD_TYPED_PARAM
 
     if (!nparams) {
         vshError(ctl, "%s",
                  _("At least one of options --min-workers, --max-workers, "
-                   "--priority-workers is mandatory "));
+                   "--priority-workers, --target-latency is mandatory "));
             goto cleanup;
     }
 
@@ -851,6 +857,179 @@ cmdSrvClientsInfo(vshControl *ctl, const vshCmd *cmd)
     return ret;
 }
 
+/* ---------------------
+ * Command server-stats
+ * ---------------------
+ */
+
+static const vshCmdInfo info_srv_stats[] = {
+    {.name = "help",
+     .data = N_("get server's per-procedure RPC statistics")
+    },
+    {.name = "desc",
+     .data = N_("Retrieve call counts, error counts, traffic and approximate "
+                "latency percentiles for each RPC procedure handled by server")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_srv_stats[] = {
+    {.name = "server",
+     .type = VSH_OT_DATA,
+     .flags = VSH_OFLAG_REQ,
+     .completer = vshAdmServerCompleter,
+     .help = N_("Server to retrieve the RPC statistics from."),
+    },
+    {.name = NULL}
+};
+
+/* The daemon reports log2 buckets, with only the non-empty ones present */
+#define VSH_ADM_RPC_STATS_BUCKETS 24
+
+/* Returns the upper bound in microseconds of the histogram bucket
+ * containing the @pct percentile of the procedure's samples. */
+static unsigned long long
+vshAdmRPCStatsPercentile(virTypedParameterPtr params,
+                         int nparams,
+                         size_t idx,
+                         const char *hist,
+                         unsigned long long calls,
+                         unsigned int pct)
+{
+    unsigned long long target = (calls * pct + 99) / 100;
+    unsigned long long seen = 0;
+    size_t j;
+
+    for (j = 0; j < VSH_ADM_RPC_STATS_BUCKETS; j++) {
+        g_autofree char *field = NULL;
+        unsigned long long val = 0;
+
+        field = g_strdup_printf("proc.%zu.%s.%zu", idx, hist, j);
+        if (virTypedParamsGetULLong(params, nparams, field, &val) < 0)
+            return 0;
+
+        seen += val;
+        if (seen && seen >= target)
+            return 1ULL << j;
+    }
+
+    return 0;
+}
+
+static bool
+cmdSrvStats(vshControl *ctl, const vshCmd *cmd)
+{
+    bool ret = false;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    unsigned int count = 0;
+    size_t i;
+    const char *srvname = NULL;
+    virAdmServerPtr srv = NULL;
+    vshAdmControlPtr priv = ctl->privData;
+    vshTablePtr table = NULL;
+
+    if (vshCommandOptStringReq(ctl, cmd, "server", &srvname) < 0)
+        return false;
+
+    if (!(srv = virAdmConnectLookupServer(priv->conn, srvname, 0)))
+        goto cleanup;
+
+    if (virAdmServerGetRPCStats(srv, &params, &nparams, 0) < 0) {
+        vshError(ctl, "%s", _("Unable to retrieve RPC statistics "
+                              "from the server"));
+        goto cleanup;
+    }
+
+    if (virTypedParamsGetUInt(params, nparams,
+                              VIR_SERVER_RPC_STATS_COUNT, &count) < 0)
+        goto cleanup;
+
+    table = vshTableNew(_("Program"), _("Procedure"), _("Calls"), _("Errors"),
+                        _("Bytes in"), _("Bytes out"),
+                        _("Queue p50 (us)"), _("Queue p99 (us)"),
+                        _("Exec p50 (us)"), _("Exec p99 (us)"), NULL);
+    if (!table)
+        goto cleanup;
+
+    for (i = 0; i < count; i++) {
+        char field[VIR_TYPED_PARAM_FIELD_LENGTH];
+        unsigned int program = 0;
+        int procedure = 0;
+        unsigned long long calls = 0;
+        unsigned long long errors = 0;
+        unsigned long long bytesIn = 0;
+        unsigned long long bytesOut = 0;
+        g_autofree char *programStr = NULL;
+        g_autofree char *procedureStr = NULL;
+        g_autofree char *callsStr = NULL;
+        g_autofree char *errorsStr = NULL;
+        g_autofree char *bytesInStr = NULL;
+        g_autofree char *bytesOutStr = NULL;
+        g_autofree char *queue50 = NULL;
+        g_autofree char *queue99 = NULL;
+        g_autofree char *exec50 = NULL;
+        g_autofree char *exec99 = NULL;
+
+        g_snprintf(field, sizeof(field), "proc.%zu.program", i);
+        if (virTypedParamsGetUInt(params, nparams, field, &program) < 0)
+            goto cleanup;
+        g_snprintf(field, sizeof(field), "proc.%zu.procedure", i);
+        if (virTypedParamsGetInt(params, nparams, field, &procedure) < 0)
+            goto cleanup;
+        g_snprintf(field, sizeof(field), "proc.%zu.calls", i);
+        if (virTypedParamsGetULLong(params, nparams, field, &calls) < 0)
+            goto cleanup;
+        g_snprintf(field, sizeof(field), "proc.%zu.errors", i);
+        if (virTypedParamsGetULLong(params, nparams, field, &errors) < 0)
+            goto cleanup;
+        g_snprintf(field, sizeof(field), "proc.%zu.bytes_in", i);
+        if (virTypedParamsGetULLong(params, nparams, field, &bytesIn) < 0)
+            goto cleanup;
+        g_snprintf(field, sizeof(field), "proc.%zu.bytes_out", i);
+        if (virTypedParamsGetULLong(params, nparams, field, &bytesOut) < 0)
+            goto cleanup;
+
+        programStr = g_strdup_printf("0x%x", program);
+        procedureStr = g_strdup_printf("%d", procedure);
+        callsStr = g_strdup_printf("%llu", calls);
+        errorsStr = g_strdup_printf("%llu", errors);
+        bytesInStr = g_strdup_printf("%llu", bytesIn);
+        bytesOutStr = g_strdup_printf("%llu", bytesOut);
+        queue50 = g_strdup_printf("%llu",
+                                  vshAdmRPCStatsPercentile(params, nparams, i,
+                                                           "queue_time",
+                                                           calls, 50));
+        queue99 = g_strdup_printf("%llu",
+                                  vshAdmRPCStatsPercentile(params, nparams, i,
+                                                           "queue_time",
+                                                           calls, 99));
+        exec50 = g_strdup_printf("%llu",
+                                 vshAdmRPCStatsPercentile(params, nparams, i,
+                                                          "exec_time",
+                                                          calls, 50));
+        exec99 = g_strdup_printf("%llu",
+                                 vshAdmRPCStatsPercentile(params, nparams, i,
+                                                          "exec_time",
+                                                          calls, 99));
+
+        if (vshTableRowAppend(table, programStr, procedureStr,
+                              callsStr, errorsStr, bytesInStr, bytesOutStr,
+                              queue50, queue99, exec50, exec99, NULL) < 0)
+            goto cleanup;
+    }
+
+    vshTablePrintToStdout(table, ctl);
+
+    ret = true;
+
+ cleanup:
+    vshTableFree(table);
+    virTypedParamsFree(params, nparams);
+    virAdmServerFree(srv);
+    return ret;
+}
+
 /* --------------------------
  * Command server-clients-set
  * --------------------------
@@ -1115,6 +1294,351 @@ cmdDaemonLogOutputs(vshControl *ctl, const vshCmd *cmd)
     return true;
 }
 
+/* --------------------------
+ * Command daemon-log-dump
+ * --------------------------
+ */
+static const vshCmdInfo info_daemon_log_dump[] = {
+    {.name = "help",
+     .data = N_("dump the in-memory logging buffers of daemon")
+    },
+    {.name = "desc",
+     .data = N_("Write the messages kept by the 'buffer' logging outputs of "
+                "daemon to their files.")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_daemon_log_dump[] = {
+    {.name = NULL}
+};
+
+static bool
+cmdDaemonLogDump(vshControl *ctl, const vshCmd *cmd G_GNUC_UNUSED)
+{
+    vshAdmControlPtr priv = ctl->privData;
+
+    if (virAdmConnectDumpLoggingBuffers(priv->conn, 0) < 0) {
+        vshError(ctl, _("Unable to dump daemon logging buffers"));
+        return false;
+    }
+
+    return true;
+}
+
+/* -------------------------------
+ * Command daemon-lock-profiling
+ * -------------------------------
+ */
+static const vshCmdInfo info_daemon_lock_profiling[] = {
+    {.name = "help",
+     .data = N_("enable or disable lock profiling of daemon")
+    },
+    {.name = "desc",
+     .data = N_("Enable or disable the accounting of lock contention of "
+                "daemon's objects.")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_daemon_lock_profiling[] = {
+    {.name = "enable",
+     .type = VSH_OT_BOOL,
+     .help = N_("start accounting lock contention"),
+    },
+    {.name = "disable",
+     .type = VSH_OT_BOOL,
+     .help = N_("stop accounting lock contention"),
+    },
+    {.name = NULL}
+};
+
+static bool
+cmdDaemonLockProfiling(vshControl *ctl, const vshCmd *cmd)
+{
+    vshAdmControlPtr priv = ctl->privData;
+    bool enable = vshCommandOptBool(cmd, "enable");
+    bool disable = vshCommandOptBool(cmd, "disable");
+
+    VSH_EXCLUSIVE_OPTIONS_VAR(enable, disable);
+
+    if (!enable && !disable) {
+        vshError(ctl, "%s", _("Either --enable or --disable is required"));
+        return false;
+    }
+
+    if (virAdmConnectSetLockProfiling(priv->conn, enable, 0) < 0) {
+        vshError(ctl, "%s", _("Unable to change lock profiling of daemon"));
+        return false;
+    }
+
+    return true;
+}
+
+/* --------------------------
+ * Command daemon-lock-stats
+ * --------------------------
+ */
+static const vshCmdInfo info_daemon_lock_stats[] = {
+    {.name = "help",
+     .data = N_("show lock contention statistics of daemon")
+    },
+    {.name = "desc",
+     .data = N_("Show how often and how long the locks of daemon's objects "
+                "were waited for and held, per object class, while lock "
+                "profiling was enabled.")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_daemon_lock_stats[] = {
+    {.name = "reset",
+     .type = VSH_OT_BOOL,
+     .help = N_("reset the statistics after retrieving them"),
+    },
+    {.name = NULL}
+};
+
+static bool
+cmdDaemonLockStats(vshControl *ctl, const vshCmd *cmd)
+{
+    bool ret = false;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    unsigned int count = 0;
+    unsigned int flags = 0;
+    size_t i;
+    vshAdmControlPtr priv = ctl->privData;
+    vshTablePtr table = NULL;
+
+    if (vshCommandOptBool(cmd, "reset"))
+        flags |= VIR_ADMIN_LOCK_STATS_RESET;
+
+    if (virAdmConnectGetLockStats(priv->conn, &params, &nparams, flags) < 0) {
+        vshError(ctl, "%s", _("Unable to retrieve lock statistics "
+                              "from daemon"));
+        goto cleanup;
+    }
+
+    if (virTypedParamsGetUInt(params, nparams,
+                              VIR_ADMIN_LOCK_STATS_COUNT, &count) < 0)
+        goto cleanup;
+
+    table = vshTableNew(_("Class"), _("Acquired"), _("Contended"),
+                        _("Wait (us)"), _("Max wait (us)"),
+                        _("Hold (us)"), _("Max hold (us)"), NULL);
+    if (!table)
+        goto cleanup;
+
+    for (i = 0; i < count; i++) {
+        static const char *fields[] = {
+            "acquired", "contended", "wait_time", "wait_time_max",
+            "hold_time", "hold_time_max",
+        };
+        char field[VIR_TYPED_PARAM_FIELD_LENGTH];
+        const char *name = NULL;
+        char *values[G_N_ELEMENTS(fields)] = { NULL };
+        size_t j;
+        int rc = -1;
+
+        g_snprintf(field, sizeof(field), "class.%zu.name", i);
+        if (virTypedParamsGetString(params, nparams, field, &name) < 0)
+            goto cleanup;
+
+        for (j = 0; j < G_N_ELEMENTS(fields); j++) {
+            unsigned long long val = 0;
+
+            g_snprintf(field, sizeof(field), "class.%zu.%s", i, fields[j]);
+            if (virTypedParamsGetULLong(params, nparams, field, &val) < 0)
+                break;
+            values[j] = g_strdup_printf("%llu", val);
+        }
+
+        if (j == G_N_ELEMENTS(fields))
+            rc = vshTableRowAppend(table, NULLSTR(name), values[0], values[1],
+                                   values[2], values[3], values[4], values[5],
+                                   NULL);
+
+        for (j = 0; j < G_N_ELEMENTS(fields); j++)
+            g_free(values[j]);
+
+        if (rc < 0)
+            goto cleanup;
+    }
+
+    vshTablePrintToStdout(table, ctl);
+
+    ret = true;
+
+ cleanup:
+    vshTableFree(table);
+    virTypedParamsFree(params, nparams);
+    return ret;
+}
+
+/* -------------------------------
+ * Command daemon-event-loop-stats
+ * -------------------------------
+ */
+static const vshCmdInfo info_daemon_event_loop_stats[] = {
+    {.name = "help",
+     .data = N_("show event loop statistics of daemon")
+    },
+    {.name = "desc",
+     .data = N_("Show how long the callbacks dispatched by daemon's event "
+                "loop took and how late its timers fired.")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_daemon_event_loop_stats[] = {
+    {.name = "reset",
+     .type = VSH_OT_BOOL,
+     .help = N_("reset the statistics after retrieving them"),
+    },
+    {.name = NULL}
+};
+
+/* The daemon reports log2 buckets, with only the non-empty ones present */
+#define VSH_ADM_EVENT_LOOP_STATS_BUCKETS 24
+
+static bool
+cmdDaemonEventLoopStats(vshControl *ctl, const vshCmd *cmd)
+{
+    bool ret = false;
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    unsigned long long dispatched = 0;
+    unsigned long long slow = 0;
+    unsigned long long dispatchMax = 0;
+    unsigned int flags = 0;
+    size_t i;
+    vshAdmControlPtr priv = ctl->privData;
+    vshTablePtr table = NULL;
+
+    if (vshCommandOptBool(cmd, "reset"))
+        flags |= VIR_ADMIN_EVENT_LOOP_STATS_RESET;
+
+    if (virAdmConnectGetEventLoopStats(priv->conn, &params,
+                                       &nparams, flags) < 0) {
+        vshError(ctl, "%s", _("Unable to retrieve event loop statistics "
+                              "from daemon"));
+        goto cleanup;
+    }
+
+    if (virTypedParamsGetULLong(params, nparams,
+                                VIR_ADMIN_EVENT_LOOP_STATS_DISPATCHED,
+                                &dispatched) < 0 ||
+        virTypedParamsGetULLong(params, nparams,
+                                VIR_ADMIN_EVENT_LOOP_STATS_SLOW,
+                                &slow) < 0 ||
+        virTypedParamsGetULLong(params, nparams,
+                                VIR_ADMIN_EVENT_LOOP_STATS_DISPATCH_TIME_MAX,
+                                &dispatchMax) < 0)
+        goto cleanup;
+
+    vshPrint(ctl, "%-20s: %llu\n", _("Dispatched"), dispatched);
+    vshPrint(ctl, "%-20s: %llu\n", _("Slow"), slow);
+    vshPrint(ctl, "%-20s: %llu\n\n", _("Max dispatch (us)"), dispatchMax);
+
+    table = vshTableNew(_("Time (us)"), _("Callbacks"), _("Late timers"), NULL);
+    if (!table)
+        goto cleanup;
+
+    for (i = 0; i < VSH_ADM_EVENT_LOOP_STATS_BUCKETS; i++) {
+        char field[VIR_TYPED_PARAM_FIELD_LENGTH];
+        unsigned long long callbacks = 0;
+        unsigned long long late = 0;
+        g_autofree char *range = NULL;
+        g_autofree char *callbacksStr = NULL;
+        g_autofree char *lateStr = NULL;
+
+        g_snprintf(field, sizeof(field), "dispatch_time.%zu", i);
+        if (virTypedParamsGetULLong(params, nparams, field, &callbacks) < 0)
+            goto cleanup;
+        g_snprintf(field, sizeof(field), "timer_lag.%zu", i);
+        if (virTypedParamsGetULLong(params, nparams, field, &late) < 0)
+            goto cleanup;
+
+        if (!callbacks && !late)
+            continue;
+
+        if (i == VSH_ADM_EVENT_LOOP_STATS_BUCKETS - 1)
+            range = g_strdup_printf(">= %llu", 1ULL << (i - 1));
+        else
+            range = g_strdup_printf("< %llu", 1ULL << i);
+        callbacksStr = g_strdup_printf("%llu", callbacks);
+        lateStr = g_strdup_printf("%llu", late);
+
+        if (vshTableRowAppend(table, range, callbacksStr, lateStr, NULL) < 0)
+            goto cleanup;
+    }
+
+    vshTablePrintToStdout(table, ctl);
+
+    ret = true;
+
+ cleanup:
+    vshTableFree(table);
+    virTypedParamsFree(params, nparams);
+    return ret;
+}
+
+/* ---------------------------
+ * Command daemon-memory-stats
+ * ---------------------------
+ */
+static const vshCmdInfo info_daemon_memory_stats[] = {
+    {.name = "help",
+     .data = N_("show memory statistics of daemon")
+    },
+    {.name = "desc",
+     .data = N_("Show how much memory daemon uses and how much of it is "
+                "saved by sharing strings between objects.")
+    },
+    {.name = NULL}
+};
+
+static const vshCmdOptDef opts_daemon_memory_stats[] = {
+    {.name = NULL}
+};
+
+static bool
+cmdDaemonMemoryStats(vshControl *ctl, const vshCmd *cmd G_GNUC_UNUSED)
+{
+    virTypedParameterPtr params = NULL;
+    int nparams = 0;
+    unsigned long long value;
+    size_t i;
+    vshAdmControlPtr priv = ctl->privData;
+    const struct {
+        const char *field;
+        const char *label;
+    } fields[] = {
+        { VIR_ADMIN_MEMORY_STATS_HEAP_SIZE, N_("Heap size") },
+        { VIR_ADMIN_MEMORY_STATS_HEAP_USED, N_("Heap used") },
+        { VIR_ADMIN_MEMORY_STATS_HEAP_FREE, N_("Heap free") },
+        { VIR_ADMIN_MEMORY_STATS_INTERNED_STRINGS, N_("Shared strings") },
+        { VIR_ADMIN_MEMORY_STATS_INTERNED_REFS, N_("Shared string refs") },
+        { VIR_ADMIN_MEMORY_STATS_INTERNED_BYTES, N_("Shared string bytes") },
+    };
+
+    if (virAdmConnectGetMemoryStats(priv->conn, &params, &nparams, 0) < 0) {
+        vshError(ctl, "%s", _("Unable to retrieve memory statistics "
+                              "from daemon"));
+        return false;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(fields); i++) {
+        if (virTypedParamsGetULLong(params, nparams,
+                                    fields[i].field, &value) == 1)
+            vshPrint(ctl, "%-20s: %llu\n", _(fields[i].label), value);
+    }
+
+    virTypedParamsFree(params, nparams);
+    return true;
+}
+
 static void *
 vshAdmConnectionHandler(vshControl *ctl)
 {
@@ -1454,6 +1978,16 @@ static const vshCmdDef monitoringCmds[] = {
      .info = info_srv_clients_info,
      .flags = 0
     },
+    {.name = "srv-stats",
+     .flags = VSH_CMD_FLAG_ALIAS,
+     .alias = "server-stats"
+    },
+    {.name = "server-stats",
+     .handler = cmdSrvStats,
+     .opts = opts_srv_stats,
+     .info = info_srv_stats,
+     .flags = 0
+    },
     {.name = NULL}
 };
 
@@ -1506,6 +2040,36 @@ static const vshCmdDef managementCmds[] = {
      .info = info_daemon_log_outputs,
      .flags = 0
     },
+    {.name = "daemon-log-dump",
+     .handler = cmdDaemonLogDump,
+     .opts = opts_daemon_log_dump,
+     .info = info_daemon_log_dump,
+     .flags = 0
+    },
+    {.name = "daemon-lock-profiling",
+     .handler = cmdDaemonLockProfiling,
+     .opts = opts_daemon_lock_profiling,
+     .info = info_daemon_lock_profiling,
+     .flags = 0
+    },
+    {.name = "daemon-lock-stats",
+     .handler = cmdDaemonLockStats,
+     .opts = opts_daemon_lock_stats,
+     .info = info_daemon_lock_stats,
+     .flags = 0
+    },
+    {.name = "daemon-event-loop-stats",
+     .handler = cmdDaemonEventLoopStats,
+     .opts = opts_daemon_event_loop_stats,
+     .info = info_daemon_event_loop_stats,
+     .flags = 0
+    },
+    {.name = "daemon-memory-stats",
+     .handler = cmdDaemonMemoryStats,
+     .opts = opts_daemon_memory_stats,
+     .info = info_daemon_memory_stats,
+     .flags = 0
+    },
     {.name = NULL}
 };
 
@@ -0,0 +1,209 @@
+/*
+ * virt-log-decode.c: Turn binary trace logs into text
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#ifdef HAVE_LIBINTL_H
+# include <libintl.h>
+#endif /* HAVE_LIBINTL_H */
+#include <getopt.h>
+
+#include "internal.h"
+#include "virgettext.h"
+#include "virlog.h"
+#include "virtime.h"
+
+/* Upper bound of a record, anything larger means the file is corrupted */
+#define VIR_LOG_DECODE_RECORD_MAX (16 * 1024 * 1024)
+
+static void
+show_help(FILE *out, const char *argv0)
+{
+    fprintf(out,
+            _("\n"
+              "syntax: %s [OPTIONS] [FILE...]\n"
+              "\n"
+              " Decodes binary trace logs written by the 'trace' log output\n"
+              " in the given files, or standard input, to standard output.\n"
+              "\n"
+              " Options:\n"
+              "   -h, --help     Display command line help\n"
+              "   -v, --version  Display command version\n"
+              "\n"),
+            argv0);
+}
+
+static void
+show_version(FILE *out, const char *argv0)
+{
+    fprintf(out, "version: %s %s\n", argv0, VERSION);
+}
+
+static const struct option argOptions[] = {
+    { "help", 0, NULL, 'h', },
+    { "version", 0, NULL, 'v', },
+    { NULL, 0, NULL, '\0', }
+};
+
+
+static const char *
+virLogDecodePriority(uint32_t priority)
+{
+    switch (priority) {
+    case VIR_LOG_DEBUG:
+        return "debug";
+    case VIR_LOG_INFO:
+        return "info";
+    case VIR_LOG_WARN:
+        return "warning";
+    case VIR_LOG_ERROR:
+        return "error";
+    }
+    return "unknown";
+}
+
+
+/*
+ * Prints the records of @in in the format of the 'file' log output, with
+ * the name of the log source added.
+ *
+ * Returns 0 on success, -1 if @in isn't a complete trace log.
+ */
+static int
+virLogDecode(FILE *in,
+             const char *name)
+{
+    char magic[sizeof(VIR_LOG_TRACE_MAGIC) - 1];
+    virLogTraceRecord rec;
+    g_autofree char *buf = NULL;
+    size_t bufsize = 0;
+
+    if (fread(magic, sizeof(magic), 1, in) != 1 ||
+        memcmp(magic, VIR_LOG_TRACE_MAGIC, sizeof(magic)) != 0) {
+        fprintf(stderr, _("%s: not a libvirt trace log\n"), name);
+        return -1;
+    }
+
+    while (fread(&rec, sizeof(rec), 1, in) == 1) {
+        char timestamp[VIR_TIME_STRING_BUFLEN];
+        const char *source;
+        const char *func;
+        const char *msg;
+        size_t len;
+
+        if (rec.len < 3 || rec.len > VIR_LOG_DECODE_RECORD_MAX) {
+            fprintf(stderr, _("%s: corrupted record\n"), name);
+            return -1;
+        }
+
+        if (rec.len > bufsize) {
+            bufsize = rec.len;
+            buf = g_renew(char, buf, bufsize);
+        }
+
+        if (fread(buf, rec.len, 1, in) != 1 || buf[rec.len - 1] != '\0') {
+            fprintf(stderr, _("%s: truncated record\n"), name);
+            return -1;
+        }
+
+        source = buf;
+        len = strlen(source) + 1;
+        if (len >= rec.len)
+            goto corrupted;
+        func = source + len;
+        len += strlen(func) + 1;
+        if (len >= rec.len)
+            goto corrupted;
+        msg = buf + len;
+
+        if (virTimeStringThenRaw(rec.when, timestamp) < 0)
+            timestamp[0] = '\0';
+
+        if (*func) {
+            printf("%s: %llu: %s : %s : %s:%u : %s\n",
+                   timestamp, (unsigned long long) rec.thread,
+                   virLogDecodePriority(rec.priority), source,
+                   func, rec.linenr, msg);
+        } else {
+            printf("%s: %llu: %s : %s : %s\n",
+                   timestamp, (unsigned long long) rec.thread,
+                   virLogDecodePriority(rec.priority), source, msg);
+        }
+    }
+
+    if (ferror(in)) {
+        fprintf(stderr, _("%s: read error: %s\n"), name, g_strerror(errno));
+        return -1;
+    }
+
+    return 0;
+
+ corrupted:
+    fprintf(stderr, _("%s: corrupted record\n"), name);
+    return -1;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    int ret = EXIT_SUCCESS;
+    int c;
+
+    if (virGettextInitialize() < 0)
+        return EXIT_FAILURE;
+
+    while ((c = getopt_long(argc, argv, "hv", argOptions, NULL)) != -1) {
+        switch (c) {
+        case 'v':
+            show_version(stdout, argv[0]);
+            return EXIT_SUCCESS;
+
+        case 'h':
+            show_help(stdout, argv[0]);
+            return EXIT_SUCCESS;
+
+        case '?':
+        default:
+            show_help(stderr, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (optind == argc)
+        return virLogDecode(stdin, "stdin") < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    for (; optind < argc; optind++) {
+        FILE *in;
+
+        if (!(in = fopen(argv[optind], "rb"))) {
+            fprintf(stderr, _("%s: cannot open: %s\n"),
+                    argv[optind], g_strerror(errno));
+            ret = EXIT_FAILURE;
+            continue;
+        }
+
+        if (virLogDecode(in, argv[optind]) < 0)
+            ret = EXIT_FAILURE;
+
+        fclose(in);
+    }
+
+    return ret;
+}
@@ -0,0 +1,683 @@
+/*
+ * virt-rpc-bench.c: Measure the RPC throughput and latency of a daemon
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#ifdef HAVE_LIBINTL_H
+# include <libintl.h>
+#endif /* HAVE_LIBINTL_H */
+#include <getopt.h>
+
+#include "internal.h"
+#include "virenum.h"
+#include "virgettext.h"
+#include "virstring.h"
+#include "virthread.h"
+
+typedef enum {
+    VIR_RPC_BENCH_CALL_VERSION,
+    VIR_RPC_BENCH_CALL_LOOKUP,
+    VIR_RPC_BENCH_CALL_INFO,
+    VIR_RPC_BENCH_CALL_XML,
+    VIR_RPC_BENCH_CALL_LIST,
+    VIR_RPC_BENCH_CALL_STATS,
+    VIR_RPC_BENCH_CALL_SCREENSHOT,
+
+    VIR_RPC_BENCH_CALL_LAST
+} virRPCBenchCall;
+
+VIR_ENUM_DECL(virRPCBenchCall);
+VIR_ENUM_IMPL(virRPCBenchCall,
+              VIR_RPC_BENCH_CALL_LAST,
+              "version",
+              "lookup",
+              "info",
+              "xml",
+              "list",
+              "stats",
+              "screenshot",
+);
+
+/* Latencies of the calls of one type, in microseconds */
+typedef struct _virRPCBenchSamples virRPCBenchSamples;
+struct _virRPCBenchSamples {
+    unsigned long long *latency;
+    size_t nlatency;
+    size_t alloc;
+    unsigned long long errors;
+    unsigned long long bytes;
+};
+
+typedef struct _virRPCBench virRPCBench;
+struct _virRPCBench {
+    const char *uri;
+    size_t nclients;
+    unsigned int duration;
+    size_t nsubscribers;
+    bool json;
+    unsigned int weights[VIR_RPC_BENCH_CALL_LAST];
+    unsigned int totalWeight;
+
+    gint64 end;
+    int quit;   /* g_atomic access only */
+    int events; /* g_atomic access only */
+};
+
+typedef struct _virRPCBenchClient virRPCBenchClient;
+struct _virRPCBenchClient {
+    virRPCBench *bench;
+    size_t id;
+    virThread thread;
+    virConnectPtr conn;
+    virDomainPtr *doms;
+    int ndoms;
+    virRPCBenchSamples samples[VIR_RPC_BENCH_CALL_LAST];
+};
+
+
+static void
+show_help(FILE *out, const char *argv0)
+{
+    fprintf(out,
+            _("\n"
+              "syntax: %s [OPTIONS]\n"
+              "\n"
+              " Measures the throughput and latency of the RPC calls of\n"
+              " concurrent clients of a daemon.\n"
+              "\n"
+              " Options:\n"
+              "   -c, --connect URI      Connect to URI, default test+unix:///default\n"
+              "   -n, --clients N        Number of concurrent clients, default 8\n"
+              "   -d, --duration SECS    Duration of the run, default 10\n"
+              "   -m, --mix CALL=WEIGHT[,CALL=WEIGHT...]\n"
+              "                          Mix of calls, default version=1\n"
+              "   -e, --events N         Number of connections subscribed to\n"
+              "                          lifecycle events, default 0\n"
+              "   -j, --json             Print the results as JSON\n"
+              "   -h, --help             Display command line help\n"
+              "   -v, --version          Display command version\n"
+              "\n"
+              " Calls: version, lookup, info, xml, list, stats and\n"
+              " screenshot, which transfers the screenshot over a stream.\n"
+              "\n"),
+            argv0);
+}
+
+static void
+show_version(FILE *out, const char *argv0)
+{
+    fprintf(out, "version: %s %s\n", argv0, VERSION);
+}
+
+static const struct option argOptions[] = {
+    { "connect", 1, NULL, 'c', },
+    { "clients", 1, NULL, 'n', },
+    { "duration", 1, NULL, 'd', },
+    { "mix", 1, NULL, 'm', },
+    { "events", 1, NULL, 'e', },
+    { "json", 0, NULL, 'j', },
+    { "help", 0, NULL, 'h', },
+    { "version", 0, NULL, 'v', },
+    { NULL, 0, NULL, '\0', }
+};
+
+
+static int
+virRPCBenchParseMix(virRPCBench *bench,
+                    const char *mix)
+{
+    g_auto(GStrv) items = g_strsplit(mix, ",", 0);
+    size_t i;
+
+    memset(bench->weights, 0, sizeof(bench->weights));
+    bench->totalWeight = 0;
+
+    for (i = 0; items[i]; i++) {
+        char *weight = strchr(items[i], '=');
+        unsigned int value = 1;
+        int call;
+
+        if (weight) {
+            *weight++ = '\0';
+            if (virStrToLong_ui(weight, NULL, 10, &value) < 0) {
+                fprintf(stderr, _("invalid weight '%s'\n"), weight);
+                return -1;
+            }
+        }
+
+        if ((call = virRPCBenchCallTypeFromString(items[i])) < 0) {
+            fprintf(stderr, _("unknown call '%s'\n"), items[i]);
+            return -1;
+        }
+
+        bench->weights[call] = value;
+        bench->totalWeight += value;
+    }
+
+    if (bench->totalWeight == 0) {
+        fprintf(stderr, "%s", _("the mix of calls is empty\n"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static virRPCBenchCall
+virRPCBenchPickCall(virRPCBench *bench,
+                    GRand *rand)
+{
+    unsigned int pick = g_rand_int_range(rand, 0, bench->totalWeight);
+    size_t i;
+
+    for (i = 0; i < VIR_RPC_BENCH_CALL_LAST; i++) {
+        if (pick < bench->weights[i])
+            return i;
+        pick -= bench->weights[i];
+    }
+
+    return VIR_RPC_BENCH_CALL_VERSION;
+}
+
+
+static int
+virRPCBenchScreenshot(virConnectPtr conn,
+                      virDomainPtr dom,
+                      unsigned long long *bytes)
+{
+    virStreamPtr st;
+    g_autofree char *mime = NULL;
+    char buf[64 * 1024];
+    int got;
+
+    if (!(st = virStreamNew(conn, 0)))
+        return -1;
+
+    if (!(mime = virDomainScreenshot(dom, st, 0, 0)))
+        goto error;
+
+    while ((got = virStreamRecv(st, buf, sizeof(buf))) > 0)
+        *bytes += got;
+
+    if (got < 0 || virStreamFinish(st) < 0)
+        goto error;
+
+    virStreamFree(st);
+    return 0;
+
+ error:
+    virStreamAbort(st);
+    virStreamFree(st);
+    return -1;
+}
+
+
+static int
+virRPCBenchRunCall(virRPCBenchClient *client,
+                   virRPCBenchCall call,
+                   GRand *rand)
+{
+    virDomainPtr dom = NULL;
+    int ret = -1;
+
+    if (call != VIR_RPC_BENCH_CALL_VERSION &&
+        call != VIR_RPC_BENCH_CALL_LIST) {
+        if (client->ndoms == 0)
+            return -1;
+        dom = client->doms[g_rand_int_range(rand, 0, client->ndoms)];
+    }
+
+    switch (call) {
+    case VIR_RPC_BENCH_CALL_VERSION: {
+        unsigned long version;
+
+        ret = virConnectGetLibVersion(client->conn, &version);
+        break;
+    }
+
+    case VIR_RPC_BENCH_CALL_LOOKUP: {
+        virDomainPtr tmp;
+
+        if ((tmp = virDomainLookupByName(client->conn, virDomainGetName(dom)))) {
+            virDomainFree(tmp);
+            ret = 0;
+        }
+        break;
+    }
+
+    case VIR_RPC_BENCH_CALL_INFO: {
+        virDomainInfo info;
+
+        ret = virDomainGetInfo(dom, &info);
+        break;
+    }
+
+    case VIR_RPC_BENCH_CALL_XML: {
+        g_autofree char *xml = NULL;
+
+        if ((xml = virDomainGetXMLDesc(dom, 0))) {
+            client->samples[call].bytes += strlen(xml);
+            ret = 0;
+        }
+        break;
+    }
+
+    case VIR_RPC_BENCH_CALL_LIST: {
+        virDomainPtr *doms = NULL;
+        int ndoms;
+        int i;
+
+        if ((ndoms = virConnectListAllDomains(client->conn, &doms, 0)) >= 0) {
+            for (i = 0; i < ndoms; i++)
+                virDomainFree(doms[i]);
+            g_free(doms);
+            ret = 0;
+        }
+        break;
+    }
+
+    case VIR_RPC_BENCH_CALL_STATS: {
+        virDomainPtr doms[] = { dom, NULL };
+        virDomainStatsRecordPtr *records = NULL;
+
+        if (virDomainListGetStats(doms, 0, &records, 0) >= 0) {
+            virDomainStatsRecordListFree(records);
+            ret = 0;
+        }
+        break;
+    }
+
+    case VIR_RPC_BENCH_CALL_SCREENSHOT:
+        ret = virRPCBenchScreenshot(client->conn, dom,
+                                    &client->samples[call].bytes);
+        break;
+
+    case VIR_RPC_BENCH_CALL_LAST:
+        break;
+    }
+
+    return ret;
+}
+
+
+static void
+virRPCBenchClientRun(void *opaque)
+{
+    virRPCBenchClient *client = opaque;
+    virRPCBench *bench = client->bench;
+    g_autoptr(GRand) rand = g_rand_new_with_seed(client->id);
+
+    while (!g_atomic_int_get(&bench->quit)) {
+        virRPCBenchCall call = virRPCBenchPickCall(bench, rand);
+        virRPCBenchSamples *samples = &client->samples[call];
+        gint64 start = g_get_monotonic_time();
+        gint64 now;
+
+        if (virRPCBenchRunCall(client, call, rand) < 0) {
+            samples->errors++;
+        } else {
+            now = g_get_monotonic_time();
+
+            if (samples->nlatency == samples->alloc) {
+                samples->alloc = MAX(samples->alloc * 2, 1024);
+                samples->latency = g_renew(unsigned long long,
+                                           samples->latency, samples->alloc);
+            }
+            samples->latency[samples->nlatency++] = now - start;
+        }
+
+        if (g_get_monotonic_time() >= bench->end)
+            break;
+    }
+}
+
+
+static void
+virRPCBenchEventLoop(void *opaque)
+{
+    virRPCBench *bench = opaque;
+
+    while (!g_atomic_int_get(&bench->quit)) {
+        if (virEventRunDefaultImpl() < 0)
+            break;
+    }
+}
+
+
+static void
+virRPCBenchTick(int timer G_GNUC_UNUSED,
+                void *opaque G_GNUC_UNUSED)
+{
+}
+
+
+static int
+virRPCBenchLifecycleEvent(virConnectPtr conn G_GNUC_UNUSED,
+                          virDomainPtr dom G_GNUC_UNUSED,
+                          int event G_GNUC_UNUSED,
+                          int detail G_GNUC_UNUSED,
+                          void *opaque)
+{
+    virRPCBench *bench = opaque;
+
+    g_atomic_int_inc(&bench->events);
+    return 0;
+}
+
+
+static int
+virRPCBenchCompare(const void *a,
+                   const void *b)
+{
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+
+/* Returns the @permille permille of the sorted @latency */
+static unsigned long long
+virRPCBenchPercentile(const unsigned long long *latency,
+                      size_t nlatency,
+                      unsigned int permille)
+{
+    if (nlatency == 0)
+        return 0;
+
+    return latency[(nlatency - 1) * permille / 1000];
+}
+
+
+static void
+virRPCBenchReportOne(virRPCBench *bench,
+                     const char *name,
+                     virRPCBenchSamples *samples,
+                     double elapsed,
+                     bool last)
+{
+    unsigned long long *lat = samples->latency;
+    size_t n = samples->nlatency;
+
+    qsort(lat, n, sizeof(*lat), virRPCBenchCompare);
+
+    if (bench->json) {
+        printf("    \"%s\": {\"calls\": %zu, \"errors\": %llu, "
+               "\"calls_per_sec\": %.1f, \"bytes_per_sec\": %.1f, "
+               "\"p50_us\": %llu, \"p99_us\": %llu, \"p999_us\": %llu, "
+               "\"max_us\": %llu}%s\n",
+               name, n, samples->errors, n / elapsed,
+               samples->bytes / elapsed,
+               virRPCBenchPercentile(lat, n, 500),
+               virRPCBenchPercentile(lat, n, 990),
+               virRPCBenchPercentile(lat, n, 999),
+               n ? lat[n - 1] : 0,
+               last ? "" : ",");
+    } else {
+        printf("%-12s %10zu %8llu %12.1f %10llu %10llu %10llu %10llu\n",
+               name, n, samples->errors, n / elapsed,
+               virRPCBenchPercentile(lat, n, 500),
+               virRPCBenchPercentile(lat, n, 990),
+               virRPCBenchPercentile(lat, n, 999),
+               n ? lat[n - 1] : 0);
+    }
+}
+
+
+/* Merges the samples of all clients and prints them per call and in total */
+static void
+virRPCBenchReport(virRPCBench *bench,
+                  virRPCBenchClient *clients,
+                  double elapsed)
+{
+    virRPCBenchSamples total = { 0 };
+    virRPCBenchSamples merged[VIR_RPC_BENCH_CALL_LAST] = { { 0 } };
+    int events = g_atomic_int_get(&bench->events);
+    size_t i;
+    size_t j;
+
+    for (i = 0; i < VIR_RPC_BENCH_CALL_LAST; i++) {
+        for (j = 0; j < bench->nclients; j++) {
+            virRPCBenchSamples *samples = &clients[j].samples[i];
+
+            merged[i].latency = g_renew(unsigned long long, merged[i].latency,
+                                        merged[i].nlatency + samples->nlatency);
+            memcpy(merged[i].latency + merged[i].nlatency, samples->latency,
+                   samples->nlatency * sizeof(*samples->latency));
+            merged[i].nlatency += samples->nlatency;
+            merged[i].errors += samples->errors;
+            merged[i].bytes += samples->bytes;
+        }
+
+        total.latency = g_renew(unsigned long long, total.latency,
+                                total.nlatency + merged[i].nlatency);
+        memcpy(total.latency + total.nlatency, merged[i].latency,
+               merged[i].nlatency * sizeof(*merged[i].latency));
+        total.nlatency += merged[i].nlatency;
+        total.errors += merged[i].errors;
+        total.bytes += merged[i].bytes;
+    }
+
+    if (bench->json) {
+        printf("{\n  \"uri\": \"%s\", \"clients\": %zu, \"seconds\": %.3f,\n"
+               "  \"events\": %d, \"events_per_sec\": %.1f,\n"
+               "  \"calls\": {\n",
+               bench->uri, bench->nclients, elapsed,
+               events, events / elapsed);
+    } else {
+        printf("%-12s %10s %8s %12s %10s %10s %10s %10s\n",
+               _("call"), _("calls"), _("errors"), _("calls/s"),
+               _("p50(us)"), _("p99(us)"), _("p99.9(us)"), _("max(us)"));
+    }
+
+    for (i = 0; i < VIR_RPC_BENCH_CALL_LAST; i++) {
+        if (bench->weights[i] == 0)
+            continue;
+        virRPCBenchReportOne(bench, virRPCBenchCallTypeToString(i),
+                             &merged[i], elapsed, false);
+    }
+    virRPCBenchReportOne(bench, "total", &total, elapsed, true);
+
+    if (bench->json) {
+        printf("  }\n}\n");
+    } else {
+        if (total.bytes)
+            printf(_("\nstream and reply data: %.1f KiB/s\n"),
+                   total.bytes / elapsed / 1024);
+        if (bench->nsubscribers)
+            printf(_("\nevents received: %d (%.1f/s) by %zu subscribers\n"),
+                   events, events / elapsed, bench->nsubscribers);
+    }
+
+    for (i = 0; i < VIR_RPC_BENCH_CALL_LAST; i++)
+        g_free(merged[i].latency);
+    g_free(total.latency);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    virRPCBench bench = {
+        .uri = "test+unix:///default",
+        .nclients = 8,
+        .duration = 10,
+    };
+    g_autofree virRPCBenchClient *clients = NULL;
+    g_autofree virConnectPtr *subscribers = NULL;
+    virThread eventLoop;
+    bool haveEventLoop = false;
+    gint64 start;
+    unsigned long long value;
+    int ret = EXIT_FAILURE;
+    size_t i;
+    int j;
+    int c;
+
+    if (virGettextInitialize() < 0)
+        return EXIT_FAILURE;
+
+    if (virRPCBenchParseMix(&bench, "version=1") < 0)
+        return EXIT_FAILURE;
+
+    while ((c = getopt_long(argc, argv, "c:n:d:m:e:jhv", argOptions, NULL)) != -1) {
+        switch (c) {
+        case 'c':
+            bench.uri = optarg;
+            break;
+
+        case 'n':
+        case 'e':
+            if (virStrToLong_ull(optarg, NULL, 10, &value) < 0 ||
+                (c == 'n' && value == 0)) {
+                fprintf(stderr, _("invalid number '%s'\n"), optarg);
+                return EXIT_FAILURE;
+            }
+            if (c == 'n')
+                bench.nclients = value;
+            else
+                bench.nsubscribers = value;
+            break;
+
+        case 'd':
+            if (virStrToLong_ui(optarg, NULL, 10, &bench.duration) < 0 ||
+                bench.duration == 0) {
+                fprintf(stderr, _("invalid duration '%s'\n"), optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+
+        case 'm':
+            if (virRPCBenchParseMix(&bench, optarg) < 0)
+                return EXIT_FAILURE;
+            break;
+
+        case 'j':
+            bench.json = true;
+            break;
+
+        case 'v':
+            show_version(stdout, argv[0]);
+            return EXIT_SUCCESS;
+
+        case 'h':
+            show_help(stdout, argv[0]);
+            return EXIT_SUCCESS;
+
+        case '?':
+        default:
+            show_help(stderr, argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (optind != argc) {
+        show_help(stderr, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (bench.nsubscribers &&
+        virEventRegisterDefaultImpl() < 0)
+        return EXIT_FAILURE;
+
+    clients = g_new0(virRPCBenchClient, bench.nclients);
+    subscribers = g_new0(virConnectPtr, bench.nsubscribers);
+
+    /* Connect all clients up front, so that connecting doesn't skew the
+     * measurement */
+    for (i = 0; i < bench.nclients; i++) {
+        clients[i].bench = &bench;
+        clients[i].id = i;
+
+        if (!(clients[i].conn = virConnectOpen(bench.uri)) ||
+            (clients[i].ndoms = virConnectListAllDomains(clients[i].conn,
+                                                         &clients[i].doms,
+                                                         0)) < 0)
+            goto cleanup;
+    }
+
+    for (i = 0; i < bench.nsubscribers; i++) {
+        if (!(subscribers[i] = virConnectOpenReadOnly(bench.uri)) ||
+            virConnectDomainEventRegisterAny(subscribers[i], NULL,
+                                             VIR_DOMAIN_EVENT_ID_LIFECYCLE,
+                                             VIR_DOMAIN_EVENT_CALLBACK(virRPCBenchLifecycleEvent),
+                                             &bench, NULL) < 0)
+            goto cleanup;
+    }
+
+    if (bench.nsubscribers) {
+        /* Keeps the event loop waking up, so that it notices @quit */
+        if (virEventAddTimeout(100, virRPCBenchTick, NULL, NULL) < 0)
+            goto cleanup;
+
+        if (virThreadCreate(&eventLoop, true, virRPCBenchEventLoop, &bench) < 0) {
+            fprintf(stderr, "%s", _("unable to create event loop thread\n"));
+            goto cleanup;
+        }
+        haveEventLoop = true;
+    }
+
+    start = g_get_monotonic_time();
+    bench.end = start + bench.duration * G_USEC_PER_SEC;
+
+    for (i = 0; i < bench.nclients; i++) {
+        if (virThreadCreate(&clients[i].thread, true,
+                            virRPCBenchClientRun, &clients[i]) < 0) {
+            fprintf(stderr, "%s", _("unable to create client thread\n"));
+            g_atomic_int_set(&bench.quit, 1);
+            while (i-- > 0)
+                virThreadJoin(&clients[i].thread);
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < bench.nclients; i++)
+        virThreadJoin(&clients[i].thread);
+
+    virRPCBenchReport(&bench, clients,
+                      (g_get_monotonic_time() - start) / (double) G_USEC_PER_SEC);
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    if (ret != EXIT_SUCCESS)
+        fprintf(stderr, _("error: %s\n"), virGetLastErrorMessage());
+
+    g_atomic_int_set(&bench.quit, 1);
+
+    for (i = 0; i < bench.nsubscribers; i++) {
+        if (subscribers[i])
+            virConnectClose(subscribers[i]);
+    }
+
+    if (haveEventLoop)
+        virThreadJoin(&eventLoop);
+
+    for (i = 0; i < bench.nclients; i++) {
+        for (j = 0; j < clients[i].ndoms; j++)
+            virDomainFree(clients[i].doms[j]);
+        g_free(clients[i].doms);
+        for (c = 0; c < VIR_RPC_BENCH_CALL_LAST; c++)
+            g_free(clients[i].samples[c].latency);
+        if (clients[i].conn)
+            virConnectClose(clients[i].conn);
+    }
+
+    return ret;
+}
@@ -42,6 +42,7 @@
 #include "vircommand.h"
 #include "virstring.h"
 #include "virutil.h"
+#include "virjson.h"
 
 #ifdef WITH_READLINE
 /* For autocompletion */
@@ -184,7 +185,26 @@ vshStringToArray(const char *str,
     return nstr_tokens;
 }
 
-virErrorPtr last_error;
+/* Errors are per thread so that commands can run concurrently in batch
+ * mode */
+__thread virErrorPtr last_error;
+
+/* Output of the command run by the current thread in batch mode, NULL
+ * if it goes straight to stdout and stderr */
+static __thread virBufferPtr vshBatchOut;
+static __thread virBufferPtr vshBatchErr;
+
+/* Serializes (re)connecting of concurrent batch mode commands */
+static virMutex vshBatchConnLock = VIR_MUTEX_INITIALIZER;
+
+static void
+vshOutput(const char *str)
+{
+    if (vshBatchOut)
+        virBufferAdd(vshBatchOut, str, -1);
+    else
+        fputs(str, stdout);
+}
 
 /*
  * Quieten libvirt until we're done with the command.
@@ -1283,12 +1303,23 @@ vshCommandRun(vshControl *ctl, const vshCmd *cmd)
 
         before = g_get_real_time();
 
-        if ((cmd->def->flags & VSH_CMD_FLAG_NOCONNECT) ||
-            (hooks && hooks->connHandler && hooks->connHandler(ctl))) {
+        if (cmd->def->flags & VSH_CMD_FLAG_NOCONNECT) {
             ret = cmd->def->handler(ctl, cmd);
         } else {
-            /* connection is not usable, return error */
-            ret = false;
+            bool usable = false;
+
+            if (hooks && hooks->connHandler) {
+                virMutexLock(&vshBatchConnLock);
+                usable = !!hooks->connHandler(ctl);
+                virMutexUnlock(&vshBatchConnLock);
+            }
+
+            if (usable) {
+                ret = cmd->def->handler(ctl, cmd);
+            } else {
+                /* connection is not usable, return error */
+                ret = false;
+            }
         }
 
         after = g_get_real_time();
@@ -1322,6 +1353,206 @@ vshCommandRun(vshControl *ctl, const vshCmd *cmd)
     return ret;
 }
 
+/* ---------------
+ * Batch mode
+ * ---------------
+ */
+
+typedef struct _vshBatchJob vshBatchJob;
+struct _vshBatchJob {
+    vshControl *ctl;
+    size_t id;
+    char *line;
+    vshCmd *cmd;
+    virThread thread;
+    bool running;
+    virBuffer out;
+    virBuffer err;
+    bool ret;
+};
+
+
+static void
+vshBatchJobRun(void *opaque)
+{
+    vshBatchJob *job = opaque;
+
+    vshBatchOut = &job->out;
+    vshBatchErr = &job->err;
+    job->ret = vshCommandRun(job->ctl, job->cmd);
+    vshBatchOut = NULL;
+    vshBatchErr = NULL;
+}
+
+
+/* Wait for @job to finish, print its result and free it. */
+static bool
+vshBatchJobFinish(vshBatchJob *job)
+{
+    vshControl *ctl = job->ctl;
+    bool ret;
+
+    if (job->running)
+        virThreadJoin(&job->thread);
+    ret = job->ret;
+
+    if (ctl->batchJSON) {
+        g_autoptr(virJSONValue) result = virJSONValueNewObject();
+        g_autofree char *str = NULL;
+
+        if (virJSONValueObjectAppendNumberUlong(result, "id", job->id) < 0 ||
+            virJSONValueObjectAppendString(result, "command", job->line) < 0 ||
+            virJSONValueObjectAppendBoolean(result, "success", job->ret) < 0 ||
+            virJSONValueObjectAppendString(result, "output",
+                                           NULLSTR_EMPTY(virBufferCurrentContent(&job->out))) < 0 ||
+            virJSONValueObjectAppendString(result, "error",
+                                           NULLSTR_EMPTY(virBufferCurrentContent(&job->err))) < 0 ||
+            !(str = virJSONValueToString(result, false))) {
+            vshReportError(ctl);
+            ret = false;
+        } else {
+            printf("%s\n", str);
+        }
+    } else {
+        fputs(NULLSTR_EMPTY(virBufferCurrentContent(&job->out)), stdout);
+        fflush(stdout);
+        fputs(NULLSTR_EMPTY(virBufferCurrentContent(&job->err)), stderr);
+        fflush(stderr);
+    }
+
+    virBufferFreeAndReset(&job->out);
+    virBufferFreeAndReset(&job->err);
+    vshCommandFree(job->cmd);
+    g_free(job->line);
+    g_free(job);
+    return ret;
+}
+
+
+static char *
+vshBatchReadLine(FILE *in)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    char chunk[1024];
+
+    while (fgets(chunk, sizeof(chunk), in)) {
+        size_t len = strlen(chunk);
+
+        if (len > 0 && chunk[len - 1] == '\n') {
+            virBufferAdd(&buf, chunk, len - 1);
+            return virBufferContentAndReset(&buf);
+        }
+        virBufferAdd(&buf, chunk, len);
+    }
+
+    if (feof(in) && virBufferUse(&buf) > 0)
+        return virBufferContentAndReset(&buf);
+    return NULL;
+}
+
+
+/**
+ * vshBatchRun:
+ * @ctl: virsh control structure
+ * @in: stream to read commands from
+ *
+ * Reads commands from @in, one command string per line, and runs up to
+ * ctl->batchJobs of them concurrently over the connection shared by all
+ * of them. The results are printed in the order of the commands, either
+ * as if the commands ran one after another or, with ctl->batchJSON, as
+ * one JSON object per command. Commands which don't use the connection,
+ * such as 'connect' or 'cd', change the state of virsh and therefore
+ * wait for all earlier commands and run alone.
+ *
+ * Returns true if all commands succeeded, false otherwise.
+ */
+bool
+vshBatchRun(vshControl *ctl, FILE *in)
+{
+    const vshClientHooks *hooks = ctl->hooks;
+    vshBatchJob **jobs = g_new0(vshBatchJob *, ctl->batchJobs);
+    size_t head = 0;
+    size_t njobs = 0;
+    size_t id = 0;
+    bool quit = false;
+    bool ret = true;
+    char *line;
+
+    /* Open the connection before the commands start to share it */
+    if (hooks && hooks->connHandler && !hooks->connHandler(ctl)) {
+        vshReportError(ctl);
+        ret = false;
+    }
+
+    while (!quit && (line = vshBatchReadLine(in))) {
+        vshBatchJob *job;
+        bool exclusive = false;
+        vshCmd *c;
+
+        if (!vshCommandStringParse(ctl, line, NULL)) {
+            /* the parser reported the error */
+            ret = false;
+            g_free(line);
+            continue;
+        }
+
+        if (!ctl->cmd) {
+            g_free(line);
+            continue;
+        }
+
+        job = g_new0(vshBatchJob, 1);
+        job->ctl = ctl;
+        job->id = id++;
+        job->line = line;
+        job->cmd = g_steal_pointer(&ctl->cmd);
+
+        for (c = job->cmd; c; c = c->next) {
+            if (c->def->flags & VSH_CMD_FLAG_NOCONNECT)
+                exclusive = true;
+            if (STREQ(c->def->name, "quit") || STREQ(c->def->name, "exit"))
+                quit = true;
+        }
+
+        /* Make room for the job, or wait for all earlier ones if it must
+         * run alone */
+        while (njobs > 0 && (exclusive || njobs == ctl->batchJobs)) {
+            if (!vshBatchJobFinish(jobs[head]))
+                ret = false;
+            head = (head + 1) % ctl->batchJobs;
+            njobs--;
+        }
+
+        if (exclusive) {
+            vshBatchJobRun(job);
+            if (!vshBatchJobFinish(job))
+                ret = false;
+            continue;
+        }
+
+        if (virThreadCreate(&job->thread, true, vshBatchJobRun, job) < 0) {
+            /* run it synchronously instead */
+            vshResetLibvirtError();
+            vshBatchJobRun(job);
+        } else {
+            job->running = true;
+        }
+        jobs[(head + njobs) % ctl->batchJobs] = job;
+        njobs++;
+    }
+
+    while (njobs > 0) {
+        if (!vshBatchJobFinish(jobs[head]))
+            ret = false;
+        head = (head + 1) % ctl->batchJobs;
+        njobs--;
+    }
+
+    g_free(jobs);
+    return ret;
+}
+
+
 /* ---------------
  * Command parsing
  * ---------------
@@ -1825,7 +2056,7 @@ vshDebug(vshControl *ctl, int level, const char *format, ...)
     va_start(ap, format);
     str = g_strdup_vprintf(format, ap);
     va_end(ap);
-    fputs(str, stdout);
+    vshOutput(str);
     VIR_FREE(str);
 }
 
@@ -1841,7 +2072,7 @@ vshPrintExtra(vshControl *ctl, const char *format, ...)
     va_start(ap, format);
     str = g_strdup_vprintf(format, ap);
     va_end(ap);
-    fputs(str, stdout);
+    vshOutput(str);
     VIR_FREE(str);
 }
 
@@ -1855,7 +2086,7 @@ vshPrint(vshControl *ctl G_GNUC_UNUSED, const char *format, ...)
     va_start(ap, format);
     str = g_strdup_vprintf(format, ap);
     va_end(ap);
-    fputs(str, stdout);
+    vshOutput(str);
     VIR_FREE(str);
 }
 
@@ -1963,16 +2194,21 @@ vshError(vshControl *ctl, const char *format, ...)
         va_end(ap);
     }
 
+    va_start(ap, format);
+    str = g_strdup_vprintf(format, ap);
+    va_end(ap);
+
+    if (vshBatchErr) {
+        virBufferAsprintf(vshBatchErr, "%s%s\n", _("error: "), NULLSTR(str));
+        VIR_FREE(str);
+        return;
+    }
+
     /* Most output is to stdout, but if someone ran virsh 2>&1, then
      * printing to stderr will not interleave correctly with stdout
      * unless we flush between every transition between streams.  */
     fflush(stdout);
     fputs(_("error: "), stderr);
-
-    va_start(ap, format);
-    str = g_strdup_vprintf(format, ap);
-    va_end(ap);
-
     fprintf(stderr, "%s\n", NULLSTR(str));
     fflush(stderr);
     VIR_FREE(str);
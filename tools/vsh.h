@@ -200,6 +200,9 @@ struct _vshControl {
     bool imode;                 /* interactive mode? */
     bool quiet;                 /* quiet mode */
     bool timing;                /* print timing info? */
+    unsigned int batchJobs;     /* batch mode: number of commands to run
+                                 * concurrently, 0 if not in batch mode */
+    bool batchJSON;             /* batch mode: print results as JSON */
     int debug;                  /* print debug messages? */
     char *logfile;              /* log file name */
     int log_fd;                 /* log file descriptor */
@@ -293,6 +296,7 @@ int vshBlockJobOptionBandwidth(vshControl *ctl,
                                unsigned long *bandwidth);
 bool vshCommandOptBool(const vshCmd *cmd, const char *name);
 bool vshCommandRun(vshControl *ctl, const vshCmd *cmd);
+bool vshBatchRun(vshControl *ctl, FILE *in);
 bool vshCommandStringParse(vshControl *ctl, char *cmdstr, vshCmd **partial);
 
 const vshCmdOpt *vshCommandOptArgv(vshControl *ctl, const vshCmd *cmd,
@@ -330,7 +334,7 @@ int vshTreePrint(vshControl *ctl, vshTreeLookup lookup, void *opaque,
                  int num_devices, int devid);
 
 /* error handling */
-extern virErrorPtr last_error;
+extern __thread virErrorPtr last_error;
 void vshErrorHandler(void *opaque, virErrorPtr error);
 void vshReportError(vshControl *ctl);
 void vshResetLibvirtError(void);